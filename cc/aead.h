@@ -17,12 +17,44 @@
 #ifndef TINK_AEAD_H_
 #define TINK_AEAD_H_
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
 #include "tink/util/statusor.h"
 
 namespace crypto {
 namespace tink {
 
+///////////////////////////////////////////////////////////////////////////////
+// Encryption and decryption with associated data which was fixed when the
+// object was created, with Aead::BindAssociatedData(). Implementations may
+// process the associated data once instead of on every call. The ciphertexts
+// are the same as those of the Aead which created the object, and can be
+// decrypted by it.
+//
+// Implementations are expected to be thread safe.
+class BoundAead {
+ public:
+  // Like Aead::Encrypt() with the bound associated data.
+  virtual crypto::tink::util::StatusOr<std::string> Encrypt(
+      absl::string_view plaintext) const = 0;
+
+  // Like Aead::Decrypt() with the bound associated data.
+  virtual crypto::tink::util::StatusOr<std::string> Decrypt(
+      absl::string_view ciphertext) const = 0;
+
+  virtual ~BoundAead() {}
+};
+
 ///////////////////////////////////////////////////////////////////////////////
 // The interface for authenticated encryption with associated data.
 // Implementations of this interface are secure against adaptive
@@ -49,9 +81,278 @@ class Aead {
       absl::string_view ciphertext,
       absl::string_view associated_data) const = 0;
 
+  // Returns the size of the ciphertext that Encrypt() and EncryptInto()
+  // produce for a plaintext of 'plaintext_size' bytes. The default
+  // implementation returns an UNIMPLEMENTED error, since the size is not
+  // known for arbitrary implementations.
+  virtual crypto::tink::util::StatusOr<int64_t> CiphertextSize(
+      int64_t plaintext_size) const {
+    return crypto::tink::util::Status(
+        crypto::tink::util::error::UNIMPLEMENTED,
+        "CiphertextSize() is not supported by this Aead");
+  }
+
+  // Like Encrypt(), but writes the ciphertext to 'buffer' instead of
+  // allocating a new string, and returns the number of bytes written.
+  // 'buffer' must not overlap with the inputs, and must hold at least
+  // CiphertextSize(plaintext.size()) bytes. The default implementation
+  // calls Encrypt() and copies the result.
+  virtual crypto::tink::util::StatusOr<int64_t> EncryptInto(
+      absl::string_view plaintext, absl::string_view associated_data,
+      absl::Span<char> buffer) const {
+    auto encrypt_result = Encrypt(plaintext, associated_data);
+    if (!encrypt_result.ok()) return encrypt_result.status();
+    const std::string& ciphertext = encrypt_result.ValueOrDie();
+    if (buffer.size() < ciphertext.size()) {
+      return crypto::tink::util::Status(
+          crypto::tink::util::error::INVALID_ARGUMENT, "Buffer too small");
+    }
+    std::memcpy(buffer.data(), ciphertext.data(), ciphertext.size());
+    return ciphertext.size();
+  }
+
+  // Like Decrypt(), but writes the plaintext to 'buffer' instead of
+  // allocating a new string, and returns the number of bytes written.
+  // 'buffer' must not overlap with the inputs; a buffer of
+  // ciphertext.size() bytes is always large enough. The default
+  // implementation calls Decrypt() and copies the result.
+  virtual crypto::tink::util::StatusOr<int64_t> DecryptInto(
+      absl::string_view ciphertext, absl::string_view associated_data,
+      absl::Span<char> buffer) const {
+    auto decrypt_result = Decrypt(ciphertext, associated_data);
+    if (!decrypt_result.ok()) return decrypt_result.status();
+    const std::string& plaintext = decrypt_result.ValueOrDie();
+    if (buffer.size() < plaintext.size()) {
+      return crypto::tink::util::Status(
+          crypto::tink::util::error::INVALID_ARGUMENT, "Buffer too small");
+    }
+    std::memcpy(buffer.data(), plaintext.data(), plaintext.size());
+    return plaintext.size();
+  }
+
+  // Like EncryptInto(), but 'plaintext' and 'associated_data' are given as
+  // sequences of fragments, which are processed as if they were
+  // concatenated, and the ciphertext is written across the fragments of
+  // 'buffers', filling each one before moving on to the next. Returns the
+  // number of bytes written. The ciphertext is the same as for the
+  // concatenated inputs, so it can be decrypted with Decrypt(). 'buffers'
+  // must not overlap with the inputs, and must hold at least
+  // CiphertextSize() bytes in total. The default implementation concatenates
+  // the inputs (unless they consist of a single fragment), encrypts them and
+  // copies the result.
+  virtual crypto::tink::util::StatusOr<int64_t> EncryptFragmentsInto(
+      absl::Span<const absl::string_view> plaintext,
+      absl::Span<const absl::string_view> associated_data,
+      absl::Span<const absl::Span<char>> buffers) const {
+    std::string plaintext_buffer;
+    std::string associated_data_buffer;
+    absl::string_view joined_plaintext = Gather(plaintext, &plaintext_buffer);
+    absl::string_view joined_associated_data =
+        Gather(associated_data, &associated_data_buffer);
+    if (buffers.size() == 1) {
+      return EncryptInto(joined_plaintext, joined_associated_data, buffers[0]);
+    }
+    auto encrypt_result = Encrypt(joined_plaintext, joined_associated_data);
+    if (!encrypt_result.ok()) return encrypt_result.status();
+    const std::string& ciphertext = encrypt_result.ValueOrDie();
+    auto status = ScatterInto(ciphertext, buffers, nullptr);
+    if (!status.ok()) return status;
+    return ciphertext.size();
+  }
+
+  // Encrypts a batch of (plaintext, associated_data) pairs. The ciphertexts
+  // are stored back-to-back in '*arena', which is overwritten, and
+  // '*ciphertexts' is set to one view into '*arena' per input, in the order
+  // of 'inputs'. The views are valid until '*arena' is modified. Fails if the
+  // encryption of any input fails.
+  virtual crypto::tink::util::Status BatchEncrypt(
+      absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs,
+      std::string* arena, std::vector<absl::string_view>* ciphertexts) const {
+    std::vector<int64_t> sizes;
+    sizes.reserve(inputs.size());
+    int64_t total_size = 0;
+    for (const auto& input : inputs) {
+      auto size_result = CiphertextSize(input.first.size());
+      if (!size_result.ok()) {
+        return BatchEncryptOneByOne(inputs, arena, ciphertexts);
+      }
+      sizes.push_back(size_result.ValueOrDie());
+      total_size += size_result.ValueOrDie();
+    }
+    arena->resize(total_size);
+    int64_t offset = 0;
+    for (size_t i = 0; i < inputs.size(); i++) {
+      auto written_result = EncryptInto(
+          inputs[i].first, inputs[i].second,
+          absl::MakeSpan(&(*arena)[0] + offset, sizes[i]));
+      if (!written_result.ok()) return written_result.status();
+      sizes[i] = written_result.ValueOrDie();
+      offset += sizes[i];
+    }
+    arena->resize(offset);
+    SplitArena(*arena, sizes, ciphertexts);
+    return crypto::tink::util::Status::OK;
+  }
+
+  // Decrypts a batch of (ciphertext, associated_data) pairs. The plaintexts
+  // are stored back-to-back in '*arena', which is overwritten, and
+  // '*plaintexts' is set to one view into '*arena' per input, in the order
+  // of 'inputs'. The views are valid until '*arena' is modified. Fails if the
+  // decryption of any input fails.
+  virtual crypto::tink::util::Status BatchDecrypt(
+      absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs,
+      std::string* arena, std::vector<absl::string_view>* plaintexts) const {
+    int64_t total_size = 0;
+    for (const auto& input : inputs) total_size += input.first.size();
+    // Plaintexts are never longer than their ciphertexts.
+    arena->resize(total_size);
+    std::vector<int64_t> sizes;
+    sizes.reserve(inputs.size());
+    int64_t offset = 0;
+    for (const auto& input : inputs) {
+      auto written_result = DecryptInto(
+          input.first, input.second,
+          absl::MakeSpan(&(*arena)[0] + offset, input.first.size()));
+      if (!written_result.ok()) return written_result.status();
+      sizes.push_back(written_result.ValueOrDie());
+      offset += written_result.ValueOrDie();
+    }
+    arena->resize(offset);
+    SplitArena(*arena, sizes, plaintexts);
+    return crypto::tink::util::Status::OK;
+  }
+
+  // Returns a ciphertext of the plaintext of 'ciphertext' which is
+  // encrypted like Encrypt() would, e.g. to rotate stored ciphertexts to the
+  // current key of a keyset. Implementations may return 'ciphertext' itself
+  // if it already is such a ciphertext, without authenticating it. The
+  // default implementation decrypts into a buffer which is wiped afterwards,
+  // and encrypts its contents.
+  virtual crypto::tink::util::StatusOr<std::string> ReEncrypt(
+      absl::string_view ciphertext, absl::string_view associated_data) const {
+    // Plaintexts are never longer than their ciphertexts.
+    crypto::tink::util::SecretData plaintext(ciphertext.size());
+    auto written_result = DecryptInto(
+        ciphertext, associated_data,
+        absl::MakeSpan(reinterpret_cast<char*>(plaintext.data()),
+                       plaintext.size()));
+    if (!written_result.ok()) return written_result.status();
+    return Encrypt(absl::string_view(reinterpret_cast<char*>(plaintext.data()),
+                                     written_result.ValueOrDie()),
+                   associated_data);
+  }
+
+  // Returns a BoundAead which encrypts and decrypts with 'associated_data'.
+  // It must not outlive this Aead. Useful when many messages share the same
+  // associated data. The default implementation keeps a copy of
+  // 'associated_data' and calls Encrypt() and Decrypt().
+  virtual crypto::tink::util::StatusOr<std::unique_ptr<BoundAead>>
+  BindAssociatedData(absl::string_view associated_data) const;
+
   virtual ~Aead() {}
+
+ protected:
+  // Returns the concatenation of 'fragments', which is stored in '*buffer'
+  // unless there is at most one fragment.
+  static absl::string_view Gather(absl::Span<const absl::string_view> fragments,
+                                  std::string* buffer) {
+    if (fragments.empty()) return absl::string_view();
+    if (fragments.size() == 1) return fragments[0];
+    size_t size = 0;
+    for (absl::string_view fragment : fragments) size += fragment.size();
+    buffer->clear();
+    buffer->reserve(size);
+    for (absl::string_view fragment : fragments) {
+      buffer->append(fragment.data(), fragment.size());
+    }
+    return *buffer;
+  }
+
+  // Copies 'data' to the start of 'buffers', filling each one before moving
+  // on to the next, and sets '*remaining' (unless it is nullptr) to the
+  // non-empty rest of 'buffers'. Fails if 'buffers' are too small.
+  static crypto::tink::util::Status ScatterInto(
+      absl::string_view data, absl::Span<const absl::Span<char>> buffers,
+      std::vector<absl::Span<char>>* remaining) {
+    std::vector<absl::Span<char>> rest;
+    for (absl::Span<char> buffer : buffers) {
+      size_t size = std::min(buffer.size(), data.size());
+      if (size > 0) std::memcpy(buffer.data(), data.data(), size);
+      data.remove_prefix(size);
+      buffer.remove_prefix(size);
+      if (!buffer.empty() && remaining != nullptr) rest.push_back(buffer);
+    }
+    if (!data.empty()) {
+      return crypto::tink::util::Status(
+          crypto::tink::util::error::INVALID_ARGUMENT, "Buffer too small");
+    }
+    if (remaining != nullptr) *remaining = std::move(rest);
+    return crypto::tink::util::Status::OK;
+  }
+
+  // Sets '*views' to consecutive substrings of 'arena' of the given sizes.
+  static void SplitArena(absl::string_view arena,
+                         const std::vector<int64_t>& sizes,
+                         std::vector<absl::string_view>* views) {
+    views->clear();
+    views->reserve(sizes.size());
+    int64_t offset = 0;
+    for (int64_t size : sizes) {
+      views->push_back(arena.substr(offset, size));
+      offset += size;
+    }
+  }
+
+ private:
+  class DefaultBoundAead;
+
+  // BatchEncrypt() for implementations which do not report their
+  // ciphertext size.
+  crypto::tink::util::Status BatchEncryptOneByOne(
+      absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs,
+      std::string* arena, std::vector<absl::string_view>* ciphertexts) const {
+    arena->clear();
+    std::vector<int64_t> sizes;
+    sizes.reserve(inputs.size());
+    for (const auto& input : inputs) {
+      auto encrypt_result = Encrypt(input.first, input.second);
+      if (!encrypt_result.ok()) return encrypt_result.status();
+      arena->append(encrypt_result.ValueOrDie());
+      sizes.push_back(encrypt_result.ValueOrDie().size());
+    }
+    SplitArena(*arena, sizes, ciphertexts);
+    return crypto::tink::util::Status::OK;
+  }
 };
 
+class Aead::DefaultBoundAead : public BoundAead {
+ public:
+  DefaultBoundAead(const Aead* aead, absl::string_view associated_data)
+      : aead_(aead),
+        associated_data_(associated_data.data(), associated_data.size()) {}
+
+  crypto::tink::util::StatusOr<std::string> Encrypt(
+      absl::string_view plaintext) const override {
+    return aead_->Encrypt(plaintext, associated_data_);
+  }
+
+  crypto::tink::util::StatusOr<std::string> Decrypt(
+      absl::string_view ciphertext) const override {
+    return aead_->Decrypt(ciphertext, associated_data_);
+  }
+
+ private:
+  const Aead* const aead_;
+  const std::string associated_data_;
+};
+
+inline crypto::tink::util::StatusOr<std::unique_ptr<BoundAead>>
+Aead::BindAssociatedData(absl::string_view associated_data) const {
+  std::unique_ptr<BoundAead> bound(
+      new DefaultBoundAead(this, associated_data));
+  return std::move(bound);
+}
+
 }  // namespace tink
 }  // namespace crypto
 
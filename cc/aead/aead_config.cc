@@ -54,11 +54,10 @@ util::Status AeadConfig::Register() {
 
   // Register key managers which utilize the FIPS validated BoringCrypto
   // implementations.
-  status = Registry::RegisterKeyTypeManager(
-      absl::make_unique<AesCtrHmacAeadKeyManager>(), true);
+  status =
+      Registry::RegisterKeyTypeManagerLazily<AesCtrHmacAeadKeyManager>(true);
   if (!status.ok()) return status;
-  status = Registry::RegisterKeyTypeManager(
-      absl::make_unique<AesGcmKeyManager>(), true);
+  status = Registry::RegisterKeyTypeManagerLazily<AesGcmKeyManager>(true);
   if (!status.ok()) return status;
 
   if (kUseOnlyFips) {
@@ -66,20 +65,17 @@ util::Status AeadConfig::Register() {
   }
 
   // Register all the other key managers.
-  status = Registry::RegisterKeyTypeManager(
-      absl::make_unique<AesGcmSivKeyManager>(), true);
+  status = Registry::RegisterKeyTypeManagerLazily<AesGcmSivKeyManager>(true);
   if (!status.ok()) return status;
-  status = Registry::RegisterKeyTypeManager(
-      absl::make_unique<AesEaxKeyManager>(), true);
+  status = Registry::RegisterKeyTypeManagerLazily<AesEaxKeyManager>(true);
   if (!status.ok()) return status;
-  status = Registry::RegisterKeyTypeManager(
-      absl::make_unique<XChaCha20Poly1305KeyManager>(), true);
+  status =
+      Registry::RegisterKeyTypeManagerLazily<XChaCha20Poly1305KeyManager>(true);
   if (!status.ok()) return status;
-  status = Registry::RegisterKeyTypeManager(
-      absl::make_unique<KmsAeadKeyManager>(), true);
+  status = Registry::RegisterKeyTypeManagerLazily<KmsAeadKeyManager>(true);
   if (!status.ok()) return status;
-  status = Registry::RegisterKeyTypeManager(
-      absl::make_unique<KmsEnvelopeAeadKeyManager>(), true);
+  status =
+      Registry::RegisterKeyTypeManagerLazily<KmsEnvelopeAeadKeyManager>(true);
   if (!status.ok()) return status;
 
   return util::OkStatus();
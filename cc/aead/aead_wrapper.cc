@@ -16,10 +16,28 @@
 
 #include "tink/aead/aead_wrapper.h"
 
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "tink/aead.h"
 #include "tink/crypto_format.h"
+#include "tink/internal/monitoring_util.h"
+#include "tink/internal/raw_key_hint.h"
+#include "tink/internal/tracing_span.h"
+#include "tink/key_usage.h"
+#include "tink/memory_stats.h"
+#include "tink/monitoring.h"
 #include "tink/primitive_set.h"
+#include "tink/subtle/subtle_util.h"
 #include "tink/subtle/subtle_util_boringssl.h"
+#include "tink/util/secret_data.h"
 #include "tink/util/status.h"
 #include "tink/util/statusor.h"
 
@@ -28,6 +46,8 @@ namespace tink {
 
 namespace {
 
+using AeadEntry = PrimitiveSet<Aead>::Entry<Aead>;
+
 util::Status Validate(PrimitiveSet<Aead>* aead_set) {
   if (aead_set == nullptr) {
     return util::Status(util::error::INTERNAL, "aead_set must be non-NULL");
@@ -39,10 +59,16 @@ util::Status Validate(PrimitiveSet<Aead>* aead_set) {
   return util::Status::OK;
 }
 
-class AeadSetWrapper : public Aead {
+class AeadSetWrapper : public Aead,
+                       public MemoryStatsSource,
+                       public KeyUsageSource {
  public:
-  explicit AeadSetWrapper(std::unique_ptr<PrimitiveSet<Aead>> aead_set)
-      : aead_set_(std::move(aead_set)) {}
+  AeadSetWrapper(std::unique_ptr<PrimitiveSet<Aead>> aead_set,
+                 PrimitiveSet<Aead>::ResolvedPrimary primary)
+      : monitoring_(
+            internal::MonitoringRecorder::ForPrimitiveSet(*aead_set, "aead")),
+        aead_set_(std::move(aead_set)),
+        primary_(primary) {}
 
   crypto::tink::util::StatusOr<std::string> Encrypt(
       absl::string_view plaintext,
@@ -52,10 +78,80 @@ class AeadSetWrapper : public Aead {
       absl::string_view ciphertext,
       absl::string_view associated_data) const override;
 
+  crypto::tink::util::StatusOr<int64_t> CiphertextSize(
+      int64_t plaintext_size) const override;
+
+  crypto::tink::util::StatusOr<int64_t> EncryptInto(
+      absl::string_view plaintext, absl::string_view associated_data,
+      absl::Span<char> buffer) const override;
+
+  crypto::tink::util::StatusOr<int64_t> EncryptFragmentsInto(
+      absl::Span<const absl::string_view> plaintext,
+      absl::Span<const absl::string_view> associated_data,
+      absl::Span<const absl::Span<char>> buffers) const override;
+
+  crypto::tink::util::StatusOr<int64_t> DecryptInto(
+      absl::string_view ciphertext, absl::string_view associated_data,
+      absl::Span<char> buffer) const override;
+
+  crypto::tink::util::Status BatchEncrypt(
+      absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs,
+      std::string* arena,
+      std::vector<absl::string_view>* ciphertexts) const override;
+
+  crypto::tink::util::Status BatchDecrypt(
+      absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs,
+      std::string* arena,
+      std::vector<absl::string_view>* plaintexts) const override;
+
+  crypto::tink::util::StatusOr<std::string> ReEncrypt(
+      absl::string_view ciphertext,
+      absl::string_view associated_data) const override;
+
+  crypto::tink::util::StatusOr<std::unique_ptr<BoundAead>> BindAssociatedData(
+      absl::string_view associated_data) const override;
+
+  MemoryStats GetMemoryStats() const override {
+    return aead_set_->GetMemoryStats("aead", sizeof(*this));
+  }
+
+  std::vector<KeyUsage> GetKeyUsage() const override {
+    return aead_set_->GetKeyUsage();
+  }
+
   ~AeadSetWrapper() override {}
 
  private:
+  class Bound;
+
+  // Returns the primitives whose prefix matches 'ciphertext', or nullptr if
+  // there are none.
+  const PrimitiveSet<Aead>::Primitives* GetPrefixedPrimitives(
+      absl::string_view ciphertext) const;
+
+  // EncryptInto, without monitoring.
+  crypto::tink::util::StatusOr<int64_t> EncryptIntoWithPrimary(
+      absl::string_view plaintext, absl::string_view associated_data,
+      absl::Span<char> buffer) const;
+
+  // BatchEncrypt, without monitoring.
+  crypto::tink::util::Status BatchEncryptWithPrimary(
+      absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs,
+      std::string* arena, std::vector<absl::string_view>* ciphertexts) const;
+
+  // Decrypts 'ciphertext' first with 'prefixed_primitives' (which may be
+  // nullptr), then with all RAW primitives. 'start' is the result of
+  // monitoring_.Start().
+  crypto::tink::util::StatusOr<int64_t> DecryptIntoWithPrimitives(
+      int64_t start, const PrimitiveSet<Aead>::Primitives* prefixed_primitives,
+      absl::string_view ciphertext, absl::string_view associated_data,
+      absl::Span<char> buffer) const;
+
+  internal::MonitoringRecorder monitoring_;
   std::unique_ptr<PrimitiveSet<Aead>> aead_set_;
+  internal::RawKeyHint<Aead> raw_key_hint_;
+  // Resolved once, since it is used by every encryption.
+  const PrimitiveSet<Aead>::ResolvedPrimary primary_;
 };
 
 util::StatusOr<std::string> AeadSetWrapper::Encrypt(
@@ -64,12 +160,294 @@ util::StatusOr<std::string> AeadSetWrapper::Encrypt(
   // regardless of whether the size is 0.
   plaintext = subtle::SubtleUtilBoringSSL::EnsureNonNull(plaintext);
   associated_data = subtle::SubtleUtilBoringSSL::EnsureNonNull(associated_data);
+  int64_t start = monitoring_.Start();
+
+  // If the primary can report its ciphertext size, the output prefix and
+  // the ciphertext are written into a single allocation.
+  auto size_result = CiphertextSize(plaintext.size());
+  if (size_result.ok()) {
+    std::string result;
+    subtle::ResizeStringUninitialized(&result, size_result.ValueOrDie());
+    auto written_result = EncryptIntoWithPrimary(plaintext, associated_data,
+                                                 absl::MakeSpan(result));
+    if (!written_result.ok()) {
+      monitoring_.RecordFailure(start, MonitoringOperation::kEncrypt,
+                                plaintext.size());
+      return written_result.status();
+    }
+    result.resize(written_result.ValueOrDie());
+    monitoring_.RecordSuccess(start, MonitoringOperation::kEncrypt,
+                              primary_.key_id, plaintext.size());
+    return result;
+  }
+
+  auto encrypt_result = primary_.primitive->Encrypt(plaintext, associated_data);
+  if (!encrypt_result.ok()) {
+    monitoring_.RecordFailure(start, MonitoringOperation::kEncrypt,
+                              plaintext.size());
+    return encrypt_result.status();
+  }
+  monitoring_.RecordSuccess(start, MonitoringOperation::kEncrypt,
+                            primary_.key_id, plaintext.size());
+  return absl::StrCat(primary_.output_prefix.view(),
+                      encrypt_result.ValueOrDie());
+}
+
+util::StatusOr<int64_t> AeadSetWrapper::CiphertextSize(
+    int64_t plaintext_size) const {
+  auto size_result = primary_.primitive->CiphertextSize(plaintext_size);
+  if (!size_result.ok()) return size_result.status();
+  return primary_.output_prefix.size() + size_result.ValueOrDie();
+}
+
+util::StatusOr<int64_t> AeadSetWrapper::EncryptInto(
+    absl::string_view plaintext, absl::string_view associated_data,
+    absl::Span<char> buffer) const {
+  // BoringSSL expects a non-null pointer for plaintext and additional_data,
+  // regardless of whether the size is 0.
+  plaintext = subtle::SubtleUtilBoringSSL::EnsureNonNull(plaintext);
+  associated_data = subtle::SubtleUtilBoringSSL::EnsureNonNull(associated_data);
+  int64_t start = monitoring_.Start();
+  auto written_result =
+      EncryptIntoWithPrimary(plaintext, associated_data, buffer);
+  if (!written_result.ok()) {
+    monitoring_.RecordFailure(start, MonitoringOperation::kEncrypt,
+                              plaintext.size());
+    return written_result.status();
+  }
+  monitoring_.RecordSuccess(start, MonitoringOperation::kEncrypt,
+                            primary_.key_id, plaintext.size());
+  return written_result;
+}
+
+util::StatusOr<int64_t> AeadSetWrapper::EncryptIntoWithPrimary(
+    absl::string_view plaintext, absl::string_view associated_data,
+    absl::Span<char> buffer) const {
+  absl::string_view key_id = primary_.output_prefix;
+  if (buffer.size() < key_id.size()) {
+    return util::Status(util::error::INVALID_ARGUMENT, "Buffer too small");
+  }
+  auto written_result = primary_.primitive->EncryptInto(
+      plaintext, associated_data, buffer.subspan(key_id.size()));
+  if (!written_result.ok()) return written_result.status();
+  std::memcpy(buffer.data(), key_id.data(), key_id.size());
+  return key_id.size() + written_result.ValueOrDie();
+}
+
+util::StatusOr<int64_t> AeadSetWrapper::EncryptFragmentsInto(
+    absl::Span<const absl::string_view> plaintext,
+    absl::Span<const absl::string_view> associated_data,
+    absl::Span<const absl::Span<char>> buffers) const {
+  int64_t plaintext_size = 0;
+  for (absl::string_view fragment : plaintext) {
+    plaintext_size += fragment.size();
+  }
+  int64_t start = monitoring_.Start();
+  // The output prefix goes to the start of the buffers, and the primary
+  // writes its ciphertext to the rest of them.
+  std::vector<absl::Span<char>> rest;
+  auto status = ScatterInto(primary_.output_prefix, buffers, &rest);
+  if (!status.ok()) {
+    monitoring_.RecordFailure(start, MonitoringOperation::kEncrypt,
+                              plaintext_size);
+    return status;
+  }
+  auto written_result = primary_.primitive->EncryptFragmentsInto(
+      plaintext, associated_data, rest);
+  if (!written_result.ok()) {
+    monitoring_.RecordFailure(start, MonitoringOperation::kEncrypt,
+                              plaintext_size);
+    return written_result.status();
+  }
+  monitoring_.RecordSuccess(start, MonitoringOperation::kEncrypt,
+                            primary_.key_id, plaintext_size);
+  return primary_.output_prefix.size() + written_result.ValueOrDie();
+}
+
+const PrimitiveSet<Aead>::Primitives* AeadSetWrapper::GetPrefixedPrimitives(
+    absl::string_view ciphertext) const {
+  if (ciphertext.length() <= CryptoFormat::kNonRawPrefixSize) return nullptr;
+  auto primitives_result = aead_set_->get_primitives(
+      ciphertext.substr(0, CryptoFormat::kNonRawPrefixSize));
+  if (!primitives_result.ok()) return nullptr;
+  return primitives_result.ValueOrDie();
+}
+
+util::StatusOr<int64_t> AeadSetWrapper::DecryptIntoWithPrimitives(
+    int64_t start, const PrimitiveSet<Aead>::Primitives* prefixed_primitives,
+    absl::string_view ciphertext, absl::string_view associated_data,
+    absl::Span<char> buffer) const {
+  internal::TracingSpan span("tink.aead.decrypt");
+  span.AddBytes(ciphertext.size());
+  if (prefixed_primitives != nullptr) {
+    absl::string_view raw_ciphertext =
+        ciphertext.substr(CryptoFormat::kNonRawPrefixSize);
+    for (auto& aead_entry : *prefixed_primitives) {
+      auto aead_result = aead_entry->get_primitive_or_status();
+      if (!aead_result.ok()) continue;
+      Aead& aead = *aead_result.ValueOrDie();
+      span.AddKeyTrial();
+      auto decrypt_result =
+          aead.DecryptInto(raw_ciphertext, associated_data, buffer);
+      if (decrypt_result.ok()) {
+        aead_entry->RecordDecryption();
+        monitoring_.RecordSuccess(start, MonitoringOperation::kDecrypt,
+                                  aead_entry->get_key_id(), ciphertext.size());
+        return decrypt_result.ValueOrDie();
+      } else {
+        // LOG that a matching key didn't decrypt the ciphertext.
+      }
+    }
+  }
+
+  // No matching key succeeded with decryption, try all RAW keys.
+  monitoring_.RecordRawFallback();
+  auto raw_primitives_result = aead_set_->get_raw_primitives();
+  if (raw_primitives_result.ok()) {
+    util::StatusOr<int64_t> decrypt_result(util::DecryptionFailedError());
+    const AeadEntry* aead_entry = raw_key_hint_.Try(
+        *raw_primitives_result.ValueOrDie(),
+        [&](const AeadEntry& entry) -> bool {
+          auto aead_result = entry.get_primitive_or_status();
+          if (!aead_result.ok()) return false;
+          span.AddKeyTrial();
+          decrypt_result = aead_result.ValueOrDie()->DecryptInto(
+              ciphertext, associated_data, buffer);
+          return decrypt_result.ok();
+        });
+    if (aead_entry != nullptr) {
+      monitoring_.RecordSuccess(start, MonitoringOperation::kDecrypt,
+                                aead_entry->get_key_id(), ciphertext.size());
+      return decrypt_result.ValueOrDie();
+    }
+  }
+  monitoring_.RecordFailure(start, MonitoringOperation::kDecrypt,
+                            ciphertext.size());
+  span.SetOk(false);
+  return util::DecryptionFailedError();
+}
+
+util::StatusOr<int64_t> AeadSetWrapper::DecryptInto(
+    absl::string_view ciphertext, absl::string_view associated_data,
+    absl::Span<char> buffer) const {
+  // BoringSSL expects a non-null pointer for plaintext and additional_data,
+  // regardless of whether the size is 0.
+  associated_data = subtle::SubtleUtilBoringSSL::EnsureNonNull(associated_data);
+  return DecryptIntoWithPrimitives(monitoring_.Start(),
+                                   GetPrefixedPrimitives(ciphertext),
+                                   ciphertext, associated_data, buffer);
+}
 
-  auto encrypt_result = aead_set_->get_primary()->get_primitive()
-      .Encrypt(plaintext, associated_data);
-  if (!encrypt_result.ok()) return encrypt_result.status();
-  const std::string& key_id = aead_set_->get_primary()->get_identifier();
-  return key_id + encrypt_result.ValueOrDie();
+util::Status AeadSetWrapper::BatchEncrypt(
+    absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs,
+    std::string* arena, std::vector<absl::string_view>* ciphertexts) const {
+  util::Status status = BatchEncryptWithPrimary(inputs, arena, ciphertexts);
+  // Batched operations are counted, but not sampled.
+  for (const auto& input : inputs) {
+    if (status.ok()) {
+      monitoring_.RecordSuccess(/*start=*/0, MonitoringOperation::kEncrypt,
+                                primary_.key_id, input.first.size());
+    } else {
+      monitoring_.RecordFailure(/*start=*/0, MonitoringOperation::kEncrypt,
+                                input.first.size());
+    }
+  }
+  return status;
+}
+
+util::Status AeadSetWrapper::BatchEncryptWithPrimary(
+    absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs,
+    std::string* arena, std::vector<absl::string_view>* ciphertexts) const {
+  absl::string_view key_id = primary_.output_prefix;
+  Aead& aead = *primary_.primitive;
+  if (key_id.empty()) {
+    // Without an output prefix the primary's own batching can be used as-is.
+    return aead.BatchEncrypt(inputs, arena, ciphertexts);
+  }
+
+  std::vector<int64_t> sizes;
+  sizes.reserve(inputs.size());
+  int64_t total_size = 0;
+  for (const auto& input : inputs) {
+    auto size_result = aead.CiphertextSize(input.first.size());
+    if (!size_result.ok()) break;
+    sizes.push_back(key_id.size() + size_result.ValueOrDie());
+    total_size += sizes.back();
+  }
+
+  if (sizes.size() != inputs.size()) {
+    // The primary cannot report its ciphertext size, encrypt one by one.
+    arena->clear();
+    sizes.clear();
+    for (const auto& input : inputs) {
+      auto encrypt_result = aead.Encrypt(
+          subtle::SubtleUtilBoringSSL::EnsureNonNull(input.first),
+          subtle::SubtleUtilBoringSSL::EnsureNonNull(input.second));
+      if (!encrypt_result.ok()) return encrypt_result.status();
+      arena->append(key_id.data(), key_id.size());
+      arena->append(encrypt_result.ValueOrDie());
+      sizes.push_back(key_id.size() + encrypt_result.ValueOrDie().size());
+    }
+    SplitArena(*arena, sizes, ciphertexts);
+    return util::Status::OK;
+  }
+
+  subtle::ResizeStringUninitialized(arena, total_size);
+  int64_t offset = 0;
+  for (size_t i = 0; i < inputs.size(); i++) {
+    char* output = &(*arena)[0] + offset;
+    std::memcpy(output, key_id.data(), key_id.size());
+    auto written_result = aead.EncryptInto(
+        subtle::SubtleUtilBoringSSL::EnsureNonNull(inputs[i].first),
+        subtle::SubtleUtilBoringSSL::EnsureNonNull(inputs[i].second),
+        absl::MakeSpan(output + key_id.size(), sizes[i] - key_id.size()));
+    if (!written_result.ok()) return written_result.status();
+    sizes[i] = key_id.size() + written_result.ValueOrDie();
+    offset += sizes[i];
+  }
+  arena->resize(offset);
+  SplitArena(*arena, sizes, ciphertexts);
+  return util::Status::OK;
+}
+
+util::Status AeadSetWrapper::BatchDecrypt(
+    absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs,
+    std::string* arena, std::vector<absl::string_view>* plaintexts) const {
+  int64_t total_size = 0;
+  for (const auto& input : inputs) total_size += input.first.size();
+  // Plaintexts are never longer than their ciphertexts.
+  subtle::ResizeStringUninitialized(arena, total_size);
+
+  // Batches are usually encrypted under a single key, so the result of the
+  // last prefix lookup is reused while the prefix does not change.
+  absl::string_view last_prefix;
+  const PrimitiveSet<Aead>::Primitives* prefixed_primitives = nullptr;
+  std::vector<int64_t> sizes;
+  sizes.reserve(inputs.size());
+  int64_t offset = 0;
+  for (const auto& input : inputs) {
+    absl::string_view ciphertext = input.first;
+    if (ciphertext.length() <= CryptoFormat::kNonRawPrefixSize) {
+      prefixed_primitives = nullptr;
+      last_prefix = absl::string_view();
+    } else if (last_prefix.empty() ||
+               ciphertext.substr(0, CryptoFormat::kNonRawPrefixSize) !=
+                   last_prefix) {
+      prefixed_primitives = GetPrefixedPrimitives(ciphertext);
+      last_prefix = ciphertext.substr(0, CryptoFormat::kNonRawPrefixSize);
+    }
+    // Batched operations are counted, but not sampled.
+    auto written_result = DecryptIntoWithPrimitives(
+        /*start=*/0, prefixed_primitives, ciphertext,
+        subtle::SubtleUtilBoringSSL::EnsureNonNull(input.second),
+        absl::MakeSpan(&(*arena)[0] + offset, ciphertext.size()));
+    if (!written_result.ok()) return written_result.status();
+    sizes.push_back(written_result.ValueOrDie());
+    offset += written_result.ValueOrDie();
+  }
+  arena->resize(offset);
+  SplitArena(*arena, sizes, plaintexts);
+  return util::Status::OK;
 }
 
 util::StatusOr<std::string> AeadSetWrapper::Decrypt(
@@ -77,6 +455,9 @@ util::StatusOr<std::string> AeadSetWrapper::Decrypt(
   // BoringSSL expects a non-null pointer for plaintext and additional_data,
   // regardless of whether the size is 0.
   associated_data = subtle::SubtleUtilBoringSSL::EnsureNonNull(associated_data);
+  int64_t start = monitoring_.Start();
+  internal::TracingSpan span("tink.aead.decrypt");
+  span.AddBytes(ciphertext.size());
 
   if (ciphertext.length() > CryptoFormat::kNonRawPrefixSize) {
     absl::string_view key_id =
@@ -86,9 +467,16 @@ util::StatusOr<std::string> AeadSetWrapper::Decrypt(
       absl::string_view raw_ciphertext =
           ciphertext.substr(CryptoFormat::kNonRawPrefixSize);
       for (auto& aead_entry : *(primitives_result.ValueOrDie())) {
-        Aead& aead = aead_entry->get_primitive();
+        auto aead_result = aead_entry->get_primitive_or_status();
+        if (!aead_result.ok()) continue;
+        Aead& aead = *aead_result.ValueOrDie();
+        span.AddKeyTrial();
         auto decrypt_result = aead.Decrypt(raw_ciphertext, associated_data);
         if (decrypt_result.ok()) {
+          aead_entry->RecordDecryption();
+          monitoring_.RecordSuccess(start, MonitoringOperation::kDecrypt,
+                                    aead_entry->get_key_id(),
+                                    ciphertext.size());
           return std::move(decrypt_result.ValueOrDie());
         } else {
           // LOG that a matching key didn't decrypt the ciphertext.
@@ -98,17 +486,119 @@ util::StatusOr<std::string> AeadSetWrapper::Decrypt(
   }
 
   // No matching key succeeded with decryption, try all RAW keys.
+  monitoring_.RecordRawFallback();
   auto raw_primitives_result = aead_set_->get_raw_primitives();
   if (raw_primitives_result.ok()) {
-    for (auto& aead_entry : *(raw_primitives_result.ValueOrDie())) {
-      Aead& aead = aead_entry->get_primitive();
-      auto decrypt_result = aead.Decrypt(ciphertext, associated_data);
+    util::StatusOr<std::string> decrypt_result(util::DecryptionFailedError());
+    const AeadEntry* aead_entry = raw_key_hint_.Try(
+        *raw_primitives_result.ValueOrDie(),
+        [&](const AeadEntry& entry) -> bool {
+          auto aead_result = entry.get_primitive_or_status();
+          if (!aead_result.ok()) return false;
+          span.AddKeyTrial();
+          decrypt_result =
+              aead_result.ValueOrDie()->Decrypt(ciphertext, associated_data);
+          return decrypt_result.ok();
+        });
+    if (aead_entry != nullptr) {
+      monitoring_.RecordSuccess(start, MonitoringOperation::kDecrypt,
+                                aead_entry->get_key_id(), ciphertext.size());
+      return std::move(decrypt_result.ValueOrDie());
+    }
+  }
+  monitoring_.RecordFailure(start, MonitoringOperation::kDecrypt,
+                            ciphertext.size());
+  span.SetOk(false);
+  return util::DecryptionFailedError();
+}
+
+// Encrypts with the primary bound to the associated data. Ciphertexts of the
+// primary are decrypted the same way, and all others by the wrapper.
+class AeadSetWrapper::Bound : public BoundAead {
+ public:
+  Bound(const AeadSetWrapper* wrapper, absl::string_view associated_data,
+        std::unique_ptr<BoundAead> primary)
+      : wrapper_(wrapper),
+        associated_data_(associated_data.data(), associated_data.size()),
+        primary_(std::move(primary)) {}
+
+  crypto::tink::util::StatusOr<std::string> Encrypt(
+      absl::string_view plaintext) const override {
+    int64_t start = wrapper_->monitoring_.Start();
+    auto encrypt_result = primary_->Encrypt(plaintext);
+    if (!encrypt_result.ok()) {
+      wrapper_->monitoring_.RecordFailure(start, MonitoringOperation::kEncrypt,
+                                          plaintext.size());
+      return encrypt_result.status();
+    }
+    wrapper_->monitoring_.RecordSuccess(start, MonitoringOperation::kEncrypt,
+                                        wrapper_->primary_.key_id,
+                                        plaintext.size());
+    return absl::StrCat(wrapper_->primary_.output_prefix.view(),
+                        encrypt_result.ValueOrDie());
+  }
+
+  crypto::tink::util::StatusOr<std::string> Decrypt(
+      absl::string_view ciphertext) const override {
+    absl::string_view output_prefix = wrapper_->primary_.output_prefix;
+    if (absl::StartsWith(ciphertext, output_prefix)) {
+      int64_t start = wrapper_->monitoring_.Start();
+      auto decrypt_result =
+          primary_->Decrypt(ciphertext.substr(output_prefix.size()));
       if (decrypt_result.ok()) {
-        return std::move(decrypt_result.ValueOrDie());
+        wrapper_->aead_set_->get_primary()->RecordDecryption();
+        wrapper_->monitoring_.RecordSuccess(
+            start, MonitoringOperation::kDecrypt, wrapper_->primary_.key_id,
+            ciphertext.size());
+        return decrypt_result;
       }
     }
+    return wrapper_->Decrypt(ciphertext, associated_data_);
+  }
+
+ private:
+  const AeadSetWrapper* const wrapper_;
+  const std::string associated_data_;
+  const std::unique_ptr<BoundAead> primary_;
+};
+
+util::StatusOr<std::string> AeadSetWrapper::ReEncrypt(
+    absl::string_view ciphertext, absl::string_view associated_data) const {
+  // A ciphertext with the output prefix of the primary was encrypted with
+  // the primary, so it is kept as it is: if it is invalid, it fails to
+  // decrypt just like before.
+  absl::string_view key_id = primary_.output_prefix;
+  if (!key_id.empty() && ciphertext.size() > key_id.size() &&
+      absl::StartsWith(ciphertext, key_id)) {
+    return std::string(ciphertext);
   }
-  return util::Status(util::error::INVALID_ARGUMENT, "decryption failed");
+
+  associated_data = subtle::SubtleUtilBoringSSL::EnsureNonNull(associated_data);
+  // The plaintext is only stored in this buffer, which is wiped when it is
+  // freed. Plaintexts are never longer than their ciphertexts.
+  util::SecretData plaintext(ciphertext.size());
+  auto written_result = DecryptIntoWithPrimitives(
+      monitoring_.Start(), GetPrefixedPrimitives(ciphertext), ciphertext,
+      associated_data,
+      absl::MakeSpan(reinterpret_cast<char*>(plaintext.data()),
+                     plaintext.size()));
+  if (!written_result.ok()) return written_result.status();
+  return Encrypt(absl::string_view(reinterpret_cast<char*>(plaintext.data()),
+                                   written_result.ValueOrDie()),
+                 associated_data);
+}
+
+util::StatusOr<std::unique_ptr<BoundAead>> AeadSetWrapper::BindAssociatedData(
+    absl::string_view associated_data) const {
+  // BoringSSL expects a non-null pointer for additional_data,
+  // regardless of whether the size is 0.
+  associated_data = subtle::SubtleUtilBoringSSL::EnsureNonNull(associated_data);
+  auto primary_result =
+      primary_.primitive->BindAssociatedData(associated_data);
+  if (!primary_result.ok()) return primary_result.status();
+  std::unique_ptr<BoundAead> bound(new Bound(
+      this, associated_data, std::move(primary_result.ValueOrDie())));
+  return std::move(bound);
 }
 
 }  // anonymous namespace
@@ -117,7 +607,10 @@ util::StatusOr<std::unique_ptr<Aead>> AeadWrapper::Wrap(
     std::unique_ptr<PrimitiveSet<Aead>> aead_set) const {
   util::Status status = Validate(aead_set.get());
   if (!status.ok()) return status;
-  std::unique_ptr<Aead> aead(new AeadSetWrapper(std::move(aead_set)));
+  auto primary_result = aead_set->ResolvePrimary();
+  if (!primary_result.ok()) return primary_result.status();
+  std::unique_ptr<Aead> aead(
+      new AeadSetWrapper(std::move(aead_set), primary_result.ValueOrDie()));
   return std::move(aead);
 }
 
@@ -38,6 +38,9 @@ class AeadWrapper : public PrimitiveWrapper<Aead, Aead> {
   // which must be non-NULL and must contain a primary instance.
   util::StatusOr<std::unique_ptr<Aead>> Wrap(
       std::unique_ptr<PrimitiveSet<Aead>> aead_set) const override;
+
+  // Primitives other than the primary are only used to decrypt.
+  bool SupportsLazyPrimitives() const override { return true; }
 };
 
 }  // namespace tink
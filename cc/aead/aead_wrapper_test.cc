@@ -16,9 +16,22 @@
 
 #include "tink/aead/aead_wrapper.h"
 
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
 #include "tink/aead.h"
+#include "tink/crypto_format.h"
+#include "tink/key_usage.h"
+#include "tink/monitoring.h"
 #include "tink/primitive_set.h"
 #include "tink/util/status.h"
 #include "tink/util/test_matchers.h"
@@ -27,6 +40,7 @@
 
 using ::crypto::tink::test::DummyAead;
 using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
 using ::google::crypto::tink::KeysetInfo;
 using ::google::crypto::tink::KeyStatusType;
 using ::google::crypto::tink::OutputPrefixType;
@@ -35,6 +49,62 @@ namespace crypto {
 namespace tink {
 namespace {
 
+// An Aead with a fixed ciphertext overhead, which implements the buffer-based
+// API natively: the ciphertext is the plaintext followed by the name.
+class FixedOverheadAead : public Aead {
+ public:
+  explicit FixedOverheadAead(absl::string_view name) : name_(name) {}
+
+  util::StatusOr<std::string> Encrypt(
+      absl::string_view plaintext,
+      absl::string_view associated_data) const override {
+    return absl::StrCat(plaintext, name_);
+  }
+
+  util::StatusOr<std::string> Decrypt(
+      absl::string_view ciphertext,
+      absl::string_view associated_data) const override {
+    if (!absl::EndsWith(ciphertext, name_)) {
+      return util::Status(util::error::INVALID_ARGUMENT, "wrong name");
+    }
+    return std::string(ciphertext.substr(0, ciphertext.size() - name_.size()));
+  }
+
+  util::StatusOr<int64_t> CiphertextSize(
+      int64_t plaintext_size) const override {
+    return plaintext_size + name_.size();
+  }
+
+  util::StatusOr<int64_t> EncryptInto(absl::string_view plaintext,
+                                      absl::string_view associated_data,
+                                      absl::Span<char> buffer) const override {
+    if (buffer.size() < plaintext.size() + name_.size()) {
+      return util::Status(util::error::INVALID_ARGUMENT, "Buffer too small");
+    }
+    std::copy(plaintext.begin(), plaintext.end(), buffer.begin());
+    std::copy(name_.begin(), name_.end(), buffer.begin() + plaintext.size());
+    return plaintext.size() + name_.size();
+  }
+
+ private:
+  std::string name_;
+};
+
+std::unique_ptr<Aead> WrapSingleAead(std::unique_ptr<Aead> aead,
+                                     OutputPrefixType output_prefix_type) {
+  KeysetInfo::KeyInfo key_info;
+  key_info.set_output_prefix_type(output_prefix_type);
+  key_info.set_key_id(1234543);
+  key_info.set_status(KeyStatusType::ENABLED);
+  auto aead_set = absl::make_unique<PrimitiveSet<Aead>>();
+  auto entry_result = aead_set->AddPrimitive(std::move(aead), key_info);
+  EXPECT_THAT(entry_result.status(), IsOk());
+  EXPECT_THAT(aead_set->set_primary(entry_result.ValueOrDie()), IsOk());
+  auto aead_result = AeadWrapper().Wrap(std::move(aead_set));
+  EXPECT_THAT(aead_result.status(), IsOk());
+  return std::move(aead_result.ValueOrDie());
+}
+
 TEST(AeadSetWrapperTest, WrapNullptr) {
   AeadWrapper wrapper;
   auto aead_result = wrapper.Wrap(nullptr);
@@ -186,6 +256,419 @@ TEST(AeadSetWrapperTest, DecryptNonPrimary) {
   auto decrypt_result = aead->Decrypt(ciphertext, aad);
   EXPECT_TRUE(decrypt_result.ok()) << decrypt_result.status();
 }
+TEST(AeadSetWrapperTest, DecryptWithLazyPrimitives) {
+  KeysetInfo::KeyInfo key_info;
+  key_info.set_output_prefix_type(OutputPrefixType::RAW);
+  key_info.set_status(KeyStatusType::ENABLED);
+  int created = 0;
+  PrimitiveSet<Aead>::Builder builder;
+  key_info.set_key_id(1);
+  builder.AddPrimaryPrimitive(absl::make_unique<DummyAead>("aead1"), key_info);
+  key_info.set_key_id(2);
+  builder.AddLazyPrimitive(
+      [&created]() -> util::StatusOr<std::unique_ptr<Aead>> {
+        created++;
+        return util::Status(util::error::INVALID_ARGUMENT, "invalid key");
+      },
+      key_info);
+  key_info.set_key_id(3);
+  builder.AddLazyPrimitive(
+      [&created]() -> util::StatusOr<std::unique_ptr<Aead>> {
+        created++;
+        return {absl::make_unique<DummyAead>("aead3")};
+      },
+      key_info);
+  auto aead_set_result = builder.Build();
+  ASSERT_THAT(aead_set_result.status(), IsOk());
+
+  AeadWrapper wrapper;
+  EXPECT_TRUE(wrapper.SupportsLazyPrimitives());
+  auto aead_result = wrapper.Wrap(std::move(aead_set_result.ValueOrDie()));
+  ASSERT_THAT(aead_result.status(), IsOk());
+  auto& aead = aead_result.ValueOrDie();
+
+  // Encrypting with the primary creates no lazy primitive.
+  auto ciphertext_result = aead->Encrypt("plaintext", "aad");
+  ASSERT_THAT(ciphertext_result.status(), IsOk());
+  EXPECT_EQ(0, created);
+  EXPECT_THAT(aead->Decrypt(ciphertext_result.ValueOrDie(), "aad").status(),
+              IsOk());
+
+  // Decrypting with the third key skips the second one, which fails.
+  std::string ciphertext =
+      DummyAead("aead3").Encrypt("plaintext", "aad").ValueOrDie();
+  for (int i = 0; i < 2; i++) {
+    auto decrypt_result = aead->Decrypt(ciphertext, "aad");
+    ASSERT_THAT(decrypt_result.status(), IsOk());
+    EXPECT_EQ("plaintext", decrypt_result.ValueOrDie());
+  }
+  EXPECT_EQ(2, created);
+}
+
+TEST(AeadSetWrapperTest, EncryptIntoWithDefaultImplementation) {
+  std::unique_ptr<Aead> aead = WrapSingleAead(
+      absl::make_unique<DummyAead>("aead0"), OutputPrefixType::TINK);
+  std::string plaintext = "some_plaintext";
+  std::string aad = "some_aad";
+
+  // DummyAead cannot predict its ciphertext size.
+  EXPECT_THAT(aead->CiphertextSize(plaintext.size()).status(),
+              StatusIs(util::error::UNIMPLEMENTED));
+
+  std::string ciphertext = aead->Encrypt(plaintext, aad).ValueOrDie();
+  std::string buffer(ciphertext.size() + 10, '\0');
+  auto written = aead->EncryptInto(plaintext, aad, absl::MakeSpan(buffer));
+  ASSERT_THAT(written.status(), IsOk());
+  EXPECT_EQ(ciphertext, buffer.substr(0, written.ValueOrDie()));
+
+  written = aead->DecryptInto(ciphertext, aad, absl::MakeSpan(buffer));
+  ASSERT_THAT(written.status(), IsOk());
+  EXPECT_EQ(plaintext, buffer.substr(0, written.ValueOrDie()));
+
+  EXPECT_THAT(aead->DecryptInto("some bad ciphertext", aad,
+                                absl::MakeSpan(buffer))
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(AeadSetWrapperTest, EncryptIntoWithNativeImplementation) {
+  std::unique_ptr<Aead> aead = WrapSingleAead(
+      absl::make_unique<FixedOverheadAead>("aead0"), OutputPrefixType::TINK);
+  std::string plaintext = "some_plaintext";
+  std::string aad = "some_aad";
+
+  auto size_result = aead->CiphertextSize(plaintext.size());
+  ASSERT_THAT(size_result.status(), IsOk());
+  EXPECT_EQ(CryptoFormat::kNonRawPrefixSize + plaintext.size() + 5,
+            size_result.ValueOrDie());
+
+  std::string buffer(size_result.ValueOrDie() - 1, '\0');
+  EXPECT_THAT(
+      aead->EncryptInto(plaintext, aad, absl::MakeSpan(buffer)).status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+  buffer.resize(size_result.ValueOrDie());
+  auto written = aead->EncryptInto(plaintext, aad, absl::MakeSpan(buffer));
+  ASSERT_THAT(written.status(), IsOk());
+  EXPECT_EQ(buffer.size(), written.ValueOrDie());
+  EXPECT_EQ(buffer, aead->Encrypt(plaintext, aad).ValueOrDie());
+
+  auto decrypt_result = aead->Decrypt(buffer, aad);
+  ASSERT_THAT(decrypt_result.status(), IsOk());
+  EXPECT_EQ(plaintext, decrypt_result.ValueOrDie());
+}
+
+TEST(AeadSetWrapperTest, EncryptFragmentsInto) {
+  std::unique_ptr<Aead> aead = WrapSingleAead(
+      absl::make_unique<FixedOverheadAead>("aead0"), OutputPrefixType::TINK);
+  std::vector<absl::string_view> plaintext = {"some_", "", "plaintext"};
+  std::vector<absl::string_view> aad = {"some", "_aad"};
+  std::string ciphertext =
+      aead->Encrypt("some_plaintext", "some_aad").ValueOrDie();
+
+  // Splits the output inside the output prefix, and inside the ciphertext.
+  for (int split : {0, 2, 5, 7, 19, 24}) {
+    SCOPED_TRACE(absl::StrCat("split: ", split));
+    std::string buffer(ciphertext.size(), '\0');
+    std::vector<absl::Span<char>> buffers = {
+        absl::MakeSpan(&buffer[0], split),
+        absl::MakeSpan(&buffer[0] + split, buffer.size() - split)};
+    auto written = aead->EncryptFragmentsInto(plaintext, aad, buffers);
+    ASSERT_THAT(written.status(), IsOk());
+    EXPECT_EQ(ciphertext.size(), written.ValueOrDie());
+    EXPECT_EQ(ciphertext, buffer);
+  }
+
+  std::string buffer(ciphertext.size() - 1, '\0');
+  std::vector<absl::Span<char>> buffers = {absl::MakeSpan(buffer)};
+  EXPECT_THAT(aead->EncryptFragmentsInto(plaintext, aad, buffers).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  buffers = {absl::MakeSpan(&buffer[0], 2)};
+  EXPECT_THAT(aead->EncryptFragmentsInto(plaintext, aad, buffers).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(AeadSetWrapperTest, EncryptIntoRaw) {
+  std::unique_ptr<Aead> aead = WrapSingleAead(
+      absl::make_unique<FixedOverheadAead>("aead0"), OutputPrefixType::RAW);
+  std::string plaintext = "some_plaintext";
+
+  EXPECT_EQ(plaintext.size() + 5,
+            aead->CiphertextSize(plaintext.size()).ValueOrDie());
+  std::string buffer(plaintext.size() + 5, '\0');
+  auto written = aead->EncryptInto(plaintext, "", absl::MakeSpan(buffer));
+  ASSERT_THAT(written.status(), IsOk());
+  EXPECT_EQ("some_plaintextaead0", buffer);
+
+  std::string decrypted(buffer.size(), '\0');
+  written = aead->DecryptInto(buffer, "", absl::MakeSpan(decrypted));
+  ASSERT_THAT(written.status(), IsOk());
+  EXPECT_EQ(plaintext, decrypted.substr(0, written.ValueOrDie()));
+}
+
+void ExpectBatchRoundTrip(const Aead& aead) {
+  std::vector<std::pair<absl::string_view, absl::string_view>> inputs = {
+      {"first plaintext", "first aad"},
+      {"", "empty plaintext"},
+      {"third plaintext", ""}};
+  std::string ciphertext_arena;
+  std::vector<absl::string_view> ciphertexts;
+  ASSERT_THAT(aead.BatchEncrypt(inputs, &ciphertext_arena, &ciphertexts),
+              IsOk());
+  ASSERT_EQ(inputs.size(), ciphertexts.size());
+
+  std::vector<std::pair<absl::string_view, absl::string_view>> decrypt_inputs;
+  for (size_t i = 0; i < inputs.size(); i++) {
+    // Batch and single ciphertexts are interchangeable.
+    auto decrypt_result = aead.Decrypt(ciphertexts[i], inputs[i].second);
+    ASSERT_THAT(decrypt_result.status(), IsOk());
+    EXPECT_EQ(inputs[i].first, decrypt_result.ValueOrDie());
+    decrypt_inputs.push_back({ciphertexts[i], inputs[i].second});
+  }
+
+  std::string plaintext_arena;
+  std::vector<absl::string_view> plaintexts;
+  ASSERT_THAT(aead.BatchDecrypt(decrypt_inputs, &plaintext_arena, &plaintexts),
+              IsOk());
+  ASSERT_EQ(inputs.size(), plaintexts.size());
+  for (size_t i = 0; i < inputs.size(); i++) {
+    EXPECT_EQ(inputs[i].first, plaintexts[i]);
+  }
+
+  // A single bad ciphertext fails the whole batch.
+  decrypt_inputs[1].first = "some bad ciphertext";
+  EXPECT_THAT(
+      aead.BatchDecrypt(decrypt_inputs, &plaintext_arena, &plaintexts),
+      StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(AeadSetWrapperTest, BatchWithDefaultImplementation) {
+  ExpectBatchRoundTrip(*WrapSingleAead(absl::make_unique<DummyAead>("aead0"),
+                                       OutputPrefixType::TINK));
+}
+
+TEST(AeadSetWrapperTest, BatchWithNativeImplementation) {
+  ExpectBatchRoundTrip(*WrapSingleAead(
+      absl::make_unique<FixedOverheadAead>("aead0"), OutputPrefixType::TINK));
+}
+
+TEST(AeadSetWrapperTest, BatchRaw) {
+  ExpectBatchRoundTrip(*WrapSingleAead(
+      absl::make_unique<FixedOverheadAead>("aead0"), OutputPrefixType::RAW));
+}
+
+TEST(AeadSetWrapperTest, BatchArenaLayout) {
+  std::unique_ptr<Aead> aead = WrapSingleAead(
+      absl::make_unique<FixedOverheadAead>("aead0"), OutputPrefixType::RAW);
+  std::vector<std::pair<absl::string_view, absl::string_view>> inputs = {
+      {"a", ""}, {"bc", ""}};
+  std::string arena;
+  std::vector<absl::string_view> ciphertexts;
+  ASSERT_THAT(aead->BatchEncrypt(inputs, &arena, &ciphertexts), IsOk());
+  EXPECT_EQ("aaead0bcaead0", arena);
+  EXPECT_EQ("aaead0", ciphertexts[0]);
+  EXPECT_EQ("bcaead0", ciphertexts[1]);
+
+  ASSERT_THAT(aead->BatchEncrypt({}, &arena, &ciphertexts), IsOk());
+  EXPECT_TRUE(arena.empty());
+  EXPECT_TRUE(ciphertexts.empty());
+}
+
+// Keeps the counters and samples it receives.
+class RecordingMonitoringClient : public MonitoringClient {
+ public:
+  int sampling_period() const override { return 1; }
+
+  void AddKeysetCounters(
+      std::shared_ptr<const MonitoringKeysetCounters> counters) override {
+    counters_.push_back(std::move(counters));
+  }
+
+  void RecordSample(const MonitoringSample& sample) override {
+    samples_.push_back(sample);
+  }
+
+  const std::vector<std::shared_ptr<const MonitoringKeysetCounters>>&
+  counters() const {
+    return counters_;
+  }
+  const std::vector<MonitoringSample>& samples() const { return samples_; }
+
+ private:
+  std::vector<std::shared_ptr<const MonitoringKeysetCounters>> counters_;
+  std::vector<MonitoringSample> samples_;
+};
+
+TEST(AeadSetWrapperTest, KeyUsage) {
+  KeysetInfo::KeyInfo key_info;
+  key_info.set_status(KeyStatusType::ENABLED);
+  PrimitiveSet<Aead>::Builder builder;
+  key_info.set_output_prefix_type(OutputPrefixType::TINK);
+  key_info.set_key_id(1);
+  builder.AddPrimaryPrimitive(absl::make_unique<DummyAead>("aead1"), key_info);
+  key_info.set_output_prefix_type(OutputPrefixType::RAW);
+  key_info.set_key_id(2);
+  builder.AddPrimitive(absl::make_unique<DummyAead>("aead2"), key_info);
+  key_info.set_key_id(3);
+  builder.AddPrimitive(absl::make_unique<DummyAead>("aead3"), key_info);
+  auto aead_set_result = builder.Build();
+  ASSERT_THAT(aead_set_result.status(), IsOk());
+  auto aead_result =
+      AeadWrapper().Wrap(std::move(aead_set_result.ValueOrDie()));
+  ASSERT_THAT(aead_result.status(), IsOk());
+  const Aead& aead = *aead_result.ValueOrDie();
+
+  auto ciphertext_result = aead.Encrypt("plaintext", "aad");
+  ASSERT_THAT(ciphertext_result.status(), IsOk());
+  EXPECT_THAT(aead.Decrypt(ciphertext_result.ValueOrDie(), "aad").status(),
+              IsOk());
+  std::string ciphertext =
+      DummyAead("aead3").Encrypt("plaintext", "aad").ValueOrDie();
+  EXPECT_THAT(aead.Decrypt(ciphertext, "aad").status(), IsOk());
+  std::string plaintext(ciphertext.size(), '\0');
+  EXPECT_THAT(aead.DecryptInto(ciphertext, "aad", absl::MakeSpan(plaintext))
+                  .status(),
+              IsOk());
+  EXPECT_FALSE(aead.Decrypt("invalid", "aad").ok());
+
+  auto usage_result = GetKeyUsage(aead);
+  ASSERT_THAT(usage_result.status(), IsOk());
+  std::map<uint32_t, int64_t> decryptions;
+  for (const KeyUsage& usage : usage_result.ValueOrDie()) {
+    decryptions[usage.key_id] = usage.decryptions;
+    EXPECT_EQ(usage.key_id == 1, usage.is_primary);
+  }
+  EXPECT_EQ((std::map<uint32_t, int64_t>{{1, 1}, {2, 0}, {3, 2}}),
+            decryptions);
+}
+
+TEST(AeadSetWrapperTest, BindAssociatedData) {
+  KeysetInfo::KeyInfo key_info;
+  key_info.set_status(KeyStatusType::ENABLED);
+  PrimitiveSet<Aead>::Builder builder;
+  key_info.set_output_prefix_type(OutputPrefixType::TINK);
+  key_info.set_key_id(1);
+  builder.AddPrimaryPrimitive(absl::make_unique<DummyAead>("aead1"), key_info);
+  key_info.set_output_prefix_type(OutputPrefixType::RAW);
+  key_info.set_key_id(2);
+  builder.AddPrimitive(absl::make_unique<DummyAead>("aead2"), key_info);
+  auto aead_set_result = builder.Build();
+  ASSERT_THAT(aead_set_result.status(), IsOk());
+  auto aead_result =
+      AeadWrapper().Wrap(std::move(aead_set_result.ValueOrDie()));
+  ASSERT_THAT(aead_result.status(), IsOk());
+  const Aead& aead = *aead_result.ValueOrDie();
+
+  auto bound_result = aead.BindAssociatedData("aad");
+  ASSERT_THAT(bound_result.status(), IsOk());
+  const BoundAead& bound = *bound_result.ValueOrDie();
+  auto ciphertext_result = bound.Encrypt("plaintext");
+  ASSERT_THAT(ciphertext_result.status(), IsOk());
+  EXPECT_EQ(aead.Encrypt("plaintext", "aad").ValueOrDie(),
+            ciphertext_result.ValueOrDie());
+  auto decrypt_result = bound.Decrypt(ciphertext_result.ValueOrDie());
+  ASSERT_THAT(decrypt_result.status(), IsOk());
+  EXPECT_EQ("plaintext", decrypt_result.ValueOrDie());
+
+  // Ciphertexts of other keys are decrypted by the whole keyset.
+  std::string ciphertext =
+      DummyAead("aead2").Encrypt("plaintext", "aad").ValueOrDie();
+  decrypt_result = bound.Decrypt(ciphertext);
+  ASSERT_THAT(decrypt_result.status(), IsOk());
+  EXPECT_EQ("plaintext", decrypt_result.ValueOrDie());
+  ciphertext = DummyAead("aead2").Encrypt("plaintext", "other").ValueOrDie();
+  EXPECT_FALSE(bound.Decrypt(ciphertext).ok());
+  EXPECT_FALSE(bound.Decrypt("invalid").ok());
+}
+
+TEST(AeadSetWrapperTest, ReEncrypt) {
+  KeysetInfo::KeyInfo key_info;
+  key_info.set_status(KeyStatusType::ENABLED);
+  PrimitiveSet<Aead>::Builder builder;
+  key_info.set_output_prefix_type(OutputPrefixType::TINK);
+  key_info.set_key_id(1);
+  builder.AddPrimaryPrimitive(absl::make_unique<DummyAead>("aead1"), key_info);
+  key_info.set_output_prefix_type(OutputPrefixType::RAW);
+  key_info.set_key_id(2);
+  builder.AddPrimitive(absl::make_unique<DummyAead>("aead2"), key_info);
+  key_info.set_output_prefix_type(OutputPrefixType::TINK);
+  key_info.set_key_id(3);
+  builder.AddPrimitive(absl::make_unique<FixedOverheadAead>("aead3"),
+                       key_info);
+  auto aead_set_result = builder.Build();
+  ASSERT_THAT(aead_set_result.status(), IsOk());
+  auto aead_result =
+      AeadWrapper().Wrap(std::move(aead_set_result.ValueOrDie()));
+  ASSERT_THAT(aead_result.status(), IsOk());
+  const Aead& aead = *aead_result.ValueOrDie();
+  std::string expected = aead.Encrypt("plaintext", "aad").ValueOrDie();
+
+  // Ciphertexts of the primary are kept as they are.
+  auto reencrypt_result = aead.ReEncrypt(expected, "aad");
+  ASSERT_THAT(reencrypt_result.status(), IsOk());
+  EXPECT_EQ(expected, reencrypt_result.ValueOrDie());
+
+  // Ciphertexts of other keys are encrypted with the primary.
+  std::string raw_ciphertext =
+      DummyAead("aead2").Encrypt("plaintext", "aad").ValueOrDie();
+  reencrypt_result = aead.ReEncrypt(raw_ciphertext, "aad");
+  ASSERT_THAT(reencrypt_result.status(), IsOk());
+  EXPECT_EQ(expected, reencrypt_result.ValueOrDie());
+  std::string prefixed_ciphertext = absl::StrCat(
+      CryptoFormat::TinkPrefix(3).view(),
+      FixedOverheadAead("aead3").Encrypt("plaintext", "aad").ValueOrDie());
+  reencrypt_result = aead.ReEncrypt(prefixed_ciphertext, "aad");
+  ASSERT_THAT(reencrypt_result.status(), IsOk());
+  EXPECT_EQ(expected, reencrypt_result.ValueOrDie());
+
+  EXPECT_THAT(aead.ReEncrypt(raw_ciphertext, "other").status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_FALSE(aead.ReEncrypt("invalid", "aad").ok());
+}
+
+TEST(AeadSetWrapperTest, ReEncryptWithRawPrimary) {
+  std::unique_ptr<Aead> aead = WrapSingleAead(
+      absl::make_unique<FixedOverheadAead>("aead"), OutputPrefixType::RAW);
+  auto reencrypt_result = aead->ReEncrypt("plaintextaead", "aad");
+  ASSERT_THAT(reencrypt_result.status(), IsOk());
+  EXPECT_EQ("plaintextaead", reencrypt_result.ValueOrDie());
+  EXPECT_FALSE(aead->ReEncrypt("plaintext", "aad").ok());
+}
+
+TEST(AeadSetWrapperTest, Monitoring) {
+  auto client = std::make_shared<RecordingMonitoringClient>();
+  Monitoring::SetClient(client);
+  std::unique_ptr<Aead> aead = WrapSingleAead(
+      absl::make_unique<DummyAead>("aead0"), OutputPrefixType::TINK);
+  Monitoring::SetClient(nullptr);
+  ASSERT_EQ(1, client->counters().size());
+  const MonitoringKeysetCounters& counters = *client->counters()[0];
+  EXPECT_EQ("aead", counters.primitive());
+
+  auto encrypt_result = aead->Encrypt("plaintext", "aad");
+  ASSERT_THAT(encrypt_result.status(), IsOk());
+  std::string ciphertext = encrypt_result.ValueOrDie();
+  ASSERT_THAT(aead->Decrypt(ciphertext, "aad").status(), IsOk());
+  EXPECT_FALSE(aead->Decrypt("invalid", "aad").ok());
+
+  std::vector<MonitoringKeysetCounters::KeyUsage> key_usage =
+      counters.GetKeyUsage();
+  ASSERT_EQ(1, key_usage.size());
+  EXPECT_EQ(1234543, key_usage[0].key_id);
+  EXPECT_EQ(2, key_usage[0].operations);
+  EXPECT_EQ(9 + static_cast<int64_t>(ciphertext.size()), key_usage[0].bytes);
+  EXPECT_EQ(1, counters.failures());
+  EXPECT_EQ(1, counters.raw_fallbacks());
+
+  ASSERT_EQ(3, client->samples().size());
+  EXPECT_EQ(MonitoringOperation::kEncrypt, client->samples()[0].operation);
+  EXPECT_EQ(1234543, client->samples()[0].key_id);
+  EXPECT_TRUE(client->samples()[0].ok);
+  EXPECT_EQ(MonitoringOperation::kDecrypt, client->samples()[1].operation);
+  EXPECT_TRUE(client->samples()[1].ok);
+  EXPECT_EQ(MonitoringOperation::kDecrypt, client->samples()[2].operation);
+  EXPECT_FALSE(client->samples()[2].ok);
+}
+
 }  // namespace
 }  // namespace tink
 }  // namespace crypto
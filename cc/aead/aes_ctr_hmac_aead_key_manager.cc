@@ -25,9 +25,7 @@
 #include "tink/mac.h"
 #include "tink/mac/hmac_key_manager.h"
 #include "tink/registry.h"
-#include "tink/subtle/aes_ctr_boringssl.h"
-#include "tink/subtle/encrypt_then_authenticate.h"
-#include "tink/subtle/hmac_boringssl.h"
+#include "tink/subtle/aes_ctr_hmac_boringssl.h"
 #include "tink/subtle/random.h"
 #include "tink/util/enums.h"
 #include "tink/util/errors.h"
@@ -81,21 +79,14 @@ StatusOr<AesCtrHmacAeadKey> AesCtrHmacAeadKeyManager::CreateKey(
 
 StatusOr<std::unique_ptr<Aead>> AesCtrHmacAeadKeyManager::AeadFactory::Create(
     const AesCtrHmacAeadKey& key) const {
-  auto aes_ctr_result = subtle::AesCtrBoringSsl::New(
+  // Encrypts and MACs in a single pass; the output is the same as that of
+  // EncryptThenAuthenticate over AesCtrBoringSsl and HmacBoringSsl.
+  return subtle::AesCtrHmacBoringSsl::New(
       util::SecretDataFromStringView(key.aes_ctr_key().key_value()),
-      key.aes_ctr_key().params().iv_size());
-  if (!aes_ctr_result.ok()) return aes_ctr_result.status();
-
-  auto hmac_result = HmacKeyManager().GetPrimitive<Mac>(key.hmac_key());
-  if (!hmac_result.ok()) return hmac_result.status();
-
-  auto cipher_res = subtle::EncryptThenAuthenticate::New(
-      std::move(aes_ctr_result.ValueOrDie()),
-      std::move(hmac_result.ValueOrDie()), key.hmac_key().params().tag_size());
-  if (!cipher_res.ok()) {
-    return cipher_res.status();
-  }
-  return std::move(cipher_res.ValueOrDie());
+      key.aes_ctr_key().params().iv_size(),
+      util::Enums::ProtoToSubtle(key.hmac_key().params().hash()),
+      util::SecretDataFromStringView(key.hmac_key().key_value()),
+      key.hmac_key().params().tag_size());
 }
 
 Status AesCtrHmacAeadKeyManager::ValidateKey(
@@ -15,11 +15,14 @@
 #define TINK_AEAD_AES_EAX_KEY_MANAGER_H_
 
 #include <string>
+#include <vector>
 
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
 #include "tink/aead.h"
 #include "tink/core/key_type_manager.h"
+#include "tink/subtle/aead_backend_selection.h"
+#include "tink/subtle/aes_eax_aesni.h"
 #include "tink/subtle/aes_eax_boringssl.h"
 #include "tink/subtle/random.h"
 #include "tink/util/constants.h"
@@ -34,19 +37,52 @@
 namespace crypto {
 namespace tink {
 
+// The primitives use the AES-EAX backend which CalibrateBackends() found to
+// be the fastest for each message size class, see
+// subtle/aead_backend_selection.h. Without calibration, they use BoringSSL.
 class AesEaxKeyManager
     : public KeyTypeManager<google::crypto::tink::AesEaxKey,
                             google::crypto::tink::AesEaxKeyFormat, List<Aead>> {
  public:
+  // The algorithm name under which the backend choice is recorded.
+  static const char* backend_algorithm() { return "AES-EAX"; }
+
   class AeadFactory : public PrimitiveFactory<Aead> {
     crypto::tink::util::StatusOr<std::unique_ptr<Aead>> Create(
         const google::crypto::tink::AesEaxKey& key) const override {
-      return subtle::AesEaxBoringSsl::New(
-          util::SecretDataFromStringView(key.key_value()),
-          key.params().iv_size());
+      return subtle::NewAeadWithBackends(
+          backend_algorithm(), Backends(key.params().iv_size()),
+          util::SecretDataFromStringView(key.key_value()));
     }
   };
 
+  // Returns the AES-EAX implementations for nonces of 'iv_size' bytes:
+  // BoringSSL, and AES-NI if Tink is compiled with SSE4.1 and AES-NI.
+  static std::vector<subtle::AeadBackend> Backends(size_t iv_size) {
+    std::vector<subtle::AeadBackend> backends;
+    backends.push_back({"boringssl", [iv_size](const util::SecretData& key) {
+                          return subtle::AesEaxBoringSsl::New(key, iv_size);
+                        }});
+#if defined(__SSE4_1__) && defined(__AES__)
+    backends.push_back({"aesni", [iv_size](const util::SecretData& key) {
+                          return subtle::AesEaxAesni::New(key, iv_size);
+                        }});
+#endif
+    return backends;
+  }
+
+  // Measures the AES-EAX backends on this machine, and records the fastest
+  // one per message size class for the primitives created afterwards.
+  static crypto::tink::util::Status CalibrateBackends(
+      const subtle::AeadCalibrationOptions& options) {
+    auto choice_result = subtle::CalibrateAeadBackends(
+        Backends(/*iv_size=*/16), /*key_size=*/16, options);
+    if (!choice_result.ok()) return choice_result.status();
+    subtle::SetAeadBackendChoice(backend_algorithm(),
+                                 choice_result.ValueOrDie());
+    return crypto::tink::util::OkStatus();
+  }
+
   AesEaxKeyManager() : KeyTypeManager(absl::make_unique<AeadFactory>()) {}
 
   uint32_t get_version() const override { return 0; }
@@ -14,9 +14,13 @@
 
 #include "tink/aead/aes_eax_key_manager.h"
 
+#include <string>
+
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "absl/time/time.h"
 #include "tink/aead.h"
+#include "tink/subtle/aead_backend_selection.h"
 #include "tink/subtle/aead_test_util.h"
 #include "tink/util/secret_data.h"
 #include "tink/util/status.h"
@@ -190,6 +194,39 @@ TEST(AesGcmKeyManagerTest, CreateAead) {
               IsOk());
 }
 
+TEST(AesEaxKeyManagerTest, CalibratedBackendsInteroperate) {
+  subtle::AeadCalibrationOptions options;
+  options.time_per_measurement = absl::Microseconds(100);
+  ASSERT_THAT(AesEaxKeyManager::CalibrateBackends(options), IsOk());
+  auto choices = subtle::GetAeadBackendChoices();
+  ASSERT_THAT(choices.count(AesEaxKeyManager::backend_algorithm()), Eq(1));
+
+  AesEaxKeyFormat format;
+  format.set_key_size(16);
+  format.mutable_params()->set_iv_size(12);
+  StatusOr<AesEaxKey> key_or = AesEaxKeyManager().CreateKey(format);
+  ASSERT_THAT(key_or.status(), IsOk());
+  StatusOr<std::unique_ptr<Aead>> aead_or =
+      AesEaxKeyManager().GetPrimitive<Aead>(key_or.ValueOrDie());
+  ASSERT_THAT(aead_or.status(), IsOk());
+  StatusOr<std::unique_ptr<Aead>> boring_ssl_aead_or =
+      subtle::AesEaxBoringSsl::New(
+          util::SecretDataFromStringView(key_or.ValueOrDie().key_value()),
+          key_or.ValueOrDie().params().iv_size());
+  ASSERT_THAT(boring_ssl_aead_or.status(), IsOk());
+  for (int size : {10, 1000, 10000, 100000}) {
+    std::string message(size, 'm');
+    EXPECT_THAT(EncryptThenDecrypt(*aead_or.ValueOrDie(),
+                                   *boring_ssl_aead_or.ValueOrDie(), message,
+                                   "aad"),
+                IsOk());
+    EXPECT_THAT(EncryptThenDecrypt(*boring_ssl_aead_or.ValueOrDie(),
+                                   *aead_or.ValueOrDie(), message, "aad"),
+                IsOk());
+  }
+  subtle::ClearAeadBackendChoices();
+}
+
 }  // namespace
 }  // namespace tink
 }  // namespace crypto
@@ -27,6 +27,7 @@
 #include "tink/core/key_type_manager.h"
 #include "tink/key_manager.h"
 #include "tink/subtle/aes_gcm_boringssl.h"
+#include "tink/subtle/crypto_provider.h"
 #include "tink/subtle/random.h"
 #include "tink/util/constants.h"
 #include "tink/util/errors.h"
@@ -50,17 +51,47 @@ class AesGcmKeyManager
   class AeadFactory : public PrimitiveFactory<Aead> {
     crypto::tink::util::StatusOr<std::unique_ptr<Aead>> Create(
         const google::crypto::tink::AesGcmKey& key) const override {
-      auto aes_gcm_result = subtle::AesGcmBoringSsl::New(
-          util::SecretDataFromStringView(key.key_value()));
+      return New(util::SecretDataFromStringView(key.key_value()));
+    }
+
+    crypto::tink::util::StatusOr<std::unique_ptr<Aead>> CreateFromSerialized(
+        absl::string_view serialized_key) const override {
+      util::SecretData key_value;
+      auto status = ParseKey(serialized_key, &key_value);
+      if (!status.ok()) return status;
+      if (key_value.empty()) return std::unique_ptr<Aead>();
+      return New(std::move(key_value));
+    }
+
+   private:
+    static crypto::tink::util::StatusOr<std::unique_ptr<Aead>> New(
+        util::SecretData key_value) {
+      auto aes_gcm_result = subtle::AesGcmBoringSsl::New(key_value);
       if (!aes_gcm_result.ok()) return aes_gcm_result.status();
-      return {std::move(aes_gcm_result.ValueOrDie())};
+      return {subtle::WithProviderAesGcm(
+          key_value, std::move(aes_gcm_result.ValueOrDie()))};
     }
   };
   class CordAeadFactory : public PrimitiveFactory<CordAead> {
     crypto::tink::util::StatusOr<std::unique_ptr<CordAead>> Create(
         const google::crypto::tink::AesGcmKey& key) const override {
-      auto cord_aes_gcm_result = crypto::tink::CordAesGcmBoringSsl::New(
-          util::SecretDataFromStringView(key.key_value()));
+      return New(util::SecretDataFromStringView(key.key_value()));
+    }
+
+    crypto::tink::util::StatusOr<std::unique_ptr<CordAead>>
+    CreateFromSerialized(absl::string_view serialized_key) const override {
+      util::SecretData key_value;
+      auto status = ParseKey(serialized_key, &key_value);
+      if (!status.ok()) return status;
+      if (key_value.empty()) return std::unique_ptr<CordAead>();
+      return New(std::move(key_value));
+    }
+
+   private:
+    static crypto::tink::util::StatusOr<std::unique_ptr<CordAead>> New(
+        util::SecretData key_value) {
+      auto cord_aes_gcm_result =
+          crypto::tink::CordAesGcmBoringSsl::New(std::move(key_value));
       if (!cord_aes_gcm_result.ok()) return cord_aes_gcm_result.status();
       return {std::move(cord_aes_gcm_result.ValueOrDie())};
     }
@@ -83,10 +114,7 @@ class AesGcmKeyManager
 
   crypto::tink::util::Status ValidateKey(
       const google::crypto::tink::AesGcmKey& key) const override {
-    crypto::tink::util::Status status =
-        ValidateVersion(key.version(), get_version());
-    if (!status.ok()) return status;
-    return ValidateAesKeySize(key.key_value().size());
+    return ValidateKeyFields(key.version(), key.key_value().size());
   }
 
   crypto::tink::util::Status ValidateKeyFormat(
@@ -127,6 +155,29 @@ class AesGcmKeyManager
   }
 
  private:
+  static crypto::tink::util::Status ValidateKeyFields(uint32_t version,
+                                                      size_t key_size) {
+    crypto::tink::util::Status status =
+        ValidateVersion(version, /*max_expected=*/0);
+    if (!status.ok()) return status;
+    return ValidateAesKeySize(key_size);
+  }
+
+  // Sets '*key_value' to the key_value of the AesGcmKey 'serialized_key',
+  // if it is valid. Leaves '*key_value' empty if 'serialized_key' cannot be
+  // parsed by a KeyFieldsParser.
+  static crypto::tink::util::Status ParseKey(absl::string_view serialized_key,
+                                             util::SecretData* key_value) {
+    internal::KeyFieldsParser parser;
+    if (!parser.Parse(serialized_key)) return util::OkStatus();
+    absl::string_view key_bytes = parser.bytes(3);
+    crypto::tink::util::Status status = ValidateKeyFields(
+        static_cast<uint32_t>(parser.varint(1)), key_bytes.size());
+    if (!status.ok()) return status;
+    *key_value = util::SecretDataFromStringView(key_bytes);
+    return util::OkStatus();
+  }
+
   const std::string key_type_ = absl::StrCat(
       kTypeGoogleapisCom, google::crypto::tink::AesGcmKey().GetTypeName());
 };
@@ -41,6 +41,7 @@ using ::google::crypto::tink::AesGcmKey;
 using ::google::crypto::tink::AesGcmKeyFormat;
 using ::testing::Eq;
 using ::testing::HasSubstr;
+using ::testing::Not;
 
 TEST(AesGcmKeyManagerTest, Basics) {
   EXPECT_THAT(AesGcmKeyManager().get_version(), Eq(0));
@@ -207,6 +208,49 @@ TEST(AesGcmKeyManagerTest, CreateCordAead) {
               IsOk());
 }
 
+TEST(AesGcmKeyManagerTest, CreateAeadFromSerialized) {
+  AesGcmKeyFormat format;
+  format.set_key_size(16);
+  StatusOr<AesGcmKey> key_or = AesGcmKeyManager().CreateKey(format);
+  ASSERT_THAT(key_or.status(), IsOk());
+
+  StatusOr<std::unique_ptr<Aead>> serialized_aead_or =
+      AesGcmKeyManager().GetPrimitiveFromSerialized<Aead>(
+          key_or.ValueOrDie().SerializeAsString());
+  ASSERT_THAT(serialized_aead_or.status(), IsOk());
+  ASSERT_THAT(serialized_aead_or.ValueOrDie(), Not(Eq(nullptr)));
+
+  StatusOr<std::unique_ptr<Aead>> aead_or =
+      AesGcmKeyManager().GetPrimitive<Aead>(key_or.ValueOrDie());
+  ASSERT_THAT(aead_or.status(), IsOk());
+
+  ASSERT_THAT(EncryptThenDecrypt(*serialized_aead_or.ValueOrDie(),
+                                 *aead_or.ValueOrDie(), "message", "aad"),
+              IsOk());
+}
+
+TEST(AesGcmKeyManagerTest, CreateAeadFromSerializedValidatesKey) {
+  AesGcmKey key;
+  key.set_key_value(std::string(24, 'a'));
+  EXPECT_THAT(AesGcmKeyManager()
+                  .GetPrimitiveFromSerialized<Aead>(key.SerializeAsString())
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  key.set_key_value(std::string(16, 'a'));
+  key.set_version(1);
+  EXPECT_THAT(AesGcmKeyManager()
+                  .GetPrimitiveFromSerialized<CordAead>(key.SerializeAsString())
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(AesGcmKeyManagerTest, CreateAeadFromSerializedFallsBack) {
+  StatusOr<std::unique_ptr<Aead>> aead_or =
+      AesGcmKeyManager().GetPrimitiveFromSerialized<Aead>("\x1a\x10");
+  ASSERT_THAT(aead_or.status(), IsOk());
+  EXPECT_THAT(aead_or.ValueOrDie(), Eq(nullptr));
+}
+
 TEST(AesGcmKeyManagerTest, DeriveShortKey) {
   AesGcmKeyFormat format;
   format.set_key_size(16);
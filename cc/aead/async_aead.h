@@ -0,0 +1,65 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_AEAD_ASYNC_AEAD_H_
+#define TINK_AEAD_ASYNC_AEAD_H_
+
+#include <functional>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+
+///////////////////////////////////////////////////////////////////////////////
+// The interface for authenticated encryption with associated data, for
+// implementations which do not block the calling thread, e.g. because they
+// send requests to a remote key management system.
+// Apart from passing their results to a callback, the methods behave as those
+// of Aead.
+//
+// Implementations are expected to be thread safe.
+class AsyncAead {
+ public:
+  // Receives the result of an operation.
+  using Callback =
+      std::function<void(crypto::tink::util::StatusOr<std::string> result)>;
+
+  // Encrypts 'plaintext' with 'associated_data' as associated data, and
+  // calls 'done' with the resulting ciphertext, or with an error.
+  // The inputs need to be valid only until Encrypt() returns. 'done' is called
+  // exactly once, possibly before Encrypt() returns and in any thread.
+  virtual void Encrypt(absl::string_view plaintext,
+                       absl::string_view associated_data,
+                       Callback done) const = 0;
+
+  // Decrypts 'ciphertext' with 'associated_data' as associated data, and
+  // calls 'done' with the resulting plaintext, or with an error.
+  // The inputs need to be valid only until Decrypt() returns. 'done' is called
+  // exactly once, possibly before Decrypt() returns and in any thread.
+  virtual void Decrypt(absl::string_view ciphertext,
+                       absl::string_view associated_data,
+                       Callback done) const = 0;
+
+  virtual ~AsyncAead() {}
+};
+
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_AEAD_ASYNC_AEAD_H_
@@ -0,0 +1,96 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/aead/async_aead_wrapper.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "tink/aead.h"
+#include "tink/aead/aead_wrapper.h"
+#include "tink/aead/async_aead.h"
+#include "tink/primitive_set.h"
+#include "tink/util/executor.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+
+namespace {
+
+class AsyncAeadSetWrapper : public AsyncAead {
+ public:
+  // 'aead' is shared with the scheduled operations, so that they can complete
+  // after this primitive is destroyed.
+  AsyncAeadSetWrapper(std::shared_ptr<const Aead> aead,
+                      util::Executor* executor)
+      : aead_(std::move(aead)), executor_(executor) {}
+
+  void Encrypt(absl::string_view plaintext, absl::string_view associated_data,
+               Callback done) const override {
+    if (executor_ == nullptr) {
+      done(aead_->Encrypt(plaintext, associated_data));
+      return;
+    }
+    std::shared_ptr<const Aead> aead = aead_;
+    std::string plaintext_copy(plaintext);
+    std::string associated_data_copy(associated_data);
+    executor_->Schedule([aead, plaintext_copy, associated_data_copy, done]() {
+      done(aead->Encrypt(plaintext_copy, associated_data_copy));
+    });
+  }
+
+  void Decrypt(absl::string_view ciphertext, absl::string_view associated_data,
+               Callback done) const override {
+    if (executor_ == nullptr) {
+      done(aead_->Decrypt(ciphertext, associated_data));
+      return;
+    }
+    std::shared_ptr<const Aead> aead = aead_;
+    std::string ciphertext_copy(ciphertext);
+    std::string associated_data_copy(associated_data);
+    executor_->Schedule([aead, ciphertext_copy, associated_data_copy, done]() {
+      done(aead->Decrypt(ciphertext_copy, associated_data_copy));
+    });
+  }
+
+  ~AsyncAeadSetWrapper() override {}
+
+ private:
+  const std::shared_ptr<const Aead> aead_;
+  util::Executor* const executor_;
+};
+
+}  // namespace
+
+util::StatusOr<std::unique_ptr<AsyncAead>> AsyncAeadWrapper::Wrap(
+    std::unique_ptr<PrimitiveSet<Aead>> aead_set) const {
+  // The key selection and the output prefixes are those of AeadWrapper, which
+  // also validates 'aead_set'.
+  auto aead_result = AeadWrapper().Wrap(std::move(aead_set));
+  if (!aead_result.ok()) return aead_result.status();
+  std::unique_ptr<AsyncAead> async_aead =
+      absl::make_unique<AsyncAeadSetWrapper>(
+          std::shared_ptr<const Aead>(std::move(aead_result.ValueOrDie())),
+          executor_);
+  return std::move(async_aead);
+}
+
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,64 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_AEAD_ASYNC_AEAD_WRAPPER_H_
+#define TINK_AEAD_ASYNC_AEAD_WRAPPER_H_
+
+#include <memory>
+
+#include "tink/aead.h"
+#include "tink/aead/async_aead.h"
+#include "tink/primitive_set.h"
+#include "tink/primitive_wrapper.h"
+#include "tink/util/executor.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+
+// Wraps a set of Aead-instances that correspond to a keyset into a single
+// AsyncAead-primitive, which selects the instances as AeadWrapper does:
+//   * AsyncAead::Encrypt(...) uses the primary instance from the set
+//   * AsyncAead::Decrypt(...) uses the instance that matches the ciphertext
+//     prefix.
+// This allows to use all Aead key types through the AsyncAead interface,
+// e.g. after registering the wrapper with
+//   Registry::RegisterPrimitiveWrapper(
+//       absl::make_unique<AsyncAeadWrapper>(executor));
+// by calling keyset_handle->GetPrimitive<AsyncAead>().
+class AsyncAeadWrapper : public PrimitiveWrapper<Aead, AsyncAead> {
+ public:
+  // The operations of the wrapped primitives run on 'executor', which must
+  // outlive them. If 'executor' is null, they run in the calling thread.
+  explicit AsyncAeadWrapper(util::Executor* executor = nullptr)
+      : executor_(executor) {}
+
+  // Returns an AsyncAead-primitive that uses Aead-instances provided in
+  // 'aead_set', which must be non-NULL and must contain a primary instance.
+  util::StatusOr<std::unique_ptr<AsyncAead>> Wrap(
+      std::unique_ptr<PrimitiveSet<Aead>> aead_set) const override;
+
+  // Primitives other than the primary are only used to decrypt.
+  bool SupportsLazyPrimitives() const override { return true; }
+
+ private:
+  util::Executor* executor_;
+};
+
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_AEAD_ASYNC_AEAD_WRAPPER_H_
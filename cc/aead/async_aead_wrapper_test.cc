@@ -0,0 +1,175 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/aead/async_aead_wrapper.h"
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "tink/aead.h"
+#include "tink/aead/aead_wrapper.h"
+#include "tink/aead/async_aead.h"
+#include "tink/primitive_set.h"
+#include "tink/util/executor.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "tink/util/test_matchers.h"
+#include "tink/util/test_util.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace {
+
+using ::crypto::tink::test::DummyAead;
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::google::crypto::tink::KeysetInfo;
+using ::google::crypto::tink::KeyStatusType;
+using ::google::crypto::tink::OutputPrefixType;
+using ::testing::Eq;
+using ::testing::IsEmpty;
+using ::testing::SizeIs;
+
+// Runs the scheduled tasks only when RunAll() is called.
+class QueueExecutor : public util::Executor {
+ public:
+  void Schedule(std::function<void()> task) override {
+    tasks_.push_back(std::move(task));
+  }
+
+  void RunAll() {
+    while (!tasks_.empty()) {
+      std::function<void()> task = std::move(tasks_.front());
+      tasks_.pop_front();
+      task();
+    }
+  }
+
+  const std::deque<std::function<void()>>& tasks() const { return tasks_; }
+
+ private:
+  std::deque<std::function<void()>> tasks_;
+};
+
+// Returns a set with a TINK primary and a RAW key.
+std::unique_ptr<PrimitiveSet<Aead>> TwoKeySet() {
+  auto aead_set = absl::make_unique<PrimitiveSet<Aead>>();
+  KeysetInfo::KeyInfo key_info;
+  key_info.set_output_prefix_type(OutputPrefixType::TINK);
+  key_info.set_key_id(1234543);
+  key_info.set_status(KeyStatusType::ENABLED);
+  auto entry_result =
+      aead_set->AddPrimitive(absl::make_unique<DummyAead>("primary"), key_info);
+  EXPECT_THAT(entry_result.status(), IsOk());
+  EXPECT_THAT(aead_set->set_primary(entry_result.ValueOrDie()), IsOk());
+  key_info.set_output_prefix_type(OutputPrefixType::RAW);
+  key_info.set_key_id(726329);
+  EXPECT_THAT(
+      aead_set->AddPrimitive(absl::make_unique<DummyAead>("raw"), key_info)
+          .status(),
+      IsOk());
+  return aead_set;
+}
+
+// Returns a callback which stores its result in 'result'.
+AsyncAead::Callback StoreIn(util::StatusOr<std::string>* result) {
+  return [result](util::StatusOr<std::string> value) {
+    *result = std::move(value);
+  };
+}
+
+TEST(AsyncAeadWrapperTest, WrapNullptr) {
+  EXPECT_THAT(AsyncAeadWrapper().Wrap(nullptr).status(),
+              StatusIs(util::error::INTERNAL));
+}
+
+TEST(AsyncAeadWrapperTest, WrapEmpty) {
+  EXPECT_THAT(AsyncAeadWrapper()
+                  .Wrap(absl::make_unique<PrimitiveSet<Aead>>())
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(AsyncAeadWrapperTest, InlineMatchesAeadWrapper) {
+  auto async_aead_result = AsyncAeadWrapper().Wrap(TwoKeySet());
+  ASSERT_THAT(async_aead_result.status(), IsOk());
+  const AsyncAead& async_aead = *async_aead_result.ValueOrDie();
+  auto aead_result = AeadWrapper().Wrap(TwoKeySet());
+  ASSERT_THAT(aead_result.status(), IsOk());
+  const Aead& aead = *aead_result.ValueOrDie();
+
+  util::StatusOr<std::string> ciphertext;
+  async_aead.Encrypt("plaintext", "aad", StoreIn(&ciphertext));
+  ASSERT_THAT(ciphertext.status(), IsOk());
+  EXPECT_THAT(ciphertext.ValueOrDie(),
+              Eq(aead.Encrypt("plaintext", "aad").ValueOrDie()));
+
+  util::StatusOr<std::string> plaintext;
+  async_aead.Decrypt(ciphertext.ValueOrDie(), "aad", StoreIn(&plaintext));
+  ASSERT_THAT(plaintext.status(), IsOk());
+  EXPECT_THAT(plaintext.ValueOrDie(), Eq("plaintext"));
+
+  // Ciphertexts of the RAW key are decrypted, as with AeadWrapper.
+  util::StatusOr<std::string> raw_plaintext;
+  async_aead.Decrypt(DummyAead("raw").Encrypt("old", "aad").ValueOrDie(),
+                     "aad", StoreIn(&raw_plaintext));
+  ASSERT_THAT(raw_plaintext.status(), IsOk());
+  EXPECT_THAT(raw_plaintext.ValueOrDie(), Eq("old"));
+
+  util::StatusOr<std::string> failure;
+  async_aead.Decrypt(ciphertext.ValueOrDie(), "other aad", StoreIn(&failure));
+  EXPECT_THAT(failure.status(), StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(AsyncAeadWrapperTest, RunsOnExecutor) {
+  QueueExecutor executor;
+  auto async_aead_result = AsyncAeadWrapper(&executor).Wrap(TwoKeySet());
+  ASSERT_THAT(async_aead_result.status(), IsOk());
+  std::unique_ptr<AsyncAead> async_aead =
+      std::move(async_aead_result.ValueOrDie());
+
+  util::StatusOr<std::string> ciphertext;
+  {
+    // The inputs need not outlive the call.
+    std::string plaintext = "plaintext";
+    std::string associated_data = "aad";
+    async_aead->Encrypt(plaintext, associated_data, StoreIn(&ciphertext));
+  }
+  EXPECT_THAT(executor.tasks(), SizeIs(1));
+  EXPECT_THAT(ciphertext.status(), StatusIs(util::error::UNKNOWN));
+  executor.RunAll();
+  ASSERT_THAT(ciphertext.status(), IsOk());
+
+  util::StatusOr<std::string> plaintext;
+  async_aead->Decrypt(ciphertext.ValueOrDie(), "aad", StoreIn(&plaintext));
+  // Scheduled operations complete after the primitive is destroyed.
+  async_aead.reset();
+  executor.RunAll();
+  ASSERT_THAT(plaintext.status(), IsOk());
+  EXPECT_THAT(plaintext.ValueOrDie(), Eq("plaintext"));
+  EXPECT_THAT(executor.tasks(), IsEmpty());
+}
+
+}  // namespace
+}  // namespace tink
+}  // namespace crypto
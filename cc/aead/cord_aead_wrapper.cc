@@ -60,7 +60,7 @@ util::StatusOr<absl::Cord> CordAeadSetWrapper::Encrypt(
       plaintext, associated_data);
   if (!encrypt_result.ok()) return encrypt_result.status();
   absl::Cord result;
-  result.Append(aead_set_->get_primary()->get_identifier());
+  result.Append(aead_set_->get_primary()->identifier_view());
   result.Append(encrypt_result.ValueOrDie());
   return result;
 }
@@ -97,7 +97,7 @@ util::StatusOr<absl::Cord> CordAeadSetWrapper::Decrypt(
       }
     }
   }
-  return util::Status(util::error::INVALID_ARGUMENT, "decryption failed");
+  return util::DecryptionFailedError();
 }
 }  // anonymous namespace
 
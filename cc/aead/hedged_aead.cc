@@ -0,0 +1,233 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/aead/hedged_aead.h"
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "tink/aead.h"
+#include "tink/util/executor.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+
+namespace {
+
+// The number of recent latencies the hedge delay is computed from.
+constexpr int kLatencySamples = 64;
+// The number of latencies needed before they are used.
+constexpr int kMinLatencySamples = 8;
+
+}  // namespace
+
+// A remote Aead with its latencies and circuit breaker.
+class HedgedAead::Backend {
+ public:
+  Backend(std::unique_ptr<Aead> aead, const Options& options)
+      : aead_(std::move(aead)), options_(options) {}
+
+  const Aead& aead() const { return *aead_; }
+
+  // Returns whether a call may be sent, and if the breaker is open, makes
+  // the call the trial.
+  bool Allow() {
+    absl::MutexLock lock(&mutex_);
+    if (consecutive_failures_ < options_.failure_threshold) return true;
+    if (trial_in_flight_ || absl::Now() < open_until_) return false;
+    trial_in_flight_ = true;
+    return true;
+  }
+
+  absl::Duration HedgeDelay() {
+    absl::MutexLock lock(&mutex_);
+    if (latencies_.size() < kMinLatencySamples) {
+      return options_.max_hedge_delay;
+    }
+    std::vector<absl::Duration> sorted = latencies_;
+    size_t rank = std::min<size_t>(
+        sorted.size() - 1,
+        static_cast<size_t>(std::ceil(options_.hedge_quantile *
+                                      sorted.size())) - 1);
+    std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+    return std::min(options_.max_hedge_delay,
+                    std::max(options_.min_hedge_delay, sorted[rank]));
+  }
+
+  // Records a call which took 'latency', returned an OK status iff 'ok', and
+  // answered the operation iff 'won'.
+  void Record(bool ok, bool won, absl::Duration latency) {
+    absl::MutexLock lock(&mutex_);
+    if (ok) {
+      if (latencies_.size() < kLatencySamples) {
+        latencies_.push_back(latency);
+      } else {
+        latencies_[next_latency_] = latency;
+        next_latency_ = (next_latency_ + 1) % kLatencySamples;
+      }
+    }
+    if (won) {
+      consecutive_failures_ = 0;
+    } else if (++consecutive_failures_ >= options_.failure_threshold) {
+      open_until_ = absl::Now() + options_.open_duration;
+    }
+    trial_in_flight_ = false;
+  }
+
+ private:
+  const std::unique_ptr<Aead> aead_;
+  const Options options_;
+
+  absl::Mutex mutex_;
+  std::vector<absl::Duration> latencies_ ABSL_GUARDED_BY(mutex_);
+  size_t next_latency_ ABSL_GUARDED_BY(mutex_) = 0;
+  int consecutive_failures_ ABSL_GUARDED_BY(mutex_) = 0;
+  absl::Time open_until_ ABSL_GUARDED_BY(mutex_);
+  bool trial_in_flight_ ABSL_GUARDED_BY(mutex_) = false;
+};
+
+// The state of one operation, shared with the calls it started.
+struct HedgedAead::Call {
+  Call(absl::string_view input, absl::string_view associated_data)
+      : input(input), associated_data(associated_data) {}
+
+  // Whether a call succeeded, or all calls started so far have failed.
+  bool Decided() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex) {
+    return winner >= 0 || finished == started;
+  }
+
+  const std::string input;
+  const std::string associated_data;
+
+  absl::Mutex mutex;
+  int started ABSL_GUARDED_BY(mutex) = 0;
+  int finished ABSL_GUARDED_BY(mutex) = 0;
+  // The index of the backend which answered first, if any.
+  int winner ABSL_GUARDED_BY(mutex) = -1;
+  bool done[2] ABSL_GUARDED_BY(mutex) = {false, false};
+  util::StatusOr<std::string> results[2] ABSL_GUARDED_BY(mutex);
+};
+
+// static
+util::StatusOr<std::unique_ptr<HedgedAead>> HedgedAead::New(
+    std::unique_ptr<Aead> primary_aead, std::unique_ptr<Aead> secondary_aead,
+    const Options& options) {
+  if (primary_aead == nullptr || secondary_aead == nullptr) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "remote aeads must be non-null");
+  }
+  if (options.executor == nullptr) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "executor must be non-null");
+  }
+  if (!(options.hedge_quantile > 0 && options.hedge_quantile <= 1)) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "hedge_quantile must be in (0, 1]");
+  }
+  if (options.min_hedge_delay < absl::ZeroDuration() ||
+      options.max_hedge_delay < options.min_hedge_delay) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "invalid hedge delay bounds");
+  }
+  if (options.failure_threshold <= 0) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "failure_threshold must be positive");
+  }
+  return absl::WrapUnique(new HedgedAead(
+      std::make_shared<Backend>(std::move(primary_aead), options),
+      std::make_shared<Backend>(std::move(secondary_aead), options),
+      options.executor));
+}
+
+util::StatusOr<std::string> HedgedAead::Encrypt(
+    absl::string_view plaintext, absl::string_view associated_data) const {
+  return Run(Operation::kEncrypt, plaintext, associated_data);
+}
+
+util::StatusOr<std::string> HedgedAead::Decrypt(
+    absl::string_view ciphertext, absl::string_view associated_data) const {
+  return Run(Operation::kDecrypt, ciphertext, associated_data);
+}
+
+void HedgedAead::Start(Operation operation, int index,
+                       const std::shared_ptr<Call>& call) const {
+  {
+    absl::MutexLock lock(&call->mutex);
+    call->started++;
+  }
+  std::shared_ptr<Backend> backend = backends_[index];
+  executor_->Schedule([operation, index, call, backend]() {
+    absl::Time start = absl::Now();
+    util::StatusOr<std::string> result =
+        operation == Operation::kEncrypt
+            ? backend->aead().Encrypt(call->input, call->associated_data)
+            : backend->aead().Decrypt(call->input, call->associated_data);
+    absl::Duration latency = absl::Now() - start;
+    absl::MutexLock lock(&call->mutex);
+    bool won = result.ok() && call->winner < 0;
+    if (won) call->winner = index;
+    // Recorded before the operation returns, so that the next one sees it.
+    backend->Record(result.ok(), won, latency);
+    call->results[index] = result;
+    call->done[index] = true;
+    call->finished++;
+  });
+}
+
+util::StatusOr<std::string> HedgedAead::Run(
+    Operation operation, absl::string_view input,
+    absl::string_view associated_data) const {
+  // Prefers the primary, unless its circuit breaker is open and the one of
+  // the secondary is not.
+  int first = 0;
+  if (!backends_[0]->Allow() && backends_[1]->Allow()) first = 1;
+  int second = 1 - first;
+  absl::Time deadline = absl::Now() + backends_[first]->HedgeDelay();
+
+  auto call = std::make_shared<Call>(input, associated_data);
+  Start(operation, first, call);
+  bool start_second;
+  {
+    absl::MutexLock lock(&call->mutex);
+    call->mutex.AwaitWithDeadline(absl::Condition(call.get(), &Call::Decided),
+                                  deadline);
+    if (call->winner >= 0) return call->results[call->winner];
+    // Fails over if the first call failed, and hedges if it is slow.
+    start_second = call->done[first] || backends_[second]->Allow();
+  }
+  if (start_second) Start(operation, second, call);
+
+  absl::MutexLock lock(&call->mutex);
+  call->mutex.Await(absl::Condition(call.get(), &Call::Decided));
+  if (call->winner >= 0) return call->results[call->winner];
+  return call->results[first];
+}
+
+}  // namespace tink
+}  // namespace crypto
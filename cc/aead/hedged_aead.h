@@ -0,0 +1,113 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TINK_AEAD_HEDGED_AEAD_H_
+#define TINK_AEAD_HEDGED_AEAD_H_
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "tink/aead.h"
+#include "tink/util/executor.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+
+// An Aead which forwards to two remote Aeads for replicas of the same key,
+// e.g. an AWS KMS multi-region key in two regions, so that a latency spike or
+// an outage of one of them does not stall its callers. Each ciphertext must
+// be decryptable by both.
+//
+// Every operation first goes to one key. If it fails, the operation fails
+// over to the other key. If it has not answered after a hedge delay, the same
+// request is also sent to the other key, and the first successful answer is
+// returned. The hedge delay is the options.hedge_quantile of the recent
+// latencies of the first key, so hedging costs few duplicate requests while
+// latencies are normal.
+//
+// A call counts as failed if it returns an error, or if the hedged call to
+// the other key answered first. After options.failure_threshold consecutive
+// failed calls of a key, its circuit breaker opens: operations go to the
+// other key first, and are not hedged to it, until a trial call succeeds.
+// The first trial is let through options.open_duration after the breaker
+// opened.
+class HedgedAead : public Aead {
+ public:
+  struct Options {
+    // Runs the calls to the remote Aeads. Must be non-null and outlive the
+    // HedgedAead and its calls, which may return after the operation that
+    // started them. Hedging needs at least two threads.
+    util::Executor* executor = nullptr;
+    // The quantile of the recent latencies of a key after which a request is
+    // hedged, in (0, 1].
+    double hedge_quantile = 0.95;
+    // Bounds of the hedge delay. Until enough latencies have been observed,
+    // the hedge delay is max_hedge_delay.
+    absl::Duration min_hedge_delay = absl::Milliseconds(10);
+    absl::Duration max_hedge_delay = absl::Seconds(1);
+    // The number of consecutive failed calls after which the circuit breaker
+    // of a key opens.
+    int failure_threshold = 5;
+    // The time after which an open circuit breaker lets a trial call through.
+    absl::Duration open_duration = absl::Seconds(30);
+  };
+
+  // 'primary_aead' is preferred while its circuit breaker is closed.
+  static crypto::tink::util::StatusOr<std::unique_ptr<HedgedAead>> New(
+      std::unique_ptr<Aead> primary_aead, std::unique_ptr<Aead> secondary_aead,
+      const Options& options);
+
+  crypto::tink::util::StatusOr<std::string> Encrypt(
+      absl::string_view plaintext,
+      absl::string_view associated_data) const override;
+
+  crypto::tink::util::StatusOr<std::string> Decrypt(
+      absl::string_view ciphertext,
+      absl::string_view associated_data) const override;
+
+ private:
+  class Backend;
+  struct Call;
+  enum class Operation { kEncrypt, kDecrypt };
+
+  HedgedAead(std::shared_ptr<Backend> primary,
+             std::shared_ptr<Backend> secondary, util::Executor* executor)
+      : backends_{std::move(primary), std::move(secondary)},
+        executor_(executor) {}
+
+  crypto::tink::util::StatusOr<std::string> Run(
+      Operation operation, absl::string_view input,
+      absl::string_view associated_data) const;
+
+  // Schedules the call of 'call' to backends_[index].
+  void Start(Operation operation, int index,
+             const std::shared_ptr<Call>& call) const;
+
+  // Shared with the calls, which may outlive the HedgedAead.
+  const std::shared_ptr<Backend> backends_[2];
+  util::Executor* const executor_;
+};
+
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_AEAD_HEDGED_AEAD_H_
@@ -0,0 +1,272 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/aead/hedged_aead.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "tink/aead.h"
+#include "tink/util/executor.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "tink/util/test_matchers.h"
+
+namespace crypto {
+namespace tink {
+namespace {
+
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::testing::Eq;
+using ::testing::Lt;
+
+// Runs every task on a new thread.
+class ThreadPerTaskExecutor : public util::Executor {
+ public:
+  ~ThreadPerTaskExecutor() override {
+    absl::MutexLock lock(&mutex_);
+    for (auto& thread : threads_) thread.join();
+  }
+
+  void Schedule(std::function<void()> task) override {
+    absl::MutexLock lock(&mutex_);
+    threads_.emplace_back(std::move(task));
+  }
+
+ private:
+  absl::Mutex mutex_;
+  std::vector<std::thread> threads_;
+};
+
+// A replica of a remote key, whose ciphertexts all replicas decrypt. Its
+// latency and whether it fails can be changed while it is used.
+class FakeRemoteAead : public Aead {
+ public:
+  util::StatusOr<std::string> Encrypt(
+      absl::string_view plaintext,
+      absl::string_view associated_data) const override {
+    if (!BeginCall()) {
+      return util::Status(util::error::UNAVAILABLE, "remote call failed");
+    }
+    return absl::StrCat(associated_data.size(), ":", associated_data,
+                        plaintext);
+  }
+
+  util::StatusOr<std::string> Decrypt(
+      absl::string_view ciphertext,
+      absl::string_view associated_data) const override {
+    if (!BeginCall()) {
+      return util::Status(util::error::UNAVAILABLE, "remote call failed");
+    }
+    std::string prefix =
+        absl::StrCat(associated_data.size(), ":", associated_data);
+    if (ciphertext.substr(0, prefix.size()) != prefix) {
+      return util::Status(util::error::INVALID_ARGUMENT, "decryption failed");
+    }
+    return std::string(ciphertext.substr(prefix.size()));
+  }
+
+  void set_latency(absl::Duration latency) {
+    absl::MutexLock lock(&mutex_);
+    latency_ = latency;
+  }
+
+  void set_fails(bool fails) {
+    absl::MutexLock lock(&mutex_);
+    fails_ = fails;
+  }
+
+  int calls() {
+    absl::MutexLock lock(&mutex_);
+    return calls_;
+  }
+
+ private:
+  // Counts the call, waits for the latency, and returns whether the call
+  // succeeds.
+  bool BeginCall() const {
+    absl::Duration latency;
+    bool fails;
+    {
+      absl::MutexLock lock(&mutex_);
+      calls_++;
+      latency = latency_;
+      fails = fails_;
+    }
+    absl::SleepFor(latency);
+    return !fails;
+  }
+
+  mutable absl::Mutex mutex_;
+  mutable int calls_ = 0;
+  absl::Duration latency_ = absl::ZeroDuration();
+  bool fails_ = false;
+};
+
+class HedgedAeadTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    auto primary = absl::make_unique<FakeRemoteAead>();
+    auto secondary = absl::make_unique<FakeRemoteAead>();
+    primary_ = primary.get();
+    secondary_ = secondary.get();
+    HedgedAead::Options options;
+    options.executor = &executor_;
+    options.min_hedge_delay = absl::Milliseconds(20);
+    options.max_hedge_delay = absl::Milliseconds(50);
+    options.failure_threshold = 3;
+    options.open_duration = absl::Milliseconds(200);
+    auto aead_result =
+        HedgedAead::New(std::move(primary), std::move(secondary), options);
+    ASSERT_THAT(aead_result.status(), IsOk());
+    aead_ = std::move(aead_result.ValueOrDie());
+  }
+
+  void ExpectRoundTrip() {
+    auto ciphertext = aead_->Encrypt("plaintext", "ad");
+    ASSERT_THAT(ciphertext.status(), IsOk());
+    auto plaintext = aead_->Decrypt(ciphertext.ValueOrDie(), "ad");
+    ASSERT_THAT(plaintext.status(), IsOk());
+    EXPECT_THAT(plaintext.ValueOrDie(), Eq("plaintext"));
+  }
+
+  // Declared first, so that the calls still running finish before the fake
+  // remote Aeads are destroyed.
+  ThreadPerTaskExecutor executor_;
+  FakeRemoteAead* primary_;
+  FakeRemoteAead* secondary_;
+  std::unique_ptr<HedgedAead> aead_;
+};
+
+TEST_F(HedgedAeadTest, UsesPrimary) {
+  for (int i = 0; i < 10; i++) ExpectRoundTrip();
+  EXPECT_THAT(primary_->calls(), Eq(20));
+  EXPECT_THAT(secondary_->calls(), Eq(0));
+}
+
+TEST_F(HedgedAeadTest, HedgesSlowPrimary) {
+  primary_->set_latency(absl::Milliseconds(500));
+  absl::Time start = absl::Now();
+  ExpectRoundTrip();
+  EXPECT_THAT(absl::Now() - start, Lt(absl::Milliseconds(400)));
+  EXPECT_THAT(primary_->calls(), Eq(2));
+  EXPECT_THAT(secondary_->calls(), Eq(2));
+}
+
+TEST_F(HedgedAeadTest, FailsOverFromFailingPrimary) {
+  primary_->set_fails(true);
+  ExpectRoundTrip();
+  EXPECT_THAT(primary_->calls(), Eq(2));
+  EXPECT_THAT(secondary_->calls(), Eq(2));
+}
+
+TEST_F(HedgedAeadTest, ReturnsPrimaryErrorIfBothFail) {
+  auto ciphertext = aead_->Encrypt("plaintext", "ad");
+  ASSERT_THAT(ciphertext.status(), IsOk());
+  EXPECT_THAT(aead_->Decrypt(ciphertext.ValueOrDie(), "other ad").status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  primary_->set_fails(true);
+  secondary_->set_fails(true);
+  EXPECT_THAT(aead_->Encrypt("plaintext", "ad").status(),
+              StatusIs(util::error::UNAVAILABLE));
+}
+
+TEST_F(HedgedAeadTest, CircuitBreakerSkipsFailingPrimary) {
+  primary_->set_fails(true);
+  for (int i = 0; i < 3; i++) {
+    EXPECT_THAT(aead_->Encrypt("plaintext", "ad").status(), IsOk());
+  }
+  EXPECT_THAT(primary_->calls(), Eq(3));
+  // The breaker of the primary is open.
+  for (int i = 0; i < 5; i++) {
+    EXPECT_THAT(aead_->Encrypt("plaintext", "ad").status(), IsOk());
+  }
+  EXPECT_THAT(primary_->calls(), Eq(3));
+  EXPECT_THAT(secondary_->calls(), Eq(8));
+
+  // After open_duration, a successful trial closes the breaker.
+  primary_->set_fails(false);
+  absl::SleepFor(absl::Milliseconds(250));
+  EXPECT_THAT(aead_->Encrypt("plaintext", "ad").status(), IsOk());
+  EXPECT_THAT(aead_->Encrypt("plaintext", "ad").status(), IsOk());
+  EXPECT_THAT(primary_->calls(), Eq(5));
+  EXPECT_THAT(secondary_->calls(), Eq(8));
+}
+
+TEST_F(HedgedAeadTest, HedgeDelayFollowsLatencies) {
+  // The first calls are hedged after max_hedge_delay.
+  primary_->set_latency(absl::Milliseconds(35));
+  for (int i = 0; i < 8; i++) {
+    EXPECT_THAT(aead_->Encrypt("plaintext", "ad").status(), IsOk());
+  }
+  EXPECT_THAT(secondary_->calls(), Eq(0));
+  // Once the latencies are known, slower calls are hedged.
+  primary_->set_latency(absl::Milliseconds(500));
+  absl::Time start = absl::Now();
+  EXPECT_THAT(aead_->Encrypt("plaintext", "ad").status(), IsOk());
+  EXPECT_THAT(absl::Now() - start, Lt(absl::Milliseconds(300)));
+  EXPECT_THAT(secondary_->calls(), Eq(1));
+}
+
+TEST(HedgedAeadNewTest, InvalidArguments) {
+  ThreadPerTaskExecutor executor;
+  HedgedAead::Options options;
+  options.executor = &executor;
+  EXPECT_THAT(HedgedAead::New(nullptr, absl::make_unique<FakeRemoteAead>(),
+                              options)
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  options.hedge_quantile = 0;
+  EXPECT_THAT(HedgedAead::New(absl::make_unique<FakeRemoteAead>(),
+                              absl::make_unique<FakeRemoteAead>(), options)
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  options.hedge_quantile = 0.9;
+  options.max_hedge_delay = absl::Milliseconds(1);
+  EXPECT_THAT(HedgedAead::New(absl::make_unique<FakeRemoteAead>(),
+                              absl::make_unique<FakeRemoteAead>(), options)
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  options.max_hedge_delay = absl::Seconds(1);
+  options.executor = nullptr;
+  EXPECT_THAT(HedgedAead::New(absl::make_unique<FakeRemoteAead>(),
+                              absl::make_unique<FakeRemoteAead>(), options)
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  options.executor = &executor;
+  EXPECT_THAT(HedgedAead::New(absl::make_unique<FakeRemoteAead>(),
+                              absl::make_unique<FakeRemoteAead>(), options)
+                  .status(),
+              IsOk());
+}
+
+}  // namespace
+}  // namespace tink
+}  // namespace crypto
@@ -26,6 +26,7 @@
 #include "openssl/cipher.h"
 #include "openssl/err.h"
 #include "tink/aead/cord_aead.h"
+#include "tink/aead/internal/cord_utils.h"
 #include "tink/subtle/random.h"
 #include "tink/subtle/subtle_util.h"
 #include "tink/subtle/subtle_util_boringssl.h"
@@ -38,14 +39,45 @@ namespace crypto {
 namespace tink {
 
 util::Status CordAesGcmBoringSsl::Init(util::SecretData key_value) {
-  cipher_ =
+  const EVP_CIPHER* cipher =
       subtle::SubtleUtilBoringSSL::GetAesGcmCipherForKeySize(key_value.size());
 
-  if (cipher_ == nullptr) {
+  if (cipher == nullptr) {
     return util::Status(util::error::INTERNAL, "invalid key size");
   }
 
-  key_ = key_value;
+  context_.reset(EVP_CIPHER_CTX_new());
+  if (context_ == nullptr) {
+    return util::Status(util::error::INTERNAL, "EVP_CIPHER_CTX_new failed");
+  }
+  if (!EVP_EncryptInit_ex(context_.get(), cipher, nullptr, nullptr, nullptr)) {
+    return util::Status(util::error::INTERNAL, "Encryption init failed");
+  }
+  if (!EVP_CIPHER_CTX_ctrl(context_.get(), EVP_CTRL_GCM_SET_IVLEN,
+                           kIvSizeInBytes, nullptr)) {
+    return util::Status(util::error::INTERNAL, "Setting IV size failed");
+  }
+  if (!EVP_EncryptInit_ex(context_.get(), nullptr, nullptr,
+                          reinterpret_cast<const uint8_t*>(key_value.data()),
+                          nullptr)) {
+    return util::Status(util::error::INTERNAL, "Setting key failed");
+  }
+  return util::OkStatus();
+}
+
+util::Status CordAesGcmBoringSsl::InitContext(EVP_CIPHER_CTX* ctx,
+                                              absl::string_view iv,
+                                              bool encrypt) const {
+  if (!EVP_CIPHER_CTX_copy(ctx, context_.get())) {
+    return util::Status(util::error::INTERNAL, "Copying context failed");
+  }
+  // Passing neither cipher nor key keeps the key schedule of the copy and
+  // only sets the IV and the direction.
+  if (!EVP_CipherInit_ex(ctx, nullptr, nullptr, nullptr,
+                         reinterpret_cast<const uint8_t*>(iv.data()),
+                         encrypt ? 1 : 0)) {
+    return util::Status(util::error::INTERNAL, "Setting IV failed");
+  }
   return util::OkStatus();
 }
 
@@ -63,22 +95,9 @@ util::StatusOr<absl::Cord> CordAesGcmBoringSsl::Encrypt(
     absl::Cord plaintext, absl::Cord additional_data) const {
   std::string iv = subtle::Random::GetRandomBytes(kIvSizeInBytes);
 
-  bssl::UniquePtr<EVP_CIPHER_CTX> ctx(EVP_CIPHER_CTX_new());
-
-  if (!EVP_EncryptInit_ex(ctx.get(), cipher_, nullptr, nullptr, nullptr)) {
-    return util::Status(util::error::INTERNAL, "Encryption init failed");
-  }
-
-  if (!EVP_CIPHER_CTX_ctrl(ctx.get(), EVP_CTRL_GCM_SET_IVLEN, kIvSizeInBytes,
-                           nullptr)) {
-    return util::Status(util::error::INTERNAL, "Setting IV size failed");
-  }
-
-  if (!EVP_EncryptInit_ex(ctx.get(), nullptr, nullptr,
-                          reinterpret_cast<const uint8_t*>(key_.data()),
-                          reinterpret_cast<const uint8_t*>(iv.data()))) {
-    return util::Status(util::error::INTERNAL, "Encryption init failed");
-  }
+  bssl::ScopedEVP_CIPHER_CTX ctx;
+  auto status = InitContext(ctx.get(), iv, /*encrypt=*/true);
+  if (!status.ok()) return status;
 
   int len = 0;
   // Process AD
@@ -136,21 +155,9 @@ util::StatusOr<absl::Cord> CordAesGcmBoringSsl::Decrypt(
   absl::Cord raw_ciphertext = ciphertext.Subcord(
       kIvSizeInBytes, ciphertext.size() - kIvSizeInBytes - kTagSizeInBytes);
 
-  bssl::UniquePtr<EVP_CIPHER_CTX> ctx(EVP_CIPHER_CTX_new());
-  if (!EVP_DecryptInit_ex(ctx.get(), cipher_, nullptr, nullptr, nullptr)) {
-    return util::Status(util::error::INTERNAL, "Decryption init failed");
-  }
-
-  if (!EVP_CIPHER_CTX_ctrl(ctx.get(), EVP_CTRL_GCM_SET_IVLEN, kIvSizeInBytes,
-                           nullptr)) {
-    return util::Status(util::error::INTERNAL, "Setting IV size failed");
-  }
-
-  if (!EVP_DecryptInit_ex(ctx.get(), nullptr, nullptr,
-                          reinterpret_cast<const uint8_t*>(key_.data()),
-                          reinterpret_cast<const uint8_t*>(iv.data()))) {
-    return util::Status(util::error::INTERNAL, "Decryption init failed");
-  }
+  bssl::ScopedEVP_CIPHER_CTX ctx;
+  auto status = InitContext(ctx.get(), iv, /*encrypt=*/false);
+  if (!status.ok()) return status;
 
   int len = 0;
   // Process AD
@@ -162,24 +169,18 @@ util::StatusOr<absl::Cord> CordAesGcmBoringSsl::Decrypt(
     }
   }
 
-  uint64_t plaintext_len = ciphertext.size() - kIvSizeInBytes - kTagSizeInBytes;
-  char* plaintext_buffer = new char[plaintext_len];
-  uint64_t plaintext_buffer_offset = 0;
-
-  absl::Cord result = absl::MakeCordFromExternal(
-      absl::string_view(plaintext_buffer, plaintext_len),
-      [plaintext_buffer](absl::string_view) { delete[] plaintext_buffer; });
-
-  for (auto ct_chunk : raw_ciphertext.Chunks()) {
-    if (!EVP_DecryptUpdate(ctx.get(),
-                           reinterpret_cast<uint8_t*>(
-                               &plaintext_buffer[plaintext_buffer_offset]),
-                           &len,
-                           reinterpret_cast<const uint8_t*>(ct_chunk.data()),
-                           ct_chunk.size())) {
-      return util::Status(util::error::INTERNAL, "Decryption failed");
-    }
-    plaintext_buffer_offset += ct_chunk.size();
+  // The plaintext reuses the chunk layout of the ciphertext, so neither of
+  // them needs to be flattened.
+  auto result = internal::TransformCordChunks(
+      raw_ciphertext, [&ctx](absl::string_view ct_chunk, char* pt_chunk) {
+        int len = 0;
+        return EVP_DecryptUpdate(
+                   ctx.get(), reinterpret_cast<uint8_t*>(pt_chunk), &len,
+                   reinterpret_cast<const uint8_t*>(ct_chunk.data()),
+                   ct_chunk.size()) == 1;
+      });
+  if (!result.ok()) {
+    return util::Status(util::error::INTERNAL, "Decryption failed");
   }
 
   // Set expected tag value to last chunk in ciphertext Cord
@@ -193,7 +194,7 @@ util::StatusOr<absl::Cord> CordAesGcmBoringSsl::Decrypt(
   }
   // Verify authentication tag
   if (!EVP_DecryptFinal_ex(ctx.get(), nullptr, &len)) {
-    return util::Status(util::error::INTERNAL, "Authentication failed");
+    return util::AuthenticationFailedError();
   }
   return result;
 }
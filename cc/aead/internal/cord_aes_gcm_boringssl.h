@@ -49,8 +49,16 @@ class CordAesGcmBoringSsl : public CordAead {
   CordAesGcmBoringSsl() {}
   crypto::tink::util::Status Init(crypto::tink::util::SecretData key_value);
 
-  const EVP_CIPHER *cipher_;
-  crypto::tink::util::SecretData key_;
+  // Initializes ctx as a copy of context_, set up for encryption or
+  // decryption with the given iv.
+  crypto::tink::util::Status InitContext(EVP_CIPHER_CTX* ctx,
+                                         absl::string_view iv,
+                                         bool encrypt) const;
+
+  // Context holding the expanded key (and GHASH tables), set up once in
+  // Init(). It is never modified afterwards, and each call to Encrypt() or
+  // Decrypt() works on a copy, so that only the IV is set per call.
+  bssl::UniquePtr<EVP_CIPHER_CTX> context_;
 };
 
 }  // namespace tink
@@ -15,6 +15,7 @@
 #include "tink/aead/internal/cord_aes_gcm_boringssl.h"
 
 #include <string>
+#include <thread>  // NOLINT(build/c++11)
 #include <vector>
 
 #include "gmock/gmock.h"
@@ -61,6 +62,33 @@ TEST(CordAesGcmBoringSslTest, EncryptDecryptCord) {
   EXPECT_EQ(pt.ValueOrDie(), message_cord.Flatten());
 }
 
+TEST(CordAesGcmBoringSslTest, ConcurrentEncryptDecrypt) {
+  util::SecretData key = util::SecretDataFromStringView(
+      test::HexDecodeOrDie("000102030405060708090a0b0c0d0e0f"));
+  auto res = CordAesGcmBoringSsl::New(key);
+  EXPECT_TRUE(res.ok()) << res.status();
+  auto cipher = std::move(res.ValueOrDie());
+  const absl::Cord aad_cord = absl::Cord("Some data to authenticate.");
+
+  // All calls share the key-expanded context of the cipher.
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&cipher, &aad_cord, t]() {
+      for (int i = 0; i < 50; ++i) {
+        absl::Cord message_cord = absl::Cord(std::string(i + t, 'a' + t));
+        auto ct = cipher->Encrypt(message_cord, aad_cord);
+        ASSERT_THAT(ct.status(), IsOk());
+        auto pt = cipher->Decrypt(ct.ValueOrDie(), aad_cord);
+        ASSERT_THAT(pt.status(), IsOk());
+        EXPECT_EQ(pt.ValueOrDie(), message_cord);
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
 TEST(CordAesGcmBoringSslTest, ChunkyCordEncrypt) {
   util::SecretData key = util::SecretDataFromStringView(
       test::HexDecodeOrDie("000102030405060708090a0b0c0d0e0f"));
@@ -0,0 +1,66 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/aead/internal/cord_utils.h"
+
+#include <string>
+
+#include "absl/functional/function_ref.h"
+#include "absl/strings/cord.h"
+#include "absl/strings/string_view.h"
+#include "tink/subtle/subtle_util.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace internal {
+
+util::StatusOr<absl::Cord> TransformCordChunks(
+    const absl::Cord& input,
+    absl::FunctionRef<bool(absl::string_view in, char* out)> transform) {
+  absl::Cord result;
+  // Output of consecutive small chunks which is appended in one go.
+  std::string pending;
+  for (absl::string_view chunk : input.Chunks()) {
+    if (chunk.size() < kMinExternalCordChunkSize) {
+      size_t offset = pending.size();
+      subtle::ResizeStringUninitialized(&pending, offset + chunk.size());
+      if (!transform(chunk, &pending[offset])) {
+        return util::Status(util::error::INTERNAL, "Transformation failed");
+      }
+      continue;
+    }
+    if (!pending.empty()) {
+      result.Append(pending);
+      pending.clear();
+    }
+    char* buffer = new char[chunk.size()];
+    absl::Cord output = absl::MakeCordFromExternal(
+        absl::string_view(buffer, chunk.size()),
+        [buffer](absl::string_view) { delete[] buffer; });
+    if (!transform(chunk, buffer)) {
+      return util::Status(util::error::INTERNAL, "Transformation failed");
+    }
+    result.Append(std::move(output));
+  }
+  if (!pending.empty()) result.Append(pending);
+  return result;
+}
+
+}  // namespace internal
+}  // namespace tink
+}  // namespace crypto
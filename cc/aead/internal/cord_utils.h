@@ -0,0 +1,52 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_AEAD_INTERNAL_CORD_UTILS_H_
+#define TINK_AEAD_INTERNAL_CORD_UTILS_H_
+
+#include <cstddef>
+
+#include "absl/functional/function_ref.h"
+#include "absl/strings/cord.h"
+#include "absl/strings/string_view.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace internal {
+
+// Chunks of at least this many bytes get their own externally owned output
+// chunk in TransformCordChunks; smaller ones are copied into the result.
+constexpr size_t kMinExternalCordChunkSize = 512;
+
+// Applies the length-preserving `transform` to `input` one chunk at a time
+// and returns the concatenated outputs, without ever flattening `input`.
+// `transform` is called with each input chunk and a buffer of the same size
+// to write its output to, and returns false on failure.
+//
+// The result mirrors the chunk layout of `input`: every chunk of at least
+// kMinExternalCordChunkSize bytes is written into a freshly allocated buffer
+// of exactly that size which is handed to the result without copying.
+// Runs of smaller chunks are appended to the result as regular Cord data.
+util::StatusOr<absl::Cord> TransformCordChunks(
+    const absl::Cord& input,
+    absl::FunctionRef<bool(absl::string_view in, char* out)> transform);
+
+}  // namespace internal
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_AEAD_INTERNAL_CORD_UTILS_H_
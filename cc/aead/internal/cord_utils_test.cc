@@ -0,0 +1,92 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/aead/internal/cord_utils.h"
+
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/cord.h"
+#include "absl/strings/cord_test_helpers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "tink/util/status.h"
+#include "tink/util/test_matchers.h"
+
+namespace crypto {
+namespace tink {
+namespace internal {
+namespace {
+
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::testing::ElementsAre;
+using ::testing::Eq;
+
+bool ToUpper(absl::string_view in, char* out) {
+  for (char c : in) *out++ = (c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c;
+  return true;
+}
+
+std::vector<size_t> ChunkSizes(const absl::Cord& cord) {
+  std::vector<size_t> sizes;
+  for (absl::string_view chunk : cord.Chunks()) sizes.push_back(chunk.size());
+  return sizes;
+}
+
+TEST(CordUtilsTest, TransformEmptyCord) {
+  auto result = TransformCordChunks(absl::Cord(), ToUpper);
+  ASSERT_THAT(result.status(), IsOk());
+  EXPECT_TRUE(result.ValueOrDie().empty());
+}
+
+TEST(CordUtilsTest, TransformKeepsLargeChunks) {
+  std::string large(kMinExternalCordChunkSize, 'a');
+  absl::Cord input = absl::MakeFragmentedCord({large, large + large});
+  auto result = TransformCordChunks(input, ToUpper);
+  ASSERT_THAT(result.status(), IsOk());
+  EXPECT_THAT(result.ValueOrDie(),
+              Eq(std::string(3 * kMinExternalCordChunkSize, 'A')));
+  EXPECT_THAT(ChunkSizes(result.ValueOrDie()),
+              ElementsAre(kMinExternalCordChunkSize,
+                          2 * kMinExternalCordChunkSize));
+}
+
+TEST(CordUtilsTest, TransformSmallChunks) {
+  std::string large(kMinExternalCordChunkSize, 'a');
+  absl::Cord input =
+      absl::MakeFragmentedCord({"ab", "cd", large, "ef", "gh", "ij"});
+  auto result = TransformCordChunks(input, ToUpper);
+  ASSERT_THAT(result.status(), IsOk());
+  EXPECT_THAT(result.ValueOrDie(),
+              Eq(absl::StrCat("ABCD", std::string(kMinExternalCordChunkSize,
+                                                  'A'),
+                              "EFGHIJ")));
+}
+
+TEST(CordUtilsTest, TransformFailure) {
+  absl::Cord input = absl::MakeFragmentedCord({"ab", "cd"});
+  auto result = TransformCordChunks(
+      input, [](absl::string_view, char*) { return false; });
+  EXPECT_THAT(result.status(), StatusIs(util::error::INTERNAL));
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace tink
+}  // namespace crypto
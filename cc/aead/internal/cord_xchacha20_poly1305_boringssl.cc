@@ -0,0 +1,289 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/aead/internal/cord_xchacha20_poly1305_boringssl.h"
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/cord.h"
+#include "absl/strings/string_view.h"
+#include "openssl/chacha.h"
+#include "openssl/mem.h"
+#include "openssl/poly1305.h"
+#include "tink/aead/cord_aead.h"
+#include "tink/aead/internal/cord_utils.h"
+#include "tink/config/tink_fips.h"
+#include "tink/subtle/random.h"
+#include "tink/subtle/subtle_util.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+
+namespace {
+
+constexpr int kChaChaBlockSize = 64;
+constexpr int kChaChaNonceSize = 12;
+constexpr int kHChaChaNonceSize = 16;
+constexpr int kPoly1305TagSize = 16;
+// The 32-bit ChaCha20 block counter starts at 1 for the ciphertext.
+constexpr uint64_t kMaxPlaintextSize =
+    (uint64_t{1} << 32) * kChaChaBlockSize - kChaChaBlockSize;
+
+uint32_t Load32Le(const uint8_t* in) {
+  return static_cast<uint32_t>(in[0]) | static_cast<uint32_t>(in[1]) << 8 |
+         static_cast<uint32_t>(in[2]) << 16 |
+         static_cast<uint32_t>(in[3]) << 24;
+}
+
+void Store32Le(uint32_t value, uint8_t* out) {
+  for (int i = 0; i < 4; i++) out[i] = static_cast<uint8_t>(value >> (8 * i));
+}
+
+void Store64Le(uint64_t value, uint8_t* out) {
+  for (int i = 0; i < 8; i++) out[i] = static_cast<uint8_t>(value >> (8 * i));
+}
+
+uint32_t RotateLeft(uint32_t value, int shift) {
+  return (value << shift) | (value >> (32 - shift));
+}
+
+void QuarterRound(uint32_t* x, int a, int b, int c, int d) {
+  x[a] += x[b];
+  x[d] = RotateLeft(x[d] ^ x[a], 16);
+  x[c] += x[d];
+  x[b] = RotateLeft(x[b] ^ x[c], 12);
+  x[a] += x[b];
+  x[d] = RotateLeft(x[d] ^ x[a], 8);
+  x[c] += x[d];
+  x[b] = RotateLeft(x[b] ^ x[c], 7);
+}
+
+// Derives the ChaCha20 subkey from the key and the first 16 bytes of the
+// nonce, see https://tools.ietf.org/html/draft-irtf-cfrg-xchacha-03#section-2.2
+util::SecretData HChaCha20(const util::SecretData& key, const uint8_t* nonce) {
+  uint32_t x[16] = {0x61707865, 0x3320646e, 0x79622d32, 0x6b206574};
+  for (int i = 0; i < 8; i++) {
+    x[4 + i] = Load32Le(key.data() + 4 * i);
+  }
+  for (int i = 0; i < 4; i++) {
+    x[12 + i] = Load32Le(nonce + 4 * i);
+  }
+  for (int i = 0; i < 10; i++) {
+    QuarterRound(x, 0, 4, 8, 12);
+    QuarterRound(x, 1, 5, 9, 13);
+    QuarterRound(x, 2, 6, 10, 14);
+    QuarterRound(x, 3, 7, 11, 15);
+    QuarterRound(x, 0, 5, 10, 15);
+    QuarterRound(x, 1, 6, 11, 12);
+    QuarterRound(x, 2, 7, 8, 13);
+    QuarterRound(x, 3, 4, 9, 14);
+  }
+  util::SecretData subkey(32);
+  for (int i = 0; i < 4; i++) {
+    Store32Le(x[i], subkey.data() + 4 * i);
+    Store32Le(x[12 + i], subkey.data() + 16 + 4 * i);
+  }
+  OPENSSL_cleanse(x, sizeof(x));
+  return subkey;
+}
+
+// Incremental ChaCha20-Poly1305 (RFC 8439) under the HChaCha20 subkey, which
+// consumes the associated data and the payload in arbitrarily sized pieces.
+class XChaCha20Poly1305Stream {
+ public:
+  XChaCha20Poly1305Stream(const util::SecretData& key, absl::string_view nonce)
+      : subkey_(HChaCha20(key, reinterpret_cast<const uint8_t*>(nonce.data()))) {
+    std::memset(chacha_nonce_, 0, kChaChaNonceSize - 8);
+    std::memcpy(chacha_nonce_ + kChaChaNonceSize - 8,
+                nonce.data() + kHChaChaNonceSize, 8);
+    // The Poly1305 key is the start of the keystream block with counter 0.
+    uint8_t poly1305_key[32] = {0};
+    CRYPTO_chacha_20(poly1305_key, poly1305_key, sizeof(poly1305_key),
+                     subkey_.data(), chacha_nonce_, 0);
+    CRYPTO_poly1305_init(&poly1305_, poly1305_key);
+    OPENSSL_cleanse(poly1305_key, sizeof(poly1305_key));
+  }
+
+  ~XChaCha20Poly1305Stream() {
+    OPENSSL_cleanse(&poly1305_, sizeof(poly1305_));
+    OPENSSL_cleanse(keystream_, sizeof(keystream_));
+  }
+
+  // Must be called exactly once, before any payload is processed.
+  void AddAssociatedData(const absl::Cord& associated_data) {
+    for (absl::string_view chunk : associated_data.Chunks()) {
+      Mac(chunk);
+    }
+    MacPadding(associated_data.size());
+    associated_data_size_ = associated_data.size();
+  }
+
+  void Encrypt(absl::string_view plaintext, char* ciphertext) {
+    Crypt(plaintext, ciphertext);
+    Mac(absl::string_view(ciphertext, plaintext.size()));
+    ciphertext_size_ += plaintext.size();
+  }
+
+  void Decrypt(absl::string_view ciphertext, char* plaintext) {
+    Mac(ciphertext);
+    Crypt(ciphertext, plaintext);
+    ciphertext_size_ += ciphertext.size();
+  }
+
+  void ComputeTag(uint8_t tag[kPoly1305TagSize]) {
+    MacPadding(ciphertext_size_);
+    uint8_t sizes[16];
+    Store64Le(associated_data_size_, sizes);
+    Store64Le(ciphertext_size_, sizes + 8);
+    CRYPTO_poly1305_update(&poly1305_, sizes, sizeof(sizes));
+    CRYPTO_poly1305_finish(&poly1305_, tag);
+  }
+
+ private:
+  void Mac(absl::string_view data) {
+    CRYPTO_poly1305_update(&poly1305_,
+                           reinterpret_cast<const uint8_t*>(data.data()),
+                           data.size());
+  }
+
+  void MacPadding(uint64_t size) {
+    static const uint8_t kZeros[16] = {0};
+    if (size % 16 != 0) {
+      CRYPTO_poly1305_update(&poly1305_, kZeros, 16 - size % 16);
+    }
+  }
+
+  void Crypt(absl::string_view in, char* out) {
+    const uint8_t* src = reinterpret_cast<const uint8_t*>(in.data());
+    uint8_t* dst = reinterpret_cast<uint8_t*>(out);
+    size_t size = in.size();
+    // Use up the keystream left over from a previous piece ending mid-block.
+    for (; size > 0 && keystream_offset_ < kChaChaBlockSize; size--) {
+      *dst++ = *src++ ^ keystream_[keystream_offset_++];
+    }
+    size_t full_blocks_size = size - size % kChaChaBlockSize;
+    if (full_blocks_size > 0) {
+      CRYPTO_chacha_20(dst, src, full_blocks_size, subkey_.data(),
+                       chacha_nonce_, counter_);
+      counter_ += full_blocks_size / kChaChaBlockSize;
+      src += full_blocks_size;
+      dst += full_blocks_size;
+      size -= full_blocks_size;
+    }
+    if (size > 0) {
+      std::memset(keystream_, 0, kChaChaBlockSize);
+      CRYPTO_chacha_20(keystream_, keystream_, kChaChaBlockSize,
+                       subkey_.data(), chacha_nonce_, counter_);
+      counter_++;
+      for (keystream_offset_ = 0; keystream_offset_ < size;
+           keystream_offset_++) {
+        dst[keystream_offset_] = src[keystream_offset_] ^
+                                 keystream_[keystream_offset_];
+      }
+    }
+  }
+
+  const util::SecretData subkey_;
+  uint8_t chacha_nonce_[kChaChaNonceSize];
+  uint32_t counter_ = 1;
+  uint8_t keystream_[kChaChaBlockSize];
+  size_t keystream_offset_ = kChaChaBlockSize;
+  poly1305_state poly1305_;
+  uint64_t associated_data_size_ = 0;
+  uint64_t ciphertext_size_ = 0;
+};
+
+}  // namespace
+
+util::StatusOr<std::unique_ptr<CordAead>> CordXChacha20Poly1305BoringSsl::New(
+    util::SecretData key_value) {
+  auto status = CheckFipsCompatibility<CordXChacha20Poly1305BoringSsl>();
+  if (!status.ok()) return status;
+
+  if (key_value.size() != kKeySize) {
+    return util::Status(util::error::INVALID_ARGUMENT, "Invalid key size");
+  }
+  return {absl::WrapUnique(
+      new CordXChacha20Poly1305BoringSsl(std::move(key_value)))};
+}
+
+util::StatusOr<absl::Cord> CordXChacha20Poly1305BoringSsl::Encrypt(
+    absl::Cord plaintext, absl::Cord additional_data) const {
+  if (plaintext.size() > kMaxPlaintextSize) {
+    return util::Status(util::error::INVALID_ARGUMENT, "Plaintext too long");
+  }
+  std::string nonce = subtle::Random::GetRandomBytes(kNonceSize);
+  XChaCha20Poly1305Stream stream(key_, nonce);
+  stream.AddAssociatedData(additional_data);
+
+  char* buffer = new char[plaintext.size()];
+  absl::Cord ciphertext_buffer = absl::MakeCordFromExternal(
+      absl::string_view(buffer, plaintext.size()),
+      [buffer](absl::string_view) { delete[] buffer; });
+  uint64_t ciphertext_buffer_offset = 0;
+  for (absl::string_view plaintext_chunk : plaintext.Chunks()) {
+    stream.Encrypt(plaintext_chunk, &buffer[ciphertext_buffer_offset]);
+    ciphertext_buffer_offset += plaintext_chunk.size();
+  }
+
+  std::string tag;
+  subtle::ResizeStringUninitialized(&tag, kTagSize);
+  stream.ComputeTag(reinterpret_cast<uint8_t*>(&tag[0]));
+
+  absl::Cord result;
+  result.Append(nonce);
+  result.Append(ciphertext_buffer);
+  result.Append(tag);
+  return result;
+}
+
+util::StatusOr<absl::Cord> CordXChacha20Poly1305BoringSsl::Decrypt(
+    absl::Cord ciphertext, absl::Cord additional_data) const {
+  if (ciphertext.size() < kNonceSize + kTagSize) {
+    return util::Status(util::error::INTERNAL, "Ciphertext too short");
+  }
+  std::string nonce = std::string(ciphertext.Subcord(0, kNonceSize));
+  absl::Cord raw_ciphertext = ciphertext.Subcord(
+      kNonceSize, ciphertext.size() - kNonceSize - kTagSize);
+  std::string tag = std::string(
+      ciphertext.Subcord(ciphertext.size() - kTagSize, kTagSize));
+
+  XChaCha20Poly1305Stream stream(key_, nonce);
+  stream.AddAssociatedData(additional_data);
+  auto result = internal::TransformCordChunks(
+      raw_ciphertext, [&stream](absl::string_view ct_chunk, char* pt_chunk) {
+        stream.Decrypt(ct_chunk, pt_chunk);
+        return true;
+      });
+  if (!result.ok()) return result.status();
+
+  uint8_t expected_tag[kTagSize];
+  stream.ComputeTag(expected_tag);
+  if (CRYPTO_memcmp(expected_tag, tag.data(), kTagSize) != 0) {
+    return util::AuthenticationFailedError();
+  }
+  return result;
+}
+
+}  // namespace tink
+}  // namespace crypto
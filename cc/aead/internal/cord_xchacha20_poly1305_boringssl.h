@@ -0,0 +1,75 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_AEAD_INTERNAL_CORD_XCHACHA20_POLY1305_BORINGSSL_H_
+#define TINK_AEAD_INTERNAL_CORD_XCHACHA20_POLY1305_BORINGSSL_H_
+
+#include <memory>
+#include <utility>
+
+#include "absl/strings/cord.h"
+#include "tink/aead/cord_aead.h"
+#include "tink/config/tink_fips.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+
+// CordAead for XChaCha20-Poly1305. The ciphertext format is the same as that
+// of subtle::XChacha20Poly1305BoringSsl, i.e. nonce || ciphertext || tag, so
+// the two can decrypt each other's ciphertexts.
+//
+// BoringSSL only offers XChaCha20-Poly1305 as a one-shot EVP_AEAD, which would
+// require flattening both plaintext and ciphertext. This implementation
+// instead streams over the Cord chunks using BoringSSL's ChaCha20 and
+// Poly1305 primitives.
+class CordXChacha20Poly1305BoringSsl : public CordAead {
+ public:
+  // Constructs a new CordAead cipher for XChacha20-Poly1305.
+  // Currently supported key size is 256 bits.
+  // Currently supported nonce size is 24 bytes.
+  // The tag size is fixed to 16 bytes.
+  static crypto::tink::util::StatusOr<std::unique_ptr<CordAead>> New(
+      util::SecretData key_value);
+
+  crypto::tink::util::StatusOr<absl::Cord> Encrypt(
+      absl::Cord plaintext, absl::Cord additional_data) const override;
+
+  // The plaintext reuses the chunk layout of the ciphertext.
+  crypto::tink::util::StatusOr<absl::Cord> Decrypt(
+      absl::Cord ciphertext, absl::Cord additional_data) const override;
+
+  static constexpr crypto::tink::FipsCompatibility kFipsStatus =
+      crypto::tink::FipsCompatibility::kNotFips;
+
+ private:
+  // The following constants are in bytes.
+  static constexpr int kKeySize = 32;
+  static constexpr int kNonceSize = 24;
+  static constexpr int kTagSize = 16;
+
+  explicit CordXChacha20Poly1305BoringSsl(util::SecretData key)
+      : key_(std::move(key)) {}
+
+  const util::SecretData key_;
+};
+
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_AEAD_INTERNAL_CORD_XCHACHA20_POLY1305_BORINGSSL_H_
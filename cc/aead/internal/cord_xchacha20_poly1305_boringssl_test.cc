@@ -0,0 +1,240 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/aead/internal/cord_xchacha20_poly1305_boringssl.h"
+
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/cord.h"
+#include "absl/strings/cord_test_helpers.h"
+#include "absl/strings/str_split.h"
+#include "tink/config/tink_fips.h"
+#include "tink/subtle/xchacha20_poly1305_boringssl.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "tink/util/test_matchers.h"
+#include "tink/util/test_util.h"
+
+namespace crypto {
+namespace tink {
+
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::testing::ElementsAreArray;
+using ::testing::Eq;
+
+namespace {
+
+constexpr absl::string_view kKey256Hex =
+    "000102030405060708090a0b0c0d0e0f000102030405060708090a0b0c0d0e0f";
+
+TEST(CordXChacha20Poly1305BoringSslTest, EncryptDecryptCord) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  util::SecretData key =
+      util::SecretDataFromStringView(test::HexDecodeOrDie(kKey256Hex));
+  auto res = CordXChacha20Poly1305BoringSsl::New(key);
+  ASSERT_THAT(res.status(), IsOk());
+  auto cipher = std::move(res.ValueOrDie());
+  absl::Cord message_cord = absl::Cord("Some data to encrypt.");
+  absl::Cord aad_cord = absl::Cord("Some data to authenticate.");
+
+  auto ct = cipher->Encrypt(message_cord, aad_cord);
+  ASSERT_THAT(ct.status(), IsOk());
+  EXPECT_EQ(ct.ValueOrDie().size(), message_cord.size() + 24 + 16);
+
+  auto pt = cipher->Decrypt(ct.ValueOrDie(), aad_cord);
+  ASSERT_THAT(pt.status(), IsOk());
+  EXPECT_EQ(pt.ValueOrDie(), message_cord);
+}
+
+// Test vector from
+// https://tools.ietf.org/html/draft-irtf-cfrg-xchacha-03#appendix-A.3.1
+TEST(CordXChacha20Poly1305BoringSslTest, TestVector) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  util::SecretData key = util::SecretDataFromStringView(test::HexDecodeOrDie(
+      "808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f"));
+  std::string ct = test::HexDecodeOrDie(
+      "404142434445464748494a4b4c4d4e4f5051525354555657"
+      "bd6d179d3e83d43b9576579493c0e939572a1700252bfaccbed2902c21396cbb"
+      "731c7f1b0b4aa6440bf3a82f4eda7e39ae64c6708c54c216cb96b72e1213b452"
+      "2f8c9ba40db5d945b11b69b982c1bb9e3f3fac2bc369488f76b2383565d3fff9"
+      "21f9664c97637da9768812f615c68b13b52e"
+      "c0875924c1c7987947deafd8780acf49");
+  std::string aad = test::HexDecodeOrDie("50515253c0c1c2c3c4c5c6c7");
+  std::string message =
+      "Ladies and Gentlemen of the class of '99: If I could offer you only "
+      "one tip for the future, sunscreen would be it.";
+  auto cipher =
+      std::move(CordXChacha20Poly1305BoringSsl::New(key).ValueOrDie());
+
+  auto pt = cipher->Decrypt(absl::Cord(ct), absl::Cord(aad));
+  ASSERT_THAT(pt.status(), IsOk());
+  EXPECT_THAT(pt.ValueOrDie(), Eq(message));
+
+  absl::Cord fragmented_ct =
+      absl::MakeFragmentedCord(absl::StrSplit(ct, absl::ByLength(7)));
+  absl::Cord fragmented_aad =
+      absl::MakeFragmentedCord(absl::StrSplit(aad, absl::ByLength(5)));
+  pt = cipher->Decrypt(fragmented_ct, fragmented_aad);
+  ASSERT_THAT(pt.status(), IsOk());
+  EXPECT_THAT(pt.ValueOrDie(), Eq(message));
+}
+
+TEST(CordXChacha20Poly1305BoringSslTest, ChunkyCordEncrypt) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  util::SecretData key =
+      util::SecretDataFromStringView(test::HexDecodeOrDie(kKey256Hex));
+  auto cipher =
+      std::move(CordXChacha20Poly1305BoringSsl::New(key).ValueOrDie());
+  // Chunk sizes which are not multiples of the ChaCha20 block size.
+  std::string message(1000, 'x');
+  for (int i = 0; i < message.size(); i++) message[i] = 'a' + i % 26;
+  std::string aad = "Some data to authenticate.";
+
+  absl::Cord message_cord =
+      absl::MakeFragmentedCord(absl::StrSplit(message, absl::ByLength(37)));
+  absl::Cord aad_cord =
+      absl::MakeFragmentedCord(absl::StrSplit(aad, absl::ByLength(3)));
+
+  auto ct = cipher->Encrypt(message_cord, aad_cord);
+  ASSERT_THAT(ct.status(), IsOk());
+
+  auto pt = cipher->Decrypt(ct.ValueOrDie(), absl::Cord(aad));
+  ASSERT_THAT(pt.status(), IsOk());
+  EXPECT_THAT(pt.ValueOrDie(), Eq(message));
+}
+
+TEST(CordXChacha20Poly1305BoringSslTest, DecryptKeepsChunkLayout) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  util::SecretData key =
+      util::SecretDataFromStringView(test::HexDecodeOrDie(kKey256Hex));
+  auto cipher =
+      std::move(CordXChacha20Poly1305BoringSsl::New(key).ValueOrDie());
+  std::string message(3 * 4096, 'x');
+  absl::Cord aad_cord = absl::Cord("Some data to authenticate.");
+  std::string ct = std::string(
+      cipher->Encrypt(absl::Cord(message), aad_cord).ValueOrDie());
+
+  std::vector<std::string> ct_chunks = {ct.substr(0, 24 + 4096),
+                                        ct.substr(24 + 4096, 4096),
+                                        ct.substr(24 + 2 * 4096)};
+  auto pt = cipher->Decrypt(absl::MakeFragmentedCord(ct_chunks), aad_cord);
+  ASSERT_THAT(pt.status(), IsOk());
+  EXPECT_THAT(pt.ValueOrDie(), Eq(message));
+  std::vector<size_t> chunk_sizes;
+  for (absl::string_view chunk : pt.ValueOrDie().Chunks()) {
+    chunk_sizes.push_back(chunk.size());
+  }
+  EXPECT_THAT(chunk_sizes, ElementsAreArray({4096, 4096, 4096}));
+}
+
+TEST(CordXChacha20Poly1305BoringSslTest, CompatibleWithStringImplementation) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  util::SecretData key =
+      util::SecretDataFromStringView(test::HexDecodeOrDie(kKey256Hex));
+  auto cord_cipher =
+      std::move(CordXChacha20Poly1305BoringSsl::New(key).ValueOrDie());
+  auto string_cipher =
+      std::move(subtle::XChacha20Poly1305BoringSsl::New(key).ValueOrDie());
+  std::string aad = "Some data to authenticate.";
+
+  for (int size : {0, 1, 63, 64, 65, 1000}) {
+    std::string message(size, 'm');
+    absl::Cord cord_ct =
+        cord_cipher->Encrypt(absl::Cord(message), absl::Cord(aad))
+            .ValueOrDie();
+    auto pt = string_cipher->Decrypt(std::string(cord_ct), aad);
+    ASSERT_THAT(pt.status(), IsOk()) << size;
+    EXPECT_EQ(pt.ValueOrDie(), message);
+
+    std::string string_ct = string_cipher->Encrypt(message, aad).ValueOrDie();
+    auto cord_pt = cord_cipher->Decrypt(absl::Cord(string_ct), absl::Cord(aad));
+    ASSERT_THAT(cord_pt.status(), IsOk()) << size;
+    EXPECT_EQ(cord_pt.ValueOrDie(), message);
+  }
+}
+
+TEST(CordXChacha20Poly1305BoringSslTest, ModifiedCord) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  util::SecretData key =
+      util::SecretDataFromStringView(test::HexDecodeOrDie(kKey256Hex));
+  auto cipher =
+      std::move(CordXChacha20Poly1305BoringSsl::New(key).ValueOrDie());
+  absl::Cord message = absl::Cord("Some data to encrypt.");
+  absl::Cord aad = absl::Cord("Some data to authenticate.");
+  std::string ct = std::string(cipher->Encrypt(message, aad).ValueOrDie());
+  EXPECT_TRUE(cipher->Decrypt(absl::Cord(ct), aad).ok());
+  // Modify the ciphertext
+  for (size_t i = 0; i < ct.size() * 8; i++) {
+    std::string modified_ct = ct;
+    modified_ct[i / 8] ^= 1 << (i % 8);
+    EXPECT_FALSE(cipher->Decrypt(absl::Cord(modified_ct), aad).ok()) << i;
+  }
+  // Modify the additional data
+  for (size_t i = 0; i < aad.size() * 8; i++) {
+    std::string modified_aad = std::string(aad);
+    modified_aad[i / 8] ^= 1 << (i % 8);
+    EXPECT_FALSE(
+        cipher->Decrypt(absl::Cord(ct), absl::Cord(modified_aad)).ok())
+        << i;
+  }
+  // Truncate the ciphertext
+  for (size_t i = 0; i < ct.size(); i++) {
+    EXPECT_FALSE(cipher->Decrypt(absl::Cord(ct.substr(0, i)), aad).ok()) << i;
+  }
+}
+
+TEST(CordXChacha20Poly1305BoringSslTest, InvalidKeySizes) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  for (int key_size = 0; key_size < 65; ++key_size) {
+    if (key_size == 32) continue;
+    util::SecretData key(key_size, 'x');
+    EXPECT_THAT(CordXChacha20Poly1305BoringSsl::New(key).status(),
+                StatusIs(util::error::INVALID_ARGUMENT));
+  }
+}
+
+TEST(CordXChacha20Poly1305BoringSslTest, FipsOnly) {
+  if (!kUseOnlyFips) {
+    GTEST_SKIP() << "Only supported in FIPS-only mode";
+  }
+  util::SecretData key =
+      util::SecretDataFromStringView(test::HexDecodeOrDie(kKey256Hex));
+  EXPECT_THAT(CordXChacha20Poly1305BoringSsl::New(key).status(),
+              StatusIs(util::error::INTERNAL));
+}
+
+}  // namespace
+}  // namespace tink
+}  // namespace crypto
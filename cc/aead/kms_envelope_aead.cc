@@ -14,12 +14,22 @@
 
 #include "tink/aead/kms_envelope_aead.h"
 
+#include <atomic>
+#include <functional>
+#include <memory>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "absl/base/internal/endian.h"
+#include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "tink/aead.h"
+#include "tink/internal/tracing_span.h"
 #include "tink/registry.h"
 #include "tink/util/errors.h"
 #include "tink/util/status.h"
@@ -48,64 +58,150 @@ std::string GetEnvelopeCiphertext(absl::string_view encrypted_dek,
                       encrypted_dek, encrypted_plaintext);
 }
 
+// Splits a ciphertext of KMS envelope encryption into the encrypted DEK and
+// the AEAD payload.
+util::Status ParseEnvelopeCiphertext(absl::string_view ciphertext,
+                                     absl::string_view* encrypted_dek,
+                                     absl::string_view* payload) {
+  if (ciphertext.size() < kEncryptedDekPrefixSize) {
+    return util::Status(util::error::INVALID_ARGUMENT, "ciphertext too short");
+  }
+  auto enc_dek_size = absl::big_endian::Load32(
+      reinterpret_cast<const uint8_t*>(ciphertext.data()));
+  if (enc_dek_size > ciphertext.size() - kEncryptedDekPrefixSize ||
+      enc_dek_size < 0) {
+    return util::Status(util::error::INVALID_ARGUMENT, "invalid ciphertext");
+  }
+  *encrypted_dek = ciphertext.substr(kEncryptedDekPrefixSize, enc_dek_size);
+  *payload = ciphertext.substr(kEncryptedDekPrefixSize + enc_dek_size);
+  return util::OkStatus();
+}
+
 }  // namespace
 
 // static
 util::StatusOr<std::unique_ptr<Aead>> KmsEnvelopeAead::New(
     const google::crypto::tink::KeyTemplate& dek_template,
     std::unique_ptr<Aead> remote_aead) {
+  auto envelope_aead_result = NewWithDekCache(
+      dek_template, std::move(remote_aead), DekCacheOptions());
+  if (!envelope_aead_result.ok()) return envelope_aead_result.status();
+  return std::unique_ptr<Aead>(std::move(envelope_aead_result.ValueOrDie()));
+}
+
+// static
+util::StatusOr<std::unique_ptr<KmsEnvelopeAead>>
+KmsEnvelopeAead::NewWithDekCache(
+    const google::crypto::tink::KeyTemplate& dek_template,
+    std::unique_ptr<Aead> remote_aead, const DekCacheOptions& options) {
   if (remote_aead == nullptr) {
     return util::Status(util::error::INVALID_ARGUMENT,
                         "remote_aead must be non-null");
   }
+  if (options.max_encryptions_per_dek < 1 ||
+      options.max_dek_age <= absl::ZeroDuration() ||
+      options.max_cached_decryption_deks < 0 ||
+      options.max_concurrent_remote_calls < 0) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "invalid DEK cache options");
+  }
   auto km_result = Registry::get_key_manager<Aead>(dek_template.type_url());
   if (!km_result.ok()) return km_result.status();
-  std::unique_ptr<Aead> envelope_aead(
-      new KmsEnvelopeAead(dek_template, std::move(remote_aead)));
-  return std::move(envelope_aead);
+  return {absl::WrapUnique(
+      new KmsEnvelopeAead(dek_template, std::move(remote_aead), options))};
 }
 
-util::StatusOr<std::string> KmsEnvelopeAead::Encrypt(
-    absl::string_view plaintext, absl::string_view associated_data) const {
+KmsEnvelopeAead::DekCacheStats KmsEnvelopeAead::GetDekCacheStats() const {
+  DekCacheStats stats;
+  stats.remote_encrypt_calls =
+      stats_.remote_encrypt_calls.load(std::memory_order_relaxed);
+  stats.remote_decrypt_calls =
+      stats_.remote_decrypt_calls.load(std::memory_order_relaxed);
+  stats.encryption_dek_reuses =
+      stats_.encryption_dek_reuses.load(std::memory_order_relaxed);
+  stats.decryption_cache_hits =
+      stats_.decryption_cache_hits.load(std::memory_order_relaxed);
+  stats.coalesced_decryptions =
+      stats_.coalesced_decryptions.load(std::memory_order_relaxed);
+  stats.throttled_remote_calls =
+      stats_.throttled_remote_calls.load(std::memory_order_relaxed);
+  return stats;
+}
+
+util::StatusOr<std::shared_ptr<const KmsEnvelopeAead::WrappedDek>>
+KmsEnvelopeAead::NewWrappedDek() const {
   // Generate DEK.
   auto dek_result = Registry::NewKeyData(dek_template_);
   if (!dek_result.ok()) return dek_result.status();
   auto dek = std::move(dek_result.ValueOrDie());
 
   // Wrap DEK key values with remote.
+  internal::TracingSpan span("tink.kms_envelope_aead.wrap_dek");
+  span.AddBytes(dek->value().size());
+  StartRemoteCall();
   auto dek_encrypt_result =
       remote_aead_->Encrypt(dek->value(), kEmptyAssociatedData);
-  if (!dek_encrypt_result.ok()) return dek_encrypt_result.status();
+  FinishRemoteCall();
+  stats_.remote_encrypt_calls.fetch_add(1, std::memory_order_relaxed);
+  if (!dek_encrypt_result.ok()) {
+    span.SetOk(false);
+    return dek_encrypt_result.status();
+  }
 
-  // Encrypt plaintext using DEK.
   auto aead_result = Registry::GetPrimitive<Aead>(*dek);
   if (!aead_result.ok()) return aead_result.status();
-  auto aead = std::move(aead_result.ValueOrDie());
-  auto encrypt_result = aead->Encrypt(plaintext, associated_data);
-  if (!encrypt_result.ok()) return encrypt_result.status();
-
-  // Build and return ciphertext.
-  return GetEnvelopeCiphertext(dek_encrypt_result.ValueOrDie(),
-                               encrypt_result.ValueOrDie());
+  auto wrapped_dek = std::make_shared<WrappedDek>();
+  wrapped_dek->encrypted_dek = std::move(dek_encrypt_result.ValueOrDie());
+  wrapped_dek->aead = std::move(aead_result.ValueOrDie());
+  return std::shared_ptr<const WrappedDek>(std::move(wrapped_dek));
 }
 
-util::StatusOr<std::string> KmsEnvelopeAead::Decrypt(
-    absl::string_view ciphertext, absl::string_view associated_data) const {
-  // Parse the ciphertext.
-  if (ciphertext.size() < kEncryptedDekPrefixSize) {
-    return util::Status(util::error::INVALID_ARGUMENT, "ciphertext too short");
+util::StatusOr<std::shared_ptr<const KmsEnvelopeAead::WrappedDek>>
+KmsEnvelopeAead::GetEncryptionDek() const {
+  bool reuse_deks = options_.max_encryptions_per_dek > 1;
+  if (reuse_deks) {
+    absl::MutexLock lock(&mutex_);
+    if (encryption_dek_ != nullptr &&
+        encryption_dek_uses_ < options_.max_encryptions_per_dek &&
+        absl::Now() < encryption_dek_expiration_) {
+      encryption_dek_uses_++;
+      stats_.encryption_dek_reuses.fetch_add(1, std::memory_order_relaxed);
+      return encryption_dek_;
+    }
   }
-  auto enc_dek_size = absl::big_endian::Load32(
-      reinterpret_cast<const uint8_t*>(ciphertext.data()));
-  if (enc_dek_size > ciphertext.size() - kEncryptedDekPrefixSize ||
-      enc_dek_size < 0) {
-    return util::Status(util::error::INVALID_ARGUMENT, "invalid ciphertext");
+  // The remote call is done without holding the lock; concurrent callers
+  // may thus each create a DEK, of which the last one is kept.
+  auto wrapped_dek_result = NewWrappedDek();
+  if (!wrapped_dek_result.ok()) return wrapped_dek_result.status();
+  if (reuse_deks) {
+    absl::MutexLock lock(&mutex_);
+    encryption_dek_ = wrapped_dek_result.ValueOrDie();
+    encryption_dek_uses_ = 1;
+    encryption_dek_expiration_ = absl::Now() + options_.max_dek_age;
   }
+  return wrapped_dek_result;
+}
+
+std::shared_ptr<const Aead> KmsEnvelopeAead::FindCachedDecryptionAead(
+    const std::string& encrypted_dek) const {
+  auto it = decryption_deks_.find(encrypted_dek);
+  if (it == decryption_deks_.end()) return nullptr;
+  stats_.decryption_cache_hits.fetch_add(1, std::memory_order_relaxed);
+  decryption_dek_lru_.splice(decryption_dek_lru_.begin(), decryption_dek_lru_,
+                             it->second.lru_position);
+  return it->second.aead;
+}
+
+util::StatusOr<std::shared_ptr<const Aead>> KmsEnvelopeAead::UnwrapDek(
+    absl::string_view encrypted_dek) const {
   // Decrypt the DEK with remote.
-  auto dek_decrypt_result = remote_aead_->Decrypt(
-      ciphertext.substr(kEncryptedDekPrefixSize, enc_dek_size),
-      kEmptyAssociatedData);
+  internal::TracingSpan span("tink.kms_envelope_aead.unwrap_dek");
+  span.AddBytes(encrypted_dek.size());
+  auto dek_decrypt_result =
+      remote_aead_->Decrypt(encrypted_dek, kEmptyAssociatedData);
+  stats_.remote_decrypt_calls.fetch_add(1, std::memory_order_relaxed);
   if (!dek_decrypt_result.ok()) {
+    span.SetOk(false);
     return util::Status(
         util::error::INVALID_ARGUMENT,
         absl::StrCat("invalid ciphertext: ",
@@ -117,14 +213,218 @@ util::StatusOr<std::string> KmsEnvelopeAead::Decrypt(
   dek.set_type_url(dek_template_.type_url());
   dek.set_value(dek_decrypt_result.ValueOrDie());
   dek.set_key_material_type(google::crypto::tink::KeyData::SYMMETRIC);
+  auto aead_result = Registry::GetPrimitive<Aead>(dek);
+  if (!aead_result.ok()) return aead_result.status();
+  return std::shared_ptr<const Aead>(std::move(aead_result.ValueOrDie()));
+}
+
+void KmsEnvelopeAead::StartRemoteCall() const {
+  // Without a limit, calls are neither counted nor queued.
+  if (options_.max_concurrent_remote_calls == 0) return;
+  absl::MutexLock lock(&mutex_);
+  if (!CanStartRemoteCall()) {
+    stats_.throttled_remote_calls.fetch_add(1, std::memory_order_relaxed);
+    mutex_.Await(absl::Condition(this, &KmsEnvelopeAead::CanStartRemoteCall));
+  }
+  running_remote_calls_++;
+}
+
+void KmsEnvelopeAead::FinishRemoteCall() const {
+  if (options_.max_concurrent_remote_calls == 0) return;
+  std::function<void()> next_call;
+  {
+    absl::MutexLock lock(&mutex_);
+    running_remote_calls_--;
+    if (queued_remote_calls_.empty()) return;
+    // The queued call takes over the slot of the finished one.
+    next_call = std::move(queued_remote_calls_.front());
+    queued_remote_calls_.pop_front();
+    running_remote_calls_++;
+  }
+  if (options_.schedule) {
+    options_.schedule(std::move(next_call));
+  } else {
+    next_call();
+  }
+}
+
+void KmsEnvelopeAead::ScheduleRemoteCall(std::function<void()> call) const {
+  if (options_.max_concurrent_remote_calls > 0) {
+    absl::MutexLock lock(&mutex_);
+    if (!CanStartRemoteCall()) {
+      stats_.throttled_remote_calls.fetch_add(1, std::memory_order_relaxed);
+      queued_remote_calls_.push_back(std::move(call));
+      return;
+    }
+    running_remote_calls_++;
+  }
+  if (options_.schedule) {
+    options_.schedule(std::move(call));
+  } else {
+    call();
+  }
+}
+
+void KmsEnvelopeAead::FinishUnwrap(
+    const std::string& encrypted_dek,
+    const std::shared_ptr<PendingUnwrap>& pending,
+    const util::StatusOr<std::shared_ptr<const Aead>>& result) const {
+  std::vector<AeadCallback> callbacks;
+  {
+    absl::MutexLock lock(&mutex_);
+    pending_unwraps_.erase(encrypted_dek);
+    pending->result = result;
+    pending->done = true;
+    callbacks.swap(pending->callbacks);
+    // DEKs that fail to unwrap are not cached. Since concurrent decryptions
+    // of the same DEK are coalesced, the DEK cannot be in the cache yet.
+    if (result.ok() && options_.max_cached_decryption_deks > 0) {
+      while (decryption_deks_.size() >=
+             static_cast<size_t>(options_.max_cached_decryption_deks)) {
+        decryption_deks_.erase(decryption_dek_lru_.back());
+        decryption_dek_lru_.pop_back();
+      }
+      decryption_dek_lru_.push_front(encrypted_dek);
+      decryption_deks_[encrypted_dek] = {result.ValueOrDie(),
+                                         decryption_dek_lru_.begin()};
+    }
+  }
+  for (const auto& callback : callbacks) callback(result);
+}
+
+util::StatusOr<std::shared_ptr<const Aead>> KmsEnvelopeAead::GetDecryptionAead(
+    absl::string_view encrypted_dek) const {
+  if (options_.max_cached_decryption_deks == 0 && !options_.schedule) {
+    // Nothing is cached, so coalescing only saves the remote calls of
+    // decryptions which overlap exactly; it is not worth copying the
+    // encrypted DEK and taking the lock on every call.
+    StartRemoteCall();
+    auto result = UnwrapDek(encrypted_dek);
+    FinishRemoteCall();
+    return result;
+  }
+  std::string key(encrypted_dek);
+  std::shared_ptr<PendingUnwrap> pending;
+  {
+    absl::MutexLock lock(&mutex_);
+    auto aead = FindCachedDecryptionAead(key);
+    if (aead != nullptr) return aead;
+    auto it = pending_unwraps_.find(key);
+    if (it != pending_unwraps_.end()) {
+      // Wait for the concurrent remote call for the same DEK.
+      pending = it->second;
+      stats_.coalesced_decryptions.fetch_add(1, std::memory_order_relaxed);
+      mutex_.Await(absl::Condition(&pending->done));
+      return pending->result;
+    }
+    pending = std::make_shared<PendingUnwrap>();
+    pending_unwraps_[key] = pending;
+  }
+  StartRemoteCall();
+  auto result = UnwrapDek(encrypted_dek);
+  FinishRemoteCall();
+  FinishUnwrap(key, pending, result);
+  return result;
+}
+
+void KmsEnvelopeAead::GetDecryptionAeadAsync(absl::string_view encrypted_dek,
+                                             AeadCallback done) const {
+  std::string key(encrypted_dek);
+  std::shared_ptr<PendingUnwrap> pending;
+  std::shared_ptr<const Aead> aead;
+  {
+    absl::MutexLock lock(&mutex_);
+    aead = FindCachedDecryptionAead(key);
+    if (aead == nullptr) {
+      auto it = pending_unwraps_.find(key);
+      if (it != pending_unwraps_.end()) {
+        stats_.coalesced_decryptions.fetch_add(1, std::memory_order_relaxed);
+        it->second->callbacks.push_back(std::move(done));
+        return;
+      }
+      pending = std::make_shared<PendingUnwrap>();
+      pending->callbacks.push_back(std::move(done));
+      pending_unwraps_[key] = pending;
+    }
+  }
+  if (aead != nullptr) {
+    done(aead);
+    return;
+  }
+  ScheduleRemoteCall([this, key, pending]() {
+    auto result = UnwrapDek(key);
+    FinishRemoteCall();
+    FinishUnwrap(key, pending, result);
+  });
+}
+
+util::StatusOr<std::string> KmsEnvelopeAead::Encrypt(
+    absl::string_view plaintext, absl::string_view associated_data) const {
+  auto dek_result = GetEncryptionDek();
+  if (!dek_result.ok()) return dek_result.status();
+  auto dek = std::move(dek_result.ValueOrDie());
 
   // Encrypt plaintext using DEK.
-  auto aead_result = Registry::GetPrimitive<Aead>(dek);
+  auto encrypt_result = dek->aead->Encrypt(plaintext, associated_data);
+  if (!encrypt_result.ok()) return encrypt_result.status();
+
+  // Build and return ciphertext.
+  return GetEnvelopeCiphertext(dek->encrypted_dek,
+                               encrypt_result.ValueOrDie());
+}
+
+util::StatusOr<std::string> KmsEnvelopeAead::Decrypt(
+    absl::string_view ciphertext, absl::string_view associated_data) const {
+  absl::string_view encrypted_dek, payload;
+  auto parse_status =
+      ParseEnvelopeCiphertext(ciphertext, &encrypted_dek, &payload);
+  if (!parse_status.ok()) return parse_status;
+  auto aead_result = GetDecryptionAead(encrypted_dek);
   if (!aead_result.ok()) return aead_result.status();
   auto aead = std::move(aead_result.ValueOrDie());
-  return aead->Decrypt(
-      ciphertext.substr(kEncryptedDekPrefixSize + enc_dek_size),
-      associated_data);
+
+  // Decrypt ciphertext using DEK.
+  return aead->Decrypt(payload, associated_data);
+}
+
+void KmsEnvelopeAead::EncryptAsync(
+    absl::string_view plaintext, absl::string_view associated_data,
+    std::function<void(util::StatusOr<std::string>)> done) const {
+  if (!options_.schedule) {
+    done(Encrypt(plaintext, associated_data));
+    return;
+  }
+  // The views may dangle once this returns, so the task owns copies.
+  std::string plaintext_copy(plaintext);
+  std::string associated_data_copy(associated_data);
+  options_.schedule([this, plaintext_copy, associated_data_copy, done]() {
+    done(Encrypt(plaintext_copy, associated_data_copy));
+  });
+}
+
+void KmsEnvelopeAead::DecryptAsync(
+    absl::string_view ciphertext, absl::string_view associated_data,
+    std::function<void(util::StatusOr<std::string>)> done) const {
+  absl::string_view encrypted_dek, payload;
+  auto parse_status =
+      ParseEnvelopeCiphertext(ciphertext, &encrypted_dek, &payload);
+  if (!parse_status.ok()) {
+    done(parse_status);
+    return;
+  }
+  std::string payload_copy(payload);
+  std::string associated_data_copy(associated_data);
+  GetDecryptionAeadAsync(
+      encrypted_dek,
+      [payload_copy, associated_data_copy, done](
+          const util::StatusOr<std::shared_ptr<const Aead>>& aead_result) {
+        if (!aead_result.ok()) {
+          done(aead_result.status());
+          return;
+        }
+        done(aead_result.ValueOrDie()->Decrypt(payload_copy,
+                                               associated_data_copy));
+      });
 }
 
 }  // namespace tink
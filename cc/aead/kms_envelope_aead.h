@@ -15,9 +15,19 @@
 #ifndef TINK_AEAD_KMS_ENVELOPE_AEAD_H_
 #define TINK_AEAD_KMS_ENVELOPE_AEAD_H_
 
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <list>
 #include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
+#include "absl/base/thread_annotations.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
 #include "tink/aead.h"
 #include "tink/util/status.h"
 #include "tink/util/statusor.h"
@@ -40,12 +50,71 @@ namespace tink {
 //  - Encrypted DEK: variable length that is equal to the value
 //    specified in the last 4 bytes.
 //  - AEAD payload: variable length.
+//
+// By default every message is encrypted with a fresh DEK, which costs a
+// remote call per Encrypt() and per Decrypt(). NewWithDekCache() allows to
+// reuse a DEK for several messages and to cache unwrapped DEKs for
+// decryption; the ciphertext format is the same in both cases. Concurrent
+// decryptions of messages with the same encrypted DEK share one remote call,
+// unless neither a DEK cache nor a schedule is configured, in which case
+// Decrypt() calls the remote AEAD directly.
 class KmsEnvelopeAead : public Aead {
  public:
   static crypto::tink::util::StatusOr<std::unique_ptr<Aead>> New(
       const google::crypto::tink::KeyTemplate& dek_template,
       std::unique_ptr<Aead> remote_aead);
 
+  // Options for reusing DEKs, see NewWithDekCache().
+  struct DekCacheOptions {
+    // The maximal number of messages encrypted with the same DEK. 1 means
+    // that every message is encrypted with a fresh DEK. Note that the DEK
+    // primitive bounds the number of messages that can safely be encrypted
+    // with a single key (e.g. 2^32 for AES-GCM with random nonces).
+    int64_t max_encryptions_per_dek = 1;
+    // The maximal time for which a DEK is used for encryption after it has
+    // been generated.
+    absl::Duration max_dek_age = absl::InfiniteDuration();
+    // The maximal number of unwrapped DEKs kept for decryption, keyed by the
+    // encrypted DEK. 0 disables the cache.
+    int max_cached_decryption_deks = 0;
+    // Runs the remote calls of EncryptAsync() and DecryptAsync(), e.g. by
+    // passing them to a thread pool. If unset, these calls are done by the
+    // calling thread.
+    std::function<void(std::function<void()>)> schedule;
+    // The maximal number of remote calls in progress at the same time, e.g.
+    // to stay below the rate limit of the KMS when many decryptions start at
+    // once. Further synchronous calls block until a call finishes, and the
+    // remote calls of DecryptAsync() are queued. 0 means no limit.
+    int max_concurrent_remote_calls = 0;
+  };
+
+  // Like New(), but reuses DEKs as configured by 'options'.
+  static crypto::tink::util::StatusOr<std::unique_ptr<KmsEnvelopeAead>>
+  NewWithDekCache(const google::crypto::tink::KeyTemplate& dek_template,
+                  std::unique_ptr<Aead> remote_aead,
+                  const DekCacheOptions& options);
+
+  // Statistics of the remote calls and of the DEK reuse.
+  struct DekCacheStats {
+    // The number of DEKs wrapped by the remote AEAD.
+    int64_t remote_encrypt_calls = 0;
+    // The number of DEKs unwrapped by the remote AEAD.
+    int64_t remote_decrypt_calls = 0;
+    // The number of encryptions which reused an already wrapped DEK.
+    int64_t encryption_dek_reuses = 0;
+    // The number of decryptions which found the DEK in the cache.
+    int64_t decryption_cache_hits = 0;
+    // The number of decryptions which used the result of a concurrent remote
+    // call for the same encrypted DEK.
+    int64_t coalesced_decryptions = 0;
+    // The number of remote calls which had to wait because
+    // max_concurrent_remote_calls were in progress.
+    int64_t throttled_remote_calls = 0;
+  };
+
+  // Returns the statistics accumulated since construction.
+  DekCacheStats GetDekCacheStats() const;
+
   crypto::tink::util::StatusOr<std::string> Encrypt(
       absl::string_view plaintext,
       absl::string_view associated_data) const override;
@@ -54,15 +123,141 @@ class KmsEnvelopeAead : public Aead {
       absl::string_view ciphertext,
       absl::string_view associated_data) const override;
 
+  // Asynchronous variants of Encrypt() and Decrypt(), which call 'done'
+  // with the result, possibly before they return. A decryption waiting for a
+  // concurrent remote call for the same encrypted DEK does not occupy a
+  // thread. This object must outlive all pending calls.
+  void EncryptAsync(
+      absl::string_view plaintext, absl::string_view associated_data,
+      std::function<void(crypto::tink::util::StatusOr<std::string>)> done)
+      const;
+  void DecryptAsync(
+      absl::string_view ciphertext, absl::string_view associated_data,
+      std::function<void(crypto::tink::util::StatusOr<std::string>)> done)
+      const;
+
   ~KmsEnvelopeAead() override {}
 
  private:
+  // A DEK together with its encryption by the remote AEAD.
+  struct WrappedDek {
+    std::string encrypted_dek;
+    std::unique_ptr<Aead> aead;
+  };
+
+  using AeadCallback = std::function<void(
+      const crypto::tink::util::StatusOr<std::shared_ptr<const Aead>>&)>;
+
+  // A remote call unwrapping a DEK which has not finished yet. The fields are
+  // guarded by mutex_.
+  struct PendingUnwrap {
+    bool done = false;
+    crypto::tink::util::StatusOr<std::shared_ptr<const Aead>> result;
+    // Called with the result once the remote call finishes.
+    std::vector<AeadCallback> callbacks;
+  };
+
   KmsEnvelopeAead(const google::crypto::tink::KeyTemplate& dek_template,
-                  std::unique_ptr<Aead> remote_aead) :
-      dek_template_(dek_template), remote_aead_(std::move(remote_aead)) {}
+                  std::unique_ptr<Aead> remote_aead,
+                  const DekCacheOptions& options)
+      : dek_template_(dek_template),
+        remote_aead_(std::move(remote_aead)),
+        options_(options) {}
+
+  // Generates a new DEK and wraps it with the remote AEAD.
+  crypto::tink::util::StatusOr<std::shared_ptr<const WrappedDek>>
+  NewWrappedDek() const;
+
+  // Returns the DEK to use for the next encryption, which is either the
+  // current DEK or a new one if the current one is used up.
+  crypto::tink::util::StatusOr<std::shared_ptr<const WrappedDek>>
+  GetEncryptionDek() const;
+
+  // Returns the AEAD for the DEK encrypted as 'encrypted_dek', either from
+  // the cache or by unwrapping it with the remote AEAD.
+  crypto::tink::util::StatusOr<std::shared_ptr<const Aead>> GetDecryptionAead(
+      absl::string_view encrypted_dek) const;
+
+  // Like GetDecryptionAead(), but calls 'done' with the result. The remote
+  // call, if any, runs on options_.schedule.
+  void GetDecryptionAeadAsync(absl::string_view encrypted_dek,
+                              AeadCallback done) const;
+
+  // Returns the cached AEAD for 'encrypted_dek', or nullptr.
+  std::shared_ptr<const Aead> FindCachedDecryptionAead(
+      const std::string& encrypted_dek) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Unwraps 'encrypted_dek' with the remote AEAD.
+  crypto::tink::util::StatusOr<std::shared_ptr<const Aead>> UnwrapDek(
+      absl::string_view encrypted_dek) const;
+
+  // Blocks until a remote call may start without exceeding
+  // options_.max_concurrent_remote_calls, and counts it as in progress. Does
+  // nothing if there is no limit.
+  void StartRemoteCall() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Counts a remote call as finished, and starts the next queued one, if any.
+  void FinishRemoteCall() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Runs 'call', which makes a remote call, on options_.schedule once the
+  // limit of concurrent remote calls allows it, without blocking. 'call' must
+  // call FinishRemoteCall() when its remote call returns.
+  void ScheduleRemoteCall(std::function<void()> call) const
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  bool CanStartRemoteCall() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    return options_.max_concurrent_remote_calls == 0 ||
+           running_remote_calls_ < options_.max_concurrent_remote_calls;
+  }
+
+  // Publishes the result of the remote call for 'encrypted_dek' to the cache
+  // and to all callers waiting on 'pending'.
+  void FinishUnwrap(
+      const std::string& encrypted_dek,
+      const std::shared_ptr<PendingUnwrap>& pending,
+      const crypto::tink::util::StatusOr<std::shared_ptr<const Aead>>& result)
+      const;
 
   google::crypto::tink::KeyTemplate dek_template_;
   std::unique_ptr<Aead> remote_aead_;
+  const DekCacheOptions options_;
+
+  mutable absl::Mutex mutex_;
+  // The DEK currently used for encryption, if any.
+  mutable std::shared_ptr<const WrappedDek> encryption_dek_
+      ABSL_GUARDED_BY(mutex_);
+  mutable int64_t encryption_dek_uses_ ABSL_GUARDED_BY(mutex_) = 0;
+  mutable absl::Time encryption_dek_expiration_ ABSL_GUARDED_BY(mutex_);
+  // The cache of unwrapped DEKs, keyed by the encrypted DEK.
+  struct CachedDek {
+    std::shared_ptr<const Aead> aead;
+    // The position of the encrypted DEK in decryption_dek_lru_.
+    std::list<std::string>::iterator lru_position;
+  };
+  mutable std::unordered_map<std::string, CachedDek> decryption_deks_
+      ABSL_GUARDED_BY(mutex_);
+  // Encrypted DEKs in the cache, most recently used first.
+  mutable std::list<std::string> decryption_dek_lru_ ABSL_GUARDED_BY(mutex_);
+  // Remote calls unwrapping DEKs in progress, keyed by the encrypted DEK.
+  mutable std::unordered_map<std::string, std::shared_ptr<PendingUnwrap>>
+      pending_unwraps_ ABSL_GUARDED_BY(mutex_);
+  // Counters of DekCacheStats. They are updated with relaxed atomics, so
+  // that counting does not need mutex_; GetDekCacheStats() thus reads each
+  // counter separately, not a consistent snapshot of all of them.
+  struct AtomicDekCacheStats {
+    std::atomic<int64_t> remote_encrypt_calls{0};
+    std::atomic<int64_t> remote_decrypt_calls{0};
+    std::atomic<int64_t> encryption_dek_reuses{0};
+    std::atomic<int64_t> decryption_cache_hits{0};
+    std::atomic<int64_t> coalesced_decryptions{0};
+    std::atomic<int64_t> throttled_remote_calls{0};
+  };
+  mutable AtomicDekCacheStats stats_;
+  mutable int running_remote_calls_ ABSL_GUARDED_BY(mutex_) = 0;
+  // Remote calls of ScheduleRemoteCall() waiting for a free slot.
+  mutable std::deque<std::function<void()>> queued_remote_calls_
+      ABSL_GUARDED_BY(mutex_);
 };
 
 }  // namespace tink
@@ -14,13 +14,19 @@
 
 #include "tink/aead/kms_envelope_aead.h"
 
+#include <functional>
 #include <string>
+#include <thread>  // NOLINT(build/c++11)
 #include <vector>
 
 #include "gtest/gtest.h"
 #include "absl/base/internal/endian.h"
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "tink/aead/aead_config.h"
 #include "tink/aead/aead_key_templates.h"
 #include "tink/mac/mac_key_templates.h"
@@ -40,6 +46,33 @@ using crypto::tink::test::IsOk;
 using crypto::tink::test::StatusIs;
 using testing::HasSubstr;
 
+// A remote AEAD whose Decrypt() blocks until Release() is called.
+class BlockingAead : public Aead {
+ public:
+  explicit BlockingAead(absl::string_view aead_name) : aead_(aead_name) {}
+
+  util::StatusOr<std::string> Encrypt(
+      absl::string_view plaintext,
+      absl::string_view associated_data) const override {
+    return aead_.Encrypt(plaintext, associated_data);
+  }
+
+  util::StatusOr<std::string> Decrypt(
+      absl::string_view ciphertext,
+      absl::string_view associated_data) const override {
+    if (!entered_.HasBeenNotified()) entered_.Notify();
+    released_.WaitForNotification();
+    return aead_.Decrypt(ciphertext, associated_data);
+  }
+
+  void WaitUntilEntered() const { entered_.WaitForNotification(); }
+  void Release() { released_.Notify(); }
+
+ private:
+  DummyAead aead_;
+  mutable absl::Notification entered_;
+  absl::Notification released_;
+};
 
 TEST(KmsEnvelopeAeadTest, BasicEncryptDecrypt) {
   EXPECT_THAT(AeadConfig::Register(), IsOk());
@@ -167,6 +200,330 @@ TEST(KmsEnvelopeAeadTest, KeyFormat) {
   EXPECT_THAT(key.key_value().size(), testing::Eq(16));
 }
 
+// Returns the encrypted DEK contained in the envelope ciphertext 'ct'.
+std::string GetEncryptedDek(absl::string_view ct) {
+  auto enc_dek_size =
+      absl::big_endian::Load32(reinterpret_cast<const uint8_t*>(ct.data()));
+  return std::string(ct.substr(4, enc_dek_size));
+}
+
+TEST(KmsEnvelopeAeadTest, DekReuse) {
+  EXPECT_THAT(AeadConfig::Register(), IsOk());
+  auto dek_template = AeadKeyTemplates::Aes128Gcm();
+  std::string remote_aead_name = "kms-backed-aead";
+  KmsEnvelopeAead::DekCacheOptions options;
+  options.max_encryptions_per_dek = 3;
+  auto aead_result = KmsEnvelopeAead::NewWithDekCache(
+      dek_template, absl::make_unique<DummyAead>(remote_aead_name), options);
+  ASSERT_THAT(aead_result.status(), IsOk());
+  auto aead = std::move(aead_result.ValueOrDie());
+
+  // Ciphertexts must stay decryptable without any DEK cache.
+  auto plain_aead_result = KmsEnvelopeAead::New(
+      dek_template, absl::make_unique<DummyAead>(remote_aead_name));
+  ASSERT_THAT(plain_aead_result.status(), IsOk());
+  auto plain_aead = std::move(plain_aead_result.ValueOrDie());
+
+  std::string aad = "Some data to authenticate.";
+  std::vector<std::string> ciphertexts;
+  for (int i = 0; i < 7; i++) {
+    std::string message = absl::StrCat("Some data to encrypt: ", i);
+    auto encrypt_result = aead->Encrypt(message, aad);
+    ASSERT_THAT(encrypt_result.status(), IsOk());
+    ciphertexts.push_back(encrypt_result.ValueOrDie());
+    auto decrypt_result = plain_aead->Decrypt(ciphertexts.back(), aad);
+    ASSERT_THAT(decrypt_result.status(), IsOk());
+    EXPECT_EQ(decrypt_result.ValueOrDie(), message);
+  }
+  EXPECT_EQ(GetEncryptedDek(ciphertexts[0]), GetEncryptedDek(ciphertexts[2]));
+  EXPECT_NE(GetEncryptedDek(ciphertexts[2]), GetEncryptedDek(ciphertexts[3]));
+  EXPECT_EQ(GetEncryptedDek(ciphertexts[3]), GetEncryptedDek(ciphertexts[5]));
+  EXPECT_NE(GetEncryptedDek(ciphertexts[5]), GetEncryptedDek(ciphertexts[6]));
+  // Reusing a DEK must not reuse the nonce.
+  EXPECT_NE(ciphertexts[0], ciphertexts[1]);
+
+  auto stats = aead->GetDekCacheStats();
+  EXPECT_EQ(stats.remote_encrypt_calls, 3);
+  EXPECT_EQ(stats.encryption_dek_reuses, 4);
+  EXPECT_EQ(stats.remote_decrypt_calls, 0);
+}
+
+TEST(KmsEnvelopeAeadTest, DekReuseExpires) {
+  EXPECT_THAT(AeadConfig::Register(), IsOk());
+  KmsEnvelopeAead::DekCacheOptions options;
+  options.max_encryptions_per_dek = 1000;
+  options.max_dek_age = absl::Milliseconds(1);
+  auto aead_result = KmsEnvelopeAead::NewWithDekCache(
+      AeadKeyTemplates::Aes128Gcm(),
+      absl::make_unique<DummyAead>("kms-backed-aead"), options);
+  ASSERT_THAT(aead_result.status(), IsOk());
+  auto aead = std::move(aead_result.ValueOrDie());
+
+  auto first_result = aead->Encrypt("message", "aad");
+  ASSERT_THAT(first_result.status(), IsOk());
+  absl::SleepFor(absl::Milliseconds(5));
+  auto second_result = aead->Encrypt("message", "aad");
+  ASSERT_THAT(second_result.status(), IsOk());
+  EXPECT_NE(GetEncryptedDek(first_result.ValueOrDie()),
+            GetEncryptedDek(second_result.ValueOrDie()));
+  EXPECT_EQ(aead->GetDekCacheStats().remote_encrypt_calls, 2);
+  EXPECT_EQ(aead->GetDekCacheStats().encryption_dek_reuses, 0);
+}
+
+TEST(KmsEnvelopeAeadTest, DecryptionDekCache) {
+  EXPECT_THAT(AeadConfig::Register(), IsOk());
+  auto dek_template = AeadKeyTemplates::Aes128Gcm();
+  std::string remote_aead_name = "kms-backed-aead";
+  KmsEnvelopeAead::DekCacheOptions options;
+  options.max_cached_decryption_deks = 2;
+  auto aead_result = KmsEnvelopeAead::NewWithDekCache(
+      dek_template, absl::make_unique<DummyAead>(remote_aead_name), options);
+  ASSERT_THAT(aead_result.status(), IsOk());
+  auto aead = std::move(aead_result.ValueOrDie());
+
+  // Each ciphertext uses its own DEK.
+  std::string aad = "Some data to authenticate.";
+  std::vector<std::string> ciphertexts;
+  for (int i = 0; i < 3; i++) {
+    auto encrypt_result = aead->Encrypt(absl::StrCat("message ", i), aad);
+    ASSERT_THAT(encrypt_result.status(), IsOk());
+    ciphertexts.push_back(encrypt_result.ValueOrDie());
+  }
+  EXPECT_EQ(aead->GetDekCacheStats().remote_encrypt_calls, 3);
+
+  auto expect_decryption = [&](int i) {
+    auto decrypt_result = aead->Decrypt(ciphertexts[i], aad);
+    ASSERT_THAT(decrypt_result.status(), IsOk());
+    EXPECT_EQ(decrypt_result.ValueOrDie(), absl::StrCat("message ", i));
+  };
+  expect_decryption(0);
+  expect_decryption(0);
+  expect_decryption(1);
+  expect_decryption(0);
+  auto stats = aead->GetDekCacheStats();
+  EXPECT_EQ(stats.remote_decrypt_calls, 2);
+  EXPECT_EQ(stats.decryption_cache_hits, 2);
+
+  // Evicts the DEK of ciphertexts[1], the least recently used one.
+  expect_decryption(2);
+  expect_decryption(0);
+  expect_decryption(1);
+  stats = aead->GetDekCacheStats();
+  EXPECT_EQ(stats.remote_decrypt_calls, 4);
+  EXPECT_EQ(stats.decryption_cache_hits, 3);
+
+  // A cached DEK must still authenticate the payload.
+  EXPECT_THAT(aead->Decrypt(ciphertexts[1], "wrong aad").status(),
+              StatusIs(util::error::INTERNAL));
+
+  // DEKs that fail to unwrap are not cached.
+  std::string corrupted = ciphertexts[0];
+  corrupted[4] = 'a';
+  EXPECT_THAT(aead->Decrypt(corrupted, aad).status(),
+              StatusIs(util::error::INVALID_ARGUMENT, HasSubstr("invalid")));
+  EXPECT_THAT(aead->Decrypt(corrupted, aad).status(),
+              StatusIs(util::error::INVALID_ARGUMENT, HasSubstr("invalid")));
+  EXPECT_EQ(aead->GetDekCacheStats().remote_decrypt_calls, 6);
+}
+
+TEST(KmsEnvelopeAeadTest, InvalidDekCacheOptions) {
+  EXPECT_THAT(AeadConfig::Register(), IsOk());
+  auto dek_template = AeadKeyTemplates::Aes128Gcm();
+  std::vector<KmsEnvelopeAead::DekCacheOptions> invalid_options(4);
+  invalid_options[0].max_encryptions_per_dek = 0;
+  invalid_options[1].max_dek_age = absl::ZeroDuration();
+  invalid_options[2].max_cached_decryption_deks = -1;
+  invalid_options[3].max_concurrent_remote_calls = -1;
+  for (const auto& options : invalid_options) {
+    EXPECT_THAT(KmsEnvelopeAead::NewWithDekCache(
+                    dek_template,
+                    absl::make_unique<DummyAead>("kms-backed-aead"), options)
+                    .status(),
+                StatusIs(util::error::INVALID_ARGUMENT,
+                         HasSubstr("DEK cache options")));
+  }
+}
+
+TEST(KmsEnvelopeAeadTest, AsyncEncryptDecrypt) {
+  EXPECT_THAT(AeadConfig::Register(), IsOk());
+  auto dek_template = AeadKeyTemplates::Aes128Gcm();
+  std::vector<std::function<void()>> tasks;
+  KmsEnvelopeAead::DekCacheOptions options;
+  options.schedule = [&tasks](std::function<void()> task) {
+    tasks.push_back(std::move(task));
+  };
+  auto aead_result = KmsEnvelopeAead::NewWithDekCache(
+      dek_template, absl::make_unique<DummyAead>("kms-backed-aead"), options);
+  ASSERT_THAT(aead_result.status(), IsOk());
+  auto aead = std::move(aead_result.ValueOrDie());
+  std::string message = "Some data to encrypt.";
+  std::string aad = "Some data to authenticate.";
+
+  util::StatusOr<std::string> encrypt_result;
+  aead->EncryptAsync(message, aad, [&](util::StatusOr<std::string> result) {
+    encrypt_result = std::move(result);
+  });
+  ASSERT_EQ(tasks.size(), 1);
+  tasks[0]();
+  tasks.clear();
+  ASSERT_THAT(encrypt_result.status(), IsOk());
+  std::string ciphertext = encrypt_result.ValueOrDie();
+
+  // Concurrent decryptions with the same DEK share one remote call.
+  std::vector<util::StatusOr<std::string>> decrypt_results;
+  for (int i = 0; i < 3; i++) {
+    aead->DecryptAsync(ciphertext, aad,
+                       [&](util::StatusOr<std::string> result) {
+                         decrypt_results.push_back(std::move(result));
+                       });
+  }
+  ASSERT_EQ(tasks.size(), 1);
+  EXPECT_TRUE(decrypt_results.empty());
+  tasks[0]();
+  tasks.clear();
+  ASSERT_EQ(decrypt_results.size(), 3);
+  for (const auto& decrypt_result : decrypt_results) {
+    ASSERT_THAT(decrypt_result.status(), IsOk());
+    EXPECT_EQ(decrypt_result.ValueOrDie(), message);
+  }
+  auto stats = aead->GetDekCacheStats();
+  EXPECT_EQ(stats.remote_decrypt_calls, 1);
+  EXPECT_EQ(stats.coalesced_decryptions, 2);
+
+  // Errors are reported through the callback.
+  util::Status decrypt_status;
+  aead->DecryptAsync("abc", aad, [&](util::StatusOr<std::string> result) {
+    decrypt_status = result.status();
+  });
+  EXPECT_THAT(decrypt_status, StatusIs(util::error::INVALID_ARGUMENT));
+  std::string corrupted = ciphertext;
+  corrupted[4] = 'a';
+  aead->DecryptAsync(corrupted, aad, [&](util::StatusOr<std::string> result) {
+    decrypt_status = result.status();
+  });
+  ASSERT_EQ(tasks.size(), 1);
+  tasks[0]();
+  EXPECT_THAT(decrypt_status, StatusIs(util::error::INVALID_ARGUMENT,
+                                       HasSubstr("invalid ciphertext")));
+}
+
+TEST(KmsEnvelopeAeadTest, AsyncWithoutSchedule) {
+  EXPECT_THAT(AeadConfig::Register(), IsOk());
+  auto dek_template = AeadKeyTemplates::Aes128Gcm();
+  auto aead_result = KmsEnvelopeAead::NewWithDekCache(
+      dek_template, absl::make_unique<DummyAead>("kms-backed-aead"),
+      KmsEnvelopeAead::DekCacheOptions());
+  ASSERT_THAT(aead_result.status(), IsOk());
+  auto aead = std::move(aead_result.ValueOrDie());
+  std::string message = "Some data to encrypt.";
+  std::string aad = "Some data to authenticate.";
+
+  util::StatusOr<std::string> encrypt_result;
+  aead->EncryptAsync(message, aad, [&](util::StatusOr<std::string> result) {
+    encrypt_result = std::move(result);
+  });
+  ASSERT_THAT(encrypt_result.status(), IsOk());
+  util::StatusOr<std::string> decrypt_result;
+  aead->DecryptAsync(encrypt_result.ValueOrDie(), aad,
+                     [&](util::StatusOr<std::string> result) {
+                       decrypt_result = std::move(result);
+                     });
+  ASSERT_THAT(decrypt_result.status(), IsOk());
+  EXPECT_EQ(decrypt_result.ValueOrDie(), message);
+}
+
+TEST(KmsEnvelopeAeadTest, AsyncRemoteCallsAreThrottled) {
+  EXPECT_THAT(AeadConfig::Register(), IsOk());
+  auto dek_template = AeadKeyTemplates::Aes128Gcm();
+  // Without a DEK cache, every ciphertext has its own DEK.
+  auto encrypter_result = KmsEnvelopeAead::New(
+      dek_template, absl::make_unique<DummyAead>("kms-backed-aead"));
+  ASSERT_THAT(encrypter_result.status(), IsOk());
+  auto encrypter = std::move(encrypter_result.ValueOrDie());
+  std::string aad = "Some data to authenticate.";
+  std::vector<std::string> messages = {"first message", "second message",
+                                       "third message"};
+  std::vector<std::string> ciphertexts;
+  for (const auto& message : messages) {
+    auto encrypt_result = encrypter->Encrypt(message, aad);
+    ASSERT_THAT(encrypt_result.status(), IsOk());
+    ciphertexts.push_back(encrypt_result.ValueOrDie());
+  }
+
+  std::vector<std::function<void()>> tasks;
+  KmsEnvelopeAead::DekCacheOptions options;
+  options.schedule = [&tasks](std::function<void()> task) {
+    tasks.push_back(std::move(task));
+  };
+  options.max_concurrent_remote_calls = 1;
+  auto aead_result = KmsEnvelopeAead::NewWithDekCache(
+      dek_template, absl::make_unique<DummyAead>("kms-backed-aead"), options);
+  ASSERT_THAT(aead_result.status(), IsOk());
+  auto aead = std::move(aead_result.ValueOrDie());
+
+  std::vector<util::StatusOr<std::string>> results(ciphertexts.size());
+  for (int i = 0; i < ciphertexts.size(); i++) {
+    aead->DecryptAsync(ciphertexts[i], aad,
+                       [&results, i](util::StatusOr<std::string> result) {
+                         results[i] = std::move(result);
+                       });
+  }
+  // Only one remote call is scheduled at a time, and each finished call
+  // schedules the next one.
+  for (int i = 0; i < ciphertexts.size(); i++) {
+    ASSERT_EQ(tasks.size(), i + 1);
+    // Running the task appends to 'tasks'.
+    auto task = std::move(tasks[i]);
+    task();
+  }
+  ASSERT_EQ(tasks.size(), ciphertexts.size());
+  for (int i = 0; i < ciphertexts.size(); i++) {
+    ASSERT_THAT(results[i].status(), IsOk());
+    EXPECT_EQ(results[i].ValueOrDie(), messages[i]);
+  }
+  auto stats = aead->GetDekCacheStats();
+  EXPECT_EQ(stats.remote_decrypt_calls, 3);
+  EXPECT_EQ(stats.throttled_remote_calls, 2);
+}
+
+TEST(KmsEnvelopeAeadTest, ConcurrentDecryptionsAreCoalesced) {
+  EXPECT_THAT(AeadConfig::Register(), IsOk());
+  auto dek_template = AeadKeyTemplates::Aes128Gcm();
+  auto remote_aead = absl::make_unique<BlockingAead>("kms-backed-aead");
+  BlockingAead* remote = remote_aead.get();
+  // Without a DEK cache or a schedule, decryptions are not coalesced.
+  KmsEnvelopeAead::DekCacheOptions options;
+  options.max_cached_decryption_deks = 1;
+  auto aead_result = KmsEnvelopeAead::NewWithDekCache(
+      dek_template, std::move(remote_aead), options);
+  ASSERT_THAT(aead_result.status(), IsOk());
+  auto aead = std::move(aead_result.ValueOrDie());
+  std::string message = "Some data to encrypt.";
+  std::string aad = "Some data to authenticate.";
+  auto encrypt_result = aead->Encrypt(message, aad);
+  ASSERT_THAT(encrypt_result.status(), IsOk());
+  std::string ciphertext = encrypt_result.ValueOrDie();
+
+  constexpr int kNumThreads = 3;
+  std::vector<util::StatusOr<std::string>> results(kNumThreads);
+  auto decrypt = [&](int i) { results[i] = aead->Decrypt(ciphertext, aad); };
+  std::vector<std::thread> threads;
+  threads.emplace_back(decrypt, 0);
+  remote->WaitUntilEntered();
+  for (int i = 1; i < kNumThreads; i++) threads.emplace_back(decrypt, i);
+  while (aead->GetDekCacheStats().coalesced_decryptions < kNumThreads - 1) {
+    absl::SleepFor(absl::Milliseconds(1));
+  }
+  remote->Release();
+  for (auto& thread : threads) thread.join();
+
+  for (const auto& result : results) {
+    ASSERT_THAT(result.status(), IsOk());
+    EXPECT_EQ(result.ValueOrDie(), message);
+  }
+  EXPECT_EQ(aead->GetDekCacheStats().remote_decrypt_calls, 1);
+}
+
 }  // namespace
 }  // namespace tink
 }  // namespace crypto
@@ -0,0 +1,163 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/aead/local_cache_aead.h"
+
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+
+#include "absl/base/internal/endian.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/escaping.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "openssl/sha.h"
+#include "tink/aead.h"
+#include "tink/subtle/random.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+
+using crypto::tink::util::Status;
+using crypto::tink::util::StatusOr;
+
+namespace {
+
+// An entry is the expiry time in seconds since the epoch, 8 bytes big-endian,
+// followed by the plaintext encrypted with the local Aead. The associated data
+// of the local encryption is the entry ID followed by the expiry time, so that
+// entries cannot be renamed or extended.
+constexpr size_t kExpirySize = 8;
+
+StatusOr<std::string> ReadFile(const std::string& path) {
+  std::ifstream input(path, std::ios::binary);
+  if (!input.is_open()) {
+    return Status(util::error::NOT_FOUND, "no cache entry");
+  }
+  std::stringstream contents;
+  contents << input.rdbuf();
+  return contents.str();
+}
+
+}  // namespace
+
+// static
+StatusOr<std::unique_ptr<LocalCacheAead>> LocalCacheAead::New(
+    std::unique_ptr<Aead> remote_aead, std::unique_ptr<Aead> local_aead,
+    const Options& options) {
+  if (remote_aead == nullptr || local_aead == nullptr) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "remote_aead and local_aead must be non-null");
+  }
+  if (options.directory.empty()) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "the cache directory must be set");
+  }
+  if (options.ttl <= absl::ZeroDuration()) {
+    return Status(util::error::INVALID_ARGUMENT, "ttl must be positive");
+  }
+  return {absl::WrapUnique(new LocalCacheAead(
+      std::move(remote_aead), std::move(local_aead), options))};
+}
+
+std::string LocalCacheAead::EntryPath(absl::string_view ciphertext,
+                                      absl::string_view associated_data,
+                                      std::string* entry_id) const {
+  // Prefixing the length of the ciphertext keeps the split between the
+  // ciphertext and the associated data unambiguous.
+  uint8_t ciphertext_size[8];
+  absl::big_endian::Store64(ciphertext_size, ciphertext.size());
+  uint8_t digest[SHA256_DIGEST_LENGTH];
+  SHA256_CTX ctx;
+  SHA256_Init(&ctx);
+  SHA256_Update(&ctx, ciphertext_size, sizeof(ciphertext_size));
+  SHA256_Update(&ctx, ciphertext.data(), ciphertext.size());
+  SHA256_Update(&ctx, associated_data.data(), associated_data.size());
+  SHA256_Final(digest, &ctx);
+  *entry_id = std::string(reinterpret_cast<const char*>(digest),
+                          sizeof(digest));
+  return absl::StrCat(options_.directory, "/",
+                      absl::BytesToHexString(*entry_id));
+}
+
+StatusOr<std::string> LocalCacheAead::Encrypt(
+    absl::string_view plaintext, absl::string_view associated_data) const {
+  return remote_aead_->Encrypt(plaintext, associated_data);
+}
+
+StatusOr<std::string> LocalCacheAead::Decrypt(
+    absl::string_view ciphertext, absl::string_view associated_data) const {
+  std::string entry_id;
+  std::string path = EntryPath(ciphertext, associated_data, &entry_id);
+  int64_t now = absl::ToUnixSeconds(absl::Now());
+
+  auto entry_result = ReadFile(path);
+  if (entry_result.ok() && entry_result.ValueOrDie().size() > kExpirySize) {
+    absl::string_view entry = entry_result.ValueOrDie();
+    absl::string_view expiry = entry.substr(0, kExpirySize);
+    if (static_cast<int64_t>(absl::big_endian::Load64(expiry.data())) > now) {
+      auto plaintext_result = local_aead_->Decrypt(
+          entry.substr(kExpirySize), absl::StrCat(entry_id, expiry));
+      if (plaintext_result.ok()) return plaintext_result;
+    }
+  }
+
+  auto plaintext_result = remote_aead_->Decrypt(ciphertext, associated_data);
+  if (!plaintext_result.ok()) return plaintext_result.status();
+
+  char expiry[kExpirySize];
+  absl::big_endian::Store64(expiry, now + absl::ToInt64Seconds(options_.ttl));
+  absl::string_view expiry_view(expiry, kExpirySize);
+  auto encrypted_result = local_aead_->Encrypt(
+      plaintext_result.ValueOrDie(), absl::StrCat(entry_id, expiry_view));
+  if (encrypted_result.ok()) {
+    // Writes to a temporary file first, so that concurrent readers never see
+    // a partial entry.
+    std::string tmp_path = absl::StrCat(
+        path, ".", absl::BytesToHexString(subtle::Random::GetRandomBytes(8)));
+    std::ofstream output(tmp_path, std::ios::binary | std::ios::trunc);
+    output.write(expiry, kExpirySize);
+    output.write(encrypted_result.ValueOrDie().data(),
+                 encrypted_result.ValueOrDie().size());
+    output.close();
+    if (!output || std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+      std::remove(tmp_path.c_str());
+    }
+  }
+  return plaintext_result;
+}
+
+Status LocalCacheAead::Invalidate(absl::string_view ciphertext,
+                                  absl::string_view associated_data) const {
+  std::string entry_id;
+  std::string path = EntryPath(ciphertext, associated_data, &entry_id);
+  if (std::remove(path.c_str()) != 0 && ReadFile(path).ok()) {
+    return Status(util::error::INTERNAL,
+                  absl::StrCat("could not remove cache entry ", path));
+  }
+  return util::OkStatus();
+}
+
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,94 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_AEAD_LOCAL_CACHE_AEAD_H_
+#define TINK_AEAD_LOCAL_CACHE_AEAD_H_
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "tink/aead.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+
+// An Aead which forwards to a remote Aead, typically a KMS key, and keeps the
+// results of Decrypt() in files of a local directory, so that processes on
+// the same host decrypt the same ciphertext with one remote call. This is
+// meant for the master key of KeysetHandle::Read(): after a restart of many
+// processes, only the first one to read a keyset calls the KMS.
+//
+// The cached plaintexts are encrypted with 'local_aead', which should use a
+// key that never leaves the host. Entries are named after the SHA-256 of
+// the ciphertext and associated data, and expire after 'ttl'. Encrypt() is
+// not cached.
+class LocalCacheAead : public Aead {
+ public:
+  struct Options {
+    // The directory holding the cache entries. It must exist, and should be
+    // readable only by the processes using the cache.
+    std::string directory;
+    // The time after which an entry is no longer used.
+    absl::Duration ttl = absl::Hours(24);
+  };
+
+  static crypto::tink::util::StatusOr<std::unique_ptr<LocalCacheAead>> New(
+      std::unique_ptr<Aead> remote_aead, std::unique_ptr<Aead> local_aead,
+      const Options& options);
+
+  crypto::tink::util::StatusOr<std::string> Encrypt(
+      absl::string_view plaintext,
+      absl::string_view associated_data) const override;
+
+  // Returns the cached plaintext of 'ciphertext' if there is a valid entry,
+  // and otherwise decrypts it with the remote Aead and caches the result.
+  // Failing to read or write the cache only costs the remote call.
+  crypto::tink::util::StatusOr<std::string> Decrypt(
+      absl::string_view ciphertext,
+      absl::string_view associated_data) const override;
+
+  // Removes the entry for 'ciphertext' and 'associated_data', e.g. after
+  // rotating the keyset it decrypts to.
+  crypto::tink::util::Status Invalidate(
+      absl::string_view ciphertext, absl::string_view associated_data) const;
+
+ private:
+  LocalCacheAead(std::unique_ptr<Aead> remote_aead,
+                 std::unique_ptr<Aead> local_aead, const Options& options)
+      : remote_aead_(std::move(remote_aead)),
+        local_aead_(std::move(local_aead)),
+        options_(options) {}
+
+  // Returns the path of the entry for 'ciphertext' and 'associated_data',
+  // and sets '*entry_id' to the hash it is named after.
+  std::string EntryPath(absl::string_view ciphertext,
+                        absl::string_view associated_data,
+                        std::string* entry_id) const;
+
+  const std::unique_ptr<Aead> remote_aead_;
+  const std::unique_ptr<Aead> local_aead_;
+  const Options options_;
+};
+
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_AEAD_LOCAL_CACHE_AEAD_H_
@@ -0,0 +1,167 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/aead/local_cache_aead.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "tink/aead.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "tink/util/test_matchers.h"
+#include "tink/util/test_util.h"
+
+namespace crypto {
+namespace tink {
+namespace {
+
+using crypto::tink::test::DummyAead;
+using crypto::tink::test::IsOk;
+using crypto::tink::test::StatusIs;
+
+// A remote AEAD which counts its calls to Decrypt().
+class CountingAead : public Aead {
+ public:
+  CountingAead(absl::string_view aead_name, int* decrypt_calls)
+      : aead_(aead_name), decrypt_calls_(decrypt_calls) {}
+
+  util::StatusOr<std::string> Encrypt(
+      absl::string_view plaintext,
+      absl::string_view associated_data) const override {
+    return aead_.Encrypt(plaintext, associated_data);
+  }
+
+  util::StatusOr<std::string> Decrypt(
+      absl::string_view ciphertext,
+      absl::string_view associated_data) const override {
+    (*decrypt_calls_)++;
+    return aead_.Decrypt(ciphertext, associated_data);
+  }
+
+ private:
+  DummyAead aead_;
+  int* decrypt_calls_;
+};
+
+// Returns a cache over "remote" in a directory for 'test_name'.
+std::unique_ptr<LocalCacheAead> NewCache(absl::string_view test_name,
+                                         absl::string_view local_name,
+                                         int* decrypt_calls) {
+  LocalCacheAead::Options options;
+  options.directory = test::TmpDir();
+  auto cache_result = LocalCacheAead::New(
+      absl::make_unique<CountingAead>(absl::StrCat("remote", test_name),
+                                      decrypt_calls),
+      absl::make_unique<DummyAead>(local_name), options);
+  EXPECT_THAT(cache_result.status(), IsOk());
+  return std::move(cache_result.ValueOrDie());
+}
+
+TEST(LocalCacheAeadTest, InvalidArguments) {
+  LocalCacheAead::Options options;
+  options.directory = test::TmpDir();
+  EXPECT_THAT(LocalCacheAead::New(nullptr, absl::make_unique<DummyAead>("l"),
+                                  options)
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  options.directory = "";
+  EXPECT_THAT(LocalCacheAead::New(absl::make_unique<DummyAead>("r"),
+                                  absl::make_unique<DummyAead>("l"), options)
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  options.directory = test::TmpDir();
+  options.ttl = absl::ZeroDuration();
+  EXPECT_THAT(LocalCacheAead::New(absl::make_unique<DummyAead>("r"),
+                                  absl::make_unique<DummyAead>("l"), options)
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(LocalCacheAeadTest, SecondProcessDecryptsLocally) {
+  int decrypt_calls = 0;
+  auto cache = NewCache("Second", "local", &decrypt_calls);
+  auto ciphertext_result = cache->Encrypt("keyset", "ad");
+  ASSERT_THAT(ciphertext_result.status(), IsOk());
+  std::string ciphertext = ciphertext_result.ValueOrDie();
+  // Removes the entry of an earlier run.
+  ASSERT_THAT(cache->Invalidate(ciphertext, "ad"), IsOk());
+
+  auto plaintext_result = cache->Decrypt(ciphertext, "ad");
+  ASSERT_THAT(plaintext_result.status(), IsOk());
+  EXPECT_EQ(plaintext_result.ValueOrDie(), "keyset");
+  EXPECT_EQ(decrypt_calls, 1);
+
+  // Another instance, as in a restarted process, finds the entry.
+  auto other_cache = NewCache("Second", "local", &decrypt_calls);
+  plaintext_result = other_cache->Decrypt(ciphertext, "ad");
+  ASSERT_THAT(plaintext_result.status(), IsOk());
+  EXPECT_EQ(plaintext_result.ValueOrDie(), "keyset");
+  EXPECT_EQ(decrypt_calls, 1);
+
+  // Other associated data is another entry, and is checked by the remote AEAD.
+  EXPECT_FALSE(other_cache->Decrypt(ciphertext, "other ad").ok());
+  EXPECT_EQ(decrypt_calls, 2);
+}
+
+TEST(LocalCacheAeadTest, WrongLocalKeyCallsRemote) {
+  int decrypt_calls = 0;
+  auto cache = NewCache("WrongLocal", "local", &decrypt_calls);
+  std::string ciphertext = cache->Encrypt("keyset", "").ValueOrDie();
+  ASSERT_THAT(cache->Invalidate(ciphertext, ""), IsOk());
+  ASSERT_THAT(cache->Decrypt(ciphertext, "").status(), IsOk());
+  EXPECT_EQ(decrypt_calls, 1);
+
+  auto other_cache = NewCache("WrongLocal", "other local", &decrypt_calls);
+  auto plaintext_result = other_cache->Decrypt(ciphertext, "");
+  ASSERT_THAT(plaintext_result.status(), IsOk());
+  EXPECT_EQ(plaintext_result.ValueOrDie(), "keyset");
+  EXPECT_EQ(decrypt_calls, 2);
+}
+
+TEST(LocalCacheAeadTest, Invalidate) {
+  int decrypt_calls = 0;
+  auto cache = NewCache("Invalidate", "local", &decrypt_calls);
+  std::string ciphertext = cache->Encrypt("keyset", "").ValueOrDie();
+  ASSERT_THAT(cache->Invalidate(ciphertext, ""), IsOk());
+  ASSERT_THAT(cache->Decrypt(ciphertext, "").status(), IsOk());
+  ASSERT_THAT(cache->Decrypt(ciphertext, "").status(), IsOk());
+  EXPECT_EQ(decrypt_calls, 1);
+
+  EXPECT_THAT(cache->Invalidate(ciphertext, ""), IsOk());
+  ASSERT_THAT(cache->Decrypt(ciphertext, "").status(), IsOk());
+  EXPECT_EQ(decrypt_calls, 2);
+  // Invalidating a missing entry is not an error.
+  EXPECT_THAT(cache->Invalidate("no such ciphertext", ""), IsOk());
+}
+
+TEST(LocalCacheAeadTest, RemoteFailureIsNotCached) {
+  int decrypt_calls = 0;
+  auto cache = NewCache("RemoteFailure", "local", &decrypt_calls);
+  EXPECT_FALSE(cache->Decrypt("not a ciphertext", "").ok());
+  EXPECT_FALSE(cache->Decrypt("not a ciphertext", "").ok());
+  EXPECT_EQ(decrypt_calls, 2);
+}
+
+}  // namespace
+}  // namespace tink
+}  // namespace crypto
@@ -19,6 +19,8 @@
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "tink/aead.h"
+#include "tink/aead/cord_aead.h"
+#include "tink/aead/internal/cord_xchacha20_poly1305_boringssl.h"
 #include "tink/subtle/aead_test_util.h"
 #include "tink/util/secret_data.h"
 #include "tink/util/status.h"
@@ -133,6 +135,28 @@ TEST(XChaCha20Poly1305KeyManagerTest, CreateAead) {
       IsOk());
 }
 
+TEST(XChaCha20Poly1305KeyManagerTest, CreateCordAead) {
+  StatusOr<XChaCha20Poly1305Key> key_or =
+      XChaCha20Poly1305KeyManager().CreateKey(XChaCha20Poly1305KeyFormat());
+  ASSERT_THAT(key_or.status(), IsOk());
+
+  StatusOr<std::unique_ptr<CordAead>> aead_or =
+      XChaCha20Poly1305KeyManager().GetPrimitive<CordAead>(
+          key_or.ValueOrDie());
+
+  ASSERT_THAT(aead_or.status(), IsOk());
+
+  StatusOr<std::unique_ptr<CordAead>> direct_aead_or =
+      CordXChacha20Poly1305BoringSsl::New(
+          util::SecretDataFromStringView(key_or.ValueOrDie().key_value()));
+  ASSERT_THAT(direct_aead_or.status(), IsOk());
+
+  ASSERT_THAT(
+      EncryptThenDecrypt(*aead_or.ValueOrDie(),
+                         *direct_aead_or.ValueOrDie(), "message", "aad"),
+      IsOk());
+}
+
 }  // namespace
 }  // namespace tink
 }  // namespace crypto
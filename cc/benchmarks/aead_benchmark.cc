@@ -0,0 +1,189 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+// Benchmarks of the AEAD primitives, both of the subtle implementations and
+// of the primitives obtained from keysets.
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "benchmark/benchmark.h"
+#include "tink/aead.h"
+#include "tink/aead/aead_key_templates.h"
+#include "tink/benchmarks/benchmark_util.h"
+#include "tink/subtle/aes_ctr_boringssl.h"
+#include "tink/subtle/aes_eax_boringssl.h"
+#include "tink/subtle/aes_gcm_boringssl.h"
+#include "tink/subtle/aes_gcm_siv_boringssl.h"
+#include "tink/subtle/common_enums.h"
+#include "tink/subtle/encrypt_then_authenticate.h"
+#include "tink/subtle/hmac_boringssl.h"
+#include "tink/subtle/random.h"
+#include "tink/subtle/xchacha20_poly1305_boringssl.h"
+#include "tink/util/statusor.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace benchmarks {
+namespace {
+
+using ::crypto::tink::subtle::Random;
+using ::google::crypto::tink::KeyTemplate;
+
+constexpr char kAssociatedData[] = "associated data";
+
+using AeadFactory = util::StatusOr<std::unique_ptr<Aead>> (*)();
+using KeyTemplateFactory = const KeyTemplate& (*)();
+
+util::StatusOr<std::unique_ptr<Aead>> NewAesGcm() {
+  return subtle::AesGcmBoringSsl::New(Random::GetRandomKeyBytes(16));
+}
+
+util::StatusOr<std::unique_ptr<Aead>> NewAesGcmSiv() {
+  return subtle::AesGcmSivBoringSsl::New(Random::GetRandomKeyBytes(16));
+}
+
+util::StatusOr<std::unique_ptr<Aead>> NewAesEax() {
+  return subtle::AesEaxBoringSsl::New(Random::GetRandomKeyBytes(16), 16);
+}
+
+util::StatusOr<std::unique_ptr<Aead>> NewXChaCha20Poly1305() {
+  return subtle::XChacha20Poly1305BoringSsl::New(
+      Random::GetRandomKeyBytes(32));
+}
+
+util::StatusOr<std::unique_ptr<Aead>> NewAesCtrHmac() {
+  auto cipher_result =
+      subtle::AesCtrBoringSsl::New(Random::GetRandomKeyBytes(16), 16);
+  if (!cipher_result.ok()) return cipher_result.status();
+  auto mac_result = subtle::HmacBoringSsl::New(
+      subtle::HashType::SHA256, 16, Random::GetRandomKeyBytes(32));
+  if (!mac_result.ok()) return mac_result.status();
+  return subtle::EncryptThenAuthenticate::New(
+      std::move(cipher_result.ValueOrDie()), std::move(mac_result.ValueOrDie()),
+      16);
+}
+
+// Returns a primitive for a keyset with state.range(1) keys.
+util::StatusOr<std::unique_ptr<Aead>> NewKeysetAead(
+    benchmark::State& state, KeyTemplateFactory key_template) {
+  RegisterTinkOrDie();
+  auto handle_result = NewKeysetHandle(key_template(), state.range(1));
+  if (!handle_result.ok()) return handle_result.status();
+  return handle_result.ValueOrDie()->GetPrimitive<Aead>();
+}
+
+void EncryptLoop(benchmark::State& state, const Aead& aead) {
+  std::string plaintext = Random::GetRandomBytes(state.range(0));
+  PerfCounters perf_counters;
+  for (auto _ : state) {
+    auto ciphertext_result = aead.Encrypt(plaintext, kAssociatedData);
+    if (SkipWithError(state, ciphertext_result.status())) break;
+    benchmark::DoNotOptimize(ciphertext_result);
+  }
+  perf_counters.Report(state, state.range(0));
+  SetBytesProcessed(state, state.range(0));
+}
+
+void DecryptLoop(benchmark::State& state, const Aead& aead) {
+  std::string plaintext = Random::GetRandomBytes(state.range(0));
+  auto ciphertext_result = aead.Encrypt(plaintext, kAssociatedData);
+  if (SkipWithError(state, ciphertext_result.status())) return;
+  std::string ciphertext = ciphertext_result.ValueOrDie();
+  PerfCounters perf_counters;
+  for (auto _ : state) {
+    auto plaintext_result = aead.Decrypt(ciphertext, kAssociatedData);
+    if (SkipWithError(state, plaintext_result.status())) break;
+    benchmark::DoNotOptimize(plaintext_result);
+  }
+  perf_counters.Report(state, state.range(0));
+  SetBytesProcessed(state, state.range(0));
+}
+
+void BM_SubtleAeadEncrypt(benchmark::State& state, AeadFactory new_aead) {
+  auto aead_result = new_aead();
+  if (SkipWithError(state, aead_result.status())) return;
+  EncryptLoop(state, *aead_result.ValueOrDie());
+}
+
+void BM_SubtleAeadDecrypt(benchmark::State& state, AeadFactory new_aead) {
+  auto aead_result = new_aead();
+  if (SkipWithError(state, aead_result.status())) return;
+  DecryptLoop(state, *aead_result.ValueOrDie());
+}
+
+void BM_KeysetAeadEncrypt(benchmark::State& state,
+                          KeyTemplateFactory key_template) {
+  auto aead_result = NewKeysetAead(state, key_template);
+  if (SkipWithError(state, aead_result.status())) return;
+  EncryptLoop(state, *aead_result.ValueOrDie());
+}
+
+void BM_KeysetAeadDecrypt(benchmark::State& state,
+                          KeyTemplateFactory key_template) {
+  auto aead_result = NewKeysetAead(state, key_template);
+  if (SkipWithError(state, aead_result.status())) return;
+  DecryptLoop(state, *aead_result.ValueOrDie());
+}
+
+BENCHMARK_CAPTURE(BM_SubtleAeadEncrypt, AesGcm, &NewAesGcm)
+    ->Apply(MessageSizes);
+BENCHMARK_CAPTURE(BM_SubtleAeadDecrypt, AesGcm, &NewAesGcm)
+    ->Apply(MessageSizes);
+BENCHMARK_CAPTURE(BM_SubtleAeadEncrypt, AesGcmSiv, &NewAesGcmSiv)
+    ->Apply(MessageSizes);
+BENCHMARK_CAPTURE(BM_SubtleAeadDecrypt, AesGcmSiv, &NewAesGcmSiv)
+    ->Apply(MessageSizes);
+BENCHMARK_CAPTURE(BM_SubtleAeadEncrypt, AesEax, &NewAesEax)
+    ->Apply(MessageSizes);
+BENCHMARK_CAPTURE(BM_SubtleAeadDecrypt, AesEax, &NewAesEax)
+    ->Apply(MessageSizes);
+BENCHMARK_CAPTURE(BM_SubtleAeadEncrypt, XChaCha20Poly1305,
+                  &NewXChaCha20Poly1305)
+    ->Apply(MessageSizes);
+BENCHMARK_CAPTURE(BM_SubtleAeadDecrypt, XChaCha20Poly1305,
+                  &NewXChaCha20Poly1305)
+    ->Apply(MessageSizes);
+BENCHMARK_CAPTURE(BM_SubtleAeadEncrypt, AesCtrHmac, &NewAesCtrHmac)
+    ->Apply(MessageSizes);
+BENCHMARK_CAPTURE(BM_SubtleAeadDecrypt, AesCtrHmac, &NewAesCtrHmac)
+    ->Apply(MessageSizes);
+
+BENCHMARK_CAPTURE(BM_KeysetAeadEncrypt, Aes128Gcm,
+                  &AeadKeyTemplates::Aes128Gcm)
+    ->Apply(MessageSizesAndKeysetSizes);
+BENCHMARK_CAPTURE(BM_KeysetAeadDecrypt, Aes128Gcm,
+                  &AeadKeyTemplates::Aes128Gcm)
+    ->Apply(MessageSizesAndKeysetSizes);
+BENCHMARK_CAPTURE(BM_KeysetAeadEncrypt, Aes128Eax,
+                  &AeadKeyTemplates::Aes128Eax)
+    ->Apply(MessageSizesAndKeysetSizes);
+BENCHMARK_CAPTURE(BM_KeysetAeadDecrypt, Aes128Eax,
+                  &AeadKeyTemplates::Aes128Eax)
+    ->Apply(MessageSizesAndKeysetSizes);
+BENCHMARK_CAPTURE(BM_KeysetAeadEncrypt, Aes128CtrHmacSha256,
+                  &AeadKeyTemplates::Aes128CtrHmacSha256)
+    ->Apply(MessageSizesAndKeysetSizes);
+BENCHMARK_CAPTURE(BM_KeysetAeadDecrypt, Aes128CtrHmacSha256,
+                  &AeadKeyTemplates::Aes128CtrHmacSha256)
+    ->Apply(MessageSizesAndKeysetSizes);
+
+}  // namespace
+}  // namespace benchmarks
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,100 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+// Benchmarks of the base64 codec of JWTs and JSON keysets, compared with the
+// one of Abseil.
+
+#include <cstdint>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "absl/strings/escaping.h"
+#include "tink/subtle/random.h"
+#include "tink/util/base64.h"
+
+namespace crypto {
+namespace tink {
+namespace benchmarks {
+namespace {
+
+using ::crypto::tink::subtle::Random;
+using ::crypto::tink::util::Base64Alphabet;
+
+// Encodes state.range(0) bytes in every iteration.
+void BM_Base64Encode(benchmark::State& state) {
+  const std::string data = Random::GetRandomBytes(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(util::Base64Encode(data, Base64Alphabet::kUrl,
+                                                /* padding = */ false));
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          data.size());
+}
+
+void BM_AbslBase64Encode(benchmark::State& state) {
+  const std::string data = Random::GetRandomBytes(state.range(0));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(absl::WebSafeBase64Escape(data));
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          data.size());
+}
+
+// Decodes the encoding of state.range(0) bytes in every iteration.
+void BM_Base64Decode(benchmark::State& state) {
+  const std::string encoded =
+      absl::WebSafeBase64Escape(Random::GetRandomBytes(state.range(0)));
+  std::string data;
+  for (auto _ : state) {
+    if (!util::Base64Decode(encoded, Base64Alphabet::kUrl, &data)) {
+      state.SkipWithError("invalid encoding");
+      break;
+    }
+    benchmark::DoNotOptimize(data);
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          encoded.size());
+}
+
+void BM_AbslBase64Decode(benchmark::State& state) {
+  const std::string encoded =
+      absl::WebSafeBase64Escape(Random::GetRandomBytes(state.range(0)));
+  std::string data;
+  for (auto _ : state) {
+    if (!absl::WebSafeBase64Unescape(encoded, &data)) {
+      state.SkipWithError("invalid encoding");
+      break;
+    }
+    benchmark::DoNotOptimize(data);
+  }
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          encoded.size());
+}
+
+// From the size of an HMAC tag to the payload of a large JWT.
+void DataSizes(benchmark::internal::Benchmark* benchmark) {
+  benchmark->RangeMultiplier(8)->Range(32, 64 * 1024);
+}
+
+BENCHMARK(BM_Base64Encode)->Apply(DataSizes);
+BENCHMARK(BM_AbslBase64Encode)->Apply(DataSizes);
+BENCHMARK(BM_Base64Decode)->Apply(DataSizes);
+BENCHMARK(BM_AbslBase64Decode)->Apply(DataSizes);
+
+}  // namespace
+}  // namespace benchmarks
+}  // namespace tink
+}  // namespace crypto
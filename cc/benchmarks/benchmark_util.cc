@@ -0,0 +1,308 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/benchmarks/benchmark_util.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>  // NOLINT(build/c++11)
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/ascii.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_join.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "benchmark/benchmark.h"
+#include "tink/config/tink_config.h"
+#include "tink/keyset_handle.h"
+#include "tink/keyset_manager.h"
+#include "tink/util/buffer.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace benchmarks {
+
+namespace {
+
+constexpr int kMessageSizeMultiplier = 16;
+
+// Indices of the events in PerfCounters::fds_.
+enum PerfEvent {
+  kCycles = 0,
+  kInstructions,
+  kL1dMisses,
+  kLlcMisses,
+  kBranchMisses,
+};
+
+// CPU features, as named in /proc/cpuinfo, which the primitives use when
+// available, and which are therefore reported with the perf counters.
+const char* const kCryptoCpuFeatures[] = {
+    // x86
+    "aes", "pclmulqdq", "vaes", "vpclmulqdq", "sha_ni", "ssse3", "sse4_1",
+    "avx", "avx2", "avx512f", "avx512bw", "bmi2", "adx",
+    // ARM
+    "asimd", "pmull", "sha1", "sha2", "sha512",
+};
+
+#ifdef __linux__
+uint64_t PerfEventConfig(PerfEvent event, uint32_t* type) {
+  constexpr uint64_t kReadMiss =
+      (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+  *type = PERF_TYPE_HARDWARE;
+  switch (event) {
+    case kCycles:
+      return PERF_COUNT_HW_CPU_CYCLES;
+    case kInstructions:
+      return PERF_COUNT_HW_INSTRUCTIONS;
+    case kL1dMisses:
+      *type = PERF_TYPE_HW_CACHE;
+      return PERF_COUNT_HW_CACHE_L1D | kReadMiss;
+    case kLlcMisses:
+      *type = PERF_TYPE_HW_CACHE;
+      return PERF_COUNT_HW_CACHE_LL | kReadMiss;
+    case kBranchMisses:
+      return PERF_COUNT_HW_BRANCH_MISSES;
+  }
+  return 0;
+}
+
+// Opens a disabled counter for 'event' on the calling thread, or returns -1.
+int OpenPerfEvent(PerfEvent event) {
+  struct perf_event_attr attr;
+  std::memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.config = PerfEventConfig(event, &attr.type);
+  attr.disabled = 1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format =
+      PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return syscall(__NR_perf_event_open, &attr, /* pid = */ 0, /* cpu = */ -1,
+                 /* group_fd = */ -1, PERF_FLAG_FD_CLOEXEC);
+}
+
+// Returns the value of the counter 'fd', scaled up if the kernel multiplexed
+// it with other counters, or -1 if it never ran.
+double ReadPerfEvent(int fd) {
+  uint64_t values[3];  // value, time enabled, time running
+  if (read(fd, values, sizeof(values)) != sizeof(values) || values[2] == 0) {
+    return -1;
+  }
+  return static_cast<double>(values[0]) * values[1] / values[2];
+}
+#endif  // __linux__
+
+// Returns the CPU model and the features in kCryptoCpuFeatures which it has,
+// read from /proc/cpuinfo.
+std::string CpuDescription() {
+  std::ifstream cpuinfo("/proc/cpuinfo");
+  std::string model = "unknown CPU";
+  std::set<std::string> features;
+  std::string line;
+  while (std::getline(cpuinfo, line)) {
+    size_t colon = line.find(':');
+    if (colon == std::string::npos) continue;
+    absl::string_view key =
+        absl::StripAsciiWhitespace(absl::string_view(line).substr(0, colon));
+    absl::string_view value =
+        absl::StripAsciiWhitespace(absl::string_view(line).substr(colon + 1));
+    if (key == "model name") {
+      model = std::string(value);
+    } else if (key == "flags" || key == "Features") {
+      for (absl::string_view feature :
+           absl::StrSplit(value, ' ', absl::SkipEmpty())) {
+        features.insert(std::string(feature));
+      }
+      // The remaining processors are assumed to be the same.
+      break;
+    }
+  }
+  std::vector<std::string> crypto_features;
+  for (const char* feature : kCryptoCpuFeatures) {
+    if (features.count(feature) > 0) crypto_features.push_back(feature);
+  }
+  return absl::StrCat(model, " [", absl::StrJoin(crypto_features, " "), "]");
+}
+
+}  // namespace
+
+void MessageSizes(benchmark::internal::Benchmark* benchmark) {
+  benchmark->RangeMultiplier(kMessageSizeMultiplier)
+      ->Range(kMinMessageSize, kMaxMessageSize)
+      ->ThreadRange(1, kMaxThreads)
+      ->UseRealTime();
+}
+
+void MessageSizesAndKeysetSizes(benchmark::internal::Benchmark* benchmark) {
+  for (int num_keys : {1, 10, 100}) {
+    for (int64_t size = kMinMessageSize; size <= kMaxMessageSize;
+         size *= kMessageSizeMultiplier) {
+      benchmark->Args({size, num_keys});
+    }
+  }
+  benchmark->ThreadRange(1, kMaxThreads)->UseRealTime();
+}
+
+util::StatusOr<std::unique_ptr<KeysetHandle>> NewKeysetHandle(
+    const google::crypto::tink::KeyTemplate& key_template, int num_keys) {
+  auto manager_result = KeysetManager::New(key_template);
+  if (!manager_result.ok()) return manager_result.status();
+  auto manager = std::move(manager_result.ValueOrDie());
+  for (int i = 1; i < num_keys; i++) {
+    auto add_result = manager->Add(key_template);
+    if (!add_result.ok()) return add_result.status();
+  }
+  return manager->GetKeysetHandle();
+}
+
+void RegisterTinkOrDie() {
+  auto status = TinkConfig::Register();
+  if (!status.ok()) {
+    std::cerr << "Registering Tink failed: " << status << std::endl;
+    std::abort();
+  }
+}
+
+bool SkipWithError(benchmark::State& state, const util::Status& status) {
+  if (status.ok()) return false;
+  state.SkipWithError(status.ToString().c_str());
+  return true;
+}
+
+void SetBytesProcessed(benchmark::State& state, int64_t bytes_per_iteration) {
+  state.SetBytesProcessed(static_cast<int64_t>(state.iterations()) *
+                          bytes_per_iteration);
+}
+
+PerfCounters::PerfCounters() {
+  for (int i = 0; i < kNumEvents; i++) fds_[i] = -1;
+#ifdef __linux__
+  if (!Enabled()) return;
+  for (int i = 0; i < kNumEvents; i++) {
+    fds_[i] = OpenPerfEvent(static_cast<PerfEvent>(i));
+  }
+  bool any_open = false;
+  for (int fd : fds_) {
+    if (fd < 0) continue;
+    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    any_open = true;
+  }
+  if (!any_open) {
+    static std::once_flag warned;
+    std::call_once(warned, [] {
+      std::cerr << "No hardware performance counters are available; check "
+                << "/proc/sys/kernel/perf_event_paranoid" << std::endl;
+    });
+  }
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+  for (int fd : fds_) {
+    if (fd >= 0) close(fd);
+  }
+#endif
+}
+
+void PerfCounters::Report(benchmark::State& state,
+                          int64_t bytes_per_iteration) {
+  if (!Enabled()) return;
+  static const std::string* cpu_description =
+      new std::string(CpuDescription());
+  state.SetLabel(*cpu_description);
+#ifdef __linux__
+  double values[kNumEvents];
+  for (int fd : fds_) {
+    if (fd >= 0) ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+  }
+  for (int i = 0; i < kNumEvents; i++) {
+    values[i] = fds_[i] >= 0 ? ReadPerfEvent(fds_[i]) : -1;
+  }
+  if (state.iterations() == 0) return;
+  double iterations = static_cast<double>(state.iterations());
+  auto set_counter = [&state](const char* name, double value) {
+    state.counters[name] =
+        benchmark::Counter(value, benchmark::Counter::kAvgThreads);
+  };
+  if (values[kCycles] >= 0 && bytes_per_iteration > 0) {
+    set_counter("cycles_per_byte",
+                values[kCycles] / (iterations * bytes_per_iteration));
+  }
+  if (values[kCycles] > 0 && values[kInstructions] >= 0) {
+    set_counter("ipc", values[kInstructions] / values[kCycles]);
+  }
+  if (values[kL1dMisses] >= 0) {
+    set_counter("l1d_misses", values[kL1dMisses] / iterations);
+  }
+  if (values[kLlcMisses] >= 0) {
+    set_counter("llc_misses", values[kLlcMisses] / iterations);
+  }
+  if (values[kBranchMisses] >= 0) {
+    set_counter("branch_misses", values[kBranchMisses] / iterations);
+  }
+#endif
+}
+
+bool PerfCounters::Enabled() {
+  static const bool enabled = [] {
+    const char* value = std::getenv("TINK_BENCHMARK_PERF_COUNTERS");
+    return value != nullptr && *value != '\0' && std::strcmp(value, "0") != 0;
+  }();
+  return enabled;
+}
+
+util::Status StringViewRandomAccessStream::PRead(int64_t position, int count,
+                                                 util::Buffer* dest_buffer) {
+  if (position >= data_.size()) {
+    dest_buffer->set_size(0).IgnoreError();
+    return util::Status(util::error::OUT_OF_RANGE, "EOF");
+  }
+  int read_count = std::min<int64_t>(count, data_.size() - position);
+  std::memcpy(dest_buffer->get_mem_block(), data_.data() + position,
+              read_count);
+  auto status = dest_buffer->set_size(read_count);
+  if (!status.ok()) return status;
+  if (read_count < count) {
+    return util::Status(util::error::OUT_OF_RANGE, "EOF");
+  }
+  return util::OkStatus();
+}
+
+}  // namespace benchmarks
+}  // namespace tink
+}  // namespace crypto
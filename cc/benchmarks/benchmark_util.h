@@ -0,0 +1,131 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_BENCHMARKS_BENCHMARK_UTIL_H_
+#define TINK_BENCHMARKS_BENCHMARK_UTIL_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "benchmark/benchmark.h"
+#include "tink/keyset_handle.h"
+#include "tink/random_access_stream.h"
+#include "tink/util/buffer.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace benchmarks {
+
+// Smallest and largest message size, in bytes, used by the benchmarks.
+constexpr int kMinMessageSize = 16;
+constexpr int kMaxMessageSize = 16 << 20;
+
+// Largest number of threads used by the benchmarks.
+constexpr int kMaxThreads = 8;
+
+// Benchmark argument generators, to be used with Apply().
+//
+// Runs the benchmark with message sizes from kMinMessageSize to
+// kMaxMessageSize (state.range(0)) and 1 to kMaxThreads threads.
+void MessageSizes(benchmark::internal::Benchmark* benchmark);
+// Like MessageSizes(), and additionally runs the benchmark with keysets of
+// 1, 10 and 100 keys (state.range(1)).
+void MessageSizesAndKeysetSizes(benchmark::internal::Benchmark* benchmark);
+
+// Returns a new keyset with 'num_keys' keys generated from 'key_template',
+// where the first key is the primary.
+crypto::tink::util::StatusOr<std::unique_ptr<KeysetHandle>> NewKeysetHandle(
+    const google::crypto::tink::KeyTemplate& key_template, int num_keys);
+
+// Registers all Tink primitives. Aborts the benchmark if this fails.
+void RegisterTinkOrDie();
+
+// Marks the benchmark as failed if 'status' is not OK, and returns true in
+// this case. Benchmarks should return immediately when this returns true.
+bool SkipWithError(benchmark::State& state,
+                   const crypto::tink::util::Status& status);
+
+// Records the number of bytes processed by all iterations of the benchmark,
+// if each iteration processes 'bytes_per_iteration' bytes.
+void SetBytesProcessed(benchmark::State& state, int64_t bytes_per_iteration);
+
+// Hardware performance counters of the calling thread, read with Linux
+// perf_event_open(2) around the loop of a benchmark:
+//
+//   PerfCounters perf_counters;
+//   for (auto _ : state) { ... }
+//   perf_counters.Report(state, bytes_per_iteration);
+//
+// The counters are only collected if the environment variable
+// TINK_BENCHMARK_PERF_COUNTERS is set to a value other than "0". They count
+// user space only, so that they can be opened with the default
+// perf_event_paranoid setting of 2. Events which the platform, the kernel or
+// a VM do not provide are left out of the report; on platforms other than
+// Linux, nothing is reported.
+class PerfCounters {
+ public:
+  // Opens and starts the counters, if enabled.
+  PerfCounters();
+  ~PerfCounters();
+
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+
+  // Stops the counters and adds them to the counters of 'state':
+  // cycles_per_byte, if each iteration processed 'bytes_per_iteration' > 0
+  // bytes; ipc, the instructions per cycle; and l1d_misses, llc_misses and
+  // branch_misses per iteration. All are averaged over the threads of the
+  // benchmark. Also sets the label of the benchmark to the CPU model and its
+  // features relevant to the primitives, e.g. "<model> [aes avx2 pclmulqdq]".
+  void Report(benchmark::State& state, int64_t bytes_per_iteration);
+
+  // Returns true if TINK_BENCHMARK_PERF_COUNTERS enables the counters.
+  static bool Enabled();
+
+ private:
+  static constexpr int kNumEvents = 5;
+
+  int fds_[kNumEvents];
+};
+
+// A RandomAccessStream reading from a string_view, without copying it.
+class StringViewRandomAccessStream : public RandomAccessStream {
+ public:
+  explicit StringViewRandomAccessStream(absl::string_view data)
+      : data_(data) {}
+
+  crypto::tink::util::Status PRead(
+      int64_t position, int count,
+      crypto::tink::util::Buffer* dest_buffer) override;
+
+  crypto::tink::util::StatusOr<int64_t> size() override {
+    return data_.size();
+  }
+
+ private:
+  absl::string_view data_;
+};
+
+}  // namespace benchmarks
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_BENCHMARKS_BENCHMARK_UTIL_H_
@@ -0,0 +1,70 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+// Benchmarks of the start of a binary which uses Tink: registering a config
+// and getting the first primitive, with the key managers which the config
+// registers lazily.
+
+#include <memory>
+#include <utility>
+
+#include "benchmark/benchmark.h"
+#include "tink/aead.h"
+#include "tink/aead/aead_config.h"
+#include "tink/aead/aead_key_templates.h"
+#include "tink/benchmarks/benchmark_util.h"
+#include "tink/config/tink_config.h"
+#include "tink/keyset_handle.h"
+#include "tink/registry.h"
+#include "tink/util/status.h"
+
+namespace crypto {
+namespace tink {
+namespace benchmarks {
+namespace {
+
+using RegisterFunction = util::Status (*)();
+
+// Resets the registry, then registers a config and gets an AES-GCM primitive
+// in every iteration.
+void BM_RegisterAndGetPrimitive(benchmark::State& state,
+                                RegisterFunction register_config) {
+  RegisterTinkOrDie();
+  auto handle_result = NewKeysetHandle(AeadKeyTemplates::Aes128Gcm(), 1);
+  if (SkipWithError(state, handle_result.status())) return;
+  const KeysetHandle& handle = *handle_result.ValueOrDie();
+  for (auto _ : state) {
+    state.PauseTiming();
+    Registry::Reset();
+    state.ResumeTiming();
+    util::Status status = register_config();
+    if (SkipWithError(state, status)) break;
+    auto aead_result = handle.GetPrimitive<Aead>();
+    if (SkipWithError(state, aead_result.status())) break;
+    benchmark::DoNotOptimize(aead_result);
+  }
+  RegisterTinkOrDie();
+}
+
+BENCHMARK_CAPTURE(BM_RegisterAndGetPrimitive, AeadConfig,
+                  &AeadConfig::Register);
+BENCHMARK_CAPTURE(BM_RegisterAndGetPrimitive, TinkConfig,
+                  &TinkConfig::Register);
+
+}  // namespace
+}  // namespace benchmarks
+}  // namespace tink
+}  // namespace crypto
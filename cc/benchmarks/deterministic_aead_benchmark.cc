@@ -0,0 +1,133 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+// Benchmarks of the deterministic AEAD primitives, both of the subtle
+// implementation and of the primitives obtained from keysets.
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "benchmark/benchmark.h"
+#include "tink/benchmarks/benchmark_util.h"
+#include "tink/daead/deterministic_aead_key_templates.h"
+#include "tink/deterministic_aead.h"
+#include "tink/subtle/aes_siv_boringssl.h"
+#include "tink/subtle/random.h"
+#include "tink/util/statusor.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace benchmarks {
+namespace {
+
+using ::crypto::tink::subtle::Random;
+using ::google::crypto::tink::KeyTemplate;
+
+constexpr char kAssociatedData[] = "associated data";
+
+using DeterministicAeadFactory =
+    util::StatusOr<std::unique_ptr<DeterministicAead>> (*)();
+using KeyTemplateFactory = const KeyTemplate& (*)();
+
+util::StatusOr<std::unique_ptr<DeterministicAead>> NewAesSiv() {
+  return subtle::AesSivBoringSsl::New(Random::GetRandomKeyBytes(64));
+}
+
+// Returns a primitive for a keyset with state.range(1) keys.
+util::StatusOr<std::unique_ptr<DeterministicAead>> NewKeysetDeterministicAead(
+    benchmark::State& state, KeyTemplateFactory key_template) {
+  RegisterTinkOrDie();
+  auto handle_result = NewKeysetHandle(key_template(), state.range(1));
+  if (!handle_result.ok()) return handle_result.status();
+  return handle_result.ValueOrDie()->GetPrimitive<DeterministicAead>();
+}
+
+void EncryptLoop(benchmark::State& state, const DeterministicAead& daead) {
+  std::string plaintext = Random::GetRandomBytes(state.range(0));
+  PerfCounters perf_counters;
+  for (auto _ : state) {
+    auto ciphertext_result =
+        daead.EncryptDeterministically(plaintext, kAssociatedData);
+    if (SkipWithError(state, ciphertext_result.status())) break;
+    benchmark::DoNotOptimize(ciphertext_result);
+  }
+  perf_counters.Report(state, state.range(0));
+  SetBytesProcessed(state, state.range(0));
+}
+
+void DecryptLoop(benchmark::State& state, const DeterministicAead& daead) {
+  std::string plaintext = Random::GetRandomBytes(state.range(0));
+  auto ciphertext_result =
+      daead.EncryptDeterministically(plaintext, kAssociatedData);
+  if (SkipWithError(state, ciphertext_result.status())) return;
+  std::string ciphertext = ciphertext_result.ValueOrDie();
+  PerfCounters perf_counters;
+  for (auto _ : state) {
+    auto plaintext_result =
+        daead.DecryptDeterministically(ciphertext, kAssociatedData);
+    if (SkipWithError(state, plaintext_result.status())) break;
+    benchmark::DoNotOptimize(plaintext_result);
+  }
+  perf_counters.Report(state, state.range(0));
+  SetBytesProcessed(state, state.range(0));
+}
+
+void BM_SubtleDeterministicAeadEncrypt(
+    benchmark::State& state, DeterministicAeadFactory new_daead) {
+  auto daead_result = new_daead();
+  if (SkipWithError(state, daead_result.status())) return;
+  EncryptLoop(state, *daead_result.ValueOrDie());
+}
+
+void BM_SubtleDeterministicAeadDecrypt(
+    benchmark::State& state, DeterministicAeadFactory new_daead) {
+  auto daead_result = new_daead();
+  if (SkipWithError(state, daead_result.status())) return;
+  DecryptLoop(state, *daead_result.ValueOrDie());
+}
+
+void BM_KeysetDeterministicAeadEncrypt(benchmark::State& state,
+                                       KeyTemplateFactory key_template) {
+  auto daead_result = NewKeysetDeterministicAead(state, key_template);
+  if (SkipWithError(state, daead_result.status())) return;
+  EncryptLoop(state, *daead_result.ValueOrDie());
+}
+
+void BM_KeysetDeterministicAeadDecrypt(benchmark::State& state,
+                                       KeyTemplateFactory key_template) {
+  auto daead_result = NewKeysetDeterministicAead(state, key_template);
+  if (SkipWithError(state, daead_result.status())) return;
+  DecryptLoop(state, *daead_result.ValueOrDie());
+}
+
+BENCHMARK_CAPTURE(BM_SubtleDeterministicAeadEncrypt, AesSiv, &NewAesSiv)
+    ->Apply(MessageSizes);
+BENCHMARK_CAPTURE(BM_SubtleDeterministicAeadDecrypt, AesSiv, &NewAesSiv)
+    ->Apply(MessageSizes);
+
+BENCHMARK_CAPTURE(BM_KeysetDeterministicAeadEncrypt, Aes256Siv,
+                  &DeterministicAeadKeyTemplates::Aes256Siv)
+    ->Apply(MessageSizesAndKeysetSizes);
+BENCHMARK_CAPTURE(BM_KeysetDeterministicAeadDecrypt, Aes256Siv,
+                  &DeterministicAeadKeyTemplates::Aes256Siv)
+    ->Apply(MessageSizesAndKeysetSizes);
+
+}  // namespace
+}  // namespace benchmarks
+}  // namespace tink
+}  // namespace crypto
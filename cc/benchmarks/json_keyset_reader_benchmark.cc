@@ -0,0 +1,114 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+// Benchmarks of reading cleartext JSON keysets, with the document based
+// JsonKeysetReader and the SAX based SaxJsonKeysetReader.
+
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+
+#include "benchmark/benchmark.h"
+#include "absl/memory/memory.h"
+#include "tink/aead/aead_key_templates.h"
+#include "tink/benchmarks/benchmark_util.h"
+#include "tink/cleartext_keyset_handle.h"
+#include "tink/json_keyset_reader.h"
+#include "tink/json_keyset_writer.h"
+#include "tink/keyset_reader.h"
+#include "tink/sax_json_keyset_reader.h"
+#include "tink/signature/signature_key_templates.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace benchmarks {
+namespace {
+
+using ::google::crypto::tink::KeyTemplate;
+
+using ReaderFactory = util::StatusOr<std::unique_ptr<KeysetReader>> (*)(
+    absl::string_view serialized_keyset);
+using KeyTemplateFactory = const KeyTemplate& (*)();
+
+util::StatusOr<std::unique_ptr<KeysetReader>> NewJsonKeysetReader(
+    absl::string_view serialized_keyset) {
+  return JsonKeysetReader::New(serialized_keyset);
+}
+
+util::StatusOr<std::unique_ptr<KeysetReader>> NewSaxJsonKeysetReader(
+    absl::string_view serialized_keyset) {
+  return SaxJsonKeysetReader::New(serialized_keyset);
+}
+
+// Returns the JSON of a keyset with 'num_keys' keys.
+util::StatusOr<std::string> NewJsonKeyset(KeyTemplateFactory key_template,
+                                          int num_keys) {
+  RegisterTinkOrDie();
+  auto handle_result = NewKeysetHandle(key_template(), num_keys);
+  if (!handle_result.ok()) return handle_result.status();
+  std::stringbuf buffer;
+  auto writer_result =
+      JsonKeysetWriter::New(absl::make_unique<std::ostream>(&buffer));
+  if (!writer_result.ok()) return writer_result.status();
+  util::Status status = writer_result.ValueOrDie()->Write(
+      CleartextKeysetHandle::GetKeyset(*handle_result.ValueOrDie()));
+  if (!status.ok()) return status;
+  return buffer.str();
+}
+
+// Reads a keyset with state.range(0) keys in every iteration.
+void BM_ReadJsonKeyset(benchmark::State& state, ReaderFactory new_reader,
+                       KeyTemplateFactory key_template) {
+  auto json_result = NewJsonKeyset(key_template, state.range(0));
+  if (SkipWithError(state, json_result.status())) return;
+  const std::string& json = json_result.ValueOrDie();
+  for (auto _ : state) {
+    auto reader_result = new_reader(json);
+    if (SkipWithError(state, reader_result.status())) break;
+    auto keyset_result = reader_result.ValueOrDie()->Read();
+    if (SkipWithError(state, keyset_result.status())) break;
+    benchmark::DoNotOptimize(keyset_result);
+  }
+  SetBytesProcessed(state, json.size());
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+void KeysetSizes(benchmark::internal::Benchmark* benchmark) {
+  benchmark->Arg(1)->Arg(10)->Arg(100)->ThreadRange(1, kMaxThreads)
+      ->UseRealTime();
+}
+
+BENCHMARK_CAPTURE(BM_ReadJsonKeyset, JsonAes128Gcm, &NewJsonKeysetReader,
+                  &AeadKeyTemplates::Aes128Gcm)
+    ->Apply(KeysetSizes);
+BENCHMARK_CAPTURE(BM_ReadJsonKeyset, SaxJsonAes128Gcm,
+                  &NewSaxJsonKeysetReader, &AeadKeyTemplates::Aes128Gcm)
+    ->Apply(KeysetSizes);
+BENCHMARK_CAPTURE(BM_ReadJsonKeyset, JsonEcdsaP256, &NewJsonKeysetReader,
+                  &SignatureKeyTemplates::EcdsaP256)
+    ->Apply(KeysetSizes);
+BENCHMARK_CAPTURE(BM_ReadJsonKeyset, SaxJsonEcdsaP256,
+                  &NewSaxJsonKeysetReader, &SignatureKeyTemplates::EcdsaP256)
+    ->Apply(KeysetSizes);
+
+}  // namespace
+}  // namespace benchmarks
+}  // namespace tink
+}  // namespace crypto
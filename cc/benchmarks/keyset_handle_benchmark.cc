@@ -0,0 +1,89 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+// Benchmarks of creating and copying keysets: KeysetHandle::GenerateNew()
+// and the handles returned by KeysetManager::GetKeysetHandle().
+
+#include <memory>
+#include <utility>
+
+#include "benchmark/benchmark.h"
+#include "tink/aead/aead_key_templates.h"
+#include "tink/benchmarks/benchmark_util.h"
+#include "tink/keyset_handle.h"
+#include "tink/keyset_manager.h"
+#include "tink/mac/mac_key_templates.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace benchmarks {
+namespace {
+
+using ::google::crypto::tink::KeyTemplate;
+
+using KeyTemplateFactory = const KeyTemplate& (*)();
+
+// Generates a keyset with a single key in every iteration.
+void BM_GenerateNew(benchmark::State& state,
+                    KeyTemplateFactory key_template) {
+  RegisterTinkOrDie();
+  for (auto _ : state) {
+    auto handle_result = KeysetHandle::GenerateNew(key_template());
+    if (SkipWithError(state, handle_result.status())) break;
+    benchmark::DoNotOptimize(handle_result);
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+// Copies a keyset with state.range(0) keys out of a KeysetManager in every
+// iteration.
+void BM_GetKeysetHandle(benchmark::State& state,
+                        KeyTemplateFactory key_template) {
+  RegisterTinkOrDie();
+  auto handle_result = NewKeysetHandle(key_template(), state.range(0));
+  if (SkipWithError(state, handle_result.status())) return;
+  auto manager_result = KeysetManager::New(*handle_result.ValueOrDie());
+  if (SkipWithError(state, manager_result.status())) return;
+  KeysetManager* manager = manager_result.ValueOrDie().get();
+  for (auto _ : state) {
+    std::unique_ptr<KeysetHandle> handle = manager->GetKeysetHandle();
+    benchmark::DoNotOptimize(handle);
+  }
+  state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+}
+
+BENCHMARK_CAPTURE(BM_GenerateNew, Aes128Gcm, &AeadKeyTemplates::Aes128Gcm)
+    ->ThreadRange(1, kMaxThreads)
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_GenerateNew, HmacSha256,
+                  &MacKeyTemplates::HmacSha256HalfSizeTag)
+    ->ThreadRange(1, kMaxThreads)
+    ->UseRealTime();
+
+BENCHMARK_CAPTURE(BM_GetKeysetHandle, Aes128Gcm, &AeadKeyTemplates::Aes128Gcm)
+    ->Arg(1)
+    ->Arg(10)
+    ->Arg(100)
+    ->ThreadRange(1, kMaxThreads)
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace benchmarks
+}  // namespace tink
+}  // namespace crypto
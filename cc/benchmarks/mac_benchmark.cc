@@ -0,0 +1,137 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+// Benchmarks of the MAC primitives, both of the subtle implementation and of
+// the primitives obtained from keysets.
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "benchmark/benchmark.h"
+#include "tink/benchmarks/benchmark_util.h"
+#include "tink/mac.h"
+#include "tink/mac/mac_key_templates.h"
+#include "tink/subtle/common_enums.h"
+#include "tink/subtle/hmac_boringssl.h"
+#include "tink/subtle/random.h"
+#include "tink/util/statusor.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace benchmarks {
+namespace {
+
+using ::crypto::tink::subtle::Random;
+using ::google::crypto::tink::KeyTemplate;
+
+using MacFactory = util::StatusOr<std::unique_ptr<Mac>> (*)();
+using KeyTemplateFactory = const KeyTemplate& (*)();
+
+util::StatusOr<std::unique_ptr<Mac>> NewHmacSha256() {
+  return subtle::HmacBoringSsl::New(subtle::HashType::SHA256, 32,
+                                    Random::GetRandomKeyBytes(32));
+}
+
+util::StatusOr<std::unique_ptr<Mac>> NewHmacSha512() {
+  return subtle::HmacBoringSsl::New(subtle::HashType::SHA512, 64,
+                                    Random::GetRandomKeyBytes(64));
+}
+
+// Returns a primitive for a keyset with state.range(1) keys.
+util::StatusOr<std::unique_ptr<Mac>> NewKeysetMac(
+    benchmark::State& state, KeyTemplateFactory key_template) {
+  RegisterTinkOrDie();
+  auto handle_result = NewKeysetHandle(key_template(), state.range(1));
+  if (!handle_result.ok()) return handle_result.status();
+  return handle_result.ValueOrDie()->GetPrimitive<Mac>();
+}
+
+void ComputeLoop(benchmark::State& state, const Mac& mac) {
+  std::string data = Random::GetRandomBytes(state.range(0));
+  PerfCounters perf_counters;
+  for (auto _ : state) {
+    auto tag_result = mac.ComputeMac(data);
+    if (SkipWithError(state, tag_result.status())) break;
+    benchmark::DoNotOptimize(tag_result);
+  }
+  perf_counters.Report(state, state.range(0));
+  SetBytesProcessed(state, state.range(0));
+}
+
+void VerifyLoop(benchmark::State& state, const Mac& mac) {
+  std::string data = Random::GetRandomBytes(state.range(0));
+  auto tag_result = mac.ComputeMac(data);
+  if (SkipWithError(state, tag_result.status())) return;
+  std::string tag = tag_result.ValueOrDie();
+  PerfCounters perf_counters;
+  for (auto _ : state) {
+    if (SkipWithError(state, mac.VerifyMac(tag, data))) break;
+  }
+  perf_counters.Report(state, state.range(0));
+  SetBytesProcessed(state, state.range(0));
+}
+
+void BM_SubtleMacCompute(benchmark::State& state, MacFactory new_mac) {
+  auto mac_result = new_mac();
+  if (SkipWithError(state, mac_result.status())) return;
+  ComputeLoop(state, *mac_result.ValueOrDie());
+}
+
+void BM_SubtleMacVerify(benchmark::State& state, MacFactory new_mac) {
+  auto mac_result = new_mac();
+  if (SkipWithError(state, mac_result.status())) return;
+  VerifyLoop(state, *mac_result.ValueOrDie());
+}
+
+void BM_KeysetMacCompute(benchmark::State& state,
+                         KeyTemplateFactory key_template) {
+  auto mac_result = NewKeysetMac(state, key_template);
+  if (SkipWithError(state, mac_result.status())) return;
+  ComputeLoop(state, *mac_result.ValueOrDie());
+}
+
+void BM_KeysetMacVerify(benchmark::State& state,
+                        KeyTemplateFactory key_template) {
+  auto mac_result = NewKeysetMac(state, key_template);
+  if (SkipWithError(state, mac_result.status())) return;
+  VerifyLoop(state, *mac_result.ValueOrDie());
+}
+
+BENCHMARK_CAPTURE(BM_SubtleMacCompute, HmacSha256, &NewHmacSha256)
+    ->Apply(MessageSizes);
+BENCHMARK_CAPTURE(BM_SubtleMacVerify, HmacSha256, &NewHmacSha256)
+    ->Apply(MessageSizes);
+BENCHMARK_CAPTURE(BM_SubtleMacCompute, HmacSha512, &NewHmacSha512)
+    ->Apply(MessageSizes);
+BENCHMARK_CAPTURE(BM_SubtleMacVerify, HmacSha512, &NewHmacSha512)
+    ->Apply(MessageSizes);
+
+BENCHMARK_CAPTURE(BM_KeysetMacCompute, HmacSha256,
+                  &MacKeyTemplates::HmacSha256)
+    ->Apply(MessageSizesAndKeysetSizes);
+BENCHMARK_CAPTURE(BM_KeysetMacVerify, HmacSha256, &MacKeyTemplates::HmacSha256)
+    ->Apply(MessageSizesAndKeysetSizes);
+BENCHMARK_CAPTURE(BM_KeysetMacCompute, AesCmac, &MacKeyTemplates::AesCmac)
+    ->Apply(MessageSizesAndKeysetSizes);
+BENCHMARK_CAPTURE(BM_KeysetMacVerify, AesCmac, &MacKeyTemplates::AesCmac)
+    ->Apply(MessageSizesAndKeysetSizes);
+
+}  // namespace
+}  // namespace benchmarks
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,100 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+// Benchmarks of the derivation of output from the HKDF streaming PRF, compared
+// to the one-shot HKDF.
+
+#include <memory>
+#include <string>
+
+#include "benchmark/benchmark.h"
+#include "tink/benchmarks/benchmark_util.h"
+#include "tink/input_stream.h"
+#include "tink/subtle/common_enums.h"
+#include "tink/subtle/hkdf.h"
+#include "tink/subtle/prf/hkdf_streaming_prf.h"
+#include "tink/subtle/prf/streaming_prf.h"
+#include "tink/subtle/random.h"
+#include "tink/util/input_stream_util.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace benchmarks {
+namespace {
+
+using ::crypto::tink::subtle::HashType;
+using ::crypto::tink::subtle::Random;
+
+// Output sizes (state.range(0)) up to the largest HKDF-SHA256 output.
+void OutputSizes(benchmark::internal::Benchmark* benchmark) {
+  benchmark->RangeMultiplier(8)
+      ->Range(16, 255 * 32)
+      ->ThreadRange(1, kMaxThreads)
+      ->UseRealTime();
+}
+
+// Derives state.range(0) bytes for a new input in every iteration.
+void BM_HkdfStreamingPrf(benchmark::State& state, HashType hash) {
+  auto prf_result = subtle::HkdfStreamingPrf::New(
+      hash, Random::GetRandomKeyBytes(32), Random::GetRandomBytes(16));
+  if (SkipWithError(state, prf_result.status())) return;
+  const StreamingPrf& prf = *prf_result.ValueOrDie();
+  std::string input = Random::GetRandomBytes(16);
+  PerfCounters perf_counters;
+  for (auto _ : state) {
+    input[0]++;
+    std::unique_ptr<InputStream> stream = prf.ComputePrf(input);
+    auto output_result = ReadBytesFromStream(state.range(0), stream.get());
+    if (SkipWithError(state, output_result.status())) break;
+    benchmark::DoNotOptimize(output_result);
+  }
+  perf_counters.Report(state, state.range(0));
+  SetBytesProcessed(state, state.range(0));
+}
+
+// The same derivations with the one-shot HKDF, which also derives the
+// pseudorandom key for every output.
+void BM_ComputeHkdf(benchmark::State& state, HashType hash) {
+  util::SecretData secret = Random::GetRandomKeyBytes(32);
+  std::string salt = Random::GetRandomBytes(16);
+  std::string input = Random::GetRandomBytes(16);
+  PerfCounters perf_counters;
+  for (auto _ : state) {
+    input[0]++;
+    auto output_result =
+        subtle::Hkdf::ComputeHkdf(hash, secret, salt, input, state.range(0));
+    if (SkipWithError(state, output_result.status())) break;
+    benchmark::DoNotOptimize(output_result);
+  }
+  perf_counters.Report(state, state.range(0));
+  SetBytesProcessed(state, state.range(0));
+}
+
+BENCHMARK_CAPTURE(BM_HkdfStreamingPrf, Sha256, HashType::SHA256)
+    ->Apply(OutputSizes);
+BENCHMARK_CAPTURE(BM_HkdfStreamingPrf, Sha512, HashType::SHA512)
+    ->Apply(OutputSizes);
+BENCHMARK_CAPTURE(BM_ComputeHkdf, Sha256, HashType::SHA256)
+    ->Apply(OutputSizes);
+BENCHMARK_CAPTURE(BM_ComputeHkdf, Sha512, HashType::SHA512)
+    ->Apply(OutputSizes);
+
+}  // namespace
+}  // namespace benchmarks
+}  // namespace tink
+}  // namespace crypto
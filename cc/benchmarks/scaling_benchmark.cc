@@ -0,0 +1,495 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+// Benchmarks of how the parts of Tink which threads share scale with the
+// number of threads: the primitives of a keyset, whose PrimitiveSet all
+// threads look up, the registry, and a decrypting random access stream. All
+// threads of a benchmark use one object, from 1 to kMaxScalingThreads threads,
+// for keysets of 1, 10 and 100 keys (state.range(0)).
+//
+// Besides the ops per second (items_per_second), the benchmarks report
+//   scaling_efficiency: the ops per second, divided by the number of threads
+//     times the ops per second of the single thread run; 1 is linear scaling.
+//   lock_waits and lock_wait_cycles: how often, per op, a thread waited for
+//     an absl::Mutex, and for how many cycles of absl's cycle clock, as
+//     reported to absl::RegisterMutexProfiler().
+//   numa_nodes: the number of NUMA nodes which the threads run on.
+//
+// Each thread is pinned to one of the CPUs which the process may run on,
+// filling one NUMA node after the other, so that the point where the threads
+// spill to the next node shows in the results. Run the benchmark under
+// taskset or numactl to choose the CPUs.
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "benchmark/benchmark.h"
+#include "tink/aead.h"
+#include "tink/aead/aead_key_templates.h"
+#include "tink/benchmarks/benchmark_util.h"
+#include "tink/internal/numa.h"
+#include "tink/keyset_handle.h"
+#include "tink/mac.h"
+#include "tink/mac/mac_key_templates.h"
+#include "tink/random_access_stream.h"
+#include "tink/registry.h"
+#include "tink/streaming_aead.h"
+#include "tink/streamingaead/streaming_aead_key_templates.h"
+#include "tink/subtle/random.h"
+#include "tink/subtle/test_util.h"
+#include "tink/util/buffer.h"
+#include "tink/util/ostream_output_stream.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace benchmarks {
+namespace {
+
+using ::crypto::tink::subtle::Random;
+using ::google::crypto::tink::KeyData;
+
+// Goes beyond kMaxThreads, since contention often only shows with many
+// threads.
+constexpr int kMaxScalingThreads = 64;
+constexpr int kMessageSize = 64;
+constexpr char kAssociatedData[] = "associated data";
+
+std::atomic<int64_t> lock_waits(0);
+std::atomic<int64_t> lock_wait_cycles(0);
+
+void RecordLockWait(int64_t wait_cycles) {
+  lock_waits.fetch_add(1, std::memory_order_relaxed);
+  lock_wait_cycles.fetch_add(wait_cycles, std::memory_order_relaxed);
+}
+
+// Returns the CPUs which the calling thread may run on, node by node, and
+// their NUMA nodes.
+std::vector<std::pair<int, int>> CpusAndNodes() {
+  std::vector<std::pair<int, int>> cpus_and_nodes;
+#if defined(__linux__)
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0) {
+    return cpus_and_nodes;
+  }
+  const internal::NumaTopology& topology = internal::NumaTopology::Get();
+  for (int node = 0; node < topology.num_nodes(); ++node) {
+    for (int cpu : topology.cpus(node)) {
+      if (cpu >= 0 && cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed)) {
+        cpus_and_nodes.emplace_back(cpu, node);
+        CPU_CLR(cpu, &allowed);
+      }
+    }
+  }
+  // CPUs of no node, if sysfs is incomplete.
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (CPU_ISSET(cpu, &allowed)) cpus_and_nodes.emplace_back(cpu, 0);
+  }
+#endif
+  return cpus_and_nodes;
+}
+
+// Returns the number of NUMA nodes which 'threads' threads pinned by
+// ScopedCpuPin run on.
+int NumaNodesOfThreads(int threads) {
+  std::vector<std::pair<int, int>> cpus_and_nodes = CpusAndNodes();
+  std::set<int> nodes;
+  for (int i = 0; i < threads && i < cpus_and_nodes.size(); ++i) {
+    nodes.insert(cpus_and_nodes[i].second);
+  }
+  return std::max<int>(nodes.size(), 1);
+}
+
+// Pins the calling thread to the CPU at 'thread_index' (modulo their number)
+// in CpusAndNodes(), and restores its affinity when destroyed. The benchmark
+// runs thread 0 on the main thread, from which the other threads inherit
+// their affinity, so the affinity must be restored for the next run.
+class ScopedCpuPin {
+ public:
+#if defined(__linux__)
+  explicit ScopedCpuPin(int thread_index) {
+    CPU_ZERO(&original_);
+    if (sched_getaffinity(0, sizeof(original_), &original_) != 0) return;
+    std::vector<std::pair<int, int>> cpus_and_nodes = CpusAndNodes();
+    if (cpus_and_nodes.empty()) return;
+    cpu_set_t pinned;
+    CPU_ZERO(&pinned);
+    CPU_SET(cpus_and_nodes[thread_index % cpus_and_nodes.size()].first,
+            &pinned);
+    pinned_ = sched_setaffinity(0, sizeof(pinned), &pinned) == 0;
+  }
+
+  ~ScopedCpuPin() {
+    if (pinned_) sched_setaffinity(0, sizeof(original_), &original_);
+  }
+
+ private:
+  cpu_set_t original_;
+  bool pinned_ = false;
+#else
+  // Threads are not pinned on other platforms.
+  explicit ScopedCpuPin(int thread_index) {}
+#endif
+};
+
+// Returns the ops per second of the single thread run of the benchmark
+// 'name', after recording 'ops_per_second' as that if 'threads' is 1.
+// Returns 0 if there was no single thread run, e.g. due to a filter.
+double SingleThreadOpsPerSecond(const std::string& name, int threads,
+                                double ops_per_second) {
+  static absl::Mutex* mutex = new absl::Mutex();
+  static std::map<std::string, double>* rates =
+      new std::map<std::string, double>();
+  absl::MutexLock lock(mutex);
+  if (threads == 1) (*rates)[name] = ops_per_second;
+  auto it = rates->find(name);
+  return it == rates->end() ? 0 : it->second;
+}
+
+// Pins the thread and, on thread 0, measures the run of a benchmark from its
+// construction, right before the benchmark loop, to its destruction, right
+// after the loop. Since all threads run the same number of iterations, thread
+// 0 can report the counters for all of them. 'name' identifies the benchmark
+// and its arguments, to find the matching single thread run.
+class ScalingRun {
+ public:
+  ScalingRun(benchmark::State& state, std::string name)
+      : state_(state),
+        name_(std::move(name)),
+        numa_nodes_(NumaNodesOfThreads(state.threads)),
+        pin_(state.thread_index) {
+    if (state_.thread_index != 0) return;
+    static const bool profiler_registered = RegisterProfiler();
+    (void)profiler_registered;
+    lock_waits_ = lock_waits.load();
+    lock_wait_cycles_ = lock_wait_cycles.load();
+    start_ = absl::Now();
+  }
+
+  ~ScalingRun() {
+    state_.SetItemsProcessed(state_.iterations());
+    if (state_.thread_index != 0 || state_.error_occurred() ||
+        state_.iterations() == 0) {
+      return;
+    }
+    double seconds = absl::ToDoubleSeconds(absl::Now() - start_);
+    double ops = static_cast<double>(state_.iterations()) * state_.threads;
+    state_.counters["lock_waits"] = (lock_waits.load() - lock_waits_) / ops;
+    state_.counters["lock_wait_cycles"] =
+        (lock_wait_cycles.load() - lock_wait_cycles_) / ops;
+    state_.counters["numa_nodes"] = numa_nodes_;
+    double single_thread_ops_per_second =
+        SingleThreadOpsPerSecond(name_, state_.threads, ops / seconds);
+    if (single_thread_ops_per_second > 0) {
+      state_.counters["scaling_efficiency"] =
+          ops / seconds / (state_.threads * single_thread_ops_per_second);
+    }
+  }
+
+ private:
+  static bool RegisterProfiler() {
+    absl::RegisterMutexProfiler(&RecordLockWait);
+    return true;
+  }
+
+  benchmark::State& state_;
+  const std::string name_;
+  // Computed before pin_ restricts the affinity of the thread.
+  const int numa_nodes_;
+  ScopedCpuPin pin_;
+  int64_t lock_waits_ = 0;
+  int64_t lock_wait_cycles_ = 0;
+  absl::Time start_;
+};
+
+// An object which thread 0 sets up with 'set_up' before the benchmark loop,
+// and which all threads may use once the loop has started.
+template <class T>
+class Shared {
+ public:
+  using SetUp = util::StatusOr<std::unique_ptr<T>> (*)(benchmark::State&);
+
+  Shared(benchmark::State& state, SetUp set_up) : state_(state) {
+    if (state_.thread_index == 0) {
+      *Slot() = new util::StatusOr<std::unique_ptr<T>>(set_up(state));
+    }
+  }
+
+  ~Shared() {
+    if (state_.thread_index == 0) {
+      delete *Slot();
+      *Slot() = nullptr;
+    }
+  }
+
+  // Returns the object, or marks the benchmark as failed and returns null if
+  // setting it up failed. Only valid inside the benchmark loop.
+  T* Get() {
+    const util::StatusOr<std::unique_ptr<T>>& result = **Slot();
+    if (SkipWithError(state_, result.status())) return nullptr;
+    return result.ValueOrDie().get();
+  }
+
+ private:
+  static util::StatusOr<std::unique_ptr<T>>** Slot() {
+    static util::StatusOr<std::unique_ptr<T>>* slot = nullptr;
+    return &slot;
+  }
+
+  benchmark::State& state_;
+};
+
+struct AeadSetUp {
+  std::unique_ptr<Aead> aead;
+  std::string plaintext;
+  std::string ciphertext;
+};
+
+util::StatusOr<std::unique_ptr<AeadSetUp>> SetUpAead(
+    benchmark::State& state) {
+  RegisterTinkOrDie();
+  auto handle_result =
+      NewKeysetHandle(AeadKeyTemplates::Aes128Gcm(), state.range(0));
+  if (!handle_result.ok()) return handle_result.status();
+  auto aead_result = handle_result.ValueOrDie()->GetPrimitive<Aead>();
+  if (!aead_result.ok()) return aead_result.status();
+  auto set_up = absl::make_unique<AeadSetUp>();
+  set_up->aead = std::move(aead_result.ValueOrDie());
+  set_up->plaintext = Random::GetRandomBytes(kMessageSize);
+  auto ciphertext_result =
+      set_up->aead->Encrypt(set_up->plaintext, kAssociatedData);
+  if (!ciphertext_result.ok()) return ciphertext_result.status();
+  set_up->ciphertext = ciphertext_result.ValueOrDie();
+  return std::move(set_up);
+}
+
+void BM_AeadEncrypt(benchmark::State& state) {
+  Shared<AeadSetUp> shared(state, &SetUpAead);
+  ScalingRun run(state, absl::StrCat("AeadEncrypt/", state.range(0)));
+  for (auto _ : state) {
+    AeadSetUp* set_up = shared.Get();
+    if (set_up == nullptr) break;
+    auto result = set_up->aead->Encrypt(set_up->plaintext, kAssociatedData);
+    if (SkipWithError(state, result.status())) break;
+    benchmark::DoNotOptimize(result);
+  }
+}
+
+// Looks up the primitives for the ciphertext's key prefix in the keyset's
+// PrimitiveSet in each iteration.
+void BM_AeadDecrypt(benchmark::State& state) {
+  Shared<AeadSetUp> shared(state, &SetUpAead);
+  ScalingRun run(state, absl::StrCat("AeadDecrypt/", state.range(0)));
+  for (auto _ : state) {
+    AeadSetUp* set_up = shared.Get();
+    if (set_up == nullptr) break;
+    auto result = set_up->aead->Decrypt(set_up->ciphertext, kAssociatedData);
+    if (SkipWithError(state, result.status())) break;
+    benchmark::DoNotOptimize(result);
+  }
+}
+
+struct MacSetUp {
+  std::unique_ptr<Mac> mac;
+  std::string data;
+  std::string tag;
+};
+
+util::StatusOr<std::unique_ptr<MacSetUp>> SetUpMac(benchmark::State& state) {
+  RegisterTinkOrDie();
+  auto handle_result =
+      NewKeysetHandle(MacKeyTemplates::HmacSha256(), state.range(0));
+  if (!handle_result.ok()) return handle_result.status();
+  auto mac_result = handle_result.ValueOrDie()->GetPrimitive<Mac>();
+  if (!mac_result.ok()) return mac_result.status();
+  auto set_up = absl::make_unique<MacSetUp>();
+  set_up->mac = std::move(mac_result.ValueOrDie());
+  set_up->data = Random::GetRandomBytes(kMessageSize);
+  auto tag_result = set_up->mac->ComputeMac(set_up->data);
+  if (!tag_result.ok()) return tag_result.status();
+  set_up->tag = tag_result.ValueOrDie();
+  return std::move(set_up);
+}
+
+void BM_MacCompute(benchmark::State& state) {
+  Shared<MacSetUp> shared(state, &SetUpMac);
+  ScalingRun run(state, absl::StrCat("MacCompute/", state.range(0)));
+  for (auto _ : state) {
+    MacSetUp* set_up = shared.Get();
+    if (set_up == nullptr) break;
+    auto result = set_up->mac->ComputeMac(set_up->data);
+    if (SkipWithError(state, result.status())) break;
+    benchmark::DoNotOptimize(result);
+  }
+}
+
+void BM_MacVerify(benchmark::State& state) {
+  Shared<MacSetUp> shared(state, &SetUpMac);
+  ScalingRun run(state, absl::StrCat("MacVerify/", state.range(0)));
+  for (auto _ : state) {
+    MacSetUp* set_up = shared.Get();
+    if (set_up == nullptr) break;
+    if (SkipWithError(state, set_up->mac->VerifyMac(set_up->tag,
+                                                    set_up->data))) {
+      break;
+    }
+  }
+}
+
+util::StatusOr<std::unique_ptr<KeysetHandle>> SetUpAeadKeyset(
+    benchmark::State& state) {
+  RegisterTinkOrDie();
+  return NewKeysetHandle(AeadKeyTemplates::Aes128Gcm(), state.range(0));
+}
+
+// Gets the keyset's primitive in each iteration, which looks up the key
+// manager and the wrapper in the registry and fills a PrimitiveSet.
+void BM_KeysetGetPrimitive(benchmark::State& state) {
+  Shared<KeysetHandle> shared(state, &SetUpAeadKeyset);
+  ScalingRun run(state, absl::StrCat("KeysetGetPrimitive/", state.range(0)));
+  for (auto _ : state) {
+    KeysetHandle* handle = shared.Get();
+    if (handle == nullptr) break;
+    auto result = handle->GetPrimitive<Aead>();
+    if (SkipWithError(state, result.status())) break;
+    benchmark::DoNotOptimize(result);
+  }
+}
+
+util::StatusOr<std::unique_ptr<KeyData>> SetUpAeadKeyData(
+    benchmark::State& state) {
+  RegisterTinkOrDie();
+  return Registry::NewKeyData(AeadKeyTemplates::Aes128Gcm());
+}
+
+// Gets the primitive for a single key from the registry in each iteration.
+void BM_RegistryGetPrimitive(benchmark::State& state) {
+  Shared<KeyData> shared(state, &SetUpAeadKeyData);
+  ScalingRun run(state, "RegistryGetPrimitive");
+  for (auto _ : state) {
+    KeyData* key_data = shared.Get();
+    if (key_data == nullptr) break;
+    auto result = Registry::GetPrimitive<Aead>(*key_data);
+    if (SkipWithError(state, result.status())) break;
+    benchmark::DoNotOptimize(result);
+  }
+}
+
+constexpr int kSegmentSize = 4096;
+constexpr int64_t kPReadPlaintextSize = 256 * kSegmentSize;
+constexpr int kPReadSize = 1024;
+
+struct StreamSetUp {
+  std::unique_ptr<StreamingAead> streaming_aead;
+  std::string ciphertext;
+  std::unique_ptr<RandomAccessStream> stream;
+};
+
+// Returns a decrypting random access stream over a ciphertext of
+// kPReadPlaintextSize bytes, whose matching key has already been found.
+util::StatusOr<std::unique_ptr<StreamSetUp>> SetUpStream(
+    benchmark::State& state) {
+  RegisterTinkOrDie();
+  auto handle_result = NewKeysetHandle(
+      StreamingAeadKeyTemplates::Aes128GcmHkdf4KB(), state.range(0));
+  if (!handle_result.ok()) return handle_result.status();
+  auto streaming_aead_result =
+      handle_result.ValueOrDie()->GetPrimitive<StreamingAead>();
+  if (!streaming_aead_result.ok()) return streaming_aead_result.status();
+  auto set_up = absl::make_unique<StreamSetUp>();
+  set_up->streaming_aead = std::move(streaming_aead_result.ValueOrDie());
+  auto ciphertext_stream = absl::make_unique<std::ostringstream>();
+  std::ostringstream* ciphertext = ciphertext_stream.get();
+  auto encrypting_result = set_up->streaming_aead->NewEncryptingStream(
+      absl::make_unique<util::OstreamOutputStream>(
+          std::move(ciphertext_stream)),
+      kAssociatedData);
+  if (!encrypting_result.ok()) return encrypting_result.status();
+  auto status =
+      subtle::test::WriteToStream(encrypting_result.ValueOrDie().get(),
+                                  Random::GetRandomBytes(kPReadPlaintextSize));
+  if (!status.ok()) return status;
+  set_up->ciphertext = ciphertext->str();
+  auto stream_result = set_up->streaming_aead->NewDecryptingRandomAccessStream(
+      absl::make_unique<StringViewRandomAccessStream>(set_up->ciphertext),
+      kAssociatedData);
+  if (!stream_result.ok()) return stream_result.status();
+  set_up->stream = std::move(stream_result.ValueOrDie());
+  // The first read finds the matching key.
+  auto buffer = std::move(util::Buffer::New(kPReadSize).ValueOrDie());
+  status = set_up->stream->PRead(0, kPReadSize, buffer.get());
+  if (!status.ok()) return status;
+  return std::move(set_up);
+}
+
+void BM_DecryptingRandomAccessStreamPRead(benchmark::State& state) {
+  Shared<StreamSetUp> shared(state, &SetUpStream);
+  auto buffer = std::move(util::Buffer::New(kPReadSize).ValueOrDie());
+  // Spreads the threads over distinct segments.
+  int64_t position =
+      (state.thread_index * kSegmentSize) % kPReadPlaintextSize;
+  ScalingRun run(state, absl::StrCat("DecryptingRandomAccessStreamPRead/",
+                                     state.range(0)));
+  for (auto _ : state) {
+    StreamSetUp* set_up = shared.Get();
+    if (set_up == nullptr) break;
+    auto status = set_up->stream->PRead(position, kPReadSize, buffer.get());
+    if (SkipWithError(state, status)) break;
+    position = (position + kSegmentSize) % kPReadPlaintextSize;
+  }
+  SetBytesProcessed(state, kPReadSize);
+}
+
+void KeysetSizesAndThreads(benchmark::internal::Benchmark* benchmark) {
+  benchmark->Arg(1)->Arg(10)->Arg(100)
+      ->ThreadRange(1, kMaxScalingThreads)
+      ->UseRealTime();
+}
+
+BENCHMARK(BM_AeadEncrypt)->Apply(KeysetSizesAndThreads);
+BENCHMARK(BM_AeadDecrypt)->Apply(KeysetSizesAndThreads);
+BENCHMARK(BM_MacCompute)->Apply(KeysetSizesAndThreads);
+BENCHMARK(BM_MacVerify)->Apply(KeysetSizesAndThreads);
+BENCHMARK(BM_KeysetGetPrimitive)->Apply(KeysetSizesAndThreads);
+BENCHMARK(BM_RegistryGetPrimitive)
+    ->ThreadRange(1, kMaxScalingThreads)
+    ->UseRealTime();
+BENCHMARK(BM_DecryptingRandomAccessStreamPRead)
+    ->Apply(KeysetSizesAndThreads);
+
+}  // namespace
+}  // namespace benchmarks
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,215 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+// Benchmarks of the signature primitives, both of the subtle implementations
+// and of the primitives obtained from keysets.
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "benchmark/benchmark.h"
+#include "tink/benchmarks/benchmark_util.h"
+#include "tink/public_key_sign.h"
+#include "tink/public_key_verify.h"
+#include "tink/signature/ecdsa_sign_key_manager.h"
+#include "tink/signature/ecdsa_verify_key_manager.h"
+#include "tink/signature/ed25519_sign_key_manager.h"
+#include "tink/signature/ed25519_verify_key_manager.h"
+#include "tink/signature/rsa_ssa_pkcs1_sign_key_manager.h"
+#include "tink/signature/rsa_ssa_pkcs1_verify_key_manager.h"
+#include "tink/signature/rsa_ssa_pss_sign_key_manager.h"
+#include "tink/signature/rsa_ssa_pss_verify_key_manager.h"
+#include "tink/signature/signature_key_templates.h"
+#include "tink/subtle/random.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace benchmarks {
+namespace {
+
+using ::crypto::tink::subtle::Random;
+using ::google::crypto::tink::KeyTemplate;
+
+using KeyTemplateFactory = const KeyTemplate& (*)();
+
+// A signer together with the matching verifier.
+struct SignaturePair {
+  std::unique_ptr<PublicKeySign> signer;
+  std::unique_ptr<PublicKeyVerify> verifier;
+};
+
+using SignaturePairFactory = util::StatusOr<SignaturePair> (*)();
+
+// Creates the subtle signer and verifier for a fresh key generated according
+// to 'key_template', without going through a keyset.
+template <class SignKeyManager, class VerifyKeyManager>
+util::StatusOr<SignaturePair> NewSubtleSignaturePair(
+    const KeyTemplate& key_template) {
+  SignKeyManager sign_key_manager;
+  typename SignKeyManager::KeyFormatProto key_format;
+  if (!key_format.ParseFromString(key_template.value())) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "invalid key format in key template");
+  }
+  auto key_result = sign_key_manager.CreateKey(key_format);
+  if (!key_result.ok()) return key_result.status();
+  auto public_key_result =
+      sign_key_manager.GetPublicKey(key_result.ValueOrDie());
+  if (!public_key_result.ok()) return public_key_result.status();
+
+  SignaturePair pair;
+  auto signer_result = sign_key_manager.template GetPrimitive<PublicKeySign>(
+      key_result.ValueOrDie());
+  if (!signer_result.ok()) return signer_result.status();
+  pair.signer = std::move(signer_result.ValueOrDie());
+  auto verifier_result =
+      VerifyKeyManager().template GetPrimitive<PublicKeyVerify>(
+          public_key_result.ValueOrDie());
+  if (!verifier_result.ok()) return verifier_result.status();
+  pair.verifier = std::move(verifier_result.ValueOrDie());
+  return std::move(pair);
+}
+
+util::StatusOr<SignaturePair> NewEcdsaP256() {
+  return NewSubtleSignaturePair<EcdsaSignKeyManager, EcdsaVerifyKeyManager>(
+      SignatureKeyTemplates::EcdsaP256());
+}
+
+util::StatusOr<SignaturePair> NewEd25519() {
+  return NewSubtleSignaturePair<Ed25519SignKeyManager,
+                                Ed25519VerifyKeyManager>(
+      SignatureKeyTemplates::Ed25519());
+}
+
+util::StatusOr<SignaturePair> NewRsaSsaPss3072() {
+  return NewSubtleSignaturePair<RsaSsaPssSignKeyManager,
+                                RsaSsaPssVerifyKeyManager>(
+      SignatureKeyTemplates::RsaSsaPss3072Sha256Sha256F4());
+}
+
+util::StatusOr<SignaturePair> NewRsaSsaPkcs13072() {
+  return NewSubtleSignaturePair<RsaSsaPkcs1SignKeyManager,
+                                RsaSsaPkcs1VerifyKeyManager>(
+      SignatureKeyTemplates::RsaSsaPkcs13072Sha256F4());
+}
+
+// Returns the primitives for a keyset with state.range(1) keys.
+util::StatusOr<SignaturePair> NewKeysetSignaturePair(
+    benchmark::State& state, KeyTemplateFactory key_template) {
+  RegisterTinkOrDie();
+  auto handle_result = NewKeysetHandle(key_template(), state.range(1));
+  if (!handle_result.ok()) return handle_result.status();
+  auto public_handle_result =
+      handle_result.ValueOrDie()->GetPublicKeysetHandle();
+  if (!public_handle_result.ok()) return public_handle_result.status();
+
+  SignaturePair pair;
+  auto signer_result =
+      handle_result.ValueOrDie()->GetPrimitive<PublicKeySign>();
+  if (!signer_result.ok()) return signer_result.status();
+  pair.signer = std::move(signer_result.ValueOrDie());
+  auto verifier_result =
+      public_handle_result.ValueOrDie()->GetPrimitive<PublicKeyVerify>();
+  if (!verifier_result.ok()) return verifier_result.status();
+  pair.verifier = std::move(verifier_result.ValueOrDie());
+  return std::move(pair);
+}
+
+void SignLoop(benchmark::State& state, const PublicKeySign& signer) {
+  std::string data = Random::GetRandomBytes(state.range(0));
+  PerfCounters perf_counters;
+  for (auto _ : state) {
+    auto signature_result = signer.Sign(data);
+    if (SkipWithError(state, signature_result.status())) break;
+    benchmark::DoNotOptimize(signature_result);
+  }
+  perf_counters.Report(state, state.range(0));
+  SetBytesProcessed(state, state.range(0));
+}
+
+void VerifyLoop(benchmark::State& state, const SignaturePair& pair) {
+  std::string data = Random::GetRandomBytes(state.range(0));
+  auto signature_result = pair.signer->Sign(data);
+  if (SkipWithError(state, signature_result.status())) return;
+  std::string signature = signature_result.ValueOrDie();
+  PerfCounters perf_counters;
+  for (auto _ : state) {
+    if (SkipWithError(state, pair.verifier->Verify(signature, data))) break;
+  }
+  perf_counters.Report(state, state.range(0));
+  SetBytesProcessed(state, state.range(0));
+}
+
+void BM_SubtleSign(benchmark::State& state, SignaturePairFactory new_pair) {
+  auto pair_result = new_pair();
+  if (SkipWithError(state, pair_result.status())) return;
+  SignLoop(state, *pair_result.ValueOrDie().signer);
+}
+
+void BM_SubtleVerify(benchmark::State& state, SignaturePairFactory new_pair) {
+  auto pair_result = new_pair();
+  if (SkipWithError(state, pair_result.status())) return;
+  VerifyLoop(state, pair_result.ValueOrDie());
+}
+
+void BM_KeysetSign(benchmark::State& state, KeyTemplateFactory key_template) {
+  auto pair_result = NewKeysetSignaturePair(state, key_template);
+  if (SkipWithError(state, pair_result.status())) return;
+  SignLoop(state, *pair_result.ValueOrDie().signer);
+}
+
+void BM_KeysetVerify(benchmark::State& state,
+                     KeyTemplateFactory key_template) {
+  auto pair_result = NewKeysetSignaturePair(state, key_template);
+  if (SkipWithError(state, pair_result.status())) return;
+  VerifyLoop(state, pair_result.ValueOrDie());
+}
+
+BENCHMARK_CAPTURE(BM_SubtleSign, EcdsaP256, &NewEcdsaP256)
+    ->Apply(MessageSizes);
+BENCHMARK_CAPTURE(BM_SubtleVerify, EcdsaP256, &NewEcdsaP256)
+    ->Apply(MessageSizes);
+BENCHMARK_CAPTURE(BM_SubtleSign, Ed25519, &NewEd25519)->Apply(MessageSizes);
+BENCHMARK_CAPTURE(BM_SubtleVerify, Ed25519, &NewEd25519)->Apply(MessageSizes);
+BENCHMARK_CAPTURE(BM_SubtleSign, RsaSsaPss3072, &NewRsaSsaPss3072)
+    ->Apply(MessageSizes);
+BENCHMARK_CAPTURE(BM_SubtleVerify, RsaSsaPss3072, &NewRsaSsaPss3072)
+    ->Apply(MessageSizes);
+BENCHMARK_CAPTURE(BM_SubtleSign, RsaSsaPkcs13072, &NewRsaSsaPkcs13072)
+    ->Apply(MessageSizes);
+BENCHMARK_CAPTURE(BM_SubtleVerify, RsaSsaPkcs13072, &NewRsaSsaPkcs13072)
+    ->Apply(MessageSizes);
+
+// Keysets of RSA keys are not benchmarked, since generating 100 RSA keys per
+// thread would dominate the running time.
+BENCHMARK_CAPTURE(BM_KeysetSign, EcdsaP256, &SignatureKeyTemplates::EcdsaP256)
+    ->Apply(MessageSizesAndKeysetSizes);
+BENCHMARK_CAPTURE(BM_KeysetVerify, EcdsaP256,
+                  &SignatureKeyTemplates::EcdsaP256)
+    ->Apply(MessageSizesAndKeysetSizes);
+BENCHMARK_CAPTURE(BM_KeysetSign, Ed25519, &SignatureKeyTemplates::Ed25519)
+    ->Apply(MessageSizesAndKeysetSizes);
+BENCHMARK_CAPTURE(BM_KeysetVerify, Ed25519, &SignatureKeyTemplates::Ed25519)
+    ->Apply(MessageSizesAndKeysetSizes);
+
+}  // namespace
+}  // namespace benchmarks
+}  // namespace tink
+}  // namespace crypto
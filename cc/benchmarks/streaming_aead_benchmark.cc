@@ -0,0 +1,347 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+// Benchmarks of the streaming AEAD primitives, both of the subtle
+// implementations and of the primitives obtained from keysets.
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "benchmark/benchmark.h"
+#include "tink/benchmarks/benchmark_util.h"
+#include "tink/input_stream.h"
+#include "tink/output_stream.h"
+#include "tink/random_access_stream.h"
+#include "tink/streaming_aead.h"
+#include "tink/streamingaead/streaming_aead_key_templates.h"
+#include "tink/subtle/aes_ctr_hmac_streaming.h"
+#include "tink/subtle/aes_gcm_hkdf_streaming.h"
+#include "tink/subtle/common_enums.h"
+#include "tink/subtle/random.h"
+#include "tink/util/buffer.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace benchmarks {
+namespace {
+
+using ::crypto::tink::subtle::Random;
+using ::google::crypto::tink::KeyTemplate;
+
+constexpr char kAssociatedData[] = "associated data";
+constexpr int kBufferSize = 64 * 1024;
+constexpr int kSegmentSize = 4096;
+
+using StreamingAeadFactory =
+    util::StatusOr<std::unique_ptr<StreamingAead>> (*)();
+using KeyTemplateFactory = const KeyTemplate& (*)();
+
+// An OutputStream which appends the written bytes to 'sink', or discards them
+// if 'sink' is null, so that only the encryption itself is measured.
+class BufferOutputStream : public OutputStream {
+ public:
+  explicit BufferOutputStream(std::string* sink)
+      : sink_(sink), buffer_(kBufferSize) {}
+
+  util::StatusOr<int> Next(void** data) override {
+    Flush();
+    *data = buffer_.data();
+    pending_ = buffer_.size();
+    return pending_;
+  }
+
+  void BackUp(int count) override {
+    pending_ -= std::min(count, pending_);
+  }
+
+  util::Status Close() override {
+    Flush();
+    return util::OkStatus();
+  }
+
+  int64_t Position() const override { return position_ + pending_; }
+
+ private:
+  void Flush() {
+    if (sink_ != nullptr) sink_->append(buffer_.data(), pending_);
+    position_ += pending_;
+    pending_ = 0;
+  }
+
+  std::string* sink_;
+  std::vector<char> buffer_;
+  int pending_ = 0;
+  int64_t position_ = 0;
+};
+
+// An InputStream reading from a string_view, without copying it.
+class StringViewInputStream : public InputStream {
+ public:
+  explicit StringViewInputStream(absl::string_view data) : data_(data) {}
+
+  util::StatusOr<int> Next(const void** data) override {
+    if (position_ == data_.size()) {
+      return util::Status(util::error::OUT_OF_RANGE, "EOF");
+    }
+    int count = std::min<size_t>(kBufferSize, data_.size() - position_);
+    *data = data_.data() + position_;
+    position_ += count;
+    return count;
+  }
+
+  void BackUp(int count) override {
+    position_ -= std::min<size_t>(count, position_);
+  }
+
+  int64_t Position() const override { return position_; }
+
+ private:
+  absl::string_view data_;
+  size_t position_ = 0;
+};
+
+util::StatusOr<std::unique_ptr<StreamingAead>> NewAesGcmHkdf() {
+  subtle::AesGcmHkdfStreaming::Params params;
+  params.ikm = Random::GetRandomKeyBytes(32);
+  params.hkdf_hash = subtle::HashType::SHA256;
+  params.derived_key_size = 16;
+  params.ciphertext_segment_size = kSegmentSize;
+  params.ciphertext_offset = 0;
+  auto result = subtle::AesGcmHkdfStreaming::New(std::move(params));
+  if (!result.ok()) return result.status();
+  return std::unique_ptr<StreamingAead>(std::move(result.ValueOrDie()));
+}
+
+util::StatusOr<std::unique_ptr<StreamingAead>> NewAesCtrHmac() {
+  subtle::AesCtrHmacStreaming::Params params;
+  params.ikm = Random::GetRandomKeyBytes(32);
+  params.hkdf_algo = subtle::HashType::SHA256;
+  params.key_size = 16;
+  params.ciphertext_segment_size = kSegmentSize;
+  params.ciphertext_offset = 0;
+  params.tag_algo = subtle::HashType::SHA256;
+  params.tag_size = 16;
+  auto result = subtle::AesCtrHmacStreaming::New(std::move(params));
+  if (!result.ok()) return result.status();
+  return std::unique_ptr<StreamingAead>(std::move(result.ValueOrDie()));
+}
+
+// Returns a primitive for a keyset with state.range(1) keys.
+util::StatusOr<std::unique_ptr<StreamingAead>> NewKeysetStreamingAead(
+    benchmark::State& state, KeyTemplateFactory key_template) {
+  RegisterTinkOrDie();
+  auto handle_result = NewKeysetHandle(key_template(), state.range(1));
+  if (!handle_result.ok()) return handle_result.status();
+  return handle_result.ValueOrDie()->GetPrimitive<StreamingAead>();
+}
+
+// Encrypts 'plaintext', appending the ciphertext to 'ciphertext' unless it is
+// null.
+util::Status Encrypt(StreamingAead* streaming_aead,
+                     absl::string_view plaintext, std::string* ciphertext) {
+  auto stream_result = streaming_aead->NewEncryptingStream(
+      absl::make_unique<BufferOutputStream>(ciphertext), kAssociatedData);
+  if (!stream_result.ok()) return stream_result.status();
+  auto stream = std::move(stream_result.ValueOrDie());
+  while (!plaintext.empty()) {
+    void* buffer;
+    auto next_result = stream->Next(&buffer);
+    if (!next_result.ok()) return next_result.status();
+    int count = std::min<size_t>(next_result.ValueOrDie(), plaintext.size());
+    std::memcpy(buffer, plaintext.data(), count);
+    stream->BackUp(next_result.ValueOrDie() - count);
+    plaintext.remove_prefix(count);
+  }
+  return stream->Close();
+}
+
+// Decrypts 'ciphertext' and returns the size of the plaintext.
+util::StatusOr<int64_t> Decrypt(StreamingAead* streaming_aead,
+                                absl::string_view ciphertext) {
+  auto stream_result = streaming_aead->NewDecryptingStream(
+      absl::make_unique<StringViewInputStream>(ciphertext), kAssociatedData);
+  if (!stream_result.ok()) return stream_result.status();
+  auto stream = std::move(stream_result.ValueOrDie());
+  int64_t size = 0;
+  while (true) {
+    const void* buffer;
+    auto next_result = stream->Next(&buffer);
+    if (next_result.status().error_code() == util::error::OUT_OF_RANGE) {
+      return size;
+    }
+    if (!next_result.ok()) return next_result.status();
+    benchmark::DoNotOptimize(buffer);
+    size += next_result.ValueOrDie();
+  }
+}
+
+void EncryptLoop(benchmark::State& state, StreamingAead* streaming_aead) {
+  std::string plaintext = Random::GetRandomBytes(state.range(0));
+  PerfCounters perf_counters;
+  for (auto _ : state) {
+    if (SkipWithError(state, Encrypt(streaming_aead, plaintext, nullptr))) {
+      break;
+    }
+  }
+  perf_counters.Report(state, state.range(0));
+  SetBytesProcessed(state, state.range(0));
+}
+
+void DecryptLoop(benchmark::State& state, StreamingAead* streaming_aead) {
+  std::string plaintext = Random::GetRandomBytes(state.range(0));
+  std::string ciphertext;
+  if (SkipWithError(state, Encrypt(streaming_aead, plaintext, &ciphertext))) {
+    return;
+  }
+  PerfCounters perf_counters;
+  for (auto _ : state) {
+    auto size_result = Decrypt(streaming_aead, ciphertext);
+    if (SkipWithError(state, size_result.status())) break;
+    benchmark::DoNotOptimize(size_result);
+  }
+  perf_counters.Report(state, state.range(0));
+  SetBytesProcessed(state, state.range(0));
+}
+
+void BM_SubtleStreamingAeadEncrypt(benchmark::State& state,
+                                   StreamingAeadFactory new_streaming_aead) {
+  auto streaming_aead_result = new_streaming_aead();
+  if (SkipWithError(state, streaming_aead_result.status())) return;
+  EncryptLoop(state, streaming_aead_result.ValueOrDie().get());
+}
+
+void BM_SubtleStreamingAeadDecrypt(benchmark::State& state,
+                                   StreamingAeadFactory new_streaming_aead) {
+  auto streaming_aead_result = new_streaming_aead();
+  if (SkipWithError(state, streaming_aead_result.status())) return;
+  DecryptLoop(state, streaming_aead_result.ValueOrDie().get());
+}
+
+void BM_KeysetStreamingAeadEncrypt(benchmark::State& state,
+                                   KeyTemplateFactory key_template) {
+  auto streaming_aead_result = NewKeysetStreamingAead(state, key_template);
+  if (SkipWithError(state, streaming_aead_result.status())) return;
+  EncryptLoop(state, streaming_aead_result.ValueOrDie().get());
+}
+
+void BM_KeysetStreamingAeadDecrypt(benchmark::State& state,
+                                   KeyTemplateFactory key_template) {
+  auto streaming_aead_result = NewKeysetStreamingAead(state, key_template);
+  if (SkipWithError(state, streaming_aead_result.status())) return;
+  DecryptLoop(state, streaming_aead_result.ValueOrDie().get());
+}
+
+constexpr int64_t kPReadPlaintextSize = 256 * kSegmentSize;
+constexpr int kPReadSize = 1024;
+
+// A decrypting random access stream over a ciphertext of kPReadPlaintextSize
+// bytes, whose matching key has already been found.
+struct MatchedDecryptingStream {
+  std::unique_ptr<StreamingAead> streaming_aead;
+  std::string ciphertext;
+  std::unique_ptr<RandomAccessStream> stream;
+};
+
+util::Status SetUpMatchedDecryptingStream(MatchedDecryptingStream* matched) {
+  RegisterTinkOrDie();
+  auto handle_result = NewKeysetHandle(
+      StreamingAeadKeyTemplates::Aes128GcmHkdf4KB(), /*num_keys=*/1);
+  if (!handle_result.ok()) return handle_result.status();
+  auto streaming_aead_result =
+      handle_result.ValueOrDie()->GetPrimitive<StreamingAead>();
+  if (!streaming_aead_result.ok()) return streaming_aead_result.status();
+  matched->streaming_aead = std::move(streaming_aead_result.ValueOrDie());
+  auto status =
+      Encrypt(matched->streaming_aead.get(),
+              Random::GetRandomBytes(kPReadPlaintextSize), &matched->ciphertext);
+  if (!status.ok()) return status;
+  auto stream_result = matched->streaming_aead->NewDecryptingRandomAccessStream(
+      absl::make_unique<StringViewRandomAccessStream>(matched->ciphertext),
+      kAssociatedData);
+  if (!stream_result.ok()) return stream_result.status();
+  matched->stream = std::move(stream_result.ValueOrDie());
+  // The first read finds the matching key.
+  auto buffer = std::move(util::Buffer::New(kPReadSize).ValueOrDie());
+  return matched->stream->PRead(0, kPReadSize, buffer.get());
+}
+
+// Reads from a single decrypting random access stream from state.threads
+// threads at once, to show how concurrent PRead()s of one stream scale once
+// the matching key has been found.
+void BM_KeysetStreamingAeadConcurrentPRead(benchmark::State& state) {
+  static MatchedDecryptingStream* matched = nullptr;
+  static util::Status* setup_status = nullptr;
+  if (state.thread_index == 0) {
+    matched = new MatchedDecryptingStream();
+    setup_status = new util::Status(SetUpMatchedDecryptingStream(matched));
+  }
+  auto buffer = std::move(util::Buffer::New(kPReadSize).ValueOrDie());
+  // Spreads the threads over distinct segments.
+  int64_t position =
+      (state.thread_index * kSegmentSize) % kPReadPlaintextSize;
+  PerfCounters perf_counters;
+  for (auto _ : state) {
+    // The setup by thread 0 is only visible once the loop has started.
+    if (SkipWithError(state, *setup_status)) break;
+    auto status = matched->stream->PRead(position, kPReadSize, buffer.get());
+    if (SkipWithError(state, status)) break;
+    position = (position + kSegmentSize) % kPReadPlaintextSize;
+  }
+  perf_counters.Report(state, kPReadSize);
+  SetBytesProcessed(state, kPReadSize);
+  if (state.thread_index == 0) {
+    delete matched;
+    delete setup_status;
+  }
+}
+
+BENCHMARK_CAPTURE(BM_SubtleStreamingAeadEncrypt, AesGcmHkdf, &NewAesGcmHkdf)
+    ->Apply(MessageSizes);
+BENCHMARK_CAPTURE(BM_SubtleStreamingAeadDecrypt, AesGcmHkdf, &NewAesGcmHkdf)
+    ->Apply(MessageSizes);
+BENCHMARK_CAPTURE(BM_SubtleStreamingAeadEncrypt, AesCtrHmac, &NewAesCtrHmac)
+    ->Apply(MessageSizes);
+BENCHMARK_CAPTURE(BM_SubtleStreamingAeadDecrypt, AesCtrHmac, &NewAesCtrHmac)
+    ->Apply(MessageSizes);
+
+// Since streaming ciphertexts have no key prefix, decryption with a keyset
+// tries the keys in turn; the keyset sizes show the cost of that.
+BENCHMARK_CAPTURE(BM_KeysetStreamingAeadEncrypt, Aes128GcmHkdf4KB,
+                  &StreamingAeadKeyTemplates::Aes128GcmHkdf4KB)
+    ->Apply(MessageSizesAndKeysetSizes);
+BENCHMARK_CAPTURE(BM_KeysetStreamingAeadDecrypt, Aes128GcmHkdf4KB,
+                  &StreamingAeadKeyTemplates::Aes128GcmHkdf4KB)
+    ->Apply(MessageSizesAndKeysetSizes);
+
+// Goes beyond kMaxThreads, since files served to many readers are the case
+// where contention on the stream matters.
+BENCHMARK(BM_KeysetStreamingAeadConcurrentPRead)
+    ->ThreadRange(1, 64)
+    ->UseRealTime();
+
+}  // namespace
+}  // namespace benchmarks
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,523 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+// Benchmarks of the streaming AEAD primitives encrypting to and decrypting
+// from real files and pipes, through the streams of tink/util, so that the
+// I/O path is measured together with the encryption. The benchmarks sweep
+// the ciphertext segment size (state.range(0)) and the stream buffer or read
+// size (state.range(1)).
+//
+// Besides the throughput (bytes_per_second), the benchmarks report
+//   syscalls_per_MB: the read and write system calls which the benchmark
+//     thread made per MB of plaintext, as counted in /proc/thread-self/io.
+//     The threads at the other end of the pipes are not counted. Only
+//     reported on Linux.
+//
+// The files are created in $TEST_TMPDIR, or in /tmp if it is not set, so
+// their file system and page cache state determine the results.
+
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "benchmark/benchmark.h"
+#include "tink/benchmarks/benchmark_util.h"
+#include "tink/input_stream.h"
+#include "tink/output_stream.h"
+#include "tink/random_access_stream.h"
+#include "tink/streaming_aead.h"
+#include "tink/subtle/aes_ctr_hmac_streaming.h"
+#include "tink/subtle/aes_gcm_hkdf_streaming.h"
+#include "tink/subtle/common_enums.h"
+#include "tink/subtle/random.h"
+#include "tink/util/buffer.h"
+#include "tink/util/file_input_stream.h"
+#include "tink/util/file_output_stream.h"
+#include "tink/util/file_random_access_stream.h"
+#include "tink/util/istream_input_stream.h"
+#include "tink/util/ostream_output_stream.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace benchmarks {
+namespace {
+
+using ::crypto::tink::subtle::Random;
+
+constexpr char kAssociatedData[] = "associated data";
+constexpr int64_t kPlaintextSize = 16 << 20;
+
+using StreamingAeadFactory =
+    util::StatusOr<std::unique_ptr<StreamingAead>> (*)(int segment_size);
+
+// Where the ciphertext is written to or read from.
+enum class Backend { kFile, kPipe };
+
+// The InputStream which reads the ciphertext.
+enum class Reader { kFileInputStream, kIstreamInputStream };
+
+// Where PRead()s of a random access stream start.
+enum class ReadPattern { kSequential, kRandom };
+
+util::StatusOr<std::unique_ptr<StreamingAead>> NewAesGcmHkdf(
+    int segment_size) {
+  subtle::AesGcmHkdfStreaming::Params params;
+  params.ikm = Random::GetRandomKeyBytes(32);
+  params.hkdf_hash = subtle::HashType::SHA256;
+  params.derived_key_size = 16;
+  params.ciphertext_segment_size = segment_size;
+  params.ciphertext_offset = 0;
+  auto result = subtle::AesGcmHkdfStreaming::New(std::move(params));
+  if (!result.ok()) return result.status();
+  return std::unique_ptr<StreamingAead>(std::move(result.ValueOrDie()));
+}
+
+util::StatusOr<std::unique_ptr<StreamingAead>> NewAesCtrHmac(
+    int segment_size) {
+  subtle::AesCtrHmacStreaming::Params params;
+  params.ikm = Random::GetRandomKeyBytes(32);
+  params.hkdf_algo = subtle::HashType::SHA256;
+  params.key_size = 16;
+  params.ciphertext_segment_size = segment_size;
+  params.ciphertext_offset = 0;
+  params.tag_algo = subtle::HashType::SHA256;
+  params.tag_size = 16;
+  auto result = subtle::AesCtrHmacStreaming::New(std::move(params));
+  if (!result.ok()) return result.status();
+  return std::unique_ptr<StreamingAead>(std::move(result.ValueOrDie()));
+}
+
+// Runs the benchmark with segment sizes of 4 KB, 64 KB and 1 MB, and buffer
+// or read sizes of 1 KB to 1 MB.
+void SegmentAndBufferSizes(benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgNames({"segment_size", "buffer_size"});
+  for (int segment_size : {4 << 10, 64 << 10, 1 << 20}) {
+    for (int buffer_size : {1 << 10, 4 << 10, 64 << 10, 1 << 20}) {
+      benchmark->Args({segment_size, buffer_size});
+    }
+  }
+}
+
+// Returns the number of read and write system calls which the calling thread
+// has made, or -1 if the platform does not report it.
+int64_t ThreadIoSyscalls() {
+  std::ifstream io("/proc/thread-self/io");
+  std::string key;
+  int64_t value;
+  int64_t syscalls = -1;
+  while (io >> key >> value) {
+    if (key == "syscr:" || key == "syscw:") {
+      syscalls = std::max<int64_t>(syscalls, 0) + value;
+    }
+  }
+  return syscalls;
+}
+
+// Reports the system calls made since ThreadIoSyscalls() returned
+// 'start_syscalls', per MB of plaintext, if each iteration of the benchmark
+// processed 'bytes_per_iteration' bytes.
+void SetSyscallsPerMegabyte(benchmark::State& state, int64_t start_syscalls,
+                            int64_t bytes_per_iteration) {
+  int64_t end_syscalls = ThreadIoSyscalls();
+  if (start_syscalls < 0 || end_syscalls < 0 || state.iterations() == 0) {
+    return;
+  }
+  double megabytes = static_cast<double>(state.iterations()) *
+                     bytes_per_iteration / (1 << 20);
+  state.counters["syscalls_per_MB"] =
+      (end_syscalls - start_syscalls) / megabytes;
+}
+
+// A file in the temporary directory, which is deleted when this is destroyed.
+class TempFile {
+ public:
+  TempFile() {
+    static int counter = 0;
+    const char* dir = std::getenv("TEST_TMPDIR");
+    path_ = absl::StrCat(dir != nullptr ? dir : "/tmp",
+                         "/streaming_aead_io_benchmark_", getpid(), "_",
+                         counter++);
+  }
+
+  ~TempFile() { unlink(path_.c_str()); }
+
+  const std::string& path() const { return path_; }
+
+  // Returns a file descriptor of the file opened with 'flags', or a negative
+  // value in case of an error.
+  int Open(int flags) const { return open(path_.c_str(), flags, 0600); }
+
+ private:
+  std::string path_;
+};
+
+// Writes all of 'data' to 'fd', and returns false if this fails.
+bool WriteFully(int fd, absl::string_view data) {
+  while (!data.empty()) {
+    ssize_t written = write(fd, data.data(), data.size());
+    if (written < 0 && errno == EINTR) continue;
+    if (written <= 0) return false;
+    data.remove_prefix(written);
+  }
+  return true;
+}
+
+// A pipe to which a separate thread writes 'data', until all of it is
+// written or the read end is closed.
+class PipeWriter {
+ public:
+  explicit PipeWriter(absl::string_view data) {
+    // Writing to a closed pipe must fail with EPIPE instead of a signal.
+    signal(SIGPIPE, SIG_IGN);
+    int fds[2];
+    if (pipe(fds) != 0) return;
+    read_fd_ = fds[0];
+    int write_fd = fds[1];
+    thread_ = std::thread([write_fd, data]() {
+      WriteFully(write_fd, data);
+      close(write_fd);
+    });
+  }
+
+  ~PipeWriter() {
+    if (thread_.joinable()) thread_.join();
+  }
+
+  // The read end of the pipe, which the caller must close, or -1 if the pipe
+  // could not be created.
+  int read_fd() const { return read_fd_; }
+
+ private:
+  int read_fd_ = -1;
+  std::thread thread_;
+};
+
+// A pipe from which a separate thread reads and discards all data, until the
+// write end is closed.
+class PipeReader {
+ public:
+  PipeReader() {
+    int fds[2];
+    if (pipe(fds) != 0) return;
+    write_fd_ = fds[1];
+    int read_fd = fds[0];
+    thread_ = std::thread([read_fd]() {
+      std::vector<char> buffer(1 << 20);
+      while (true) {
+        ssize_t count = read(read_fd, buffer.data(), buffer.size());
+        if (count < 0 && errno == EINTR) continue;
+        if (count <= 0) break;
+      }
+      close(read_fd);
+    });
+  }
+
+  ~PipeReader() {
+    if (thread_.joinable()) thread_.join();
+  }
+
+  // The write end of the pipe, which the caller must close, or -1 if the
+  // pipe could not be created.
+  int write_fd() const { return write_fd_; }
+
+ private:
+  int write_fd_ = -1;
+  std::thread thread_;
+};
+
+// Writes 'data' to 'stream' and closes it.
+util::Status WriteAndClose(OutputStream* stream, absl::string_view data) {
+  while (!data.empty()) {
+    void* buffer;
+    auto next_result = stream->Next(&buffer);
+    if (!next_result.ok()) return next_result.status();
+    int count = std::min<size_t>(next_result.ValueOrDie(), data.size());
+    std::memcpy(buffer, data.data(), count);
+    stream->BackUp(next_result.ValueOrDie() - count);
+    data.remove_prefix(count);
+  }
+  return stream->Close();
+}
+
+// Reads 'stream' to its end, and returns the number of bytes read.
+util::StatusOr<int64_t> ReadFully(InputStream* stream) {
+  int64_t size = 0;
+  while (true) {
+    const void* buffer;
+    auto next_result = stream->Next(&buffer);
+    if (next_result.status().error_code() == util::error::OUT_OF_RANGE) {
+      return size;
+    }
+    if (!next_result.ok()) return next_result.status();
+    benchmark::DoNotOptimize(buffer);
+    size += next_result.ValueOrDie();
+  }
+}
+
+// Returns the ciphertext of kPlaintextSize random bytes.
+util::StatusOr<std::string> NewCiphertext(StreamingAead* streaming_aead) {
+  auto output = absl::make_unique<std::ostringstream>();
+  std::ostringstream* output_ptr = output.get();
+  auto stream_result = streaming_aead->NewEncryptingStream(
+      absl::make_unique<util::OstreamOutputStream>(std::move(output)),
+      kAssociatedData);
+  if (!stream_result.ok()) return stream_result.status();
+  auto status = WriteAndClose(stream_result.ValueOrDie().get(),
+                              Random::GetRandomBytes(kPlaintextSize));
+  if (!status.ok()) return status;
+  return output_ptr->str();
+}
+
+// Writes 'ciphertext' to 'file'.
+util::Status WriteCiphertextFile(const TempFile& file,
+                                 absl::string_view ciphertext) {
+  int fd = file.Open(O_WRONLY | O_CREAT | O_TRUNC);
+  if (fd < 0) {
+    return util::Status(util::error::INTERNAL,
+                        absl::StrCat("Cannot create ", file.path()));
+  }
+  bool written = WriteFully(fd, ciphertext);
+  if (close(fd) != 0 || !written) {
+    return util::Status(util::error::INTERNAL,
+                        absl::StrCat("Cannot write ", file.path()));
+  }
+  return util::OkStatus();
+}
+
+// Returns an InputStream of the 'reader' kind reading from 'fd', which it
+// takes ownership of.
+std::unique_ptr<InputStream> NewInputStream(Reader reader, int fd,
+                                            int buffer_size) {
+  if (reader == Reader::kFileInputStream) {
+    return absl::make_unique<util::FileInputStream>(fd, buffer_size);
+  }
+  // Reopening the file descriptor works for both files and pipes.
+  auto input = absl::make_unique<std::ifstream>(
+      absl::StrCat("/dev/fd/", fd), std::ios::in | std::ios::binary);
+  close(fd);
+  return absl::make_unique<util::IstreamInputStream>(std::move(input),
+                                                     buffer_size);
+}
+
+// Encrypts kPlaintextSize bytes to a FileOutputStream over a file or pipe.
+void BM_EncryptTo(benchmark::State& state,
+                  StreamingAeadFactory new_streaming_aead, Backend backend) {
+  auto streaming_aead_result = new_streaming_aead(state.range(0));
+  if (SkipWithError(state, streaming_aead_result.status())) return;
+  StreamingAead* streaming_aead = streaming_aead_result.ValueOrDie().get();
+  std::string plaintext = Random::GetRandomBytes(kPlaintextSize);
+  TempFile file;
+  util::FileOutputStream::Options options;
+  options.buffer_size = state.range(1);
+  int64_t start_syscalls = ThreadIoSyscalls();
+  PerfCounters perf_counters;
+  for (auto _ : state) {
+    // Declared before the stream, so that the stream closes the write end
+    // before the reader thread is joined.
+    std::unique_ptr<PipeReader> pipe_reader;
+    int fd;
+    if (backend == Backend::kPipe) {
+      pipe_reader = absl::make_unique<PipeReader>();
+      fd = pipe_reader->write_fd();
+    } else {
+      fd = file.Open(O_WRONLY | O_CREAT | O_TRUNC);
+    }
+    if (fd < 0) {
+      state.SkipWithError("Cannot open the ciphertext file or pipe");
+      break;
+    }
+    auto stream_result = streaming_aead->NewEncryptingStream(
+        absl::make_unique<util::FileOutputStream>(fd, options),
+        kAssociatedData);
+    if (SkipWithError(state, stream_result.status())) break;
+    auto status = WriteAndClose(stream_result.ValueOrDie().get(), plaintext);
+    if (SkipWithError(state, status)) break;
+  }
+  SetSyscallsPerMegabyte(state, start_syscalls, kPlaintextSize);
+  perf_counters.Report(state, kPlaintextSize);
+  SetBytesProcessed(state, kPlaintextSize);
+}
+
+// Decrypts the ciphertext of kPlaintextSize bytes from a file or pipe.
+void BM_DecryptFrom(benchmark::State& state,
+                    StreamingAeadFactory new_streaming_aead, Backend backend,
+                    Reader reader) {
+  auto streaming_aead_result = new_streaming_aead(state.range(0));
+  if (SkipWithError(state, streaming_aead_result.status())) return;
+  StreamingAead* streaming_aead = streaming_aead_result.ValueOrDie().get();
+  auto ciphertext_result = NewCiphertext(streaming_aead);
+  if (SkipWithError(state, ciphertext_result.status())) return;
+  const std::string& ciphertext = ciphertext_result.ValueOrDie();
+  TempFile file;
+  if (backend == Backend::kFile &&
+      SkipWithError(state, WriteCiphertextFile(file, ciphertext))) {
+    return;
+  }
+  int64_t start_syscalls = ThreadIoSyscalls();
+  PerfCounters perf_counters;
+  for (auto _ : state) {
+    // Declared before the stream, so that the stream closes the read end
+    // before the writer thread is joined.
+    std::unique_ptr<PipeWriter> pipe_writer;
+    int fd;
+    if (backend == Backend::kPipe) {
+      pipe_writer = absl::make_unique<PipeWriter>(ciphertext);
+      fd = pipe_writer->read_fd();
+    } else {
+      fd = file.Open(O_RDONLY);
+    }
+    if (fd < 0) {
+      state.SkipWithError("Cannot open the ciphertext file or pipe");
+      break;
+    }
+    auto stream_result = streaming_aead->NewDecryptingStream(
+        NewInputStream(reader, fd, state.range(1)), kAssociatedData);
+    if (SkipWithError(state, stream_result.status())) break;
+    auto size_result = ReadFully(stream_result.ValueOrDie().get());
+    if (SkipWithError(state, size_result.status())) break;
+    if (size_result.ValueOrDie() != kPlaintextSize) {
+      state.SkipWithError("Wrong plaintext size");
+      break;
+    }
+  }
+  SetSyscallsPerMegabyte(state, start_syscalls, kPlaintextSize);
+  perf_counters.Report(state, kPlaintextSize);
+  SetBytesProcessed(state, kPlaintextSize);
+}
+
+// Reads state.range(1) bytes per iteration from a decrypting random access
+// stream over a FileRandomAccessStream, sequentially or at random positions.
+void BM_PReadFromFile(benchmark::State& state,
+                      StreamingAeadFactory new_streaming_aead,
+                      ReadPattern pattern) {
+  auto streaming_aead_result = new_streaming_aead(state.range(0));
+  if (SkipWithError(state, streaming_aead_result.status())) return;
+  StreamingAead* streaming_aead = streaming_aead_result.ValueOrDie().get();
+  auto ciphertext_result = NewCiphertext(streaming_aead);
+  if (SkipWithError(state, ciphertext_result.status())) return;
+  TempFile file;
+  auto status = WriteCiphertextFile(file, ciphertext_result.ValueOrDie());
+  if (SkipWithError(state, status)) return;
+  int fd = file.Open(O_RDONLY);
+  if (fd < 0) {
+    state.SkipWithError("Cannot open the ciphertext file");
+    return;
+  }
+  auto stream_result = streaming_aead->NewDecryptingRandomAccessStream(
+      absl::make_unique<util::FileRandomAccessStream>(fd), kAssociatedData);
+  if (SkipWithError(state, stream_result.status())) return;
+  RandomAccessStream* stream = stream_result.ValueOrDie().get();
+  const int read_size = state.range(1);
+  auto buffer = std::move(util::Buffer::New(read_size).ValueOrDie());
+  // The positions are drawn up front, so that this is not measured. No read
+  // reaches the end of the plaintext, where PRead() returns OUT_OF_RANGE.
+  const int64_t end = kPlaintextSize - read_size;
+  std::vector<int64_t> positions(1024);
+  std::mt19937_64 generator(1);
+  std::uniform_int_distribution<int64_t> distribution(0, end - 1);
+  for (int i = 0; i < positions.size(); ++i) {
+    positions[i] = pattern == ReadPattern::kSequential
+                       ? (i * static_cast<int64_t>(read_size)) % end
+                       : distribution(generator);
+  }
+  // The first read finds the matching key.
+  if (SkipWithError(state, stream->PRead(0, read_size, buffer.get()))) return;
+  int64_t start_syscalls = ThreadIoSyscalls();
+  int i = 0;
+  PerfCounters perf_counters;
+  for (auto _ : state) {
+    auto status = stream->PRead(positions[i], read_size, buffer.get());
+    if (SkipWithError(state, status)) break;
+    i = (i + 1) % positions.size();
+  }
+  SetSyscallsPerMegabyte(state, start_syscalls, read_size);
+  perf_counters.Report(state, read_size);
+  SetBytesProcessed(state, read_size);
+}
+
+BENCHMARK_CAPTURE(BM_EncryptTo, AesGcmHkdf_File, &NewAesGcmHkdf,
+                  Backend::kFile)
+    ->Apply(SegmentAndBufferSizes);
+BENCHMARK_CAPTURE(BM_EncryptTo, AesGcmHkdf_Pipe, &NewAesGcmHkdf,
+                  Backend::kPipe)
+    ->Apply(SegmentAndBufferSizes);
+BENCHMARK_CAPTURE(BM_EncryptTo, AesCtrHmac_File, &NewAesCtrHmac,
+                  Backend::kFile)
+    ->Apply(SegmentAndBufferSizes);
+BENCHMARK_CAPTURE(BM_EncryptTo, AesCtrHmac_Pipe, &NewAesCtrHmac,
+                  Backend::kPipe)
+    ->Apply(SegmentAndBufferSizes);
+
+BENCHMARK_CAPTURE(BM_DecryptFrom, AesGcmHkdf_File_FileInputStream,
+                  &NewAesGcmHkdf, Backend::kFile, Reader::kFileInputStream)
+    ->Apply(SegmentAndBufferSizes);
+BENCHMARK_CAPTURE(BM_DecryptFrom, AesGcmHkdf_Pipe_FileInputStream,
+                  &NewAesGcmHkdf, Backend::kPipe, Reader::kFileInputStream)
+    ->Apply(SegmentAndBufferSizes);
+BENCHMARK_CAPTURE(BM_DecryptFrom, AesGcmHkdf_File_IstreamInputStream,
+                  &NewAesGcmHkdf, Backend::kFile, Reader::kIstreamInputStream)
+    ->Apply(SegmentAndBufferSizes);
+BENCHMARK_CAPTURE(BM_DecryptFrom, AesGcmHkdf_Pipe_IstreamInputStream,
+                  &NewAesGcmHkdf, Backend::kPipe, Reader::kIstreamInputStream)
+    ->Apply(SegmentAndBufferSizes);
+BENCHMARK_CAPTURE(BM_DecryptFrom, AesCtrHmac_File_FileInputStream,
+                  &NewAesCtrHmac, Backend::kFile, Reader::kFileInputStream)
+    ->Apply(SegmentAndBufferSizes);
+BENCHMARK_CAPTURE(BM_DecryptFrom, AesCtrHmac_Pipe_FileInputStream,
+                  &NewAesCtrHmac, Backend::kPipe, Reader::kFileInputStream)
+    ->Apply(SegmentAndBufferSizes);
+BENCHMARK_CAPTURE(BM_DecryptFrom, AesCtrHmac_File_IstreamInputStream,
+                  &NewAesCtrHmac, Backend::kFile, Reader::kIstreamInputStream)
+    ->Apply(SegmentAndBufferSizes);
+BENCHMARK_CAPTURE(BM_DecryptFrom, AesCtrHmac_Pipe_IstreamInputStream,
+                  &NewAesCtrHmac, Backend::kPipe, Reader::kIstreamInputStream)
+    ->Apply(SegmentAndBufferSizes);
+
+BENCHMARK_CAPTURE(BM_PReadFromFile, AesGcmHkdf_Sequential, &NewAesGcmHkdf,
+                  ReadPattern::kSequential)
+    ->Apply(SegmentAndBufferSizes);
+BENCHMARK_CAPTURE(BM_PReadFromFile, AesGcmHkdf_Random, &NewAesGcmHkdf,
+                  ReadPattern::kRandom)
+    ->Apply(SegmentAndBufferSizes);
+BENCHMARK_CAPTURE(BM_PReadFromFile, AesCtrHmac_Sequential, &NewAesCtrHmac,
+                  ReadPattern::kSequential)
+    ->Apply(SegmentAndBufferSizes);
+BENCHMARK_CAPTURE(BM_PReadFromFile, AesCtrHmac_Random, &NewAesCtrHmac,
+                  ReadPattern::kRandom)
+    ->Apply(SegmentAndBufferSizes);
+
+}  // namespace
+}  // namespace benchmarks
+}  // namespace tink
+}  // namespace crypto
@@ -18,9 +18,14 @@
 #define TINK_BINARY_KEYSET_READER_H_
 
 #include <istream>
+#include <memory>
 
 #include "absl/strings/string_view.h"
+#include "tink/input_stream.h"
 #include "tink/keyset_reader.h"
+#include "tink/util/protobuf_helper.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
 #include "tink/util/statusor.h"
 #include "proto/tink.pb.h"
 
@@ -30,10 +35,20 @@ namespace tink {
 // A KeysetReader that can read from some source cleartext or
 // encrypted keysets in proto binary wire format, cf.
 // https://developers.google.com/protocol-buffers/docs/encoding
+//
+// A reader created from a stream parses the keyset directly from the stream,
+// without first reading all of it into memory, so the stream is consumed by
+// the first call to Read() or ReadEncrypted(). Later calls fail.
 class BinaryKeysetReader : public KeysetReader {
  public:
+  // The bytes read from 'keyset_stream' only pass through a buffer of
+  // this reader, which is wiped when the keyset has been parsed.
   static crypto::tink::util::StatusOr<std::unique_ptr<KeysetReader>> New(
       std::unique_ptr<std::istream> keyset_stream);
+  // The bytes read from 'keyset_stream' are parsed from the buffers
+  // returned by its Next(), without copying.
+  static crypto::tink::util::StatusOr<std::unique_ptr<KeysetReader>> New(
+      std::unique_ptr<crypto::tink::InputStream> keyset_stream);
   static crypto::tink::util::StatusOr<std::unique_ptr<KeysetReader>> New(
       absl::string_view serialized_keyset);
 
@@ -46,9 +61,25 @@ class BinaryKeysetReader : public KeysetReader {
 
  private:
   explicit BinaryKeysetReader(absl::string_view serialized_keyset)
-      : serialized_keyset_(serialized_keyset) {}
+      : serialized_keyset_(util::SecretDataFromStringView(serialized_keyset)) {}
+  explicit BinaryKeysetReader(std::unique_ptr<std::istream> keyset_istream)
+      : keyset_istream_(std::move(keyset_istream)), is_stream_(true) {}
+  explicit BinaryKeysetReader(
+      std::unique_ptr<crypto::tink::InputStream> keyset_stream)
+      : keyset_stream_(std::move(keyset_stream)), is_stream_(true) {}
+
+  // Parses 'message' from the source of this reader, and returns an
+  // INVALID_ARGUMENT error with 'parse_error' if the bytes are malformed.
+  crypto::tink::util::Status Parse(portable_proto::MessageLite* message,
+                                   absl::string_view parse_error);
 
-  std::string serialized_keyset_;
+  // Exactly one of the following is the source of this reader; the streams
+  // are reset once they have been read, and 'is_stream_' tells whether this
+  // reader was created from one.
+  util::SecretData serialized_keyset_;
+  std::unique_ptr<std::istream> keyset_istream_;
+  std::unique_ptr<crypto::tink::InputStream> keyset_stream_;
+  bool is_stream_ = false;
 };
 
 }  // namespace tink
@@ -0,0 +1,110 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TINK_BULK_KEYSET_GENERATOR_H_
+#define TINK_BULK_KEYSET_GENERATOR_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "tink/aead.h"
+#include "tink/core/registry_impl.h"
+#include "tink/output_stream.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+
+// Generates many independent keysets for one key template, for example one
+// keyset per tenant when provisioning tenants in bulk, and writes them to an
+// OutputStream:
+//
+//   BulkKeysetGenerator::Options options;
+//   options.num_threads = 8;
+//   options.master_key_aead = master_key_aead.get();
+//   auto generator_result = BulkKeysetGenerator::New(
+//       AeadKeyTemplates::Aes128Gcm(), options);
+//   if (!generator_result.ok()) return generator_result.status();
+//   auto status = generator_result.ValueOrDie()->Generate(10000000, &output);
+//
+// Every keyset holds a single enabled primary key. It is written as a
+// serialized Keyset, or as a serialized EncryptedKeyset if master_key_aead is
+// set, preceded by its size as a varint, which is the length-delimited format
+// read by protobuf's ParseDelimitedFromZeroCopyStream().
+//
+// Unlike KeysetHandle::GenerateNew(), the generator looks up the key type in
+// the registry once. If its key manager supports key derivation, such as the
+// managers of AES-GCM and HMAC, the key bytes are cut from large reads of the
+// random number generator; other key types are generated one key at a time.
+//
+// Instances are thread-safe. They must not be used after the registry is
+// reset.
+class BulkKeysetGenerator {
+ public:
+  struct Options {
+    // The number of threads generating keysets, including the calling one.
+    int num_threads = 1;
+    // The number of keysets a thread generates before they are written.
+    int batch_size = 1024;
+    // The number of bytes taken from the random number generator at once.
+    int random_read_size = 64 * 1024;
+    // If not null, every keyset is encrypted with it, as by
+    // KeysetHandle::Write(). It must outlive the generator.
+    const Aead* master_key_aead = nullptr;
+  };
+
+  // Fails if the registry does not allow new keys for 'key_template'.
+  static crypto::tink::util::StatusOr<std::unique_ptr<BulkKeysetGenerator>>
+  New(const google::crypto::tink::KeyTemplate& key_template,
+      const Options& options);
+
+  BulkKeysetGenerator(const BulkKeysetGenerator&) = delete;
+  BulkKeysetGenerator& operator=(const BulkKeysetGenerator&) = delete;
+
+  // Generates 'count' keysets and writes them to 'output', which is not
+  // closed. On failure, some of the keysets may have been written.
+  crypto::tink::util::Status Generate(int64_t count,
+                                      OutputStream* output) const;
+
+ private:
+  class RandomInputStream;
+
+  BulkKeysetGenerator(const google::crypto::tink::KeyTemplate& key_template,
+                      const Options& options,
+                      const RegistryImpl::KeyDeriver* key_deriver)
+      : key_template_(key_template),
+        options_(options),
+        key_deriver_(key_deriver) {}
+
+  // Appends the records of 'count' new keysets to '*records'.
+  crypto::tink::util::Status GenerateRecords(int64_t count,
+                                             RandomInputStream* randomness,
+                                             std::string* records) const;
+
+  const google::crypto::tink::KeyTemplate key_template_;
+  const Options options_;
+  // Owned by the registry, or null if the key type cannot derive keys.
+  const RegistryImpl::KeyDeriver* const key_deriver_;
+};
+
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_BULK_KEYSET_GENERATOR_H_
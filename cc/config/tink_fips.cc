@@ -16,11 +16,15 @@
 namespace crypto {
 namespace tink {
 
-#ifdef TINK_USE_ONLY_FIPS
-const bool kUseOnlyFips = true;
-#else
-const bool kUseOnlyFips = false;
-#endif
+namespace {
+
+// FIPS_mode() does not change at run time, so it is queried only once.
+bool IsBoringCryptoAvailable() {
+  static const bool is_available = FIPS_mode();
+  return is_available;
+}
+
+}  // namespace
 
 crypto::tink::util::Status ChecksFipsCompatibility(
     FipsCompatibility fips_status) {
@@ -33,7 +37,7 @@ crypto::tink::util::Status ChecksFipsCompatibility(
         return util::OkStatus();
       }
     case FipsCompatibility::kRequiresBoringCrypto:
-      if (kUseOnlyFips && !FIPS_mode()) {
+      if (kUseOnlyFips && !IsBoringCryptoAvailable()) {
         return util::Status(
             util::error::INTERNAL,
             "BoringSSL not built with the BoringCrypto module. If you want to "
@@ -44,8 +48,8 @@ crypto::tink::util::Status ChecksFipsCompatibility(
         return util::OkStatus();
       }
     default:
-      util::Status(util::error::INTERNAL,
-                   "Could not determine FIPS status.");
+      return util::Status(util::error::INTERNAL,
+                          "Could not determine FIPS status.");
   }
 }
 
@@ -14,7 +14,6 @@
 #ifndef TINK_CONFIG_TINK_FIPS_H_
 #define TINK_CONFIG_TINK_FIPS_H_
 
-#include "absl/base/attributes.h"
 #include "openssl/crypto.h"
 #include "tink/util/status.h"
 
@@ -24,7 +23,15 @@ namespace tink {
 // This flag indicates whether Tink was build in FIPS only mode. If the flag
 // is set, then usage of algorithms will be restricted to algorithms which
 // utilize the FIPS validated BoringCrypto module.
-ABSL_CONST_INIT extern const bool kUseOnlyFips;
+//
+// The flag is a compile-time constant, so that the checks below cost nothing
+// in the default build, and the registration of non-FIPS key managers is
+// dead code, which the linker can drop, in the FIPS only build.
+#ifdef TINK_USE_ONLY_FIPS
+constexpr bool kUseOnlyFips = true;
+#else
+constexpr bool kUseOnlyFips = false;
+#endif
 
 // Should be used to indicate whether an algorithm can be used in FIPS only
 // mode or not.
@@ -43,9 +50,11 @@ enum class FipsCompatibility {
 crypto::tink::util::Status ChecksFipsCompatibility(
     FipsCompatibility fips_status);
 
-// Utility function wich calls CheckFipsCompatibility(T::kFipsStatus).
+// Utility function wich calls CheckFipsCompatibility(T::kFipsStatus). Without
+// FIPS only mode this is resolved at compile time.
 template <class T>
 crypto::tink::util::Status CheckFipsCompatibility() {
+  if (!kUseOnlyFips) return util::OkStatus();
   return ChecksFipsCompatibility(T::kFipsStatus);
 }
 
@@ -25,6 +25,8 @@ using testing::Eq;
 
 TEST(TinkFipsTest, FlagCorrectlySet) { EXPECT_THAT(kUseOnlyFips, Eq(false)); }
 
+static_assert(!kUseOnlyFips, "kUseOnlyFips must be a compile-time constant");
+
 class FipsIncompatible {
  public:
   static constexpr crypto::tink::FipsCompatibility kFipsStatus =
@@ -34,6 +34,8 @@ TEST(TinkFipsTest, FlagCorrectlySet) {
   EXPECT_THAT(kUseOnlyFips, testing::Eq(true));
 }
 
+static_assert(kUseOnlyFips, "kUseOnlyFips must be a compile-time constant");
+
 class FipsIncompatible {
  public:
   static constexpr crypto::tink::FipsCompatibility kFipsStatus =
@@ -16,12 +16,13 @@
 
 #include "tink/binary_keyset_reader.h"
 
-#include <iostream>
 #include <istream>
-#include <sstream>
 
 #include "absl/memory/memory.h"
+#include "google/protobuf/io/zero_copy_stream.h"
+#include "tink/input_stream.h"
 #include "tink/util/errors.h"
+#include "tink/util/secret_data.h"
 #include "tink/util/status.h"
 #include "tink/util/statusor.h"
 #include "proto/tink.pb.h"
@@ -31,6 +32,105 @@ namespace tink {
 
 using google::crypto::tink::EncryptedKeyset;
 using google::crypto::tink::Keyset;
+using portable_proto::io::ZeroCopyInputStream;
+
+namespace {
+
+// Implements ZeroCopyInputStream::Skip() with Next() and BackUp().
+bool SkipBytes(ZeroCopyInputStream* stream, int count) {
+  const void* data;
+  int size;
+  while (count > 0) {
+    if (!stream->Next(&data, &size)) return false;
+    if (size > count) {
+      stream->BackUp(size - count);
+      return true;
+    }
+    count -= size;
+  }
+  return true;
+}
+
+// A ZeroCopyInputStream reading from a std::istream via a buffer which is
+// wiped when the stream is destroyed, as it holds parts of the keyset.
+class IstreamZeroCopyInputStream : public ZeroCopyInputStream {
+ public:
+  explicit IstreamZeroCopyInputStream(std::istream* input)
+      : input_(input), buffer_(kBufferSize) {}
+
+  bool Next(const void** data, int* size) override {
+    if (count_backedup_ == 0) {
+      std::streambuf* streambuf = input_->rdbuf();
+      if (streambuf == nullptr) return false;
+      count_in_buffer_ = streambuf->sgetn(
+          reinterpret_cast<char*>(buffer_.data()), buffer_.size());
+      if (count_in_buffer_ <= 0) {
+        count_in_buffer_ = 0;
+        input_->setstate(std::ios::eofbit);
+        return false;
+      }
+      count_backedup_ = count_in_buffer_;
+    }
+    *data = buffer_.data() + (count_in_buffer_ - count_backedup_);
+    *size = count_backedup_;
+    position_ += count_backedup_;
+    count_backedup_ = 0;
+    return true;
+  }
+
+  void BackUp(int count) override {
+    count_backedup_ += count;
+    position_ -= count;
+  }
+
+  bool Skip(int count) override { return SkipBytes(this, count); }
+
+  int64_t ByteCount() const override { return position_; }
+
+ private:
+  static constexpr int kBufferSize = 16 * 1024;
+
+  std::istream* input_;
+  util::SecretData buffer_;
+  int count_in_buffer_ = 0;  // # of bytes read into buffer_
+  int count_backedup_ = 0;   // # of bytes at the end of buffer_ backed up
+  int64_t position_ = 0;
+};
+
+constexpr int IstreamZeroCopyInputStream::kBufferSize;
+
+// A ZeroCopyInputStream returning the buffers of a Tink InputStream.
+class InputStreamAdapter : public ZeroCopyInputStream {
+ public:
+  explicit InputStreamAdapter(InputStream* input) : input_(input) {}
+
+  bool Next(const void** data, int* size) override {
+    auto next_result = input_->Next(data);
+    if (!next_result.ok()) {
+      if (next_result.status().error_code() != util::error::OUT_OF_RANGE) {
+        status_ = next_result.status();
+      }
+      return false;
+    }
+    *size = next_result.ValueOrDie();
+    return true;
+  }
+
+  void BackUp(int count) override { input_->BackUp(count); }
+
+  bool Skip(int count) override { return SkipBytes(this, count); }
+
+  int64_t ByteCount() const override { return input_->Position(); }
+
+  // Returns the error of the underlying stream, if it failed before its end.
+  const util::Status& status() const { return status_; }
+
+ private:
+  InputStream* input_;
+  util::Status status_;
+};
+
+}  // namespace
 
 //  static
 util::StatusOr<std::unique_ptr<KeysetReader>> BinaryKeysetReader::New(
@@ -39,9 +139,21 @@ util::StatusOr<std::unique_ptr<KeysetReader>> BinaryKeysetReader::New(
     return util::Status(util::error::INVALID_ARGUMENT,
                         "keyset_stream must be non-null.");
   }
-  std::stringstream buffer;
-  buffer << keyset_stream->rdbuf();
-  return New(buffer.str());
+  std::unique_ptr<KeysetReader> reader(
+      new BinaryKeysetReader(std::move(keyset_stream)));
+  return std::move(reader);
+}
+
+//  static
+util::StatusOr<std::unique_ptr<KeysetReader>> BinaryKeysetReader::New(
+    std::unique_ptr<InputStream> keyset_stream) {
+  if (keyset_stream == nullptr) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "keyset_stream must be non-null.");
+  }
+  std::unique_ptr<KeysetReader> reader(
+      new BinaryKeysetReader(std::move(keyset_stream)));
+  return std::move(reader);
 }
 
 //  static
@@ -52,22 +164,51 @@ util::StatusOr<std::unique_ptr<KeysetReader>> BinaryKeysetReader::New(
   return std::move(reader);
 }
 
-util::StatusOr<std::unique_ptr<Keyset>> BinaryKeysetReader::Read() {
-  auto keyset = absl::make_unique<Keyset>();
-  if (!keyset->ParseFromString(serialized_keyset_)) {
+util::Status BinaryKeysetReader::Parse(portable_proto::MessageLite* message,
+                                       absl::string_view parse_error) {
+  bool parsed;
+  if (!is_stream_) {
+    absl::string_view serialized_keyset =
+        util::SecretDataAsStringView(serialized_keyset_);
+    parsed = message->ParseFromArray(serialized_keyset.data(),
+                                     serialized_keyset.size());
+  } else if (keyset_istream_ != nullptr) {
+    {
+      IstreamZeroCopyInputStream input(keyset_istream_.get());
+      parsed = message->ParseFromZeroCopyStream(&input);
+    }
+    keyset_istream_.reset();
+  } else if (keyset_stream_ != nullptr) {
+    InputStreamAdapter input(keyset_stream_.get());
+    parsed = message->ParseFromZeroCopyStream(&input);
+    keyset_stream_.reset();
+    if (!input.status().ok()) return input.status();
+  } else {
+    return util::Status(util::error::FAILED_PRECONDITION,
+                        "The keyset stream has already been read.");
+  }
+  if (!parsed) {
     return util::Status(util::error::INVALID_ARGUMENT,
-                        "Could not parse the input stream as a Keyset-proto.");
+                        std::string(parse_error));
   }
+  return util::OkStatus();
+}
+
+util::StatusOr<std::unique_ptr<Keyset>> BinaryKeysetReader::Read() {
+  auto keyset = absl::make_unique<Keyset>();
+  auto status = Parse(keyset.get(),
+                      "Could not parse the input stream as a Keyset-proto.");
+  if (!status.ok()) return status;
   return std::move(keyset);
 }
 
 util::StatusOr<std::unique_ptr<EncryptedKeyset>>
 BinaryKeysetReader::ReadEncrypted() {
   auto enc_keyset = absl::make_unique<EncryptedKeyset>();
-  if (!enc_keyset->ParseFromString(serialized_keyset_)) {
-    return util::Status(util::error::INVALID_ARGUMENT,
-        "Could not parse the input stream as an EncryptedKeyset-proto.");
-  }
+  auto status = Parse(
+      enc_keyset.get(),
+      "Could not parse the input stream as an EncryptedKeyset-proto.");
+  if (!status.ok()) return status;
   return std::move(enc_keyset);
 }
 
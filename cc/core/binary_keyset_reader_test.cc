@@ -20,12 +20,19 @@
 #include <istream>
 #include <sstream>
 
-#include "tink/util/test_util.h"
 #include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "tink/input_stream.h"
+#include "tink/util/istream_input_stream.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "tink/util/test_util.h"
 #include "proto/tink.pb.h"
 
 using crypto::tink::test::AddRawKey;
 using crypto::tink::test::AddTinkKey;
+using crypto::tink::util::IstreamInputStream;
 
 using google::crypto::tink::EncryptedKeyset;
 using google::crypto::tink::KeyData;
@@ -200,6 +207,110 @@ TEST_F(BinaryKeysetReaderTest, testReadEncryptedFromStream) {
   }
 }
 
+TEST_F(BinaryKeysetReaderTest, testReadLargeKeysetFromStream) {
+  Keyset large_keyset;
+  for (int i = 0; i < 100; i++) {
+    Keyset::Key key;
+    AddRawKey(absl::StrCat("key type ", i), i, key, KeyStatusType::ENABLED,
+              KeyData::SYMMETRIC, &large_keyset);
+    large_keyset.mutable_key(i)->mutable_key_data()->set_value(
+        std::string(1000, 'a' + i % 26));
+  }
+  std::string serialized_keyset = large_keyset.SerializeAsString();
+  auto reader_result = BinaryKeysetReader::New(
+      absl::make_unique<std::stringstream>(serialized_keyset));
+  ASSERT_TRUE(reader_result.ok()) << reader_result.status();
+  auto read_result = reader_result.ValueOrDie()->Read();
+  ASSERT_TRUE(read_result.ok()) << read_result.status();
+  EXPECT_EQ(serialized_keyset, read_result.ValueOrDie()->SerializeAsString());
+}
+
+TEST_F(BinaryKeysetReaderTest, testStreamIsReadOnce) {
+  std::unique_ptr<std::istream> keyset_stream(
+      new std::stringstream(good_serialized_keyset_));
+  auto reader_result = BinaryKeysetReader::New(std::move(keyset_stream));
+  ASSERT_TRUE(reader_result.ok()) << reader_result.status();
+  auto reader = std::move(reader_result.ValueOrDie());
+  EXPECT_TRUE(reader->Read().ok());
+  auto read_result = reader->Read();
+  EXPECT_EQ(util::error::FAILED_PRECONDITION,
+            read_result.status().error_code());
+  auto read_encrypted_result = reader->ReadEncrypted();
+  EXPECT_EQ(util::error::FAILED_PRECONDITION,
+            read_encrypted_result.status().error_code());
+}
+
+TEST_F(BinaryKeysetReaderTest, testReadFromInputStream) {
+  {  // Null stream.
+    std::unique_ptr<InputStream> null_stream(nullptr);
+    auto reader_result = BinaryKeysetReader::New(std::move(null_stream));
+    EXPECT_EQ(util::error::INVALID_ARGUMENT,
+              reader_result.status().error_code());
+  }
+
+  {  // Good stream, with a buffer smaller than the keyset.
+    std::unique_ptr<InputStream> keyset_stream(new IstreamInputStream(
+        absl::make_unique<std::stringstream>(good_serialized_keyset_),
+        /*buffer_size=*/7));
+    auto reader_result = BinaryKeysetReader::New(std::move(keyset_stream));
+    ASSERT_TRUE(reader_result.ok()) << reader_result.status();
+    auto reader = std::move(reader_result.ValueOrDie());
+    auto read_result = reader->Read();
+    ASSERT_TRUE(read_result.ok()) << read_result.status();
+    EXPECT_EQ(good_serialized_keyset_,
+              read_result.ValueOrDie()->SerializeAsString());
+    EXPECT_EQ(util::error::FAILED_PRECONDITION,
+              reader->Read().status().error_code());
+  }
+
+  {  // Good encrypted keyset.
+    std::unique_ptr<InputStream> keyset_stream(new IstreamInputStream(
+        absl::make_unique<std::stringstream>(
+            good_serialized_encrypted_keyset_)));
+    auto reader_result = BinaryKeysetReader::New(std::move(keyset_stream));
+    ASSERT_TRUE(reader_result.ok()) << reader_result.status();
+    auto read_encrypted_result = reader_result.ValueOrDie()->ReadEncrypted();
+    ASSERT_TRUE(read_encrypted_result.ok()) << read_encrypted_result.status();
+    EXPECT_EQ(good_serialized_encrypted_keyset_,
+              read_encrypted_result.ValueOrDie()->SerializeAsString());
+  }
+
+  {  // Bad stream.
+    std::unique_ptr<InputStream> keyset_stream(new IstreamInputStream(
+        absl::make_unique<std::stringstream>(bad_serialized_keyset_)));
+    auto reader_result = BinaryKeysetReader::New(std::move(keyset_stream));
+    ASSERT_TRUE(reader_result.ok()) << reader_result.status();
+    EXPECT_EQ(util::error::INVALID_ARGUMENT,
+              reader_result.ValueOrDie()->Read().status().error_code());
+  }
+}
+
+// An InputStream which fails after returning its first byte.
+class FailingInputStream : public InputStream {
+ public:
+  util::StatusOr<int> Next(const void** data) override {
+    if (position_ > 0) {
+      return util::Status(util::error::INTERNAL, "read failed");
+    }
+    *data = "\x08";
+    position_ = 1;
+    return 1;
+  }
+  void BackUp(int count) override { position_ -= count; }
+  int64_t Position() const override { return position_; }
+
+ private:
+  int64_t position_ = 0;
+};
+
+TEST_F(BinaryKeysetReaderTest, testInputStreamErrorIsReturned) {
+  auto reader_result =
+      BinaryKeysetReader::New(absl::make_unique<FailingInputStream>());
+  ASSERT_TRUE(reader_result.ok()) << reader_result.status();
+  EXPECT_EQ(util::error::INTERNAL,
+            reader_result.ValueOrDie()->Read().status().error_code());
+}
+
 }  // namespace
 }  // namespace tink
 }  // namespace crypto
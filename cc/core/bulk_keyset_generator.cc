@@ -0,0 +1,230 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/bulk_keyset_generator.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "tink/core/registry_impl.h"
+#include "tink/input_stream.h"
+#include "tink/subtle/random.h"
+#include "tink/util/input_stream_util.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+
+using ::google::crypto::tink::EncryptedKeyset;
+using ::google::crypto::tink::KeyData;
+using ::google::crypto::tink::Keyset;
+using ::google::crypto::tink::KeyTemplate;
+
+// An endless stream of random bytes, which are read from the random number
+// generator 'read_size' bytes at a time. The buffer is zeroized when the
+// stream is destroyed.
+class BulkKeysetGenerator::RandomInputStream : public InputStream {
+ public:
+  explicit RandomInputStream(int read_size)
+      : buffer_(read_size), position_(read_size) {}
+
+  util::StatusOr<int> Next(const void** data) override {
+    if (position_ == buffer_.size()) {
+      subtle::Random::GetRandomKeyBytes(absl::MakeSpan(buffer_));
+      position_ = 0;
+    }
+    *data = buffer_.data() + position_;
+    last_size_ = buffer_.size() - position_;
+    position_ = buffer_.size();
+    total_ += last_size_;
+    return last_size_;
+  }
+
+  void BackUp(int count) override {
+    count = std::min(std::max(count, 0), last_size_);
+    position_ -= count;
+    total_ -= count;
+    last_size_ -= count;
+  }
+
+  int64_t Position() const override { return total_; }
+
+ private:
+  util::SecretData buffer_;
+  size_t position_;
+  int last_size_ = 0;
+  int64_t total_ = 0;
+};
+
+namespace {
+
+void AppendVarint(uint64_t value, std::string* output) {
+  while (value >= 0x80) {
+    output->push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  output->push_back(static_cast<char>(value));
+}
+
+util::Status WriteAll(absl::string_view data, OutputStream* output) {
+  while (!data.empty()) {
+    void* buffer;
+    auto next_result = output->Next(&buffer);
+    if (!next_result.ok()) return next_result.status();
+    size_t size = std::min<size_t>(next_result.ValueOrDie(), data.size());
+    std::memcpy(buffer, data.data(), size);
+    output->BackUp(next_result.ValueOrDie() - size);
+    data.remove_prefix(size);
+  }
+  return util::OkStatus();
+}
+
+}  // namespace
+
+// static
+util::StatusOr<std::unique_ptr<BulkKeysetGenerator>> BulkKeysetGenerator::New(
+    const KeyTemplate& key_template, const Options& options) {
+  if (options.num_threads < 1 || options.batch_size < 1 ||
+      options.random_read_size < 1) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "num_threads, batch_size and random_read_size must "
+                        "be positive");
+  }
+  if (key_template.output_prefix_type() ==
+      google::crypto::tink::OutputPrefixType::UNKNOWN_PREFIX) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "key template has unknown prefix");
+  }
+  // Also checks that the key type allows new keys, which deriving does not.
+  auto key_data_result =
+      RegistryImpl::GlobalInstance().GenerateKeyData(key_template);
+  if (!key_data_result.ok()) return key_data_result.status();
+  // Key type managers which do not implement DeriveKey() still have a key
+  // deriver, which fails, so try it once.
+  const RegistryImpl::KeyDeriver* key_deriver = nullptr;
+  auto key_deriver_result =
+      RegistryImpl::GlobalInstance().GetKeyDeriver(key_template.type_url());
+  if (key_deriver_result.ok()) {
+    RandomInputStream randomness(options.random_read_size);
+    if ((*key_deriver_result.ValueOrDie())(key_template.value(), &randomness)
+            .ok()) {
+      key_deriver = key_deriver_result.ValueOrDie();
+    }
+  }
+  return absl::WrapUnique(
+      new BulkKeysetGenerator(key_template, options, key_deriver));
+}
+
+util::Status BulkKeysetGenerator::GenerateRecords(
+    int64_t count, RandomInputStream* randomness, std::string* records) const {
+  for (int64_t i = 0; i < count; i++) {
+    Keyset keyset;
+    Keyset::Key* key = keyset.add_key();
+    if (key_deriver_ != nullptr) {
+      auto key_data_result = (*key_deriver_)(key_template_.value(), randomness);
+      if (!key_data_result.ok()) return key_data_result.status();
+      *key->mutable_key_data() = std::move(key_data_result.ValueOrDie());
+    } else {
+      auto key_data_result =
+          RegistryImpl::GlobalInstance().GenerateKeyData(key_template_);
+      if (!key_data_result.ok()) return key_data_result.status();
+      key->mutable_key_data()->Swap(key_data_result.ValueOrDie().get());
+    }
+    auto key_id_result = ReadBytesFromStream(sizeof(uint32_t), randomness);
+    if (!key_id_result.ok()) return key_id_result.status();
+    uint32_t key_id;
+    std::memcpy(&key_id, key_id_result.ValueOrDie().data(), sizeof(key_id));
+    key->set_key_id(key_id);
+    key->set_status(google::crypto::tink::KeyStatusType::ENABLED);
+    key->set_output_prefix_type(key_template_.output_prefix_type());
+    keyset.set_primary_key_id(key_id);
+    std::string record = keyset.SerializeAsString();
+    if (options_.master_key_aead != nullptr) {
+      auto encrypt_result = options_.master_key_aead->Encrypt(
+          record, /* associated_data= */ "");
+      if (!encrypt_result.ok()) return encrypt_result.status();
+      EncryptedKeyset encrypted_keyset;
+      encrypted_keyset.set_encrypted_keyset(encrypt_result.ValueOrDie());
+      record = encrypted_keyset.SerializeAsString();
+    }
+    AppendVarint(record.size(), records);
+    records->append(record);
+  }
+  return util::OkStatus();
+}
+
+util::Status BulkKeysetGenerator::Generate(int64_t count,
+                                           OutputStream* output) const {
+  if (count < 0) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "count must not be negative");
+  }
+  std::vector<std::unique_ptr<RandomInputStream>> streams;
+  for (int i = 0; i < options_.num_threads; i++) {
+    streams.push_back(
+        absl::make_unique<RandomInputStream>(options_.random_read_size));
+  }
+  std::vector<std::string> records(options_.num_threads);
+  std::vector<util::Status> statuses(options_.num_threads);
+  // Every round, each thread generates a batch of keysets, the calling
+  // thread the last one, and the batches are written in order.
+  int64_t done = 0;
+  while (done < count) {
+    int num_batches = static_cast<int>(std::min<int64_t>(
+        options_.num_threads,
+        (count - done + options_.batch_size - 1) / options_.batch_size));
+    std::vector<std::thread> threads;
+    threads.reserve(num_batches - 1);
+    for (int batch = 0; batch < num_batches; batch++) {
+      int64_t size = std::min<int64_t>(options_.batch_size, count - done);
+      done += size;
+      RandomInputStream* randomness = streams[batch].get();
+      std::string* batch_records = &records[batch];
+      util::Status* status = &statuses[batch];
+      batch_records->clear();
+      if (batch + 1 < num_batches) {
+        threads.emplace_back([this, size, randomness, batch_records, status]() {
+          *status = GenerateRecords(size, randomness, batch_records);
+        });
+      } else {
+        *status = GenerateRecords(size, randomness, batch_records);
+      }
+    }
+    for (std::thread& thread : threads) thread.join();
+    for (int batch = 0; batch < num_batches; batch++) {
+      if (!statuses[batch].ok()) return statuses[batch];
+      util::Status status = WriteAll(records[batch], output);
+      if (!status.ok()) return status;
+    }
+  }
+  return util::OkStatus();
+}
+
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,199 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/bulk_keyset_generator.h"
+
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "tink/aead.h"
+#include "tink/aead/aead_config.h"
+#include "tink/aead/aead_key_templates.h"
+#include "tink/keyset_handle.h"
+#include "tink/util/ostream_output_stream.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "tink/util/test_keyset_handle.h"
+#include "tink/util/test_matchers.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace {
+
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::google::crypto::tink::EncryptedKeyset;
+using ::google::crypto::tink::Keyset;
+using ::google::crypto::tink::KeyStatusType;
+using ::google::crypto::tink::KeyTemplate;
+using ::testing::Eq;
+using ::testing::IsEmpty;
+using ::testing::SizeIs;
+
+class BulkKeysetGeneratorTest : public ::testing::Test {
+ protected:
+  void SetUp() override { ASSERT_THAT(AeadConfig::Register(), IsOk()); }
+};
+
+// Generates 'count' keysets and returns their records.
+std::vector<std::string> Generate(const BulkKeysetGenerator& generator,
+                                  int64_t count) {
+  auto output = absl::make_unique<std::stringstream>();
+  std::stringstream* output_ptr = output.get();
+  util::OstreamOutputStream output_stream(std::move(output));
+  EXPECT_THAT(generator.Generate(count, &output_stream), IsOk());
+  EXPECT_THAT(output_stream.Close(), IsOk());
+  std::string data = output_ptr->str();
+  std::vector<std::string> records;
+  absl::string_view remaining = data;
+  while (!remaining.empty()) {
+    uint64_t size = 0;
+    int shift = 0;
+    while (true) {
+      uint8_t byte = remaining[0];
+      remaining.remove_prefix(1);
+      size |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      shift += 7;
+      if (byte < 0x80) break;
+    }
+    records.push_back(std::string(remaining.substr(0, size)));
+    remaining.remove_prefix(size);
+  }
+  return records;
+}
+
+// Checks that 'keyset' holds one enabled primary key for 'key_template'.
+void ExpectSingleKeyKeyset(const Keyset& keyset,
+                           const KeyTemplate& key_template) {
+  ASSERT_THAT(keyset.key(), SizeIs(1));
+  EXPECT_THAT(keyset.primary_key_id(), Eq(keyset.key(0).key_id()));
+  EXPECT_THAT(keyset.key(0).status(), Eq(KeyStatusType::ENABLED));
+  EXPECT_THAT(keyset.key(0).output_prefix_type(),
+              Eq(key_template.output_prefix_type()));
+  EXPECT_THAT(keyset.key(0).key_data().type_url(),
+              Eq(key_template.type_url()));
+}
+
+TEST_F(BulkKeysetGeneratorTest, GeneratesIndependentKeysets) {
+  // AES-EAX keys cannot be derived, so they are generated one by one.
+  for (const KeyTemplate& key_template :
+       {AeadKeyTemplates::Aes128Gcm(), AeadKeyTemplates::Aes128Eax()}) {
+    SCOPED_TRACE(key_template.type_url());
+    BulkKeysetGenerator::Options options;
+    options.num_threads = 4;
+    options.batch_size = 30;
+    options.random_read_size = 100;
+    auto generator_result = BulkKeysetGenerator::New(key_template, options);
+    ASSERT_THAT(generator_result.status(), IsOk());
+    std::vector<std::string> records =
+        Generate(*generator_result.ValueOrDie(), 250);
+    ASSERT_THAT(records, SizeIs(250));
+    std::set<std::string> keys;
+    for (const std::string& record : records) {
+      Keyset keyset;
+      ASSERT_TRUE(keyset.ParseFromString(record));
+      ExpectSingleKeyKeyset(keyset, key_template);
+      keys.insert(keyset.key(0).key_data().value());
+    }
+    EXPECT_THAT(keys, SizeIs(records.size()));
+
+    Keyset keyset;
+    ASSERT_TRUE(keyset.ParseFromString(records.back()));
+    auto aead_result =
+        TestKeysetHandle::GetKeysetHandle(keyset)->GetPrimitive<Aead>();
+    ASSERT_THAT(aead_result.status(), IsOk());
+    auto ciphertext_result =
+        aead_result.ValueOrDie()->Encrypt("plaintext", "ad");
+    ASSERT_THAT(ciphertext_result.status(), IsOk());
+    auto plaintext_result = aead_result.ValueOrDie()->Decrypt(
+        ciphertext_result.ValueOrDie(), "ad");
+    ASSERT_THAT(plaintext_result.status(), IsOk());
+    EXPECT_THAT(plaintext_result.ValueOrDie(), Eq("plaintext"));
+  }
+}
+
+TEST_F(BulkKeysetGeneratorTest, EncryptsKeysets) {
+  auto master_key_result =
+      KeysetHandle::GenerateNew(AeadKeyTemplates::Aes256Gcm());
+  ASSERT_THAT(master_key_result.status(), IsOk());
+  auto master_key_aead_result =
+      master_key_result.ValueOrDie()->GetPrimitive<Aead>();
+  ASSERT_THAT(master_key_aead_result.status(), IsOk());
+  const Aead& master_key_aead = *master_key_aead_result.ValueOrDie();
+
+  BulkKeysetGenerator::Options options;
+  options.num_threads = 2;
+  options.master_key_aead = &master_key_aead;
+  KeyTemplate key_template = AeadKeyTemplates::Aes128Gcm();
+  auto generator_result = BulkKeysetGenerator::New(key_template, options);
+  ASSERT_THAT(generator_result.status(), IsOk());
+  std::vector<std::string> records =
+      Generate(*generator_result.ValueOrDie(), 10);
+  ASSERT_THAT(records, SizeIs(10));
+  for (const std::string& record : records) {
+    EncryptedKeyset encrypted_keyset;
+    ASSERT_TRUE(encrypted_keyset.ParseFromString(record));
+    auto decrypt_result = master_key_aead.Decrypt(
+        encrypted_keyset.encrypted_keyset(), /* associated_data= */ "");
+    ASSERT_THAT(decrypt_result.status(), IsOk());
+    Keyset keyset;
+    ASSERT_TRUE(keyset.ParseFromString(decrypt_result.ValueOrDie()));
+    ExpectSingleKeyKeyset(keyset, key_template);
+  }
+}
+
+TEST_F(BulkKeysetGeneratorTest, GeneratesNothingForZeroCount) {
+  auto generator_result = BulkKeysetGenerator::New(
+      AeadKeyTemplates::Aes128Gcm(), BulkKeysetGenerator::Options());
+  ASSERT_THAT(generator_result.status(), IsOk());
+  EXPECT_THAT(Generate(*generator_result.ValueOrDie(), 0), IsEmpty());
+}
+
+TEST_F(BulkKeysetGeneratorTest, InvalidArguments) {
+  BulkKeysetGenerator::Options options;
+  options.num_threads = 0;
+  EXPECT_THAT(
+      BulkKeysetGenerator::New(AeadKeyTemplates::Aes128Gcm(), options)
+          .status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+  KeyTemplate unknown_template = AeadKeyTemplates::Aes128Gcm();
+  unknown_template.set_type_url("type.googleapis.com/unknown");
+  EXPECT_THAT(BulkKeysetGenerator::New(unknown_template,
+                                       BulkKeysetGenerator::Options())
+                  .status(),
+              StatusIs(util::error::NOT_FOUND));
+  KeyTemplate unknown_prefix_template = AeadKeyTemplates::Aes128Gcm();
+  unknown_prefix_template.set_output_prefix_type(
+      google::crypto::tink::OutputPrefixType::UNKNOWN_PREFIX);
+  EXPECT_THAT(BulkKeysetGenerator::New(unknown_prefix_template,
+                                       BulkKeysetGenerator::Options())
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace tink
+}  // namespace crypto
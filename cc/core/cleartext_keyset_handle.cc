@@ -58,9 +58,8 @@ crypto::tink::util::Status CleartextKeysetHandle::Write(
 // static
 std::unique_ptr<KeysetHandle> CleartextKeysetHandle::GetKeysetHandle(
     const Keyset& keyset) {
-  auto unique_keyset = absl::make_unique<Keyset>(keyset);
-  std::unique_ptr<KeysetHandle> handle =
-      absl::WrapUnique(new KeysetHandle(std::move(unique_keyset)));
+  std::unique_ptr<KeysetHandle> handle(new KeysetHandle());
+  *handle->mutable_keyset() = keyset;
   return handle;
 }
 
@@ -25,18 +25,6 @@ using google::crypto::tink::OutputPrefixType;
 namespace crypto {
 namespace tink {
 
-namespace {
-// Writes bytes of 'value' in Big Endian order to 'buf'.
-// 'buf' must have at least 4 bytes allocated.
-void uint32_as_big_endian(uint32_t value, char* buf) {
-  buf[0] = 0xff & (value >> 24);
-  buf[1] = 0xff & (value >> 16);
-  buf[2] = 0xff & (value >> 8);
-  buf[3] = 0xff & (value >> 0);
-}
-
-}  // anonymous namespace
-
 const int CryptoFormat::kNonRawPrefixSize;
 const int CryptoFormat::kLegacyPrefixSize;
 const uint8_t CryptoFormat::kLegacyStartByte;
@@ -47,35 +35,35 @@ const uint8_t CryptoFormat::kTinkStartByte;
 const int CryptoFormat::kRawPrefixSize;
 const absl::string_view CryptoFormat::kRawPrefix = "";
 
+const int OutputPrefix::kMaxSize;
+static_assert(OutputPrefix::kMaxSize == CryptoFormat::kNonRawPrefixSize,
+              "OutputPrefix must hold non-RAW prefixes");
+
 // static
-crypto::tink::util::StatusOr<std::string> CryptoFormat::GetOutputPrefix(
+crypto::tink::util::StatusOr<OutputPrefix> CryptoFormat::GetFixedOutputPrefix(
     const google::crypto::tink::KeysetInfo::KeyInfo& key_info) {
   switch (key_info.output_prefix_type()) {
-    case OutputPrefixType::TINK: {
-      std::string prefix;
-      prefix.assign(reinterpret_cast<const char*>(&kTinkStartByte), 1);
-      char key_id_buf[4];
-      uint32_as_big_endian(key_info.key_id(), key_id_buf);
-      prefix.append(key_id_buf, 4);
-      return prefix;
-    }
+    case OutputPrefixType::TINK:
+      return TinkPrefix(key_info.key_id());
     case OutputPrefixType::CRUNCHY:
       // FALLTHROUGH
-    case OutputPrefixType::LEGACY: {
-      std::string prefix;
-      prefix.assign(reinterpret_cast<const char*>(&kLegacyStartByte), 1);
-      char key_id_buf[4];
-      uint32_as_big_endian(key_info.key_id(), key_id_buf);
-      prefix.append(key_id_buf, 4);
-      return prefix;
-    }
+    case OutputPrefixType::LEGACY:
+      return LegacyPrefix(key_info.key_id());
     case OutputPrefixType::RAW:
-      return std::string(kRawPrefix);
+      return OutputPrefix();
     default:
       return util::Status(crypto::tink::util::error::INVALID_ARGUMENT,
                           "The given key has invalid OutputPrefixType.");
   }
 }
 
+// static
+crypto::tink::util::StatusOr<std::string> CryptoFormat::GetOutputPrefix(
+    const google::crypto::tink::KeysetInfo::KeyInfo& key_info) {
+  auto prefix_result = GetFixedOutputPrefix(key_info);
+  if (!prefix_result.ok()) return prefix_result.status();
+  return std::string(prefix_result.ValueOrDie().view());
+}
+
 }  // namespace tink
 }  // namespace crypto
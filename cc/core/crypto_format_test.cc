@@ -97,6 +97,42 @@ TEST_F(CryptoFormatTest, testRawPrefix) {
   EXPECT_EQ(CryptoFormat::kRawPrefixSize, prefix.length());
 }
 
+TEST_F(CryptoFormatTest, testFixedOutputPrefix) {
+  for (OutputPrefixType type :
+       {OutputPrefixType::TINK, OutputPrefixType::LEGACY,
+        OutputPrefixType::CRUNCHY, OutputPrefixType::RAW}) {
+    KeysetInfo::KeyInfo key_info;
+    key_info.set_output_prefix_type(type);
+    key_info.set_key_id(0x80a0b0c0);
+    auto fixed_result = CryptoFormat::GetFixedOutputPrefix(key_info);
+    ASSERT_TRUE(fixed_result.ok()) << fixed_result.status();
+    auto string_result = CryptoFormat::GetOutputPrefix(key_info);
+    ASSERT_TRUE(string_result.ok()) << string_result.status();
+    EXPECT_EQ(string_result.ValueOrDie(), fixed_result.ValueOrDie().view());
+  }
+
+  KeysetInfo::KeyInfo key_info;
+  key_info.set_output_prefix_type(OutputPrefixType::UNKNOWN_PREFIX);
+  EXPECT_FALSE(CryptoFormat::GetFixedOutputPrefix(key_info).ok());
+}
+
+TEST_F(CryptoFormatTest, testConstexprOutputPrefix) {
+  constexpr OutputPrefix kTink = CryptoFormat::TinkPrefix(0x01020304);
+  static_assert(kTink.size() == 5, "");
+  static_assert(kTink[0] == 0x01 && kTink[4] == 0x04, "");
+  static_assert(kTink.AsInteger() == 0x0101020304, "");
+  constexpr OutputPrefix kLegacy = CryptoFormat::LegacyPrefix(0xffffffff);
+  static_assert(kLegacy.AsInteger() == 0x00ffffffff, "");
+  constexpr OutputPrefix kRaw;
+  static_assert(kRaw.empty() && kRaw.AsInteger() == 0, "");
+
+  EXPECT_EQ(std::string("\x01\x01\x02\x03\x04", 5), kTink.view());
+  EXPECT_EQ(std::string("\x00\xff\xff\xff\xff", 5), kLegacy.view());
+  EXPECT_EQ("", kRaw.view());
+  EXPECT_TRUE(kTink == CryptoFormat::TinkPrefix(0x01020304));
+  EXPECT_TRUE(kTink != CryptoFormat::LegacyPrefix(0x01020304));
+}
+
 }  // namespace
 }  // namespace tink
 }  // namespace crypto
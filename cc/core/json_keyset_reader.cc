@@ -21,10 +21,10 @@
 #include <sstream>
 
 #include "absl/memory/memory.h"
-#include "absl/strings/escaping.h"
 #include "absl/strings/str_cat.h"
 #include "include/rapidjson/document.h"
 #include "include/rapidjson/error/en.h"
+#include "tink/util/base64.h"
 #include "tink/util/enums.h"
 #include "tink/util/errors.h"
 #include "tink/util/protobuf_helper.h"
@@ -117,8 +117,8 @@ EncryptedKeysetFromJson(const rapidjson::Document& json_doc) {
   auto status = ValidateEncryptedKeyset(json_doc);
   if (!status.ok()) return status;
   std::string enc_keyset;
-  if (!absl::Base64Unescape(
-          json_doc["encryptedKeyset"].GetString(), &enc_keyset)) {
+  if (!util::Base64Decode(json_doc["encryptedKeyset"].GetString(),
+                          util::Base64Alphabet::kStandard, &enc_keyset)) {
     return util::Status(util::error::INVALID_ARGUMENT,
                             "Invalid JSON EncryptedKeyset");
   }
@@ -182,7 +182,8 @@ KeyDataFromJson(const rapidjson::Value& json_value) {
   auto status = ValidateKeyData(json_value);
   if (!status.ok()) return status;
   std::string value_field;
-  if (!absl::Base64Unescape(json_value["value"].GetString(), &value_field)) {
+  if (!util::Base64Decode(json_value["value"].GetString(),
+                          util::Base64Alphabet::kStandard, &value_field)) {
     return util::Status(util::error::INVALID_ARGUMENT,
                             "Invalid JSON KeyData");
   }
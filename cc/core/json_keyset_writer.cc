@@ -20,9 +20,9 @@
 #include <istream>
 #include <sstream>
 
-#include "absl/strings/escaping.h"
 #include "include/rapidjson/document.h"
 #include "include/rapidjson/prettywriter.h"
+#include "tink/util/base64.h"
 #include "tink/util/enums.h"
 #include "tink/util/errors.h"
 #include "tink/util/protobuf_helper.h"
@@ -56,8 +56,8 @@ util::Status ToJson(const KeyData& key_data,
                           *allocator);
   json_key_data->AddMember("keyMaterialType", material_type, *allocator);
 
-  std::string base64_string;
-  absl::Base64Escape(key_data.value(), &base64_string);
+  std::string base64_string = util::Base64Encode(
+      key_data.value(), util::Base64Alphabet::kStandard, /* padding = */ true);
   rapidjson::Value key_value(rapidjson::kStringType);
   key_value.SetString(base64_string.c_str(), *allocator);
   json_key_data->AddMember("value", key_value, *allocator);
@@ -154,8 +154,9 @@ util::StatusOr<std::string> ToJsonString(const EncryptedKeyset& keyset) {
   rapidjson::Document json_doc(rapidjson::kObjectType);
   auto& allocator = json_doc.GetAllocator();
 
-  std::string base64_string;
-  absl::Base64Escape(keyset.encrypted_keyset(), &base64_string);
+  std::string base64_string =
+      util::Base64Encode(keyset.encrypted_keyset(),
+                         util::Base64Alphabet::kStandard, /* padding = */ true);
   rapidjson::Value encrypted_keyset(rapidjson::kStringType);
   encrypted_keyset.SetString(base64_string.c_str(), allocator);
   json_doc.AddMember("encryptedKeyset", encrypted_keyset, allocator);
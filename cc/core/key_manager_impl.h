@@ -172,6 +172,13 @@ class KeyManagerImpl<
                        "Key type '%s' is not supported by this manager.",
                        key_data.type_url());
     }
+    // Factories which parse serialized keys themselves need no KeyProto.
+    auto primitive_result =
+        key_type_manager_->template GetPrimitiveFromSerialized<Primitive>(
+            key_data.value());
+    if (!primitive_result.ok() || primitive_result.ValueOrDie() != nullptr) {
+      return primitive_result;
+    }
     KeyProto key_proto;
     if (!key_proto.ParseFromString(key_data.value())) {
       return ToStatusF(util::error::INVALID_ARGUMENT,
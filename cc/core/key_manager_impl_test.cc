@@ -18,6 +18,8 @@
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
 #include "tink/aead.h"
 #include "tink/subtle/aes_gcm_boringssl.h"
 #include "tink/subtle/random.h"
@@ -538,6 +540,104 @@ TEST(CreateDeriverFunctionForTest, DeriverWithoutFactory) {
               StatusIs(util::error::UNIMPLEMENTED));
 }
 
+// A KeyTypeManager whose factory also creates primitives directly from the
+// serialized key, without going through ParseFromString and ValidateKey.
+class SerializedKeyTypeManager
+    : public KeyTypeManager<AesGcmKey, void, List<AeadVariant>> {
+ public:
+  class AeadVariantFactory : public PrimitiveFactory<AeadVariant> {
+   public:
+    crypto::tink::util::StatusOr<std::unique_ptr<AeadVariant>> Create(
+        const AesGcmKey& key) const override {
+      return absl::make_unique<AeadVariant>(
+          absl::StrCat("proto:", key.key_value()));
+    }
+
+    crypto::tink::util::StatusOr<std::unique_ptr<AeadVariant>>
+    CreateFromSerialized(absl::string_view serialized_key) const override {
+      KeyFieldsParser parser;
+      if (!parser.Parse(serialized_key)) {
+        return std::unique_ptr<AeadVariant>();
+      }
+      if (parser.bytes(3) == "invalid") {
+        return util::Status(util::error::INVALID_ARGUMENT, "invalid key");
+      }
+      return absl::make_unique<AeadVariant>(
+          absl::StrCat("serialized:", parser.bytes(3)));
+    }
+  };
+
+  SerializedKeyTypeManager()
+      : KeyTypeManager(absl::make_unique<AeadVariantFactory>()) {}
+
+  google::crypto::tink::KeyData::KeyMaterialType key_material_type()
+      const override {
+    return google::crypto::tink::KeyData::SYMMETRIC;
+  }
+
+  uint32_t get_version() const override { return 0; }
+
+  crypto::tink::util::Status ValidateKey(const AesGcmKey& key) const override {
+    return util::OkStatus();
+  }
+
+  const std::string& get_key_type() const override { return kKeyType; }
+
+ private:
+  const std::string kKeyType =
+      "type.googleapis.com/google.crypto.tink.AesGcmKey";
+};
+
+TEST(KeyManagerImplTest, GetPrimitiveUsesCreateFromSerialized) {
+  SerializedKeyTypeManager internal_km;
+  std::unique_ptr<KeyManager<AeadVariant>> key_manager =
+      MakeKeyManager<AeadVariant>(&internal_km);
+
+  AesGcmKey key;
+  key.set_key_value("some key");
+  auto aead_variant =
+      key_manager->GetPrimitive(test::AsKeyData(key, KeyData::SYMMETRIC));
+  ASSERT_THAT(aead_variant.status(), IsOk());
+  EXPECT_THAT(aead_variant.ValueOrDie()->get(), Eq("serialized:some key"));
+
+  // GetPrimitive(MessageLite) has a parsed key already.
+  auto from_key = key_manager->GetPrimitive(key);
+  ASSERT_THAT(from_key.status(), IsOk());
+  EXPECT_THAT(from_key.ValueOrDie()->get(), Eq("proto:some key"));
+}
+
+TEST(KeyManagerImplTest, GetPrimitiveReturnsCreateFromSerializedError) {
+  SerializedKeyTypeManager internal_km;
+  std::unique_ptr<KeyManager<AeadVariant>> key_manager =
+      MakeKeyManager<AeadVariant>(&internal_km);
+
+  AesGcmKey key;
+  key.set_key_value("invalid");
+  EXPECT_THAT(
+      key_manager->GetPrimitive(test::AsKeyData(key, KeyData::SYMMETRIC))
+          .status(),
+      StatusIs(util::error::INVALID_ARGUMENT, HasSubstr("invalid key")));
+}
+
+TEST(KeyManagerImplTest, GetPrimitiveFallsBackToProtoParsing) {
+  SerializedKeyTypeManager internal_km;
+  std::unique_ptr<KeyManager<AeadVariant>> key_manager =
+      MakeKeyManager<AeadVariant>(&internal_km);
+
+  // A repeated field makes the KeyFieldsParser give up; the proto parser
+  // keeps the last value.
+  AesGcmKey first_key;
+  first_key.set_key_value("first");
+  AesGcmKey second_key;
+  second_key.set_key_value("second");
+  KeyData key_data = test::AsKeyData(first_key, KeyData::SYMMETRIC);
+  key_data.set_value(absl::StrCat(first_key.SerializeAsString(),
+                                  second_key.SerializeAsString()));
+  auto aead_variant = key_manager->GetPrimitive(key_data);
+  ASSERT_THAT(aead_variant.status(), IsOk());
+  EXPECT_THAT(aead_variant.ValueOrDie()->get(), Eq("proto:second"));
+}
+
 
 }  // namespace
 
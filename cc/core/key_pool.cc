@@ -0,0 +1,256 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/key_pool.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <pthread.h>
+#endif
+
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+#include "tink/core/registry_impl.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+
+using ::google::crypto::tink::KeyData;
+using ::google::crypto::tink::KeyTemplate;
+
+namespace {
+
+// The key data of a key template does not depend on its output prefix type.
+bool GeneratesSameKeys(const KeyTemplate& a, const KeyTemplate& b) {
+  return a.type_url() == b.type_url() && a.value() == b.value();
+}
+
+// Incremented in the child process after a fork(), so that the child
+// discards the keys copied from the parent instead of handing out the same
+// keys as the parent.
+std::atomic<uint64_t> fork_generation{0};
+
+void IncrementForkGeneration() {
+  fork_generation.fetch_add(1, std::memory_order_relaxed);
+}
+
+void RegisterForkHandler() {
+#if !defined(_WIN32)
+  static const bool registered =
+      pthread_atfork(nullptr, nullptr, &IncrementForkGeneration) == 0;
+  (void)registered;
+#endif
+}
+
+}  // namespace
+
+// static
+util::StatusOr<std::shared_ptr<KeyPool>> KeyPool::New(
+    std::vector<KeyTemplate> key_templates, const Options& options) {
+  if (key_templates.empty()) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "key_templates must be non-empty");
+  }
+  for (size_t i = 0; i < key_templates.size(); i++) {
+    for (size_t j = 0; j < i; j++) {
+      if (GeneratesSameKeys(key_templates[i], key_templates[j])) {
+        return util::Status(util::error::INVALID_ARGUMENT,
+                            "key_templates must be different");
+      }
+    }
+  }
+  if (options.depth <= 0) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "depth must be positive");
+  }
+  if (options.num_threads <= 0) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "num_threads must be positive");
+  }
+  RegisterForkHandler();
+  std::shared_ptr<KeyPool> pool(new KeyPool(std::move(key_templates), options));
+  {
+    absl::MutexLock lock(&pool->mutex_);
+    pool->fork_generation_ = fork_generation.load(std::memory_order_relaxed);
+    pool->StartThreads();
+  }
+  return std::move(pool);
+}
+
+// static
+void KeyPool::Install(std::shared_ptr<KeyPool> pool) {
+  if (pool == nullptr) {
+    RegistryImpl::GlobalInstance().SetKeyDataSource(nullptr);
+    return;
+  }
+  RegistryImpl::GlobalInstance().SetKeyDataSource(
+      [pool](const KeyTemplate& key_template) {
+        return pool->Take(key_template);
+      });
+}
+
+KeyPool::KeyPool(std::vector<KeyTemplate> key_templates,
+                 const Options& options)
+    : key_templates_(std::move(key_templates)),
+      options_(options),
+      pools_(key_templates_.size()) {}
+
+KeyPool::~KeyPool() {
+  std::unique_ptr<std::vector<std::thread>> threads;
+  {
+    absl::MutexLock lock(&mutex_);
+    stopped_ = true;
+    DiscardAfterFork();
+    threads = std::move(threads_);
+  }
+  for (std::thread& thread : *threads) thread.join();
+}
+
+std::unique_ptr<KeyData> KeyPool::Take(const KeyTemplate& key_template) {
+  int index = Find(key_template);
+  if (index < 0) return nullptr;
+  util::SecretData serialized_key_data;
+  {
+    absl::MutexLock lock(&mutex_);
+    DiscardAfterFork();
+    std::deque<util::SecretData>& keys = pools_[index].keys;
+    if (keys.empty()) return nullptr;
+    serialized_key_data = std::move(keys.front());
+    keys.pop_front();
+  }
+  auto key_data = absl::make_unique<KeyData>();
+  if (!key_data->ParseFromArray(serialized_key_data.data(),
+                                serialized_key_data.size())) {
+    return nullptr;
+  }
+  return key_data;
+}
+
+int KeyPool::size(const KeyTemplate& key_template) const {
+  int index = Find(key_template);
+  if (index < 0) return 0;
+  absl::MutexLock lock(&mutex_);
+  DiscardAfterFork();
+  return pools_[index].keys.size();
+}
+
+bool KeyPool::WaitUntilFull(absl::Duration timeout) const {
+  absl::MutexLock lock(&mutex_);
+  DiscardAfterFork();
+  return mutex_.AwaitWithTimeout(absl::Condition(this, &KeyPool::IsFull),
+                                 timeout);
+}
+
+util::Status KeyPool::last_error() const {
+  absl::MutexLock lock(&mutex_);
+  return last_error_;
+}
+
+int KeyPool::Find(const KeyTemplate& key_template) const {
+  for (int i = 0; i < static_cast<int>(key_templates_.size()); i++) {
+    if (GeneratesSameKeys(key_templates_[i], key_template)) return i;
+  }
+  return -1;
+}
+
+int KeyPool::NextToFill() const {
+  int next = -1;
+  int next_count = options_.depth;
+  for (int i = 0; i < static_cast<int>(pools_.size()); i++) {
+    int count = pools_[i].keys.size() + pools_[i].in_flight;
+    if (count < next_count) {
+      next = i;
+      next_count = count;
+    }
+  }
+  return next;
+}
+
+bool KeyPool::HasWork() const { return stopped_ || NextToFill() >= 0; }
+
+bool KeyPool::IsFull() const {
+  for (const TemplatePool& pool : pools_) {
+    if (static_cast<int>(pool.keys.size()) < options_.depth) return false;
+  }
+  return true;
+}
+
+void KeyPool::StartThreads() const {
+  threads_ = absl::make_unique<std::vector<std::thread>>();
+  if (stopped_) return;
+  for (int i = 0; i < options_.num_threads; i++) {
+    threads_->emplace_back([this]() { Run(); });
+  }
+}
+
+void KeyPool::DiscardAfterFork() const {
+  uint64_t generation = fork_generation.load(std::memory_order_relaxed);
+  if (fork_generation_ == generation) return;
+  fork_generation_ = generation;
+  // Destroying the keys zeroizes them. The keys being generated were
+  // generated by threads of the parent.
+  for (TemplatePool& pool : pools_) {
+    pool.keys.clear();
+    pool.in_flight = 0;
+  }
+  // The threads of the parent do not exist in this process, and joining or
+  // detaching their handles is undefined, so the handles are leaked.
+  (void)threads_.release();
+  StartThreads();
+}
+
+void KeyPool::Run() const {
+  absl::MutexLock lock(&mutex_);
+  while (true) {
+    mutex_.Await(absl::Condition(this, &KeyPool::HasWork));
+    if (stopped_) return;
+    int index = NextToFill();
+    pools_[index].in_flight++;
+    mutex_.Unlock();
+    auto key_data_result =
+        RegistryImpl::GlobalInstance().GenerateKeyData(key_templates_[index]);
+    util::SecretData serialized_key_data;
+    if (key_data_result.ok()) {
+      std::string serialized =
+          key_data_result.ValueOrDie()->SerializeAsString();
+      serialized_key_data = util::SecretDataFromStringView(serialized);
+      util::SafeZeroString(&serialized);
+    }
+    mutex_.Lock();
+    pools_[index].in_flight--;
+    if (!key_data_result.ok()) {
+      last_error_ = key_data_result.status();
+      // Avoids spinning on key types which are not registered, or do not
+      // allow new keys.
+      mutex_.AwaitWithTimeout(absl::Condition(&stopped_),
+                              options_.retry_interval);
+      continue;
+    }
+    pools_[index].keys.push_back(std::move(serialized_key_data));
+  }
+}
+
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,287 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/key_pool.h"
+
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+
+#if !defined(_WIN32)
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "tink/aead/aead_config.h"
+#include "tink/aead/aead_key_templates.h"
+#include "tink/core/registry_impl.h"
+#include "tink/keyset_handle.h"
+#include "tink/mac/mac_key_templates.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "tink/util/test_keyset_handle.h"
+#include "tink/util/test_matchers.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace {
+
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::google::crypto::tink::KeyData;
+using ::google::crypto::tink::KeyTemplate;
+using ::testing::Eq;
+using ::testing::Ge;
+using ::testing::IsNull;
+using ::testing::Not;
+using ::testing::NotNull;
+
+constexpr absl::Duration kTimeout = absl::Seconds(30);
+
+class KeyPoolTest : public ::testing::Test {
+ protected:
+  void SetUp() override { ASSERT_THAT(AeadConfig::Register(), IsOk()); }
+  void TearDown() override { KeyPool::Install(nullptr); }
+};
+
+TEST_F(KeyPoolTest, InvalidArguments) {
+  KeyPool::Options options;
+  EXPECT_THAT(KeyPool::New({}, options).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(KeyPool::New({AeadKeyTemplates::Aes128Gcm(),
+                            AeadKeyTemplates::Aes128Gcm()},
+                           options)
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+
+  options.depth = 0;
+  EXPECT_THAT(KeyPool::New({AeadKeyTemplates::Aes128Gcm()}, options).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  options.depth = 1;
+  options.num_threads = 0;
+  EXPECT_THAT(KeyPool::New({AeadKeyTemplates::Aes128Gcm()}, options).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST_F(KeyPoolTest, FillsToDepth) {
+  KeyPool::Options options;
+  options.depth = 3;
+  options.num_threads = 2;
+  auto pool_result = KeyPool::New(
+      {AeadKeyTemplates::Aes128Gcm(), AeadKeyTemplates::Aes256Gcm()}, options);
+  ASSERT_THAT(pool_result.status(), IsOk());
+  const KeyPool& pool = *pool_result.ValueOrDie();
+
+  ASSERT_TRUE(pool.WaitUntilFull(kTimeout));
+  EXPECT_THAT(pool.size(AeadKeyTemplates::Aes128Gcm()), Eq(3));
+  EXPECT_THAT(pool.size(AeadKeyTemplates::Aes256Gcm()), Eq(3));
+  EXPECT_THAT(pool.size(MacKeyTemplates::HmacSha256()), Eq(0));
+  EXPECT_THAT(pool.last_error(), IsOk());
+}
+
+TEST_F(KeyPoolTest, TakeReturnsDistinctKeysAndRefills) {
+  KeyPool::Options options;
+  options.depth = 4;
+  auto pool_result = KeyPool::New({AeadKeyTemplates::Aes128Gcm()}, options);
+  ASSERT_THAT(pool_result.status(), IsOk());
+  KeyPool& pool = *pool_result.ValueOrDie();
+  ASSERT_TRUE(pool.WaitUntilFull(kTimeout));
+
+  std::set<std::string> values;
+  for (int i = 0; i < options.depth; i++) {
+    std::unique_ptr<KeyData> key_data =
+        pool.Take(AeadKeyTemplates::Aes128Gcm());
+    ASSERT_THAT(key_data, NotNull());
+    EXPECT_THAT(key_data->type_url(),
+                Eq(AeadKeyTemplates::Aes128Gcm().type_url()));
+    EXPECT_THAT(key_data->key_material_type(), Eq(KeyData::SYMMETRIC));
+    values.insert(key_data->value());
+  }
+  EXPECT_THAT(values.size(), Eq(options.depth));
+  EXPECT_TRUE(pool.WaitUntilFull(kTimeout));
+}
+
+TEST_F(KeyPoolTest, TakeIgnoresOutputPrefixType) {
+  KeyPool::Options options;
+  options.depth = 1;
+  auto pool_result = KeyPool::New({AeadKeyTemplates::Aes128Gcm()}, options);
+  ASSERT_THAT(pool_result.status(), IsOk());
+  KeyPool& pool = *pool_result.ValueOrDie();
+  ASSERT_TRUE(pool.WaitUntilFull(kTimeout));
+
+  KeyTemplate raw_template = AeadKeyTemplates::Aes128Gcm();
+  raw_template.set_output_prefix_type(google::crypto::tink::RAW);
+  EXPECT_THAT(pool.Take(raw_template), NotNull());
+}
+
+TEST_F(KeyPoolTest, TakeReturnsNullForOtherTemplates) {
+  KeyPool::Options options;
+  options.depth = 1;
+  auto pool_result = KeyPool::New({AeadKeyTemplates::Aes128Gcm()}, options);
+  ASSERT_THAT(pool_result.status(), IsOk());
+  KeyPool& pool = *pool_result.ValueOrDie();
+  ASSERT_TRUE(pool.WaitUntilFull(kTimeout));
+
+  EXPECT_THAT(pool.Take(AeadKeyTemplates::Aes256Gcm()), IsNull());
+  EXPECT_THAT(pool.Take(MacKeyTemplates::HmacSha256()), IsNull());
+}
+
+TEST_F(KeyPoolTest, ReportsGenerationErrors) {
+  KeyTemplate unknown_template = AeadKeyTemplates::Aes128Gcm();
+  unknown_template.set_type_url("type.googleapis.com/some.unknown.KeyType");
+  KeyPool::Options options;
+  options.depth = 1;
+  options.retry_interval = absl::Milliseconds(10);
+  auto pool_result = KeyPool::New(
+      {unknown_template, AeadKeyTemplates::Aes128Gcm()}, options);
+  ASSERT_THAT(pool_result.status(), IsOk());
+  const KeyPool& pool = *pool_result.ValueOrDie();
+
+  absl::Time deadline = absl::Now() + kTimeout;
+  while (pool.last_error().ok() && absl::Now() < deadline) {
+    absl::SleepFor(absl::Milliseconds(1));
+  }
+  EXPECT_THAT(pool.last_error(), StatusIs(util::error::NOT_FOUND));
+  EXPECT_FALSE(pool.WaitUntilFull(absl::Milliseconds(50)));
+  EXPECT_THAT(pool.size(unknown_template), Eq(0));
+}
+
+#if !defined(_WIN32)
+TEST_F(KeyPoolTest, ForkedProcessesTakeDistinctKeys) {
+  KeyPool::Options options;
+  options.depth = 2;
+  auto pool_result = KeyPool::New({AeadKeyTemplates::Aes128Gcm()}, options);
+  ASSERT_THAT(pool_result.status(), IsOk());
+  KeyPool& pool = *pool_result.ValueOrDie();
+  // The threads wait without holding the pool's mutex while it is full.
+  ASSERT_TRUE(pool.WaitUntilFull(kTimeout));
+
+  int fds[2];
+  ASSERT_THAT(pipe(fds), Eq(0));
+  pid_t pid = fork();
+  ASSERT_THAT(pid, Ge(0));
+  if (pid == 0) {
+    close(fds[0]);
+    // The keys copied from the parent are gone, and new threads refill the
+    // pool.
+    int exit_code = 1;
+    if (pool.size(AeadKeyTemplates::Aes128Gcm()) == 0 &&
+        pool.WaitUntilFull(kTimeout)) {
+      std::unique_ptr<KeyData> key_data =
+          pool.Take(AeadKeyTemplates::Aes128Gcm());
+      if (key_data != nullptr &&
+          write(fds[1], key_data->value().data(), key_data->value().size()) ==
+              static_cast<ssize_t>(key_data->value().size())) {
+        exit_code = 0;
+      }
+    }
+    _exit(exit_code);
+  }
+  close(fds[1]);
+  std::string child_value;
+  char buffer[256];
+  ssize_t read_size;
+  while ((read_size = read(fds[0], buffer, sizeof(buffer))) > 0) {
+    child_value.append(buffer, read_size);
+  }
+  close(fds[0]);
+  int status;
+  ASSERT_THAT(waitpid(pid, &status, 0), Eq(pid));
+  ASSERT_TRUE(WIFEXITED(status));
+  ASSERT_THAT(WEXITSTATUS(status), Eq(0));
+
+  std::set<std::string> parent_values;
+  for (int i = 0; i < options.depth; i++) {
+    std::unique_ptr<KeyData> key_data =
+        pool.Take(AeadKeyTemplates::Aes128Gcm());
+    ASSERT_THAT(key_data, NotNull());
+    parent_values.insert(key_data->value());
+  }
+  EXPECT_THAT(parent_values.count(child_value), Eq(0));
+}
+#endif
+
+TEST_F(KeyPoolTest, NewKeyDataTakesKeysFromSource) {
+  KeyData pooled_key_data;
+  pooled_key_data.set_type_url(AeadKeyTemplates::Aes128Gcm().type_url());
+  pooled_key_data.set_value("pooled key");
+  pooled_key_data.set_key_material_type(KeyData::SYMMETRIC);
+  RegistryImpl::GlobalInstance().SetKeyDataSource(
+      [&pooled_key_data](
+          const KeyTemplate& key_template) -> std::unique_ptr<KeyData> {
+        if (key_template.type_url() != pooled_key_data.type_url()) {
+          return nullptr;
+        }
+        return absl::make_unique<KeyData>(pooled_key_data);
+      });
+
+  auto handle_result = KeysetHandle::GenerateNew(AeadKeyTemplates::Aes128Gcm());
+  ASSERT_THAT(handle_result.status(), IsOk());
+  EXPECT_THAT(TestKeysetHandle::GetKeyset(*handle_result.ValueOrDie())
+                  .key(0)
+                  .key_data()
+                  .value(),
+              Eq("pooled key"));
+
+  // Other key types are generated as usual.
+  auto other_handle_result =
+      KeysetHandle::GenerateNew(AeadKeyTemplates::Aes256Gcm());
+  ASSERT_THAT(other_handle_result.status(), IsOk());
+  EXPECT_THAT(TestKeysetHandle::GetKeyset(*other_handle_result.ValueOrDie())
+                  .key(0)
+                  .key_data()
+                  .value(),
+              Not(Eq("pooled key")));
+
+  // GenerateKeyData never takes keys from the source.
+  auto key_data_result = RegistryImpl::GlobalInstance().GenerateKeyData(
+      AeadKeyTemplates::Aes128Gcm());
+  ASSERT_THAT(key_data_result.status(), IsOk());
+  EXPECT_THAT(key_data_result.ValueOrDie()->value(), Not(Eq("pooled key")));
+
+  RegistryImpl::GlobalInstance().SetKeyDataSource(nullptr);
+}
+
+TEST_F(KeyPoolTest, InstalledPoolServesGenerateNew) {
+  KeyPool::Options options;
+  options.depth = 2;
+  auto pool_result = KeyPool::New({AeadKeyTemplates::Aes128Gcm()}, options);
+  ASSERT_THAT(pool_result.status(), IsOk());
+  std::shared_ptr<KeyPool> pool = std::move(pool_result.ValueOrDie());
+  ASSERT_TRUE(pool->WaitUntilFull(kTimeout));
+
+  KeyPool::Install(pool);
+  EXPECT_THAT(pool.use_count(), Eq(2));
+  for (int i = 0; i < 2 * options.depth; i++) {
+    auto handle_result =
+        KeysetHandle::GenerateNew(AeadKeyTemplates::Aes128Gcm());
+    ASSERT_THAT(handle_result.status(), IsOk());
+  }
+
+  KeyPool::Install(nullptr);
+  EXPECT_THAT(pool.use_count(), Eq(1));
+}
+
+}  // namespace
+}  // namespace tink
+}  // namespace crypto
@@ -17,9 +17,12 @@
 #ifndef TINK_CORE_KEY_TYPE_MANAGER_H_
 #define TINK_CORE_KEY_TYPE_MANAGER_H_
 
+#include <cstdint>
+#include <memory>
 #include <tuple>
 
 #include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
 #include "tink/core/template_util.h"
 #include "tink/input_stream.h"
 #include "tink/util/status.h"
@@ -30,6 +33,111 @@ namespace crypto {
 namespace tink {
 
 namespace internal {
+// A parser of serialized key protos whose fields are scalars, bytes or
+// nested messages numbered below kMaxFieldNumber, as in
+//   message HmacKey {
+//     uint32 version = 1; HmacParams params = 2; bytes key_value = 3;
+//   }
+// It does not copy: bytes and nested messages are returned as views into
+// the serialized key, so that key material can be copied straight into a
+// util::SecretData. Nested messages are parsed by another KeyFieldsParser.
+class KeyFieldsParser {
+ public:
+  static constexpr int kMaxFieldNumber = 16;
+
+  // Parses 'serialized', and returns false if it is malformed, or if it
+  // repeats a field or contains groups. Callers then parse the proto with
+  // ParseFromString(), which handles these cases. Fields with other numbers
+  // are skipped, like unknown fields.
+  bool Parse(absl::string_view serialized) {
+    present_ = 0;
+    while (!serialized.empty()) {
+      uint64_t tag;
+      if (!ReadVarint(&serialized, &tag)) return false;
+      uint64_t field_number = tag >> 3;
+      if (field_number == 0) return false;
+      bool known = field_number < kMaxFieldNumber;
+      if (known) {
+        uint32_t bit = uint32_t{1} << field_number;
+        if (present_ & bit) return false;
+        present_ |= bit;
+      }
+      switch (tag & 7) {
+        case 0: {  // varint
+          uint64_t value;
+          if (!ReadVarint(&serialized, &value)) return false;
+          if (known) {
+            varints_[field_number] = value;
+            bytes_[field_number] = absl::string_view();
+          }
+          break;
+        }
+        case 1:  // fixed64
+          if (serialized.size() < 8) return false;
+          serialized.remove_prefix(8);
+          if (known) present_ &= ~(uint32_t{1} << field_number);
+          break;
+        case 2: {  // length-delimited
+          uint64_t size;
+          if (!ReadVarint(&serialized, &size) || size > serialized.size()) {
+            return false;
+          }
+          if (known) {
+            varints_[field_number] = 0;
+            bytes_[field_number] = serialized.substr(0, size);
+          }
+          serialized.remove_prefix(size);
+          break;
+        }
+        case 5:  // fixed32
+          if (serialized.size() < 4) return false;
+          serialized.remove_prefix(4);
+          if (known) present_ &= ~(uint32_t{1} << field_number);
+          break;
+        default:  // groups, or invalid
+          return false;
+      }
+    }
+    return true;
+  }
+
+  // Returns the value of the varint field 'field_number', or 0 if it is
+  // absent, as for the default value of a scalar field.
+  uint64_t varint(int field_number) const {
+    return has(field_number) ? varints_[field_number] : 0;
+  }
+
+  // Returns the contents of the length-delimited field 'field_number', or
+  // an empty view if it is absent.
+  absl::string_view bytes(int field_number) const {
+    return has(field_number) ? bytes_[field_number] : absl::string_view();
+  }
+
+  bool has(int field_number) const {
+    return field_number > 0 && field_number < kMaxFieldNumber &&
+           (present_ & (uint32_t{1} << field_number)) != 0;
+  }
+
+ private:
+  static bool ReadVarint(absl::string_view* input, uint64_t* value) {
+    uint64_t result = 0;
+    for (size_t i = 0; i < 10 && i < input->size(); i++) {
+      uint8_t byte = static_cast<uint8_t>((*input)[i]);
+      result |= static_cast<uint64_t>(byte & 0x7f) << (7 * i);
+      if (byte < 0x80) {
+        input->remove_prefix(i + 1);
+        *value = result;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  uint32_t present_ = 0;
+  uint64_t varints_[kMaxFieldNumber];
+  absl::string_view bytes_[kMaxFieldNumber];
+};
+
 // InternalKeyFactory should not be used directly: it is an implementation
 // detail. The internal key factory provides the functions which are required
 // if a KeyTypeManager can create new keys: ValidateKeyFormat and
@@ -111,6 +219,16 @@ class KeyTypeManager<KeyProtoParam, KeyFormatProtoParam, List<Primitives...>>
     virtual ~PrimitiveFactory() {}
     virtual crypto::tink::util::StatusOr<std::unique_ptr<Primitive>> Create(
         const KeyProto& key) const = 0;
+    // Creates the primitive from 'serialized_key', a serialized KeyProto,
+    // without parsing it into a KeyProto, e.g. with a KeyFieldsParser.
+    // Implementations must validate the key like ValidateKey(). Returns a
+    // null primitive if this is not supported, or if 'serialized_key' cannot
+    // be parsed this way: the key is then parsed into a KeyProto, validated
+    // and passed to Create().
+    virtual crypto::tink::util::StatusOr<std::unique_ptr<Primitive>>
+    CreateFromSerialized(absl::string_view serialized_key) const {
+      return std::unique_ptr<Primitive>();
+    }
   };
 
   // Creates a new KeyTypeManager. The parameter(s) primitives must be some
@@ -140,6 +258,15 @@ class KeyTypeManager<KeyProtoParam, KeyFormatProtoParam, List<Primitives...>>
     return GetPrimitiveImpl<Primitive>(key);
   }
 
+  // Creates a new primitive from 'serialized_key' with
+  // PrimitiveFactory::CreateFromSerialized(), which may return a null
+  // primitive.
+  template <typename Primitive>
+  util::StatusOr<std::unique_ptr<Primitive>> GetPrimitiveFromSerialized(
+      absl::string_view serialized_key) const {
+    return GetPrimitiveFromSerializedImpl<Primitive>(serialized_key);
+  }
+
  private:
   // TODO(C++17) replace with `constexpr if` after migration
   template <typename Primitive>
@@ -163,6 +290,24 @@ class KeyTypeManager<KeyProtoParam, KeyFormatProtoParam, List<Primitives...>>
     return std::get<index>(primitive_factories_)->Create(key);
   }
 
+  template <typename Primitive>
+  typename std::enable_if<
+      !internal::OccursInTuple<Primitive, std::tuple<Primitives...>>::value,
+      util::StatusOr<std::unique_ptr<Primitive>>>::type
+  GetPrimitiveFromSerializedImpl(absl::string_view serialized_key) const {
+    return std::unique_ptr<Primitive>();
+  }
+  template <typename Primitive>
+  typename std::enable_if<
+      internal::OccursInTuple<Primitive, std::tuple<Primitives...>>::value,
+      util::StatusOr<std::unique_ptr<Primitive>>>::type
+  GetPrimitiveFromSerializedImpl(absl::string_view serialized_key) const {
+    constexpr size_t index =
+        internal::IndexOf<Primitive, List<Primitives...>>::value;
+    return std::get<index>(primitive_factories_)
+        ->CreateFromSerialized(serialized_key);
+  }
+
   std::tuple<std::unique_ptr<PrimitiveFactory<Primitives>>...>
       primitive_factories_;
 };
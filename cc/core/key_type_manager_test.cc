@@ -21,6 +21,8 @@
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
 #include "tink/aead.h"
 #include "tink/subtle/aes_gcm_boringssl.h"
 #include "tink/subtle/random.h"
@@ -28,6 +30,7 @@
 #include "tink/util/status.h"
 #include "tink/util/statusor.h"
 #include "tink/util/test_matchers.h"
+#include "tink/util/test_util.h"
 #include "tink/util/validation.h"
 #include "proto/aes_gcm.pb.h"
 
@@ -211,6 +214,85 @@ TEST(KeyManagerWithoutFactoryTest, CreateFails) {
   EXPECT_THAT(failing.status(), test::StatusIs(util::error::INVALID_ARGUMENT));
 }
 
+TEST(KeyTypeManagerTest, GetPrimitiveFromSerializedDefaultsToNull) {
+  AesGcmKey key;
+  key.set_key_value("0123456789abcdef");
+  std::string serialized_key = key.SerializeAsString();
+  auto aead_result =
+      ExampleKeyTypeManager().GetPrimitiveFromSerialized<Aead>(serialized_key);
+  ASSERT_THAT(aead_result.status(), test::IsOk());
+  EXPECT_THAT(aead_result.ValueOrDie(), Eq(nullptr));
+  auto failing = ExampleKeyTypeManagerWithoutFactory()
+                     .GetPrimitiveFromSerialized<NotRegistered>(serialized_key);
+  ASSERT_THAT(failing.status(), test::IsOk());
+  EXPECT_THAT(failing.ValueOrDie(), Eq(nullptr));
+}
+
+TEST(KeyFieldsParserTest, ParsesFields) {
+  AesGcmKey key;
+  key.set_version(300);
+  key.set_key_value("key value");
+  std::string serialized_key = key.SerializeAsString();
+  internal::KeyFieldsParser parser;
+  ASSERT_TRUE(parser.Parse(serialized_key));
+  EXPECT_TRUE(parser.has(1));
+  EXPECT_THAT(parser.varint(1), Eq(300));
+  EXPECT_TRUE(parser.has(3));
+  EXPECT_THAT(parser.bytes(3), Eq("key value"));
+  // Absent fields have default values.
+  EXPECT_FALSE(parser.has(2));
+  EXPECT_THAT(parser.varint(2), Eq(0));
+  EXPECT_THAT(parser.bytes(2), Eq(""));
+
+  ASSERT_TRUE(parser.Parse(""));
+  EXPECT_FALSE(parser.has(1));
+  EXPECT_THAT(parser.varint(1), Eq(0));
+  EXPECT_THAT(parser.bytes(3), Eq(""));
+}
+
+TEST(KeyFieldsParserTest, SkipsUnknownFields) {
+  AesGcmKey key;
+  key.set_version(1);
+  key.set_key_value("key value");
+  std::string serialized = absl::StrCat(
+      std::string("\x25\x01\x02\x03\x04", 5),           // fixed32 field 4
+      std::string("\x29\x01\x02\x03\x04\x05\x06\x07\x08", 9),  // fixed64 5
+      key.SerializeAsString(),
+      std::string("\xa0\x01\x05", 3),                   // varint field 20
+      std::string("\xf2\x01\x02xy", 5));                // bytes field 30
+  internal::KeyFieldsParser parser;
+  ASSERT_TRUE(parser.Parse(serialized));
+  EXPECT_THAT(parser.varint(1), Eq(1));
+  EXPECT_THAT(parser.bytes(3), Eq("key value"));
+  EXPECT_FALSE(parser.has(4));
+  EXPECT_FALSE(parser.has(5));
+  EXPECT_FALSE(parser.has(20));
+}
+
+TEST(KeyFieldsParserTest, RejectsRepeatedFields) {
+  AesGcmKey key;
+  key.set_key_value("key value");
+  internal::KeyFieldsParser parser;
+  EXPECT_FALSE(parser.Parse(
+      absl::StrCat(key.SerializeAsString(), key.SerializeAsString())));
+}
+
+TEST(KeyFieldsParserTest, RejectsMalformedInput) {
+  internal::KeyFieldsParser parser;
+  for (absl::string_view serialized :
+       {absl::string_view("\x08", 1),        // missing varint
+        absl::string_view("\x08\x80", 2),    // truncated varint
+        absl::string_view("\x08\xff\xff\xff\xff\xff\xff\xff\xff\xff\xff\x01",
+                          12),               // varint too long
+        absl::string_view("\x1a\x05" "abcd", 6),  // truncated bytes
+        absl::string_view("\x25\x01\x02", 3),  // truncated fixed32
+        absl::string_view("\x0b\x0c", 2),    // group
+        absl::string_view("\x0e\x00", 2),    // invalid wire type
+        absl::string_view("\x00\x00", 2)}) {  // field number 0
+    EXPECT_FALSE(parser.Parse(serialized)) << test::HexEncode(serialized);
+  }
+}
+
 }  // namespace
 
 }  // namespace tink
@@ -0,0 +1,44 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/key_usage.h"
+
+#include <atomic>
+
+namespace crypto {
+namespace tink {
+
+namespace {
+
+std::atomic<bool>& AdaptiveKeyTrialOrder() {
+  static std::atomic<bool>* adaptive = new std::atomic<bool>(false);
+  return *adaptive;
+}
+
+}  // namespace
+
+// static
+void KeyTrialOrder::SetAdaptive(bool adaptive) {
+  AdaptiveKeyTrialOrder().store(adaptive, std::memory_order_relaxed);
+}
+
+// static
+bool KeyTrialOrder::IsAdaptive() {
+  return AdaptiveKeyTrialOrder().load(std::memory_order_relaxed);
+}
+
+}  // namespace tink
+}  // namespace crypto
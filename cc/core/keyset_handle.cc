@@ -15,16 +15,22 @@
 ///////////////////////////////////////////////////////////////////////////////
 #include "tink/keyset_handle.h"
 
+#include <cstdint>
 #include <memory>
+#include <string>
 
 #include "absl/memory/memory.h"
+#include "google/protobuf/arena.h"
 #include "tink/aead.h"
 #include "tink/internal/key_info.h"
+#include "tink/internal/tracing_span.h"
 #include "tink/keyset_reader.h"
 #include "tink/keyset_writer.h"
+#include "tink/memory_stats.h"
 #include "tink/registry.h"
 #include "tink/util/errors.h"
 #include "tink/util/keyset_util.h"
+#include "tink/util/secret_data.h"
 #include "proto/tink.pb.h"
 
 using google::crypto::tink::EncryptedKeyset;
@@ -39,6 +45,15 @@ namespace tink {
 
 namespace {
 
+// Returns the heap memory of 'value', which is none if its characters are
+// stored inline.
+size_t StringHeapBytes(const std::string& value) {
+  uintptr_t object = reinterpret_cast<uintptr_t>(&value);
+  uintptr_t data = reinterpret_cast<uintptr_t>(value.data());
+  if (data >= object && data < object + sizeof(value)) return 0;
+  return value.capacity() + 1;
+}
+
 util::StatusOr<std::unique_ptr<EncryptedKeyset>>
 Encrypt(const Keyset& keyset, const Aead& master_key_aead) {
   auto encrypt_result = master_key_aead.Encrypt(
@@ -49,17 +64,17 @@ Encrypt(const Keyset& keyset, const Aead& master_key_aead) {
   return std::move(enc_keyset);
 }
 
-util::StatusOr<std::unique_ptr<Keyset>>
-Decrypt(const EncryptedKeyset& enc_keyset, const Aead& master_key_aead) {
+// Decrypts 'enc_keyset' into '*keyset'.
+util::Status Decrypt(const EncryptedKeyset& enc_keyset,
+                     const Aead& master_key_aead, Keyset* keyset) {
   auto decrypt_result = master_key_aead.Decrypt(
           enc_keyset.encrypted_keyset(), /* associated_data= */ "");
   if (!decrypt_result.ok()) return decrypt_result.status();
-  auto keyset = absl::make_unique<Keyset>();
   if (!keyset->ParseFromString(decrypt_result.ValueOrDie())) {
     return util::Status(util::error::INVALID_ARGUMENT,
         "Could not parse the decrypted data as a Keyset-proto.");
   }
-  return std::move(keyset);
+  return util::Status::OK;
 }
 
 util::Status ValidateNoSecret(const Keyset& keyset) {
@@ -76,42 +91,61 @@ util::Status ValidateNoSecret(const Keyset& keyset) {
   return util::Status::OK;
 }
 
+// Returns an arena for a keyset. Its first block holds a keyset with a few
+// keys, so that most keysets need a single allocation besides their key
+// material.
+std::unique_ptr<google::protobuf::Arena> NewKeysetArena() {
+  google::protobuf::ArenaOptions options;
+  options.start_block_size = 1024;
+  return absl::make_unique<google::protobuf::Arena>(options);
+}
+
+// Zeroes the key material in 'keyset' before it is freed.
+void WipeKeyMaterial(Keyset* keyset) {
+  for (Keyset::Key& key : *keyset->mutable_key()) {
+    util::SafeZeroString(key.mutable_key_data()->mutable_value());
+  }
+}
+
 }  // anonymous namespace
 
 // static
 util::StatusOr<std::unique_ptr<KeysetHandle>> KeysetHandle::Read(
     std::unique_ptr<KeysetReader> reader, const Aead& master_key_aead) {
+  internal::TracingSpan span("tink.keyset_handle.read");
   auto enc_keyset_result = reader->ReadEncrypted();
   if (!enc_keyset_result.ok()) {
+    span.SetOk(false);
     return ToStatusF(util::error::INVALID_ARGUMENT,
                      "Error reading encrypted keyset data: %s",
                      enc_keyset_result.status().error_message());
   }
 
-  auto keyset_result =
-      Decrypt(*enc_keyset_result.ValueOrDie(), master_key_aead);
-  if (!keyset_result.ok()) {
+  span.AddBytes(enc_keyset_result.ValueOrDie()->encrypted_keyset().size());
+
+  std::unique_ptr<KeysetHandle> handle(new KeysetHandle());
+  util::Status status = Decrypt(*enc_keyset_result.ValueOrDie(),
+                                master_key_aead, handle->mutable_keyset());
+  if (!status.ok()) {
+    span.SetOk(false);
     return ToStatusF(util::error::INVALID_ARGUMENT,
                      "Error decrypting encrypted keyset: %s",
-                     keyset_result.status().error_message());
+                     status.error_message());
   }
-
-  std::unique_ptr<KeysetHandle> handle(
-      new KeysetHandle(std::move(keyset_result.ValueOrDie())));
   return std::move(handle);
 }
 
 // static
 util::StatusOr<std::unique_ptr<KeysetHandle>> KeysetHandle::ReadNoSecret(
     const std::string& serialized_keyset) {
-  Keyset keyset;
-  if (!keyset.ParseFromString(serialized_keyset)) {
+  std::unique_ptr<KeysetHandle> handle(new KeysetHandle());
+  if (!handle->mutable_keyset()->ParseFromString(serialized_keyset)) {
     return util::Status(util::error::INVALID_ARGUMENT,
                         "Could not parse the input string as a Keyset-proto.");
   }
-  util::Status validation = ValidateNoSecret(keyset);
+  util::Status validation = ValidateNoSecret(handle->get_keyset());
   if (!validation.ok()) return validation;
-  return absl::WrapUnique(new KeysetHandle(std::move(keyset)));
+  return std::move(handle);
 }
 
 util::Status KeysetHandle::Write(KeysetWriter* writer,
@@ -120,13 +154,18 @@ util::Status KeysetHandle::Write(KeysetWriter* writer,
     return util::Status(util::error::INVALID_ARGUMENT,
                         "Writer must be non-null");
   }
+  internal::TracingSpan span("tink.keyset_handle.write");
   auto encrypt_result = Encrypt(get_keyset(), master_key_aead);
   if (!encrypt_result.ok()) {
+    span.SetOk(false);
     return ToStatusF(util::error::INVALID_ARGUMENT,
                      "Encryption of the keyset failed: %s",
                      encrypt_result.status().error_message());
   }
-  return writer->Write(*(encrypt_result.ValueOrDie().get()));
+  span.AddBytes(encrypt_result.ValueOrDie()->encrypted_keyset().size());
+  util::Status status = writer->Write(*(encrypt_result.ValueOrDie().get()));
+  span.SetOk(status.ok());
+  return status;
 }
 
 util::Status KeysetHandle::WriteNoSecret(KeysetWriter* writer) {
@@ -144,16 +183,18 @@ util::Status KeysetHandle::WriteNoSecret(KeysetWriter* writer) {
 // static
 util::StatusOr<std::unique_ptr<KeysetHandle>> KeysetHandle::GenerateNew(
     const KeyTemplate& key_template) {
-  Keyset keyset;
-  auto result = AddToKeyset(key_template, /*as_primary=*/true, &keyset);
+  std::unique_ptr<KeysetHandle> handle(new KeysetHandle());
+  auto result = AddToKeyset(key_template, /*as_primary=*/true,
+                            handle->mutable_keyset());
   if (!result.ok()) {
     return result.status();
   }
-  return absl::WrapUnique<KeysetHandle>(new KeysetHandle(std::move(keyset)));
+  return std::move(handle);
 }
 
-util::StatusOr<std::unique_ptr<Keyset::Key>> ExtractPublicKey(
-    const Keyset::Key& key) {
+// Sets '*public_key' to the public key of the private 'key'.
+util::Status ExtractPublicKey(const Keyset::Key& key,
+                              Keyset::Key* public_key) {
   if (key.key_data().key_material_type() != KeyData::ASYMMETRIC_PRIVATE) {
     return util::Status(util::error::INVALID_ARGUMENT,
         "Key material is not of type KeyData::ASYMMETRIC_PRIVATE");
@@ -161,28 +202,36 @@ util::StatusOr<std::unique_ptr<Keyset::Key>> ExtractPublicKey(
   auto key_data_result = Registry::GetPublicKeyData(key.key_data().type_url(),
                                                     key.key_data().value());
   if (!key_data_result.ok()) return key_data_result.status();
-  auto public_key = absl::make_unique<Keyset::Key>(key);
-  public_key->mutable_key_data()->Swap(key_data_result.ValueOrDie().get());
-  return std::move(public_key);
+  public_key->set_key_id(key.key_id());
+  public_key->set_status(key.status());
+  public_key->set_output_prefix_type(key.output_prefix_type());
+  *public_key->mutable_key_data() = *key_data_result.ValueOrDie();
+  return util::Status::OK;
 }
 
 util::StatusOr<std::unique_ptr<KeysetHandle>>
 KeysetHandle::GetPublicKeysetHandle() const {
-  std::unique_ptr<Keyset> public_keyset(new Keyset());
+  std::unique_ptr<KeysetHandle> handle(new KeysetHandle());
+  Keyset* public_keyset = handle->mutable_keyset();
+  public_keyset->mutable_key()->Reserve(get_keyset().key_size());
   for (const Keyset::Key& key : get_keyset().key()) {
-    auto public_key_result = ExtractPublicKey(key);
-    if (!public_key_result.ok()) return public_key_result.status();
-    public_keyset->add_key()->Swap(public_key_result.ValueOrDie().get());
+    util::Status status = ExtractPublicKey(key, public_keyset->add_key());
+    if (!status.ok()) return status;
   }
   public_keyset->set_primary_key_id(get_keyset().primary_key_id());
-  std::unique_ptr<KeysetHandle> handle(
-      new KeysetHandle(std::move(public_keyset)));
   return std::move(handle);
 }
 
 crypto::tink::util::StatusOr<uint32_t> KeysetHandle::AddToKeyset(
     const google::crypto::tink::KeyTemplate& key_template,
     bool as_primary, Keyset* keyset) {
+  return AddToKeyset(key_template, as_primary, GenerateUnusedKeyId(*keyset),
+                     keyset);
+}
+
+crypto::tink::util::StatusOr<uint32_t> KeysetHandle::AddToKeyset(
+    const google::crypto::tink::KeyTemplate& key_template, bool as_primary,
+    uint32_t key_id, Keyset* keyset) {
   if (key_template.output_prefix_type() ==
       google::crypto::tink::OutputPrefixType::UNKNOWN_PREFIX) {
     return util::Status(util::error::INVALID_ARGUMENT,
@@ -192,7 +241,6 @@ crypto::tink::util::StatusOr<uint32_t> KeysetHandle::AddToKeyset(
   if (!key_data_result.ok()) return key_data_result.status();
   auto key_data = std::move(key_data_result.ValueOrDie());
   Keyset::Key* key = keyset->add_key();
-  uint32_t key_id = GenerateUnusedKeyId(*keyset);
   *(key->mutable_key_data()) = *key_data;
   key->set_status(google::crypto::tink::KeyStatusType::ENABLED);
   key->set_key_id(key_id);
@@ -207,14 +255,62 @@ KeysetInfo KeysetHandle::GetKeysetInfo() const {
   return KeysetInfoFromKeyset(get_keyset());
 }
 
+MemoryStats KeysetHandle::GetMemoryStats() const {
+  const Keyset& keyset = get_keyset();
+  MemoryStats stats;
+  // The keys are held by pointer.
+  stats.keyset_bytes =
+      sizeof(Keyset) +
+      keyset.key_size() * (sizeof(void*) + sizeof(Keyset::Key));
+  for (const Keyset::Key& key : keyset.key()) {
+    if (!key.has_key_data()) continue;
+    stats.keyset_bytes += sizeof(KeyData) +
+                          StringHeapBytes(key.key_data().type_url()) +
+                          StringHeapBytes(key.key_data().value());
+  }
+  return stats;
+}
+
+KeysetHandle::KeysetHandle() {
+  google::protobuf::Arena* arena = NewKeysetArena().release();
+  building_keyset_ = google::protobuf::Arena::CreateMessage<Keyset>(arena);
+  keyset_ = std::shared_ptr<const Keyset>(
+      building_keyset_, [arena](const Keyset* keyset) {
+        WipeKeyMaterial(const_cast<Keyset*>(keyset));
+        delete arena;
+      });
+}
+
 KeysetHandle::KeysetHandle(Keyset keyset)
-    : keyset_(std::move(keyset)) {}
+    : keyset_(NewSharedKeyset(std::move(keyset))) {}
 
 KeysetHandle::KeysetHandle(std::unique_ptr<Keyset> keyset)
-    : keyset_(std::move(*keyset)) {}
+    : keyset_(keyset.release(), [](const Keyset* keyset) {
+        WipeKeyMaterial(const_cast<Keyset*>(keyset));
+        delete keyset;
+      }) {}
+
+KeysetHandle::KeysetHandle(std::shared_ptr<const Keyset> keyset)
+    : keyset_(std::move(keyset)) {}
+
+// static
+std::shared_ptr<Keyset> KeysetHandle::NewSharedKeyset(Keyset keyset) {
+  return std::shared_ptr<Keyset>(new Keyset(std::move(keyset)),
+                                 [](Keyset* keyset) {
+                                   WipeKeyMaterial(keyset);
+                                   delete keyset;
+                                 });
+}
 
 const Keyset& KeysetHandle::get_keyset() const {
-  return keyset_;
+  return *keyset_;
+}
+
+const util::StatusOr<KeysetPlan>& KeysetHandle::GetKeysetPlan() const {
+  PlanCache* cache = plan_cache_.get();
+  absl::call_once(cache->once,
+                  [this, cache]() { cache->plan = PlanKeyset(get_keyset()); });
+  return cache->plan;
 }
 
 }  // namespace tink
@@ -27,6 +27,7 @@
 #include "tink/config/tink_config.h"
 #include "tink/json_keyset_reader.h"
 #include "tink/json_keyset_writer.h"
+#include "tink/memory_stats.h"
 #include "tink/signature/ecdsa_sign_key_manager.h"
 #include "tink/signature/signature_key_templates.h"
 #include "tink/util/protobuf_helper.h"
@@ -468,6 +469,56 @@ TEST_F(KeysetHandleTest, Copiable) {
   KeysetHandle handle_copy = *handle;
 }
 
+TEST_F(KeysetHandleTest, CopiesShareTheKeyset) {
+  auto handle_result = KeysetHandle::GenerateNew(AeadKeyTemplates::Aes128Eax());
+  ASSERT_TRUE(handle_result.ok()) << handle_result.status();
+  std::unique_ptr<KeysetHandle> handle = std::move(handle_result.ValueOrDie());
+  const Keyset* keyset = &TestKeysetHandle::GetKeyset(*handle);
+  std::string serialized_keyset = keyset->SerializeAsString();
+
+  KeysetHandle handle_copy = *handle;
+  EXPECT_EQ(keyset, &TestKeysetHandle::GetKeyset(handle_copy));
+  // The copy keeps the keyset alive.
+  handle.reset();
+  EXPECT_EQ(serialized_keyset,
+            TestKeysetHandle::GetKeyset(handle_copy).SerializeAsString());
+  EXPECT_TRUE(handle_copy.GetPrimitive<Aead>().ok());
+}
+
+TEST_F(KeysetHandleTest, MemoryStats) {
+  Keyset small_keyset;
+  Keyset large_keyset;
+  Keyset::Key key;
+  std::string key_value(100, 'k');
+  AddTinkKey("some key type", 42, key, KeyStatusType::ENABLED,
+             KeyData::SYMMETRIC, &small_keyset);
+  for (int i = 0; i < 10; i++) {
+    AddTinkKey("some key type", 42 + i, key, KeyStatusType::ENABLED,
+               KeyData::SYMMETRIC, &large_keyset);
+    large_keyset.mutable_key(i)->mutable_key_data()->set_value(key_value);
+  }
+  MemoryStats small_stats =
+      TestKeysetHandle::GetKeysetHandle(small_keyset)->GetMemoryStats();
+  MemoryStats large_stats =
+      TestKeysetHandle::GetKeysetHandle(large_keyset)->GetMemoryStats();
+  EXPECT_GT(small_stats.keyset_bytes, sizeof(Keyset));
+  EXPECT_GT(large_stats.keyset_bytes,
+            small_stats.keyset_bytes + 10 * key_value.size());
+  EXPECT_EQ(large_stats.total_bytes(), large_stats.keyset_bytes);
+
+  // The primitive reports the PrimitiveSet and the wrapper.
+  auto handle_result = KeysetHandle::GenerateNew(AeadKeyTemplates::Aes128Gcm());
+  ASSERT_THAT(handle_result.status(), IsOk());
+  auto aead_result = handle_result.ValueOrDie()->GetPrimitive<Aead>();
+  ASSERT_THAT(aead_result.status(), IsOk());
+  auto stats_result = GetMemoryStats(*aead_result.ValueOrDie());
+  ASSERT_THAT(stats_result.status(), IsOk());
+  const MemoryStats& aead_stats = stats_result.ValueOrDie();
+  EXPECT_GT(aead_stats.primitive_set_bytes, 0);
+  EXPECT_EQ(aead_stats.bytes_by_primitive.at("aead"),
+            aead_stats.total_bytes());
+}
+
 TEST_F(KeysetHandleTest, ReadNoSecret) {
   Keyset keyset;
   Keyset::Key key;
@@ -16,6 +16,8 @@
 
 #include "tink/keyset_manager.h"
 
+#include <atomic>
+#include <memory>
 #include <random>
 
 #include "absl/memory/memory.h"
@@ -24,6 +26,7 @@
 #include "tink/registry.h"
 #include "tink/util/enums.h"
 #include "tink/util/errors.h"
+#include "tink/util/keyset_util.h"
 #include "proto/tink.pb.h"
 
 namespace crypto {
@@ -36,6 +39,9 @@ using crypto::tink::util::Enums;
 using crypto::tink::util::Status;
 using crypto::tink::util::StatusOr;
 
+KeysetManager::KeysetManager()
+    : keyset_(KeysetHandle::NewSharedKeyset(Keyset())) {}
+
 // static
 StatusOr<std::unique_ptr<KeysetManager>> KeysetManager::New(
     const KeyTemplate& key_template) {
@@ -50,16 +56,43 @@ StatusOr<std::unique_ptr<KeysetManager>> KeysetManager::New(
     const KeysetHandle& keyset_handle) {
   auto manager = absl::make_unique<KeysetManager>();
   absl::MutexLock lock(&manager->keyset_mutex_);
-  manager->keyset_ = keyset_handle.get_keyset();
+  // The keyset is shared with 'keyset_handle' until it is modified.
+  manager->keyset_ = std::const_pointer_cast<Keyset>(keyset_handle.keyset_);
+  manager->RebuildKeyIndex();
   return std::move(manager);
 }
 
 std::unique_ptr<KeysetHandle> KeysetManager::GetKeysetHandle() {
   absl::MutexLock lock(&keyset_mutex_);
-  std::unique_ptr<Keyset> keyset_copy(new Keyset(keyset_));
-  std::unique_ptr<KeysetHandle> handle(
-      new KeysetHandle(std::move(keyset_copy)));
-  return handle;
+  return absl::WrapUnique(
+      new KeysetHandle(std::shared_ptr<const Keyset>(keyset_)));
+}
+
+Keyset* KeysetManager::MutableKeyset() {
+  // Handles only read the keyset, and new ones are only created under
+  // keyset_mutex_; if there are none the keyset can be modified in place.
+  if (keyset_.use_count() > 1) {
+    keyset_ = KeysetHandle::NewSharedKeyset(*keyset_);
+  } else {
+    // Orders the reads by handles destroyed on other threads before the
+    // modification.
+    std::atomic_thread_fence(std::memory_order_acquire);
+  }
+  return keyset_.get();
+}
+
+int KeysetManager::FindKey(uint32_t key_id) const {
+  auto found = key_index_.find(key_id);
+  return found == key_index_.end() ? -1 : found->second;
+}
+
+void KeysetManager::RebuildKeyIndex() {
+  key_index_.clear();
+  key_index_.reserve(keyset_->key_size());
+  for (int i = 0; i < keyset_->key_size(); i++) {
+    // Keeps the first key for duplicate key ids.
+    key_index_.emplace(keyset_->key(i).key_id(), i);
+  }
 }
 
 StatusOr<uint32_t> KeysetManager::Add(const KeyTemplate& key_template) {
@@ -69,7 +102,15 @@ StatusOr<uint32_t> KeysetManager::Add(const KeyTemplate& key_template) {
 crypto::tink::util::StatusOr<uint32_t> KeysetManager::Add(
     const google::crypto::tink::KeyTemplate& key_template, bool as_primary) {
   absl::MutexLock lock(&keyset_mutex_);
-  return KeysetHandle::AddToKeyset(key_template, as_primary, &keyset_);
+  const absl::flat_hash_map<uint32_t, int>& key_index = key_index_;
+  uint32_t key_id = GenerateUnusedKeyId([&key_index](uint32_t candidate) {
+    return key_index.contains(candidate);
+  });
+  auto add_result = KeysetHandle::AddToKeyset(key_template, as_primary,
+                                              key_id, MutableKeyset());
+  if (!add_result.ok()) return add_result.status();
+  key_index_.emplace(key_id, keyset_->key_size() - 1);
+  return add_result;
 }
 
 StatusOr<uint32_t> KeysetManager::Rotate(const KeyTemplate& key_template) {
@@ -79,110 +120,112 @@ StatusOr<uint32_t> KeysetManager::Rotate(const KeyTemplate& key_template) {
 
 Status KeysetManager::Enable(uint32_t key_id) {
   absl::MutexLock lock(&keyset_mutex_);
-  for (auto& key : *(keyset_.mutable_key())) {
-    if (key.key_id() == key_id) {
-      if (key.status() != KeyStatusType::DISABLED &&
-          key.status() != KeyStatusType::ENABLED) {
-        return ToStatusF(util::error::INVALID_ARGUMENT,
-                         "Cannot enable key with key_id %u and status %s.",
-                         key_id, Enums::KeyStatusName(key.status()));
-      }
-      key.set_status(KeyStatusType::ENABLED);
-      return Status::OK;
-    }
-  }
-  return ToStatusF(util::error::NOT_FOUND,
-                   "No key with key_id %u found in the keyset.", key_id);
+  int index = FindKey(key_id);
+  if (index < 0) {
+    return ToStatusF(util::error::NOT_FOUND,
+                     "No key with key_id %u found in the keyset.", key_id);
+  }
+  KeyStatusType status = keyset_->key(index).status();
+  if (status != KeyStatusType::DISABLED && status != KeyStatusType::ENABLED) {
+    return ToStatusF(util::error::INVALID_ARGUMENT,
+                     "Cannot enable key with key_id %u and status %s.", key_id,
+                     Enums::KeyStatusName(status));
+  }
+  if (status != KeyStatusType::ENABLED) {
+    MutableKeyset()->mutable_key(index)->set_status(KeyStatusType::ENABLED);
+  }
+  return Status::OK;
 }
 
 Status KeysetManager::Disable(uint32_t key_id) {
   absl::MutexLock lock(&keyset_mutex_);
-  if (keyset_.primary_key_id() == key_id) {
+  if (keyset_->primary_key_id() == key_id) {
     return ToStatusF(util::error::INVALID_ARGUMENT,
                      "Cannot disable primary key (key_id %u).", key_id);
   }
-  for (auto& key : *(keyset_.mutable_key())) {
-    if (key.key_id() == key_id) {
-      if (key.status() != KeyStatusType::DISABLED &&
-          key.status() != KeyStatusType::ENABLED) {
-        return ToStatusF(util::error::INVALID_ARGUMENT,
-                         "Cannot disable key with key_id %u and status %s.",
-                         key_id, Enums::KeyStatusName(key.status()));
-      }
-      key.set_status(KeyStatusType::DISABLED);
-      return Status::OK;
-    }
-  }
-  return ToStatusF(util::error::NOT_FOUND,
-                   "No key with key_id %u found in the keyset.", key_id);
+  int index = FindKey(key_id);
+  if (index < 0) {
+    return ToStatusF(util::error::NOT_FOUND,
+                     "No key with key_id %u found in the keyset.", key_id);
+  }
+  KeyStatusType status = keyset_->key(index).status();
+  if (status != KeyStatusType::DISABLED && status != KeyStatusType::ENABLED) {
+    return ToStatusF(util::error::INVALID_ARGUMENT,
+                     "Cannot disable key with key_id %u and status %s.",
+                     key_id, Enums::KeyStatusName(status));
+  }
+  if (status != KeyStatusType::DISABLED) {
+    MutableKeyset()->mutable_key(index)->set_status(KeyStatusType::DISABLED);
+  }
+  return Status::OK;
 }
 
 Status KeysetManager::Delete(uint32_t key_id) {
   absl::MutexLock lock(&keyset_mutex_);
-  if (keyset_.primary_key_id() == key_id) {
+  if (keyset_->primary_key_id() == key_id) {
     return ToStatusF(util::error::INVALID_ARGUMENT,
                      "Cannot delete primary key (key_id %u).", key_id);
   }
-  auto key_field = keyset_.mutable_key();
-  for (auto key_iter = key_field->begin();
-       key_iter != key_field->end();
-       key_iter++) {
-    auto key = *key_iter;
-    if (key.key_id() == key_id) {
-      keyset_.mutable_key()->erase(key_iter);
-      return Status::OK;
-    }
-  }
-  return ToStatusF(util::error::NOT_FOUND,
-                   "No key with key_id %u found in the keyset.", key_id);
+  int index = FindKey(key_id);
+  if (index < 0) {
+    return ToStatusF(util::error::NOT_FOUND,
+                     "No key with key_id %u found in the keyset.", key_id);
+  }
+  auto key_field = MutableKeyset()->mutable_key();
+  key_field->erase(key_field->begin() + index);
+  // The keys after the deleted one moved.
+  RebuildKeyIndex();
+  return Status::OK;
 }
 
 Status KeysetManager::Destroy(uint32_t key_id) {
   absl::MutexLock lock(&keyset_mutex_);
-  if (keyset_.primary_key_id() == key_id) {
+  if (keyset_->primary_key_id() == key_id) {
     return ToStatusF(util::error::INVALID_ARGUMENT,
                      "Cannot destroy primary key (key_id %u).", key_id);
   }
-  for (auto& key : *(keyset_.mutable_key())) {
-    if (key.key_id() == key_id) {
-      if (key.status() != KeyStatusType::DISABLED &&
-          key.status() != KeyStatusType::DESTROYED &&
-          key.status() != KeyStatusType::ENABLED) {
-        return ToStatusF(util::error::INVALID_ARGUMENT,
-                         "Cannot destroy key with key_id %u and status %s.",
-                         key_id, Enums::KeyStatusName(key.status()));
-      }
-      key.clear_key_data();
-      key.set_status(KeyStatusType::DESTROYED);
-      return Status::OK;
-    }
-  }
-  return ToStatusF(util::error::NOT_FOUND,
-                   "No key with key_id %u found in the keyset.", key_id);
+  int index = FindKey(key_id);
+  if (index < 0) {
+    return ToStatusF(util::error::NOT_FOUND,
+                     "No key with key_id %u found in the keyset.", key_id);
+  }
+  KeyStatusType status = keyset_->key(index).status();
+  if (status != KeyStatusType::DISABLED &&
+      status != KeyStatusType::DESTROYED &&
+      status != KeyStatusType::ENABLED) {
+    return ToStatusF(util::error::INVALID_ARGUMENT,
+                     "Cannot destroy key with key_id %u and status %s.",
+                     key_id, Enums::KeyStatusName(status));
+  }
+  Keyset::Key* key = MutableKeyset()->mutable_key(index);
+  key->clear_key_data();
+  key->set_status(KeyStatusType::DESTROYED);
+  return Status::OK;
 }
 
 Status KeysetManager::SetPrimary(uint32_t key_id) {
   absl::MutexLock lock(&keyset_mutex_);
-  for (auto& key : keyset_.key()) {
-    if (key.key_id() == key_id) {
-      if (key.status() != KeyStatusType::ENABLED) {
-        return ToStatusF(util::error::INVALID_ARGUMENT,
-                         "The candidate for the primary key must be ENABLED"
-                         " (key_id %u).",
-                         key_id);
-      }
-      keyset_.set_primary_key_id(key_id);
-      return Status::OK;
-    }
-  }
-  return ToStatusF(util::error::NOT_FOUND,
-                   "No key with key_id %u found in the keyset.", key_id);
+  int index = FindKey(key_id);
+  if (index < 0) {
+    return ToStatusF(util::error::NOT_FOUND,
+                     "No key with key_id %u found in the keyset.", key_id);
+  }
+  if (keyset_->key(index).status() != KeyStatusType::ENABLED) {
+    return ToStatusF(util::error::INVALID_ARGUMENT,
+                     "The candidate for the primary key must be ENABLED"
+                     " (key_id %u).",
+                     key_id);
+  }
+  if (keyset_->primary_key_id() != key_id) {
+    MutableKeyset()->set_primary_key_id(key_id);
+  }
+  return Status::OK;
 }
 
 
 int KeysetManager::KeyCount() const {
   absl::MutexLock lock(&keyset_mutex_);
-  return keyset_.key_size();
+  return keyset_->key_size();
 }
 
 }  // namespace tink
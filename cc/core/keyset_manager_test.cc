@@ -15,6 +15,8 @@
 ////////////////////////////////////////////////////////////////////////////////
 #include "tink/keyset_manager.h"
 
+#include <vector>
+
 #include "gtest/gtest.h"
 #include "tink/aead/aead_config.h"
 #include "tink/aead/aes_gcm_key_manager.h"
@@ -230,5 +232,95 @@ TEST_F(KeysetManagerTest, testBasicOperations) {
   EXPECT_EQ(1, keyset_manager->KeyCount());
 }
 
+TEST_F(KeysetManagerTest, HandlesHoldCopiesOfTheKeyset) {
+  AesGcmKeyFormat key_format;
+  key_format.set_key_size(16);
+  KeyTemplate key_template;
+  key_template.set_type_url(AesGcmKeyManager().get_key_type());
+  key_template.set_output_prefix_type(OutputPrefixType::TINK);
+  key_template.set_value(key_format.SerializeAsString());
+
+  auto new_result = KeysetManager::New(key_template);
+  ASSERT_TRUE(new_result.ok()) << new_result.status();
+  auto keyset_manager = std::move(new_result.ValueOrDie());
+  auto handle = keyset_manager->GetKeysetHandle();
+  google::crypto::tink::Keyset keyset = TestKeysetHandle::GetKeyset(*handle);
+  auto rotate_result = keyset_manager->Rotate(key_template);
+  ASSERT_TRUE(rotate_result.ok()) << rotate_result.status();
+
+  // The handle is not affected by changes of the manager, nor by its
+  // destruction.
+  keyset_manager.reset();
+  EXPECT_EQ(keyset.SerializeAsString(),
+            TestKeysetHandle::GetKeyset(*handle).SerializeAsString());
+  EXPECT_EQ(1, TestKeysetHandle::GetKeyset(*handle).key_size());
+}
+
+TEST_F(KeysetManagerTest, HandlesAreNotAffectedByKeyChanges) {
+  AesGcmKeyFormat key_format;
+  key_format.set_key_size(16);
+  KeyTemplate key_template;
+  key_template.set_type_url(AesGcmKeyManager().get_key_type());
+  key_template.set_output_prefix_type(OutputPrefixType::TINK);
+  key_template.set_value(key_format.SerializeAsString());
+
+  auto new_result = KeysetManager::New(key_template);
+  ASSERT_TRUE(new_result.ok()) << new_result.status();
+  auto keyset_manager = std::move(new_result.ValueOrDie());
+  auto add_result = keyset_manager->Add(key_template);
+  ASSERT_TRUE(add_result.ok()) << add_result.status();
+  uint32_t key_id = add_result.ValueOrDie();
+
+  auto handle = keyset_manager->GetKeysetHandle();
+  google::crypto::tink::Keyset keyset = TestKeysetHandle::GetKeyset(*handle);
+  ASSERT_TRUE(keyset_manager->Disable(key_id).ok());
+  auto disabled_handle = keyset_manager->GetKeysetHandle();
+  ASSERT_TRUE(keyset_manager->Destroy(key_id).ok());
+  auto destroyed_handle = keyset_manager->GetKeysetHandle();
+  ASSERT_TRUE(keyset_manager->Delete(key_id).ok());
+
+  EXPECT_EQ(keyset.SerializeAsString(),
+            TestKeysetHandle::GetKeyset(*handle).SerializeAsString());
+  EXPECT_EQ(KeyStatusType::DISABLED,
+            TestKeysetHandle::GetKeyset(*disabled_handle).key(1).status());
+  EXPECT_EQ(KeyStatusType::DESTROYED,
+            TestKeysetHandle::GetKeyset(*destroyed_handle).key(1).status());
+  EXPECT_EQ(1, keyset_manager->KeyCount());
+}
+
+TEST_F(KeysetManagerTest, ManyKeys) {
+  AesGcmKeyFormat key_format;
+  key_format.set_key_size(16);
+  KeyTemplate key_template;
+  key_template.set_type_url(AesGcmKeyManager().get_key_type());
+  key_template.set_output_prefix_type(OutputPrefixType::TINK);
+  key_template.set_value(key_format.SerializeAsString());
+
+  KeysetManager keyset_manager;
+  std::vector<uint32_t> key_ids;
+  for (int i = 0; i < 1000; i++) {
+    auto rotate_result = keyset_manager.Rotate(key_template);
+    ASSERT_TRUE(rotate_result.ok()) << rotate_result.status();
+    key_ids.push_back(rotate_result.ValueOrDie());
+  }
+  EXPECT_EQ(1000, keyset_manager.KeyCount());
+
+  // Keys are still found after the ones before them were deleted.
+  ASSERT_TRUE(keyset_manager.Delete(key_ids[0]).ok());
+  ASSERT_TRUE(keyset_manager.Delete(key_ids[500]).ok());
+  EXPECT_EQ(util::error::NOT_FOUND,
+            keyset_manager.Disable(key_ids[500]).error_code());
+  ASSERT_TRUE(keyset_manager.Disable(key_ids[501]).ok());
+  ASSERT_TRUE(keyset_manager.SetPrimary(key_ids[1]).ok());
+
+  google::crypto::tink::Keyset keyset =
+      TestKeysetHandle::GetKeyset(*keyset_manager.GetKeysetHandle());
+  ASSERT_EQ(998, keyset.key_size());
+  EXPECT_EQ(key_ids[1], keyset.primary_key_id());
+  EXPECT_EQ(key_ids[1], keyset.key(0).key_id());
+  EXPECT_EQ(key_ids[501], keyset.key(499).key_id());
+  EXPECT_EQ(KeyStatusType::DISABLED, keyset.key(499).status());
+}
+
 }  // namespace tink
 }  // namespace crypto
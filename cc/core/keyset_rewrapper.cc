@@ -0,0 +1,123 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/keyset_rewrapper.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
+#include "tink/aead.h"
+#include "tink/internal/tracing_span.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+
+using ::google::crypto::tink::EncryptedKeyset;
+
+// static
+util::StatusOr<std::unique_ptr<KeysetRewrapper>> KeysetRewrapper::New(
+    const Aead* old_master_key_aead, const Aead* new_master_key_aead,
+    const Options& options) {
+  if (old_master_key_aead == nullptr || new_master_key_aead == nullptr) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "master key Aeads must be non-null");
+  }
+  if (options.max_concurrency < 1) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "max_concurrency must be positive");
+  }
+  return absl::WrapUnique(
+      new KeysetRewrapper(old_master_key_aead, new_master_key_aead, options));
+}
+
+util::StatusOr<EncryptedKeyset> KeysetRewrapper::Rewrap(
+    const EncryptedKeyset& encrypted_keyset) const {
+  internal::TracingSpan span("tink.keyset_rewrapper.rewrap");
+  span.AddBytes(encrypted_keyset.encrypted_keyset().size());
+  auto decrypt_result = old_master_key_aead_->Decrypt(
+      encrypted_keyset.encrypted_keyset(), /* associated_data= */ "");
+  if (!decrypt_result.ok()) {
+    span.SetOk(false);
+    return util::Status(
+        util::error::INVALID_ARGUMENT,
+        absl::StrCat("Error decrypting encrypted keyset: ",
+                     decrypt_result.status().error_message()));
+  }
+  std::string& serialized_keyset = decrypt_result.ValueOrDie();
+  auto encrypt_result = new_master_key_aead_->Encrypt(
+      serialized_keyset, /* associated_data= */ "");
+  util::SafeZeroString(&serialized_keyset);
+  if (!encrypt_result.ok()) {
+    span.SetOk(false);
+    return util::Status(
+        util::error::INVALID_ARGUMENT,
+        absl::StrCat("Encryption of the keyset failed: ",
+                     encrypt_result.status().error_message()));
+  }
+  EncryptedKeyset result;
+  result.set_encrypted_keyset(encrypt_result.ValueOrDie());
+  if (encrypted_keyset.has_keyset_info()) {
+    *result.mutable_keyset_info() = encrypted_keyset.keyset_info();
+  }
+  return result;
+}
+
+util::Status KeysetRewrapper::RewrapJob(const Job& job) const {
+  if (job.reader == nullptr || job.writer == nullptr) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "reader and writer must be non-null");
+  }
+  auto read_result = job.reader->ReadEncrypted();
+  if (!read_result.ok()) return read_result.status();
+  auto rewrap_result = Rewrap(*read_result.ValueOrDie());
+  if (!rewrap_result.ok()) return rewrap_result.status();
+  return job.writer->Write(rewrap_result.ValueOrDie());
+}
+
+std::vector<util::Status> KeysetRewrapper::RewrapAll(
+    absl::Span<const Job> jobs) const {
+  std::vector<util::Status> statuses(jobs.size());
+  // Every thread takes the next job until none are left, the calling thread
+  // included.
+  std::atomic<size_t> next_job(0);
+  auto run = [this, jobs, &statuses, &next_job]() {
+    for (size_t i = next_job++; i < jobs.size(); i = next_job++) {
+      statuses[i] = RewrapJob(jobs[i]);
+    }
+  };
+  size_t num_threads =
+      std::min<size_t>(options_.max_concurrency, jobs.size());
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < num_threads; i++) threads.emplace_back(run);
+  run();
+  for (std::thread& thread : threads) thread.join();
+  return statuses;
+}
+
+}  // namespace tink
+}  // namespace crypto
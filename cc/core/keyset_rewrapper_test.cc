@@ -0,0 +1,175 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/keyset_rewrapper.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "tink/binary_keyset_reader.h"
+#include "tink/keyset_writer.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "tink/util/test_matchers.h"
+#include "tink/util/test_util.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace {
+
+using ::crypto::tink::test::DummyAead;
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::google::crypto::tink::EncryptedKeyset;
+using ::google::crypto::tink::Keyset;
+using ::testing::Eq;
+using ::testing::SizeIs;
+
+// Keeps the last encrypted keyset written to it.
+class RecordingKeysetWriter : public KeysetWriter {
+ public:
+  util::Status Write(const Keyset& keyset) override {
+    return util::Status(util::error::UNIMPLEMENTED, "cleartext keyset");
+  }
+
+  util::Status Write(const EncryptedKeyset& encrypted_keyset) override {
+    encrypted_keyset_ = encrypted_keyset;
+    return util::OkStatus();
+  }
+
+  const EncryptedKeyset& encrypted_keyset() const { return encrypted_keyset_; }
+
+ private:
+  EncryptedKeyset encrypted_keyset_;
+};
+
+EncryptedKeyset NewEncryptedKeyset(const Aead& master_key_aead,
+                                   uint32_t key_id) {
+  Keyset keyset;
+  keyset.set_primary_key_id(key_id);
+  keyset.add_key()->set_key_id(key_id);
+  EncryptedKeyset encrypted_keyset;
+  encrypted_keyset.set_encrypted_keyset(
+      master_key_aead.Encrypt(keyset.SerializeAsString(), "").ValueOrDie());
+  encrypted_keyset.mutable_keyset_info()->set_primary_key_id(key_id);
+  return encrypted_keyset;
+}
+
+uint32_t DecryptPrimaryKeyId(const Aead& master_key_aead,
+                             const EncryptedKeyset& encrypted_keyset) {
+  auto decrypt_result =
+      master_key_aead.Decrypt(encrypted_keyset.encrypted_keyset(), "");
+  EXPECT_THAT(decrypt_result.status(), IsOk());
+  Keyset keyset;
+  EXPECT_TRUE(keyset.ParseFromString(decrypt_result.ValueOrDie()));
+  return keyset.primary_key_id();
+}
+
+std::unique_ptr<KeysetRewrapper> NewRewrapper(const Aead* old_aead,
+                                              const Aead* new_aead,
+                                              int max_concurrency) {
+  KeysetRewrapper::Options options;
+  options.max_concurrency = max_concurrency;
+  auto rewrapper_result = KeysetRewrapper::New(old_aead, new_aead, options);
+  EXPECT_THAT(rewrapper_result.status(), IsOk());
+  return std::move(rewrapper_result.ValueOrDie());
+}
+
+TEST(KeysetRewrapperTest, Rewrap) {
+  DummyAead old_aead("old master key");
+  DummyAead new_aead("new master key");
+  auto rewrapper = NewRewrapper(&old_aead, &new_aead, 1);
+  EncryptedKeyset encrypted_keyset = NewEncryptedKeyset(old_aead, 42);
+  auto rewrap_result = rewrapper->Rewrap(encrypted_keyset);
+  ASSERT_THAT(rewrap_result.status(), IsOk());
+  EXPECT_THAT(DecryptPrimaryKeyId(new_aead, rewrap_result.ValueOrDie()),
+              Eq(42));
+  EXPECT_THAT(rewrap_result.ValueOrDie().keyset_info().primary_key_id(),
+              Eq(42));
+  // Rewrapping a keyset that is not encrypted with the old master key fails.
+  EXPECT_THAT(rewrapper->Rewrap(rewrap_result.ValueOrDie()).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(KeysetRewrapperTest, RewrapAll) {
+  DummyAead old_aead("old master key");
+  DummyAead new_aead("new master key");
+  const int kNumJobs = 50;
+  for (int max_concurrency : {1, 4, 100}) {
+    SCOPED_TRACE(absl::StrCat("max_concurrency: ", max_concurrency));
+    auto rewrapper = NewRewrapper(&old_aead, &new_aead, max_concurrency);
+    std::vector<std::unique_ptr<KeysetReader>> readers;
+    std::vector<RecordingKeysetWriter> writers(kNumJobs);
+    std::vector<KeysetRewrapper::Job> jobs;
+    for (int i = 0; i < kNumJobs; i++) {
+      // Every seventh keyset is encrypted with the wrong master key.
+      const Aead& master_key_aead = i % 7 == 3 ? new_aead : old_aead;
+      auto reader_result = BinaryKeysetReader::New(
+          NewEncryptedKeyset(master_key_aead, i + 1).SerializeAsString());
+      ASSERT_THAT(reader_result.status(), IsOk());
+      readers.push_back(std::move(reader_result.ValueOrDie()));
+      jobs.push_back({readers.back().get(), &writers[i]});
+    }
+    std::vector<util::Status> statuses = rewrapper->RewrapAll(jobs);
+    ASSERT_THAT(statuses, SizeIs(kNumJobs));
+    for (int i = 0; i < kNumJobs; i++) {
+      if (i % 7 == 3) {
+        EXPECT_THAT(statuses[i], StatusIs(util::error::INVALID_ARGUMENT));
+        continue;
+      }
+      ASSERT_THAT(statuses[i], IsOk());
+      EXPECT_THAT(DecryptPrimaryKeyId(new_aead, writers[i].encrypted_keyset()),
+                  Eq(i + 1));
+    }
+  }
+}
+
+TEST(KeysetRewrapperTest, RewrapAllWithoutJobs) {
+  DummyAead old_aead("old master key");
+  DummyAead new_aead("new master key");
+  auto rewrapper = NewRewrapper(&old_aead, &new_aead, 4);
+  EXPECT_THAT(rewrapper->RewrapAll({}), SizeIs(0));
+}
+
+TEST(KeysetRewrapperTest, InvalidArguments) {
+  DummyAead aead("master key");
+  EXPECT_THAT(
+      KeysetRewrapper::New(nullptr, &aead, KeysetRewrapper::Options()).status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(
+      KeysetRewrapper::New(&aead, nullptr, KeysetRewrapper::Options()).status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+  KeysetRewrapper::Options options;
+  options.max_concurrency = 0;
+  EXPECT_THAT(KeysetRewrapper::New(&aead, &aead, options).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  auto rewrapper = NewRewrapper(&aead, &aead, 1);
+  KeysetRewrapper::Job job = {nullptr, nullptr};
+  std::vector<util::Status> statuses = rewrapper->RewrapAll({job});
+  ASSERT_THAT(statuses, SizeIs(1));
+  EXPECT_THAT(statuses[0], StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace tink
+}  // namespace crypto
@@ -28,6 +28,13 @@ namespace tink {
 using crypto::tink::util::Status;
 using crypto::tink::util::StatusOr;
 
+namespace {
+
+// Bounds the memory of the lookup cache if callers use many distinct URIs.
+constexpr size_t kMaxCachedUris = 1024;
+
+}  // namespace
+
 // static
 KmsClients& KmsClients::GlobalInstance() {
   static KmsClients* instance = new KmsClients();
@@ -49,9 +56,19 @@ StatusOr<const KmsClient*> KmsClients::LocalGet(absl::string_view key_uri) {
     return Status(util::error::INVALID_ARGUMENT,
                   "key_uri must be non-empty.");
   }
+  {
+    absl::ReaderMutexLock lock(&clients_mutex_);
+    auto it = client_by_uri_.find(key_uri);
+    if (it != client_by_uri_.end()) return it->second;
+  }
   absl::MutexLock lock(&clients_mutex_);
   for (const auto& client : clients_) {
-    if (client->DoesSupport(key_uri)) return client.get();
+    if (client->DoesSupport(key_uri)) {
+      if (client_by_uri_.size() < kMaxCachedUris) {
+        client_by_uri_.emplace(std::string(key_uri), client.get());
+      }
+      return client.get();
+    }
   }
   return ToStatusF(util::error::NOT_FOUND, "no KmsClient found for key '%s'.",
                    std::string(key_uri).c_str());
@@ -100,6 +100,27 @@ TEST(KmsClientsTest, AddAndGet) {
   EXPECT_FALSE(client_result.ValueOrDie()->DoesSupport(data_1.uri));
 }
 
+TEST(KmsClientsTest, GetReturnsFirstAddedClient) {
+  std::string uri = "prefix3:uri";
+  EXPECT_THAT(
+      KmsClients::Add(absl::make_unique<DummyKmsClient>("prefix3", uri)),
+      IsOk());
+  auto first_result = KmsClients::Get(uri);
+  ASSERT_THAT(first_result.status(), IsOk());
+
+  // A later client for the same URI, which only supports it by prefix.
+  EXPECT_THAT(
+      KmsClients::Add(absl::make_unique<DummyKmsClient>("prefix3", "")),
+      IsOk());
+  for (int i = 0; i < 3; i++) {
+    auto client_result = KmsClients::Get(uri);
+    ASSERT_THAT(client_result.status(), IsOk());
+    EXPECT_EQ(client_result.ValueOrDie(), first_result.ValueOrDie());
+  }
+  auto other_result = KmsClients::Get("prefix3:other_uri");
+  ASSERT_THAT(other_result.status(), IsOk());
+  EXPECT_NE(other_result.ValueOrDie(), first_result.ValueOrDie());
+}
 
 }  // namespace
 }  // namespace tink
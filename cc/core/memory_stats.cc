@@ -0,0 +1,34 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/memory_stats.h"
+
+namespace crypto {
+namespace tink {
+
+MemoryStats& MemoryStats::operator+=(const MemoryStats& other) {
+  keyset_bytes += other.keyset_bytes;
+  primitive_set_bytes += other.primitive_set_bytes;
+  primitive_secret_bytes += other.primitive_secret_bytes;
+  for (const auto& primitive_and_bytes : other.bytes_by_primitive) {
+    bytes_by_primitive[primitive_and_bytes.first] +=
+        primitive_and_bytes.second;
+  }
+  return *this;
+}
+
+}  // namespace tink
+}  // namespace crypto
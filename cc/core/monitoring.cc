@@ -0,0 +1,128 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/monitoring.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+
+namespace crypto {
+namespace tink {
+
+namespace {
+
+std::vector<uint32_t> SortedUnique(std::vector<uint32_t> key_ids) {
+  std::sort(key_ids.begin(), key_ids.end());
+  key_ids.erase(std::unique(key_ids.begin(), key_ids.end()), key_ids.end());
+  return key_ids;
+}
+
+struct GlobalClient {
+  absl::Mutex mutex;
+  std::shared_ptr<MonitoringClient> client ABSL_GUARDED_BY(mutex);
+};
+
+GlobalClient& GlobalInstance() {
+  static GlobalClient* instance = new GlobalClient();
+  return *instance;
+}
+
+}  // namespace
+
+constexpr int MonitoringKeysetCounters::kNumShards;
+constexpr int MonitoringKeysetCounters::kCountersPerLine;
+constexpr int MonitoringKeysetCounters::kFailuresIndex;
+constexpr int MonitoringKeysetCounters::kRawFallbacksIndex;
+constexpr int MonitoringKeysetCounters::kKeysIndex;
+
+MonitoringKeysetCounters::MonitoringKeysetCounters(
+    absl::string_view primitive, std::vector<uint32_t> key_ids)
+    : primitive_(primitive),
+      key_ids_(SortedUnique(std::move(key_ids))),
+      shard_size_((kKeysIndex + 2 * static_cast<int>(key_ids_.size()) +
+                   kCountersPerLine - 1) /
+                  kCountersPerLine * kCountersPerLine),
+      // One more line, to align the shards to cache lines.
+      counters_(new std::atomic<int64_t>[kNumShards * shard_size_ +
+                                         kCountersPerLine]) {
+  for (int i = 0; i < kNumShards * shard_size_ + kCountersPerLine; i++) {
+    counters_[i].store(0, std::memory_order_relaxed);
+  }
+  uintptr_t misalignment = reinterpret_cast<uintptr_t>(counters_.get()) % 64;
+  shards_ = counters_.get();
+  if (misalignment != 0) {
+    shards_ += (64 - misalignment) / sizeof(std::atomic<int64_t>);
+  }
+}
+
+std::vector<MonitoringKeysetCounters::KeyUsage>
+MonitoringKeysetCounters::GetKeyUsage() const {
+  std::vector<KeyUsage> key_usage;
+  key_usage.reserve(key_ids_.size());
+  for (int i = 0; i < static_cast<int>(key_ids_.size()); i++) {
+    key_usage.push_back({key_ids_[i], Sum(kKeysIndex + 2 * i),
+                         Sum(kKeysIndex + 2 * i + 1)});
+  }
+  return key_usage;
+}
+
+int MonitoringKeysetCounters::KeyIndex(uint32_t key_id) const {
+  auto it = std::lower_bound(key_ids_.begin(), key_ids_.end(), key_id);
+  if (it == key_ids_.end() || *it != key_id) return -1;
+  return it - key_ids_.begin();
+}
+
+// static
+int MonitoringKeysetCounters::ShardIndex() {
+  static std::atomic<int> next_shard{0};
+  // Threads are assigned shards round-robin, on their first operation.
+  thread_local int shard =
+      next_shard.fetch_add(1, std::memory_order_relaxed) % kNumShards;
+  return shard;
+}
+
+int64_t MonitoringKeysetCounters::Sum(int index) const {
+  int64_t sum = 0;
+  for (int i = 0; i < kNumShards; i++) {
+    sum += shards_[i * shard_size_ + index].load(std::memory_order_relaxed);
+  }
+  return sum;
+}
+
+// static
+void Monitoring::SetClient(std::shared_ptr<MonitoringClient> client) {
+  GlobalClient& global = GlobalInstance();
+  absl::MutexLock lock(&global.mutex);
+  // The previous client is released after the lock.
+  global.client.swap(client);
+}
+
+// static
+std::shared_ptr<MonitoringClient> Monitoring::GetClient() {
+  GlobalClient& global = GlobalInstance();
+  absl::MutexLock lock(&global.mutex);
+  return global.client;
+}
+
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,108 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/monitoring.h"
+
+#include <memory>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+
+namespace crypto {
+namespace tink {
+namespace {
+
+using ::testing::Eq;
+using ::testing::IsNull;
+using ::testing::SizeIs;
+
+class NullMonitoringClient : public MonitoringClient {
+ public:
+  void RecordSample(const MonitoringSample& sample) override {}
+};
+
+TEST(MonitoringKeysetCountersTest, KeyIndex) {
+  MonitoringKeysetCounters counters("aead", {42, 7, 1000, 7});
+  EXPECT_THAT(counters.primitive(), Eq("aead"));
+  EXPECT_THAT(counters.KeyIndex(7), Eq(0));
+  EXPECT_THAT(counters.KeyIndex(42), Eq(1));
+  EXPECT_THAT(counters.KeyIndex(1000), Eq(2));
+  EXPECT_THAT(counters.KeyIndex(8), Eq(-1));
+  EXPECT_THAT(counters.GetKeyUsage(), SizeIs(3));
+}
+
+TEST(MonitoringKeysetCountersTest, Counts) {
+  MonitoringKeysetCounters counters("mac", {1, 2});
+  counters.Add(counters.KeyIndex(2), 10);
+  counters.Add(counters.KeyIndex(2), 5);
+  counters.AddFailure();
+  counters.AddRawFallback();
+  counters.AddRawFallback();
+
+  std::vector<MonitoringKeysetCounters::KeyUsage> key_usage =
+      counters.GetKeyUsage();
+  ASSERT_THAT(key_usage, SizeIs(2));
+  EXPECT_THAT(key_usage[0].key_id, Eq(1));
+  EXPECT_THAT(key_usage[0].operations, Eq(0));
+  EXPECT_THAT(key_usage[0].bytes, Eq(0));
+  EXPECT_THAT(key_usage[1].key_id, Eq(2));
+  EXPECT_THAT(key_usage[1].operations, Eq(2));
+  EXPECT_THAT(key_usage[1].bytes, Eq(15));
+  EXPECT_THAT(counters.failures(), Eq(1));
+  EXPECT_THAT(counters.raw_fallbacks(), Eq(2));
+}
+
+TEST(MonitoringKeysetCountersTest, SumsShardsOfAllThreads) {
+  const int kNumThreads = 16;
+  const int kOperationsPerThread = 1000;
+  MonitoringKeysetCounters counters("aead", {1, 2, 3, 4, 5});
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; i++) {
+    threads.emplace_back([&counters, i]() {
+      int key_index = i % 5;
+      for (int j = 0; j < kOperationsPerThread; j++) {
+        counters.Add(key_index, 3);
+        counters.AddFailure();
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  int64_t operations = 0;
+  for (const auto& key_usage : counters.GetKeyUsage()) {
+    EXPECT_THAT(key_usage.bytes, Eq(3 * key_usage.operations));
+    operations += key_usage.operations;
+  }
+  EXPECT_THAT(operations, Eq(kNumThreads * kOperationsPerThread));
+  EXPECT_THAT(counters.failures(), Eq(kNumThreads * kOperationsPerThread));
+}
+
+TEST(MonitoringTest, SetClient) {
+  EXPECT_THAT(Monitoring::GetClient(), IsNull());
+  auto client = std::make_shared<NullMonitoringClient>();
+  Monitoring::SetClient(client);
+  EXPECT_THAT(Monitoring::GetClient(), Eq(client));
+  Monitoring::SetClient(nullptr);
+  EXPECT_THAT(Monitoring::GetClient(), IsNull());
+  EXPECT_THAT(client.use_count(), Eq(1));
+}
+
+}  // namespace
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,247 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/packed_keyset_store.h"
+
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/base/internal/endian.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "tink/aead.h"
+#include "tink/keyset_handle.h"
+#include "tink/random_access_stream.h"
+#include "tink/util/buffer.h"
+#include "tink/util/errors.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+
+using ::google::crypto::tink::Keyset;
+
+namespace {
+
+constexpr absl::string_view kMagic = "TINKPKS1";
+constexpr int kHeaderSize = 16;
+constexpr int kIndexRecordSize = 16;
+
+struct IndexRecord {
+  uint64_t offset;
+  uint32_t id_size;
+  uint32_t ciphertext_size;
+};
+
+IndexRecord ParseIndexRecord(const std::string& data) {
+  IndexRecord record;
+  record.offset = absl::big_endian::Load64(data.data());
+  record.id_size = absl::big_endian::Load32(data.data() + 8);
+  record.ciphertext_size = absl::big_endian::Load32(data.data() + 12);
+  return record;
+}
+
+std::string SerializeIndexRecord(const IndexRecord& record) {
+  std::string data(kIndexRecordSize, '\0');
+  absl::big_endian::Store64(&data[0], record.offset);
+  absl::big_endian::Store32(&data[8], record.id_size);
+  absl::big_endian::Store32(&data[12], record.ciphertext_size);
+  return data;
+}
+
+util::Status CorruptStoreError() {
+  return util::Status(util::error::DATA_LOSS, "PackedKeysetStore is corrupt");
+}
+
+// Reads the 'count' bytes at 'position' of 'stream', which has the given
+// 'size', into 'data'.
+util::Status ReadAt(RandomAccessStream* stream, int64_t size,
+                    int64_t position, int64_t count, std::string* data) {
+  data->clear();
+  if (position < 0 || count < 0 || position > size || count > size - position ||
+      count > std::numeric_limits<int>::max()) {
+    return CorruptStoreError();
+  }
+  if (count == 0) return util::OkStatus();
+  auto buffer_result = util::Buffer::New(count);
+  if (!buffer_result.ok()) return buffer_result.status();
+  auto& buffer = buffer_result.ValueOrDie();
+  // PRead() may return fewer bytes than requested.
+  while (static_cast<int64_t>(data->size()) < count) {
+    util::Status status = stream->PRead(position + data->size(),
+                                        count - data->size(), buffer.get());
+    if (buffer->size() == 0) {
+      if (status.ok()) {
+        return util::Status(util::error::UNAVAILABLE,
+                            "no data read from the stream");
+      }
+      return status.error_code() == util::error::OUT_OF_RANGE
+                 ? CorruptStoreError()
+                 : status;
+    }
+    data->append(buffer->get_mem_block(), buffer->size());
+  }
+  return util::OkStatus();
+}
+
+}  // namespace
+
+// static
+util::StatusOr<std::unique_ptr<PackedKeysetStore>> PackedKeysetStore::New(
+    std::unique_ptr<RandomAccessStream> stream,
+    std::unique_ptr<Aead> master_key_aead) {
+  if (stream == nullptr || master_key_aead == nullptr) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "stream and master_key_aead must be non-null");
+  }
+  auto size_result = stream->size();
+  if (!size_result.ok()) return size_result.status();
+  int64_t size = size_result.ValueOrDie();
+
+  std::string header;
+  util::Status status = ReadAt(stream.get(), size, 0, kHeaderSize, &header);
+  if (!status.ok()) return status;
+  if (absl::string_view(header).substr(0, kMagic.size()) != kMagic) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "not a PackedKeysetStore");
+  }
+  int64_t num_entries = absl::big_endian::Load32(header.data() + 8);
+  if (kHeaderSize + num_entries * kIndexRecordSize > size) {
+    return CorruptStoreError();
+  }
+  return absl::WrapUnique(new PackedKeysetStore(
+      std::move(stream), std::move(master_key_aead), size, num_entries));
+}
+
+util::StatusOr<std::unique_ptr<KeysetHandle>> PackedKeysetStore::ReadKeyset(
+    absl::string_view id) const {
+  // Binary search of the index, reading only the records and IDs compared.
+  int64_t low = 0;
+  int64_t high = num_entries_;
+  std::string record_data;
+  std::string entry_id;
+  while (low < high) {
+    int64_t middle = low + (high - low) / 2;
+    util::Status status =
+        ReadAt(stream_.get(), size_, kHeaderSize + middle * kIndexRecordSize,
+               kIndexRecordSize, &record_data);
+    if (!status.ok()) return status;
+    IndexRecord record = ParseIndexRecord(record_data);
+    if (record.offset > static_cast<uint64_t>(size_)) {
+      return CorruptStoreError();
+    }
+    status = ReadAt(stream_.get(), size_, record.offset, record.id_size,
+                    &entry_id);
+    if (!status.ok()) return status;
+    int comparison = absl::string_view(entry_id).compare(id);
+    if (comparison < 0) {
+      low = middle + 1;
+    } else if (comparison > 0) {
+      high = middle;
+    } else {
+      std::string ciphertext;
+      status = ReadAt(stream_.get(), size_, record.offset + record.id_size,
+                      record.ciphertext_size, &ciphertext);
+      if (!status.ok()) return status;
+      auto keyset_data_result = master_key_aead_->Decrypt(ciphertext, id);
+      if (!keyset_data_result.ok()) {
+        return ToStatusF(util::error::INVALID_ARGUMENT,
+                         "Error decrypting encrypted keyset: %s",
+                         keyset_data_result.status().error_message());
+      }
+      std::unique_ptr<KeysetHandle> handle(new KeysetHandle());
+      if (!handle->mutable_keyset()->ParseFromString(
+              keyset_data_result.ValueOrDie())) {
+        return util::Status(util::error::INVALID_ARGUMENT,
+                            "Could not parse the decrypted keyset");
+      }
+      return std::move(handle);
+    }
+  }
+  return util::Status(util::error::NOT_FOUND,
+                      absl::StrCat("No keyset with ID '", id, "'"));
+}
+
+util::StatusOr<std::shared_ptr<const KeysetHandle>>
+PackedKeysetStore::GetKeysetHandle(absl::string_view id) {
+  {
+    absl::MutexLock lock(&mutex_);
+    auto it = handles_.find(id);
+    if (it != handles_.end()) return it->second;
+  }
+  // The keyset is read and decrypted without holding the lock, so another
+  // thread may materialize the same keyset concurrently.
+  auto handle_result = ReadKeyset(id);
+  if (!handle_result.ok()) return handle_result.status();
+  std::shared_ptr<const KeysetHandle> handle =
+      std::move(handle_result.ValueOrDie());
+  absl::MutexLock lock(&mutex_);
+  return handles_.emplace(std::string(id), std::move(handle)).first->second;
+}
+
+util::Status PackedKeysetStoreWriter::Add(absl::string_view id,
+                                          const KeysetHandle& keyset_handle) {
+  if (id.size() > std::numeric_limits<uint32_t>::max()) {
+    return util::Status(util::error::INVALID_ARGUMENT, "ID is too long");
+  }
+  if (ciphertexts_.find(std::string(id)) != ciphertexts_.end()) {
+    return util::Status(util::error::ALREADY_EXISTS,
+                        absl::StrCat("ID '", id, "' was already added"));
+  }
+  auto ciphertext_result = master_key_aead_->Encrypt(
+      keyset_handle.get_keyset().SerializeAsString(), id);
+  if (!ciphertext_result.ok()) return ciphertext_result.status();
+  if (ciphertext_result.ValueOrDie().size() >
+      std::numeric_limits<uint32_t>::max()) {
+    return util::Status(util::error::INVALID_ARGUMENT, "keyset is too large");
+  }
+  ciphertexts_.emplace(std::string(id),
+                       std::move(ciphertext_result.ValueOrDie()));
+  return util::OkStatus();
+}
+
+util::StatusOr<std::string> PackedKeysetStoreWriter::Write() const {
+  if (ciphertexts_.size() > std::numeric_limits<uint32_t>::max()) {
+    return util::Status(util::error::INVALID_ARGUMENT, "too many keysets");
+  }
+  std::string header(kHeaderSize, '\0');
+  header.replace(0, kMagic.size(), kMagic.data(), kMagic.size());
+  absl::big_endian::Store32(&header[8], ciphertexts_.size());
+
+  std::string index;
+  index.reserve(ciphertexts_.size() * kIndexRecordSize);
+  std::string entries;
+  uint64_t offset = kHeaderSize + ciphertexts_.size() * kIndexRecordSize;
+  for (const auto& entry : ciphertexts_) {
+    IndexRecord record;
+    record.offset = offset + entries.size();
+    record.id_size = entry.first.size();
+    record.ciphertext_size = entry.second.size();
+    index.append(SerializeIndexRecord(record));
+    absl::StrAppend(&entries, entry.first, entry.second);
+  }
+  return absl::StrCat(header, index, entries);
+}
+
+}  // namespace tink
+}  // namespace crypto
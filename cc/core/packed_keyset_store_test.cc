@@ -0,0 +1,222 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/packed_keyset_store.h"
+
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "tink/aead.h"
+#include "tink/aead/aead_config.h"
+#include "tink/aead/aead_key_templates.h"
+#include "tink/keyset_handle.h"
+#include "tink/subtle/aes_gcm_boringssl.h"
+#include "tink/subtle/random.h"
+#include "tink/util/mmap_random_access_stream.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/test_matchers.h"
+#include "tink/util/test_util.h"
+
+namespace crypto {
+namespace tink {
+namespace {
+
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::testing::Eq;
+using ::testing::Not;
+
+class PackedKeysetStoreTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_THAT(AeadConfig::Register(), IsOk());
+    master_key_value_ = subtle::Random::GetRandomBytes(16);
+  }
+
+  std::unique_ptr<Aead> NewMasterKeyAead() {
+    auto aead_result = subtle::AesGcmBoringSsl::New(
+        util::SecretDataFromStringView(master_key_value_));
+    EXPECT_THAT(aead_result.status(), IsOk());
+    return std::move(aead_result.ValueOrDie());
+  }
+
+  std::unique_ptr<KeysetHandle> NewKeysetHandle() {
+    auto handle_result =
+        KeysetHandle::GenerateNew(AeadKeyTemplates::Aes128Gcm());
+    EXPECT_THAT(handle_result.status(), IsOk());
+    return std::move(handle_result.ValueOrDie());
+  }
+
+  // Returns a store with the contents 'store_data'.
+  util::StatusOr<std::unique_ptr<PackedKeysetStore>> OpenStore(
+      absl::string_view store_data) {
+    std::string filename = absl::StrCat(
+        "packed_keyset_store_", file_count_++, "_test.bin");
+    int fd = test::GetTestFileDescriptor(filename, store_data);
+    auto stream_result = util::MmapRandomAccessStream::New(
+        fd, util::MmapRandomAccessStream::AccessPattern::kRandom);
+    if (!stream_result.ok()) return stream_result.status();
+    return PackedKeysetStore::New(std::move(stream_result.ValueOrDie()),
+                                  NewMasterKeyAead());
+  }
+
+  std::string master_key_value_;
+  int file_count_ = 0;
+};
+
+// Checks that 'handle' holds the same keys as 'expected', by decrypting a
+// ciphertext of one with the other.
+void ExpectSameKeys(const KeysetHandle& expected, const KeysetHandle& handle) {
+  auto expected_aead = expected.GetPrimitive<Aead>().ValueOrDie();
+  auto aead = handle.GetPrimitive<Aead>().ValueOrDie();
+  std::string ciphertext = expected_aead->Encrypt("plaintext", "").ValueOrDie();
+  auto plaintext_result = aead->Decrypt(ciphertext, "");
+  ASSERT_THAT(plaintext_result.status(), IsOk());
+  EXPECT_THAT(plaintext_result.ValueOrDie(), Eq("plaintext"));
+}
+
+TEST_F(PackedKeysetStoreTest, WriteAndRead) {
+  auto master_key_aead = NewMasterKeyAead();
+  PackedKeysetStoreWriter writer(master_key_aead.get());
+  std::vector<std::string> ids;
+  std::vector<std::unique_ptr<KeysetHandle>> handles;
+  for (int i = 0; i < 100; i++) {
+    ids.push_back(absl::StrCat("tenant", i));
+    handles.push_back(NewKeysetHandle());
+    ASSERT_THAT(writer.Add(ids.back(), *handles.back()), IsOk());
+  }
+  auto data_result = writer.Write();
+  ASSERT_THAT(data_result.status(), IsOk());
+
+  auto store_result = OpenStore(data_result.ValueOrDie());
+  ASSERT_THAT(store_result.status(), IsOk());
+  auto& store = store_result.ValueOrDie();
+  EXPECT_THAT(store->size(), Eq(100));
+  for (int i = 0; i < 100; i++) {
+    SCOPED_TRACE(ids[i]);
+    auto handle_result = store->GetKeysetHandle(ids[i]);
+    ASSERT_THAT(handle_result.status(), IsOk());
+    ExpectSameKeys(*handles[i], *handle_result.ValueOrDie());
+    // Later calls return the same handle.
+    EXPECT_THAT(store->GetKeysetHandle(ids[i]).ValueOrDie(),
+                Eq(handle_result.ValueOrDie()));
+  }
+  for (absl::string_view missing_id : {"", "tenant", "tenant100", "zzz"}) {
+    EXPECT_THAT(store->GetKeysetHandle(missing_id).status(),
+                StatusIs(util::error::NOT_FOUND));
+  }
+}
+
+TEST_F(PackedKeysetStoreTest, EmptyStore) {
+  auto master_key_aead = NewMasterKeyAead();
+  auto data_result = PackedKeysetStoreWriter(master_key_aead.get()).Write();
+  ASSERT_THAT(data_result.status(), IsOk());
+  auto store_result = OpenStore(data_result.ValueOrDie());
+  ASSERT_THAT(store_result.status(), IsOk());
+  EXPECT_THAT(store_result.ValueOrDie()->size(), Eq(0));
+  EXPECT_THAT(store_result.ValueOrDie()->GetKeysetHandle("tenant").status(),
+              StatusIs(util::error::NOT_FOUND));
+}
+
+TEST_F(PackedKeysetStoreTest, DuplicateId) {
+  auto master_key_aead = NewMasterKeyAead();
+  PackedKeysetStoreWriter writer(master_key_aead.get());
+  ASSERT_THAT(writer.Add("tenant", *NewKeysetHandle()), IsOk());
+  EXPECT_THAT(writer.Add("tenant", *NewKeysetHandle()),
+              StatusIs(util::error::ALREADY_EXISTS));
+}
+
+TEST_F(PackedKeysetStoreTest, InvalidStores) {
+  EXPECT_THAT(OpenStore("").status(), Not(IsOk()));
+  EXPECT_THAT(OpenStore("not a packed keyset store").status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+
+  auto master_key_aead = NewMasterKeyAead();
+  PackedKeysetStoreWriter writer(master_key_aead.get());
+  ASSERT_THAT(writer.Add("tenant", *NewKeysetHandle()), IsOk());
+  std::string data = writer.Write().ValueOrDie();
+  // Truncated index.
+  EXPECT_THAT(OpenStore(data.substr(0, 20)).status(),
+              StatusIs(util::error::DATA_LOSS));
+  // Truncated entries.
+  auto store_result = OpenStore(data.substr(0, data.size() - 1));
+  ASSERT_THAT(store_result.status(), IsOk());
+  EXPECT_THAT(store_result.ValueOrDie()->GetKeysetHandle("tenant").status(),
+              StatusIs(util::error::DATA_LOSS));
+}
+
+TEST_F(PackedKeysetStoreTest, KeysetsAreBoundToTheirIds) {
+  auto master_key_aead = NewMasterKeyAead();
+  PackedKeysetStoreWriter writer(master_key_aead.get());
+  ASSERT_THAT(writer.Add("tenantA", *NewKeysetHandle()), IsOk());
+  ASSERT_THAT(writer.Add("tenantB", *NewKeysetHandle()), IsOk());
+  std::string data = writer.Write().ValueOrDie();
+  // Renames the entry of tenantA to tenantB, and the one of tenantB to
+  // tenantC: both IDs are still in sorted order.
+  std::string modified = data;
+  size_t a = modified.find("tenantA");
+  size_t b = modified.find("tenantB");
+  ASSERT_NE(a, std::string::npos);
+  ASSERT_NE(b, std::string::npos);
+  modified[b + 6] = 'C';
+  modified[a + 6] = 'B';
+  auto store_result = OpenStore(modified);
+  ASSERT_THAT(store_result.status(), IsOk());
+  EXPECT_THAT(store_result.ValueOrDie()->GetKeysetHandle("tenantB").status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+
+  // A store with a different master key.
+  master_key_value_ = subtle::Random::GetRandomBytes(16);
+  auto other_store_result = OpenStore(data);
+  ASSERT_THAT(other_store_result.status(), IsOk());
+  EXPECT_THAT(
+      other_store_result.ValueOrDie()->GetKeysetHandle("tenantA").status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST_F(PackedKeysetStoreTest, ConcurrentReads) {
+  auto master_key_aead = NewMasterKeyAead();
+  PackedKeysetStoreWriter writer(master_key_aead.get());
+  for (int i = 0; i < 20; i++) {
+    ASSERT_THAT(writer.Add(absl::StrCat("tenant", i), *NewKeysetHandle()),
+                IsOk());
+  }
+  auto store_result = OpenStore(writer.Write().ValueOrDie());
+  ASSERT_THAT(store_result.status(), IsOk());
+  PackedKeysetStore* store = store_result.ValueOrDie().get();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([store]() {
+      for (int i = 0; i < 20; i++) {
+        EXPECT_THAT(store->GetKeysetHandle(absl::StrCat("tenant", i)).status(),
+                    IsOk());
+      }
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+}
+
+}  // namespace
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,135 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/per_node_primitive.h"
+
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "tink/internal/numa.h"
+#include "tink/keyset_handle.h"
+#include "tink/keyset_manager.h"
+#include "tink/mac.h"
+#include "tink/mac/mac_config.h"
+#include "tink/mac/mac_key_templates.h"
+#include "tink/util/status.h"
+#include "tink/util/test_matchers.h"
+
+namespace crypto {
+namespace tink {
+namespace {
+
+using ::crypto::tink::test::IsOk;
+using ::testing::Eq;
+using ::testing::Ne;
+using ::testing::Not;
+
+class PerNodePrimitiveTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_THAT(MacConfig::Register(), IsOk());
+    manager_ = std::move(
+        KeysetManager::New(MacKeyTemplates::HmacSha256HalfSizeTag())
+            .ValueOrDie());
+  }
+
+  // Returns the tag of the primary key of the current keyset.
+  std::string ExpectedTag() {
+    auto mac = manager_->GetKeysetHandle()->GetPrimitive<Mac>().ValueOrDie();
+    return mac->ComputeMac("data").ValueOrDie();
+  }
+
+  // Two nodes on CPU 0, so that replicas are built on bound threads on any
+  // host.
+  internal::NumaTopology topology_ =
+      internal::NumaTopology::FromCpuLists({{0}, {0}});
+  std::unique_ptr<KeysetManager> manager_;
+};
+
+TEST_F(PerNodePrimitiveTest, OneReplicaPerNode) {
+  auto result =
+      PerNodePrimitive<Mac>::New(*manager_->GetKeysetHandle(), topology_);
+  ASSERT_THAT(result.status(), IsOk());
+  auto& per_node = result.ValueOrDie();
+  ASSERT_THAT(per_node->num_nodes(), Eq(2));
+  EXPECT_THAT(per_node->GetForNode(0).get(),
+              Ne(per_node->GetForNode(1).get()));
+  std::string tag = ExpectedTag();
+  for (int node = 0; node < 2; node++) {
+    EXPECT_THAT(per_node->GetForNode(node)->ComputeMac("data").ValueOrDie(),
+                Eq(tag));
+  }
+  EXPECT_THAT(per_node->Get()->ComputeMac("data").ValueOrDie(), Eq(tag));
+}
+
+TEST_F(PerNodePrimitiveTest, UpdateReplacesAllReplicas) {
+  auto result =
+      PerNodePrimitive<Mac>::New(*manager_->GetKeysetHandle(), topology_);
+  ASSERT_THAT(result.status(), IsOk());
+  auto& per_node = result.ValueOrDie();
+  std::string old_tag = ExpectedTag();
+
+  // An unchanged keyset is not rebuilt.
+  Mac* mac = per_node->GetForNode(0).get();
+  ASSERT_THAT(per_node->Update(*manager_->GetKeysetHandle()), IsOk());
+  EXPECT_THAT(per_node->generation(), Eq(1));
+  EXPECT_THAT(per_node->GetForNode(0).get(), Eq(mac));
+
+  ASSERT_THAT(
+      manager_->Rotate(MacKeyTemplates::HmacSha256HalfSizeTag()).status(),
+      IsOk());
+  {
+    PerNodePrimitive<Mac>::Handle old_handle = per_node->GetForNode(1);
+    ASSERT_THAT(per_node->Update(*manager_->GetKeysetHandle()), IsOk());
+    // The handle still refers to the replica of the old keyset.
+    EXPECT_THAT(old_handle->ComputeMac("data").ValueOrDie(), Eq(old_tag));
+  }
+  EXPECT_THAT(per_node->generation(), Eq(2));
+  std::string new_tag = ExpectedTag();
+  EXPECT_THAT(new_tag, Not(Eq(old_tag)));
+  for (int node = 0; node < 2; node++) {
+    EXPECT_THAT(per_node->GetForNode(node)->ComputeMac("data").ValueOrDie(),
+                Eq(new_tag));
+    EXPECT_THAT(per_node->GetForNode(node)->VerifyMac(old_tag, "data"),
+                IsOk());
+  }
+}
+
+TEST_F(PerNodePrimitiveTest, HostTopology) {
+  auto result = PerNodePrimitive<Mac>::New(*manager_->GetKeysetHandle());
+  ASSERT_THAT(result.status(), IsOk());
+  auto& per_node = result.ValueOrDie();
+  std::string tag = ExpectedTag();
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back([&per_node, &tag]() {
+      for (int j = 0; j < 100; j++) {
+        EXPECT_THAT(per_node->Get()->ComputeMac("data").ValueOrDie(), Eq(tag));
+      }
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+}
+
+}  // namespace
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,142 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/primitive_cache.h"
+
+#include <memory>
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "tink/keyset_handle.h"
+#include "tink/mac.h"
+#include "tink/mac/mac_config.h"
+#include "tink/mac/mac_key_templates.h"
+#include "tink/registry.h"
+#include "tink/util/status.h"
+#include "tink/util/test_matchers.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace {
+
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::google::crypto::tink::KeyData;
+using ::testing::Eq;
+using ::testing::Ne;
+
+class PrimitiveCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override { ASSERT_THAT(MacConfig::Register(), IsOk()); }
+
+  static KeyData NewHmacKeyData() {
+    auto key_data_result =
+        Registry::NewKeyData(MacKeyTemplates::HmacSha256HalfSizeTag());
+    EXPECT_THAT(key_data_result.status(), IsOk());
+    return *key_data_result.ValueOrDie();
+  }
+};
+
+TEST_F(PrimitiveCacheTest, InvalidMaxEntries) {
+  EXPECT_THAT(PrimitiveCache::New(0).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(PrimitiveCache::New(-1).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST_F(PrimitiveCacheTest, ReturnsCachedPrimitive) {
+  auto cache = std::move(PrimitiveCache::New(10).ValueOrDie());
+  KeyData key_data = NewHmacKeyData();
+
+  auto first = cache->GetPrimitive<Mac>(key_data);
+  ASSERT_THAT(first.status(), IsOk());
+  auto second = cache->GetPrimitive<Mac>(key_data);
+  ASSERT_THAT(second.status(), IsOk());
+  EXPECT_THAT(second.ValueOrDie().get(), Eq(first.ValueOrDie().get()));
+
+  auto other = cache->GetPrimitive<Mac>(NewHmacKeyData());
+  ASSERT_THAT(other.status(), IsOk());
+  EXPECT_THAT(other.ValueOrDie().get(), Ne(first.ValueOrDie().get()));
+
+  PrimitiveCache::Stats stats = cache->GetStats();
+  EXPECT_THAT(stats.hits, Eq(1));
+  EXPECT_THAT(stats.misses, Eq(2));
+}
+
+TEST_F(PrimitiveCacheTest, EvictsLeastRecentlyUsed) {
+  auto cache = std::move(PrimitiveCache::New(2).ValueOrDie());
+  KeyData key_data_1 = NewHmacKeyData();
+  KeyData key_data_2 = NewHmacKeyData();
+  KeyData key_data_3 = NewHmacKeyData();
+
+  ASSERT_THAT(cache->GetPrimitive<Mac>(key_data_1).status(), IsOk());
+  ASSERT_THAT(cache->GetPrimitive<Mac>(key_data_2).status(), IsOk());
+  // Makes key_data_2 the least recently used entry.
+  ASSERT_THAT(cache->GetPrimitive<Mac>(key_data_1).status(), IsOk());
+  ASSERT_THAT(cache->GetPrimitive<Mac>(key_data_3).status(), IsOk());
+  EXPECT_THAT(cache->GetStats().misses, Eq(3));
+
+  ASSERT_THAT(cache->GetPrimitive<Mac>(key_data_1).status(), IsOk());
+  EXPECT_THAT(cache->GetStats().misses, Eq(3));
+  ASSERT_THAT(cache->GetPrimitive<Mac>(key_data_2).status(), IsOk());
+  EXPECT_THAT(cache->GetStats().misses, Eq(4));
+}
+
+TEST_F(PrimitiveCacheTest, UnknownKeyType) {
+  auto cache = std::move(PrimitiveCache::New(10).ValueOrDie());
+  KeyData key_data = NewHmacKeyData();
+  key_data.set_type_url("some.unknown.KeyType");
+  EXPECT_THAT(cache->GetPrimitive<Mac>(key_data).status(),
+              StatusIs(util::error::NOT_FOUND));
+}
+
+TEST_F(PrimitiveCacheTest, KeysetHandleGetCachedPrimitive) {
+  auto cache = std::move(PrimitiveCache::New(10).ValueOrDie());
+  auto handle = std::move(
+      KeysetHandle::GenerateNew(MacKeyTemplates::HmacSha256HalfSizeTag())
+          .ValueOrDie());
+
+  auto cached_mac = handle->GetCachedPrimitive<Mac>(cache.get());
+  ASSERT_THAT(cached_mac.status(), IsOk());
+  auto mac = handle->GetPrimitive<Mac>();
+  ASSERT_THAT(mac.status(), IsOk());
+
+  std::string data = "some data";
+  auto tag = cached_mac.ValueOrDie()->ComputeMac(data);
+  ASSERT_THAT(tag.status(), IsOk());
+  EXPECT_THAT(mac.ValueOrDie()->VerifyMac(tag.ValueOrDie(), data), IsOk());
+
+  // The second primitive reuses the cached per-key primitive.
+  auto cached_mac_2 = handle->GetCachedPrimitive<Mac>(cache.get());
+  ASSERT_THAT(cached_mac_2.status(), IsOk());
+  EXPECT_THAT(cache->GetStats().hits, Eq(1));
+  EXPECT_THAT(cached_mac_2.ValueOrDie()->VerifyMac(tag.ValueOrDie(), data),
+              IsOk());
+}
+
+TEST_F(PrimitiveCacheTest, KeysetHandleNullCache) {
+  auto handle = std::move(
+      KeysetHandle::GenerateNew(MacKeyTemplates::HmacSha256HalfSizeTag())
+          .ValueOrDie());
+  EXPECT_THAT(handle->GetCachedPrimitive<Mac>(nullptr).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace tink
+}  // namespace crypto
@@ -16,21 +16,30 @@
 
 #include "tink/primitive_set.h"
 
+#include <atomic>
+#include <map>
+#include <string>
 #include <thread>  // NOLINT(build/c++11)
+#include <vector>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "tink/crypto_format.h"
 #include "tink/mac.h"
+#include "tink/mac/mac_wrapper.h"
+#include "tink/memory_stats.h"
+#include "tink/util/secret_data.h"
 #include "tink/util/test_matchers.h"
 #include "tink/util/test_util.h"
 #include "proto/tink.pb.h"
 
 using ::crypto::tink::test::DummyMac;
 using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
 using ::google::crypto::tink::KeysetInfo;
 using ::google::crypto::tink::KeyStatusType;
 using ::google::crypto::tink::OutputPrefixType;
+using ::testing::Eq;
 using ::testing::UnorderedElementsAreArray;
 
 namespace crypto {
@@ -388,6 +397,27 @@ KeysetInfo::KeyInfo CreateKey(
   return key_info;
 }
 
+TEST_F(PrimitiveSetTest, IdentifierAccessors) {
+  for (OutputPrefixType output_prefix_type :
+       {OutputPrefixType::TINK, OutputPrefixType::LEGACY,
+        OutputPrefixType::RAW}) {
+    KeysetInfo::KeyInfo key_info =
+        CreateKey(1234543, output_prefix_type, KeyStatusType::ENABLED);
+    PrimitiveSet<Mac> primitive_set;
+    auto add_primitive_result = primitive_set.AddPrimitive(
+        absl::make_unique<DummyMac>("MAC"), key_info);
+    ASSERT_THAT(add_primitive_result.status(), IsOk());
+    const auto* entry = add_primitive_result.ValueOrDie();
+
+    std::string prefix = CryptoFormat::GetOutputPrefix(key_info).ValueOrDie();
+    EXPECT_EQ(prefix, entry->identifier_view());
+    const std::string& identifier = entry->get_identifier();
+    EXPECT_EQ(prefix, identifier);
+    // The string is built once and stays valid with the entry.
+    EXPECT_EQ(&identifier, &entry->get_identifier());
+  }
+}
+
 TEST_F(PrimitiveSetTest, GetAll) {
   PrimitiveSet<Mac> pset;
   EXPECT_THAT(pset.AddPrimitive(absl::make_unique<DummyMac>("MAC1"),
@@ -438,6 +468,429 @@ TEST_F(PrimitiveSetTest, GetAll) {
   EXPECT_THAT(mac_and_id, UnorderedElementsAreArray(expected_result));
 }
 
+TEST_F(PrimitiveSetTest, BuilderBasic) {
+  KeysetInfo::KeyInfo key_1 =
+      CreateKey(0x01010101, OutputPrefixType::TINK, KeyStatusType::ENABLED);
+  KeysetInfo::KeyInfo key_2 =
+      CreateKey(0x01010101, OutputPrefixType::LEGACY, KeyStatusType::ENABLED);
+  KeysetInfo::KeyInfo key_3 =
+      CreateKey(0x02020202, OutputPrefixType::TINK, KeyStatusType::ENABLED);
+  KeysetInfo::KeyInfo key_4 =
+      CreateKey(0x03030303, OutputPrefixType::RAW, KeyStatusType::ENABLED);
+
+  auto pset_or = PrimitiveSet<Mac>::Builder()
+                     .AddPrimitive(absl::make_unique<DummyMac>("MAC1"), key_1)
+                     .AddPrimitive(absl::make_unique<DummyMac>("MAC2"), key_2)
+                     .AddPrimaryPrimitive(
+                         absl::make_unique<DummyMac>("MAC3"), key_3)
+                     .AddPrimitive(absl::make_unique<DummyMac>("MAC4"), key_4)
+                     .Build();
+  ASSERT_THAT(pset_or.status(), IsOk());
+  std::unique_ptr<PrimitiveSet<Mac>> pset = std::move(pset_or.ValueOrDie());
+  EXPECT_FALSE(pset->is_mutable());
+  EXPECT_EQ(4, pset->get_all().size());
+
+  ASSERT_NE(pset->get_primary(), nullptr);
+  EXPECT_EQ(key_3.key_id(), pset->get_primary()->get_key_id());
+  EXPECT_EQ("13:0:DummyMac:MAC3",
+            pset->get_primary()->get_primitive().ComputeMac("").ValueOrDie());
+
+  {  // Check Tink primitives.
+    std::string prefix = CryptoFormat::GetOutputPrefix(key_1).ValueOrDie();
+    auto primitives_or = pset->get_primitives(prefix);
+    ASSERT_THAT(primitives_or.status(), IsOk());
+    ASSERT_EQ(1, primitives_or.ValueOrDie()->size());
+    EXPECT_EQ("13:0:DummyMac:MAC1", (*primitives_or.ValueOrDie())[0]
+                                        ->get_primitive()
+                                        .ComputeMac("")
+                                        .ValueOrDie());
+  }
+
+  {  // Check legacy primitive with the same key id.
+    std::string prefix = CryptoFormat::GetOutputPrefix(key_2).ValueOrDie();
+    auto primitives_or = pset->get_primitives(prefix);
+    ASSERT_THAT(primitives_or.status(), IsOk());
+    ASSERT_EQ(1, primitives_or.ValueOrDie()->size());
+    EXPECT_EQ(OutputPrefixType::LEGACY,
+              (*primitives_or.ValueOrDie())[0]->get_output_prefix_type());
+  }
+
+  {  // Check raw primitives.
+    auto primitives_or = pset->get_raw_primitives();
+    ASSERT_THAT(primitives_or.status(), IsOk());
+    ASSERT_EQ(1, primitives_or.ValueOrDie()->size());
+    EXPECT_EQ(key_4.key_id(), (*primitives_or.ValueOrDie())[0]->get_key_id());
+  }
+
+  // Unknown identifiers.
+  EXPECT_EQ(
+      util::error::NOT_FOUND,
+      pset->get_primitives("\x01\x04\x04\x04\x04").status().error_code());
+  EXPECT_EQ(util::error::NOT_FOUND,
+            pset->get_primitives("prefix").status().error_code());
+}
+
+TEST_F(PrimitiveSetTest, BuilderWithoutRawPrimitives) {
+  auto pset_or = PrimitiveSet<Mac>::Builder()
+                     .AddPrimaryPrimitive(
+                         absl::make_unique<DummyMac>("MAC1"),
+                         CreateKey(0x01010101, OutputPrefixType::TINK,
+                                   KeyStatusType::ENABLED))
+                     .Build();
+  ASSERT_THAT(pset_or.status(), IsOk());
+  EXPECT_EQ(util::error::NOT_FOUND,
+            pset_or.ValueOrDie()->get_raw_primitives().status().error_code());
+}
+
+TEST_F(PrimitiveSetTest, BuilderReturnsFirstError) {
+  auto pset_or = PrimitiveSet<Mac>::Builder()
+                     .AddPrimitive(absl::make_unique<DummyMac>("MAC1"),
+                                   CreateKey(0x01010101, OutputPrefixType::TINK,
+                                             KeyStatusType::DISABLED))
+                     .AddPrimitive(nullptr,
+                                   CreateKey(0x01010101, OutputPrefixType::TINK,
+                                             KeyStatusType::ENABLED))
+                     .Build();
+  EXPECT_EQ(util::error::INVALID_ARGUMENT, pset_or.status().error_code());
+  EXPECT_THAT(pset_or.status().error_message(),
+              testing::HasSubstr("must be ENABLED"));
+}
+
+TEST_F(PrimitiveSetTest, BuilderBuildTwice) {
+  PrimitiveSet<Mac>::Builder builder;
+  builder.AddPrimaryPrimitive(
+      absl::make_unique<DummyMac>("MAC1"),
+      CreateKey(0x01010101, OutputPrefixType::TINK, KeyStatusType::ENABLED));
+  EXPECT_THAT(builder.Build().status(), IsOk());
+  EXPECT_EQ(util::error::FAILED_PRECONDITION,
+            builder.Build().status().error_code());
+}
+
+TEST_F(PrimitiveSetTest, ImmutableSetRejectsChanges) {
+  auto pset_or = PrimitiveSet<Mac>::Builder()
+                     .AddPrimaryPrimitive(
+                         absl::make_unique<DummyMac>("MAC1"),
+                         CreateKey(0x01010101, OutputPrefixType::TINK,
+                                   KeyStatusType::ENABLED))
+                     .Build();
+  ASSERT_THAT(pset_or.status(), IsOk());
+  PrimitiveSet<Mac>& pset = *pset_or.ValueOrDie();
+  EXPECT_EQ(util::error::FAILED_PRECONDITION,
+            pset.AddPrimitive(absl::make_unique<DummyMac>("MAC2"),
+                              CreateKey(0x02020202, OutputPrefixType::TINK,
+                                        KeyStatusType::ENABLED))
+                .status()
+                .error_code());
+  EXPECT_EQ(util::error::FAILED_PRECONDITION,
+            pset.set_primary(pset.get_all()[0]).error_code());
+  EXPECT_EQ(1, pset.get_all().size());
+}
+
+TEST_F(PrimitiveSetTest, ImmutableSetConcurrentAccess) {
+  PrimitiveSet<Mac>::Builder builder;
+  int count = 100;
+  for (int i = 0; i < count; i++) {
+    builder.AddPrimitive(
+        absl::make_unique<DummyMac>("dummy MAC"),
+        CreateKey(100 + i, OutputPrefixType::TINK, KeyStatusType::ENABLED));
+  }
+  auto pset_or = builder.Build();
+  ASSERT_THAT(pset_or.status(), IsOk());
+  PrimitiveSet<Mac>* pset = pset_or.ValueOrDie().get();
+
+  std::thread access_primitives_a(access_primitives, pset, 100, count);
+  std::thread access_primitives_b(access_primitives, pset, 100, count);
+  access_primitives_a.join();
+  access_primitives_b.join();
+}
+
+TEST_F(PrimitiveSetTest, MemoryUsage) {
+  const int kCount = 100;
+  PrimitiveSet<Mac> mutable_pset;
+  add_primitives(&mutable_pset, 100, kCount);
+  PrimitiveSet<Mac>::Builder builder;
+  for (int i = 0; i < kCount; i++) {
+    builder.AddPrimitive(
+        absl::make_unique<DummyMac>("dummy MAC"),
+        CreateKey(100 + i, OutputPrefixType::TINK, KeyStatusType::ENABLED));
+  }
+  auto pset_or = builder.Build();
+  ASSERT_THAT(pset_or.status(), IsOk());
+  const PrimitiveSet<Mac>& pset = *pset_or.ValueOrDie();
+
+  size_t min_usage = kCount * sizeof(PrimitiveSet<Mac>::Entry<Mac>);
+  EXPECT_GE(pset.GetMemoryUsage(), min_usage);
+  // The immutable set needs no hash map.
+  EXPECT_LT(pset.GetMemoryUsage(), mutable_pset.GetMemoryUsage());
+
+  // The entries stay accessible after the move into the lookup table.
+  EXPECT_EQ(kCount, pset.get_all().size());
+  for (const auto* entry : pset.get_all()) {
+    EXPECT_EQ(CryptoFormat::kNonRawPrefixSize, entry->get_identifier().size());
+  }
+  access_primitives(pset_or.ValueOrDie().get(), 100, kCount);
+}
+
+TEST_F(PrimitiveSetTest, MemoryUsageWithoutIdentifierStrings) {
+  const int kCount = 10;
+  PrimitiveSet<Mac>::Builder builder;
+  for (int i = 0; i < kCount; i++) {
+    builder.AddPrimitive(
+        absl::make_unique<DummyMac>("dummy MAC"),
+        CreateKey(100 + i, OutputPrefixType::TINK, KeyStatusType::ENABLED));
+  }
+  builder.AddPrimaryPrimitive(
+      absl::make_unique<DummyMac>("dummy MAC"),
+      CreateKey(100 + kCount, OutputPrefixType::TINK, KeyStatusType::ENABLED));
+  auto pset_or = builder.Build();
+  ASSERT_THAT(pset_or.status(), IsOk());
+  const PrimitiveSet<Mac>* pset = pset_or.ValueOrDie().get();
+  size_t usage = pset->GetMemoryUsage();
+
+  // Neither building nor wrapping the set, nor computing and verifying, builds
+  // the identifier strings.
+  auto mac_or = MacWrapper().Wrap(std::move(pset_or.ValueOrDie()));
+  ASSERT_THAT(mac_or.status(), IsOk());
+  auto tag_or = mac_or.ValueOrDie()->ComputeMac("data");
+  ASSERT_THAT(tag_or.status(), IsOk());
+  EXPECT_THAT(mac_or.ValueOrDie()->VerifyMac(tag_or.ValueOrDie(), "data"),
+              IsOk());
+  EXPECT_THAT(pset->GetMemoryUsage(), Eq(usage));
+
+  // They are only counted once a caller asks for them.
+  for (const auto* entry : pset->get_all()) entry->get_identifier();
+  EXPECT_THAT(pset->GetMemoryUsage(),
+              Eq(usage + (kCount + 1) * sizeof(std::string)));
+}
+
+// A Mac which holds a key of a given size.
+class SecretMac : public Mac {
+ public:
+  explicit SecretMac(size_t key_size)
+      : key_(util::SecretDataFromStringView(std::string(key_size, 'k'))) {}
+
+  util::StatusOr<std::string> ComputeMac(
+      absl::string_view data) const override {
+    return std::string(util::SecretDataAsStringView(key_));
+  }
+
+  util::Status VerifyMac(absl::string_view mac,
+                         absl::string_view data) const override {
+    return util::OkStatus();
+  }
+
+ private:
+  util::SecretData key_;
+};
+
+TEST_F(PrimitiveSetTest, MemoryStats) {
+  auto pset_or =
+      PrimitiveSet<Mac>::Builder()
+          .AddPrimaryPrimitive(absl::make_unique<SecretMac>(32),
+                               CreateKey(0x01010101, OutputPrefixType::TINK,
+                                         KeyStatusType::ENABLED))
+          .AddPrimitive(absl::make_unique<SecretMac>(64),
+                        CreateKey(0x02020202, OutputPrefixType::TINK,
+                                  KeyStatusType::ENABLED))
+          .AddLazyPrimitive(
+              []() -> util::StatusOr<std::unique_ptr<Mac>> {
+                return {absl::make_unique<SecretMac>(16)};
+              },
+              CreateKey(0x03030303, OutputPrefixType::RAW,
+                        KeyStatusType::ENABLED))
+          .Build();
+  ASSERT_THAT(pset_or.status(), IsOk());
+  const PrimitiveSet<Mac>& pset = *pset_or.ValueOrDie();
+  std::map<uint32_t, const PrimitiveSet<Mac>::Entry<Mac>*> entries;
+  for (const auto* entry : pset.get_all()) {
+    entries[entry->get_key_id()] = entry;
+  }
+  ASSERT_EQ(3, entries.size());
+  EXPECT_THAT(entries[0x01010101]->get_secret_data_bytes(), Eq(32));
+  EXPECT_THAT(entries[0x02020202]->get_secret_data_bytes(), Eq(64));
+  EXPECT_THAT(entries[0x03030303]->get_secret_data_bytes(), Eq(0));
+
+  MemoryStats stats = pset.GetMemoryStats("mac", /* wrapper_bytes = */ 10);
+  EXPECT_THAT(stats.keyset_bytes, Eq(0));
+  EXPECT_THAT(stats.primitive_set_bytes, Eq(pset.GetMemoryUsage() + 10));
+  EXPECT_THAT(stats.primitive_secret_bytes, Eq(96));
+  EXPECT_THAT(stats.bytes_by_primitive["mac"], Eq(stats.total_bytes()));
+
+  // A lazy entry counts once its primitive is created.
+  ASSERT_THAT(entries[0x03030303]->get_primitive_or_status().status(), IsOk());
+  EXPECT_THAT(entries[0x03030303]->get_secret_data_bytes(), Eq(16));
+  EXPECT_THAT(pset.GetMemoryStats("mac").primitive_secret_bytes, Eq(112));
+}
+
+TEST_F(PrimitiveSetTest, MemoryStatsAddUp) {
+  MemoryStats stats;
+  stats.keyset_bytes = 1;
+  stats.primitive_set_bytes = 2;
+  stats.bytes_by_primitive["aead"] = 2;
+  MemoryStats other;
+  other.primitive_secret_bytes = 4;
+  other.bytes_by_primitive["aead"] = 3;
+  other.bytes_by_primitive["mac"] = 1;
+  stats += other;
+  EXPECT_THAT(stats.total_bytes(), Eq(7));
+  EXPECT_THAT(stats.bytes_by_primitive["aead"], Eq(5));
+  EXPECT_THAT(stats.bytes_by_primitive["mac"], Eq(1));
+}
+
+TEST_F(PrimitiveSetTest, MemoryStatsOfUnwrappedPrimitive) {
+  DummyMac mac("dummy MAC");
+  EXPECT_THAT(GetMemoryStats<Mac>(mac).status(),
+              StatusIs(util::error::UNIMPLEMENTED));
+}
+
+TEST_F(PrimitiveSetTest, LazyPrimitive) {
+  int created = 0;
+  auto pset_or =
+      PrimitiveSet<Mac>::Builder()
+          .AddPrimaryPrimitive(absl::make_unique<DummyMac>("MAC1"),
+                               CreateKey(0x01010101, OutputPrefixType::TINK,
+                                         KeyStatusType::ENABLED))
+          .AddLazyPrimitive(
+              [&created]() -> util::StatusOr<std::unique_ptr<Mac>> {
+                created++;
+                return {absl::make_unique<DummyMac>("MAC2")};
+              },
+              CreateKey(0x02020202, OutputPrefixType::TINK,
+                        KeyStatusType::ENABLED))
+          .Build();
+  ASSERT_THAT(pset_or.status(), IsOk());
+  EXPECT_EQ(0, created);
+  auto entries = pset_or.ValueOrDie()->get_all();
+  ASSERT_EQ(2, entries.size());
+  for (const auto* entry : entries) {
+    EXPECT_EQ(entry->get_key_id() == 0x02020202, entry->is_lazy());
+  }
+  EXPECT_EQ(0, created);
+
+  auto primitives_or = pset_or.ValueOrDie()->get_primitives(
+      CryptoFormat::GetOutputPrefix(CreateKey(0x02020202,
+                                              OutputPrefixType::TINK,
+                                              KeyStatusType::ENABLED))
+          .ValueOrDie());
+  ASSERT_THAT(primitives_or.status(), IsOk());
+  const auto& entry = *(*primitives_or.ValueOrDie())[0];
+  for (int i = 0; i < 2; i++) {
+    auto mac_or = entry.get_primitive_or_status();
+    ASSERT_THAT(mac_or.status(), IsOk());
+    EXPECT_EQ("13:0:DummyMac:MAC2",
+              mac_or.ValueOrDie()->ComputeMac("").ValueOrDie());
+    EXPECT_EQ("13:0:DummyMac:MAC2",
+              entry.get_primitive().ComputeMac("").ValueOrDie());
+  }
+  EXPECT_EQ(1, created);
+}
+
+TEST_F(PrimitiveSetTest, LazyPrimitiveError) {
+  int created = 0;
+  auto pset_or =
+      PrimitiveSet<Mac>::Builder()
+          .AddPrimaryPrimitive(absl::make_unique<DummyMac>("MAC1"),
+                               CreateKey(0x01010101, OutputPrefixType::TINK,
+                                         KeyStatusType::ENABLED))
+          .AddLazyPrimitive(
+              [&created]() -> util::StatusOr<std::unique_ptr<Mac>> {
+                created++;
+                return util::Status(util::error::INVALID_ARGUMENT,
+                                    "invalid key");
+              },
+              CreateKey(0x02020202, OutputPrefixType::RAW,
+                        KeyStatusType::ENABLED))
+          .Build();
+  ASSERT_THAT(pset_or.status(), IsOk());
+  auto primitives_or = pset_or.ValueOrDie()->get_raw_primitives();
+  ASSERT_THAT(primitives_or.status(), IsOk());
+  const auto& entry = *(*primitives_or.ValueOrDie())[0];
+  // The error is kept, and the factory is not called again.
+  for (int i = 0; i < 2; i++) {
+    auto mac_or = entry.get_primitive_or_status();
+    EXPECT_EQ(util::error::INVALID_ARGUMENT, mac_or.status().error_code());
+    EXPECT_THAT(mac_or.status().error_message(),
+                testing::HasSubstr("invalid key"));
+  }
+  EXPECT_EQ(1, created);
+}
+
+TEST_F(PrimitiveSetTest, ResolvePrimary) {
+  PrimitiveSet<Mac> empty_set;
+  EXPECT_EQ(util::error::INVALID_ARGUMENT,
+            empty_set.ResolvePrimary().status().error_code());
+
+  KeysetInfo::KeyInfo key_info =
+      CreateKey(0x01020304, OutputPrefixType::LEGACY, KeyStatusType::ENABLED);
+  auto pset_or = PrimitiveSet<Mac>::Builder()
+                     .AddPrimaryPrimitive(absl::make_unique<DummyMac>("MAC1"),
+                                          key_info)
+                     .AddPrimitive(absl::make_unique<DummyMac>("MAC2"),
+                                   CreateKey(0x05060708, OutputPrefixType::RAW,
+                                             KeyStatusType::ENABLED))
+                     .Build();
+  ASSERT_THAT(pset_or.status(), IsOk());
+  const PrimitiveSet<Mac>& pset = *pset_or.ValueOrDie();
+  auto primary_or = pset.ResolvePrimary();
+  ASSERT_THAT(primary_or.status(), IsOk());
+  const PrimitiveSet<Mac>::ResolvedPrimary& primary = primary_or.ValueOrDie();
+  EXPECT_EQ(&pset.get_primary()->get_primitive(), primary.primitive);
+  EXPECT_EQ(CryptoFormat::GetOutputPrefix(key_info).ValueOrDie(),
+            primary.output_prefix.view());
+  EXPECT_EQ(0x01020304, primary.key_id);
+  EXPECT_EQ(OutputPrefixType::LEGACY, primary.output_prefix_type);
+}
+
+TEST_F(PrimitiveSetTest, LazyPrimitiveRejectsInvalidKeys) {
+  PrimitiveSet<Mac>::PrimitiveFactory factory = []() {
+    return util::StatusOr<std::unique_ptr<Mac>>(
+        absl::make_unique<DummyMac>("MAC"));
+  };
+  EXPECT_EQ(util::error::INVALID_ARGUMENT,
+            PrimitiveSet<Mac>::Builder()
+                .AddLazyPrimitive(factory,
+                                  CreateKey(0x01010101, OutputPrefixType::TINK,
+                                            KeyStatusType::DISABLED))
+                .Build()
+                .status()
+                .error_code());
+  EXPECT_EQ(util::error::INVALID_ARGUMENT,
+            PrimitiveSet<Mac>::Builder()
+                .AddLazyPrimitive(nullptr,
+                                  CreateKey(0x01010101, OutputPrefixType::TINK,
+                                            KeyStatusType::ENABLED))
+                .Build()
+                .status()
+                .error_code());
+}
+
+TEST_F(PrimitiveSetTest, LazyPrimitiveConcurrentAccess) {
+  std::atomic<int> created(0);
+  auto pset_or =
+      PrimitiveSet<Mac>::Builder()
+          .AddLazyPrimitive(
+              [&created]() -> util::StatusOr<std::unique_ptr<Mac>> {
+                created++;
+                return {absl::make_unique<DummyMac>("MAC")};
+              },
+              CreateKey(0x01010101, OutputPrefixType::RAW,
+                        KeyStatusType::ENABLED))
+          .Build();
+  ASSERT_THAT(pset_or.status(), IsOk());
+  PrimitiveSet<Mac>* pset = pset_or.ValueOrDie().get();
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back([pset]() {
+      for (int j = 0; j < 100; j++) {
+        const auto& entry = *(*pset->get_raw_primitives().ValueOrDie())[0];
+        EXPECT_THAT(entry.get_primitive_or_status().status(), IsOk());
+      }
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+  EXPECT_EQ(1, created);
+}
+
 }  // namespace
 }  // namespace tink
 }  // namespace crypto
@@ -0,0 +1,171 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/primitive_warmup.h"
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "tink/subtle/random.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+
+using ::crypto::tink::util::Status;
+using ::crypto::tink::util::StatusOr;
+
+namespace {
+
+// A made-up signature or ciphertext, long enough to get past the length
+// checks of most primitives.
+constexpr int kDummyInputSize = 256;
+
+// The state shared by the tasks of PrimitiveWarmup::RunAll().
+struct WarmupJob {
+  explicit WarmupJob(const std::vector<std::function<Status()>>& tasks)
+      : tasks(tasks), statuses(tasks.size()) {}
+
+  // Takes the next task to run into '*task_nr', and returns false if there
+  // is none left, or a task failed already.
+  bool NextTask(size_t* task_nr) ABSL_LOCKS_EXCLUDED(mutex) {
+    absl::MutexLock lock(&mutex);
+    if (failed || next_task >= tasks.size()) return false;
+    *task_nr = next_task++;
+    return true;
+  }
+
+  // Runs tasks until none are left.
+  void Run() ABSL_LOCKS_EXCLUDED(mutex) {
+    size_t task_nr;
+    while (NextTask(&task_nr)) {
+      // Each task has its own status, so these need no lock.
+      statuses[task_nr] = tasks[task_nr]();
+      if (statuses[task_nr].ok()) continue;
+      absl::MutexLock lock(&mutex);
+      failed = true;
+    }
+    absl::MutexLock lock(&mutex);
+    running_tasks--;
+  }
+
+  // Only used while RunAll() waits for the tasks.
+  const std::vector<std::function<Status()>>& tasks;
+  std::vector<Status> statuses;
+
+  absl::Mutex mutex;
+  size_t next_task ABSL_GUARDED_BY(mutex) = 0;
+  bool failed ABSL_GUARDED_BY(mutex) = false;
+  int running_tasks ABSL_GUARDED_BY(mutex) = 0;
+};
+
+}  // namespace
+
+// static
+Status PrimitiveWarmup::RunAll(
+    const std::vector<std::function<Status()>>& tasks,
+    const Options& options) {
+  if (options.max_keys_in_flight <= 0) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "max_keys_in_flight must be positive");
+  }
+  // Seeds the random number generator of the process, which every
+  // primitive generating nonces or keys uses.
+  subtle::Random::GetRandomBytes(1);
+
+  // Shared with the tasks, so that it outlives the last of them.
+  auto job = std::make_shared<WarmupJob>(tasks);
+  int num_tasks = 1;
+  if (options.schedule) {
+    num_tasks = static_cast<int>(std::min<size_t>(
+        options.max_keys_in_flight, std::max<size_t>(1, tasks.size())));
+  }
+  {
+    absl::MutexLock lock(&job->mutex);
+    job->running_tasks = num_tasks;
+  }
+  for (int i = 1; i < num_tasks; i++) {
+    options.schedule([job]() { job->Run(); });
+  }
+  job->Run();
+
+  absl::MutexLock lock(&job->mutex);
+  job->mutex.Await(absl::Condition(
+      +[](int* count) { return *count == 0; }, &job->running_tasks));
+  for (const Status& status : job->statuses) {
+    if (!status.ok()) return status;
+  }
+  return util::OkStatus();
+}
+
+// static
+Status PrimitiveWarmup::Warmup(const Aead& aead) {
+  StatusOr<std::string> ciphertext_result = aead.Encrypt("", "");
+  if (!ciphertext_result.ok()) return ciphertext_result.status();
+  return aead.Decrypt(ciphertext_result.ValueOrDie(), "").status();
+}
+
+// static
+Status PrimitiveWarmup::Warmup(const DeterministicAead& daead) {
+  StatusOr<std::string> ciphertext_result =
+      daead.EncryptDeterministically("", "");
+  if (!ciphertext_result.ok()) return ciphertext_result.status();
+  return daead.DecryptDeterministically(ciphertext_result.ValueOrDie(), "")
+      .status();
+}
+
+// static
+Status PrimitiveWarmup::Warmup(const Mac& mac) {
+  StatusOr<std::string> mac_result = mac.ComputeMac("");
+  if (!mac_result.ok()) return mac_result.status();
+  return mac.VerifyMac(mac_result.ValueOrDie(), "");
+}
+
+// static
+Status PrimitiveWarmup::Warmup(const PublicKeySign& signer) {
+  return signer.Sign("").status();
+}
+
+// static
+Status PrimitiveWarmup::Warmup(const PublicKeyVerify& verifier) {
+  // The signature is invalid, so the error is expected.
+  verifier.Verify(std::string(kDummyInputSize, '\0'), "").IgnoreError();
+  return util::OkStatus();
+}
+
+// static
+Status PrimitiveWarmup::Warmup(const HybridEncrypt& encrypter) {
+  return encrypter.Encrypt("", "").status();
+}
+
+// static
+Status PrimitiveWarmup::Warmup(const HybridDecrypt& decrypter) {
+  // The ciphertext is invalid, so the error is expected.
+  decrypter.Decrypt(std::string(kDummyInputSize, '\0'), "")
+      .status()
+      .IgnoreError();
+  return util::OkStatus();
+}
+
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,295 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/primitive_warmup.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "tink/aead.h"
+#include "tink/aead/aead_wrapper.h"
+#include "tink/core/key_type_manager.h"
+#include "tink/primitive_set.h"
+#include "tink/public_key_verify.h"
+#include "tink/registry.h"
+#include "tink/subtle/test_util.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "tink/util/test_keyset_handle.h"
+#include "tink/util/test_matchers.h"
+#include "tink/util/test_util.h"
+#include "proto/aes_gcm.pb.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace {
+
+using ::crypto::tink::test::DummyAead;
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::google::crypto::tink::AesGcmKey;
+using ::google::crypto::tink::AesGcmKeyFormat;
+using ::google::crypto::tink::KeyData;
+using ::google::crypto::tink::Keyset;
+using ::google::crypto::tink::KeysetInfo;
+using ::google::crypto::tink::KeyStatusType;
+using ::google::crypto::tink::OutputPrefixType;
+using ::testing::Eq;
+using ::testing::HasSubstr;
+
+// Counts its encryptions, and fails them if 'fail' is set.
+class CountingAead : public Aead {
+ public:
+  CountingAead(absl::string_view name, std::atomic<int>* encryptions,
+               bool fail = false)
+      : aead_(name), encryptions_(encryptions), fail_(fail) {}
+
+  util::StatusOr<std::string> Encrypt(
+      absl::string_view plaintext,
+      absl::string_view associated_data) const override {
+    (*encryptions_)++;
+    if (fail_) return util::Status(util::error::INTERNAL, "broken key");
+    return aead_.Encrypt(plaintext, associated_data);
+  }
+
+  util::StatusOr<std::string> Decrypt(
+      absl::string_view ciphertext,
+      absl::string_view associated_data) const override {
+    return aead_.Decrypt(ciphertext, associated_data);
+  }
+
+ private:
+  DummyAead aead_;
+  std::atomic<int>* encryptions_;
+  bool fail_;
+};
+
+KeysetInfo::KeyInfo NewKeyInfo(uint32_t key_id) {
+  KeysetInfo::KeyInfo key_info;
+  key_info.set_output_prefix_type(OutputPrefixType::TINK);
+  key_info.set_key_id(key_id);
+  key_info.set_status(KeyStatusType::ENABLED);
+  return key_info;
+}
+
+TEST(PrimitiveWarmupTest, WarmsUpEveryPrimitive) {
+  std::atomic<int> encryptions[4];
+  for (auto& count : encryptions) count = 0;
+  int lazy_creations = 0;
+  PrimitiveSet<Aead>::Builder builder;
+  builder.AddPrimaryPrimitive(
+      absl::make_unique<CountingAead>("0", &encryptions[0]), NewKeyInfo(10));
+  for (int i = 1; i < 3; i++) {
+    builder.AddPrimitive(
+        absl::make_unique<CountingAead>(absl::StrCat(i), &encryptions[i]),
+        NewKeyInfo(10 + i));
+  }
+  builder.AddLazyPrimitive(
+      [&]() -> util::StatusOr<std::unique_ptr<Aead>> {
+        lazy_creations++;
+        return {absl::make_unique<CountingAead>("3", &encryptions[3])};
+      },
+      NewKeyInfo(13));
+  auto primitive_set_result = builder.Build();
+  ASSERT_THAT(primitive_set_result.status(), IsOk());
+
+  EXPECT_THAT(PrimitiveWarmup::WarmupPrimitiveSet(
+                  *primitive_set_result.ValueOrDie(),
+                  PrimitiveWarmup::Options()),
+              IsOk());
+  for (auto& count : encryptions) EXPECT_THAT(count.load(), Eq(1));
+  EXPECT_THAT(lazy_creations, Eq(1));
+}
+
+TEST(PrimitiveWarmupTest, WarmsUpConcurrently) {
+  const int kNumKeys = 50;
+  std::atomic<int> encryptions{0};
+  PrimitiveSet<Aead>::Builder builder;
+  builder.AddPrimaryPrimitive(
+      absl::make_unique<CountingAead>("0", &encryptions), NewKeyInfo(0));
+  for (int i = 1; i < kNumKeys; i++) {
+    builder.AddPrimitive(
+        absl::make_unique<CountingAead>(absl::StrCat(i), &encryptions),
+        NewKeyInfo(i));
+  }
+  auto primitive_set_result = builder.Build();
+  ASSERT_THAT(primitive_set_result.status(), IsOk());
+
+  subtle::test::TestThreadPool pool(4);
+  PrimitiveWarmup::Options options;
+  options.schedule = [&pool](std::function<void()> task) {
+    pool.Schedule(std::move(task));
+  };
+  options.max_keys_in_flight = 4;
+  EXPECT_THAT(PrimitiveWarmup::WarmupPrimitiveSet(
+                  *primitive_set_result.ValueOrDie(), options),
+              IsOk());
+  EXPECT_THAT(encryptions.load(), Eq(kNumKeys));
+}
+
+TEST(PrimitiveWarmupTest, ReportsFailingKey) {
+  std::atomic<int> encryptions{0};
+  PrimitiveSet<Aead>::Builder builder;
+  builder.AddPrimaryPrimitive(
+      absl::make_unique<CountingAead>("0", &encryptions), NewKeyInfo(1));
+  builder.AddPrimitive(absl::make_unique<CountingAead>("1", &encryptions,
+                                                       /*fail=*/true),
+                       NewKeyInfo(2));
+  auto primitive_set_result = builder.Build();
+  ASSERT_THAT(primitive_set_result.status(), IsOk());
+
+  util::Status status = PrimitiveWarmup::WarmupPrimitiveSet(
+      *primitive_set_result.ValueOrDie(), PrimitiveWarmup::Options());
+  EXPECT_THAT(status, StatusIs(util::error::INTERNAL));
+  EXPECT_THAT(status.error_message(), HasSubstr("key 2"));
+}
+
+TEST(PrimitiveWarmupTest, ReportsFailingLazyPrimitive) {
+  std::atomic<int> encryptions{0};
+  PrimitiveSet<Aead>::Builder builder;
+  builder.AddPrimaryPrimitive(
+      absl::make_unique<CountingAead>("0", &encryptions), NewKeyInfo(1));
+  builder.AddLazyPrimitive(
+      []() -> util::StatusOr<std::unique_ptr<Aead>> {
+        return util::Status(util::error::INVALID_ARGUMENT, "invalid key");
+      },
+      NewKeyInfo(2));
+  auto primitive_set_result = builder.Build();
+  ASSERT_THAT(primitive_set_result.status(), IsOk());
+
+  EXPECT_THAT(PrimitiveWarmup::WarmupPrimitiveSet(
+                  *primitive_set_result.ValueOrDie(),
+                  PrimitiveWarmup::Options()),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(PrimitiveWarmupTest, RejectsInvalidOptions) {
+  PrimitiveSet<Aead>::Builder builder;
+  std::atomic<int> encryptions{0};
+  builder.AddPrimaryPrimitive(
+      absl::make_unique<CountingAead>("0", &encryptions), NewKeyInfo(1));
+  auto primitive_set_result = builder.Build();
+  ASSERT_THAT(primitive_set_result.status(), IsOk());
+  PrimitiveWarmup::Options options;
+  options.max_keys_in_flight = 0;
+  EXPECT_THAT(PrimitiveWarmup::WarmupPrimitiveSet(
+                  *primitive_set_result.ValueOrDie(), options),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+class FailingVerify : public PublicKeyVerify {
+ public:
+  util::Status Verify(absl::string_view signature,
+                      absl::string_view data) const override {
+    return util::Status(util::error::INVALID_ARGUMENT, "invalid signature");
+  }
+};
+
+TEST(PrimitiveWarmupTest, IgnoresRejectedMadeUpSignature) {
+  EXPECT_THAT(PrimitiveWarmup::Warmup(FailingVerify()), IsOk());
+}
+
+// The number of encryptions of all primitives created by CountingKeyManager.
+std::atomic<int> key_manager_encryptions{0};
+
+class CountingKeyManager
+    : public KeyTypeManager<AesGcmKey, AesGcmKeyFormat, List<Aead>> {
+ public:
+  class AeadFactory : public PrimitiveFactory<Aead> {
+   public:
+    util::StatusOr<std::unique_ptr<Aead>> Create(
+        const AesGcmKey& key) const override {
+      return {absl::make_unique<CountingAead>(key.key_value(),
+                                              &key_manager_encryptions)};
+    }
+  };
+
+  CountingKeyManager() : KeyTypeManager(absl::make_unique<AeadFactory>()) {}
+
+  KeyData::KeyMaterialType key_material_type() const override {
+    return KeyData::SYMMETRIC;
+  }
+  uint32_t get_version() const override { return 0; }
+  const std::string& get_key_type() const override { return key_type_; }
+  util::Status ValidateKey(const AesGcmKey& key) const override {
+    return util::OkStatus();
+  }
+  util::Status ValidateKeyFormat(
+      const AesGcmKeyFormat& key_format) const override {
+    return util::OkStatus();
+  }
+  util::StatusOr<AesGcmKey> CreateKey(
+      const AesGcmKeyFormat& key_format) const override {
+    return util::Status(util::error::UNIMPLEMENTED, "not needed");
+  }
+
+ private:
+  const std::string key_type_ =
+      "type.googleapis.com/google.crypto.tink.AesGcmKey";
+};
+
+TEST(PrimitiveWarmupTest, GetPrimitiveWarmsUpEveryKey) {
+  Registry::Reset();
+  ASSERT_THAT(Registry::RegisterKeyTypeManager(
+                  absl::make_unique<CountingKeyManager>(), true),
+              IsOk());
+  ASSERT_THAT(
+      Registry::RegisterPrimitiveWrapper(absl::make_unique<AeadWrapper>()),
+      IsOk());
+  Keyset keyset;
+  for (uint32_t key_id = 1; key_id <= 3; key_id++) {
+    AesGcmKey key;
+    key.set_key_value(absl::StrCat("key ", key_id));
+    Keyset::Key* keyset_key = keyset.add_key();
+    keyset_key->set_key_id(key_id);
+    keyset_key->set_status(KeyStatusType::ENABLED);
+    keyset_key->set_output_prefix_type(OutputPrefixType::TINK);
+    keyset_key->mutable_key_data()->set_type_url(
+        CountingKeyManager().get_key_type());
+    keyset_key->mutable_key_data()->set_value(key.SerializeAsString());
+    keyset_key->mutable_key_data()->set_key_material_type(
+        KeyData::SYMMETRIC);
+  }
+  keyset.set_primary_key_id(3);
+  auto handle = TestKeysetHandle::GetKeysetHandle(keyset);
+
+  key_manager_encryptions = 0;
+  auto aead_result = PrimitiveWarmup::GetPrimitive<Aead>(
+      *handle, PrimitiveWarmup::Options());
+  ASSERT_THAT(aead_result.status(), IsOk());
+  EXPECT_THAT(key_manager_encryptions.load(), Eq(3));
+
+  auto ciphertext_result = aead_result.ValueOrDie()->Encrypt("data", "ad");
+  ASSERT_THAT(ciphertext_result.status(), IsOk());
+  auto plaintext_result =
+      aead_result.ValueOrDie()->Decrypt(ciphertext_result.ValueOrDie(), "ad");
+  ASSERT_THAT(plaintext_result.status(), IsOk());
+  EXPECT_THAT(plaintext_result.ValueOrDie(), Eq("data"));
+  Registry::Reset();
+}
+
+}  // namespace
+}  // namespace tink
+}  // namespace crypto
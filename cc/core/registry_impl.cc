@@ -27,8 +27,24 @@ namespace crypto {
 namespace tink {
 
 StatusOr<const RegistryImpl::KeyTypeInfo*> RegistryImpl::get_key_type_info(
-    const std::string& type_url) const {
-  absl::MutexLock lock(&maps_mutex_);
+    absl::string_view type_url) const {
+  std::shared_ptr<LazyRegistration> lazy_registration;
+  {
+    absl::ReaderMutexLock lock(&maps_mutex_);
+    auto it = type_url_to_info_.find(type_url);
+    if (it != type_url_to_info_.end()) return &it->second;
+    auto lazy_it = lazy_key_types_.find(type_url);
+    if (lazy_it == lazy_key_types_.end()) {
+      return ToStatusF(util::error::NOT_FOUND,
+                       "No manager for type '%s' has been registered.",
+                       type_url);
+    }
+    lazy_registration = lazy_it->second.registration;
+  }
+  // Registration takes maps_mutex_ exclusively.
+  util::Status status = lazy_registration->Register();
+  if (!status.ok()) return status;
+  absl::ReaderMutexLock lock(&maps_mutex_);
   auto it = type_url_to_info_.find(type_url);
   if (it == type_url_to_info_.end()) {
     return ToStatusF(util::error::NOT_FOUND,
@@ -37,7 +53,21 @@ StatusOr<const RegistryImpl::KeyTypeInfo*> RegistryImpl::get_key_type_info(
   return &it->second;
 }
 
-StatusOr<std::unique_ptr<KeyData>> RegistryImpl::NewKeyData(
+StatusOr<RegistryImpl::KeyTypeHandle> RegistryImpl::GetKeyTypeHandle(
+    absl::string_view type_url) const {
+  auto key_type_info_or = get_key_type_info(type_url);
+  if (!key_type_info_or.ok()) return key_type_info_or.status();
+  absl::ReaderMutexLock lock(&maps_mutex_);
+  auto it = type_url_to_info_.find(type_url);
+  if (it == type_url_to_info_.end()) {
+    return ToStatusF(util::error::NOT_FOUND,
+                     "No manager for type '%s' has been registered.", type_url);
+  }
+  return KeyTypeHandle(&it->first, &it->second);
+}
+
+StatusOr<const RegistryImpl::KeyTypeInfo*>
+RegistryImpl::get_key_type_info_for_new_key(
     const KeyTemplate& key_template) const {
   auto key_type_info_or = get_key_type_info(key_template.type_url());
   if (!key_type_info_or.ok()) return key_type_info_or.status();
@@ -47,12 +77,44 @@ StatusOr<std::unique_ptr<KeyData>> RegistryImpl::NewKeyData(
         absl::StrCat("KeyManager for type ", key_template.type_url(),
                      " does not allow for creation of new keys."));
   }
+  return key_type_info_or;
+}
+
+StatusOr<std::unique_ptr<KeyData>> RegistryImpl::NewKeyData(
+    const KeyTemplate& key_template) const {
+  auto key_type_info_or = get_key_type_info_for_new_key(key_template);
+  if (!key_type_info_or.ok()) return key_type_info_or.status();
+  KeyDataSource source;
+  {
+    absl::MutexLock lock(&key_data_source_mutex_);
+    source = key_data_source_;
+  }
+  if (source != nullptr) {
+    std::unique_ptr<KeyData> key_data = source(key_template);
+    if (key_data != nullptr) return std::move(key_data);
+  }
   return key_type_info_or.ValueOrDie()->key_factory().NewKeyData(
       key_template.value());
 }
 
+StatusOr<std::unique_ptr<KeyData>> RegistryImpl::GenerateKeyData(
+    const KeyTemplate& key_template) const {
+  auto key_type_info_or = get_key_type_info_for_new_key(key_template);
+  if (!key_type_info_or.ok()) return key_type_info_or.status();
+  return key_type_info_or.ValueOrDie()->key_factory().NewKeyData(
+      key_template.value());
+}
+
+void RegistryImpl::SetKeyDataSource(KeyDataSource source) {
+  {
+    absl::MutexLock lock(&key_data_source_mutex_);
+    std::swap(key_data_source_, source);
+  }
+  // The previous source is destroyed here, without holding the lock.
+}
+
 StatusOr<std::unique_ptr<KeyData>> RegistryImpl::GetPublicKeyData(
-    const std::string& type_url,
+    absl::string_view type_url,
     const std::string& serialized_private_key) const {
   auto key_type_info_or = get_key_type_info(type_url);
   if (!key_type_info_or.ok()) return key_type_info_or.status();
@@ -69,19 +131,29 @@ StatusOr<std::unique_ptr<KeyData>> RegistryImpl::GetPublicKeyData(
 }
 
 crypto::tink::util::Status RegistryImpl::CheckInsertable(
-    const std::string& type_url, const std::type_index& key_manager_type_index,
+    absl::string_view type_url, const std::type_index& key_manager_type_index,
     bool new_key_allowed) const {
+  absl::optional<std::type_index> registered_type_index;
+  bool registered_new_key_allowed = false;
   auto it = type_url_to_info_.find(type_url);
-
-  if (it == type_url_to_info_.end()) {
-    return crypto::tink::util::Status::OK;
+  if (it != type_url_to_info_.end()) {
+    registered_type_index = it->second.key_manager_type_index();
+    registered_new_key_allowed = it->second.new_key_allowed();
+  } else {
+    auto lazy_it = lazy_key_types_.find(type_url);
+    if (lazy_it == lazy_key_types_.end()) {
+      return crypto::tink::util::Status::OK;
+    }
+    registered_type_index = lazy_it->second.key_manager_type_index;
+    registered_new_key_allowed =
+        lazy_it->second.registration->new_key_allowed();
   }
-  if (it->second.key_manager_type_index() != key_manager_type_index) {
+  if (*registered_type_index != key_manager_type_index) {
     return ToStatusF(crypto::tink::util::error::ALREADY_EXISTS,
                      "A manager for type '%s' has been already registered.",
                      type_url);
   }
-  if (!it->second.new_key_allowed() && new_key_allowed) {
+  if (!registered_new_key_allowed && new_key_allowed) {
     return ToStatusF(crypto::tink::util::error::ALREADY_EXISTS,
                      "A manager for type '%s' has been already registered "
                      "with forbidden new key operation.",
@@ -90,24 +162,65 @@ crypto::tink::util::Status RegistryImpl::CheckInsertable(
   return crypto::tink::util::Status::OK;
 }
 
+crypto::tink::util::Status RegistryImpl::RegisterLazily(
+    const std::vector<std::pair<std::string, std::type_index>>& key_types,
+    std::function<crypto::tink::util::Status(bool new_key_allowed)>
+        register_key_types,
+    bool new_key_allowed) {
+  {
+    absl::MutexLock lock(&maps_mutex_);
+    bool registered = false;
+    for (const auto& key_type : key_types) {
+      crypto::tink::util::Status status =
+          CheckInsertable(key_type.first, key_type.second, new_key_allowed);
+      if (!status.ok()) return status;
+      registered = registered || type_url_to_info_.contains(key_type.first);
+    }
+    if (!registered) {
+      auto registration = std::make_shared<LazyRegistration>(
+          std::move(register_key_types), new_key_allowed);
+      for (const auto& key_type : key_types) {
+        auto it = lazy_key_types_.find(key_type.first);
+        if (it != lazy_key_types_.end()) {
+          it->second.registration->set_new_key_allowed(new_key_allowed);
+        } else {
+          lazy_key_types_.emplace(
+              std::piecewise_construct, std::forward_as_tuple(key_type.first),
+              std::forward_as_tuple(key_type.second, registration));
+        }
+      }
+      return crypto::tink::util::Status::OK;
+    }
+  }
+  // Updates the registered key types as an eager registration would.
+  return register_key_types(new_key_allowed);
+}
+
 crypto::tink::util::StatusOr<google::crypto::tink::KeyData>
 RegistryImpl::DeriveKey(const google::crypto::tink::KeyTemplate& key_template,
                         InputStream* randomness) const {
-  auto key_type_info_or = get_key_type_info(key_template.type_url());
+  auto key_deriver_or = GetKeyDeriver(key_template.type_url());
+  if (!key_deriver_or.ok()) return key_deriver_or.status();
+  return (*key_deriver_or.ValueOrDie())(key_template.value(), randomness);
+}
+
+crypto::tink::util::StatusOr<const RegistryImpl::KeyDeriver*>
+RegistryImpl::GetKeyDeriver(absl::string_view type_url) const {
+  auto key_type_info_or = get_key_type_info(type_url);
   if (!key_type_info_or.ok()) return key_type_info_or.status();
   if (!key_type_info_or.ValueOrDie()->key_deriver()) {
     return crypto::tink::util::Status(
         crypto::tink::util::error::INVALID_ARGUMENT,
-        absl::StrCat("Manager for type '", key_template.type_url(),
-                     "' cannot derive keys."));
+        absl::StrCat("Manager for type '", type_url, "' cannot derive keys."));
   }
-  return key_type_info_or.ValueOrDie()->key_deriver()(key_template.value(),
-                                                      randomness);
+  return &key_type_info_or.ValueOrDie()->key_deriver();
 }
 
 void RegistryImpl::Reset() {
+  SetKeyDataSource(nullptr);
   absl::MutexLock lock(&maps_mutex_);
   type_url_to_info_.clear();
+  lazy_key_types_.clear();
   name_to_catalogue_map_.clear();
   primitive_to_wrapper_.clear();
 }
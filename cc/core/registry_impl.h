@@ -17,16 +17,24 @@
 #define TINK_CORE_REGISTRY_IMPL_H_
 
 #include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
 #include <tuple>
 #include <typeindex>
 #include <typeinfo>
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
+#include "absl/base/call_once.h"
 #include "absl/base/thread_annotations.h"
+#include "absl/container/node_hash_map.h"
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
+#include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
 #include "absl/types/optional.h"
 #include "tink/catalogue.h"
@@ -36,9 +44,11 @@
 #include "tink/core/private_key_type_manager.h"
 #include "tink/internal/keyset_wrapper.h"
 #include "tink/internal/keyset_wrapper_impl.h"
+#include "tink/internal/tracing_span.h"
 #include "tink/key_manager.h"
 #include "tink/primitive_set.h"
 #include "tink/primitive_wrapper.h"
+#include "tink/util/constants.h"
 #include "tink/util/errors.h"
 #include "tink/util/protobuf_helper.h"
 #include "tink/util/status.h"
@@ -100,9 +110,42 @@ class RegistryImpl {
           public_key_manager,
       bool new_key_allowed) ABSL_LOCKS_EXCLUDED(maps_mutex_);
 
+  // As RegisterKeyTypeManager() with a default constructed KeyTypeManagerT,
+  // but only records the key type, "type.googleapis.com/" followed by the
+  // type name of KeyTypeManagerT::KeyProto. The manager is constructed and
+  // registered when the key type is first looked up, so that binaries which
+  // use few of the key types of a config do not pay for the others at start.
+  // Registering a conflicting manager for the key type fails as it does for
+  // a registered manager.
+  template <class KeyTypeManagerT>
+  crypto::tink::util::Status RegisterKeyTypeManagerLazily(
+      bool new_key_allowed) ABSL_LOCKS_EXCLUDED(maps_mutex_);
+
+  // As RegisterAsymmetricKeyManagers() with default constructed managers,
+  // which are registered when either key type is first looked up, like
+  // RegisterKeyTypeManagerLazily().
+  template <class PrivateKeyTypeManagerT, class PublicKeyTypeManagerT>
+  crypto::tink::util::Status RegisterAsymmetricKeyManagersLazily(
+      bool new_key_allowed) ABSL_LOCKS_EXCLUDED(maps_mutex_);
+
+  template <class P>
+  crypto::tink::util::StatusOr<const KeyManager<P>*> get_key_manager(
+      absl::string_view type_url) const ABSL_LOCKS_EXCLUDED(maps_mutex_);
+
+  // A registered key type, which callers looking up the same type URL
+  // repeatedly, e.g. for every key of a keyset, can keep instead of the URL.
+  // Lookups with a handle neither hash the URL nor take maps_mutex_. Like the
+  // key managers, a handle stays valid until Reset() is called.
+  class KeyTypeHandle;
+
+  // Returns the handle of the key type 'type_url', or NOT_FOUND if no manager
+  // for it has been registered.
+  crypto::tink::util::StatusOr<KeyTypeHandle> GetKeyTypeHandle(
+      absl::string_view type_url) const ABSL_LOCKS_EXCLUDED(maps_mutex_);
+
   template <class P>
   crypto::tink::util::StatusOr<const KeyManager<P>*> get_key_manager(
-      const std::string& type_url) const ABSL_LOCKS_EXCLUDED(maps_mutex_);
+      const KeyTypeHandle& key_type) const;
 
   // Takes ownership of 'wrapper', which must be non-nullptr.
   template <class P, class Q>
@@ -116,15 +159,42 @@ class RegistryImpl {
 
   template <class P>
   crypto::tink::util::StatusOr<std::unique_ptr<P>> GetPrimitive(
-      const std::string& type_url, const portable_proto::MessageLite& key) const
+      absl::string_view type_url, const portable_proto::MessageLite& key) const
       ABSL_LOCKS_EXCLUDED(maps_mutex_);
 
+  // As GetPrimitive(key_data), for a key of type 'key_type'. Fails with
+  // INVALID_ARGUMENT if 'key_data' has a different type URL.
+  template <class P>
+  crypto::tink::util::StatusOr<std::unique_ptr<P>> GetPrimitive(
+      const KeyTypeHandle& key_type,
+      const google::crypto::tink::KeyData& key_data) const;
+
+  // Returns a new key for 'key_template'. Takes the key from the key data
+  // source if one is set and has a key ready, and generates it otherwise.
   crypto::tink::util::StatusOr<std::unique_ptr<google::crypto::tink::KeyData>>
   NewKeyData(const google::crypto::tink::KeyTemplate& key_template) const
+      ABSL_LOCKS_EXCLUDED(maps_mutex_, key_data_source_mutex_);
+
+  // Like NewKeyData, but always generates the key with the key manager,
+  // without consulting the key data source.
+  crypto::tink::util::StatusOr<std::unique_ptr<google::crypto::tink::KeyData>>
+  GenerateKeyData(const google::crypto::tink::KeyTemplate& key_template) const
       ABSL_LOCKS_EXCLUDED(maps_mutex_);
 
+  // Returns a pre-generated key for a key template, or nullptr if it has none
+  // ready. Must be thread-safe.
+  using KeyDataSource =
+      std::function<std::unique_ptr<google::crypto::tink::KeyData>(
+          const google::crypto::tink::KeyTemplate&)>;
+
+  // Sets the source NewKeyData takes keys from, such as a KeyPool. Keys from
+  // the source are only returned for key types which allow new keys. Passing
+  // nullptr removes the source.
+  void SetKeyDataSource(KeyDataSource source)
+      ABSL_LOCKS_EXCLUDED(key_data_source_mutex_);
+
   crypto::tink::util::StatusOr<std::unique_ptr<google::crypto::tink::KeyData>>
-  GetPublicKeyData(const std::string& type_url,
+  GetPublicKeyData(absl::string_view type_url,
                    const std::string& serialized_private_key) const
       ABSL_LOCKS_EXCLUDED(maps_mutex_);
 
@@ -138,11 +208,28 @@ class RegistryImpl {
       const google::crypto::tink::Keyset& keyset) const
       ABSL_LOCKS_EXCLUDED(maps_mutex_);
 
+  // As WrapKeyset(keyset), but skips the validation of 'keyset', whose result
+  // is 'plan'.
+  template <class P>
+  crypto::tink::util::StatusOr<std::unique_ptr<P>> WrapKeyset(
+      const google::crypto::tink::Keyset& keyset, const KeysetPlan& plan) const
+      ABSL_LOCKS_EXCLUDED(maps_mutex_);
+
   crypto::tink::util::StatusOr<google::crypto::tink::KeyData> DeriveKey(
       const google::crypto::tink::KeyTemplate& key_template,
       InputStream* randomness) const ABSL_LOCKS_EXCLUDED(maps_mutex_);
 
-  void Reset() ABSL_LOCKS_EXCLUDED(maps_mutex_);
+  // Derives a key from a serialized key format and randomness, as DeriveKey.
+  using KeyDeriver = std::function<crypto::tink::util::StatusOr<
+      google::crypto::tink::KeyData>(absl::string_view, InputStream*)>;
+
+  // Returns the key deriver for the key type 'type_url', so that callers
+  // deriving many keys need to look it up only once. Since we never replace
+  // key type infos, the pointer stays valid until Reset() is called.
+  crypto::tink::util::StatusOr<const KeyDeriver*> GetKeyDeriver(
+      absl::string_view type_url) const ABSL_LOCKS_EXCLUDED(maps_mutex_);
+
+  void Reset() ABSL_LOCKS_EXCLUDED(maps_mutex_, key_data_source_mutex_);
 
  private:
   // All information for a given type url.
@@ -263,8 +350,12 @@ class RegistryImpl {
       return public_key_manager_type_index_;
     }
 
-    bool new_key_allowed() const { return new_key_allowed_; }
-    void set_new_key_allowed(bool b) { new_key_allowed_ = b; }
+    bool new_key_allowed() const {
+      return new_key_allowed_.load(std::memory_order_acquire);
+    }
+    void set_new_key_allowed(bool b) {
+      new_key_allowed_.store(b, std::memory_order_release);
+    }
 
     const KeyFactory& key_factory() const { return *key_factory_; }
 
@@ -285,8 +376,10 @@ class RegistryImpl {
 
     // For each primitive, the corresponding names and key_manager.
     std::vector<PerPrimitiveIndex> per_primitive_managers_;
-    // Whether the key manager allows creating new keys.
-    bool new_key_allowed_;
+    // Whether the key manager allows creating new keys. This is the only field
+    // which can change after insertion, and it is read without holding
+    // maps_mutex_ (see NewKeyData), hence atomic.
+    std::atomic<bool> new_key_allowed_;
     // A factory constructed from an internal key manager. Owned version of
     // key_factory if constructed with a KeyTypeManager. This is nullptr if
     // constructed with a KeyManager.
@@ -376,6 +469,54 @@ class RegistryImpl {
     std::shared_ptr<void> keyset_wrapper_;
   };
 
+  // The registration of one or two key types, the private and the public one,
+  // which were registered lazily and are registered on their first lookup.
+  class LazyRegistration {
+   public:
+    LazyRegistration(
+        std::function<crypto::tink::util::Status(bool new_key_allowed)>
+            register_key_types,
+        bool new_key_allowed)
+        : register_key_types_(std::move(register_key_types)),
+          new_key_allowed_(new_key_allowed) {}
+
+    // Registers the key types unless they have been registered already, and
+    // returns the status of the registration.
+    crypto::tink::util::Status Register() {
+      absl::call_once(once_, [this]() {
+        status_ = register_key_types_(
+            new_key_allowed_.load(std::memory_order_acquire));
+      });
+      return status_;
+    }
+
+    bool new_key_allowed() const {
+      return new_key_allowed_.load(std::memory_order_acquire);
+    }
+    void set_new_key_allowed(bool b) {
+      new_key_allowed_.store(b, std::memory_order_release);
+    }
+
+   private:
+    const std::function<crypto::tink::util::Status(bool new_key_allowed)>
+        register_key_types_;
+    std::atomic<bool> new_key_allowed_;
+    absl::once_flag once_;
+    crypto::tink::util::Status status_;
+  };
+
+  // A key type which was registered lazily.
+  struct LazyKeyTypeInfo {
+    LazyKeyTypeInfo(std::type_index key_manager_type_index,
+                    std::shared_ptr<LazyRegistration> registration)
+        : key_manager_type_index(key_manager_type_index),
+          registration(std::move(registration)) {}
+    // std::type_index of the key manager class which will be registered.
+    std::type_index key_manager_type_index;
+    // Shared by the private and the public key type of asymmetric managers.
+    std::shared_ptr<LazyRegistration> registration;
+  };
+
   // All information for a given primitive label.
   struct LabelInfo {
     LabelInfo(std::shared_ptr<void> catalogue, std::type_index type_index,
@@ -400,29 +541,61 @@ class RegistryImpl {
   crypto::tink::util::StatusOr<const KeysetWrapper<P>*> GetKeysetWrapper() const
       ABSL_LOCKS_EXCLUDED(maps_mutex_);
 
-  // Returns the key type info for a given type URL. Since we never replace
-  // key type infos, the pointers will stay valid for the lifetime of the
-  // binary.
+  // Returns the key type info for a given type URL, after registering it if
+  // it was registered lazily. Since we never replace key type infos, the
+  // pointers will stay valid for the lifetime of the binary.
   crypto::tink::util::StatusOr<const KeyTypeInfo*> get_key_type_info(
-      const std::string& type_url) const ABSL_LOCKS_EXCLUDED(maps_mutex_);
+      absl::string_view type_url) const ABSL_LOCKS_EXCLUDED(maps_mutex_);
+
+  // Returns the key type info for the type URL of 'key_template', or an error
+  // if the key type does not allow for creation of new keys.
+  crypto::tink::util::StatusOr<const KeyTypeInfo*>
+  get_key_type_info_for_new_key(
+      const google::crypto::tink::KeyTemplate& key_template) const
+      ABSL_LOCKS_EXCLUDED(maps_mutex_);
 
   // Returns OK if the key manager with the given type index can be inserted
   // for type url type_url and parameter new_key_allowed. Otherwise returns
   // an error to be returned to the user.
   crypto::tink::util::Status CheckInsertable(
-      const std::string& type_url,
+      absl::string_view type_url,
       const std::type_index& key_manager_type_index, bool new_key_allowed) const
       ABSL_SHARED_LOCKS_REQUIRED(maps_mutex_);
 
+  // Records the key types 'key_types', pairs of a type URL and the type index
+  // of its key manager, which 'register_key_types' registers when one of them
+  // is first looked up. Registers them right away if one of them is
+  // registered already.
+  crypto::tink::util::Status RegisterLazily(
+      const std::vector<std::pair<std::string, std::type_index>>& key_types,
+      std::function<crypto::tink::util::Status(bool new_key_allowed)>
+          register_key_types,
+      bool new_key_allowed) ABSL_LOCKS_EXCLUDED(maps_mutex_);
+
+  // Returns the type URL of the keys of type KeyProto.
+  template <class KeyProto>
+  static std::string TypeUrl() {
+    return absl::StrCat(kTypeGoogleapisCom,
+                        KeyProto::default_instance().GetTypeName());
+  }
+
+  // Registration and Reset() take maps_mutex_ exclusively; all lookups only
+  // take a shared (reader) lock, so that concurrent GetPrimitive() and Wrap()
+  // calls do not serialize on the registry.
   mutable absl::Mutex maps_mutex_;
   // A map from the type_url to the given KeyTypeInfo. Once emplaced KeyTypeInfo
   // objects must remain valid throughout the life time of the binary. Hence,
   // one should /never/ replace any element of the KeyTypeInfo. This is because
   // get_key_type_manager() needs to guarantee that the returned
   // key_type_manager remains valid.
-  // NOTE: We require pointer stability of the value, as get_key_type_info
-  // returns a pointer which needs to stay alive.
-  std::unordered_map<std::string, KeyTypeInfo> type_url_to_info_
+  // NOTE: We require pointer stability of the key and the value, as
+  // get_key_type_info and KeyTypeHandle keep pointers to them. The hash is
+  // transparent, so lookups by absl::string_view do not copy the type URL.
+  absl::node_hash_map<std::string, KeyTypeInfo> type_url_to_info_
+      ABSL_GUARDED_BY(maps_mutex_);
+  // The key types which were registered lazily, until Reset(). A key type
+  // stays here after it has been moved to type_url_to_info_.
+  absl::node_hash_map<std::string, LazyKeyTypeInfo> lazy_key_types_
       ABSL_GUARDED_BY(maps_mutex_);
   // A map from the type_id to the corresponding wrapper.
   std::unordered_map<std::type_index, WrapperInfo> primitive_to_wrapper_
@@ -430,6 +603,37 @@ class RegistryImpl {
 
   std::unordered_map<std::string, LabelInfo> name_to_catalogue_map_
       ABSL_GUARDED_BY(maps_mutex_);
+
+  // Separate from maps_mutex_, so that a source which generates keys through
+  // this registry can be destroyed while the source is replaced.
+  mutable absl::Mutex key_data_source_mutex_;
+  KeyDataSource key_data_source_ ABSL_GUARDED_BY(key_data_source_mutex_);
+};
+
+class RegistryImpl::KeyTypeHandle {
+ public:
+  // An empty handle, which must be assigned one from GetKeyTypeHandle()
+  // before it is used.
+  KeyTypeHandle() : type_url_(nullptr), key_type_info_(nullptr) {}
+
+  const std::string& type_url() const { return *type_url_; }
+
+  bool operator==(const KeyTypeHandle& other) const {
+    return key_type_info_ == other.key_type_info_;
+  }
+  bool operator!=(const KeyTypeHandle& other) const {
+    return !(*this == other);
+  }
+
+ private:
+  friend class RegistryImpl;
+
+  KeyTypeHandle(const std::string* type_url, const KeyTypeInfo* key_type_info)
+      : type_url_(type_url), key_type_info_(key_type_info) {}
+
+  // The key and the value of the entry in type_url_to_info_.
+  const std::string* type_url_;
+  const KeyTypeInfo* key_type_info_;
 };
 
 template <class P>
@@ -464,7 +668,7 @@ crypto::tink::util::Status RegistryImpl::AddCatalogue(
 template <class P>
 crypto::tink::util::StatusOr<const Catalogue<P>*> RegistryImpl::get_catalogue(
     const std::string& catalogue_name) const {
-  absl::MutexLock lock(&maps_mutex_);
+  absl::ReaderMutexLock lock(&maps_mutex_);
   auto catalogue_entry = name_to_catalogue_map_.find(catalogue_name);
   if (catalogue_entry == name_to_catalogue_map_.end()) {
     return ToStatusF(crypto::tink::util::error::NOT_FOUND,
@@ -670,42 +874,126 @@ crypto::tink::util::Status RegistryImpl::RegisterPrimitiveWrapper(
   return crypto::tink::util::Status::OK;
 }
 
+template <class KeyTypeManagerT>
+crypto::tink::util::Status RegistryImpl::RegisterKeyTypeManagerLazily(
+    bool new_key_allowed) {
+  std::string type_url = TypeUrl<typename KeyTypeManagerT::KeyProto>();
+  return RegisterLazily(
+      {{type_url, std::type_index(typeid(KeyTypeManagerT))}},
+      [this, type_url](bool new_key_allowed) -> crypto::tink::util::Status {
+        auto manager = absl::make_unique<KeyTypeManagerT>();
+        if (manager->get_key_type() != type_url) {
+          return ToStatusF(crypto::tink::util::error::INTERNAL,
+                           "The manager registered lazily for type '%s' is "
+                           "for type '%s'.",
+                           type_url, manager->get_key_type());
+        }
+        return RegisterKeyTypeManager<typename KeyTypeManagerT::KeyProto,
+                                      typename KeyTypeManagerT::KeyFormatProto,
+                                      typename KeyTypeManagerT::PrimitiveList>(
+            std::move(manager), new_key_allowed);
+      },
+      new_key_allowed);
+}
+
+template <class PrivateKeyTypeManagerT, class PublicKeyTypeManagerT>
+crypto::tink::util::Status RegistryImpl::RegisterAsymmetricKeyManagersLazily(
+    bool new_key_allowed) {
+  std::string private_type_url =
+      TypeUrl<typename PrivateKeyTypeManagerT::KeyProto>();
+  std::string public_type_url =
+      TypeUrl<typename PublicKeyTypeManagerT::KeyProto>();
+  return RegisterLazily(
+      {{private_type_url, std::type_index(typeid(PrivateKeyTypeManagerT))},
+       {public_type_url, std::type_index(typeid(PublicKeyTypeManagerT))}},
+      [this, private_type_url,
+       public_type_url](bool new_key_allowed) -> crypto::tink::util::Status {
+        auto private_key_manager = absl::make_unique<PrivateKeyTypeManagerT>();
+        auto public_key_manager = absl::make_unique<PublicKeyTypeManagerT>();
+        if (private_key_manager->get_key_type() != private_type_url ||
+            public_key_manager->get_key_type() != public_type_url) {
+          return ToStatusF(crypto::tink::util::error::INTERNAL,
+                           "The managers registered lazily for types '%s' "
+                           "and '%s' are for other types.",
+                           private_type_url, public_type_url);
+        }
+        return RegisterAsymmetricKeyManagers(private_key_manager.release(),
+                                             public_key_manager.release(),
+                                             new_key_allowed);
+      },
+      new_key_allowed);
+}
+
 template <class P>
 crypto::tink::util::StatusOr<const KeyManager<P>*>
-RegistryImpl::get_key_manager(const std::string& type_url) const {
-  absl::MutexLock lock(&maps_mutex_);
-  auto it = type_url_to_info_.find(type_url);
-  if (it == type_url_to_info_.end()) {
-    return ToStatusF(crypto::tink::util::error::NOT_FOUND,
-                     "No manager for type '%s' has been registered.", type_url);
-  }
-  return it->second.get_key_manager<P>(type_url);
+RegistryImpl::get_key_manager(absl::string_view type_url) const {
+  auto key_type_info_or = get_key_type_info(type_url);
+  if (!key_type_info_or.ok()) return key_type_info_or.status();
+  return key_type_info_or.ValueOrDie()->get_key_manager<P>(type_url);
+}
+
+template <class P>
+crypto::tink::util::StatusOr<const KeyManager<P>*>
+RegistryImpl::get_key_manager(const KeyTypeHandle& key_type) const {
+  return key_type.key_type_info_->get_key_manager<P>(key_type.type_url());
 }
 
 template <class P>
 crypto::tink::util::StatusOr<std::unique_ptr<P>> RegistryImpl::GetPrimitive(
     const google::crypto::tink::KeyData& key_data) const {
+  internal::TracingSpan span("tink.registry.get_primitive");
+  span.AddBytes(key_data.value().size());
   auto key_manager_result = get_key_manager<P>(key_data.type_url());
-  if (key_manager_result.ok()) {
-    return key_manager_result.ValueOrDie()->GetPrimitive(key_data);
+  if (!key_manager_result.ok()) {
+    span.SetOk(false);
+    return key_manager_result.status();
   }
-  return key_manager_result.status();
+  auto primitive_result =
+      key_manager_result.ValueOrDie()->GetPrimitive(key_data);
+  span.SetOk(primitive_result.ok());
+  return primitive_result;
 }
 
 template <class P>
 crypto::tink::util::StatusOr<std::unique_ptr<P>> RegistryImpl::GetPrimitive(
-    const std::string& type_url, const portable_proto::MessageLite& key) const {
+    absl::string_view type_url, const portable_proto::MessageLite& key) const {
+  internal::TracingSpan span("tink.registry.get_primitive");
   auto key_manager_result = get_key_manager<P>(type_url);
-  if (key_manager_result.ok()) {
-    return key_manager_result.ValueOrDie()->GetPrimitive(key);
+  if (!key_manager_result.ok()) {
+    span.SetOk(false);
+    return key_manager_result.status();
+  }
+  auto primitive_result = key_manager_result.ValueOrDie()->GetPrimitive(key);
+  span.SetOk(primitive_result.ok());
+  return primitive_result;
+}
+
+template <class P>
+crypto::tink::util::StatusOr<std::unique_ptr<P>> RegistryImpl::GetPrimitive(
+    const KeyTypeHandle& key_type,
+    const google::crypto::tink::KeyData& key_data) const {
+  if (key_data.type_url() != key_type.type_url()) {
+    return ToStatusF(crypto::tink::util::error::INVALID_ARGUMENT,
+                     "Key of type '%s' is not of type '%s'.",
+                     key_data.type_url(), key_type.type_url());
+  }
+  internal::TracingSpan span("tink.registry.get_primitive");
+  span.AddBytes(key_data.value().size());
+  auto key_manager_result = get_key_manager<P>(key_type);
+  if (!key_manager_result.ok()) {
+    span.SetOk(false);
+    return key_manager_result.status();
   }
-  return key_manager_result.status();
+  auto primitive_result =
+      key_manager_result.ValueOrDie()->GetPrimitive(key_data);
+  span.SetOk(primitive_result.ok());
+  return primitive_result;
 }
 
 template <class P>
 crypto::tink::util::StatusOr<const PrimitiveWrapper<P, P>*>
 RegistryImpl::GetLegacyWrapper() const {
-  absl::MutexLock lock(&maps_mutex_);
+  absl::ReaderMutexLock lock(&maps_mutex_);
   auto it = primitive_to_wrapper_.find(std::type_index(typeid(P)));
   if (it == primitive_to_wrapper_.end()) {
     return util::Status(
@@ -718,7 +1006,7 @@ RegistryImpl::GetLegacyWrapper() const {
 template <class P>
 crypto::tink::util::StatusOr<const KeysetWrapper<P>*>
 RegistryImpl::GetKeysetWrapper() const {
-  absl::MutexLock lock(&maps_mutex_);
+  absl::ReaderMutexLock lock(&maps_mutex_);
   auto it = primitive_to_wrapper_.find(std::type_index(typeid(P)));
   if (it == primitive_to_wrapper_.end()) {
     return util::Status(
@@ -759,6 +1047,17 @@ crypto::tink::util::StatusOr<std::unique_ptr<P>> RegistryImpl::WrapKeyset(
   return std::move(primitive_result);
 }
 
+template <class P>
+crypto::tink::util::StatusOr<std::unique_ptr<P>> RegistryImpl::WrapKeyset(
+    const google::crypto::tink::Keyset& keyset, const KeysetPlan& plan) const {
+  util::StatusOr<const KeysetWrapper<P>*> wrapper_result =
+      GetKeysetWrapper<P>();
+  if (!wrapper_result.ok()) {
+    return wrapper_result.status();
+  }
+  return wrapper_result.ValueOrDie()->WrapWithPlan(keyset, plan);
+}
+
 }  // namespace tink
 }  // namespace crypto
 
@@ -22,6 +22,7 @@
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "tink/aead.h"
 #include "tink/aead/aead_wrapper.h"
@@ -58,6 +59,7 @@ using ::crypto::tink::test::AddRawKey;
 using ::crypto::tink::test::AddTinkKey;
 using ::crypto::tink::test::DummyAead;
 using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::IsOkAndHolds;
 using ::crypto::tink::test::StatusIs;
 using ::crypto::tink::util::Status;
 using ::google::crypto::tink::AesCtrHmacAeadKey;
@@ -233,6 +235,16 @@ class ExampleKeyTypeManager : public KeyTypeManager<AesGcmKey, AesGcmKeyFormat,
       "type.googleapis.com/google.crypto.tink.AesGcmKey";
 };
 
+// Counts its instances, to check when the registry constructs it.
+class CountingKeyTypeManager : public ExampleKeyTypeManager {
+ public:
+  CountingKeyTypeManager() { ++constructed; }
+
+  static int constructed;
+};
+
+int CountingKeyTypeManager::constructed = 0;
+
 template <typename P, typename Q = P>
 class TestWrapper : public PrimitiveWrapper<P, Q> {
  public:
@@ -386,6 +398,24 @@ TEST_F(RegistryTest, testConcurrentRegistration) {
   EXPECT_EQ(util::error::NOT_FOUND, manager_result.status().error_code());
 }
 
+TEST_F(RegistryTest, testConcurrentLookups) {
+  std::string key_type_prefix = "key_type_";
+  int count = 16;
+  register_test_managers(key_type_prefix, count);
+
+  // Many readers looking up the same managers should not interfere with each
+  // other, nor with a writer registering further key types.
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; i++) {
+    threads.emplace_back(verify_test_managers, key_type_prefix, count);
+  }
+  threads.emplace_back(register_test_managers, "other_key_type_", count);
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  verify_test_managers("other_key_type_", count);
+}
+
 TEST_F(RegistryTest, testBasic) {
   std::string key_type_1 = "google.crypto.tink.AesCtrHmacAeadKey";
   std::string key_type_2 = "google.crypto.tink.AesGcmKey";
@@ -1134,6 +1164,174 @@ TEST_F(RegistryTest, KeyManagerDeriveKeyFail) {
       StatusIs(util::error::INVALID_ARGUMENT, HasSubstr("cannot derive")));
 }
 
+TEST_F(RegistryTest, GetKeyDeriver) {
+  EXPECT_THAT(Registry::RegisterKeyTypeManager(
+                  absl::make_unique<ExampleKeyTypeManager>(), true),
+              IsOk());
+
+  AesGcmKeyFormat format;
+  format.set_key_size(32);
+
+  crypto::tink::util::IstreamInputStream input_stream{
+      absl::make_unique<std::stringstream>(
+          "0123456789012345678901234567890123456789")};
+
+  auto key_deriver_or = RegistryImpl::GlobalInstance().GetKeyDeriver(
+      "type.googleapis.com/google.crypto.tink.AesGcmKey");
+  ASSERT_THAT(key_deriver_or.status(), IsOk());
+  auto key_data_or = (*key_deriver_or.ValueOrDie())(
+      format.SerializeAsString(), &input_stream);
+  ASSERT_THAT(key_data_or.status(), IsOk());
+  AesGcmKey key;
+  EXPECT_TRUE(key.ParseFromString(key_data_or.ValueOrDie().value()));
+  EXPECT_THAT(key.key_value(), Eq("01234567890123456789012345678901"));
+
+  EXPECT_THAT(
+      RegistryImpl::GlobalInstance().GetKeyDeriver("some_inexistent_keytype")
+          .status(),
+      StatusIs(util::error::NOT_FOUND));
+}
+
+TEST_F(RegistryTest, LookupsByStringView) {
+  constexpr absl::string_view kKeyType =
+      "type.googleapis.com/google.crypto.tink.AesGcmKey";
+  ASSERT_THAT(Registry::RegisterKeyManager(
+                  absl::make_unique<TestAeadKeyManager>(std::string(kKeyType)),
+                  /* new_key_allowed= */ true),
+              IsOk());
+  // A view into a longer string, which is not null-terminated at the end of
+  // the type URL.
+  std::string buffer = absl::StrCat(kKeyType, "/suffix");
+  absl::string_view type_url = absl::string_view(buffer).substr(
+      0, kKeyType.size());
+  auto manager_result = Registry::get_key_manager<Aead>(type_url);
+  ASSERT_THAT(manager_result.status(), IsOk());
+  EXPECT_THAT(manager_result.ValueOrDie()->get_key_type(), Eq(kKeyType));
+  EXPECT_THAT(Registry::get_key_manager<Aead>(buffer).status(),
+              StatusIs(util::error::NOT_FOUND));
+}
+
+TEST_F(RegistryTest, KeyTypeHandle) {
+  std::string key_type_1 = "google.crypto.tink.AesCtrHmacAeadKey";
+  std::string key_type_2 = "google.crypto.tink.AesGcmKey";
+  ASSERT_THAT(Registry::RegisterKeyManager(
+                  absl::make_unique<TestAeadKeyManager>(key_type_1), true),
+              IsOk());
+  ASSERT_THAT(Registry::RegisterKeyManager(
+                  absl::make_unique<TestAeadKeyManager>(key_type_2), true),
+              IsOk());
+  RegistryImpl& registry = RegistryImpl::GlobalInstance();
+
+  auto handle_1_result = registry.GetKeyTypeHandle(key_type_1);
+  ASSERT_THAT(handle_1_result.status(), IsOk());
+  RegistryImpl::KeyTypeHandle handle_1 = handle_1_result.ValueOrDie();
+  EXPECT_THAT(handle_1.type_url(), Eq(key_type_1));
+  auto handle_2_result = registry.GetKeyTypeHandle(key_type_2);
+  ASSERT_THAT(handle_2_result.status(), IsOk());
+  EXPECT_TRUE(handle_1 == registry.GetKeyTypeHandle(key_type_1).ValueOrDie());
+  EXPECT_TRUE(handle_1 != handle_2_result.ValueOrDie());
+  EXPECT_THAT(registry.GetKeyTypeHandle("some_inexistent_keytype").status(),
+              StatusIs(util::error::NOT_FOUND));
+
+  auto manager_result = registry.get_key_manager<Aead>(handle_1);
+  ASSERT_THAT(manager_result.status(), IsOk());
+  EXPECT_THAT(manager_result.ValueOrDie(),
+              Eq(Registry::get_key_manager<Aead>(key_type_1).ValueOrDie()));
+  EXPECT_THAT(registry.get_key_manager<AeadVariant>(handle_1).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+
+  KeyData key_data;
+  key_data.set_type_url(key_type_1);
+  auto aead_result = registry.GetPrimitive<Aead>(handle_1, key_data);
+  ASSERT_THAT(aead_result.status(), IsOk());
+  EXPECT_THAT(aead_result.ValueOrDie()->Encrypt("plaintext", "aad"),
+              IsOkAndHolds(DummyAead(key_type_1)
+                               .Encrypt("plaintext", "aad")
+                               .ValueOrDie()));
+  key_data.set_type_url(key_type_2);
+  EXPECT_THAT(registry.GetPrimitive<Aead>(handle_1, key_data).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST_F(RegistryTest, RegisterKeyTypeManagerLazily) {
+  CountingKeyTypeManager::constructed = 0;
+  ASSERT_THAT(Registry::RegisterKeyTypeManagerLazily<CountingKeyTypeManager>(
+                  /* new_key_allowed= */ true),
+              IsOk());
+  ASSERT_THAT(Registry::RegisterKeyTypeManagerLazily<CountingKeyTypeManager>(
+                  /* new_key_allowed= */ true),
+              IsOk());
+  EXPECT_THAT(CountingKeyTypeManager::constructed, Eq(0));
+
+  std::string key_type = "type.googleapis.com/google.crypto.tink.AesGcmKey";
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) {
+    threads.emplace_back([&key_type]() {
+      EXPECT_THAT(Registry::get_key_manager<AeadVariant>(key_type).status(),
+                  IsOk());
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  EXPECT_THAT(CountingKeyTypeManager::constructed, Eq(1));
+
+  AesGcmKey key;
+  key.set_key_value("0123456789abcdef");
+  KeyData key_data;
+  key_data.set_type_url(key_type);
+  key_data.set_value(key.SerializeAsString());
+  auto variant_result = Registry::GetPrimitive<AeadVariant>(key_data);
+  ASSERT_THAT(variant_result.status(), IsOk());
+  EXPECT_THAT(variant_result.ValueOrDie()->get(), Eq("0123456789abcdef"));
+  EXPECT_THAT(CountingKeyTypeManager::constructed, Eq(1));
+}
+
+TEST_F(RegistryTest, RegisterKeyTypeManagerLazilyConflicts) {
+  std::string key_type = "type.googleapis.com/google.crypto.tink.AesGcmKey";
+  ASSERT_THAT(Registry::RegisterKeyTypeManagerLazily<ExampleKeyTypeManager>(
+                  /* new_key_allowed= */ false),
+              IsOk());
+  EXPECT_THAT(Registry::RegisterKeyManager(
+                  absl::make_unique<TestAeadKeyManager>(key_type),
+                  /* new_key_allowed= */ false),
+              StatusIs(util::error::ALREADY_EXISTS));
+  EXPECT_THAT(Registry::RegisterKeyTypeManagerLazily<CountingKeyTypeManager>(
+                  /* new_key_allowed= */ false),
+              StatusIs(util::error::ALREADY_EXISTS));
+  EXPECT_THAT(Registry::RegisterKeyTypeManagerLazily<ExampleKeyTypeManager>(
+                  /* new_key_allowed= */ true),
+              StatusIs(util::error::ALREADY_EXISTS));
+
+  KeyTemplate key_template;
+  key_template.set_type_url(key_type);
+  EXPECT_THAT(Registry::NewKeyData(key_template).status(),
+              StatusIs(util::error::INVALID_ARGUMENT,
+                       HasSubstr("does not allow for creation of new keys")));
+  // Registering the same manager again, now that it has been constructed.
+  EXPECT_THAT(Registry::RegisterKeyTypeManagerLazily<ExampleKeyTypeManager>(
+                  /* new_key_allowed= */ false),
+              IsOk());
+}
+
+TEST_F(RegistryTest, RegisterAsymmetricKeyManagersLazily) {
+  ASSERT_THAT(
+      (Registry::RegisterAsymmetricKeyManagersLazily<
+          EciesAeadHkdfPrivateKeyManager, EciesAeadHkdfPublicKeyManager>(
+          /* new_key_allowed= */ true)),
+      IsOk());
+  EXPECT_THAT(Registry::get_key_manager<HybridEncrypt>(
+                  EciesAeadHkdfPublicKeyManager().get_key_type())
+                  .status(),
+              IsOk());
+  EXPECT_THAT(Registry::get_key_manager<HybridDecrypt>(
+                  EciesAeadHkdfPrivateKeyManager().get_key_type())
+                  .status(),
+              IsOk());
+  EXPECT_THAT(Registry::RegisterKeyTypeManager(
+                  absl::make_unique<EciesAeadHkdfPublicKeyManager>(),
+                  /* new_key_allowed= */ true),
+              IsOk());
+}
+
 TEST_F(RegistryTest, KeyManagerDeriveNotRegistered) {
   KeyTemplate key_template;
   key_template.set_type_url("some_inexistent_keytype");
@@ -0,0 +1,254 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/rotating_primitive.h"
+
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "tink/keyset_handle.h"
+#include "tink/keyset_manager.h"
+#include "tink/mac.h"
+#include "tink/mac/mac_config.h"
+#include "tink/mac/mac_key_templates.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "tink/util/test_keyset_handle.h"
+#include "tink/util/test_matchers.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace {
+
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::google::crypto::tink::Keyset;
+using ::testing::Eq;
+using ::testing::Ge;
+using ::testing::Not;
+
+// A keyset source backed by a KeysetManager, which can be made to fail.
+class KeysetSource {
+ public:
+  KeysetSource() {
+    manager_ = std::move(
+        KeysetManager::New(MacKeyTemplates::HmacSha256HalfSizeTag())
+            .ValueOrDie());
+  }
+
+  RotatingPrimitive<Mac>::KeysetHandleSource AsSource() {
+    return [this]() -> util::StatusOr<std::unique_ptr<KeysetHandle>> {
+      absl::MutexLock lock(&mutex_);
+      calls_++;
+      if (fail_) return util::Status(util::error::UNAVAILABLE, "unavailable");
+      return manager_->GetKeysetHandle();
+    };
+  }
+
+  void Rotate() {
+    ASSERT_THAT(
+        manager_->Rotate(MacKeyTemplates::HmacSha256HalfSizeTag()).status(),
+        IsOk());
+  }
+
+  std::unique_ptr<KeysetHandle> GetKeysetHandle() {
+    return manager_->GetKeysetHandle();
+  }
+
+  void set_fail(bool fail) {
+    absl::MutexLock lock(&mutex_);
+    fail_ = fail;
+  }
+
+  int calls() {
+    absl::MutexLock lock(&mutex_);
+    return calls_;
+  }
+
+ private:
+  std::unique_ptr<KeysetManager> manager_;
+  absl::Mutex mutex_;
+  bool fail_ ABSL_GUARDED_BY(mutex_) = false;
+  int calls_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+class RotatingPrimitiveTest : public ::testing::Test {
+ protected:
+  void SetUp() override { ASSERT_THAT(MacConfig::Register(), IsOk()); }
+
+  // Returns the tag of the primary key of the keyset in 'source'.
+  std::string ExpectedTag(KeysetSource* source) {
+    auto mac = source->GetKeysetHandle()->GetPrimitive<Mac>().ValueOrDie();
+    return mac->ComputeMac("data").ValueOrDie();
+  }
+};
+
+TEST_F(RotatingPrimitiveTest, RefreshPicksUpRotations) {
+  KeysetSource source;
+  auto rotating_result =
+      RotatingPrimitive<Mac>::New(source.AsSource(), absl::Hours(1));
+  ASSERT_THAT(rotating_result.status(), IsOk());
+  auto& rotating = rotating_result.ValueOrDie();
+  EXPECT_THAT(rotating->generation(), Eq(1));
+  EXPECT_THAT(rotating->last_refresh_status(), IsOk());
+  std::string old_tag = rotating->Get()->ComputeMac("data").ValueOrDie();
+  EXPECT_THAT(old_tag, Eq(ExpectedTag(&source)));
+
+  source.Rotate();
+  ASSERT_THAT(rotating->Refresh(), IsOk());
+  EXPECT_THAT(rotating->generation(), Eq(2));
+  std::string new_tag = rotating->Get()->ComputeMac("data").ValueOrDie();
+  EXPECT_THAT(new_tag, Eq(ExpectedTag(&source)));
+  EXPECT_THAT(new_tag, Not(Eq(old_tag)));
+  // Tags of the previous primary key still verify.
+  EXPECT_THAT(rotating->Get()->VerifyMac(old_tag, "data"), IsOk());
+}
+
+TEST_F(RotatingPrimitiveTest, UnchangedKeysetsAreNotRebuilt) {
+  KeysetSource source;
+  auto rotating_result =
+      RotatingPrimitive<Mac>::New(source.AsSource(), absl::Hours(1));
+  ASSERT_THAT(rotating_result.status(), IsOk());
+  auto& rotating = rotating_result.ValueOrDie();
+  Mac* mac = rotating->Get().get();
+  ASSERT_THAT(rotating->Refresh(), IsOk());
+  EXPECT_THAT(rotating->generation(), Eq(1));
+  EXPECT_THAT(rotating->Get().get(), Eq(mac));
+}
+
+TEST_F(RotatingPrimitiveTest, RefreshPicksUpChangedKeyMaterial) {
+  KeysetSource source;
+  KeysetSource other_source;
+  Keyset keyset = TestKeysetHandle::GetKeyset(*source.GetKeysetHandle());
+  // Same keyset info, but the key value of another key.
+  Keyset replaced_keyset = keyset;
+  *replaced_keyset.mutable_key(0)->mutable_key_data()->mutable_value() =
+      TestKeysetHandle::GetKeyset(*other_source.GetKeysetHandle())
+          .key(0)
+          .key_data()
+          .value();
+  bool replaced = false;
+  auto rotating_result = RotatingPrimitive<Mac>::New(
+      [&]() -> util::StatusOr<std::unique_ptr<KeysetHandle>> {
+        return TestKeysetHandle::GetKeysetHandle(replaced ? replaced_keyset
+                                                          : keyset);
+      },
+      absl::Hours(1));
+  ASSERT_THAT(rotating_result.status(), IsOk());
+  auto& rotating = rotating_result.ValueOrDie();
+  std::string old_tag = rotating->Get()->ComputeMac("data").ValueOrDie();
+
+  replaced = true;
+  ASSERT_THAT(rotating->Refresh(), IsOk());
+  EXPECT_THAT(rotating->generation(), Eq(2));
+  EXPECT_THAT(rotating->Get()->ComputeMac("data").ValueOrDie(),
+              Not(Eq(old_tag)));
+}
+
+TEST_F(RotatingPrimitiveTest, FailedRefreshKeepsThePrimitive) {
+  KeysetSource source;
+  auto rotating_result =
+      RotatingPrimitive<Mac>::New(source.AsSource(), absl::Hours(1));
+  ASSERT_THAT(rotating_result.status(), IsOk());
+  auto& rotating = rotating_result.ValueOrDie();
+  std::string tag = ExpectedTag(&source);
+
+  source.set_fail(true);
+  source.Rotate();
+  EXPECT_THAT(rotating->Refresh(), StatusIs(util::error::UNAVAILABLE));
+  EXPECT_THAT(rotating->last_refresh_status(),
+              StatusIs(util::error::UNAVAILABLE));
+  EXPECT_THAT(rotating->generation(), Eq(1));
+  EXPECT_THAT(rotating->Get()->ComputeMac("data").ValueOrDie(), Eq(tag));
+
+  source.set_fail(false);
+  EXPECT_THAT(rotating->Refresh(), IsOk());
+  EXPECT_THAT(rotating->last_refresh_status(), IsOk());
+  EXPECT_THAT(rotating->generation(), Eq(2));
+}
+
+TEST_F(RotatingPrimitiveTest, InvalidArguments) {
+  KeysetSource source;
+  EXPECT_THAT(RotatingPrimitive<Mac>::New(nullptr, absl::Hours(1)).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(
+      RotatingPrimitive<Mac>::New(source.AsSource(), absl::ZeroDuration())
+          .status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+  source.set_fail(true);
+  EXPECT_THAT(
+      RotatingPrimitive<Mac>::New(source.AsSource(), absl::Hours(1)).status(),
+      StatusIs(util::error::UNAVAILABLE));
+}
+
+TEST_F(RotatingPrimitiveTest, HandlesOutliveRefreshes) {
+  KeysetSource source;
+  auto rotating_result =
+      RotatingPrimitive<Mac>::New(source.AsSource(), absl::Hours(1));
+  ASSERT_THAT(rotating_result.status(), IsOk());
+  auto& rotating = rotating_result.ValueOrDie();
+  std::string old_tag = ExpectedTag(&source);
+  {
+    RotatingPrimitive<Mac>::Handle handle = rotating->Get();
+    source.Rotate();
+    ASSERT_THAT(rotating->Refresh(), IsOk());
+    // The handle still refers to the primitive of the old keyset.
+    EXPECT_THAT(handle->ComputeMac("data").ValueOrDie(), Eq(old_tag));
+    EXPECT_THAT(rotating->Get().get(), Not(Eq(handle.get())));
+  }
+  EXPECT_THAT(rotating->Get()->ComputeMac("data").ValueOrDie(),
+              Not(Eq(old_tag)));
+}
+
+TEST_F(RotatingPrimitiveTest, BackgroundRefresh) {
+  KeysetSource source;
+  auto rotating_result =
+      RotatingPrimitive<Mac>::New(source.AsSource(), absl::Milliseconds(1));
+  ASSERT_THAT(rotating_result.status(), IsOk());
+  auto& rotating = rotating_result.ValueOrDie();
+  source.Rotate();
+  std::string new_tag = ExpectedTag(&source);
+
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; i++) {
+    readers.emplace_back([&rotating]() {
+      for (int j = 0; j < 1000; j++) {
+        EXPECT_THAT(rotating->Get()->ComputeMac("data").status(), IsOk());
+      }
+    });
+  }
+  absl::Time deadline = absl::Now() + absl::Seconds(30);
+  while (rotating->generation() < 2 && absl::Now() < deadline) {
+    absl::SleepFor(absl::Milliseconds(1));
+  }
+  for (std::thread& reader : readers) reader.join();
+  EXPECT_THAT(rotating->generation(), Eq(2));
+  EXPECT_THAT(rotating->Get()->ComputeMac("data").ValueOrDie(), Eq(new_tag));
+  EXPECT_THAT(source.calls(), Ge(2));
+}
+
+}  // namespace
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,361 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/sax_json_keyset_reader.h"
+
+#include <cstdint>
+#include <istream>
+#include <iterator>
+#include <memory>
+#include <string>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "include/rapidjson/error/en.h"
+#include "include/rapidjson/reader.h"
+#include "tink/json_keyset_reader.h"
+#include "tink/util/base64.h"
+#include "tink/util/enums.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+
+using google::crypto::tink::EncryptedKeyset;
+using google::crypto::tink::KeyData;
+using google::crypto::tink::Keyset;
+using crypto::tink::util::Enums;
+
+namespace {
+
+// The fields of the JSON objects that KeysetHandler reads. kUnknown is for
+// the fields that are ignored, and kNone when no value is expected.
+enum class Field {
+  kNone,
+  kUnknown,
+  kPrimaryKeyId,
+  kKey,
+  kKeyData,
+  kStatus,
+  kKeyId,
+  kOutputPrefixType,
+  kTypeUrl,
+  kValue,
+  kKeyMaterialType,
+};
+
+constexpr uint32_t Bit(Field field) {
+  return uint32_t{1} << static_cast<int>(field);
+}
+
+// The required fields of each object.
+constexpr uint32_t kKeysetFields = Bit(Field::kPrimaryKeyId) | Bit(Field::kKey);
+constexpr uint32_t kKeyFields = Bit(Field::kKeyData) | Bit(Field::kStatus) |
+                                Bit(Field::kKeyId) |
+                                Bit(Field::kOutputPrefixType);
+constexpr uint32_t kKeyDataFields = Bit(Field::kTypeUrl) | Bit(Field::kValue) |
+                                    Bit(Field::kKeyMaterialType);
+
+// Fills in a Keyset from the SAX events of its JSON, with the validation of
+// JsonKeysetReader. Values of unknown fields are skipped.
+class KeysetHandler
+    : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, KeysetHandler> {
+ public:
+  explicit KeysetHandler(Keyset* keyset) : keyset_(keyset) {}
+
+  // Called for all the values without a handler below, i.e. null, bool, and
+  // numbers other than unsigned 32-bit integers.
+  bool Default() {
+    if (skip_depth_ > 0) return true;
+    return TakeField() == Field::kUnknown || Fail();
+  }
+
+  bool Uint(unsigned value) {
+    if (skip_depth_ > 0) return true;
+    switch (TakeField()) {
+      case Field::kUnknown:
+        return true;
+      case Field::kPrimaryKeyId:
+        keyset_->set_primary_key_id(value);
+        return true;
+      case Field::kKeyId:
+        key_->set_key_id(value);
+        return true;
+      default:
+        return Fail();
+    }
+  }
+
+  bool String(const char* str, rapidjson::SizeType length, bool copy) {
+    if (skip_depth_ > 0) return true;
+    absl::string_view value(str, length);
+    switch (TakeField()) {
+      case Field::kUnknown:
+        return true;
+      case Field::kStatus:
+        key_->set_status(Enums::KeyStatus(value));
+        return true;
+      case Field::kOutputPrefixType:
+        key_->set_output_prefix_type(Enums::OutputPrefix(value));
+        return true;
+      case Field::kTypeUrl:
+        key_data_->set_type_url(str, length);
+        return true;
+      case Field::kValue:
+        return util::Base64Decode(value, util::Base64Alphabet::kStandard,
+                                  key_data_->mutable_value()) ||
+               Fail();
+      case Field::kKeyMaterialType:
+        key_data_->set_key_material_type(Enums::KeyMaterial(value));
+        return true;
+      default:
+        return Fail();
+    }
+  }
+
+  bool Key(const char* str, rapidjson::SizeType length, bool copy) {
+    if (skip_depth_ > 0) return true;
+    absl::string_view name(str, length);
+    uint32_t* fields;
+    switch (state_) {
+      case State::kKeyset:
+        fields = &keyset_fields_;
+        if (name == "primaryKeyId") {
+          field_ = Field::kPrimaryKeyId;
+        } else if (name == "key") {
+          field_ = Field::kKey;
+        } else {
+          field_ = Field::kUnknown;
+        }
+        break;
+      case State::kKey:
+        fields = &key_fields_;
+        if (name == "keyData") {
+          field_ = Field::kKeyData;
+        } else if (name == "status") {
+          field_ = Field::kStatus;
+        } else if (name == "keyId") {
+          field_ = Field::kKeyId;
+        } else if (name == "outputPrefixType") {
+          field_ = Field::kOutputPrefixType;
+        } else {
+          field_ = Field::kUnknown;
+        }
+        break;
+      case State::kKeyData:
+        fields = &key_data_fields_;
+        if (name == "typeUrl") {
+          field_ = Field::kTypeUrl;
+        } else if (name == "value") {
+          field_ = Field::kValue;
+        } else if (name == "keyMaterialType") {
+          field_ = Field::kKeyMaterialType;
+        } else {
+          field_ = Field::kUnknown;
+        }
+        break;
+      default:
+        return Fail();
+    }
+    if (field_ == Field::kUnknown) return true;
+    if (*fields & Bit(field_)) return Fail();
+    *fields |= Bit(field_);
+    return true;
+  }
+
+  bool StartObject() {
+    if (skip_depth_ > 0) {
+      skip_depth_++;
+      return true;
+    }
+    switch (state_) {
+      case State::kStart:
+        state_ = State::kKeyset;
+        return true;
+      case State::kKeyList:
+        key_ = keyset_->add_key();
+        key_fields_ = 0;
+        state_ = State::kKey;
+        return true;
+      default:
+        break;
+    }
+    Field field = TakeField();
+    if (field == Field::kUnknown) {
+      skip_depth_ = 1;
+      return true;
+    }
+    if (field != Field::kKeyData) return Fail();
+    key_data_ = key_->mutable_key_data();
+    key_data_fields_ = 0;
+    state_ = State::kKeyData;
+    return true;
+  }
+
+  bool EndObject(rapidjson::SizeType member_count) {
+    if (skip_depth_ > 0) {
+      skip_depth_--;
+      return true;
+    }
+    switch (state_) {
+      case State::kKeyset:
+        if (keyset_fields_ != kKeysetFields) return Fail();
+        state_ = State::kDone;
+        return true;
+      case State::kKey:
+        if (key_fields_ != kKeyFields) return Fail();
+        state_ = State::kKeyList;
+        return true;
+      case State::kKeyData:
+        if (key_data_fields_ != kKeyDataFields) return Fail();
+        state_ = State::kKey;
+        return true;
+      default:
+        return Fail();
+    }
+  }
+
+  bool StartArray() {
+    if (skip_depth_ > 0) {
+      skip_depth_++;
+      return true;
+    }
+    Field field = TakeField();
+    if (field == Field::kUnknown) {
+      skip_depth_ = 1;
+      return true;
+    }
+    if (field != Field::kKey) return Fail();
+    state_ = State::kKeyList;
+    return true;
+  }
+
+  bool EndArray(rapidjson::SizeType element_count) {
+    if (skip_depth_ > 0) {
+      skip_depth_--;
+      return true;
+    }
+    // Only the key list is not skipped, which must not be empty.
+    state_ = State::kKeyset;
+    return element_count > 0 || Fail();
+  }
+
+  // The error that stopped the parsing, if any.
+  const util::Status& status() const { return status_; }
+
+ private:
+  // The object or array that is being read.
+  enum class State { kStart, kKeyset, kKeyList, kKey, kKeyData, kDone };
+
+  // Returns the field of the next value, which is kNone outside of objects.
+  Field TakeField() {
+    Field field = field_;
+    field_ = Field::kNone;
+    return field;
+  }
+
+  // Stops the parsing with the error for the current object.
+  bool Fail() {
+    switch (state_) {
+      case State::kKeyList:
+      case State::kKey:
+        status_ = util::Status(util::error::INVALID_ARGUMENT,
+                               "Invalid JSON Key");
+        break;
+      case State::kKeyData:
+        status_ = util::Status(util::error::INVALID_ARGUMENT,
+                               "Invalid JSON KeyData");
+        break;
+      default:
+        status_ = util::Status(util::error::INVALID_ARGUMENT,
+                               "Invalid JSON Keyset");
+    }
+    return false;
+  }
+
+  Keyset* const keyset_;
+  Keyset::Key* key_ = nullptr;
+  KeyData* key_data_ = nullptr;
+  State state_ = State::kStart;
+  Field field_ = Field::kNone;
+  // The nesting depth within a skipped value.
+  int skip_depth_ = 0;
+  // The fields read of the current keyset, key and key data.
+  uint32_t keyset_fields_ = 0;
+  uint32_t key_fields_ = 0;
+  uint32_t key_data_fields_ = 0;
+  util::Status status_;
+};
+
+}  // namespace
+
+//  static
+util::StatusOr<std::unique_ptr<KeysetReader>> SaxJsonKeysetReader::New(
+    std::unique_ptr<std::istream> keyset_stream) {
+  if (keyset_stream == nullptr) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "keyset_stream must be non-null.");
+  }
+  std::unique_ptr<KeysetReader> reader(
+      new SaxJsonKeysetReader(std::move(keyset_stream)));
+  return std::move(reader);
+}
+
+//  static
+util::StatusOr<std::unique_ptr<KeysetReader>> SaxJsonKeysetReader::New(
+    absl::string_view serialized_keyset) {
+  std::unique_ptr<KeysetReader> reader(
+      new SaxJsonKeysetReader(serialized_keyset));
+  return std::move(reader);
+}
+
+std::string SaxJsonKeysetReader::GetSerializedKeyset() {
+  if (keyset_stream_ == nullptr) return serialized_keyset_;
+  return std::string(std::istreambuf_iterator<char>(*keyset_stream_), {});
+}
+
+util::StatusOr<std::unique_ptr<Keyset>> SaxJsonKeysetReader::Read() {
+  // Parsing in place modifies the JSON, so it works on a copy that strings
+  // are unescaped into, and passed to the handler from.
+  std::string serialized_keyset = GetSerializedKeyset();
+  auto keyset = absl::make_unique<Keyset>();
+  KeysetHandler handler(keyset.get());
+  rapidjson::Reader reader;
+  rapidjson::InsituStringStream stream(&serialized_keyset[0]);
+  rapidjson::ParseResult result =
+      reader.Parse<rapidjson::kParseInsituFlag>(stream, handler);
+  if (!handler.status().ok()) return handler.status();
+  if (result.IsError()) {
+    return util::Status(
+        util::error::INVALID_ARGUMENT,
+        absl::StrCat("Invalid JSON Keyset: Error (offset ", result.Offset(),
+                     "): ", rapidjson::GetParseError_En(result.Code())));
+  }
+  return std::move(keyset);
+}
+
+util::StatusOr<std::unique_ptr<EncryptedKeyset>>
+SaxJsonKeysetReader::ReadEncrypted() {
+  auto reader_result = JsonKeysetReader::New(GetSerializedKeyset());
+  if (!reader_result.ok()) return reader_result.status();
+  return reader_result.ValueOrDie()->ReadEncrypted();
+}
+
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,270 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/sax_json_keyset_reader.h"
+
+#include <istream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/escaping.h"
+#include "absl/strings/str_replace.h"
+#include "absl/strings/substitute.h"
+#include "tink/json_keyset_reader.h"
+#include "tink/json_keyset_writer.h"
+#include "tink/util/test_matchers.h"
+#include "tink/util/test_util.h"
+#include "proto/aes_eax.pb.h"
+#include "proto/aes_gcm.pb.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+
+using ::crypto::tink::test::AddRawKey;
+using ::crypto::tink::test::AddTinkKey;
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::google::crypto::tink::AesEaxKey;
+using ::google::crypto::tink::AesGcmKey;
+using ::google::crypto::tink::EncryptedKeyset;
+using ::google::crypto::tink::KeyData;
+using ::google::crypto::tink::Keyset;
+using ::google::crypto::tink::KeyStatusType;
+using ::google::crypto::tink::OutputPrefixType;
+using ::testing::Eq;
+using ::testing::Not;
+
+namespace {
+
+// A keyset in JSON, where $0 is inserted into the first key, and $1 and $2
+// are the base64 encoded key values.
+constexpr char kJsonKeysetTemplate[] = R"(
+      {
+         "primaryKeyId":42,
+         "key":[
+            {
+               "keyData":{
+                  "typeUrl":"type.googleapis.com/google.crypto.tink.AesGcmKey",
+                  "keyMaterialType":"SYMMETRIC",
+                  "value": "$1"
+               },
+               $0
+               "outputPrefixType":"TINK",
+               "keyId":42,
+               "status":"ENABLED"
+            },
+            {
+               "keyData":{
+                  "typeUrl":"type.googleapis.com/google.crypto.tink.AesEaxKey",
+                  "keyMaterialType":"SYMMETRIC",
+                  "value":"$2"
+               },
+               "outputPrefixType":"RAW",
+               "keyId":711,
+               "status":"ENABLED"
+            }
+         ]
+      })";
+
+class SaxJsonKeysetReaderTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    gcm_key_.set_key_value("some gcm key value");
+    gcm_key_.set_version(0);
+    eax_key_.set_key_value("some eax key value");
+    eax_key_.set_version(0);
+    eax_key_.mutable_params()->set_iv_size(16);
+
+    AddTinkKey("type.googleapis.com/google.crypto.tink.AesGcmKey", 42, gcm_key_,
+               KeyStatusType::ENABLED, KeyData::SYMMETRIC, &keyset_);
+    AddRawKey("type.googleapis.com/google.crypto.tink.AesEaxKey", 711, eax_key_,
+              KeyStatusType::ENABLED, KeyData::SYMMETRIC, &keyset_);
+    keyset_.set_primary_key_id(42);
+  }
+
+  // Returns the JSON keyset with 'extra_fields' in the first key.
+  std::string JsonKeyset(absl::string_view extra_fields = "") {
+    return absl::Substitute(kJsonKeysetTemplate, extra_fields,
+                            absl::Base64Escape(gcm_key_.SerializeAsString()),
+                            absl::Base64Escape(eax_key_.SerializeAsString()));
+  }
+
+  Keyset keyset_;
+  AesGcmKey gcm_key_;
+  AesEaxKey eax_key_;
+};
+
+util::StatusOr<std::unique_ptr<Keyset>> ReadKeyset(absl::string_view json) {
+  auto reader_result = SaxJsonKeysetReader::New(json);
+  if (!reader_result.ok()) return reader_result.status();
+  return reader_result.ValueOrDie()->Read();
+}
+
+TEST_F(SaxJsonKeysetReaderTest, NullStream) {
+  EXPECT_THAT(SaxJsonKeysetReader::New(std::unique_ptr<std::istream>())
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST_F(SaxJsonKeysetReaderTest, ReadFromString) {
+  auto reader_result = SaxJsonKeysetReader::New(JsonKeyset());
+  ASSERT_THAT(reader_result.status(), IsOk());
+  auto& reader = reader_result.ValueOrDie();
+  // The string can be read more than once.
+  for (int i = 0; i < 2; i++) {
+    auto read_result = reader->Read();
+    ASSERT_THAT(read_result.status(), IsOk());
+    EXPECT_THAT(read_result.ValueOrDie()->SerializeAsString(),
+                Eq(keyset_.SerializeAsString()));
+  }
+}
+
+TEST_F(SaxJsonKeysetReaderTest, ReadFromStream) {
+  std::unique_ptr<std::istream> stream(
+      new std::stringstream(JsonKeyset(), std::ios_base::in));
+  auto reader_result = SaxJsonKeysetReader::New(std::move(stream));
+  ASSERT_THAT(reader_result.status(), IsOk());
+  auto read_result = reader_result.ValueOrDie()->Read();
+  ASSERT_THAT(read_result.status(), IsOk());
+  EXPECT_THAT(read_result.ValueOrDie()->SerializeAsString(),
+              Eq(keyset_.SerializeAsString()));
+}
+
+TEST_F(SaxJsonKeysetReaderTest, ReadsOutputOfJsonKeysetWriter) {
+  std::stringbuf buffer;
+  auto writer_result = JsonKeysetWriter::New(
+      absl::make_unique<std::ostream>(&buffer));
+  ASSERT_THAT(writer_result.status(), IsOk());
+  ASSERT_THAT(writer_result.ValueOrDie()->Write(keyset_), IsOk());
+  auto read_result = ReadKeyset(buffer.str());
+  ASSERT_THAT(read_result.status(), IsOk());
+  EXPECT_THAT(read_result.ValueOrDie()->SerializeAsString(),
+              Eq(keyset_.SerializeAsString()));
+}
+
+TEST_F(SaxJsonKeysetReaderTest, SkipsUnknownFields) {
+  auto read_result = ReadKeyset(JsonKeyset(
+      R"("unknown":{"keyId":[1,{"status":2}],"key":{}},"other":null,)"));
+  ASSERT_THAT(read_result.status(), IsOk());
+  EXPECT_THAT(read_result.ValueOrDie()->SerializeAsString(),
+              Eq(keyset_.SerializeAsString()));
+}
+
+TEST_F(SaxJsonKeysetReaderTest, ReadLargeKeyId) {
+  std::string json = JsonKeyset();
+  absl::StrReplaceAll({{":42", ":4294967275"}}, &json);
+  auto read_result = ReadKeyset(json);
+  ASSERT_THAT(read_result.status(), IsOk());
+  EXPECT_THAT(read_result.ValueOrDie()->primary_key_id(), Eq(4294967275));
+  EXPECT_THAT(read_result.ValueOrDie()->key(0).key_id(), Eq(4294967275));
+}
+
+TEST_F(SaxJsonKeysetReaderTest, InvalidKeysets) {
+  std::string json = JsonKeyset();
+  for (absl::string_view invalid_json : {
+           "",
+           "some weird string",
+           "[]",
+           R"({"primaryKeyId":42})",
+           R"({"primaryKeyId":42,"key":[]})",
+           R"({"primaryKeyId":42,"key":{}})",
+           R"({"primaryKeyId":42,"key":[1]})",
+           R"({"primaryKeyId":-1,"key":[{}]})",
+           R"({"primaryKeyId":"42","key":[{}]})",
+       }) {
+    SCOPED_TRACE(invalid_json);
+    EXPECT_THAT(ReadKeyset(invalid_json).status(),
+                StatusIs(util::error::INVALID_ARGUMENT));
+  }
+  for (absl::string_view extra_fields : {
+           R"("keyId":43,)",
+           R"("status":"DISABLED",)",
+           R"("keyData":{},)",
+       }) {
+    SCOPED_TRACE(extra_fields);
+    EXPECT_THAT(ReadKeyset(JsonKeyset(extra_fields)).status(),
+                StatusIs(util::error::INVALID_ARGUMENT));
+  }
+  for (const auto& replacement : std::vector<std::pair<std::string,
+                                                       std::string>>{
+           {R"("keyId":42)", R"("keyId":-42)"},
+           {R"("keyId":42)", R"("keyId":42.5)"},
+           {R"("keyId":42)", R"("keyId":"42")"},
+           {R"("status":"ENABLED")", R"("status":1)"},
+           {R"("value": ")", R"("value": "!)"},
+           {R"("keyMaterialType":"SYMMETRIC",)", ""},
+           {R"("outputPrefixType":"TINK",)", ""},
+       }) {
+    SCOPED_TRACE(replacement.second);
+    std::string modified = json;
+    ASSERT_GT(absl::StrReplaceAll({replacement}, &modified), 0);
+    EXPECT_THAT(ReadKeyset(modified).status(),
+                StatusIs(util::error::INVALID_ARGUMENT));
+  }
+  // Trailing data.
+  EXPECT_THAT(ReadKeyset(json + " {}").status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST_F(SaxJsonKeysetReaderTest, AcceptsWhatJsonKeysetReaderAccepts) {
+  std::string json = JsonKeyset(R"("extra":[{"a":true}],)");
+  auto expected_result = JsonKeysetReader::New(json).ValueOrDie()->Read();
+  ASSERT_THAT(expected_result.status(), IsOk());
+  auto read_result = ReadKeyset(json);
+  ASSERT_THAT(read_result.status(), IsOk());
+  EXPECT_THAT(read_result.ValueOrDie()->SerializeAsString(),
+              Eq(expected_result.ValueOrDie()->SerializeAsString()));
+}
+
+TEST_F(SaxJsonKeysetReaderTest, ReadEncrypted) {
+  EncryptedKeyset encrypted_keyset;
+  encrypted_keyset.set_encrypted_keyset("some ciphertext with keyset");
+  encrypted_keyset.mutable_keyset_info()->set_primary_key_id(42);
+  std::string json = absl::Substitute(
+      R"({"encryptedKeyset":"$0","keysetInfo":{"primaryKeyId":42,)"
+      R"("keyInfo":[{"typeUrl":"type.googleapis.com/google.crypto.tink.)"
+      R"(AesGcmKey","outputPrefixType":"TINK","keyId":42,)"
+      R"("status":"ENABLED"}]}})",
+      absl::Base64Escape(encrypted_keyset.encrypted_keyset()));
+  auto* key_info = encrypted_keyset.mutable_keyset_info()->add_key_info();
+  key_info->set_type_url("type.googleapis.com/google.crypto.tink.AesGcmKey");
+  key_info->set_key_id(42);
+  key_info->set_output_prefix_type(OutputPrefixType::TINK);
+  key_info->set_status(KeyStatusType::ENABLED);
+
+  auto reader_result = SaxJsonKeysetReader::New(json);
+  ASSERT_THAT(reader_result.status(), IsOk());
+  auto read_result = reader_result.ValueOrDie()->ReadEncrypted();
+  ASSERT_THAT(read_result.status(), IsOk());
+  EXPECT_THAT(read_result.ValueOrDie()->SerializeAsString(),
+              Eq(encrypted_keyset.SerializeAsString()));
+
+  EXPECT_THAT(SaxJsonKeysetReader::New("some weird string")
+                  .ValueOrDie()
+                  ->ReadEncrypted()
+                  .status(),
+              Not(IsOk()));
+}
+
+}  // namespace
+}  // namespace tink
+}  // namespace crypto
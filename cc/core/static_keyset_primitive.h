@@ -0,0 +1,190 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+#ifndef TINK_CORE_STATIC_KEYSET_PRIMITIVE_H_
+#define TINK_CORE_STATIC_KEYSET_PRIMITIVE_H_
+
+#include <cstddef>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "absl/meta/type_traits.h"
+#include "absl/strings/str_cat.h"
+#include "tink/core/template_util.h"
+#include "tink/internal/key_info.h"
+#include "tink/keyset_handle.h"
+#include "tink/primitive_set.h"
+#include "tink/primitive_wrapper.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "tink/util/validation.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+
+namespace internal {
+
+// Defines ::value as true if the KeyTypeManager can create a Primitive.
+template <typename Primitive, typename KeyTypeManager>
+struct ManagerSupportsPrimitive;
+template <typename Primitive, typename KeyTypeManager, typename PrimitiveList>
+struct ManagerSupportsPrimitiveImpl;
+template <typename Primitive, typename KeyTypeManager, typename... Primitives>
+struct ManagerSupportsPrimitiveImpl<Primitive, KeyTypeManager,
+                                    List<Primitives...>>
+    : public OccursInTuple<Primitive, std::tuple<Primitives...>> {};
+template <typename Primitive, typename KeyTypeManager>
+struct ManagerSupportsPrimitive
+    : public ManagerSupportsPrimitiveImpl<
+          Primitive, KeyTypeManager, typename KeyTypeManager::PrimitiveList> {
+};
+
+}  // namespace internal
+
+// Creates primitives of keysets whose key types are known at build time,
+// without the Registry: there is no global registration, key managers are
+// not looked up in maps, and the KeyTypeManagers are called directly, so the
+// compiler can inline them. Only the code of the listed key types is linked.
+// Example:
+//
+//   StaticKeysetPrimitive<Aead, AesGcmKeyManager, XChaCha20Poly1305KeyManager>
+//       aead_factory(absl::make_unique<AeadWrapper>());
+//   auto aead_result = aead_factory.GetPrimitive(*keyset_handle);
+//
+// Keys of other types fail with INVALID_ARGUMENT. The KeyTypeManagers must
+// be default constructible. Thread-safe; the returned primitives may outlive
+// the StaticKeysetPrimitive.
+template <typename P, typename... KeyTypeManagers>
+class StaticKeysetPrimitive {
+ public:
+  static_assert(sizeof...(KeyTypeManagers) > 0,
+                "At least one KeyTypeManager is required.");
+  static_assert(!internal::HasDuplicates<KeyTypeManagers...>::value,
+                "List of KeyTypeManagers contains a duplicate.");
+  static_assert(
+      absl::conjunction<
+          internal::ManagerSupportsPrimitive<P, KeyTypeManagers>...>::value,
+      "All KeyTypeManagers must support the primitive.");
+
+  // Wraps the primitives of the keys with 'wrapper', e.g. an AeadWrapper.
+  explicit StaticKeysetPrimitive(
+      std::unique_ptr<PrimitiveWrapper<P, P>> wrapper)
+      : managers_(std::make_shared<const Managers>()),
+        wrapper_(std::move(wrapper)) {}
+
+  // Creates the wrapped primitive of the keyset of 'handle'.
+  crypto::tink::util::StatusOr<std::unique_ptr<P>> GetPrimitive(
+      const KeysetHandle& handle) const {
+    return GetPrimitive(handle.get_keyset());
+  }
+
+  // Creates the wrapped primitive of 'keyset'.
+  crypto::tink::util::StatusOr<std::unique_ptr<P>> GetPrimitive(
+      const google::crypto::tink::Keyset& keyset) const;
+
+  // Creates the primitive of a single key.
+  crypto::tink::util::StatusOr<std::unique_ptr<P>> GetKeyPrimitive(
+      const google::crypto::tink::KeyData& key_data) const {
+    return GetKeyPrimitiveImpl<0>(*managers_, key_data);
+  }
+
+ private:
+  using Managers = std::tuple<KeyTypeManagers...>;
+
+  // Tries the I-th and later KeyTypeManagers.
+  // TODO(C++17) replace with `constexpr if` after migration
+  template <std::size_t I>
+  static typename std::enable_if<
+      I == sizeof...(KeyTypeManagers),
+      crypto::tink::util::StatusOr<std::unique_ptr<P>>>::type
+  GetKeyPrimitiveImpl(const Managers& managers,
+                      const google::crypto::tink::KeyData& key_data) {
+    return crypto::tink::util::Status(
+        util::error::INVALID_ARGUMENT,
+        absl::StrCat("Key type '", key_data.type_url(),
+                     "' is not supported by this StaticKeysetPrimitive."));
+  }
+  template <std::size_t I>
+  static typename std::enable_if<
+      (I < sizeof...(KeyTypeManagers)),
+      crypto::tink::util::StatusOr<std::unique_ptr<P>>>::type
+  GetKeyPrimitiveImpl(const Managers& managers,
+                      const google::crypto::tink::KeyData& key_data) {
+    const auto& manager = std::get<I>(managers);
+    if (key_data.type_url() != manager.get_key_type()) {
+      return GetKeyPrimitiveImpl<I + 1>(managers, key_data);
+    }
+    typename std::tuple_element<I, Managers>::type::KeyProto key_proto;
+    if (!key_proto.ParseFromString(key_data.value())) {
+      return crypto::tink::util::Status(
+          util::error::INVALID_ARGUMENT,
+          absl::StrCat("Could not parse key_data.value as key type '",
+                       key_data.type_url(), "'."));
+    }
+    auto validation = manager.ValidateKey(key_proto);
+    if (!validation.ok()) return validation;
+    return manager.template GetPrimitive<P>(key_proto);
+  }
+
+  // Shared with the lazy primitives of the returned primitives.
+  const std::shared_ptr<const Managers> managers_;
+  const std::unique_ptr<PrimitiveWrapper<P, P>> wrapper_;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Implementation details of templated methods.
+
+template <typename P, typename... KeyTypeManagers>
+crypto::tink::util::StatusOr<std::unique_ptr<P>>
+StaticKeysetPrimitive<P, KeyTypeManagers...>::GetPrimitive(
+    const google::crypto::tink::Keyset& keyset) const {
+  crypto::tink::util::Status status = ValidateKeyset(keyset);
+  if (!status.ok()) return status;
+  typename PrimitiveSet<P>::Builder primitives_builder;
+  for (const google::crypto::tink::Keyset::Key& key : keyset.key()) {
+    if (key.status() != google::crypto::tink::KeyStatusType::ENABLED) {
+      continue;
+    }
+    if (key.key_id() != keyset.primary_key_id() &&
+        wrapper_->SupportsLazyPrimitives()) {
+      std::shared_ptr<const Managers> managers = managers_;
+      google::crypto::tink::KeyData key_data = key.key_data();
+      primitives_builder.AddLazyPrimitive(
+          [managers, key_data]() {
+            return GetKeyPrimitiveImpl<0>(*managers, key_data);
+          },
+          KeyInfoFromKey(key));
+      continue;
+    }
+    auto primitive = GetKeyPrimitiveImpl<0>(*managers_, key.key_data());
+    if (!primitive.ok()) return primitive.status();
+    if (key.key_id() == keyset.primary_key_id()) {
+      primitives_builder.AddPrimaryPrimitive(
+          std::move(primitive.ValueOrDie()), KeyInfoFromKey(key));
+    } else {
+      primitives_builder.AddPrimitive(std::move(primitive.ValueOrDie()),
+                                      KeyInfoFromKey(key));
+    }
+  }
+  auto primitives_result = primitives_builder.Build();
+  if (!primitives_result.ok()) return primitives_result.status();
+  return wrapper_->Wrap(std::move(primitives_result.ValueOrDie()));
+}
+
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_CORE_STATIC_KEYSET_PRIMITIVE_H_
@@ -0,0 +1,174 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/core/static_keyset_primitive.h"
+
+#include <memory>
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "tink/aead.h"
+#include "tink/aead/aead_wrapper.h"
+#include "tink/aead/aes_eax_key_manager.h"
+#include "tink/aead/aes_gcm_key_manager.h"
+#include "tink/aead/xchacha20_poly1305_key_manager.h"
+#include "tink/keyset_handle.h"
+#include "tink/util/status.h"
+#include "tink/util/test_keyset_handle.h"
+#include "tink/util/test_matchers.h"
+#include "tink/util/test_util.h"
+#include "proto/aes_eax.pb.h"
+#include "proto/aes_gcm.pb.h"
+#include "proto/tink.pb.h"
+#include "proto/xchacha20_poly1305.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace {
+
+using ::crypto::tink::test::AddRawKey;
+using ::crypto::tink::test::AddTinkKey;
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::google::crypto::tink::AesEaxKeyFormat;
+using ::google::crypto::tink::AesGcmKeyFormat;
+using ::google::crypto::tink::KeyData;
+using ::google::crypto::tink::Keyset;
+using ::google::crypto::tink::KeyStatusType;
+using ::google::crypto::tink::XChaCha20Poly1305KeyFormat;
+using ::testing::Eq;
+using ::testing::HasSubstr;
+
+using StaticAead = StaticKeysetPrimitive<Aead, AesGcmKeyManager,
+                                         XChaCha20Poly1305KeyManager>;
+
+// Returns a keyset with an AES-GCM key 1 and an XChaCha20Poly1305 key 2.
+Keyset NewKeyset(uint32_t primary_key_id) {
+  AesGcmKeyFormat aes_gcm_format;
+  aes_gcm_format.set_key_size(16);
+  auto aes_gcm_key = AesGcmKeyManager().CreateKey(aes_gcm_format);
+  EXPECT_THAT(aes_gcm_key.status(), IsOk());
+  auto xchacha_key =
+      XChaCha20Poly1305KeyManager().CreateKey(XChaCha20Poly1305KeyFormat());
+  EXPECT_THAT(xchacha_key.status(), IsOk());
+
+  Keyset keyset;
+  AddTinkKey(AesGcmKeyManager().get_key_type(), 1, aes_gcm_key.ValueOrDie(),
+             KeyStatusType::ENABLED, KeyData::SYMMETRIC, &keyset);
+  AddRawKey(XChaCha20Poly1305KeyManager().get_key_type(), 2,
+            xchacha_key.ValueOrDie(), KeyStatusType::ENABLED,
+            KeyData::SYMMETRIC, &keyset);
+  keyset.set_primary_key_id(primary_key_id);
+  return keyset;
+}
+
+// None of the tests registers key managers: StaticKeysetPrimitive does not
+// use the Registry.
+TEST(StaticKeysetPrimitiveTest, EncryptDecrypt) {
+  StaticAead static_aead(absl::make_unique<AeadWrapper>());
+  std::string plaintext = "some plaintext";
+  std::string aad = "some aad";
+
+  for (uint32_t primary_key_id : {1, 2}) {
+    SCOPED_TRACE(primary_key_id);
+    auto handle =
+        TestKeysetHandle::GetKeysetHandle(NewKeyset(primary_key_id));
+    auto aead_result = static_aead.GetPrimitive(*handle);
+    ASSERT_THAT(aead_result.status(), IsOk());
+    auto aead = std::move(aead_result.ValueOrDie());
+    auto ciphertext = aead->Encrypt(plaintext, aad);
+    ASSERT_THAT(ciphertext.status(), IsOk());
+    auto decrypted = aead->Decrypt(ciphertext.ValueOrDie(), aad);
+    ASSERT_THAT(decrypted.status(), IsOk());
+    EXPECT_THAT(decrypted.ValueOrDie(), Eq(plaintext));
+  }
+}
+
+TEST(StaticKeysetPrimitiveTest, DecryptsWithNonPrimaryKey) {
+  StaticAead static_aead(absl::make_unique<AeadWrapper>());
+  Keyset keyset = NewKeyset(2);
+  auto old_aead = static_aead.GetPrimitive(keyset);
+  ASSERT_THAT(old_aead.status(), IsOk());
+  auto ciphertext = old_aead.ValueOrDie()->Encrypt("plaintext", "aad");
+  ASSERT_THAT(ciphertext.status(), IsOk());
+
+  keyset.set_primary_key_id(1);
+  auto new_aead = static_aead.GetPrimitive(keyset);
+  ASSERT_THAT(new_aead.status(), IsOk());
+  auto decrypted =
+      new_aead.ValueOrDie()->Decrypt(ciphertext.ValueOrDie(), "aad");
+  ASSERT_THAT(decrypted.status(), IsOk());
+  EXPECT_THAT(decrypted.ValueOrDie(), Eq("plaintext"));
+}
+
+TEST(StaticKeysetPrimitiveTest, PrimitiveOutlivesFactory) {
+  Keyset keyset = NewKeyset(1);
+  std::unique_ptr<Aead> aead;
+  {
+    StaticAead static_aead(absl::make_unique<AeadWrapper>());
+    auto aead_result = static_aead.GetPrimitive(keyset);
+    ASSERT_THAT(aead_result.status(), IsOk());
+    aead = std::move(aead_result.ValueOrDie());
+  }
+  // Decrypting with the non-primary key creates its primitive now.
+  keyset.set_primary_key_id(2);
+  StaticAead other_static_aead(absl::make_unique<AeadWrapper>());
+  auto ciphertext =
+      other_static_aead.GetPrimitive(keyset).ValueOrDie()->Encrypt("a", "b");
+  ASSERT_THAT(ciphertext.status(), IsOk());
+  EXPECT_THAT(aead->Decrypt(ciphertext.ValueOrDie(), "b").status(), IsOk());
+}
+
+TEST(StaticKeysetPrimitiveTest, UnsupportedKeyType) {
+  StaticAead static_aead(absl::make_unique<AeadWrapper>());
+  AesEaxKeyFormat aes_eax_format;
+  aes_eax_format.set_key_size(16);
+  aes_eax_format.mutable_params()->set_iv_size(16);
+  auto aes_eax_key = AesEaxKeyManager().CreateKey(aes_eax_format);
+  ASSERT_THAT(aes_eax_key.status(), IsOk());
+  Keyset keyset;
+  AddTinkKey(AesEaxKeyManager().get_key_type(), 1, aes_eax_key.ValueOrDie(),
+             KeyStatusType::ENABLED, KeyData::SYMMETRIC, &keyset);
+  keyset.set_primary_key_id(1);
+
+  EXPECT_THAT(static_aead.GetPrimitive(keyset).status(),
+              StatusIs(util::error::INVALID_ARGUMENT,
+                       HasSubstr("not supported")));
+  EXPECT_THAT(static_aead.GetKeyPrimitive(keyset.key(0).key_data()).status(),
+              StatusIs(util::error::INVALID_ARGUMENT,
+                       HasSubstr("not supported")));
+}
+
+TEST(StaticKeysetPrimitiveTest, InvalidKey) {
+  StaticAead static_aead(absl::make_unique<AeadWrapper>());
+  KeyData key_data;
+  key_data.set_type_url(AesGcmKeyManager().get_key_type());
+  key_data.set_value("not a key");
+  key_data.set_key_material_type(KeyData::SYMMETRIC);
+  EXPECT_THAT(static_aead.GetKeyPrimitive(key_data).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(StaticKeysetPrimitiveTest, InvalidKeyset) {
+  StaticAead static_aead(absl::make_unique<AeadWrapper>());
+  Keyset keyset = NewKeyset(3);
+  EXPECT_THAT(static_aead.GetPrimitive(keyset).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,170 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/thread_local_primitive.h"
+
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "tink/keyset_handle.h"
+#include "tink/keyset_manager.h"
+#include "tink/mac.h"
+#include "tink/mac/mac_config.h"
+#include "tink/mac/mac_key_templates.h"
+#include "tink/util/status.h"
+#include "tink/util/test_matchers.h"
+
+namespace crypto {
+namespace tink {
+namespace {
+
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::testing::Eq;
+using ::testing::Ne;
+using ::testing::Not;
+
+class ThreadLocalPrimitiveTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_THAT(MacConfig::Register(), IsOk());
+    manager_ = std::move(
+        KeysetManager::New(MacKeyTemplates::HmacSha256HalfSizeTag())
+            .ValueOrDie());
+  }
+
+  // Returns the tag of the primary key of the current keyset.
+  std::string ExpectedTag() {
+    auto mac = manager_->GetKeysetHandle()->GetPrimitive<Mac>().ValueOrDie();
+    return mac->ComputeMac("data").ValueOrDie();
+  }
+
+  // Returns the primitive which Get() returns on a new thread.
+  static Mac* GetOnNewThread(const ThreadLocalPrimitive<Mac>& primitive) {
+    Mac* mac = nullptr;
+    std::thread thread([&primitive, &mac]() { mac = primitive.Get(); });
+    thread.join();
+    return mac;
+  }
+
+  std::unique_ptr<KeysetManager> manager_;
+};
+
+TEST_F(ThreadLocalPrimitiveTest, NegativeMaxClones) {
+  EXPECT_THAT(
+      ThreadLocalPrimitive<Mac>::New(*manager_->GetKeysetHandle(), -1)
+          .status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST_F(ThreadLocalPrimitiveTest, OneClonePerThread) {
+  auto result =
+      ThreadLocalPrimitive<Mac>::New(*manager_->GetKeysetHandle(), 10);
+  ASSERT_THAT(result.status(), IsOk());
+  const ThreadLocalPrimitive<Mac>& primitive = *result.ValueOrDie();
+  std::string tag = ExpectedTag();
+
+  Mac* mac = primitive.Get();
+  EXPECT_THAT(primitive.Get(), Eq(mac));
+  EXPECT_THAT(mac->ComputeMac("data").ValueOrDie(), Eq(tag));
+  EXPECT_THAT(primitive.num_clones(), Eq(1));
+
+  std::vector<std::thread> threads;
+  std::vector<Mac*> macs(4);
+  std::vector<std::string> tags(4);
+  for (int i = 0; i < 4; i++) {
+    threads.emplace_back([&primitive, &macs, &tags, i]() {
+      macs[i] = primitive.Get();
+      tags[i] = macs[i]->ComputeMac("data").ValueOrDie();
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+  EXPECT_THAT(primitive.num_clones(), Eq(5));
+  std::set<Mac*> distinct_macs(macs.begin(), macs.end());
+  distinct_macs.insert(mac);
+  EXPECT_THAT(distinct_macs.size(), Eq(5));
+  for (const std::string& thread_tag : tags) {
+    EXPECT_THAT(thread_tag, Eq(tag));
+  }
+}
+
+TEST_F(ThreadLocalPrimitiveTest, ThreadsBeyondMaxClonesShare) {
+  auto result = ThreadLocalPrimitive<Mac>::New(*manager_->GetKeysetHandle(), 1);
+  ASSERT_THAT(result.status(), IsOk());
+  const ThreadLocalPrimitive<Mac>& primitive = *result.ValueOrDie();
+  Mac* clone = primitive.Get();
+  Mac* shared = GetOnNewThread(primitive);
+  EXPECT_THAT(shared, Ne(clone));
+  EXPECT_THAT(GetOnNewThread(primitive), Eq(shared));
+  EXPECT_THAT(primitive.num_clones(), Eq(1));
+}
+
+TEST_F(ThreadLocalPrimitiveTest, UpdateReplacesClones) {
+  auto result =
+      ThreadLocalPrimitive<Mac>::New(*manager_->GetKeysetHandle(), 10);
+  ASSERT_THAT(result.status(), IsOk());
+  ThreadLocalPrimitive<Mac>& primitive = *result.ValueOrDie();
+  std::string old_tag = ExpectedTag();
+  Mac* mac = primitive.Get();
+
+  // An unchanged keyset is not rebuilt.
+  ASSERT_THAT(primitive.Update(*manager_->GetKeysetHandle()), IsOk());
+  EXPECT_THAT(primitive.generation(), Eq(1));
+  EXPECT_THAT(primitive.Get(), Eq(mac));
+
+  ASSERT_THAT(
+      manager_->Rotate(MacKeyTemplates::HmacSha256HalfSizeTag()).status(),
+      IsOk());
+  ASSERT_THAT(primitive.Update(*manager_->GetKeysetHandle()), IsOk());
+  EXPECT_THAT(primitive.generation(), Eq(2));
+  EXPECT_THAT(primitive.num_clones(), Eq(0));
+  // The clone stays valid until the thread calls Get() again.
+  EXPECT_THAT(mac->ComputeMac("data").ValueOrDie(), Eq(old_tag));
+
+  std::string new_tag = ExpectedTag();
+  EXPECT_THAT(new_tag, Not(Eq(old_tag)));
+  EXPECT_THAT(primitive.Get()->ComputeMac("data").ValueOrDie(), Eq(new_tag));
+  EXPECT_THAT(primitive.Get()->VerifyMac(old_tag, "data"), IsOk());
+  EXPECT_THAT(primitive.num_clones(), Eq(1));
+}
+
+TEST_F(ThreadLocalPrimitiveTest, IndependentInstances) {
+  auto first = ThreadLocalPrimitive<Mac>::New(*manager_->GetKeysetHandle(), 1);
+  ASSERT_THAT(first.status(), IsOk());
+  Mac* first_mac = first.ValueOrDie()->Get();
+
+  auto second =
+      ThreadLocalPrimitive<Mac>::New(*manager_->GetKeysetHandle(), 1);
+  ASSERT_THAT(second.status(), IsOk());
+  Mac* second_mac = second.ValueOrDie()->Get();
+  EXPECT_THAT(second_mac, Ne(first_mac));
+  EXPECT_THAT(first.ValueOrDie()->Get(), Eq(first_mac));
+
+  // The clones of the thread for a destroyed instance are dropped.
+  first.ValueOrDie().reset();
+  EXPECT_THAT(second.ValueOrDie()->Get(), Eq(second_mac));
+  EXPECT_THAT(second_mac->ComputeMac("data").ValueOrDie(), Eq(ExpectedTag()));
+}
+
+}  // namespace
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,71 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/tracing.h"
+
+#include <atomic>
+#include <memory>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+
+namespace crypto {
+namespace tink {
+
+namespace {
+
+struct GlobalClient {
+  absl::Mutex mutex;
+  std::shared_ptr<TracingClient> client ABSL_GUARDED_BY(mutex);
+  // Whether 'client' is set, so that spans without a client take no lock.
+  std::atomic<bool> has_client{false};
+};
+
+GlobalClient& GlobalInstance() {
+  static GlobalClient* instance = new GlobalClient();
+  return *instance;
+}
+
+}  // namespace
+
+// static
+void Tracing::SetClient(std::shared_ptr<TracingClient> client) {
+  GlobalClient& global = GlobalInstance();
+  absl::MutexLock lock(&global.mutex);
+  global.has_client.store(client != nullptr, std::memory_order_release);
+  // The previous client is released after the lock.
+  global.client.swap(client);
+}
+
+// static
+std::shared_ptr<TracingClient> Tracing::GetClient() {
+  GlobalClient& global = GlobalInstance();
+  if (!global.has_client.load(std::memory_order_acquire)) return nullptr;
+  absl::MutexLock lock(&global.mutex);
+  return global.client;
+}
+
+// static
+bool Tracing::IsCompiledIn() {
+#ifdef TINK_ENABLE_TRACING
+  return true;
+#else
+  return false;
+#endif
+}
+
+}  // namespace tink
+}  // namespace crypto
@@ -17,14 +17,73 @@
 #ifndef TINK_CRYPTO_FORMAT_H_
 #define TINK_CRYPTO_FORMAT_H_
 
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
 #include <vector>
 
+#include "absl/strings/string_view.h"
 #include "tink/util/statusor.h"
 #include "proto/tink.pb.h"
 
 namespace crypto {
 namespace tink {
 
+// The prefix of the outputs of a key: empty for RAW keys, otherwise a start
+// byte followed by the 4-byte big-endian key id. Unlike a std::string it is
+// a fixed-size value which never allocates, and can be built at compile time.
+class OutputPrefix {
+ public:
+  static constexpr int kMaxSize = 5;
+
+  // The empty (RAW) prefix.
+  constexpr OutputPrefix() : bytes_{}, size_(0) {}
+
+  // The prefix 'start_byte' || big-endian 'key_id'.
+  constexpr OutputPrefix(uint8_t start_byte, uint32_t key_id)
+      : bytes_{{static_cast<char>(start_byte),
+                static_cast<char>((key_id >> 24) & 0xff),
+                static_cast<char>((key_id >> 16) & 0xff),
+                static_cast<char>((key_id >> 8) & 0xff),
+                static_cast<char>(key_id & 0xff)}},
+        size_(kMaxSize) {}
+
+  constexpr size_t size() const { return size_; }
+  constexpr bool empty() const { return size_ == 0; }
+  const char* data() const { return bytes_.data(); }
+  constexpr char operator[](size_t i) const { return bytes_[i]; }
+
+  absl::string_view view() const { return absl::string_view(data(), size_); }
+  operator absl::string_view() const { return view(); }  // NOLINT
+
+  // The prefix as big-endian integer, which orders like the bytes of
+  // prefixes of the same size. 0 for the empty prefix.
+  constexpr uint64_t AsInteger() const {
+    return size_ == 0 ? 0
+                      : (static_cast<uint64_t>(Byte(0)) << 32) |
+                            (static_cast<uint64_t>(Byte(1)) << 24) |
+                            (static_cast<uint64_t>(Byte(2)) << 16) |
+                            (static_cast<uint64_t>(Byte(3)) << 8) |
+                            static_cast<uint64_t>(Byte(4));
+  }
+
+  bool operator==(const OutputPrefix& other) const {
+    return view() == other.view();
+  }
+  bool operator!=(const OutputPrefix& other) const {
+    return !(*this == other);
+  }
+
+ private:
+  constexpr uint8_t Byte(size_t i) const {
+    return static_cast<uint8_t>(bytes_[i]);
+  }
+
+  std::array<char, kMaxSize> bytes_;
+  uint8_t size_;
+};
+
 // Constants and convenience methods that deal with the format
 // of the outputs handled by Tink.
 class CryptoFormat {
@@ -44,8 +103,22 @@ class CryptoFormat {
   static constexpr int kRawPrefixSize = 0;
   static const absl::string_view kRawPrefix;  // empty string
 
+  // Returns the prefix of a TINK key with id 'key_id'.
+  static constexpr OutputPrefix TinkPrefix(uint32_t key_id) {
+    return OutputPrefix(kTinkStartByte, key_id);
+  }
+
+  // Returns the prefix of a LEGACY or CRUNCHY key with id 'key_id'.
+  static constexpr OutputPrefix LegacyPrefix(uint32_t key_id) {
+    return OutputPrefix(kLegacyStartByte, key_id);
+  }
+
   // Generates the prefix for the outputs handled with the given key_info.
   // Returns an error if the prefix type 'output_prefix_type' is invalid.
+  static crypto::tink::util::StatusOr<OutputPrefix> GetFixedOutputPrefix(
+      const google::crypto::tink::KeysetInfo::KeyInfo& key_info);
+
+  // As GetFixedOutputPrefix(), but returns the prefix as a string.
   static crypto::tink::util::StatusOr<std::string> GetOutputPrefix(
       const google::crypto::tink::KeysetInfo::KeyInfo& key_info);
 };
@@ -0,0 +1,131 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/daead/aes_gcm_siv_deterministic_key_manager.h"
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "tink/config/tink_fips.h"
+#include "tink/deterministic_aead.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "tink/util/test_matchers.h"
+#include "proto/aes_gcm_siv_deterministic.pb.h"
+
+namespace crypto {
+namespace tink {
+
+using ::crypto::tink::test::IsOk;
+using ::google::crypto::tink::AesGcmSivDeterministicKey;
+using ::google::crypto::tink::AesGcmSivDeterministicKeyFormat;
+using ::testing::Eq;
+using ::testing::Ne;
+using ::testing::Not;
+using ::testing::SizeIs;
+
+namespace {
+
+TEST(AesGcmSivDeterministicKeyManagerTest, Basics) {
+  EXPECT_THAT(AesGcmSivDeterministicKeyManager().get_version(), Eq(0));
+  EXPECT_THAT(
+      AesGcmSivDeterministicKeyManager().get_key_type(),
+      Eq("type.googleapis.com/google.crypto.tink.AesGcmSivDeterministicKey"));
+  EXPECT_THAT(AesGcmSivDeterministicKeyManager().key_material_type(),
+              Eq(google::crypto::tink::KeyData::SYMMETRIC));
+}
+
+TEST(AesGcmSivDeterministicKeyManagerTest, ValidateEmptyKey) {
+  EXPECT_THAT(AesGcmSivDeterministicKeyManager().ValidateKey(
+                  AesGcmSivDeterministicKey()),
+              Not(IsOk()));
+}
+
+TEST(AesGcmSivDeterministicKeyManagerTest, ValidateKeyFormat) {
+  AesGcmSivDeterministicKeyFormat format;
+  format.set_key_size(64);
+  EXPECT_THAT(AesGcmSivDeterministicKeyManager().ValidateKeyFormat(format),
+              IsOk());
+  for (int i : {0, 16, 32, 63, 65, 128}) {
+    format.set_key_size(i);
+    EXPECT_THAT(AesGcmSivDeterministicKeyManager().ValidateKeyFormat(format),
+                Not(IsOk()))
+        << " for length " << i;
+  }
+}
+
+TEST(AesGcmSivDeterministicKeyManagerTest, CreateKey) {
+  AesGcmSivDeterministicKeyFormat format;
+  format.set_key_size(64);
+  AesGcmSivDeterministicKeyManager manager;
+  auto key_or = manager.CreateKey(format);
+  ASSERT_THAT(key_or.status(), IsOk());
+  EXPECT_THAT(key_or.ValueOrDie().key_value(), SizeIs(format.key_size()));
+  EXPECT_THAT(key_or.ValueOrDie().version(), Eq(0));
+  EXPECT_THAT(manager.ValidateKey(key_or.ValueOrDie()), IsOk());
+  auto other_key_or = manager.CreateKey(format);
+  ASSERT_THAT(other_key_or.status(), IsOk());
+  EXPECT_THAT(key_or.ValueOrDie().key_value(),
+              Ne(other_key_or.ValueOrDie().key_value()));
+}
+
+TEST(AesGcmSivDeterministicKeyManagerTest, ValidateKey) {
+  AesGcmSivDeterministicKey key;
+  key.set_version(0);
+  *key.mutable_key_value() = std::string(64, 'a');
+  EXPECT_THAT(AesGcmSivDeterministicKeyManager().ValidateKey(key), IsOk());
+  for (int i : {0, 16, 32, 63, 65, 128}) {
+    *key.mutable_key_value() = std::string(i, 'a');
+    EXPECT_THAT(AesGcmSivDeterministicKeyManager().ValidateKey(key),
+                Not(IsOk()))
+        << " for length " << i;
+  }
+  *key.mutable_key_value() = std::string(64, 'a');
+  key.set_version(1);
+  EXPECT_THAT(AesGcmSivDeterministicKeyManager().ValidateKey(key),
+              Not(IsOk()));
+}
+
+TEST(AesGcmSivDeterministicKeyManagerTest, GetPrimitive) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  AesGcmSivDeterministicKeyFormat format;
+  format.set_key_size(64);
+  auto key_or = AesGcmSivDeterministicKeyManager().CreateKey(format);
+  ASSERT_THAT(key_or.status(), IsOk());
+  auto daead_or =
+      AesGcmSivDeterministicKeyManager().GetPrimitive<DeterministicAead>(
+          key_or.ValueOrDie());
+  ASSERT_THAT(daead_or.status(), IsOk());
+
+  auto direct_daead_or = subtle::AesGcmSivDeterministicBoringSsl::New(
+      util::SecretDataFromStringView(key_or.ValueOrDie().key_value()));
+  ASSERT_THAT(direct_daead_or.status(), IsOk());
+
+  auto encryption_or =
+      daead_or.ValueOrDie()->EncryptDeterministically("123", "abcd");
+  ASSERT_THAT(encryption_or.status(), IsOk());
+  auto direct_encryption_or =
+      direct_daead_or.ValueOrDie()->EncryptDeterministically("123", "abcd");
+  ASSERT_THAT(direct_encryption_or.status(), IsOk());
+  EXPECT_THAT(encryption_or.ValueOrDie(),
+              Eq(direct_encryption_or.ValueOrDie()));
+}
+
+}  // namespace
+}  // namespace tink
+}  // namespace crypto
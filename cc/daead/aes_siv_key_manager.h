@@ -20,6 +20,7 @@
 
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
 #include "tink/core/key_type_manager.h"
 #include "tink/deterministic_aead.h"
 #include "tink/subtle/aes_siv_boringssl.h"
@@ -47,6 +48,20 @@ class AesSivKeyManager
       return subtle::AesSivBoringSsl::New(
           util::SecretDataFromStringView(key.key_value()));
     }
+
+    crypto::tink::util::StatusOr<std::unique_ptr<DeterministicAead>>
+    CreateFromSerialized(absl::string_view serialized_key) const override {
+      internal::KeyFieldsParser parser;
+      if (!parser.Parse(serialized_key)) {
+        return std::unique_ptr<DeterministicAead>();
+      }
+      absl::string_view key_value = parser.bytes(2);
+      crypto::tink::util::Status status = ValidateKeyFields(
+          static_cast<uint32_t>(parser.varint(1)), key_value.size());
+      if (!status.ok()) return status;
+      return subtle::AesSivBoringSsl::New(
+          util::SecretDataFromStringView(key_value));
+    }
   };
 
   AesSivKeyManager()
@@ -63,10 +78,7 @@ class AesSivKeyManager
 
   crypto::tink::util::Status ValidateKey(
       const google::crypto::tink::AesSivKey& key) const override {
-    crypto::tink::util::Status status =
-        ValidateVersion(key.version(), get_version());
-    if (!status.ok()) return status;
-    return ValidateKeySize(key.key_value().size());
+    return ValidateKeyFields(key.version(), key.key_value().size());
   }
 
   crypto::tink::util::Status ValidateKeyFormat(
@@ -83,7 +95,15 @@ class AesSivKeyManager
   }
 
  private:
-  crypto::tink::util::Status ValidateKeySize(uint32_t key_size) const {
+  static crypto::tink::util::Status ValidateKeyFields(uint32_t version,
+                                                      size_t key_size) {
+    crypto::tink::util::Status status =
+        ValidateVersion(version, /*max_expected=*/0);
+    if (!status.ok()) return status;
+    return ValidateKeySize(key_size);
+  }
+
+  static crypto::tink::util::Status ValidateKeySize(uint32_t key_size) {
     if (key_size != 64) {
       return crypto::tink::util::Status(
           crypto::tink::util::error::INVALID_ARGUMENT,
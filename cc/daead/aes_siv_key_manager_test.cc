@@ -29,6 +29,7 @@ namespace crypto {
 namespace tink {
 
 using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
 using ::google::crypto::tink::AesSivKey;
 using ::google::crypto::tink::AesSivKeyFormat;
 using ::testing::Eq;
@@ -155,6 +156,54 @@ TEST(AesSivKeyManagerTest, GetPrimitive) {
               Eq(direct_encryption_or.ValueOrDie()));
 }
 
+TEST(AesSivKeyManagerTest, GetPrimitiveFromSerialized) {
+  AesSivKeyFormat format;
+  format.set_key_size(64);
+  AesSivKey key = AesSivKeyManager().CreateKey(format).ValueOrDie();
+  auto serialized_daead_or =
+      AesSivKeyManager().GetPrimitiveFromSerialized<DeterministicAead>(
+          key.SerializeAsString());
+  ASSERT_THAT(serialized_daead_or.status(), IsOk());
+  ASSERT_THAT(serialized_daead_or.ValueOrDie(), Ne(nullptr));
+  auto daead_or = AesSivKeyManager().GetPrimitive<DeterministicAead>(key);
+  ASSERT_THAT(daead_or.status(), IsOk());
+
+  auto encryption_or =
+      serialized_daead_or.ValueOrDie()->EncryptDeterministically("123",
+                                                                 "abcd");
+  ASSERT_THAT(encryption_or.status(), IsOk());
+  auto direct_encryption_or =
+      daead_or.ValueOrDie()->EncryptDeterministically("123", "abcd");
+  ASSERT_THAT(direct_encryption_or.status(), IsOk());
+  EXPECT_THAT(encryption_or.ValueOrDie(),
+              Eq(direct_encryption_or.ValueOrDie()));
+}
+
+TEST(AesSivKeyManagerTest, GetPrimitiveFromSerializedValidatesKey) {
+  AesSivKey key;
+  key.set_key_value(std::string(32, 'a'));
+  EXPECT_THAT(AesSivKeyManager()
+                  .GetPrimitiveFromSerialized<DeterministicAead>(
+                      key.SerializeAsString())
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  key.set_key_value(std::string(64, 'a'));
+  key.set_version(1);
+  EXPECT_THAT(AesSivKeyManager()
+                  .GetPrimitiveFromSerialized<DeterministicAead>(
+                      key.SerializeAsString())
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(AesSivKeyManagerTest, GetPrimitiveFromSerializedFallsBack) {
+  auto daead_or =
+      AesSivKeyManager().GetPrimitiveFromSerialized<DeterministicAead>(
+          "\x12\x40");
+  ASSERT_THAT(daead_or.status(), IsOk());
+  EXPECT_THAT(daead_or.ValueOrDie(), Eq(nullptr));
+}
+
 }  // namespace
 }  // namespace tink
 }  // namespace crypto
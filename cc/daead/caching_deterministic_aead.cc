@@ -0,0 +1,273 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/daead/caching_deterministic_aead.h"
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/hash/hash.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "openssl/mem.h"
+#include "tink/deterministic_aead.h"
+#include "tink/subtle/subtle_util.h"
+#include "tink/util/cache_budget.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+
+namespace {
+
+// The memory counted for each entry in addition to its key and value, for
+// the list node, the index slot and the string headers.
+constexpr int64_t kEntryOverhead = 128;
+
+// Returns the cache key of the result of an operation on 'input', where
+// 'operation' distinguishes encryptions from decryptions.
+std::string MakeKey(char operation, absl::string_view associated_data,
+                    absl::string_view input) {
+  std::string key(1, operation);
+  key.reserve(5 + associated_data.size() + input.size());
+  key.append(subtle::BigEndian32(associated_data.size()));
+  key.append(associated_data.data(), associated_data.size());
+  key.append(input.data(), input.size());
+  return key;
+}
+
+void Cleanse(std::string* s) {
+  if (!s->empty()) OPENSSL_cleanse(&(*s)[0], s->size());
+}
+
+}  // namespace
+
+// A part of the cache, with least recently used eviction.
+class CachingDeterministicAead::Shard {
+ public:
+  explicit Shard(int64_t max_memory_bytes)
+      : max_memory_bytes_(max_memory_bytes) {}
+
+  ~Shard() {
+    absl::MutexLock lock(&mutex_);
+    for (Entry& entry : entries_) Erase(&entry);
+  }
+
+  // Sets '*output' to the cached result for 'key', if there is one.
+  bool Lookup(absl::string_view key, std::string* output) {
+    absl::MutexLock lock(&mutex_);
+    auto it = index_.find(key);
+    if (it == index_.end()) return false;
+    entries_.splice(entries_.begin(), entries_, it->second);
+    *output = it->second->value;
+    return true;
+  }
+
+  // Returns by how much the memory of the shard grew.
+  int64_t Insert(std::string key, absl::string_view value) {
+    int64_t size = key.size() + value.size() + kEntryOverhead;
+    if (size > max_memory_bytes_) {
+      Cleanse(&key);
+      return 0;
+    }
+    absl::MutexLock lock(&mutex_);
+    if (index_.contains(key)) {
+      // Another thread computed the same result concurrently.
+      Cleanse(&key);
+      return 0;
+    }
+    int64_t old_memory_bytes = memory_bytes_;
+    while (memory_bytes_ + size > max_memory_bytes_) {
+      Erase(&entries_.back());
+      entries_.pop_back();
+    }
+    entries_.push_front({std::move(key), std::string(value)});
+    index_.emplace(entries_.front().key, entries_.begin());
+    memory_bytes_ += size;
+    return memory_bytes_ - old_memory_bytes;
+  }
+
+  // Evicts the least recently used entries holding at least 'bytes', and
+  // returns the number of bytes freed.
+  int64_t Evict(int64_t bytes) {
+    absl::MutexLock lock(&mutex_);
+    int64_t old_memory_bytes = memory_bytes_;
+    while (old_memory_bytes - memory_bytes_ < bytes && !entries_.empty()) {
+      Erase(&entries_.back());
+      entries_.pop_back();
+    }
+    return old_memory_bytes - memory_bytes_;
+  }
+
+  void AddStats(Stats* stats) const {
+    absl::MutexLock lock(&mutex_);
+    stats->entries += entries_.size();
+    stats->memory_bytes += memory_bytes_;
+  }
+
+ private:
+  struct Entry {
+    std::string key;
+    std::string value;
+  };
+
+  // Removes 'entry' from the index and zeroes its contents. The entry
+  // itself must be removed from entries_ by the caller.
+  void Erase(Entry* entry) ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_) {
+    index_.erase(entry->key);
+    memory_bytes_ -= entry->key.size() + entry->value.size() + kEntryOverhead;
+    Cleanse(&entry->key);
+    Cleanse(&entry->value);
+  }
+
+  const int64_t max_memory_bytes_;
+  mutable absl::Mutex mutex_;
+  // Most recently used first.
+  std::list<Entry> entries_ ABSL_GUARDED_BY(mutex_);
+  // The keys point into the entries.
+  absl::flat_hash_map<absl::string_view, std::list<Entry>::iterator> index_
+      ABSL_GUARDED_BY(mutex_);
+  int64_t memory_bytes_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+// static
+util::StatusOr<std::unique_ptr<CachingDeterministicAead>>
+CachingDeterministicAead::New(std::unique_ptr<DeterministicAead> daead,
+                              Options options) {
+  if (daead == nullptr) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "daead must be non-null");
+  }
+  if (options.max_memory_bytes <= 0) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "max_memory_bytes must be positive");
+  }
+  if (options.shard_count <= 0) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "shard_count must be positive");
+  }
+  auto caching_daead = absl::WrapUnique(
+      new CachingDeterministicAead(std::move(daead), options));
+  if (options.budget != nullptr) {
+    auto registration_result = options.budget->Register(
+        "caching_deterministic_aead", options.budget_cost,
+        caching_daead.get());
+    if (!registration_result.ok()) return registration_result.status();
+    caching_daead->budget_registration_ =
+        std::move(registration_result.ValueOrDie());
+  }
+  return {std::move(caching_daead)};
+}
+
+CachingDeterministicAead::CachingDeterministicAead(
+    std::unique_ptr<DeterministicAead> daead, const Options& options)
+    : daead_(std::move(daead)) {
+  int64_t shard_memory_bytes = options.max_memory_bytes / options.shard_count;
+  for (int i = 0; i < options.shard_count; i++) {
+    shards_.push_back(absl::make_unique<Shard>(shard_memory_bytes));
+  }
+}
+
+CachingDeterministicAead::~CachingDeterministicAead() {}
+
+CachingDeterministicAead::Shard* CachingDeterministicAead::GetShard(
+    absl::string_view key) const {
+  size_t hash = absl::Hash<absl::string_view>()(key);
+  return shards_[hash % shards_.size()].get();
+}
+
+void CachingDeterministicAead::Insert(std::string key,
+                                      absl::string_view output) const {
+  Shard* shard = GetShard(key);
+  int64_t delta = shard->Insert(std::move(key), output);
+  if (budget_registration_ != nullptr && delta != 0) {
+    budget_registration_->Add(delta);
+  }
+}
+
+int64_t CachingDeterministicAead::Evict(int64_t bytes) {
+  // The shards are used evenly, so they give up equal parts first.
+  int64_t shard_count = shards_.size();
+  int64_t shard_bytes = (bytes + shard_count - 1) / shard_count;
+  int64_t freed = 0;
+  for (const auto& shard : shards_) freed += shard->Evict(shard_bytes);
+  for (const auto& shard : shards_) {
+    if (freed >= bytes) break;
+    freed += shard->Evict(bytes - freed);
+  }
+  return freed;
+}
+
+util::StatusOr<std::string> CachingDeterministicAead::EncryptDeterministically(
+    absl::string_view plaintext, absl::string_view associated_data) const {
+  std::string key = MakeKey('e', associated_data, plaintext);
+  std::string ciphertext;
+  if (GetShard(key)->Lookup(key, &ciphertext)) {
+    encrypt_hits_.fetch_add(1, std::memory_order_relaxed);
+    Cleanse(&key);
+    return ciphertext;
+  }
+  encrypt_misses_.fetch_add(1, std::memory_order_relaxed);
+  auto encrypt_result =
+      daead_->EncryptDeterministically(plaintext, associated_data);
+  if (!encrypt_result.ok()) {
+    Cleanse(&key);
+    return encrypt_result.status();
+  }
+  ciphertext = std::move(encrypt_result.ValueOrDie());
+  Insert(std::move(key), ciphertext);
+  Insert(MakeKey('d', associated_data, ciphertext), plaintext);
+  return ciphertext;
+}
+
+util::StatusOr<std::string> CachingDeterministicAead::DecryptDeterministically(
+    absl::string_view ciphertext, absl::string_view associated_data) const {
+  std::string key = MakeKey('d', associated_data, ciphertext);
+  std::string plaintext;
+  if (GetShard(key)->Lookup(key, &plaintext)) {
+    decrypt_hits_.fetch_add(1, std::memory_order_relaxed);
+    return plaintext;
+  }
+  decrypt_misses_.fetch_add(1, std::memory_order_relaxed);
+  auto decrypt_result =
+      daead_->DecryptDeterministically(ciphertext, associated_data);
+  if (!decrypt_result.ok()) return decrypt_result.status();
+  plaintext = std::move(decrypt_result.ValueOrDie());
+  Insert(std::move(key), plaintext);
+  return plaintext;
+}
+
+CachingDeterministicAead::Stats CachingDeterministicAead::GetStats() const {
+  Stats stats;
+  stats.encrypt_hits = encrypt_hits_.load(std::memory_order_relaxed);
+  stats.encrypt_misses = encrypt_misses_.load(std::memory_order_relaxed);
+  stats.decrypt_hits = decrypt_hits_.load(std::memory_order_relaxed);
+  stats.decrypt_misses = decrypt_misses_.load(std::memory_order_relaxed);
+  for (const auto& shard : shards_) shard->AddStats(&stats);
+  return stats;
+}
+
+}  // namespace tink
+}  // namespace crypto
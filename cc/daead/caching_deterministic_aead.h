@@ -0,0 +1,129 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_DAEAD_CACHING_DETERMINISTIC_AEAD_H_
+#define TINK_DAEAD_CACHING_DETERMINISTIC_AEAD_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "tink/deterministic_aead.h"
+#include "tink/util/cache_budget.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+
+// A DeterministicAead that remembers the results of recent encryptions and
+// decryptions of another DeterministicAead, typically the primitive
+// returned by DeterministicAeadWrapper for a keyset. Since a deterministic
+// encryption maps the same (plaintext, associated data) pair always to the
+// same ciphertext, a workload which encrypts the same values repeatedly,
+// like tokenization of skewed data, can be served mostly from the cache.
+// The result of an encryption is also remembered as the result of the
+// decryption of its ciphertext. Decryptions are not remembered as
+// encryptions, since the ciphertext may belong to a key which is not the
+// primary.
+//
+// The cache is split into shards, each with its own lock and least recently
+// used eviction, so that instances can be used concurrently. Evicted entries
+// are overwritten with zeros before their memory is freed.
+//
+// With Options::budget, the cache also counts against a util::CacheBudget
+// shared with other caches, which evicts its least recently used entries
+// when the caches together exceed the budget.
+//
+// Security: the cache holds plaintexts in memory for longer than the
+// wrapped primitive would, and the time of a call reveals whether its
+// inputs were processed recently. Use it only where neither matters.
+class CachingDeterministicAead : public DeterministicAead,
+                                 private util::CacheBudget::Cache {
+ public:
+  struct Options {
+    // The maximal number of bytes held by the cache, counting its entries
+    // and a small constant overhead per entry. Must be positive.
+    int64_t max_memory_bytes = 16 << 20;
+    // The number of independently locked parts of the cache. Must be
+    // positive.
+    int shard_count = 16;
+    // An optional budget shared with other caches, in addition to
+    // max_memory_bytes.
+    std::shared_ptr<util::CacheBudget> budget;
+    // The relative cost of recomputing the entries, for the budget. Must be
+    // positive if 'budget' is set.
+    double budget_cost = 1;
+  };
+
+  struct Stats {
+    int64_t encrypt_hits = 0;
+    int64_t encrypt_misses = 0;
+    int64_t decrypt_hits = 0;
+    int64_t decrypt_misses = 0;
+    // The number of cached results, and the memory they use.
+    int64_t entries = 0;
+    int64_t memory_bytes = 0;
+  };
+
+  static crypto::tink::util::StatusOr<
+      std::unique_ptr<CachingDeterministicAead>>
+  New(std::unique_ptr<DeterministicAead> daead, Options options);
+
+  ~CachingDeterministicAead() override;
+
+  crypto::tink::util::StatusOr<std::string> EncryptDeterministically(
+      absl::string_view plaintext,
+      absl::string_view associated_data) const override;
+
+  crypto::tink::util::StatusOr<std::string> DecryptDeterministically(
+      absl::string_view ciphertext,
+      absl::string_view associated_data) const override;
+
+  Stats GetStats() const;
+
+ private:
+  class Shard;
+
+  CachingDeterministicAead(std::unique_ptr<DeterministicAead> daead,
+                           const Options& options);
+
+  // Returns the shard for the entry with the given 'key'.
+  Shard* GetShard(absl::string_view key) const;
+
+  // Stores 'output' as the cached result for 'key'.
+  void Insert(std::string key, absl::string_view output) const;
+
+  // Evicts the least recently used entries of all shards, for the budget.
+  int64_t Evict(int64_t bytes) override;
+
+  const std::unique_ptr<DeterministicAead> daead_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+  mutable std::atomic<int64_t> encrypt_hits_{0};
+  mutable std::atomic<int64_t> encrypt_misses_{0};
+  mutable std::atomic<int64_t> decrypt_hits_{0};
+  mutable std::atomic<int64_t> decrypt_misses_{0};
+  // Destroyed before the shards, so that the budget does not evict from
+  // them meanwhile.
+  std::unique_ptr<util::CacheBudget::Registration> budget_registration_;
+};
+
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_DAEAD_CACHING_DETERMINISTIC_AEAD_H_
@@ -0,0 +1,267 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/daead/caching_deterministic_aead.h"
+
+#include <atomic>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "tink/deterministic_aead.h"
+#include "tink/util/cache_budget.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "tink/util/test_matchers.h"
+#include "tink/util/test_util.h"
+
+namespace crypto {
+namespace tink {
+namespace {
+
+using ::crypto::tink::test::DummyDeterministicAead;
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+
+// A DeterministicAead which counts the calls to the wrapped one.
+class CountingDeterministicAead : public DeterministicAead {
+ public:
+  explicit CountingDeterministicAead(std::atomic<int>* calls)
+      : daead_("daead"), calls_(calls) {}
+
+  util::StatusOr<std::string> EncryptDeterministically(
+      absl::string_view plaintext,
+      absl::string_view associated_data) const override {
+    (*calls_)++;
+    return daead_.EncryptDeterministically(plaintext, associated_data);
+  }
+
+  util::StatusOr<std::string> DecryptDeterministically(
+      absl::string_view ciphertext,
+      absl::string_view associated_data) const override {
+    (*calls_)++;
+    return daead_.DecryptDeterministically(ciphertext, associated_data);
+  }
+
+ private:
+  DummyDeterministicAead daead_;
+  std::atomic<int>* calls_;
+};
+
+std::unique_ptr<CachingDeterministicAead> NewCache(
+    std::atomic<int>* calls, CachingDeterministicAead::Options options) {
+  auto result = CachingDeterministicAead::New(
+      absl::make_unique<CountingDeterministicAead>(calls), options);
+  EXPECT_THAT(result.status(), IsOk());
+  return std::move(result.ValueOrDie());
+}
+
+TEST(CachingDeterministicAeadTest, CachesResults) {
+  std::atomic<int> calls{0};
+  auto cache = NewCache(&calls, CachingDeterministicAead::Options());
+  DummyDeterministicAead expected_daead("daead");
+  std::string expected_ciphertext =
+      expected_daead.EncryptDeterministically("plaintext", "aad").ValueOrDie();
+
+  for (int i = 0; i < 3; i++) {
+    auto encrypt_result = cache->EncryptDeterministically("plaintext", "aad");
+    ASSERT_THAT(encrypt_result.status(), IsOk());
+    EXPECT_EQ(expected_ciphertext, encrypt_result.ValueOrDie());
+  }
+  EXPECT_EQ(1, calls);
+  // The ciphertext of an encryption is decrypted from the cache.
+  auto decrypt_result =
+      cache->DecryptDeterministically(expected_ciphertext, "aad");
+  ASSERT_THAT(decrypt_result.status(), IsOk());
+  EXPECT_EQ("plaintext", decrypt_result.ValueOrDie());
+  EXPECT_EQ(1, calls);
+
+  // The associated data is part of the cache key.
+  EXPECT_NE(expected_ciphertext,
+            cache->EncryptDeterministically("plaintext", "other aad")
+                .ValueOrDie());
+  EXPECT_NE(cache->EncryptDeterministically("plaintexta", "ad").ValueOrDie(),
+            cache->EncryptDeterministically("plaintext", "aad").ValueOrDie());
+  EXPECT_EQ(3, calls);
+
+  CachingDeterministicAead::Stats stats = cache->GetStats();
+  EXPECT_EQ(3, stats.encrypt_hits);
+  EXPECT_EQ(3, stats.encrypt_misses);
+  EXPECT_EQ(1, stats.decrypt_hits);
+  EXPECT_EQ(0, stats.decrypt_misses);
+  EXPECT_EQ(6, stats.entries);
+  EXPECT_GT(stats.memory_bytes, 0);
+}
+
+TEST(CachingDeterministicAeadTest, DecryptionsAreNotCachedAsEncryptions) {
+  std::atomic<int> calls{0};
+  auto cache = NewCache(&calls, CachingDeterministicAead::Options());
+  std::string ciphertext = DummyDeterministicAead("daead")
+                               .EncryptDeterministically("plaintext", "aad")
+                               .ValueOrDie();
+  EXPECT_EQ("plaintext",
+            cache->DecryptDeterministically(ciphertext, "aad").ValueOrDie());
+  EXPECT_EQ("plaintext",
+            cache->DecryptDeterministically(ciphertext, "aad").ValueOrDie());
+  EXPECT_EQ(1, calls);
+  EXPECT_EQ(ciphertext,
+            cache->EncryptDeterministically("plaintext", "aad").ValueOrDie());
+  EXPECT_EQ(2, calls);
+}
+
+TEST(CachingDeterministicAeadTest, ErrorsAreNotCached) {
+  std::atomic<int> calls{0};
+  auto cache = NewCache(&calls, CachingDeterministicAead::Options());
+  for (int i = 0; i < 2; i++) {
+    EXPECT_THAT(
+        cache->DecryptDeterministically("invalid ciphertext", "aad").status(),
+        StatusIs(util::error::INVALID_ARGUMENT));
+  }
+  EXPECT_EQ(2, calls);
+  EXPECT_EQ(0, cache->GetStats().entries);
+}
+
+TEST(CachingDeterministicAeadTest, EvictsLeastRecentlyUsed) {
+  std::atomic<int> calls{0};
+  CachingDeterministicAead::Options options;
+  options.shard_count = 1;
+  options.max_memory_bytes = 10000;
+  auto cache = NewCache(&calls, options);
+  for (int i = 0; i < 1000; i++) {
+    ASSERT_THAT(
+        cache->EncryptDeterministically(absl::StrCat("value ", i), "aad")
+            .status(),
+        IsOk());
+    // Keeps the first value recently used.
+    ASSERT_THAT(cache->EncryptDeterministically("value 0", "aad").status(),
+                IsOk());
+  }
+  CachingDeterministicAead::Stats stats = cache->GetStats();
+  EXPECT_LE(stats.memory_bytes, options.max_memory_bytes);
+  EXPECT_LT(stats.entries, 100);
+  EXPECT_EQ(1000, calls);
+  EXPECT_EQ(1000, stats.encrypt_hits);
+
+  // Entries larger than the cache are not stored.
+  std::string large_value(options.max_memory_bytes, 'a');
+  ASSERT_THAT(cache->EncryptDeterministically(large_value, "aad").status(),
+              IsOk());
+  ASSERT_THAT(cache->EncryptDeterministically(large_value, "aad").status(),
+              IsOk());
+  EXPECT_EQ(1002, calls);
+}
+
+TEST(CachingDeterministicAeadTest, SharesBudget) {
+  std::shared_ptr<util::CacheBudget> budget =
+      util::CacheBudget::New(20000).ValueOrDie();
+  std::atomic<int> calls{0};
+  CachingDeterministicAead::Options options;
+  options.shard_count = 2;
+  options.max_memory_bytes = 1 << 20;
+  options.budget = budget;
+  auto first_cache = NewCache(&calls, options);
+  auto second_cache = NewCache(&calls, options);
+  for (int i = 0; i < 200; i++) {
+    std::string plaintext = absl::StrCat("value ", i);
+    ASSERT_THAT(first_cache->EncryptDeterministically(plaintext, "aad")
+                    .status(),
+                IsOk());
+    ASSERT_THAT(second_cache->EncryptDeterministically(plaintext, "aad")
+                    .status(),
+                IsOk());
+  }
+  CachingDeterministicAead::Stats first_stats = first_cache->GetStats();
+  CachingDeterministicAead::Stats second_stats = second_cache->GetStats();
+  EXPECT_LE(first_stats.memory_bytes + second_stats.memory_bytes, 20000);
+  EXPECT_GT(first_stats.entries, 0);
+  EXPECT_GT(second_stats.entries, 0);
+  EXPECT_EQ(budget->used_bytes(),
+            first_stats.memory_bytes + second_stats.memory_bytes);
+
+  budget->HandleMemoryPressure(1);
+  EXPECT_EQ(0, first_cache->GetStats().entries);
+  EXPECT_EQ(0, second_cache->GetStats().entries);
+  EXPECT_EQ(0, budget->used_bytes());
+
+  ASSERT_THAT(first_cache->EncryptDeterministically("value", "aad").status(),
+              IsOk());
+  EXPECT_EQ(budget->used_bytes(), first_cache->GetStats().memory_bytes);
+  first_cache.reset();
+  EXPECT_EQ(0, budget->used_bytes());
+
+  options.budget_cost = 0;
+  EXPECT_THAT(CachingDeterministicAead::New(
+                  absl::make_unique<DummyDeterministicAead>("daead"), options)
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(CachingDeterministicAeadTest, InvalidOptions) {
+  CachingDeterministicAead::Options options;
+  EXPECT_THAT(CachingDeterministicAead::New(nullptr, options).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  options.max_memory_bytes = 0;
+  EXPECT_THAT(CachingDeterministicAead::New(
+                  absl::make_unique<DummyDeterministicAead>("daead"), options)
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  options.max_memory_bytes = 1000;
+  options.shard_count = 0;
+  EXPECT_THAT(CachingDeterministicAead::New(
+                  absl::make_unique<DummyDeterministicAead>("daead"), options)
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(CachingDeterministicAeadTest, ConcurrentUse) {
+  std::atomic<int> calls{0};
+  CachingDeterministicAead::Options options;
+  options.max_memory_bytes = 1 << 16;
+  options.shard_count = 4;
+  auto cache = NewCache(&calls, options);
+  DummyDeterministicAead expected_daead("daead");
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&cache, &expected_daead, t]() {
+      for (int i = 0; i < 500; i++) {
+        std::string plaintext = absl::StrCat("value ", (i * (t + 1)) % 50);
+        auto encrypt_result =
+            cache->EncryptDeterministically(plaintext, "aad");
+        ASSERT_TRUE(encrypt_result.ok());
+        ASSERT_EQ(
+            expected_daead.EncryptDeterministically(plaintext, "aad")
+                .ValueOrDie(),
+            encrypt_result.ValueOrDie());
+        auto decrypt_result = cache->DecryptDeterministically(
+            encrypt_result.ValueOrDie(), "aad");
+        ASSERT_TRUE(decrypt_result.ok());
+        ASSERT_EQ(plaintext, decrypt_result.ValueOrDie());
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  CachingDeterministicAead::Stats stats = cache->GetStats();
+  EXPECT_EQ(2000, stats.encrypt_hits + stats.encrypt_misses);
+  EXPECT_GT(stats.encrypt_hits, stats.encrypt_misses);
+}
+
+}  // namespace
+}  // namespace tink
+}  // namespace crypto
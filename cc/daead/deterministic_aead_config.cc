@@ -19,6 +19,7 @@
 #include "absl/memory/memory.h"
 #include "tink/config/config_util.h"
 #include "tink/config/tink_fips.h"
+#include "tink/daead/aes_gcm_siv_deterministic_key_manager.h"
 #include "tink/daead/aes_siv_key_manager.h"
 #include "tink/daead/deterministic_aead_wrapper.h"
 #include "tink/registry.h"
@@ -45,8 +46,10 @@ util::Status DeterministicAeadConfig::Register() {
   }
 
   // Register non-FIPS key managers.
-  auto status = Registry::RegisterKeyTypeManager(
-      absl::make_unique<AesSivKeyManager>(), true);
+  auto status = Registry::RegisterKeyTypeManagerLazily<AesSivKeyManager>(true);
+  if (!status.ok()) return status;
+  status = Registry::RegisterKeyTypeManagerLazily<
+      AesGcmSivDeterministicKeyManager>(true);
   if (!status.ok()) return status;
 
   // Register primitive wrapper.
@@ -22,6 +22,7 @@
 #include "gtest/gtest.h"
 #include "tink/config.h"
 #include "tink/config/tink_fips.h"
+#include "tink/daead/aes_gcm_siv_deterministic_key_manager.h"
 #include "tink/daead/aes_siv_key_manager.h"
 #include "tink/daead/deterministic_aead_key_templates.h"
 #include "tink/deterministic_aead.h"
@@ -54,11 +55,19 @@ TEST_F(DeterministicAeadConfigTest, Basic) {
                   AesSivKeyManager().get_key_type())
                   .status(),
               StatusIs(util::error::NOT_FOUND));
+  EXPECT_THAT(Registry::get_key_manager<DeterministicAead>(
+                  AesGcmSivDeterministicKeyManager().get_key_type())
+                  .status(),
+              StatusIs(util::error::NOT_FOUND));
   EXPECT_THAT(DeterministicAeadConfig::Register(), IsOk());
   EXPECT_THAT(Registry::get_key_manager<DeterministicAead>(
                   AesSivKeyManager().get_key_type())
                   .status(),
               IsOk());
+  EXPECT_THAT(Registry::get_key_manager<DeterministicAead>(
+                  AesGcmSivDeterministicKeyManager().get_key_type())
+                  .status(),
+              IsOk());
 }
 
 // Tests that the DeterministicAeadWrapper has been properly registered and we
@@ -111,6 +120,8 @@ TEST_F(DeterministicAeadConfigTest, RegisterFipsValidTemplates) {
   // Check that we can not retrieve non-FIPS key handle
   std::list<google::crypto::tink::KeyTemplate> non_fips_key_templates;
   non_fips_key_templates.push_back(DeterministicAeadKeyTemplates::Aes256Siv());
+  non_fips_key_templates.push_back(
+      DeterministicAeadKeyTemplates::Aes256GcmSivDeterministic());
 
   for (auto key_template : non_fips_key_templates) {
     auto new_keyset_handle_result = KeysetHandle::GenerateNew(key_template);
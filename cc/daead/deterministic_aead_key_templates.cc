@@ -16,10 +16,12 @@
 
 #include "tink/daead/deterministic_aead_key_templates.h"
 
+#include "proto/aes_gcm_siv_deterministic.pb.h"
 #include "proto/aes_siv.pb.h"
 #include "proto/common.pb.h"
 #include "proto/tink.pb.h"
 
+using google::crypto::tink::AesGcmSivDeterministicKeyFormat;
 using google::crypto::tink::AesSivKeyFormat;
 using google::crypto::tink::KeyTemplate;
 using google::crypto::tink::OutputPrefixType;
@@ -40,6 +42,17 @@ KeyTemplate* NewAesSivKeyTemplate(int key_size_in_bytes) {
   return key_template;
 }
 
+KeyTemplate* NewAesGcmSivDeterministicKeyTemplate(int key_size_in_bytes) {
+  KeyTemplate* key_template = new KeyTemplate;
+  key_template->set_type_url(
+      "type.googleapis.com/google.crypto.tink.AesGcmSivDeterministicKey");
+  key_template->set_output_prefix_type(OutputPrefixType::TINK);
+  AesGcmSivDeterministicKeyFormat key_format;
+  key_format.set_key_size(key_size_in_bytes);
+  key_format.SerializeToString(key_template->mutable_value());
+  return key_template;
+}
+
 }  // anonymous namespace
 
 // static
@@ -49,5 +62,12 @@ const KeyTemplate& DeterministicAeadKeyTemplates::Aes256Siv() {
   return *key_template;
 }
 
+// static
+const KeyTemplate& DeterministicAeadKeyTemplates::Aes256GcmSivDeterministic() {
+  static const KeyTemplate* key_template =
+      NewAesGcmSivDeterministicKeyTemplate(/* key_size_in_bytes= */ 64);
+  return *key_template;
+}
+
 }  // namespace tink
 }  // namespace crypto
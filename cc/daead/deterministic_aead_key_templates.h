@@ -40,6 +40,12 @@ class DeterministicAeadKeyTemplates {
   //   - key size: 64 bytes
   //   - OutputPrefixType: TINK
   static const google::crypto::tink::KeyTemplate& Aes256Siv();
+
+  // Returns a KeyTemplate that generates new instances of
+  // AesGcmSivDeterministicKey with the following parameters:
+  //   - key size: 64 bytes
+  //   - OutputPrefixType: TINK
+  static const google::crypto::tink::KeyTemplate& Aes256GcmSivDeterministic();
 };
 
 }  // namespace tink
@@ -16,8 +16,18 @@
 
 #include "tink/daead/deterministic_aead_wrapper.h"
 
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "tink/crypto_format.h"
 #include "tink/deterministic_aead.h"
+#include "tink/internal/tracing_span.h"
+#include "tink/memory_stats.h"
 #include "tink/primitive_set.h"
 #include "tink/subtle/subtle_util_boringssl.h"
 #include "tink/util/status.h"
@@ -39,11 +49,13 @@ util::Status Validate(PrimitiveSet<DeterministicAead>* daead_set) {
   return util::Status::OK;
 }
 
-class  DeterministicAeadSetWrapper : public DeterministicAead {
+class DeterministicAeadSetWrapper : public DeterministicAead,
+                                    public MemoryStatsSource {
  public:
-  explicit DeterministicAeadSetWrapper(
-      std::unique_ptr<PrimitiveSet<DeterministicAead>> daead_set)
-      : daead_set_(std::move(daead_set)) {}
+  DeterministicAeadSetWrapper(
+      std::unique_ptr<PrimitiveSet<DeterministicAead>> daead_set,
+      PrimitiveSet<DeterministicAead>::ResolvedPrimary primary)
+      : daead_set_(std::move(daead_set)), primary_(primary) {}
 
   crypto::tink::util::StatusOr<std::string> EncryptDeterministically(
       absl::string_view plaintext,
@@ -53,34 +65,51 @@ class  DeterministicAeadSetWrapper : public DeterministicAead {
       absl::string_view ciphertext,
       absl::string_view associated_data) const override;
 
+  crypto::tink::util::StatusOr<std::string>
+  EncryptDeterministicallyWithComponents(
+      absl::string_view plaintext,
+      absl::Span<const absl::string_view> associated_data) const override;
+
+  crypto::tink::util::StatusOr<std::string>
+  DecryptDeterministicallyWithComponents(
+      absl::string_view ciphertext,
+      absl::Span<const absl::string_view> associated_data) const override;
+
+  crypto::tink::util::Status EncryptDeterministicallyBatch(
+      absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs,
+      std::string* arena,
+      std::vector<absl::string_view>* ciphertexts) const override;
+
+  crypto::tink::util::Status DecryptDeterministicallyBatch(
+      absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs,
+      std::string* arena,
+      std::vector<absl::string_view>* plaintexts) const override;
+
+  MemoryStats GetMemoryStats() const override {
+    return daead_set_->GetMemoryStats("deterministic_aead", sizeof(*this));
+  }
+
   ~DeterministicAeadSetWrapper() override {}
 
  private:
+  // Decrypts 'ciphertext' with the primitives whose prefix matches it, then
+  // with the RAW primitives, where 'decrypt' is called with a primitive and
+  // the ciphertext without the prefix.
+  template <class Decrypt>
+  crypto::tink::util::StatusOr<std::string> DecryptWithMatchingPrimitives(
+      absl::string_view ciphertext, Decrypt decrypt) const;
+
   std::unique_ptr<PrimitiveSet<DeterministicAead>> daead_set_;
+  // Resolved once, since it is used by every encryption.
+  const PrimitiveSet<DeterministicAead>::ResolvedPrimary primary_;
 };
 
+template <class Decrypt>
 util::StatusOr<std::string>
-DeterministicAeadSetWrapper::EncryptDeterministically(
-    absl::string_view plaintext, absl::string_view associated_data) const {
-  // BoringSSL expects a non-null pointer for plaintext and additional_data,
-  // regardless of whether the size is 0.
-  plaintext = subtle::SubtleUtilBoringSSL::EnsureNonNull(plaintext);
-  associated_data = subtle::SubtleUtilBoringSSL::EnsureNonNull(associated_data);
-
-  auto encrypt_result =
-      daead_set_->get_primary()->get_primitive().EncryptDeterministically(
-          plaintext, associated_data);
-  if (!encrypt_result.ok()) return encrypt_result.status();
-  const std::string& key_id = daead_set_->get_primary()->get_identifier();
-  return key_id + encrypt_result.ValueOrDie();
-}
-
-util::StatusOr<std::string>
-DeterministicAeadSetWrapper::DecryptDeterministically(
-    absl::string_view ciphertext, absl::string_view associated_data) const {
-  // BoringSSL expects a non-null pointer for plaintext and additional_data,
-  // regardless of whether the size is 0.
-  associated_data = subtle::SubtleUtilBoringSSL::EnsureNonNull(associated_data);
+DeterministicAeadSetWrapper::DecryptWithMatchingPrimitives(
+    absl::string_view ciphertext, Decrypt decrypt) const {
+  internal::TracingSpan span("tink.deterministic_aead.decrypt");
+  span.AddBytes(ciphertext.size());
 
   if (ciphertext.length() > CryptoFormat::kNonRawPrefixSize) {
     absl::string_view key_id =
@@ -90,9 +119,11 @@ DeterministicAeadSetWrapper::DecryptDeterministically(
       absl::string_view raw_ciphertext =
           ciphertext.substr(CryptoFormat::kNonRawPrefixSize);
       for (auto& daead_entry : *(primitives_result.ValueOrDie())) {
-        DeterministicAead& daead = daead_entry->get_primitive();
-        auto decrypt_result =
-            daead.DecryptDeterministically(raw_ciphertext, associated_data);
+        auto daead_result = daead_entry->get_primitive_or_status();
+        if (!daead_result.ok()) continue;
+        DeterministicAead& daead = *daead_result.ValueOrDie();
+        span.AddKeyTrial();
+        auto decrypt_result = decrypt(daead, raw_ciphertext);
         if (decrypt_result.ok()) {
           return std::move(decrypt_result.ValueOrDie());
         } else {
@@ -106,15 +137,181 @@ DeterministicAeadSetWrapper::DecryptDeterministically(
   auto raw_primitives_result = daead_set_->get_raw_primitives();
   if (raw_primitives_result.ok()) {
     for (auto& daead_entry : *(raw_primitives_result.ValueOrDie())) {
-      DeterministicAead& daead = daead_entry->get_primitive();
-      auto decrypt_result =
-          daead.DecryptDeterministically(ciphertext, associated_data);
+      auto daead_result = daead_entry->get_primitive_or_status();
+      if (!daead_result.ok()) continue;
+      DeterministicAead& daead = *daead_result.ValueOrDie();
+      span.AddKeyTrial();
+      auto decrypt_result = decrypt(daead, ciphertext);
       if (decrypt_result.ok()) {
         return std::move(decrypt_result.ValueOrDie());
       }
     }
   }
-  return util::Status(util::error::INVALID_ARGUMENT, "decryption failed");
+  span.SetOk(false);
+  return util::DecryptionFailedError();
+}
+
+util::StatusOr<std::string>
+DeterministicAeadSetWrapper::EncryptDeterministically(
+    absl::string_view plaintext, absl::string_view associated_data) const {
+  // BoringSSL expects a non-null pointer for plaintext and additional_data,
+  // regardless of whether the size is 0.
+  plaintext = subtle::SubtleUtilBoringSSL::EnsureNonNull(plaintext);
+  associated_data = subtle::SubtleUtilBoringSSL::EnsureNonNull(associated_data);
+
+  auto encrypt_result =
+      primary_.primitive->EncryptDeterministically(plaintext, associated_data);
+  if (!encrypt_result.ok()) return encrypt_result.status();
+  return absl::StrCat(primary_.output_prefix.view(),
+                      encrypt_result.ValueOrDie());
+}
+
+util::StatusOr<std::string>
+DeterministicAeadSetWrapper::DecryptDeterministically(
+    absl::string_view ciphertext, absl::string_view associated_data) const {
+  // BoringSSL expects a non-null pointer for plaintext and additional_data,
+  // regardless of whether the size is 0.
+  associated_data = subtle::SubtleUtilBoringSSL::EnsureNonNull(associated_data);
+  return DecryptWithMatchingPrimitives(
+      ciphertext,
+      [associated_data](DeterministicAead& daead,
+                        absl::string_view raw_ciphertext) {
+        return daead.DecryptDeterministically(raw_ciphertext, associated_data);
+      });
+}
+
+util::StatusOr<std::string>
+DeterministicAeadSetWrapper::EncryptDeterministicallyWithComponents(
+    absl::string_view plaintext,
+    absl::Span<const absl::string_view> associated_data) const {
+  auto encrypt_result =
+      primary_.primitive->EncryptDeterministicallyWithComponents(
+          subtle::SubtleUtilBoringSSL::EnsureNonNull(plaintext),
+          associated_data);
+  if (!encrypt_result.ok()) return encrypt_result.status();
+  return absl::StrCat(primary_.output_prefix.view(),
+                      encrypt_result.ValueOrDie());
+}
+
+util::StatusOr<std::string>
+DeterministicAeadSetWrapper::DecryptDeterministicallyWithComponents(
+    absl::string_view ciphertext,
+    absl::Span<const absl::string_view> associated_data) const {
+  return DecryptWithMatchingPrimitives(
+      ciphertext,
+      [associated_data](DeterministicAead& daead,
+                        absl::string_view raw_ciphertext) {
+        return daead.DecryptDeterministicallyWithComponents(raw_ciphertext,
+                                                            associated_data);
+      });
+}
+
+util::Status DeterministicAeadSetWrapper::EncryptDeterministicallyBatch(
+    absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs,
+    std::string* arena, std::vector<absl::string_view>* ciphertexts) const {
+  // BoringSSL expects a non-null pointer for plaintext and additional_data,
+  // regardless of whether the size is 0.
+  std::vector<std::pair<absl::string_view, absl::string_view>> safe_inputs;
+  safe_inputs.reserve(inputs.size());
+  for (const auto& input : inputs) {
+    safe_inputs.emplace_back(
+        subtle::SubtleUtilBoringSSL::EnsureNonNull(input.first),
+        subtle::SubtleUtilBoringSSL::EnsureNonNull(input.second));
+  }
+
+  absl::string_view key_id = primary_.output_prefix;
+  DeterministicAead& daead = *primary_.primitive;
+  if (key_id.empty()) {
+    return daead.EncryptDeterministicallyBatch(safe_inputs, arena,
+                                               ciphertexts);
+  }
+  std::string raw_arena;
+  std::vector<absl::string_view> raw_ciphertexts;
+  auto status = daead.EncryptDeterministicallyBatch(safe_inputs, &raw_arena,
+                                                    &raw_ciphertexts);
+  if (!status.ok()) return status;
+  arena->clear();
+  arena->reserve(raw_arena.size() + inputs.size() * key_id.size());
+  std::vector<int64_t> sizes;
+  sizes.reserve(inputs.size());
+  for (absl::string_view raw_ciphertext : raw_ciphertexts) {
+    arena->append(key_id.data(), key_id.size());
+    arena->append(raw_ciphertext.data(), raw_ciphertext.size());
+    sizes.push_back(key_id.size() + raw_ciphertext.size());
+  }
+  SplitArena(*arena, sizes, ciphertexts);
+  return util::Status::OK;
+}
+
+util::Status DeterministicAeadSetWrapper::DecryptDeterministicallyBatch(
+    absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs,
+    std::string* arena, std::vector<absl::string_view>* plaintexts) const {
+  arena->clear();
+  std::vector<int64_t> sizes;
+  sizes.reserve(inputs.size());
+  std::vector<std::pair<absl::string_view, absl::string_view>> run;
+  std::string run_arena;
+  std::vector<absl::string_view> run_plaintexts;
+  size_t begin = 0;
+  while (begin < inputs.size()) {
+    // Batches are usually encrypted under a single key, so consecutive
+    // ciphertexts with the same prefix are decrypted together by the
+    // primitive of that prefix, if it is unique.
+    absl::string_view prefix;
+    if (inputs[begin].first.length() > CryptoFormat::kNonRawPrefixSize) {
+      prefix = inputs[begin].first.substr(0, CryptoFormat::kNonRawPrefixSize);
+    }
+    size_t end = begin + 1;
+    while (end < inputs.size() &&
+           inputs[end].first.length() > CryptoFormat::kNonRawPrefixSize &&
+           inputs[end].first.substr(0, CryptoFormat::kNonRawPrefixSize) ==
+               prefix) {
+      end++;
+    }
+    if (!prefix.empty()) {
+      auto primitives_result = daead_set_->get_primitives(prefix);
+      if (primitives_result.ok() &&
+          primitives_result.ValueOrDie()->size() == 1 &&
+          primitives_result.ValueOrDie()->front()->get_primitive_or_status()
+              .ok()) {
+        run.clear();
+        for (size_t i = begin; i < end; i++) {
+          run.emplace_back(
+              inputs[i].first.substr(CryptoFormat::kNonRawPrefixSize),
+              subtle::SubtleUtilBoringSSL::EnsureNonNull(inputs[i].second));
+        }
+        DeterministicAead& daead =
+            primitives_result.ValueOrDie()->front()->get_primitive();
+        if (daead.DecryptDeterministicallyBatch(run, &run_arena,
+                                                &run_plaintexts)
+                .ok()) {
+          arena->append(run_arena);
+          for (absl::string_view plaintext : run_plaintexts) {
+            sizes.push_back(plaintext.size());
+          }
+          begin = end;
+          continue;
+        }
+      }
+    }
+    // Otherwise, or if some ciphertext of the run does not decrypt with
+    // that primitive, the ciphertexts are decrypted one by one, which also
+    // tries the RAW primitives.
+    for (size_t i = begin; i < end; i++) {
+      auto decrypt_result =
+          DecryptDeterministically(inputs[i].first, inputs[i].second);
+      if (!decrypt_result.ok()) {
+        arena->clear();
+        plaintexts->clear();
+        return decrypt_result.status();
+      }
+      arena->append(decrypt_result.ValueOrDie());
+      sizes.push_back(decrypt_result.ValueOrDie().size());
+    }
+    begin = end;
+  }
+  SplitArena(*arena, sizes, plaintexts);
+  return util::Status::OK;
 }
 
 }  // anonymous namespace
@@ -124,8 +321,10 @@ DeterministicAeadWrapper::Wrap(
     std::unique_ptr<PrimitiveSet<DeterministicAead>> primitive_set) const {
   util::Status status = Validate(primitive_set.get());
   if (!status.ok()) return status;
-  std::unique_ptr<DeterministicAead> daead(
-      new DeterministicAeadSetWrapper(std::move(primitive_set)));
+  auto primary_result = primitive_set->ResolvePrimary();
+  if (!primary_result.ok()) return primary_result.status();
+  std::unique_ptr<DeterministicAead> daead(new DeterministicAeadSetWrapper(
+      std::move(primitive_set), primary_result.ValueOrDie()));
   return std::move(daead);
 }
 
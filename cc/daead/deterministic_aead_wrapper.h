@@ -42,6 +42,9 @@ class DeterministicAeadWrapper
   crypto::tink::util::StatusOr<std::unique_ptr<DeterministicAead>> Wrap(
       std::unique_ptr<PrimitiveSet<DeterministicAead>> primitive_set)
       const override;
+
+  // Primitives other than the primary are only used to decrypt.
+  bool SupportsLazyPrimitives() const override { return true; }
 };
 
 }  // namespace tink
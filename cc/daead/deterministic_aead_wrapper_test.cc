@@ -16,8 +16,14 @@
 
 #include "tink/daead/deterministic_aead_wrapper.h"
 
+#include <string>
+#include <utility>
+#include <vector>
+
 #include "gtest/gtest.h"
 #include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
 #include "tink/deterministic_aead.h"
 #include "tink/primitive_set.h"
 #include "tink/util/status.h"
@@ -134,6 +140,147 @@ TEST_F(DeterministicAeadSetWrapperTest, testBasic) {
   }
 }
 
+TEST_F(DeterministicAeadSetWrapperTest, testBatch) {
+  KeysetInfo keyset_info;
+  KeysetInfo::KeyInfo* key_info = keyset_info.add_key_info();
+  key_info->set_output_prefix_type(OutputPrefixType::TINK);
+  key_info->set_key_id(1234543);
+  key_info->set_status(KeyStatusType::ENABLED);
+  key_info = keyset_info.add_key_info();
+  key_info->set_output_prefix_type(OutputPrefixType::RAW);
+  key_info->set_key_id(726329);
+  key_info->set_status(KeyStatusType::ENABLED);
+  key_info = keyset_info.add_key_info();
+  key_info->set_output_prefix_type(OutputPrefixType::TINK);
+  key_info->set_key_id(7213743);
+  key_info->set_status(KeyStatusType::ENABLED);
+
+  auto daead_set = absl::make_unique<PrimitiveSet<DeterministicAead>>();
+  std::vector<std::unique_ptr<DeterministicAead>> single_key_daeads;
+  for (int i = 0; i < 3; i++) {
+    std::string name = absl::StrCat("daead", i);
+    auto entry_result = daead_set->AddPrimitive(
+        absl::make_unique<DummyDeterministicAead>(name),
+        keyset_info.key_info(i));
+    ASSERT_TRUE(entry_result.ok());
+    ASSERT_THAT(daead_set->set_primary(entry_result.ValueOrDie()), IsOk());
+
+    // A wrapper around the i-th key only, to produce its ciphertexts.
+    auto single_key_set = absl::make_unique<PrimitiveSet<DeterministicAead>>();
+    entry_result = single_key_set->AddPrimitive(
+        absl::make_unique<DummyDeterministicAead>(name),
+        keyset_info.key_info(i));
+    ASSERT_TRUE(entry_result.ok());
+    ASSERT_THAT(single_key_set->set_primary(entry_result.ValueOrDie()),
+                IsOk());
+    single_key_daeads.push_back(std::move(
+        DeterministicAeadWrapper().Wrap(std::move(single_key_set))
+            .ValueOrDie()));
+  }
+  auto daead =
+      std::move(DeterministicAeadWrapper().Wrap(std::move(daead_set))
+                    .ValueOrDie());
+
+  // Encryption uses the primary, like EncryptDeterministically().
+  std::vector<std::pair<absl::string_view, absl::string_view>> inputs = {
+      {"plaintext 0", "aad"}, {"", "aad"}, {"plaintext 2", ""}};
+  std::string arena;
+  std::vector<absl::string_view> ciphertexts;
+  ASSERT_THAT(daead->EncryptDeterministicallyBatch(inputs, &arena,
+                                                   &ciphertexts),
+              IsOk());
+  ASSERT_EQ(inputs.size(), ciphertexts.size());
+  for (size_t i = 0; i < inputs.size(); i++) {
+    EXPECT_EQ(daead->EncryptDeterministically(inputs[i].first,
+                                              inputs[i].second)
+                  .ValueOrDie(),
+              ciphertexts[i]);
+  }
+
+  // Decryption handles runs of ciphertexts of different keys.
+  std::vector<std::string> mixed_ciphertexts;
+  std::vector<std::pair<absl::string_view, absl::string_view>> mixed_inputs;
+  std::vector<std::string> plaintexts;
+  for (int key : {0, 0, 1, 2, 2, 0, 1}) {
+    plaintexts.push_back(absl::StrCat("plaintext ", plaintexts.size()));
+    mixed_ciphertexts.push_back(
+        single_key_daeads[key]
+            ->EncryptDeterministically(plaintexts.back(), "aad")
+            .ValueOrDie());
+  }
+  for (const std::string& ciphertext : mixed_ciphertexts) {
+    mixed_inputs.emplace_back(ciphertext, "aad");
+  }
+  std::vector<absl::string_view> decrypted;
+  ASSERT_THAT(daead->DecryptDeterministicallyBatch(mixed_inputs, &arena,
+                                                   &decrypted),
+              IsOk());
+  ASSERT_EQ(plaintexts.size(), decrypted.size());
+  for (size_t i = 0; i < plaintexts.size(); i++) {
+    EXPECT_EQ(plaintexts[i], decrypted[i]);
+  }
+
+  // A single invalid ciphertext fails the batch.
+  mixed_inputs.back().second = "other aad";
+  EXPECT_EQ(util::error::INVALID_ARGUMENT,
+            daead->DecryptDeterministicallyBatch(mixed_inputs, &arena,
+                                                 &decrypted)
+                .error_code());
+}
+
+TEST_F(DeterministicAeadSetWrapperTest, testAssociatedDataComponents) {
+  KeysetInfo keyset_info;
+  KeysetInfo::KeyInfo* key_info = keyset_info.add_key_info();
+  key_info->set_output_prefix_type(OutputPrefixType::RAW);
+  key_info->set_key_id(726329);
+  key_info->set_status(KeyStatusType::ENABLED);
+  key_info = keyset_info.add_key_info();
+  key_info->set_output_prefix_type(OutputPrefixType::TINK);
+  key_info->set_key_id(1234543);
+  key_info->set_status(KeyStatusType::ENABLED);
+
+  auto daead_set = absl::make_unique<PrimitiveSet<DeterministicAead>>();
+  for (int i = 0; i < 2; i++) {
+    auto entry_result = daead_set->AddPrimitive(
+        absl::make_unique<DummyDeterministicAead>(absl::StrCat("daead", i)),
+        keyset_info.key_info(i));
+    ASSERT_TRUE(entry_result.ok());
+    ASSERT_THAT(daead_set->set_primary(entry_result.ValueOrDie()), IsOk());
+  }
+  auto daead =
+      std::move(DeterministicAeadWrapper().Wrap(std::move(daead_set))
+                    .ValueOrDie());
+
+  auto encrypt_result =
+      daead->EncryptDeterministicallyWithComponents("plaintext", {"aad"});
+  ASSERT_THAT(encrypt_result.status(), IsOk());
+  EXPECT_EQ(daead->EncryptDeterministically("plaintext", "aad").ValueOrDie(),
+            encrypt_result.ValueOrDie());
+  auto decrypt_result = daead->DecryptDeterministicallyWithComponents(
+      encrypt_result.ValueOrDie(), {"aad"});
+  ASSERT_THAT(decrypt_result.status(), IsOk());
+  EXPECT_EQ("plaintext", decrypt_result.ValueOrDie());
+
+  // Ciphertexts of the RAW key are found as well.
+  std::string raw_ciphertext = DummyDeterministicAead("daead0")
+                                   .EncryptDeterministically("plaintext", "aad")
+                                   .ValueOrDie();
+  decrypt_result =
+      daead->DecryptDeterministicallyWithComponents(raw_ciphertext, {"aad"});
+  ASSERT_THAT(decrypt_result.status(), IsOk());
+  EXPECT_EQ("plaintext", decrypt_result.ValueOrDie());
+
+  // The dummy primitive only supports a single component.
+  EXPECT_EQ(util::error::UNIMPLEMENTED,
+            daead->EncryptDeterministicallyWithComponents("plaintext",
+                                                          {"a", "ad"})
+                .status()
+                .error_code());
+  EXPECT_FALSE(daead->DecryptDeterministicallyWithComponents(
+                        encrypt_result.ValueOrDie(), {"a", "ad"})
+                   .ok());
+}
+
 }  // namespace
 }  // namespace tink
 }  // namespace crypto
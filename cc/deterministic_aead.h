@@ -17,7 +17,14 @@
 #ifndef TINK_DETERMINISTIC_AEAD_H_
 #define TINK_DETERMINISTIC_AEAD_H_
 
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "tink/util/status.h"
 #include "tink/util/statusor.h"
 
 namespace crypto {
@@ -51,7 +58,99 @@ class DeterministicAead {
       absl::string_view ciphertext,
       absl::string_view associated_data) const = 0;
 
+  // Like EncryptDeterministically(), but the associated data consists of
+  // several components, which are authenticated as a vector of strings
+  // rather than as their concatenation. With a single component, this is the
+  // same as EncryptDeterministically(). The default implementation only
+  // supports a single component.
+  virtual crypto::tink::util::StatusOr<std::string>
+  EncryptDeterministicallyWithComponents(
+      absl::string_view plaintext,
+      absl::Span<const absl::string_view> associated_data) const {
+    if (associated_data.size() != 1) {
+      return crypto::tink::util::Status(
+          crypto::tink::util::error::UNIMPLEMENTED,
+          "Multiple associated data components are not supported");
+    }
+    return EncryptDeterministically(plaintext, associated_data[0]);
+  }
+
+  // Decrypts a ciphertext of EncryptDeterministicallyWithComponents() with
+  // the same associated data components. The default implementation only
+  // supports a single component.
+  virtual crypto::tink::util::StatusOr<std::string>
+  DecryptDeterministicallyWithComponents(
+      absl::string_view ciphertext,
+      absl::Span<const absl::string_view> associated_data) const {
+    if (associated_data.size() != 1) {
+      return crypto::tink::util::Status(
+          crypto::tink::util::error::UNIMPLEMENTED,
+          "Multiple associated data components are not supported");
+    }
+    return DecryptDeterministically(ciphertext, associated_data[0]);
+  }
+
+  // Encrypts a batch of (plaintext, associated_data) pairs deterministically.
+  // The ciphertexts are stored back-to-back in '*arena', which is
+  // overwritten, and '*ciphertexts' is set to one view into '*arena' per
+  // input, in the order of 'inputs'. The views are valid until '*arena' is
+  // modified. Fails if the encryption of any input fails. The default
+  // implementation calls EncryptDeterministically() for each input.
+  virtual crypto::tink::util::Status EncryptDeterministicallyBatch(
+      absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs,
+      std::string* arena, std::vector<absl::string_view>* ciphertexts) const {
+    arena->clear();
+    std::vector<int64_t> sizes;
+    sizes.reserve(inputs.size());
+    for (const auto& input : inputs) {
+      auto encrypt_result =
+          EncryptDeterministically(input.first, input.second);
+      if (!encrypt_result.ok()) return encrypt_result.status();
+      arena->append(encrypt_result.ValueOrDie());
+      sizes.push_back(encrypt_result.ValueOrDie().size());
+    }
+    SplitArena(*arena, sizes, ciphertexts);
+    return crypto::tink::util::Status::OK;
+  }
+
+  // Decrypts a batch of (ciphertext, associated_data) pairs. The plaintexts
+  // are stored back-to-back in '*arena', which is overwritten, and
+  // '*plaintexts' is set to one view into '*arena' per input, in the order
+  // of 'inputs'. The views are valid until '*arena' is modified. Fails if the
+  // decryption of any input fails. The default implementation calls
+  // DecryptDeterministically() for each input.
+  virtual crypto::tink::util::Status DecryptDeterministicallyBatch(
+      absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs,
+      std::string* arena, std::vector<absl::string_view>* plaintexts) const {
+    arena->clear();
+    std::vector<int64_t> sizes;
+    sizes.reserve(inputs.size());
+    for (const auto& input : inputs) {
+      auto decrypt_result =
+          DecryptDeterministically(input.first, input.second);
+      if (!decrypt_result.ok()) return decrypt_result.status();
+      arena->append(decrypt_result.ValueOrDie());
+      sizes.push_back(decrypt_result.ValueOrDie().size());
+    }
+    SplitArena(*arena, sizes, plaintexts);
+    return crypto::tink::util::Status::OK;
+  }
+
   virtual ~DeterministicAead() {}
+
+ protected:
+  // Sets '*views' to consecutive substrings of 'arena' of the given sizes.
+  static void SplitArena(absl::string_view arena,
+                         const std::vector<int64_t>& sizes,
+                         std::vector<absl::string_view>* views) {
+    views->clear();
+    views->reserve(sizes.size());
+    int64_t offset = 0;
+    for (int64_t size : sizes) {
+      views->push_back(arena.substr(offset, size));
+      offset += size;
+    }
+  }
 };
 
 }  // namespace tink
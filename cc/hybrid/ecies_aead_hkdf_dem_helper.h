@@ -21,8 +21,7 @@
 
 #include "tink/aead.h"
 #include "tink/daead/subtle/aead_or_daead.h"
-#include "tink/key_manager.h"
-#include "tink/util/protobuf_helper.h"
+#include "tink/subtle/common_enums.h"
 #include "tink/util/secret_data.h"
 #include "tink/util/statusor.h"
 #include "proto/tink.pb.h"
@@ -48,6 +47,8 @@ class EciesAeadHkdfDemHelper {
   // Creates and returns a new AeadOrDaead object that uses
   // the key material given in 'symmetric_key', which must
   // be of length dem_key_size_in_bytes().
+  // The primitive is constructed directly from the key bytes and the
+  // parameters parsed in New(), without going through the registry.
   virtual crypto::tink::util::StatusOr<
       std::unique_ptr<crypto::tink::subtle::AeadOrDaead>>
   GetAeadOrDaead(const util::SecretData& symmetric_key_value) const = 0;
@@ -63,7 +64,11 @@ class EciesAeadHkdfDemHelper {
   struct DemKeyParams {
     DemKeyType key_type;
     uint32_t key_size_in_bytes;
+    // The fields below are only set for AES_CTR_HMAC_AEAD_KEY.
     uint32_t aes_ctr_key_size_in_bytes;
+    uint32_t aes_ctr_iv_size_in_bytes;
+    crypto::tink::subtle::HashType hmac_hash_type;
+    uint32_t hmac_tag_size_in_bytes;
   };
 
   EciesAeadHkdfDemHelper(const google::crypto::tink::KeyTemplate& key_template,
@@ -73,11 +78,6 @@ class EciesAeadHkdfDemHelper {
   static util::StatusOr<DemKeyParams> GetKeyParams(
       const ::google::crypto::tink::KeyTemplate& key_template);
 
-  bool ReplaceKeyBytes(const util::SecretData& key_bytes,
-                       portable_proto::MessageLite* proto) const;
-
-  void ZeroKeyBytes(portable_proto::MessageLite* proto) const;
-
   const google::crypto::tink::KeyTemplate key_template_;
   const DemKeyParams key_params_;
 };
@@ -16,12 +16,16 @@
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "tink/aead/aes_ctr_hmac_aead_key_manager.h"
 #include "tink/aead/aes_gcm_key_manager.h"
 #include "tink/daead/aes_siv_key_manager.h"
 #include "tink/registry.h"
 #include "tink/util/secret_data.h"
 #include "tink/util/test_matchers.h"
 #include "tink/util/test_util.h"
+#include "proto/aes_ctr_hmac_aead.pb.h"
+#include "proto/common.pb.h"
 
 namespace crypto {
 namespace tink {
@@ -31,6 +35,9 @@ using ::crypto::tink::subtle::AeadOrDaead;
 using ::crypto::tink::test::IsOk;
 using ::crypto::tink::test::StatusIs;
 using ::crypto::tink::util::StatusOr;
+using ::google::crypto::tink::AesCtrHmacAeadKey;
+using ::google::crypto::tink::AesCtrHmacAeadKeyFormat;
+using ::google::crypto::tink::HashType;
 using ::testing::HasSubstr;
 
 // Checks whether Decrypt(Encrypt(message)) == message with the given dem.
@@ -113,6 +120,65 @@ TEST(EciesAeadHkdfDemHelperTest, DemHelperWithSomeDeterministicAeadKeyType) {
               IsOk());
 }
 
+TEST(EciesAeadHkdfDemHelperTest, DemHelperWithAesCtrHmacAeadKeyType) {
+  AesCtrHmacAeadKeyFormat key_format;
+  key_format.mutable_aes_ctr_key_format()->set_key_size(16);
+  key_format.mutable_aes_ctr_key_format()->mutable_params()->set_iv_size(16);
+  key_format.mutable_hmac_key_format()->set_key_size(32);
+  key_format.mutable_hmac_key_format()->mutable_params()->set_hash(
+      HashType::SHA256);
+  key_format.mutable_hmac_key_format()->mutable_params()->set_tag_size(16);
+  std::string dem_key_type = AesCtrHmacAeadKeyManager().get_key_type();
+  ASSERT_THAT(Registry::RegisterKeyTypeManager(
+                  absl::make_unique<AesCtrHmacAeadKeyManager>(), true),
+              IsOk());
+
+  google::crypto::tink::KeyTemplate dem_key_template;
+  dem_key_template.set_type_url(dem_key_type);
+  dem_key_template.set_value(key_format.SerializeAsString());
+
+  auto dem_helper_or = EciesAeadHkdfDemHelper::New(dem_key_template);
+  ASSERT_THAT(dem_helper_or.status(), IsOk());
+  auto dem_helper = std::move(dem_helper_or.ValueOrDie());
+  EXPECT_EQ(dem_helper->dem_key_size_in_bytes(), 48);
+
+  std::string aes_ctr_key_value =
+      test::HexDecodeOrDie("000102030405060708090a0b0c0d0e0f");
+  std::string hmac_key_value = test::HexDecodeOrDie(
+      "101112131415161718191a1b1c1d1e1f202122232425262728292a2b2c2d2e2f");
+  util::SecretData dem_key =
+      util::SecretDataFromStringView(aes_ctr_key_value + hmac_key_value);
+  StatusOr<std::unique_ptr<AeadOrDaead>> aead_or_daead_result_or =
+      dem_helper->GetAeadOrDaead(dem_key);
+  ASSERT_THAT(aead_or_daead_result_or.status(), IsOk());
+  auto aead_or_daead = std::move(aead_or_daead_result_or.ValueOrDie());
+  EXPECT_THAT(EncryptThenDecrypt(*aead_or_daead, "test_plaintext", "test_ad"),
+              IsOk());
+
+  // The DEM must be interoperable with the primitive built by the key manager
+  // from the same key material.
+  AesCtrHmacAeadKey key;
+  *key.mutable_aes_ctr_key()->mutable_params() =
+      key_format.aes_ctr_key_format().params();
+  key.mutable_aes_ctr_key()->set_key_value(aes_ctr_key_value);
+  *key.mutable_hmac_key()->mutable_params() =
+      key_format.hmac_key_format().params();
+  key.mutable_hmac_key()->set_key_value(hmac_key_value);
+  auto aead_or = AesCtrHmacAeadKeyManager().GetPrimitive<Aead>(key);
+  ASSERT_THAT(aead_or.status(), IsOk());
+  auto ciphertext_or = aead_or_daead->Encrypt("test_plaintext", "test_ad");
+  ASSERT_THAT(ciphertext_or.status(), IsOk());
+  auto plaintext_or =
+      aead_or.ValueOrDie()->Decrypt(ciphertext_or.ValueOrDie(), "test_ad");
+  ASSERT_THAT(plaintext_or.status(), IsOk());
+  EXPECT_EQ(plaintext_or.ValueOrDie(), "test_plaintext");
+
+  EXPECT_THAT(
+      dem_helper->GetAeadOrDaead(util::SecretDataFromStringView("short"))
+          .status(),
+      StatusIs(util::error::INTERNAL, HasSubstr("Wrong length")));
+}
+
 }  // namespace
 }  // namespace tink
 }  // namespace crypto
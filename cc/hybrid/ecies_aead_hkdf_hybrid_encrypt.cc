@@ -59,13 +59,33 @@ util::Status Validate(const EciesAeadHkdfPublicKey& key) {
 // static
 util::StatusOr<std::unique_ptr<HybridEncrypt>> EciesAeadHkdfHybridEncrypt::New(
     const EciesAeadHkdfPublicKey& recipient_key) {
+  return New(recipient_key, nullptr);
+}
+
+// static
+util::StatusOr<std::unique_ptr<HybridEncrypt>>
+EciesAeadHkdfHybridEncrypt::NewWithKeyPool(
+    const EciesAeadHkdfPublicKey& recipient_key,
+    const subtle::EciesEphemeralKeyPool::Options& kem_pool_options) {
+  return New(recipient_key, &kem_pool_options);
+}
+
+// static
+util::StatusOr<std::unique_ptr<HybridEncrypt>> EciesAeadHkdfHybridEncrypt::New(
+    const EciesAeadHkdfPublicKey& recipient_key,
+    const subtle::EciesEphemeralKeyPool::Options* kem_pool_options) {
   util::Status status = Validate(recipient_key);
   if (!status.ok()) return status;
 
-  auto kem_result = subtle::EciesHkdfSenderKemBoringSsl::New(
-      util::Enums::ProtoToSubtle(
-          recipient_key.params().kem_params().curve_type()),
-      recipient_key.x(), recipient_key.y());
+  subtle::EllipticCurveType curve = util::Enums::ProtoToSubtle(
+      recipient_key.params().kem_params().curve_type());
+  auto kem_result =
+      kem_pool_options == nullptr
+          ? subtle::EciesHkdfSenderKemBoringSsl::New(curve, recipient_key.x(),
+                                                     recipient_key.y())
+          : subtle::EciesHkdfSenderKemBoringSsl::NewWithKeyPool(
+                curve, recipient_key.x(), recipient_key.y(),
+                *kem_pool_options);
   if (!kem_result.ok()) return kem_result.status();
 
   auto dem_result = EciesAeadHkdfDemHelper::New(
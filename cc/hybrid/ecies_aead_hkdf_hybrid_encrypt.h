@@ -21,6 +21,7 @@
 
 #include "tink/hybrid/ecies_aead_hkdf_dem_helper.h"
 #include "tink/hybrid_encrypt.h"
+#include "tink/subtle/ecies_ephemeral_key_pool.h"
 #include "tink/subtle/ecies_hkdf_sender_kem_boringssl.h"
 #include "tink/util/statusor.h"
 #include "proto/ecies_aead_hkdf.pb.h"
@@ -37,11 +38,23 @@ class EciesAeadHkdfHybridEncrypt : public HybridEncrypt {
   static crypto::tink::util::StatusOr<std::unique_ptr<HybridEncrypt>> New(
       const google::crypto::tink::EciesAeadHkdfPublicKey& recipient_key);
 
+  // Like New(), but ephemeral keys are computed ahead of time, on the
+  // threads of an EciesEphemeralKeyPool with 'kem_pool_options', for
+  // example for bursts of encryptions to the same recipient.
+  static crypto::tink::util::StatusOr<std::unique_ptr<HybridEncrypt>>
+  NewWithKeyPool(
+      const google::crypto::tink::EciesAeadHkdfPublicKey& recipient_key,
+      const subtle::EciesEphemeralKeyPool::Options& kem_pool_options);
+
   crypto::tink::util::StatusOr<std::string> Encrypt(
       absl::string_view plaintext,
       absl::string_view context_info) const override;
 
  private:
+  static crypto::tink::util::StatusOr<std::unique_ptr<HybridEncrypt>> New(
+      const google::crypto::tink::EciesAeadHkdfPublicKey& recipient_key,
+      const subtle::EciesEphemeralKeyPool::Options* kem_pool_options);
+
   EciesAeadHkdfHybridEncrypt(
       const google::crypto::tink::EciesAeadHkdfPublicKey& recipient_key,
       std::unique_ptr<const subtle::EciesHkdfSenderKemBoringSsl> sender_kem,
@@ -17,6 +17,8 @@
 #include "tink/hybrid/ecies_aead_hkdf_hybrid_encrypt.h"
 
 #include "absl/memory/memory.h"
+#include "tink/hybrid/ecies_aead_hkdf_hybrid_decrypt.h"
+#include "tink/hybrid_decrypt.h"
 #include "tink/hybrid_encrypt.h"
 #include "tink/registry.h"
 #include "tink/aead/aes_gcm_key_manager.h"
@@ -150,6 +152,35 @@ TEST_F(EciesAeadHkdfHybridEncryptTest, testBasic) {
   }
 }
 
+TEST_F(EciesAeadHkdfHybridEncryptTest, testWithKeyPool) {
+  ASSERT_TRUE(Registry::RegisterKeyTypeManager(
+                  absl::make_unique<AesGcmKeyManager>(), true)
+                  .ok());
+  subtle::EciesEphemeralKeyPool::Options pool_options;
+  pool_options.depth = 2;
+  std::string plaintext = "some plaintext";
+  std::string context_info = "some context info";
+  for (auto curve :
+       {EllipticCurveType::NIST_P256, EllipticCurveType::CURVE25519}) {
+    auto ecies_key = test::GetEciesAesGcmHkdfTestKey(
+        curve, EcPointFormat::COMPRESSED, HashType::SHA256, 16);
+    auto encrypt_result = EciesAeadHkdfHybridEncrypt::NewWithKeyPool(
+        ecies_key.public_key(), pool_options);
+    ASSERT_TRUE(encrypt_result.ok()) << encrypt_result.status();
+    auto decrypt_result = EciesAeadHkdfHybridDecrypt::New(ecies_key);
+    ASSERT_TRUE(decrypt_result.ok()) << decrypt_result.status();
+    for (int i = 0; i < 5; i++) {
+      auto ciphertext_result =
+          encrypt_result.ValueOrDie()->Encrypt(plaintext, context_info);
+      ASSERT_TRUE(ciphertext_result.ok()) << ciphertext_result.status();
+      auto plaintext_result = decrypt_result.ValueOrDie()->Decrypt(
+          ciphertext_result.ValueOrDie(), context_info);
+      ASSERT_TRUE(plaintext_result.ok()) << plaintext_result.status();
+      EXPECT_EQ(plaintext_result.ValueOrDie(), plaintext);
+    }
+  }
+}
+
 }  // namespace
 }  // namespace tink
 }  // namespace crypto
@@ -0,0 +1,330 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/hybrid/ecies_aead_hkdf_multi_recipient.h"
+
+#include <cstdint>
+#include <utility>
+
+#include "absl/base/internal/endian.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/blocking_counter.h"
+#include "openssl/evp.h"
+#include "tink/subtle/ec_util.h"
+#include "tink/subtle/random.h"
+#include "tink/subtle/subtle_util.h"
+#include "tink/subtle/subtle_util_boringssl.h"
+#include "tink/util/enums.h"
+#include "tink/util/status.h"
+
+using ::google::crypto::tink::EciesAeadHkdfParams;
+using ::google::crypto::tink::EciesAeadHkdfPrivateKey;
+using ::google::crypto::tink::EciesAeadHkdfPublicKey;
+using ::google::crypto::tink::EllipticCurveType;
+
+namespace crypto {
+namespace tink {
+
+namespace {
+
+const uint8_t kVersion = 1;
+const int kVersionSize = 1;
+const int kCountSize = 4;
+const int kHintSize = 4;
+const int kIndexEntrySize = kHintSize + 4;
+
+util::Status Validate(const EciesAeadHkdfPublicKey& key) {
+  if (key.x().empty() || !key.has_params()) {
+    return util::Status(
+        util::error::INVALID_ARGUMENT,
+        "Invalid EciesAeadHkdfPublicKey: missing required fields.");
+  }
+  if (key.params().has_kem_params() &&
+      key.params().kem_params().curve_type() == EllipticCurveType::CURVE25519) {
+    if (!key.y().empty()) {
+      return util::Status(
+          util::error::INVALID_ARGUMENT,
+          "Invalid EciesAeadHkdfPublicKey: has unexpected field.");
+    }
+  } else if (key.y().empty()) {
+    return util::Status(
+        util::error::INVALID_ARGUMENT,
+        "Invalid EciesAeadHkdfPublicKey: missing required fields.");
+  }
+  return util::Status::OK;
+}
+
+absl::string_view StripLeadingZeros(absl::string_view bytes) {
+  while (!bytes.empty() && bytes[0] == '\0') bytes.remove_prefix(1);
+  return bytes;
+}
+
+// Returns the hint of the recipient with the public key 'key'. Leading zeros
+// of the coordinates are ignored, since keys differ in whether they have them.
+util::StatusOr<std::string> RecipientHint(const EciesAeadHkdfPublicKey& key) {
+  absl::string_view x = StripLeadingZeros(key.x());
+  absl::string_view y = StripLeadingZeros(key.y());
+  auto hash_result = subtle::boringssl::ComputeHash(
+      absl::StrCat(subtle::BigEndian32(x.size()), x, y), *EVP_sha256());
+  if (!hash_result.ok()) return hash_result.status();
+  return std::string(
+      reinterpret_cast<const char*>(hash_result.ValueOrDie().data()),
+      kHintSize);
+}
+
+uint32_t LoadBigEndian32(absl::string_view bytes) {
+  return absl::big_endian::Load32(
+      reinterpret_cast<const uint8_t*>(bytes.data()));
+}
+
+}  // namespace
+
+// static
+util::StatusOr<std::unique_ptr<HybridEncrypt>>
+EciesAeadHkdfMultiRecipientHybridEncrypt::New(
+    const std::vector<EciesAeadHkdfPublicKey>& recipient_keys,
+    Options options) {
+  if (recipient_keys.empty()) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "At least one recipient key is required.");
+  }
+  const auto& dem_template = recipient_keys[0].params().dem_params().aead_dem();
+  std::vector<Recipient> recipients;
+  recipients.reserve(recipient_keys.size());
+  for (const EciesAeadHkdfPublicKey& recipient_key : recipient_keys) {
+    util::Status status = Validate(recipient_key);
+    if (!status.ok()) return status;
+    const auto& recipient_dem_template =
+        recipient_key.params().dem_params().aead_dem();
+    if (recipient_dem_template.type_url() != dem_template.type_url() ||
+        recipient_dem_template.value() != dem_template.value()) {
+      return util::Status(
+          util::error::INVALID_ARGUMENT,
+          "All recipient keys must have the same DEM parameters.");
+    }
+    auto kem_result = subtle::EciesHkdfSenderKemBoringSsl::New(
+        util::Enums::ProtoToSubtle(
+            recipient_key.params().kem_params().curve_type()),
+        recipient_key.x(), recipient_key.y());
+    if (!kem_result.ok()) return kem_result.status();
+    auto hint_result = RecipientHint(recipient_key);
+    if (!hint_result.ok()) return hint_result.status();
+    recipients.push_back({recipient_key.params(),
+                          std::move(hint_result).ValueOrDie(),
+                          std::move(kem_result).ValueOrDie()});
+  }
+
+  auto dem_result = EciesAeadHkdfDemHelper::New(dem_template);
+  if (!dem_result.ok()) return dem_result.status();
+
+  return {absl::WrapUnique(new EciesAeadHkdfMultiRecipientHybridEncrypt(
+      std::move(recipients), std::move(dem_result).ValueOrDie(),
+      std::move(options)))};
+}
+
+util::StatusOr<std::string>
+EciesAeadHkdfMultiRecipientHybridEncrypt::WrapContentKey(
+    const Recipient& recipient, const util::SecretData& content_key,
+    absl::string_view context_info) const {
+  auto kem_key_result = recipient.sender_kem->GenerateKey(
+      util::Enums::ProtoToSubtle(
+          recipient.params.kem_params().hkdf_hash_type()),
+      recipient.params.kem_params().hkdf_salt(), context_info,
+      dem_helper_->dem_key_size_in_bytes(),
+      util::Enums::ProtoToSubtle(recipient.params.ec_point_format()));
+  if (!kem_key_result.ok()) return kem_key_result.status();
+  auto kem_key = std::move(kem_key_result.ValueOrDie());
+
+  auto aead_or_daead_result =
+      dem_helper_->GetAeadOrDaead(kem_key->get_symmetric_key());
+  if (!aead_or_daead_result.ok()) return aead_or_daead_result.status();
+  auto encrypt_result = aead_or_daead_result.ValueOrDie()->Encrypt(
+      util::SecretDataAsStringView(content_key), "");  // empty aad
+  if (!encrypt_result.ok()) return encrypt_result.status();
+  return absl::StrCat(kem_key->get_kem_bytes(), encrypt_result.ValueOrDie());
+}
+
+util::StatusOr<std::string> EciesAeadHkdfMultiRecipientHybridEncrypt::Encrypt(
+    absl::string_view plaintext, absl::string_view context_info) const {
+  util::SecretData content_key =
+      subtle::Random::GetRandomKeyBytes(dem_helper_->dem_key_size_in_bytes());
+  auto payload_aead_result = dem_helper_->GetAeadOrDaead(content_key);
+  if (!payload_aead_result.ok()) return payload_aead_result.status();
+
+  // Wrap the content key for every recipient.
+  std::vector<util::Status> statuses(recipients_.size());
+  std::vector<std::string> wrapped_keys(recipients_.size());
+  auto wrap = [&](int i) {
+    auto wrap_result =
+        WrapContentKey(recipients_[i], content_key, context_info);
+    if (wrap_result.ok()) {
+      wrapped_keys[i] = std::move(wrap_result.ValueOrDie());
+    } else {
+      statuses[i] = wrap_result.status();
+    }
+  };
+  if (options_.schedule == nullptr || recipients_.size() == 1) {
+    for (int i = 0; i < recipients_.size(); i++) wrap(i);
+  } else {
+    absl::BlockingCounter pending(recipients_.size() - 1);
+    for (int i = 1; i < recipients_.size(); i++) {
+      options_.schedule([&wrap, &pending, i]() {
+        wrap(i);
+        pending.DecrementCount();
+      });
+    }
+    wrap(0);
+    pending.Wait();
+  }
+  for (const util::Status& status : statuses) {
+    if (!status.ok()) return status;
+  }
+
+  std::string header;
+  header.push_back(static_cast<char>(kVersion));
+  header.append(subtle::BigEndian32(recipients_.size()));
+  for (int i = 0; i < recipients_.size(); i++) {
+    header.append(recipients_[i].hint);
+    header.append(subtle::BigEndian32(wrapped_keys[i].size()));
+  }
+  for (const std::string& wrapped_key : wrapped_keys) {
+    header.append(wrapped_key);
+  }
+
+  // The header is authenticated by the payload, so that wrapped keys cannot
+  // be dropped or swapped without detection.
+  auto encrypt_result =
+      payload_aead_result.ValueOrDie()->Encrypt(plaintext, header);
+  if (!encrypt_result.ok()) return encrypt_result.status();
+  header.append(encrypt_result.ValueOrDie());
+  return header;
+}
+
+// static
+util::StatusOr<std::unique_ptr<HybridDecrypt>>
+EciesAeadHkdfMultiRecipientHybridDecrypt::New(
+    const EciesAeadHkdfPrivateKey& recipient_key) {
+  if (!recipient_key.has_public_key() || recipient_key.key_value().empty()) {
+    return util::Status(
+        util::error::INVALID_ARGUMENT,
+        "Invalid EciesAeadHkdfPrivateKey: missing required fields.");
+  }
+  util::Status status = Validate(recipient_key.public_key());
+  if (!status.ok()) return status;
+
+  auto kem_result = subtle::EciesHkdfRecipientKemBoringSsl::New(
+      util::Enums::ProtoToSubtle(
+          recipient_key.public_key().params().kem_params().curve_type()),
+      util::SecretDataFromStringView(recipient_key.key_value()));
+  if (!kem_result.ok()) return kem_result.status();
+
+  auto dem_result = EciesAeadHkdfDemHelper::New(
+      recipient_key.public_key().params().dem_params().aead_dem());
+  if (!dem_result.ok()) return dem_result.status();
+
+  auto hint_result = RecipientHint(recipient_key.public_key());
+  if (!hint_result.ok()) return hint_result.status();
+
+  return {absl::WrapUnique(new EciesAeadHkdfMultiRecipientHybridDecrypt(
+      recipient_key.public_key().params(), std::move(hint_result).ValueOrDie(),
+      std::move(kem_result).ValueOrDie(),
+      std::move(dem_result).ValueOrDie()))};
+}
+
+util::StatusOr<util::SecretData>
+EciesAeadHkdfMultiRecipientHybridDecrypt::UnwrapContentKey(
+    absl::string_view wrapped_key, absl::string_view context_info) const {
+  auto kem_size_result = subtle::EcUtil::EncodingSizeInBytes(
+      util::Enums::ProtoToSubtle(params_.kem_params().curve_type()),
+      util::Enums::ProtoToSubtle(params_.ec_point_format()));
+  if (!kem_size_result.ok()) return kem_size_result.status();
+  auto kem_size = kem_size_result.ValueOrDie();
+  if (wrapped_key.size() < kem_size) {
+    return util::Status(util::error::INVALID_ARGUMENT, "wrapped key too short");
+  }
+
+  auto kem_key_result = recipient_kem_->GenerateKey(
+      wrapped_key.substr(0, kem_size),
+      util::Enums::ProtoToSubtle(params_.kem_params().hkdf_hash_type()),
+      params_.kem_params().hkdf_salt(), context_info,
+      dem_helper_->dem_key_size_in_bytes(),
+      util::Enums::ProtoToSubtle(params_.ec_point_format()));
+  if (!kem_key_result.ok()) return kem_key_result.status();
+
+  auto aead_or_daead_result =
+      dem_helper_->GetAeadOrDaead(kem_key_result.ValueOrDie());
+  if (!aead_or_daead_result.ok()) return aead_or_daead_result.status();
+  auto decrypt_result = aead_or_daead_result.ValueOrDie()->Decrypt(
+      wrapped_key.substr(kem_size), "");  // empty aad
+  if (!decrypt_result.ok()) return decrypt_result.status();
+  util::SecretData content_key =
+      util::SecretDataFromStringView(decrypt_result.ValueOrDie());
+  util::SafeZeroString(&decrypt_result.ValueOrDie());
+  if (content_key.size() != dem_helper_->dem_key_size_in_bytes()) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "wrapped key has the wrong size");
+  }
+  return std::move(content_key);
+}
+
+util::StatusOr<std::string> EciesAeadHkdfMultiRecipientHybridDecrypt::Decrypt(
+    absl::string_view ciphertext, absl::string_view context_info) const {
+  if (ciphertext.size() < kVersionSize + kCountSize) {
+    return util::Status(util::error::INVALID_ARGUMENT, "ciphertext too short");
+  }
+  if (static_cast<uint8_t>(ciphertext[0]) != kVersion) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "unsupported ciphertext version");
+  }
+  uint64_t num_recipients = LoadBigEndian32(ciphertext.substr(kVersionSize));
+  absl::string_view index = ciphertext.substr(kVersionSize + kCountSize);
+  if (num_recipients == 0 || num_recipients > index.size() / kIndexEntrySize) {
+    return util::Status(util::error::INVALID_ARGUMENT, "invalid ciphertext");
+  }
+
+  // Find the wrapped keys with our hint, and the end of the header.
+  std::vector<absl::string_view> candidates;
+  size_t offset = kVersionSize + kCountSize + num_recipients * kIndexEntrySize;
+  for (uint64_t i = 0; i < num_recipients; i++) {
+    absl::string_view entry = index.substr(i * kIndexEntrySize, kIndexEntrySize);
+    uint32_t wrapped_key_size = LoadBigEndian32(entry.substr(kHintSize));
+    if (wrapped_key_size > ciphertext.size() - offset) {
+      return util::Status(util::error::INVALID_ARGUMENT, "invalid ciphertext");
+    }
+    if (entry.substr(0, kHintSize) == hint_) {
+      candidates.push_back(ciphertext.substr(offset, wrapped_key_size));
+    }
+    offset += wrapped_key_size;
+  }
+
+  // Hints may collide, so try every matching wrapped key.
+  for (absl::string_view wrapped_key : candidates) {
+    auto content_key_result = UnwrapContentKey(wrapped_key, context_info);
+    if (!content_key_result.ok()) continue;
+    auto payload_aead_result =
+        dem_helper_->GetAeadOrDaead(content_key_result.ValueOrDie());
+    if (!payload_aead_result.ok()) return payload_aead_result.status();
+    return payload_aead_result.ValueOrDie()->Decrypt(
+        ciphertext.substr(offset), ciphertext.substr(0, offset));
+  }
+  return util::Status(util::error::INVALID_ARGUMENT,
+                      "no wrapped key for this recipient");
+}
+
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,144 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TINK_HYBRID_ECIES_AEAD_HKDF_MULTI_RECIPIENT_H_
+#define TINK_HYBRID_ECIES_AEAD_HKDF_MULTI_RECIPIENT_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "tink/hybrid/ecies_aead_hkdf_dem_helper.h"
+#include "tink/hybrid_decrypt.h"
+#include "tink/hybrid_encrypt.h"
+#include "tink/subtle/ecies_hkdf_recipient_kem_boringssl.h"
+#include "tink/subtle/ecies_hkdf_sender_kem_boringssl.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/statusor.h"
+#include "proto/ecies_aead_hkdf.pb.h"
+
+namespace crypto {
+namespace tink {
+
+// ECIES-AEAD-HKDF encryption to several recipients at once. The plaintext is
+// encrypted only once, with the DEM under a fresh content key, and the
+// content key is encrypted to every recipient with ECIES-AEAD-HKDF. The
+// ciphertext has the format
+//
+//   version (1 byte) || N (4 bytes) ||
+//   N * (recipient hint (4 bytes) || wrapped key size (4 bytes)) ||
+//   N * wrapped key || payload
+//
+// where sizes are big-endian, a wrapped key is the KEM bytes followed by the
+// DEM ciphertext of the content key, and the payload is the DEM ciphertext of
+// the plaintext with everything before it as associated data. The hint of a
+// recipient is a prefix of the SHA-256 of its public key, so that a recipient
+// only tries to unwrap its own keys. 'context_info' is the HKDF info of all
+// wrapped keys.
+//
+// All recipient keys must have the same DEM parameters. As with any
+// multi-recipient encryption without signatures, every recipient can create
+// ciphertexts which the other recipients accept.
+class EciesAeadHkdfMultiRecipientHybridEncrypt : public HybridEncrypt {
+ public:
+  struct Options {
+    // Runs the given task, typically on a thread pool owned by the caller.
+    // If set, Encrypt() wraps the content key for the recipients in parallel
+    // and blocks until all tasks ran. If null, it wraps them one by one.
+    std::function<void(std::function<void()>)> schedule;
+  };
+
+  static crypto::tink::util::StatusOr<std::unique_ptr<HybridEncrypt>> New(
+      const std::vector<google::crypto::tink::EciesAeadHkdfPublicKey>&
+          recipient_keys,
+      Options options);
+
+  static crypto::tink::util::StatusOr<std::unique_ptr<HybridEncrypt>> New(
+      const std::vector<google::crypto::tink::EciesAeadHkdfPublicKey>&
+          recipient_keys) {
+    return New(recipient_keys, Options());
+  }
+
+  crypto::tink::util::StatusOr<std::string> Encrypt(
+      absl::string_view plaintext,
+      absl::string_view context_info) const override;
+
+ private:
+  struct Recipient {
+    google::crypto::tink::EciesAeadHkdfParams params;
+    std::string hint;
+    std::unique_ptr<const subtle::EciesHkdfSenderKemBoringSsl> sender_kem;
+  };
+
+  EciesAeadHkdfMultiRecipientHybridEncrypt(
+      std::vector<Recipient> recipients,
+      std::unique_ptr<const EciesAeadHkdfDemHelper> dem_helper,
+      Options options)
+      : recipients_(std::move(recipients)),
+        dem_helper_(std::move(dem_helper)),
+        options_(std::move(options)) {}
+
+  // Encrypts 'content_key' to 'recipient'.
+  crypto::tink::util::StatusOr<std::string> WrapContentKey(
+      const Recipient& recipient, const util::SecretData& content_key,
+      absl::string_view context_info) const;
+
+  const std::vector<Recipient> recipients_;
+  const std::unique_ptr<const EciesAeadHkdfDemHelper> dem_helper_;
+  const Options options_;
+};
+
+// Decrypts the ciphertexts of EciesAeadHkdfMultiRecipientHybridEncrypt for
+// one of their recipients.
+class EciesAeadHkdfMultiRecipientHybridDecrypt : public HybridDecrypt {
+ public:
+  static crypto::tink::util::StatusOr<std::unique_ptr<HybridDecrypt>> New(
+      const google::crypto::tink::EciesAeadHkdfPrivateKey& recipient_key);
+
+  crypto::tink::util::StatusOr<std::string> Decrypt(
+      absl::string_view ciphertext,
+      absl::string_view context_info) const override;
+
+ private:
+  EciesAeadHkdfMultiRecipientHybridDecrypt(
+      const google::crypto::tink::EciesAeadHkdfParams& params,
+      std::string hint,
+      std::unique_ptr<const subtle::EciesHkdfRecipientKemBoringSsl>
+          recipient_kem,
+      std::unique_ptr<const EciesAeadHkdfDemHelper> dem_helper)
+      : params_(params),
+        hint_(std::move(hint)),
+        recipient_kem_(std::move(recipient_kem)),
+        dem_helper_(std::move(dem_helper)) {}
+
+  // Decrypts a wrapped key of the ciphertext.
+  crypto::tink::util::StatusOr<util::SecretData> UnwrapContentKey(
+      absl::string_view wrapped_key, absl::string_view context_info) const;
+
+  const google::crypto::tink::EciesAeadHkdfParams params_;
+  const std::string hint_;
+  const std::unique_ptr<const subtle::EciesHkdfRecipientKemBoringSsl>
+      recipient_kem_;
+  const std::unique_ptr<const EciesAeadHkdfDemHelper> dem_helper_;
+};
+
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_HYBRID_ECIES_AEAD_HKDF_MULTI_RECIPIENT_H_
@@ -0,0 +1,175 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/hybrid/ecies_aead_hkdf_multi_recipient.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "tink/aead/aes_gcm_key_manager.h"
+#include "tink/hybrid/ecies_aead_hkdf_hybrid_encrypt.h"
+#include "tink/hybrid_decrypt.h"
+#include "tink/hybrid_encrypt.h"
+#include "tink/registry.h"
+#include "tink/subtle/test_util.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "tink/util/test_matchers.h"
+#include "tink/util/test_util.h"
+#include "proto/common.pb.h"
+#include "proto/ecies_aead_hkdf.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace {
+
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::IsOkAndHolds;
+using ::crypto::tink::test::StatusIs;
+using ::google::crypto::tink::EciesAeadHkdfPrivateKey;
+using ::google::crypto::tink::EciesAeadHkdfPublicKey;
+using ::google::crypto::tink::EcPointFormat;
+using ::google::crypto::tink::EllipticCurveType;
+using ::google::crypto::tink::HashType;
+using ::testing::Not;
+
+class EciesAeadHkdfMultiRecipientTest : public ::testing::Test {
+ protected:
+  static void SetUpTestSuite() {
+    ASSERT_THAT(Registry::RegisterKeyTypeManager(
+                    absl::make_unique<AesGcmKeyManager>(), true),
+                IsOk());
+  }
+
+  void SetUp() override {
+    private_keys_ = {
+        test::GetEciesAesGcmHkdfTestKey(EllipticCurveType::NIST_P256,
+                                        EcPointFormat::UNCOMPRESSED,
+                                        HashType::SHA256, 16),
+        test::GetEciesAesGcmHkdfTestKey(EllipticCurveType::NIST_P384,
+                                        EcPointFormat::COMPRESSED,
+                                        HashType::SHA512, 16),
+        test::GetEciesAesGcmHkdfTestKey(EllipticCurveType::NIST_P521,
+                                        EcPointFormat::UNCOMPRESSED,
+                                        HashType::SHA256, 16),
+    };
+    for (const auto& private_key : private_keys_) {
+      public_keys_.push_back(private_key.public_key());
+    }
+  }
+
+  std::unique_ptr<HybridDecrypt> NewDecrypt(
+      const EciesAeadHkdfPrivateKey& private_key) {
+    auto result = EciesAeadHkdfMultiRecipientHybridDecrypt::New(private_key);
+    EXPECT_THAT(result.status(), IsOk());
+    return std::move(result.ValueOrDie());
+  }
+
+  std::vector<EciesAeadHkdfPrivateKey> private_keys_;
+  std::vector<EciesAeadHkdfPublicKey> public_keys_;
+};
+
+TEST_F(EciesAeadHkdfMultiRecipientTest, EveryRecipientDecrypts) {
+  subtle::test::TestThreadPool pool(2);
+  for (bool parallel : {false, true}) {
+    EciesAeadHkdfMultiRecipientHybridEncrypt::Options options;
+    if (parallel) {
+      options.schedule = [&pool](std::function<void()> task) {
+        pool.Schedule(std::move(task));
+      };
+    }
+    auto encrypt_result = EciesAeadHkdfMultiRecipientHybridEncrypt::New(
+        public_keys_, std::move(options));
+    ASSERT_THAT(encrypt_result.status(), IsOk());
+    auto ciphertext_result =
+        encrypt_result.ValueOrDie()->Encrypt("plaintext", "context info");
+    ASSERT_THAT(ciphertext_result.status(), IsOk());
+
+    for (const auto& private_key : private_keys_) {
+      auto decrypt = NewDecrypt(private_key);
+      EXPECT_THAT(
+          decrypt->Decrypt(ciphertext_result.ValueOrDie(), "context info"),
+          IsOkAndHolds("plaintext"));
+      EXPECT_THAT(decrypt->Decrypt(ciphertext_result.ValueOrDie(), "other"),
+                  Not(IsOk()));
+    }
+  }
+}
+
+TEST_F(EciesAeadHkdfMultiRecipientTest, OtherKeyFails) {
+  auto encrypt = std::move(
+      EciesAeadHkdfMultiRecipientHybridEncrypt::New(
+          {public_keys_[0], public_keys_[1]})
+          .ValueOrDie());
+  std::string ciphertext =
+      encrypt->Encrypt("plaintext", "").ValueOrDie();
+  EXPECT_THAT(NewDecrypt(private_keys_[2])->Decrypt(ciphertext, ""),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST_F(EciesAeadHkdfMultiRecipientTest, ModifiedCiphertextFails) {
+  auto encrypt = std::move(
+      EciesAeadHkdfMultiRecipientHybridEncrypt::New(public_keys_)
+          .ValueOrDie());
+  std::string ciphertext = encrypt->Encrypt("plaintext", "").ValueOrDie();
+  auto decrypt = NewDecrypt(private_keys_[0]);
+  for (int i = 0; i < ciphertext.size(); i++) {
+    std::string modified = ciphertext;
+    modified[i] ^= 1;
+    EXPECT_THAT(decrypt->Decrypt(modified, ""), Not(IsOk())) << i;
+  }
+  for (int size = 0; size < ciphertext.size(); size++) {
+    EXPECT_THAT(decrypt->Decrypt(ciphertext.substr(0, size), ""),
+                Not(IsOk()))
+        << size;
+  }
+}
+
+TEST_F(EciesAeadHkdfMultiRecipientTest, SingleRecipientCiphertextFails) {
+  auto encrypt = std::move(
+      EciesAeadHkdfHybridEncrypt::New(public_keys_[0]).ValueOrDie());
+  std::string ciphertext = encrypt->Encrypt("plaintext", "").ValueOrDie();
+  EXPECT_THAT(NewDecrypt(private_keys_[0])->Decrypt(ciphertext, ""),
+              Not(IsOk()));
+}
+
+TEST_F(EciesAeadHkdfMultiRecipientTest, InvalidRecipients) {
+  EXPECT_THAT(EciesAeadHkdfMultiRecipientHybridEncrypt::New({}).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+
+  EciesAeadHkdfPublicKey other_dem = test::GetEciesAesGcmHkdfTestKey(
+      EllipticCurveType::NIST_P256, EcPointFormat::UNCOMPRESSED,
+      HashType::SHA256, 32).public_key();
+  EXPECT_THAT(EciesAeadHkdfMultiRecipientHybridEncrypt::New(
+                  {public_keys_[0], other_dem})
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+
+  EXPECT_THAT(EciesAeadHkdfMultiRecipientHybridEncrypt::New(
+                  {public_keys_[0], EciesAeadHkdfPublicKey()})
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace tink
+}  // namespace crypto
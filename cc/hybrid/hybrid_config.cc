@@ -60,9 +60,8 @@ util::Status HybridConfig::Register() {
 
   // Register non-FIPS key managers.
   if (!status.ok()) return status;
-  status = Registry::RegisterAsymmetricKeyManagers(
-      absl::make_unique<EciesAeadHkdfPrivateKeyManager>(),
-      absl::make_unique<EciesAeadHkdfPublicKeyManager>(), true);
+  status = Registry::RegisterAsymmetricKeyManagersLazily<
+      EciesAeadHkdfPrivateKeyManager, EciesAeadHkdfPublicKeyManager>(true);
   if (!status.ok()) return status;
 
   return util::OkStatus();
@@ -16,39 +16,148 @@
 
 #include "tink/hybrid/hybrid_decrypt_wrapper.h"
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
 #include "tink/crypto_format.h"
+#include "tink/internal/monitoring_util.h"
+#include "tink/monitoring.h"
 #include "tink/hybrid_decrypt.h"
+#include "tink/internal/raw_key_hint.h"
+#include "tink/internal/tracing_span.h"
+#include "tink/key_usage.h"
+#include "tink/memory_stats.h"
 #include "tink/primitive_set.h"
 #include "tink/subtle/subtle_util_boringssl.h"
 #include "tink/util/status.h"
 #include "tink/util/statusor.h"
+#include "proto/tink.pb.h"
 
 namespace crypto {
 namespace tink {
 
+using google::crypto::tink::OutputPrefixType;
+
+struct HybridDecryptWrapper::Counters {
+  std::atomic<int64_t> decryptions{0};
+  std::atomic<int64_t> key_hint_hits{0};
+  std::atomic<int64_t> trial_decryptions{0};
+};
+
 namespace {
 
-class HybridDecryptSetWrapper : public HybridDecrypt {
+using Counters = HybridDecryptWrapper::Counters;
+using DecryptEntry = PrimitiveSet<HybridDecrypt>::Entry<HybridDecrypt>;
+
+// Decrypts 'ciphertext' with the primitive of 'entry', after checking and
+// stripping the output prefix of the entry.
+util::StatusOr<std::string> DecryptWithEntry(const DecryptEntry& entry,
+                                             absl::string_view ciphertext,
+                                             absl::string_view context_info) {
+  if (entry.get_output_prefix_type() != OutputPrefixType::RAW) {
+    absl::string_view prefix = entry.identifier_view();
+    if (ciphertext.length() <= prefix.size() ||
+        ciphertext.substr(0, prefix.size()) != prefix) {
+      return util::DecryptionFailedError();
+    }
+    ciphertext = ciphertext.substr(prefix.size());
+  }
+  auto hybrid_decrypt_result = entry.get_primitive_or_status();
+  if (!hybrid_decrypt_result.ok()) return hybrid_decrypt_result.status();
+  return hybrid_decrypt_result.ValueOrDie()->Decrypt(ciphertext, context_info);
+}
+
+class HybridDecryptSetWrapper : public HybridDecrypt,
+                                public MemoryStatsSource,
+                                public KeyUsageSource {
  public:
-  explicit HybridDecryptSetWrapper(
-      std::unique_ptr<PrimitiveSet<HybridDecrypt>> hybrid_decrypt_set)
-      : hybrid_decrypt_set_(std::move(hybrid_decrypt_set)) {}
+  HybridDecryptSetWrapper(
+      std::unique_ptr<PrimitiveSet<HybridDecrypt>> hybrid_decrypt_set,
+      std::shared_ptr<Counters> counters)
+      : monitoring_(internal::MonitoringRecorder::ForPrimitiveSet(
+            *hybrid_decrypt_set, "hybrid_decrypt")),
+        hybrid_decrypt_set_(std::move(hybrid_decrypt_set)),
+        counters_(std::move(counters)) {
+    for (const DecryptEntry* entry : hybrid_decrypt_set_->get_all()) {
+      // Keeps the first entry if several share a key ID.
+      entries_by_key_id_.emplace(entry->get_key_id(), entry);
+    }
+  }
 
   crypto::tink::util::StatusOr<std::string> Decrypt(
       absl::string_view ciphertext,
       absl::string_view context_info) const override;
 
+  crypto::tink::util::StatusOr<std::string> DecryptWithKeyId(
+      absl::string_view ciphertext, absl::string_view context_info,
+      uint32_t key_id) const override;
+
+  MemoryStats GetMemoryStats() const override {
+    return hybrid_decrypt_set_->GetMemoryStats("hybrid_decrypt", sizeof(*this));
+  }
+
+  std::vector<KeyUsage> GetKeyUsage() const override {
+    return hybrid_decrypt_set_->GetKeyUsage();
+  }
+
   ~HybridDecryptSetWrapper() override {}
 
  private:
+  // Tries the keys matching the prefix of 'ciphertext', then all RAW keys.
+  // 'start' is the result of monitoring_.Start().
+  util::StatusOr<std::string> DecryptWithAllKeys(
+      int64_t start, absl::string_view ciphertext,
+      absl::string_view context_info) const;
+
+  internal::MonitoringRecorder monitoring_;
   std::unique_ptr<PrimitiveSet<HybridDecrypt>> hybrid_decrypt_set_;
+  const std::shared_ptr<Counters> counters_;
+  internal::RawKeyHint<HybridDecrypt> raw_key_hint_;
+  // Entries of hybrid_decrypt_set_, which owns them.
+  absl::flat_hash_map<uint32_t, const DecryptEntry*> entries_by_key_id_;
 };
 
 util::StatusOr<std::string> HybridDecryptSetWrapper::Decrypt(
     absl::string_view ciphertext, absl::string_view context_info) const {
+  counters_->decryptions.fetch_add(1, std::memory_order_relaxed);
+  return DecryptWithAllKeys(monitoring_.Start(), ciphertext, context_info);
+}
+
+util::StatusOr<std::string> HybridDecryptSetWrapper::DecryptWithKeyId(
+    absl::string_view ciphertext, absl::string_view context_info,
+    uint32_t key_id) const {
+  counters_->decryptions.fetch_add(1, std::memory_order_relaxed);
+  int64_t start = monitoring_.Start();
+  context_info = subtle::SubtleUtilBoringSSL::EnsureNonNull(context_info);
+  auto entry_it = entries_by_key_id_.find(key_id);
+  if (entry_it != entries_by_key_id_.end()) {
+    auto decrypt_result =
+        DecryptWithEntry(*entry_it->second, ciphertext, context_info);
+    if (decrypt_result.ok()) {
+      entry_it->second->RecordDecryption();
+      counters_->key_hint_hits.fetch_add(1, std::memory_order_relaxed);
+      monitoring_.RecordSuccess(start, MonitoringOperation::kDecrypt, key_id,
+                                ciphertext.size());
+      return std::move(decrypt_result.ValueOrDie());
+    }
+  }
+  // The hint was wrong, or the ciphertext is invalid.
+  return DecryptWithAllKeys(start, ciphertext, context_info);
+}
+
+util::StatusOr<std::string> HybridDecryptSetWrapper::DecryptWithAllKeys(
+    int64_t start, absl::string_view ciphertext,
+    absl::string_view context_info) const {
   // BoringSSL expects a non-null pointer for context_info,
   // regardless of whether the size is 0.
   context_info = subtle::SubtleUtilBoringSSL::EnsureNonNull(context_info);
+  internal::TracingSpan span("tink.hybrid_decrypt.decrypt");
+  span.AddBytes(ciphertext.size());
 
   if (ciphertext.length() > CryptoFormat::kNonRawPrefixSize) {
     absl::string_view key_id =
@@ -58,10 +167,19 @@ util::StatusOr<std::string> HybridDecryptSetWrapper::Decrypt(
       absl::string_view raw_ciphertext =
           ciphertext.substr(CryptoFormat::kNonRawPrefixSize);
       for (auto& hybrid_decrypt_entry : *(primitives_result.ValueOrDie())) {
-        HybridDecrypt& hybrid_decrypt = hybrid_decrypt_entry->get_primitive();
+        auto hybrid_decrypt_result =
+            hybrid_decrypt_entry->get_primitive_or_status();
+        if (!hybrid_decrypt_result.ok()) continue;
+        HybridDecrypt& hybrid_decrypt = *hybrid_decrypt_result.ValueOrDie();
+        counters_->trial_decryptions.fetch_add(1, std::memory_order_relaxed);
+        span.AddKeyTrial();
         auto decrypt_result =
             hybrid_decrypt.Decrypt(raw_ciphertext, context_info);
         if (decrypt_result.ok()) {
+          hybrid_decrypt_entry->RecordDecryption();
+          monitoring_.RecordSuccess(start, MonitoringOperation::kDecrypt,
+                                    hybrid_decrypt_entry->get_key_id(),
+                                    ciphertext.size());
           return std::move(decrypt_result.ValueOrDie());
         } else {
           // LOG that a matching key didn't decrypt the ciphertext.
@@ -71,17 +189,32 @@ util::StatusOr<std::string> HybridDecryptSetWrapper::Decrypt(
   }
 
   // No matching key succeeded with decryption, try all RAW keys.
+  monitoring_.RecordRawFallback();
   auto raw_primitives_result = hybrid_decrypt_set_->get_raw_primitives();
   if (raw_primitives_result.ok()) {
-    for (auto& hybrid_decrypt_entry : *(raw_primitives_result.ValueOrDie())) {
-        HybridDecrypt& hybrid_decrypt = hybrid_decrypt_entry->get_primitive();
-      auto decrypt_result = hybrid_decrypt.Decrypt(ciphertext, context_info);
-      if (decrypt_result.ok()) {
-        return std::move(decrypt_result.ValueOrDie());
-      }
+    util::StatusOr<std::string> decrypt_result(util::DecryptionFailedError());
+    const DecryptEntry* hybrid_decrypt_entry = raw_key_hint_.Try(
+        *raw_primitives_result.ValueOrDie(),
+        [&](const DecryptEntry& entry) -> bool {
+          auto hybrid_decrypt_result = entry.get_primitive_or_status();
+          if (!hybrid_decrypt_result.ok()) return false;
+          counters_->trial_decryptions.fetch_add(1, std::memory_order_relaxed);
+          span.AddKeyTrial();
+          decrypt_result = hybrid_decrypt_result.ValueOrDie()->Decrypt(
+              ciphertext, context_info);
+          return decrypt_result.ok();
+        });
+    if (hybrid_decrypt_entry != nullptr) {
+      monitoring_.RecordSuccess(start, MonitoringOperation::kDecrypt,
+                                hybrid_decrypt_entry->get_key_id(),
+                                ciphertext.size());
+      return std::move(decrypt_result.ValueOrDie());
     }
   }
-  return util::Status(util::error::INVALID_ARGUMENT, "decryption failed");
+  monitoring_.RecordFailure(start, MonitoringOperation::kDecrypt,
+                            ciphertext.size());
+  span.SetOk(false);
+  return util::DecryptionFailedError();
 }
 
 util::Status Validate(PrimitiveSet<HybridDecrypt>* hybrid_decrypt_set) {
@@ -98,6 +231,19 @@ util::Status Validate(PrimitiveSet<HybridDecrypt>* hybrid_decrypt_set) {
 
 }  // anonymous namespace
 
+HybridDecryptWrapper::HybridDecryptWrapper()
+    : counters_(std::make_shared<Counters>()) {}
+
+HybridDecryptStats HybridDecryptWrapper::GetStats() const {
+  HybridDecryptStats stats;
+  stats.decryptions = counters_->decryptions.load(std::memory_order_relaxed);
+  stats.key_hint_hits =
+      counters_->key_hint_hits.load(std::memory_order_relaxed);
+  stats.trial_decryptions =
+      counters_->trial_decryptions.load(std::memory_order_relaxed);
+  return stats;
+}
+
 // static
 util::StatusOr<std::unique_ptr<HybridDecrypt>>
 HybridDecryptWrapper::Wrap(
@@ -105,7 +251,7 @@ HybridDecryptWrapper::Wrap(
   util::Status status = Validate(primitive_set.get());
   if (!status.ok()) return status;
   std::unique_ptr<HybridDecrypt> hybrid_decrypt(
-      new HybridDecryptSetWrapper(std::move(primitive_set)));
+      new HybridDecryptSetWrapper(std::move(primitive_set), counters_));
   return std::move(hybrid_decrypt);
 }
 
@@ -17,6 +17,9 @@
 #ifndef TINK_HYBRID_HYBRID_DECRYPT_WRAPPER_H_
 #define TINK_HYBRID_HYBRID_DECRYPT_WRAPPER_H_
 
+#include <cstdint>
+#include <memory>
+
 #include "absl/strings/string_view.h"
 #include "tink/hybrid_decrypt.h"
 #include "tink/primitive_set.h"
@@ -27,15 +30,47 @@
 namespace crypto {
 namespace tink {
 
+// Counters of the decryptions done by the primitives of a
+// HybridDecryptWrapper.
+struct HybridDecryptStats {
+  // Ciphertexts decrypted, by Decrypt() or DecryptWithKeyId().
+  int64_t decryptions = 0;
+  // Ciphertexts decrypted by DecryptWithKeyId() with the hinted key.
+  int64_t key_hint_hits = 0;
+  // Decryptions by the primitives of single keys while trying all keys which
+  // could match a ciphertext. Keysets with many RAW keys, for which this is
+  // much larger than 'decryptions', should pass key hints.
+  int64_t trial_decryptions = 0;
+};
+
 // Wraps a set of HybridDecrypt-instances that correspond to a keyset,
 // and combines them into a single HybridDecrypt-primitive, that for
 // actual decryption uses the instance that matches the ciphertext prefix.
+//
+// DecryptWithKeyId() looks the hinted key up in an index of the keyset, so
+// that a ciphertext of a RAW key is decrypted once rather than with every RAW
+// key. If the hinted key does not decrypt the ciphertext, it falls back on
+// trying all keys, like Decrypt().
 class HybridDecryptWrapper
     : public PrimitiveWrapper<HybridDecrypt, HybridDecrypt> {
  public:
+  HybridDecryptWrapper();
+
   util::StatusOr<std::unique_ptr<HybridDecrypt>> Wrap(
       std::unique_ptr<PrimitiveSet<HybridDecrypt>> primitive_set)
       const override;
+
+  // Primitives other than the primary are only used to decrypt.
+  bool SupportsLazyPrimitives() const override { return true; }
+
+  // Returns the counters summed over all primitives returned by Wrap().
+  HybridDecryptStats GetStats() const;
+
+  // Shared with the wrapped primitives, which may outlive the wrapper.
+  struct Counters;
+
+ private:
+  std::shared_ptr<Counters> counters_;
 };
 
 }  // namespace tink
@@ -16,8 +16,15 @@
 
 #include "tink/hybrid/hybrid_decrypt_wrapper.h"
 
+#include <string>
+#include <vector>
+
 #include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "tink/crypto_format.h"
 #include "tink/hybrid_decrypt.h"
+#include "tink/key_usage.h"
 #include "tink/primitive_set.h"
 #include "tink/util/status.h"
 #include "tink/util/test_matchers.h"
@@ -27,6 +34,7 @@
 using ::crypto::tink::test::DummyHybridDecrypt;
 using ::crypto::tink::test::DummyHybridEncrypt;
 using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::IsOkAndHolds;
 using ::google::crypto::tink::KeysetInfo;
 using ::google::crypto::tink::KeyStatusType;
 using ::google::crypto::tink::OutputPrefixType;
@@ -160,6 +168,144 @@ TEST_F(HybridDecryptSetWrapperTest, Basic) {
   }
 }
 
+TEST_F(HybridDecryptSetWrapperTest, DecryptWithKeyId) {
+  constexpr int kNumRawKeys = 20;
+  KeysetInfo keyset_info;
+  std::unique_ptr<PrimitiveSet<HybridDecrypt>> hybrid_decrypt_set(
+      new PrimitiveSet<HybridDecrypt>());
+  std::vector<std::string> prefixes;
+  // Many RAW keys, followed by a TINK key with ID kNumRawKeys.
+  for (uint32_t key_id = 0; key_id <= kNumRawKeys; key_id++) {
+    KeysetInfo::KeyInfo* key_info = keyset_info.add_key_info();
+    key_info->set_output_prefix_type(key_id < kNumRawKeys
+                                         ? OutputPrefixType::RAW
+                                         : OutputPrefixType::TINK);
+    key_info->set_key_id(key_id);
+    key_info->set_status(KeyStatusType::ENABLED);
+    auto entry_result = hybrid_decrypt_set->AddPrimitive(
+        absl::make_unique<DummyHybridDecrypt>(absl::StrCat("hybrid_", key_id)),
+        *key_info);
+    ASSERT_THAT(entry_result.status(), IsOk());
+    ASSERT_THAT(hybrid_decrypt_set->set_primary(entry_result.ValueOrDie()),
+                IsOk());
+    prefixes.push_back(CryptoFormat::GetOutputPrefix(*key_info).ValueOrDie());
+  }
+  HybridDecryptWrapper wrapper;
+  auto hybrid_decrypt_result = wrapper.Wrap(std::move(hybrid_decrypt_set));
+  ASSERT_THAT(hybrid_decrypt_result.status(), IsOk());
+  std::unique_ptr<HybridDecrypt> hybrid_decrypt =
+      std::move(hybrid_decrypt_result.ValueOrDie());
+
+  std::string plaintext = "some_plaintext";
+  std::string context_info = "some_context";
+  std::string raw_ciphertext = DummyHybridEncrypt("hybrid_15")
+                                   .Encrypt(plaintext, context_info)
+                                   .ValueOrDie();
+  std::string tink_ciphertext =
+      prefixes[kNumRawKeys] +
+      DummyHybridEncrypt(absl::StrCat("hybrid_", kNumRawKeys))
+          .Encrypt(plaintext, context_info)
+          .ValueOrDie();
+
+  // The hinted keys decrypt their ciphertexts, without trying other keys.
+  EXPECT_THAT(
+      hybrid_decrypt->DecryptWithKeyId(raw_ciphertext, context_info, 15),
+      IsOkAndHolds(plaintext));
+  EXPECT_THAT(hybrid_decrypt->DecryptWithKeyId(tink_ciphertext, context_info,
+                                               kNumRawKeys),
+              IsOkAndHolds(plaintext));
+  HybridDecryptStats stats = wrapper.GetStats();
+  EXPECT_EQ(stats.decryptions, 2);
+  EXPECT_EQ(stats.key_hint_hits, 2);
+  EXPECT_EQ(stats.trial_decryptions, 0);
+
+  // Without a hint, the RAW keys are tried in turn.
+  EXPECT_THAT(hybrid_decrypt->Decrypt(raw_ciphertext, context_info),
+              IsOkAndHolds(plaintext));
+  stats = wrapper.GetStats();
+  EXPECT_EQ(stats.decryptions, 3);
+  EXPECT_EQ(stats.trial_decryptions, 16);
+
+  // Wrong and unknown hints fall back on trying all keys.
+  EXPECT_THAT(
+      hybrid_decrypt->DecryptWithKeyId(raw_ciphertext, context_info, 3),
+      IsOkAndHolds(plaintext));
+  EXPECT_THAT(
+      hybrid_decrypt->DecryptWithKeyId(raw_ciphertext, context_info, 1000),
+      IsOkAndHolds(plaintext));
+  EXPECT_THAT(
+      hybrid_decrypt->DecryptWithKeyId(tink_ciphertext, context_info, 3),
+      IsOkAndHolds(plaintext));
+  stats = wrapper.GetStats();
+  EXPECT_EQ(stats.decryptions, 6);
+  EXPECT_EQ(stats.key_hint_hits, 2);
+
+  // Invalid ciphertexts are rejected whatever the hint.
+  EXPECT_FALSE(
+      hybrid_decrypt->DecryptWithKeyId(raw_ciphertext, "other context", 15)
+          .ok());
+  EXPECT_FALSE(hybrid_decrypt
+                   ->DecryptWithKeyId(tink_ciphertext.substr(0, 3),
+                                      context_info, kNumRawKeys)
+                   .ok());
+}
+
+TEST_F(HybridDecryptSetWrapperTest, AdaptiveKeyTrialOrderAndKeyUsage) {
+  constexpr int kNumRawKeys = 20;
+  std::unique_ptr<PrimitiveSet<HybridDecrypt>> hybrid_decrypt_set(
+      new PrimitiveSet<HybridDecrypt>());
+  for (uint32_t key_id = 0; key_id < kNumRawKeys; key_id++) {
+    KeysetInfo::KeyInfo key_info;
+    key_info.set_output_prefix_type(OutputPrefixType::RAW);
+    key_info.set_key_id(key_id);
+    key_info.set_status(KeyStatusType::ENABLED);
+    auto entry_result = hybrid_decrypt_set->AddPrimitive(
+        absl::make_unique<DummyHybridDecrypt>(absl::StrCat("hybrid_", key_id)),
+        key_info);
+    ASSERT_THAT(entry_result.status(), IsOk());
+    ASSERT_THAT(hybrid_decrypt_set->set_primary(entry_result.ValueOrDie()),
+                IsOk());
+  }
+  HybridDecryptWrapper wrapper;
+  KeyTrialOrder::SetAdaptive(true);
+  auto hybrid_decrypt_result = wrapper.Wrap(std::move(hybrid_decrypt_set));
+  KeyTrialOrder::SetAdaptive(false);
+  ASSERT_THAT(hybrid_decrypt_result.status(), IsOk());
+  const HybridDecrypt& hybrid_decrypt = *hybrid_decrypt_result.ValueOrDie();
+
+  std::string plaintext = "some_plaintext";
+  std::string context_info = "some_context";
+  std::string ciphertext_15 = DummyHybridEncrypt("hybrid_15")
+                                  .Encrypt(plaintext, context_info)
+                                  .ValueOrDie();
+  std::string ciphertext_3 = DummyHybridEncrypt("hybrid_3")
+                                 .Encrypt(plaintext, context_info)
+                                 .ValueOrDie();
+
+  // The key which decrypted the last ciphertext is tried first.
+  EXPECT_THAT(hybrid_decrypt.Decrypt(ciphertext_15, context_info),
+              IsOkAndHolds(plaintext));
+  EXPECT_EQ(wrapper.GetStats().trial_decryptions, 16);
+  EXPECT_THAT(hybrid_decrypt.Decrypt(ciphertext_15, context_info),
+              IsOkAndHolds(plaintext));
+  EXPECT_EQ(wrapper.GetStats().trial_decryptions, 17);
+  EXPECT_THAT(hybrid_decrypt.Decrypt(ciphertext_3, context_info),
+              IsOkAndHolds(plaintext));
+  EXPECT_EQ(wrapper.GetStats().trial_decryptions, 22);
+  EXPECT_THAT(hybrid_decrypt.Decrypt(ciphertext_3, context_info),
+              IsOkAndHolds(plaintext));
+  EXPECT_EQ(wrapper.GetStats().trial_decryptions, 23);
+
+  auto usage_result = GetKeyUsage(hybrid_decrypt);
+  ASSERT_THAT(usage_result.status(), IsOk());
+  ASSERT_EQ(usage_result.ValueOrDie().size(), kNumRawKeys);
+  for (const KeyUsage& usage : usage_result.ValueOrDie()) {
+    int64_t expected = usage.key_id == 3 || usage.key_id == 15 ? 2 : 0;
+    EXPECT_EQ(usage.decryptions, expected) << usage.key_id;
+    EXPECT_EQ(usage.is_primary, usage.key_id == kNumRawKeys - 1);
+  }
+}
+
 }  // namespace
 }  // namespace tink
 }  // namespace crypto
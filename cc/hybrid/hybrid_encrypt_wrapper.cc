@@ -16,8 +16,12 @@
 
 #include "tink/hybrid/hybrid_encrypt_wrapper.h"
 
+#include "absl/strings/str_cat.h"
 #include "tink/crypto_format.h"
+#include "tink/internal/monitoring_util.h"
+#include "tink/monitoring.h"
 #include "tink/hybrid_encrypt.h"
+#include "tink/memory_stats.h"
 #include "tink/primitive_set.h"
 #include "tink/subtle/subtle_util_boringssl.h"
 #include "tink/util/status.h"
@@ -44,20 +48,31 @@ util::Status Validate(PrimitiveSet<HybridEncrypt>* hybrid_encrypt_set) {
 // Returns an HybridEncrypt-primitive that uses the primary
 // HybridEncrypt-instance provided in 'hybrid_encrypt_set',
 // which must be non-NULL (and must contain a primary instance).
-class HybridEncryptSetWrapper : public HybridEncrypt {
+class HybridEncryptSetWrapper : public HybridEncrypt, public MemoryStatsSource {
  public:
-  explicit HybridEncryptSetWrapper(
-      std::unique_ptr<PrimitiveSet<HybridEncrypt>> hybrid_encrypt_set)
-      : hybrid_encrypt_set_(std::move(hybrid_encrypt_set)) {}
+  HybridEncryptSetWrapper(
+      std::unique_ptr<PrimitiveSet<HybridEncrypt>> hybrid_encrypt_set,
+      PrimitiveSet<HybridEncrypt>::ResolvedPrimary primary)
+      : monitoring_(internal::MonitoringRecorder::ForPrimitiveSet(
+            *hybrid_encrypt_set, "hybrid_encrypt")),
+        hybrid_encrypt_set_(std::move(hybrid_encrypt_set)),
+        primary_(primary) {}
 
   crypto::tink::util::StatusOr<std::string> Encrypt(
       absl::string_view plaintext,
       absl::string_view context_info) const override;
 
+  MemoryStats GetMemoryStats() const override {
+    return hybrid_encrypt_set_->GetMemoryStats("hybrid_encrypt", sizeof(*this));
+  }
+
   ~HybridEncryptSetWrapper() override {}
 
  private:
+  internal::MonitoringRecorder monitoring_;
   std::unique_ptr<PrimitiveSet<HybridEncrypt>> hybrid_encrypt_set_;
+  // Resolved once, since it is used by every encryption.
+  const PrimitiveSet<HybridEncrypt>::ResolvedPrimary primary_;
 };
 
 util::StatusOr<std::string> HybridEncryptSetWrapper::Encrypt(
@@ -66,13 +81,18 @@ util::StatusOr<std::string> HybridEncryptSetWrapper::Encrypt(
   // regardless of whether the size is 0.
   plaintext = subtle::SubtleUtilBoringSSL::EnsureNonNull(plaintext);
   context_info = subtle::SubtleUtilBoringSSL::EnsureNonNull(context_info);
+  int64_t start = monitoring_.Start();
 
-  auto primary = hybrid_encrypt_set_->get_primary();
-  auto encrypt_result =
-      primary->get_primitive().Encrypt(plaintext, context_info);
-  if (!encrypt_result.ok()) return encrypt_result.status();
-  const std::string& key_id = primary->get_identifier();
-  return key_id + encrypt_result.ValueOrDie();
+  auto encrypt_result = primary_.primitive->Encrypt(plaintext, context_info);
+  if (!encrypt_result.ok()) {
+    monitoring_.RecordFailure(start, MonitoringOperation::kEncrypt,
+                              plaintext.size());
+    return encrypt_result.status();
+  }
+  monitoring_.RecordSuccess(start, MonitoringOperation::kEncrypt,
+                            primary_.key_id, plaintext.size());
+  return absl::StrCat(primary_.output_prefix.view(),
+                      encrypt_result.ValueOrDie());
 }
 
 }  // anonymous namespace
@@ -81,8 +101,10 @@ util::StatusOr<std::unique_ptr<HybridEncrypt>> HybridEncryptWrapper::Wrap(
     std::unique_ptr<PrimitiveSet<HybridEncrypt>> primitive_set) const {
   util::Status status = Validate(primitive_set.get());
   if (!status.ok()) return status;
-  std::unique_ptr<HybridEncrypt> hybrid_encrypt(
-      new HybridEncryptSetWrapper(std::move(primitive_set)));
+  auto primary_result = primitive_set->ResolvePrimary();
+  if (!primary_result.ok()) return primary_result.status();
+  std::unique_ptr<HybridEncrypt> hybrid_encrypt(new HybridEncryptSetWrapper(
+      std::move(primitive_set), primary_result.ValueOrDie()));
   return std::move(hybrid_encrypt);
 }
 
@@ -0,0 +1,461 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/hybrid/internal/hpke_context.h"
+
+#include <cstring>
+#include <initializer_list>
+#include <limits>
+#include <string>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "openssl/bn.h"
+#include "openssl/curve25519.h"
+#include "openssl/ec.h"
+#include "openssl/hkdf.h"
+#include "tink/subtle/common_enums.h"
+#include "tink/subtle/subtle_util.h"
+#include "tink/subtle/subtle_util_boringssl.h"
+
+namespace crypto {
+namespace tink {
+namespace internal {
+
+namespace {
+
+using ::crypto::tink::subtle::EcPointFormat;
+using ::crypto::tink::subtle::EllipticCurveType;
+using ::crypto::tink::subtle::SubtleUtilBoringSSL;
+
+constexpr char kHpkeVersion[] = "HPKE-v1";
+constexpr char kBaseMode[] = "\x00";
+constexpr uint16_t kKdfIdHkdfSha256 = 0x0001;
+// Nh of HKDF-SHA256 and Nsecret of both KEMs.
+constexpr int kHashSize = 32;
+constexpr int kNonceSize = 12;
+constexpr int kTagSize = 16;
+constexpr int kX25519KeySize = 32;
+constexpr int kP256PrivateKeySize = 32;
+constexpr int kP256PublicKeySize = 65;
+
+// Returns the 2-byte big-endian encoding of 'value', I2OSP(value, 2).
+std::string BigEndian16(uint16_t value) {
+  std::string encoded(2, '\0');
+  encoded[0] = static_cast<char>(value >> 8);
+  encoded[1] = static_cast<char>(value & 0xff);
+  return encoded;
+}
+
+// The functions below expect parameters accepted by ValidateHpkeParams().
+uint16_t KemId(HpkeKem kem) {
+  return kem == HpkeKem::kX25519HkdfSha256 ? 0x0020 : 0x0010;
+}
+
+uint16_t AeadId(HpkeAead aead) {
+  return aead == HpkeAead::kAes128Gcm ? 0x0001 : 0x0003;
+}
+
+const EVP_AEAD* EvpAead(HpkeAead aead) {
+  return aead == HpkeAead::kAes128Gcm ? EVP_aead_aes_128_gcm()
+                                      : EVP_aead_chacha20_poly1305();
+}
+
+int AeadKeySize(HpkeAead aead) {
+  return aead == HpkeAead::kAes128Gcm ? 16 : 32;
+}
+
+util::SecretData Concat(std::initializer_list<absl::string_view> parts) {
+  size_t size = 0;
+  for (absl::string_view part : parts) size += part.size();
+  util::SecretData result;
+  result.reserve(size);
+  for (absl::string_view part : parts) {
+    result.insert(result.end(), part.begin(), part.end());
+  }
+  return result;
+}
+
+util::StatusOr<util::SecretData> LabeledExtract(absl::string_view suite_id,
+                                                absl::string_view salt,
+                                                absl::string_view label,
+                                                absl::string_view ikm) {
+  util::SecretData labeled_ikm = Concat({kHpkeVersion, suite_id, label, ikm});
+  util::SecretData prk(kHashSize);
+  size_t prk_size;
+  if (HKDF_extract(prk.data(), &prk_size, EVP_sha256(), labeled_ikm.data(),
+                   labeled_ikm.size(),
+                   reinterpret_cast<const uint8_t*>(salt.data()),
+                   salt.size()) != 1 ||
+      prk_size != kHashSize) {
+    return util::Status(util::error::INTERNAL, "HKDF_extract failed");
+  }
+  return prk;
+}
+
+util::StatusOr<util::SecretData> LabeledExpand(absl::string_view suite_id,
+                                               const util::SecretData& prk,
+                                               absl::string_view label,
+                                               absl::string_view info,
+                                               int length) {
+  std::string labeled_info =
+      absl::StrCat(BigEndian16(length), kHpkeVersion, suite_id, label, info);
+  util::SecretData result(length);
+  if (HKDF_expand(result.data(), result.size(), EVP_sha256(), prk.data(),
+                  prk.size(),
+                  reinterpret_cast<const uint8_t*>(labeled_info.data()),
+                  labeled_info.size()) != 1) {
+    return util::Status(util::error::INTERNAL, "HKDF_expand failed");
+  }
+  return result;
+}
+
+// Returns the scalar of a serialized P-256 private key, which must be in
+// [1, n - 1].
+util::StatusOr<bssl::UniquePtr<BIGNUM>> P256PrivateKeyToBignum(
+    const util::SecretData& private_key) {
+  if (private_key.size() != kP256PrivateKeySize) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "Invalid P-256 private key size");
+  }
+  auto group_result =
+      SubtleUtilBoringSSL::GetStaticEcGroup(EllipticCurveType::NIST_P256);
+  if (!group_result.ok()) return group_result.status();
+  bssl::UniquePtr<BIGNUM> scalar(
+      BN_bin2bn(private_key.data(), private_key.size(), nullptr));
+  if (scalar == nullptr || BN_is_zero(scalar.get()) ||
+      BN_cmp(scalar.get(), EC_GROUP_get0_order(group_result.ValueOrDie())) >=
+          0) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "Invalid P-256 private key");
+  }
+  return std::move(scalar);
+}
+
+// Returns DH(private_key, public_key) of 'kem'.
+util::StatusOr<util::SecretData> Dh(HpkeKem kem,
+                                    const util::SecretData& private_key,
+                                    absl::string_view public_key) {
+  util::Status status = ValidateHpkePublicKey(kem, public_key);
+  if (!status.ok()) return status;
+  if (kem == HpkeKem::kX25519HkdfSha256) {
+    if (private_key.size() != kX25519KeySize) {
+      return util::Status(util::error::INVALID_ARGUMENT,
+                          "Invalid X25519 private key size");
+    }
+    util::SecretData dh(kX25519KeySize);
+    // Fails for small-order public keys, whose shared secret is all zeros.
+    if (X25519(dh.data(), private_key.data(),
+               reinterpret_cast<const uint8_t*>(public_key.data())) != 1) {
+      return util::Status(util::error::INVALID_ARGUMENT,
+                          "Invalid X25519 public key");
+    }
+    return dh;
+  }
+  auto scalar_result = P256PrivateKeyToBignum(private_key);
+  if (!scalar_result.ok()) return scalar_result.status();
+  auto point_result = SubtleUtilBoringSSL::EcPointDecode(
+      EllipticCurveType::NIST_P256, EcPointFormat::UNCOMPRESSED, public_key);
+  if (!point_result.ok()) return point_result.status();
+  return SubtleUtilBoringSSL::ComputeEcdhSharedSecret(
+      EllipticCurveType::NIST_P256, scalar_result.ValueOrDie().get(),
+      point_result.ValueOrDie().get());
+}
+
+// ExtractAndExpand() of the KEM (RFC 9180, section 4.1).
+util::StatusOr<util::SecretData> KemSharedSecret(
+    HpkeKem kem, const util::SecretData& dh,
+    absl::string_view encapsulated_key,
+    absl::string_view recipient_public_key) {
+  std::string suite_id = absl::StrCat("KEM", BigEndian16(KemId(kem)));
+  auto prk_result = LabeledExtract(suite_id, "", "eae_prk",
+                                   util::SecretDataAsStringView(dh));
+  if (!prk_result.ok()) return prk_result.status();
+  return LabeledExpand(suite_id, prk_result.ValueOrDie(), "shared_secret",
+                       absl::StrCat(encapsulated_key, recipient_public_key),
+                       kHashSize);
+}
+
+}  // namespace
+
+util::Status ValidateHpkeParams(const HpkeParams& params) {
+  if (params.kem != HpkeKem::kX25519HkdfSha256 &&
+      params.kem != HpkeKem::kP256HkdfSha256) {
+    return util::Status(util::error::INVALID_ARGUMENT, "Unsupported HPKE KEM");
+  }
+  if (params.kdf != HpkeKdf::kHkdfSha256) {
+    return util::Status(util::error::INVALID_ARGUMENT, "Unsupported HPKE KDF");
+  }
+  if (params.aead != HpkeAead::kAes128Gcm &&
+      params.aead != HpkeAead::kChaCha20Poly1305) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "Unsupported HPKE AEAD");
+  }
+  return util::OkStatus();
+}
+
+int HpkeEncapsulatedKeySize(HpkeKem kem) {
+  return kem == HpkeKem::kX25519HkdfSha256 ? kX25519KeySize
+                                           : kP256PublicKeySize;
+}
+
+util::Status ValidateHpkePublicKey(HpkeKem kem, absl::string_view public_key) {
+  if (public_key.size() != HpkeEncapsulatedKeySize(kem)) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "Invalid HPKE public key size");
+  }
+  if (kem == HpkeKem::kP256HkdfSha256) {
+    // Rejects points which are not on the curve.
+    auto point_result = SubtleUtilBoringSSL::EcPointDecode(
+        EllipticCurveType::NIST_P256, EcPointFormat::UNCOMPRESSED,
+        public_key);
+    if (!point_result.ok()) return point_result.status();
+  }
+  return util::OkStatus();
+}
+
+util::StatusOr<std::string> HpkePublicKeyFromPrivateKey(
+    HpkeKem kem, const util::SecretData& private_key) {
+  if (kem == HpkeKem::kX25519HkdfSha256) {
+    if (private_key.size() != kX25519KeySize) {
+      return util::Status(util::error::INVALID_ARGUMENT,
+                          "Invalid X25519 private key size");
+    }
+    std::string public_key(kX25519KeySize, '\0');
+    X25519_public_from_private(reinterpret_cast<uint8_t*>(&public_key[0]),
+                               private_key.data());
+    return public_key;
+  }
+  auto scalar_result = P256PrivateKeyToBignum(private_key);
+  if (!scalar_result.ok()) return scalar_result.status();
+  auto group_result =
+      SubtleUtilBoringSSL::GetStaticEcGroup(EllipticCurveType::NIST_P256);
+  if (!group_result.ok()) return group_result.status();
+  const EC_GROUP* group = group_result.ValueOrDie();
+  bssl::UniquePtr<EC_POINT> point(EC_POINT_new(group));
+  if (point == nullptr ||
+      EC_POINT_mul(group, point.get(), scalar_result.ValueOrDie().get(),
+                   nullptr, nullptr, nullptr) != 1) {
+    return util::Status(util::error::INTERNAL, "EC_POINT_mul failed");
+  }
+  return SubtleUtilBoringSSL::EcPointEncode(
+      EllipticCurveType::NIST_P256, EcPointFormat::UNCOMPRESSED, point.get());
+}
+
+// static
+util::StatusOr<std::unique_ptr<HpkeContext>> HpkeContext::SetupSender(
+    const HpkeParams& params, absl::string_view recipient_public_key,
+    absl::string_view info) {
+  util::Status status = ValidateHpkeParams(params);
+  if (!status.ok()) return status;
+  util::SecretData ephemeral_private_key;
+  std::string ephemeral_public_key;
+  if (params.kem == HpkeKem::kX25519HkdfSha256) {
+    auto key = SubtleUtilBoringSSL::GenerateNewX25519Key();
+    ephemeral_private_key = util::SecretData(
+        key->private_key, key->private_key + X25519_PRIVATE_KEY_LEN);
+    ephemeral_public_key =
+        std::string(reinterpret_cast<const char*>(key->public_value),
+                    X25519_PUBLIC_VALUE_LEN);
+  } else {
+    auto key_result =
+        SubtleUtilBoringSSL::GetNewEcKey(EllipticCurveType::NIST_P256);
+    if (!key_result.ok()) return key_result.status();
+    const SubtleUtilBoringSSL::EcKey& key = key_result.ValueOrDie();
+    ephemeral_private_key = key.priv;
+    ephemeral_public_key = absl::StrCat("\x04", key.pub_x, key.pub_y);
+  }
+  // Encap() of the KEM (RFC 9180, section 4.1).
+  auto dh_result =
+      Dh(params.kem, ephemeral_private_key, recipient_public_key);
+  if (!dh_result.ok()) return dh_result.status();
+  auto shared_secret_result =
+      KemSharedSecret(params.kem, dh_result.ValueOrDie(),
+                      ephemeral_public_key, recipient_public_key);
+  if (!shared_secret_result.ok()) return shared_secret_result.status();
+  return KeySchedule(params, /* is_sender = */ true,
+                     shared_secret_result.ValueOrDie(), info,
+                     std::move(ephemeral_public_key));
+}
+
+// static
+util::StatusOr<std::unique_ptr<HpkeContext>> HpkeContext::SetupRecipient(
+    const HpkeParams& params, const util::SecretData& recipient_private_key,
+    absl::string_view recipient_public_key,
+    absl::string_view encapsulated_key, absl::string_view info) {
+  util::Status status = ValidateHpkeParams(params);
+  if (!status.ok()) return status;
+  // Decap() of the KEM (RFC 9180, section 4.1).
+  auto dh_result = Dh(params.kem, recipient_private_key, encapsulated_key);
+  if (!dh_result.ok()) return dh_result.status();
+  auto shared_secret_result =
+      KemSharedSecret(params.kem, dh_result.ValueOrDie(), encapsulated_key,
+                      recipient_public_key);
+  if (!shared_secret_result.ok()) return shared_secret_result.status();
+  return KeySchedule(params, /* is_sender = */ false,
+                     shared_secret_result.ValueOrDie(), info,
+                     std::string(encapsulated_key));
+}
+
+// static
+util::StatusOr<std::unique_ptr<HpkeContext>> HpkeContext::KeySchedule(
+    const HpkeParams& params, bool is_sender,
+    const util::SecretData& shared_secret, absl::string_view info,
+    std::string encapsulated_key) {
+  std::string suite_id = absl::StrCat(
+      "HPKE", BigEndian16(KemId(params.kem)), BigEndian16(kKdfIdHkdfSha256),
+      BigEndian16(AeadId(params.aead)));
+  // Base mode has an empty PSK and PSK ID.
+  auto psk_id_hash_result = LabeledExtract(suite_id, "", "psk_id_hash", "");
+  if (!psk_id_hash_result.ok()) return psk_id_hash_result.status();
+  auto info_hash_result = LabeledExtract(suite_id, "", "info_hash", info);
+  if (!info_hash_result.ok()) return info_hash_result.status();
+  std::string key_schedule_context = absl::StrCat(
+      absl::string_view(kBaseMode, 1),
+      util::SecretDataAsStringView(psk_id_hash_result.ValueOrDie()),
+      util::SecretDataAsStringView(info_hash_result.ValueOrDie()));
+  auto secret_result = LabeledExtract(
+      suite_id, util::SecretDataAsStringView(shared_secret), "secret", "");
+  if (!secret_result.ok()) return secret_result.status();
+  const util::SecretData& secret = secret_result.ValueOrDie();
+
+  auto key_result = LabeledExpand(suite_id, secret, "key",
+                                  key_schedule_context,
+                                  AeadKeySize(params.aead));
+  if (!key_result.ok()) return key_result.status();
+  auto base_nonce_result = LabeledExpand(suite_id, secret, "base_nonce",
+                                         key_schedule_context, kNonceSize);
+  if (!base_nonce_result.ok()) return base_nonce_result.status();
+  auto exporter_secret_result = LabeledExpand(suite_id, secret, "exp",
+                                              key_schedule_context, kHashSize);
+  if (!exporter_secret_result.ok()) return exporter_secret_result.status();
+
+  const util::SecretData& key = key_result.ValueOrDie();
+  bssl::UniquePtr<EVP_AEAD_CTX> aead_ctx(
+      EVP_AEAD_CTX_new(EvpAead(params.aead), key.data(), key.size(),
+                       EVP_AEAD_DEFAULT_TAG_LENGTH));
+  if (aead_ctx == nullptr) {
+    return util::Status(util::error::INTERNAL,
+                        "could not initialize EVP_AEAD_CTX");
+  }
+  return absl::WrapUnique(new HpkeContext(
+      is_sender, std::move(encapsulated_key), std::move(suite_id),
+      std::move(aead_ctx), std::move(base_nonce_result.ValueOrDie()),
+      std::move(exporter_secret_result.ValueOrDie())));
+}
+
+HpkeContext::HpkeContext(bool is_sender, std::string encapsulated_key,
+                         std::string suite_id,
+                         bssl::UniquePtr<EVP_AEAD_CTX> aead_ctx,
+                         util::SecretData base_nonce,
+                         util::SecretData exporter_secret)
+    : is_sender_(is_sender),
+      encapsulated_key_(std::move(encapsulated_key)),
+      suite_id_(std::move(suite_id)),
+      aead_ctx_(std::move(aead_ctx)),
+      base_nonce_(std::move(base_nonce)),
+      exporter_secret_(std::move(exporter_secret)) {}
+
+void HpkeContext::ComputeNonce(uint64_t seq, uint8_t* nonce) const {
+  std::memcpy(nonce, base_nonce_.data(), kNonceSize);
+  for (int i = 0; i < 8; ++i) {
+    nonce[kNonceSize - 1 - i] ^= static_cast<uint8_t>(seq >> (8 * i));
+  }
+}
+
+util::StatusOr<std::string> HpkeContext::Seal(
+    absl::string_view plaintext, absl::string_view associated_data) {
+  if (!is_sender_) {
+    return util::Status(util::error::FAILED_PRECONDITION,
+                        "Seal() needs a sender context");
+  }
+  uint64_t seq;
+  {
+    absl::MutexLock lock(&mutex_);
+    if (seq_ == std::numeric_limits<uint64_t>::max()) {
+      return util::Status(util::error::RESOURCE_EXHAUSTED,
+                          "HPKE message limit reached");
+    }
+    seq = seq_++;
+  }
+  uint8_t nonce[kNonceSize];
+  ComputeNonce(seq, nonce);
+  plaintext = SubtleUtilBoringSSL::EnsureNonNull(plaintext);
+  associated_data = SubtleUtilBoringSSL::EnsureNonNull(associated_data);
+  std::string ciphertext;
+  subtle::ResizeStringUninitialized(&ciphertext, plaintext.size() + kTagSize);
+  size_t ciphertext_size;
+  if (EVP_AEAD_CTX_seal(
+          aead_ctx_.get(), reinterpret_cast<uint8_t*>(&ciphertext[0]),
+          &ciphertext_size, ciphertext.size(), nonce, kNonceSize,
+          reinterpret_cast<const uint8_t*>(plaintext.data()), plaintext.size(),
+          reinterpret_cast<const uint8_t*>(associated_data.data()),
+          associated_data.size()) != 1 ||
+      ciphertext_size != ciphertext.size()) {
+    return util::Status(util::error::INTERNAL, "Encryption failed");
+  }
+  return ciphertext;
+}
+
+util::StatusOr<std::string> HpkeContext::Open(
+    absl::string_view ciphertext, absl::string_view associated_data) {
+  if (is_sender_) {
+    return util::Status(util::error::FAILED_PRECONDITION,
+                        "Open() needs a recipient context");
+  }
+  if (ciphertext.size() < kTagSize) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "Ciphertext too short");
+  }
+  associated_data = SubtleUtilBoringSSL::EnsureNonNull(associated_data);
+  std::string plaintext;
+  subtle::ResizeStringUninitialized(&plaintext, ciphertext.size() - kTagSize);
+  absl::MutexLock lock(&mutex_);
+  if (seq_ == std::numeric_limits<uint64_t>::max()) {
+    return util::Status(util::error::RESOURCE_EXHAUSTED,
+                        "HPKE message limit reached");
+  }
+  uint8_t nonce[kNonceSize];
+  ComputeNonce(seq_, nonce);
+  size_t plaintext_size;
+  if (EVP_AEAD_CTX_open(
+          aead_ctx_.get(), reinterpret_cast<uint8_t*>(&plaintext[0]),
+          &plaintext_size, plaintext.size(), nonce, kNonceSize,
+          reinterpret_cast<const uint8_t*>(ciphertext.data()),
+          ciphertext.size(),
+          reinterpret_cast<const uint8_t*>(associated_data.data()),
+          associated_data.size()) != 1) {
+    return util::Status(util::error::INVALID_ARGUMENT, "Decryption failed");
+  }
+  ++seq_;
+  return plaintext;
+}
+
+util::StatusOr<util::SecretData> HpkeContext::Export(
+    absl::string_view exporter_context, int length) const {
+  if (length <= 0 || length > 255 * kHashSize) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "Invalid export length");
+  }
+  return LabeledExpand(suite_id_, exporter_secret_, "sec", exporter_context,
+                       length);
+}
+
+}  // namespace internal
+}  // namespace tink
+}  // namespace crypto
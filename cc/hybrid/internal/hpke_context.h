@@ -0,0 +1,144 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TINK_HYBRID_INTERNAL_HPKE_CONTEXT_H_
+#define TINK_HYBRID_INTERNAL_HPKE_CONTEXT_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "openssl/aead.h"
+#include "openssl/base.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace internal {
+
+// The HPKE (RFC 9180) algorithms which are supported.
+enum class HpkeKem {
+  kX25519HkdfSha256,  // DHKEM(X25519, HKDF-SHA256)
+  kP256HkdfSha256,    // DHKEM(P-256, HKDF-SHA256)
+};
+
+enum class HpkeKdf {
+  kHkdfSha256,
+};
+
+enum class HpkeAead {
+  kAes128Gcm,
+  kChaCha20Poly1305,
+};
+
+struct HpkeParams {
+  HpkeKem kem;
+  HpkeKdf kdf;
+  HpkeAead aead;
+};
+
+// Returns an error if 'params' names an unsupported algorithm.
+util::Status ValidateHpkeParams(const HpkeParams& params);
+
+// Returns the size of the serialized public keys of 'kem', which is also the
+// size of its encapsulated keys: 32 bytes for X25519 and 65 bytes (an
+// uncompressed point) for P-256.
+int HpkeEncapsulatedKeySize(HpkeKem kem);
+
+// Returns an error if 'public_key' is not a serialized public key of 'kem'.
+util::Status ValidateHpkePublicKey(HpkeKem kem, absl::string_view public_key);
+
+// Returns the serialized public key of the serialized 'private_key' of 'kem'.
+util::StatusOr<std::string> HpkePublicKeyFromPrivateKey(
+    HpkeKem kem, const util::SecretData& private_key);
+
+// An HPKE context in base mode (RFC 9180, section 5.1), i.e. an AEAD key and
+// base nonce derived from a single key encapsulation, which encrypts a
+// sequence of messages to the same recipient.
+//
+// The AEAD is set up directly from the key schedule, so apart from the
+// encapsulation, which costs one Diffie-Hellman operation on either side,
+// a message costs one AEAD operation. All methods are thread-safe, but a
+// recipient context has to open the messages in the order they were sealed.
+class HpkeContext {
+ public:
+  // Sets up a context to encrypt messages to the owner of the serialized
+  // 'recipient_public_key'. The recipient needs encapsulated_key() and the
+  // same 'info' to set up the matching context.
+  static util::StatusOr<std::unique_ptr<HpkeContext>> SetupSender(
+      const HpkeParams& params, absl::string_view recipient_public_key,
+      absl::string_view info);
+
+  // Sets up a context to decrypt the messages of the sender which produced
+  // 'encapsulated_key'. 'recipient_public_key' must be the public key of
+  // 'recipient_private_key', see HpkePublicKeyFromPrivateKey().
+  static util::StatusOr<std::unique_ptr<HpkeContext>> SetupRecipient(
+      const HpkeParams& params, const util::SecretData& recipient_private_key,
+      absl::string_view recipient_public_key,
+      absl::string_view encapsulated_key, absl::string_view info);
+
+  // The encapsulated key of a sender context.
+  const std::string& encapsulated_key() const { return encapsulated_key_; }
+
+  // Encrypts the next message of a sender context.
+  util::StatusOr<std::string> Seal(absl::string_view plaintext,
+                                   absl::string_view associated_data);
+
+  // Decrypts the next message of a recipient context. The sequence number
+  // only advances if 'ciphertext' is valid.
+  util::StatusOr<std::string> Open(absl::string_view ciphertext,
+                                   absl::string_view associated_data);
+
+  // Returns 'length' bytes of secret derived from the context and
+  // 'exporter_context', which are the same on both sides.
+  util::StatusOr<util::SecretData> Export(absl::string_view exporter_context,
+                                          int length) const;
+
+ private:
+  // KeySchedule() of base mode (RFC 9180, section 5.1).
+  static util::StatusOr<std::unique_ptr<HpkeContext>> KeySchedule(
+      const HpkeParams& params, bool is_sender,
+      const util::SecretData& shared_secret, absl::string_view info,
+      std::string encapsulated_key);
+
+  HpkeContext(bool is_sender, std::string encapsulated_key,
+              std::string suite_id, bssl::UniquePtr<EVP_AEAD_CTX> aead_ctx,
+              util::SecretData base_nonce, util::SecretData exporter_secret);
+
+  // Writes the nonce of the message with sequence number 'seq' to 'nonce'.
+  void ComputeNonce(uint64_t seq, uint8_t* nonce) const;
+
+  const bool is_sender_;
+  const std::string encapsulated_key_;
+  const std::string suite_id_;
+  const bssl::UniquePtr<EVP_AEAD_CTX> aead_ctx_;
+  const util::SecretData base_nonce_;
+  const util::SecretData exporter_secret_;
+  absl::Mutex mutex_;
+  uint64_t seq_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+}  // namespace internal
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_HYBRID_INTERNAL_HPKE_CONTEXT_H_
@@ -0,0 +1,313 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/hybrid/internal/hpke_context.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "tink/subtle/common_enums.h"
+#include "tink/subtle/random.h"
+#include "tink/subtle/subtle_util_boringssl.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/test_matchers.h"
+#include "tink/util/test_util.h"
+
+namespace crypto {
+namespace tink {
+namespace internal {
+namespace {
+
+using ::crypto::tink::subtle::SubtleUtilBoringSSL;
+using ::crypto::tink::test::HexDecodeOrDie;
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::testing::Eq;
+using ::testing::Not;
+
+struct KeyPair {
+  util::SecretData private_key;
+  std::string public_key;
+};
+
+KeyPair NewKeyPair(HpkeKem kem) {
+  KeyPair key_pair;
+  if (kem == HpkeKem::kX25519HkdfSha256) {
+    auto key = SubtleUtilBoringSSL::GenerateNewX25519Key();
+    key_pair.private_key = util::SecretData(
+        key->private_key, key->private_key + X25519_PRIVATE_KEY_LEN);
+  } else {
+    auto key_result =
+        SubtleUtilBoringSSL::GetNewEcKey(subtle::EllipticCurveType::NIST_P256);
+    EXPECT_THAT(key_result.status(), IsOk());
+    key_pair.private_key = key_result.ValueOrDie().priv;
+  }
+  auto public_key_result =
+      HpkePublicKeyFromPrivateKey(kem, key_pair.private_key);
+  EXPECT_THAT(public_key_result.status(), IsOk());
+  key_pair.public_key = public_key_result.ValueOrDie();
+  return key_pair;
+}
+
+std::vector<HpkeParams> AllParams() {
+  std::vector<HpkeParams> all_params;
+  for (HpkeKem kem : {HpkeKem::kX25519HkdfSha256, HpkeKem::kP256HkdfSha256}) {
+    for (HpkeAead aead :
+         {HpkeAead::kAes128Gcm, HpkeAead::kChaCha20Poly1305}) {
+      all_params.push_back({kem, HpkeKdf::kHkdfSha256, aead});
+    }
+  }
+  return all_params;
+}
+
+// RFC 9180, appendix A.1.1: DHKEM(X25519, HKDF-SHA256), HKDF-SHA256,
+// AES-128-GCM in base mode.
+TEST(HpkeContextTest, Rfc9180TestVector) {
+  HpkeParams params = {HpkeKem::kX25519HkdfSha256, HpkeKdf::kHkdfSha256,
+                       HpkeAead::kAes128Gcm};
+  util::SecretData recipient_private_key = util::SecretDataFromStringView(
+      HexDecodeOrDie("4612c550263fc8ad58375df3f557aac5"
+                     "31d26850903e55a9f23f21d8534e8ac8"));
+  auto public_key_result =
+      HpkePublicKeyFromPrivateKey(params.kem, recipient_private_key);
+  ASSERT_THAT(public_key_result.status(), IsOk());
+  EXPECT_THAT(public_key_result.ValueOrDie(),
+              Eq(HexDecodeOrDie("3948cfe0ad1ddb695d780e59077195da"
+                                "6c56506b027329794ab02bca80815c4d")));
+  auto context_result = HpkeContext::SetupRecipient(
+      params, recipient_private_key, public_key_result.ValueOrDie(),
+      HexDecodeOrDie("37fda3567bdbd628e88668c3c8d7e97d"
+                     "1d1253b6d4ea6d44c150f741f1bf4431"),
+      HexDecodeOrDie("4f6465206f6e2061204772656369616e2055726e"));
+  ASSERT_THAT(context_result.status(), IsOk());
+  auto plaintext_result = context_result.ValueOrDie()->Open(
+      HexDecodeOrDie("f938558b5d72f1a23810b4be2ab4f84331acc02fc97babc53a52ae"
+                     "8218a355a96d8770ac83d07bea87e13c512a"),
+      "Count-0");
+  ASSERT_THAT(plaintext_result.status(), IsOk());
+  EXPECT_THAT(plaintext_result.ValueOrDie(),
+              Eq("Beauty is truth, truth beauty"));
+  auto exported_result = context_result.ValueOrDie()->Export("", 32);
+  ASSERT_THAT(exported_result.status(), IsOk());
+  EXPECT_THAT(util::SecretDataAsStringView(exported_result.ValueOrDie()),
+              Eq(HexDecodeOrDie("3853fe2b4035195a573ffc53856e7705"
+                                "8e15d9ea064de3e59f4961d0095250ee")));
+}
+
+TEST(HpkeContextTest, MultipleMessages) {
+  for (const HpkeParams& params : AllParams()) {
+    SCOPED_TRACE(absl::StrCat("kem: ", static_cast<int>(params.kem),
+                              " aead: ", static_cast<int>(params.aead)));
+    KeyPair recipient = NewKeyPair(params.kem);
+    auto sender_result =
+        HpkeContext::SetupSender(params, recipient.public_key, "info");
+    ASSERT_THAT(sender_result.status(), IsOk());
+    HpkeContext& sender = *sender_result.ValueOrDie();
+    EXPECT_THAT(sender.encapsulated_key().size(),
+                Eq(HpkeEncapsulatedKeySize(params.kem)));
+    auto recipient_result = HpkeContext::SetupRecipient(
+        params, recipient.private_key, recipient.public_key,
+        sender.encapsulated_key(), "info");
+    ASSERT_THAT(recipient_result.status(), IsOk());
+    HpkeContext& recipient_context = *recipient_result.ValueOrDie();
+    for (int size : {0, 1, 16, 1000}) {
+      std::string plaintext = subtle::Random::GetRandomBytes(size);
+      std::string associated_data = absl::StrCat("message ", size);
+      auto ciphertext_result = sender.Seal(plaintext, associated_data);
+      ASSERT_THAT(ciphertext_result.status(), IsOk());
+      auto plaintext_result =
+          recipient_context.Open(ciphertext_result.ValueOrDie(),
+                                 associated_data);
+      ASSERT_THAT(plaintext_result.status(), IsOk());
+      EXPECT_THAT(plaintext_result.ValueOrDie(), Eq(plaintext));
+    }
+    auto sender_secret_result = sender.Export("context", 42);
+    ASSERT_THAT(sender_secret_result.status(), IsOk());
+    auto recipient_secret_result = recipient_context.Export("context", 42);
+    ASSERT_THAT(recipient_secret_result.status(), IsOk());
+    EXPECT_THAT(sender_secret_result.ValueOrDie(),
+                Eq(recipient_secret_result.ValueOrDie()));
+  }
+}
+
+TEST(HpkeContextTest, MessagesMustBeOpenedInOrder) {
+  HpkeParams params = {HpkeKem::kX25519HkdfSha256, HpkeKdf::kHkdfSha256,
+                       HpkeAead::kChaCha20Poly1305};
+  KeyPair recipient = NewKeyPair(params.kem);
+  auto sender_result = HpkeContext::SetupSender(params, recipient.public_key,
+                                                /* info = */ "");
+  ASSERT_THAT(sender_result.status(), IsOk());
+  HpkeContext& sender = *sender_result.ValueOrDie();
+  auto recipient_result = HpkeContext::SetupRecipient(
+      params, recipient.private_key, recipient.public_key,
+      sender.encapsulated_key(), /* info = */ "");
+  ASSERT_THAT(recipient_result.status(), IsOk());
+  HpkeContext& recipient_context = *recipient_result.ValueOrDie();
+  std::string first = sender.Seal("first", "").ValueOrDie();
+  std::string second = sender.Seal("second", "").ValueOrDie();
+  // A failure does not advance the sequence number.
+  EXPECT_THAT(recipient_context.Open(second, "").status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(recipient_context.Open(first, "").status(), IsOk());
+  EXPECT_THAT(recipient_context.Open(first, "").status(), Not(IsOk()));
+  EXPECT_THAT(recipient_context.Open(second, "").status(), IsOk());
+}
+
+TEST(HpkeContextTest, ModifiedInputs) {
+  for (const HpkeParams& params : AllParams()) {
+    SCOPED_TRACE(absl::StrCat("kem: ", static_cast<int>(params.kem),
+                              " aead: ", static_cast<int>(params.aead)));
+    KeyPair recipient = NewKeyPair(params.kem);
+    auto sender_result =
+        HpkeContext::SetupSender(params, recipient.public_key, "info");
+    ASSERT_THAT(sender_result.status(), IsOk());
+    std::string ciphertext =
+        sender_result.ValueOrDie()->Seal("plaintext", "ad").ValueOrDie();
+    const std::string& encapsulated_key =
+        sender_result.ValueOrDie()->encapsulated_key();
+
+    auto other_info_result = HpkeContext::SetupRecipient(
+        params, recipient.private_key, recipient.public_key,
+        encapsulated_key, "other info");
+    ASSERT_THAT(other_info_result.status(), IsOk());
+    EXPECT_THAT(
+        other_info_result.ValueOrDie()->Open(ciphertext, "ad").status(),
+        Not(IsOk()));
+    KeyPair other = NewKeyPair(params.kem);
+    auto other_recipient_result = HpkeContext::SetupRecipient(
+        params, other.private_key, other.public_key, encapsulated_key, "info");
+    ASSERT_THAT(other_recipient_result.status(), IsOk());
+    EXPECT_THAT(
+        other_recipient_result.ValueOrDie()->Open(ciphertext, "ad").status(),
+        Not(IsOk()));
+
+    auto recipient_result = HpkeContext::SetupRecipient(
+        params, recipient.private_key, recipient.public_key,
+        encapsulated_key, "info");
+    ASSERT_THAT(recipient_result.status(), IsOk());
+    HpkeContext& recipient_context = *recipient_result.ValueOrDie();
+    EXPECT_THAT(recipient_context.Open(ciphertext, "other ad").status(),
+                Not(IsOk()));
+    for (int i = 0; i < ciphertext.size(); ++i) {
+      std::string modified = ciphertext;
+      modified[i] ^= 1;
+      EXPECT_THAT(recipient_context.Open(modified, "ad").status(),
+                  Not(IsOk()));
+    }
+    EXPECT_THAT(recipient_context.Open(ciphertext.substr(1), "ad").status(),
+                Not(IsOk()));
+    EXPECT_THAT(recipient_context.Open("short", "ad").status(),
+                StatusIs(util::error::INVALID_ARGUMENT));
+    EXPECT_THAT(recipient_context.Open(ciphertext, "ad").status(), IsOk());
+  }
+}
+
+TEST(HpkeContextTest, WrongRole) {
+  HpkeParams params = {HpkeKem::kP256HkdfSha256, HpkeKdf::kHkdfSha256,
+                       HpkeAead::kAes128Gcm};
+  KeyPair recipient = NewKeyPair(params.kem);
+  auto sender_result = HpkeContext::SetupSender(params, recipient.public_key,
+                                                /* info = */ "");
+  ASSERT_THAT(sender_result.status(), IsOk());
+  std::string ciphertext =
+      sender_result.ValueOrDie()->Seal("plaintext", "").ValueOrDie();
+  EXPECT_THAT(sender_result.ValueOrDie()->Open(ciphertext, "").status(),
+              StatusIs(util::error::FAILED_PRECONDITION));
+  auto recipient_result = HpkeContext::SetupRecipient(
+      params, recipient.private_key, recipient.public_key,
+      sender_result.ValueOrDie()->encapsulated_key(), /* info = */ "");
+  ASSERT_THAT(recipient_result.status(), IsOk());
+  EXPECT_THAT(recipient_result.ValueOrDie()->Seal("plaintext", "").status(),
+              StatusIs(util::error::FAILED_PRECONDITION));
+}
+
+TEST(HpkeContextTest, InvalidKeys) {
+  HpkeParams x25519_params = {HpkeKem::kX25519HkdfSha256,
+                              HpkeKdf::kHkdfSha256, HpkeAead::kAes128Gcm};
+  HpkeParams p256_params = {HpkeKem::kP256HkdfSha256, HpkeKdf::kHkdfSha256,
+                            HpkeAead::kAes128Gcm};
+  KeyPair x25519_key = NewKeyPair(x25519_params.kem);
+  KeyPair p256_key = NewKeyPair(p256_params.kem);
+  EXPECT_THAT(
+      HpkeContext::SetupSender(x25519_params, p256_key.public_key, "")
+          .status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(
+      HpkeContext::SetupSender(p256_params, x25519_key.public_key, "")
+          .status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+  // The all-zero X25519 public key has small order.
+  EXPECT_THAT(HpkeContext::SetupSender(x25519_params, std::string(32, '\0'),
+                                       "")
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  // A point which is not on the curve.
+  std::string not_on_curve = p256_key.public_key;
+  not_on_curve[64] ^= 1;
+  EXPECT_THAT(
+      HpkeContext::SetupSender(p256_params, not_on_curve, "").status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+  // P-256 private keys must be in [1, n - 1].
+  EXPECT_THAT(HpkePublicKeyFromPrivateKey(p256_params.kem,
+                                          util::SecretData(32, 0))
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(HpkePublicKeyFromPrivateKey(p256_params.kem,
+                                          util::SecretData(32, 0xff))
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(HpkePublicKeyFromPrivateKey(x25519_params.kem,
+                                          util::SecretData(31, 1))
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(HpkeContextTest, InvalidParams) {
+  HpkeParams params = {static_cast<HpkeKem>(42), HpkeKdf::kHkdfSha256,
+                       HpkeAead::kAes128Gcm};
+  EXPECT_THAT(ValidateHpkeParams(params),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  params = {HpkeKem::kX25519HkdfSha256, HpkeKdf::kHkdfSha256,
+            static_cast<HpkeAead>(42)};
+  EXPECT_THAT(HpkeContext::SetupSender(params, std::string(32, 'a'), "")
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(HpkeContextTest, InvalidExportLength) {
+  HpkeParams params = {HpkeKem::kX25519HkdfSha256, HpkeKdf::kHkdfSha256,
+                       HpkeAead::kAes128Gcm};
+  KeyPair recipient = NewKeyPair(params.kem);
+  auto sender_result = HpkeContext::SetupSender(params, recipient.public_key,
+                                                /* info = */ "");
+  ASSERT_THAT(sender_result.status(), IsOk());
+  EXPECT_THAT(sender_result.ValueOrDie()->Export("", 0).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(sender_result.ValueOrDie()->Export("", 255 * 32 + 1).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(sender_result.ValueOrDie()->Export("", 255 * 32).status(),
+              IsOk());
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace tink
+}  // namespace crypto
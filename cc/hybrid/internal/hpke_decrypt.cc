@@ -0,0 +1,64 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/hybrid/internal/hpke_decrypt.h"
+
+#include <string>
+#include <utility>
+
+#include "tink/util/status.h"
+
+namespace crypto {
+namespace tink {
+namespace internal {
+
+// static
+util::StatusOr<std::unique_ptr<HybridDecrypt>> HpkeDecrypt::New(
+    const HpkeParams& params, util::SecretData recipient_private_key) {
+  auto status = CheckFipsCompatibility<HpkeDecrypt>();
+  if (!status.ok()) return status;
+
+  status = ValidateHpkeParams(params);
+  if (!status.ok()) return status;
+  auto public_key_result =
+      HpkePublicKeyFromPrivateKey(params.kem, recipient_private_key);
+  if (!public_key_result.ok()) return public_key_result.status();
+  std::unique_ptr<HybridDecrypt> hybrid_decrypt(
+      new HpkeDecrypt(params, std::move(recipient_private_key),
+                      std::move(public_key_result.ValueOrDie())));
+  return std::move(hybrid_decrypt);
+}
+
+util::StatusOr<std::string> HpkeDecrypt::Decrypt(
+    absl::string_view ciphertext, absl::string_view context_info) const {
+  size_t encapsulated_key_size = HpkeEncapsulatedKeySize(params_.kem);
+  if (ciphertext.size() < encapsulated_key_size) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "Ciphertext too short");
+  }
+  auto context_result = HpkeContext::SetupRecipient(
+      params_, recipient_private_key_, recipient_public_key_,
+      ciphertext.substr(0, encapsulated_key_size), context_info);
+  if (!context_result.ok()) return context_result.status();
+  return context_result.ValueOrDie()->Open(
+      ciphertext.substr(encapsulated_key_size),
+      /* associated_data = */ "");
+}
+
+}  // namespace internal
+}  // namespace tink
+}  // namespace crypto
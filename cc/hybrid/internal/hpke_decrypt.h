@@ -0,0 +1,68 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TINK_HYBRID_INTERNAL_HPKE_DECRYPT_H_
+#define TINK_HYBRID_INTERNAL_HPKE_DECRYPT_H_
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/strings/string_view.h"
+#include "tink/config/tink_fips.h"
+#include "tink/hybrid/internal/hpke_context.h"
+#include "tink/hybrid_decrypt.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace internal {
+
+// Decryption of the ciphertexts of HpkeEncrypt.
+class HpkeDecrypt : public HybridDecrypt {
+ public:
+  // Returns an HybridDecrypt-primitive for the serialized
+  // 'recipient_private_key'.
+  static crypto::tink::util::StatusOr<std::unique_ptr<HybridDecrypt>> New(
+      const HpkeParams& params, util::SecretData recipient_private_key);
+
+  crypto::tink::util::StatusOr<std::string> Decrypt(
+      absl::string_view ciphertext,
+      absl::string_view context_info) const override;
+
+  static constexpr crypto::tink::FipsCompatibility kFipsStatus =
+      crypto::tink::FipsCompatibility::kNotFips;
+
+ private:
+  HpkeDecrypt(const HpkeParams& params, util::SecretData recipient_private_key,
+              std::string recipient_public_key)
+      : params_(params),
+        recipient_private_key_(std::move(recipient_private_key)),
+        recipient_public_key_(std::move(recipient_public_key)) {}
+
+  const HpkeParams params_;
+  const util::SecretData recipient_private_key_;
+  // Needed by the KEM, computed once from 'recipient_private_key_'.
+  const std::string recipient_public_key_;
+};
+
+}  // namespace internal
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_HYBRID_INTERNAL_HPKE_DECRYPT_H_
@@ -0,0 +1,135 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/hybrid/internal/hpke_decrypt.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "tink/hybrid/internal/hpke_context.h"
+#include "tink/hybrid/internal/hpke_encrypt.h"
+#include "tink/subtle/common_enums.h"
+#include "tink/subtle/random.h"
+#include "tink/subtle/subtle_util_boringssl.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/test_matchers.h"
+
+namespace crypto {
+namespace tink {
+namespace internal {
+namespace {
+
+using ::crypto::tink::subtle::SubtleUtilBoringSSL;
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::testing::Eq;
+using ::testing::Not;
+
+util::SecretData NewPrivateKey(HpkeKem kem) {
+  if (kem == HpkeKem::kX25519HkdfSha256) {
+    auto key = SubtleUtilBoringSSL::GenerateNewX25519Key();
+    return util::SecretData(key->private_key,
+                            key->private_key + X25519_PRIVATE_KEY_LEN);
+  }
+  auto key_result =
+      SubtleUtilBoringSSL::GetNewEcKey(subtle::EllipticCurveType::NIST_P256);
+  EXPECT_THAT(key_result.status(), IsOk());
+  return key_result.ValueOrDie().priv;
+}
+
+class HpkeDecryptTest : public testing::TestWithParam<HpkeParams> {
+ protected:
+  void SetUp() override {
+    util::SecretData private_key = NewPrivateKey(GetParam().kem);
+    auto public_key_result =
+        HpkePublicKeyFromPrivateKey(GetParam().kem, private_key);
+    ASSERT_THAT(public_key_result.status(), IsOk());
+    auto encrypt_result =
+        HpkeEncrypt::New(GetParam(), public_key_result.ValueOrDie());
+    ASSERT_THAT(encrypt_result.status(), IsOk());
+    encrypt_ = std::move(encrypt_result.ValueOrDie());
+    auto decrypt_result = HpkeDecrypt::New(GetParam(), std::move(private_key));
+    ASSERT_THAT(decrypt_result.status(), IsOk());
+    decrypt_ = std::move(decrypt_result.ValueOrDie());
+  }
+
+  std::unique_ptr<HybridEncrypt> encrypt_;
+  std::unique_ptr<HybridDecrypt> decrypt_;
+};
+
+TEST_P(HpkeDecryptTest, EncryptDecrypt) {
+  for (int size : {0, 1, 100, 10000}) {
+    SCOPED_TRACE(absl::StrCat("size: ", size));
+    std::string plaintext = subtle::Random::GetRandomBytes(size);
+    auto ciphertext_result = encrypt_->Encrypt(plaintext, "context info");
+    ASSERT_THAT(ciphertext_result.status(), IsOk());
+    auto plaintext_result =
+        decrypt_->Decrypt(ciphertext_result.ValueOrDie(), "context info");
+    ASSERT_THAT(plaintext_result.status(), IsOk());
+    EXPECT_THAT(plaintext_result.ValueOrDie(), Eq(plaintext));
+  }
+}
+
+TEST_P(HpkeDecryptTest, InvalidCiphertexts) {
+  std::string ciphertext =
+      encrypt_->Encrypt("plaintext", "context info").ValueOrDie();
+  EXPECT_THAT(decrypt_->Decrypt(ciphertext, "other context info").status(),
+              Not(IsOk()));
+  for (int i = 0; i < ciphertext.size(); ++i) {
+    std::string modified = ciphertext;
+    modified[i] ^= 1;
+    EXPECT_THAT(decrypt_->Decrypt(modified, "context info").status(),
+                Not(IsOk()));
+  }
+  for (int size = 0; size < ciphertext.size(); ++size) {
+    EXPECT_THAT(
+        decrypt_->Decrypt(ciphertext.substr(0, size), "context info").status(),
+        Not(IsOk()));
+  }
+  EXPECT_THAT(decrypt_->Decrypt(ciphertext, "context info").status(), IsOk());
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    HpkeDecryptTests, HpkeDecryptTest,
+    testing::Values(HpkeParams{HpkeKem::kX25519HkdfSha256,
+                               HpkeKdf::kHkdfSha256, HpkeAead::kAes128Gcm},
+                    HpkeParams{HpkeKem::kX25519HkdfSha256,
+                               HpkeKdf::kHkdfSha256,
+                               HpkeAead::kChaCha20Poly1305},
+                    HpkeParams{HpkeKem::kP256HkdfSha256, HpkeKdf::kHkdfSha256,
+                               HpkeAead::kAes128Gcm},
+                    HpkeParams{HpkeKem::kP256HkdfSha256, HpkeKdf::kHkdfSha256,
+                               HpkeAead::kChaCha20Poly1305}));
+
+TEST(HpkeDecryptStaticTest, InvalidPrivateKey) {
+  HpkeParams params = {HpkeKem::kX25519HkdfSha256, HpkeKdf::kHkdfSha256,
+                       HpkeAead::kAes128Gcm};
+  EXPECT_THAT(HpkeDecrypt::New(params, util::SecretData(16, 1)).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  params.kem = HpkeKem::kP256HkdfSha256;
+  EXPECT_THAT(HpkeDecrypt::New(params, util::SecretData(32, 0)).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace tink
+}  // namespace crypto
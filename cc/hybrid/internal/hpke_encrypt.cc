@@ -0,0 +1,60 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/hybrid/internal/hpke_encrypt.h"
+
+#include <string>
+#include <utility>
+
+#include "absl/strings/str_cat.h"
+#include "tink/util/status.h"
+
+namespace crypto {
+namespace tink {
+namespace internal {
+
+// static
+util::StatusOr<std::unique_ptr<HybridEncrypt>> HpkeEncrypt::New(
+    const HpkeParams& params, absl::string_view recipient_public_key) {
+  auto status = CheckFipsCompatibility<HpkeEncrypt>();
+  if (!status.ok()) return status;
+
+  status = ValidateHpkeParams(params);
+  if (!status.ok()) return status;
+  status = ValidateHpkePublicKey(params.kem, recipient_public_key);
+  if (!status.ok()) return status;
+  std::unique_ptr<HybridEncrypt> hybrid_encrypt(
+      new HpkeEncrypt(params, recipient_public_key));
+  return std::move(hybrid_encrypt);
+}
+
+util::StatusOr<std::string> HpkeEncrypt::Encrypt(
+    absl::string_view plaintext, absl::string_view context_info) const {
+  auto context_result =
+      HpkeContext::SetupSender(params_, recipient_public_key_, context_info);
+  if (!context_result.ok()) return context_result.status();
+  HpkeContext& context = *context_result.ValueOrDie();
+  auto ciphertext_result =
+      context.Seal(plaintext, /* associated_data = */ "");
+  if (!ciphertext_result.ok()) return ciphertext_result.status();
+  return absl::StrCat(context.encapsulated_key(),
+                      ciphertext_result.ValueOrDie());
+}
+
+}  // namespace internal
+}  // namespace tink
+}  // namespace crypto
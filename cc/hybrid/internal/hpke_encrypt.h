@@ -0,0 +1,65 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TINK_HYBRID_INTERNAL_HPKE_ENCRYPT_H_
+#define TINK_HYBRID_INTERNAL_HPKE_ENCRYPT_H_
+
+#include <memory>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "tink/config/tink_fips.h"
+#include "tink/hybrid/internal/hpke_context.h"
+#include "tink/hybrid_encrypt.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace internal {
+
+// HPKE (RFC 9180) single-shot encryption in base mode: every message is
+// sealed in a fresh sender context with 'context_info' as the HPKE info and
+// empty associated data. The ciphertext is the encapsulated key followed by
+// the AEAD ciphertext. Use HpkeContext directly to send several messages
+// with a single encapsulation.
+class HpkeEncrypt : public HybridEncrypt {
+ public:
+  // Returns an HybridEncrypt-primitive which encrypts to the owner of the
+  // serialized 'recipient_public_key'.
+  static crypto::tink::util::StatusOr<std::unique_ptr<HybridEncrypt>> New(
+      const HpkeParams& params, absl::string_view recipient_public_key);
+
+  crypto::tink::util::StatusOr<std::string> Encrypt(
+      absl::string_view plaintext,
+      absl::string_view context_info) const override;
+
+  static constexpr crypto::tink::FipsCompatibility kFipsStatus =
+      crypto::tink::FipsCompatibility::kNotFips;
+
+ private:
+  HpkeEncrypt(const HpkeParams& params, absl::string_view recipient_public_key)
+      : params_(params), recipient_public_key_(recipient_public_key) {}
+
+  const HpkeParams params_;
+  const std::string recipient_public_key_;
+};
+
+}  // namespace internal
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_HYBRID_INTERNAL_HPKE_ENCRYPT_H_
@@ -0,0 +1,84 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/hybrid/internal/hpke_encrypt.h"
+
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "tink/hybrid/internal/hpke_context.h"
+#include "tink/subtle/subtle_util_boringssl.h"
+#include "tink/util/test_matchers.h"
+
+namespace crypto {
+namespace tink {
+namespace internal {
+namespace {
+
+using ::crypto::tink::subtle::SubtleUtilBoringSSL;
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::testing::Eq;
+using ::testing::Ne;
+
+const HpkeParams kParams = {HpkeKem::kX25519HkdfSha256, HpkeKdf::kHkdfSha256,
+                            HpkeAead::kAes128Gcm};
+
+std::string NewX25519PublicKey() {
+  auto key = SubtleUtilBoringSSL::GenerateNewX25519Key();
+  return std::string(reinterpret_cast<const char*>(key->public_value),
+                     X25519_PUBLIC_VALUE_LEN);
+}
+
+TEST(HpkeEncryptTest, CiphertextFormat) {
+  auto encrypt_result = HpkeEncrypt::New(kParams, NewX25519PublicKey());
+  ASSERT_THAT(encrypt_result.status(), IsOk());
+  auto first_result = encrypt_result.ValueOrDie()->Encrypt("plaintext", "");
+  ASSERT_THAT(first_result.status(), IsOk());
+  // Encapsulated key, plaintext and tag.
+  EXPECT_THAT(first_result.ValueOrDie().size(), Eq(32 + 9 + 16));
+  // Every message has its own encapsulated key.
+  auto second_result = encrypt_result.ValueOrDie()->Encrypt("plaintext", "");
+  ASSERT_THAT(second_result.status(), IsOk());
+  EXPECT_THAT(second_result.ValueOrDie().substr(0, 32),
+              Ne(first_result.ValueOrDie().substr(0, 32)));
+}
+
+TEST(HpkeEncryptTest, InvalidPublicKey) {
+  EXPECT_THAT(HpkeEncrypt::New(kParams, "").status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(
+      HpkeEncrypt::New(kParams, NewX25519PublicKey().substr(1)).status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+  HpkeParams p256_params = kParams;
+  p256_params.kem = HpkeKem::kP256HkdfSha256;
+  EXPECT_THAT(HpkeEncrypt::New(p256_params, std::string(65, '\x04')).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(HpkeEncryptTest, InvalidParams) {
+  HpkeParams params = kParams;
+  params.kdf = static_cast<HpkeKdf>(42);
+  EXPECT_THAT(HpkeEncrypt::New(params, NewX25519PublicKey()).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace tink
+}  // namespace crypto
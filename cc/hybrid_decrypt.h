@@ -17,6 +17,9 @@
 #ifndef TINK_HYBRID_DECRYPT_H_
 #define TINK_HYBRID_DECRYPT_H_
 
+#include <cstdint>
+#include <string>
+
 #include "absl/strings/string_view.h"
 #include "tink/util/statusor.h"
 
@@ -59,6 +62,18 @@ class HybridDecrypt {
   virtual crypto::tink::util::StatusOr<std::string> Decrypt(
       absl::string_view ciphertext, absl::string_view context_info) const = 0;
 
+  // Decrypts 'ciphertext' like Decrypt(), where 'key_id' is a hint of the ID
+  // of the key to which it was encrypted, for instance one sent along with a
+  // ciphertext of a RAW key. Primitives of a keyset try the key with that ID
+  // first, instead of every key which could match the ciphertext, each of
+  // which costs a key agreement. A wrong hint only costs one failed
+  // decryption. The default implementation ignores the hint.
+  virtual crypto::tink::util::StatusOr<std::string> DecryptWithKeyId(
+      absl::string_view ciphertext, absl::string_view context_info,
+      uint32_t key_id) const {
+    return Decrypt(ciphertext, context_info);
+  }
+
   virtual ~HybridDecrypt() {}
 };
 
@@ -0,0 +1,280 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/integration/arrow/column_encryptor.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "tink/aead.h"
+#include "tink/deterministic_aead.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace integration {
+namespace arrow {
+
+using ::crypto::tink::util::Status;
+using ::crypto::tink::util::StatusOr;
+
+namespace {
+
+bool IsNull(const uint8_t* null_bitmap, int64_t index) {
+  return null_bitmap != nullptr &&
+         (null_bitmap[index / 8] & (1 << (index % 8))) == 0;
+}
+
+// The shared state of the tasks processing the chunks of a column.
+template <typename OffsetType>
+struct ColumnJob {
+  using ProcessChunkFn = std::function<Status(
+      const BinaryArrayView<OffsetType>&, BinaryArray<OffsetType>*)>;
+
+  ColumnJob(absl::Span<const BinaryArrayView<OffsetType>> chunks,
+            ProcessChunkFn process_chunk)
+      : chunks(chunks), process_chunk(std::move(process_chunk)),
+        results(chunks.size()), statuses(chunks.size()) {}
+
+  // Takes the next chunk to process into '*chunk_nr', and returns false if
+  // there is none left, or a chunk failed already.
+  bool NextChunk(int64_t* chunk_nr) ABSL_LOCKS_EXCLUDED(mutex) {
+    absl::MutexLock lock(&mutex);
+    if (failed || next_chunk >= chunks.size()) return false;
+    *chunk_nr = next_chunk++;
+    return true;
+  }
+
+  // Processes chunks until none are left.
+  void Run() ABSL_LOCKS_EXCLUDED(mutex) {
+    int64_t chunk_nr;
+    while (NextChunk(&chunk_nr)) {
+      // Each chunk has its own result and status, so these need no lock.
+      statuses[chunk_nr] = process_chunk(chunks[chunk_nr], &results[chunk_nr]);
+      if (statuses[chunk_nr].ok()) continue;
+      absl::MutexLock lock(&mutex);
+      failed = true;
+    }
+    absl::MutexLock lock(&mutex);
+    running_tasks--;
+  }
+
+  const absl::Span<const BinaryArrayView<OffsetType>> chunks;
+  const ProcessChunkFn process_chunk;
+  std::vector<BinaryArray<OffsetType>> results;
+  std::vector<Status> statuses;
+
+  absl::Mutex mutex;
+  int64_t next_chunk ABSL_GUARDED_BY(mutex) = 0;
+  bool failed ABSL_GUARDED_BY(mutex) = false;
+  int running_tasks ABSL_GUARDED_BY(mutex) = 0;
+};
+
+// Checks that the offsets of the values of 'chunk' are well-formed.
+template <typename OffsetType>
+Status ValidateChunk(const BinaryArrayView<OffsetType>& chunk) {
+  if (chunk.length < 0 || chunk.offset < 0) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "length and offset must be non-negative");
+  }
+  if (chunk.offsets == nullptr) {
+    return Status(util::error::INVALID_ARGUMENT, "offsets must be non-null");
+  }
+  const OffsetType* offsets = chunk.offsets + chunk.offset;
+  if (offsets[0] < 0) {
+    return Status(util::error::INVALID_ARGUMENT, "negative value offset");
+  }
+  for (int64_t i = 0; i < chunk.length; i++) {
+    if (offsets[i + 1] < offsets[i]) {
+      return Status(util::error::INVALID_ARGUMENT,
+                    absl::StrCat("value offsets decrease at index ", i));
+    }
+  }
+  if (chunk.values == nullptr && offsets[chunk.length] > offsets[0]) {
+    return Status(util::error::INVALID_ARGUMENT, "values must be non-null");
+  }
+  return util::OkStatus();
+}
+
+}  // namespace
+
+// static
+StatusOr<std::unique_ptr<ColumnEncryptor>> ColumnEncryptor::NewEncrypting(
+    std::unique_ptr<Aead> aead, const Options& options) {
+  if (aead == nullptr) {
+    return Status(util::error::INVALID_ARGUMENT, "aead must be non-null");
+  }
+  if (options.max_chunks_in_flight <= 0) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "max_chunks_in_flight must be positive");
+  }
+  return {absl::WrapUnique(
+      new ColumnEncryptor(std::move(aead), nullptr, options))};
+}
+
+// static
+StatusOr<std::unique_ptr<ColumnEncryptor>> ColumnEncryptor::NewTokenizing(
+    std::unique_ptr<DeterministicAead> daead, const Options& options) {
+  if (daead == nullptr) {
+    return Status(util::error::INVALID_ARGUMENT, "daead must be non-null");
+  }
+  if (options.max_chunks_in_flight <= 0) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "max_chunks_in_flight must be positive");
+  }
+  return {absl::WrapUnique(
+      new ColumnEncryptor(nullptr, std::move(daead), options))};
+}
+
+StatusOr<std::vector<BinaryArray<int32_t>>> ColumnEncryptor::Encrypt(
+    absl::Span<const BinaryArrayView<int32_t>> chunks,
+    absl::string_view column_associated_data) const {
+  return ProcessColumn(/*encrypt=*/true, chunks, column_associated_data);
+}
+
+StatusOr<std::vector<BinaryArray<int64_t>>> ColumnEncryptor::Encrypt(
+    absl::Span<const BinaryArrayView<int64_t>> chunks,
+    absl::string_view column_associated_data) const {
+  return ProcessColumn(/*encrypt=*/true, chunks, column_associated_data);
+}
+
+StatusOr<std::vector<BinaryArray<int32_t>>> ColumnEncryptor::Decrypt(
+    absl::Span<const BinaryArrayView<int32_t>> chunks,
+    absl::string_view column_associated_data) const {
+  return ProcessColumn(/*encrypt=*/false, chunks, column_associated_data);
+}
+
+StatusOr<std::vector<BinaryArray<int64_t>>> ColumnEncryptor::Decrypt(
+    absl::Span<const BinaryArrayView<int64_t>> chunks,
+    absl::string_view column_associated_data) const {
+  return ProcessColumn(/*encrypt=*/false, chunks, column_associated_data);
+}
+
+Status ColumnEncryptor::ProcessBatch(
+    bool encrypt,
+    absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs,
+    std::string* arena, std::vector<absl::string_view>* outputs) const {
+  if (aead_ != nullptr) {
+    return encrypt ? aead_->BatchEncrypt(inputs, arena, outputs)
+                   : aead_->BatchDecrypt(inputs, arena, outputs);
+  }
+  return encrypt
+             ? daead_->EncryptDeterministicallyBatch(inputs, arena, outputs)
+             : daead_->DecryptDeterministicallyBatch(inputs, arena, outputs);
+}
+
+template <typename OffsetType>
+StatusOr<std::vector<BinaryArray<OffsetType>>> ColumnEncryptor::ProcessColumn(
+    bool encrypt, absl::Span<const BinaryArrayView<OffsetType>> chunks,
+    absl::string_view column_associated_data) const {
+  for (size_t i = 0; i < chunks.size(); i++) {
+    Status status = ValidateChunk(chunks[i]);
+    if (!status.ok()) {
+      return Status(status.CanonicalCode(),
+                    absl::StrCat("chunk ", i, ": ", status.error_message()));
+    }
+  }
+  auto process_chunk = [this, encrypt, column_associated_data](
+                           const BinaryArrayView<OffsetType>& chunk,
+                           BinaryArray<OffsetType>* result) -> Status {
+    const OffsetType* offsets = chunk.offsets + chunk.offset;
+    const char* values = reinterpret_cast<const char*>(chunk.values);
+    std::vector<std::pair<absl::string_view, absl::string_view>> inputs;
+    inputs.reserve(chunk.length);
+    for (int64_t i = 0; i < chunk.length; i++) {
+      if (IsNull(chunk.null_bitmap, chunk.offset + i)) continue;
+      inputs.emplace_back(
+          absl::string_view(values + offsets[i], offsets[i + 1] - offsets[i]),
+          column_associated_data);
+    }
+    std::vector<absl::string_view> outputs;
+    Status status = ProcessBatch(encrypt, inputs, &result->values, &outputs);
+    if (!status.ok()) return status;
+    if (result->values.size() > std::numeric_limits<OffsetType>::max()) {
+      return Status(util::error::OUT_OF_RANGE,
+                    "values do not fit the offsets, use a large binary array");
+    }
+
+    // The outputs are stored back-to-back, in the order of the inputs.
+    result->length = chunk.length;
+    result->offsets.resize(chunk.length + 1);
+    result->offsets[0] = 0;
+    size_t next_output = 0;
+    for (int64_t i = 0; i < chunk.length; i++) {
+      OffsetType size = 0;
+      if (!IsNull(chunk.null_bitmap, chunk.offset + i)) {
+        size = outputs[next_output++].size();
+      }
+      result->offsets[i + 1] = result->offsets[i] + size;
+    }
+    result->null_count = chunk.length - outputs.size();
+    if (result->null_count > 0) {
+      result->null_bitmap.assign((chunk.length + 7) / 8, 0);
+      for (int64_t i = 0; i < chunk.length; i++) {
+        if (IsNull(chunk.null_bitmap, chunk.offset + i)) continue;
+        result->null_bitmap[i / 8] |= 1 << (i % 8);
+      }
+    }
+    return util::OkStatus();
+  };
+
+  // Shared with the tasks, so that it outlives the last of them.
+  auto job = std::make_shared<ColumnJob<OffsetType>>(chunks, process_chunk);
+  int num_tasks = 1;
+  if (options_.schedule) {
+    num_tasks = static_cast<int>(std::min<int64_t>(
+        options_.max_chunks_in_flight,
+        std::max<int64_t>(1, chunks.size())));
+  }
+  {
+    absl::MutexLock lock(&job->mutex);
+    job->running_tasks = num_tasks;
+  }
+  for (int i = 1; i < num_tasks; i++) {
+    options_.schedule([job]() { job->Run(); });
+  }
+  job->Run();
+
+  absl::MutexLock lock(&job->mutex);
+  job->mutex.Await(absl::Condition(
+      +[](int* count) { return *count == 0; }, &job->running_tasks));
+  for (size_t i = 0; i < chunks.size(); i++) {
+    const Status& status = job->statuses[i];
+    if (!status.ok()) {
+      return Status(status.CanonicalCode(),
+                    absl::StrCat("chunk ", i, ": ", status.error_message()));
+    }
+  }
+  return std::move(job->results);
+}
+
+}  // namespace arrow
+}  // namespace integration
+}  // namespace tink
+}  // namespace crypto
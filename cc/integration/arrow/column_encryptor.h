@@ -0,0 +1,165 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TINK_INTEGRATION_ARROW_COLUMN_ENCRYPTOR_H_
+#define TINK_INTEGRATION_ARROW_COLUMN_ENCRYPTOR_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "tink/aead.h"
+#include "tink/deterministic_aead.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace integration {
+namespace arrow {
+
+// A read-only view of the buffers of an Arrow binary or string array, in the
+// Arrow columnar format: OffsetType is int32_t for BinaryArray and
+// StringArray, and int64_t for LargeBinaryArray and LargeStringArray. The
+// fields correspond to those of arrow::ArrayData, so a view is built from an
+// array without copying:
+//   null_bitmap = data->buffers[0] ? data->buffers[0]->data() : nullptr,
+//   offsets = data->GetValues<OffsetType>(1, 0),
+//   values = data->buffers[2]->data(), length = data->length,
+//   offset = data->offset.
+// Value i of the view is values[offsets[offset + i]..offsets[offset + i + 1]),
+// and is null if 'null_bitmap' is non-null and bit (offset + i) of it is 0.
+template <typename OffsetType>
+struct BinaryArrayView {
+  int64_t length = 0;
+  int64_t offset = 0;
+  const uint8_t* null_bitmap = nullptr;
+  const OffsetType* offsets = nullptr;
+  const uint8_t* values = nullptr;
+};
+
+// The buffers of an Arrow binary array produced by ColumnEncryptor, with an
+// offset of 0. They can be handed to Arrow without copying, e.g. with
+// arrow::Buffer::FromString(std::move(values)) and
+// arrow::Buffer::FromVector(std::move(offsets)).
+template <typename OffsetType>
+struct BinaryArray {
+  int64_t length = 0;
+  int64_t null_count = 0;
+  // Empty if null_count is 0.
+  std::vector<uint8_t> null_bitmap;
+  // length + 1 entries.
+  std::vector<OffsetType> offsets;
+  std::string values;
+
+  BinaryArrayView<OffsetType> view() const {
+    BinaryArrayView<OffsetType> view;
+    view.length = length;
+    view.null_bitmap = null_bitmap.empty() ? nullptr : null_bitmap.data();
+    view.offsets = offsets.data();
+    view.values = reinterpret_cast<const uint8_t*>(values.data());
+    return view;
+  }
+};
+
+// ColumnEncryptor encrypts or tokenizes whole Arrow binary and string
+// columns, given as the chunks of an arrow::ChunkedArray. Every non-null
+// value is encrypted with the associated data of the column (e.g. its fully
+// qualified name), so that ciphertexts cannot be moved between columns
+// unnoticed; null values stay null. Each chunk is encrypted with a single
+// call of the batch API of the primitive, and chunks can be processed
+// concurrently.
+//
+// An encrypting ColumnEncryptor uses an Aead, a tokenizing one a
+// DeterministicAead, so that equal values of a column get equal tokens and
+// the column can still be joined and grouped on.
+class ColumnEncryptor {
+ public:
+  struct Options {
+    // If set, runs the given task, typically on a thread pool owned by the
+    // caller, so that up to max_chunks_in_flight chunks are processed
+    // concurrently. Tasks may run on any thread and in any order, and must
+    // all eventually run. If null, the chunks are processed one after the
+    // other on the calling thread.
+    std::function<void(std::function<void()>)> schedule;
+    // The maximal number of chunks processed concurrently. Must be positive.
+    int max_chunks_in_flight = 8;
+  };
+
+  static crypto::tink::util::StatusOr<std::unique_ptr<ColumnEncryptor>>
+  NewEncrypting(std::unique_ptr<Aead> aead, const Options& options);
+
+  static crypto::tink::util::StatusOr<std::unique_ptr<ColumnEncryptor>>
+  NewTokenizing(std::unique_ptr<DeterministicAead> daead,
+                const Options& options);
+
+  // Encrypts the chunks of a column with 'column_associated_data', and
+  // returns one encrypted array per chunk. Fails if any value fails to
+  // encrypt, or if an encrypted chunk does not fit into 32-bit offsets, in
+  // which case the column should be processed as a large binary column.
+  crypto::tink::util::StatusOr<std::vector<BinaryArray<int32_t>>> Encrypt(
+      absl::Span<const BinaryArrayView<int32_t>> chunks,
+      absl::string_view column_associated_data) const;
+  crypto::tink::util::StatusOr<std::vector<BinaryArray<int64_t>>> Encrypt(
+      absl::Span<const BinaryArrayView<int64_t>> chunks,
+      absl::string_view column_associated_data) const;
+
+  // Decrypts the chunks of a column encrypted by Encrypt() with
+  // 'column_associated_data'. Fails if any value fails to decrypt.
+  crypto::tink::util::StatusOr<std::vector<BinaryArray<int32_t>>> Decrypt(
+      absl::Span<const BinaryArrayView<int32_t>> chunks,
+      absl::string_view column_associated_data) const;
+  crypto::tink::util::StatusOr<std::vector<BinaryArray<int64_t>>> Decrypt(
+      absl::Span<const BinaryArrayView<int64_t>> chunks,
+      absl::string_view column_associated_data) const;
+
+ private:
+  ColumnEncryptor(std::unique_ptr<Aead> aead,
+                  std::unique_ptr<DeterministicAead> daead,
+                  const Options& options)
+      : aead_(std::move(aead)), daead_(std::move(daead)), options_(options) {}
+
+  // Encrypts or decrypts (if 'encrypt' is false) the values of 'inputs',
+  // which are (value, associated data) pairs, with the batch API of the
+  // primitive.
+  crypto::tink::util::Status ProcessBatch(
+      bool encrypt,
+      absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs,
+      std::string* arena, std::vector<absl::string_view>* outputs) const;
+
+  template <typename OffsetType>
+  crypto::tink::util::StatusOr<std::vector<BinaryArray<OffsetType>>>
+  ProcessColumn(bool encrypt,
+                absl::Span<const BinaryArrayView<OffsetType>> chunks,
+                absl::string_view column_associated_data) const;
+
+  const std::unique_ptr<Aead> aead_;  // null if tokenizing
+  const std::unique_ptr<DeterministicAead> daead_;  // null if encrypting
+  const Options options_;
+};
+
+}  // namespace arrow
+}  // namespace integration
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_INTEGRATION_ARROW_COLUMN_ENCRYPTOR_H_
@@ -0,0 +1,284 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/integration/arrow/column_encryptor.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "tink/subtle/test_util.h"
+#include "tink/util/status.h"
+#include "tink/util/test_matchers.h"
+#include "tink/util/test_util.h"
+
+namespace crypto {
+namespace tink {
+namespace integration {
+namespace arrow {
+namespace {
+
+using ::crypto::tink::subtle::test::TestThreadPool;
+using ::crypto::tink::test::DummyAead;
+using ::crypto::tink::test::DummyDeterministicAead;
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::testing::ElementsAre;
+using ::testing::HasSubstr;
+
+// Returns an array with the given values, where absl::nullopt is null.
+template <typename OffsetType>
+BinaryArray<OffsetType> MakeArray(
+    const std::vector<absl::optional<std::string>>& values) {
+  BinaryArray<OffsetType> array;
+  array.length = values.size();
+  array.offsets.push_back(0);
+  array.null_bitmap.assign((values.size() + 7) / 8, 0);
+  for (size_t i = 0; i < values.size(); i++) {
+    if (values[i].has_value()) {
+      array.values += *values[i];
+      array.null_bitmap[i / 8] |= 1 << (i % 8);
+    } else {
+      array.null_count++;
+    }
+    array.offsets.push_back(array.values.size());
+  }
+  if (array.null_count == 0) array.null_bitmap.clear();
+  return array;
+}
+
+// Returns the values of 'view', where absl::nullopt is null.
+template <typename OffsetType>
+std::vector<absl::optional<std::string>> GetValues(
+    const BinaryArrayView<OffsetType>& view) {
+  std::vector<absl::optional<std::string>> values;
+  for (int64_t i = view.offset; i < view.offset + view.length; i++) {
+    if (view.null_bitmap != nullptr &&
+        (view.null_bitmap[i / 8] & (1 << (i % 8))) == 0) {
+      values.push_back(absl::nullopt);
+      continue;
+    }
+    values.push_back(std::string(
+        reinterpret_cast<const char*>(view.values) + view.offsets[i],
+        view.offsets[i + 1] - view.offsets[i]));
+  }
+  return values;
+}
+
+std::unique_ptr<ColumnEncryptor> NewEncrypting(
+    const ColumnEncryptor::Options& options) {
+  auto encryptor_result = ColumnEncryptor::NewEncrypting(
+      absl::make_unique<DummyAead>("column aead"), options);
+  EXPECT_THAT(encryptor_result.status(), IsOk());
+  return std::move(encryptor_result.ValueOrDie());
+}
+
+template <typename OffsetType>
+void TestRoundTrip(const ColumnEncryptor::Options& options) {
+  auto encryptor = NewEncrypting(options);
+  std::vector<BinaryArray<OffsetType>> arrays;
+  std::vector<BinaryArrayView<OffsetType>> chunks;
+  std::vector<std::vector<absl::optional<std::string>>> expected;
+  for (int i = 0; i < 20; i++) {
+    std::vector<absl::optional<std::string>> values;
+    for (int j = 0; j < i * 10; j++) {
+      if (j % 7 == 3) {
+        values.push_back(absl::nullopt);
+      } else {
+        values.push_back(absl::StrCat("value ", i, ".", j));
+      }
+    }
+    arrays.push_back(MakeArray<OffsetType>(values));
+    expected.push_back(values);
+  }
+  for (const auto& array : arrays) chunks.push_back(array.view());
+
+  auto encrypted_result = encryptor->Encrypt(chunks, "db.table.column");
+  ASSERT_THAT(encrypted_result.status(), IsOk());
+  const auto& encrypted = encrypted_result.ValueOrDie();
+  ASSERT_EQ(encrypted.size(), chunks.size());
+  DummyAead aead("column aead");
+  std::vector<BinaryArrayView<OffsetType>> encrypted_chunks;
+  for (size_t i = 0; i < encrypted.size(); i++) {
+    EXPECT_EQ(encrypted[i].length, arrays[i].length);
+    EXPECT_EQ(encrypted[i].null_count, arrays[i].null_count);
+    auto values = GetValues(encrypted[i].view());
+    for (size_t j = 0; j < values.size(); j++) {
+      ASSERT_EQ(values[j].has_value(), expected[i][j].has_value());
+      if (!values[j].has_value()) continue;
+      // Each value is encrypted with the column associated data.
+      auto decrypt_result = aead.Decrypt(*values[j], "db.table.column");
+      ASSERT_THAT(decrypt_result.status(), IsOk());
+      EXPECT_EQ(decrypt_result.ValueOrDie(), *expected[i][j]);
+    }
+    encrypted_chunks.push_back(encrypted[i].view());
+  }
+
+  auto decrypted_result =
+      encryptor->Decrypt(encrypted_chunks, "db.table.column");
+  ASSERT_THAT(decrypted_result.status(), IsOk());
+  ASSERT_EQ(decrypted_result.ValueOrDie().size(), chunks.size());
+  for (size_t i = 0; i < chunks.size(); i++) {
+    EXPECT_EQ(GetValues(decrypted_result.ValueOrDie()[i].view()),
+              expected[i]);
+  }
+}
+
+TEST(ColumnEncryptorTest, RoundTrip) {
+  TestRoundTrip<int32_t>(ColumnEncryptor::Options());
+  TestRoundTrip<int64_t>(ColumnEncryptor::Options());
+}
+
+TEST(ColumnEncryptorTest, ParallelRoundTrip) {
+  TestThreadPool pool(4);
+  ColumnEncryptor::Options options;
+  options.schedule = [&pool](std::function<void()> task) {
+    pool.Schedule(std::move(task));
+  };
+  options.max_chunks_in_flight = 3;
+  TestRoundTrip<int32_t>(options);
+  TestRoundTrip<int64_t>(options);
+}
+
+TEST(ColumnEncryptorTest, SlicedChunk) {
+  auto encryptor = NewEncrypting(ColumnEncryptor::Options());
+  auto array = MakeArray<int32_t>(
+      {std::string("a"), absl::nullopt, std::string("bc"), std::string(""),
+       absl::nullopt, std::string("def"), std::string("g"), absl::nullopt,
+       std::string("hi"), std::string("j")});
+  auto view = array.view();
+  view.offset = 4;
+  view.length = 5;
+  std::vector<BinaryArrayView<int32_t>> chunks = {view};
+  auto encrypted_result = encryptor->Encrypt(chunks, "column");
+  ASSERT_THAT(encrypted_result.status(), IsOk());
+  EXPECT_EQ(encrypted_result.ValueOrDie()[0].null_count, 2);
+  std::vector<BinaryArrayView<int32_t>> encrypted_chunks = {
+      encrypted_result.ValueOrDie()[0].view()};
+  auto decrypted_result = encryptor->Decrypt(encrypted_chunks, "column");
+  ASSERT_THAT(decrypted_result.status(), IsOk());
+  EXPECT_THAT(GetValues(decrypted_result.ValueOrDie()[0].view()),
+              ElementsAre(absl::nullopt, std::string("def"), std::string("g"),
+                          absl::nullopt, std::string("hi")));
+}
+
+TEST(ColumnEncryptorTest, Tokenizing) {
+  auto encryptor_result = ColumnEncryptor::NewTokenizing(
+      absl::make_unique<DummyDeterministicAead>("column daead"),
+      ColumnEncryptor::Options());
+  ASSERT_THAT(encryptor_result.status(), IsOk());
+  auto encryptor = std::move(encryptor_result.ValueOrDie());
+  auto array = MakeArray<int32_t>(
+      {std::string("alice"), std::string("bob"), std::string("alice")});
+  std::vector<BinaryArrayView<int32_t>> chunks = {array.view()};
+  auto tokens_result = encryptor->Encrypt(chunks, "users.name");
+  ASSERT_THAT(tokens_result.status(), IsOk());
+  auto tokens = GetValues(tokens_result.ValueOrDie()[0].view());
+  // Equal values get equal tokens.
+  EXPECT_EQ(tokens[0], tokens[2]);
+  EXPECT_NE(tokens[0], tokens[1]);
+  DummyDeterministicAead daead("column daead");
+  EXPECT_EQ(*tokens[1],
+            daead.EncryptDeterministically("bob", "users.name").ValueOrDie());
+  std::vector<BinaryArrayView<int32_t>> token_chunks = {
+      tokens_result.ValueOrDie()[0].view()};
+  auto decrypted_result = encryptor->Decrypt(token_chunks, "users.name");
+  ASSERT_THAT(decrypted_result.status(), IsOk());
+  EXPECT_THAT(GetValues(decrypted_result.ValueOrDie()[0].view()),
+              ElementsAre(std::string("alice"), std::string("bob"),
+                          std::string("alice")));
+}
+
+TEST(ColumnEncryptorTest, WrongColumnAssociatedData) {
+  auto encryptor = NewEncrypting(ColumnEncryptor::Options());
+  auto first = MakeArray<int32_t>({std::string("a")});
+  auto second = MakeArray<int32_t>({std::string("b"), absl::nullopt});
+  std::vector<BinaryArrayView<int32_t>> chunks = {first.view(),
+                                                  second.view()};
+  auto encrypted_result = encryptor->Encrypt(chunks, "column");
+  ASSERT_THAT(encrypted_result.status(), IsOk());
+  std::vector<BinaryArrayView<int32_t>> encrypted_chunks = {
+      encrypted_result.ValueOrDie()[0].view(),
+      encrypted_result.ValueOrDie()[1].view()};
+  EXPECT_THAT(encryptor->Decrypt(encrypted_chunks, "other column").status(),
+              StatusIs(util::error::INVALID_ARGUMENT, HasSubstr("chunk 0")));
+  // Ciphertexts of one column cannot be decrypted as another column.
+  encrypted_chunks[0] = first.view();
+  EXPECT_THAT(encryptor->Decrypt(encrypted_chunks, "column").status(),
+              StatusIs(util::error::INVALID_ARGUMENT, HasSubstr("chunk 0")));
+}
+
+TEST(ColumnEncryptorTest, EmptyColumn) {
+  auto encryptor = NewEncrypting(ColumnEncryptor::Options());
+  auto encrypted_result =
+      encryptor->Encrypt(std::vector<BinaryArrayView<int32_t>>(), "column");
+  ASSERT_THAT(encrypted_result.status(), IsOk());
+  EXPECT_TRUE(encrypted_result.ValueOrDie().empty());
+  auto array = MakeArray<int64_t>({});
+  std::vector<BinaryArrayView<int64_t>> chunks = {array.view()};
+  auto empty_chunk_result = encryptor->Encrypt(chunks, "column");
+  ASSERT_THAT(empty_chunk_result.status(), IsOk());
+  EXPECT_EQ(empty_chunk_result.ValueOrDie()[0].length, 0);
+  EXPECT_THAT(empty_chunk_result.ValueOrDie()[0].offsets, ElementsAre(0));
+}
+
+TEST(ColumnEncryptorTest, InvalidChunk) {
+  auto encryptor = NewEncrypting(ColumnEncryptor::Options());
+  auto valid = MakeArray<int32_t>({std::string("a")});
+  auto invalid = MakeArray<int32_t>({std::string("ab"), std::string("c")});
+  invalid.offsets[1] = 4;
+  std::vector<BinaryArrayView<int32_t>> chunks = {valid.view(),
+                                                  invalid.view()};
+  EXPECT_THAT(encryptor->Encrypt(chunks, "column").status(),
+              StatusIs(util::error::INVALID_ARGUMENT,
+                       HasSubstr("chunk 1: value offsets decrease")));
+  BinaryArrayView<int32_t> no_offsets;
+  no_offsets.length = 1;
+  chunks = {no_offsets};
+  EXPECT_THAT(encryptor->Encrypt(chunks, "column").status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(ColumnEncryptorTest, InvalidArguments) {
+  EXPECT_THAT(ColumnEncryptor::NewEncrypting(nullptr,
+                                             ColumnEncryptor::Options())
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(ColumnEncryptor::NewTokenizing(nullptr,
+                                             ColumnEncryptor::Options())
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  ColumnEncryptor::Options options;
+  options.max_chunks_in_flight = 0;
+  EXPECT_THAT(ColumnEncryptor::NewEncrypting(
+                  absl::make_unique<DummyAead>("aead"), options)
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace arrow
+}  // namespace integration
+}  // namespace tink
+}  // namespace crypto
@@ -28,6 +28,7 @@
 #include "aws/kms/model/EncryptRequest.h"
 #include "aws/kms/model/EncryptResult.h"
 #include "tink/aead.h"
+#include "tink/internal/tracing_span.h"
 #include "tink/util/errors.h"
 #include "tink/util/status.h"
 #include "tink/util/statusor.h"
@@ -84,6 +85,8 @@ AwsKmsAead::New(absl::string_view key_arn,
 
 StatusOr<std::string> AwsKmsAead::Encrypt(
     absl::string_view plaintext, absl::string_view associated_data) const {
+  internal::TracingSpan span("tink.awskms.encrypt");
+  span.AddBytes(plaintext.size());
   Aws::KMS::Model::EncryptRequest req;
   req.SetKeyId(key_arn_.c_str());
   Aws::Utils::ByteBuffer plaintext_buffer(
@@ -102,6 +105,7 @@ StatusOr<std::string> AwsKmsAead::Encrypt(
         blob.GetLength());
     return ciphertext;
   }
+  span.SetOk(false);
   auto& err = outcome.GetError();
   return ToStatusF(util::error::INVALID_ARGUMENT,
                    "AWS KMS encryption failed with error: %s",
@@ -110,6 +114,8 @@ StatusOr<std::string> AwsKmsAead::Encrypt(
 
 StatusOr<std::string> AwsKmsAead::Decrypt(
     absl::string_view ciphertext, absl::string_view associated_data) const {
+  internal::TracingSpan span("tink.awskms.decrypt");
+  span.AddBytes(ciphertext.size());
   Aws::KMS::Model::DecryptRequest req;
   req.SetKeyId(key_arn_.c_str());
   Aws::Utils::ByteBuffer ciphertext_buffer(
@@ -123,6 +129,7 @@ StatusOr<std::string> AwsKmsAead::Decrypt(
   auto outcome = aws_client_->Decrypt(req);
   if (outcome.IsSuccess()) {
     if (outcome.GetResult().GetKeyId() != Aws::String(key_arn_.c_str())) {
+      span.SetOk(false);
       return util::Status(util::error::INVALID_ARGUMENT,
                           "AWS KMS decryption failed: wrong key ARN.");
     }
@@ -132,6 +139,7 @@ StatusOr<std::string> AwsKmsAead::Decrypt(
         buffer.GetLength());
     return plaintext;
   }
+  span.SetOk(false);
   auto& err = outcome.GetError();
   return ToStatusF(util::error::INVALID_ARGUMENT,
                    "AWS KMS decryption failed with error: %s",
@@ -56,20 +56,26 @@ std::string GetKeyArn(absl::string_view key_uri) {
   return std::string(key_uri.substr(std::string(kKeyUriPrefix).length()));
 }
 
-// Returns ClientConfiguration with region set to the value
-// extracted from 'key_arn'.
-StatusOr<Aws::Client::ClientConfiguration>
-    GetAwsClientConfig(absl::string_view key_arn) {
+// Returns the region contained in 'key_arn'.
+StatusOr<std::string> GetRegion(absl::string_view key_arn) {
   std::vector<std::string> key_arn_parts = absl::StrSplit(key_arn, ':');
   if (key_arn_parts.size() < 6) {
     return ToStatusF(util::error::INVALID_ARGUMENT, "Invalid key ARN '%s'.",
                      key_arn);
   }
+  return key_arn_parts[3];  // 4th part of key arn
+}
+
+// Returns ClientConfiguration for 'region'.
+Aws::Client::ClientConfiguration GetAwsClientConfig(
+    const std::string& region, const AwsKmsClientOptions& options) {
   Aws::Client::ClientConfiguration config;
-  config.region = key_arn_parts[3].c_str();  // 4th part of key arn
+  config.region = region.c_str();
   config.scheme = Aws::Http::Scheme::HTTPS;
   config.connectTimeoutMs = 30000;
   config.requestTimeoutMs = 60000;
+  config.maxConnections = options.max_connections;
+  config.enableTcpKeepAlive = true;
   return config;
 }
 
@@ -181,8 +187,17 @@ void AwsKmsClient::InitAwsApi() {
 StatusOr<std::unique_ptr<AwsKmsClient>>
 AwsKmsClient::New(absl::string_view key_uri,
                   absl::string_view credentials_path) {
+  return New(key_uri, credentials_path, AwsKmsClientOptions());
+}
+
+// static
+StatusOr<std::unique_ptr<AwsKmsClient>>
+AwsKmsClient::New(absl::string_view key_uri,
+                  absl::string_view credentials_path,
+                  const AwsKmsClientOptions& options) {
   if (!aws_api_is_initialized_) InitAwsApi();
   std::unique_ptr<AwsKmsClient> client(new AwsKmsClient());
+  client->options_ = options;
 
   // Read credentials.
   auto credentials_result = GetAwsCredentials(credentials_path);
@@ -198,17 +213,27 @@ AwsKmsClient::New(absl::string_view key_uri,
       return ToStatusF(util::error::INVALID_ARGUMENT, "Key '%s' not supported",
                        key_uri);
     }
-    auto config_result = GetAwsClientConfig(client->key_arn_);
-    if (!config_result.ok()) return config_result.status();
-    // Create AWS KMSClient.
-    client->aws_client_ = Aws::MakeShared<Aws::KMS::KMSClient>(
-        kAwsCryptoAllocationTag,
-        client->credentials_,
-        config_result.ValueOrDie());
+    auto aws_client_result = client->GetAwsClient(client->key_arn_);
+    if (!aws_client_result.ok()) return aws_client_result.status();
   }
   return std::move(client);
 }
 
+StatusOr<std::shared_ptr<Aws::KMS::KMSClient>> AwsKmsClient::GetAwsClient(
+    absl::string_view key_arn) const {
+  auto region_result = GetRegion(key_arn);
+  if (!region_result.ok()) return region_result.status();
+  const std::string& region = region_result.ValueOrDie();
+  absl::MutexLock lock(&aws_clients_mutex_);
+  auto it = aws_clients_.find(region);
+  if (it != aws_clients_.end()) return it->second;
+  auto aws_client = Aws::MakeShared<Aws::KMS::KMSClient>(
+      kAwsCryptoAllocationTag, credentials_,
+      GetAwsClientConfig(region, options_));
+  aws_clients_.emplace(region, aws_client);
+  return aws_client;
+}
+
 bool AwsKmsClient::DoesSupport(absl::string_view key_uri) const {
   if (!key_arn_.empty()) {
     return key_arn_ == GetKeyArn(key_uri);
@@ -228,16 +253,10 @@ AwsKmsClient::GetAead(absl::string_view key_uri) const {
                        "This client does not support key '%s'.", key_uri);
     }
   }
-  if (!key_arn_.empty()) {  // This client is bound to a specific key.
-    return AwsKmsAead::New(key_arn_, aws_client_);
-  } else {  // Create an AWS KMSClient for the given key.
-    auto key_arn = GetKeyArn(key_uri);
-    auto config_result = GetAwsClientConfig(key_arn);
-    if (!config_result.ok()) return config_result.status();
-    auto aws_client = Aws::MakeShared<Aws::KMS::KMSClient>(
-        kAwsCryptoAllocationTag, credentials_, config_result.ValueOrDie());
-    return AwsKmsAead::New(key_arn, aws_client);
-  }
+  std::string key_arn = key_arn_.empty() ? GetKeyArn(key_uri) : key_arn_;
+  auto aws_client_result = GetAwsClient(key_arn);
+  if (!aws_client_result.ok()) return aws_client_result.status();
+  return AwsKmsAead::New(key_arn, aws_client_result.ValueOrDie());
 }
 
 Status AwsKmsClient::RegisterNewClient(absl::string_view key_uri,
@@ -16,7 +16,10 @@
 #define TINK_INTEGRATION_AWSKMS_AWS_KMS_CLIENT_H_
 
 #include <memory>
+#include <string>
 
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
 #include "aws/core/auth/AWSCredentialsProvider.h"
@@ -33,8 +36,17 @@ namespace integration {
 namespace awskms {
 
 
+struct AwsKmsClientOptions {
+  // The maximum number of concurrent HTTP connections to each region.
+  int max_connections = 25;
+};
+
 // AwsKmsClient is an implementation of KmsClient for
 // <a href="https://aws.amazon.com/kms/">AWS KMS</a>
+//
+// The client keeps one AWS KMSClient per region, which all Aead-primitives
+// it returns for keys in that region share, so that they reuse the open
+// keep-alive connections.
 class AwsKmsClient : public crypto::tink::KmsClient  {
  public:
   // Creates a new AwsKmsClient that is bound to the key specified in 'key_uri',
@@ -46,6 +58,11 @@ class AwsKmsClient : public crypto::tink::KmsClient  {
   static crypto::tink::util::StatusOr<std::unique_ptr<AwsKmsClient>>
   New(absl::string_view key_uri, absl::string_view credentials_path);
 
+  // Like New(), with the HTTP connection settings in 'options'.
+  static crypto::tink::util::StatusOr<std::unique_ptr<AwsKmsClient>>
+  New(absl::string_view key_uri, absl::string_view credentials_path,
+      const AwsKmsClientOptions& options);
+
   // Creates a new client and registers it in KMSClients.
   static crypto::tink::util::Status RegisterNewClient(
       absl::string_view key_uri, absl::string_view credentials_path);
@@ -65,9 +82,19 @@ class AwsKmsClient : public crypto::tink::KmsClient  {
   static bool aws_api_is_initialized_;
   static absl::Mutex aws_api_init_mutex_;
 
+  // Returns the AWS KMSClient for the region of 'key_arn', and creates it
+  // on first use.
+  crypto::tink::util::StatusOr<std::shared_ptr<Aws::KMS::KMSClient>>
+  GetAwsClient(absl::string_view key_arn) const;
+
   std::string key_arn_;
   Aws::Auth::AWSCredentials credentials_;
-  std::shared_ptr<Aws::KMS::KMSClient> aws_client_;
+  AwsKmsClientOptions options_;
+  mutable absl::Mutex aws_clients_mutex_;
+  // Keyed by region.
+  mutable absl::flat_hash_map<std::string,
+                              std::shared_ptr<Aws::KMS::KMSClient>>
+      aws_clients_ ABSL_GUARDED_BY(aws_clients_mutex_);
 };
 
 
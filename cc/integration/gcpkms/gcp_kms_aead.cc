@@ -14,12 +14,17 @@
 
 #include "tink/integration/gcpkms/gcp_kms_aead.h"
 
+#include <utility>
+
 #include "absl/memory/memory.h"
 #include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
 #include "google/cloud/kms/v1/service.grpc.pb.h"
 #include "tink/aead.h"
+#include "tink/internal/tracing_span.h"
 #include "tink/util/errors.h"
 #include "tink/util/status.h"
 #include "tink/util/statusor.h"
@@ -40,13 +45,24 @@ using grpc::ClientContext;
 
 GcpKmsAead::GcpKmsAead(
     absl::string_view key_name,
-    std::shared_ptr<KeyManagementService::Stub> kms_stub)
-    : key_name_(key_name), kms_stub_(kms_stub) {}
+    std::shared_ptr<KeyManagementService::Stub> kms_stub,
+    absl::Duration call_timeout)
+    : key_name_(key_name),
+      kms_stub_(std::move(kms_stub)),
+      call_timeout_(call_timeout) {}
 
 // static
 StatusOr<std::unique_ptr<Aead>>
 GcpKmsAead::New(absl::string_view key_name,
                 std::shared_ptr<KeyManagementService::Stub> kms_stub) {
+  return New(key_name, std::move(kms_stub), absl::InfiniteDuration());
+}
+
+// static
+StatusOr<std::unique_ptr<Aead>>
+GcpKmsAead::New(absl::string_view key_name,
+                std::shared_ptr<KeyManagementService::Stub> kms_stub,
+                absl::Duration call_timeout) {
   if (key_name.empty()) {
     return Status(util::error::INVALID_ARGUMENT, "Key URI cannot be empty.");
   }
@@ -54,12 +70,23 @@ GcpKmsAead::New(absl::string_view key_name,
     return Status(util::error::INVALID_ARGUMENT,
                   "KMS stub cannot be null.");
   }
-  std::unique_ptr<Aead> aead(new GcpKmsAead(key_name, kms_stub));
+  std::unique_ptr<Aead> aead(
+      new GcpKmsAead(key_name, std::move(kms_stub), call_timeout));
   return std::move(aead);
 }
 
+void GcpKmsAead::PrepareContext(ClientContext* context) const {
+  context->AddMetadata("x-goog-request-params",
+                       absl::StrCat("name=", key_name_));
+  if (call_timeout_ != absl::InfiniteDuration()) {
+    context->set_deadline(absl::ToChronoTime(absl::Now() + call_timeout_));
+  }
+}
+
 StatusOr<std::string> GcpKmsAead::Encrypt(
     absl::string_view plaintext, absl::string_view associated_data) const {
+  internal::TracingSpan span("tink.gcpkms.encrypt");
+  span.AddBytes(plaintext.size());
   EncryptRequest req;
   req.set_name(key_name_);
   req.set_plaintext(std::string(plaintext));
@@ -67,18 +94,20 @@ StatusOr<std::string> GcpKmsAead::Encrypt(
 
   EncryptResponse resp;
   ClientContext context;
-  context.AddMetadata("x-goog-request-params",
-                      absl::StrCat("name=", key_name_));
+  PrepareContext(&context);
 
   auto status =  kms_stub_->Encrypt(&context, req, &resp);
 
   if (status.ok()) return resp.ciphertext();
+  span.SetOk(false);
   return ToStatusF(util::error::INVALID_ARGUMENT,
                    "GCP KMS encryption failed: %s", status.error_message());
 }
 
 StatusOr<std::string> GcpKmsAead::Decrypt(
     absl::string_view ciphertext, absl::string_view associated_data) const {
+  internal::TracingSpan span("tink.gcpkms.decrypt");
+  span.AddBytes(ciphertext.size());
   DecryptRequest req;
   req.set_name(key_name_);
   req.set_ciphertext(std::string(ciphertext));
@@ -86,12 +115,12 @@ StatusOr<std::string> GcpKmsAead::Decrypt(
 
   DecryptResponse resp;
   ClientContext context;
-  context.AddMetadata("x-goog-request-params",
-                      absl::StrCat("name=", key_name_));
+  PrepareContext(&context);
 
   auto status =  kms_stub_->Decrypt(&context, req, &resp);
 
   if (status.ok()) return resp.plaintext();
+  span.SetOk(false);
   return ToStatusF(util::error::INVALID_ARGUMENT,
                    "GCP KMS encryption failed: %s", status.error_message());
 }
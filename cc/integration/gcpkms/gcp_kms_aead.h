@@ -16,6 +16,7 @@
 #define TINK_INTEGRATION_GCPKMS_GCP_KMS_AEAD_H_
 
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
 
 #include "google/cloud/kms/v1/service.grpc.pb.h"
 
@@ -42,6 +43,13 @@ class GcpKmsAead : public Aead {
       std::shared_ptr<google::cloud::kms::v1::KeyManagementService::Stub>
           kms_stub);
 
+  // Like New(), with a deadline of 'call_timeout' for every call to the KMS.
+  static crypto::tink::util::StatusOr<std::unique_ptr<Aead>>
+  New(absl::string_view key_name,
+      std::shared_ptr<google::cloud::kms::v1::KeyManagementService::Stub>
+          kms_stub,
+      absl::Duration call_timeout);
+
   crypto::tink::util::StatusOr<std::string> Encrypt(
       absl::string_view plaintext,
       absl::string_view associated_data) const override;
@@ -56,10 +64,17 @@ class GcpKmsAead : public Aead {
   GcpKmsAead(
       absl::string_view key_name,
       std::shared_ptr<google::cloud::kms::v1::KeyManagementService::Stub>
-          kms_stub);
+          kms_stub,
+      absl::Duration call_timeout);
+
+  // Sets the metadata and deadline of a call to the KMS.
+  void PrepareContext(grpc::ClientContext* context) const;
+
   std::string key_name_;  // The location of a crypto key in GCP KMS.
   std::shared_ptr<google::cloud::kms::v1::KeyManagementService::Stub>
       kms_stub_;
+  // absl::InfiniteDuration() if calls have no deadline.
+  absl::Duration call_timeout_;
 };
 
 
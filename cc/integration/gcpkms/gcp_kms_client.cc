@@ -20,11 +20,13 @@
 #include "grpcpp/channel.h"
 #include "grpcpp/create_channel.h"
 #include "grpcpp/security/credentials.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/memory/memory.h"
 #include "absl/strings/ascii.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_split.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "tink/integration/gcpkms/gcp_kms_aead.h"
 #include "tink/kms_clients.h"
 #include "tink/util/errors.h"
@@ -44,6 +46,7 @@ using crypto::tink::Version;
 using crypto::tink::util::Status;
 using crypto::tink::util::StatusOr;
 using google::cloud::kms::v1::KeyManagementService;
+using grpc::Channel;
 using grpc::ChannelArguments;
 using grpc::ChannelCredentials;
 
@@ -90,6 +93,30 @@ StatusOr<std::shared_ptr<ChannelCredentials>> GetCredentials(
                    "Could not load credentials from file %s", credentials_path);
 }
 
+// Returns the channel to the KMS for 'credentials_path', which is shared by
+// all clients in the process that use these credentials.
+StatusOr<std::shared_ptr<Channel>> GetChannel(
+    absl::string_view credentials_path) {
+  static absl::Mutex* mutex = new absl::Mutex();
+  // Keyed by credentials path.
+  static auto* channels =
+      new absl::flat_hash_map<std::string, std::shared_ptr<Channel>>();
+  absl::MutexLock lock(mutex);
+  auto it = channels->find(credentials_path);
+  if (it != channels->end()) return it->second;
+
+  auto creds_result = GetCredentials(credentials_path);
+  if (!creds_result.ok()) return creds_result.status();
+  ChannelArguments args;
+  args.SetUserAgentPrefix(
+      absl::StrCat(kTinkUserAgentPrefix, Version::kTinkVersion, " CPP-Python"));
+  args.SetLoadBalancingPolicyName("round_robin");
+  std::shared_ptr<Channel> channel = grpc::CreateCustomChannel(
+      kGcpKmsServer, creds_result.ValueOrDie(), args);
+  channels->emplace(std::string(credentials_path), channel);
+  return channel;
+}
+
 // Returns GCP KMS key name contained in 'key_uri'.
 // If 'key_uri' does not refer to an GCP key, returns an empty string.
 std::string GetKeyName(absl::string_view key_uri) {
@@ -103,7 +130,16 @@ std::string GetKeyName(absl::string_view key_uri) {
 StatusOr<std::unique_ptr<GcpKmsClient>>
 GcpKmsClient::New(absl::string_view key_uri,
                   absl::string_view credentials_path) {
+  return New(key_uri, credentials_path, GcpKmsClientOptions());
+}
+
+// static
+StatusOr<std::unique_ptr<GcpKmsClient>>
+GcpKmsClient::New(absl::string_view key_uri,
+                  absl::string_view credentials_path,
+                  const GcpKmsClientOptions& options) {
   std::unique_ptr<GcpKmsClient> client(new GcpKmsClient());
+  client->options_ = options;
 
   // If a specific key is given, create a GCP KMSClient.
   if (!key_uri.empty()) {
@@ -113,18 +149,14 @@ GcpKmsClient::New(absl::string_view key_uri,
                        key_uri);
     }
   }
-  // Read credentials.
-  auto creds_result = GetCredentials(credentials_path);
-  if (!creds_result.ok()) {
-    return creds_result.status();
+  auto channel_result = GetChannel(credentials_path);
+  if (!channel_result.ok()) {
+    return channel_result.status();
   }
 
   // Create a KMS stub.
-  ChannelArguments args;
-  args.SetUserAgentPrefix(
-      absl::StrCat(kTinkUserAgentPrefix, Version::kTinkVersion, " CPP-Python"));
-  client->kms_stub_ = KeyManagementService::NewStub(grpc::CreateCustomChannel(
-      kGcpKmsServer, creds_result.ValueOrDie(), args));
+  client->kms_stub_ =
+      KeyManagementService::NewStub(channel_result.ValueOrDie());
   return std::move(client);
 }
 
@@ -148,10 +180,10 @@ GcpKmsClient::GetAead(absl::string_view key_uri) const {
     }
   }
   if (!key_name_.empty()) {  // This client is bound to a specific key.
-    return GcpKmsAead::New(key_name_, kms_stub_);
+    return GcpKmsAead::New(key_name_, kms_stub_, options_.call_timeout);
   } else {  // Create an GCP KMSClient for the given key.
     auto key_name = GetKeyName(key_uri);
-    return GcpKmsAead::New(key_name, kms_stub_);
+    return GcpKmsAead::New(key_name, kms_stub_, options_.call_timeout);
   }
 }
 
@@ -16,8 +16,10 @@
 #define TINK_INTEGRATION_GCPKMS_GCP_KMS_CLIENT_H_
 
 #include <memory>
+#include <string>
 
 #include "absl/strings/string_view.h"
+#include "absl/time/time.h"
 #include "google/cloud/kms/v1/service.grpc.pb.h"
 #include "grpcpp/channel.h"
 #include "tink/aead.h"
@@ -31,8 +33,17 @@ namespace integration {
 namespace gcpkms {
 
 
+struct GcpKmsClientOptions {
+  // The deadline of every call to the KMS. By default, calls have none.
+  absl::Duration call_timeout = absl::InfiniteDuration();
+};
+
 // GcpKmsClient is an implementation of KmsClient for
 // <a href="https://cloud.google.com/kms/">Google Cloud KMS</a>.
+//
+// All clients which use the same credentials share one gRPC channel, which
+// balances the calls over the addresses of the KMS, so that they reuse its
+// connections. Calls from many threads are multiplexed onto them.
 class GcpKmsClient : public crypto::tink::KmsClient  {
  public:
   // Creates a new GcpKmsClient that is bound to the key specified in 'key_uri',
@@ -44,6 +55,11 @@ class GcpKmsClient : public crypto::tink::KmsClient  {
   static crypto::tink::util::StatusOr<std::unique_ptr<GcpKmsClient>>
   New(absl::string_view key_uri, absl::string_view credentials_path);
 
+  // Like New(), with the call settings in 'options'.
+  static crypto::tink::util::StatusOr<std::unique_ptr<GcpKmsClient>>
+  New(absl::string_view key_uri, absl::string_view credentials_path,
+      const GcpKmsClientOptions& options);
+
   // Creates a new client and registers it in KMSClients.
   static crypto::tink::util::Status RegisterNewClient(
       absl::string_view key_uri, absl::string_view credentials_path);
@@ -60,6 +76,7 @@ class GcpKmsClient : public crypto::tink::KmsClient  {
   GcpKmsClient() {}
 
   std::string key_name_;
+  GcpKmsClientOptions options_;
   std::shared_ptr<google::cloud::kms::v1::KeyManagementService::Stub> kms_stub_;
 };
 
@@ -0,0 +1,164 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/integration/keyagent/key_agent_keyset_reader.h"
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "tink/integration/keyagent/key_agent_protocol.h"
+#include "tink/util/errors.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace integration {
+namespace keyagent {
+
+using ::crypto::tink::util::Status;
+using ::crypto::tink::util::StatusOr;
+using ::google::crypto::tink::EncryptedKeyset;
+using ::google::crypto::tink::Keyset;
+
+namespace {
+
+// Closes a file descriptor when going out of scope.
+class ScopedFd {
+ public:
+  explicit ScopedFd(int fd) : fd_(fd) {}
+  ~ScopedFd() {
+    if (fd_ >= 0) close(fd_);
+  }
+  int get() const { return fd_; }
+
+ private:
+  const int fd_;
+};
+
+StatusOr<int> Connect(const std::string& socket_path, uid_t server_uid) {
+  struct sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (socket_path.size() >= sizeof(address.sun_path)) {
+    return Status(util::error::INVALID_ARGUMENT, "socket_path is too long");
+  }
+  std::memcpy(address.sun_path, socket_path.data(), socket_path.size());
+  int socket_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (socket_fd < 0) {
+    return ToStatusF(util::error::INTERNAL, "socket failed: %d", errno);
+  }
+  if (connect(socket_fd, reinterpret_cast<struct sockaddr*>(&address),
+              sizeof(address)) < 0) {
+    int connect_errno = errno;
+    close(socket_fd);
+    return ToStatusF(util::error::UNAVAILABLE,
+                     "could not connect to the key agent: %d", connect_errno);
+  }
+  // Anyone able to create the socket could impersonate the key agent, so
+  // only talk to the expected user.
+  struct ucred peer;
+  socklen_t peer_size = sizeof(peer);
+  if (getsockopt(socket_fd, SOL_SOCKET, SO_PEERCRED, &peer, &peer_size) < 0) {
+    int getsockopt_errno = errno;
+    close(socket_fd);
+    return ToStatusF(util::error::INTERNAL, "getsockopt failed: %d",
+                     getsockopt_errno);
+  }
+  if (peer.uid != server_uid) {
+    close(socket_fd);
+    return Status(util::error::PERMISSION_DENIED,
+                  absl::StrCat("the key agent runs as uid ", peer.uid,
+                               " instead of ", server_uid));
+  }
+  return socket_fd;
+}
+
+}  // namespace
+
+// static
+StatusOr<std::unique_ptr<KeysetReader>> KeyAgentKeysetReader::New(
+    absl::string_view socket_path, absl::string_view keyset_name,
+    uid_t server_uid) {
+  if (socket_path.empty()) {
+    return Status(util::error::INVALID_ARGUMENT, "socket_path must be set");
+  }
+  if (keyset_name.empty() || keyset_name.size() > kMaxKeysetNameSize) {
+    return Status(util::error::INVALID_ARGUMENT, "invalid keyset_name");
+  }
+  std::unique_ptr<KeysetReader> reader(
+      new KeyAgentKeysetReader(socket_path, keyset_name, server_uid));
+  return std::move(reader);
+}
+
+StatusOr<std::unique_ptr<Keyset>> KeyAgentKeysetReader::Read() {
+  auto socket_fd_result = Connect(socket_path_, server_uid_);
+  if (!socket_fd_result.ok()) return socket_fd_result.status();
+  ScopedFd socket_fd(socket_fd_result.ValueOrDie());
+  Status status = SendRequest(socket_fd.get(), keyset_name_);
+  if (!status.ok()) return status;
+  int received_memfd = -1;
+  status = ReceiveResponse(socket_fd.get(), &received_memfd);
+  if (!status.ok()) return status;
+  ScopedFd memfd(received_memfd);
+
+  status = CheckSealed(memfd.get());
+  if (!status.ok()) return status;
+  struct stat memfd_stat;
+  if (fstat(memfd.get(), &memfd_stat) < 0) {
+    return ToStatusF(util::error::INTERNAL, "fstat failed: %d", errno);
+  }
+  auto keyset = absl::make_unique<Keyset>();
+  if (memfd_stat.st_size == 0) return std::move(keyset);
+  // Parse the shared pages in place, rather than copying the keyset.
+  void* contents = mmap(nullptr, memfd_stat.st_size, PROT_READ, MAP_SHARED,
+                        memfd.get(), 0);
+  if (contents == MAP_FAILED) {
+    return ToStatusF(util::error::INTERNAL, "mmap failed: %d", errno);
+  }
+  bool parsed = keyset->ParseFromArray(contents, memfd_stat.st_size);
+  munmap(contents, memfd_stat.st_size);
+  if (!parsed) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "could not parse the keyset from the key agent");
+  }
+  return std::move(keyset);
+}
+
+StatusOr<std::unique_ptr<EncryptedKeyset>>
+KeyAgentKeysetReader::ReadEncrypted() {
+  return Status(util::error::UNIMPLEMENTED,
+                "the key agent only serves cleartext keysets");
+}
+
+}  // namespace keyagent
+}  // namespace integration
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,79 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TINK_INTEGRATION_KEYAGENT_KEY_AGENT_KEYSET_READER_H_
+#define TINK_INTEGRATION_KEYAGENT_KEY_AGENT_KEYSET_READER_H_
+
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <memory>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "tink/keyset_reader.h"
+#include "tink/util/statusor.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace integration {
+namespace keyagent {
+
+// KeyAgentKeysetReader reads a cleartext keyset from a KeyAgentServer on the
+// same host. It is used in place of reading the encrypted keyset and
+// unwrapping it with a KMS, e.g.
+//
+//   auto reader = KeyAgentKeysetReader::New(
+//       "/run/tink/key_agent.sock", "payments").ValueOrDie();
+//   auto handle = CleartextKeysetHandle::Read(std::move(reader));
+//
+// The reader only accepts a server running as 'server_uid', and only a
+// memfd which is sealed against any change.
+class KeyAgentKeysetReader : public KeysetReader {
+ public:
+  static crypto::tink::util::StatusOr<std::unique_ptr<KeysetReader>> New(
+      absl::string_view socket_path, absl::string_view keyset_name,
+      uid_t server_uid = getuid());
+
+  crypto::tink::util::StatusOr<std::unique_ptr<google::crypto::tink::Keyset>>
+  Read() override;
+
+  // The key agent only serves cleartext keysets, so this returns
+  // UNIMPLEMENTED.
+  crypto::tink::util::StatusOr<
+      std::unique_ptr<google::crypto::tink::EncryptedKeyset>>
+  ReadEncrypted() override;
+
+ private:
+  KeyAgentKeysetReader(absl::string_view socket_path,
+                       absl::string_view keyset_name, uid_t server_uid)
+      : socket_path_(socket_path),
+        keyset_name_(keyset_name),
+        server_uid_(server_uid) {}
+
+  const std::string socket_path_;
+  const std::string keyset_name_;
+  const uid_t server_uid_;
+};
+
+}  // namespace keyagent
+}  // namespace integration
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_INTEGRATION_KEYAGENT_KEY_AGENT_KEYSET_READER_H_
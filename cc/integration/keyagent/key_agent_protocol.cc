@@ -0,0 +1,253 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/integration/keyagent/key_agent_protocol.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "tink/util/errors.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace integration {
+namespace keyagent {
+
+using ::crypto::tink::util::Status;
+using ::crypto::tink::util::StatusOr;
+
+namespace {
+
+// The seals which make the contents of a memfd immutable.
+constexpr int kRequiredSeals =
+    F_SEAL_SEAL | F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE;
+
+// Longer error messages are truncated.
+constexpr size_t kMaxErrorMessageSize = 1 << 16;
+
+// The fixed-size part of a response.
+struct ResponseHeader {
+  int32_t code;
+  uint32_t message_size;
+};
+
+Status WriteFully(int fd, const char* data, size_t size) {
+  while (size > 0) {
+    ssize_t written = send(fd, data, size, MSG_NOSIGNAL);
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      return ToStatusF(util::error::UNAVAILABLE, "send failed: %d", errno);
+    }
+    data += written;
+    size -= written;
+  }
+  return util::OkStatus();
+}
+
+Status ReadFully(int fd, char* data, size_t size) {
+  while (size > 0) {
+    ssize_t read = recv(fd, data, size, 0);
+    if (read < 0) {
+      if (errno == EINTR) continue;
+      return ToStatusF(util::error::UNAVAILABLE, "recv failed: %d", errno);
+    }
+    if (read == 0) {
+      return Status(util::error::UNAVAILABLE, "connection closed");
+    }
+    data += read;
+    size -= read;
+  }
+  return util::OkStatus();
+}
+
+}  // namespace
+
+Status SendRequest(int socket_fd, absl::string_view keyset_name) {
+  if (keyset_name.size() > kMaxKeysetNameSize) {
+    return Status(util::error::INVALID_ARGUMENT, "keyset name is too long");
+  }
+  uint32_t size = keyset_name.size();
+  Status status =
+      WriteFully(socket_fd, reinterpret_cast<const char*>(&size), sizeof(size));
+  if (!status.ok()) return status;
+  return WriteFully(socket_fd, keyset_name.data(), keyset_name.size());
+}
+
+StatusOr<std::string> ReceiveRequest(int socket_fd) {
+  uint32_t size;
+  Status status =
+      ReadFully(socket_fd, reinterpret_cast<char*>(&size), sizeof(size));
+  if (!status.ok()) return status;
+  if (size > kMaxKeysetNameSize) {
+    return Status(util::error::INVALID_ARGUMENT, "keyset name is too long");
+  }
+  std::string keyset_name(size, '\0');
+  status = ReadFully(socket_fd, &keyset_name[0], size);
+  if (!status.ok()) return status;
+  return keyset_name;
+}
+
+Status SendResponse(int socket_fd, const Status& status, int memfd) {
+  absl::string_view error_message = status.error_message();
+  if (error_message.size() > kMaxErrorMessageSize) {
+    error_message = error_message.substr(0, kMaxErrorMessageSize);
+  }
+  ResponseHeader header;
+  header.code = status.error_code();
+  header.message_size = error_message.size();
+  struct iovec iov;
+  iov.iov_base = &header;
+  iov.iov_len = sizeof(header);
+  struct msghdr message;
+  std::memset(&message, 0, sizeof(message));
+  message.msg_iov = &iov;
+  message.msg_iovlen = 1;
+  alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+  if (status.ok()) {
+    std::memset(control, 0, sizeof(control));
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&message);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    std::memcpy(CMSG_DATA(cmsg), &memfd, sizeof(int));
+  }
+  ssize_t sent;
+  do {
+    sent = sendmsg(socket_fd, &message, MSG_NOSIGNAL);
+  } while (sent < 0 && errno == EINTR);
+  if (sent < 0) {
+    return ToStatusF(util::error::UNAVAILABLE, "sendmsg failed: %d", errno);
+  }
+  // The ancillary data went with the first byte, the rest is plain data.
+  Status write_status =
+      WriteFully(socket_fd, reinterpret_cast<const char*>(&header) + sent,
+                 sizeof(header) - sent);
+  if (!write_status.ok()) return write_status;
+  return WriteFully(socket_fd, error_message.data(), error_message.size());
+}
+
+Status ReceiveResponse(int socket_fd, int* memfd) {
+  *memfd = -1;
+  ResponseHeader header;
+  struct iovec iov;
+  iov.iov_base = &header;
+  iov.iov_len = sizeof(header);
+  struct msghdr message;
+  std::memset(&message, 0, sizeof(message));
+  message.msg_iov = &iov;
+  message.msg_iovlen = 1;
+  alignas(struct cmsghdr) char control[CMSG_SPACE(sizeof(int))];
+  message.msg_control = control;
+  message.msg_controllen = sizeof(control);
+  ssize_t received;
+  do {
+    received = recvmsg(socket_fd, &message, MSG_CMSG_CLOEXEC);
+  } while (received < 0 && errno == EINTR);
+  if (received < 0) {
+    return ToStatusF(util::error::UNAVAILABLE, "recvmsg failed: %d", errno);
+  }
+  if (received == 0) {
+    return Status(util::error::UNAVAILABLE, "connection closed");
+  }
+  int received_fd = -1;
+  for (struct cmsghdr* cmsg = CMSG_FIRSTHDR(&message); cmsg != nullptr;
+       cmsg = CMSG_NXTHDR(&message, cmsg)) {
+    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS &&
+        cmsg->cmsg_len == CMSG_LEN(sizeof(int))) {
+      std::memcpy(&received_fd, CMSG_DATA(cmsg), sizeof(int));
+    }
+  }
+  Status status =
+      ReadFully(socket_fd, reinterpret_cast<char*>(&header) + received,
+                sizeof(header) - received);
+  if (status.ok() && header.message_size > kMaxErrorMessageSize) {
+    status = Status(util::error::INTERNAL, "response message is too long");
+  }
+  std::string error_message(status.ok() ? header.message_size : 0, '\0');
+  if (status.ok()) {
+    status = ReadFully(socket_fd, &error_message[0], error_message.size());
+  }
+  if (status.ok() && header.code == util::error::OK) {
+    if (received_fd < 0) {
+      return Status(util::error::INTERNAL, "response carries no memfd");
+    }
+    *memfd = received_fd;
+    return util::OkStatus();
+  }
+  if (received_fd >= 0) close(received_fd);
+  if (!status.ok()) return status;
+  return Status(static_cast<util::error::Code>(header.code),
+                absl::StrCat("key agent: ", error_message));
+}
+
+StatusOr<int> CreateSealedMemfd(absl::string_view name,
+                                absl::string_view contents) {
+  int memfd = memfd_create(std::string(name).c_str(),
+                           MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (memfd < 0) {
+    return ToStatusF(util::error::INTERNAL, "memfd_create failed: %d", errno);
+  }
+  const char* data = contents.data();
+  size_t size = contents.size();
+  while (size > 0) {
+    ssize_t written = write(memfd, data, size);
+    if (written < 0 && errno == EINTR) continue;
+    if (written < 0) {
+      int write_errno = errno;
+      close(memfd);
+      return ToStatusF(util::error::INTERNAL, "write failed: %d", write_errno);
+    }
+    data += written;
+    size -= written;
+  }
+  if (fcntl(memfd, F_ADD_SEALS, kRequiredSeals) < 0) {
+    int seal_errno = errno;
+    close(memfd);
+    return ToStatusF(util::error::INTERNAL, "sealing failed: %d", seal_errno);
+  }
+  return memfd;
+}
+
+Status CheckSealed(int memfd) {
+  int seals = fcntl(memfd, F_GET_SEALS);
+  if (seals < 0) {
+    return ToStatusF(util::error::INTERNAL, "F_GET_SEALS failed: %d", errno);
+  }
+  if ((seals & kRequiredSeals) != kRequiredSeals) {
+    return Status(util::error::INTERNAL, "memfd is not sealed");
+  }
+  return util::OkStatus();
+}
+
+}  // namespace keyagent
+}  // namespace integration
+}  // namespace tink
+}  // namespace crypto
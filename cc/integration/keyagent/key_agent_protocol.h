@@ -0,0 +1,68 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TINK_INTEGRATION_KEYAGENT_KEY_AGENT_PROTOCOL_H_
+#define TINK_INTEGRATION_KEYAGENT_KEY_AGENT_PROTOCOL_H_
+
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace integration {
+namespace keyagent {
+
+// The wire protocol between KeyAgentServer and KeyAgentKeysetReader over a
+// Unix domain stream socket. A client sends one request, the name of a
+// keyset, and the server answers with a status. If the status is OK, the
+// answer carries a sealed memfd holding the serialized Keyset, passed with
+// SCM_RIGHTS. Integers are sent in host byte order, as both ends run on the
+// same host.
+
+// The maximal length of a keyset name.
+constexpr int kMaxKeysetNameSize = 4096;
+
+crypto::tink::util::Status SendRequest(int socket_fd,
+                                       absl::string_view keyset_name);
+
+crypto::tink::util::StatusOr<std::string> ReceiveRequest(int socket_fd);
+
+// Sends 'status', and 'memfd' if 'status' is OK.
+crypto::tink::util::Status SendResponse(
+    int socket_fd, const crypto::tink::util::Status& status, int memfd);
+
+// Returns the transmission error, or the status sent by the server, in
+// which case '*memfd' is set to the received memfd if the status is OK.
+crypto::tink::util::Status ReceiveResponse(int socket_fd, int* memfd);
+
+// Creates a memfd holding 'contents', sealed against any further change.
+crypto::tink::util::StatusOr<int> CreateSealedMemfd(absl::string_view name,
+                                                    absl::string_view contents);
+
+// Checks that 'memfd' is sealed against writes, resizing and changes of its
+// seals, so that its contents can be trusted not to change.
+crypto::tink::util::Status CheckSealed(int memfd);
+
+}  // namespace keyagent
+}  // namespace integration
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_INTEGRATION_KEYAGENT_KEY_AGENT_PROTOCOL_H_
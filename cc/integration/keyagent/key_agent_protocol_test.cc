@@ -0,0 +1,101 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/integration/keyagent/key_agent_protocol.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace integration {
+namespace keyagent {
+namespace {
+
+using ::crypto::tink::util::Status;
+using ::testing::Eq;
+using ::testing::Gt;
+using ::testing::HasSubstr;
+
+class KeyAgentProtocolTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_THAT(socketpair(AF_UNIX, SOCK_STREAM, 0, fds_), Eq(0));
+  }
+  void TearDown() override {
+    close(fds_[0]);
+    close(fds_[1]);
+  }
+  int fds_[2];
+};
+
+TEST_F(KeyAgentProtocolTest, Request) {
+  ASSERT_TRUE(SendRequest(fds_[0], "some keyset").ok());
+  auto name_result = ReceiveRequest(fds_[1]);
+  ASSERT_TRUE(name_result.ok()) << name_result.status();
+  EXPECT_THAT(name_result.ValueOrDie(), Eq("some keyset"));
+}
+
+TEST_F(KeyAgentProtocolTest, RequestWithTooLongName) {
+  EXPECT_FALSE(
+      SendRequest(fds_[0], std::string(kMaxKeysetNameSize + 1, 'a')).ok());
+}
+
+TEST_F(KeyAgentProtocolTest, ErrorResponse) {
+  ASSERT_TRUE(SendResponse(fds_[0],
+                           Status(util::error::NOT_FOUND, "no such keyset"),
+                           -1)
+                  .ok());
+  int memfd = -1;
+  Status status = ReceiveResponse(fds_[1], &memfd);
+  EXPECT_THAT(status.error_code(), Eq(util::error::NOT_FOUND));
+  EXPECT_THAT(status.error_message(), HasSubstr("no such keyset"));
+  EXPECT_THAT(memfd, Eq(-1));
+}
+
+TEST_F(KeyAgentProtocolTest, ResponseWithSealedMemfd) {
+  auto memfd_result = CreateSealedMemfd("test", "contents");
+  ASSERT_TRUE(memfd_result.ok()) << memfd_result.status();
+  int sent_memfd = memfd_result.ValueOrDie();
+  ASSERT_TRUE(SendResponse(fds_[0], util::OkStatus(), sent_memfd).ok());
+  close(sent_memfd);
+
+  int memfd = -1;
+  ASSERT_TRUE(ReceiveResponse(fds_[1], &memfd).ok());
+  ASSERT_THAT(memfd, Gt(-1));
+  EXPECT_TRUE(CheckSealed(memfd).ok());
+  char contents[16];
+  EXPECT_THAT(pread(memfd, contents, sizeof(contents), 0), Eq(8));
+  EXPECT_THAT(std::string(contents, 8), Eq("contents"));
+  // The receiver cannot change the keyset seen by other processes.
+  EXPECT_THAT(pwrite(memfd, "x", 1, 0), Eq(-1));
+  EXPECT_THAT(ftruncate(memfd, 0), Eq(-1));
+  close(memfd);
+}
+
+}  // namespace
+}  // namespace keyagent
+}  // namespace integration
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,219 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/integration/keyagent/key_agent_server.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "tink/integration/keyagent/key_agent_protocol.h"
+#include "tink/util/errors.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace integration {
+namespace keyagent {
+
+using ::crypto::tink::util::Status;
+using ::crypto::tink::util::StatusOr;
+
+namespace {
+
+// How long a connection may take to send its request or receive its
+// response, so that a stuck client cannot block the server.
+constexpr int kConnectionTimeoutSeconds = 5;
+
+Status SetTimeouts(int fd) {
+  struct timeval timeout;
+  timeout.tv_sec = kConnectionTimeoutSeconds;
+  timeout.tv_usec = 0;
+  if (setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) < 0 ||
+      setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout)) < 0) {
+    return ToStatusF(util::error::INTERNAL, "setsockopt failed: %d", errno);
+  }
+  return util::OkStatus();
+}
+
+}  // namespace
+
+// static
+StatusOr<std::unique_ptr<KeyAgentServer>> KeyAgentServer::New(
+    const KeyAgentServerOptions& options, KeysetLoader loader) {
+  if (!loader) {
+    return Status(util::error::INVALID_ARGUMENT, "loader must be set");
+  }
+  struct sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  if (options.socket_path.empty() ||
+      options.socket_path.size() >= sizeof(address.sun_path)) {
+    return Status(util::error::INVALID_ARGUMENT, "invalid socket_path");
+  }
+  std::memcpy(address.sun_path, options.socket_path.data(),
+              options.socket_path.size());
+
+  // Replace a socket left behind by an earlier server, but nothing else.
+  struct stat socket_stat;
+  if (lstat(options.socket_path.c_str(), &socket_stat) == 0) {
+    if (!S_ISSOCK(socket_stat.st_mode)) {
+      return Status(util::error::ALREADY_EXISTS,
+                    "socket_path exists and is not a socket");
+    }
+    unlink(options.socket_path.c_str());
+  }
+  int listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (listen_fd < 0) {
+    return ToStatusF(util::error::INTERNAL, "socket failed: %d", errno);
+  }
+  if (bind(listen_fd, reinterpret_cast<struct sockaddr*>(&address),
+           sizeof(address)) < 0 ||
+      listen(listen_fd, SOMAXCONN) < 0) {
+    int bind_errno = errno;
+    close(listen_fd);
+    return ToStatusF(util::error::INTERNAL, "bind or listen failed: %d",
+                     bind_errno);
+  }
+  int stop_fds[2];
+  if (pipe2(stop_fds, O_CLOEXEC) < 0) {
+    int pipe_errno = errno;
+    close(listen_fd);
+    unlink(options.socket_path.c_str());
+    return ToStatusF(util::error::INTERNAL, "pipe2 failed: %d", pipe_errno);
+  }
+  return {absl::WrapUnique(new KeyAgentServer(
+      options, std::move(loader), listen_fd, stop_fds[0], stop_fds[1]))};
+}
+
+KeyAgentServer::KeyAgentServer(const KeyAgentServerOptions& options,
+                               KeysetLoader loader, int listen_fd,
+                               int stop_read_fd, int stop_write_fd)
+    : socket_path_(options.socket_path),
+      allowed_uids_(options.allowed_uids.empty()
+                        ? std::vector<uid_t>({getuid()})
+                        : options.allowed_uids),
+      loader_(std::move(loader)),
+      listen_fd_(listen_fd),
+      stop_read_fd_(stop_read_fd),
+      stop_write_fd_(stop_write_fd) {}
+
+KeyAgentServer::~KeyAgentServer() {
+  close(listen_fd_);
+  unlink(socket_path_.c_str());
+  close(stop_read_fd_);
+  close(stop_write_fd_);
+  absl::MutexLock lock(&mutex_);
+  // Clients keep their own references to the memfds.
+  for (const auto& entry : keyset_memfds_) close(entry.second);
+}
+
+void KeyAgentServer::Serve() {
+  while (true) {
+    struct pollfd fds[2];
+    fds[0].fd = listen_fd_;
+    fds[0].events = POLLIN;
+    fds[1].fd = stop_read_fd_;
+    fds[1].events = POLLIN;
+    if (poll(fds, 2, /*timeout=*/-1) < 0) {
+      if (errno == EINTR) continue;
+      return;
+    }
+    if (fds[1].revents != 0) return;
+    if ((fds[0].revents & POLLIN) == 0) continue;
+    int connection_fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+    if (connection_fd < 0) continue;
+    HandleConnection(connection_fd);
+    close(connection_fd);
+  }
+}
+
+void KeyAgentServer::Stop() {
+  char byte = 0;
+  while (write(stop_write_fd_, &byte, 1) < 0 && errno == EINTR) {
+  }
+}
+
+void KeyAgentServer::HandleConnection(int connection_fd) {
+  if (!SetTimeouts(connection_fd).ok()) return;
+  struct ucred peer;
+  socklen_t peer_size = sizeof(peer);
+  if (getsockopt(connection_fd, SOL_SOCKET, SO_PEERCRED, &peer, &peer_size) <
+      0) {
+    return;
+  }
+  StatusOr<std::string> keyset_name_result = ReceiveRequest(connection_fd);
+  if (!keyset_name_result.ok()) return;
+  if (std::find(allowed_uids_.begin(), allowed_uids_.end(), peer.uid) ==
+      allowed_uids_.end()) {
+    SendResponse(connection_fd,
+                 Status(util::error::PERMISSION_DENIED,
+                        absl::StrCat("uid ", peer.uid, " is not allowed")),
+                 -1)
+        .IgnoreError();
+    return;
+  }
+  StatusOr<int> memfd_result = GetKeysetMemfd(keyset_name_result.ValueOrDie());
+  SendResponse(connection_fd, memfd_result.status(),
+               memfd_result.ok() ? memfd_result.ValueOrDie() : -1)
+      .IgnoreError();
+}
+
+StatusOr<int> KeyAgentServer::GetKeysetMemfd(absl::string_view keyset_name) {
+  absl::MutexLock lock(&mutex_);
+  auto it = keyset_memfds_.find(keyset_name);
+  if (it != keyset_memfds_.end()) return it->second;
+  auto keyset_result = loader_(keyset_name);
+  if (!keyset_result.ok()) return keyset_result.status();
+  util::SecretData serialized_keyset(
+      keyset_result.ValueOrDie()->ByteSizeLong());
+  if (!keyset_result.ValueOrDie()->SerializeToArray(serialized_keyset.data(),
+                                                    serialized_keyset.size())) {
+    return Status(util::error::INTERNAL, "could not serialize the keyset");
+  }
+  auto memfd_result =
+      CreateSealedMemfd(absl::StrCat("tink_keyset_", keyset_name),
+                        util::SecretDataAsStringView(serialized_keyset));
+  if (!memfd_result.ok()) return memfd_result.status();
+  keyset_memfds_.emplace(std::string(keyset_name), memfd_result.ValueOrDie());
+  return memfd_result.ValueOrDie();
+}
+
+}  // namespace keyagent
+}  // namespace integration
+}  // namespace tink
+}  // namespace crypto
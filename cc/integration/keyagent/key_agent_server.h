@@ -0,0 +1,113 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TINK_INTEGRATION_KEYAGENT_KEY_AGENT_SERVER_H_
+#define TINK_INTEGRATION_KEYAGENT_KEY_AGENT_SERVER_H_
+
+#include <sys/types.h>
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace integration {
+namespace keyagent {
+
+struct KeyAgentServerOptions {
+  // The path of the Unix domain socket to listen on. A stale socket at the
+  // path is replaced. The directory of the socket should only be writable by
+  // the user of the server, so that no other process can take its place.
+  std::string socket_path;
+  // The user IDs of the processes which may read keysets. If empty, only
+  // processes of the user of the server may.
+  std::vector<uid_t> allowed_uids;
+};
+
+// KeyAgentServer is the daemon side of a per-host key agent. Worker
+// processes on the host read their keysets from it with
+// KeyAgentKeysetReader, instead of each of them reading the encrypted
+// keysets and unwrapping them with a KMS.
+//
+// The server loads each keyset once, on its first request, with the
+// KeysetLoader, typically by decrypting an encrypted keyset with a KMS
+// Aead. It then keeps the serialized keyset in a memfd sealed against any
+// change, and passes that memfd to every authorized client over the Unix
+// domain socket, so that clients share the same read-only memory. Clients
+// are authorized by the user ID of their process, as reported by the
+// kernel.
+//
+// A failed load is not cached, so a later request tries again.
+class KeyAgentServer {
+ public:
+  // Returns the cleartext keyset with the given name, or NOT_FOUND if there
+  // is none.
+  using KeysetLoader = std::function<crypto::tink::util::StatusOr<
+      std::unique_ptr<google::crypto::tink::Keyset>>(absl::string_view)>;
+
+  // Binds the socket; connections are accepted by Serve().
+  static crypto::tink::util::StatusOr<std::unique_ptr<KeyAgentServer>> New(
+      const KeyAgentServerOptions& options, KeysetLoader loader);
+
+  // Closes the socket and removes it.
+  ~KeyAgentServer();
+
+  // Serves requests, one connection at a time, until Stop() is called.
+  void Serve();
+
+  // Makes Serve() return. May be called from any thread.
+  void Stop();
+
+ private:
+  KeyAgentServer(const KeyAgentServerOptions& options, KeysetLoader loader,
+                 int listen_fd, int stop_read_fd, int stop_write_fd);
+
+  void HandleConnection(int connection_fd);
+
+  // Returns the sealed memfd of the named keyset, loading it if needed. The
+  // memfd remains owned by the server.
+  crypto::tink::util::StatusOr<int> GetKeysetMemfd(
+      absl::string_view keyset_name) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  const std::string socket_path_;
+  const std::vector<uid_t> allowed_uids_;
+  const KeysetLoader loader_;
+  const int listen_fd_;
+  // A pipe which Stop() writes to, to wake up Serve().
+  const int stop_read_fd_;
+  const int stop_write_fd_;
+
+  absl::Mutex mutex_;
+  absl::flat_hash_map<std::string, int> keyset_memfds_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace keyagent
+}  // namespace integration
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_INTEGRATION_KEYAGENT_KEY_AGENT_SERVER_H_
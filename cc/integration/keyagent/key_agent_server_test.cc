@@ -0,0 +1,199 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/integration/keyagent/key_agent_server.h"
+
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "tink/integration/keyagent/key_agent_keyset_reader.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace integration {
+namespace keyagent {
+namespace {
+
+using ::crypto::tink::util::Status;
+using ::crypto::tink::util::StatusOr;
+using ::google::crypto::tink::KeyData;
+using ::google::crypto::tink::Keyset;
+using ::testing::Eq;
+
+std::unique_ptr<Keyset> NewKeyset(absl::string_view name) {
+  auto keyset = absl::make_unique<Keyset>();
+  keyset->set_primary_key_id(42);
+  Keyset::Key* key = keyset->add_key();
+  key->set_key_id(42);
+  key->set_status(google::crypto::tink::ENABLED);
+  key->set_output_prefix_type(google::crypto::tink::TINK);
+  key->mutable_key_data()->set_type_url("some type url");
+  key->mutable_key_data()->set_value(absl::StrCat("key of ", name));
+  key->mutable_key_data()->set_key_material_type(KeyData::SYMMETRIC);
+  return keyset;
+}
+
+std::string SocketPath() {
+  const char* dir = getenv("TEST_TMPDIR");
+  return absl::StrCat(dir != nullptr ? dir : "/tmp", "/key_agent_", getpid(),
+                      ".sock");
+}
+
+class KeyAgentServerTest : public ::testing::Test {
+ protected:
+  void StartServer(const KeyAgentServerOptions& options) {
+    auto server_result = KeyAgentServer::New(
+        options,
+        [this](absl::string_view name) -> StatusOr<std::unique_ptr<Keyset>> {
+          loads_++;
+          if (name == "missing") {
+            return Status(util::error::NOT_FOUND, "no such keyset");
+          }
+          return NewKeyset(name);
+        });
+    ASSERT_TRUE(server_result.ok()) << server_result.status();
+    server_ = std::move(server_result.ValueOrDie());
+    thread_ = std::thread([this]() { server_->Serve(); });
+  }
+
+  void StartServer() {
+    KeyAgentServerOptions options;
+    options.socket_path = SocketPath();
+    StartServer(options);
+  }
+
+  void TearDown() override {
+    if (server_ == nullptr) return;
+    server_->Stop();
+    thread_.join();
+    server_.reset();
+  }
+
+  StatusOr<std::unique_ptr<Keyset>> Read(absl::string_view name,
+                                         uid_t server_uid = getuid()) {
+    auto reader_result =
+        KeyAgentKeysetReader::New(SocketPath(), name, server_uid);
+    if (!reader_result.ok()) return reader_result.status();
+    return reader_result.ValueOrDie()->Read();
+  }
+
+  int loads_ = 0;
+  std::unique_ptr<KeyAgentServer> server_;
+  std::thread thread_;
+};
+
+TEST_F(KeyAgentServerTest, ReadsKeyset) {
+  StartServer();
+  auto keyset_result = Read("payments");
+  ASSERT_TRUE(keyset_result.ok()) << keyset_result.status();
+  EXPECT_THAT(keyset_result.ValueOrDie()->SerializeAsString(),
+              Eq(NewKeyset("payments")->SerializeAsString()));
+}
+
+TEST_F(KeyAgentServerTest, LoadsEachKeysetOnce) {
+  StartServer();
+  for (int i = 0; i < 3; i++) {
+    EXPECT_TRUE(Read("payments").ok());
+    EXPECT_TRUE(Read("billing").ok());
+  }
+  EXPECT_THAT(loads_, Eq(2));
+  auto keyset_result = Read("billing");
+  ASSERT_TRUE(keyset_result.ok()) << keyset_result.status();
+  EXPECT_THAT(keyset_result.ValueOrDie()->SerializeAsString(),
+              Eq(NewKeyset("billing")->SerializeAsString()));
+}
+
+TEST_F(KeyAgentServerTest, DoesNotCacheFailures) {
+  StartServer();
+  EXPECT_THAT(Read("missing").status().error_code(),
+              Eq(util::error::NOT_FOUND));
+  EXPECT_THAT(Read("missing").status().error_code(),
+              Eq(util::error::NOT_FOUND));
+  EXPECT_THAT(loads_, Eq(2));
+}
+
+TEST_F(KeyAgentServerTest, RejectsUnauthorizedUser) {
+  KeyAgentServerOptions options;
+  options.socket_path = SocketPath();
+  options.allowed_uids = {getuid() + 1};
+  StartServer(options);
+  EXPECT_THAT(Read("payments").status().error_code(),
+              Eq(util::error::PERMISSION_DENIED));
+  EXPECT_THAT(loads_, Eq(0));
+}
+
+TEST_F(KeyAgentServerTest, RejectsUnexpectedServerUser) {
+  StartServer();
+  EXPECT_THAT(Read("payments", getuid() + 1).status().error_code(),
+              Eq(util::error::PERMISSION_DENIED));
+}
+
+TEST_F(KeyAgentServerTest, ReplacesStaleSocket) {
+  // A server which exited without removing its socket.
+  std::string socket_path = SocketPath();
+  struct sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  std::memcpy(address.sun_path, socket_path.data(), socket_path.size());
+  int stale_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  ASSERT_THAT(bind(stale_fd, reinterpret_cast<struct sockaddr*>(&address),
+                   sizeof(address)),
+              Eq(0));
+  close(stale_fd);
+
+  StartServer();
+  EXPECT_TRUE(Read("payments").ok());
+}
+
+TEST_F(KeyAgentServerTest, ConnectionFailsWithoutServer) {
+  EXPECT_THAT(Read("payments").status().error_code(),
+              Eq(util::error::UNAVAILABLE));
+}
+
+TEST(KeyAgentKeysetReaderTest, ReadEncryptedIsUnimplemented) {
+  auto reader_result = KeyAgentKeysetReader::New(SocketPath(), "payments");
+  ASSERT_TRUE(reader_result.ok()) << reader_result.status();
+  EXPECT_THAT(
+      reader_result.ValueOrDie()->ReadEncrypted().status().error_code(),
+      Eq(util::error::UNIMPLEMENTED));
+}
+
+TEST(KeyAgentKeysetReaderTest, RejectsInvalidArguments) {
+  EXPECT_FALSE(KeyAgentKeysetReader::New("", "payments").ok());
+  EXPECT_FALSE(KeyAgentKeysetReader::New(SocketPath(), "").ok());
+}
+
+}  // namespace
+}  // namespace keyagent
+}  // namespace integration
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,215 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/integration/pkcs11/fake_pkcs11_module.h"
+
+#include <functional>
+#include <string>
+#include <utility>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace integration {
+namespace pkcs11 {
+
+using crypto::tink::util::Status;
+using crypto::tink::util::StatusOr;
+
+namespace {
+
+constexpr int kTagSize = 16;
+
+}  // namespace
+
+void FakePkcs11Module::AddKey(uint64_t slot_id, absl::string_view label) {
+  absl::MutexLock lock(&mutex_);
+  keys_[next_handle_++] = Key{slot_id, std::string(label)};
+}
+
+void FakePkcs11Module::ResetToken() {
+  absl::MutexLock lock(&mutex_);
+  sessions_.clear();
+  busy_sessions_.clear();
+  logged_in_ = false;
+  absl::flat_hash_map<Pkcs11ObjectHandle, Key> keys;
+  for (const auto& entry : keys_) keys[next_handle_++] = entry.second;
+  keys_ = std::move(keys);
+}
+
+int FakePkcs11Module::sessions_opened() {
+  absl::MutexLock lock(&mutex_);
+  return sessions_opened_;
+}
+
+int FakePkcs11Module::sessions_open() {
+  absl::MutexLock lock(&mutex_);
+  return sessions_.size();
+}
+
+int FakePkcs11Module::logins() {
+  absl::MutexLock lock(&mutex_);
+  return logins_;
+}
+
+int FakePkcs11Module::find_calls() {
+  absl::MutexLock lock(&mutex_);
+  return find_calls_;
+}
+
+int FakePkcs11Module::concurrent_session_uses() {
+  absl::MutexLock lock(&mutex_);
+  return concurrent_session_uses_;
+}
+
+StatusOr<Pkcs11SessionHandle> FakePkcs11Module::OpenSession(
+    uint64_t slot_id) {
+  absl::MutexLock lock(&mutex_);
+  if (slot_id >= num_slots_) {
+    return Status(util::error::INVALID_ARGUMENT, "CKR_SLOT_ID_INVALID");
+  }
+  Pkcs11SessionHandle session = next_handle_++;
+  sessions_[session] = slot_id;
+  sessions_opened_++;
+  return session;
+}
+
+Status FakePkcs11Module::CloseSession(Pkcs11SessionHandle session) {
+  absl::MutexLock lock(&mutex_);
+  if (sessions_.erase(session) == 0) {
+    return Status(util::error::UNAVAILABLE, "CKR_SESSION_HANDLE_INVALID");
+  }
+  if (sessions_.empty()) logged_in_ = false;
+  return util::OkStatus();
+}
+
+Status FakePkcs11Module::Login(Pkcs11SessionHandle session,
+                               absl::string_view pin) {
+  absl::MutexLock lock(&mutex_);
+  if (!sessions_.contains(session)) {
+    return Status(util::error::UNAVAILABLE, "CKR_SESSION_HANDLE_INVALID");
+  }
+  if (pin != pin_) {
+    return Status(util::error::PERMISSION_DENIED, "CKR_PIN_INCORRECT");
+  }
+  logins_++;
+  logged_in_ = true;
+  return util::OkStatus();
+}
+
+StatusOr<Pkcs11ObjectHandle> FakePkcs11Module::FindSecretKey(
+    Pkcs11SessionHandle session, absl::string_view label) {
+  absl::MutexLock lock(&mutex_);
+  find_calls_++;
+  auto session_it = sessions_.find(session);
+  if (session_it == sessions_.end()) {
+    return Status(util::error::UNAVAILABLE, "CKR_SESSION_HANDLE_INVALID");
+  }
+  if (logged_in_) {
+    for (const auto& entry : keys_) {
+      if (entry.second.slot_id == session_it->second &&
+          entry.second.label == label) {
+        return entry.first;
+      }
+    }
+  }
+  return Status(util::error::NOT_FOUND, "No such key");
+}
+
+StatusOr<FakePkcs11Module::Key> FakePkcs11Module::BeginOperation(
+    Pkcs11SessionHandle session, Pkcs11ObjectHandle handle) {
+  {
+    absl::MutexLock lock(&mutex_);
+    auto session_it = sessions_.find(session);
+    if (session_it == sessions_.end()) {
+      return Status(util::error::UNAVAILABLE, "CKR_SESSION_HANDLE_INVALID");
+    }
+    if (!logged_in_) {
+      return Status(util::error::PERMISSION_DENIED, "CKR_USER_NOT_LOGGED_IN");
+    }
+    auto key_it = keys_.find(handle);
+    if (key_it == keys_.end() ||
+        key_it->second.slot_id != session_it->second) {
+      return Status(util::error::INVALID_ARGUMENT,
+                    "CKR_KEY_HANDLE_INVALID");
+    }
+    if (!busy_sessions_.insert(session).second) {
+      concurrent_session_uses_++;
+      return Status(util::error::FAILED_PRECONDITION, "CKR_OPERATION_ACTIVE");
+    }
+  }
+  // Gives other threads a chance to use the session at the same time.
+  absl::SleepFor(absl::Microseconds(100));
+  absl::MutexLock lock(&mutex_);
+  return keys_[handle];
+}
+
+void FakePkcs11Module::EndOperation(Pkcs11SessionHandle session) {
+  absl::MutexLock lock(&mutex_);
+  busy_sessions_.erase(session);
+}
+
+std::string FakePkcs11Module::Checksum(const Key& key, absl::string_view iv,
+                                       absl::string_view plaintext,
+                                       absl::string_view associated_data) {
+  std::string input = absl::StrCat(key.slot_id, "/", key.label, "/",
+                                   iv.size(), ":", iv, associated_data.size(),
+                                   ":", associated_data, plaintext);
+  return absl::StrCat(
+      absl::Hex(std::hash<std::string>()(input), absl::kZeroPad16));
+}
+
+StatusOr<std::string> FakePkcs11Module::EncryptAesGcm(
+    Pkcs11SessionHandle session, Pkcs11ObjectHandle key, absl::string_view iv,
+    absl::string_view plaintext, absl::string_view associated_data) {
+  auto key_result = BeginOperation(session, key);
+  if (!key_result.ok()) return key_result.status();
+  EndOperation(session);
+  return absl::StrCat(plaintext, Checksum(key_result.ValueOrDie(), iv,
+                                          plaintext, associated_data));
+}
+
+StatusOr<std::string> FakePkcs11Module::DecryptAesGcm(
+    Pkcs11SessionHandle session, Pkcs11ObjectHandle key, absl::string_view iv,
+    absl::string_view ciphertext, absl::string_view associated_data) {
+  auto key_result = BeginOperation(session, key);
+  if (!key_result.ok()) return key_result.status();
+  EndOperation(session);
+  if (ciphertext.size() < kTagSize) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "CKR_ENCRYPTED_DATA_LEN_RANGE");
+  }
+  absl::string_view plaintext =
+      ciphertext.substr(0, ciphertext.size() - kTagSize);
+  if (ciphertext.substr(plaintext.size()) !=
+      Checksum(key_result.ValueOrDie(), iv, plaintext, associated_data)) {
+    return Status(util::error::INVALID_ARGUMENT, "CKR_ENCRYPTED_DATA_INVALID");
+  }
+  return std::string(plaintext);
+}
+
+}  // namespace pkcs11
+}  // namespace integration
+}  // namespace tink
+}  // namespace crypto
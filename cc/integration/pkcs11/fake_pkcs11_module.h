@@ -0,0 +1,120 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TINK_INTEGRATION_PKCS11_FAKE_PKCS11_MODULE_H_
+#define TINK_INTEGRATION_PKCS11_FAKE_PKCS11_MODULE_H_
+
+#include <cstdint>
+#include <string>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "tink/integration/pkcs11/pkcs11_module.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace integration {
+namespace pkcs11 {
+
+// An in-memory Pkcs11Module for tests. Its "AES-GCM" appends a 16-byte
+// checksum of the key, IV, associated data and plaintext to the plaintext,
+// and therefore provides no security.
+//
+// It counts the calls it gets, and fails operations which use a session
+// while another operation uses it.
+class FakePkcs11Module : public Pkcs11Module {
+ public:
+  // A module with the given slots, whose user PIN is 'pin'.
+  FakePkcs11Module(absl::string_view pin, int num_slots)
+      : pin_(pin), num_slots_(num_slots) {}
+
+  // Adds a secret key labelled 'label' to 'slot_id'.
+  void AddKey(uint64_t slot_id, absl::string_view label);
+
+  // Invalidates all open sessions and object handles, as if the token had
+  // been reset.
+  void ResetToken();
+
+  int sessions_opened();
+  int sessions_open();
+  int logins();
+  int find_calls();
+  // The number of operations which found their session used by another
+  // operation.
+  int concurrent_session_uses();
+
+  crypto::tink::util::StatusOr<Pkcs11SessionHandle> OpenSession(
+      uint64_t slot_id) override;
+  crypto::tink::util::Status CloseSession(
+      Pkcs11SessionHandle session) override;
+  crypto::tink::util::Status Login(Pkcs11SessionHandle session,
+                                   absl::string_view pin) override;
+  crypto::tink::util::StatusOr<Pkcs11ObjectHandle> FindSecretKey(
+      Pkcs11SessionHandle session, absl::string_view label) override;
+  crypto::tink::util::StatusOr<std::string> EncryptAesGcm(
+      Pkcs11SessionHandle session, Pkcs11ObjectHandle key,
+      absl::string_view iv, absl::string_view plaintext,
+      absl::string_view associated_data) override;
+  crypto::tink::util::StatusOr<std::string> DecryptAesGcm(
+      Pkcs11SessionHandle session, Pkcs11ObjectHandle key,
+      absl::string_view iv, absl::string_view ciphertext,
+      absl::string_view associated_data) override;
+
+ private:
+  struct Key {
+    uint64_t slot_id;
+    std::string label;
+  };
+
+  // Marks 'session' as used by an operation, and returns the key of 'handle'
+  // in its slot.
+  crypto::tink::util::StatusOr<Key> BeginOperation(
+      Pkcs11SessionHandle session, Pkcs11ObjectHandle handle);
+  void EndOperation(Pkcs11SessionHandle session);
+  std::string Checksum(const Key& key, absl::string_view iv,
+                       absl::string_view plaintext,
+                       absl::string_view associated_data);
+
+  const std::string pin_;
+  const int num_slots_;
+
+  absl::Mutex mutex_;
+  // Slot of each open session.
+  absl::flat_hash_map<Pkcs11SessionHandle, uint64_t> sessions_
+      ABSL_GUARDED_BY(mutex_);
+  absl::flat_hash_set<Pkcs11SessionHandle> busy_sessions_
+      ABSL_GUARDED_BY(mutex_);
+  absl::flat_hash_map<Pkcs11ObjectHandle, Key> keys_ ABSL_GUARDED_BY(mutex_);
+  bool logged_in_ ABSL_GUARDED_BY(mutex_) = false;
+  uint64_t next_handle_ ABSL_GUARDED_BY(mutex_) = 1;
+  int sessions_opened_ ABSL_GUARDED_BY(mutex_) = 0;
+  int logins_ ABSL_GUARDED_BY(mutex_) = 0;
+  int find_calls_ ABSL_GUARDED_BY(mutex_) = 0;
+  int concurrent_session_uses_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+}  // namespace pkcs11
+}  // namespace integration
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_INTEGRATION_PKCS11_FAKE_PKCS11_MODULE_H_
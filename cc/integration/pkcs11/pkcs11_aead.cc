@@ -0,0 +1,138 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/integration/pkcs11/pkcs11_aead.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "tink/aead.h"
+#include "tink/integration/pkcs11/pkcs11_module.h"
+#include "tink/integration/pkcs11/pkcs11_session_pool.h"
+#include "tink/internal/tracing_span.h"
+#include "tink/subtle/random.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace integration {
+namespace pkcs11 {
+
+using crypto::tink::util::Status;
+using crypto::tink::util::StatusOr;
+
+namespace {
+
+// Closes 'session' if 'status' says that the module cannot use it anymore.
+void DiscardIfUnavailable(const Status& status,
+                          Pkcs11SessionPool::Session* session) {
+  if (status.error_code() == util::error::UNAVAILABLE) session->Discard();
+}
+
+}  // namespace
+
+constexpr int Pkcs11Aead::kIvSizeInBytes;
+constexpr int Pkcs11Aead::kTagSizeInBytes;
+
+// static
+StatusOr<std::unique_ptr<Aead>> Pkcs11Aead::New(
+    absl::string_view key_label,
+    std::shared_ptr<Pkcs11SessionPool> session_pool) {
+  if (key_label.empty()) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "Key label cannot be empty.");
+  }
+  if (session_pool == nullptr) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "PKCS#11 session pool cannot be null.");
+  }
+  std::unique_ptr<Aead> aead(new Pkcs11Aead(key_label, session_pool));
+  return std::move(aead);
+}
+
+StatusOr<std::string> Pkcs11Aead::Encrypt(
+    absl::string_view plaintext, absl::string_view associated_data) const {
+  internal::TracingSpan span("tink.pkcs11.encrypt");
+  span.AddBytes(plaintext.size());
+  auto session_result = session_pool_->Acquire();
+  if (!session_result.ok()) {
+    span.SetOk(false);
+    return session_result.status();
+  }
+  Pkcs11SessionPool::Session& session = session_result.ValueOrDie();
+  auto key_result = session_pool_->FindSecretKey(session, key_label_);
+  if (!key_result.ok()) {
+    span.SetOk(false);
+    DiscardIfUnavailable(key_result.status(), &session);
+    return key_result.status();
+  }
+  std::string iv = subtle::Random::GetRandomBytes(kIvSizeInBytes);
+  auto ciphertext_result = session_pool_->module()->EncryptAesGcm(
+      session.handle(), key_result.ValueOrDie(), iv, plaintext,
+      associated_data);
+  if (!ciphertext_result.ok()) {
+    span.SetOk(false);
+    DiscardIfUnavailable(ciphertext_result.status(), &session);
+    return Status(ciphertext_result.status().CanonicalCode(),
+                  absl::StrCat("PKCS#11 encryption failed: ",
+                               ciphertext_result.status().error_message()));
+  }
+  return absl::StrCat(iv, ciphertext_result.ValueOrDie());
+}
+
+StatusOr<std::string> Pkcs11Aead::Decrypt(
+    absl::string_view ciphertext, absl::string_view associated_data) const {
+  internal::TracingSpan span("tink.pkcs11.decrypt");
+  span.AddBytes(ciphertext.size());
+  if (ciphertext.size() < kIvSizeInBytes + kTagSizeInBytes) {
+    span.SetOk(false);
+    return Status(util::error::INVALID_ARGUMENT, "Ciphertext too short.");
+  }
+  auto session_result = session_pool_->Acquire();
+  if (!session_result.ok()) {
+    span.SetOk(false);
+    return session_result.status();
+  }
+  Pkcs11SessionPool::Session& session = session_result.ValueOrDie();
+  auto key_result = session_pool_->FindSecretKey(session, key_label_);
+  if (!key_result.ok()) {
+    span.SetOk(false);
+    DiscardIfUnavailable(key_result.status(), &session);
+    return key_result.status();
+  }
+  auto plaintext_result = session_pool_->module()->DecryptAesGcm(
+      session.handle(), key_result.ValueOrDie(),
+      ciphertext.substr(0, kIvSizeInBytes), ciphertext.substr(kIvSizeInBytes),
+      associated_data);
+  if (!plaintext_result.ok()) {
+    span.SetOk(false);
+    DiscardIfUnavailable(plaintext_result.status(), &session);
+    return Status(plaintext_result.status().CanonicalCode(),
+                  absl::StrCat("PKCS#11 decryption failed: ",
+                               plaintext_result.status().error_message()));
+  }
+  return plaintext_result.ValueOrDie();
+}
+
+}  // namespace pkcs11
+}  // namespace integration
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,74 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TINK_INTEGRATION_PKCS11_PKCS11_AEAD_H_
+#define TINK_INTEGRATION_PKCS11_PKCS11_AEAD_H_
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/strings/string_view.h"
+#include "tink/aead.h"
+#include "tink/integration/pkcs11/pkcs11_session_pool.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace integration {
+namespace pkcs11 {
+
+// Pkcs11Aead is an implementation of AEAD which encrypts with an AES-GCM key
+// stored in a PKCS#11 token, e.g. a hardware security module. The ciphertext
+// is the random 12-byte IV followed by the output of CKM_AES_GCM.
+//
+// Every operation takes a session out of 'session_pool', so that Pkcs11Aead
+// can be used from several threads at once.
+class Pkcs11Aead : public Aead {
+ public:
+  static constexpr int kIvSizeInBytes = 12;
+  static constexpr int kTagSizeInBytes = 16;
+
+  // Creates a new Pkcs11Aead which uses the secret key labelled 'key_label'
+  // in the token of 'session_pool'.
+  static crypto::tink::util::StatusOr<std::unique_ptr<Aead>> New(
+      absl::string_view key_label,
+      std::shared_ptr<Pkcs11SessionPool> session_pool);
+
+  crypto::tink::util::StatusOr<std::string> Encrypt(
+      absl::string_view plaintext,
+      absl::string_view associated_data) const override;
+
+  crypto::tink::util::StatusOr<std::string> Decrypt(
+      absl::string_view ciphertext,
+      absl::string_view associated_data) const override;
+
+ private:
+  Pkcs11Aead(absl::string_view key_label,
+             std::shared_ptr<Pkcs11SessionPool> session_pool)
+      : key_label_(key_label), session_pool_(std::move(session_pool)) {}
+
+  std::string key_label_;
+  std::shared_ptr<Pkcs11SessionPool> session_pool_;
+};
+
+}  // namespace pkcs11
+}  // namespace integration
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_INTEGRATION_PKCS11_PKCS11_AEAD_H_
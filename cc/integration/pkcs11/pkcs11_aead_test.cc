@@ -0,0 +1,167 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/integration/pkcs11/pkcs11_aead.h"
+
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "tink/aead.h"
+#include "tink/integration/pkcs11/fake_pkcs11_module.h"
+#include "tink/integration/pkcs11/pkcs11_session_pool.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "tink/util/test_matchers.h"
+
+namespace crypto {
+namespace tink {
+namespace integration {
+namespace pkcs11 {
+namespace {
+
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::testing::Eq;
+using ::testing::Le;
+using ::testing::Ne;
+
+constexpr char kPin[] = "1234";
+
+class Pkcs11AeadTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    module_ = std::make_shared<FakePkcs11Module>(kPin, /*num_slots=*/1);
+    module_->AddKey(/*slot_id=*/0, "key");
+    module_->AddKey(/*slot_id=*/0, "other key");
+    Pkcs11SessionPoolOptions options;
+    options.pin = kPin;
+    options.max_sessions = 4;
+    auto pool_result = Pkcs11SessionPool::New(module_, /*slot_id=*/0, options);
+    ASSERT_THAT(pool_result.status(), IsOk());
+    pool_ = std::move(pool_result.ValueOrDie());
+  }
+
+  std::unique_ptr<Aead> NewAead(absl::string_view key_label) {
+    auto aead_result = Pkcs11Aead::New(key_label, pool_);
+    EXPECT_THAT(aead_result.status(), IsOk());
+    return std::move(aead_result.ValueOrDie());
+  }
+
+  std::shared_ptr<FakePkcs11Module> module_;
+  std::shared_ptr<Pkcs11SessionPool> pool_;
+};
+
+TEST_F(Pkcs11AeadTest, EncryptDecrypt) {
+  auto aead = NewAead("key");
+  auto ciphertext = aead->Encrypt("plaintext", "associated data");
+  ASSERT_THAT(ciphertext.status(), IsOk());
+  EXPECT_THAT(ciphertext.ValueOrDie().size(),
+              Eq(Pkcs11Aead::kIvSizeInBytes + 9 + Pkcs11Aead::kTagSizeInBytes));
+  auto plaintext = aead->Decrypt(ciphertext.ValueOrDie(), "associated data");
+  ASSERT_THAT(plaintext.status(), IsOk());
+  EXPECT_THAT(plaintext.ValueOrDie(), Eq("plaintext"));
+
+  // The IV is random.
+  auto other_ciphertext = aead->Encrypt("plaintext", "associated data");
+  ASSERT_THAT(other_ciphertext.status(), IsOk());
+  EXPECT_THAT(other_ciphertext.ValueOrDie(), Ne(ciphertext.ValueOrDie()));
+}
+
+TEST_F(Pkcs11AeadTest, DecryptFailures) {
+  auto aead = NewAead("key");
+  auto ciphertext_result = aead->Encrypt("plaintext", "associated data");
+  ASSERT_THAT(ciphertext_result.status(), IsOk());
+  const std::string& ciphertext = ciphertext_result.ValueOrDie();
+
+  EXPECT_THAT(aead->Decrypt(ciphertext, "other data").status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(NewAead("other key")->Decrypt(ciphertext, "associated data")
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  std::string modified = ciphertext;
+  modified[0] ^= 1;
+  EXPECT_THAT(aead->Decrypt(modified, "associated data").status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(aead->Decrypt(ciphertext.substr(0, 27), "associated data")
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  // A failed decryption does not lose the session.
+  EXPECT_THAT(aead->Decrypt(ciphertext, "associated data").status(), IsOk());
+  EXPECT_THAT(module_->sessions_opened(), Eq(1));
+}
+
+TEST_F(Pkcs11AeadTest, UnknownKey) {
+  auto aead = NewAead("unknown key");
+  EXPECT_THAT(aead->Encrypt("plaintext", "").status(),
+              StatusIs(util::error::NOT_FOUND));
+}
+
+TEST_F(Pkcs11AeadTest, ConcurrentOperationsUseSeparateSessions) {
+  auto aead = NewAead("key");
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; t++) {
+    threads.emplace_back([&aead, t]() {
+      for (int i = 0; i < 20; i++) {
+        std::string plaintext = absl::StrCat("message ", t, " ", i);
+        auto ciphertext = aead->Encrypt(plaintext, "ad");
+        ASSERT_THAT(ciphertext.status(), IsOk());
+        auto decrypted = aead->Decrypt(ciphertext.ValueOrDie(), "ad");
+        ASSERT_THAT(decrypted.status(), IsOk());
+        EXPECT_THAT(decrypted.ValueOrDie(), Eq(plaintext));
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  EXPECT_THAT(module_->concurrent_session_uses(), Eq(0));
+  EXPECT_THAT(module_->sessions_opened(), Le(4));
+  EXPECT_THAT(module_->logins(), Eq(1));
+  EXPECT_THAT(module_->find_calls(), Le(4));
+}
+
+TEST_F(Pkcs11AeadTest, RecoversFromTokenReset) {
+  auto aead = NewAead("key");
+  auto ciphertext = aead->Encrypt("plaintext", "ad");
+  ASSERT_THAT(ciphertext.status(), IsOk());
+
+  module_->ResetToken();
+  EXPECT_THAT(aead->Decrypt(ciphertext.ValueOrDie(), "ad").status(),
+              StatusIs(util::error::UNAVAILABLE));
+  // The pool opens a new session and looks up the new key handle.
+  auto plaintext = aead->Decrypt(ciphertext.ValueOrDie(), "ad");
+  ASSERT_THAT(plaintext.status(), IsOk());
+  EXPECT_THAT(plaintext.ValueOrDie(), Eq("plaintext"));
+  EXPECT_THAT(module_->logins(), Eq(2));
+}
+
+TEST_F(Pkcs11AeadTest, InvalidArguments) {
+  EXPECT_THAT(Pkcs11Aead::New("", pool_).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(Pkcs11Aead::New("key", nullptr).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace pkcs11
+}  // namespace integration
+}  // namespace tink
+}  // namespace crypto
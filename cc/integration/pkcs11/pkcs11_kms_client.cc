@@ -0,0 +1,152 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/integration/pkcs11/pkcs11_kms_client.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/strings/match.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "tink/integration/pkcs11/pkcs11_aead.h"
+#include "tink/kms_clients.h"
+#include "tink/util/errors.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace integration {
+namespace pkcs11 {
+
+namespace {
+
+using crypto::tink::ToStatusF;
+using crypto::tink::util::Status;
+using crypto::tink::util::StatusOr;
+
+static constexpr char kKeyUriPrefix[] = "pkcs11://";
+
+struct KeyLocation {
+  uint64_t slot_id;
+  std::string label;
+};
+
+// Returns the slot and the key label in 'key_uri', or an error if 'key_uri'
+// does not refer to a PKCS#11 key.
+StatusOr<KeyLocation> GetKeyLocation(absl::string_view key_uri) {
+  if (!absl::StartsWithIgnoreCase(key_uri, kKeyUriPrefix)) {
+    return ToStatusF(util::error::INVALID_ARGUMENT, "Key '%s' not supported",
+                     key_uri);
+  }
+  absl::string_view path = key_uri.substr(sizeof(kKeyUriPrefix) - 1);
+  size_t separator = path.find('/');
+  KeyLocation location;
+  if (separator == absl::string_view::npos ||
+      !absl::SimpleAtoi(path.substr(0, separator), &location.slot_id) ||
+      separator + 1 == path.size()) {
+    return ToStatusF(util::error::INVALID_ARGUMENT,
+                     "Invalid PKCS#11 key URI '%s', expected "
+                     "'pkcs11://<slot id>/<key label>'.",
+                     key_uri);
+  }
+  location.label = std::string(path.substr(separator + 1));
+  return location;
+}
+
+}  // namespace
+
+// static
+StatusOr<std::unique_ptr<Pkcs11KmsClient>> Pkcs11KmsClient::New(
+    std::shared_ptr<Pkcs11Module> module, absl::string_view key_uri,
+    const Pkcs11SessionPoolOptions& options) {
+  if (module == nullptr) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "PKCS#11 module cannot be null.");
+  }
+  std::unique_ptr<Pkcs11KmsClient> client(
+      new Pkcs11KmsClient(std::move(module), options));
+
+  // If a specific key is given, open the session pool of its slot.
+  if (!key_uri.empty()) {
+    auto location_result = GetKeyLocation(key_uri);
+    if (!location_result.ok()) return location_result.status();
+    client->key_uri_ = std::string(key_uri);
+    auto pool_result =
+        client->GetSessionPool(location_result.ValueOrDie().slot_id);
+    if (!pool_result.ok()) return pool_result.status();
+  }
+  return std::move(client);
+}
+
+StatusOr<std::shared_ptr<Pkcs11SessionPool>> Pkcs11KmsClient::GetSessionPool(
+    uint64_t slot_id) const {
+  absl::MutexLock lock(&session_pools_mutex_);
+  auto it = session_pools_.find(slot_id);
+  if (it != session_pools_.end()) return it->second;
+  auto pool_result = Pkcs11SessionPool::New(module_, slot_id, options_);
+  if (!pool_result.ok()) return pool_result.status();
+  std::shared_ptr<Pkcs11SessionPool> pool =
+      std::move(pool_result.ValueOrDie());
+  session_pools_.emplace(slot_id, pool);
+  return pool;
+}
+
+bool Pkcs11KmsClient::DoesSupport(absl::string_view key_uri) const {
+  if (!key_uri_.empty()) return key_uri_ == key_uri;
+  return GetKeyLocation(key_uri).ok();
+}
+
+StatusOr<std::unique_ptr<Aead>> Pkcs11KmsClient::GetAead(
+    absl::string_view key_uri) const {
+  if (!DoesSupport(key_uri)) {
+    if (!key_uri_.empty()) {
+      return ToStatusF(util::error::INVALID_ARGUMENT,
+                       "This client is bound to '%s', and cannot use key '%s'.",
+                       key_uri_, key_uri);
+    } else {
+      return ToStatusF(util::error::INVALID_ARGUMENT,
+                       "This client does not support key '%s'.", key_uri);
+    }
+  }
+  auto location_result = GetKeyLocation(key_uri);
+  if (!location_result.ok()) return location_result.status();
+  auto pool_result = GetSessionPool(location_result.ValueOrDie().slot_id);
+  if (!pool_result.ok()) return pool_result.status();
+  return Pkcs11Aead::New(location_result.ValueOrDie().label,
+                         pool_result.ValueOrDie());
+}
+
+Status Pkcs11KmsClient::RegisterNewClient(
+    std::shared_ptr<Pkcs11Module> module, absl::string_view key_uri,
+    const Pkcs11SessionPoolOptions& options) {
+  auto client_result = Pkcs11KmsClient::New(std::move(module), key_uri,
+                                            options);
+  if (!client_result.ok()) {
+    return client_result.status();
+  }
+
+  return KmsClients::Add(std::move(client_result.ValueOrDie()));
+}
+
+}  // namespace pkcs11
+}  // namespace integration
+}  // namespace tink
+}  // namespace crypto
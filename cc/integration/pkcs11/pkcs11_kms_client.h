@@ -0,0 +1,97 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TINK_INTEGRATION_PKCS11_PKCS11_KMS_CLIENT_H_
+#define TINK_INTEGRATION_PKCS11_PKCS11_KMS_CLIENT_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "tink/aead.h"
+#include "tink/integration/pkcs11/pkcs11_module.h"
+#include "tink/integration/pkcs11/pkcs11_session_pool.h"
+#include "tink/kms_client.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace integration {
+namespace pkcs11 {
+
+// Pkcs11KmsClient is an implementation of KmsClient for AES-GCM keys stored
+// in PKCS#11 tokens, e.g. hardware security modules. Key URIs have the form
+//
+//   pkcs11://<slot id>/<key label>
+//
+// The client keeps one Pkcs11SessionPool per slot, which all Aead-primitives
+// it returns for keys in that slot share. It can be used under
+// KmsEnvelopeAead, where each encryption and decryption makes one call to
+// the token.
+class Pkcs11KmsClient : public crypto::tink::KmsClient {
+ public:
+  // Creates a new Pkcs11KmsClient which calls 'module', and which is bound to
+  // the key specified in 'key_uri'. 'options' apply to the session pool of
+  // every slot.
+  //
+  // If 'key_uri' is empty, then the client is not bound to any particular key.
+  static crypto::tink::util::StatusOr<std::unique_ptr<Pkcs11KmsClient>> New(
+      std::shared_ptr<Pkcs11Module> module, absl::string_view key_uri,
+      const Pkcs11SessionPoolOptions& options);
+
+  // Creates a new client and registers it in KMSClients.
+  static crypto::tink::util::Status RegisterNewClient(
+      std::shared_ptr<Pkcs11Module> module, absl::string_view key_uri,
+      const Pkcs11SessionPoolOptions& options);
+
+  // Returns true iff this client does support KMS key specified by 'key_uri'.
+  bool DoesSupport(absl::string_view key_uri) const override;
+
+  // Returns an Aead-primitive backed by KMS key specified by 'key_uri',
+  // provided that this KmsClient does support 'key_uri'.
+  crypto::tink::util::StatusOr<std::unique_ptr<Aead>> GetAead(
+      absl::string_view key_uri) const override;
+
+ private:
+  Pkcs11KmsClient(std::shared_ptr<Pkcs11Module> module,
+                  const Pkcs11SessionPoolOptions& options)
+      : module_(std::move(module)), options_(options) {}
+
+  // Returns the session pool for 'slot_id', and creates it on first use.
+  crypto::tink::util::StatusOr<std::shared_ptr<Pkcs11SessionPool>>
+  GetSessionPool(uint64_t slot_id) const;
+
+  std::shared_ptr<Pkcs11Module> module_;
+  Pkcs11SessionPoolOptions options_;
+  std::string key_uri_;
+  mutable absl::Mutex session_pools_mutex_;
+  mutable absl::flat_hash_map<uint64_t, std::shared_ptr<Pkcs11SessionPool>>
+      session_pools_ ABSL_GUARDED_BY(session_pools_mutex_);
+};
+
+}  // namespace pkcs11
+}  // namespace integration
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_INTEGRATION_PKCS11_PKCS11_KMS_CLIENT_H_
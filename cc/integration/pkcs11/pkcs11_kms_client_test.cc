@@ -0,0 +1,159 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/integration/pkcs11/pkcs11_kms_client.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "tink/aead.h"
+#include "tink/aead/aead_config.h"
+#include "tink/aead/aead_key_templates.h"
+#include "tink/aead/kms_envelope_aead.h"
+#include "tink/integration/pkcs11/fake_pkcs11_module.h"
+#include "tink/integration/pkcs11/pkcs11_session_pool.h"
+#include "tink/kms_clients.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "tink/util/test_matchers.h"
+
+namespace crypto {
+namespace tink {
+namespace integration {
+namespace pkcs11 {
+namespace {
+
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::testing::Eq;
+
+constexpr char kPin[] = "1234";
+constexpr char kKey1[] = "pkcs11://0/key1";
+constexpr char kKey2[] = "pkcs11://1/key2";
+
+std::shared_ptr<FakePkcs11Module> NewModule() {
+  auto module = std::make_shared<FakePkcs11Module>(kPin, /*num_slots=*/2);
+  module->AddKey(/*slot_id=*/0, "key1");
+  module->AddKey(/*slot_id=*/0, "other key");
+  module->AddKey(/*slot_id=*/1, "key2");
+  return module;
+}
+
+Pkcs11SessionPoolOptions Options() {
+  Pkcs11SessionPoolOptions options;
+  options.pin = kPin;
+  return options;
+}
+
+TEST(Pkcs11KmsClientTest, DoesSupport) {
+  auto module = NewModule();
+  {  // A client not bound to any particular key.
+    auto client_result = Pkcs11KmsClient::New(module, "", Options());
+    ASSERT_THAT(client_result.status(), IsOk());
+    auto client = std::move(client_result.ValueOrDie());
+    EXPECT_TRUE(client->DoesSupport(kKey1));
+    EXPECT_TRUE(client->DoesSupport(kKey2));
+    EXPECT_TRUE(client->DoesSupport("pkcs11://0/a/b"));
+    EXPECT_FALSE(client->DoesSupport("pkcs11://0/"));
+    EXPECT_FALSE(client->DoesSupport("pkcs11://x/key"));
+    EXPECT_FALSE(client->DoesSupport("pkcs11://key"));
+    EXPECT_FALSE(client->DoesSupport("aws-kms://arn:aws:kms:us-east-1:a:k"));
+  }
+  {  // A client bound to a specific key.
+    auto client_result = Pkcs11KmsClient::New(module, kKey1, Options());
+    ASSERT_THAT(client_result.status(), IsOk());
+    auto client = std::move(client_result.ValueOrDie());
+    EXPECT_TRUE(client->DoesSupport(kKey1));
+    EXPECT_FALSE(client->DoesSupport(kKey2));
+    EXPECT_THAT(client->GetAead(kKey2).status(),
+                StatusIs(util::error::INVALID_ARGUMENT));
+  }
+}
+
+TEST(Pkcs11KmsClientTest, SharesSessionsPerSlot) {
+  auto module = NewModule();
+  auto client_result = Pkcs11KmsClient::New(module, "", Options());
+  ASSERT_THAT(client_result.status(), IsOk());
+  auto client = std::move(client_result.ValueOrDie());
+
+  auto aead1 = client->GetAead(kKey1);
+  auto aead2 = client->GetAead("pkcs11://0/other key");
+  auto aead3 = client->GetAead(kKey2);
+  ASSERT_THAT(aead1.status(), IsOk());
+  ASSERT_THAT(aead2.status(), IsOk());
+  ASSERT_THAT(aead3.status(), IsOk());
+  for (int i = 0; i < 10; i++) {
+    ASSERT_THAT(aead1.ValueOrDie()->Encrypt("data", "").status(), IsOk());
+    ASSERT_THAT(aead2.ValueOrDie()->Encrypt("data", "").status(), IsOk());
+    ASSERT_THAT(aead3.ValueOrDie()->Encrypt("data", "").status(), IsOk());
+  }
+  // One session in each of the two slots.
+  EXPECT_THAT(module->sessions_opened(), Eq(2));
+  EXPECT_THAT(module->find_calls(), Eq(3));
+}
+
+TEST(Pkcs11KmsClientTest, InvalidArguments) {
+  auto module = NewModule();
+  EXPECT_THAT(Pkcs11KmsClient::New(nullptr, "", Options()).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(Pkcs11KmsClient::New(module, "gcp-kms://key", Options()).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(
+      Pkcs11KmsClient::New(module, "pkcs11://7/key", Options()).status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+  Pkcs11SessionPoolOptions wrong_pin = Options();
+  wrong_pin.pin = "wrong pin";
+  EXPECT_THAT(Pkcs11KmsClient::New(module, kKey1, wrong_pin).status(),
+              StatusIs(util::error::PERMISSION_DENIED));
+}
+
+TEST(Pkcs11KmsClientTest, RegisterNewClient) {
+  auto module = NewModule();
+  ASSERT_THAT(Pkcs11KmsClient::RegisterNewClient(module, kKey2, Options()),
+              IsOk());
+  auto client_result = KmsClients::Get(kKey2);
+  ASSERT_THAT(client_result.status(), IsOk());
+  EXPECT_THAT(client_result.ValueOrDie()->GetAead(kKey2).status(), IsOk());
+}
+
+TEST(Pkcs11KmsClientTest, EnvelopeEncryption) {
+  ASSERT_THAT(AeadConfig::Register(), IsOk());
+  auto module = NewModule();
+  auto client_result = Pkcs11KmsClient::New(module, kKey1, Options());
+  ASSERT_THAT(client_result.status(), IsOk());
+  auto remote_aead = client_result.ValueOrDie()->GetAead(kKey1);
+  ASSERT_THAT(remote_aead.status(), IsOk());
+  auto aead_result = KmsEnvelopeAead::New(AeadKeyTemplates::Aes128Gcm(),
+                                          std::move(remote_aead.ValueOrDie()));
+  ASSERT_THAT(aead_result.status(), IsOk());
+  auto aead = std::move(aead_result.ValueOrDie());
+
+  auto ciphertext = aead->Encrypt("plaintext", "associated data");
+  ASSERT_THAT(ciphertext.status(), IsOk());
+  auto plaintext = aead->Decrypt(ciphertext.ValueOrDie(), "associated data");
+  ASSERT_THAT(plaintext.status(), IsOk());
+  EXPECT_THAT(plaintext.ValueOrDie(), Eq("plaintext"));
+}
+
+}  // namespace
+}  // namespace pkcs11
+}  // namespace integration
+}  // namespace tink
+}  // namespace crypto
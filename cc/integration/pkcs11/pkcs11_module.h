@@ -0,0 +1,88 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TINK_INTEGRATION_PKCS11_PKCS11_MODULE_H_
+#define TINK_INTEGRATION_PKCS11_PKCS11_MODULE_H_
+
+#include <cstdint>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace integration {
+namespace pkcs11 {
+
+// A PKCS#11 CK_SESSION_HANDLE.
+using Pkcs11SessionHandle = uint64_t;
+// A PKCS#11 CK_OBJECT_HANDLE.
+using Pkcs11ObjectHandle = uint64_t;
+
+// The calls of a PKCS#11 module (the CK_FUNCTION_LIST of a vendor library)
+// which Tink uses. A binding forwards each method to the corresponding C_*
+// function, and maps CK_RV codes to a Status. The module must be initialized
+// with CKF_OS_LOCKING_OK, since all methods may be called concurrently for
+// different sessions.
+//
+// Methods return UNAVAILABLE iff the session can no longer be used, e.g. for
+// CKR_SESSION_HANDLE_INVALID, CKR_SESSION_CLOSED or CKR_DEVICE_REMOVED.
+class Pkcs11Module {
+ public:
+  // C_OpenSession with CKF_SERIAL_SESSION.
+  virtual crypto::tink::util::StatusOr<Pkcs11SessionHandle> OpenSession(
+      uint64_t slot_id) = 0;
+
+  // C_CloseSession.
+  virtual crypto::tink::util::Status CloseSession(
+      Pkcs11SessionHandle session) = 0;
+
+  // C_Login as CKU_USER. Returns OK for CKR_USER_ALREADY_LOGGED_IN.
+  virtual crypto::tink::util::Status Login(Pkcs11SessionHandle session,
+                                           absl::string_view pin) = 0;
+
+  // C_FindObjects for the CKO_SECRET_KEY with the given CKA_LABEL. Returns
+  // NOT_FOUND if there is no such key.
+  virtual crypto::tink::util::StatusOr<Pkcs11ObjectHandle> FindSecretKey(
+      Pkcs11SessionHandle session, absl::string_view label) = 0;
+
+  // C_EncryptInit with CKM_AES_GCM, a 128-bit tag, 'iv' and
+  // 'associated_data', followed by C_Encrypt. Returns the ciphertext followed
+  // by the tag.
+  virtual crypto::tink::util::StatusOr<std::string> EncryptAesGcm(
+      Pkcs11SessionHandle session, Pkcs11ObjectHandle key,
+      absl::string_view iv, absl::string_view plaintext,
+      absl::string_view associated_data) = 0;
+
+  // C_DecryptInit with CKM_AES_GCM, followed by C_Decrypt. 'ciphertext' is
+  // what EncryptAesGcm() returns.
+  virtual crypto::tink::util::StatusOr<std::string> DecryptAesGcm(
+      Pkcs11SessionHandle session, Pkcs11ObjectHandle key,
+      absl::string_view iv, absl::string_view ciphertext,
+      absl::string_view associated_data) = 0;
+
+  virtual ~Pkcs11Module() {}
+};
+
+}  // namespace pkcs11
+}  // namespace integration
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_INTEGRATION_PKCS11_PKCS11_MODULE_H_
@@ -0,0 +1,159 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/integration/pkcs11/pkcs11_session_pool.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "tink/integration/pkcs11/pkcs11_module.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace integration {
+namespace pkcs11 {
+
+using crypto::tink::util::Status;
+using crypto::tink::util::StatusOr;
+
+Pkcs11SessionPool::Session::Session(Session&& other)
+    : pool_(other.pool_), handle_(other.handle_) {
+  other.pool_ = nullptr;
+}
+
+Pkcs11SessionPool::Session& Pkcs11SessionPool::Session::operator=(
+    Session&& other) {
+  if (this != &other) {
+    if (pool_ != nullptr) pool_->Release(handle_, /*discard=*/false);
+    pool_ = other.pool_;
+    handle_ = other.handle_;
+    other.pool_ = nullptr;
+  }
+  return *this;
+}
+
+Pkcs11SessionPool::Session::~Session() {
+  if (pool_ != nullptr) pool_->Release(handle_, /*discard=*/false);
+}
+
+void Pkcs11SessionPool::Session::Discard() {
+  if (pool_ != nullptr) pool_->Release(handle_, /*discard=*/true);
+  pool_ = nullptr;
+}
+
+// static
+StatusOr<std::unique_ptr<Pkcs11SessionPool>> Pkcs11SessionPool::New(
+    std::shared_ptr<Pkcs11Module> module, uint64_t slot_id,
+    const Pkcs11SessionPoolOptions& options) {
+  if (module == nullptr) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "PKCS#11 module cannot be null.");
+  }
+  if (options.max_sessions <= 0) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "max_sessions must be positive.");
+  }
+  std::unique_ptr<Pkcs11SessionPool> pool(
+      new Pkcs11SessionPool(std::move(module), slot_id, options));
+  // Opens the first session eagerly, so that a wrong slot or PIN is reported
+  // here rather than on first use.
+  auto session_result = pool->Acquire();
+  if (!session_result.ok()) return session_result.status();
+  return std::move(pool);
+}
+
+Pkcs11SessionPool::~Pkcs11SessionPool() {
+  absl::MutexLock lock(&mutex_);
+  for (Pkcs11SessionHandle handle : free_sessions_) {
+    module_->CloseSession(handle).IgnoreError();
+  }
+}
+
+StatusOr<Pkcs11SessionHandle> Pkcs11SessionPool::OpenSession() {
+  auto handle_result = module_->OpenSession(slot_id_);
+  if (!handle_result.ok()) return handle_result.status();
+  // The login state is shared by all sessions of the token, and ends when its
+  // last session is closed.
+  if (open_sessions_ == 0 && !options_.pin.empty()) {
+    Status status = module_->Login(handle_result.ValueOrDie(), options_.pin);
+    if (!status.ok()) {
+      module_->CloseSession(handle_result.ValueOrDie()).IgnoreError();
+      return status;
+    }
+  }
+  open_sessions_++;
+  return handle_result.ValueOrDie();
+}
+
+bool Pkcs11SessionPool::CanAcquire() const {
+  return !free_sessions_.empty() || open_sessions_ < options_.max_sessions;
+}
+
+StatusOr<Pkcs11SessionPool::Session> Pkcs11SessionPool::Acquire() {
+  absl::MutexLock lock(&mutex_);
+  mutex_.Await(absl::Condition(this, &Pkcs11SessionPool::CanAcquire));
+  if (!free_sessions_.empty()) {
+    Pkcs11SessionHandle handle = free_sessions_.back();
+    free_sessions_.pop_back();
+    return Session(this, handle);
+  }
+  auto handle_result = OpenSession();
+  if (!handle_result.ok()) return handle_result.status();
+  return Session(this, handle_result.ValueOrDie());
+}
+
+void Pkcs11SessionPool::Release(Pkcs11SessionHandle handle, bool discard) {
+  absl::MutexLock lock(&mutex_);
+  if (!discard) {
+    free_sessions_.push_back(handle);
+    return;
+  }
+  module_->CloseSession(handle).IgnoreError();
+  open_sessions_--;
+  // A lost session usually means that the token was removed or reset, so the
+  // other sessions and the cached handles are likely invalid as well.
+  for (Pkcs11SessionHandle free_handle : free_sessions_) {
+    module_->CloseSession(free_handle).IgnoreError();
+  }
+  open_sessions_ -= free_sessions_.size();
+  free_sessions_.clear();
+  key_handles_.clear();
+}
+
+StatusOr<Pkcs11ObjectHandle> Pkcs11SessionPool::FindSecretKey(
+    const Session& session, absl::string_view label) {
+  {
+    absl::MutexLock lock(&mutex_);
+    auto it = key_handles_.find(std::string(label));
+    if (it != key_handles_.end()) return it->second;
+  }
+  auto key_result = module_->FindSecretKey(session.handle(), label);
+  if (!key_result.ok()) return key_result.status();
+  absl::MutexLock lock(&mutex_);
+  key_handles_.emplace(std::string(label), key_result.ValueOrDie());
+  return key_result.ValueOrDie();
+}
+
+}  // namespace pkcs11
+}  // namespace integration
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,130 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TINK_INTEGRATION_PKCS11_PKCS11_SESSION_POOL_H_
+#define TINK_INTEGRATION_PKCS11_PKCS11_SESSION_POOL_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "tink/integration/pkcs11/pkcs11_module.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace integration {
+namespace pkcs11 {
+
+struct Pkcs11SessionPoolOptions {
+  // The PIN of the normal user of the token. Empty if the token needs no
+  // login.
+  std::string pin;
+  // The maximum number of sessions open at the same time.
+  int max_sessions = 16;
+};
+
+// Pkcs11SessionPool keeps the logged-in sessions of one PKCS#11 slot open, so
+// that operations need not open a session each. A session is used by one
+// thread at a time: Acquire() takes a free session out of the pool, or opens
+// a new one, and the session goes back to the pool when the caller is done.
+//
+// The pool also caches the object handles of secret keys, which remain valid
+// in all sessions as long as any session of the token is open.
+class Pkcs11SessionPool {
+ public:
+  // A session taken out of the pool, which is returned to the pool on
+  // destruction.
+  class Session {
+   public:
+    Session() {}
+    Session(Session&& other);
+    Session& operator=(Session&& other);
+    ~Session();
+
+    Pkcs11SessionHandle handle() const { return handle_; }
+
+    // Closes the session instead of returning it to the pool, after the
+    // module reported that it can no longer be used.
+    void Discard();
+
+   private:
+    friend class Pkcs11SessionPool;
+    Session(Pkcs11SessionPool* pool, Pkcs11SessionHandle handle)
+        : pool_(pool), handle_(handle) {}
+
+    Pkcs11SessionPool* pool_ = nullptr;
+    Pkcs11SessionHandle handle_ = 0;
+  };
+
+  static crypto::tink::util::StatusOr<std::unique_ptr<Pkcs11SessionPool>> New(
+      std::shared_ptr<Pkcs11Module> module, uint64_t slot_id,
+      const Pkcs11SessionPoolOptions& options);
+
+  // Closes all sessions. Sessions which have not been returned yet must not
+  // outlive the pool.
+  ~Pkcs11SessionPool();
+
+  Pkcs11Module* module() const { return module_.get(); }
+
+  // Returns a session which no other thread uses. Opens a new session if no
+  // session is free, and waits for a session to be returned if
+  // options.max_sessions sessions are open already.
+  crypto::tink::util::StatusOr<Session> Acquire();
+
+  // Returns the handle of the secret key labelled 'label', which is looked up
+  // with 'session' unless it is cached.
+  crypto::tink::util::StatusOr<Pkcs11ObjectHandle> FindSecretKey(
+      const Session& session, absl::string_view label);
+
+ private:
+  Pkcs11SessionPool(std::shared_ptr<Pkcs11Module> module, uint64_t slot_id,
+                    const Pkcs11SessionPoolOptions& options)
+      : module_(std::move(module)), slot_id_(slot_id), options_(options) {}
+
+  void Release(Pkcs11SessionHandle handle, bool discard);
+
+  bool CanAcquire() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Opens and logs in a session, with 'mutex_' held.
+  crypto::tink::util::StatusOr<Pkcs11SessionHandle> OpenSession()
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const std::shared_ptr<Pkcs11Module> module_;
+  const uint64_t slot_id_;
+  const Pkcs11SessionPoolOptions options_;
+
+  absl::Mutex mutex_;
+  std::vector<Pkcs11SessionHandle> free_sessions_ ABSL_GUARDED_BY(mutex_);
+  int open_sessions_ ABSL_GUARDED_BY(mutex_) = 0;
+  absl::flat_hash_map<std::string, Pkcs11ObjectHandle> key_handles_
+      ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace pkcs11
+}  // namespace integration
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_INTEGRATION_PKCS11_PKCS11_SESSION_POOL_H_
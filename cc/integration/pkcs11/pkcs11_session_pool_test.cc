@@ -0,0 +1,192 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/integration/pkcs11/pkcs11_session_pool.h"
+
+#include <memory>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/synchronization/notification.h"
+#include "absl/time/time.h"
+#include "tink/integration/pkcs11/fake_pkcs11_module.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "tink/util/test_matchers.h"
+
+namespace crypto {
+namespace tink {
+namespace integration {
+namespace pkcs11 {
+namespace {
+
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::testing::Eq;
+using ::testing::Ne;
+
+constexpr char kPin[] = "1234";
+
+std::unique_ptr<Pkcs11SessionPool> NewPool(
+    std::shared_ptr<FakePkcs11Module> module, int max_sessions) {
+  Pkcs11SessionPoolOptions options;
+  options.pin = kPin;
+  options.max_sessions = max_sessions;
+  auto pool_result = Pkcs11SessionPool::New(module, /*slot_id=*/0, options);
+  EXPECT_THAT(pool_result.status(), IsOk());
+  return std::move(pool_result.ValueOrDie());
+}
+
+TEST(Pkcs11SessionPoolTest, ReusesSessions) {
+  auto module = std::make_shared<FakePkcs11Module>(kPin, /*num_slots=*/1);
+  auto pool = NewPool(module, /*max_sessions=*/4);
+  for (int i = 0; i < 10; i++) {
+    auto session_result = pool->Acquire();
+    ASSERT_THAT(session_result.status(), IsOk());
+  }
+  EXPECT_THAT(module->sessions_opened(), Eq(1));
+  EXPECT_THAT(module->logins(), Eq(1));
+}
+
+TEST(Pkcs11SessionPoolTest, OpensSessionsForConcurrentUsers) {
+  auto module = std::make_shared<FakePkcs11Module>(kPin, /*num_slots=*/1);
+  auto pool = NewPool(module, /*max_sessions=*/4);
+  auto session1 = pool->Acquire();
+  auto session2 = pool->Acquire();
+  auto session3 = pool->Acquire();
+  ASSERT_THAT(session1.status(), IsOk());
+  ASSERT_THAT(session2.status(), IsOk());
+  ASSERT_THAT(session3.status(), IsOk());
+  EXPECT_THAT(session1.ValueOrDie().handle(),
+              Ne(session2.ValueOrDie().handle()));
+  EXPECT_THAT(session2.ValueOrDie().handle(),
+              Ne(session3.ValueOrDie().handle()));
+  EXPECT_THAT(module->sessions_opened(), Eq(3));
+  // Logging in one session logs in all sessions of the token.
+  EXPECT_THAT(module->logins(), Eq(1));
+}
+
+TEST(Pkcs11SessionPoolTest, WaitsForFreeSession) {
+  auto module = std::make_shared<FakePkcs11Module>(kPin, /*num_slots=*/1);
+  auto pool = NewPool(module, /*max_sessions=*/1);
+  auto session_result = pool->Acquire();
+  ASSERT_THAT(session_result.status(), IsOk());
+  Pkcs11SessionHandle handle = session_result.ValueOrDie().handle();
+
+  absl::Notification acquired;
+  Pkcs11SessionHandle other_handle = 0;
+  std::thread thread([&pool, &acquired, &other_handle]() {
+    auto other_result = pool->Acquire();
+    EXPECT_THAT(other_result.status(), IsOk());
+    if (other_result.ok()) other_handle = other_result.ValueOrDie().handle();
+    acquired.Notify();
+  });
+  EXPECT_FALSE(acquired.WaitForNotificationWithTimeout(
+      absl::Milliseconds(50)));
+  {
+    // Returns the session to the pool.
+    Pkcs11SessionPool::Session released =
+        std::move(session_result.ValueOrDie());
+  }
+  thread.join();
+  EXPECT_THAT(other_handle, Eq(handle));
+  EXPECT_THAT(module->sessions_opened(), Eq(1));
+}
+
+TEST(Pkcs11SessionPoolTest, CachesKeyHandles) {
+  auto module = std::make_shared<FakePkcs11Module>(kPin, /*num_slots=*/1);
+  module->AddKey(/*slot_id=*/0, "key");
+  auto pool = NewPool(module, /*max_sessions=*/4);
+  auto session_result = pool->Acquire();
+  ASSERT_THAT(session_result.status(), IsOk());
+  auto key1 = pool->FindSecretKey(session_result.ValueOrDie(), "key");
+  auto key2 = pool->FindSecretKey(session_result.ValueOrDie(), "key");
+  ASSERT_THAT(key1.status(), IsOk());
+  ASSERT_THAT(key2.status(), IsOk());
+  EXPECT_THAT(key1.ValueOrDie(), Eq(key2.ValueOrDie()));
+  EXPECT_THAT(module->find_calls(), Eq(1));
+  EXPECT_THAT(
+      pool->FindSecretKey(session_result.ValueOrDie(), "other").status(),
+      StatusIs(util::error::NOT_FOUND));
+}
+
+TEST(Pkcs11SessionPoolTest, DiscardClosesAllFreeSessions) {
+  auto module = std::make_shared<FakePkcs11Module>(kPin, /*num_slots=*/1);
+  module->AddKey(/*slot_id=*/0, "key");
+  auto pool = NewPool(module, /*max_sessions=*/4);
+  {
+    auto session1 = pool->Acquire();
+    auto session2 = pool->Acquire();
+    ASSERT_THAT(session1.status(), IsOk());
+    ASSERT_THAT(session2.status(), IsOk());
+    ASSERT_THAT(pool->FindSecretKey(session1.ValueOrDie(), "key").status(),
+                IsOk());
+  }
+  EXPECT_THAT(module->sessions_open(), Eq(2));
+  {
+    auto session = pool->Acquire();
+    ASSERT_THAT(session.status(), IsOk());
+    session.ValueOrDie().Discard();
+  }
+  EXPECT_THAT(module->sessions_open(), Eq(0));
+
+  // The next session logs in again, and the key is looked up again.
+  auto session = pool->Acquire();
+  ASSERT_THAT(session.status(), IsOk());
+  EXPECT_THAT(module->logins(), Eq(2));
+  ASSERT_THAT(pool->FindSecretKey(session.ValueOrDie(), "key").status(),
+              IsOk());
+  EXPECT_THAT(module->find_calls(), Eq(2));
+}
+
+TEST(Pkcs11SessionPoolTest, ClosesSessionsOnDestruction) {
+  auto module = std::make_shared<FakePkcs11Module>(kPin, /*num_slots=*/1);
+  {
+    auto pool = NewPool(module, /*max_sessions=*/4);
+    auto session1 = pool->Acquire();
+    auto session2 = pool->Acquire();
+    EXPECT_THAT(module->sessions_open(), Eq(2));
+  }
+  EXPECT_THAT(module->sessions_open(), Eq(0));
+}
+
+TEST(Pkcs11SessionPoolTest, InvalidArguments) {
+  auto module = std::make_shared<FakePkcs11Module>(kPin, /*num_slots=*/1);
+  Pkcs11SessionPoolOptions options;
+  options.pin = kPin;
+  EXPECT_THAT(Pkcs11SessionPool::New(nullptr, 0, options).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(Pkcs11SessionPool::New(module, 1, options).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  options.max_sessions = 0;
+  EXPECT_THAT(Pkcs11SessionPool::New(module, 0, options).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  options.max_sessions = 1;
+  options.pin = "wrong pin";
+  EXPECT_THAT(Pkcs11SessionPool::New(module, 0, options).status(),
+              StatusIs(util::error::PERMISSION_DENIED));
+  EXPECT_THAT(module->sessions_open(), Eq(0));
+}
+
+}  // namespace
+}  // namespace pkcs11
+}  // namespace integration
+}  // namespace tink
+}  // namespace crypto
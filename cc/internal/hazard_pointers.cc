@@ -0,0 +1,102 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+#include "tink/internal/hazard_pointers.h"
+
+#include <algorithm>
+#include <atomic>
+#include <utility>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+
+namespace crypto {
+namespace tink {
+namespace internal {
+
+HazardPointerDomain::~HazardPointerDomain() {
+  absl::MutexLock lock(&mutex_);
+  for (auto& object_and_deleter : retired_) {
+    object_and_deleter.second(object_and_deleter.first);
+  }
+  Record* record = records_.load(std::memory_order_acquire);
+  while (record != nullptr) {
+    Record* next = record->next;
+    delete record;
+    record = next;
+  }
+}
+
+HazardPointerDomain::Record* HazardPointerDomain::AcquireRecord() {
+  for (Record* record = records_.load(std::memory_order_acquire);
+       record != nullptr; record = record->next) {
+    bool in_use = false;
+    if (!record->in_use.load(std::memory_order_relaxed) &&
+        record->in_use.compare_exchange_strong(in_use, true,
+                                               std::memory_order_acquire)) {
+      return record;
+    }
+  }
+  Record* record = new Record();
+  record->in_use.store(true, std::memory_order_relaxed);
+  Record* head = records_.load(std::memory_order_relaxed);
+  do {
+    record->next = head;
+  } while (!records_.compare_exchange_weak(head, record,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed));
+  return record;
+}
+
+void HazardPointerDomain::Retire(void* object, Deleter deleter) {
+  absl::MutexLock lock(&mutex_);
+  retired_.emplace_back(object, std::move(deleter));
+  ReclaimLocked();
+}
+
+void HazardPointerDomain::Reclaim() {
+  absl::MutexLock lock(&mutex_);
+  ReclaimLocked();
+}
+
+int HazardPointerDomain::retired_count() const {
+  absl::MutexLock lock(&mutex_);
+  return retired_.size();
+}
+
+void HazardPointerDomain::ReclaimLocked() {
+  if (retired_.empty()) return;
+  std::vector<void*> hazards;
+  for (Record* record = records_.load(std::memory_order_acquire);
+       record != nullptr; record = record->next) {
+    void* hazard = record->hazard.load(std::memory_order_seq_cst);
+    if (hazard != nullptr) hazards.push_back(hazard);
+  }
+  std::sort(hazards.begin(), hazards.end());
+  std::vector<std::pair<void*, Deleter>> still_retired;
+  for (auto& object_and_deleter : retired_) {
+    if (std::binary_search(hazards.begin(), hazards.end(),
+                           object_and_deleter.first)) {
+      still_retired.push_back(std::move(object_and_deleter));
+    } else {
+      object_and_deleter.second(object_and_deleter.first);
+    }
+  }
+  retired_ = std::move(still_retired);
+}
+
+}  // namespace internal
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,134 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+#ifndef TINK_INTERNAL_HAZARD_POINTERS_H_
+#define TINK_INTERNAL_HAZARD_POINTERS_H_
+
+#include <atomic>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+
+namespace crypto {
+namespace tink {
+namespace internal {
+
+// Hazard pointers, which let readers use an object published through an
+// std::atomic<void*> without taking locks, while a writer replaces it and
+// deletes the old object once no reader uses it anymore.
+//
+// Readers protect the pointer with a Holder:
+//
+//   HazardPointerDomain::Holder holder(&domain);
+//   auto* object = static_cast<Object*>(holder.Protect(published));
+//   ... use object until holder is destroyed or reset ...
+//
+// A writer swaps the published pointer and retires the old object:
+//
+//   void* old = published.exchange(new_object);
+//   domain.Retire(old, [](void* object) {
+//     delete static_cast<Object*>(object);
+//   });
+//
+// Holders never block. Retire() and Reclaim() may be called concurrently with
+// readers, but are serialized with each other.
+class HazardPointerDomain {
+ public:
+  using Deleter = std::function<void(void*)>;
+
+ private:
+  // A hazard pointer. Records are only allocated, never freed until the
+  // domain is destroyed, so that readers can traverse the list without locks.
+  struct Record {
+    std::atomic<void*> hazard{nullptr};
+    std::atomic<bool> in_use{false};
+    Record* next = nullptr;
+  };
+
+ public:
+  // A reader's reference to one hazard pointer of a domain, which must
+  // outlive the holder. Not thread-safe: a holder belongs to one reader.
+  class Holder {
+   public:
+    explicit Holder(HazardPointerDomain* domain)
+        : record_(domain->AcquireRecord()) {}
+    Holder(Holder&& other) : record_(other.record_) { other.record_ = nullptr; }
+    ~Holder() {
+      if (record_ == nullptr) return;
+      record_->hazard.store(nullptr, std::memory_order_release);
+      record_->in_use.store(false, std::memory_order_release);
+    }
+
+    Holder(const Holder&) = delete;
+    Holder& operator=(const Holder&) = delete;
+    Holder& operator=(Holder&&) = delete;
+
+    // Loads 'source' and returns its value, which will not be deleted by
+    // Reclaim() until this holder is reset or destroyed.
+    void* Protect(const std::atomic<void*>& source) {
+      void* object = source.load(std::memory_order_relaxed);
+      while (true) {
+        record_->hazard.store(object, std::memory_order_seq_cst);
+        // Check that 'object' was not retired before the hazard was visible.
+        void* current = source.load(std::memory_order_seq_cst);
+        if (current == object) return object;
+        object = current;
+      }
+    }
+
+    // Releases the protection of the last Protect() call.
+    void Reset() { record_->hazard.store(nullptr, std::memory_order_release); }
+
+   private:
+    Record* record_;  // null if moved from
+  };
+
+  HazardPointerDomain() = default;
+  // Deletes all retired objects: no holder may protect them anymore.
+  ~HazardPointerDomain();
+
+  HazardPointerDomain(const HazardPointerDomain&) = delete;
+  HazardPointerDomain& operator=(const HazardPointerDomain&) = delete;
+
+  // Schedules 'object', which must no longer be reachable by new Protect()
+  // calls, to be deleted with 'deleter', and reclaims retired objects.
+  void Retire(void* object, Deleter deleter) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Deletes the retired objects which are not protected by any holder.
+  void Reclaim() ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns the number of retired objects which are not deleted yet.
+  int retired_count() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  // Returns an unused record, allocating one if all are in use.
+  Record* AcquireRecord();
+
+  void ReclaimLocked() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  std::atomic<Record*> records_{nullptr};
+
+  mutable absl::Mutex mutex_;
+  std::vector<std::pair<void*, Deleter>> retired_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace internal
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_INTERNAL_HAZARD_POINTERS_H_
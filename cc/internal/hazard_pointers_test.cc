@@ -0,0 +1,149 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+#include "tink/internal/hazard_pointers.h"
+
+#include <atomic>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+
+namespace crypto {
+namespace tink {
+namespace internal {
+namespace {
+
+// Counts the live instances, and checks that deleted ones are not used.
+struct Counted {
+  explicit Counted(std::atomic<int>* live, int value)
+      : live(live), value(value) {
+    live->fetch_add(1);
+  }
+  ~Counted() {
+    value = -1;
+    live->fetch_sub(1);
+  }
+
+  std::atomic<int>* live;
+  int value;
+};
+
+void DeleteCounted(void* object) { delete static_cast<Counted*>(object); }
+
+TEST(HazardPointerDomainTest, RetiredObjectsAreDeleted) {
+  std::atomic<int> live(0);
+  HazardPointerDomain domain;
+  domain.Retire(new Counted(&live, 1), &DeleteCounted);
+  EXPECT_EQ(0, live);
+  EXPECT_EQ(0, domain.retired_count());
+}
+
+TEST(HazardPointerDomainTest, ProtectedObjectsAreKept) {
+  std::atomic<int> live(0);
+  HazardPointerDomain domain;
+  std::atomic<void*> published(new Counted(&live, 1));
+  {
+    HazardPointerDomain::Holder holder(&domain);
+    auto* object = static_cast<Counted*>(holder.Protect(published));
+    void* old = published.exchange(new Counted(&live, 2));
+    ASSERT_EQ(old, object);
+    domain.Retire(old, &DeleteCounted);
+    EXPECT_EQ(2, live);
+    EXPECT_EQ(1, domain.retired_count());
+    EXPECT_EQ(1, object->value);
+
+    // Protecting again returns the new object, and releases the old one.
+    auto* new_object = static_cast<Counted*>(holder.Protect(published));
+    EXPECT_EQ(2, new_object->value);
+    domain.Reclaim();
+    EXPECT_EQ(1, live);
+    EXPECT_EQ(0, domain.retired_count());
+
+    // After Reset(), the new object can be deleted, too.
+    holder.Reset();
+    domain.Retire(published.exchange(nullptr), &DeleteCounted);
+    EXPECT_EQ(0, live);
+  }
+}
+
+TEST(HazardPointerDomainTest, HoldersReleaseTheirProtection) {
+  std::atomic<int> live(0);
+  HazardPointerDomain domain;
+  std::atomic<void*> published(new Counted(&live, 1));
+  auto holder = absl::make_unique<HazardPointerDomain::Holder>(&domain);
+  holder->Protect(published);
+  // A moved holder keeps protecting the object.
+  HazardPointerDomain::Holder moved_holder(std::move(*holder));
+  holder.reset();
+  domain.Retire(published.exchange(nullptr), &DeleteCounted);
+  EXPECT_EQ(1, live);
+  {
+    HazardPointerDomain::Holder other_holder(std::move(moved_holder));
+  }
+  domain.Reclaim();
+  EXPECT_EQ(0, live);
+}
+
+TEST(HazardPointerDomainTest, DestructorDeletesRetiredObjects) {
+  std::atomic<int> live(0);
+  std::atomic<void*> published(new Counted(&live, 1));
+  {
+    HazardPointerDomain domain;
+    HazardPointerDomain::Holder holder(&domain);
+    holder.Protect(published);
+    domain.Retire(published.exchange(nullptr), &DeleteCounted);
+    EXPECT_EQ(1, live);
+  }
+  EXPECT_EQ(0, live);
+}
+
+TEST(HazardPointerDomainTest, ConcurrentReadersAndWriter) {
+  std::atomic<int> live(0);
+  HazardPointerDomain domain;
+  std::atomic<void*> published(new Counted(&live, 0));
+  std::atomic<bool> done(false);
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; i++) {
+    readers.emplace_back([&]() {
+      int last_value = 0;
+      while (!done.load()) {
+        HazardPointerDomain::Holder holder(&domain);
+        auto* object = static_cast<Counted*>(holder.Protect(published));
+        // Values only increase, and deleted objects are never seen.
+        EXPECT_GE(object->value, last_value);
+        last_value = object->value;
+      }
+    });
+  }
+  for (int value = 1; value <= 1000; value++) {
+    domain.Retire(published.exchange(new Counted(&live, value)),
+                  &DeleteCounted);
+  }
+  done.store(true);
+  for (std::thread& reader : readers) reader.join();
+  domain.Reclaim();
+  EXPECT_EQ(1, live);
+  DeleteCounted(published.exchange(nullptr));
+  EXPECT_EQ(0, live);
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace tink
+}  // namespace crypto
@@ -15,6 +15,7 @@
 #define TINK_INTERNAL_KEYSET_WRAPPER_H_
 
 #include "tink/util/statusor.h"
+#include "tink/util/validation.h"
 #include "proto/tink.pb.h"
 
 namespace crypto {
@@ -39,6 +40,12 @@ class KeysetWrapper {
 
   virtual crypto::tink::util::StatusOr<std::unique_ptr<Primitive>> Wrap(
       const google::crypto::tink::Keyset& keyset) const = 0;
+
+  // As Wrap(), but for a keyset which has already been validated, with 'plan'
+  // being the result of PlanKeyset(keyset).
+  virtual crypto::tink::util::StatusOr<std::unique_ptr<Primitive>>
+  WrapWithPlan(const google::crypto::tink::Keyset& keyset,
+               const KeysetPlan& plan) const = 0;
 };
 
 }  // namespace tink
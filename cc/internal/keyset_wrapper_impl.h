@@ -40,24 +40,44 @@ class KeysetWrapperImpl : public KeysetWrapper<Q> {
 
   crypto::tink::util::StatusOr<std::unique_ptr<Q>> Wrap(
       const google::crypto::tink::Keyset& keyset) const override {
-    crypto::tink::util::Status status = ValidateKeyset(keyset);
-    if (!status.ok()) return status;
-    std::unique_ptr<PrimitiveSet<P>> primitives =
-        absl::make_unique<PrimitiveSet<P>>();
-    for (const google::crypto::tink::Keyset::Key& key : keyset.key()) {
-      if (key.status() != google::crypto::tink::KeyStatusType::ENABLED) {
+    crypto::tink::util::StatusOr<KeysetPlan> plan_result = PlanKeyset(keyset);
+    if (!plan_result.ok()) return plan_result.status();
+    return WrapWithPlan(keyset, plan_result.ValueOrDie());
+  }
+
+  crypto::tink::util::StatusOr<std::unique_ptr<Q>> WrapWithPlan(
+      const google::crypto::tink::Keyset& keyset,
+      const KeysetPlan& plan) const override {
+    typename PrimitiveSet<P>::Builder primitives_builder;
+    for (int index : plan.enabled_key_indices) {
+      const google::crypto::tink::Keyset::Key& key = keyset.key(index);
+      const bool is_primary = index == plan.primary_key_index;
+      if (!is_primary && transforming_wrapper_.SupportsLazyPrimitives()) {
+        // Keys other than the primary are often only kept to decrypt or
+        // verify old data, so they are imported when first used.
+        auto primitive_getter = primitive_getter_;
+        google::crypto::tink::KeyData key_data = key.key_data();
+        primitives_builder.AddLazyPrimitive(
+            [primitive_getter, key_data]() {
+              return primitive_getter(key_data);
+            },
+            KeyInfoFromKey(key));
         continue;
       }
       auto primitive = primitive_getter_(key.key_data());
       if (!primitive.ok()) return primitive.status();
-      auto entry = primitives->AddPrimitive(std::move(primitive.ValueOrDie()),
-                                            KeyInfoFromKey(key));
-      if (!entry.ok()) return entry.status();
-      if (key.key_id() == keyset.primary_key_id()) {
-        auto primary_result = primitives->set_primary(entry.ValueOrDie());
-        if (!primary_result.ok()) return primary_result;
+      if (is_primary) {
+        primitives_builder.AddPrimaryPrimitive(
+            std::move(primitive.ValueOrDie()), KeyInfoFromKey(key));
+      } else {
+        primitives_builder.AddPrimitive(std::move(primitive.ValueOrDie()),
+                                        KeyInfoFromKey(key));
       }
     }
+    auto primitives_result = primitives_builder.Build();
+    if (!primitives_result.ok()) return primitives_result.status();
+    std::unique_ptr<PrimitiveSet<P>> primitives =
+        std::move(primitives_result.ValueOrDie());
     return transforming_wrapper_.Wrap(std::move(primitives));
   }
 
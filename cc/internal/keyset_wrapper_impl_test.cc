@@ -57,6 +57,32 @@ class Wrapper : public PrimitiveWrapper<InputPrimitive, OutputPrimitive> {
   }
 };
 
+// As Wrapper, but supports lazy primitives: the primitive of an entry is
+// replaced by the error creating it, if any.
+class LazyWrapper : public PrimitiveWrapper<InputPrimitive, OutputPrimitive> {
+ public:
+  crypto::tink::util::StatusOr<std::unique_ptr<OutputPrimitive>> Wrap(
+      std::unique_ptr<PrimitiveSet<InputPrimitive>> primitive_set)
+      const override {
+    auto result = absl::make_unique<OutputPrimitive>();
+    for (const auto* entry : primitive_set->get_all()) {
+      if (entry->get_key_id() == primitive_set->get_primary()->get_key_id()) {
+        EXPECT_FALSE(entry->is_lazy());
+      } else {
+        EXPECT_TRUE(entry->is_lazy());
+      }
+      auto primitive_result = entry->get_primitive_or_status();
+      result->push_back(std::make_pair(
+          entry->get_key_id(),
+          primitive_result.ok() ? *primitive_result.ValueOrDie()
+                                : primitive_result.status().error_message()));
+    }
+    return result;
+  }
+
+  bool SupportsLazyPrimitives() const override { return true; }
+};
+
 crypto::tink::util::StatusOr<std::unique_ptr<InputPrimitive>> CreateIn(
     const google::crypto::tink::KeyData& key_data) {
   if (absl::StartsWith(key_data.type_url(), "error:")) {
@@ -154,6 +180,42 @@ TEST(KeysetWrapperImplTest, OnlyEnabled) {
                                    Pair(444, "four")));
 }
 
+TEST(KeysetWrapperImplTest, LazyNonPrimaryPrimitives) {
+  LazyWrapper wrapper;
+  auto wrapper_or =
+      absl::make_unique<KeysetWrapperImpl<InputPrimitive, OutputPrimitive>>(
+          &wrapper, &CreateIn);
+  std::vector<std::pair<int, std::string>> keydata = {{1, "ok:one"},
+                                                      {2, "error:two"}};
+  google::crypto::tink::Keyset keyset = CreateKeyset(keydata);
+  keyset.set_primary_key_id(1);
+
+  // The failing non-primary key does not fail Wrap().
+  util::StatusOr<std::unique_ptr<OutputPrimitive>> wrapped =
+      wrapper_or->Wrap(keyset);
+
+  ASSERT_THAT(wrapped.status(), IsOk());
+  ASSERT_THAT(*wrapped.ValueOrDie(),
+              UnorderedElementsAre(Pair(1, "ok:one"), Pair(2, "error:two")));
+}
+
+TEST(KeysetWrapperImplTest, LazyWrapperFailingPrimary) {
+  LazyWrapper wrapper;
+  auto wrapper_or =
+      absl::make_unique<KeysetWrapperImpl<InputPrimitive, OutputPrimitive>>(
+          &wrapper, &CreateIn);
+  std::vector<std::pair<int, std::string>> keydata = {{1, "error:one"},
+                                                      {2, "ok:two"}};
+  google::crypto::tink::Keyset keyset = CreateKeyset(keydata);
+  keyset.set_primary_key_id(1);
+
+  util::StatusOr<std::unique_ptr<OutputPrimitive>> wrapped =
+      wrapper_or->Wrap(keyset);
+
+  ASSERT_THAT(wrapped.status(), Not(IsOk()));
+  ASSERT_THAT(wrapped.status().error_message(), HasSubstr("error:one"));
+}
+
 }  // namespace
 
 }  // namespace tink
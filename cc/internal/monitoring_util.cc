@@ -0,0 +1,66 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/internal/monitoring_util.h"
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "tink/monitoring.h"
+
+namespace crypto {
+namespace tink {
+namespace internal {
+
+MonitoringRecorder::MonitoringRecorder(std::shared_ptr<MonitoringClient> client,
+                                       absl::string_view primitive,
+                                       std::vector<uint32_t> key_ids)
+    : client_(std::move(client)),
+      counters_(std::make_shared<MonitoringKeysetCounters>(
+          primitive, std::move(key_ids))),
+      sampling_period_(client_->sampling_period()) {
+  client_->AddKeysetCounters(counters_);
+}
+
+// static
+bool MonitoringRecorder::ShouldSample(int sampling_period) {
+  // Counts down on every thread, so that sampling needs no atomics.
+  thread_local int countdown = 0;
+  if (--countdown > 0) return false;
+  countdown = sampling_period;
+  return true;
+}
+
+void MonitoringRecorder::Sample(int64_t start, MonitoringOperation operation,
+                                uint32_t key_id, int64_t num_bytes,
+                                bool ok) const {
+  MonitoringSample sample;
+  sample.primitive = counters_->primitive();
+  sample.operation = operation;
+  sample.key_id = key_id;
+  sample.num_bytes = num_bytes;
+  sample.latency = absl::Nanoseconds(absl::GetCurrentTimeNanos() - start);
+  sample.ok = ok;
+  client_->RecordSample(sample);
+}
+
+}  // namespace internal
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,115 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_INTERNAL_MONITORING_UTIL_H_
+#define TINK_INTERNAL_MONITORING_UTIL_H_
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "tink/monitoring.h"
+#include "tink/primitive_set.h"
+
+namespace crypto {
+namespace tink {
+namespace internal {
+
+// Reports the operations of a wrapped primitive to the MonitoringClient which
+// was installed when the primitive set was wrapped. Without a client, all
+// methods return right away.
+//
+// A wrapper calls Start() before an operation, and passes its result to one of
+// the Record* methods afterwards:
+//
+//   int64_t start = monitoring_.Start();
+//   ... encrypt with 'entry' ...
+//   monitoring_.RecordSuccess(start, MonitoringOperation::kEncrypt,
+//                             entry->get_key_id(), plaintext.size());
+class MonitoringRecorder {
+ public:
+  // Returns a recorder for the wrapper of 'primitive_set', of the kind
+  // 'primitive', such as "aead".
+  template <class P>
+  static MonitoringRecorder ForPrimitiveSet(
+      const PrimitiveSet<P>& primitive_set, absl::string_view primitive) {
+    std::shared_ptr<MonitoringClient> client = Monitoring::GetClient();
+    if (client == nullptr) return MonitoringRecorder();
+    std::vector<uint32_t> key_ids;
+    for (const auto* entry : primitive_set.get_all()) {
+      key_ids.push_back(entry->get_key_id());
+    }
+    return MonitoringRecorder(std::move(client), primitive, std::move(key_ids));
+  }
+
+  MonitoringRecorder() = default;
+  MonitoringRecorder(MonitoringRecorder&&) = default;
+  MonitoringRecorder& operator=(MonitoringRecorder&&) = default;
+
+  // Returns the start time in nanoseconds if the operation is sampled,
+  // and 0 otherwise.
+  int64_t Start() const {
+    if (sampling_period_ <= 0 || !ShouldSample(sampling_period_)) return 0;
+    return absl::GetCurrentTimeNanos();
+  }
+
+  // Records an operation which succeeded with the key 'key_id'.
+  void RecordSuccess(int64_t start, MonitoringOperation operation,
+                     uint32_t key_id, int64_t num_bytes) const {
+    if (counters_ == nullptr) return;
+    int key_index = counters_->KeyIndex(key_id);
+    if (key_index >= 0) counters_->Add(key_index, num_bytes);
+    if (start != 0) Sample(start, operation, key_id, num_bytes, /*ok=*/true);
+  }
+
+  // Records an operation which failed.
+  void RecordFailure(int64_t start, MonitoringOperation operation,
+                     int64_t num_bytes) const {
+    if (counters_ == nullptr) return;
+    counters_->AddFailure();
+    if (start != 0) Sample(start, operation, 0, num_bytes, /*ok=*/false);
+  }
+
+  // Records that an operation tried the keys with output prefix type RAW.
+  void RecordRawFallback() const {
+    if (counters_ != nullptr) counters_->AddRawFallback();
+  }
+
+ private:
+  MonitoringRecorder(std::shared_ptr<MonitoringClient> client,
+                     absl::string_view primitive,
+                     std::vector<uint32_t> key_ids);
+
+  // Returns true for one in 'sampling_period' calls on a thread.
+  static bool ShouldSample(int sampling_period);
+
+  void Sample(int64_t start, MonitoringOperation operation, uint32_t key_id,
+              int64_t num_bytes, bool ok) const;
+
+  std::shared_ptr<MonitoringClient> client_;
+  std::shared_ptr<MonitoringKeysetCounters> counters_;
+  int sampling_period_ = 0;
+};
+
+}  // namespace internal
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_INTERNAL_MONITORING_UTIL_H_
@@ -0,0 +1,174 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/internal/numa.h"
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "absl/strings/ascii.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace crypto {
+namespace tink {
+namespace internal {
+
+namespace {
+
+// Number of CurrentNode() calls after which a thread looks up its CPU again.
+constexpr int kNodeRecheckPeriod = 256;
+
+// Returns the first line of the file at 'path', or an empty string.
+std::string ReadLine(const std::string& path) {
+  std::ifstream file(path);
+  std::string line;
+  std::getline(file, line);
+  return line;
+}
+
+#ifdef __linux__
+std::vector<std::vector<int>> ReadNodeCpus() {
+  const std::string kNodeDir = "/sys/devices/system/node/";
+  std::vector<std::vector<int>> node_cpus;
+  for (int node : NumaTopology::ParseCpuList(ReadLine(kNodeDir + "online"))) {
+    std::vector<int> cpus = NumaTopology::ParseCpuList(
+        ReadLine(absl::StrCat(kNodeDir, "node", node, "/cpulist")));
+    // Nodes which only have memory get no replica.
+    if (!cpus.empty()) node_cpus.push_back(std::move(cpus));
+  }
+  return node_cpus;
+}
+#else
+std::vector<std::vector<int>> ReadNodeCpus() { return {}; }
+#endif
+
+}  // namespace
+
+NumaTopology::NumaTopology(std::vector<std::vector<int>> node_cpus)
+    : node_cpus_(std::move(node_cpus)) {
+  if (node_cpus_.empty()) {
+    node_cpus_.emplace_back();
+    unsigned int num_cpus = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned int cpu = 0; cpu < num_cpus; cpu++) {
+      node_cpus_[0].push_back(cpu);
+    }
+  }
+  for (int node = 0; node < num_nodes(); node++) {
+    for (int cpu : node_cpus_[node]) {
+      if (cpu >= static_cast<int>(cpu_nodes_.size())) {
+        cpu_nodes_.resize(cpu + 1, -1);
+      }
+      cpu_nodes_[cpu] = node;
+    }
+  }
+}
+
+// static
+const NumaTopology& NumaTopology::Get() {
+  static const NumaTopology* topology = new NumaTopology(ReadNodeCpus());
+  return *topology;
+}
+
+// static
+NumaTopology NumaTopology::FromCpuLists(
+    std::vector<std::vector<int>> node_cpus) {
+  return NumaTopology(std::move(node_cpus));
+}
+
+// static
+std::vector<int> NumaTopology::ParseCpuList(absl::string_view cpu_list) {
+  std::vector<int> cpus;
+  cpu_list = absl::StripAsciiWhitespace(cpu_list);
+  if (cpu_list.empty()) return cpus;
+  for (absl::string_view range : absl::StrSplit(cpu_list, ',')) {
+    std::pair<absl::string_view, absl::string_view> bounds =
+        absl::StrSplit(range, absl::MaxSplits('-', 1));
+    int first, last;
+    if (!absl::SimpleAtoi(bounds.first, &first)) return {};
+    if (bounds.second.empty()) {
+      last = first;
+    } else if (!absl::SimpleAtoi(bounds.second, &last)) {
+      return {};
+    }
+    if (first < 0 || last < first) return {};
+    for (int cpu = first; cpu <= last; cpu++) cpus.push_back(cpu);
+  }
+  return cpus;
+}
+
+int NumaTopology::NodeOfCpu(int cpu) const {
+  if (cpu < 0 || cpu >= static_cast<int>(cpu_nodes_.size())) return 0;
+  return std::max(0, cpu_nodes_[cpu]);
+}
+
+int NumaTopology::CurrentNode() const {
+  if (num_nodes() == 1) return 0;
+#ifdef __linux__
+  struct Cache {
+    const NumaTopology* topology = nullptr;
+    int node = 0;
+    int countdown = 0;
+  };
+  thread_local Cache cache;
+  if (cache.topology != this || --cache.countdown <= 0) {
+    cache.topology = this;
+    cache.node = NodeOfCpu(sched_getcpu());
+    cache.countdown = kNodeRecheckPeriod;
+  }
+  return cache.node;
+#else
+  return 0;
+#endif
+}
+
+void NumaTopology::RunOnNode(int node,
+                             const std::function<void()>& function) const {
+#ifdef __linux__
+  if (num_nodes() > 1) {
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (int cpu : cpus(node)) {
+      if (cpu < CPU_SETSIZE) CPU_SET(cpu, &cpu_set);
+    }
+    std::thread thread([&cpu_set, &function]() {
+      // If the CPUs are outside of the affinity mask of the process, the
+      // function still runs, just without locality.
+      pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+      function();
+    });
+    thread.join();
+    return;
+  }
+#endif
+  function();
+}
+
+}  // namespace internal
+}  // namespace tink
+}  // namespace crypto
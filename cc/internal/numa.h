@@ -0,0 +1,74 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_INTERNAL_NUMA_H_
+#define TINK_INTERNAL_NUMA_H_
+
+#include <functional>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+
+namespace crypto {
+namespace tink {
+namespace internal {
+
+// The NUMA nodes of the host and their CPUs. On Linux, read from
+// /sys/devices/system/node; elsewhere, or if sysfs cannot be read, the host
+// is treated as one node.
+class NumaTopology {
+ public:
+  // Returns the topology of the host, read once.
+  static const NumaTopology& Get();
+
+  // Returns a topology with one node per entry of 'node_cpus', which lists
+  // the CPUs of the node.
+  static NumaTopology FromCpuLists(std::vector<std::vector<int>> node_cpus);
+
+  // Parses a sysfs CPU list such as "0-3,8,10-11". Returns an empty list if
+  // 'cpu_list' is malformed.
+  static std::vector<int> ParseCpuList(absl::string_view cpu_list);
+
+  int num_nodes() const { return node_cpus_.size(); }
+
+  const std::vector<int>& cpus(int node) const { return node_cpus_[node]; }
+
+  // Returns the node of the CPU which the calling thread runs on. The result
+  // is cached per thread, and looked up again every few hundred calls, in
+  // case the thread migrated.
+  int CurrentNode() const;
+
+  // Runs 'function' on a thread bound to the CPUs of 'node', and waits for
+  // it. Memory first written by 'function' is thereby allocated on 'node'
+  // under the default first-touch policy. Runs 'function' on the calling
+  // thread if the thread cannot be bound.
+  void RunOnNode(int node, const std::function<void()>& function) const;
+
+ private:
+  explicit NumaTopology(std::vector<std::vector<int>> node_cpus);
+
+  int NodeOfCpu(int cpu) const;
+
+  std::vector<std::vector<int>> node_cpus_;
+  // The node of every CPU, or -1 for CPUs of no node.
+  std::vector<int> cpu_nodes_;
+};
+
+}  // namespace internal
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_INTERNAL_NUMA_H_
@@ -0,0 +1,81 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/internal/numa.h"
+
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace crypto {
+namespace tink {
+namespace internal {
+namespace {
+
+using ::testing::ElementsAre;
+using ::testing::Eq;
+using ::testing::Ge;
+using ::testing::IsEmpty;
+using ::testing::Lt;
+
+TEST(NumaTopologyTest, ParseCpuList) {
+  EXPECT_THAT(NumaTopology::ParseCpuList("0-3,8,10-11\n"),
+              ElementsAre(0, 1, 2, 3, 8, 10, 11));
+  EXPECT_THAT(NumaTopology::ParseCpuList("5"), ElementsAre(5));
+  EXPECT_THAT(NumaTopology::ParseCpuList(""), IsEmpty());
+  EXPECT_THAT(NumaTopology::ParseCpuList("3-1"), IsEmpty());
+  EXPECT_THAT(NumaTopology::ParseCpuList("1,x"), IsEmpty());
+}
+
+TEST(NumaTopologyTest, FromCpuLists) {
+  NumaTopology topology = NumaTopology::FromCpuLists({{0, 1}, {2, 3}});
+  EXPECT_THAT(topology.num_nodes(), Eq(2));
+  EXPECT_THAT(topology.cpus(1), ElementsAre(2, 3));
+}
+
+TEST(NumaTopologyTest, EmptyTopologyHasOneNode) {
+  NumaTopology topology = NumaTopology::FromCpuLists({});
+  EXPECT_THAT(topology.num_nodes(), Eq(1));
+  EXPECT_THAT(topology.CurrentNode(), Eq(0));
+}
+
+TEST(NumaTopologyTest, HostTopology) {
+  const NumaTopology& topology = NumaTopology::Get();
+  ASSERT_THAT(topology.num_nodes(), Ge(1));
+  EXPECT_THAT(topology.CurrentNode(), Ge(0));
+  EXPECT_THAT(topology.CurrentNode(), Lt(topology.num_nodes()));
+}
+
+TEST(NumaTopologyTest, RunOnNode) {
+  // Both nodes use CPU 0, which every host has.
+  NumaTopology topology = NumaTopology::FromCpuLists({{0}, {0}});
+  for (int node = 0; node < topology.num_nodes(); node++) {
+    std::thread::id caller = std::this_thread::get_id();
+    bool ran = false;
+    topology.RunOnNode(node, [&]() {
+      ran = true;
+      EXPECT_NE(std::this_thread::get_id(), caller);
+    });
+    EXPECT_TRUE(ran);
+  }
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,78 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_INTERNAL_RAW_KEY_HINT_H_
+#define TINK_INTERNAL_RAW_KEY_HINT_H_
+
+#include <atomic>
+
+#include "tink/key_usage.h"
+#include "tink/primitive_set.h"
+
+namespace crypto {
+namespace tink {
+namespace internal {
+
+// Tries the RAW entries of a PrimitiveSet for a ciphertext, and counts the
+// decryption on the entry which succeeds. If adaptive, see KeyTrialOrder, it
+// remembers that entry and tries it first next time. Thread safe; a wrapper
+// holds one for the RAW entries of its set.
+template <class P>
+class RawKeyHint {
+ public:
+  using Entry = typename PrimitiveSet<P>::template Entry<P>;
+
+  explicit RawKeyHint(bool adaptive = KeyTrialOrder::IsAdaptive())
+      : adaptive_(adaptive) {}
+
+  // Calls 'try_entry', which returns whether the entry passed to it decrypted
+  // the ciphertext, for the entries in 'raw_entries' until it returns true.
+  // Returns that entry, or nullptr if none decrypted the ciphertext.
+  // 'raw_entries' must be the RAW entries of the same set on every call.
+  template <class TryEntry>
+  const Entry* Try(const typename PrimitiveSet<P>::Primitives& raw_entries,
+                   TryEntry try_entry) const {
+    const Entry* hinted =
+        adaptive_ ? last_success_.load(std::memory_order_relaxed) : nullptr;
+    if (hinted != nullptr && try_entry(*hinted)) return Succeeded(hinted);
+    for (const auto& entry : raw_entries) {
+      if (entry.get() != hinted && try_entry(*entry)) {
+        return Succeeded(entry.get());
+      }
+    }
+    return nullptr;
+  }
+
+ private:
+  const Entry* Succeeded(const Entry* entry) const {
+    entry->RecordDecryption();
+    // Only written when the key changes, so that concurrent decryptions with
+    // the same key do not contend on the cache line.
+    if (adaptive_ && last_success_.load(std::memory_order_relaxed) != entry) {
+      last_success_.store(entry, std::memory_order_relaxed);
+    }
+    return entry;
+  }
+
+  const bool adaptive_;
+  mutable std::atomic<const Entry*> last_success_{nullptr};
+};
+
+}  // namespace internal
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_INTERNAL_RAW_KEY_HINT_H_
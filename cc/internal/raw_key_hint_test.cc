@@ -0,0 +1,157 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/internal/raw_key_hint.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "tink/key_usage.h"
+#include "tink/primitive_set.h"
+#include "tink/util/test_matchers.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace internal {
+namespace {
+
+using ::crypto::tink::test::IsOk;
+using ::google::crypto::tink::KeysetInfo;
+using ::google::crypto::tink::KeyStatusType;
+using ::google::crypto::tink::OutputPrefixType;
+using ::testing::ElementsAre;
+using ::testing::Eq;
+using ::testing::IsNull;
+using ::testing::UnorderedElementsAre;
+
+// Decrypts the ciphertexts which are equal to its key ID.
+struct FakePrimitive {
+  std::string key_id;
+};
+
+using FakeEntry = PrimitiveSet<FakePrimitive>::Entry<FakePrimitive>;
+
+KeysetInfo::KeyInfo RawKeyInfo(uint32_t key_id) {
+  KeysetInfo::KeyInfo key_info;
+  key_info.set_key_id(key_id);
+  key_info.set_status(KeyStatusType::ENABLED);
+  key_info.set_output_prefix_type(OutputPrefixType::RAW);
+  return key_info;
+}
+
+// Returns a set with RAW keys 1, 2 and 3, where 3 is the primary.
+std::unique_ptr<PrimitiveSet<FakePrimitive>> NewSet() {
+  PrimitiveSet<FakePrimitive>::Builder builder;
+  for (uint32_t key_id : {1, 2}) {
+    builder.AddPrimitive(absl::make_unique<FakePrimitive>(
+                             FakePrimitive{std::to_string(key_id)}),
+                         RawKeyInfo(key_id));
+  }
+  builder.AddPrimaryPrimitive(
+      absl::make_unique<FakePrimitive>(FakePrimitive{"3"}), RawKeyInfo(3));
+  auto set_result = builder.Build();
+  EXPECT_THAT(set_result.status(), IsOk());
+  return std::move(set_result.ValueOrDie());
+}
+
+// Decrypts 'ciphertext' with 'hint', and returns the key IDs tried.
+std::vector<uint32_t> Decrypt(const RawKeyHint<FakePrimitive>& hint,
+                              const PrimitiveSet<FakePrimitive>& set,
+                              const std::string& ciphertext) {
+  std::vector<uint32_t> tried;
+  hint.Try(*set.get_raw_primitives().ValueOrDie(),
+           [&](const FakeEntry& entry) -> bool {
+             tried.push_back(entry.get_key_id());
+             return entry.get_primitive().key_id == ciphertext;
+           });
+  return tried;
+}
+
+TEST(RawKeyHintTest, TriesKeysetOrderIfNotAdaptive) {
+  auto set = NewSet();
+  RawKeyHint<FakePrimitive> hint(/*adaptive=*/false);
+  EXPECT_THAT(Decrypt(hint, *set, "2"), ElementsAre(1, 2));
+  EXPECT_THAT(Decrypt(hint, *set, "2"), ElementsAre(1, 2));
+  EXPECT_THAT(Decrypt(hint, *set, "4"), ElementsAre(1, 2, 3));
+}
+
+TEST(RawKeyHintTest, TriesLastSuccessfulKeyFirstIfAdaptive) {
+  auto set = NewSet();
+  RawKeyHint<FakePrimitive> hint(/*adaptive=*/true);
+  EXPECT_THAT(Decrypt(hint, *set, "2"), ElementsAre(1, 2));
+  EXPECT_THAT(Decrypt(hint, *set, "2"), ElementsAre(2));
+  EXPECT_THAT(Decrypt(hint, *set, "3"), ElementsAre(2, 1, 3));
+  EXPECT_THAT(Decrypt(hint, *set, "3"), ElementsAre(3));
+  // A failure keeps the hint.
+  EXPECT_THAT(Decrypt(hint, *set, "4"), ElementsAre(3, 1, 2));
+  EXPECT_THAT(Decrypt(hint, *set, "1"), ElementsAre(3, 1));
+}
+
+TEST(RawKeyHintTest, ReturnsTheSuccessfulEntry) {
+  auto set = NewSet();
+  RawKeyHint<FakePrimitive> hint(/*adaptive=*/true);
+  auto accept_key_2 = [](const FakeEntry& entry) {
+    return entry.get_key_id() == 2;
+  };
+  const FakeEntry* entry =
+      hint.Try(*set->get_raw_primitives().ValueOrDie(), accept_key_2);
+  ASSERT_NE(entry, nullptr);
+  EXPECT_THAT(entry->get_key_id(), Eq(2));
+  EXPECT_THAT(hint.Try(*set->get_raw_primitives().ValueOrDie(),
+                       [](const FakeEntry&) { return false; }),
+              IsNull());
+}
+
+MATCHER_P2(IsKeyUsage, key_id, decryptions, "") {
+  return arg.key_id == key_id && arg.decryptions == decryptions;
+}
+
+TEST(RawKeyHintTest, CountsDecryptions) {
+  auto set = NewSet();
+  RawKeyHint<FakePrimitive> hint(/*adaptive=*/true);
+  Decrypt(hint, *set, "1");
+  Decrypt(hint, *set, "3");
+  Decrypt(hint, *set, "3");
+  Decrypt(hint, *set, "4");
+  EXPECT_THAT(set->GetKeyUsage(),
+              UnorderedElementsAre(IsKeyUsage(1, 1), IsKeyUsage(2, 0),
+                                   IsKeyUsage(3, 2)));
+  for (const KeyUsage& usage : set->GetKeyUsage()) {
+    EXPECT_THAT(usage.is_primary, Eq(usage.key_id == 3));
+  }
+}
+
+TEST(RawKeyHintTest, DefaultsToKeyTrialOrder) {
+  auto set = NewSet();
+  KeyTrialOrder::SetAdaptive(true);
+  RawKeyHint<FakePrimitive> adaptive_hint;
+  KeyTrialOrder::SetAdaptive(false);
+  RawKeyHint<FakePrimitive> hint;
+  Decrypt(adaptive_hint, *set, "2");
+  Decrypt(hint, *set, "2");
+  EXPECT_THAT(Decrypt(adaptive_hint, *set, "2"), ElementsAre(2));
+  EXPECT_THAT(Decrypt(hint, *set, "2"), ElementsAre(1, 2));
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace tink
+}  // namespace crypto
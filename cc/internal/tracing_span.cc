@@ -0,0 +1,47 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/internal/tracing_span.h"
+
+#include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "tink/tracing.h"
+
+namespace crypto {
+namespace tink {
+namespace internal {
+
+#ifdef TINK_ENABLE_TRACING
+
+TracingSpan::TracingSpan(absl::string_view name)
+    : client_(Tracing::GetClient()) {
+  if (client_ == nullptr) return;
+  span_ = client_->StartSpan(name);
+  start_ = absl::Now();
+}
+
+TracingSpan::~TracingSpan() {
+  if (client_ == nullptr) return;
+  data_.duration = absl::Now() - start_;
+  client_->EndSpan(span_, data_);
+}
+
+#endif  // TINK_ENABLE_TRACING
+
+}  // namespace internal
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,84 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_INTERNAL_TRACING_SPAN_H_
+#define TINK_INTERNAL_TRACING_SPAN_H_
+
+#include <cstdint>
+#include <memory>
+
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "tink/tracing.h"
+
+namespace crypto {
+namespace tink {
+namespace internal {
+
+#ifdef TINK_ENABLE_TRACING
+
+// Reports a span from its construction to its destruction to the
+// TracingClient which was installed when it was constructed. Without a
+// client, the methods only update a few fields.
+//
+//   internal::TracingSpan span("tink.keyset_handle.read");
+//   span.AddBytes(encrypted_keyset.size());
+//   ... decrypt ...
+//   if (!status.ok()) span.SetOk(false);
+//
+// Unless Tink is built with TINK_ENABLE_TRACING, the methods are empty and a
+// span compiles to nothing.
+class TracingSpan {
+ public:
+  explicit TracingSpan(absl::string_view name);
+
+  TracingSpan(const TracingSpan&) = delete;
+  TracingSpan& operator=(const TracingSpan&) = delete;
+
+  ~TracingSpan();
+
+  void AddBytes(int64_t num_bytes) { data_.num_bytes += num_bytes; }
+  void AddKeyTrial() { data_.key_trials++; }
+  void SetOk(bool ok) { data_.ok = ok; }
+
+ private:
+  std::shared_ptr<TracingClient> client_;
+  void* span_ = nullptr;
+  absl::Time start_;
+  TracingSpanData data_;
+};
+
+#else  // TINK_ENABLE_TRACING
+
+class TracingSpan {
+ public:
+  explicit TracingSpan(absl::string_view name) {}
+
+  TracingSpan(const TracingSpan&) = delete;
+  TracingSpan& operator=(const TracingSpan&) = delete;
+
+  void AddBytes(int64_t num_bytes) {}
+  void AddKeyTrial() {}
+  void SetOk(bool ok) {}
+};
+
+#endif  // TINK_ENABLE_TRACING
+
+}  // namespace internal
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_INTERNAL_TRACING_SPAN_H_
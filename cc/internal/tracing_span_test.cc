@@ -0,0 +1,124 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/internal/tracing_span.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "tink/tracing.h"
+
+namespace crypto {
+namespace tink {
+namespace internal {
+namespace {
+
+using ::testing::Eq;
+using ::testing::IsEmpty;
+using ::testing::SizeIs;
+
+struct FinishedSpan {
+  std::string name;
+  TracingSpanData data;
+};
+
+// Records the finished spans. A span is its name.
+class FakeTracingClient : public TracingClient {
+ public:
+  void* StartSpan(absl::string_view name) override {
+    return new std::string(name);
+  }
+
+  void EndSpan(void* span, const TracingSpanData& data) override {
+    std::unique_ptr<std::string> name(static_cast<std::string*>(span));
+    absl::MutexLock lock(&mutex_);
+    finished_.push_back({*name, data});
+  }
+
+  std::vector<FinishedSpan> finished() {
+    absl::MutexLock lock(&mutex_);
+    return finished_;
+  }
+
+ private:
+  absl::Mutex mutex_;
+  std::vector<FinishedSpan> finished_;
+};
+
+class TracingSpanTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    client_ = std::make_shared<FakeTracingClient>();
+    Tracing::SetClient(client_);
+  }
+  void TearDown() override { Tracing::SetClient(nullptr); }
+
+  std::shared_ptr<FakeTracingClient> client_;
+};
+
+TEST_F(TracingSpanTest, ReportsSpans) {
+  {
+    TracingSpan outer("outer");
+    outer.AddBytes(10);
+    outer.AddBytes(5);
+    {
+      TracingSpan inner("inner");
+      inner.AddKeyTrial();
+      inner.AddKeyTrial();
+      inner.SetOk(false);
+    }
+  }
+  std::vector<FinishedSpan> finished = client_->finished();
+  if (!Tracing::IsCompiledIn()) {
+    EXPECT_THAT(finished, IsEmpty());
+    return;
+  }
+  ASSERT_THAT(finished, SizeIs(2));
+  EXPECT_THAT(finished[0].name, Eq("inner"));
+  EXPECT_THAT(finished[0].data.num_bytes, Eq(0));
+  EXPECT_THAT(finished[0].data.key_trials, Eq(2));
+  EXPECT_FALSE(finished[0].data.ok);
+  EXPECT_THAT(finished[1].name, Eq("outer"));
+  EXPECT_THAT(finished[1].data.num_bytes, Eq(15));
+  EXPECT_THAT(finished[1].data.key_trials, Eq(0));
+  EXPECT_TRUE(finished[1].data.ok);
+  EXPECT_GE(finished[1].data.duration, finished[0].data.duration);
+}
+
+TEST_F(TracingSpanTest, SpansWithoutClient) {
+  Tracing::SetClient(nullptr);
+  EXPECT_THAT(Tracing::GetClient(), Eq(nullptr));
+  { TracingSpan span("span"); }
+  // A span reports to the client installed when it started.
+  Tracing::SetClient(client_);
+  EXPECT_THAT(Tracing::GetClient(), Eq(client_));
+  {
+    TracingSpan span("span");
+    Tracing::SetClient(nullptr);
+  }
+  EXPECT_THAT(client_->finished(), SizeIs(Tracing::IsCompiledIn() ? 1 : 0));
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace tink
+}  // namespace crypto
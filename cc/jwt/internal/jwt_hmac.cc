@@ -0,0 +1,169 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/jwt/internal/jwt_hmac.h"
+
+#include <memory>
+#include <string>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "include/rapidjson/document.h"
+#include "include/rapidjson/stringbuffer.h"
+#include "include/rapidjson/writer.h"
+#include "tink/jwt/internal/parsed_jwt.h"
+#include "tink/jwt/internal/raw_jwt_hmac_key_manager.h"
+#include "tink/jwt/jwt_names.h"
+#include "tink/mac.h"
+#include "tink/util/base64.h"
+#include "tink/util/enums.h"
+#include "tink/util/errors.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "proto/common.pb.h"
+#include "proto/jwt_hmac.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace internal {
+
+using ::google::crypto::tink::HashType;
+using ::google::crypto::tink::JwtHmacKey;
+
+namespace {
+
+util::StatusOr<absl::string_view> AlgorithmForHash(HashType hash_type) {
+  switch (hash_type) {
+    case HashType::SHA256:
+      return kJwtAlgorithmHs256;
+    case HashType::SHA384:
+      return kJwtAlgorithmHs384;
+    case HashType::SHA512:
+      return kJwtAlgorithmHs512;
+    default:
+      return ToStatusF(util::error::INVALID_ARGUMENT,
+                       "HashType '%s' is not supported.",
+                       util::Enums::HashName(hash_type));
+  }
+}
+
+std::string Base64UrlEncode(absl::string_view data) {
+  // Encodes without padding.
+  return util::Base64Encode(data, util::Base64Alphabet::kUrl,
+                            /* padding = */ false);
+}
+
+util::Status Base64UrlDecode(absl::string_view encoded, std::string* data) {
+  if (encoded.find('=') != absl::string_view::npos ||
+      !util::Base64Decode(encoded, util::Base64Alphabet::kUrl, data)) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "invalid base64url encoding");
+  }
+  return util::OkStatus();
+}
+
+}  // namespace
+
+// static
+util::StatusOr<std::unique_ptr<JwtHmac>> JwtHmac::New(const JwtHmacKey& key) {
+  RawJwtHmacKeyManager key_manager;
+  util::Status status = key_manager.ValidateKey(key);
+  if (!status.ok()) return status;
+  auto algorithm_or = AlgorithmForHash(key.hash_type());
+  if (!algorithm_or.ok()) return algorithm_or.status();
+  auto mac_or = key_manager.GetPrimitive<Mac>(key);
+  if (!mac_or.ok()) return mac_or.status();
+  return {absl::WrapUnique(new JwtHmac(std::move(mac_or.ValueOrDie()),
+                                       algorithm_or.ValueOrDie()))};
+}
+
+util::StatusOr<std::string> JwtHmac::ComputeMacAndEncode(
+    absl::string_view payload, absl::string_view key_id) const {
+  rapidjson::Document payload_document;
+  payload_document.Parse(payload.data(), payload.size());
+  if (payload_document.HasParseError() || !payload_document.IsObject()) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "payload is not a JSON object");
+  }
+
+  rapidjson::StringBuffer header;
+  rapidjson::Writer<rapidjson::StringBuffer> writer(header);
+  writer.StartObject();
+  writer.Key(kJwtHeaderAlgorithm.data(), kJwtHeaderAlgorithm.size());
+  writer.String(algorithm_.data(), algorithm_.size());
+  if (!key_id.empty()) {
+    writer.Key(kJwtHeaderKeyId.data(), kJwtHeaderKeyId.size());
+    writer.String(key_id.data(), key_id.size());
+  }
+  writer.EndObject();
+
+  std::string signed_data = absl::StrCat(
+      Base64UrlEncode(absl::string_view(header.GetString(), header.GetSize())),
+      ".", Base64UrlEncode(payload));
+  util::Status status = ComputeMacAndAppend(&signed_data);
+  if (!status.ok()) return status;
+  return signed_data;
+}
+
+util::Status JwtHmac::ComputeMacAndAppend(std::string* signing_input) const {
+  auto tag_or = mac_->ComputeMac(*signing_input);
+  if (!tag_or.ok()) return tag_or.status();
+  absl::StrAppend(signing_input, ".", Base64UrlEncode(tag_or.ValueOrDie()));
+  return util::OkStatus();
+}
+
+util::StatusOr<std::unique_ptr<ParsedJwt>> JwtHmac::VerifyMacAndDecode(
+    absl::string_view compact, const JwtValidationOptions& options,
+    absl::Time now) const {
+  size_t header_end = compact.find('.');
+  size_t payload_end = header_end == absl::string_view::npos
+                           ? absl::string_view::npos
+                           : compact.find('.', header_end + 1);
+  if (payload_end == absl::string_view::npos ||
+      compact.find('.', payload_end + 1) != absl::string_view::npos) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "JWT must have three segments");
+  }
+
+  std::string tag;
+  util::Status status = Base64UrlDecode(compact.substr(payload_end + 1), &tag);
+  if (!status.ok()) return status;
+  // The MAC covers the encoded header and payload as received.
+  status = mac_->VerifyMac(tag, compact.substr(0, payload_end));
+  if (!status.ok()) return status;
+
+  auto jwt_or = ParsedJwt::Parse(
+      compact.substr(0, header_end),
+      compact.substr(header_end + 1, payload_end - header_end - 1));
+  if (!jwt_or.ok()) return jwt_or.status();
+  const ParsedJwt& jwt = *jwt_or.ValueOrDie();
+  auto algorithm_or = jwt.GetAlgorithm();
+  if (!algorithm_or.ok()) return algorithm_or.status();
+  if (algorithm_or.ValueOrDie() != algorithm_) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        absl::StrCat("invalid 'alg' header; expected ",
+                                     algorithm_));
+  }
+  status = jwt.Validate(options, now);
+  if (!status.ok()) return status;
+  return std::move(jwt_or.ValueOrDie());
+}
+
+}  // namespace internal
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,93 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_JWT_INTERNAL_JWT_HMAC_H_
+#define TINK_JWT_INTERNAL_JWT_HMAC_H_
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "tink/jwt/internal/parsed_jwt.h"
+#include "tink/mac.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "proto/jwt_hmac.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace internal {
+
+///////////////////////////////////////////////////////////////////////////////
+// Computes and verifies JWTs in compact serialization with the MAC of a
+// JwtHmacKey, created by RawJwtHmacKeyManager.
+// https://tools.ietf.org/html/rfc7519
+//
+// Verification computes the MAC over the "header.payload" bytes of the token
+// as received, so the token is never re-serialized, and only decodes the
+// header and payload once the MAC is verified, into a ParsedJwt. The claims
+// are validated on the ParsedJwt without building a JSON object of them.
+//
+// Instances are thread-safe.
+class JwtHmac {
+ public:
+  static crypto::tink::util::StatusOr<std::unique_ptr<JwtHmac>> New(
+      const google::crypto::tink::JwtHmacKey& key);
+
+  // Returns the compact serialization of a JWT with the JSON object
+  // 'payload' as its claims. The header has the "alg" of the key, and
+  // 'key_id' as "kid" if it is not empty.
+  crypto::tink::util::StatusOr<std::string> ComputeMacAndEncode(
+      absl::string_view payload, absl::string_view key_id) const;
+
+  // Computes the MAC of 'signing_input', the encoded "header.payload" of a
+  // JWT whose header has the algorithm() of the key, and appends "." and the
+  // encoded MAC to it, which completes the compact serialization.
+  crypto::tink::util::Status ComputeMacAndAppend(
+      std::string* signing_input) const;
+
+  // Verifies the MAC and the "alg" header of the compact serialization
+  // 'compact', decodes it, and validates its claims against 'options' at time
+  // 'now'.
+  crypto::tink::util::StatusOr<std::unique_ptr<ParsedJwt>> VerifyMacAndDecode(
+      absl::string_view compact, const JwtValidationOptions& options,
+      absl::Time now) const;
+
+  // Like above, at the current time.
+  crypto::tink::util::StatusOr<std::unique_ptr<ParsedJwt>> VerifyMacAndDecode(
+      absl::string_view compact, const JwtValidationOptions& options) const {
+    return VerifyMacAndDecode(compact, options, absl::Now());
+  }
+
+  // Returns the "alg" header value of the key, such as "HS256".
+  absl::string_view algorithm() const { return algorithm_; }
+
+ private:
+  JwtHmac(std::unique_ptr<Mac> mac, absl::string_view algorithm)
+      : mac_(std::move(mac)), algorithm_(algorithm) {}
+
+  const std::unique_ptr<Mac> mac_;
+  const std::string algorithm_;
+};
+
+}  // namespace internal
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_JWT_INTERNAL_JWT_HMAC_H_
@@ -0,0 +1,132 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/jwt/internal/jwt_hmac_set.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "include/rapidjson/document.h"
+#include "tink/jwt/jwt_names.h"
+#include "tink/util/base64.h"
+#include "tink/util/errors.h"
+
+namespace crypto {
+namespace tink {
+namespace internal {
+
+namespace {
+
+// Returns the "kid" header of the compact serialization 'compact', or an
+// empty string if it has none. Only the header is decoded.
+util::StatusOr<std::string> GetKeyId(absl::string_view compact) {
+  size_t header_end = compact.find('.');
+  if (header_end == absl::string_view::npos) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "JWT must have three segments");
+  }
+  absl::string_view encoded_header = compact.substr(0, header_end);
+  std::string header;
+  if (encoded_header.find('=') != absl::string_view::npos ||
+      !util::Base64Decode(encoded_header, util::Base64Alphabet::kUrl,
+                          &header)) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "invalid base64url encoding");
+  }
+  rapidjson::Document document;
+  document.Parse(header.data(), header.size());
+  if (document.HasParseError() || !document.IsObject()) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "header is not a JSON object");
+  }
+  auto it = document.FindMember(rapidjson::Value(
+      rapidjson::StringRef(kJwtHeaderKeyId.data(), kJwtHeaderKeyId.size())));
+  if (it == document.MemberEnd()) return std::string();
+  if (!it->value.IsString()) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "header 'kid' is not a string");
+  }
+  return std::string(it->value.GetString(), it->value.GetStringLength());
+}
+
+}  // namespace
+
+// static
+util::StatusOr<std::unique_ptr<JwtHmacSet>> JwtHmacSet::New(
+    std::vector<std::pair<std::string, std::shared_ptr<const JwtHmac>>> keys,
+    Options options) {
+  absl::flat_hash_set<absl::string_view> key_ids;
+  for (const auto& key : keys) {
+    if (key.first.empty()) {
+      return util::Status(util::error::INVALID_ARGUMENT,
+                          "key IDs must be non-empty");
+    }
+    if (key.second == nullptr) {
+      return util::Status(util::error::INVALID_ARGUMENT,
+                          "keys must be non-null");
+    }
+    if (!key_ids.insert(key.first).second) {
+      return ToStatusF(util::error::INVALID_ARGUMENT, "duplicate key ID '%s'",
+                       key.first);
+    }
+  }
+  return {absl::WrapUnique(new JwtHmacSet(std::move(keys), options))};
+}
+
+JwtHmacSet::JwtHmacSet(
+    std::vector<std::pair<std::string, std::shared_ptr<const JwtHmac>>> keys,
+    Options options)
+    : keys_(std::move(keys)), options_(options) {
+  keys_by_id_.reserve(keys_.size());
+  for (const auto& key : keys_) {
+    keys_by_id_.emplace(key.first, key.second.get());
+  }
+}
+
+util::StatusOr<std::unique_ptr<ParsedJwt>> JwtHmacSet::VerifyMacAndDecode(
+    absl::string_view compact, const JwtValidationOptions& options,
+    absl::Time now) const {
+  auto key_id_or = GetKeyId(compact);
+  if (!key_id_or.ok()) return key_id_or.status();
+  const std::string& key_id = key_id_or.ValueOrDie();
+  auto it = keys_by_id_.find(key_id);
+  if (it != keys_by_id_.end()) {
+    return it->second->VerifyMacAndDecode(compact, options, now);
+  }
+  if (!options_.allow_trial_verification) {
+    if (key_id.empty()) {
+      return util::Status(util::error::INVALID_ARGUMENT,
+                          "JWT has no 'kid' header");
+    }
+    return ToStatusF(util::error::INVALID_ARGUMENT, "unknown key ID '%s'",
+                     key_id);
+  }
+  util::Status status(util::error::INVALID_ARGUMENT, "no keys to verify JWT");
+  for (const auto& key : keys_) {
+    auto jwt_or = key.second->VerifyMacAndDecode(compact, options, now);
+    if (jwt_or.ok()) return std::move(jwt_or.ValueOrDie());
+    status = jwt_or.status();
+  }
+  return status;
+}
+
+}  // namespace internal
+}  // namespace tink
+}  // namespace crypto
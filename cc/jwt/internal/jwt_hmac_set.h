@@ -0,0 +1,91 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_JWT_INTERNAL_JWT_HMAC_SET_H_
+#define TINK_JWT_INTERNAL_JWT_HMAC_SET_H_
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "tink/jwt/internal/jwt_hmac.h"
+#include "tink/jwt/internal/parsed_jwt.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace internal {
+
+///////////////////////////////////////////////////////////////////////////////
+// Verifies JWTs with one of a set of keys, such as the keys of all partners
+// trusted by a gateway, each identified by a key ID.
+//
+// The "kid" header of a token selects the key in a hash index built by New(),
+// so only one MAC is verified regardless of the number of keys. Tokens with
+// an unknown or no "kid" are rejected, unless
+// Options::allow_trial_verification is set, in which case they are verified
+// with each key in turn, until one of them succeeds.
+//
+// Instances are thread-safe.
+class JwtHmacSet {
+ public:
+  struct Options {
+    // Whether tokens without a "kid" header, or with one not in the set, are
+    // verified with every key of the set.
+    bool allow_trial_verification = false;
+  };
+
+  // Returns a set of the JwtHmac in 'keys', each with its key ID. The key IDs
+  // must be distinct and non-empty.
+  static crypto::tink::util::StatusOr<std::unique_ptr<JwtHmacSet>> New(
+      std::vector<std::pair<std::string, std::shared_ptr<const JwtHmac>>> keys,
+      Options options);
+
+  // Verifies the compact serialization 'compact' with the key of its "kid"
+  // header, like JwtHmac::VerifyMacAndDecode().
+  crypto::tink::util::StatusOr<std::unique_ptr<ParsedJwt>> VerifyMacAndDecode(
+      absl::string_view compact, const JwtValidationOptions& options,
+      absl::Time now) const;
+
+  // Like above, at the current time.
+  crypto::tink::util::StatusOr<std::unique_ptr<ParsedJwt>> VerifyMacAndDecode(
+      absl::string_view compact, const JwtValidationOptions& options) const {
+    return VerifyMacAndDecode(compact, options, absl::Now());
+  }
+
+ private:
+  JwtHmacSet(
+      std::vector<std::pair<std::string, std::shared_ptr<const JwtHmac>>> keys,
+      Options options);
+
+  const std::vector<std::pair<std::string, std::shared_ptr<const JwtHmac>>>
+      keys_;
+  const Options options_;
+  // The index of keys_ by key ID.
+  absl::flat_hash_map<absl::string_view, const JwtHmac*> keys_by_id_;
+};
+
+}  // namespace internal
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_JWT_INTERNAL_JWT_HMAC_SET_H_
@@ -0,0 +1,161 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/jwt/internal/jwt_hmac_set.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/escaping.h"
+#include "absl/strings/str_cat.h"
+#include "tink/jwt/internal/jwt_hmac.h"
+#include "tink/jwt/internal/parsed_jwt.h"
+#include "tink/subtle/random.h"
+#include "tink/util/status.h"
+#include "tink/util/test_matchers.h"
+#include "proto/common.pb.h"
+#include "proto/jwt_hmac.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace internal {
+namespace {
+
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::google::crypto::tink::HashType;
+using ::google::crypto::tink::JwtHmacKey;
+using ::testing::Eq;
+
+constexpr char kPayload[] = R"({"iss":"issuer"})";
+
+std::shared_ptr<const JwtHmac> NewJwtHmac() {
+  JwtHmacKey key;
+  key.set_version(0);
+  key.set_hash_type(HashType::SHA256);
+  key.set_key_value(subtle::Random::GetRandomBytes(32));
+  auto jwt_hmac_or = JwtHmac::New(key);
+  EXPECT_THAT(jwt_hmac_or.status(), IsOk());
+  return std::move(jwt_hmac_or.ValueOrDie());
+}
+
+class JwtHmacSetTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    for (int i = 0; i < 100; ++i) {
+      keys_.emplace_back(absl::StrCat("key-", i), NewJwtHmac());
+    }
+    options_.issuer = "issuer";
+    options_.allow_missing_expiration = true;
+  }
+
+  std::unique_ptr<JwtHmacSet> NewSet(bool allow_trial_verification) {
+    JwtHmacSet::Options options;
+    options.allow_trial_verification = allow_trial_verification;
+    auto set_or = JwtHmacSet::New(keys_, options);
+    EXPECT_THAT(set_or.status(), IsOk());
+    return std::move(set_or.ValueOrDie());
+  }
+
+  // Returns a token with the MAC of keys_[index] and 'key_id' as "kid".
+  std::string NewToken(int index, absl::string_view key_id) {
+    auto compact_or =
+        keys_[index].second->ComputeMacAndEncode(kPayload, key_id);
+    EXPECT_THAT(compact_or.status(), IsOk());
+    return compact_or.ValueOrDie();
+  }
+
+  std::vector<std::pair<std::string, std::shared_ptr<const JwtHmac>>> keys_;
+  JwtValidationOptions options_;
+};
+
+TEST_F(JwtHmacSetTest, SelectsTheKeyOfTheKeyId) {
+  auto set = NewSet(/* allow_trial_verification = */ false);
+  for (int index : {0, 42, 99}) {
+    auto jwt_or = set->VerifyMacAndDecode(
+        NewToken(index, keys_[index].first), options_);
+    ASSERT_THAT(jwt_or.status(), IsOk());
+    EXPECT_THAT(jwt_or.ValueOrDie()->GetKeyId().ValueOrDie(),
+                Eq(keys_[index].first));
+  }
+  // The MAC of another key than that of the key ID.
+  EXPECT_THAT(
+      set->VerifyMacAndDecode(NewToken(1, keys_[2].first), options_).status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST_F(JwtHmacSetTest, UnknownOrMissingKeyId) {
+  auto set = NewSet(/* allow_trial_verification = */ false);
+  EXPECT_THAT(
+      set->VerifyMacAndDecode(NewToken(3, "unknown"), options_).status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(set->VerifyMacAndDecode(NewToken(3, ""), options_).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST_F(JwtHmacSetTest, TrialVerification) {
+  auto set = NewSet(/* allow_trial_verification = */ true);
+  EXPECT_THAT(
+      set->VerifyMacAndDecode(NewToken(3, "unknown"), options_).status(),
+      IsOk());
+  EXPECT_THAT(set->VerifyMacAndDecode(NewToken(77, ""), options_).status(),
+              IsOk());
+  // A known key ID is not tried against the other keys.
+  EXPECT_THAT(
+      set->VerifyMacAndDecode(NewToken(1, keys_[2].first), options_).status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+  auto other_jwt_hmac = NewJwtHmac();
+  EXPECT_THAT(
+      set->VerifyMacAndDecode(
+             other_jwt_hmac->ComputeMacAndEncode(kPayload, "").ValueOrDie(),
+             options_)
+          .status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST_F(JwtHmacSetTest, MalformedTokens) {
+  auto set = NewSet(/* allow_trial_verification = */ true);
+  for (const std::string& compact :
+       {std::string("no-dots"), std::string("a.b.c"),
+        absl::StrCat(absl::WebSafeBase64Escape(R"({"kid":1})"), ".e30.c"),
+        absl::StrCat(absl::WebSafeBase64Escape("[]"), ".e30.c")}) {
+    SCOPED_TRACE(compact);
+    EXPECT_THAT(set->VerifyMacAndDecode(compact, options_).status(),
+                StatusIs(util::error::INVALID_ARGUMENT));
+  }
+}
+
+TEST_F(JwtHmacSetTest, InvalidKeys) {
+  keys_.emplace_back(keys_[0].first, NewJwtHmac());
+  EXPECT_THAT(JwtHmacSet::New(keys_, JwtHmacSet::Options()).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  keys_.back().first = "";
+  EXPECT_THAT(JwtHmacSet::New(keys_, JwtHmacSet::Options()).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  keys_.back().first = "key-new";
+  keys_.back().second = nullptr;
+  EXPECT_THAT(JwtHmacSet::New(keys_, JwtHmacSet::Options()).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace tink
+}  // namespace crypto
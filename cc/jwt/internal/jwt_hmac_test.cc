@@ -0,0 +1,198 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/jwt/internal/jwt_hmac.h"
+
+#include <memory>
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/escaping.h"
+#include "absl/time/time.h"
+#include "tink/jwt/internal/parsed_jwt.h"
+#include "tink/subtle/random.h"
+#include "tink/util/status.h"
+#include "tink/util/test_matchers.h"
+#include "proto/common.pb.h"
+#include "proto/jwt_hmac.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace internal {
+namespace {
+
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::google::crypto::tink::HashType;
+using ::google::crypto::tink::JwtHmacKey;
+using ::testing::Eq;
+using ::testing::Not;
+
+JwtHmacKey NewKey(HashType hash_type) {
+  JwtHmacKey key;
+  key.set_version(0);
+  key.set_hash_type(hash_type);
+  key.set_key_value(subtle::Random::GetRandomBytes(32));
+  return key;
+}
+
+std::unique_ptr<JwtHmac> NewJwtHmac(const JwtHmacKey& key) {
+  auto jwt_hmac_or = JwtHmac::New(key);
+  EXPECT_THAT(jwt_hmac_or.status(), IsOk());
+  return std::move(jwt_hmac_or.ValueOrDie());
+}
+
+TEST(JwtHmacTest, ComputeAndVerify) {
+  for (HashType hash_type :
+       {HashType::SHA256, HashType::SHA384, HashType::SHA512}) {
+    SCOPED_TRACE(hash_type);
+    auto jwt_hmac = NewJwtHmac(NewKey(hash_type));
+    auto compact_or = jwt_hmac->ComputeMacAndEncode(
+        R"({"iss":"issuer","exp":1300819380})", "key-1");
+    ASSERT_THAT(compact_or.status(), IsOk());
+    std::string compact = compact_or.ValueOrDie();
+
+    JwtValidationOptions options;
+    options.issuer = "issuer";
+    auto jwt_or = jwt_hmac->VerifyMacAndDecode(
+        compact, options, absl::FromUnixSeconds(1300819379));
+    ASSERT_THAT(jwt_or.status(), IsOk());
+    const ParsedJwt& jwt = *jwt_or.ValueOrDie();
+    EXPECT_THAT(jwt.GetAlgorithm().ValueOrDie(), Eq(jwt_hmac->algorithm()));
+    EXPECT_THAT(jwt.GetKeyId().ValueOrDie(), Eq("key-1"));
+    EXPECT_THAT(jwt.GetIssuer().ValueOrDie(), Eq("issuer"));
+
+    EXPECT_THAT(jwt_hmac
+                    ->VerifyMacAndDecode(compact, options,
+                                         absl::FromUnixSeconds(1300819380))
+                    .status(),
+                StatusIs(util::error::INVALID_ARGUMENT));
+  }
+}
+
+TEST(JwtHmacTest, Algorithms) {
+  EXPECT_THAT(NewJwtHmac(NewKey(HashType::SHA256))->algorithm(), Eq("HS256"));
+  EXPECT_THAT(NewJwtHmac(NewKey(HashType::SHA384))->algorithm(), Eq("HS384"));
+  EXPECT_THAT(NewJwtHmac(NewKey(HashType::SHA512))->algorithm(), Eq("HS512"));
+  EXPECT_THAT(JwtHmac::New(NewKey(HashType::SHA1)).status(), Not(IsOk()));
+  EXPECT_THAT(JwtHmac::New(JwtHmacKey()).status(), Not(IsOk()));
+}
+
+TEST(JwtHmacTest, NoKeyId) {
+  auto jwt_hmac = NewJwtHmac(NewKey(HashType::SHA256));
+  std::string compact =
+      jwt_hmac->ComputeMacAndEncode(R"({"exp":1300819380})", "").ValueOrDie();
+  auto jwt_or = jwt_hmac->VerifyMacAndDecode(compact, JwtValidationOptions(),
+                                             absl::FromUnixSeconds(0));
+  ASSERT_THAT(jwt_or.status(), IsOk());
+  EXPECT_THAT(jwt_or.ValueOrDie()->GetKeyId().status(),
+              StatusIs(util::error::NOT_FOUND));
+}
+
+TEST(JwtHmacTest, PayloadMustBeAnObject) {
+  auto jwt_hmac = NewJwtHmac(NewKey(HashType::SHA256));
+  EXPECT_THAT(jwt_hmac->ComputeMacAndEncode("[]", "").status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(jwt_hmac->ComputeMacAndEncode("{", "").status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(JwtHmacTest, ModifiedTokensAreRejected) {
+  auto jwt_hmac = NewJwtHmac(NewKey(HashType::SHA256));
+  std::string compact =
+      jwt_hmac->ComputeMacAndEncode(R"({"exp":1300819380})", "").ValueOrDie();
+  JwtValidationOptions options;
+  absl::Time now = absl::FromUnixSeconds(0);
+  ASSERT_THAT(jwt_hmac->VerifyMacAndDecode(compact, options, now).status(),
+              IsOk());
+
+  for (size_t i = 0; i < compact.size(); i++) {
+    std::string modified = compact;
+    modified[i] ^= 1;
+    EXPECT_THAT(jwt_hmac->VerifyMacAndDecode(modified, options, now).status(),
+                Not(IsOk()));
+  }
+  EXPECT_THAT(
+      jwt_hmac->VerifyMacAndDecode(compact + ".", options, now).status(),
+      Not(IsOk()));
+  EXPECT_THAT(
+      jwt_hmac->VerifyMacAndDecode(compact + "=", options, now).status(),
+      Not(IsOk()));
+  EXPECT_THAT(
+      jwt_hmac
+          ->VerifyMacAndDecode(compact.substr(0, compact.rfind('.')), options,
+                               now)
+          .status(),
+      Not(IsOk()));
+  EXPECT_THAT(jwt_hmac->VerifyMacAndDecode("", options, now).status(),
+              Not(IsOk()));
+
+  auto other_jwt_hmac = NewJwtHmac(NewKey(HashType::SHA256));
+  EXPECT_THAT(
+      other_jwt_hmac->VerifyMacAndDecode(compact, options, now).status(),
+      Not(IsOk()));
+}
+
+TEST(JwtHmacTest, AlgorithmMustMatchKey) {
+  JwtHmacKey key = NewKey(HashType::SHA256);
+  JwtHmacKey key384 = key;
+  key384.set_hash_type(HashType::SHA384);
+  std::string compact = NewJwtHmac(key384)
+                            ->ComputeMacAndEncode(R"({"exp":1300819380})", "")
+                            .ValueOrDie();
+  EXPECT_THAT(NewJwtHmac(key)
+                  ->VerifyMacAndDecode(compact, JwtValidationOptions(),
+                                       absl::FromUnixSeconds(0))
+                  .status(),
+              Not(IsOk()));
+}
+
+// https://tools.ietf.org/html/rfc7515#appendix-A.1
+TEST(JwtHmacTest, Rfc7515Example) {
+  JwtHmacKey key;
+  key.set_version(0);
+  key.set_hash_type(HashType::SHA256);
+  std::string key_value;
+  ASSERT_TRUE(absl::WebSafeBase64Unescape(
+      "AyM1SysPpbyDfgZld3umj1qzKObwVMkoqQ-EstJQLr_T-1qS0gZH75aKtMN3Yj0iPS4hcgUu"
+      "TwjAzZr1Z9CAow",
+      &key_value));
+  key.set_key_value(key_value);
+  auto jwt_hmac = NewJwtHmac(key);
+
+  std::string compact =
+      "eyJ0eXAiOiJKV1QiLA0KICJhbGciOiJIUzI1NiJ9"
+      ".eyJpc3MiOiJqb2UiLA0KICJleHAiOjEzMDA4MTkzODAsDQogImh0dHA6Ly9leGFt"
+      "cGxlLmNvbS9pc19yb290Ijp0cnVlfQ"
+      ".dBjftJeZ4CVP-mB92K27uhbUJU1p1r_wW1gFWFOEjXk";
+  JwtValidationOptions options;
+  options.issuer = "joe";
+  auto jwt_or = jwt_hmac->VerifyMacAndDecode(
+      compact, options, absl::FromUnixSeconds(1300819379));
+  ASSERT_THAT(jwt_or.status(), IsOk());
+  const ParsedJwt& jwt = *jwt_or.ValueOrDie();
+  EXPECT_THAT(jwt.GetType().ValueOrDie(), Eq("JWT"));
+  EXPECT_TRUE(
+      jwt.GetClaimAsBool("http://example.com/is_root").ValueOrDie());
+  EXPECT_THAT(jwt_hmac->VerifyMacAndDecode(compact, options).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace tink
+}  // namespace crypto
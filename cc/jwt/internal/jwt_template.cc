@@ -0,0 +1,158 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/jwt/internal/jwt_template.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "include/rapidjson/document.h"
+#include "include/rapidjson/stringbuffer.h"
+#include "include/rapidjson/writer.h"
+#include "tink/jwt/jwt_names.h"
+#include "tink/subtle/subtle_util.h"
+#include "tink/util/base64.h"
+#include "tink/util/errors.h"
+
+namespace crypto {
+namespace tink {
+namespace internal {
+
+namespace {
+
+// The registered claims which are set per token.
+constexpr absl::string_view kTokenClaimNames[] = {
+    kJwtClaimSubject, kJwtClaimJwtId, kJwtClaimExpiration, kJwtClaimNotBefore,
+    kJwtClaimIssuedAt};
+
+void WriteKey(absl::string_view key,
+              rapidjson::Writer<rapidjson::StringBuffer>* writer) {
+  writer->Key(key.data(), key.size());
+}
+
+void WriteString(absl::string_view key,
+                 const absl::optional<std::string>& value,
+                 rapidjson::Writer<rapidjson::StringBuffer>* writer) {
+  if (!value.has_value()) return;
+  WriteKey(key, writer);
+  writer->String(value->data(), value->size());
+}
+
+void WriteTime(absl::string_view key, const absl::optional<absl::Time>& value,
+               rapidjson::Writer<rapidjson::StringBuffer>* writer) {
+  if (!value.has_value()) return;
+  WriteKey(key, writer);
+  writer->Int64(absl::ToUnixSeconds(*value));
+}
+
+}  // namespace
+
+// static
+util::StatusOr<std::unique_ptr<JwtTemplate>> JwtTemplate::New(
+    const JwtHmac* jwt_hmac, absl::string_view key_id, absl::string_view type,
+    absl::string_view constant_claims) {
+  if (jwt_hmac == nullptr) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "jwt_hmac must be non-null");
+  }
+  rapidjson::Document claims;
+  claims.Parse(constant_claims.data(), constant_claims.size());
+  if (claims.HasParseError() || !claims.IsObject()) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "constant_claims is not a JSON object");
+  }
+  for (absl::string_view name : kTokenClaimNames) {
+    if (claims.HasMember(rapidjson::Value(rapidjson::StringRef(
+            name.data(), name.size())))) {
+      return ToStatusF(util::error::INVALID_ARGUMENT,
+                       "claim '%s' must be set per token", name);
+    }
+  }
+
+  rapidjson::StringBuffer header;
+  rapidjson::Writer<rapidjson::StringBuffer> header_writer(header);
+  header_writer.StartObject();
+  WriteKey(kJwtHeaderAlgorithm, &header_writer);
+  header_writer.String(jwt_hmac->algorithm().data(),
+                       jwt_hmac->algorithm().size());
+  if (!key_id.empty()) {
+    WriteKey(kJwtHeaderKeyId, &header_writer);
+    header_writer.String(key_id.data(), key_id.size());
+  }
+  if (!type.empty()) {
+    WriteKey(kJwtHeaderType, &header_writer);
+    header_writer.String(type.data(), type.size());
+  }
+  header_writer.EndObject();
+
+  rapidjson::StringBuffer payload;
+  rapidjson::Writer<rapidjson::StringBuffer> payload_writer(payload);
+  claims.Accept(payload_writer);
+  // Drops the closing brace, which follows the claims of each token, and pads
+  // the rest so that its base64url encoding can be followed by theirs.
+  std::string payload_prefix(payload.GetString(), payload.GetSize() - 1);
+  payload_prefix.append((3 - payload_prefix.size() % 3) % 3, ' ');
+
+  std::string encoded_prefix = util::Base64Encode(
+      absl::string_view(header.GetString(), header.GetSize()),
+      util::Base64Alphabet::kUrl, /* padding = */ false);
+  encoded_prefix.push_back('.');
+  encoded_prefix.append(util::Base64Encode(
+      payload_prefix, util::Base64Alphabet::kUrl, /* padding = */ false));
+  return {absl::WrapUnique(new JwtTemplate(
+      jwt_hmac, std::move(encoded_prefix),
+      !claims.ObjectEmpty()))};
+}
+
+util::StatusOr<std::string> JwtTemplate::ComputeMacAndEncode(
+    const TokenClaims& claims) const {
+  rapidjson::StringBuffer token_claims;
+  rapidjson::Writer<rapidjson::StringBuffer> writer(token_claims);
+  writer.StartObject();
+  WriteString(kJwtClaimSubject, claims.subject, &writer);
+  WriteString(kJwtClaimJwtId, claims.jwt_id, &writer);
+  WriteTime(kJwtClaimExpiration, claims.expiration, &writer);
+  WriteTime(kJwtClaimNotBefore, claims.not_before, &writer);
+  WriteTime(kJwtClaimIssuedAt, claims.issued_at, &writer);
+  writer.EndObject();
+
+  // The claims of the token without their opening brace complete the
+  // payload, after a comma if both the template and the token have claims.
+  absl::string_view payload_suffix(token_claims.GetString() + 1,
+                                   token_claims.GetSize() - 1);
+  std::string suffix;
+  if (has_constant_claims_ && payload_suffix.size() > 1) {
+    suffix = absl::StrCat(",", payload_suffix);
+    payload_suffix = suffix;
+  }
+  std::string compact = encoded_prefix_;
+  const size_t prefix_size = compact.size();
+  subtle::ResizeStringUninitialized(
+      &compact, prefix_size + util::Base64EncodedSize(payload_suffix.size(),
+                                                      /* padding = */ false));
+  util::Base64EncodeInto(payload_suffix, util::Base64Alphabet::kUrl,
+                         /* padding = */ false, &compact[prefix_size]);
+  util::Status status = jwt_hmac_->ComputeMacAndAppend(&compact);
+  if (!status.ok()) return status;
+  return compact;
+}
+
+}  // namespace internal
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,88 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_JWT_INTERNAL_JWT_TEMPLATE_H_
+#define TINK_JWT_INTERNAL_JWT_TEMPLATE_H_
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
+#include "tink/jwt/internal/jwt_hmac.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace internal {
+
+///////////////////////////////////////////////////////////////////////////////
+// Computes JWTs which share their header and most of their claims, such as
+// "iss" and "aud", with the MAC of a JwtHmac.
+//
+// The header and the constant claims are serialized and base64url encoded
+// once, when the template is created. The constant claims are padded with
+// JSON whitespace to a multiple of 3 bytes, so their encoding is a prefix of
+// the encoding of every payload. Computing a token then only serializes and
+// encodes the claims which differ per token, and computes the MAC.
+//
+// Instances are thread-safe.
+class JwtTemplate {
+ public:
+  // The claims which differ per token. Claims which are not set are omitted.
+  struct TokenClaims {
+    absl::optional<std::string> subject;
+    absl::optional<std::string> jwt_id;
+    absl::optional<absl::Time> expiration;
+    absl::optional<absl::Time> not_before;
+    absl::optional<absl::Time> issued_at;
+  };
+
+  // Returns a template of JWTs with the MAC of 'jwt_hmac', which must outlive
+  // the template, and 'constant_claims', a JSON object, in their payload.
+  // The header has the "alg" of 'jwt_hmac', 'key_id' as "kid" and 'type' as
+  // "typ", if they are not empty. 'constant_claims' must not contain any of
+  // the claims of TokenClaims.
+  static crypto::tink::util::StatusOr<std::unique_ptr<JwtTemplate>> New(
+      const JwtHmac* jwt_hmac, absl::string_view key_id,
+      absl::string_view type, absl::string_view constant_claims);
+
+  // Returns the compact serialization of a JWT with the constant claims of
+  // the template and 'claims'.
+  crypto::tink::util::StatusOr<std::string> ComputeMacAndEncode(
+      const TokenClaims& claims) const;
+
+ private:
+  JwtTemplate(const JwtHmac* jwt_hmac, std::string encoded_prefix,
+              bool has_constant_claims)
+      : jwt_hmac_(jwt_hmac),
+        encoded_prefix_(std::move(encoded_prefix)),
+        has_constant_claims_(has_constant_claims) {}
+
+  const JwtHmac* const jwt_hmac_;
+  // The encoded header, ".", and the encoded constant claims.
+  const std::string encoded_prefix_;
+  const bool has_constant_claims_;
+};
+
+}  // namespace internal
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_JWT_INTERNAL_JWT_TEMPLATE_H_
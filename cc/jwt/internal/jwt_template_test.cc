@@ -0,0 +1,143 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/jwt/internal/jwt_template.h"
+
+#include <memory>
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/time.h"
+#include "tink/jwt/internal/jwt_hmac.h"
+#include "tink/jwt/internal/parsed_jwt.h"
+#include "tink/subtle/random.h"
+#include "tink/util/status.h"
+#include "tink/util/test_matchers.h"
+#include "proto/common.pb.h"
+#include "proto/jwt_hmac.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace internal {
+namespace {
+
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::google::crypto::tink::HashType;
+using ::google::crypto::tink::JwtHmacKey;
+using ::testing::ElementsAre;
+using ::testing::Eq;
+
+std::unique_ptr<JwtHmac> NewJwtHmac() {
+  JwtHmacKey key;
+  key.set_version(0);
+  key.set_hash_type(HashType::SHA256);
+  key.set_key_value(subtle::Random::GetRandomBytes(32));
+  auto jwt_hmac_or = JwtHmac::New(key);
+  EXPECT_THAT(jwt_hmac_or.status(), IsOk());
+  return std::move(jwt_hmac_or.ValueOrDie());
+}
+
+TEST(JwtTemplateTest, ComputesVerifiableTokens) {
+  auto jwt_hmac = NewJwtHmac();
+  auto template_or = JwtTemplate::New(
+      jwt_hmac.get(), "key-1", "JWT",
+      R"({"iss":"issuer","aud":["audience-1","audience-2"]})");
+  ASSERT_THAT(template_or.status(), IsOk());
+  const JwtTemplate& jwt_template = *template_or.ValueOrDie();
+
+  JwtTemplate::TokenClaims claims;
+  claims.subject = "subject \"1\"";
+  claims.jwt_id = "id-1";
+  claims.issued_at = absl::FromUnixSeconds(1300819000);
+  claims.expiration = absl::FromUnixSeconds(1300819380);
+  auto compact_or = jwt_template.ComputeMacAndEncode(claims);
+  ASSERT_THAT(compact_or.status(), IsOk());
+
+  JwtValidationOptions options;
+  options.issuer = "issuer";
+  options.audience = "audience-2";
+  auto jwt_or = jwt_hmac->VerifyMacAndDecode(
+      compact_or.ValueOrDie(), options, absl::FromUnixSeconds(1300819379));
+  ASSERT_THAT(jwt_or.status(), IsOk());
+  const ParsedJwt& jwt = *jwt_or.ValueOrDie();
+  EXPECT_THAT(jwt.GetAlgorithm().ValueOrDie(), Eq("HS256"));
+  EXPECT_THAT(jwt.GetKeyId().ValueOrDie(), Eq("key-1"));
+  EXPECT_THAT(jwt.GetType().ValueOrDie(), Eq("JWT"));
+  EXPECT_THAT(jwt.GetIssuer().ValueOrDie(), Eq("issuer"));
+  EXPECT_THAT(jwt.GetAudiences().ValueOrDie(),
+              ElementsAre("audience-1", "audience-2"));
+  EXPECT_THAT(jwt.GetSubject().ValueOrDie(), Eq("subject \"1\""));
+  EXPECT_THAT(jwt.GetJwtId().ValueOrDie(), Eq("id-1"));
+  EXPECT_THAT(jwt.GetIssuedAt().ValueOrDie(),
+              Eq(absl::FromUnixSeconds(1300819000)));
+  EXPECT_THAT(jwt.GetExpiration().ValueOrDie(),
+              Eq(absl::FromUnixSeconds(1300819380)));
+
+  EXPECT_THAT(jwt_hmac
+                  ->VerifyMacAndDecode(compact_or.ValueOrDie(), options,
+                                       absl::FromUnixSeconds(1300819380))
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(JwtTemplateTest, SplicesAnyClaims) {
+  auto jwt_hmac = NewJwtHmac();
+  JwtValidationOptions options;
+  options.allow_missing_expiration = true;
+  // The constant claims have each size modulo 3, so need each padding.
+  for (const std::string& constant_claims :
+       {"{}", R"({"iss":"a"})", R"({"iss":"ab"})", R"({"iss":"abc"})"}) {
+    for (bool has_subject : {false, true}) {
+      SCOPED_TRACE(absl::StrCat(constant_claims, " ", has_subject));
+      auto template_or =
+          JwtTemplate::New(jwt_hmac.get(), "", "", constant_claims);
+      ASSERT_THAT(template_or.status(), IsOk());
+      JwtTemplate::TokenClaims claims;
+      if (has_subject) claims.subject = "subject";
+      auto compact_or = template_or.ValueOrDie()->ComputeMacAndEncode(claims);
+      ASSERT_THAT(compact_or.status(), IsOk());
+      auto jwt_or =
+          jwt_hmac->VerifyMacAndDecode(compact_or.ValueOrDie(), options);
+      ASSERT_THAT(jwt_or.status(), IsOk());
+      const ParsedJwt& jwt = *jwt_or.ValueOrDie();
+      EXPECT_THAT(jwt.GetKeyId().status(), StatusIs(util::error::NOT_FOUND));
+      EXPECT_THAT(jwt.GetIssuer().ok(), Eq(constant_claims != "{}"));
+      EXPECT_THAT(jwt.GetSubject().ok(), Eq(has_subject));
+    }
+  }
+}
+
+TEST(JwtTemplateTest, InvalidTemplates) {
+  auto jwt_hmac = NewJwtHmac();
+  EXPECT_THAT(JwtTemplate::New(jwt_hmac.get(), "", "", R"(["iss"])").status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(JwtTemplate::New(jwt_hmac.get(), "", "", "{").status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(
+      JwtTemplate::New(jwt_hmac.get(), "", "", R"({"exp":1300819380})")
+          .status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(JwtTemplate::New(nullptr, "", "", "{}").status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace tink
+}  // namespace crypto
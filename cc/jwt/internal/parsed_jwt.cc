@@ -0,0 +1,330 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/jwt/internal/parsed_jwt.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "absl/strings/substitute.h"
+#include "absl/time/time.h"
+#include "include/rapidjson/document.h"
+#include "include/rapidjson/error/en.h"
+#include "tink/jwt/jwt_names.h"
+#include "tink/util/base64.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace internal {
+
+namespace {
+
+// Objects with at most this many members are checked for duplicate names
+// pairwise, which avoids allocating a hash set for typical JWTs.
+constexpr rapidjson::SizeType kMaxMembersForPairwiseCheck = 32;
+
+absl::string_view StringView(const rapidjson::Value& value) {
+  return absl::string_view(value.GetString(), value.GetStringLength());
+}
+
+util::Status CheckNoDuplicateNames(const rapidjson::Value& object) {
+  util::Status duplicate_status(util::error::INVALID_ARGUMENT,
+                                "JSON object has duplicate names");
+  if (object.MemberCount() <= kMaxMembersForPairwiseCheck) {
+    for (auto it = object.MemberBegin(); it != object.MemberEnd(); ++it) {
+      for (auto other = it + 1; other != object.MemberEnd(); ++other) {
+        if (StringView(it->name) == StringView(other->name)) {
+          return duplicate_status;
+        }
+      }
+    }
+    return util::OkStatus();
+  }
+  absl::flat_hash_set<absl::string_view> names;
+  names.reserve(object.MemberCount());
+  for (auto it = object.MemberBegin(); it != object.MemberEnd(); ++it) {
+    if (!names.insert(StringView(it->name)).second) return duplicate_status;
+  }
+  return util::OkStatus();
+}
+
+util::StatusOr<const rapidjson::Value*> FindValue(
+    const rapidjson::Document& document, absl::string_view name) {
+  rapidjson::Value key(rapidjson::StringRef(name.data(), name.size()));
+  auto it = document.FindMember(key);
+  if (it == document.MemberEnd()) {
+    return util::Status(util::error::NOT_FOUND,
+                        absl::Substitute("field '$0' not found", name));
+  }
+  return &it->value;
+}
+
+util::StatusOr<absl::string_view> FindString(
+    const rapidjson::Document& document, absl::string_view name) {
+  auto value_or = FindValue(document, name);
+  if (!value_or.ok()) return value_or.status();
+  const rapidjson::Value& value = *value_or.ValueOrDie();
+  if (!value.IsString()) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        absl::Substitute("field '$0' is not a string", name));
+  }
+  return StringView(value);
+}
+
+util::StatusOr<double> FindNumber(const rapidjson::Document& document,
+                                  absl::string_view name) {
+  auto value_or = FindValue(document, name);
+  if (!value_or.ok()) return value_or.status();
+  const rapidjson::Value& value = *value_or.ValueOrDie();
+  if (!value.IsNumber()) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        absl::Substitute("field '$0' is not a number", name));
+  }
+  return value.GetDouble();
+}
+
+// Returns the NumericDate claim 'name', which may have a fractional part.
+// https://tools.ietf.org/html/rfc7519#section-2
+util::StatusOr<absl::Time> FindTime(const rapidjson::Document& document,
+                                    absl::string_view name) {
+  auto value_or = FindValue(document, name);
+  if (!value_or.ok()) return value_or.status();
+  const rapidjson::Value& value = *value_or.ValueOrDie();
+  if (value.IsInt64()) return absl::FromUnixSeconds(value.GetInt64());
+  if (!value.IsNumber()) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        absl::Substitute("field '$0' is not a number", name));
+  }
+  return absl::UnixEpoch() + absl::Seconds(value.GetDouble());
+}
+
+// Checks that the string claim 'name' equals 'expected'.
+util::Status ValidateString(const rapidjson::Document& payload,
+                            absl::string_view name,
+                            absl::string_view expected) {
+  auto value_or = FindString(payload, name);
+  if (!value_or.ok()) return value_or.status();
+  if (value_or.ValueOrDie() != expected) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        absl::Substitute("invalid '$0' claim", name));
+  }
+  return util::OkStatus();
+}
+
+}  // namespace
+
+// static
+util::Status ParsedJwt::DecodeAndParse(absl::string_view encoded,
+                                       std::string* buffer,
+                                       rapidjson::Document* document) {
+  // JWTs are encoded without padding.
+  // https://tools.ietf.org/html/rfc7515#section-2
+  if (encoded.find('=') != absl::string_view::npos ||
+      !util::Base64Decode(encoded, util::Base64Alphabet::kUrl, buffer)) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "invalid base64url encoding");
+  }
+  // The buffer is parsed as a null-terminated string, so it must not contain
+  // null characters, which would hide the data after them.
+  if (buffer->find('\0') != std::string::npos) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "invalid JSON: null character");
+  }
+  // Parsing in place unescapes the strings within the buffer, and
+  // terminates them there, so the values need no copies of their own.
+  document->ParseInsitu(&(*buffer)[0]);
+  if (document->HasParseError()) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        absl::Substitute("invalid JSON: $0",
+                                         rapidjson::GetParseError_En(
+                                             document->GetParseError())));
+  }
+  if (!document->IsObject()) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "JSON value is not an object");
+  }
+  return CheckNoDuplicateNames(*document);
+}
+
+// static
+util::StatusOr<std::unique_ptr<ParsedJwt>> ParsedJwt::Parse(
+    absl::string_view header, absl::string_view payload) {
+  auto jwt = absl::WrapUnique(new ParsedJwt());
+  util::Status status =
+      DecodeAndParse(header, &jwt->header_buffer_, &jwt->header_);
+  if (!status.ok()) return status;
+  status = DecodeAndParse(payload, &jwt->payload_buffer_, &jwt->payload_);
+  if (!status.ok()) return status;
+  return std::move(jwt);
+}
+
+util::StatusOr<absl::string_view> ParsedJwt::GetAlgorithm() const {
+  return FindString(header_, kJwtHeaderAlgorithm);
+}
+
+util::StatusOr<absl::string_view> ParsedJwt::GetType() const {
+  return FindString(header_, kJwtHeaderType);
+}
+
+util::StatusOr<absl::string_view> ParsedJwt::GetContentType() const {
+  return FindString(header_, kJwtHeaderContentType);
+}
+
+util::StatusOr<absl::string_view> ParsedJwt::GetKeyId() const {
+  return FindString(header_, kJwtHeaderKeyId);
+}
+
+util::StatusOr<absl::string_view> ParsedJwt::GetIssuer() const {
+  return FindString(payload_, kJwtClaimIssuer);
+}
+
+util::StatusOr<absl::string_view> ParsedJwt::GetSubject() const {
+  return FindString(payload_, kJwtClaimSubject);
+}
+
+util::StatusOr<absl::string_view> ParsedJwt::GetJwtId() const {
+  return FindString(payload_, kJwtClaimJwtId);
+}
+
+util::StatusOr<absl::Time> ParsedJwt::GetExpiration() const {
+  return FindTime(payload_, kJwtClaimExpiration);
+}
+
+util::StatusOr<absl::Time> ParsedJwt::GetNotBefore() const {
+  return FindTime(payload_, kJwtClaimNotBefore);
+}
+
+util::StatusOr<absl::Time> ParsedJwt::GetIssuedAt() const {
+  return FindTime(payload_, kJwtClaimIssuedAt);
+}
+
+util::StatusOr<std::vector<absl::string_view>> ParsedJwt::GetAudiences()
+    const {
+  auto value_or = FindValue(payload_, kJwtClaimAudience);
+  if (!value_or.ok()) return value_or.status();
+  const rapidjson::Value& value = *value_or.ValueOrDie();
+  std::vector<absl::string_view> audiences;
+  if (value.IsString()) {
+    audiences.push_back(StringView(value));
+    return audiences;
+  }
+  if (!value.IsArray()) {
+    return util::Status(
+        util::error::INVALID_ARGUMENT,
+        absl::Substitute("field '$0' is not a list", kJwtClaimAudience));
+  }
+  audiences.reserve(value.Size());
+  for (const rapidjson::Value& audience : value.GetArray()) {
+    if (!audience.IsString()) {
+      return util::Status(
+          util::error::INVALID_ARGUMENT,
+          absl::Substitute("field '$0' contains an element that is not a "
+                           "string",
+                           kJwtClaimAudience));
+    }
+    audiences.push_back(StringView(audience));
+  }
+  return audiences;
+}
+
+util::StatusOr<absl::string_view> ParsedJwt::GetClaimAsString(
+    absl::string_view name) const {
+  return FindString(payload_, name);
+}
+
+util::StatusOr<double> ParsedJwt::GetClaimAsNumber(
+    absl::string_view name) const {
+  return FindNumber(payload_, name);
+}
+
+util::StatusOr<bool> ParsedJwt::GetClaimAsBool(absl::string_view name) const {
+  auto value_or = FindValue(payload_, name);
+  if (!value_or.ok()) return value_or.status();
+  const rapidjson::Value& value = *value_or.ValueOrDie();
+  if (!value.IsBool()) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        absl::Substitute("field '$0' is not a bool", name));
+  }
+  return value.GetBool();
+}
+
+util::Status ParsedJwt::Validate(const JwtValidationOptions& options,
+                                 absl::Time now) const {
+  auto expiration_or = GetExpiration();
+  if (expiration_or.ok()) {
+    if (now >= expiration_or.ValueOrDie() + options.clock_skew) {
+      return util::Status(util::error::INVALID_ARGUMENT, "token has expired");
+    }
+  } else if (expiration_or.status().error_code() != util::error::NOT_FOUND ||
+             !options.allow_missing_expiration) {
+    return expiration_or.status();
+  }
+
+  auto not_before_or = GetNotBefore();
+  if (not_before_or.ok()) {
+    if (now + options.clock_skew < not_before_or.ValueOrDie()) {
+      return util::Status(util::error::INVALID_ARGUMENT,
+                          "token cannot be used yet");
+    }
+  } else if (not_before_or.status().error_code() != util::error::NOT_FOUND) {
+    return not_before_or.status();
+  }
+
+  auto issued_at_or = GetIssuedAt();
+  if (!issued_at_or.ok() &&
+      issued_at_or.status().error_code() != util::error::NOT_FOUND) {
+    return issued_at_or.status();
+  }
+
+  if (options.issuer.has_value()) {
+    util::Status status =
+        ValidateString(payload_, kJwtClaimIssuer, *options.issuer);
+    if (!status.ok()) return status;
+  }
+  if (options.subject.has_value()) {
+    util::Status status =
+        ValidateString(payload_, kJwtClaimSubject, *options.subject);
+    if (!status.ok()) return status;
+  }
+
+  auto audiences_or = GetAudiences();
+  if (options.audience.has_value()) {
+    if (!audiences_or.ok()) return audiences_or.status();
+    const std::vector<absl::string_view>& audiences =
+        audiences_or.ValueOrDie();
+    if (std::find(audiences.begin(), audiences.end(), *options.audience) ==
+        audiences.end()) {
+      return util::Status(util::error::INVALID_ARGUMENT,
+                          "invalid 'aud' claim");
+    }
+  } else if (audiences_or.status().error_code() != util::error::NOT_FOUND) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "token has an 'aud' claim, but no audience is "
+                        "expected");
+  }
+  return util::OkStatus();
+}
+
+}  // namespace internal
+}  // namespace tink
+}  // namespace crypto
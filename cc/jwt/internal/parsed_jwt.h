@@ -0,0 +1,121 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_JWT_INTERNAL_PARSED_JWT_H_
+#define TINK_JWT_INTERNAL_PARSED_JWT_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
+#include "include/rapidjson/document.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace internal {
+
+// Requirements on the claims of a JWT, checked by ParsedJwt::Validate().
+struct JwtValidationOptions {
+  // If set, the "iss" claim must be equal to it.
+  absl::optional<std::string> issuer;
+  // If set, the "sub" claim must be equal to it.
+  absl::optional<std::string> subject;
+  // If set, the "aud" claim must contain it. If not set, JWTs with an "aud"
+  // claim are rejected, as the recipient cannot identify itself with it.
+  // https://tools.ietf.org/html/rfc7519#section-4.1.3
+  absl::optional<std::string> audience;
+  // Whether JWTs without an "exp" claim are accepted.
+  bool allow_missing_expiration = false;
+  // The tolerance for the "exp" and "nbf" claims.
+  absl::Duration clock_skew = absl::ZeroDuration();
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// The header and payload of a JWT in compact serialization.
+// https://tools.ietf.org/html/rfc7515#section-7.1
+//
+// The segments are base64url decoded into buffers owned by the object and
+// parsed in place, into JSON values allocated from a memory pool. Getters
+// return views into these buffers, so reading a claim neither walks a
+// protobuf map nor copies its value. The views are valid as long as the
+// object.
+//
+// Like JwtObject, the getters return NOT_FOUND if the requested header or
+// claim does not exist, and INVALID_ARGUMENT if its type does not match.
+class ParsedJwt {
+ public:
+  // Decodes and parses the base64url encoded 'header' and 'payload'
+  // segments. Both must be JSON objects without duplicate names.
+  static crypto::tink::util::StatusOr<std::unique_ptr<ParsedJwt>> Parse(
+      absl::string_view header, absl::string_view payload);
+
+  // Header getters.
+  crypto::tink::util::StatusOr<absl::string_view> GetAlgorithm() const;
+  crypto::tink::util::StatusOr<absl::string_view> GetType() const;
+  crypto::tink::util::StatusOr<absl::string_view> GetContentType() const;
+  crypto::tink::util::StatusOr<absl::string_view> GetKeyId() const;
+
+  // Payload getters.
+  crypto::tink::util::StatusOr<absl::string_view> GetIssuer() const;
+  crypto::tink::util::StatusOr<absl::string_view> GetSubject() const;
+  crypto::tink::util::StatusOr<absl::string_view> GetJwtId() const;
+  crypto::tink::util::StatusOr<absl::Time> GetExpiration() const;
+  crypto::tink::util::StatusOr<absl::Time> GetNotBefore() const;
+  crypto::tink::util::StatusOr<absl::Time> GetIssuedAt() const;
+  // A single string "aud" value is returned as a list of one audience.
+  crypto::tink::util::StatusOr<std::vector<absl::string_view>> GetAudiences()
+      const;
+  crypto::tink::util::StatusOr<absl::string_view> GetClaimAsString(
+      absl::string_view name) const;
+  crypto::tink::util::StatusOr<double> GetClaimAsNumber(
+      absl::string_view name) const;
+  crypto::tink::util::StatusOr<bool> GetClaimAsBool(
+      absl::string_view name) const;
+
+  // Checks the registered claims against 'options', at time 'now'.
+  crypto::tink::util::Status Validate(const JwtValidationOptions& options,
+                                      absl::Time now) const;
+
+  ParsedJwt(const ParsedJwt&) = delete;
+  ParsedJwt& operator=(const ParsedJwt&) = delete;
+
+ private:
+  ParsedJwt() : header_(&allocator_), payload_(&allocator_) {}
+
+  // Base64url decodes 'encoded' into 'buffer' and parses it into 'document'.
+  static crypto::tink::util::Status DecodeAndParse(
+      absl::string_view encoded, std::string* buffer,
+      rapidjson::Document* document);
+
+  // The buffers hold the decoded segments, which the JSON values of the
+  // documents point into.
+  std::string header_buffer_;
+  std::string payload_buffer_;
+  rapidjson::MemoryPoolAllocator<> allocator_;
+  rapidjson::Document header_;
+  rapidjson::Document payload_;
+};
+
+}  // namespace internal
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_JWT_INTERNAL_PARSED_JWT_H_
@@ -0,0 +1,204 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/jwt/internal/parsed_jwt.h"
+
+#include <memory>
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/escaping.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "tink/util/status.h"
+#include "tink/util/test_matchers.h"
+
+namespace crypto {
+namespace tink {
+namespace internal {
+namespace {
+
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::testing::ElementsAre;
+using ::testing::Eq;
+
+std::string Encode(absl::string_view json) {
+  std::string encoded;
+  absl::WebSafeBase64Escape(json, &encoded);
+  return encoded;
+}
+
+std::unique_ptr<ParsedJwt> ParseOrDie(absl::string_view header,
+                                      absl::string_view payload) {
+  auto jwt_or = ParsedJwt::Parse(Encode(header), Encode(payload));
+  EXPECT_THAT(jwt_or.status(), IsOk());
+  return std::move(jwt_or.ValueOrDie());
+}
+
+TEST(ParsedJwtTest, Getters) {
+  auto jwt = ParseOrDie(
+      R"({"alg":"HS256","typ":"JWT","cty":"x","kid":"key-1"})",
+      R"({"iss":"issuer","sub":"subject","jti":"id","aud":["a","b"],)"
+      R"("exp":1300819380,"nbf":1300819370.5,"iat":1300819360,)"
+      R"("name":"value\n","number":1.5,"flag":true})");
+  EXPECT_THAT(jwt->GetAlgorithm().ValueOrDie(), Eq("HS256"));
+  EXPECT_THAT(jwt->GetType().ValueOrDie(), Eq("JWT"));
+  EXPECT_THAT(jwt->GetContentType().ValueOrDie(), Eq("x"));
+  EXPECT_THAT(jwt->GetKeyId().ValueOrDie(), Eq("key-1"));
+  EXPECT_THAT(jwt->GetIssuer().ValueOrDie(), Eq("issuer"));
+  EXPECT_THAT(jwt->GetSubject().ValueOrDie(), Eq("subject"));
+  EXPECT_THAT(jwt->GetJwtId().ValueOrDie(), Eq("id"));
+  EXPECT_THAT(jwt->GetAudiences().ValueOrDie(), ElementsAre("a", "b"));
+  EXPECT_THAT(jwt->GetExpiration().ValueOrDie(),
+              Eq(absl::FromUnixSeconds(1300819380)));
+  EXPECT_THAT(jwt->GetNotBefore().ValueOrDie(),
+              Eq(absl::FromUnixMillis(1300819370500)));
+  EXPECT_THAT(jwt->GetIssuedAt().ValueOrDie(),
+              Eq(absl::FromUnixSeconds(1300819360)));
+  EXPECT_THAT(jwt->GetClaimAsString("name").ValueOrDie(), Eq("value\n"));
+  EXPECT_THAT(jwt->GetClaimAsNumber("number").ValueOrDie(), Eq(1.5));
+  EXPECT_TRUE(jwt->GetClaimAsBool("flag").ValueOrDie());
+}
+
+TEST(ParsedJwtTest, SingleAudience) {
+  auto jwt = ParseOrDie(R"({"alg":"HS256"})", R"({"aud":"a"})");
+  EXPECT_THAT(jwt->GetAudiences().ValueOrDie(), ElementsAre("a"));
+}
+
+TEST(ParsedJwtTest, MissingAndMistypedFields) {
+  auto jwt = ParseOrDie(R"({"alg":1})", R"({"iss":true,"aud":[1]})");
+  EXPECT_THAT(jwt->GetAlgorithm().status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(jwt->GetKeyId().status(), StatusIs(util::error::NOT_FOUND));
+  EXPECT_THAT(jwt->GetIssuer().status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(jwt->GetSubject().status(), StatusIs(util::error::NOT_FOUND));
+  EXPECT_THAT(jwt->GetAudiences().status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(jwt->GetExpiration().status(),
+              StatusIs(util::error::NOT_FOUND));
+  EXPECT_THAT(jwt->GetClaimAsNumber("iss").status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(jwt->GetClaimAsBool("iss").ValueOrDie(), Eq(true));
+}
+
+TEST(ParsedJwtTest, InvalidSegments) {
+  std::string header = Encode(R"({"alg":"HS256"})");
+  // Not an object.
+  EXPECT_THAT(ParsedJwt::Parse(header, Encode("[1]")).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  // Not JSON.
+  EXPECT_THAT(ParsedJwt::Parse(header, Encode("{")).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  // Duplicate names.
+  EXPECT_THAT(
+      ParsedJwt::Parse(header, Encode(R"({"iss":"a","iss":"b"})")).status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+  // Null characters.
+  EXPECT_THAT(ParsedJwt::Parse(header, Encode(std::string("{}\0{}", 5)))
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  // Padding.
+  EXPECT_THAT(ParsedJwt::Parse(header, "e30=").status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  // Not base64url.
+  EXPECT_THAT(ParsedJwt::Parse(header, "e30+").status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(ParsedJwt::Parse(header, "e30").status(), IsOk());
+}
+
+TEST(ParsedJwtTest, DuplicateNamesInLargeObject) {
+  std::string payload = "{";
+  for (int i = 0; i < 40; i++) {
+    payload += "\"claim" + std::to_string(i) + "\":1,";
+  }
+  EXPECT_THAT(ParsedJwt::Parse(Encode("{}"), Encode(payload + "\"x\":1}"))
+                  .status(),
+              IsOk());
+  EXPECT_THAT(
+      ParsedJwt::Parse(Encode("{}"), Encode(payload + "\"claim7\":1}"))
+          .status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(ParsedJwtTest, ValidateExpiration) {
+  absl::Time exp = absl::FromUnixSeconds(1300819380);
+  auto jwt = ParseOrDie("{}", R"({"exp":1300819380})");
+  JwtValidationOptions options;
+  EXPECT_THAT(jwt->Validate(options, exp - absl::Seconds(1)), IsOk());
+  EXPECT_THAT(jwt->Validate(options, exp),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  options.clock_skew = absl::Seconds(2);
+  EXPECT_THAT(jwt->Validate(options, exp + absl::Seconds(1)), IsOk());
+
+  auto without_exp = ParseOrDie("{}", "{}");
+  EXPECT_THAT(without_exp->Validate(JwtValidationOptions(), exp),
+              StatusIs(util::error::NOT_FOUND));
+  JwtValidationOptions allow_missing;
+  allow_missing.allow_missing_expiration = true;
+  EXPECT_THAT(without_exp->Validate(allow_missing, exp), IsOk());
+}
+
+TEST(ParsedJwtTest, ValidateNotBefore) {
+  absl::Time nbf = absl::FromUnixSeconds(1300819380);
+  auto jwt = ParseOrDie("{}", R"({"nbf":1300819380})");
+  JwtValidationOptions options;
+  options.allow_missing_expiration = true;
+  EXPECT_THAT(jwt->Validate(options, nbf), IsOk());
+  EXPECT_THAT(jwt->Validate(options, nbf - absl::Seconds(1)),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  options.clock_skew = absl::Seconds(2);
+  EXPECT_THAT(jwt->Validate(options, nbf - absl::Seconds(1)), IsOk());
+}
+
+TEST(ParsedJwtTest, ValidateIssuerSubjectAndAudience) {
+  auto jwt = ParseOrDie(
+      "{}", R"({"iss":"issuer","sub":"subject","aud":["a","b"]})");
+  JwtValidationOptions options;
+  options.allow_missing_expiration = true;
+  // An "aud" claim requires an expected audience.
+  EXPECT_THAT(jwt->Validate(options, absl::Now()),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  options.audience = "b";
+  EXPECT_THAT(jwt->Validate(options, absl::Now()), IsOk());
+  options.issuer = "issuer";
+  options.subject = "subject";
+  EXPECT_THAT(jwt->Validate(options, absl::Now()), IsOk());
+
+  JwtValidationOptions wrong_audience = options;
+  wrong_audience.audience = "c";
+  EXPECT_THAT(jwt->Validate(wrong_audience, absl::Now()),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  JwtValidationOptions wrong_issuer = options;
+  wrong_issuer.issuer = "other";
+  EXPECT_THAT(jwt->Validate(wrong_issuer, absl::Now()),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  JwtValidationOptions wrong_subject = options;
+  wrong_subject.subject = "other";
+  EXPECT_THAT(jwt->Validate(wrong_subject, absl::Now()),
+              StatusIs(util::error::INVALID_ARGUMENT));
+
+  auto without_claims = ParseOrDie("{}", "{}");
+  EXPECT_THAT(without_claims->Validate(options, absl::Now()),
+              StatusIs(util::error::NOT_FOUND));
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,177 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/jwt/internal/verified_jwt_cache.h"
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "openssl/sha.h"
+#include "tink/jwt/internal/jwt_hmac.h"
+#include "tink/jwt/internal/parsed_jwt.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace internal {
+
+namespace {
+
+std::string TokenHash(absl::string_view compact) {
+  uint8_t digest[SHA256_DIGEST_LENGTH];
+  SHA256(reinterpret_cast<const uint8_t*>(compact.data()), compact.size(),
+         digest);
+  return std::string(reinterpret_cast<const char*>(digest), sizeof(digest));
+}
+
+}  // namespace
+
+// static
+util::StatusOr<std::unique_ptr<VerifiedJwtCache>> VerifiedJwtCache::New(
+    std::shared_ptr<const JwtHmac> jwt_hmac, int max_entries, int num_shards) {
+  if (jwt_hmac == nullptr) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "jwt_hmac must be non-null");
+  }
+  if (max_entries <= 0) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "max_entries must be positive");
+  }
+  if (num_shards <= 0) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "num_shards must be positive");
+  }
+  size_t max_entries_per_shard = (max_entries + num_shards - 1) / num_shards;
+  return absl::WrapUnique(new VerifiedJwtCache(
+      std::move(jwt_hmac), max_entries_per_shard, num_shards));
+}
+
+util::StatusOr<std::shared_ptr<const ParsedJwt>>
+VerifiedJwtCache::VerifyMacAndDecode(absl::string_view compact,
+                                     const JwtValidationOptions& options,
+                                     absl::Time now) {
+  std::shared_ptr<const JwtHmac> jwt_hmac;
+  uint64_t generation;
+  {
+    absl::ReaderMutexLock lock(&jwt_hmac_mutex_);
+    jwt_hmac = jwt_hmac_;
+    generation = generation_;
+  }
+
+  std::string token_hash = TokenHash(compact);
+  std::shared_ptr<const ParsedJwt> cached = Find(token_hash, generation, now);
+  if (cached != nullptr) {
+    util::Status status = cached->Validate(options, now);
+    if (!status.ok()) return status;
+    return cached;
+  }
+
+  auto jwt_result = jwt_hmac->VerifyMacAndDecode(compact, options, now);
+  if (!jwt_result.ok()) return jwt_result.status();
+  std::shared_ptr<const ParsedJwt> jwt = std::move(jwt_result.ValueOrDie());
+  auto expiration_result = jwt->GetExpiration();
+  // Tokens accepted within the clock skew after their expiration are not
+  // cached either.
+  if (expiration_result.ok() && expiration_result.ValueOrDie() > now) {
+    Insert(token_hash, {jwt, expiration_result.ValueOrDie(), generation}, now);
+  }
+  return jwt;
+}
+
+void VerifiedJwtCache::SetJwtHmac(std::shared_ptr<const JwtHmac> jwt_hmac) {
+  {
+    absl::MutexLock lock(&jwt_hmac_mutex_);
+    jwt_hmac_ = std::move(jwt_hmac);
+    generation_++;
+  }
+  // Entries of the previous generation that are inserted concurrently are
+  // dropped by Find().
+  for (Shard& shard : shards_) {
+    absl::MutexLock lock(&shard.mutex);
+    shard.entries.clear();
+    shard.expirations.clear();
+  }
+}
+
+VerifiedJwtCache::Stats VerifiedJwtCache::GetStats() const {
+  Stats stats;
+  stats.hits = hits_.load(std::memory_order_relaxed);
+  stats.misses = misses_.load(std::memory_order_relaxed);
+  stats.evictions = evictions_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+VerifiedJwtCache::Shard& VerifiedJwtCache::ShardFor(
+    absl::string_view token_hash) {
+  uint64_t index;
+  std::memcpy(&index, token_hash.data(), sizeof(index));
+  return shards_[index % shards_.size()];
+}
+
+std::shared_ptr<const ParsedJwt> VerifiedJwtCache::Find(
+    absl::string_view token_hash, uint64_t generation, absl::Time now) {
+  Shard& shard = ShardFor(token_hash);
+  absl::MutexLock lock(&shard.mutex);
+  auto it = shard.entries.find(token_hash);
+  if (it == shard.entries.end()) {
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+  if (it->second.generation != generation || now >= it->second.expiration) {
+    if (it->second.generation == generation) {
+      evictions_.fetch_add(1, std::memory_order_relaxed);
+    }
+    Erase(&shard, it);
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+  hits_.fetch_add(1, std::memory_order_relaxed);
+  return it->second.jwt;
+}
+
+void VerifiedJwtCache::Insert(const std::string& token_hash, Entry entry,
+                              absl::Time now) {
+  Shard& shard = ShardFor(token_hash);
+  absl::MutexLock lock(&shard.mutex);
+  // Another thread may have inserted the same token concurrently.
+  if (shard.entries.contains(token_hash)) return;
+  // Drops the expired entries first, then the ones expiring soonest.
+  while (!shard.expirations.empty() &&
+         (shard.expirations.begin()->first <= now ||
+          shard.entries.size() >= max_entries_per_shard_)) {
+    Erase(&shard, shard.entries.find(shard.expirations.begin()->second));
+    evictions_.fetch_add(1, std::memory_order_relaxed);
+  }
+  shard.expirations.emplace(entry.expiration, token_hash);
+  shard.entries.emplace(token_hash, std::move(entry));
+}
+
+void VerifiedJwtCache::Erase(
+    Shard* shard, absl::flat_hash_map<std::string, Entry>::iterator it) {
+  shard->expirations.erase({it->second.expiration, it->first});
+  shard->entries.erase(it);
+}
+
+}  // namespace internal
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,149 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_JWT_INTERNAL_VERIFIED_JWT_CACHE_H_
+#define TINK_JWT_INTERNAL_VERIFIED_JWT_CACHE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "tink/jwt/internal/jwt_hmac.h"
+#include "tink/jwt/internal/parsed_jwt.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace internal {
+
+///////////////////////////////////////////////////////////////////////////////
+// A bounded, thread-safe cache in front of JwtHmac::VerifyMacAndDecode(),
+// for services that see the same tokens many times before they expire:
+//
+//   auto cache = VerifiedJwtCache::New(jwt_hmac, /* max_entries= */ 10000,
+//                                      /* num_shards= */ 16).ValueOrDie();
+//   ...
+//   auto jwt_result = cache->VerifyMacAndDecode(compact, options);
+//
+// Verified tokens are keyed by the SHA-256 of their compact serialization,
+// so a repeated token only costs a hash and a lookup instead of a MAC
+// verification and JSON parsing. The claims of a cached token are still
+// validated against the options of every call, which is cheap. Tokens
+// without an "exp" claim are not cached, and cached tokens are dropped once
+// they expire, or when the cache is full, in the order of their expiration.
+//
+// The entries are spread over 'num_shards' independently locked shards, to
+// keep threads verifying distinct tokens from contending on a single lock.
+// SetJwtHmac() replaces the verifier, e.g. after a keyset rotation, and
+// invalidates all entries verified with the previous one.
+class VerifiedJwtCache {
+ public:
+  struct Stats {
+    int64_t hits = 0;
+    int64_t misses = 0;
+    // Entries dropped because they expired or the cache was full.
+    int64_t evictions = 0;
+  };
+
+  // Returns a cache holding at most 'max_entries' tokens verified with
+  // 'jwt_hmac'. Both 'max_entries' and 'num_shards' must be positive.
+  static crypto::tink::util::StatusOr<std::unique_ptr<VerifiedJwtCache>> New(
+      std::shared_ptr<const JwtHmac> jwt_hmac, int max_entries,
+      int num_shards);
+
+  VerifiedJwtCache(const VerifiedJwtCache&) = delete;
+  VerifiedJwtCache& operator=(const VerifiedJwtCache&) = delete;
+
+  // Like JwtHmac::VerifyMacAndDecode(), but returns the cached claims if
+  // 'compact' was verified before and has not expired.
+  crypto::tink::util::StatusOr<std::shared_ptr<const ParsedJwt>>
+  VerifyMacAndDecode(absl::string_view compact,
+                     const JwtValidationOptions& options, absl::Time now);
+
+  // Like above, at the current time.
+  crypto::tink::util::StatusOr<std::shared_ptr<const ParsedJwt>>
+  VerifyMacAndDecode(absl::string_view compact,
+                     const JwtValidationOptions& options) {
+    return VerifyMacAndDecode(compact, options, absl::Now());
+  }
+
+  // Verifies tokens with 'jwt_hmac' from now on, and drops all entries.
+  void SetJwtHmac(std::shared_ptr<const JwtHmac> jwt_hmac)
+      ABSL_LOCKS_EXCLUDED(jwt_hmac_mutex_);
+
+  Stats GetStats() const;
+
+ private:
+  struct Entry {
+    std::shared_ptr<const ParsedJwt> jwt;
+    absl::Time expiration;
+    // The generation of the verifier the token was verified with.
+    uint64_t generation;
+  };
+
+  struct Shard {
+    absl::Mutex mutex;
+    absl::flat_hash_map<std::string, Entry> entries ABSL_GUARDED_BY(mutex);
+    // The keys of 'entries', ordered by expiration.
+    std::set<std::pair<absl::Time, std::string>> expirations
+        ABSL_GUARDED_BY(mutex);
+  };
+
+  VerifiedJwtCache(std::shared_ptr<const JwtHmac> jwt_hmac,
+                   size_t max_entries_per_shard, int num_shards)
+      : max_entries_per_shard_(max_entries_per_shard),
+        shards_(num_shards),
+        jwt_hmac_(std::move(jwt_hmac)) {}
+
+  Shard& ShardFor(absl::string_view token_hash);
+
+  // Returns the cached claims for 'token_hash', or nullptr.
+  std::shared_ptr<const ParsedJwt> Find(absl::string_view token_hash,
+                                        uint64_t generation, absl::Time now);
+  void Insert(const std::string& token_hash, Entry entry, absl::Time now);
+
+  // Removes the entry of 'it' from 'shard'.
+  void Erase(Shard* shard,
+             absl::flat_hash_map<std::string, Entry>::iterator it)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(shard->mutex);
+
+  const size_t max_entries_per_shard_;
+  std::vector<Shard> shards_;
+
+  mutable absl::Mutex jwt_hmac_mutex_;
+  std::shared_ptr<const JwtHmac> jwt_hmac_ ABSL_GUARDED_BY(jwt_hmac_mutex_);
+  uint64_t generation_ ABSL_GUARDED_BY(jwt_hmac_mutex_) = 0;
+
+  std::atomic<int64_t> hits_{0};
+  std::atomic<int64_t> misses_{0};
+  std::atomic<int64_t> evictions_{0};
+};
+
+}  // namespace internal
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_JWT_INTERNAL_VERIFIED_JWT_CACHE_H_
@@ -0,0 +1,252 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/jwt/internal/verified_jwt_cache.h"
+
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/time.h"
+#include "tink/jwt/internal/jwt_hmac.h"
+#include "tink/jwt/internal/parsed_jwt.h"
+#include "tink/subtle/random.h"
+#include "tink/util/status.h"
+#include "tink/util/test_matchers.h"
+#include "proto/common.pb.h"
+#include "proto/jwt_hmac.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace internal {
+namespace {
+
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::google::crypto::tink::HashType;
+using ::google::crypto::tink::JwtHmacKey;
+using ::testing::Eq;
+using ::testing::Not;
+
+constexpr int64_t kExpiration = 1300819380;
+
+std::shared_ptr<const JwtHmac> NewJwtHmac() {
+  JwtHmacKey key;
+  key.set_version(0);
+  key.set_hash_type(HashType::SHA256);
+  key.set_key_value(subtle::Random::GetRandomBytes(32));
+  auto jwt_hmac_result = JwtHmac::New(key);
+  EXPECT_THAT(jwt_hmac_result.status(), IsOk());
+  return std::move(jwt_hmac_result.ValueOrDie());
+}
+
+std::string NewToken(const JwtHmac& jwt_hmac, absl::string_view subject,
+                     int64_t expiration = kExpiration) {
+  auto compact_result = jwt_hmac.ComputeMacAndEncode(
+      absl::StrCat(R"({"sub":")", subject, R"(","exp":)", expiration, "}"),
+      "");
+  EXPECT_THAT(compact_result.status(), IsOk());
+  return compact_result.ValueOrDie();
+}
+
+absl::Time Before(int64_t expiration) {
+  return absl::FromUnixSeconds(expiration - 1);
+}
+
+std::unique_ptr<VerifiedJwtCache> NewCache(
+    std::shared_ptr<const JwtHmac> jwt_hmac, int max_entries = 100,
+    int num_shards = 4) {
+  auto cache_result =
+      VerifiedJwtCache::New(std::move(jwt_hmac), max_entries, num_shards);
+  EXPECT_THAT(cache_result.status(), IsOk());
+  return std::move(cache_result.ValueOrDie());
+}
+
+TEST(VerifiedJwtCacheTest, InvalidArguments) {
+  EXPECT_THAT(VerifiedJwtCache::New(nullptr, 1, 1).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(VerifiedJwtCache::New(NewJwtHmac(), 0, 1).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(VerifiedJwtCache::New(NewJwtHmac(), 1, 0).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(VerifiedJwtCacheTest, RepeatedTokensAreCached) {
+  auto jwt_hmac = NewJwtHmac();
+  auto cache = NewCache(jwt_hmac);
+  std::string compact = NewToken(*jwt_hmac, "subject");
+  JwtValidationOptions options;
+
+  auto first = cache->VerifyMacAndDecode(compact, options, Before(kExpiration));
+  ASSERT_THAT(first.status(), IsOk());
+  auto second =
+      cache->VerifyMacAndDecode(compact, options, Before(kExpiration));
+  ASSERT_THAT(second.status(), IsOk());
+  EXPECT_THAT(second.ValueOrDie(), Eq(first.ValueOrDie()));
+  EXPECT_THAT(second.ValueOrDie()->GetSubject().ValueOrDie(), Eq("subject"));
+
+  VerifiedJwtCache::Stats stats = cache->GetStats();
+  EXPECT_THAT(stats.hits, Eq(1));
+  EXPECT_THAT(stats.misses, Eq(1));
+  EXPECT_THAT(stats.evictions, Eq(0));
+}
+
+TEST(VerifiedJwtCacheTest, CachedTokensAreValidated) {
+  auto jwt_hmac = NewJwtHmac();
+  auto cache = NewCache(jwt_hmac);
+  std::string compact = NewToken(*jwt_hmac, "subject");
+  JwtValidationOptions options;
+  ASSERT_THAT(
+      cache->VerifyMacAndDecode(compact, options, Before(kExpiration))
+          .status(),
+      IsOk());
+
+  JwtValidationOptions other_subject;
+  other_subject.subject = "other";
+  EXPECT_THAT(
+      cache->VerifyMacAndDecode(compact, other_subject, Before(kExpiration))
+          .status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(cache->GetStats().hits, Eq(1));
+}
+
+TEST(VerifiedJwtCacheTest, InvalidTokensAreNotCached) {
+  auto jwt_hmac = NewJwtHmac();
+  auto cache = NewCache(jwt_hmac);
+  std::string compact = NewToken(*NewJwtHmac(), "subject");
+  for (int i = 0; i < 2; i++) {
+    EXPECT_THAT(cache
+                    ->VerifyMacAndDecode(compact, JwtValidationOptions(),
+                                         Before(kExpiration))
+                    .status(),
+                Not(IsOk()));
+  }
+  EXPECT_THAT(cache->GetStats().hits, Eq(0));
+  EXPECT_THAT(cache->GetStats().misses, Eq(2));
+}
+
+TEST(VerifiedJwtCacheTest, ExpiredTokensAreEvicted) {
+  auto jwt_hmac = NewJwtHmac();
+  auto cache = NewCache(jwt_hmac);
+  std::string compact = NewToken(*jwt_hmac, "subject");
+  JwtValidationOptions options;
+  ASSERT_THAT(
+      cache->VerifyMacAndDecode(compact, options, Before(kExpiration))
+          .status(),
+      IsOk());
+  EXPECT_THAT(cache
+                  ->VerifyMacAndDecode(compact, options,
+                                       absl::FromUnixSeconds(kExpiration))
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  VerifiedJwtCache::Stats stats = cache->GetStats();
+  EXPECT_THAT(stats.hits, Eq(0));
+  EXPECT_THAT(stats.misses, Eq(2));
+  EXPECT_THAT(stats.evictions, Eq(1));
+}
+
+TEST(VerifiedJwtCacheTest, TokensWithoutExpirationAreNotCached) {
+  auto jwt_hmac = NewJwtHmac();
+  auto cache = NewCache(jwt_hmac);
+  std::string compact =
+      jwt_hmac->ComputeMacAndEncode(R"({"sub":"subject"})", "").ValueOrDie();
+  JwtValidationOptions options;
+  options.allow_missing_expiration = true;
+  for (int i = 0; i < 2; i++) {
+    EXPECT_THAT(
+        cache->VerifyMacAndDecode(compact, options, absl::FromUnixSeconds(0))
+            .status(),
+        IsOk());
+  }
+  EXPECT_THAT(cache->GetStats().hits, Eq(0));
+}
+
+TEST(VerifiedJwtCacheTest, EvictsTokensExpiringFirst) {
+  auto jwt_hmac = NewJwtHmac();
+  // A single shard, so that all tokens compete for the same entries.
+  auto cache = NewCache(jwt_hmac, /*max_entries=*/2, /*num_shards=*/1);
+  std::string soon = NewToken(*jwt_hmac, "soon", kExpiration);
+  std::string later = NewToken(*jwt_hmac, "later", kExpiration + 100);
+  std::string latest = NewToken(*jwt_hmac, "latest", kExpiration + 200);
+  JwtValidationOptions options;
+  absl::Time now = Before(kExpiration);
+  for (const std::string& compact : {soon, later, latest}) {
+    ASSERT_THAT(cache->VerifyMacAndDecode(compact, options, now).status(),
+                IsOk());
+  }
+  EXPECT_THAT(cache->GetStats().evictions, Eq(1));
+
+  ASSERT_THAT(cache->VerifyMacAndDecode(later, options, now).status(), IsOk());
+  ASSERT_THAT(cache->VerifyMacAndDecode(latest, options, now).status(),
+              IsOk());
+  EXPECT_THAT(cache->GetStats().hits, Eq(2));
+  ASSERT_THAT(cache->VerifyMacAndDecode(soon, options, now).status(), IsOk());
+  EXPECT_THAT(cache->GetStats().hits, Eq(2));
+}
+
+TEST(VerifiedJwtCacheTest, SetJwtHmacInvalidatesEntries) {
+  auto jwt_hmac = NewJwtHmac();
+  auto cache = NewCache(jwt_hmac);
+  std::string compact = NewToken(*jwt_hmac, "subject");
+  JwtValidationOptions options;
+  ASSERT_THAT(
+      cache->VerifyMacAndDecode(compact, options, Before(kExpiration))
+          .status(),
+      IsOk());
+
+  cache->SetJwtHmac(NewJwtHmac());
+  EXPECT_THAT(
+      cache->VerifyMacAndDecode(compact, options, Before(kExpiration))
+          .status(),
+      Not(IsOk()));
+  EXPECT_THAT(cache->GetStats().hits, Eq(0));
+}
+
+TEST(VerifiedJwtCacheTest, ConcurrentVerification) {
+  auto jwt_hmac = NewJwtHmac();
+  auto cache = NewCache(jwt_hmac, /*max_entries=*/16, /*num_shards=*/4);
+  std::vector<std::string> tokens;
+  for (int i = 0; i < 32; i++) {
+    tokens.push_back(NewToken(*jwt_hmac, absl::StrCat("subject", i),
+                              kExpiration + i));
+  }
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&cache, &tokens]() {
+      for (int round = 0; round < 10; round++) {
+        for (const std::string& compact : tokens) {
+          EXPECT_THAT(cache
+                          ->VerifyMacAndDecode(compact, JwtValidationOptions(),
+                                               Before(kExpiration))
+                          .status(),
+                      IsOk());
+        }
+      }
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+  VerifiedJwtCache::Stats stats = cache->GetStats();
+  EXPECT_THAT(stats.hits + stats.misses, Eq(4 * 10 * 32));
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace tink
+}  // namespace crypto
@@ -46,6 +46,8 @@ constexpr absl::string_view kJwtHeaderContentType = "cty";
 
 // Algorithms
 constexpr absl::string_view kJwtAlgorithmHs256 = "HS256";
+constexpr absl::string_view kJwtAlgorithmHs384 = "HS384";
+constexpr absl::string_view kJwtAlgorithmHs512 = "HS512";
 constexpr absl::string_view kJwtAlgorithmEs256 = "ES256";
 constexpr absl::string_view kJwtAlgorithmRs256 = "RS256";
 
@@ -0,0 +1,153 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_KEY_POOL_H_
+#define TINK_KEY_POOL_H_
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+
+// A pool of pre-generated keys for a fixed set of key templates, for key
+// types whose key generation is slow, such as RSA. Background threads keep
+// up to 'depth' keys ready for each template, so that once the pool is
+// installed, KeysetHandle::GenerateNew() and KeysetManager take a ready key
+// instead of generating one:
+//
+//   KeyPool::Options options;
+//   options.depth = 16;
+//   auto pool_result = KeyPool::New(
+//       {SignatureKeyTemplates::RsaSsaPss3072Sha256Sha256F4()}, options);
+//   if (!pool_result.ok()) return pool_result.status();
+//   KeyPool::Install(std::move(pool_result.ValueOrDie()));
+//
+// If the pool of a template is empty, keys are generated as usual. Ready keys
+// are held serialized in util::SecretData, which is zeroized when freed.
+//
+// After a fork(), the child process discards the ready keys it copied from
+// the parent, so that both do not hand out the same keys, and starts its own
+// threads when the pool is next used.
+//
+// The threads run at the priority of the process; callers which need them to
+// yield to serving threads should lower it with the platform's facilities.
+class KeyPool {
+ public:
+  struct Options {
+    // The number of keys kept ready per key template.
+    int depth = 8;
+    // The number of threads generating keys.
+    int num_threads = 1;
+    // The time a thread waits after a key could not be generated.
+    absl::Duration retry_interval = absl::Seconds(1);
+  };
+
+  // Returns a pool for 'key_templates', which starts generating keys right
+  // away. The key templates must be different.
+  static crypto::tink::util::StatusOr<std::shared_ptr<KeyPool>> New(
+      std::vector<google::crypto::tink::KeyTemplate> key_templates,
+      const Options& options);
+
+  // Makes the global registry take new keys from 'pool'. The registry keeps
+  // the pool until another pool is installed, Install(nullptr) is called,
+  // or the registry is reset.
+  static void Install(std::shared_ptr<KeyPool> pool);
+
+  KeyPool(const KeyPool&) = delete;
+  KeyPool& operator=(const KeyPool&) = delete;
+
+  // Stops the threads, and zeroizes the keys which are still ready.
+  ~KeyPool() ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns a ready key for 'key_template', or nullptr if the pool has none.
+  // Thread-safe.
+  std::unique_ptr<google::crypto::tink::KeyData> Take(
+      const google::crypto::tink::KeyTemplate& key_template)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns the number of ready keys for 'key_template'.
+  int size(const google::crypto::tink::KeyTemplate& key_template) const
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Waits until 'depth' keys are ready for every template, for example to
+  // fill the pool before serving. Returns false on timeout.
+  bool WaitUntilFull(absl::Duration timeout) const ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns the error of the last failed key generation, or OK.
+  crypto::tink::util::Status last_error() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  // The ready keys of one key template.
+  struct TemplatePool {
+    // Serialized KeyData protos.
+    std::deque<util::SecretData> keys;
+    // The number of keys being generated.
+    int in_flight = 0;
+  };
+
+  KeyPool(std::vector<google::crypto::tink::KeyTemplate> key_templates,
+          const Options& options);
+
+  // Returns the index of 'key_template' in key_templates_, or -1.
+  int Find(const google::crypto::tink::KeyTemplate& key_template) const;
+
+  // Returns the index of the template which needs a key most, or -1 if all
+  // pools are full.
+  int NextToFill() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  bool HasWork() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  bool IsFull() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Starts the threads generating keys, unless the pool is stopped.
+  void StartThreads() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // If the process was forked since the threads were started, zeroizes the
+  // ready keys, and starts new threads.
+  void DiscardAfterFork() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  void Run() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Never changes, so it is read without holding mutex_.
+  const std::vector<google::crypto::tink::KeyTemplate> key_templates_;
+  const Options options_;
+
+  mutable absl::Mutex mutex_;
+  // The members below are mutable, as every method discards the state
+  // copied from the parent process after a fork().
+  // The pool of key_templates_[i] is pools_[i].
+  mutable std::vector<TemplatePool> pools_ ABSL_GUARDED_BY(mutex_);
+  bool stopped_ ABSL_GUARDED_BY(mutex_) = false;
+  mutable crypto::tink::util::Status last_error_ ABSL_GUARDED_BY(mutex_);
+  // The fork generation in which threads_ were started.
+  mutable uint64_t fork_generation_ ABSL_GUARDED_BY(mutex_) = 0;
+  mutable std::unique_ptr<std::vector<std::thread>> threads_
+      ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_KEY_POOL_H_
@@ -0,0 +1,82 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_KEY_USAGE_H_
+#define TINK_KEY_USAGE_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+
+// How often a key of a keyset decrypted an input of a primitive, e.g. to
+// tell after a key rotation when the old keys no longer get traffic and can
+// be disabled. A key whose count stays zero for long enough has no more
+// ciphertexts in use, as far as this primitive saw.
+struct KeyUsage {
+  uint32_t key_id = 0;
+  bool is_primary = false;
+  // The inputs which the key decrypted since the primitive was created; for
+  // streaming AEADs, the ciphertext streams which it matched.
+  int64_t decryptions = 0;
+};
+
+// Implemented by the decrypting primitives which KeysetHandle::GetPrimitive()
+// returns: Aead, HybridDecrypt and StreamingAead. Use GetKeyUsage() to query
+// a primitive.
+class KeyUsageSource {
+ public:
+  virtual ~KeyUsageSource() = default;
+
+  // Returns the usage of every key of the primitive, in no particular order.
+  virtual std::vector<KeyUsage> GetKeyUsage() const = 0;
+};
+
+// Returns the KeyUsage of the keys of a primitive obtained from a
+// KeysetHandle, or UNIMPLEMENTED if 'primitive' does not count it.
+template <class P>
+crypto::tink::util::StatusOr<std::vector<KeyUsage>> GetKeyUsage(
+    const P& primitive) {
+  const KeyUsageSource* source =
+      dynamic_cast<const KeyUsageSource*>(&primitive);
+  if (source == nullptr) {
+    return crypto::tink::util::Status(
+        crypto::tink::util::error::UNIMPLEMENTED,
+        "The primitive does not count the usage of its keys");
+  }
+  return source->GetKeyUsage();
+}
+
+// The order in which the wrappers try the RAW keys of a keyset, which have
+// no output prefix to select them by. By default they are tried in the order
+// of the keyset. If adaptive, the RAW key which last decrypted an input is
+// tried first, which after a rotation saves the trials of the keys which no
+// longer match. Streaming AEADs always try the last matching key first.
+class KeyTrialOrder {
+ public:
+  // Applies to the primitives wrapped afterwards.
+  static void SetAdaptive(bool adaptive);
+  static bool IsAdaptive();
+};
+
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_KEY_USAGE_H_
@@ -0,0 +1,166 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/keyderivation/derived_aead_cache.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "tink/aead.h"
+#include "tink/core/registry_impl.h"
+#include "tink/keyderivation/prf_based_deriver.h"
+#include "tink/keyset_handle.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "proto/prf_based_deriver.pb.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+
+using ::google::crypto::tink::KeyData;
+using ::google::crypto::tink::Keyset;
+using ::google::crypto::tink::KeyStatusType;
+using ::google::crypto::tink::PrfBasedDeriverKey;
+
+namespace {
+
+constexpr char kPrfBasedDeriverKeyTypeUrl[] =
+    "type.googleapis.com/google.crypto.tink.PrfBasedDeriverKey";
+
+// Wipes the key material of 'keyset'.
+void ZeroizeKeys(Keyset* keyset) {
+  for (Keyset::Key& key : *keyset->mutable_key()) {
+    util::SafeZeroString(key.mutable_key_data()->mutable_value());
+  }
+}
+
+}  // namespace
+
+util::StatusOr<std::unique_ptr<DerivedAeadCache>> DerivedAeadCache::New(
+    const KeysetHandle& master_keyset, int max_entries) {
+  if (max_entries <= 0) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "max_entries must be positive");
+  }
+  const Keyset& keyset = master_keyset.get_keyset();
+  std::vector<MasterKey> master_keys;
+  bool has_primary = false;
+  for (const Keyset::Key& key : keyset.key()) {
+    if (key.status() != KeyStatusType::ENABLED) continue;
+    if (key.key_data().type_url() != kPrfBasedDeriverKeyTypeUrl) {
+      return util::Status(
+          util::error::INVALID_ARGUMENT,
+          absl::StrCat("master keyset contains a key of type ",
+                       key.key_data().type_url(),
+                       " instead of a PrfBasedDeriverKey"));
+    }
+    PrfBasedDeriverKey deriver_key;
+    bool parsed = deriver_key.ParseFromString(key.key_data().value());
+    if (!parsed) {
+      return util::Status(util::error::INVALID_ARGUMENT,
+                          "could not parse a PrfBasedDeriverKey");
+    }
+    auto deriver_result = PrfBasedDeriver::New(deriver_key);
+    util::SafeZeroString(deriver_key.mutable_prf_key()->mutable_value());
+    if (!deriver_result.ok()) return deriver_result.status();
+    master_keys.push_back({key.key_id(), key.output_prefix_type(),
+                           std::move(deriver_result.ValueOrDie())});
+    if (key.key_id() == keyset.primary_key_id()) has_primary = true;
+  }
+  if (!has_primary) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "master keyset has no enabled primary key");
+  }
+  return absl::WrapUnique(new DerivedAeadCache(
+      std::move(master_keys), keyset.primary_key_id(), max_entries));
+}
+
+util::StatusOr<std::unique_ptr<Aead>> DerivedAeadCache::DeriveAead(
+    absl::string_view tenant_id) const {
+  Keyset keyset;
+  keyset.set_primary_key_id(primary_key_id_);
+  for (const MasterKey& master_key : master_keys_) {
+    auto key_data_result = master_key.deriver->DeriveKey(tenant_id);
+    if (!key_data_result.ok()) {
+      ZeroizeKeys(&keyset);
+      return key_data_result.status();
+    }
+    Keyset::Key* key = keyset.add_key();
+    *key->mutable_key_data() = std::move(key_data_result.ValueOrDie());
+    key->set_key_id(master_key.key_id);
+    key->set_status(KeyStatusType::ENABLED);
+    key->set_output_prefix_type(master_key.output_prefix_type);
+  }
+  auto aead_result = RegistryImpl::GlobalInstance().WrapKeyset<Aead>(keyset);
+  ZeroizeKeys(&keyset);
+  return aead_result;
+}
+
+util::StatusOr<std::shared_ptr<Aead>> DerivedAeadCache::GetAead(
+    absl::string_view tenant_id) {
+  std::string key(tenant_id);
+  std::shared_ptr<Aead> cached = Find(key);
+  if (cached != nullptr) return cached;
+
+  auto aead_result = DeriveAead(tenant_id);
+  if (!aead_result.ok()) return aead_result.status();
+  return Insert(key, std::move(aead_result.ValueOrDie()));
+}
+
+std::shared_ptr<Aead> DerivedAeadCache::Find(const std::string& tenant_id) {
+  absl::MutexLock lock(&mutex_);
+  auto it = aeads_.find(tenant_id);
+  if (it == aeads_.end()) {
+    stats_.misses++;
+    return nullptr;
+  }
+  stats_.hits++;
+  lru_.splice(lru_.begin(), lru_, it->second.lru_position);
+  return it->second.aead;
+}
+
+std::shared_ptr<Aead> DerivedAeadCache::Insert(const std::string& tenant_id,
+                                               std::shared_ptr<Aead> aead) {
+  absl::MutexLock lock(&mutex_);
+  // Another thread may have derived the same tenant concurrently.
+  auto it = aeads_.find(tenant_id);
+  if (it != aeads_.end()) return it->second.aead;
+  while (aeads_.size() >= static_cast<size_t>(max_entries_)) {
+    aeads_.erase(lru_.back());
+    lru_.pop_back();
+    stats_.evictions++;
+  }
+  lru_.push_front(tenant_id);
+  aeads_[tenant_id] = {aead, lru_.begin()};
+  return aead;
+}
+
+DerivedAeadCache::Stats DerivedAeadCache::GetStats() const {
+  absl::MutexLock lock(&mutex_);
+  return stats_;
+}
+
+}  // namespace tink
+}  // namespace crypto
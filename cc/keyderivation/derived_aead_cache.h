@@ -0,0 +1,133 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TINK_KEYDERIVATION_DERIVED_AEAD_CACHE_H_
+#define TINK_KEYDERIVATION_DERIVED_AEAD_CACHE_H_
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "tink/aead.h"
+#include "tink/keyderivation/prf_based_deriver.h"
+#include "tink/keyset_handle.h"
+#include "tink/util/statusor.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+
+// Provides an Aead per tenant without storing a keyset per tenant: the AEAD
+// keys of a tenant are derived on demand from its tenant id, with the
+// PrfBasedDeriverKeys of a master keyset, and the resulting primitives are
+// kept in a bounded LRU cache:
+//
+//   auto cache_result = DerivedAeadCache::New(*master_keyset_handle,
+//                                             /* max_entries= */ 10000);
+//   if (!cache_result.ok()) return cache_result.status();
+//   auto aead_result = cache_result.ValueOrDie()->GetAead(tenant_id);
+//
+// The Aead of a tenant holds one derived key per enabled key of the master
+// keyset, with the same key id, output prefix type and primary key, so that
+// the master keyset can be rotated as usual: ciphertexts made with the keys
+// derived from an older master key can be decrypted until it is disabled.
+//
+// The derived keys only live in the cached primitives, which release them
+// (and wipe those held in SecretData) once they are evicted and no longer
+// used; the serialized keys are wiped right after the primitives are
+// created. The memory thus grows with the number of recently used tenants,
+// not with the number of all tenants.
+//
+// Instances are thread-safe. They require the key managers of the derived
+// AEAD keys and the Aead wrapper to be registered, and must not be used
+// after the registry is reset.
+class DerivedAeadCache {
+ public:
+  struct Stats {
+    int64_t hits = 0;
+    int64_t misses = 0;
+    int64_t evictions = 0;
+  };
+
+  // 'master_keyset' must consist of PrfBasedDeriverKeys whose derived key
+  // templates are AEAD key templates supporting key derivation. The cache
+  // holds at most 'max_entries' tenants, which must be positive.
+  static crypto::tink::util::StatusOr<std::unique_ptr<DerivedAeadCache>> New(
+      const KeysetHandle& master_keyset, int max_entries);
+
+  DerivedAeadCache(const DerivedAeadCache&) = delete;
+  DerivedAeadCache& operator=(const DerivedAeadCache&) = delete;
+
+  // Returns the Aead of the tenant 'tenant_id', deriving its keys on a miss.
+  crypto::tink::util::StatusOr<std::shared_ptr<Aead>> GetAead(
+      absl::string_view tenant_id) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  Stats GetStats() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  // An enabled key of the master keyset.
+  struct MasterKey {
+    uint32_t key_id;
+    google::crypto::tink::OutputPrefixType output_prefix_type;
+    std::unique_ptr<PrfBasedDeriver> deriver;
+  };
+
+  struct CachedAead {
+    std::shared_ptr<Aead> aead;
+    // The position of the entry in lru_.
+    std::list<std::string>::iterator lru_position;
+  };
+
+  DerivedAeadCache(std::vector<MasterKey> master_keys, uint32_t primary_key_id,
+                   int max_entries)
+      : master_keys_(std::move(master_keys)),
+        primary_key_id_(primary_key_id),
+        max_entries_(max_entries) {}
+
+  // Derives the keys of 'tenant_id' and wraps them into an Aead.
+  crypto::tink::util::StatusOr<std::unique_ptr<Aead>> DeriveAead(
+      absl::string_view tenant_id) const;
+
+  // Returns the cached Aead for 'tenant_id', or nullptr.
+  std::shared_ptr<Aead> Find(const std::string& tenant_id)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+  // Caches 'aead' for 'tenant_id' and returns it, or the Aead another thread
+  // cached for 'tenant_id' in the meantime.
+  std::shared_ptr<Aead> Insert(const std::string& tenant_id,
+                               std::shared_ptr<Aead> aead)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  const std::vector<MasterKey> master_keys_;
+  const uint32_t primary_key_id_;
+  const int max_entries_;
+  mutable absl::Mutex mutex_;
+  std::unordered_map<std::string, CachedAead> aeads_ ABSL_GUARDED_BY(mutex_);
+  // Tenant ids, most recently used first.
+  std::list<std::string> lru_ ABSL_GUARDED_BY(mutex_);
+  Stats stats_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_KEYDERIVATION_DERIVED_AEAD_CACHE_H_
@@ -0,0 +1,237 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/keyderivation/derived_aead_cache.h"
+
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "tink/aead.h"
+#include "tink/aead/aead_key_templates.h"
+#include "tink/aead/aead_wrapper.h"
+#include "tink/aead/aes_gcm_key_manager.h"
+#include "tink/keyset_handle.h"
+#include "tink/prf/hkdf_prf_key_manager.h"
+#include "tink/registry.h"
+#include "tink/util/status.h"
+#include "tink/util/test_keyset_handle.h"
+#include "tink/util/test_matchers.h"
+#include "tink/util/test_util.h"
+#include "proto/common.pb.h"
+#include "proto/hkdf_prf.pb.h"
+#include "proto/prf_based_deriver.pb.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace {
+
+using ::crypto::tink::test::AddKeyData;
+using ::crypto::tink::test::AsKeyData;
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::google::crypto::tink::HkdfPrfKey;
+using ::google::crypto::tink::KeyData;
+using ::google::crypto::tink::Keyset;
+using ::google::crypto::tink::KeyStatusType;
+using ::google::crypto::tink::OutputPrefixType;
+using ::google::crypto::tink::PrfBasedDeriverKey;
+using ::testing::Eq;
+
+class DerivedAeadCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    Registry::Reset();
+    ASSERT_THAT(Registry::RegisterKeyTypeManager(
+                    absl::make_unique<HkdfPrfKeyManager>(), true),
+                IsOk());
+    ASSERT_THAT(Registry::RegisterKeyTypeManager(
+                    absl::make_unique<AesGcmKeyManager>(), true),
+                IsOk());
+    ASSERT_THAT(
+        Registry::RegisterPrimitiveWrapper(absl::make_unique<AeadWrapper>()),
+        IsOk());
+  }
+
+  void TearDown() override { Registry::Reset(); }
+};
+
+KeyData DeriverKey(absl::string_view prf_key_value) {
+  HkdfPrfKey prf_key;
+  prf_key.set_version(0);
+  prf_key.set_key_value(std::string(prf_key_value));
+  prf_key.mutable_params()->set_hash(::google::crypto::tink::SHA256);
+  PrfBasedDeriverKey key;
+  key.set_version(0);
+  *key.mutable_prf_key() = AsKeyData(prf_key, KeyData::SYMMETRIC);
+  *key.mutable_params()->mutable_derived_key_template() =
+      AeadKeyTemplates::Aes128Gcm();
+  KeyData key_data;
+  key_data.set_type_url(
+      "type.googleapis.com/google.crypto.tink.PrfBasedDeriverKey");
+  key_data.set_value(key.SerializeAsString());
+  key_data.set_key_material_type(KeyData::SYMMETRIC);
+  return key_data;
+}
+
+// Adds a master key with id 'key_id', making it the primary key.
+void AddMasterKey(absl::string_view prf_key_value, uint32_t key_id,
+                  Keyset* keyset) {
+  AddKeyData(DeriverKey(prf_key_value), key_id, OutputPrefixType::TINK,
+             KeyStatusType::ENABLED, keyset);
+  keyset->set_primary_key_id(key_id);
+}
+
+std::unique_ptr<DerivedAeadCache> NewCache(const Keyset& keyset,
+                                           int max_entries) {
+  auto cache_result = DerivedAeadCache::New(
+      *TestKeysetHandle::GetKeysetHandle(keyset), max_entries);
+  EXPECT_THAT(cache_result.status(), IsOk());
+  return std::move(cache_result.ValueOrDie());
+}
+
+std::string Encrypt(DerivedAeadCache* cache, absl::string_view tenant_id,
+                    absl::string_view plaintext) {
+  auto aead_result = cache->GetAead(tenant_id);
+  EXPECT_THAT(aead_result.status(), IsOk());
+  auto ciphertext_result = aead_result.ValueOrDie()->Encrypt(plaintext, "ad");
+  EXPECT_THAT(ciphertext_result.status(), IsOk());
+  return ciphertext_result.ValueOrDie();
+}
+
+util::Status Decrypt(DerivedAeadCache* cache, absl::string_view tenant_id,
+                     absl::string_view ciphertext) {
+  auto aead_result = cache->GetAead(tenant_id);
+  if (!aead_result.ok()) return aead_result.status();
+  return aead_result.ValueOrDie()->Decrypt(ciphertext, "ad").status();
+}
+
+TEST_F(DerivedAeadCacheTest, TenantsHaveDistinctKeys) {
+  Keyset keyset;
+  AddMasterKey("01234567890123456789012345678901", 42, &keyset);
+  auto cache = NewCache(keyset, 10);
+  std::string ciphertext = Encrypt(cache.get(), "tenant a", "plaintext");
+  EXPECT_THAT(Decrypt(cache.get(), "tenant a", ciphertext), IsOk());
+  EXPECT_THAT(Decrypt(cache.get(), "tenant b", ciphertext),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  // A second cache derives the same keys.
+  auto other_cache = NewCache(keyset, 10);
+  EXPECT_THAT(Decrypt(other_cache.get(), "tenant a", ciphertext), IsOk());
+}
+
+TEST_F(DerivedAeadCacheTest, CachesAeads) {
+  Keyset keyset;
+  AddMasterKey("01234567890123456789012345678901", 42, &keyset);
+  auto cache = NewCache(keyset, 2);
+  auto first_result = cache->GetAead("tenant a");
+  ASSERT_THAT(first_result.status(), IsOk());
+  auto second_result = cache->GetAead("tenant a");
+  ASSERT_THAT(second_result.status(), IsOk());
+  EXPECT_THAT(second_result.ValueOrDie(), Eq(first_result.ValueOrDie()));
+  EXPECT_THAT(cache->GetStats().hits, Eq(1));
+  EXPECT_THAT(cache->GetStats().misses, Eq(1));
+
+  ASSERT_THAT(cache->GetAead("tenant b").status(), IsOk());
+  // "tenant a" was used more recently than "tenant b", which is evicted.
+  ASSERT_THAT(cache->GetAead("tenant a").status(), IsOk());
+  ASSERT_THAT(cache->GetAead("tenant c").status(), IsOk());
+  EXPECT_THAT(cache->GetStats().evictions, Eq(1));
+  auto third_result = cache->GetAead("tenant a");
+  ASSERT_THAT(third_result.status(), IsOk());
+  EXPECT_THAT(third_result.ValueOrDie(), Eq(first_result.ValueOrDie()));
+  ASSERT_THAT(cache->GetAead("tenant b").status(), IsOk());
+  EXPECT_THAT(cache->GetStats().hits, Eq(3));
+  EXPECT_THAT(cache->GetStats().misses, Eq(4));
+  EXPECT_THAT(cache->GetStats().evictions, Eq(2));
+}
+
+TEST_F(DerivedAeadCacheTest, MasterKeyRotation) {
+  Keyset keyset;
+  AddMasterKey("01234567890123456789012345678901", 42, &keyset);
+  auto old_cache = NewCache(keyset, 10);
+  std::string old_ciphertext = Encrypt(old_cache.get(), "tenant", "a");
+
+  AddMasterKey("abcdefghijabcdefghijabcdefghijab", 43, &keyset);
+  auto new_cache = NewCache(keyset, 10);
+  std::string new_ciphertext = Encrypt(new_cache.get(), "tenant", "b");
+  EXPECT_THAT(Decrypt(new_cache.get(), "tenant", old_ciphertext), IsOk());
+  EXPECT_THAT(Decrypt(new_cache.get(), "tenant", new_ciphertext), IsOk());
+  EXPECT_THAT(Decrypt(old_cache.get(), "tenant", new_ciphertext),
+              StatusIs(util::error::INVALID_ARGUMENT));
+
+  // Once the old master key is disabled, its ciphertexts can no longer be
+  // decrypted.
+  keyset.mutable_key(0)->set_status(KeyStatusType::DISABLED);
+  auto rotated_cache = NewCache(keyset, 10);
+  EXPECT_THAT(Decrypt(rotated_cache.get(), "tenant", old_ciphertext),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(Decrypt(rotated_cache.get(), "tenant", new_ciphertext), IsOk());
+}
+
+TEST_F(DerivedAeadCacheTest, ConcurrentTenants) {
+  Keyset keyset;
+  AddMasterKey("01234567890123456789012345678901", 42, &keyset);
+  auto cache = NewCache(keyset, 5);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 8; i++) {
+    threads.emplace_back([&cache, i]() {
+      for (int j = 0; j < 20; j++) {
+        std::string tenant_id = absl::StrCat("tenant ", (i + j) % 10);
+        std::string ciphertext = Encrypt(cache.get(), tenant_id, "plaintext");
+        EXPECT_THAT(Decrypt(cache.get(), tenant_id, ciphertext), IsOk());
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  DerivedAeadCache::Stats stats = cache->GetStats();
+  EXPECT_THAT(stats.hits + stats.misses, Eq(8 * 20 * 2));
+}
+
+TEST_F(DerivedAeadCacheTest, InvalidMasterKeysets) {
+  Keyset keyset;
+  AddMasterKey("01234567890123456789012345678901", 42, &keyset);
+  EXPECT_THAT(
+      DerivedAeadCache::New(*TestKeysetHandle::GetKeysetHandle(keyset), 0)
+          .status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+
+  Keyset disabled_primary = keyset;
+  disabled_primary.mutable_key(0)->set_status(KeyStatusType::DISABLED);
+  EXPECT_THAT(DerivedAeadCache::New(
+                  *TestKeysetHandle::GetKeysetHandle(disabled_primary), 10)
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+
+  Keyset aead_keyset = keyset;
+  aead_keyset.mutable_key(0)->mutable_key_data()->set_type_url(
+      AeadKeyTemplates::Aes128Gcm().type_url());
+  EXPECT_THAT(
+      DerivedAeadCache::New(*TestKeysetHandle::GetKeysetHandle(aead_keyset),
+                            10)
+          .status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace tink
+}  // namespace crypto
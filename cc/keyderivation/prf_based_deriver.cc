@@ -0,0 +1,117 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/keyderivation/prf_based_deriver.h"
+
+#include <algorithm>
+#include <memory>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "tink/core/registry_impl.h"
+#include "tink/input_stream.h"
+#include "tink/subtle/prf/streaming_prf.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "proto/prf_based_deriver.pb.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+
+using ::google::crypto::tink::KeyData;
+using ::google::crypto::tink::KeyTemplate;
+using ::google::crypto::tink::PrfBasedDeriverKey;
+
+util::StatusOr<std::unique_ptr<PrfBasedDeriver>> PrfBasedDeriver::New(
+    const KeyData& prf_key, const KeyTemplate& key_template) {
+  auto prf_result =
+      RegistryImpl::GlobalInstance().GetPrimitive<StreamingPrf>(prf_key);
+  if (!prf_result.ok()) return prf_result.status();
+  auto key_deriver_result =
+      RegistryImpl::GlobalInstance().GetKeyDeriver(key_template.type_url());
+  if (!key_deriver_result.ok()) return key_deriver_result.status();
+  return {absl::WrapUnique(
+      new PrfBasedDeriver(std::move(prf_result.ValueOrDie()),
+                          key_deriver_result.ValueOrDie(), key_template))};
+}
+
+util::StatusOr<std::unique_ptr<PrfBasedDeriver>> PrfBasedDeriver::New(
+    const PrfBasedDeriverKey& key) {
+  return New(key.prf_key(), key.params().derived_key_template());
+}
+
+util::StatusOr<KeyData> PrfBasedDeriver::DeriveKey(
+    absl::string_view salt) const {
+  std::unique_ptr<InputStream> randomness = prf_->ComputePrf(salt);
+  return (*key_deriver_)(key_format_, randomness.get());
+}
+
+util::Status PrfBasedDeriver::DeriveKeysInto(
+    absl::Span<const absl::string_view> salts,
+    absl::Span<KeyData> keys) const {
+  for (size_t i = 0; i < salts.size(); i++) {
+    auto key_result = DeriveKey(salts[i]);
+    if (!key_result.ok()) return key_result.status();
+    keys[i] = std::move(key_result.ValueOrDie());
+  }
+  return util::OkStatus();
+}
+
+util::StatusOr<std::vector<KeyData>> PrfBasedDeriver::DeriveKeys(
+    absl::Span<const absl::string_view> salts, int num_threads) const {
+  if (num_threads < 1) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "num_threads must be positive");
+  }
+  std::vector<KeyData> keys(salts.size());
+  // Every thread derives a contiguous range of the keys, the calling thread
+  // the last one.
+  size_t num_ranges =
+      std::max<size_t>(1, std::min<size_t>(num_threads, salts.size()));
+  std::vector<util::Status> statuses(num_ranges);
+  std::vector<std::thread> threads;
+  threads.reserve(num_ranges - 1);
+  absl::Span<KeyData> keys_span = absl::MakeSpan(keys);
+  size_t begin = 0;
+  for (size_t range = 0; range < num_ranges; range++) {
+    size_t end = salts.size() * (range + 1) / num_ranges;
+    absl::Span<const absl::string_view> range_salts =
+        salts.subspan(begin, end - begin);
+    absl::Span<KeyData> range_keys = keys_span.subspan(begin, end - begin);
+    util::Status* status = &statuses[range];
+    if (range + 1 < num_ranges) {
+      threads.emplace_back([this, range_salts, range_keys, status]() {
+        *status = DeriveKeysInto(range_salts, range_keys);
+      });
+    } else {
+      *status = DeriveKeysInto(range_salts, range_keys);
+    }
+    begin = end;
+  }
+  for (std::thread& thread : threads) thread.join();
+  for (const util::Status& status : statuses) {
+    if (!status.ok()) return status;
+  }
+  return std::move(keys);
+}
+
+}  // namespace tink
+}  // namespace crypto
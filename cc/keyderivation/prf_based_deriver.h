@@ -0,0 +1,90 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_KEYDERIVATION_PRF_BASED_DERIVER_H_
+#define TINK_KEYDERIVATION_PRF_BASED_DERIVER_H_
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "tink/core/registry_impl.h"
+#include "tink/subtle/prf/streaming_prf.h"
+#include "tink/util/statusor.h"
+#include "proto/prf_based_deriver.pb.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+
+// Derives keys of a fixed key template from a salt, using the output of a
+// StreamingPrf on the salt as the randomness of the key manager of the
+// template (see RegistryImpl::DeriveKey).
+//
+// The StreamingPrf and the key deriver are looked up in the registry once,
+// in New(), so deriving a key does not access the registry. DeriveKeys
+// derives many keys on several threads, for bulk provisioning.
+//
+// Instances are thread-safe. They must not be used after the registry is
+// reset.
+class PrfBasedDeriver {
+ public:
+  // 'prf_key' must be a key for the StreamingPrf primitive, such as an
+  // HkdfPrfKey, and the key manager of 'key_template' must support key
+  // derivation.
+  static crypto::tink::util::StatusOr<std::unique_ptr<PrfBasedDeriver>> New(
+      const google::crypto::tink::KeyData& prf_key,
+      const google::crypto::tink::KeyTemplate& key_template);
+
+  static crypto::tink::util::StatusOr<std::unique_ptr<PrfBasedDeriver>> New(
+      const google::crypto::tink::PrfBasedDeriverKey& key);
+
+  // Returns the key derived from 'salt'.
+  crypto::tink::util::StatusOr<google::crypto::tink::KeyData> DeriveKey(
+      absl::string_view salt) const;
+
+  // Returns the keys derived from each of 'salts', in the same order, using
+  // up to 'num_threads' threads, including the calling one. Fails if any of
+  // the derivations fails.
+  crypto::tink::util::StatusOr<std::vector<google::crypto::tink::KeyData>>
+  DeriveKeys(absl::Span<const absl::string_view> salts, int num_threads) const;
+
+ private:
+  PrfBasedDeriver(std::unique_ptr<StreamingPrf> prf,
+                  const RegistryImpl::KeyDeriver* key_deriver,
+                  const google::crypto::tink::KeyTemplate& key_template)
+      : prf_(std::move(prf)),
+        key_deriver_(key_deriver),
+        key_format_(key_template.value()) {}
+
+  // Derives the keys for 'salts' into 'keys', which has the same size.
+  crypto::tink::util::Status DeriveKeysInto(
+      absl::Span<const absl::string_view> salts,
+      absl::Span<google::crypto::tink::KeyData> keys) const;
+
+  const std::unique_ptr<StreamingPrf> prf_;
+  // Owned by the registry.
+  const RegistryImpl::KeyDeriver* const key_deriver_;
+  const std::string key_format_;
+};
+
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_KEYDERIVATION_PRF_BASED_DERIVER_H_
@@ -0,0 +1,166 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/keyderivation/prf_based_deriver.h"
+
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "tink/aead/aead_key_templates.h"
+#include "tink/core/registry_impl.h"
+#include "tink/mac/hmac_key_manager.h"
+#include "tink/mac/mac_key_templates.h"
+#include "tink/prf/hkdf_prf_key_manager.h"
+#include "tink/registry.h"
+#include "tink/subtle/prf/streaming_prf.h"
+#include "tink/util/status.h"
+#include "tink/util/test_matchers.h"
+#include "tink/util/test_util.h"
+#include "proto/common.pb.h"
+#include "proto/hkdf_prf.pb.h"
+#include "proto/prf_based_deriver.pb.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace {
+
+using ::crypto::tink::test::AsKeyData;
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::google::crypto::tink::HkdfPrfKey;
+using ::google::crypto::tink::KeyData;
+using ::google::crypto::tink::KeyTemplate;
+using ::google::crypto::tink::PrfBasedDeriverKey;
+using ::testing::Eq;
+using ::testing::Ne;
+
+class PrfBasedDeriverTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    Registry::Reset();
+    ASSERT_THAT(Registry::RegisterKeyTypeManager(
+                    absl::make_unique<HkdfPrfKeyManager>(), true),
+                IsOk());
+    ASSERT_THAT(Registry::RegisterKeyTypeManager(
+                    absl::make_unique<HmacKeyManager>(), true),
+                IsOk());
+  }
+
+  void TearDown() override { Registry::Reset(); }
+};
+
+KeyData PrfKey() {
+  HkdfPrfKey key;
+  key.set_version(0);
+  key.set_key_value("01234567890123456789012345678901");
+  key.mutable_params()->set_hash(::google::crypto::tink::SHA256);
+  key.mutable_params()->set_salt("salt");
+  return AsKeyData(key, KeyData::SYMMETRIC);
+}
+
+// The key derived from the PRF output on 'salt' through the registry.
+KeyData ExpectedKey(const KeyTemplate& key_template, absl::string_view salt) {
+  auto prf_result = Registry::GetPrimitive<StreamingPrf>(PrfKey());
+  EXPECT_THAT(prf_result.status(), IsOk());
+  std::unique_ptr<InputStream> randomness =
+      prf_result.ValueOrDie()->ComputePrf(salt);
+  auto key_result =
+      RegistryImpl::GlobalInstance().DeriveKey(key_template, randomness.get());
+  EXPECT_THAT(key_result.status(), IsOk());
+  return key_result.ValueOrDie();
+}
+
+TEST_F(PrfBasedDeriverTest, DeriveKey) {
+  const KeyTemplate& key_template = MacKeyTemplates::HmacSha512();
+  auto deriver_result = PrfBasedDeriver::New(PrfKey(), key_template);
+  ASSERT_THAT(deriver_result.status(), IsOk());
+  const PrfBasedDeriver& deriver = *deriver_result.ValueOrDie();
+
+  auto key_result = deriver.DeriveKey("salt 1");
+  ASSERT_THAT(key_result.status(), IsOk());
+  const KeyData& key = key_result.ValueOrDie();
+  EXPECT_THAT(key.type_url(), Eq(key_template.type_url()));
+  EXPECT_THAT(key.SerializeAsString(),
+              Eq(ExpectedKey(key_template, "salt 1").SerializeAsString()));
+  EXPECT_THAT(key.value(),
+              Ne(deriver.DeriveKey("salt 2").ValueOrDie().value()));
+}
+
+TEST_F(PrfBasedDeriverTest, NewFromPrfBasedDeriverKey) {
+  PrfBasedDeriverKey key;
+  *key.mutable_prf_key() = PrfKey();
+  *key.mutable_params()->mutable_derived_key_template() =
+      MacKeyTemplates::HmacSha256();
+  auto deriver_result = PrfBasedDeriver::New(key);
+  ASSERT_THAT(deriver_result.status(), IsOk());
+  auto key_result = deriver_result.ValueOrDie()->DeriveKey("salt");
+  ASSERT_THAT(key_result.status(), IsOk());
+  EXPECT_THAT(key_result.ValueOrDie().SerializeAsString(),
+              Eq(ExpectedKey(MacKeyTemplates::HmacSha256(), "salt")
+                     .SerializeAsString()));
+}
+
+TEST_F(PrfBasedDeriverTest, DeriveKeys) {
+  auto deriver_result =
+      PrfBasedDeriver::New(PrfKey(), MacKeyTemplates::HmacSha256());
+  ASSERT_THAT(deriver_result.status(), IsOk());
+  const PrfBasedDeriver& deriver = *deriver_result.ValueOrDie();
+  std::vector<std::string> salts;
+  for (int i = 0; i < 100; i++) salts.push_back(absl::StrCat("user ", i));
+  std::vector<absl::string_view> salt_views(salts.begin(), salts.end());
+
+  for (int num_threads : {1, 3, 8, 200}) {
+    SCOPED_TRACE(num_threads);
+    auto keys_result = deriver.DeriveKeys(salt_views, num_threads);
+    ASSERT_THAT(keys_result.status(), IsOk());
+    const std::vector<KeyData>& keys = keys_result.ValueOrDie();
+    ASSERT_THAT(keys.size(), Eq(salts.size()));
+    for (size_t i = 0; i < salts.size(); i++) {
+      EXPECT_THAT(
+          keys[i].SerializeAsString(),
+          Eq(deriver.DeriveKey(salts[i]).ValueOrDie().SerializeAsString()));
+    }
+  }
+
+  auto empty_result = deriver.DeriveKeys({}, 4);
+  ASSERT_THAT(empty_result.status(), IsOk());
+  EXPECT_TRUE(empty_result.ValueOrDie().empty());
+  EXPECT_THAT(deriver.DeriveKeys(salt_views, 0).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST_F(PrfBasedDeriverTest, InvalidKeys) {
+  // Not a StreamingPrf key.
+  EXPECT_THAT(PrfBasedDeriver::New(
+                  ExpectedKey(MacKeyTemplates::HmacSha256(), "salt"),
+                  MacKeyTemplates::HmacSha256())
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  // Unregistered key type.
+  EXPECT_THAT(
+      PrfBasedDeriver::New(PrfKey(), AeadKeyTemplates::Aes128Gcm()).status(),
+      StatusIs(util::error::NOT_FOUND));
+}
+
+}  // namespace
+}  // namespace tink
+}  // namespace crypto
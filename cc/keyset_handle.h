@@ -17,14 +17,22 @@
 #ifndef TINK_KEYSET_HANDLE_H_
 #define TINK_KEYSET_HANDLE_H_
 
+#include <memory>
+
 #include "absl/base/attributes.h"
+#include "absl/base/call_once.h"
+#include "google/protobuf/arena.h"
 #include "tink/aead.h"
 #include "tink/internal/key_info.h"
 #include "tink/key_manager.h"
 #include "tink/keyset_reader.h"
 #include "tink/keyset_writer.h"
+#include "tink/memory_stats.h"
+#include "tink/primitive_cache.h"
 #include "tink/primitive_set.h"
 #include "tink/registry.h"
+#include "tink/util/statusor.h"
+#include "tink/util/validation.h"
 #include "proto/tink.pb.h"
 
 namespace crypto {
@@ -33,8 +41,23 @@ namespace tink {
 // KeysetHandle provides abstracted access to Keysets, to limit
 // the exposure of actual protocol buffers that hold sensitive
 // key material.
+//
+// The keyset of a handle is immutable and reference-counted: copies of a
+// handle share it, and its key material is wiped when the last handle (or
+// KeysetManager) referring to it is destroyed. The keyset is validated only
+// once per handle and its copies, when the first primitive is created.
 class KeysetHandle {
  public:
+  // Copies share the keyset, so copying is cheap.
+  KeysetHandle(const KeysetHandle& other)
+      : keyset_(other.keyset_), plan_cache_(other.plan_cache_) {}
+  KeysetHandle& operator=(const KeysetHandle& other) {
+    keyset_ = other.keyset_;
+    plan_cache_ = other.plan_cache_;
+    building_keyset_ = nullptr;
+    return *this;
+  }
+
   // Creates a KeysetHandle from an encrypted keyset obtained via |reader|
   // using |master_key_aead| to decrypt the keyset.
   static crypto::tink::util::StatusOr<std::unique_ptr<KeysetHandle>> Read(
@@ -60,6 +83,12 @@ class KeysetHandle {
   // key material, thus can be used for logging or monitoring.
   google::crypto::tink::KeysetInfo GetKeysetInfo() const;
 
+  // Returns the memory which the keyset of this handle holds, in
+  // MemoryStats::keyset_bytes. The keyset is shared with the copies of the
+  // handle. Primitives obtained from the handle report their own memory, see
+  // GetMemoryStats(primitive).
+  MemoryStats GetMemoryStats() const;
+
   // Writes the underlying keyset to |writer| only if the keyset does not
   // contain any secret key material.
   // This can be used to persist public keysets or envelope encryption keysets.
@@ -89,19 +118,49 @@ class KeysetHandle {
   crypto::tink::util::StatusOr<std::unique_ptr<P>> GetPrimitive(
       const KeyManager<P>* custom_manager) const;
 
+  // As GetPrimitive(), but takes the primitives for the individual keys from
+  // 'cache', creating them only if they are not cached yet. The returned
+  // primitive shares them with the cache, which must be non-null. Requires a
+  // PrimitiveWrapper<P, P> to be registered.
+  template <class P>
+  crypto::tink::util::StatusOr<std::unique_ptr<P>> GetCachedPrimitive(
+      PrimitiveCache* cache) const;
+
  private:
   // The classes below need access to get_keyset();
   friend class CleartextKeysetHandle;
+  friend class DerivedAeadCache;
   friend class KeysetManager;
+  friend class PackedKeysetStore;
+  friend class PackedKeysetStoreWriter;
+  friend class PrimitiveWarmup;
   friend class RegistryImpl;
+  template <class P>
+  friend class RotatingPrimitive;
+  template <typename P, typename... KeyTypeManagers>
+  friend class StaticKeysetPrimitive;
 
   // TestKeysetHandle::GetKeyset() provides access to get_keyset().
   friend class TestKeysetHandle;
 
+  // Creates a handle with an empty keyset, to be filled through
+  // mutable_keyset(). The keyset is allocated on an arena owned with the
+  // keyset, so the keyset, its keys and their key data share few
+  // allocations, which are freed together.
+  KeysetHandle();
   // Creates a handle that contains the given keyset.
   explicit KeysetHandle(google::crypto::tink::Keyset keyset);
   // Creates a handle that contains the given keyset.
   explicit KeysetHandle(std::unique_ptr<google::crypto::tink::Keyset> keyset);
+  // Creates a handle that shares 'keyset', which must not be modified while
+  // the handle exists.
+  explicit KeysetHandle(
+      std::shared_ptr<const google::crypto::tink::Keyset> keyset);
+
+  // Returns a reference-counted 'keyset', whose key material is wiped when
+  // the last reference is dropped.
+  static std::shared_ptr<google::crypto::tink::Keyset> NewSharedKeyset(
+      google::crypto::tink::Keyset keyset);
 
   // Helper function which generates a key from a template, then adds it
   // to the keyset. TODO(tholenst): Change this to a proper member operating
@@ -110,9 +169,19 @@ class KeysetHandle {
       const google::crypto::tink::KeyTemplate& key_template, bool as_primary,
       google::crypto::tink::Keyset* keyset);
 
+  // As above, but adds the key with id 'key_id', which must not be used in
+  // 'keyset' yet.
+  static crypto::tink::util::StatusOr<uint32_t> AddToKeyset(
+      const google::crypto::tink::KeyTemplate& key_template, bool as_primary,
+      uint32_t key_id, google::crypto::tink::Keyset* keyset);
+
   // Returns keyset held by this handle.
   const google::crypto::tink::Keyset& get_keyset() const;
 
+  // Returns the keyset of a handle created with KeysetHandle(), while it
+  // is built, i.e. before the handle is copied or returned.
+  google::crypto::tink::Keyset* mutable_keyset() { return building_keyset_; }
+
   // Creates a set of primitives corresponding to the keys with
   // (status == ENABLED) in the keyset given in 'keyset_handle',
   // assuming all the corresponding key managers are present (keys
@@ -124,7 +193,23 @@ class KeysetHandle {
   crypto::tink::util::StatusOr<std::unique_ptr<PrimitiveSet<P>>> GetPrimitives(
       const KeyManager<P>* custom_manager) const;
 
-  google::crypto::tink::Keyset keyset_;
+  // Returns PlanKeyset(get_keyset()), which is computed on the first call.
+  // Must not be called while the keyset is built through mutable_keyset().
+  const crypto::tink::util::StatusOr<KeysetPlan>& GetKeysetPlan() const;
+
+  // The memoized result of PlanKeyset(), shared with the copies of the handle
+  // since they share the keyset.
+  struct PlanCache {
+    absl::once_flag once;
+    crypto::tink::util::StatusOr<KeysetPlan> plan;
+  };
+
+  // Never null.
+  std::shared_ptr<const google::crypto::tink::Keyset> keyset_;
+  // Never null.
+  std::shared_ptr<PlanCache> plan_cache_ = std::make_shared<PlanCache>();
+  // Only set for a handle created with KeysetHandle(), see mutable_keyset().
+  google::crypto::tink::Keyset* building_keyset_ = nullptr;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -133,39 +218,40 @@ class KeysetHandle {
 template <class P>
 crypto::tink::util::StatusOr<std::unique_ptr<PrimitiveSet<P>>>
 KeysetHandle::GetPrimitives(const KeyManager<P>* custom_manager) const {
-  crypto::tink::util::Status status = ValidateKeyset(get_keyset());
-  if (!status.ok()) return status;
-  std::unique_ptr<PrimitiveSet<P>> primitives(new PrimitiveSet<P>());
-  for (const google::crypto::tink::Keyset::Key& key : get_keyset().key()) {
-    if (key.status() == google::crypto::tink::KeyStatusType::ENABLED) {
-      std::unique_ptr<P> primitive;
-      if (custom_manager != nullptr &&
-          custom_manager->DoesSupport(key.key_data().type_url())) {
-        auto primitive_result = custom_manager->GetPrimitive(key.key_data());
-        if (!primitive_result.ok()) return primitive_result.status();
-        primitive = std::move(primitive_result.ValueOrDie());
-      } else {
-        auto primitive_result = Registry::GetPrimitive<P>(key.key_data());
-        if (!primitive_result.ok()) return primitive_result.status();
-        primitive = std::move(primitive_result.ValueOrDie());
-      }
-      auto entry_result =
-          primitives->AddPrimitive(std::move(primitive), KeyInfoFromKey(key));
-      if (!entry_result.ok()) return entry_result.status();
-      if (key.key_id() == get_keyset().primary_key_id()) {
-        auto primary_result =
-            primitives->set_primary(entry_result.ValueOrDie());
-        if (!primary_result.ok()) return primary_result;
-      }
+  const crypto::tink::util::StatusOr<KeysetPlan>& plan = GetKeysetPlan();
+  if (!plan.ok()) return plan.status();
+  typename PrimitiveSet<P>::Builder primitives_builder;
+  for (int index : plan.ValueOrDie().enabled_key_indices) {
+    const google::crypto::tink::Keyset::Key& key = get_keyset().key(index);
+    std::unique_ptr<P> primitive;
+    if (custom_manager != nullptr &&
+        custom_manager->DoesSupport(key.key_data().type_url())) {
+      auto primitive_result = custom_manager->GetPrimitive(key.key_data());
+      if (!primitive_result.ok()) return primitive_result.status();
+      primitive = std::move(primitive_result.ValueOrDie());
+    } else {
+      auto primitive_result = Registry::GetPrimitive<P>(key.key_data());
+      if (!primitive_result.ok()) return primitive_result.status();
+      primitive = std::move(primitive_result.ValueOrDie());
+    }
+    if (index == plan.ValueOrDie().primary_key_index) {
+      primitives_builder.AddPrimaryPrimitive(std::move(primitive),
+                                             KeyInfoFromKey(key));
+    } else {
+      primitives_builder.AddPrimitive(std::move(primitive),
+                                      KeyInfoFromKey(key));
     }
   }
-  return std::move(primitives);
+  return primitives_builder.Build();
 }
 
 template <class P>
 crypto::tink::util::StatusOr<std::unique_ptr<P>> KeysetHandle::GetPrimitive()
     const {
-  return RegistryImpl::GlobalInstance().WrapKeyset<P>(keyset_);
+  const crypto::tink::util::StatusOr<KeysetPlan>& plan = GetKeysetPlan();
+  if (!plan.ok()) return plan.status();
+  return RegistryImpl::GlobalInstance().WrapKeyset<P>(get_keyset(),
+                                                      plan.ValueOrDie());
 }
 
 template <class P>
@@ -182,6 +268,33 @@ crypto::tink::util::StatusOr<std::unique_ptr<P>> KeysetHandle::GetPrimitive(
   return Registry::Wrap<P>(std::move(primitives_result.ValueOrDie()));
 }
 
+template <class P>
+crypto::tink::util::StatusOr<std::unique_ptr<P>>
+KeysetHandle::GetCachedPrimitive(PrimitiveCache* cache) const {
+  if (cache == nullptr) {
+    return crypto::tink::util::Status(util::error::INVALID_ARGUMENT,
+                                      "cache must not be null");
+  }
+  const crypto::tink::util::StatusOr<KeysetPlan>& plan = GetKeysetPlan();
+  if (!plan.ok()) return plan.status();
+  typename PrimitiveSet<P>::Builder primitives_builder;
+  for (int index : plan.ValueOrDie().enabled_key_indices) {
+    const google::crypto::tink::Keyset::Key& key = get_keyset().key(index);
+    auto primitive_result = cache->GetPrimitive<P>(key.key_data());
+    if (!primitive_result.ok()) return primitive_result.status();
+    if (index == plan.ValueOrDie().primary_key_index) {
+      primitives_builder.AddSharedPrimaryPrimitive(
+          std::move(primitive_result.ValueOrDie()), KeyInfoFromKey(key));
+    } else {
+      primitives_builder.AddSharedPrimitive(
+          std::move(primitive_result.ValueOrDie()), KeyInfoFromKey(key));
+    }
+  }
+  auto primitives_result = primitives_builder.Build();
+  if (!primitives_result.ok()) return primitives_result.status();
+  return Registry::Wrap<P>(std::move(primitives_result.ValueOrDie()));
+}
+
 }  // namespace tink
 }  // namespace crypto
 
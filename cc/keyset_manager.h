@@ -16,7 +16,10 @@
 #ifndef TINK_KEYSET_MANAGER_H_
 #define TINK_KEYSET_MANAGER_H_
 
+#include <memory>
+
 #include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/synchronization/mutex.h"
 #include "tink/util/status.h"
 #include "tink/util/statusor.h"
@@ -31,10 +34,15 @@ class KeysetHandle;
 // rotating, disabling, enabling, or destroying keys.
 // An instance of this class takes care of a single Keyset, that can be
 // accessed via GetKeysetHandle()-method.
+//
+// Keys are looked up by id through an index, and the handles returned by
+// GetKeysetHandle() share the keyset with the manager until it is next
+// modified, so that managing keysets with many keys does not copy the
+// keyset on every operation.
 class KeysetManager {
  public:
   // Constructs a KeysetManager with an empty Keyset.
-  KeysetManager() {}
+  KeysetManager();
 
   // Creates a new KeysetManager that contains a Keyset with a single key
   // generated freshly according the specification in 'key_template'.
@@ -95,7 +103,8 @@ class KeysetManager {
   // Returns the count of all keys in the keyset.
   int KeyCount() const;
 
-  // Returns a handle with a copy of the managed keyset.
+  // Returns a handle with a copy of the managed keyset. The copy is made
+  // lazily: the handle shares the keyset until the manager modifies it.
   std::unique_ptr<KeysetHandle> GetKeysetHandle()
       ABSL_LOCKS_EXCLUDED(keyset_mutex_);
 
@@ -104,8 +113,26 @@ class KeysetManager {
       const google::crypto::tink::KeyTemplate& key_template, bool as_primary)
       ABSL_LOCKS_EXCLUDED(keyset_mutex_);
 
+  // Returns the managed keyset for modification, after copying it if it is
+  // shared with handles.
+  google::crypto::tink::Keyset* MutableKeyset()
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(keyset_mutex_);
+
+  // Returns the index in the keyset of the key with id 'key_id', or -1.
+  int FindKey(uint32_t key_id) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(keyset_mutex_);
+
+  // Recomputes key_index_ from keyset_.
+  void RebuildKeyIndex() ABSL_EXCLUSIVE_LOCKS_REQUIRED(keyset_mutex_);
+
   mutable absl::Mutex keyset_mutex_;
-  google::crypto::tink::Keyset keyset_ ABSL_GUARDED_BY(keyset_mutex_);
+  // Shared with the handles returned by GetKeysetHandle(), and never
+  // modified while it is shared.
+  std::shared_ptr<google::crypto::tink::Keyset> keyset_
+      ABSL_GUARDED_BY(keyset_mutex_);
+  // Maps key ids to the index of the first key with that id in keyset_.
+  absl::flat_hash_map<uint32_t, int> key_index_
+      ABSL_GUARDED_BY(keyset_mutex_);
 };
 
 }  // namespace tink
@@ -0,0 +1,104 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TINK_KEYSET_REWRAPPER_H_
+#define TINK_KEYSET_REWRAPPER_H_
+
+#include <memory>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "tink/aead.h"
+#include "tink/keyset_reader.h"
+#include "tink/keyset_writer.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+
+// Re-encrypts encrypted keysets from one master key to another, for example
+// when a KMS master key is rotated:
+//
+//   auto rewrapper_result = KeysetRewrapper::New(
+//       old_master_key_aead.get(), new_master_key_aead.get(),
+//       KeysetRewrapper::Options());
+//   if (!rewrapper_result.ok()) return rewrapper_result.status();
+//   std::vector<util::Status> statuses =
+//       rewrapper_result.ValueOrDie()->RewrapAll(jobs);
+//
+// Unlike KeysetHandle::Read() followed by KeysetHandle::Write(), the
+// decrypted keyset is not parsed into a KeysetHandle: the serialized keyset
+// is re-encrypted as is, and zeroized afterwards. RewrapAll() runs up to
+// max_concurrency re-wraps at once, so that the calls to remote master keys
+// overlap.
+//
+// Instances are thread-safe.
+class KeysetRewrapper {
+ public:
+  struct Options {
+    // The number of keysets re-wrapped at once by RewrapAll(), each on its
+    // own thread.
+    int max_concurrency = 16;
+  };
+
+  // One keyset to re-wrap: the encrypted keyset read from 'reader' is
+  // re-wrapped and written to 'writer'.
+  struct Job {
+    KeysetReader* reader;
+    KeysetWriter* writer;
+  };
+
+  // Both Aeads must outlive the rewrapper.
+  static crypto::tink::util::StatusOr<std::unique_ptr<KeysetRewrapper>> New(
+      const Aead* old_master_key_aead, const Aead* new_master_key_aead,
+      const Options& options);
+
+  KeysetRewrapper(const KeysetRewrapper&) = delete;
+  KeysetRewrapper& operator=(const KeysetRewrapper&) = delete;
+
+  // Returns 'encrypted_keyset', decrypted with the old master key and
+  // encrypted with the new one. Its keyset info is kept.
+  crypto::tink::util::StatusOr<google::crypto::tink::EncryptedKeyset> Rewrap(
+      const google::crypto::tink::EncryptedKeyset& encrypted_keyset) const;
+
+  // Reads, re-wraps and writes the keyset of every job, and returns one
+  // status per job, in the order of 'jobs', so that a failed keyset does
+  // not stop the others. The readers and writers of different jobs are
+  // used concurrently.
+  std::vector<crypto::tink::util::Status> RewrapAll(
+      absl::Span<const Job> jobs) const;
+
+ private:
+  KeysetRewrapper(const Aead* old_master_key_aead,
+                  const Aead* new_master_key_aead, const Options& options)
+      : old_master_key_aead_(old_master_key_aead),
+        new_master_key_aead_(new_master_key_aead),
+        options_(options) {}
+
+  crypto::tink::util::Status RewrapJob(const Job& job) const;
+
+  const Aead* const old_master_key_aead_;
+  const Aead* const new_master_key_aead_;
+  const Options options_;
+};
+
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_KEYSET_REWRAPPER_H_
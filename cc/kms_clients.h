@@ -15,9 +15,11 @@
 #ifndef TINK_KMS_CLIENTS_H_
 #define TINK_KMS_CLIENTS_H_
 
+#include <string>
 #include <vector>
 
 #include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
 #include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
 #include "tink/kms_client.h"
@@ -59,6 +61,10 @@ class KmsClients {
   absl::Mutex clients_mutex_;
   std::vector<std::unique_ptr<KmsClient>> clients_
       ABSL_GUARDED_BY(clients_mutex_);
+  // The results of LocalGet() which found a client. Clients are never
+  // removed and new ones are appended, so these stay the first match.
+  absl::flat_hash_map<std::string, const KmsClient*> client_by_uri_
+      ABSL_GUARDED_BY(clients_mutex_);
 
   static KmsClients& GlobalInstance();
 };
@@ -17,7 +17,13 @@
 #ifndef TINK_MAC_H_
 #define TINK_MAC_H_
 
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "tink/util/status.h"
 #include "tink/util/statusor.h"
 
@@ -40,6 +46,46 @@ class Mac {
       absl::string_view mac_value,
       absl::string_view data) const = 0;
 
+  // Returns 'output_prefix' followed by the MAC of 'data' followed by
+  // 'data_suffix'. Wrappers use it to prepend the output prefix of a key, and
+  // to append the byte that LEGACY keys authenticate after the data, and
+  // implementations can override it to do so without copying the data or the
+  // MAC. The default implementation concatenates.
+  virtual crypto::tink::util::StatusOr<std::string> ComputeMacWithPrefix(
+      absl::string_view output_prefix, absl::string_view data,
+      absl::string_view data_suffix) const {
+    crypto::tink::util::StatusOr<std::string> compute_mac_result =
+        data_suffix.empty() ? ComputeMac(data)
+                            : ComputeMac(absl::StrCat(data, data_suffix));
+    if (!compute_mac_result.ok()) return compute_mac_result.status();
+    return absl::StrCat(output_prefix, compute_mac_result.ValueOrDie());
+  }
+
+  // Verifies if 'mac_value' is a correct MAC for 'data' followed by
+  // 'data_suffix'. The default implementation concatenates.
+  virtual crypto::tink::util::Status VerifyMacWithSuffix(
+      absl::string_view mac_value, absl::string_view data,
+      absl::string_view data_suffix) const {
+    if (data_suffix.empty()) return VerifyMac(mac_value, data);
+    return VerifyMac(mac_value, absl::StrCat(data, data_suffix));
+  }
+
+  // Verifies a batch of (mac, data) pairs and returns one status per pair,
+  // in the order of 'inputs'. Each status is the one VerifyMac() would
+  // return for that pair, so an invalid MAC does not affect the results of
+  // the other pairs. The default implementation calls VerifyMac() for every
+  // pair.
+  virtual std::vector<crypto::tink::util::Status> BatchVerifyMac(
+      absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs)
+      const {
+    std::vector<crypto::tink::util::Status> results;
+    results.reserve(inputs.size());
+    for (const auto& input : inputs) {
+      results.push_back(VerifyMac(input.first, input.second));
+    }
+    return results;
+  }
+
   virtual ~Mac() {}
 };
 
@@ -0,0 +1,151 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/mac/blake3_mac_key_manager.h"
+
+#include <sstream>
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "tink/config/tink_fips.h"
+#include "tink/mac.h"
+#include "tink/subtle/blake3_mac.h"
+#include "tink/util/istream_input_stream.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "tink/util/test_matchers.h"
+#include "proto/blake3_mac.pb.h"
+
+namespace crypto {
+namespace tink {
+
+namespace {
+
+using ::crypto::tink::test::IsOk;
+using ::google::crypto::tink::Blake3MacKey;
+using ::google::crypto::tink::Blake3MacKeyFormat;
+using ::testing::Eq;
+using ::testing::Not;
+using ::testing::SizeIs;
+
+Blake3MacKeyFormat ValidKeyFormat() {
+  Blake3MacKeyFormat format;
+  format.mutable_params()->set_tag_size(32);
+  format.set_key_size(32);
+  return format;
+}
+
+TEST(Blake3MacKeyManagerTest, Basics) {
+  EXPECT_THAT(Blake3MacKeyManager().get_version(), Eq(0));
+  EXPECT_THAT(Blake3MacKeyManager().get_key_type(),
+              Eq("type.googleapis.com/google.crypto.tink.Blake3MacKey"));
+  EXPECT_THAT(Blake3MacKeyManager().key_material_type(),
+              Eq(google::crypto::tink::KeyData::SYMMETRIC));
+}
+
+TEST(Blake3MacKeyManagerTest, ValidateEmptyKeyAndKeyFormat) {
+  EXPECT_THAT(Blake3MacKeyManager().ValidateKey(Blake3MacKey()), Not(IsOk()));
+  EXPECT_THAT(Blake3MacKeyManager().ValidateKeyFormat(Blake3MacKeyFormat()),
+              Not(IsOk()));
+}
+
+TEST(Blake3MacKeyManagerTest, ValidateKeyFormatKeySizes) {
+  Blake3MacKeyFormat format = ValidKeyFormat();
+  for (int key_size : {0, 16, 31, 33, 64}) {
+    format.set_key_size(key_size);
+    EXPECT_THAT(Blake3MacKeyManager().ValidateKeyFormat(format), Not(IsOk()))
+        << key_size;
+  }
+  format.set_key_size(32);
+  EXPECT_THAT(Blake3MacKeyManager().ValidateKeyFormat(format), IsOk());
+}
+
+TEST(Blake3MacKeyManagerTest, ValidateKeyFormatTagSizes) {
+  Blake3MacKeyFormat format = ValidKeyFormat();
+  for (int tag_size : {0, 10, 15, 65, 100}) {
+    format.mutable_params()->set_tag_size(tag_size);
+    EXPECT_THAT(Blake3MacKeyManager().ValidateKeyFormat(format), Not(IsOk()))
+        << tag_size;
+  }
+  for (int tag_size : {16, 32, 64}) {
+    format.mutable_params()->set_tag_size(tag_size);
+    EXPECT_THAT(Blake3MacKeyManager().ValidateKeyFormat(format), IsOk())
+        << tag_size;
+  }
+}
+
+TEST(Blake3MacKeyManagerTest, CreateKey) {
+  Blake3MacKeyFormat format = ValidKeyFormat();
+  auto key_or = Blake3MacKeyManager().CreateKey(format);
+  ASSERT_THAT(key_or.status(), IsOk());
+  EXPECT_THAT(key_or.ValueOrDie().version(), Eq(0));
+  EXPECT_THAT(key_or.ValueOrDie().key_value(), SizeIs(32));
+  EXPECT_THAT(key_or.ValueOrDie().params().tag_size(), Eq(32));
+  EXPECT_THAT(Blake3MacKeyManager().ValidateKey(key_or.ValueOrDie()), IsOk());
+}
+
+TEST(Blake3MacKeyManagerTest, ValidateKeyInvalidVersionAndTagSize) {
+  Blake3MacKey key =
+      Blake3MacKeyManager().CreateKey(ValidKeyFormat()).ValueOrDie();
+  key.set_version(1);
+  EXPECT_THAT(Blake3MacKeyManager().ValidateKey(key), Not(IsOk()));
+  key.set_version(0);
+  key.mutable_params()->set_tag_size(65);
+  EXPECT_THAT(Blake3MacKeyManager().ValidateKey(key), Not(IsOk()));
+}
+
+TEST(Blake3MacKeyManagerTest, DeriveKey) {
+  std::string bytes = "0123456789abcdef0123456789abcdef";
+  util::IstreamInputStream input_stream(
+      absl::make_unique<std::stringstream>(bytes));
+  auto key_or =
+      Blake3MacKeyManager().DeriveKey(ValidKeyFormat(), &input_stream);
+  ASSERT_THAT(key_or.status(), IsOk());
+  EXPECT_THAT(key_or.ValueOrDie().key_value(), Eq(bytes));
+  EXPECT_THAT(key_or.ValueOrDie().params().tag_size(), Eq(32));
+
+  util::IstreamInputStream short_stream(
+      absl::make_unique<std::stringstream>("0123456789abcdef"));
+  EXPECT_THAT(
+      Blake3MacKeyManager().DeriveKey(ValidKeyFormat(), &short_stream).status(),
+      Not(IsOk()));
+}
+
+TEST(Blake3MacKeyManagerTest, GetPrimitive) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  Blake3MacKey key =
+      Blake3MacKeyManager().CreateKey(ValidKeyFormat()).ValueOrDie();
+  auto manager_mac_or = Blake3MacKeyManager().GetPrimitive<Mac>(key);
+  ASSERT_THAT(manager_mac_or.status(), IsOk());
+  auto mac_value_or = manager_mac_or.ValueOrDie()->ComputeMac("some plaintext");
+  ASSERT_THAT(mac_value_or.status(), IsOk());
+
+  auto direct_mac_or = subtle::Blake3Mac::New(
+      util::SecretDataFromStringView(key.key_value()), key.params().tag_size());
+  ASSERT_THAT(direct_mac_or.status(), IsOk());
+  EXPECT_THAT(direct_mac_or.ValueOrDie()->VerifyMac(mac_value_or.ValueOrDie(),
+                                                    "some plaintext"),
+              IsOk());
+}
+
+}  // namespace
+}  // namespace tink
+}  // namespace crypto
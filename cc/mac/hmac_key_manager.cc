@@ -16,7 +16,8 @@
 
 #include "tink/mac/hmac_key_manager.h"
 
-#include <map>
+#include <cstdint>
+#include <memory>
 
 #include "absl/strings/string_view.h"
 #include "tink/mac.h"
@@ -85,37 +86,76 @@ StatusOr<HmacKey> HmacKeyManager::DeriveKey(
   return hmac_key;
 }
 
-Status HmacKeyManager::ValidateParams(const HmacParams& params) const {
+// static
+Status HmacKeyManager::ValidateParams(const HmacParams& params) {
   if (params.tag_size() < kMinTagSizeInBytes) {
     return ToStatusF(util::error::INVALID_ARGUMENT,
                      "Invalid HmacParams: tag_size %d is too small.",
                      params.tag_size());
   }
-  std::map<HashType, uint32_t> max_tag_size = {{HashType::SHA1, 20},
-                                               {HashType::SHA256, 32},
-                                               {HashType::SHA512, 64}};
-  if (max_tag_size.find(params.hash()) == max_tag_size.end()) {
-    return ToStatusF(util::error::INVALID_ARGUMENT,
-                     "Invalid HmacParams: HashType '%s' not supported.",
-                     Enums::HashName(params.hash()));
-  } else {
-    if (params.tag_size() > max_tag_size[params.hash()]) {
+  uint32_t max_tag_size;
+  switch (params.hash()) {
+    case HashType::SHA1:
+      max_tag_size = 20;
+      break;
+    case HashType::SHA256:
+      max_tag_size = 32;
+      break;
+    case HashType::SHA512:
+      max_tag_size = 64;
+      break;
+    default:
       return ToStatusF(util::error::INVALID_ARGUMENT,
-          "Invalid HmacParams: tag_size %d is too big for HashType '%s'.",
-          params.tag_size(), Enums::HashName(params.hash()));
-    }
+                       "Invalid HmacParams: HashType '%s' not supported.",
+                       Enums::HashName(params.hash()));
+  }
+  if (params.tag_size() > max_tag_size) {
+    return ToStatusF(util::error::INVALID_ARGUMENT,
+        "Invalid HmacParams: tag_size %d is too big for HashType '%s'.",
+        params.tag_size(), Enums::HashName(params.hash()));
   }
   return Status::OK;
 }
 
 Status HmacKeyManager::ValidateKey(const HmacKey& key) const {
-  Status status = ValidateVersion(key.version(), get_version());
+  return ValidateKeyFields(key.version(), key.params(),
+                           key.key_value().size());
+}
+
+// static
+Status HmacKeyManager::ValidateKeyFields(uint32_t version,
+                                         const HmacParams& params,
+                                         size_t key_size) {
+  Status status = ValidateVersion(version, /*max_expected=*/0);
   if (!status.ok()) return status;
-  if (key.key_value().size() < kMinKeySizeInBytes) {
+  if (key_size < kMinKeySizeInBytes) {
     return util::Status(util::error::INVALID_ARGUMENT,
                         "Invalid HmacKey: key_value is too short.");
   }
-  return ValidateParams(key.params());
+  return ValidateParams(params);
+}
+
+StatusOr<std::unique_ptr<Mac>> HmacKeyManager::MacFactory::CreateFromSerialized(
+    absl::string_view serialized_key) const {
+  // HmacKey {version = 1; params = 2; key_value = 3}, and
+  // HmacParams {hash = 1; tag_size = 2}.
+  internal::KeyFieldsParser key_parser;
+  internal::KeyFieldsParser params_parser;
+  if (!key_parser.Parse(serialized_key) ||
+      !params_parser.Parse(key_parser.bytes(2))) {
+    return std::unique_ptr<Mac>();
+  }
+  HmacParams params;
+  params.set_hash(
+      static_cast<HashType>(static_cast<int32_t>(params_parser.varint(1))));
+  params.set_tag_size(static_cast<uint32_t>(params_parser.varint(2)));
+  absl::string_view key_value = key_parser.bytes(3);
+  Status status = ValidateKeyFields(static_cast<uint32_t>(key_parser.varint(1)),
+                                    params, key_value.size());
+  if (!status.ok()) return status;
+  return subtle::HmacBoringSsl::New(Enums::ProtoToSubtle(params.hash()),
+                                    params.tag_size(),
+                                    util::SecretDataFromStringView(key_value));
 }
 
 // static
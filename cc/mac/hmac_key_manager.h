@@ -20,6 +20,7 @@
 
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
 #include "tink/core/key_type_manager.h"
 #include "tink/mac.h"
 #include "tink/subtle/hmac_boringssl.h"
@@ -48,6 +49,9 @@ class HmacKeyManager
           hmac_key.params().tag_size(),
           util::SecretDataFromStringView(hmac_key.key_value()));
     }
+
+    crypto::tink::util::StatusOr<std::unique_ptr<Mac>> CreateFromSerialized(
+        absl::string_view serialized_key) const override;
   };
 
   HmacKeyManager() : KeyTypeManager(absl::make_unique<MacFactory>()) {}
@@ -75,8 +79,12 @@ class HmacKeyManager
       InputStream* input_stream) const override;
 
  private:
-  crypto::tink::util::Status ValidateParams(
-      const google::crypto::tink::HmacParams& params) const;
+  static crypto::tink::util::Status ValidateParams(
+      const google::crypto::tink::HmacParams& params);
+
+  static crypto::tink::util::Status ValidateKeyFields(
+      uint32_t version, const google::crypto::tink::HmacParams& params,
+      size_t key_size);
 
   const std::string key_type_ = absl::StrCat(
       kTypeGoogleapisCom, google::crypto::tink::HmacKey().GetTypeName());
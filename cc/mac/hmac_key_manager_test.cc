@@ -283,6 +283,69 @@ TEST(HmacKeyManagerTest, GetPrimitive) {
                                                     "some plaintext"), IsOk());
 }
 
+TEST(HmacKeyManagerTest, GetPrimitiveFromSerialized) {
+  HmacKeyFormat key_format;
+  key_format.mutable_params()->set_tag_size(16);
+  key_format.mutable_params()->set_hash(HashType::SHA512);
+  key_format.set_key_size(32);
+  HmacKey key = HmacKeyManager().CreateKey(key_format).ValueOrDie();
+  auto serialized_mac_or = HmacKeyManager().GetPrimitiveFromSerialized<Mac>(
+      key.SerializeAsString());
+  ASSERT_THAT(serialized_mac_or.status(), IsOk());
+  ASSERT_THAT(serialized_mac_or.ValueOrDie(), Not(Eq(nullptr)));
+  auto mac_value_or =
+      serialized_mac_or.ValueOrDie()->ComputeMac("some plaintext");
+  ASSERT_THAT(mac_value_or.status(), IsOk());
+  EXPECT_THAT(mac_value_or.ValueOrDie(), SizeIs(16));
+
+  auto manager_mac_or = HmacKeyManager().GetPrimitive<Mac>(key);
+  ASSERT_THAT(manager_mac_or.status(), IsOk());
+  EXPECT_THAT(manager_mac_or.ValueOrDie()->VerifyMac(
+                  mac_value_or.ValueOrDie(), "some plaintext"),
+              IsOk());
+}
+
+TEST(HmacKeyManagerTest, GetPrimitiveFromSerializedValidatesKey) {
+  HmacKeyFormat key_format;
+  key_format.mutable_params()->set_tag_size(16);
+  key_format.mutable_params()->set_hash(HashType::SHA256);
+  key_format.set_key_size(16);
+  HmacKey key = HmacKeyManager().CreateKey(key_format).ValueOrDie();
+
+  HmacKey bad_key = key;
+  bad_key.set_version(1);
+  EXPECT_THAT(HmacKeyManager()
+                  .GetPrimitiveFromSerialized<Mac>(bad_key.SerializeAsString())
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  bad_key = key;
+  bad_key.mutable_params()->set_tag_size(33);
+  EXPECT_THAT(HmacKeyManager()
+                  .GetPrimitiveFromSerialized<Mac>(bad_key.SerializeAsString())
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  bad_key = key;
+  bad_key.mutable_params()->set_hash(HashType::UNKNOWN_HASH);
+  EXPECT_THAT(HmacKeyManager()
+                  .GetPrimitiveFromSerialized<Mac>(bad_key.SerializeAsString())
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  bad_key = key;
+  bad_key.set_key_value("short");
+  EXPECT_THAT(HmacKeyManager()
+                  .GetPrimitiveFromSerialized<Mac>(bad_key.SerializeAsString())
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(HmacKeyManagerTest, GetPrimitiveFromSerializedFallsBack) {
+  // Input the KeyFieldsParser does not handle gives no primitive, so that
+  // callers parse the proto instead.
+  auto mac_or = HmacKeyManager().GetPrimitiveFromSerialized<Mac>("\x1a\x05");
+  ASSERT_THAT(mac_or.status(), IsOk());
+  EXPECT_THAT(mac_or.ValueOrDie(), Eq(nullptr));
+}
+
 }  // namespace
 }  // namespace tink
 }  // namespace crypto
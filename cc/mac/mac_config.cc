@@ -20,6 +20,7 @@
 #include "tink/config/config_util.h"
 #include "tink/config/tink_fips.h"
 #include "tink/mac/aes_cmac_key_manager.h"
+#include "tink/mac/blake3_mac_key_manager.h"
 #include "tink/mac/hmac_key_manager.h"
 #include "tink/mac/mac_wrapper.h"
 #include "tink/registry.h"
@@ -46,8 +47,7 @@ util::Status MacConfig::Register() {
 
   // Register key managers which utilize the FIPS validated BoringCrypto
   // implementations.
-  status = Registry::RegisterKeyTypeManager(absl::make_unique<HmacKeyManager>(),
-                                            true);
+  status = Registry::RegisterKeyTypeManagerLazily<HmacKeyManager>(true);
   if (!status.ok()) return status;
 
   if (kUseOnlyFips) {
@@ -55,8 +55,10 @@ util::Status MacConfig::Register() {
   }
 
   // CMac in BoringSSL is not FIPS validated.
-  status = Registry::RegisterKeyTypeManager(
-      absl::make_unique<AesCmacKeyManager>(), true);
+  status = Registry::RegisterKeyTypeManagerLazily<AesCmacKeyManager>(true);
+  if (!status.ok()) return status;
+
+  status = Registry::RegisterKeyTypeManagerLazily<Blake3MacKeyManager>(true);
   if (!status.ok()) return status;
 
   return util::OkStatus();
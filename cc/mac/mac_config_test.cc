@@ -97,6 +97,7 @@ TEST_F(MacConfigTest, RegisterNonFipsTemplates) {
 
   std::list<google::crypto::tink::KeyTemplate> non_fips_key_templates;
   non_fips_key_templates.push_back(MacKeyTemplates::AesCmac());
+  non_fips_key_templates.push_back(MacKeyTemplates::Blake3());
 
   for (auto key_template : non_fips_key_templates) {
     EXPECT_THAT(KeysetHandle::GenerateNew(key_template).status(),
@@ -17,6 +17,7 @@
 #include "tink/mac/mac_key_templates.h"
 
 #include "proto/aes_cmac.pb.h"
+#include "proto/blake3_mac.pb.h"
 #include "proto/common.pb.h"
 #include "proto/hmac.pb.h"
 #include "proto/tink.pb.h"
@@ -26,6 +27,7 @@ namespace tink {
 namespace {
 
 using google::crypto::tink::AesCmacKeyFormat;
+using google::crypto::tink::Blake3MacKeyFormat;
 using google::crypto::tink::HashType;
 using google::crypto::tink::HmacKeyFormat;
 using google::crypto::tink::KeyTemplate;
@@ -57,6 +59,19 @@ KeyTemplate* NewAesCmacKeyTemplate(int key_size_in_bytes,
   return key_template;
 }
 
+KeyTemplate* NewBlake3MacKeyTemplate(int key_size_in_bytes,
+                                     int tag_size_in_bytes) {
+  KeyTemplate* key_template = new KeyTemplate;
+  key_template->set_type_url(
+      "type.googleapis.com/google.crypto.tink.Blake3MacKey");
+  key_template->set_output_prefix_type(OutputPrefixType::TINK);
+  Blake3MacKeyFormat key_format;
+  key_format.set_key_size(key_size_in_bytes);
+  key_format.mutable_params()->set_tag_size(tag_size_in_bytes);
+  key_format.SerializeToString(key_template->mutable_value());
+  return key_template;
+}
+
 }  // anonymous namespace
 
 // static
@@ -98,5 +113,12 @@ const KeyTemplate& MacKeyTemplates::AesCmac() {
   return *key_template;
 }
 
+// static
+const KeyTemplate& MacKeyTemplates::Blake3() {
+  static const KeyTemplate* key_template = NewBlake3MacKeyTemplate(
+      /* key_size_in_bytes= */ 32, /* tag_size_in_bytes= */ 32);
+  return *key_template;
+}
+
 }  // namespace tink
 }  // namespace crypto
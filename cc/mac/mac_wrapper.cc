@@ -16,9 +16,17 @@
 
 #include "tink/mac/mac_wrapper.h"
 
-#include "absl/strings/str_cat.h"
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "tink/crypto_format.h"
+#include "tink/internal/monitoring_util.h"
 #include "tink/mac.h"
+#include "tink/memory_stats.h"
+#include "tink/monitoring.h"
 #include "tink/primitive_set.h"
 #include "tink/subtle/subtle_util_boringssl.h"
 #include "tink/util/status.h"
@@ -32,10 +40,14 @@ using google::crypto::tink::OutputPrefixType;
 
 namespace {
 
-class MacSetWrapper : public Mac {
+class MacSetWrapper : public Mac, public MemoryStatsSource {
  public:
-  explicit MacSetWrapper(std::unique_ptr<PrimitiveSet<Mac>> mac_set)
-      : mac_set_(std::move(mac_set)) {}
+  MacSetWrapper(std::unique_ptr<PrimitiveSet<Mac>> mac_set,
+                PrimitiveSet<Mac>::ResolvedPrimary primary)
+      : monitoring_(
+            internal::MonitoringRecorder::ForPrimitiveSet(*mac_set, "mac")),
+        mac_set_(std::move(mac_set)),
+        primary_(primary) {}
 
   crypto::tink::util::StatusOr<std::string> ComputeMac(
       absl::string_view data) const override;
@@ -43,12 +55,34 @@ class MacSetWrapper : public Mac {
   crypto::tink::util::Status VerifyMac(absl::string_view mac_value,
                                        absl::string_view data) const override;
 
+  // Passes the inputs whose prefix matches a non-LEGACY key to that key's
+  // BatchVerifyMac(), and the others, as well as those which fail there, to
+  // VerifyMac().
+  std::vector<crypto::tink::util::Status> BatchVerifyMac(
+      absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs)
+      const override;
+
+  MemoryStats GetMemoryStats() const override {
+    return mac_set_->GetMemoryStats("mac", sizeof(*this));
+  }
+
   ~MacSetWrapper() override {}
 
  private:
+  internal::MonitoringRecorder monitoring_;
   std::unique_ptr<PrimitiveSet<Mac>> mac_set_;
+  // Resolved once, since it is used by every ComputeMac().
+  const PrimitiveSet<Mac>::ResolvedPrimary primary_;
 };
 
+// Returns the bytes that keys with 'output_prefix_type' authenticate after
+// the data: one zero byte for LEGACY keys, and none otherwise.
+absl::string_view DataSuffix(OutputPrefixType output_prefix_type) {
+  static constexpr char kLegacySuffix[] = {CryptoFormat::kLegacyStartByte};
+  if (output_prefix_type != OutputPrefixType::LEGACY) return "";
+  return absl::string_view(kLegacySuffix, sizeof(kLegacySuffix));
+}
+
 util::Status Validate(PrimitiveSet<Mac>* mac_set) {
   if (mac_set == nullptr) {
     return util::Status(util::error::INTERNAL, "mac_set must be non-NULL");
@@ -65,19 +99,19 @@ util::StatusOr<std::string> MacSetWrapper::ComputeMac(
   // BoringSSL expects a non-null pointer for data,
   // regardless of whether the size is 0.
   data = subtle::SubtleUtilBoringSSL::EnsureNonNull(data);
-
-  auto primary = mac_set_->get_primary();
-  std::string local_data;
-  if (primary->get_output_prefix_type() == OutputPrefixType::LEGACY) {
-    local_data = std::string(data);
-    local_data.append(
-        reinterpret_cast<const char*>(&CryptoFormat::kLegacyStartByte), 1);
-    data = local_data;
+  int64_t start = monitoring_.Start();
+  int64_t num_bytes = data.size();
+
+  auto compute_mac_result = primary_.primitive->ComputeMacWithPrefix(
+      primary_.output_prefix, data, DataSuffix(primary_.output_prefix_type));
+  if (!compute_mac_result.ok()) {
+    monitoring_.RecordFailure(start, MonitoringOperation::kComputeMac,
+                              num_bytes);
+    return compute_mac_result.status();
   }
-  auto compute_mac_result = primary->get_primitive().ComputeMac(data);
-  if (!compute_mac_result.ok()) return compute_mac_result.status();
-  const std::string& key_id = primary->get_identifier();
-  return key_id + compute_mac_result.ValueOrDie();
+  monitoring_.RecordSuccess(start, MonitoringOperation::kComputeMac,
+                            primary_.key_id, num_bytes);
+  return compute_mac_result;
 }
 
 util::Status MacSetWrapper::VerifyMac(
@@ -85,6 +119,7 @@ util::Status MacSetWrapper::VerifyMac(
     absl::string_view data) const {
   data = subtle::SubtleUtilBoringSSL::EnsureNonNull(data);
   mac_value = subtle::SubtleUtilBoringSSL::EnsureNonNull(mac_value);
+  int64_t start = monitoring_.Start();
 
   if (mac_value.length() > CryptoFormat::kNonRawPrefixSize) {
     absl::string_view key_id =
@@ -94,16 +129,15 @@ util::Status MacSetWrapper::VerifyMac(
       absl::string_view raw_mac_value =
           mac_value.substr(CryptoFormat::kNonRawPrefixSize);
       for (auto& mac_entry : *(primitives_result.ValueOrDie())) {
-        std::string legacy_data;
-        absl::string_view view_on_data_or_legacy_data = data;
-        if (mac_entry->get_output_prefix_type() == OutputPrefixType::LEGACY) {
-          legacy_data = absl::StrCat(data, std::string("\x00", 1));
-          view_on_data_or_legacy_data = legacy_data;
-        }
-        Mac& mac = mac_entry->get_primitive();
-        util::Status status =
-            mac.VerifyMac(raw_mac_value, view_on_data_or_legacy_data);
+        auto mac_result = mac_entry->get_primitive_or_status();
+        if (!mac_result.ok()) continue;
+        Mac& mac = *mac_result.ValueOrDie();
+        util::Status status = mac.VerifyMacWithSuffix(
+            raw_mac_value, data,
+            DataSuffix(mac_entry->get_output_prefix_type()));
         if (status.ok()) {
+          monitoring_.RecordSuccess(start, MonitoringOperation::kVerifyMac,
+                                    mac_entry->get_key_id(), data.size());
           return status;
         } else {
           // TODO(przydatek): LOG that a matching key didn't verify the MAC.
@@ -113,26 +147,101 @@ util::Status MacSetWrapper::VerifyMac(
   }
 
   // No matching key succeeded with verification, try all RAW keys.
+  monitoring_.RecordRawFallback();
   auto raw_primitives_result = mac_set_->get_raw_primitives();
   if (raw_primitives_result.ok()) {
     for (auto& mac_entry : *(raw_primitives_result.ValueOrDie())) {
-      Mac& mac = mac_entry->get_primitive();
+      auto mac_result = mac_entry->get_primitive_or_status();
+      if (!mac_result.ok()) continue;
+      Mac& mac = *mac_result.ValueOrDie();
       util::Status status = mac.VerifyMac(mac_value, data);
       if (status.ok()) {
+        monitoring_.RecordSuccess(start, MonitoringOperation::kVerifyMac,
+                                  mac_entry->get_key_id(), data.size());
         return status;
       }
     }
   }
+  monitoring_.RecordFailure(start, MonitoringOperation::kVerifyMac,
+                            data.size());
   return util::Status(util::error::INVALID_ARGUMENT, "verification failed");
 }
 
+std::vector<util::Status> MacSetWrapper::BatchVerifyMac(
+    absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs)
+    const {
+  // The inputs whose prefix matches the key 'entry' first.
+  struct Group {
+    const PrimitiveSet<Mac>::Entry<Mac>* entry;
+    std::vector<size_t> indices;
+  };
+  std::vector<Group> groups;
+  for (size_t i = 0; i < inputs.size(); i++) {
+    absl::string_view mac_value = inputs[i].first;
+    if (mac_value.length() <= CryptoFormat::kNonRawPrefixSize) continue;
+    auto primitives_result = mac_set_->get_primitives(
+        mac_value.substr(0, CryptoFormat::kNonRawPrefixSize));
+    if (!primitives_result.ok() || primitives_result.ValueOrDie()->empty()) {
+      continue;
+    }
+    const auto* entry = primitives_result.ValueOrDie()->front().get();
+    if (entry->get_output_prefix_type() == OutputPrefixType::LEGACY ||
+        !entry->get_primitive_or_status().ok()) {
+      continue;
+    }
+    // Keysets have few keys, so a linear search is fast enough.
+    auto group = std::find_if(groups.begin(), groups.end(),
+                              [entry](const Group& g) {
+                                return g.entry == entry;
+                              });
+    if (group == groups.end()) {
+      groups.push_back({entry, {}});
+      group = groups.end() - 1;
+    }
+    group->indices.push_back(i);
+  }
+
+  std::vector<util::Status> results(inputs.size());
+  std::vector<bool> verified(inputs.size(), false);
+  std::vector<std::pair<absl::string_view, absl::string_view>> raw_inputs;
+  for (const Group& group : groups) {
+    raw_inputs.clear();
+    for (size_t i : group.indices) {
+      raw_inputs.emplace_back(
+          inputs[i].first.substr(CryptoFormat::kNonRawPrefixSize),
+          subtle::SubtleUtilBoringSSL::EnsureNonNull(inputs[i].second));
+    }
+    std::vector<util::Status> statuses =
+        group.entry->get_primitive_or_status().ValueOrDie()->BatchVerifyMac(
+            raw_inputs);
+    for (size_t j = 0; j < group.indices.size(); j++) {
+      if (!statuses[j].ok()) continue;
+      size_t i = group.indices[j];
+      verified[i] = true;
+      monitoring_.RecordSuccess(monitoring_.Start(),
+                                MonitoringOperation::kVerifyMac,
+                                group.entry->get_key_id(),
+                                inputs[i].second.size());
+    }
+  }
+  // The remaining inputs may still verify with another key with the same
+  // prefix, or with a RAW key.
+  for (size_t i = 0; i < inputs.size(); i++) {
+    if (!verified[i]) results[i] = VerifyMac(inputs[i].first, inputs[i].second);
+  }
+  return results;
+}
+
 }  // namespace
 
 util::StatusOr<std::unique_ptr<Mac>> MacWrapper::Wrap(
       std::unique_ptr<PrimitiveSet<Mac>> mac_set) const {
   util::Status status = Validate(mac_set.get());
   if (!status.ok()) return status;
-  std::unique_ptr<Mac> mac(new MacSetWrapper(std::move(mac_set)));
+  auto primary_result = mac_set->ResolvePrimary();
+  if (!primary_result.ok()) return primary_result.status();
+  std::unique_ptr<Mac> mac(
+      new MacSetWrapper(std::move(mac_set), primary_result.ValueOrDie()));
   return std::move(mac);
 }
 
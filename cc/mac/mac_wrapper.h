@@ -37,6 +37,9 @@ class MacWrapper : public PrimitiveWrapper<Mac, Mac> {
  public:
   util::StatusOr<std::unique_ptr<Mac>> Wrap(
       std::unique_ptr<PrimitiveSet<Mac>> mac_set) const override;
+
+  // Primitives other than the primary are only used to verify.
+  bool SupportsLazyPrimitives() const override { return true; }
 };
 
 }  // namespace tink
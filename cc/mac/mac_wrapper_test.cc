@@ -16,6 +16,10 @@
 
 #include "tink/mac/mac_wrapper.h"
 
+#include <string>
+#include <utility>
+#include <vector>
+
 #include "gtest/gtest.h"
 #include "absl/strings/str_cat.h"
 #include "tink/crypto_format.h"
@@ -28,6 +32,7 @@
 
 using crypto::tink::test::DummyMac;
 using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
 using google::crypto::tink::KeysetInfo;
 using google::crypto::tink::KeyStatusType;
 using google::crypto::tink::OutputPrefixType;
@@ -206,6 +211,81 @@ TEST(MacWrapperTest, VerifyRawAfterLegacy) {
               IsOk());
 }
 
+// A DummyMac which counts the MACs verified with BatchVerifyMac().
+class BatchCountingMac : public DummyMac {
+ public:
+  BatchCountingMac(const std::string& mac_name, int* batch_size)
+      : DummyMac(mac_name), batch_size_(batch_size) {}
+
+  std::vector<util::Status> BatchVerifyMac(
+      absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs)
+      const override {
+    *batch_size_ += inputs.size();
+    return DummyMac::BatchVerifyMac(inputs);
+  }
+
+ private:
+  int* batch_size_;
+};
+
+TEST(MacWrapperTest, BatchVerifyMac) {
+  KeysetInfo::KeyInfo tink_key;
+  tink_key.set_output_prefix_type(OutputPrefixType::TINK);
+  tink_key.set_key_id(1234543);
+  tink_key.set_status(KeyStatusType::ENABLED);
+  KeysetInfo::KeyInfo legacy_key;
+  legacy_key.set_output_prefix_type(OutputPrefixType::LEGACY);
+  legacy_key.set_key_id(726329);
+  legacy_key.set_status(KeyStatusType::ENABLED);
+  KeysetInfo::KeyInfo raw_key;
+  raw_key.set_output_prefix_type(OutputPrefixType::RAW);
+  raw_key.set_key_id(7213743);
+  raw_key.set_status(KeyStatusType::ENABLED);
+
+  int tink_batch_size = 0;
+  int legacy_batch_size = 0;
+  std::unique_ptr<PrimitiveSet<Mac>> mac_set(new PrimitiveSet<Mac>());
+  auto tink_entry = mac_set->AddPrimitive(
+      absl::make_unique<BatchCountingMac>("tink", &tink_batch_size), tink_key);
+  ASSERT_THAT(tink_entry.status(), IsOk());
+  ASSERT_THAT(mac_set
+                  ->AddPrimitive(absl::make_unique<BatchCountingMac>(
+                                     "legacy", &legacy_batch_size),
+                                 legacy_key)
+                  .status(),
+              IsOk());
+  ASSERT_THAT(
+      mac_set->AddPrimitive(absl::make_unique<DummyMac>("raw"), raw_key)
+          .status(),
+      IsOk());
+  ASSERT_THAT(mac_set->set_primary(tink_entry.ValueOrDie()), IsOk());
+  auto mac_result = MacWrapper().Wrap(std::move(mac_set));
+  ASSERT_THAT(mac_result.status(), IsOk());
+  std::unique_ptr<Mac> mac = std::move(mac_result.ValueOrDie());
+
+  std::string tink_tag = mac->ComputeMac("a").ValueOrDie();
+  std::string other_tink_tag = mac->ComputeMac("b").ValueOrDie();
+  std::string legacy_tag = absl::StrCat(
+      CryptoFormat::GetOutputPrefix(legacy_key).ValueOrDie(),
+      DummyMac("legacy").ComputeMac(std::string("c\x00", 2)).ValueOrDie());
+  std::string raw_tag = DummyMac("raw").ComputeMac("d").ValueOrDie();
+  std::vector<std::pair<absl::string_view, absl::string_view>> inputs = {
+      {tink_tag, "a"},   {other_tink_tag, "a"}, {legacy_tag, "c"},
+      {raw_tag, "d"},    {"", "e"},             {other_tink_tag, "b"}};
+
+  std::vector<util::Status> results = mac->BatchVerifyMac(inputs);
+  ASSERT_EQ(results.size(), inputs.size());
+  EXPECT_THAT(results[0], IsOk());
+  EXPECT_THAT(results[1], StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(results[2], IsOk());
+  EXPECT_THAT(results[3], IsOk());
+  EXPECT_THAT(results[4], StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(results[5], IsOk());
+  // The TINK tags were verified together; the LEGACY key was not batched.
+  EXPECT_EQ(tink_batch_size, 3);
+  EXPECT_EQ(legacy_batch_size, 0);
+}
+
 }  // namespace
 }  // namespace tink
 }  // namespace crypto
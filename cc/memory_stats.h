@@ -0,0 +1,82 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_MEMORY_STATS_H_
+#define TINK_MEMORY_STATS_H_
+
+#include <cstddef>
+#include <map>
+#include <string>
+
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+
+// An estimate of the memory which Tink objects hold, in bytes, e.g. to size
+// caches of keysets and primitives. It counts the objects and the memory they
+// allocate, but neither the overhead of the allocator nor the memory which
+// BoringSSL allocates for contexts such as EVP_AEAD_CTX and HMAC_CTX.
+struct MemoryStats {
+  // Keyset protos, including their key material.
+  size_t keyset_bytes = 0;
+  // PrimitiveSets, their entries and the wrappers which own them, excluding
+  // the primitives.
+  size_t primitive_set_bytes = 0;
+  // The SecretData and SecretUniquePtr memory of the primitives, such as
+  // keys and key schedules.
+  size_t primitive_secret_bytes = 0;
+  // primitive_set_bytes plus primitive_secret_bytes, by the primitive name
+  // used for monitoring, e.g. "aead" or "mac".
+  std::map<std::string, size_t> bytes_by_primitive;
+
+  size_t total_bytes() const {
+    return keyset_bytes + primitive_set_bytes + primitive_secret_bytes;
+  }
+
+  // Adds the bytes of 'other', e.g. to sum up the stats of many keysets.
+  MemoryStats& operator+=(const MemoryStats& other);
+};
+
+// Implemented by the primitives which KeysetHandle::GetPrimitive() returns.
+// Use GetMemoryStats() to query a primitive.
+class MemoryStatsSource {
+ public:
+  virtual ~MemoryStatsSource() = default;
+
+  virtual MemoryStats GetMemoryStats() const = 0;
+};
+
+// Returns the MemoryStats of a primitive obtained from a KeysetHandle, or
+// UNIMPLEMENTED if 'primitive' does not report them, e.g. because it was not
+// returned by a PrimitiveWrapper of Tink.
+template <class P>
+crypto::tink::util::StatusOr<MemoryStats> GetMemoryStats(const P& primitive) {
+  const MemoryStatsSource* source =
+      dynamic_cast<const MemoryStatsSource*>(&primitive);
+  if (source == nullptr) {
+    return crypto::tink::util::Status(
+        crypto::tink::util::error::UNIMPLEMENTED,
+        "The primitive does not report its memory usage");
+  }
+  return source->GetMemoryStats();
+}
+
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_MEMORY_STATS_H_
@@ -0,0 +1,183 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_MONITORING_H_
+#define TINK_MONITORING_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+
+namespace crypto {
+namespace tink {
+
+namespace util {
+class CacheBudget;
+}  // namespace util
+
+// The operations of wrapped primitives which are monitored.
+enum class MonitoringOperation {
+  kEncrypt,
+  kDecrypt,
+  kComputeMac,
+  kVerifyMac,
+  kSign,
+  kVerify,
+  kNewEncryptingStream,
+};
+
+// One sampled operation.
+struct MonitoringSample {
+  // The kind of primitive, such as "aead" or "mac".
+  absl::string_view primitive;
+  MonitoringOperation operation;
+  // The ID of the key used, or 0 if the operation failed.
+  uint32_t key_id;
+  // The size of the input.
+  int64_t num_bytes;
+  absl::Duration latency;
+  bool ok;
+};
+
+// Counts the operations of one wrapped primitive, per key. Thread-safe.
+//
+// The counters are split into shards, and every thread adds to one shard,
+// so that concurrent operations do not contend on a cache line.
+class MonitoringKeysetCounters {
+ public:
+  struct KeyUsage {
+    uint32_t key_id;
+    // The number of successful operations with the key.
+    int64_t operations;
+    // The number of input bytes of these operations.
+    int64_t bytes;
+  };
+
+  // Counts the operations of a primitive with the keys 'key_ids'.
+  MonitoringKeysetCounters(absl::string_view primitive,
+                           std::vector<uint32_t> key_ids);
+
+  MonitoringKeysetCounters(const MonitoringKeysetCounters&) = delete;
+  MonitoringKeysetCounters& operator=(const MonitoringKeysetCounters&) =
+      delete;
+
+  const std::string& primitive() const { return primitive_; }
+
+  // Returns the usage of every key, ordered by key ID.
+  std::vector<KeyUsage> GetKeyUsage() const;
+
+  // Returns the number of failed operations.
+  int64_t failures() const { return Sum(kFailuresIndex); }
+
+  // Returns the number of decryptions and verifications which had to try the
+  // keys with output prefix type RAW, since no key matched the prefix of the
+  // input.
+  int64_t raw_fallbacks() const { return Sum(kRawFallbacksIndex); }
+
+  // Returns the index of 'key_id' for Add(), or -1 if it is not a key of the
+  // primitive.
+  int KeyIndex(uint32_t key_id) const;
+
+  // Counts a successful operation with the key at 'key_index'.
+  void Add(int key_index, int64_t num_bytes) {
+    std::atomic<int64_t>* shard = Shard();
+    int offset = kKeysIndex + 2 * key_index;
+    shard[offset].fetch_add(1, std::memory_order_relaxed);
+    shard[offset + 1].fetch_add(num_bytes, std::memory_order_relaxed);
+  }
+
+  void AddFailure() {
+    Shard()[kFailuresIndex].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void AddRawFallback() {
+    Shard()[kRawFallbacksIndex].fetch_add(1, std::memory_order_relaxed);
+  }
+
+ private:
+  static constexpr int kNumShards = 8;
+  // Number of counters per cache line.
+  static constexpr int kCountersPerLine = 64 / sizeof(std::atomic<int64_t>);
+  // Layout of a shard.
+  static constexpr int kFailuresIndex = 0;
+  static constexpr int kRawFallbacksIndex = 1;
+  static constexpr int kKeysIndex = 2;
+
+  // Returns the shard of the calling thread.
+  std::atomic<int64_t>* Shard() const {
+    return shards_ + ShardIndex() * shard_size_;
+  }
+  static int ShardIndex();
+
+  int64_t Sum(int index) const;
+
+  const std::string primitive_;
+  // Sorted.
+  const std::vector<uint32_t> key_ids_;
+  // Counters per shard, a multiple of kCountersPerLine.
+  const int shard_size_;
+  std::unique_ptr<std::atomic<int64_t>[]> counters_;
+  // The first counter of counters_ at the start of a cache line.
+  std::atomic<int64_t>* shards_;
+};
+
+// Receives the counters and sampled operations of wrapped primitives. Set it
+// with Monitoring::SetClient(); the wrappers of primitives created afterwards
+// report to it.
+class MonitoringClient {
+ public:
+  virtual ~MonitoringClient() = default;
+
+  // Returns N, so that one in N operations is passed to RecordSample().
+  // 0 disables sampling.
+  virtual int sampling_period() const { return 1000; }
+
+  // Called when a primitive set is wrapped, with the counters of its keys,
+  // for example to export them periodically.
+  virtual void AddKeysetCounters(
+      std::shared_ptr<const MonitoringKeysetCounters> counters) {}
+
+  // Called when a util::CacheBudget is created, with the budget, for example
+  // to export the memory of its caches periodically.
+  virtual void AddCacheBudget(
+      std::shared_ptr<const util::CacheBudget> budget) {}
+
+  // Called on the thread of a sampled operation, after it finished. Must be
+  // thread-safe.
+  virtual void RecordSample(const MonitoringSample& sample) = 0;
+};
+
+// Holds the installed MonitoringClient.
+class Monitoring {
+ public:
+  // Makes primitives wrapped afterwards report to 'client'. Passing nullptr
+  // disables monitoring for them. Primitives wrapped earlier keep reporting
+  // to the client which was set when they were wrapped.
+  static void SetClient(std::shared_ptr<MonitoringClient> client);
+
+  // Returns the installed client, or nullptr.
+  static std::shared_ptr<MonitoringClient> GetClient();
+};
+
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_MONITORING_H_
@@ -0,0 +1,131 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_PACKED_KEYSET_STORE_H_
+#define TINK_PACKED_KEYSET_STORE_H_
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "tink/aead.h"
+#include "tink/keyset_handle.h"
+#include "tink/random_access_stream.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+
+// A read-only store of many encrypted keysets, indexed by an ID such as a
+// tenant ID, for applications that hold more keysets than they want to
+// parse at startup. The store is a single file, written with
+// PackedKeysetStoreWriter, which is meant to be memory-mapped:
+//
+//   auto stream = util::MmapRandomAccessStream::New(
+//       fd, util::MmapRandomAccessStream::AccessPattern::kRandom)
+//           .ValueOrDie();
+//   auto store = PackedKeysetStore::New(std::move(stream),
+//                                       std::move(master_key_aead))
+//                    .ValueOrDie();
+//   ...
+//   auto handle_result = store->GetKeysetHandle(tenant_id);
+//
+// Opening a store only reads its header. A keyset is read and decrypted
+// when it is first requested, and its KeysetHandle is kept for later calls.
+//
+// The format, with all integers in big-endian:
+//
+//   header: "TINKPKS1" | uint32 number of entries | uint32 0
+//   index:  per entry, sorted by ID:
+//           uint64 entry offset | uint32 ID size | uint32 ciphertext size
+//   entries: ID | ciphertext
+//
+// where the ciphertext is the serialized Keyset, encrypted with the master
+// key AEAD and the ID as associated data. This binds each keyset to its ID,
+// so a modified index can make a lookup fail, but cannot return the keyset
+// of a different ID.
+class PackedKeysetStore {
+ public:
+  // Returns a store reading from 'stream', whose PRead() must be
+  // thread-safe, like the one of util::MmapRandomAccessStream.
+  static crypto::tink::util::StatusOr<std::unique_ptr<PackedKeysetStore>> New(
+      std::unique_ptr<crypto::tink::RandomAccessStream> stream,
+      std::unique_ptr<Aead> master_key_aead);
+
+  PackedKeysetStore(const PackedKeysetStore&) = delete;
+  PackedKeysetStore& operator=(const PackedKeysetStore&) = delete;
+
+  // Returns the keyset with the given 'id', or NOT_FOUND.
+  crypto::tink::util::StatusOr<std::shared_ptr<const KeysetHandle>>
+  GetKeysetHandle(absl::string_view id) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns the number of keysets in the store.
+  int64_t size() const { return num_entries_; }
+
+ private:
+  PackedKeysetStore(std::unique_ptr<crypto::tink::RandomAccessStream> stream,
+                    std::unique_ptr<Aead> master_key_aead, int64_t size,
+                    int64_t num_entries)
+      : stream_(std::move(stream)),
+        master_key_aead_(std::move(master_key_aead)),
+        size_(size),
+        num_entries_(num_entries) {}
+
+  // Reads and decrypts the keyset with the given 'id'.
+  crypto::tink::util::StatusOr<std::unique_ptr<KeysetHandle>> ReadKeyset(
+      absl::string_view id) const;
+
+  const std::unique_ptr<crypto::tink::RandomAccessStream> stream_;
+  const std::unique_ptr<Aead> master_key_aead_;
+  const int64_t size_;
+  const int64_t num_entries_;
+
+  absl::Mutex mutex_;
+  absl::flat_hash_map<std::string, std::shared_ptr<const KeysetHandle>>
+      handles_ ABSL_GUARDED_BY(mutex_);
+};
+
+// Writes the file of a PackedKeysetStore.
+class PackedKeysetStoreWriter {
+ public:
+  // 'master_key_aead' must outlive the writer.
+  explicit PackedKeysetStoreWriter(const Aead* master_key_aead)
+      : master_key_aead_(master_key_aead) {}
+
+  // Encrypts the keyset of 'keyset_handle' and adds it with the given 'id',
+  // which must not be added already.
+  crypto::tink::util::Status Add(absl::string_view id,
+                                 const KeysetHandle& keyset_handle);
+
+  // Returns the contents of the file of a store with the keysets added.
+  crypto::tink::util::StatusOr<std::string> Write() const;
+
+ private:
+  const Aead* const master_key_aead_;
+  // The ciphertext of each keyset, by ID.
+  std::map<std::string, std::string> ciphertexts_;
+};
+
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_PACKED_KEYSET_STORE_H_
@@ -0,0 +1,187 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_PER_NODE_PRIMITIVE_H_
+#define TINK_PER_NODE_PRIMITIVE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+#include "tink/internal/hazard_pointers.h"
+#include "tink/internal/numa.h"
+#include "tink/keyset_handle.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+
+// A primitive of type P with one replica per NUMA node of the host, so that
+// the key schedules and primitive sets used by a thread are in the memory of
+// its own socket:
+//
+//   auto aead_result = PerNodePrimitive<Aead>::New(*keyset_handle);
+//   ...
+//   auto ciphertext_result =
+//       aead_result.ValueOrDie()->Get()->Encrypt(plaintext, associated_data);
+//
+// Every replica is built with KeysetHandle::GetPrimitive<P>() on a thread
+// bound to the CPUs of its node, so that its memory is allocated there.
+// Get() returns the replica of the node the calling thread runs on.
+//
+// Update() replaces all replicas with ones for a new keyset, and publishes
+// them at once, so that no two threads use replicas of different keysets
+// after it returned. To reload a keyset periodically, call Update() from the
+// reloading thread. Like RotatingPrimitive, Get() never blocks, and replaced
+// replicas are deleted once no caller uses them anymore.
+//
+// On hosts with one node, there is one replica, built on the calling thread.
+template <class P>
+class PerNodePrimitive {
+ private:
+  // One generation of replicas, indexed by node.
+  struct Replicas {
+    std::vector<std::unique_ptr<P>> primitives;
+  };
+
+ public:
+  // A reference to a replica, which stays valid while the Handle exists,
+  // also if the replicas are updated.
+  class Handle {
+   public:
+    P* get() const { return primitive_; }
+    P* operator->() const { return primitive_; }
+    P& operator*() const { return *primitive_; }
+
+   private:
+    friend class PerNodePrimitive;
+
+    Handle(const PerNodePrimitive& per_node_primitive, int node)
+        : holder_(&per_node_primitive.hazard_pointers_),
+          primitive_(static_cast<Replicas*>(
+                         holder_.Protect(per_node_primitive.current_))
+                         ->primitives[node]
+                         .get()) {}
+
+    internal::HazardPointerDomain::Holder holder_;
+    P* primitive_;
+  };
+
+  // Returns replicas of the primitive of 'handle' for the NUMA nodes of the
+  // host.
+  static crypto::tink::util::StatusOr<std::unique_ptr<PerNodePrimitive<P>>>
+  New(const KeysetHandle& handle) {
+    return New(handle, internal::NumaTopology::Get());
+  }
+
+  // As above, with replicas for the nodes of 'topology'.
+  static crypto::tink::util::StatusOr<std::unique_ptr<PerNodePrimitive<P>>>
+  New(const KeysetHandle& handle, const internal::NumaTopology& topology) {
+    auto per_node_primitive =
+        absl::WrapUnique(new PerNodePrimitive<P>(topology));
+    util::Status status = per_node_primitive->Update(handle);
+    if (!status.ok()) return status;
+    return std::move(per_node_primitive);
+  }
+
+  PerNodePrimitive(const PerNodePrimitive&) = delete;
+  PerNodePrimitive& operator=(const PerNodePrimitive&) = delete;
+
+  // There must be no Handles anymore.
+  ~PerNodePrimitive() {
+    delete static_cast<Replicas*>(current_.load(std::memory_order_acquire));
+  }
+
+  // Returns the replica of the node of the calling thread. Thread-safe and
+  // lock-free.
+  Handle Get() const { return Handle(*this, topology_.CurrentNode()); }
+
+  // Returns the replica of 'node', which must be less than num_nodes().
+  Handle GetForNode(int node) const { return Handle(*this, node); }
+
+  // Builds replicas for the keyset of 'handle' and publishes them, if the
+  // keyset differs from the current one. If a replica cannot be built, the
+  // current replicas stay in use. Thread-safe.
+  crypto::tink::util::Status Update(const KeysetHandle& handle)
+      ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock lock(&mutex_);
+    // The keyset info changes with every rotation, and does not hold key
+    // material.
+    std::string keyset_info = handle.GetKeysetInfo().SerializeAsString();
+    if (current_.load(std::memory_order_relaxed) != nullptr &&
+        keyset_info == keyset_info_) {
+      return util::OkStatus();
+    }
+    auto replicas = absl::make_unique<Replicas>();
+    replicas->primitives.resize(topology_.num_nodes());
+    for (int node = 0; node < topology_.num_nodes(); node++) {
+      util::Status status;
+      topology_.RunOnNode(node, [&handle, &replicas, &status, node]() {
+        auto primitive_result = handle.GetPrimitive<P>();
+        if (!primitive_result.ok()) {
+          status = primitive_result.status();
+          return;
+        }
+        replicas->primitives[node] = std::move(primitive_result.ValueOrDie());
+      });
+      if (!status.ok()) return status;
+    }
+    void* previous =
+        current_.exchange(replicas.release(), std::memory_order_seq_cst);
+    keyset_info_ = std::move(keyset_info);
+    generation_.fetch_add(1, std::memory_order_relaxed);
+    if (previous != nullptr) {
+      hazard_pointers_.Retire(previous, [](void* replicas) {
+        delete static_cast<Replicas*>(replicas);
+      });
+    }
+    return util::OkStatus();
+  }
+
+  // Returns the number of replicas.
+  int num_nodes() const { return topology_.num_nodes(); }
+
+  // Returns the number of times new replicas were published.
+  int64_t generation() const {
+    return generation_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  explicit PerNodePrimitive(const internal::NumaTopology& topology)
+      : topology_(topology) {}
+
+  const internal::NumaTopology topology_;
+
+  // The current replicas, a Replicas* owned by this object.
+  std::atomic<void*> current_{nullptr};
+  std::atomic<int64_t> generation_{0};
+  mutable internal::HazardPointerDomain hazard_pointers_;
+
+  absl::Mutex mutex_;
+  std::string keyset_info_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_PER_NODE_PRIMITIVE_H_
@@ -0,0 +1,126 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/prf/blake3_prf_key_manager.h"
+
+#include <sstream>
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "tink/config/tink_fips.h"
+#include "tink/prf/prf_set.h"
+#include "tink/subtle/blake3_mac.h"
+#include "tink/util/istream_input_stream.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "tink/util/test_matchers.h"
+#include "proto/blake3_prf.pb.h"
+
+namespace crypto {
+namespace tink {
+
+namespace {
+
+using ::crypto::tink::test::IsOk;
+using ::google::crypto::tink::Blake3PrfKey;
+using ::google::crypto::tink::Blake3PrfKeyFormat;
+using ::testing::Eq;
+using ::testing::Not;
+using ::testing::SizeIs;
+
+Blake3PrfKeyFormat ValidKeyFormat() {
+  Blake3PrfKeyFormat format;
+  format.set_key_size(32);
+  return format;
+}
+
+TEST(Blake3PrfKeyManagerTest, Basics) {
+  EXPECT_THAT(Blake3PrfKeyManager().get_version(), Eq(0));
+  EXPECT_THAT(Blake3PrfKeyManager().get_key_type(),
+              Eq("type.googleapis.com/google.crypto.tink.Blake3PrfKey"));
+  EXPECT_THAT(Blake3PrfKeyManager().key_material_type(),
+              Eq(google::crypto::tink::KeyData::SYMMETRIC));
+}
+
+TEST(Blake3PrfKeyManagerTest, ValidateKeyFormat) {
+  EXPECT_THAT(Blake3PrfKeyManager().ValidateKeyFormat(Blake3PrfKeyFormat()),
+              Not(IsOk()));
+  Blake3PrfKeyFormat format = ValidKeyFormat();
+  EXPECT_THAT(Blake3PrfKeyManager().ValidateKeyFormat(format), IsOk());
+  format.set_key_size(16);
+  EXPECT_THAT(Blake3PrfKeyManager().ValidateKeyFormat(format), Not(IsOk()));
+  format = ValidKeyFormat();
+  format.set_version(1);
+  EXPECT_THAT(Blake3PrfKeyManager().ValidateKeyFormat(format), Not(IsOk()));
+}
+
+TEST(Blake3PrfKeyManagerTest, CreateAndValidateKey) {
+  EXPECT_THAT(Blake3PrfKeyManager().ValidateKey(Blake3PrfKey()), Not(IsOk()));
+  auto key_or = Blake3PrfKeyManager().CreateKey(ValidKeyFormat());
+  ASSERT_THAT(key_or.status(), IsOk());
+  Blake3PrfKey key = key_or.ValueOrDie();
+  EXPECT_THAT(key.key_value(), SizeIs(32));
+  EXPECT_THAT(Blake3PrfKeyManager().ValidateKey(key), IsOk());
+  key.set_version(1);
+  EXPECT_THAT(Blake3PrfKeyManager().ValidateKey(key), Not(IsOk()));
+}
+
+TEST(Blake3PrfKeyManagerTest, DeriveKey) {
+  std::string bytes = "0123456789abcdef0123456789abcdef";
+  util::IstreamInputStream input_stream(
+      absl::make_unique<std::stringstream>(bytes));
+  auto key_or =
+      Blake3PrfKeyManager().DeriveKey(ValidKeyFormat(), &input_stream);
+  ASSERT_THAT(key_or.status(), IsOk());
+  EXPECT_THAT(key_or.ValueOrDie().key_value(), Eq(bytes));
+
+  util::IstreamInputStream short_stream(
+      absl::make_unique<std::stringstream>("0123456789abcdef"));
+  EXPECT_THAT(
+      Blake3PrfKeyManager().DeriveKey(ValidKeyFormat(), &short_stream).status(),
+      Not(IsOk()));
+}
+
+TEST(Blake3PrfKeyManagerTest, GetPrimitive) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  Blake3PrfKey key =
+      Blake3PrfKeyManager().CreateKey(ValidKeyFormat()).ValueOrDie();
+  auto prf_or = Blake3PrfKeyManager().GetPrimitive<Prf>(key);
+  ASSERT_THAT(prf_or.status(), IsOk());
+  auto prf_value_or = prf_or.ValueOrDie()->Compute("some plaintext", 48);
+  ASSERT_THAT(prf_value_or.status(), IsOk());
+  EXPECT_THAT(prf_or.ValueOrDie()
+                  ->Compute("some plaintext",
+                            Blake3PrfKeyManager::MaxOutputLength() + 1)
+                  .status(),
+              Not(IsOk()));
+
+  // The PRF is the extendable output of the keyed hash, i.e. a long MAC.
+  auto mac_or = subtle::Blake3Mac::New(
+      util::SecretDataFromStringView(key.key_value()), 48);
+  ASSERT_THAT(mac_or.status(), IsOk());
+  EXPECT_THAT(mac_or.ValueOrDie()->ComputeMac("some plaintext").ValueOrDie(),
+              Eq(prf_value_or.ValueOrDie()));
+}
+
+}  // namespace
+}  // namespace tink
+}  // namespace crypto
@@ -23,9 +23,9 @@
 #include "tink/core/key_type_manager.h"
 #include "tink/key_manager.h"
 #include "tink/subtle/common_enums.h"
+#include "tink/subtle/hmac_batch_boringssl.h"
 #include "tink/subtle/prf/prf_set_util.h"
 #include "tink/subtle/random.h"
-#include "tink/subtle/stateful_hmac_boringssl.h"
 #include "tink/util/constants.h"
 #include "tink/util/enums.h"
 #include "tink/util/errors.h"
@@ -47,11 +47,12 @@ class HmacPrfKeyManager
   class PrfFactory : public PrimitiveFactory<Prf> {
     crypto::tink::util::StatusOr<std::unique_ptr<Prf>> Create(
         const google::crypto::tink::HmacPrfKey& key) const override {
-      return subtle::CreatePrfFromStatefulMacFactory(
-          absl::make_unique<subtle::StatefulHmacBoringSslFactory>(
-              util::Enums::ProtoToSubtle(key.params().hash()),
-              MaxOutputLength(util::Enums::ProtoToSubtle(key.params().hash())),
-              util::SecretDataFromStringView(key.key_value())));
+      auto hmac_result = subtle::HmacBatchBoringSsl::New(
+          util::Enums::ProtoToSubtle(key.params().hash()),
+          util::SecretDataFromStringView(key.key_value()));
+      if (!hmac_result.ok()) return hmac_result.status();
+      return subtle::CreatePrfFromHmacBatch(
+          std::move(hmac_result.ValueOrDie()));
     }
   };
 
@@ -0,0 +1,124 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/prf/prf_bucketer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "tink/prf/prf_set.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+
+using ::crypto::tink::util::Status;
+using ::crypto::tink::util::StatusOr;
+
+namespace {
+
+// The number of hashes BucketBatch() computes at a time, on the stack.
+constexpr size_t kBucketBatchSize = 64;
+
+Status ValidateNumBuckets(int32_t num_buckets) {
+  if (num_buckets <= 0) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "num_buckets must be positive");
+  }
+  return util::OkStatus();
+}
+
+}  // namespace
+
+// static
+StatusOr<std::unique_ptr<PrfBucketer>> PrfBucketer::New(
+    std::unique_ptr<PrfSet> prf_set) {
+  if (prf_set == nullptr) {
+    return Status(util::error::INVALID_ARGUMENT, "prf_set must be non-null");
+  }
+  const auto& prfs = prf_set->GetPrfs();
+  auto prf_it = prfs.find(prf_set->GetPrimaryId());
+  if (prf_it == prfs.end() || prf_it->second == nullptr) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "PrfSet has no PRF for primary ID.");
+  }
+  const Prf* primary_prf = prf_it->second;
+  return {absl::WrapUnique(new PrfBucketer(std::move(prf_set), primary_prf))};
+}
+
+StatusOr<uint64_t> PrfBucketer::Hash(absl::string_view input) const {
+  return primary_prf_->ComputeUint64(input);
+}
+
+Status PrfBucketer::HashBatch(absl::Span<const absl::string_view> inputs,
+                              absl::Span<uint64_t> hashes) const {
+  return primary_prf_->ComputeUint64Batch(inputs, hashes);
+}
+
+StatusOr<int32_t> PrfBucketer::Bucket(absl::string_view input,
+                                      int32_t num_buckets) const {
+  Status status = ValidateNumBuckets(num_buckets);
+  if (!status.ok()) return status;
+  auto hash_result = primary_prf_->ComputeUint64(input);
+  if (!hash_result.ok()) return hash_result.status();
+  return JumpConsistentHash(hash_result.ValueOrDie(), num_buckets);
+}
+
+Status PrfBucketer::BucketBatch(absl::Span<const absl::string_view> inputs,
+                                int32_t num_buckets,
+                                absl::Span<int32_t> buckets) const {
+  Status status = ValidateNumBuckets(num_buckets);
+  if (!status.ok()) return status;
+  if (buckets.size() != inputs.size()) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "buckets must have the size of inputs");
+  }
+  uint64_t hashes[kBucketBatchSize];
+  for (size_t i = 0; i < inputs.size(); i += kBucketBatchSize) {
+    size_t count = std::min(kBucketBatchSize, inputs.size() - i);
+    status = primary_prf_->ComputeUint64Batch(inputs.subspan(i, count),
+                                              absl::MakeSpan(hashes, count));
+    if (!status.ok()) return status;
+    for (size_t j = 0; j < count; j++) {
+      buckets[i + j] = JumpConsistentHash(hashes[j], num_buckets);
+    }
+  }
+  return util::OkStatus();
+}
+
+// static
+int32_t PrfBucketer::JumpConsistentHash(uint64_t key, int32_t num_buckets) {
+  int64_t bucket = -1;
+  int64_t next = 0;
+  while (next < num_buckets) {
+    bucket = next;
+    key = key * 2862933555777941757ULL + 1;
+    next = static_cast<int64_t>((bucket + 1) *
+                                (static_cast<double>(1LL << 31) /
+                                 static_cast<double>((key >> 33) + 1)));
+  }
+  return static_cast<int32_t>(bucket);
+}
+
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,87 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TINK_PRF_PRF_BUCKETER_H_
+#define TINK_PRF_PRF_BUCKETER_H_
+
+#include <cstdint>
+#include <memory>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "tink/prf/prf_set.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+
+// PrfBucketer assigns inputs, such as user IDs, to shards or experiment
+// buckets with a keyed hash, so that the assignment cannot be predicted or
+// steered without the key. It uses the primary PRF of a PrfSet, which is
+// resolved once, and computes 64-bit PRF values with Prf::ComputeUint64(),
+// which for AES-CMAC-PRF and HMAC-PRF keys allocates nothing. AES-CMAC-PRF is
+// the fastest, in particular for batches, whose CMACs are computed in
+// parallel lanes.
+//
+// Buckets are assigned with jump consistent hashing, so that when the number
+// of buckets grows from n to n + 1, only a fraction 1 / (n + 1) of the inputs
+// move, all of them to the new bucket.
+//
+// Instances are immutable and thread-safe.
+class PrfBucketer {
+ public:
+  static crypto::tink::util::StatusOr<std::unique_ptr<PrfBucketer>> New(
+      std::unique_ptr<PrfSet> prf_set);
+
+  // Returns the 64-bit keyed hash of 'input', see Prf::ComputeUint64().
+  crypto::tink::util::StatusOr<uint64_t> Hash(absl::string_view input) const;
+
+  // Stores the keyed hash of inputs[i] in hashes[i]. 'hashes' must have the
+  // size of 'inputs'.
+  crypto::tink::util::Status HashBatch(
+      absl::Span<const absl::string_view> inputs,
+      absl::Span<uint64_t> hashes) const;
+
+  // Returns the bucket of 'input' among 'num_buckets' buckets, which must be
+  // positive, in the range [0, num_buckets).
+  crypto::tink::util::StatusOr<int32_t> Bucket(absl::string_view input,
+                                               int32_t num_buckets) const;
+
+  // Stores the bucket of inputs[i] among 'num_buckets' buckets in
+  // buckets[i]. 'buckets' must have the size of 'inputs'.
+  crypto::tink::util::Status BucketBatch(
+      absl::Span<const absl::string_view> inputs, int32_t num_buckets,
+      absl::Span<int32_t> buckets) const;
+
+  // The jump consistent hash of Lamping and Veach
+  // (https://arxiv.org/abs/1406.2294): maps 'key' to a bucket in
+  // [0, num_buckets), which must be positive.
+  static int32_t JumpConsistentHash(uint64_t key, int32_t num_buckets);
+
+ private:
+  PrfBucketer(std::unique_ptr<PrfSet> prf_set, const Prf* primary_prf)
+      : prf_set_(std::move(prf_set)), primary_prf_(primary_prf) {}
+
+  const std::unique_ptr<PrfSet> prf_set_;
+  const Prf* const primary_prf_;
+};
+
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_PRF_PRF_BUCKETER_H_
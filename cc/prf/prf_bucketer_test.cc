@@ -0,0 +1,182 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/prf/prf_bucketer.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "tink/prf/prf_set.h"
+#include "tink/subtle/aes_cmac_batch_boringssl.h"
+#include "tink/subtle/prf/prf_set_util.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/test_matchers.h"
+
+namespace crypto {
+namespace tink {
+namespace {
+
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+
+// A PrfSet with a single AES-CMAC PRF.
+class AesCmacPrfSet : public PrfSet {
+ public:
+  AesCmacPrfSet() {
+    prf_ = subtle::CreatePrfFromAesCmacBatch(
+        std::move(subtle::AesCmacBatchBoringSsl::New(
+                      util::SecretDataFromStringView("0123456789abcdef"))
+                      .ValueOrDie()));
+    prfs_[7] = prf_.get();
+  }
+  uint32_t GetPrimaryId() const override { return 7; }
+  const std::map<uint32_t, Prf*>& GetPrfs() const override { return prfs_; }
+
+ private:
+  std::unique_ptr<Prf> prf_;
+  std::map<uint32_t, Prf*> prfs_;
+};
+
+class NoPrimaryPrfSet : public PrfSet {
+ public:
+  uint32_t GetPrimaryId() const override { return 1; }
+  const std::map<uint32_t, Prf*>& GetPrfs() const override { return prfs_; }
+
+ private:
+  std::map<uint32_t, Prf*> prfs_;
+};
+
+std::unique_ptr<PrfBucketer> NewBucketer() {
+  auto bucketer_result = PrfBucketer::New(absl::make_unique<AesCmacPrfSet>());
+  EXPECT_THAT(bucketer_result.status(), IsOk());
+  return std::move(bucketer_result.ValueOrDie());
+}
+
+std::vector<std::string> GetInputs(int count) {
+  std::vector<std::string> inputs;
+  for (int i = 0; i < count; i++) inputs.push_back(absl::StrCat("user", i));
+  return inputs;
+}
+
+TEST(PrfBucketerTest, Hash) {
+  auto bucketer = NewBucketer();
+  AesCmacPrfSet prf_set;
+  auto hash_result = bucketer->Hash("user");
+  ASSERT_THAT(hash_result.status(), IsOk());
+  EXPECT_EQ(prf_set.GetPrfs().at(7)->ComputeUint64("user").ValueOrDie(),
+            hash_result.ValueOrDie());
+  EXPECT_NE(hash_result.ValueOrDie(), bucketer->Hash("other").ValueOrDie());
+
+  std::vector<std::string> input_strings = GetInputs(100);
+  std::vector<absl::string_view> inputs(input_strings.begin(),
+                                        input_strings.end());
+  std::vector<uint64_t> hashes(inputs.size());
+  ASSERT_THAT(bucketer->HashBatch(inputs, absl::MakeSpan(hashes)), IsOk());
+  for (size_t i = 0; i < inputs.size(); i++) {
+    EXPECT_EQ(bucketer->Hash(inputs[i]).ValueOrDie(), hashes[i]);
+  }
+}
+
+TEST(PrfBucketerTest, Bucket) {
+  auto bucketer = NewBucketer();
+  std::vector<std::string> input_strings = GetInputs(10000);
+  std::vector<absl::string_view> inputs(input_strings.begin(),
+                                        input_strings.end());
+  std::vector<int32_t> buckets(inputs.size());
+  ASSERT_THAT(bucketer->BucketBatch(inputs, 10, absl::MakeSpan(buckets)),
+              IsOk());
+  std::vector<int> counts(10);
+  for (size_t i = 0; i < inputs.size(); i++) {
+    auto bucket_result = bucketer->Bucket(inputs[i], 10);
+    ASSERT_THAT(bucket_result.status(), IsOk());
+    EXPECT_EQ(bucket_result.ValueOrDie(), buckets[i]);
+    ASSERT_GE(buckets[i], 0);
+    ASSERT_LT(buckets[i], 10);
+    counts[buckets[i]]++;
+  }
+  // The buckets are roughly balanced.
+  for (int count : counts) {
+    EXPECT_GT(count, 800);
+    EXPECT_LT(count, 1200);
+  }
+}
+
+TEST(PrfBucketerTest, AddingABucketMovesInputsOnlyToIt) {
+  auto bucketer = NewBucketer();
+  std::vector<std::string> input_strings = GetInputs(2000);
+  std::vector<absl::string_view> inputs(input_strings.begin(),
+                                        input_strings.end());
+  std::vector<int32_t> before(inputs.size());
+  std::vector<int32_t> after(inputs.size());
+  for (int32_t num_buckets = 1; num_buckets < 20; num_buckets++) {
+    ASSERT_THAT(bucketer->BucketBatch(inputs, num_buckets,
+                                      absl::MakeSpan(before)),
+                IsOk());
+    ASSERT_THAT(bucketer->BucketBatch(inputs, num_buckets + 1,
+                                      absl::MakeSpan(after)),
+                IsOk());
+    int moved = 0;
+    for (size_t i = 0; i < inputs.size(); i++) {
+      if (before[i] == after[i]) continue;
+      EXPECT_EQ(num_buckets, after[i]);
+      moved++;
+    }
+    EXPECT_LT(moved, 2 * inputs.size() / (num_buckets + 1));
+  }
+}
+
+TEST(PrfBucketerTest, JumpConsistentHash) {
+  for (uint64_t key : {0ULL, 1ULL, 0xffffffffffffffffULL}) {
+    EXPECT_EQ(0, PrfBucketer::JumpConsistentHash(key, 1));
+    for (int32_t num_buckets : {2, 1000, 0x7fffffff}) {
+      int32_t bucket = PrfBucketer::JumpConsistentHash(key, num_buckets);
+      EXPECT_GE(bucket, 0);
+      EXPECT_LT(bucket, num_buckets);
+    }
+  }
+}
+
+TEST(PrfBucketerTest, InvalidArguments) {
+  EXPECT_THAT(PrfBucketer::New(nullptr).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(PrfBucketer::New(absl::make_unique<NoPrimaryPrfSet>()).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  auto bucketer = NewBucketer();
+  EXPECT_THAT(bucketer->Bucket("user", 0).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  std::vector<absl::string_view> inputs = {"a", "b"};
+  std::vector<int32_t> buckets(1);
+  EXPECT_THAT(bucketer->BucketBatch(inputs, 10, absl::MakeSpan(buckets)),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  std::vector<uint64_t> hashes(3);
+  EXPECT_THAT(bucketer->HashBatch(inputs, absl::MakeSpan(hashes)),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace tink
+}  // namespace crypto
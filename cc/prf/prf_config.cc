@@ -15,6 +15,7 @@
 
 #include "tink/config/tink_fips.h"
 #include "tink/prf/aes_cmac_prf_key_manager.h"
+#include "tink/prf/blake3_prf_key_manager.h"
 #include "tink/prf/hkdf_prf_key_manager.h"
 #include "tink/prf/hmac_prf_key_manager.h"
 #include "tink/prf/prf_set_wrapper.h"
@@ -30,22 +31,22 @@ crypto::tink::util::Status PrfConfig::Register() {
       Registry::RegisterPrimitiveWrapper(absl::make_unique<PrfSetWrapper>());
   if (!status.ok()) return status;
 
-  status = Registry::RegisterKeyTypeManager(
-      absl::make_unique<HmacPrfKeyManager>(), true);
+  status = Registry::RegisterKeyTypeManagerLazily<HmacPrfKeyManager>(true);
   if (!status.ok()) return status;
 
   // When using FIPS only mode do not register other key managers.
   if (kUseOnlyFips) return util::OkStatus();
 
-  status = Registry::RegisterKeyTypeManager(
-      absl::make_unique<HkdfPrfKeyManager>(), true);
+  status = Registry::RegisterKeyTypeManagerLazily<HkdfPrfKeyManager>(true);
   if (!status.ok()) return status;
 
-  status = Registry::RegisterKeyTypeManager(
-      absl::make_unique<AesCmacPrfKeyManager>(), true);
+  status = Registry::RegisterKeyTypeManagerLazily<AesCmacPrfKeyManager>(true);
   if (!status.ok()) {
     return status;
   }
+
+  status = Registry::RegisterKeyTypeManagerLazily<Blake3PrfKeyManager>(true);
+  if (!status.ok()) return status;
   return util::OkStatus();
 }
 
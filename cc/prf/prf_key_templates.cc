@@ -15,9 +15,11 @@
 
 #include "absl/memory/memory.h"
 #include "tink/prf/aes_cmac_prf_key_manager.h"
+#include "tink/prf/blake3_prf_key_manager.h"
 #include "tink/prf/hkdf_prf_key_manager.h"
 #include "tink/prf/hmac_prf_key_manager.h"
 #include "proto/aes_cmac_prf.pb.h"
+#include "proto/blake3_prf.pb.h"
 #include "proto/hkdf_prf.pb.h"
 #include "proto/hmac_prf.pb.h"
 
@@ -27,6 +29,7 @@ namespace tink {
 namespace {
 
 using google::crypto::tink::AesCmacPrfKeyFormat;
+using google::crypto::tink::Blake3PrfKeyFormat;
 using google::crypto::tink::HkdfPrfKeyFormat;
 using google::crypto::tink::HmacPrfKeyFormat;
 
@@ -72,6 +75,19 @@ std::unique_ptr<google::crypto::tink::KeyTemplate> NewAesCmacTemplate() {
   return key_template;
 }
 
+std::unique_ptr<google::crypto::tink::KeyTemplate> NewBlake3Template() {
+  auto key_template = absl::make_unique<google::crypto::tink::KeyTemplate>();
+  auto blake3_prf_key_manager = absl::make_unique<Blake3PrfKeyManager>();
+  key_template->set_type_url(blake3_prf_key_manager->get_key_type());
+  key_template->set_output_prefix_type(
+      google::crypto::tink::OutputPrefixType::RAW);
+  Blake3PrfKeyFormat key_format;
+  key_format.set_version(blake3_prf_key_manager->get_version());
+  key_format.set_key_size(32);
+  key_format.SerializeToString(key_template->mutable_value());
+  return key_template;
+}
+
 }  // namespace
 
 const google::crypto::tink::KeyTemplate& PrfKeyTemplates::HkdfSha256() {
@@ -98,5 +114,11 @@ const google::crypto::tink::KeyTemplate& PrfKeyTemplates::AesCmac() {
   return *key_template;
 }
 
+const google::crypto::tink::KeyTemplate& PrfKeyTemplates::Blake3() {
+  static const google::crypto::tink::KeyTemplate* key_template =
+      NewBlake3Template().release();
+  return *key_template;
+}
+
 }  // namespace tink
 }  // namespace crypto
@@ -39,6 +39,9 @@ class PrfKeyTemplates {
   static const google::crypto::tink::KeyTemplate& HmacSha256();
   static const google::crypto::tink::KeyTemplate& HmacSha512();
   static const google::crypto::tink::KeyTemplate& AesCmac();
+  // Blake3 in the keyed hash mode
+  //  * Key size: 256 bit
+  static const google::crypto::tink::KeyTemplate& Blake3();
 };
 
 }  // namespace tink
@@ -18,10 +18,12 @@
 #include "gtest/gtest.h"
 #include "absl/memory/memory.h"
 #include "tink/prf/aes_cmac_prf_key_manager.h"
+#include "tink/prf/blake3_prf_key_manager.h"
 #include "tink/prf/hkdf_prf_key_manager.h"
 #include "tink/prf/hmac_prf_key_manager.h"
 #include "tink/util/test_matchers.h"
 #include "proto/aes_cmac_prf.pb.h"
+#include "proto/blake3_prf.pb.h"
 #include "proto/hmac_prf.pb.h"
 
 namespace crypto {
@@ -108,6 +110,20 @@ TEST(CmacPrfTest, MultipleCallsSameReference) {
   EXPECT_THAT(PrfKeyTemplates::AesCmac(), Ref(PrfKeyTemplates::AesCmac()));
 }
 
+TEST(Blake3PrfTest, Basics) {
+  EXPECT_THAT(PrfKeyTemplates::Blake3().type_url(),
+              Eq("type.googleapis.com/google.crypto.tink.Blake3PrfKey"));
+  Blake3PrfKeyManager manager;
+  EXPECT_THAT(PrfKeyTemplates::Blake3().type_url(),
+              Eq(manager.get_key_type()));
+  google::crypto::tink::Blake3PrfKeyFormat format;
+  ASSERT_TRUE(format.ParseFromString(PrfKeyTemplates::Blake3().value()));
+  EXPECT_THAT(manager.ValidateKeyFormat(format), IsOk());
+  EXPECT_THAT(PrfKeyTemplates::Blake3().output_prefix_type(),
+              Eq(google::crypto::tink::OutputPrefixType::RAW));
+  EXPECT_THAT(PrfKeyTemplates::Blake3(), Ref(PrfKeyTemplates::Blake3()));
+}
+
 }  // namespace
 }  // namespace tink
 }  // namespace crypto
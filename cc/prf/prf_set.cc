@@ -17,15 +17,72 @@
 namespace crypto {
 namespace tink {
 
+util::Status Prf::ComputeBatch(absl::Span<const absl::string_view> inputs,
+                               size_t output_length,
+                               std::string* output) const {
+  output->clear();
+  output->reserve(inputs.size() * output_length);
+  for (absl::string_view input : inputs) {
+    auto compute_result = Compute(input, output_length);
+    if (!compute_result.ok()) return compute_result.status();
+    output->append(compute_result.ValueOrDie());
+  }
+  return util::Status::OK;
+}
+
+util::StatusOr<uint64_t> Prf::ComputeUint64(absl::string_view input) const {
+  auto compute_result = Compute(input, sizeof(uint64_t));
+  if (!compute_result.ok()) return compute_result.status();
+  const std::string& output = compute_result.ValueOrDie();
+  if (output.size() != sizeof(uint64_t)) {
+    return util::Status(util::error::INTERNAL,
+                        "PRF returned an output of the wrong size");
+  }
+  uint64_t value = 0;
+  for (char byte : output) value = (value << 8) | static_cast<uint8_t>(byte);
+  return value;
+}
+
+util::Status Prf::ComputeUint64Batch(absl::Span<const absl::string_view> inputs,
+                                     absl::Span<uint64_t> outputs) const {
+  if (outputs.size() != inputs.size()) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "outputs must have the size of inputs");
+  }
+  for (size_t i = 0; i < inputs.size(); i++) {
+    auto compute_result = ComputeUint64(inputs[i]);
+    if (!compute_result.ok()) return compute_result.status();
+    outputs[i] = compute_result.ValueOrDie();
+  }
+  return util::Status::OK;
+}
+
+const Prf* PrfSet::GetPrimaryPrf() const {
+  const std::map<uint32_t, Prf*>& prfs = GetPrfs();
+  auto prf_it = prfs.find(GetPrimaryId());
+  if (prf_it == prfs.end()) return nullptr;
+  return prf_it->second;
+}
+
 util::StatusOr<std::string> PrfSet::ComputePrimary(absl::string_view input,
                                                    size_t output_length) const {
-  auto prfs = GetPrfs();
-  auto prf_it = prfs.find(GetPrimaryId());
-  if (prf_it == prfs.end()) {
+  const Prf* prf = GetPrimaryPrf();
+  if (prf == nullptr) {
+    return util::Status(util::error::INTERNAL,
+                        "PrfSet has no PRF for primary ID.");
+  }
+  return prf->Compute(input, output_length);
+}
+
+util::Status PrfSet::ComputePrimaryBatch(
+    absl::Span<const absl::string_view> inputs, size_t output_length,
+    std::string* output) const {
+  const Prf* prf = GetPrimaryPrf();
+  if (prf == nullptr) {
     return util::Status(util::error::INTERNAL,
                         "PrfSet has no PRF for primary ID.");
   }
-  return prf_it->second->Compute(input, output_length);
+  return prf->ComputeBatch(inputs, output_length, output);
 }
 
 }  // namespace tink
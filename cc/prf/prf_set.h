@@ -15,9 +15,13 @@
 #ifndef TINK_PRF_PRF_SET_H_
 #define TINK_PRF_PRF_SET_H_
 
+#include <cstdint>
 #include <map>
+#include <string>
 
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "tink/util/status.h"
 #include "tink/util/statusor.h"
 
 namespace crypto {
@@ -56,6 +60,25 @@ class Prf {
   // algorithm is less than outputLength.
   virtual util::StatusOr<std::string> Compute(absl::string_view input,
                                               size_t output_length) const = 0;
+  // Computes the PRF on each of 'inputs' and stores the first output_length
+  // bytes of each result back-to-back in '*output', which is overwritten:
+  // the output for inputs[i] starts at i * output_length. Fails if the
+  // computation fails for any input. The default implementation calls
+  // Compute() for each input.
+  virtual util::Status ComputeBatch(absl::Span<const absl::string_view> inputs,
+                                    size_t output_length,
+                                    std::string* output) const;
+  // Returns the first 8 bytes of the PRF output on 'input' as a big-endian
+  // integer, e.g. for keyed hashing and bucketing. Implementations may
+  // override it to compute the value without allocating. The default
+  // implementation calls Compute().
+  virtual util::StatusOr<uint64_t> ComputeUint64(absl::string_view input) const;
+  // Like ComputeUint64() for each of 'inputs', storing the value for
+  // inputs[i] in outputs[i]. 'outputs' must have the size of 'inputs'. The
+  // default implementation calls ComputeUint64() for each input.
+  virtual util::Status ComputeUint64Batch(
+      absl::Span<const absl::string_view> inputs,
+      absl::Span<uint64_t> outputs) const;
 };
 
 // A Tink Keyset can be converted into a set of PRFs using this primitive. Every
@@ -74,6 +97,17 @@ class PrfSet {
   // See PRF.compute for details of the parameters.
   util::StatusOr<std::string> ComputePrimary(absl::string_view input,
                                              size_t output_length) const;
+  // Convenience method to compute the primary PRF on a batch of inputs.
+  // See Prf::ComputeBatch for details of the parameters.
+  util::Status ComputePrimaryBatch(absl::Span<const absl::string_view> inputs,
+                                   size_t output_length,
+                                   std::string* output) const;
+
+ protected:
+  // Returns the PRF for the primary ID, or nullptr if there is none. The
+  // default implementation looks it up in GetPrfs(); implementations may
+  // override it to avoid the lookup.
+  virtual const Prf* GetPrimaryPrf() const;
 };
 
 }  // namespace tink
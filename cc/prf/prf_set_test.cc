@@ -14,13 +14,16 @@
 
 #include "tink/prf/prf_set.h"
 
+#include <cstdint>
 #include <map>
+#include <vector>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "tink/keyset_handle.h"
 #include "tink/keyset_manager.h"
 #include "tink/prf/prf_config.h"
@@ -81,6 +84,20 @@ TEST(PrfSetTest, ComputePrimary) {
       << "Expected broken PrfSet to not be able to compute the primary PRF";
 }
 
+TEST(PrfTest, ComputeUint64) {
+  DummyPrf prf;
+  auto value_result = prf.ComputeUint64("DummyInput");
+  ASSERT_TRUE(value_result.ok()) << value_result.status();
+  // The big-endian value of "DummyPRF".
+  EXPECT_EQ(0x44756d6d79505246ULL, value_result.ValueOrDie());
+  std::vector<absl::string_view> inputs = {"a", "b"};
+  std::vector<uint64_t> outputs(2);
+  ASSERT_TRUE(prf.ComputeUint64Batch(inputs, absl::MakeSpan(outputs)).ok());
+  EXPECT_EQ(0x44756d6d79505246ULL, outputs[1]);
+  outputs.resize(1);
+  EXPECT_FALSE(prf.ComputeUint64Batch(inputs, absl::MakeSpan(outputs)).ok());
+}
+
 TEST(PrfSetWrapperTest, TestPrimitivesEndToEnd) {
   auto status = PrfConfig::Register();
   ASSERT_TRUE(status.ok()) << status;
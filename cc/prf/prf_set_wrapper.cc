@@ -14,6 +14,7 @@
 #include "tink/prf/prf_set_wrapper.h"
 
 #include "absl/memory/memory.h"
+#include "tink/memory_stats.h"
 #include "tink/util/status.h"
 #include "proto/tink.pb.h"
 
@@ -24,13 +25,14 @@ using google::crypto::tink::OutputPrefixType;
 
 namespace {
 
-class PrfSetPrimitiveWrapper : public PrfSet {
+class PrfSetPrimitiveWrapper : public PrfSet, public MemoryStatsSource {
  public:
   explicit PrfSetPrimitiveWrapper(std::unique_ptr<PrimitiveSet<Prf>> prf_set)
       : prf_set_(std::move(prf_set)) {
     for (const auto& prf : *prf_set_->get_raw_primitives().ValueOrDie()) {
       prfs_.insert({prf->get_key_id(), &prf->get_primitive()});
     }
+    primary_prf_ = prfs_.at(GetPrimaryId());
   }
 
   uint32_t GetPrimaryId() const override {
@@ -38,11 +40,24 @@ class PrfSetPrimitiveWrapper : public PrfSet {
   }
   const std::map<uint32_t, Prf*>& GetPrfs() const override { return prfs_; }
 
+  MemoryStats GetMemoryStats() const override {
+    // A node of prfs_ holds the value, three links and the color.
+    const size_t prfs_bytes =
+        prfs_.size() * (sizeof(std::map<uint32_t, Prf*>::value_type) +
+                        4 * sizeof(void*));
+    return prf_set_->GetMemoryStats("prf", sizeof(*this) + prfs_bytes);
+  }
+
   ~PrfSetPrimitiveWrapper() override {}
 
+ protected:
+  const Prf* GetPrimaryPrf() const override { return primary_prf_; }
+
  private:
   std::unique_ptr<PrimitiveSet<Prf>> prf_set_;
   std::map<uint32_t, Prf*> prfs_;
+  // Resolved once, so that ComputePrimary() needs no lookup.
+  const Prf* primary_prf_;
 };
 
 util::Status Validate(PrimitiveSet<Prf>* prf_set) {
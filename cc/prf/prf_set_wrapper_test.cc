@@ -16,6 +16,7 @@
 #include <cstdint>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -135,6 +136,21 @@ TEST_F(PrfSetWrapperTest, WrapTwo) {
               IsOkAndHolds(StrEq("different")));
 }
 
+TEST_F(PrfSetWrapperTest, ComputePrimaryBatch) {
+  ASSERT_THAT(AddPrf("different", MakeKey(1)).status(), IsOk());
+  auto entry = AddPrf("output", MakeKey(2));
+  ASSERT_THAT(entry.status(), IsOk());
+  ASSERT_THAT(PrfSet()->set_primary(entry.ValueOrDie()), IsOk());
+  PrfSetWrapper wrapper;
+  auto wrapped_or = wrapper.Wrap(std::move(PrfSet()));
+  ASSERT_THAT(wrapped_or.status(), IsOk());
+  auto wrapped = std::move(wrapped_or.ValueOrDie());
+  std::vector<absl::string_view> inputs = {"input1", "input2"};
+  std::string output;
+  ASSERT_THAT(wrapped->ComputePrimaryBatch(inputs, 6, &output), IsOk());
+  EXPECT_THAT(output, StrEq("outputoutput"));
+}
+
 }  // namespace
 }  // namespace tink
 }  // namespace crypto
@@ -0,0 +1,96 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/primitive_cache.h"
+
+#include <cstdint>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "openssl/mem.h"
+#include "openssl/sha.h"
+#include "tink/util/status.h"
+
+namespace crypto {
+namespace tink {
+
+using ::crypto::tink::util::Status;
+using ::crypto::tink::util::StatusOr;
+using ::google::crypto::tink::KeyData;
+
+StatusOr<std::unique_ptr<PrimitiveCache>> PrimitiveCache::New(
+    int max_entries) {
+  if (max_entries <= 0) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "max_entries must be positive");
+  }
+  return absl::WrapUnique(new PrimitiveCache(max_entries));
+}
+
+// The cache key holds a SHA-256 hash of the key instead of the key value, so
+// that the map and lru_ do not copy key material into memory which is not
+// zeroized. The type URL is length-prefixed to keep the hashed encoding
+// unambiguous.
+std::string PrimitiveCache::CacheKey(const std::type_info& primitive_type,
+                                     const KeyData& key_data) {
+  std::string prefix = absl::StrCat(key_data.key_material_type(), ":",
+                                    key_data.type_url().size(), ":");
+  SHA256_CTX sha256;
+  SHA256_Init(&sha256);
+  SHA256_Update(&sha256, prefix.data(), prefix.size());
+  SHA256_Update(&sha256, key_data.type_url().data(),
+                key_data.type_url().size());
+  SHA256_Update(&sha256, key_data.value().data(), key_data.value().size());
+  uint8_t digest[SHA256_DIGEST_LENGTH];
+  SHA256_Final(digest, &sha256);
+  OPENSSL_cleanse(&sha256, sizeof(sha256));
+  return absl::StrCat(
+      primitive_type.name(), ":",
+      absl::string_view(reinterpret_cast<const char*>(digest), sizeof(digest)));
+}
+
+std::shared_ptr<void> PrimitiveCache::Find(const std::string& cache_key) {
+  absl::MutexLock lock(&mutex_);
+  auto it = primitives_.find(cache_key);
+  if (it == primitives_.end()) {
+    stats_.misses++;
+    return nullptr;
+  }
+  stats_.hits++;
+  lru_.splice(lru_.begin(), lru_, it->second.lru_position);
+  return it->second.primitive;
+}
+
+void PrimitiveCache::Insert(const std::string& cache_key,
+                            std::shared_ptr<void> primitive) {
+  absl::MutexLock lock(&mutex_);
+  // Another thread may have inserted the same key concurrently.
+  if (primitives_.find(cache_key) != primitives_.end()) return;
+  while (primitives_.size() >= static_cast<size_t>(max_entries_)) {
+    primitives_.erase(lru_.back());
+    lru_.pop_back();
+  }
+  lru_.push_front(cache_key);
+  primitives_[cache_key] = {std::move(primitive), lru_.begin()};
+}
+
+PrimitiveCache::Stats PrimitiveCache::GetStats() const {
+  absl::MutexLock lock(&mutex_);
+  return stats_;
+}
+
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,117 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_PRIMITIVE_CACHE_H_
+#define TINK_PRIMITIVE_CACHE_H_
+
+#include <list>
+#include <memory>
+#include <string>
+#include <typeinfo>
+#include <unordered_map>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "tink/registry.h"
+#include "tink/util/statusor.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+
+// A bounded, thread-safe cache of primitives, keyed by the KeyData they were
+// created from and the primitive type. Constructing a primitive from a key
+// can be expensive (it parses the key proto and, e.g. for RSA or ECDSA keys,
+// imports big numbers and curve points); with a cache, repeatedly obtaining
+// primitives for the same keys only costs a hash lookup:
+//
+//   auto cache = PrimitiveCache::New(/* max_entries= */ 1000).ValueOrDie();
+//   ...
+//   auto aead_result = keyset_handle->GetCachedPrimitive<Aead>(cache.get());
+//
+// Cached primitives are shared between all their users, which relies on Tink
+// primitives being thread-safe. The least recently used entry is evicted once
+// the cache holds 'max_entries' primitives. Entries are keyed by a SHA-256
+// hash of the key, so the cache itself holds no copy of the key material;
+// the cached primitives do.
+class PrimitiveCache {
+ public:
+  struct Stats {
+    int64_t hits = 0;
+    int64_t misses = 0;
+  };
+
+  // Returns a cache holding at most 'max_entries' primitives, which must be
+  // positive.
+  static crypto::tink::util::StatusOr<std::unique_ptr<PrimitiveCache>> New(
+      int max_entries);
+
+  PrimitiveCache(const PrimitiveCache&) = delete;
+  PrimitiveCache& operator=(const PrimitiveCache&) = delete;
+
+  // Returns the cached P-primitive for 'key_data', creating it via
+  // Registry::GetPrimitive<P>() on a miss.
+  template <class P>
+  crypto::tink::util::StatusOr<std::shared_ptr<P>> GetPrimitive(
+      const google::crypto::tink::KeyData& key_data) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  Stats GetStats() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  struct CachedPrimitive {
+    std::shared_ptr<void> primitive;
+    // The position of the entry in lru_.
+    std::list<std::string>::iterator lru_position;
+  };
+
+  explicit PrimitiveCache(int max_entries) : max_entries_(max_entries) {}
+
+  static std::string CacheKey(const std::type_info& primitive_type,
+                              const google::crypto::tink::KeyData& key_data);
+
+  // Returns the cached primitive for 'cache_key', or nullptr.
+  std::shared_ptr<void> Find(const std::string& cache_key)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+  void Insert(const std::string& cache_key, std::shared_ptr<void> primitive)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  const int max_entries_;
+  mutable absl::Mutex mutex_;
+  std::unordered_map<std::string, CachedPrimitive> primitives_
+      ABSL_GUARDED_BY(mutex_);
+  // Cache keys, most recently used first.
+  std::list<std::string> lru_ ABSL_GUARDED_BY(mutex_);
+  Stats stats_ ABSL_GUARDED_BY(mutex_);
+};
+
+template <class P>
+crypto::tink::util::StatusOr<std::shared_ptr<P>> PrimitiveCache::GetPrimitive(
+    const google::crypto::tink::KeyData& key_data) {
+  std::string cache_key = CacheKey(typeid(P), key_data);
+  std::shared_ptr<void> cached = Find(cache_key);
+  if (cached != nullptr) return std::static_pointer_cast<P>(cached);
+
+  auto primitive_result = Registry::GetPrimitive<P>(key_data);
+  if (!primitive_result.ok()) return primitive_result.status();
+  std::shared_ptr<P> primitive = std::move(primitive_result.ValueOrDie());
+  Insert(cache_key, primitive);
+  return primitive;
+}
+
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_PRIMITIVE_CACHE_H_
@@ -17,13 +17,25 @@
 #ifndef TINK_PRIMITIVE_SET_H_
 #define TINK_PRIMITIVE_SET_H_
 
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "absl/base/call_once.h"
 #include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
 #include "absl/synchronization/mutex.h"
 #include "tink/crypto_format.h"
+#include "tink/key_usage.h"
+#include "tink/memory_stats.h"
 #include "tink/util/errors.h"
+#include "tink/util/secret_data_internal.h"
 #include "tink/util/statusor.h"
 #include "proto/tink.pb.h"
 
@@ -48,9 +60,19 @@ namespace tink {
 //
 // PrimitiveSet is a public class to allow its use in implementations
 // of custom primitives.
+//
+// A PrimitiveSet is either mutable or immutable. A default-constructed set
+// is mutable: primitives can be added at any time, and all accesses are
+// synchronized with a mutex. A set obtained from PrimitiveSet<P>::Builder is
+// immutable: it cannot be changed after Build(), so lookups take no locks and
+// are resolved through a sorted table of output prefixes.
 template <class P>
 class PrimitiveSet {
  public:
+  // Creates the primitive of a lazy entry, see Builder::AddLazyPrimitive().
+  using PrimitiveFactory =
+      std::function<crypto::tink::util::StatusOr<std::unique_ptr<P>>()>;
+
   // Entry-objects hold individual instances of primitives in the set.
   template <class P2>
   class Entry {
@@ -58,25 +80,85 @@ class PrimitiveSet {
     static crypto::tink::util::StatusOr<std::unique_ptr<Entry<P>>> New(
         std::unique_ptr<P> primitive,
         const google::crypto::tink::KeysetInfo::KeyInfo& key_info) {
-      if (key_info.status() != google::crypto::tink::KeyStatusType::ENABLED) {
-        return util::Status(crypto::tink::util::error::INVALID_ARGUMENT,
-                            "The key must be ENABLED.");
+      return NewShared(std::move(primitive), key_info);
+    }
+
+    // As New(), but the primitive may be shared with other owners, e.g. a
+    // PrimitiveCache.
+    static crypto::tink::util::StatusOr<std::unique_ptr<Entry<P>>> NewShared(
+        std::shared_ptr<P> primitive,
+        const google::crypto::tink::KeysetInfo::KeyInfo& key_info) {
+      return NewImpl(std::move(primitive), nullptr, key_info);
+    }
+
+    // As New(), but the primitive is created by 'factory' when it is first
+    // accessed.
+    static crypto::tink::util::StatusOr<std::unique_ptr<Entry<P>>> NewLazy(
+        PrimitiveFactory factory,
+        const google::crypto::tink::KeysetInfo::KeyInfo& key_info) {
+      return NewImpl(nullptr, std::move(factory), key_info);
+    }
+
+    // Returns the primitive. For a lazy entry, the primitive must have been
+    // created successfully, which only get_primitive_or_status() can tell.
+    P2& get_primitive() const {
+      if (factory_ == nullptr) return *primitive_;
+      return *get_primitive_or_status().ValueOrDie();
+    }
+
+    // Returns the primitive, or the error of creating it if this is a lazy
+    // entry. The primitive of a lazy entry is created once, by the first call
+    // of this method or get_primitive(), and is safe to call concurrently.
+    crypto::tink::util::StatusOr<P2*> get_primitive_or_status() const {
+      if (factory_ != nullptr) {
+        absl::call_once(create_once_, [this]() {
+          int64_t secret_data_mark = util::internal::ThreadSecretDataBytes();
+          auto primitive_result = factory_();
+          secret_data_bytes_.store(SecretDataBytesSince(secret_data_mark),
+                                   std::memory_order_relaxed);
+          if (!primitive_result.ok()) {
+            create_status_ = primitive_result.status();
+          } else if (primitive_result.ValueOrDie() == nullptr) {
+            create_status_ =
+                util::Status(crypto::tink::util::error::INTERNAL,
+                             "The primitive factory returned null.");
+          } else {
+            primitive_ = std::move(primitive_result.ValueOrDie());
+          }
+        });
+        if (!create_status_.ok()) return create_status_;
       }
-      auto identifier_result = CryptoFormat::GetOutputPrefix(key_info);
-      if (!identifier_result.ok()) return identifier_result.status();
-      if (primitive == nullptr) {
-        return util::Status(crypto::tink::util::error::INVALID_ARGUMENT,
-                            "The primitive must be non-null.");
+      return primitive_.get();
+    }
+
+    // Returns true if the primitive is created when it is first accessed.
+    bool is_lazy() const { return factory_ != nullptr; }
+
+    ~Entry() { delete identifier_string_.load(std::memory_order_relaxed); }
+
+    // Returns the output prefix of the entry. The string is built when this
+    // is first called; identifier_view() returns the prefix without
+    // allocating.
+    const std::string& get_identifier() const {
+      const std::string* identifier =
+          identifier_string_.load(std::memory_order_acquire);
+      if (identifier == nullptr) {
+        auto* built = new std::string(identifier_.view());
+        // Of concurrent callers, the first one publishes its string.
+        if (identifier_string_.compare_exchange_strong(
+                identifier, built, std::memory_order_acq_rel,
+                std::memory_order_acquire)) {
+          identifier = built;
+        } else {
+          delete built;
+        }
       }
-      std::string identifier = identifier_result.ValueOrDie();
-      return absl::WrapUnique(new Entry(std::move(primitive), identifier,
-                                        key_info.status(), key_info.key_id(),
-                                        key_info.output_prefix_type()));
+      return *identifier;
     }
 
-    P2& get_primitive() const { return *primitive_; }
+    absl::string_view identifier_view() const { return identifier_.view(); }
 
-    const std::string& get_identifier() const { return identifier_; }
+    const OutputPrefix& get_output_prefix() const { return identifier_; }
 
     google::crypto::tink::KeyStatusType get_status() const { return status_; }
 
@@ -86,46 +168,237 @@ class PrimitiveSet {
       return output_prefix_type_;
     }
 
+    // Returns the secret data which the primitive allocated when it was
+    // created, as far as it is known, see Builder. Zero for a lazy entry
+    // whose primitive was not created yet.
+    size_t get_secret_data_bytes() const {
+      return secret_data_bytes_.load(std::memory_order_relaxed);
+    }
+
+    // Counts an input which the primitive decrypted, see KeyUsage. Cheap
+    // enough to be called on every decryption, also concurrently.
+    void RecordDecryption() const {
+      decryptions_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    int64_t get_decryptions() const {
+      return decryptions_.load(std::memory_order_relaxed);
+    }
+
    private:
-    Entry(std::unique_ptr<P2> primitive, const std::string& identifier,
+    friend class PrimitiveSet<P>;
+
+    static crypto::tink::util::StatusOr<std::unique_ptr<Entry<P>>> NewImpl(
+        std::shared_ptr<P> primitive, PrimitiveFactory factory,
+        const google::crypto::tink::KeysetInfo::KeyInfo& key_info) {
+      if (key_info.status() != google::crypto::tink::KeyStatusType::ENABLED) {
+        return util::Status(crypto::tink::util::error::INVALID_ARGUMENT,
+                            "The key must be ENABLED.");
+      }
+      auto identifier_result = CryptoFormat::GetFixedOutputPrefix(key_info);
+      if (!identifier_result.ok()) return identifier_result.status();
+      if (primitive == nullptr && factory == nullptr) {
+        return util::Status(crypto::tink::util::error::INVALID_ARGUMENT,
+                            "The primitive must be non-null.");
+      }
+      return absl::WrapUnique(new Entry(std::move(primitive),
+                                        std::move(factory),
+                                        identifier_result.ValueOrDie(),
+                                        key_info.status(), key_info.key_id(),
+                                        key_info.output_prefix_type()));
+    }
+
+    Entry(std::shared_ptr<P2> primitive, PrimitiveFactory factory,
+          const OutputPrefix& identifier,
           google::crypto::tink::KeyStatusType status, uint32_t key_id,
           google::crypto::tink::OutputPrefixType output_prefix_type)
         : primitive_(std::move(primitive)),
-          identifier_(identifier),
+          factory_(std::move(factory)),
           status_(status),
           key_id_(key_id),
-          output_prefix_type_(output_prefix_type) {}
+          output_prefix_type_(output_prefix_type),
+          identifier_(identifier) {}
+
+    // The memory of the string built by get_identifier(), if any. The prefix
+    // fits into the string object itself.
+    size_t IdentifierStringBytes() const {
+      return identifier_string_.load(std::memory_order_relaxed) == nullptr
+                 ? 0
+                 : sizeof(std::string);
+    }
 
-    std::unique_ptr<P> primitive_;
-    std::string identifier_;
+    // Set by the constructor, or by the factory for a lazy entry.
+    mutable std::shared_ptr<P> primitive_;
+    // Only for lazy entries.
+    const PrimitiveFactory factory_;
+    mutable absl::once_flag create_once_;
+    mutable crypto::tink::util::Status create_status_;
     google::crypto::tink::KeyStatusType status_;
     uint32_t key_id_;
     google::crypto::tink::OutputPrefixType output_prefix_type_;
+    // The output prefix is stored inline, as it has at most 5 bytes.
+    OutputPrefix identifier_;
+    // Only built by get_identifier(), which lookups do not use.
+    mutable std::atomic<const std::string*> identifier_string_{nullptr};
+    mutable std::atomic<size_t> secret_data_bytes_{0};
+    mutable std::atomic<int64_t> decryptions_{0};
   };
 
   typedef std::vector<std::unique_ptr<Entry<P>>> Primitives;
 
-  // Constructs an empty PrimitiveSet.
-  PrimitiveSet<P>() : primary_(nullptr) {}
+  // Builder for immutable PrimitiveSets. Errors are accumulated, and the
+  // first one encountered is returned by Build().
+  //
+  // The secret data which the calling thread allocates between two calls of
+  // the Builder is attributed to the primitive added by the second call, see
+  // Entry::get_secret_data_bytes(). This covers the usual case of creating
+  // each primitive right before adding it. Example:
+  //
+  //   auto primitive_set_result = PrimitiveSet<Aead>::Builder()
+  //       .AddPrimitive(std::move(aead_1), key_info_1)
+  //       .AddPrimaryPrimitive(std::move(aead_2), key_info_2)
+  //       .Build();
+  class Builder {
+   public:
+    Builder()
+        : primitive_set_(new PrimitiveSet<P>()),
+          primary_(nullptr),
+          secret_data_mark_(util::internal::ThreadSecretDataBytes()) {}
+
+    // Adds 'primitive' for the key specified by 'key_info'.
+    Builder& AddPrimitive(
+        std::unique_ptr<P> primitive,
+        const google::crypto::tink::KeysetInfo::KeyInfo& key_info) {
+      AddPrimitiveImpl(std::move(primitive), key_info);
+      return *this;
+    }
+
+    // Adds 'primitive' for the key specified by 'key_info', and makes it the
+    // primary of the set. If called more than once, the last call wins.
+    Builder& AddPrimaryPrimitive(
+        std::unique_ptr<P> primitive,
+        const google::crypto::tink::KeysetInfo::KeyInfo& key_info) {
+      Entry<P>* entry = AddPrimitiveImpl(std::move(primitive), key_info);
+      if (entry != nullptr) primary_ = entry;
+      return *this;
+    }
+
+    // As AddPrimitive() and AddPrimaryPrimitive(), for a primitive which is
+    // shared with other owners. The primitive must be thread-safe, which all
+    // Tink primitives are.
+    Builder& AddSharedPrimitive(
+        std::shared_ptr<P> primitive,
+        const google::crypto::tink::KeysetInfo::KeyInfo& key_info) {
+      AddPrimitiveImpl(std::move(primitive), key_info);
+      return *this;
+    }
+    Builder& AddSharedPrimaryPrimitive(
+        std::shared_ptr<P> primitive,
+        const google::crypto::tink::KeysetInfo::KeyInfo& key_info) {
+      Entry<P>* entry = AddPrimitiveImpl(std::move(primitive), key_info);
+      if (entry != nullptr) primary_ = entry;
+      return *this;
+    }
+
+    // As AddPrimitive(), but the primitive is created by 'factory' when it is
+    // first used, e.g. for a key which is only needed to decrypt old
+    // ciphertexts. An error of 'factory' is returned by
+    // Entry::get_primitive_or_status(), so that the set must only be given to
+    // wrappers which handle it, see PrimitiveWrapper::SupportsLazyPrimitives().
+    // The primary primitive cannot be lazy.
+    Builder& AddLazyPrimitive(
+        PrimitiveFactory factory,
+        const google::crypto::tink::KeysetInfo::KeyInfo& key_info) {
+      if (!status_.ok()) return *this;
+      if (primitive_set_ == nullptr) {
+        status_ = util::Status(crypto::tink::util::error::FAILED_PRECONDITION,
+                               "Build() has already been called.");
+        return *this;
+      }
+      auto entry_result = Entry<P>::NewLazy(std::move(factory), key_info);
+      if (!entry_result.ok()) {
+        status_ = entry_result.status();
+        return *this;
+      }
+      primitive_set_->AddEntry(std::move(entry_result.ValueOrDie()));
+      // The factory measures the secret data of the primitive itself.
+      secret_data_mark_ = util::internal::ThreadSecretDataBytes();
+      return *this;
+    }
+
+    // Returns the immutable PrimitiveSet, or the first error encountered
+    // while adding primitives. The Builder must not be used afterwards.
+    crypto::tink::util::StatusOr<std::unique_ptr<PrimitiveSet<P>>> Build() {
+      if (!status_.ok()) return status_;
+      if (primitive_set_ == nullptr) {
+        return util::Status(crypto::tink::util::error::FAILED_PRECONDITION,
+                            "Build() has already been called.");
+      }
+      if (primary_ != nullptr) {
+        auto status = primitive_set_->set_primary(primary_);
+        if (!status.ok()) return status;
+      }
+      primitive_set_->Freeze();
+      return std::move(primitive_set_);
+    }
+
+   private:
+    Entry<P>* AddPrimitiveImpl(
+        std::shared_ptr<P> primitive,
+        const google::crypto::tink::KeysetInfo::KeyInfo& key_info) {
+      if (!status_.ok()) return nullptr;
+      if (primitive_set_ == nullptr) {
+        status_ = util::Status(crypto::tink::util::error::FAILED_PRECONDITION,
+                               "Build() has already been called.");
+        return nullptr;
+      }
+      auto entry_result =
+          primitive_set_->AddSharedPrimitive(std::move(primitive), key_info);
+      if (!entry_result.ok()) {
+        status_ = entry_result.status();
+        return nullptr;
+      }
+      Entry<P>* entry = entry_result.ValueOrDie();
+      entry->secret_data_bytes_.store(SecretDataBytesSince(secret_data_mark_),
+                                      std::memory_order_relaxed);
+      secret_data_mark_ = util::internal::ThreadSecretDataBytes();
+      return entry;
+    }
+
+    crypto::tink::util::Status status_;
+    std::unique_ptr<PrimitiveSet<P>> primitive_set_;
+    Entry<P>* primary_;  // owned by primitive_set_
+    // util::internal::ThreadSecretDataBytes() after the last call.
+    int64_t secret_data_mark_;
+  };
+
+  // Constructs an empty, mutable PrimitiveSet.
+  PrimitiveSet<P>()
+      : primary_(nullptr),
+        primitives_mutex_(absl::make_unique<absl::Mutex>()) {}
 
   // Adds 'primitive' to this set for the specified 'key'.
+  // Fails if this set is immutable.
   crypto::tink::util::StatusOr<Entry<P>*> AddPrimitive(
       std::unique_ptr<P> primitive,
       const google::crypto::tink::KeysetInfo::KeyInfo& key_info) {
-    auto entry_or = Entry<P>::New(std::move(primitive), key_info);
-    if (!entry_or.ok()) return entry_or.status();
-
-    absl::MutexLock lock(&primitives_mutex_);
-    std::string identifier = entry_or.ValueOrDie()->get_identifier();
-    primitives_[identifier].push_back(std::move(entry_or.ValueOrDie()));
-    return primitives_[identifier].back().get();
+    return AddSharedPrimitive(std::move(primitive), key_info);
   }
 
   // Returns the entries with primitives identifed by 'identifier'.
   crypto::tink::util::StatusOr<const Primitives*> get_primitives(
-      absl::string_view identifier) {
-    absl::MutexLock lock(&primitives_mutex_);
-    typename CiphertextPrefixToPrimitivesMap::iterator found =
+      absl::string_view identifier) const {
+    if (!is_mutable()) {
+      const Primitives* found = FindImmutable(identifier);
+      if (found == nullptr) {
+        return ToStatusF(crypto::tink::util::error::NOT_FOUND,
+                         "No primitives found for identifier '%s'.",
+                         identifier);
+      }
+      return found;
+    }
+    absl::MutexLock lock(primitives_mutex_.get());
+    typename CiphertextPrefixToPrimitivesMap::const_iterator found =
         primitives_.find(std::string(identifier));
     if (found == primitives_.end()) {
       return ToStatusF(crypto::tink::util::error::NOT_FOUND,
@@ -135,12 +408,17 @@ class PrimitiveSet {
   }
 
   // Returns all primitives that use RAW prefix.
-  crypto::tink::util::StatusOr<const Primitives*> get_raw_primitives() {
+  crypto::tink::util::StatusOr<const Primitives*> get_raw_primitives() const {
     return get_primitives(CryptoFormat::kRawPrefix);
   }
 
   // Sets the given 'primary' as the primary primitive of this set.
+  // Fails if this set is immutable.
   crypto::tink::util::Status set_primary(Entry<P>* primary) {
+    if (!is_mutable()) {
+      return util::Status(crypto::tink::util::error::FAILED_PRECONDITION,
+                          "The PrimitiveSet is immutable.");
+    }
     if (!primary) {
       return util::Status(crypto::tink::util::error::INVALID_ARGUMENT,
                           "The primary primitive must be non-null.");
@@ -149,7 +427,7 @@ class PrimitiveSet {
       return util::Status(crypto::tink::util::error::INVALID_ARGUMENT,
                           "Primary has to be enabled.");
     }
-    auto entries_result = get_primitives(primary->get_identifier());
+    auto entries_result = get_primitives(primary->identifier_view());
     if (!entries_result.ok()) {
       return util::Status(crypto::tink::util::error::INVALID_ARGUMENT,
                           "Primary cannot be set to an entry which is "
@@ -163,10 +441,47 @@ class PrimitiveSet {
   // Returns the entry with the primary primitive.
   const Entry<P>* get_primary() const { return primary_; }
 
+  // The parts of the primary entry which wrappers use on every encryption or
+  // signature, so that they can copy them once when they are created.
+  struct ResolvedPrimary {
+    P* primitive;
+    OutputPrefix output_prefix;
+    uint32_t key_id;
+    google::crypto::tink::OutputPrefixType output_prefix_type;
+  };
+
+  // Returns the primary entry, creating its primitive if the entry is lazy.
+  // Fails if there is no primary, or if its primitive cannot be created.
+  crypto::tink::util::StatusOr<ResolvedPrimary> ResolvePrimary() const {
+    if (primary_ == nullptr) {
+      return util::Status(crypto::tink::util::error::INVALID_ARGUMENT,
+                          "The PrimitiveSet has no primary.");
+    }
+    auto primitive_result = primary_->get_primitive_or_status();
+    if (!primitive_result.ok()) return primitive_result.status();
+    ResolvedPrimary resolved;
+    resolved.primitive = primitive_result.ValueOrDie();
+    resolved.output_prefix = primary_->get_output_prefix();
+    resolved.key_id = primary_->get_key_id();
+    resolved.output_prefix_type = primary_->get_output_prefix_type();
+    return resolved;
+  }
+
   // Returns all entries currently in this primitive set.
   const std::vector<Entry<P>*> get_all() const {
-    absl::MutexLock lock(&primitives_mutex_);
     std::vector<Entry<P>*> result;
+    if (!is_mutable()) {
+      for (const auto& primitive : raw_primitives_) {
+        result.push_back(primitive.get());
+      }
+      for (const auto& group : prefix_table_) {
+        for (const auto& primitive : group.primitives) {
+          result.push_back(primitive.get());
+        }
+      }
+      return result;
+    }
+    absl::MutexLock lock(primitives_mutex_.get());
     for (const auto& prefix_and_vector : primitives_) {
       for (const auto& primitive : prefix_and_vector.second) {
         result.push_back(primitive.get());
@@ -175,13 +490,180 @@ class PrimitiveSet {
     return result;
   }
 
+  // Returns true if primitives can still be added to this set, i.e. if it
+  // was not created by a Builder.
+  bool is_mutable() const { return primitives_mutex_ != nullptr; }
+
+  // Returns the memory of this set and the secret data of its primitives,
+  // under 'primitive_name' in MemoryStats::bytes_by_primitive. 'wrapper_bytes'
+  // is the memory of the wrapper which owns the set, if any.
+  MemoryStats GetMemoryStats(absl::string_view primitive_name,
+                             size_t wrapper_bytes = 0) const {
+    MemoryStats stats;
+    stats.primitive_set_bytes = GetMemoryUsage() + wrapper_bytes;
+    for (const Entry<P>* entry : get_all()) {
+      stats.primitive_secret_bytes += entry->get_secret_data_bytes();
+    }
+    stats.bytes_by_primitive[std::string(primitive_name)] =
+        stats.primitive_set_bytes + stats.primitive_secret_bytes;
+    return stats;
+  }
+
+  // Returns the KeyUsage of all entries, as counted by RecordDecryption().
+  std::vector<KeyUsage> GetKeyUsage() const {
+    std::vector<KeyUsage> usage;
+    for (const Entry<P>* entry : get_all()) {
+      KeyUsage key_usage;
+      key_usage.key_id = entry->get_key_id();
+      key_usage.is_primary = entry == primary_;
+      key_usage.decryptions = entry->get_decryptions();
+      usage.push_back(key_usage);
+    }
+    return usage;
+  }
+
+  // Returns an estimate of the memory in bytes held by this set and its
+  // entries, excluding the primitives themselves.
+  size_t GetMemoryUsage() const {
+    size_t usage = sizeof(*this);
+    if (!is_mutable()) {
+      usage += EntriesMemoryUsage(raw_primitives_);
+      usage += prefix_table_.capacity() * sizeof(PrefixGroup);
+      for (const auto& group : prefix_table_) {
+        usage += EntriesMemoryUsage(group.primitives);
+      }
+      return usage;
+    }
+    absl::MutexLock lock(primitives_mutex_.get());
+    usage += sizeof(absl::Mutex);
+    usage += primitives_.bucket_count() * sizeof(void*);
+    for (const auto& prefix_and_vector : primitives_) {
+      const Primitives& primitives = prefix_and_vector.second;
+      // A node holds the key, the value and the link to the next node.
+      usage += sizeof(typename CiphertextPrefixToPrimitivesMap::value_type) +
+               sizeof(void*);
+      usage += EntriesMemoryUsage(primitives);
+    }
+    return usage;
+  }
+
  private:
   typedef std::unordered_map<std::string, Primitives>
       CiphertextPrefixToPrimitivesMap;
+
+  // Returns the memory of 'primitives' and of their entries.
+  static size_t EntriesMemoryUsage(const Primitives& primitives) {
+    size_t usage = primitives.capacity() * sizeof(primitives[0]) +
+                   primitives.size() * sizeof(Entry<P>);
+    for (const auto& entry : primitives) {
+      usage += entry->IdentifierStringBytes();
+    }
+    return usage;
+  }
+
+  // Returns the secret data which the calling thread retained since
+  // util::internal::ThreadSecretDataBytes() returned 'mark'.
+  static size_t SecretDataBytesSince(int64_t mark) {
+    int64_t bytes = util::internal::ThreadSecretDataBytes() - mark;
+    return bytes > 0 ? bytes : 0;
+  }
+
+  crypto::tink::util::StatusOr<Entry<P>*> AddSharedPrimitive(
+      std::shared_ptr<P> primitive,
+      const google::crypto::tink::KeysetInfo::KeyInfo& key_info) {
+    if (!is_mutable()) {
+      return util::Status(crypto::tink::util::error::FAILED_PRECONDITION,
+                          "The PrimitiveSet is immutable.");
+    }
+    auto entry_or = Entry<P>::NewShared(std::move(primitive), key_info);
+    if (!entry_or.ok()) return entry_or.status();
+    return AddEntry(std::move(entry_or.ValueOrDie()));
+  }
+
+  // Adds 'entry' to this mutable set.
+  Entry<P>* AddEntry(std::unique_ptr<Entry<P>> entry) {
+    absl::MutexLock lock(primitives_mutex_.get());
+    Primitives& primitives =
+        primitives_[std::string(entry->identifier_view())];
+    primitives.push_back(std::move(entry));
+    return primitives.back().get();
+  }
+
+  // The entries of an immutable set with one non-RAW output prefix. Such a
+  // prefix consists of one start byte and a 4-byte key id, and is stored as
+  // the corresponding 40-bit big-endian integer.
+  struct PrefixGroup {
+    uint64_t prefix;
+    Primitives primitives;
+
+    bool operator<(const PrefixGroup& other) const {
+      return prefix < other.prefix;
+    }
+  };
+
+  static uint64_t EncodePrefix(absl::string_view identifier) {
+    uint64_t prefix = 0;
+    for (char c : identifier) {
+      prefix = (prefix << 8) | static_cast<uint8_t>(c);
+    }
+    return prefix;
+  }
+
+  // Makes this set immutable, and moves the entries into the sorted lookup
+  // table, which replaces the hash map. The entries themselves do not move.
+  // Must be called only once, before the set is shared with other threads.
+  void Freeze() {
+    {
+      absl::MutexLock lock(primitives_mutex_.get());
+      prefix_table_.reserve(primitives_.size());
+      for (auto& prefix_and_vector : primitives_) {
+        // All entries of a group share the prefix of the first one.
+        const OutputPrefix& identifier =
+            prefix_and_vector.second.front()->get_output_prefix();
+        if (identifier.empty()) {
+          raw_primitives_ = std::move(prefix_and_vector.second);
+        } else {
+          prefix_table_.push_back({identifier.AsInteger(),
+                                   std::move(prefix_and_vector.second)});
+        }
+      }
+      // Releases the nodes and the buckets.
+      CiphertextPrefixToPrimitivesMap().swap(primitives_);
+    }
+    std::sort(prefix_table_.begin(), prefix_table_.end());
+    prefix_table_.shrink_to_fit();
+    raw_primitives_.shrink_to_fit();
+    primitives_mutex_.reset();
+  }
+
+  // Lock-free lookup in an immutable set.
+  const Primitives* FindImmutable(absl::string_view identifier) const {
+    if (identifier.size() == CryptoFormat::kRawPrefixSize) {
+      return raw_primitives_.empty() ? nullptr : &raw_primitives_;
+    }
+    if (identifier.size() != CryptoFormat::kNonRawPrefixSize) return nullptr;
+    uint64_t prefix = EncodePrefix(identifier);
+    auto found = std::lower_bound(
+        prefix_table_.begin(), prefix_table_.end(), prefix,
+        [](const PrefixGroup& group, uint64_t value) {
+          return group.prefix < value;
+        });
+    if (found == prefix_table_.end() || found->prefix != prefix) {
+      return nullptr;
+    }
+    return &found->primitives;
+  }
+
   Entry<P>* primary_;  // the Entry<P> object is owned by primitives_
-  mutable absl::Mutex primitives_mutex_;
+  // Null iff the set is immutable.
+  mutable std::unique_ptr<absl::Mutex> primitives_mutex_;
   CiphertextPrefixToPrimitivesMap primitives_
       ABSL_GUARDED_BY(primitives_mutex_);
+
+  // Only used by immutable sets, which hold their entries here instead of in
+  // primitives_.
+  std::vector<PrefixGroup> prefix_table_;
+  Primitives raw_primitives_;
 };
 
 }  // namespace tink
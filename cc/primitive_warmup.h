@@ -0,0 +1,149 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TINK_PRIMITIVE_WARMUP_H_
+#define TINK_PRIMITIVE_WARMUP_H_
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
+#include "tink/aead.h"
+#include "tink/deterministic_aead.h"
+#include "tink/hybrid_decrypt.h"
+#include "tink/hybrid_encrypt.h"
+#include "tink/keyset_handle.h"
+#include "tink/mac.h"
+#include "tink/primitive_set.h"
+#include "tink/public_key_sign.h"
+#include "tink/public_key_verify.h"
+#include "tink/registry.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+
+// PrimitiveWarmup creates primitives whose lazily initialized state is set
+// up before they are used. Several primitives defer expensive work to their
+// first operation, e.g. BoringSSL computes the Montgomery contexts and the
+// blinding of an RSA key when it is first used, and the process-wide random
+// number generator is seeded on its first use. Done on the first production
+// request, this shows up as latency spikes after deploys and keyset reloads.
+//
+// PrimitiveWarmup::GetPrimitive() is a replacement for
+// KeysetHandle::GetPrimitive() which performs one operation with every key
+// of the keyset before returning the wrapped primitive, e.g. when a new
+// keyset is loaded in the background:
+//
+//   auto aead_result = PrimitiveWarmup::GetPrimitive<Aead>(
+//       *keyset_handle, PrimitiveWarmup::Options());
+//   if (!aead_result.ok()) return aead_result.status();
+//   current_aead.store(std::move(aead_result.ValueOrDie()));
+//
+// A key with which the warm-up operation fails is reported as an error, as
+// its primitive would fail in production too.
+//
+// Warm-up is supported for Aead, DeterministicAead, Mac, PublicKeySign,
+// PublicKeyVerify, HybridEncrypt and HybridDecrypt. As the inputs for
+// PublicKeyVerify and HybridDecrypt are made up, their operation is
+// expected to fail and only initializes what is set up before the input is
+// rejected.
+class PrimitiveWarmup {
+ public:
+  struct Options {
+    // If set, runs the given task, typically on a thread pool owned by the
+    // caller, so that up to max_keys_in_flight keys are warmed up
+    // concurrently. Tasks may run on any thread and in any order, and must
+    // all eventually run. If null, the keys are warmed up one after the
+    // other on the calling thread.
+    std::function<void(std::function<void()>)> schedule;
+    // The maximal number of keys warmed up concurrently. Must be positive.
+    int max_keys_in_flight = 8;
+  };
+
+  // Creates the primitives of the enabled keys of 'keyset_handle', warms
+  // each of them up, and wraps them with the PrimitiveWrapper<P, P> in the
+  // global registry.
+  template <class P>
+  static crypto::tink::util::StatusOr<std::unique_ptr<P>> GetPrimitive(
+      const KeysetHandle& keyset_handle, const Options& options);
+
+  // Warms up all primitives of 'primitive_set', creating those of lazy
+  // entries.
+  template <class P>
+  static crypto::tink::util::Status WarmupPrimitiveSet(
+      const PrimitiveSet<P>& primitive_set, const Options& options);
+
+  // Warms up a single primitive by performing one operation with it.
+  static crypto::tink::util::Status Warmup(const Aead& aead);
+  static crypto::tink::util::Status Warmup(const DeterministicAead& daead);
+  static crypto::tink::util::Status Warmup(const Mac& mac);
+  static crypto::tink::util::Status Warmup(const PublicKeySign& signer);
+  static crypto::tink::util::Status Warmup(const PublicKeyVerify& verifier);
+  static crypto::tink::util::Status Warmup(const HybridEncrypt& encrypter);
+  static crypto::tink::util::Status Warmup(const HybridDecrypt& decrypter);
+
+ private:
+  // Runs all 'tasks' as configured by 'options', and returns the first
+  // error, if any.
+  static crypto::tink::util::Status RunAll(
+      const std::vector<std::function<crypto::tink::util::Status()>>& tasks,
+      const Options& options);
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// Implementation details of templated methods.
+
+template <class P>
+crypto::tink::util::StatusOr<std::unique_ptr<P>>
+PrimitiveWarmup::GetPrimitive(const KeysetHandle& keyset_handle,
+                              const Options& options) {
+  auto primitives_result = keyset_handle.GetPrimitives<P>(nullptr);
+  if (!primitives_result.ok()) return primitives_result.status();
+  crypto::tink::util::Status status =
+      WarmupPrimitiveSet(*primitives_result.ValueOrDie(), options);
+  if (!status.ok()) return status;
+  return Registry::Wrap<P>(std::move(primitives_result.ValueOrDie()));
+}
+
+template <class P>
+crypto::tink::util::Status PrimitiveWarmup::WarmupPrimitiveSet(
+    const PrimitiveSet<P>& primitive_set, const Options& options) {
+  std::vector<std::function<crypto::tink::util::Status()>> tasks;
+  for (const typename PrimitiveSet<P>::template Entry<P>* entry :
+       primitive_set.get_all()) {
+    tasks.push_back([entry]() -> crypto::tink::util::Status {
+      auto primitive_result = entry->get_primitive_or_status();
+      if (!primitive_result.ok()) return primitive_result.status();
+      crypto::tink::util::Status status =
+          Warmup(*primitive_result.ValueOrDie());
+      if (status.ok()) return status;
+      return crypto::tink::util::Status(
+          status.CanonicalCode(),
+          absl::StrCat("warm-up of key ", entry->get_key_id(),
+                       " failed: ", status.error_message()));
+    });
+  }
+  return RunAll(tasks, options);
+}
+
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_PRIMITIVE_WARMUP_H_
@@ -37,6 +37,12 @@ class PrimitiveWrapper {
   virtual ~PrimitiveWrapper() {}
   virtual crypto::tink::util::StatusOr<std::unique_ptr<Primitive>> Wrap(
       std::unique_ptr<PrimitiveSet<InputPrimitive>> primitive_set) const = 0;
+
+  // Returns true if the wrapper accesses the primitives of non-primary entries
+  // only through Entry::get_primitive_or_status(), so that they can be lazy
+  // (see PrimitiveSet::Builder::AddLazyPrimitive()). If so, keysets wrapped
+  // through the Registry only create the primary primitive eagerly.
+  virtual bool SupportsLazyPrimitives() const { return false; }
 };
 
 }  // namespace tink
@@ -17,7 +17,16 @@
 #ifndef TINK_PUBLIC_KEY_SIGN_H_
 #define TINK_PUBLIC_KEY_SIGN_H_
 
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "tink/output_stream_with_result.h"
+#include "tink/util/status.h"
 #include "tink/util/statusor.h"
 
 namespace crypto {
@@ -37,7 +46,80 @@ class PublicKeySign {
   virtual crypto::tink::util::StatusOr<std::string> Sign(
       absl::string_view data) const = 0;
 
+  // Returns 'output_prefix' followed by the signature of 'data' followed by
+  // 'data_suffix'. Wrappers use it to prepend the output prefix of a key, and
+  // to append the byte that LEGACY keys sign after the data, and
+  // implementations can override it to do so without copying the data or the
+  // signature. The default implementation concatenates.
+  virtual crypto::tink::util::StatusOr<std::string> SignWithPrefix(
+      absl::string_view output_prefix, absl::string_view data,
+      absl::string_view data_suffix) const {
+    crypto::tink::util::StatusOr<std::string> sign_result =
+        data_suffix.empty() ? Sign(data)
+                            : Sign(absl::StrCat(data, data_suffix));
+    if (!sign_result.ok()) return sign_result.status();
+    return absl::StrCat(output_prefix, sign_result.ValueOrDie());
+  }
+
+  // Signs each of 'data'. The signatures are stored back-to-back in
+  // '*arena', which is overwritten, and '*signatures' is set to one view into
+  // '*arena' per input, in the order of 'data'. The views are valid until
+  // '*arena' is modified. Fails if signing any input fails.
+  virtual crypto::tink::util::Status SignBatch(
+      absl::Span<const absl::string_view> data, std::string* arena,
+      std::vector<absl::string_view>* signatures) const {
+    return SignBatchWithPrefix("", data, "", arena, signatures);
+  }
+
+  // Like SignBatch(), but every signature is the one SignWithPrefix() returns
+  // for 'output_prefix' and 'data_suffix'. Implementations which sign into a
+  // packed buffer override it, the default implementation calls
+  // SignWithPrefix() for each input.
+  virtual crypto::tink::util::Status SignBatchWithPrefix(
+      absl::string_view output_prefix,
+      absl::Span<const absl::string_view> data, absl::string_view data_suffix,
+      std::string* arena, std::vector<absl::string_view>* signatures) const {
+    arena->clear();
+    std::vector<int64_t> sizes;
+    sizes.reserve(data.size());
+    for (absl::string_view message : data) {
+      auto sign_result = SignWithPrefix(output_prefix, message, data_suffix);
+      if (!sign_result.ok()) return sign_result.status();
+      arena->append(sign_result.ValueOrDie());
+      sizes.push_back(sign_result.ValueOrDie().size());
+    }
+    SplitArena(*arena, sizes, signatures);
+    return crypto::tink::util::Status::OK;
+  }
+
+  // Returns a stream which, when closed, returns the signature of the data
+  // written to it, so that messages need not be held in memory to be
+  // signed. The signature is the one Sign() would return for the data. The
+  // primitive must outlive the stream. The default implementation returns
+  // UNIMPLEMENTED.
+  virtual crypto::tink::util::StatusOr<
+      std::unique_ptr<OutputStreamWithResult<std::string>>>
+  NewSignOutputStream() const {
+    return crypto::tink::util::Status(
+        crypto::tink::util::error::UNIMPLEMENTED,
+        "Streaming signing is not supported.");
+  }
+
   virtual ~PublicKeySign() {}
+
+ protected:
+  // Sets '*views' to consecutive substrings of 'arena' of the given sizes.
+  static void SplitArena(absl::string_view arena,
+                         const std::vector<int64_t>& sizes,
+                         std::vector<absl::string_view>* views) {
+    views->clear();
+    views->reserve(sizes.size());
+    int64_t offset = 0;
+    for (int64_t size : sizes) {
+      views->push_back(arena.substr(offset, size));
+      offset += size;
+    }
+  }
 };
 
 }  // namespace tink
@@ -17,8 +17,16 @@
 #ifndef TINK_PUBLIC_KEY_VERIFY_H_
 #define TINK_PUBLIC_KEY_VERIFY_H_
 
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "tink/output_stream_with_result.h"
 #include "tink/util/status.h"
+#include "tink/util/statusor.h"
 
 namespace crypto {
 namespace tink {
@@ -38,6 +46,47 @@ class PublicKeyVerify {
       absl::string_view signature,
       absl::string_view data) const = 0;
 
+  // Verifies that 'signature' is a digital signature for 'data', where
+  // 'key_id' is a hint of the ID of the key which created the signature, for
+  // instance one looked up from the "kid" of the signed message. Primitives
+  // of a keyset verify with the key with that ID first, instead of trying
+  // every key which could match the signature. A wrong hint only costs one
+  // failed verification. The default implementation ignores the hint.
+  virtual crypto::tink::util::Status VerifyWithKeyId(
+      absl::string_view signature, absl::string_view data,
+      uint32_t key_id) const {
+    return Verify(signature, data);
+  }
+
+  // Verifies a batch of (signature, data) pairs and returns one status per
+  // pair, in the order of 'inputs'. Each status is the one Verify() would
+  // return for that pair, so an invalid signature does not affect the
+  // results of the other pairs. The default implementation calls Verify()
+  // for every pair.
+  virtual std::vector<crypto::tink::util::Status> BatchVerify(
+      absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs)
+      const {
+    std::vector<crypto::tink::util::Status> results;
+    results.reserve(inputs.size());
+    for (const auto& input : inputs) {
+      results.push_back(Verify(input.first, input.second));
+    }
+    return results;
+  }
+
+  // Returns a stream which, when closed, verifies that 'signature' is a
+  // digital signature for the data written to it, so that messages need not
+  // be held in memory to be verified. The result is the one Verify() would
+  // return for the data. The primitive must outlive the stream. The default
+  // implementation returns UNIMPLEMENTED.
+  virtual crypto::tink::util::StatusOr<
+      std::unique_ptr<OutputStreamWithResult<crypto::tink::util::Status>>>
+  NewVerifyOutputStream(absl::string_view signature) const {
+    return crypto::tink::util::Status(
+        crypto::tink::util::error::UNIMPLEMENTED,
+        "Streaming verification is not supported.");
+  }
+
   virtual ~PublicKeyVerify() {}
 };
 
@@ -17,6 +17,10 @@
 #ifndef TINK_RANDOM_ACCESS_STREAM_H_
 #define TINK_RANDOM_ACCESS_STREAM_H_
 
+#include <cstdint>
+#include <vector>
+
+#include "absl/types/span.h"
 #include "tink/util/buffer.h"
 #include "tink/util/status.h"
 #include "tink/util/statusor.h"
@@ -53,6 +57,30 @@ class RandomAccessStream {
       int count,
       crypto::tink::util::Buffer* dest_buffer) = 0;
 
+  // A single read of PReadV(), with the arguments of PRead().
+  struct ReadRequest {
+    int64_t position;
+    int count;
+    crypto::tink::util::Buffer* dest_buffer;
+  };
+
+  // Performs all reads in 'requests' and returns one status per request, in
+  // the order of 'requests'. Each read has the semantics of the PRead() with
+  // the same arguments. Implementations whose reads have a high latency,
+  // e.g. range requests to remote storage, can override this to merge the
+  // reads into fewer round-trips. The default implementation calls PRead()
+  // for every request.
+  virtual std::vector<crypto::tink::util::Status> PReadV(
+      absl::Span<const ReadRequest> requests) {
+    std::vector<crypto::tink::util::Status> results;
+    results.reserve(requests.size());
+    for (const auto& request : requests) {
+      results.push_back(
+          PRead(request.position, request.count, request.dest_buffer));
+    }
+    return results;
+  }
+
   // Returns the size of this stream in bytes, if available.
   // If the size is not available, returns a non-Ok status.
   // The returned value is the "logical" size of a stream, i.e. of
@@ -60,6 +88,15 @@ class RandomAccessStream {
   // For a successful PRead-operation the starting position should be
   // in the range 0..size()-1 (otherwise PRead may return a non-Ok status).
   virtual crypto::tink::util::StatusOr<int64_t> size() = 0;
+
+  // Like size(), but for streams whose size() is not authenticated, such as
+  // decrypting streams, the returned size is verified first, e.g. by
+  // decrypting the last segment. Implementations cache the verified size,
+  // so only the first call is expensive. The default implementation returns
+  // size().
+  virtual crypto::tink::util::StatusOr<int64_t> VerifiedSize() {
+    return size();
+  }
 };
 
 }  // namespace tink
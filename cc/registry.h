@@ -20,6 +20,7 @@
 #include <memory>
 #include <string>
 
+#include "absl/strings/string_view.h"
 #include "tink/core/registry_impl.h"
 #include "tink/util/status.h"
 #include "tink/util/statusor.h"
@@ -130,6 +131,27 @@ class Registry {
         new_key_allowed);
   }
 
+  // Like RegisterKeyTypeManager() with a default constructed KTManager, but
+  // the manager is only constructed when its key type is first looked up, so
+  // that registering a config costs little for the key types a binary does
+  // not use.
+  template <class KTManager>
+  static crypto::tink::util::Status RegisterKeyTypeManagerLazily(
+      bool new_key_allowed) {
+    return RegistryImpl::GlobalInstance()
+        .RegisterKeyTypeManagerLazily<KTManager>(new_key_allowed);
+  }
+
+  // Like RegisterAsymmetricKeyManagers() with default constructed managers,
+  // which are constructed when either key type is first looked up.
+  template <class PrivateKeyTypeManager, class KeyTypeManager>
+  static crypto::tink::util::Status RegisterAsymmetricKeyManagersLazily(
+      bool new_key_allowed) {
+    return RegistryImpl::GlobalInstance()
+        .RegisterAsymmetricKeyManagersLazily<PrivateKeyTypeManager,
+                                             KeyTypeManager>(new_key_allowed);
+  }
+
   template <class ConcretePrimitiveWrapper>
   static crypto::tink::util::Status RegisterPrimitiveWrapper(
       std::unique_ptr<ConcretePrimitiveWrapper> wrapper) {
@@ -145,7 +167,7 @@ class Registry {
   // but should be test only anyhow.
   template <class P>
   static crypto::tink::util::StatusOr<const KeyManager<P>*> get_key_manager(
-      const std::string& type_url) {
+      absl::string_view type_url) {
     return RegistryImpl::GlobalInstance().get_key_manager<P>(type_url);
   }
 
@@ -162,7 +184,7 @@ class Registry {
   // and calls manager's GetPrimitive(key)-method.
   template <class P>
   static crypto::tink::util::StatusOr<std::unique_ptr<P>> GetPrimitive(
-      const std::string& type_url, const portable_proto::MessageLite& key) {
+      absl::string_view type_url, const portable_proto::MessageLite& key) {
     return RegistryImpl::GlobalInstance().GetPrimitive<P>(type_url, key);
   }
 
@@ -182,7 +204,7 @@ class Registry {
   // a PrivateKeyFactory, and calls PrivateKeyFactory::GetPublicKeyData.
   static crypto::tink::util::StatusOr<
       std::unique_ptr<google::crypto::tink::KeyData>>
-  GetPublicKeyData(const std::string& type_url,
+  GetPublicKeyData(absl::string_view type_url,
                    const std::string& serialized_private_key) {
     return RegistryImpl::GlobalInstance().GetPublicKeyData(
         type_url, serialized_private_key);
@@ -0,0 +1,227 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_ROTATING_PRIMITIVE_H_
+#define TINK_ROTATING_PRIMITIVE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "openssl/mem.h"
+#include "openssl/sha.h"
+#include "tink/internal/hazard_pointers.h"
+#include "tink/keyset_handle.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+
+// A primitive of type P for a keyset which is reloaded periodically, so that
+// key rotations are picked up without recreating the primitive in every
+// caller. For example, for an encrypted keyset in a file:
+//
+//   auto aead_result = RotatingPrimitive<Aead>::New(
+//       [&master_key_aead]() {
+//         return KeysetHandle::Read(
+//             OpenKeysetReader("/path/to/keyset"), *master_key_aead);
+//       },
+//       absl::Minutes(10));
+//   ...
+//   auto ciphertext_result =
+//       aead_result.ValueOrDie()->Get()->Encrypt(plaintext, associated_data);
+//
+// A background thread calls the keyset source every 'refresh_interval', and
+// if the keyset changed (including only its key material), builds the new primitive with
+// KeysetHandle::GetPrimitive<P>() and publishes it atomically. Get() never
+// blocks: it protects the current primitive with a hazard pointer, and a
+// replaced primitive is deleted once no caller uses it anymore.
+//
+// If a reload fails, the previous primitive stays in use, and the error is
+// returned by last_refresh_status().
+template <class P>
+class RotatingPrimitive {
+ public:
+  // Returns the handle of the current keyset. Called by the thread of the
+  // RotatingPrimitive, so it must be thread-compatible with the caller.
+  using KeysetHandleSource = std::function<
+      crypto::tink::util::StatusOr<std::unique_ptr<KeysetHandle>>()>;
+
+  // A reference to the primitive which was current when Get() was called. The
+  // primitive stays valid while the Handle exists, also if it is replaced.
+  class Handle {
+   public:
+    P* get() const { return primitive_; }
+    P* operator->() const { return primitive_; }
+    P& operator*() const { return *primitive_; }
+
+   private:
+    friend class RotatingPrimitive;
+
+    explicit Handle(const RotatingPrimitive& rotating_primitive)
+        : holder_(&rotating_primitive.hazard_pointers_),
+          primitive_(static_cast<P*>(
+              holder_.Protect(rotating_primitive.current_))) {}
+
+    internal::HazardPointerDomain::Holder holder_;
+    P* primitive_;
+  };
+
+  // Returns a RotatingPrimitive for the keysets returned by 'source', which
+  // first loads a keyset and fails if it cannot create its primitive.
+  static crypto::tink::util::StatusOr<std::unique_ptr<RotatingPrimitive<P>>>
+  New(KeysetHandleSource source, absl::Duration refresh_interval) {
+    if (source == nullptr) {
+      return util::Status(util::error::INVALID_ARGUMENT,
+                          "source must be non-null");
+    }
+    if (refresh_interval <= absl::ZeroDuration()) {
+      return util::Status(util::error::INVALID_ARGUMENT,
+                          "refresh_interval must be positive");
+    }
+    auto rotating_primitive = absl::WrapUnique(
+        new RotatingPrimitive<P>(std::move(source), refresh_interval));
+    util::Status status = rotating_primitive->Refresh();
+    if (!status.ok()) return status;
+    rotating_primitive->Start();
+    return std::move(rotating_primitive);
+  }
+
+  RotatingPrimitive(const RotatingPrimitive&) = delete;
+  RotatingPrimitive& operator=(const RotatingPrimitive&) = delete;
+
+  // Stops the refresh thread. There must be no Handles anymore.
+  ~RotatingPrimitive() {
+    {
+      absl::MutexLock lock(&mutex_);
+      stopped_ = true;
+    }
+    if (thread_.joinable()) thread_.join();
+    delete static_cast<P*>(current_.load(std::memory_order_acquire));
+  }
+
+  // Returns the current primitive. Thread-safe and lock-free.
+  Handle Get() const { return Handle(*this); }
+
+  // Loads the keyset now, and publishes its primitive if the keyset changed.
+  // Thread-safe.
+  crypto::tink::util::Status Refresh() ABSL_LOCKS_EXCLUDED(refresh_mutex_) {
+    absl::MutexLock lock(&refresh_mutex_);
+    util::Status status = RefreshLocked();
+    {
+      absl::MutexLock status_lock(&mutex_);
+      last_refresh_status_ = status;
+    }
+    return status;
+  }
+
+  // Returns the result of the last reload.
+  crypto::tink::util::Status last_refresh_status() const
+      ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock lock(&mutex_);
+    return last_refresh_status_;
+  }
+
+  // Returns the number of times a new primitive was published.
+  int64_t generation() const {
+    return generation_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  RotatingPrimitive(KeysetHandleSource source, absl::Duration refresh_interval)
+      : source_(std::move(source)), refresh_interval_(refresh_interval) {}
+
+  void Start() {
+    thread_ = std::thread([this]() {
+      mutex_.Lock();
+      while (!mutex_.AwaitWithTimeout(absl::Condition(&stopped_),
+                                      refresh_interval_)) {
+        mutex_.Unlock();
+        Refresh();
+        // Deletes the primitives whose last Handle went away since.
+        hazard_pointers_.Reclaim();
+        mutex_.Lock();
+      }
+      mutex_.Unlock();
+    });
+  }
+
+  crypto::tink::util::Status RefreshLocked()
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(refresh_mutex_) {
+    auto handle_result = source_();
+    if (!handle_result.ok()) return handle_result.status();
+    const KeysetHandle& handle = *handle_result.ValueOrDie();
+    std::string keyset_digest = KeysetDigest(handle.get_keyset());
+    if (current_.load(std::memory_order_relaxed) != nullptr &&
+        keyset_digest == keyset_digest_) {
+      return util::OkStatus();
+    }
+    auto primitive_result = handle.GetPrimitive<P>();
+    if (!primitive_result.ok()) return primitive_result.status();
+    void* previous = current_.exchange(primitive_result.ValueOrDie().release(),
+                                       std::memory_order_seq_cst);
+    keyset_digest_ = std::move(keyset_digest);
+    generation_.fetch_add(1, std::memory_order_relaxed);
+    if (previous != nullptr) {
+      hazard_pointers_.Retire(
+          previous, [](void* primitive) { delete static_cast<P*>(primitive); });
+    }
+    return util::OkStatus();
+  }
+
+  // Returns the SHA-256 hash of the serialized 'keyset'. Unlike the keyset
+  // info, it also changes if only the key material of a key changes, e.g.
+  // when a keyset is replaced by one reusing its key IDs.
+  static std::string KeysetDigest(const google::crypto::tink::Keyset& keyset) {
+    std::string serialized = keyset.SerializeAsString();
+    uint8_t digest[SHA256_DIGEST_LENGTH];
+    SHA256(reinterpret_cast<const uint8_t*>(serialized.data()),
+           serialized.size(), digest);
+    OPENSSL_cleanse(&serialized[0], serialized.size());
+    return std::string(reinterpret_cast<const char*>(digest), sizeof(digest));
+  }
+
+  const KeysetHandleSource source_;
+  const absl::Duration refresh_interval_;
+
+  // The current primitive, a P* owned by this object.
+  std::atomic<void*> current_{nullptr};
+  std::atomic<int64_t> generation_{0};
+  mutable internal::HazardPointerDomain hazard_pointers_;
+
+  absl::Mutex refresh_mutex_;
+  std::string keyset_digest_ ABSL_GUARDED_BY(refresh_mutex_);
+
+  mutable absl::Mutex mutex_;
+  bool stopped_ ABSL_GUARDED_BY(mutex_) = false;
+  crypto::tink::util::Status last_refresh_status_ ABSL_GUARDED_BY(mutex_);
+
+  std::thread thread_;
+};
+
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_ROTATING_PRIMITIVE_H_
@@ -0,0 +1,73 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_SAX_JSON_KEYSET_READER_H_
+#define TINK_SAX_JSON_KEYSET_READER_H_
+
+#include <istream>
+#include <memory>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "tink/keyset_reader.h"
+#include "tink/util/statusor.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+
+// A KeysetReader for the same JSON format as JsonKeysetReader, for
+// applications that read many keysets, e.g. at startup.
+//
+// Instead of building a rapidjson::Document and then copying it field by
+// field into the Keyset, Read() parses the JSON in place with rapidjson's SAX
+// API and fills in the Keyset as the JSON is read. Key values are base64
+// decoded straight into their KeyData protos. ReadEncrypted() is the same as
+// in JsonKeysetReader.
+//
+// Unlike JsonKeysetReader, Read() rejects keysets in which a key, or its key
+// data, has the same field more than once.
+class SaxJsonKeysetReader : public KeysetReader {
+ public:
+  static crypto::tink::util::StatusOr<std::unique_ptr<KeysetReader>> New(
+      std::unique_ptr<std::istream> keyset_stream);
+  static crypto::tink::util::StatusOr<std::unique_ptr<KeysetReader>> New(
+      absl::string_view serialized_keyset);
+
+  crypto::tink::util::StatusOr<std::unique_ptr<google::crypto::tink::Keyset>>
+  Read() override;
+
+  crypto::tink::util::StatusOr<
+      std::unique_ptr<google::crypto::tink::EncryptedKeyset>>
+  ReadEncrypted() override;
+
+ private:
+  explicit SaxJsonKeysetReader(std::unique_ptr<std::istream> keyset_stream)
+      : keyset_stream_(std::move(keyset_stream)) {}
+  explicit SaxJsonKeysetReader(absl::string_view serialized_keyset)
+      : serialized_keyset_(serialized_keyset), keyset_stream_(nullptr) {}
+
+  // Returns the JSON to parse, from the stream if there is one.
+  std::string GetSerializedKeyset();
+
+  std::string serialized_keyset_;
+  std::unique_ptr<std::istream> keyset_stream_;
+};
+
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_SAX_JSON_KEYSET_READER_H_
@@ -0,0 +1,100 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/signature/parallel_batch_sign.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "tink/public_key_sign.h"
+#include "tink/subtle/subtle_util.h"
+#include "tink/util/status.h"
+
+namespace crypto {
+namespace tink {
+
+namespace {
+
+struct Shard {
+  std::string arena;
+  std::vector<absl::string_view> signatures;
+  util::Status status;
+};
+
+}  // namespace
+
+util::Status ParallelBatchSign(const PublicKeySign& signer,
+                               absl::Span<const absl::string_view> data,
+                               const ParallelBatchSignOptions& options,
+                               std::string* arena,
+                               std::vector<absl::string_view>* signatures) {
+  if (options.schedule == nullptr) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "schedule must be non-null");
+  }
+  if (options.shard_size <= 0) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "shard_size must be positive");
+  }
+  size_t shard_size = options.shard_size;
+  if (data.size() <= shard_size) {
+    return signer.SignBatch(data, arena, signatures);
+  }
+
+  std::vector<Shard> shards((data.size() + shard_size - 1) / shard_size);
+  absl::Mutex mutex;
+  size_t shards_pending = shards.size();
+  for (size_t i = 0; i < shards.size(); i++) {
+    options.schedule([&, i]() {
+      Shard& shard = shards[i];
+      shard.status = signer.SignBatch(data.subspan(i * shard_size, shard_size),
+                                      &shard.arena, &shard.signatures);
+      absl::MutexLock lock(&mutex);
+      shards_pending--;
+    });
+  }
+  auto all_done = [&shards_pending]() { return shards_pending == 0; };
+  mutex.LockWhen(absl::Condition(&all_done));
+  mutex.Unlock();
+
+  size_t total_size = 0;
+  for (const Shard& shard : shards) {
+    if (!shard.status.ok()) return shard.status;
+    total_size += shard.arena.size();
+  }
+  // Moves the signatures of all shards into 'arena'.
+  subtle::ResizeStringUninitialized(arena, total_size);
+  signatures->clear();
+  signatures->reserve(data.size());
+  size_t offset = 0;
+  for (const Shard& shard : shards) {
+    std::memcpy(&(*arena)[0] + offset, shard.arena.data(), shard.arena.size());
+    for (absl::string_view signature : shard.signatures) {
+      signatures->push_back(absl::string_view(
+          arena->data() + offset + (signature.data() - shard.arena.data()),
+          signature.size()));
+    }
+    offset += shard.arena.size();
+  }
+  return util::OkStatus();
+}
+
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,55 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TINK_SIGNATURE_PARALLEL_BATCH_SIGN_H_
+#define TINK_SIGNATURE_PARALLEL_BATCH_SIGN_H_
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "tink/public_key_sign.h"
+#include "tink/util/status.h"
+
+namespace crypto {
+namespace tink {
+
+// Options for signing a batch of messages concurrently.
+struct ParallelBatchSignOptions {
+  // Runs the given task, typically on a thread pool owned by the caller.
+  // Tasks may run on any thread and in any order. Must be non-null,
+  // and must eventually run every task it has been given.
+  std::function<void(std::function<void()>)> schedule;
+  // The number of messages signed by each task. Must be positive.
+  int shard_size = 256;
+};
+
+// Same as signer.SignBatch(data, arena, signatures), but splits 'data' into
+// shards of options.shard_size messages, which are signed concurrently with
+// SignBatch() on tasks run by options.schedule. Blocks until all shards have
+// been signed. Batches of at most one shard are signed on the calling thread.
+crypto::tink::util::Status ParallelBatchSign(
+    const PublicKeySign& signer, absl::Span<const absl::string_view> data,
+    const ParallelBatchSignOptions& options, std::string* arena,
+    std::vector<absl::string_view>* signatures);
+
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_SIGNATURE_PARALLEL_BATCH_SIGN_H_
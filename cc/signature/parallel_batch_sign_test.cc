@@ -0,0 +1,159 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/signature/parallel_batch_sign.h"
+
+#include <functional>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "tink/public_key_sign.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "tink/util/test_matchers.h"
+#include "tink/util/test_util.h"
+
+namespace crypto {
+namespace tink {
+namespace {
+
+using ::crypto::tink::test::DummyPublicKeySign;
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+
+// Runs every task on a new thread, and joins them on destruction.
+class ThreadScheduler {
+ public:
+  ~ThreadScheduler() {
+    for (std::thread& thread : threads_) thread.join();
+  }
+
+  std::function<void(std::function<void()>)> AsFunction() {
+    return [this](std::function<void()> task) {
+      absl::MutexLock lock(&mutex_);
+      threads_.emplace_back(std::move(task));
+    };
+  }
+
+  int num_tasks() {
+    absl::MutexLock lock(&mutex_);
+    return threads_.size();
+  }
+
+ private:
+  absl::Mutex mutex_;
+  std::vector<std::thread> threads_;
+};
+
+// Fails to sign the message "fail", and signs others like DummyPublicKeySign.
+class FailingPublicKeySign : public PublicKeySign {
+ public:
+  util::StatusOr<std::string> Sign(absl::string_view data) const override {
+    if (data == "fail") {
+      return util::Status(util::error::INTERNAL, "signing failed");
+    }
+    return signer_.Sign(data);
+  }
+
+ private:
+  DummyPublicKeySign signer_{"signer"};
+};
+
+TEST(ParallelBatchSignTest, SameSignaturesAsSign) {
+  DummyPublicKeySign signer("signer");
+  std::vector<std::string> messages;
+  for (int i = 0; i < 100; i++) messages.push_back(absl::StrCat("data ", i));
+  std::vector<absl::string_view> data(messages.begin(), messages.end());
+
+  ThreadScheduler scheduler;
+  ParallelBatchSignOptions options;
+  options.schedule = scheduler.AsFunction();
+  options.shard_size = 7;
+  std::string arena;
+  std::vector<absl::string_view> signatures;
+  ASSERT_THAT(ParallelBatchSign(signer, data, options, &arena, &signatures),
+              IsOk());
+  EXPECT_EQ(scheduler.num_tasks(), 15);
+
+  ASSERT_EQ(signatures.size(), messages.size());
+  for (int i = 0; i < messages.size(); i++) {
+    EXPECT_EQ(signatures[i], signer.Sign(messages[i]).ValueOrDie()) << i;
+  }
+}
+
+TEST(ParallelBatchSignTest, SmallBatchRunsOnCallingThread) {
+  DummyPublicKeySign signer("signer");
+  std::vector<absl::string_view> data = {"data", "other data"};
+
+  ThreadScheduler scheduler;
+  ParallelBatchSignOptions options;
+  options.schedule = scheduler.AsFunction();
+  std::string arena;
+  std::vector<absl::string_view> signatures;
+  ASSERT_THAT(ParallelBatchSign(signer, data, options, &arena, &signatures),
+              IsOk());
+  EXPECT_EQ(scheduler.num_tasks(), 0);
+  ASSERT_EQ(signatures.size(), 2);
+  EXPECT_EQ(signatures[0], signer.Sign("data").ValueOrDie());
+  EXPECT_EQ(signatures[1], signer.Sign("other data").ValueOrDie());
+}
+
+TEST(ParallelBatchSignTest, FailingShard) {
+  FailingPublicKeySign signer;
+  for (int failing : {0, 50, 99}) {
+    SCOPED_TRACE(absl::StrCat("failing: ", failing));
+    std::vector<std::string> messages;
+    for (int i = 0; i < 100; i++) messages.push_back(absl::StrCat("data ", i));
+    messages[failing] = "fail";
+    std::vector<absl::string_view> data(messages.begin(), messages.end());
+
+    ThreadScheduler scheduler;
+    ParallelBatchSignOptions options;
+    options.schedule = scheduler.AsFunction();
+    options.shard_size = 7;
+    std::string arena;
+    std::vector<absl::string_view> signatures;
+    EXPECT_THAT(ParallelBatchSign(signer, data, options, &arena, &signatures),
+                StatusIs(util::error::INTERNAL));
+  }
+}
+
+TEST(ParallelBatchSignTest, InvalidOptions) {
+  DummyPublicKeySign signer("signer");
+  std::string arena;
+  std::vector<absl::string_view> signatures;
+  ParallelBatchSignOptions options;
+  EXPECT_THAT(ParallelBatchSign(signer, {}, options, &arena, &signatures),
+              StatusIs(util::error::INVALID_ARGUMENT));
+
+  ThreadScheduler scheduler;
+  options.schedule = scheduler.AsFunction();
+  options.shard_size = 0;
+  EXPECT_THAT(ParallelBatchSign(signer, {}, options, &arena, &signatures),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,67 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/signature/parallel_batch_verify.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "tink/public_key_verify.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+
+util::StatusOr<std::vector<util::Status>> ParallelBatchVerify(
+    const PublicKeyVerify& verifier,
+    absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs,
+    const ParallelBatchVerifyOptions& options) {
+  if (options.schedule == nullptr) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "schedule must be non-null");
+  }
+  if (options.shard_size <= 0) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "shard_size must be positive");
+  }
+  size_t shard_size = options.shard_size;
+  if (inputs.size() <= shard_size) return verifier.BatchVerify(inputs);
+
+  std::vector<util::Status> results(inputs.size());
+  absl::Mutex mutex;
+  size_t shards_pending = (inputs.size() + shard_size - 1) / shard_size;
+  for (size_t start = 0; start < inputs.size(); start += shard_size) {
+    options.schedule([&, start]() {
+      auto shard = inputs.subspan(start, shard_size);
+      std::vector<util::Status> shard_results = verifier.BatchVerify(shard);
+      std::move(shard_results.begin(), shard_results.end(),
+                results.begin() + start);
+      absl::MutexLock lock(&mutex);
+      shards_pending--;
+    });
+  }
+  auto all_done = [&shards_pending]() { return shards_pending == 0; };
+  mutex.LockWhen(absl::Condition(&all_done));
+  mutex.Unlock();
+  return results;
+}
+
+}  // namespace tink
+}  // namespace crypto
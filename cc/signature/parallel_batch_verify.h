@@ -0,0 +1,58 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_SIGNATURE_PARALLEL_BATCH_VERIFY_H_
+#define TINK_SIGNATURE_PARALLEL_BATCH_VERIFY_H_
+
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "tink/public_key_verify.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+
+// Options for verifying a batch of signatures concurrently.
+struct ParallelBatchVerifyOptions {
+  // Runs the given task, typically on a thread pool owned by the caller.
+  // Tasks may run on any thread and in any order. Must be non-null,
+  // and must eventually run every task it has been given.
+  std::function<void(std::function<void()>)> schedule;
+  // The number of (signature, data) pairs verified by each task. Must be
+  // positive.
+  int shard_size = 256;
+};
+
+// Returns the same results as verifier.BatchVerify(inputs), but splits
+// 'inputs' into shards of options.shard_size pairs, which are verified
+// concurrently with BatchVerify() on tasks run by options.schedule. Blocks
+// until all shards have been verified. Batches of at most one shard are
+// verified on the calling thread.
+crypto::tink::util::StatusOr<std::vector<crypto::tink::util::Status>>
+ParallelBatchVerify(
+    const PublicKeyVerify& verifier,
+    absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs,
+    const ParallelBatchVerifyOptions& options);
+
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_SIGNATURE_PARALLEL_BATCH_VERIFY_H_
@@ -0,0 +1,132 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/signature/parallel_batch_verify.h"
+
+#include <functional>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "tink/public_key_verify.h"
+#include "tink/util/status.h"
+#include "tink/util/test_matchers.h"
+#include "tink/util/test_util.h"
+
+namespace crypto {
+namespace tink {
+namespace {
+
+using ::crypto::tink::test::DummyPublicKeySign;
+using ::crypto::tink::test::DummyPublicKeyVerify;
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+
+// Runs every task on a new thread, and joins them on destruction.
+class ThreadScheduler {
+ public:
+  ~ThreadScheduler() {
+    for (std::thread& thread : threads_) thread.join();
+  }
+
+  std::function<void(std::function<void()>)> AsFunction() {
+    return [this](std::function<void()> task) {
+      absl::MutexLock lock(&mutex_);
+      threads_.emplace_back(std::move(task));
+    };
+  }
+
+  int num_tasks() {
+    absl::MutexLock lock(&mutex_);
+    return threads_.size();
+  }
+
+ private:
+  absl::Mutex mutex_;
+  std::vector<std::thread> threads_;
+};
+
+TEST(ParallelBatchVerifyTest, SameResultsAsBatchVerify) {
+  DummyPublicKeySign signer("signer");
+  DummyPublicKeyVerify verifier("signer");
+  std::vector<std::string> data;
+  std::vector<std::string> signatures;
+  for (int i = 0; i < 100; i++) {
+    data.push_back(absl::StrCat("data ", i));
+    // Every third signature is invalid.
+    signatures.push_back(i % 3 == 0 ? "invalid" : signer.Sign(data[i])
+                                                      .ValueOrDie());
+  }
+  std::vector<std::pair<absl::string_view, absl::string_view>> inputs;
+  for (int i = 0; i < 100; i++) inputs.emplace_back(signatures[i], data[i]);
+
+  ThreadScheduler scheduler;
+  ParallelBatchVerifyOptions options;
+  options.schedule = scheduler.AsFunction();
+  options.shard_size = 7;
+  auto results_or = ParallelBatchVerify(verifier, inputs, options);
+  ASSERT_THAT(results_or.status(), IsOk());
+  EXPECT_EQ(scheduler.num_tasks(), 15);
+
+  std::vector<util::Status> expected = verifier.BatchVerify(inputs);
+  ASSERT_EQ(results_or.ValueOrDie().size(), expected.size());
+  for (int i = 0; i < expected.size(); i++) {
+    EXPECT_EQ(results_or.ValueOrDie()[i].ok(), i % 3 != 0) << i;
+    EXPECT_EQ(results_or.ValueOrDie()[i].error_code(),
+              expected[i].error_code());
+  }
+}
+
+TEST(ParallelBatchVerifyTest, SmallBatchRunsOnCallingThread) {
+  DummyPublicKeySign signer("signer");
+  DummyPublicKeyVerify verifier("signer");
+  std::string signature = signer.Sign("data").ValueOrDie();
+  std::vector<std::pair<absl::string_view, absl::string_view>> inputs = {
+      {signature, "data"}, {signature, "other data"}};
+
+  ThreadScheduler scheduler;
+  ParallelBatchVerifyOptions options;
+  options.schedule = scheduler.AsFunction();
+  auto results_or = ParallelBatchVerify(verifier, inputs, options);
+  ASSERT_THAT(results_or.status(), IsOk());
+  EXPECT_EQ(scheduler.num_tasks(), 0);
+  ASSERT_EQ(results_or.ValueOrDie().size(), 2);
+  EXPECT_THAT(results_or.ValueOrDie()[0], IsOk());
+  EXPECT_FALSE(results_or.ValueOrDie()[1].ok());
+}
+
+TEST(ParallelBatchVerifyTest, InvalidOptions) {
+  DummyPublicKeyVerify verifier("signer");
+  ParallelBatchVerifyOptions options;
+  EXPECT_THAT(ParallelBatchVerify(verifier, {}, options).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+
+  ThreadScheduler scheduler;
+  options.schedule = scheduler.AsFunction();
+  options.shard_size = 0;
+  EXPECT_THAT(ParallelBatchVerify(verifier, {}, options).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace tink
+}  // namespace crypto
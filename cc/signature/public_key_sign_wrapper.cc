@@ -16,7 +16,15 @@
 
 #include "tink/signature/public_key_sign_wrapper.h"
 
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "tink/crypto_format.h"
+#include "tink/internal/monitoring_util.h"
+#include "tink/memory_stats.h"
+#include "tink/monitoring.h"
 #include "tink/primitive_set.h"
 #include "tink/public_key_sign.h"
 #include "tink/subtle/subtle_util_boringssl.h"
@@ -42,19 +50,42 @@ util::Status Validate(PrimitiveSet<PublicKeySign>* public_key_sign_set) {
   return util::Status::OK;
 }
 
-class PublicKeySignSetWrapper : public PublicKeySign {
+class PublicKeySignSetWrapper : public PublicKeySign, public MemoryStatsSource {
  public:
-  explicit PublicKeySignSetWrapper(
-      std::unique_ptr<PrimitiveSet<PublicKeySign>> public_key_sign_set)
-      : public_key_sign_set_(std::move(public_key_sign_set)) {}
+  PublicKeySignSetWrapper(
+      std::unique_ptr<PrimitiveSet<PublicKeySign>> public_key_sign_set,
+      PrimitiveSet<PublicKeySign>::ResolvedPrimary primary)
+      : monitoring_(internal::MonitoringRecorder::ForPrimitiveSet(
+            *public_key_sign_set, "public_key_sign")),
+        public_key_sign_set_(std::move(public_key_sign_set)),
+        primary_(primary) {}
 
   crypto::tink::util::StatusOr<std::string> Sign(
       absl::string_view data) const override;
 
+  crypto::tink::util::Status SignBatch(
+      absl::Span<const absl::string_view> data, std::string* arena,
+      std::vector<absl::string_view>* signatures) const override;
+
+  MemoryStats GetMemoryStats() const override {
+    return public_key_sign_set_->GetMemoryStats("public_key_sign",
+                                                sizeof(*this));
+  }
+
   ~PublicKeySignSetWrapper() override {}
 
  private:
+  // LEGACY keys sign the data followed by one byte.
+  absl::string_view DataSuffix() const {
+    static const char legacy_suffix = CryptoFormat::kLegacyStartByte;
+    if (primary_.output_prefix_type != OutputPrefixType::LEGACY) return "";
+    return absl::string_view(&legacy_suffix, 1);
+  }
+
+  internal::MonitoringRecorder monitoring_;
   std::unique_ptr<PrimitiveSet<PublicKeySign>> public_key_sign_set_;
+  // Resolved once, since it is used by every signature.
+  const PrimitiveSet<PublicKeySign>::ResolvedPrimary primary_;
 };
 
 util::StatusOr<std::string> PublicKeySignSetWrapper::Sign(
@@ -62,18 +93,36 @@ util::StatusOr<std::string> PublicKeySignSetWrapper::Sign(
   // BoringSSL expects a non-null pointer for data,
   // regardless of whether the size is 0.
   data = subtle::SubtleUtilBoringSSL::EnsureNonNull(data);
+  int64_t start = monitoring_.Start();
+  int64_t num_bytes = data.size();
+
+  auto sign_result = primary_.primitive->SignWithPrefix(
+      primary_.output_prefix, data, DataSuffix());
+  if (!sign_result.ok()) {
+    monitoring_.RecordFailure(start, MonitoringOperation::kSign, num_bytes);
+    return sign_result.status();
+  }
+  monitoring_.RecordSuccess(start, MonitoringOperation::kSign,
+                            primary_.key_id, num_bytes);
+  return sign_result;
+}
 
-  auto primary = public_key_sign_set_->get_primary();
-  std::string local_data;
-  if (primary->get_output_prefix_type() == OutputPrefixType::LEGACY) {
-    local_data = std::string(data);
-    local_data.append(1, CryptoFormat::kLegacyStartByte);
-    data = local_data;
+util::Status PublicKeySignSetWrapper::SignBatch(
+    absl::Span<const absl::string_view> data, std::string* arena,
+    std::vector<absl::string_view>* signatures) const {
+  util::Status status = primary_.primitive->SignBatchWithPrefix(
+      primary_.output_prefix, data, DataSuffix(), arena, signatures);
+  // Batched operations are counted, but not sampled.
+  for (absl::string_view message : data) {
+    if (status.ok()) {
+      monitoring_.RecordSuccess(/*start=*/0, MonitoringOperation::kSign,
+                                primary_.key_id, message.size());
+    } else {
+      monitoring_.RecordFailure(/*start=*/0, MonitoringOperation::kSign,
+                                message.size());
+    }
   }
-  auto sign_result = primary->get_primitive().Sign(data);
-  if (!sign_result.ok()) return sign_result.status();
-  const std::string& key_id = primary->get_identifier();
-  return key_id + sign_result.ValueOrDie();
+  return status;
 }
 
 }  // anonymous namespace
@@ -82,8 +131,10 @@ util::StatusOr<std::unique_ptr<PublicKeySign>> PublicKeySignWrapper::Wrap(
     std::unique_ptr<PrimitiveSet<PublicKeySign>> primitive_set) const {
   util::Status status = Validate(primitive_set.get());
   if (!status.ok()) return status;
-  std::unique_ptr<PublicKeySign> public_key_sign(
-      new PublicKeySignSetWrapper(std::move(primitive_set)));
+  auto primary_result = primitive_set->ResolvePrimary();
+  if (!primary_result.ok()) return primary_result.status();
+  std::unique_ptr<PublicKeySign> public_key_sign(new PublicKeySignSetWrapper(
+      std::move(primitive_set), primary_result.ValueOrDie()));
   return std::move(public_key_sign);
 }
 
@@ -15,7 +15,12 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include "tink/signature/public_key_sign_wrapper.h"
+
+#include <string>
+#include <vector>
+
 #include "gtest/gtest.h"
+#include "absl/strings/string_view.h"
 #include "tink/crypto_format.h"
 #include "tink/primitive_set.h"
 #include "tink/public_key_sign.h"
@@ -169,6 +174,36 @@ TEST_F(PublicKeySignSetWrapperTest, testLegacySignatures) {
     EXPECT_TRUE(status.ok()) << status;
 }
 
+TEST_F(PublicKeySignSetWrapperTest, testSignBatch) {
+  for (OutputPrefixType output_prefix_type :
+       {OutputPrefixType::TINK, OutputPrefixType::LEGACY,
+        OutputPrefixType::RAW}) {
+    KeysetInfo::KeyInfo key;
+    key.set_output_prefix_type(output_prefix_type);
+    key.set_key_id(1234543);
+    key.set_status(KeyStatusType::ENABLED);
+    std::unique_ptr<PrimitiveSet<PublicKeySign>> pk_sign_set(
+        new PrimitiveSet<PublicKeySign>());
+    std::unique_ptr<PublicKeySign> pk_sign(
+        new DummyPublicKeySign("BatchSignatures"));
+    auto entry_result = pk_sign_set->AddPrimitive(std::move(pk_sign), key);
+    ASSERT_TRUE(entry_result.ok());
+    ASSERT_THAT(pk_sign_set->set_primary(entry_result.ValueOrDie()), IsOk());
+    auto pk_sign_result = PublicKeySignWrapper().Wrap(std::move(pk_sign_set));
+    ASSERT_THAT(pk_sign_result.status(), IsOk());
+    pk_sign = std::move(pk_sign_result.ValueOrDie());
+
+    std::vector<absl::string_view> data = {"first", "", "third message"};
+    std::string arena;
+    std::vector<absl::string_view> signatures;
+    ASSERT_THAT(pk_sign->SignBatch(data, &arena, &signatures), IsOk());
+    ASSERT_EQ(signatures.size(), data.size());
+    for (size_t i = 0; i < data.size(); i++) {
+      EXPECT_EQ(signatures[i], pk_sign->Sign(data[i]).ValueOrDie());
+    }
+  }
+}
+
 }  // namespace
 }  // namespace tink
 }  // namespace crypto
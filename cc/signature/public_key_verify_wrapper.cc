@@ -16,8 +16,21 @@
 
 #include "tink/signature/public_key_verify_wrapper.h"
 
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
 #include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
 #include "tink/crypto_format.h"
+#include "tink/internal/monitoring_util.h"
+#include "tink/memory_stats.h"
+#include "tink/monitoring.h"
 #include "tink/primitive_set.h"
 #include "tink/public_key_verify.h"
 #include "tink/subtle/subtle_util_boringssl.h"
@@ -30,8 +43,17 @@ namespace tink {
 
 using google::crypto::tink::OutputPrefixType;
 
+struct PublicKeyVerifyWrapper::Counters {
+  std::atomic<int64_t> verifications{0};
+  std::atomic<int64_t> key_hint_hits{0};
+  std::atomic<int64_t> trial_verifications{0};
+};
+
 namespace {
 
+using Counters = PublicKeyVerifyWrapper::Counters;
+using VerifyEntry = PrimitiveSet<PublicKeyVerify>::Entry<PublicKeyVerify>;
+
 util::Status Validate(PrimitiveSet<PublicKeyVerify>* public_key_verify_set) {
   if (public_key_verify_set == nullptr) {
     return util::Status(util::error::INTERNAL,
@@ -44,24 +66,151 @@ util::Status Validate(PrimitiveSet<PublicKeyVerify>* public_key_verify_set) {
   return util::Status::OK;
 }
 
-class PublicKeyVerifySetWrapper : public PublicKeyVerify {
+// Verifies the pairs of 'inputs' at 'indices' with the primitive of 'entry',
+// stripping the output prefix from the signatures if 'strip_prefix' is set.
+// Sets the results of the pairs which verify to OK, and returns the indices
+// of the pairs which do not.
+std::vector<size_t> BatchVerifyWithEntry(
+    const VerifyEntry& entry,
+    absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs,
+    const std::vector<size_t>& indices, bool strip_prefix,
+    std::vector<util::Status>* results, Counters* counters,
+    const internal::MonitoringRecorder& monitoring) {
+  counters->trial_verifications.fetch_add(indices.size(),
+                                          std::memory_order_relaxed);
+  bool is_legacy =
+      strip_prefix && entry.get_output_prefix_type() == OutputPrefixType::LEGACY;
+  // Reserved up front, so that views into the strings stay valid.
+  std::vector<std::string> legacy_data;
+  if (is_legacy) legacy_data.reserve(indices.size());
+  std::vector<std::pair<absl::string_view, absl::string_view>> batch;
+  batch.reserve(indices.size());
+  for (size_t index : indices) {
+    absl::string_view signature =
+        subtle::SubtleUtilBoringSSL::EnsureNonNull(inputs[index].first);
+    absl::string_view data =
+        subtle::SubtleUtilBoringSSL::EnsureNonNull(inputs[index].second);
+    if (strip_prefix) {
+      signature = signature.substr(CryptoFormat::kNonRawPrefixSize);
+    }
+    if (is_legacy) {
+      legacy_data.push_back(absl::StrCat(data, std::string("\x00", 1)));
+      data = legacy_data.back();
+    }
+    batch.emplace_back(signature, data);
+  }
+  std::vector<util::Status> batch_results =
+      entry.get_primitive().BatchVerify(batch);
+  std::vector<size_t> failed;
+  for (size_t i = 0; i < indices.size(); i++) {
+    if (batch_results[i].ok()) {
+      (*results)[indices[i]] = util::Status::OK;
+      // Batched operations are counted, but not sampled.
+      monitoring.RecordSuccess(/*start=*/0, MonitoringOperation::kVerify,
+                               entry.get_key_id(),
+                               inputs[indices[i]].second.size());
+    } else {
+      failed.push_back(indices[i]);
+    }
+  }
+  return failed;
+}
+
+// Verifies 'signature' on 'data' with the primitive of 'entry', after
+// checking and stripping the output prefix of the entry.
+util::Status VerifyWithEntry(const VerifyEntry& entry,
+                             absl::string_view signature,
+                             absl::string_view data) {
+  std::string legacy_data;
+  if (entry.get_output_prefix_type() != OutputPrefixType::RAW) {
+    absl::string_view prefix = entry.identifier_view();
+    if (signature.length() <= prefix.size() ||
+        signature.substr(0, prefix.size()) != prefix) {
+      return util::Status(util::error::INVALID_ARGUMENT, "Invalid signature.");
+    }
+    signature = signature.substr(prefix.size());
+    if (entry.get_output_prefix_type() == OutputPrefixType::LEGACY) {
+      legacy_data = absl::StrCat(data, std::string("\x00", 1));
+      data = legacy_data;
+    }
+  }
+  return entry.get_primitive().Verify(signature, data);
+}
+
+class PublicKeyVerifySetWrapper : public PublicKeyVerify,
+                                  public MemoryStatsSource {
  public:
-  explicit PublicKeyVerifySetWrapper(
-      std::unique_ptr<PrimitiveSet<PublicKeyVerify>> public_key_verify_set)
-      : public_key_verify_set_(std::move(public_key_verify_set)) {}
+  PublicKeyVerifySetWrapper(
+      std::unique_ptr<PrimitiveSet<PublicKeyVerify>> public_key_verify_set,
+      std::shared_ptr<Counters> counters)
+      : monitoring_(internal::MonitoringRecorder::ForPrimitiveSet(
+            *public_key_verify_set, "public_key_verify")),
+        public_key_verify_set_(std::move(public_key_verify_set)),
+        counters_(std::move(counters)) {
+    for (const VerifyEntry* entry : public_key_verify_set_->get_all()) {
+      // Keeps the first entry if several share a key ID.
+      entries_by_key_id_.emplace(entry->get_key_id(), entry);
+    }
+  }
 
   crypto::tink::util::Status Verify(absl::string_view signature,
                                     absl::string_view data) const override;
 
+  crypto::tink::util::Status VerifyWithKeyId(
+      absl::string_view signature, absl::string_view data,
+      uint32_t key_id) const override;
+
+  std::vector<crypto::tink::util::Status> BatchVerify(
+      absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs)
+      const override;
+
+  MemoryStats GetMemoryStats() const override {
+    return public_key_verify_set_->GetMemoryStats("public_key_verify",
+                                                  sizeof(*this));
+  }
+
   ~PublicKeyVerifySetWrapper() override {}
 
  private:
+  // Tries the keys matching the prefix of 'signature', then all RAW keys.
+  // 'start' is the result of monitoring_.Start().
+  util::Status VerifyWithAllKeys(int64_t start, absl::string_view signature,
+                                 absl::string_view data) const;
+
+  internal::MonitoringRecorder monitoring_;
   std::unique_ptr<PrimitiveSet<PublicKeyVerify>> public_key_verify_set_;
+  const std::shared_ptr<Counters> counters_;
+  // Entries of public_key_verify_set_, which owns them.
+  absl::flat_hash_map<uint32_t, const VerifyEntry*> entries_by_key_id_;
 };
 
-util::Status PublicKeyVerifySetWrapper::Verify(
-    absl::string_view signature,
-    absl::string_view data) const {
+util::Status PublicKeyVerifySetWrapper::Verify(absl::string_view signature,
+                                               absl::string_view data) const {
+  counters_->verifications.fetch_add(1, std::memory_order_relaxed);
+  return VerifyWithAllKeys(monitoring_.Start(), signature, data);
+}
+
+util::Status PublicKeyVerifySetWrapper::VerifyWithKeyId(
+    absl::string_view signature, absl::string_view data,
+    uint32_t key_id) const {
+  counters_->verifications.fetch_add(1, std::memory_order_relaxed);
+  int64_t start = monitoring_.Start();
+  data = subtle::SubtleUtilBoringSSL::EnsureNonNull(data);
+  signature = subtle::SubtleUtilBoringSSL::EnsureNonNull(signature);
+  auto entry_it = entries_by_key_id_.find(key_id);
+  if (entry_it != entries_by_key_id_.end() &&
+      VerifyWithEntry(*entry_it->second, signature, data).ok()) {
+    counters_->key_hint_hits.fetch_add(1, std::memory_order_relaxed);
+    monitoring_.RecordSuccess(start, MonitoringOperation::kVerify, key_id,
+                              data.size());
+    return util::Status::OK;
+  }
+  // The hint was wrong, or the signature is invalid.
+  return VerifyWithAllKeys(start, signature, data);
+}
+
+util::Status PublicKeyVerifySetWrapper::VerifyWithAllKeys(
+    int64_t start, absl::string_view signature, absl::string_view data) const {
   // BoringSSL expects a non-null pointer for data,
   // regardless of whether the size is 0.
   data = subtle::SubtleUtilBoringSSL::EnsureNonNull(data);
@@ -70,6 +219,7 @@ util::Status PublicKeyVerifySetWrapper::Verify(
   if (signature.length() <= CryptoFormat::kNonRawPrefixSize) {
     // This also rejects raw signatures with size of 4 bytes or fewer.
     // We're not aware of any schemes that output signatures that small.
+    monitoring_.RecordFailure(start, MonitoringOperation::kVerify, data.size());
     return util::Status(util::error::INVALID_ARGUMENT, "Signature too short.");
   }
   absl::string_view key_id =
@@ -86,9 +236,12 @@ util::Status PublicKeyVerifySetWrapper::Verify(
         view_on_data_or_legacy_data = legacy_data;
       }
       auto& public_key_verify = entry->get_primitive();
+      counters_->trial_verifications.fetch_add(1, std::memory_order_relaxed);
       auto verify_result =
           public_key_verify.Verify(raw_signature, view_on_data_or_legacy_data);
       if (verify_result.ok()) {
+        monitoring_.RecordSuccess(start, MonitoringOperation::kVerify,
+                                  entry->get_key_id(), data.size());
         return util::Status::OK;
       } else {
         // LOG that a matching key didn't verify the signature.
@@ -97,29 +250,111 @@ util::Status PublicKeyVerifySetWrapper::Verify(
   }
 
   // No matching key succeeded with verification, try all RAW keys.
+  monitoring_.RecordRawFallback();
   auto raw_primitives_result = public_key_verify_set_->get_raw_primitives();
   if (raw_primitives_result.ok()) {
     for (auto& public_key_verify_entry :
              *(raw_primitives_result.ValueOrDie())) {
       auto& public_key_verify = public_key_verify_entry->get_primitive();
+      counters_->trial_verifications.fetch_add(1, std::memory_order_relaxed);
       auto verify_result = public_key_verify.Verify(signature, data);
       if (verify_result.ok()) {
+        monitoring_.RecordSuccess(start, MonitoringOperation::kVerify,
+                                  public_key_verify_entry->get_key_id(),
+                                  data.size());
         return util::Status::OK;
       }
     }
   }
+  monitoring_.RecordFailure(start, MonitoringOperation::kVerify, data.size());
   return util::Status(util::error::INVALID_ARGUMENT, "Invalid signature.");
 }
 
+std::vector<util::Status> PublicKeyVerifySetWrapper::BatchVerify(
+    absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs)
+    const {
+  std::vector<util::Status> results(
+      inputs.size(),
+      util::Status(util::error::INVALID_ARGUMENT, "Invalid signature."));
+  counters_->verifications.fetch_add(inputs.size(), std::memory_order_relaxed);
+
+  // Pairs are grouped by key id, so that each key's primitive verifies all
+  // of its signatures with a single BatchVerify() call.
+  std::map<absl::string_view, std::vector<size_t>> indices_by_key_id;
+  for (size_t i = 0; i < inputs.size(); i++) {
+    absl::string_view signature =
+        subtle::SubtleUtilBoringSSL::EnsureNonNull(inputs[i].first);
+    if (signature.length() <= CryptoFormat::kNonRawPrefixSize) {
+      results[i] =
+          util::Status(util::error::INVALID_ARGUMENT, "Signature too short.");
+      continue;
+    }
+    indices_by_key_id[signature.substr(0, CryptoFormat::kNonRawPrefixSize)]
+        .push_back(i);
+  }
+
+  std::vector<size_t> unverified;
+  for (auto& key_id_and_indices : indices_by_key_id) {
+    std::vector<size_t> pending = std::move(key_id_and_indices.second);
+    auto primitives_result =
+        public_key_verify_set_->get_primitives(key_id_and_indices.first);
+    if (primitives_result.ok()) {
+      for (auto& entry : *(primitives_result.ValueOrDie())) {
+        if (pending.empty()) break;
+        pending = BatchVerifyWithEntry(*entry, inputs, pending,
+                                       /*strip_prefix=*/true, &results,
+                                       counters_.get(), monitoring_);
+      }
+    }
+    unverified.insert(unverified.end(), pending.begin(), pending.end());
+  }
+
+  // Pairs no matching key verified are tried with all RAW keys.
+  for (size_t i = 0; i < unverified.size(); i++) {
+    monitoring_.RecordRawFallback();
+  }
+  auto raw_primitives_result = public_key_verify_set_->get_raw_primitives();
+  if (raw_primitives_result.ok()) {
+    for (auto& entry : *(raw_primitives_result.ValueOrDie())) {
+      if (unverified.empty()) break;
+      unverified = BatchVerifyWithEntry(*entry, inputs, unverified,
+                                        /*strip_prefix=*/false, &results,
+                                        counters_.get(), monitoring_);
+    }
+  }
+  for (size_t i = 0; i < results.size(); i++) {
+    if (!results[i].ok()) {
+      monitoring_.RecordFailure(/*start=*/0, MonitoringOperation::kVerify,
+                                inputs[i].second.size());
+    }
+  }
+  return results;
+}
+
 }  // anonymous namespace
 
+PublicKeyVerifyWrapper::PublicKeyVerifyWrapper()
+    : counters_(std::make_shared<Counters>()) {}
+
+PublicKeyVerifyStats PublicKeyVerifyWrapper::GetStats() const {
+  PublicKeyVerifyStats stats;
+  stats.verifications =
+      counters_->verifications.load(std::memory_order_relaxed);
+  stats.key_hint_hits =
+      counters_->key_hint_hits.load(std::memory_order_relaxed);
+  stats.trial_verifications =
+      counters_->trial_verifications.load(std::memory_order_relaxed);
+  return stats;
+}
+
 util::StatusOr<std::unique_ptr<PublicKeyVerify>> PublicKeyVerifyWrapper::Wrap(
     std::unique_ptr<PrimitiveSet<PublicKeyVerify>> public_key_verify_set)
     const {
   util::Status status = Validate(public_key_verify_set.get());
   if (!status.ok()) return status;
   std::unique_ptr<PublicKeyVerify> public_key_verify(
-      new PublicKeyVerifySetWrapper(std::move(public_key_verify_set)));
+      new PublicKeyVerifySetWrapper(std::move(public_key_verify_set),
+                                    counters_));
   return std::move(public_key_verify);
 }
 
@@ -17,6 +17,9 @@
 #ifndef TINK_SIGNATURE_PUBLIC_KEY_VERIFY_WRAPPER_H_
 #define TINK_SIGNATURE_PUBLIC_KEY_VERIFY_WRAPPER_H_
 
+#include <cstdint>
+#include <memory>
+
 #include "absl/strings/string_view.h"
 #include "tink/primitive_set.h"
 #include "tink/primitive_wrapper.h"
@@ -28,19 +31,48 @@
 namespace crypto {
 namespace tink {
 
+// Counters of the verifications done by the primitives of a
+// PublicKeyVerifyWrapper.
+struct PublicKeyVerifyStats {
+  // Signatures verified, by Verify(), VerifyWithKeyId() or BatchVerify().
+  int64_t verifications = 0;
+  // Signatures verified by VerifyWithKeyId() with the hinted key.
+  int64_t key_hint_hits = 0;
+  // Verifications by the primitives of single keys while trying all keys
+  // which could match a signature. Keysets with many RAW keys, for which
+  // this is much larger than 'verifications', should pass key hints.
+  int64_t trial_verifications = 0;
+};
+
 // Wraps a set of PublicKeyVerify-instances that correspond to a keyset,
 // and combines them into a single PublicKeyVerify-primitive,
 // that for the actual verification uses the instance that matches the
 // signature prefix.
+//
+// VerifyWithKeyId() looks the hinted key up in an index of the keyset, so
+// that a signature of a RAW key is verified once rather than with every RAW
+// key. If the hinted key does not verify the signature, it falls back on
+// trying all keys, like Verify().
 class PublicKeyVerifyWrapper
     : public PrimitiveWrapper<PublicKeyVerify, PublicKeyVerify> {
  public:
+  PublicKeyVerifyWrapper();
+
   // Returns an PublicKeyVerify-primitive that uses the primary
   // PublicKeyVerify-instance provided in 'public_key_verify_set',
   // which must be non-NULL (and must contain a primary instance).
   crypto::tink::util::StatusOr<std::unique_ptr<PublicKeyVerify>> Wrap(
       std::unique_ptr<PrimitiveSet<PublicKeyVerify>> public_key_verify_set)
       const override;
+
+  // Returns the counters summed over all primitives returned by Wrap().
+  PublicKeyVerifyStats GetStats() const;
+
+  // Shared with the wrapped primitives, which may outlive the wrapper.
+  struct Counters;
+
+ private:
+  std::shared_ptr<Counters> counters_;
 };
 
 }  // namespace tink
@@ -16,7 +16,15 @@
 
 #include "tink/signature/public_key_verify_wrapper.h"
 
+#include <string>
+#include <utility>
+#include <vector>
+
 #include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "tink/crypto_format.h"
 #include "tink/primitive_set.h"
 #include "tink/public_key_verify.h"
 #include "tink/util/status.h"
@@ -124,6 +132,135 @@ TEST_F(PublicKeyVerifySetWrapperTest, testBasic) {
   }
 }
 
+TEST_F(PublicKeyVerifySetWrapperTest, testBatchVerify) {
+  KeysetInfo keyset_info;
+  std::vector<OutputPrefixType> prefix_types = {
+      OutputPrefixType::RAW, OutputPrefixType::LEGACY, OutputPrefixType::TINK};
+  std::vector<uint32_t> key_ids = {1234543, 726329, 7213743};
+  std::unique_ptr<PrimitiveSet<PublicKeyVerify>> pk_verify_set(
+      new PrimitiveSet<PublicKeyVerify>());
+  std::vector<std::string> prefixes;
+  for (int i = 0; i < 3; i++) {
+    KeysetInfo::KeyInfo* key_info = keyset_info.add_key_info();
+    key_info->set_output_prefix_type(prefix_types[i]);
+    key_info->set_key_id(key_ids[i]);
+    key_info->set_status(KeyStatusType::ENABLED);
+    auto entry_result = pk_verify_set->AddPrimitive(
+        absl::make_unique<DummyPublicKeyVerify>(absl::StrCat("signature_", i)),
+        *key_info);
+    ASSERT_THAT(entry_result.status(), IsOk());
+    ASSERT_THAT(pk_verify_set->set_primary(entry_result.ValueOrDie()), IsOk());
+    prefixes.push_back(CryptoFormat::GetOutputPrefix(*key_info).ValueOrDie());
+  }
+  auto pk_verify_result =
+      PublicKeyVerifyWrapper().Wrap(std::move(pk_verify_set));
+  ASSERT_THAT(pk_verify_result.status(), IsOk());
+  std::unique_ptr<PublicKeyVerify> pk_verify =
+      std::move(pk_verify_result.ValueOrDie());
+
+  std::string data = "some data to sign";
+  std::string raw_signature =
+      DummyPublicKeySign("signature_0").Sign(data).ValueOrDie();
+  std::string legacy_signature =
+      prefixes[1] + DummyPublicKeySign("signature_1")
+                        .Sign(absl::StrCat(data, std::string("\x00", 1)))
+                        .ValueOrDie();
+  std::string tink_signature =
+      prefixes[2] + DummyPublicKeySign("signature_2").Sign(data).ValueOrDie();
+  // Signed by the TINK key, but with the prefix of the LEGACY key.
+  std::string wrong_prefix_signature =
+      prefixes[1] + DummyPublicKeySign("signature_2").Sign(data).ValueOrDie();
+
+  std::vector<std::pair<absl::string_view, absl::string_view>> inputs = {
+      {tink_signature, data},
+      {raw_signature, data},
+      {"abc", data},
+      {legacy_signature, data},
+      {tink_signature, "other data"},
+      {wrong_prefix_signature, data},
+      {tink_signature, data},
+  };
+  std::vector<util::Status> results = pk_verify->BatchVerify(inputs);
+  ASSERT_EQ(results.size(), inputs.size());
+  std::vector<bool> expected = {true, true, false, true, false, false, true};
+  for (size_t i = 0; i < inputs.size(); i++) {
+    EXPECT_EQ(results[i].ok(), expected[i]) << i << ": " << results[i];
+    // The results match those of individual Verify() calls.
+    util::Status status = pk_verify->Verify(inputs[i].first, inputs[i].second);
+    EXPECT_EQ(results[i].ok(), status.ok()) << i;
+    EXPECT_EQ(results[i].error_code(), status.error_code()) << i;
+  }
+  EXPECT_TRUE(pk_verify->BatchVerify({}).empty());
+}
+
+TEST_F(PublicKeyVerifySetWrapperTest, testVerifyWithKeyId) {
+  constexpr int kNumRawKeys = 20;
+  KeysetInfo keyset_info;
+  std::unique_ptr<PrimitiveSet<PublicKeyVerify>> pk_verify_set(
+      new PrimitiveSet<PublicKeyVerify>());
+  std::vector<std::string> prefixes;
+  // Many RAW keys, followed by a TINK key with ID kNumRawKeys.
+  for (uint32_t key_id = 0; key_id <= kNumRawKeys; key_id++) {
+    KeysetInfo::KeyInfo* key_info = keyset_info.add_key_info();
+    key_info->set_output_prefix_type(key_id < kNumRawKeys
+                                         ? OutputPrefixType::RAW
+                                         : OutputPrefixType::TINK);
+    key_info->set_key_id(key_id);
+    key_info->set_status(KeyStatusType::ENABLED);
+    auto entry_result = pk_verify_set->AddPrimitive(
+        absl::make_unique<DummyPublicKeyVerify>(
+            absl::StrCat("signature_", key_id)),
+        *key_info);
+    ASSERT_THAT(entry_result.status(), IsOk());
+    ASSERT_THAT(pk_verify_set->set_primary(entry_result.ValueOrDie()), IsOk());
+    prefixes.push_back(CryptoFormat::GetOutputPrefix(*key_info).ValueOrDie());
+  }
+  PublicKeyVerifyWrapper wrapper;
+  auto pk_verify_result = wrapper.Wrap(std::move(pk_verify_set));
+  ASSERT_THAT(pk_verify_result.status(), IsOk());
+  std::unique_ptr<PublicKeyVerify> pk_verify =
+      std::move(pk_verify_result.ValueOrDie());
+
+  std::string data = "some data to sign";
+  std::string raw_signature =
+      DummyPublicKeySign("signature_15").Sign(data).ValueOrDie();
+  std::string tink_signature =
+      prefixes[kNumRawKeys] +
+      DummyPublicKeySign(absl::StrCat("signature_", kNumRawKeys))
+          .Sign(data)
+          .ValueOrDie();
+
+  // The hinted keys verify their signatures, without trying other keys.
+  EXPECT_THAT(pk_verify->VerifyWithKeyId(raw_signature, data, 15), IsOk());
+  EXPECT_THAT(pk_verify->VerifyWithKeyId(tink_signature, data, kNumRawKeys),
+              IsOk());
+  PublicKeyVerifyStats stats = wrapper.GetStats();
+  EXPECT_EQ(stats.verifications, 2);
+  EXPECT_EQ(stats.key_hint_hits, 2);
+  EXPECT_EQ(stats.trial_verifications, 0);
+
+  // Without a hint, the RAW keys are tried in turn.
+  EXPECT_THAT(pk_verify->Verify(raw_signature, data), IsOk());
+  stats = wrapper.GetStats();
+  EXPECT_EQ(stats.verifications, 3);
+  EXPECT_EQ(stats.trial_verifications, 16);
+
+  // Wrong and unknown hints fall back on trying all keys.
+  EXPECT_THAT(pk_verify->VerifyWithKeyId(raw_signature, data, 3), IsOk());
+  EXPECT_THAT(pk_verify->VerifyWithKeyId(raw_signature, data, 1000), IsOk());
+  EXPECT_THAT(pk_verify->VerifyWithKeyId(tink_signature, data, 3), IsOk());
+  stats = wrapper.GetStats();
+  EXPECT_EQ(stats.verifications, 6);
+  EXPECT_EQ(stats.key_hint_hits, 2);
+
+  // Invalid signatures are rejected whatever the hint.
+  EXPECT_FALSE(
+      pk_verify->VerifyWithKeyId(raw_signature, "other data", 15).ok());
+  EXPECT_FALSE(
+      pk_verify->VerifyWithKeyId(tink_signature.substr(0, 3), data, kNumRawKeys)
+          .ok());
+}
+
 }  // namespace
 }  // namespace tink
 }  // namespace crypto
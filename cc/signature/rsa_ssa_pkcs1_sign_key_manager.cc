@@ -22,6 +22,7 @@
 #include "tink/public_key_verify.h"
 #include "tink/signature/rsa_ssa_pkcs1_verify_key_manager.h"
 #include "tink/signature/sig_util.h"
+#include "tink/subtle/crypto_provider.h"
 #include "tink/subtle/rsa_ssa_pkcs1_sign_boringssl.h"
 #include "tink/subtle/subtle_util_boringssl.h"
 #include "tink/util/enums.h"
@@ -104,21 +105,24 @@ RsaSsaPkcs1SignKeyManager::PublicKeySignFactory::Create(
   subtle::SubtleUtilBoringSSL::RsaSsaPkcs1Params params;
   const RsaSsaPkcs1Params& params_proto = private_key.public_key().params();
   params.hash_type = Enums::ProtoToSubtle(params_proto.hash_type());
-  auto signer = subtle::RsaSsaPkcs1SignBoringSsl::New(key, params);
-  if (!signer.ok()) return signer.status();
-  // To check that the key is correct, we sign a test message with private key
-  // and verify with public key.
+  auto software_signer = subtle::RsaSsaPkcs1SignBoringSsl::New(key, params);
+  if (!software_signer.ok()) return software_signer.status();
+  std::unique_ptr<PublicKeySign> signer = subtle::WithProviderRsaSsaPkcs1Sign(
+      key, params, std::move(software_signer.ValueOrDie()));
+  // To check that the key is correct, and that an installed CryptoProvider
+  // signs compatibly, we sign a test message with private key and verify
+  // with public key.
   auto verifier = RsaSsaPkcs1VerifyKeyManager().GetPrimitive<PublicKeyVerify>(
       private_key.public_key());
   if (!verifier.ok()) return verifier.status();
   auto sign_verify_result =
-      SignAndVerify(signer.ValueOrDie().get(), verifier.ValueOrDie().get());
+      SignAndVerify(signer.get(), verifier.ValueOrDie().get());
   if (!sign_verify_result.ok()) {
     return util::Status(util::error::INTERNAL,
                         "security bug: signing with private key followed by "
                         "verifying with public key failed");
   }
-  return signer;
+  return std::move(signer);
 }
 
 Status RsaSsaPkcs1SignKeyManager::ValidateKey(
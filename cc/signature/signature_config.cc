@@ -57,21 +57,18 @@ util::Status SignatureConfig::Register() {
   // Register key managers which utilize FIPS validated BoringCrypto
   // implementations.
   // ECDSA
-  status = Registry::RegisterAsymmetricKeyManagers(
-      absl::make_unique<EcdsaSignKeyManager>(),
-      absl::make_unique<EcdsaVerifyKeyManager>(), true);
+  status = Registry::RegisterAsymmetricKeyManagersLazily<
+      EcdsaSignKeyManager, EcdsaVerifyKeyManager>(true);
   if (!status.ok()) return status;
 
   // RSA SSA PSS
-  status = Registry::RegisterAsymmetricKeyManagers(
-      absl::make_unique<RsaSsaPssSignKeyManager>(),
-      absl::make_unique<RsaSsaPssVerifyKeyManager>(), true);
+  status = Registry::RegisterAsymmetricKeyManagersLazily<
+      RsaSsaPssSignKeyManager, RsaSsaPssVerifyKeyManager>(true);
   if (!status.ok()) return status;
 
   // RSA SSA PKCS1
-  status = Registry::RegisterAsymmetricKeyManagers(
-      absl::make_unique<RsaSsaPkcs1SignKeyManager>(),
-      absl::make_unique<RsaSsaPkcs1VerifyKeyManager>(), true);
+  status = Registry::RegisterAsymmetricKeyManagersLazily<
+      RsaSsaPkcs1SignKeyManager, RsaSsaPkcs1VerifyKeyManager>(true);
   if (!status.ok()) return status;
 
   if (kUseOnlyFips) {
@@ -79,9 +76,8 @@ util::Status SignatureConfig::Register() {
   }
 
   // ED25519
-  status = Registry::RegisterAsymmetricKeyManagers(
-      absl::make_unique<Ed25519SignKeyManager>(),
-      absl::make_unique<Ed25519VerifyKeyManager>(), true);
+  status = Registry::RegisterAsymmetricKeyManagersLazily<
+      Ed25519SignKeyManager, Ed25519VerifyKeyManager>(true);
   if (!status.ok()) return status;
 
   return util::OkStatus();
@@ -16,22 +16,28 @@
 
 #include "tink/signature/signature_pem_keyset_reader.h"
 
+#include <algorithm>
 #include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <memory>
-#include <random>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
 
+#include "absl/container/flat_hash_set.h"
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "tink/keyset_reader.h"
 #include "tink/signature/rsa_ssa_pkcs1_sign_key_manager.h"
 #include "tink/signature/rsa_ssa_pkcs1_verify_key_manager.h"
 #include "tink/signature/rsa_ssa_pss_sign_key_manager.h"
 #include "tink/signature/rsa_ssa_pss_verify_key_manager.h"
 #include "tink/subtle/pem_parser_boringssl.h"
+#include "tink/subtle/random.h"
 #include "tink/subtle/subtle_util_boringssl.h"
 #include "tink/util/enums.h"
-#include "tink/util/keyset_util.h"
 #include "tink/util/secret_data.h"
 #include "tink/util/status.h"
 #include "tink/util/statusor.h"
@@ -73,15 +79,14 @@ util::Status SetRsaSsaPssParameters(const PemKeyParams& pem_parameters,
   return util::OkStatus();
 }
 
-// Creates a new Keyset::Key with ID `key_id`. The key has key data
+// Creates a new Keyset::Key without a key ID. The key has key data
 // `key_data`, key type `key_type`, and key material type
 // `key_material_type`.
-Keyset::Key NewKeysetKey(uint32_t key_id, absl::string_view key_type,
+Keyset::Key NewKeysetKey(absl::string_view key_type,
                          const KeyData::KeyMaterialType& key_material_type,
                          absl::string_view key_data) {
   Keyset::Key key;
   // Populate KeyData for the new key.
-  key.set_key_id(key_id);
   key.set_status(KeyStatusType::ENABLED);
   // PEM keys don't add any prefix to signatures
   key.set_output_prefix_type(OutputPrefixType::RAW);
@@ -167,8 +172,10 @@ RsaSsaPkcs1PrivateKey NewRsaSsaPkcs1PrivateKey(
   return private_key_proto;
 }
 
-// Adds the PEM-encoded private key `pem_key` to `keyset`.
-util::Status AddRsaSsaPrivateKey(const PemKey& pem_key, Keyset* keyset) {
+// Parses the PEM-encoded private key `pem_key` into a key without a key ID,
+// validating it with its key manager if `validate_key` is set.
+util::StatusOr<Keyset::Key> ParseRsaSsaPrivateKey(const PemKey& pem_key,
+                                                  bool validate_key) {
   // Try to parse the PEM RSA private key.
   auto private_key_subtle_or =
       subtle::PemParser::ParseRsaPrivateKey(pem_key.serialized_key);
@@ -194,43 +201,40 @@ util::Status AddRsaSsaPrivateKey(const PemKey& pem_key, Keyset* keyset) {
       RsaSsaPssPrivateKey private_key_proto = private_key_proto_or.ValueOrDie();
 
       // Validate the key.
-      auto key_validation_status = key_manager.ValidateKey(private_key_proto);
-      if (!key_validation_status.ok()) return key_validation_status;
-
-      *keyset->add_key() =
-          NewKeysetKey(GenerateUnusedKeyId(*keyset), key_manager.get_key_type(),
-                       key_manager.key_material_type(),
-                       private_key_proto.SerializeAsString());
-      break;
-    }
+      if (validate_key) {
+        auto key_validation_status = key_manager.ValidateKey(private_key_proto);
+        if (!key_validation_status.ok()) return key_validation_status;
+      }
+
+      return NewKeysetKey(key_manager.get_key_type(),
+                          key_manager.key_material_type(),
+                          private_key_proto.SerializeAsString());    }
     case PemAlgorithm::RSASSA_PKCS1: {
       RsaSsaPkcs1SignKeyManager key_manager;
       RsaSsaPkcs1PrivateKey private_key_proto = NewRsaSsaPkcs1PrivateKey(
           *private_key_subtle, key_manager.get_version(), pem_key.parameters);
 
       // Validate the key.
-      auto key_validation_status = key_manager.ValidateKey(private_key_proto);
-      if (!key_validation_status.ok()) return key_validation_status;
-
-      *keyset->add_key() =
-          NewKeysetKey(GenerateUnusedKeyId(*keyset), key_manager.get_key_type(),
-                       key_manager.key_material_type(),
-                       private_key_proto.SerializeAsString());
+      if (validate_key) {
+        auto key_validation_status = key_manager.ValidateKey(private_key_proto);
+        if (!key_validation_status.ok()) return key_validation_status;
+      }
 
-      break;
+      return NewKeysetKey(key_manager.get_key_type(),
+                          key_manager.key_material_type(),
+                          private_key_proto.SerializeAsString());
     }
     default:
       return util::Status(
           util::error::INVALID_ARGUMENT,
           absl::StrCat("Invalid RSA algorithm ", pem_key.parameters.algorithm));
   }
-
-  return util::OkStatus();
 }
 
-// Parses a given PEM-encoded RSA public key `pem_key`, and adds it to the
-// keyset `keyset`.
-util::Status AddRsaSsaPublicKey(const PemKey& pem_key, Keyset* keyset) {
+// Parses a given PEM-encoded RSA public key `pem_key` into a key without a
+// key ID, validating it with its key manager if `validate_key` is set.
+util::StatusOr<Keyset::Key> ParseRsaSsaPublicKey(const PemKey& pem_key,
+                                                 bool validate_key) {
   // Parse the PEM string into a RSA public key.
   auto public_key_subtle_or =
       subtle::PemParser::ParseRsaPublicKey(pem_key.serialized_key);
@@ -264,15 +268,14 @@ util::Status AddRsaSsaPublicKey(const PemKey& pem_key, Keyset* keyset) {
       public_key_proto.set_version(key_manager.get_version());
 
       // Validate the key.
-      auto key_validation_status = key_manager.ValidateKey(public_key_proto);
-      if (!key_validation_status.ok()) return key_validation_status;
-
-      *keyset->add_key() =
-          NewKeysetKey(GenerateUnusedKeyId(*keyset), key_manager.get_key_type(),
-                       key_manager.key_material_type(),
-                       public_key_proto.SerializeAsString());
+      if (validate_key) {
+        auto key_validation_status = key_manager.ValidateKey(public_key_proto);
+        if (!key_validation_status.ok()) return key_validation_status;
+      }
 
-      break;
+      return NewKeysetKey(key_manager.get_key_type(),
+                          key_manager.key_material_type(),
+                          public_key_proto.SerializeAsString());
     }
     case PemAlgorithm::RSASSA_PKCS1: {
       RsaSsaPkcs1PublicKey public_key_proto;
@@ -288,23 +291,98 @@ util::Status AddRsaSsaPublicKey(const PemKey& pem_key, Keyset* keyset) {
       public_key_proto.set_version(key_manager.get_version());
 
       // Validate the key.
-      auto key_validation_status = key_manager.ValidateKey(public_key_proto);
-      if (!key_validation_status.ok()) return key_validation_status;
-
-      *keyset->add_key() =
-          NewKeysetKey(GenerateUnusedKeyId(*keyset), key_manager.get_key_type(),
-                       key_manager.key_material_type(),
-                       public_key_proto.SerializeAsString());
-      break;
-    }
+      if (validate_key) {
+        auto key_validation_status = key_manager.ValidateKey(public_key_proto);
+        if (!key_validation_status.ok()) return key_validation_status;
+      }
+
+      return NewKeysetKey(key_manager.get_key_type(),
+                          key_manager.key_material_type(),
+                          public_key_proto.SerializeAsString());    }
     default:
       return util::Status(
           util::error::INVALID_ARGUMENT,
           absl::StrCat("Invalid RSA algorithm ", pem_key.parameters.algorithm));
   }
+}
+
+// Parses the keys in `pem_keys` into `keys`, which has the same size, with
+// `parse_key`. Stops at the first key that fails to parse.
+util::Status ParseKeysInto(
+    absl::Span<const PemKey> pem_keys,
+    const std::function<util::StatusOr<Keyset::Key>(const PemKey&)>& parse_key,
+    absl::Span<Keyset::Key> keys) {
+  for (size_t i = 0; i < pem_keys.size(); i++) {
+    auto key_or = parse_key(pem_keys[i]);
+    if (!key_or.ok()) return key_or.status();
+    keys[i].Swap(&key_or.ValueOrDie());
+  }
   return util::OkStatus();
 }
 
+// Parses `pem_keys` with `parse_key` on up to `num_threads` threads, and
+// returns a keyset with the keys in the same order, the first one primary.
+// Fails with the error of the first key in `pem_keys` which fails to parse.
+util::StatusOr<std::unique_ptr<Keyset>> ReadKeyset(
+    const std::vector<PemKey>& pem_keys, int num_threads,
+    const std::function<util::StatusOr<Keyset::Key>(const PemKey&)>&
+        parse_key) {
+  if (pem_keys.empty()) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "Empty array of PEM-encoded keys");
+  }
+  std::vector<Keyset::Key> keys(pem_keys.size());
+  // Every thread parses a contiguous range of the keys, the calling thread
+  // the last one.
+  size_t num_ranges =
+      std::max<size_t>(1, std::min<size_t>(num_threads, pem_keys.size()));
+  std::vector<util::Status> statuses(num_ranges);
+  std::vector<std::thread> threads;
+  threads.reserve(num_ranges - 1);
+  absl::Span<const PemKey> pem_keys_span = absl::MakeConstSpan(pem_keys);
+  absl::Span<Keyset::Key> keys_span = absl::MakeSpan(keys);
+  size_t begin = 0;
+  for (size_t range = 0; range < num_ranges; range++) {
+    size_t end = pem_keys.size() * (range + 1) / num_ranges;
+    absl::Span<const PemKey> range_pem_keys =
+        pem_keys_span.subspan(begin, end - begin);
+    absl::Span<Keyset::Key> range_keys = keys_span.subspan(begin, end - begin);
+    util::Status* status = &statuses[range];
+    if (range + 1 < num_ranges) {
+      threads.emplace_back([range_pem_keys, &parse_key, range_keys, status]() {
+        *status = ParseKeysInto(range_pem_keys, parse_key, range_keys);
+      });
+    } else {
+      *status = ParseKeysInto(range_pem_keys, parse_key, range_keys);
+    }
+    begin = end;
+  }
+  for (std::thread& thread : threads) thread.join();
+  for (const util::Status& status : statuses) {
+    if (!status.ok()) return status;
+  }
+
+  // Assign distinct random key IDs in one pass, rather than searching the
+  // keyset for every new ID.
+  auto keyset = absl::make_unique<Keyset>();
+  keyset->mutable_key()->Reserve(keys.size());
+  absl::flat_hash_set<uint32_t> key_ids;
+  key_ids.reserve(keys.size());
+  for (Keyset::Key& key : keys) {
+    uint32_t key_id;
+    do {
+      key_id = subtle::Random::GetRandomUInt32();
+    } while (!key_ids.insert(key_id).second);
+    key.set_key_id(key_id);
+    keyset->add_key()->Swap(&key);
+  }
+
+  // Set the 1st key as primary.
+  keyset->set_primary_key_id(keyset->key(0).key_id());
+
+  return keyset;
+}
+
 }  // namespace
 
 void SignaturePemKeysetReaderBuilder::Add(const PemKey& pem_serialized_key) {
@@ -317,15 +395,19 @@ SignaturePemKeysetReaderBuilder::Build() {
     return util::Status(util::error::INVALID_ARGUMENT,
                         "Empty array of PEM-encoded keys");
   }
+  if (num_threads_ < 1) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "num_threads must be positive");
+  }
 
   switch (pem_reader_type_) {
     case PUBLIC_KEY_SIGN: {
-      return absl::WrapUnique<KeysetReader>(
-          new PublicKeySignPemKeysetReader(pem_serialized_keys_));
+      return absl::WrapUnique<KeysetReader>(new PublicKeySignPemKeysetReader(
+          pem_serialized_keys_, num_threads_, validate_keys_));
     }
     case PUBLIC_KEY_VERIFY: {
-      return absl::WrapUnique<KeysetReader>(
-          new PublicKeyVerifyPemKeysetReader(pem_serialized_keys_));
+      return absl::WrapUnique<KeysetReader>(new PublicKeyVerifyPemKeysetReader(
+          pem_serialized_keys_, num_threads_, validate_keys_));
     }
   }
   return util::Status(util::error::INVALID_ARGUMENT,
@@ -333,57 +415,33 @@ SignaturePemKeysetReaderBuilder::Build() {
 }
 
 util::StatusOr<std::unique_ptr<Keyset>> PublicKeySignPemKeysetReader::Read() {
-  if (pem_serialized_keys_.empty()) {
-    return util::Status(util::error::INVALID_ARGUMENT,
-                        "Empty array of PEM-encoded keys");
-  }
-
-  auto keyset = absl::make_unique<Keyset>();
-  for (const PemKey& pem_key : pem_serialized_keys_) {
-    // Parse and add the new key to the keyset.
-    switch (pem_key.parameters.key_type) {
-      case PemKeyType::PEM_RSA: {
-        auto add_rsassa_pss_status = AddRsaSsaPrivateKey(pem_key, keyset.get());
-        if (!add_rsassa_pss_status.ok()) return add_rsassa_pss_status;
-        break;
-      }
-      default:
-        return util::Status(util::error::UNIMPLEMENTED,
-                            "EC Keys Parsing unimplemented");
-    }
-  }
-
-  // Set the 1st key as primary.
-  keyset->set_primary_key_id(keyset->key(0).key_id());
-
-  return keyset;
+  bool validate_keys = validate_keys_;
+  return ReadKeyset(
+      pem_serialized_keys_, num_threads_,
+      [validate_keys](const PemKey& pem_key) -> util::StatusOr<Keyset::Key> {
+        switch (pem_key.parameters.key_type) {
+          case PemKeyType::PEM_RSA:
+            return ParseRsaSsaPrivateKey(pem_key, validate_keys);
+          default:
+            return util::Status(util::error::UNIMPLEMENTED,
+                                "EC Keys Parsing unimplemented");
+        }
+      });
 }
 
 util::StatusOr<std::unique_ptr<Keyset>> PublicKeyVerifyPemKeysetReader::Read() {
-  if (pem_serialized_keys_.empty()) {
-    return util::Status(util::error::INVALID_ARGUMENT,
-                        "Empty array of PEM-encoded keys");
-  }
-
-  auto keyset = absl::make_unique<Keyset>();
-  for (const PemKey& pem_key : pem_serialized_keys_) {
-    // Parse and add the new key to the keyset.
-    switch (pem_key.parameters.key_type) {
-      case PemKeyType::PEM_RSA: {
-        auto add_rsassa_pss_status = AddRsaSsaPublicKey(pem_key, keyset.get());
-        if (!add_rsassa_pss_status.ok()) return add_rsassa_pss_status;
-        break;
-      }
-      default:
-        return util::Status(util::error::UNIMPLEMENTED,
-                            "EC Keys Parsing unimplemented");
-    }
-  }
-
-  // Set the 1st key as primary.
-  keyset->set_primary_key_id(keyset->key(0).key_id());
-
-  return keyset;
+  bool validate_keys = validate_keys_;
+  return ReadKeyset(
+      pem_serialized_keys_, num_threads_,
+      [validate_keys](const PemKey& pem_key) -> util::StatusOr<Keyset::Key> {
+        switch (pem_key.parameters.key_type) {
+          case PemKeyType::PEM_RSA:
+            return ParseRsaSsaPublicKey(pem_key, validate_keys);
+          default:
+            return util::Status(util::error::UNIMPLEMENTED,
+                                "EC Keys Parsing unimplemented");
+        }
+      });
 }
 
 util::StatusOr<std::unique_ptr<EncryptedKeyset>>
@@ -57,12 +57,18 @@ class SignaturePemKeysetReader : public KeysetReader {
   ReadEncrypted() override;
 
  protected:
-  explicit SignaturePemKeysetReader(
-      const std::vector<PemKey>& pem_serialized_keys)
-      : pem_serialized_keys_(pem_serialized_keys) {}
+  SignaturePemKeysetReader(const std::vector<PemKey>& pem_serialized_keys,
+                           int num_threads, bool validate_keys)
+      : pem_serialized_keys_(pem_serialized_keys),
+        num_threads_(num_threads),
+        validate_keys_(validate_keys) {}
 
   // PEM-serialized keys to parse.
   std::vector<PemKey> pem_serialized_keys_;
+  // Number of threads used to parse the keys, including the calling one.
+  int num_threads_;
+  // Whether the parsed keys are validated by their key managers.
+  bool validate_keys_;
 };
 
 // Builder class for creating a PEM reader. Example usage:
@@ -100,6 +106,18 @@ class SignaturePemKeysetReaderBuilder {
   // Adds a PEM serialized key `pem_serialized_key` to the builder.
   void Add(const PemKey& pem_serialized_key);
 
+  // Sets the number of threads, including the calling one, on which the
+  // reader parses the keys. Defaults to 1. Parsing large numbers of keys, and
+  // in particular RSA keys, is CPU bound, so bulk imports benefit from
+  // parsing them in parallel.
+  void SetNumThreads(int num_threads) { num_threads_ = num_threads; }
+
+  // Skips the validation of the parsed keys by their key managers. The
+  // registry still validates a key when a primitive is created from it, so
+  // this defers the cost of validation to the first use of each key. The
+  // modulus size and the PEM encoding are still checked when reading.
+  void DeferKeyValidation() { validate_keys_ = false; }
+
   // Creates an instance of keyset reader based on `pem_reader_type_`, to parse
   // the PEM-encoded keys in `pem_serialized_keys_`.
   util::StatusOr<std::unique_ptr<KeysetReader>> Build();
@@ -109,6 +127,8 @@ class SignaturePemKeysetReaderBuilder {
   std::vector<PemKey> pem_serialized_keys_;
   // Reader type that this reader must support.
   PemReaderType pem_reader_type_;
+  int num_threads_ = 1;
+  bool validate_keys_ = true;
 };
 
 // Keyset reader for PEM keys that support the PublicKeySign principal.
@@ -121,9 +141,10 @@ class PublicKeySignPemKeysetReader : public SignaturePemKeysetReader {
   // Friend builder class.
   friend class SignaturePemKeysetReaderBuilder;
 
-  explicit PublicKeySignPemKeysetReader(
-      const std::vector<PemKey> pem_serialized_keys)
-      : SignaturePemKeysetReader(pem_serialized_keys) {}
+  PublicKeySignPemKeysetReader(const std::vector<PemKey> pem_serialized_keys,
+                               int num_threads, bool validate_keys)
+      : SignaturePemKeysetReader(pem_serialized_keys, num_threads,
+                                 validate_keys) {}
 };
 
 // Keyset reader for PEM keys that support the PublicKeyVerify principal.
@@ -136,9 +157,10 @@ class PublicKeyVerifyPemKeysetReader : public SignaturePemKeysetReader {
   // Friend builder class.
   friend class SignaturePemKeysetReaderBuilder;
 
-  explicit PublicKeyVerifyPemKeysetReader(
-      const std::vector<PemKey> pem_serialized_keys)
-      : SignaturePemKeysetReader(pem_serialized_keys) {}
+  PublicKeyVerifyPemKeysetReader(const std::vector<PemKey> pem_serialized_keys,
+                                 int num_threads, bool validate_keys)
+      : SignaturePemKeysetReader(pem_serialized_keys, num_threads,
+                                 validate_keys) {}
 };
 
 }  // namespace tink
@@ -16,6 +16,8 @@
 #include "tink/signature/signature_pem_keyset_reader.h"
 
 #include <memory>
+#include <set>
+#include <string>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -425,6 +427,124 @@ TEST(SignaturePemKeysetTeaderTest, ReadRsaPublicKeyInvalidHashType) {
   EXPECT_THAT(keyset_reader->Read().status(), StatusIs(Code::INVALID_ARGUMENT));
 }
 
+// Verify parsing many keys on several threads keeps their order.
+TEST(SignaturePemKeysetReaderTest, ReadPublicKeysInParallel) {
+  constexpr int kNumKeys = 50;
+  auto builder = SignaturePemKeysetReaderBuilder(
+      SignaturePemKeysetReaderBuilder::PemReaderType::PUBLIC_KEY_VERIFY);
+  builder.SetNumThreads(4);
+  for (int i = 0; i < kNumKeys; i++) {
+    builder.Add(
+        {.serialized_key = std::string(kRsaPublicKey2048),
+         .parameters = {.key_type = PemKeyType::PEM_RSA,
+                        .algorithm = PemAlgorithm::RSASSA_PSS,
+                        .key_size_in_bits = 2048,
+                        .hash_type = i % 2 ? HashType::SHA256
+                                           : HashType::SHA384}});
+  }
+
+  auto keyset_reader_or = builder.Build();
+  ASSERT_THAT(keyset_reader_or.status(), IsOk());
+  auto keyset_or = keyset_reader_or.ValueOrDie()->Read();
+  ASSERT_THAT(keyset_or.status(), IsOk());
+  std::unique_ptr<Keyset> keyset = std::move(keyset_or).ValueOrDie();
+
+  RsaSsaPssVerifyKeyManager verify_key_manager;
+  ASSERT_THAT(keyset->key(), SizeIs(kNumKeys));
+  EXPECT_EQ(keyset->primary_key_id(), keyset->key(0).key_id());
+  std::set<uint32_t> key_ids;
+  for (int i = 0; i < kNumKeys; i++) {
+    SCOPED_TRACE(i);
+    key_ids.insert(keyset->key(i).key_id());
+    EXPECT_THAT(
+        keyset->key(i).key_data().value(),
+        Eq(GetRsaSsaPssPublicKeyProto(
+               kRsaPublicKey2048, i % 2 ? HashType::SHA256 : HashType::SHA384,
+               verify_key_manager.get_version())
+               .SerializeAsString()));
+  }
+  EXPECT_THAT(key_ids, SizeIs(kNumKeys));
+}
+
+// Expects the error of the first invalid key in the order they were added.
+TEST(SignaturePemKeysetReaderTest, ReadInParallelReturnsFirstError) {
+  auto builder = SignaturePemKeysetReaderBuilder(
+      SignaturePemKeysetReaderBuilder::PemReaderType::PUBLIC_KEY_VERIFY);
+  builder.SetNumThreads(3);
+  for (int i = 0; i < 9; i++) {
+    builder.Add({.serialized_key = std::string(kRsaPublicKey2048),
+                 .parameters = {.key_type = i == 4 ? PemKeyType::PEM_EC
+                                                   : PemKeyType::PEM_RSA,
+                                .algorithm = PemAlgorithm::RSASSA_PSS,
+                                .key_size_in_bits =
+                                    i == 7 ? size_t{3072} : size_t{2048},
+                                .hash_type = HashType::SHA256}});
+  }
+
+  auto keyset_reader_or = builder.Build();
+  ASSERT_THAT(keyset_reader_or.status(), IsOk());
+  EXPECT_THAT(keyset_reader_or.ValueOrDie()->Read().status(),
+              StatusIs(Code::UNIMPLEMENTED));
+}
+
+TEST(SignaturePemKeysetReaderTest, BuildWithInvalidNumThreads) {
+  auto builder = SignaturePemKeysetReaderBuilder(
+      SignaturePemKeysetReaderBuilder::PemReaderType::PUBLIC_KEY_VERIFY);
+  builder.Add({.serialized_key = std::string(kRsaPublicKey2048),
+               .parameters = {.key_type = PemKeyType::PEM_RSA,
+                              .algorithm = PemAlgorithm::RSASSA_PSS,
+                              .key_size_in_bits = 2048,
+                              .hash_type = HashType::SHA256}});
+  builder.SetNumThreads(0);
+  EXPECT_THAT(builder.Build().status(), StatusIs(Code::INVALID_ARGUMENT));
+}
+
+// With deferred validation, a key rejected by its key manager is still read,
+// and fails validation when used.
+TEST(SignaturePemKeysetReaderTest, DeferKeyValidation) {
+  auto builder = SignaturePemKeysetReaderBuilder(
+      SignaturePemKeysetReaderBuilder::PemReaderType::PUBLIC_KEY_VERIFY);
+  builder.DeferKeyValidation();
+
+  // The key is too small to be accepted by the key manager.
+  builder.Add({.serialized_key = std::string(kRsaPublicKey1024),
+               .parameters = {.key_type = PemKeyType::PEM_RSA,
+                              .algorithm = PemAlgorithm::RSASSA_PSS,
+                              .key_size_in_bits = 1024,
+                              .hash_type = HashType::SHA256}});
+
+  auto keyset_reader_or = builder.Build();
+  ASSERT_THAT(keyset_reader_or.status(), IsOk());
+  auto keyset_or = keyset_reader_or.ValueOrDie()->Read();
+  ASSERT_THAT(keyset_or.status(), IsOk());
+  const Keyset& keyset = *keyset_or.ValueOrDie();
+  ASSERT_THAT(keyset.key(), SizeIs(1));
+
+  RsaSsaPssPublicKey public_key_proto;
+  ASSERT_TRUE(
+      public_key_proto.ParseFromString(keyset.key(0).key_data().value()));
+  EXPECT_THAT(RsaSsaPssVerifyKeyManager().ValidateKey(public_key_proto),
+              StatusIs(Code::INVALID_ARGUMENT));
+}
+
+// The modulus size is checked even when validation is deferred.
+TEST(SignaturePemKeysetReaderTest, DeferKeyValidationChecksModulusSize) {
+  auto builder = SignaturePemKeysetReaderBuilder(
+      SignaturePemKeysetReaderBuilder::PemReaderType::PUBLIC_KEY_VERIFY);
+  builder.DeferKeyValidation();
+
+  builder.Add({.serialized_key = std::string(kRsaPublicKey2048),
+               .parameters = {.key_type = PemKeyType::PEM_RSA,
+                              .algorithm = PemAlgorithm::RSASSA_PSS,
+                              .key_size_in_bits = 3072,
+                              .hash_type = HashType::SHA256}});
+
+  auto keyset_reader_or = builder.Build();
+  ASSERT_THAT(keyset_reader_or.status(), IsOk());
+  EXPECT_THAT(keyset_reader_or.ValueOrDie()->Read().status(),
+              StatusIs(Code::INVALID_ARGUMENT));
+}
+
 }  // namespace
 }  // namespace tink
 }  // namespace crypto
@@ -17,12 +17,15 @@
 #ifndef TINK_STREAMING_AEAD_H_
 #define TINK_STREAMING_AEAD_H_
 
+#include <functional>
 #include <memory>
+#include <string>
 
 #include "absl/strings/string_view.h"
 #include "tink/input_stream.h"
 #include "tink/output_stream.h"
 #include "tink/random_access_stream.h"
+#include "tink/util/status.h"
 #include "tink/util/statusor.h"
 
 namespace crypto {
@@ -69,7 +72,8 @@ class StreamingAead {
   // Note that the returned wrapper's size()-method reports size that is
   // not checked for integrity.  For example, if the ciphertext file has been
   // truncated then size() will return a wrong result.  Reading the last block
-  // of the plaintext will verify whether size() is correct.
+  // of the plaintext will verify whether size() is correct, as does
+  // VerifiedSize(), which reads only the last block.
   // Reading through the wrapper is thread safe.
   virtual crypto::tink::util::StatusOr<
       std::unique_ptr<crypto::tink::RandomAccessStream>>
@@ -77,6 +81,57 @@ class StreamingAead {
       std::unique_ptr<crypto::tink::RandomAccessStream> ciphertext_source,
       absl::string_view associated_data) = 0;
 
+  // Encrypts 'plaintext' in one shot, and returns the ciphertext, which is
+  // the same as a stream from NewEncryptingStream() would produce, and hence
+  // can be decrypted by any of the decrypting streams. This avoids the
+  // buffers and the stream setup for plaintexts that fit a single segment.
+  // Returns INVALID_ARGUMENT if 'plaintext' is longer, then the encrypting
+  // stream must be used. Implementations which do not support this return
+  // UNIMPLEMENTED.
+  virtual crypto::tink::util::StatusOr<std::string> EncryptSmall(
+      absl::string_view plaintext, absl::string_view associated_data) {
+    return crypto::tink::util::Status(crypto::tink::util::error::UNIMPLEMENTED,
+                                      "EncryptSmall() is not supported");
+  }
+
+  // Decrypts 'ciphertext' of a stream that consists of a single segment, as
+  // produced by EncryptSmall() or by an encrypting stream of a short
+  // plaintext, and returns the plaintext. Returns INVALID_ARGUMENT if the
+  // ciphertext is longer than a single segment, and an error if it is
+  // invalid. Implementations which do not support this return UNIMPLEMENTED.
+  virtual crypto::tink::util::StatusOr<std::string> DecryptSmall(
+      absl::string_view ciphertext, absl::string_view associated_data) {
+    return crypto::tink::util::Status(crypto::tink::util::error::UNIMPLEMENTED,
+                                      "DecryptSmall() is not supported");
+  }
+
+  // Options for ReEncrypt().
+  struct ReEncryptOptions {
+    // If set, the ciphertext is decrypted on tasks run by 'schedule', e.g.
+    // on a thread pool owned by the caller, while the calling thread
+    // encrypts the plaintext decrypted so far, so that the decryption and
+    // the encryption of consecutive segments overlap.
+    std::function<void(std::function<void()>)> schedule;
+    // The maximal number of decrypted chunks waiting to be encrypted.
+    // Must be positive if 'schedule' is set.
+    int max_chunks_in_flight = 4;
+  };
+
+  // Reads a ciphertext from 'ciphertext_source', and writes a ciphertext of
+  // its plaintext to 'ciphertext_destination', which is closed at the end,
+  // as if it was written to NewEncryptingStream(). Useful to rotate stored
+  // ciphertexts to the current key of a keyset. Implementations may copy
+  // the ciphertext unchanged if it already is such a ciphertext, after
+  // authenticating only a part of it. Implementations which do not support
+  // this return UNIMPLEMENTED.
+  virtual crypto::tink::util::Status ReEncrypt(
+      std::unique_ptr<crypto::tink::InputStream> ciphertext_source,
+      std::unique_ptr<crypto::tink::OutputStream> ciphertext_destination,
+      absl::string_view associated_data, ReEncryptOptions options) {
+    return crypto::tink::util::Status(crypto::tink::util::error::UNIMPLEMENTED,
+                                      "ReEncrypt() is not supported");
+  }
+
   virtual ~StreamingAead() {}
 };
 
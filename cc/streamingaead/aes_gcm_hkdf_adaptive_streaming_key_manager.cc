@@ -0,0 +1,129 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/streamingaead/aes_gcm_hkdf_adaptive_streaming_key_manager.h"
+
+#include <cstdint>
+
+#include "tink/subtle/aes_gcm_hkdf_adaptive_streaming.h"
+#include "tink/subtle/aes_gcm_hkdf_stream_segment_encrypter.h"
+#include "tink/subtle/random.h"
+#include "tink/util/input_stream_util.h"
+#include "tink/util/validation.h"
+
+namespace crypto {
+namespace tink {
+
+using ::crypto::tink::subtle::AesGcmHkdfAdaptiveStreaming;
+using ::crypto::tink::subtle::AesGcmHkdfStreamSegmentEncrypter;
+using ::crypto::tink::util::Status;
+using ::crypto::tink::util::StatusOr;
+using ::google::crypto::tink::AesGcmHkdfAdaptiveStreamingKey;
+using ::google::crypto::tink::AesGcmHkdfAdaptiveStreamingKeyFormat;
+using ::google::crypto::tink::AesGcmHkdfAdaptiveStreamingParams;
+using ::google::crypto::tink::HashType;
+
+namespace {
+
+Status ValidateParams(const AesGcmHkdfAdaptiveStreamingParams& params) {
+  if (!(params.hkdf_hash_type() == HashType::SHA1 ||
+        params.hkdf_hash_type() == HashType::SHA256 ||
+        params.hkdf_hash_type() == HashType::SHA512)) {
+    return Status(util::error::INVALID_ARGUMENT, "unsupported hkdf_hash_type");
+  }
+  if (params.ciphertext_segment_sizes().empty()) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "ciphertext_segment_sizes must not be empty");
+  }
+  // The first segment holds the segment size, the header and a tag.
+  const uint32_t min_segment_size =
+      AesGcmHkdfAdaptiveStreaming::kSegmentSizeFieldSize + 1 +
+      params.derived_key_size() +
+      AesGcmHkdfStreamSegmentEncrypter::kNoncePrefixSizeInBytes +
+      AesGcmHkdfStreamSegmentEncrypter::kTagSizeInBytes;
+  if (params.ciphertext_segment_sizes(0) <= min_segment_size) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "ciphertext_segment_size too small");
+  }
+  for (int i = 1; i < params.ciphertext_segment_sizes_size(); i++) {
+    if (params.ciphertext_segment_sizes(i) <=
+        params.ciphertext_segment_sizes(i - 1)) {
+      return Status(
+          util::error::INVALID_ARGUMENT,
+          "ciphertext_segment_sizes must be in strictly increasing order");
+    }
+  }
+  if (params.ciphertext_segment_sizes(params.ciphertext_segment_sizes_size() -
+                                      1) > INT32_MAX) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "ciphertext_segment_size too large");
+  }
+  return ValidateAesKeySize(params.derived_key_size());
+}
+
+}  // namespace
+
+StatusOr<AesGcmHkdfAdaptiveStreamingKey>
+AesGcmHkdfAdaptiveStreamingKeyManager::CreateKey(
+    const AesGcmHkdfAdaptiveStreamingKeyFormat& key_format) const {
+  AesGcmHkdfAdaptiveStreamingKey key;
+  key.set_version(get_version());
+  key.set_key_value(subtle::Random::GetRandomBytes(key_format.key_size()));
+  *key.mutable_params() = key_format.params();
+  return key;
+}
+
+StatusOr<AesGcmHkdfAdaptiveStreamingKey>
+AesGcmHkdfAdaptiveStreamingKeyManager::DeriveKey(
+    const AesGcmHkdfAdaptiveStreamingKeyFormat& key_format,
+    InputStream* input_stream) const {
+  Status status = ValidateVersion(key_format.version(), get_version());
+  if (!status.ok()) return status;
+
+  StatusOr<std::string> randomness_or =
+      ReadBytesFromStream(key_format.key_size(), input_stream);
+  if (!randomness_or.ok()) {
+    return randomness_or.status();
+  }
+  AesGcmHkdfAdaptiveStreamingKey key;
+  key.set_version(get_version());
+  key.set_key_value(randomness_or.ValueOrDie());
+  *key.mutable_params() = key_format.params();
+  return key;
+}
+
+Status AesGcmHkdfAdaptiveStreamingKeyManager::ValidateKey(
+    const AesGcmHkdfAdaptiveStreamingKey& key) const {
+  Status status = ValidateVersion(key.version(), get_version());
+  if (!status.ok()) return status;
+  if (key.key_value().size() < key.params().derived_key_size()) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "key_value (i.e. ikm) too short");
+  }
+  return ValidateParams(key.params());
+}
+
+Status AesGcmHkdfAdaptiveStreamingKeyManager::ValidateKeyFormat(
+    const AesGcmHkdfAdaptiveStreamingKeyFormat& key_format) const {
+  if (key_format.key_size() < key_format.params().derived_key_size()) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "key_size must not be smaller than derived_key_size");
+  }
+  return ValidateParams(key_format.params());
+}
+
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,197 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/streamingaead/aes_gcm_hkdf_adaptive_streaming_key_manager.h"
+
+#include <sstream>
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "tink/streaming_aead.h"
+#include "tink/subtle/aes_gcm_hkdf_adaptive_streaming.h"
+#include "tink/subtle/common_enums.h"
+#include "tink/subtle/random.h"
+#include "tink/subtle/streaming_aead_test_util.h"
+#include "tink/util/istream_input_stream.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "tink/util/test_matchers.h"
+#include "proto/aes_gcm_hkdf_streaming.pb.h"
+#include "proto/common.pb.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::crypto::tink::util::IstreamInputStream;
+using ::crypto::tink::util::StatusOr;
+using ::google::crypto::tink::AesGcmHkdfAdaptiveStreamingKey;
+using ::google::crypto::tink::AesGcmHkdfAdaptiveStreamingKeyFormat;
+using ::google::crypto::tink::HashType;
+using ::testing::Eq;
+using ::testing::HasSubstr;
+using ::testing::Not;
+
+namespace {
+
+AesGcmHkdfAdaptiveStreamingKeyFormat ValidKeyFormat() {
+  AesGcmHkdfAdaptiveStreamingKeyFormat key_format;
+  key_format.set_key_size(32);
+  key_format.mutable_params()->set_derived_key_size(32);
+  key_format.mutable_params()->set_hkdf_hash_type(HashType::SHA256);
+  key_format.mutable_params()->add_ciphertext_segment_sizes(1024);
+  key_format.mutable_params()->add_ciphertext_segment_sizes(65536);
+  return key_format;
+}
+
+TEST(AesGcmHkdfAdaptiveStreamingKeyManagerTest, Basics) {
+  EXPECT_THAT(AesGcmHkdfAdaptiveStreamingKeyManager().get_version(), Eq(0));
+  EXPECT_THAT(AesGcmHkdfAdaptiveStreamingKeyManager().key_material_type(),
+              Eq(google::crypto::tink::KeyData::SYMMETRIC));
+  EXPECT_THAT(AesGcmHkdfAdaptiveStreamingKeyManager().get_key_type(),
+              Eq("type.googleapis.com/"
+                 "google.crypto.tink.AesGcmHkdfAdaptiveStreamingKey"));
+}
+
+TEST(AesGcmHkdfAdaptiveStreamingKeyManagerTest, ValidateKeyFormat) {
+  EXPECT_THAT(
+      AesGcmHkdfAdaptiveStreamingKeyManager().ValidateKeyFormat(
+          ValidKeyFormat()),
+      IsOk());
+  EXPECT_THAT(AesGcmHkdfAdaptiveStreamingKeyManager().ValidateKeyFormat(
+                  AesGcmHkdfAdaptiveStreamingKeyFormat()),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(AesGcmHkdfAdaptiveStreamingKeyManagerTest, ValidateKeyFormatSmallKey) {
+  AesGcmHkdfAdaptiveStreamingKeyFormat key_format = ValidKeyFormat();
+  key_format.set_key_size(16);
+  EXPECT_THAT(
+      AesGcmHkdfAdaptiveStreamingKeyManager().ValidateKeyFormat(key_format),
+      StatusIs(util::error::INVALID_ARGUMENT, HasSubstr("derived_key_size")));
+}
+
+TEST(AesGcmHkdfAdaptiveStreamingKeyManagerTest, ValidateKeyFormatWrongHash) {
+  AesGcmHkdfAdaptiveStreamingKeyFormat key_format = ValidKeyFormat();
+  key_format.mutable_params()->set_hkdf_hash_type(HashType::UNKNOWN_HASH);
+  EXPECT_THAT(
+      AesGcmHkdfAdaptiveStreamingKeyManager().ValidateKeyFormat(key_format),
+      StatusIs(util::error::INVALID_ARGUMENT, HasSubstr("hkdf_hash_type")));
+}
+
+TEST(AesGcmHkdfAdaptiveStreamingKeyManagerTest,
+     ValidateKeyFormatSegmentSizes) {
+  AesGcmHkdfAdaptiveStreamingKeyFormat key_format = ValidKeyFormat();
+  key_format.mutable_params()->clear_ciphertext_segment_sizes();
+  EXPECT_THAT(
+      AesGcmHkdfAdaptiveStreamingKeyManager().ValidateKeyFormat(key_format),
+      StatusIs(util::error::INVALID_ARGUMENT));
+
+  // The first segment must hold 4 + 40 bytes of header and a tag.
+  key_format.mutable_params()->add_ciphertext_segment_sizes(60);
+  EXPECT_THAT(
+      AesGcmHkdfAdaptiveStreamingKeyManager().ValidateKeyFormat(key_format),
+      StatusIs(util::error::INVALID_ARGUMENT,
+               HasSubstr("ciphertext_segment_size")));
+
+  key_format.mutable_params()->set_ciphertext_segment_sizes(0, 4096);
+  key_format.mutable_params()->add_ciphertext_segment_sizes(1024);
+  EXPECT_THAT(
+      AesGcmHkdfAdaptiveStreamingKeyManager().ValidateKeyFormat(key_format),
+      StatusIs(util::error::INVALID_ARGUMENT, HasSubstr("increasing")));
+}
+
+TEST(AesGcmHkdfAdaptiveStreamingKeyManagerTest, ValidateKeyWrongVersion) {
+  auto key_or =
+      AesGcmHkdfAdaptiveStreamingKeyManager().CreateKey(ValidKeyFormat());
+  ASSERT_THAT(key_or.status(), IsOk());
+  AesGcmHkdfAdaptiveStreamingKey key = key_or.ValueOrDie();
+  EXPECT_THAT(AesGcmHkdfAdaptiveStreamingKeyManager().ValidateKey(key),
+              IsOk());
+  key.set_version(1);
+  EXPECT_THAT(AesGcmHkdfAdaptiveStreamingKeyManager().ValidateKey(key),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(AesGcmHkdfAdaptiveStreamingKeyManagerTest, CreateKey) {
+  AesGcmHkdfAdaptiveStreamingKeyFormat key_format = ValidKeyFormat();
+  auto key_or = AesGcmHkdfAdaptiveStreamingKeyManager().CreateKey(key_format);
+  ASSERT_THAT(key_or.status(), IsOk());
+  EXPECT_THAT(key_or.ValueOrDie().version(), Eq(0));
+  EXPECT_THAT(key_or.ValueOrDie().params().SerializeAsString(),
+              Eq(key_format.params().SerializeAsString()));
+  EXPECT_THAT(key_or.ValueOrDie().key_value().size(),
+              Eq(key_format.key_size()));
+}
+
+TEST(AesGcmHkdfAdaptiveStreamingKeyManagerTest, DeriveKey) {
+  AesGcmHkdfAdaptiveStreamingKeyFormat key_format = ValidKeyFormat();
+  IstreamInputStream input_stream{
+      absl::make_unique<std::stringstream>("01234567890123456789012345678901")};
+  StatusOr<AesGcmHkdfAdaptiveStreamingKey> key_or =
+      AesGcmHkdfAdaptiveStreamingKeyManager().DeriveKey(key_format,
+                                                        &input_stream);
+  ASSERT_THAT(key_or.status(), IsOk());
+  EXPECT_THAT(key_or.ValueOrDie().key_value(),
+              Eq("01234567890123456789012345678901"));
+  EXPECT_THAT(key_or.ValueOrDie().params().SerializeAsString(),
+              Eq(key_format.params().SerializeAsString()));
+
+  IstreamInputStream short_input_stream{
+      absl::make_unique<std::stringstream>("0123456789012345678901234567890")};
+  EXPECT_THAT(AesGcmHkdfAdaptiveStreamingKeyManager()
+                  .DeriveKey(key_format, &short_input_stream)
+                  .status(),
+              Not(IsOk()));
+}
+
+TEST(AesGcmHkdfAdaptiveStreamingKeyManagerTest, GetPrimitive) {
+  auto key_or =
+      AesGcmHkdfAdaptiveStreamingKeyManager().CreateKey(ValidKeyFormat());
+  ASSERT_THAT(key_or.status(), IsOk());
+  const AesGcmHkdfAdaptiveStreamingKey& key = key_or.ValueOrDie();
+  auto streaming_aead_from_manager_result =
+      AesGcmHkdfAdaptiveStreamingKeyManager().GetPrimitive<StreamingAead>(key);
+  ASSERT_THAT(streaming_aead_from_manager_result.status(), IsOk());
+
+  subtle::AesGcmHkdfAdaptiveStreaming::Params params;
+  params.ikm = util::SecretDataFromStringView(key.key_value());
+  params.hkdf_hash = subtle::HashType::SHA256;
+  params.derived_key_size = 32;
+  params.ciphertext_segment_sizes = {1024, 65536};
+  auto streaming_aead_direct_result =
+      subtle::AesGcmHkdfAdaptiveStreaming::New(std::move(params));
+  ASSERT_THAT(streaming_aead_direct_result.status(), IsOk());
+
+  // Check that the two primitives are the same by encrypting with one, and
+  // decrypting with the other.
+  EXPECT_THAT(
+      EncryptThenDecrypt(streaming_aead_from_manager_result.ValueOrDie().get(),
+                         streaming_aead_direct_result.ValueOrDie().get(),
+                         subtle::Random::GetRandomBytes(10000),
+                         "some associated data", /* ciphertext_offset = */ 0),
+      IsOk());
+}
+
+}  // namespace
+}  // namespace tink
+}  // namespace crypto
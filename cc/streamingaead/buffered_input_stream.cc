@@ -18,9 +18,13 @@
 
 #include <algorithm>
 #include <cstring>
+#include <deque>
+#include <utility>
 #include <vector>
 
+#include "absl/base/thread_annotations.h"
 #include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
 #include "tink/input_stream.h"
 #include "tink/util/errors.h"
 #include "tink/util/status.h"
@@ -33,12 +37,35 @@ namespace streamingaead {
 using util::Status;
 using util::StatusOr;
 
+struct BufferedInputStream::PrefetchState {
+  absl::Mutex mutex;
+  // The chunks read from input_stream_ and not yet returned by Next().
+  std::deque<std::vector<uint8_t>> chunks ABSL_GUARDED_BY(mutex);
+  // Buffers of returned chunks, for reuse by the next reads.
+  std::vector<std::vector<uint8_t>> free_buffers ABSL_GUARDED_BY(mutex);
+  // The status of the last read, e.g. OUT_OF_RANGE at the end of the stream.
+  // No further reads are scheduled once it is not OK.
+  Status status ABSL_GUARDED_BY(mutex);
+  bool fetching ABSL_GUARDED_BY(mutex) = false;  // true iff a task runs
+  bool stopped ABSL_GUARDED_BY(mutex) = false;   // true iff being destroyed
+};
+
+BufferedInputStream::BufferedInputStream(
+    std::unique_ptr<crypto::tink::InputStream> input_stream)
+    : BufferedInputStream(std::move(input_stream), PrefetchOptions()) {}
+
 BufferedInputStream::BufferedInputStream(
-    std::unique_ptr<crypto::tink::InputStream> input_stream) {
+    std::unique_ptr<crypto::tink::InputStream> input_stream,
+    PrefetchOptions prefetch_options)
+    : prefetch_options_(std::move(prefetch_options)) {
   input_stream_ = std::move(input_stream);
+  if (prefetch_options_.depth > 0 && prefetch_options_.schedule) {
+    prefetch_state_ = std::make_shared<PrefetchState>();
+  }
   count_in_buffer_ = 0;
   count_backedup_ = 0;
   position_ = 0;
+  buffer_start_ = 0;
   buffer_.resize(4 * 1024);  // 4 KB
   buffer_offset_ = 0;
   after_rewind_ = false;
@@ -63,14 +90,18 @@ crypto::tink::util::StatusOr<int> BufferedInputStream::Next(const void** data) {
     *data = buffer_.data() + buffer_offset_;
     int backedup = count_backedup_;
     count_backedup_ = 0;
-    position_ = count_in_buffer_;
+    position_ = buffer_start_ + count_in_buffer_;
     return backedup;
   }
 
   // Read new bytes from input_stream_.
   //
   // If we don't allow rewind any more, all the data buffered so far
-  // can be discarded, and from now on we go directly to input_stream_
+  // can be discarded, and from now on we go directly to input_stream_,
+  // or to the prefetched chunks.
+  if (!rewinding_enabled_ && prefetch_state_ != nullptr) {
+    return NextPrefetched(data);
+  }
   if (!rewinding_enabled_) {
     direct_access_ = true;
     buffer_.resize(0);
@@ -99,6 +130,80 @@ crypto::tink::util::StatusOr<int> BufferedInputStream::Next(const void** data) {
   return count_read;
 }
 
+StatusOr<int> BufferedInputStream::NextPrefetched(const void** data) {
+  PrefetchState* state = prefetch_state_.get();
+  bool schedule;
+  {
+    absl::MutexLock lock(&state->mutex);
+    schedule = state->chunks.empty() && !state->fetching && state->status.ok();
+    if (schedule) state->fetching = true;
+  }
+  if (schedule) SchedulePrefetch();
+  {
+    absl::MutexLock lock(&state->mutex);
+    state->mutex.Await(absl::Condition(
+        +[](PrefetchState* state) {
+          return !state->chunks.empty() || !state->fetching;
+        },
+        state));
+    if (state->chunks.empty()) {
+      status_ = state->status;
+      return status_;
+    }
+    // The bytes of buffer_ are no longer accessible to the caller.
+    state->free_buffers.push_back(std::move(buffer_));
+    buffer_ = std::move(state->chunks.front());
+    state->chunks.pop_front();
+    schedule = !state->fetching && state->status.ok();
+    if (schedule) state->fetching = true;
+  }
+  if (schedule) SchedulePrefetch();
+  after_rewind_ = false;
+  buffer_start_ = position_;
+  buffer_offset_ = 0;
+  count_backedup_ = 0;
+  count_in_buffer_ = buffer_.size();
+  position_ = position_ + count_in_buffer_;
+  *data = buffer_.data();
+  return count_in_buffer_;
+}
+
+void BufferedInputStream::SchedulePrefetch() {
+  // The task reads chunks until 'depth' chunks are waiting to be returned,
+  // the stream fails or ends, or prefetching is stopped. The destructor
+  // waits for it, so input_stream_ outlives it.
+  InputStream* input_stream = input_stream_.get();
+  int depth = prefetch_options_.depth;
+  std::shared_ptr<PrefetchState> state = prefetch_state_;
+  prefetch_options_.schedule([input_stream, depth, state]() {
+    while (true) {
+      std::vector<uint8_t> buffer;
+      {
+        absl::MutexLock lock(&state->mutex);
+        if (state->stopped || state->chunks.size() >= static_cast<size_t>(depth)) {
+          state->fetching = false;
+          return;
+        }
+        if (!state->free_buffers.empty()) {
+          buffer = std::move(state->free_buffers.back());
+          state->free_buffers.pop_back();
+        }
+      }
+      const void* data;
+      auto next_result = input_stream->Next(&data);
+      absl::MutexLock lock(&state->mutex);
+      if (!next_result.ok()) {
+        state->status = next_result.status();
+        state->fetching = false;
+        return;
+      }
+      const uint8_t* bytes = static_cast<const uint8_t*>(data);
+      buffer.assign(bytes, bytes + next_result.ValueOrDie());
+      state->chunks.push_back(std::move(buffer));
+    }
+  });
+}
+
 void BufferedInputStream::BackUp(int count) {
   if (direct_access_) {
     input_stream_->BackUp(count);
@@ -134,6 +239,11 @@ crypto::tink::util::Status BufferedInputStream::Rewind() {
 
 
 BufferedInputStream::~BufferedInputStream() {
+  if (prefetch_state_ == nullptr) return;
+  absl::MutexLock lock(&prefetch_state_->mutex);
+  prefetch_state_->stopped = true;
+  prefetch_state_->mutex.Await(absl::Condition(
+      +[](bool* fetching) { return !*fetching; }, &prefetch_state_->fetching));
 }
 
 int64_t BufferedInputStream::Position() const {
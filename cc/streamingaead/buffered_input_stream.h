@@ -17,6 +17,7 @@
 #ifndef TINK_STREAMINGAEAD_BUFFERED_INPUT_STREAM_H_
 #define TINK_STREAMINGAEAD_BUFFERED_INPUT_STREAM_H_
 
+#include <functional>
 #include <memory>
 #include <vector>
 
@@ -31,14 +32,37 @@ namespace streamingaead {
 // An InputStream that initially buffers all the read bytes, and offers
 // rewind-functionality, until explicitly instructed to disable
 // rewinding (and stop buffering).
+//
+// Once rewinding is disabled, the stream can optionally prefetch: the next
+// chunks of the wrapped stream are then read on a background task while
+// the caller processes the current one, e.g. while a decrypter authenticates
+// a segment.
 class BufferedInputStream : public crypto::tink::InputStream {
  public:
+  struct PrefetchOptions {
+    // The number of chunks of the wrapped stream read ahead of the one
+    // returned by Next(). 0 disables prefetching.
+    int depth = 0;
+    // Runs the reads, e.g. by passing them to a thread pool. Must be set
+    // if depth is positive. The wrapped stream is only accessed by one read
+    // at a time.
+    std::function<void(std::function<void()>)> schedule;
+  };
+
   // Constructs an InputStream that will read from 'input_stream',
   // buffering all the read bytes in memory, and offering rewinding
   // to the beginning of the stream (as long as rewinding is enabled).
   explicit BufferedInputStream(
       std::unique_ptr<crypto::tink::InputStream> input_stream);
 
+  // Like above, but once rewinding is disabled, reads from 'input_stream'
+  // as specified by 'prefetch_options'. Prefetching is disabled if
+  // 'prefetch_options' has no schedule.
+  BufferedInputStream(std::unique_ptr<crypto::tink::InputStream> input_stream,
+                      PrefetchOptions prefetch_options);
+
+  // Waits for a prefetching read in flight, if any.
+
   ~BufferedInputStream() override;
 
   crypto::tink::util::StatusOr<int> Next(const void** data) override;
@@ -54,17 +78,33 @@ class BufferedInputStream : public crypto::tink::InputStream {
   void DisableRewinding();
 
  private:
+  // The chunks read ahead by the prefetching task, shared with it.
+  struct PrefetchState;
+
+  // Returns the next prefetched chunk, which replaces the contents
+  // of buffer_.
+  crypto::tink::util::StatusOr<int> NextPrefetched(const void** data);
+
+  // Schedules a prefetching task, which must not be running yet.
+  void SchedulePrefetch();
+
   std::unique_ptr<crypto::tink::InputStream> input_stream_;
+  const PrefetchOptions prefetch_options_;
+  // Non-null iff prefetching is enabled.
+  std::shared_ptr<PrefetchState> prefetch_state_;
   bool direct_access_;      // true iff we don't buffer any data any more
 
   // The fields below are valid and in use iff direct_access_ is false.
   // Once direct_access_ becomes true, all the calls to this stream's methods
-  // are directly relayed to methods of input_stream_.
+  // are directly relayed to methods of input_stream_. With prefetching,
+  // direct_access_ stays false, and once rewinding is disabled buffer_ holds
+  // only the last prefetched chunk.
   crypto::tink::util::Status status_;
   std::vector<uint8_t> buffer_;
   bool after_rewind_;       // true iff no Next has been called after rewind
   bool rewinding_enabled_;  // true iff this stream can be rewound
   int64_t position_;     // current position in the stream (from the beginning)
+  int64_t buffer_start_;  // position in the stream of the first byte of buffer_
 
   // Counters that describe the state of the data in buffer_.
   int count_in_buffer_;  // # of bytes available in buffer_
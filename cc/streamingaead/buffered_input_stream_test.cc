@@ -16,7 +16,10 @@
 
 #include "tink/streamingaead/buffered_input_stream.h"
 
+#include <functional>
 #include <sstream>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -83,6 +86,24 @@ util::Status ReadFromStream(InputStream* input_stream, int count,
   return util::Status::OK;
 }
 
+// Runs each scheduled task on a new thread, and joins the threads
+// upon destruction.
+class ThreadScheduler {
+ public:
+  ~ThreadScheduler() {
+    for (auto& thread : threads_) thread.join();
+  }
+
+  std::function<void(std::function<void()>)> Get() {
+    return [this](std::function<void()> task) {
+      threads_.emplace_back(std::move(task));
+    };
+  }
+
+ private:
+  std::vector<std::thread> threads_;
+};
+
 TEST(BufferedInputStreamTest, ReadingAndRewinding) {
   for (auto input_size : {0, 1, 10, 100, 1000, 10000, 100000}) {
     std::string contents = subtle::Random::GetRandomBytes(input_size);
@@ -320,6 +341,78 @@ TEST(BufferedInputStreamTest, DisableRewindingAfterRewind) {
   }
 }
 
+TEST(BufferedInputStreamTest, PrefetchingAfterRewind) {
+  for (int depth : {1, 2, 5}) {
+    for (auto input_size : {0, 10, 1000, 10000, 100000}) {
+      std::string contents = subtle::Random::GetRandomBytes(input_size);
+      for (auto read_size : {0, 10, 1024, 5000}) {
+        SCOPED_TRACE(absl::StrCat("depth = ", depth,
+                                  ", input_size = ", input_size,
+                                  ", read_size = ", read_size));
+        ThreadScheduler scheduler;
+        BufferedInputStream::PrefetchOptions options;
+        options.depth = depth;
+        options.schedule = scheduler.Get();
+        auto buf_stream = absl::make_unique<BufferedInputStream>(
+            GetInputStream(contents), options);
+
+        // Read a prefix, rewind, and disable rewinding.
+        std::string prefix;
+        auto status = ReadFromStream(buf_stream.get(), read_size, &prefix);
+        EXPECT_THAT(status, IsOk());
+        EXPECT_THAT(buf_stream->Rewind(), IsOk());
+        buf_stream->DisableRewinding();
+
+        // Read the input again, in small pieces, which backs up the rest
+        // of each buffer.
+        std::string rest;
+        std::string piece;
+        do {
+          status = ReadFromStream(buf_stream.get(), 777, &piece);
+          EXPECT_THAT(status, IsOk());
+          rest += piece;
+          EXPECT_EQ(rest.size(), buf_stream->Position());
+        } while (!piece.empty());
+        EXPECT_EQ(contents, rest);
+        EXPECT_EQ(input_size, buf_stream->Position());
+
+        // Reading at the end returns OUT_OF_RANGE.
+        const void* buffer;
+        EXPECT_THAT(buf_stream->Next(&buffer).status(),
+                    StatusIs(util::error::OUT_OF_RANGE));
+      }
+    }
+  }
+}
+
+TEST(BufferedInputStreamTest, PrefetchingWithSynchronousSchedule) {
+  std::string contents = subtle::Random::GetRandomBytes(30000);
+  BufferedInputStream::PrefetchOptions options;
+  options.depth = 3;
+  options.schedule = [](std::function<void()> task) { task(); };
+  auto buf_stream =
+      absl::make_unique<BufferedInputStream>(GetInputStream(contents), options);
+  buf_stream->DisableRewinding();
+  std::string output;
+  EXPECT_THAT(ReadFromStream(buf_stream.get(), &output), IsOk());
+  EXPECT_EQ(contents, output);
+}
+
+TEST(BufferedInputStreamTest, DestroyWhilePrefetching) {
+  std::string contents = subtle::Random::GetRandomBytes(100000);
+  ThreadScheduler scheduler;
+  BufferedInputStream::PrefetchOptions options;
+  options.depth = 4;
+  options.schedule = scheduler.Get();
+  auto buf_stream =
+      absl::make_unique<BufferedInputStream>(GetInputStream(contents), options);
+  buf_stream->DisableRewinding();
+  std::string prefix;
+  EXPECT_THAT(ReadFromStream(buf_stream.get(), 10, &prefix), IsOk());
+  EXPECT_EQ(contents.substr(0, 10), prefix);
+  buf_stream.reset();
+}
+
 }  // namespace
 }  // namespace streamingaead
 }  // namespace tink
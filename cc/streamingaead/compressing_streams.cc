@@ -0,0 +1,487 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/streamingaead/compressing_streams.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#include "absl/base/internal/endian.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "tink/util/errors.h"
+
+namespace crypto {
+namespace tink {
+namespace streamingaead {
+
+using crypto::tink::util::Buffer;
+using crypto::tink::util::Status;
+using crypto::tink::util::StatusOr;
+
+namespace {
+
+constexpr uint32_t kFormatVersion = 1;
+constexpr int kFooterSize = 16;
+constexpr int kIndexEntrySize = 8;
+// The size of the buffer of DecompressingInputStream.
+constexpr int kInflateBufferSize = 64 * 1024;
+// Raw deflate streams, i.e. without the zlib header and checksum, since the
+// data is authenticated by the StreamingAead.
+constexpr int kWindowBits = -15;
+constexpr int kMemLevel = 8;
+
+Status CorruptedError(absl::string_view detail) {
+  return Status(util::error::INVALID_ARGUMENT,
+                absl::StrCat("Corrupted compressed data: ", detail));
+}
+
+// Returns the number of blocks of 'size' uncompressed bytes.
+int64_t BlockCount(int64_t size, int block_size) {
+  return (size + block_size - 1) / block_size;
+}
+
+// Reads exactly 'count' bytes at 'position' from 'stream' into 'buffer'.
+Status ReadFully(RandomAccessStream* stream, int64_t position, int count,
+                 Buffer* buffer) {
+  int read = 0;
+  while (read < count) {
+    auto part_result = Buffer::NewNonOwning(
+        buffer->get_mem_block() + read, count - read);
+    if (!part_result.ok()) return part_result.status();
+    Buffer* part = part_result.ValueOrDie().get();
+    Status status = stream->PRead(position + read, count - read, part);
+    read += part->size();
+    if (status.error_code() == util::error::OUT_OF_RANGE && read < count) {
+      return CorruptedError("unexpected end of stream");
+    }
+    if (!status.ok() && status.error_code() != util::error::OUT_OF_RANGE) {
+      return status;
+    }
+  }
+  return buffer->set_size(count);
+}
+
+}  // namespace
+
+// static
+StatusOr<std::unique_ptr<CompressingOutputStream>> CompressingOutputStream::New(
+    std::unique_ptr<crypto::tink::OutputStream> output_stream,
+    CompressionOptions options) {
+  if (output_stream == nullptr) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "output_stream must be non-null");
+  }
+  if (options.block_size <= 0) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "block_size must be positive");
+  }
+  if (options.level < -1 || options.level > 9) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "level must be between -1 and 9");
+  }
+  auto stream = absl::WrapUnique(
+      new CompressingOutputStream(std::move(output_stream),
+                                  options.block_size));
+  if (deflateInit2(&stream->deflater_, options.level, Z_DEFLATED,
+                   kWindowBits, kMemLevel, Z_DEFAULT_STRATEGY) != Z_OK) {
+    // The destructor must not call deflateEnd().
+    stream->deflater_.state = nullptr;
+    return Status(util::error::INTERNAL, "Could not initialize zlib");
+  }
+  return {std::move(stream)};
+}
+
+CompressingOutputStream::CompressingOutputStream(
+    std::unique_ptr<crypto::tink::OutputStream> output_stream,
+    int block_size)
+    : output_stream_(std::move(output_stream)), block_(block_size) {
+  std::memset(&deflater_, 0, sizeof(deflater_));
+}
+
+CompressingOutputStream::~CompressingOutputStream() {
+  if (deflater_.state != nullptr) deflateEnd(&deflater_);
+}
+
+StatusOr<int> CompressingOutputStream::Next(void** data) {
+  if (!status_.ok()) return status_;
+  int block_size = block_.size();
+  if (block_position_ == block_size) {
+    status_ = CompressBlock(block_size);
+    if (!status_.ok()) return status_;
+    blocks_size_ += block_size;
+    block_position_ = 0;
+  }
+  *data = block_.data() + block_position_;
+  next_start_ = block_position_;
+  block_position_ = block_size;
+  return block_size - next_start_;
+}
+
+void CompressingOutputStream::BackUp(int count) {
+  count = std::min(std::max(0, count), block_position_ - next_start_);
+  block_position_ -= count;
+}
+
+Status CompressingOutputStream::Close() {
+  if (!status_.ok()) return status_;
+  if (block_position_ > 0) {
+    status_ = CompressBlock(block_position_);
+    if (!status_.ok()) return status_;
+    blocks_size_ += block_position_;
+    block_position_ = 0;
+  }
+  // The terminator, after which the sequential reader stops.
+  status_ = CompressBlock(0);
+  if (!status_.ok()) return status_;
+
+  std::vector<uint8_t> trailer(
+      kIndexEntrySize * block_positions_.size() + kFooterSize);
+  uint8_t* out = trailer.data();
+  for (int64_t block_position : block_positions_) {
+    absl::big_endian::Store64(out, block_position);
+    out += kIndexEntrySize;
+  }
+  absl::big_endian::Store64(out, blocks_size_);
+  absl::big_endian::Store32(out + 8, block_.size());
+  absl::big_endian::Store32(out + 12, kFormatVersion);
+  status_ = Write(trailer.data(), trailer.size());
+  if (!status_.ok()) return status_;
+  status_ = output_stream_->Close();
+  if (!status_.ok()) return status_;
+  status_ = Status(util::error::FAILED_PRECONDITION, "Stream closed");
+  return util::OkStatus();
+}
+
+int64_t CompressingOutputStream::Position() const {
+  return blocks_size_ + block_position_;
+}
+
+Status CompressingOutputStream::CompressBlock(int size) {
+  block_positions_.push_back(compressed_size_);
+  if (deflateReset(&deflater_) != Z_OK) {
+    return Status(util::error::INTERNAL, "Could not reset zlib");
+  }
+  deflater_.next_in = block_.data();
+  deflater_.avail_in = size;
+  int result = Z_OK;
+  while (result != Z_STREAM_END) {
+    void* buffer;
+    auto next_result = output_stream_->Next(&buffer);
+    if (!next_result.ok()) return next_result.status();
+    deflater_.next_out = static_cast<Bytef*>(buffer);
+    deflater_.avail_out = next_result.ValueOrDie();
+    result = deflate(&deflater_, Z_FINISH);
+    if (result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR) {
+      return Status(util::error::INTERNAL, "Could not compress data");
+    }
+    compressed_size_ += next_result.ValueOrDie() - deflater_.avail_out;
+    output_stream_->BackUp(deflater_.avail_out);
+  }
+  return util::OkStatus();
+}
+
+Status CompressingOutputStream::Write(const uint8_t* data, size_t size) {
+  while (size > 0) {
+    void* buffer;
+    auto next_result = output_stream_->Next(&buffer);
+    if (!next_result.ok()) return next_result.status();
+    size_t count =
+        std::min(size, static_cast<size_t>(next_result.ValueOrDie()));
+    std::memcpy(buffer, data, count);
+    output_stream_->BackUp(next_result.ValueOrDie() - count);
+    data += count;
+    size -= count;
+    compressed_size_ += count;
+  }
+  return util::OkStatus();
+}
+
+// static
+StatusOr<std::unique_ptr<DecompressingInputStream>>
+DecompressingInputStream::New(
+    std::unique_ptr<crypto::tink::InputStream> input_stream) {
+  if (input_stream == nullptr) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "input_stream must be non-null");
+  }
+  auto stream =
+      absl::WrapUnique(new DecompressingInputStream(std::move(input_stream)));
+  if (inflateInit2(&stream->inflater_, kWindowBits) != Z_OK) {
+    stream->inflater_.state = nullptr;
+    return Status(util::error::INTERNAL, "Could not initialize zlib");
+  }
+  return {std::move(stream)};
+}
+
+DecompressingInputStream::DecompressingInputStream(
+    std::unique_ptr<crypto::tink::InputStream> input_stream)
+    : input_stream_(std::move(input_stream)), buffer_(kInflateBufferSize) {
+  std::memset(&inflater_, 0, sizeof(inflater_));
+}
+
+DecompressingInputStream::~DecompressingInputStream() {
+  if (inflater_.state != nullptr) inflateEnd(&inflater_);
+}
+
+StatusOr<int> DecompressingInputStream::Next(const void** data) {
+  if (count_backedup_ > 0) {
+    *data = buffer_.data() + count_in_buffer_ - count_backedup_;
+    int count = count_backedup_;
+    position_ += count;
+    count_backedup_ = 0;
+    return count;
+  }
+  if (!status_.ok()) return status_;
+  int count = 0;
+  while (count == 0) {
+    if (inflater_.avail_in == 0) {
+      const void* in;
+      auto next_result = input_stream_->Next(&in);
+      if (!next_result.ok()) {
+        status_ = next_result.status();
+        if (status_.error_code() == util::error::OUT_OF_RANGE) {
+          status_ = CorruptedError("missing end of the compressed blocks");
+        }
+        return status_;
+      }
+      inflater_.next_in =
+          static_cast<Bytef*>(const_cast<void*>(in));
+      inflater_.avail_in = next_result.ValueOrDie();
+      continue;
+    }
+    inflater_.next_out = buffer_.data();
+    inflater_.avail_out = buffer_.size();
+    int result = inflate(&inflater_, Z_NO_FLUSH);
+    if (result != Z_OK && result != Z_STREAM_END) {
+      status_ = CorruptedError("invalid deflate stream");
+      return status_;
+    }
+    count = buffer_.size() - inflater_.avail_out;
+    if (count > 0) stream_empty_ = false;
+    if (result == Z_STREAM_END) {
+      ++ended_streams_;
+      if (stream_empty_) {
+        status_ = ReadTrailer();
+        if (!status_.ok()) return status_;
+        status_ = Status(util::error::OUT_OF_RANGE, "EOF");
+        // The terminator produces no bytes, so count is 0.
+        return status_;
+      }
+      if (inflateReset(&inflater_) != Z_OK) {
+        status_ = Status(util::error::INTERNAL, "Could not reset zlib");
+        return status_;
+      }
+      stream_empty_ = true;
+    }
+  }
+  *data = buffer_.data();
+  count_in_buffer_ = count;
+  position_ += count;
+  return count;
+}
+
+void DecompressingInputStream::BackUp(int count) {
+  count = std::min(std::max(0, count), count_in_buffer_ - count_backedup_);
+  count_backedup_ += count;
+  position_ -= count;
+}
+
+int64_t DecompressingInputStream::Position() const { return position_; }
+
+Status DecompressingInputStream::ReadTrailer() {
+  std::string trailer(reinterpret_cast<const char*>(inflater_.next_in),
+                      inflater_.avail_in);
+  inflater_.avail_in = 0;
+  while (true) {
+    const void* in;
+    auto next_result = input_stream_->Next(&in);
+    if (!next_result.ok()) {
+      if (next_result.status().error_code() == util::error::OUT_OF_RANGE) {
+        break;
+      }
+      return next_result.status();
+    }
+    trailer.append(static_cast<const char*>(in), next_result.ValueOrDie());
+  }
+  if (trailer.size() != kIndexEntrySize * ended_streams_ + kFooterSize) {
+    return CorruptedError("invalid index size");
+  }
+  const uint8_t* footer = reinterpret_cast<const uint8_t*>(trailer.data()) +
+                          trailer.size() - kFooterSize;
+  if (absl::big_endian::Load32(footer + 12) != kFormatVersion) {
+    return CorruptedError("unsupported format version");
+  }
+  if (static_cast<int64_t>(absl::big_endian::Load64(footer)) != position_) {
+    return CorruptedError("invalid uncompressed size");
+  }
+  return util::OkStatus();
+}
+
+DecompressingRandomAccessStream::DecompressingRandomAccessStream(
+    std::unique_ptr<crypto::tink::RandomAccessStream> random_access_stream)
+    : random_access_stream_(std::move(random_access_stream)) {}
+
+Status DecompressingRandomAccessStream::ReadIndex() {
+  absl::MutexLock lock(&index_mutex_);
+  if (index_read_) return index_status_;
+  index_read_ = true;
+  auto compressed_size_result = random_access_stream_->size();
+  if (!compressed_size_result.ok()) {
+    index_status_ = compressed_size_result.status();
+    return index_status_;
+  }
+  int64_t compressed_size = compressed_size_result.ValueOrDie();
+  if (compressed_size < kFooterSize + kIndexEntrySize) {
+    index_status_ = CorruptedError("too short");
+    return index_status_;
+  }
+  auto footer_result = Buffer::New(kFooterSize);
+  if (!footer_result.ok()) {
+    index_status_ = footer_result.status();
+    return index_status_;
+  }
+  Buffer* footer = footer_result.ValueOrDie().get();
+  index_status_ = ReadFully(random_access_stream_.get(),
+                            compressed_size - kFooterSize, kFooterSize,
+                            footer);
+  if (!index_status_.ok()) return index_status_;
+  const uint8_t* footer_bytes =
+      reinterpret_cast<const uint8_t*>(footer->get_mem_block());
+  int64_t size = absl::big_endian::Load64(footer_bytes);
+  int64_t block_size = absl::big_endian::Load32(footer_bytes + 8);
+  if (absl::big_endian::Load32(footer_bytes + 12) != kFormatVersion) {
+    index_status_ = CorruptedError("unsupported format version");
+    return index_status_;
+  }
+  if (size < 0 || block_size <= 0 || block_size > INT32_MAX) {
+    index_status_ = CorruptedError("invalid footer");
+    return index_status_;
+  }
+  int64_t entries = BlockCount(size, block_size) + 1;
+  int64_t index_size = kIndexEntrySize * entries;
+  if (index_size > compressed_size - kFooterSize || index_size > INT32_MAX) {
+    index_status_ = CorruptedError("invalid index size");
+    return index_status_;
+  }
+  auto index_result = Buffer::New(index_size);
+  if (!index_result.ok()) {
+    index_status_ = index_result.status();
+    return index_status_;
+  }
+  Buffer* index = index_result.ValueOrDie().get();
+  int64_t index_position = compressed_size - kFooterSize - index_size;
+  index_status_ = ReadFully(random_access_stream_.get(), index_position,
+                            index_size, index);
+  if (!index_status_.ok()) return index_status_;
+  std::vector<int64_t> block_positions(entries);
+  const uint8_t* entry =
+      reinterpret_cast<const uint8_t*>(index->get_mem_block());
+  int64_t previous = 0;
+  for (int64_t i = 0; i < entries; ++i) {
+    block_positions[i] = absl::big_endian::Load64(entry + kIndexEntrySize * i);
+    if (block_positions[i] < previous || block_positions[i] > index_position) {
+      index_status_ = CorruptedError("invalid block position");
+      return index_status_;
+    }
+    previous = block_positions[i];
+  }
+  size_ = size;
+  block_size_ = block_size;
+  block_positions_ = std::move(block_positions);
+  return index_status_;
+}
+
+Status DecompressingRandomAccessStream::ReadBlock(
+    int64_t i, std::vector<uint8_t>* block) {
+  int64_t start = block_positions_[i];
+  int64_t compressed_block_size = block_positions_[i + 1] - start;
+  if (compressed_block_size > INT32_MAX) {
+    return CorruptedError("block too large");
+  }
+  auto compressed_result = Buffer::New(std::max<int64_t>(
+      1, compressed_block_size));
+  if (!compressed_result.ok()) return compressed_result.status();
+  Buffer* compressed = compressed_result.ValueOrDie().get();
+  Status status = ReadFully(random_access_stream_.get(), start,
+                            compressed_block_size, compressed);
+  if (!status.ok()) return status;
+
+  int64_t expected_size = std::min<int64_t>(block_size_, size_ - i * block_size_);
+  block->resize(expected_size);
+  z_stream inflater;
+  std::memset(&inflater, 0, sizeof(inflater));
+  if (inflateInit2(&inflater, kWindowBits) != Z_OK) {
+    return Status(util::error::INTERNAL, "Could not initialize zlib");
+  }
+  inflater.next_in = reinterpret_cast<Bytef*>(compressed->get_mem_block());
+  inflater.avail_in = compressed_block_size;
+  inflater.next_out = block->data();
+  inflater.avail_out = expected_size;
+  int result = inflate(&inflater, Z_FINISH);
+  bool complete = result == Z_STREAM_END && inflater.avail_out == 0 &&
+                  inflater.avail_in == 0;
+  inflateEnd(&inflater);
+  if (!complete) return CorruptedError("invalid block");
+  return util::OkStatus();
+}
+
+Status DecompressingRandomAccessStream::PRead(int64_t position, int count,
+                                              Buffer* dest_buffer) {
+  if (dest_buffer == nullptr) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "dest_buffer must be non-null");
+  }
+  if (count < 0 || position < 0 || dest_buffer->allocated_size() < count) {
+    return Status(util::error::INVALID_ARGUMENT, "Invalid PRead arguments");
+  }
+  auto status = dest_buffer->set_size(0);
+  if (!status.ok()) return status;
+  status = ReadIndex();
+  if (!status.ok()) return status;
+  if (position >= size_) {
+    return Status(util::error::OUT_OF_RANGE, "EOF");
+  }
+  int64_t end = std::min<int64_t>(size_, position + count);
+  std::vector<uint8_t> block;
+  int written = 0;
+  for (int64_t i = position / block_size_; i * block_size_ < end; ++i) {
+    status = ReadBlock(i, &block);
+    if (!status.ok()) return status;
+    int64_t block_start = i * block_size_;
+    int64_t from = std::max(position, block_start) - block_start;
+    int64_t to = std::min<int64_t>(end - block_start, block.size());
+    std::memcpy(dest_buffer->get_mem_block() + written, block.data() + from,
+                to - from);
+    written += to - from;
+  }
+  status = dest_buffer->set_size(written);
+  if (!status.ok()) return status;
+  if (written < count) return Status(util::error::OUT_OF_RANGE, "EOF");
+  return util::OkStatus();
+}
+
+StatusOr<int64_t> DecompressingRandomAccessStream::size() {
+  auto status = ReadIndex();
+  if (!status.ok()) return status;
+  return size_;
+}
+
+}  // namespace streamingaead
+}  // namespace tink
+}  // namespace crypto
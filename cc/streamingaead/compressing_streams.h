@@ -0,0 +1,196 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_STREAMINGAEAD_COMPRESSING_STREAMS_H_
+#define TINK_STREAMINGAEAD_COMPRESSING_STREAMS_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "tink/input_stream.h"
+#include "tink/output_stream.h"
+#include "tink/random_access_stream.h"
+#include "tink/util/buffer.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "zlib.h"
+
+namespace crypto {
+namespace tink {
+namespace streamingaead {
+
+// Streams which compress data with zlib before it is encrypted with a
+// StreamingAead, and decompress it after decryption. The compressed bytes
+// are written directly into the buffers of the encrypting stream and read
+// directly from those of the decrypting stream, without a copy in between.
+//
+// The data is compressed in independent blocks of a fixed number of
+// uncompressed bytes, followed by an index of the positions of the blocks,
+// so that a DecompressingRandomAccessStream over the stream returned by
+// NewDecryptingRandomAccessStream() decompresses only the blocks which a
+// read touches. The format of the compressed data is:
+//
+//   block_0 || ... || block_{n-1} || terminator || index || footer
+//
+// where each block is a raw deflate stream of block_size uncompressed bytes
+// (fewer for block_{n-1}), terminator is a raw deflate stream of no bytes,
+// index holds the n + 1 positions of the blocks and of the terminator as
+// big-endian uint64s, and footer holds the uncompressed size as a big-endian
+// uint64, followed by block_size and the format version 1 as big-endian
+// uint32s.
+
+// The settings of a CompressingOutputStream.
+struct CompressionOptions {
+  // The number of uncompressed bytes per block. Larger blocks compress
+  // better, smaller blocks make random access reads cheaper.
+  int block_size = 64 * 1024;
+  // The zlib compression level, from 0 (none) to 9 (best), or -1 for the
+  // default of zlib.
+  int level = -1;
+};
+
+// An OutputStream which compresses the data written to it, typically into
+// an encrypting stream.
+class CompressingOutputStream : public crypto::tink::OutputStream {
+ public:
+  // Returns a stream which writes the compressed data to 'output_stream'.
+  static crypto::tink::util::StatusOr<std::unique_ptr<CompressingOutputStream>>
+  New(std::unique_ptr<crypto::tink::OutputStream> output_stream,
+      CompressionOptions options = CompressionOptions());
+
+  ~CompressingOutputStream() override;
+
+  crypto::tink::util::StatusOr<int> Next(void** data) override;
+
+  void BackUp(int count) override;
+
+  // Compresses the last block, writes the index and closes 'output_stream'.
+  crypto::tink::util::Status Close() override;
+
+  // Returns the number of uncompressed bytes written.
+  int64_t Position() const override;
+
+ private:
+  CompressingOutputStream(
+      std::unique_ptr<crypto::tink::OutputStream> output_stream,
+      int block_size);
+
+  // Compresses the first 'size' bytes of block_ into a raw deflate stream.
+  crypto::tink::util::Status CompressBlock(int size);
+
+  // Writes 'size' bytes of 'data' to output_stream_.
+  crypto::tink::util::Status Write(const uint8_t* data, size_t size);
+
+  std::unique_ptr<crypto::tink::OutputStream> output_stream_;
+  z_stream deflater_;
+  crypto::tink::util::Status status_;
+  // The uncompressed bytes of the current block.
+  std::vector<uint8_t> block_;
+  // The number of bytes of block_ which were returned by Next() and not
+  // backed up.
+  int block_position_ = 0;
+  // The offset in block_ of the buffer returned by the last Next().
+  int next_start_ = 0;
+  // The number of uncompressed bytes of the blocks before block_.
+  int64_t blocks_size_ = 0;
+  // The number of compressed bytes written to output_stream_.
+  int64_t compressed_size_ = 0;
+  // The positions of the blocks in the compressed data.
+  std::vector<int64_t> block_positions_;
+};
+
+// An InputStream which decompresses data written by a
+// CompressingOutputStream, typically read from a decrypting stream.
+class DecompressingInputStream : public crypto::tink::InputStream {
+ public:
+  // Returns a stream which reads the compressed data from 'input_stream'.
+  static crypto::tink::util::StatusOr<
+      std::unique_ptr<DecompressingInputStream>>
+  New(std::unique_ptr<crypto::tink::InputStream> input_stream);
+
+  ~DecompressingInputStream() override;
+
+  crypto::tink::util::StatusOr<int> Next(const void** data) override;
+
+  void BackUp(int count) override;
+
+  int64_t Position() const override;
+
+ private:
+  explicit DecompressingInputStream(
+      std::unique_ptr<crypto::tink::InputStream> input_stream);
+
+  // Reads the index and the footer, and checks that they match the data.
+  crypto::tink::util::Status ReadTrailer();
+
+  std::unique_ptr<crypto::tink::InputStream> input_stream_;
+  z_stream inflater_;
+  crypto::tink::util::Status status_;
+  std::vector<uint8_t> buffer_;
+  // The number of decompressed bytes in buffer_, and the number of them
+  // which were backed up.
+  int count_in_buffer_ = 0;
+  int count_backedup_ = 0;
+  int64_t position_ = 0;
+  // The number of deflate streams which ended, including the terminator.
+  int64_t ended_streams_ = 0;
+  // Whether the last deflate stream which was inflated was empty.
+  bool stream_empty_ = true;
+};
+
+// A RandomAccessStream which decompresses data written by a
+// CompressingOutputStream, typically read from a decrypting random access
+// stream. Each PRead() decompresses the blocks it touches. It is thread-safe
+// if 'random_access_stream' is.
+class DecompressingRandomAccessStream
+    : public crypto::tink::RandomAccessStream {
+ public:
+  explicit DecompressingRandomAccessStream(
+      std::unique_ptr<crypto::tink::RandomAccessStream> random_access_stream);
+
+  crypto::tink::util::Status PRead(
+      int64_t position, int count,
+      crypto::tink::util::Buffer* dest_buffer) override;
+
+  // Returns the uncompressed size.
+  crypto::tink::util::StatusOr<int64_t> size() override;
+
+ private:
+  // Reads the footer and the index on the first call.
+  crypto::tink::util::Status ReadIndex();
+
+  // Decompresses block 'i' into 'block'.
+  crypto::tink::util::Status ReadBlock(int64_t i, std::vector<uint8_t>* block);
+
+  const std::unique_ptr<crypto::tink::RandomAccessStream>
+      random_access_stream_;
+  absl::Mutex index_mutex_;
+  bool index_read_ ABSL_GUARDED_BY(index_mutex_) = false;
+  crypto::tink::util::Status index_status_ ABSL_GUARDED_BY(index_mutex_);
+  // Set once by ReadIndex(), constant afterwards.
+  int64_t size_ = 0;
+  int block_size_ = 0;
+  std::vector<int64_t> block_positions_;
+};
+
+}  // namespace streamingaead
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_STREAMINGAEAD_COMPRESSING_STREAMS_H_
@@ -0,0 +1,307 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/streamingaead/compressing_streams.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <utility>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "tink/subtle/random.h"
+#include "tink/subtle/test_util.h"
+#include "tink/util/buffer.h"
+#include "tink/util/istream_input_stream.h"
+#include "tink/util/ostream_output_stream.h"
+#include "tink/util/status.h"
+#include "tink/util/test_matchers.h"
+#include "tink/util/test_util.h"
+
+namespace crypto {
+namespace tink {
+namespace streamingaead {
+namespace {
+
+using ::crypto::tink::subtle::Random;
+using ::crypto::tink::test::DummyStreamingAead;
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::crypto::tink::util::Buffer;
+using ::crypto::tink::util::IstreamInputStream;
+using ::crypto::tink::util::OstreamOutputStream;
+using ::crypto::tink::util::Status;
+using ::testing::Eq;
+using ::testing::Lt;
+
+// A RandomAccessStream over a string, which counts the bytes read.
+class StringRandomAccessStream : public RandomAccessStream {
+ public:
+  explicit StringRandomAccessStream(std::string data)
+      : data_(std::move(data)) {}
+
+  Status PRead(int64_t position, int count, Buffer* dest_buffer) override {
+    auto status = dest_buffer->set_size(0);
+    if (!status.ok()) return status;
+    if (position >= data_.size()) {
+      return Status(util::error::OUT_OF_RANGE, "EOF");
+    }
+    int read = std::min<int64_t>(count, data_.size() - position);
+    std::memcpy(dest_buffer->get_mem_block(), data_.data() + position, read);
+    bytes_read_ += read;
+    status = dest_buffer->set_size(read);
+    if (!status.ok()) return status;
+    if (read < count) return Status(util::error::OUT_OF_RANGE, "EOF");
+    return util::OkStatus();
+  }
+
+  util::StatusOr<int64_t> size() override { return data_.size(); }
+
+  int64_t bytes_read() const { return bytes_read_; }
+
+ private:
+  const std::string data_;
+  int64_t bytes_read_ = 0;
+};
+
+// Returns data which compresses well.
+std::string CompressibleData(int size) {
+  std::string data;
+  for (int i = 0; data.size() < size; ++i) {
+    absl::StrAppend(&data, "log line ", i % 100, ": ", Random::GetRandomBytes(1),
+                    "\n");
+  }
+  data.resize(size);
+  return data;
+}
+
+std::string Compress(absl::string_view data,
+                     CompressionOptions options = CompressionOptions()) {
+  auto out = absl::make_unique<std::stringstream>();
+  std::stringstream* out_ptr = out.get();
+  auto stream_result = CompressingOutputStream::New(
+      absl::make_unique<OstreamOutputStream>(std::move(out), 100), options);
+  EXPECT_THAT(stream_result.status(), IsOk());
+  EXPECT_THAT(subtle::test::WriteToStream(stream_result.ValueOrDie().get(),
+                                          data),
+              IsOk());
+  return out_ptr->str();
+}
+
+std::string Decompress(absl::string_view compressed) {
+  auto stream_result =
+      DecompressingInputStream::New(absl::make_unique<IstreamInputStream>(
+          absl::make_unique<std::stringstream>(std::string(compressed)), 100));
+  EXPECT_THAT(stream_result.status(), IsOk());
+  std::string data;
+  EXPECT_THAT(
+      subtle::test::ReadFromStream(stream_result.ValueOrDie().get(), &data),
+      IsOk());
+  return data;
+}
+
+TEST(CompressingStreamsTest, SequentialRoundTrip) {
+  for (int block_size : {1, 100, 4096, 64 * 1024}) {
+    for (int size : {0, 1, 99, 100, 101, 10000, 300000}) {
+      SCOPED_TRACE(absl::StrCat("block_size: ", block_size, " size: ", size));
+      std::string data = CompressibleData(size);
+      CompressionOptions options;
+      options.block_size = block_size;
+      EXPECT_THAT(Decompress(Compress(data, options)), Eq(data));
+    }
+  }
+}
+
+TEST(CompressingStreamsTest, CompressesCompressibleData) {
+  std::string data = CompressibleData(100000);
+  EXPECT_THAT(Compress(data).size(), Lt(data.size() / 2));
+}
+
+TEST(CompressingStreamsTest, BackUp) {
+  auto out = absl::make_unique<std::stringstream>();
+  std::stringstream* out_ptr = out.get();
+  CompressionOptions options;
+  options.block_size = 16;
+  auto stream_result = CompressingOutputStream::New(
+      absl::make_unique<OstreamOutputStream>(std::move(out)), options);
+  ASSERT_THAT(stream_result.status(), IsOk());
+  auto& stream = stream_result.ValueOrDie();
+  std::string expected;
+  for (int i = 0; i < 10; ++i) {
+    void* buffer;
+    auto next_result = stream->Next(&buffer);
+    ASSERT_THAT(next_result.status(), IsOk());
+    // Blocks of 16 bytes make some buffers shorter than "abcde".
+    int count = std::min(5, next_result.ValueOrDie());
+    std::memcpy(buffer, "abcde", count);
+    stream->BackUp(next_result.ValueOrDie() - count);
+    expected.append("abcde", count);
+    EXPECT_THAT(stream->Position(), Eq(expected.size()));
+  }
+  ASSERT_THAT(stream->Close(), IsOk());
+
+  auto in_result =
+      DecompressingInputStream::New(absl::make_unique<IstreamInputStream>(
+          absl::make_unique<std::stringstream>(out_ptr->str())));
+  ASSERT_THAT(in_result.status(), IsOk());
+  auto& in = in_result.ValueOrDie();
+  const void* buffer;
+  auto next_result = in->Next(&buffer);
+  ASSERT_THAT(next_result.status(), IsOk());
+  in->BackUp(next_result.ValueOrDie());
+  EXPECT_THAT(in->Position(), Eq(0));
+  std::string data;
+  ASSERT_THAT(subtle::test::ReadFromStream(in.get(), &data), IsOk());
+  EXPECT_THAT(data, Eq(expected));
+}
+
+TEST(CompressingStreamsTest, InvalidOptions) {
+  CompressionOptions options;
+  options.block_size = 0;
+  EXPECT_THAT(CompressingOutputStream::New(
+                  absl::make_unique<OstreamOutputStream>(
+                      absl::make_unique<std::stringstream>()),
+                  options)
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  options = CompressionOptions();
+  options.level = 10;
+  EXPECT_THAT(CompressingOutputStream::New(
+                  absl::make_unique<OstreamOutputStream>(
+                      absl::make_unique<std::stringstream>()),
+                  options)
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(CompressingStreamsTest, TruncatedData) {
+  std::string compressed = Compress(CompressibleData(10000));
+  auto stream_result =
+      DecompressingInputStream::New(absl::make_unique<IstreamInputStream>(
+          absl::make_unique<std::stringstream>(
+              compressed.substr(0, compressed.size() - 1))));
+  ASSERT_THAT(stream_result.status(), IsOk());
+  std::string data;
+  EXPECT_THAT(
+      subtle::test::ReadFromStream(stream_result.ValueOrDie().get(), &data),
+      StatusIs(util::error::INVALID_ARGUMENT));
+
+  auto short_result =
+      DecompressingInputStream::New(absl::make_unique<IstreamInputStream>(
+          absl::make_unique<std::stringstream>(compressed.substr(0, 100))));
+  ASSERT_THAT(short_result.status(), IsOk());
+  EXPECT_THAT(
+      subtle::test::ReadFromStream(short_result.ValueOrDie().get(), &data),
+      StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(CompressingStreamsTest, RandomAccess) {
+  std::string data = CompressibleData(100000);
+  CompressionOptions options;
+  options.block_size = 4096;
+  DecompressingRandomAccessStream stream(
+      absl::make_unique<StringRandomAccessStream>(Compress(data, options)));
+  auto size_result = stream.size();
+  ASSERT_THAT(size_result.status(), IsOk());
+  EXPECT_THAT(size_result.ValueOrDie(), Eq(data.size()));
+
+  auto buffer = std::move(Buffer::New(10000).ValueOrDie());
+  for (int64_t position : {0, 1, 4095, 4096, 50000, 95000}) {
+    for (int count : {1, 100, 4096, 10000}) {
+      SCOPED_TRACE(absl::StrCat("position: ", position, " count: ", count));
+      Status status = stream.PRead(position, count, buffer.get());
+      int64_t expected_size =
+          std::min<int64_t>(count, data.size() - position);
+      if (expected_size < count) {
+        EXPECT_THAT(status, StatusIs(util::error::OUT_OF_RANGE));
+      } else {
+        EXPECT_THAT(status, IsOk());
+      }
+      EXPECT_THAT(std::string(buffer->get_mem_block(), buffer->size()),
+                  Eq(data.substr(position, expected_size)));
+    }
+  }
+  EXPECT_THAT(stream.PRead(data.size(), 1, buffer.get()),
+              StatusIs(util::error::OUT_OF_RANGE));
+  EXPECT_THAT(buffer->size(), Eq(0));
+}
+
+TEST(CompressingStreamsTest, RandomAccessReadsOnlyTouchedBlocks) {
+  std::string data = Random::GetRandomBytes(1000000);
+  CompressionOptions options;
+  options.block_size = 4096;
+  auto compressed = absl::make_unique<StringRandomAccessStream>(
+      Compress(data, options));
+  StringRandomAccessStream* compressed_ptr = compressed.get();
+  DecompressingRandomAccessStream stream(std::move(compressed));
+  auto buffer = std::move(Buffer::New(10).ValueOrDie());
+  ASSERT_THAT(stream.PRead(500000, 10, buffer.get()), IsOk());
+  EXPECT_THAT(std::string(buffer->get_mem_block(), buffer->size()),
+              Eq(data.substr(500000, 10)));
+  // The footer, the index and one block.
+  EXPECT_THAT(compressed_ptr->bytes_read(), Lt(10000));
+}
+
+TEST(CompressingStreamsTest, EncryptsCompressedData) {
+  DummyStreamingAead saead("saead");
+  std::string plaintext = CompressibleData(100000);
+  auto ct = absl::make_unique<std::stringstream>();
+  std::stringstream* ct_ptr = ct.get();
+  auto enc_result = saead.NewEncryptingStream(
+      absl::make_unique<OstreamOutputStream>(std::move(ct)), "ad");
+  ASSERT_THAT(enc_result.status(), IsOk());
+  auto compressing_result =
+      CompressingOutputStream::New(std::move(enc_result.ValueOrDie()));
+  ASSERT_THAT(compressing_result.status(), IsOk());
+  ASSERT_THAT(subtle::test::WriteToStream(
+                  compressing_result.ValueOrDie().get(), plaintext),
+              IsOk());
+  std::string ciphertext = ct_ptr->str();
+  EXPECT_THAT(ciphertext.size(), Lt(plaintext.size() / 2));
+
+  auto dec_result = saead.NewDecryptingStream(
+      absl::make_unique<IstreamInputStream>(
+          absl::make_unique<std::stringstream>(ciphertext)),
+      "ad");
+  ASSERT_THAT(dec_result.status(), IsOk());
+  auto decompressing_result =
+      DecompressingInputStream::New(std::move(dec_result.ValueOrDie()));
+  ASSERT_THAT(decompressing_result.status(), IsOk());
+  std::string decrypted;
+  ASSERT_THAT(subtle::test::ReadFromStream(
+                  decompressing_result.ValueOrDie().get(), &decrypted),
+              IsOk());
+  EXPECT_THAT(decrypted, Eq(plaintext));
+
+  auto dec_ra_result = saead.NewDecryptingRandomAccessStream(
+      absl::make_unique<StringRandomAccessStream>(ciphertext), "ad");
+  ASSERT_THAT(dec_ra_result.status(), IsOk());
+  DecompressingRandomAccessStream ra_stream(
+      std::move(dec_ra_result.ValueOrDie()));
+  auto buffer = std::move(Buffer::New(1000).ValueOrDie());
+  ASSERT_THAT(ra_stream.PRead(70000, 1000, buffer.get()), IsOk());
+  EXPECT_THAT(std::string(buffer->get_mem_block(), buffer->size()),
+              Eq(plaintext.substr(70000, 1000)));
+}
+
+}  // namespace
+}  // namespace streamingaead
+}  // namespace tink
+}  // namespace crypto
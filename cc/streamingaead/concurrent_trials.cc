@@ -0,0 +1,239 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/streamingaead/concurrent_trials.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/synchronization/blocking_counter.h"
+#include "absl/synchronization/mutex.h"
+#include "tink/input_stream.h"
+#include "tink/random_access_stream.h"
+#include "tink/util/buffer.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace streamingaead {
+
+using util::Status;
+using util::StatusOr;
+
+namespace {
+
+Status CancelledStatus() {
+  return Status(util::error::CANCELLED, "another key matched the ciphertext");
+}
+
+}  // namespace
+
+void RunTrials(int begin, int end,
+               const std::function<void(std::function<void()>)>& schedule,
+               const std::function<void(int)>& trial) {
+  if (begin >= end) return;
+  if (schedule == nullptr) {
+    for (int i = begin; i < end; i++) trial(i);
+    return;
+  }
+  absl::BlockingCounter pending(end - begin - 1);
+  for (int i = begin + 1; i < end; i++) {
+    schedule([&trial, &pending, i]() {
+      trial(i);
+      pending.DecrementCount();
+    });
+  }
+  trial(begin);
+  pending.Wait();
+}
+
+class TrialInputSource::TrialStream : public crypto::tink::InputStream {
+ public:
+  TrialStream(TrialInputSource* source, int trial)
+      : source_(source), trial_(trial) {}
+
+  StatusOr<int> Next(const void** data) override {
+    auto next_result = source_->Read(trial_, position_, data);
+    if (!next_result.ok()) {
+      last_count_ = 0;
+      return next_result;
+    }
+    last_count_ = next_result.ValueOrDie();
+    position_ += last_count_;
+    return next_result;
+  }
+
+  void BackUp(int count) override {
+    count = std::min(count, last_count_);
+    if (count <= 0) return;
+    source_->BackUp(trial_, position_, count);
+    position_ -= count;
+    last_count_ -= count;
+  }
+
+  int64_t Position() const override { return position_; }
+
+ private:
+  TrialInputSource* const source_;
+  const int trial_;
+  int64_t position_ = 0;
+  int last_count_ = 0;  // # of bytes of the last Next() not backed up
+};
+
+std::unique_ptr<InputStream> TrialInputSource::NewTrialStream(int trial) {
+  return absl::make_unique<TrialStream>(this, trial);
+}
+
+bool TrialInputSource::SetMatch(int trial) {
+  int none = -1;
+  return match_.compare_exchange_strong(none, trial,
+                                        std::memory_order_acq_rel);
+}
+
+StatusOr<int> TrialInputSource::Read(int trial, int64_t position,
+                                     const void** data) {
+  int match = match_.load(std::memory_order_acquire);
+  if (match >= 0 && match != trial) return CancelledStatus();
+  absl::MutexLock lock(&mutex_);
+  if (position < buffered_size_) {
+    int i = std::upper_bound(chunk_positions_.begin(),
+                             chunk_positions_.end(), position) -
+            chunk_positions_.begin() - 1;
+    int offset = position - chunk_positions_[i];
+    *data = chunks_[i].data() + offset;
+    return chunks_[i].size() - offset;
+  }
+  if (match == trial) {
+    // The other trials returned, so the buffer is no longer needed.
+    chunks_.clear();
+    chunk_positions_.clear();
+    return source_->Next(data);
+  }
+  if (!status_.ok()) return status_;
+  const void* chunk;
+  auto next_result = source_->Next(&chunk);
+  if (!next_result.ok()) {
+    status_ = next_result.status();
+    return status_;
+  }
+  int count = next_result.ValueOrDie();
+  chunks_.emplace_back(static_cast<const char*>(chunk), count);
+  chunk_positions_.push_back(buffered_size_);
+  buffered_size_ += count;
+  *data = chunks_.back().data();
+  return count;
+}
+
+void TrialInputSource::BackUp(int trial, int64_t end, int count) {
+  absl::MutexLock lock(&mutex_);
+  // Only the match reads past the buffered ciphertext, from source_.
+  if (end > buffered_size_) source_->BackUp(count);
+}
+
+class TrialRandomAccessSource::TrialStream
+    : public crypto::tink::RandomAccessStream {
+ public:
+  TrialStream(TrialRandomAccessSource* source, int trial)
+      : source_(source), trial_(trial) {}
+
+  Status PRead(int64_t position, int count,
+               util::Buffer* dest_buffer) override {
+    return source_->PRead(trial_, position, count, dest_buffer);
+  }
+
+  StatusOr<int64_t> size() override { return source_->source_->size(); }
+
+ private:
+  TrialRandomAccessSource* const source_;
+  const int trial_;
+};
+
+std::unique_ptr<RandomAccessStream> TrialRandomAccessSource::NewTrialStream(
+    int trial) {
+  return absl::make_unique<TrialStream>(this, trial);
+}
+
+bool TrialRandomAccessSource::SetMatch(int trial) {
+  absl::MutexLock lock(&mutex_);
+  int none = -1;
+  if (!match_.compare_exchange_strong(none, trial,
+                                      std::memory_order_acq_rel)) {
+    return false;
+  }
+  std::string().swap(prefix_);
+  return true;
+}
+
+Status TrialRandomAccessSource::PRead(int trial, int64_t position, int count,
+                                      util::Buffer* dest_buffer) {
+  int match = match_.load(std::memory_order_acquire);
+  if (match == trial) return source_->PRead(position, count, dest_buffer);
+  if (match >= 0) return CancelledStatus();
+  if (position < 0 || count < 0 || dest_buffer == nullptr ||
+      count > dest_buffer->allocated_size()) {
+    return source_->PRead(position, count, dest_buffer);
+  }
+  {
+    absl::MutexLock lock(&mutex_);
+    // Re-check, since the match may have released the buffer meanwhile.
+    match = match_.load(std::memory_order_acquire);
+    if (match >= 0) return CancelledStatus();
+    int64_t end = position + count;
+    if (!prefix_complete_ && end > prefix_.size() &&
+        end <= max_buffered_size_) {
+      // Extends the prefix up to 'end', so that the other trials can read
+      // the same range from it.
+      int64_t missing = end - prefix_.size();
+      auto buffer_result = util::Buffer::New(missing);
+      if (!buffer_result.ok()) return buffer_result.status();
+      auto buffer = std::move(buffer_result.ValueOrDie());
+      Status status = source_->PRead(prefix_.size(), missing, buffer.get());
+      if (!status.ok() &&
+          status.error_code() != util::error::OUT_OF_RANGE) {
+        return status;
+      }
+      prefix_.append(buffer->get_mem_block(), buffer->size());
+      if (!status.ok()) prefix_complete_ = true;
+    }
+    if (end <= prefix_.size() || prefix_complete_) {
+      int64_t available =
+          std::max<int64_t>(0, std::min<int64_t>(end, prefix_.size()) -
+                                   position);
+      if (available > 0) {
+        std::memcpy(dest_buffer->get_mem_block(), prefix_.data() + position,
+                    available);
+      }
+      auto status = dest_buffer->set_size(available);
+      if (!status.ok()) return status;
+      if (available < count) {
+        return Status(util::error::OUT_OF_RANGE, "EOF");
+      }
+      return util::OkStatus();
+    }
+  }
+  // Beyond the buffered prefix.
+  return source_->PRead(position, count, dest_buffer);
+}
+
+}  // namespace streamingaead
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,152 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_STREAMINGAEAD_CONCURRENT_TRIALS_H_
+#define TINK_STREAMINGAEAD_CONCURRENT_TRIALS_H_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "tink/input_stream.h"
+#include "tink/random_access_stream.h"
+#include "tink/util/buffer.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace streamingaead {
+
+// Specifies how the decrypting streams try the candidate keys of a
+// ciphertext stream whose key they do not know yet.
+struct TrialOptions {
+  // Runs the given task, typically on a small thread pool owned by the
+  // caller. If set, the candidate keys are tried concurrently, and the first
+  // one that matches cancels the trials of the others, so that finding the
+  // key takes about as long as a single trial. The key of a KeyIdHint is
+  // still tried alone first, since it most likely matches. If null, the keys
+  // are tried one by one.
+  std::function<void(std::function<void()>)> schedule;
+};
+
+// Calls 'trial' with every index in [begin, end): one of them on the calling
+// thread and the others on 'schedule', which may be null to run all of them
+// on the calling thread. Returns once all calls returned.
+void RunTrials(int begin, int end,
+               const std::function<void(std::function<void()>)>& schedule,
+               const std::function<void(int)>& trial);
+
+// The ciphertext of an InputStream shared by concurrent trials, each reading
+// it from the beginning through its own stream. The ciphertext is read from
+// the source once and buffered. Once a trial is the match, the reads of the
+// other trials fail with CANCELLED, and the stream of the match reads past
+// the buffered ciphertext directly from the source, without buffering.
+//
+// The stream of the match must not read past the buffered ciphertext before
+// the other trials returned, as they may still access the buffer.
+class TrialInputSource {
+ public:
+  // 'source' must outlive this object and the streams it returns.
+  explicit TrialInputSource(crypto::tink::InputStream* source)
+      : source_(source) {}
+
+  // Returns a stream over the ciphertext for the trial 'trial', which must
+  // be non-negative. The stream must not outlive this object.
+  std::unique_ptr<crypto::tink::InputStream> NewTrialStream(int trial);
+
+  // Makes 'trial' the match, unless another trial is already, and returns
+  // whether it did.
+  bool SetMatch(int trial);
+
+  // Returns the trial which is the match, or -1 if there is none yet.
+  int match() const { return match_.load(std::memory_order_acquire); }
+
+ private:
+  class TrialStream;
+
+  // Returns the ciphertext of 'trial' from 'position' on, which is either
+  // within the buffered ciphertext or at its end.
+  crypto::tink::util::StatusOr<int> Read(int trial, int64_t position,
+                                         const void** data);
+
+  // Backs up the 'count' last bytes which 'trial' read until 'end'.
+  void BackUp(int trial, int64_t end, int count);
+
+  crypto::tink::InputStream* const source_;
+  std::atomic<int> match_{-1};
+  absl::Mutex mutex_;
+  // The buffered chunks of the ciphertext and their positions.
+  std::vector<std::string> chunks_ ABSL_GUARDED_BY(mutex_);
+  std::vector<int64_t> chunk_positions_ ABSL_GUARDED_BY(mutex_);
+  int64_t buffered_size_ ABSL_GUARDED_BY(mutex_) = 0;
+  // The status of the last read from source_, e.g. OUT_OF_RANGE at its end.
+  crypto::tink::util::Status status_ ABSL_GUARDED_BY(mutex_);
+};
+
+// The ciphertext of a RandomAccessStream shared by concurrent trials, each
+// reading it through its own stream. A prefix of up to 'max_buffered_size'
+// bytes of the ciphertext is read from the source once and buffered, which
+// usually covers the header and the first segment; the trials read past the
+// prefix directly from the source. Once a trial is the match, the reads of
+// the other trials fail with CANCELLED, the buffer is released, and the
+// stream of the match reads directly from the source without taking a lock.
+class TrialRandomAccessSource {
+ public:
+  static constexpr int64_t kDefaultMaxBufferedSize = 4 << 20;  // 4 MB
+
+  // 'source' must outlive this object and the streams it returns.
+  explicit TrialRandomAccessSource(
+      crypto::tink::RandomAccessStream* source,
+      int64_t max_buffered_size = kDefaultMaxBufferedSize)
+      : source_(source), max_buffered_size_(max_buffered_size) {}
+
+  // Returns a stream over the ciphertext for the trial 'trial', which must
+  // be non-negative. The stream must not outlive this object.
+  std::unique_ptr<crypto::tink::RandomAccessStream> NewTrialStream(int trial);
+
+  // Makes 'trial' the match, unless another trial is already, and returns
+  // whether it did.
+  bool SetMatch(int trial);
+
+  // Returns the trial which is the match, or -1 if there is none yet.
+  int match() const { return match_.load(std::memory_order_acquire); }
+
+ private:
+  class TrialStream;
+
+  crypto::tink::util::Status PRead(int trial, int64_t position, int count,
+                                   crypto::tink::util::Buffer* dest_buffer);
+
+  crypto::tink::RandomAccessStream* const source_;
+  const int64_t max_buffered_size_;
+  std::atomic<int> match_{-1};
+  absl::Mutex mutex_;
+  std::string prefix_ ABSL_GUARDED_BY(mutex_);
+  // True iff prefix_ holds the whole ciphertext.
+  bool prefix_complete_ ABSL_GUARDED_BY(mutex_) = false;
+};
+
+}  // namespace streamingaead
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_STREAMINGAEAD_CONCURRENT_TRIALS_H_
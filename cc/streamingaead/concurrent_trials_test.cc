@@ -0,0 +1,251 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/streamingaead/concurrent_trials.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "tink/input_stream.h"
+#include "tink/random_access_stream.h"
+#include "tink/subtle/random.h"
+#include "tink/subtle/test_util.h"
+#include "tink/util/buffer.h"
+#include "tink/util/file_random_access_stream.h"
+#include "tink/util/istream_input_stream.h"
+#include "tink/util/status.h"
+#include "tink/util/test_matchers.h"
+#include "tink/util/test_util.h"
+
+namespace crypto {
+namespace tink {
+namespace streamingaead {
+namespace {
+
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::testing::Eq;
+using ::testing::HasSubstr;
+
+std::unique_ptr<InputStream> GetInputStream(const std::string& contents,
+                                            int buffer_size) {
+  return absl::make_unique<util::IstreamInputStream>(
+      absl::make_unique<std::stringstream>(contents), buffer_size);
+}
+
+std::unique_ptr<RandomAccessStream> GetRandomAccessStream(
+    const std::string& contents) {
+  static int index = 1;
+  std::string filename = absl::StrCat("trial_data_file_", index, ".txt");
+  index++;
+  int input_fd = test::GetTestFileDescriptor(filename, contents);
+  return absl::make_unique<util::FileRandomAccessStream>(input_fd);
+}
+
+// Reads 'count' bytes at 'position' from 'stream'.
+util::StatusOr<std::string> ReadAt(RandomAccessStream* stream,
+                                   int64_t position, int count) {
+  auto buffer = std::move(util::Buffer::New(count).ValueOrDie());
+  auto status = stream->PRead(position, count, buffer.get());
+  if (!status.ok() && status.error_code() != util::error::OUT_OF_RANGE) {
+    return status;
+  }
+  std::string result(buffer->get_mem_block(), buffer->size());
+  if (!status.ok()) return status;
+  return result;
+}
+
+TEST(RunTrialsTest, RunsAllTrials) {
+  std::vector<std::thread> threads;
+  std::function<void(std::function<void()>)> schedule =
+      [&threads](std::function<void()> task) {
+        threads.emplace_back(std::move(task));
+      };
+  for (bool concurrently : {false, true}) {
+    SCOPED_TRACE(absl::StrCat("concurrently = ", concurrently));
+    std::vector<std::atomic<int>> calls(10);
+    for (auto& count : calls) count = 0;
+    RunTrials(2, 10, concurrently ? schedule : nullptr,
+              [&calls](int trial) { calls[trial]++; });
+    for (int i = 0; i < 10; i++) EXPECT_THAT(calls[i].load(), Eq(i >= 2));
+    RunTrials(5, 5, schedule, [](int trial) { ADD_FAILURE() << trial; });
+  }
+  EXPECT_THAT(threads.size(), Eq(7));
+  for (auto& thread : threads) thread.join();
+}
+
+TEST(TrialInputSourceTest, TrialsShareTheCiphertext) {
+  std::string contents = subtle::Random::GetRandomBytes(1000);
+  auto source_stream = GetInputStream(contents, 64);
+  TrialInputSource source(source_stream.get());
+  std::vector<std::unique_ptr<InputStream>> trials;
+  for (int i = 0; i < 3; i++) trials.push_back(source.NewTrialStream(i));
+  for (int i = 0; i < 3; i++) {
+    std::string read;
+    EXPECT_THAT(subtle::test::ReadFromStream(trials[i].get(), &read),
+                IsOk());
+    EXPECT_THAT(read, Eq(contents));
+    EXPECT_THAT(trials[i]->Position(), Eq(contents.size()));
+  }
+  EXPECT_THAT(source_stream->Position(), Eq(contents.size()));
+}
+
+TEST(TrialInputSourceTest, MatchCancelsTheOtherTrials) {
+  std::string contents = subtle::Random::GetRandomBytes(1000);
+  auto source_stream = GetInputStream(contents, 64);
+  TrialInputSource source(source_stream.get());
+  auto trial_0 = source.NewTrialStream(0);
+  auto trial_1 = source.NewTrialStream(1);
+  const void* data;
+  // Both trials read the first two chunks, and trial 1 backs up.
+  for (auto* trial : {trial_0.get(), trial_1.get()}) {
+    ASSERT_THAT(trial->Next(&data).status(), IsOk());
+    ASSERT_THAT(trial->Next(&data).status(), IsOk());
+  }
+  trial_1->BackUp(10);
+  EXPECT_THAT(trial_1->Position(), Eq(118));
+  EXPECT_THAT(source.match(), Eq(-1));
+  EXPECT_TRUE(source.SetMatch(1));
+  EXPECT_FALSE(source.SetMatch(0));
+  EXPECT_THAT(source.match(), Eq(1));
+  EXPECT_THAT(trial_0->Next(&data).status(),
+              StatusIs(util::error::CANCELLED, HasSubstr("matched")));
+
+  // The match reads the rest of the buffered ciphertext, and then reads
+  // past it directly from the source.
+  auto next_result = trial_1->Next(&data);
+  ASSERT_THAT(next_result.status(), IsOk());
+  ASSERT_THAT(next_result.ValueOrDie(), Eq(10));
+  EXPECT_THAT(std::string(static_cast<const char*>(data), 10),
+              Eq(contents.substr(118, 10)));
+  next_result = trial_1->Next(&data);
+  ASSERT_THAT(next_result.status(), IsOk());
+  ASSERT_THAT(next_result.ValueOrDie(), Eq(64));
+  trial_1->BackUp(4);
+  EXPECT_THAT(source_stream->Position(), Eq(188));
+  std::string rest;
+  EXPECT_THAT(subtle::test::ReadFromStream(trial_1.get(), &rest), IsOk());
+  EXPECT_THAT(rest, Eq(contents.substr(188)));
+}
+
+TEST(TrialInputSourceTest, ConcurrentTrials) {
+  std::string contents = subtle::Random::GetRandomBytes(100000);
+  auto source_stream = GetInputStream(contents, 1000);
+  TrialInputSource source(source_stream.get());
+  std::vector<std::thread> threads;
+  std::vector<std::string> reads(8);
+  std::vector<util::Status> statuses(8);
+  RunTrials(
+      0, 8,
+      [&threads](std::function<void()> task) {
+        threads.emplace_back(std::move(task));
+      },
+      [&](int trial) {
+        auto stream = source.NewTrialStream(trial);
+        const void* data;
+        // Trial 5 matches after reading 10000 bytes.
+        while (trial != 5 || stream->Position() < 10000) {
+          auto next_result = stream->Next(&data);
+          if (!next_result.ok()) {
+            statuses[trial] = next_result.status();
+            return;
+          }
+          reads[trial].append(static_cast<const char*>(data),
+                              next_result.ValueOrDie());
+        }
+        source.SetMatch(trial);
+      });
+  for (auto& thread : threads) thread.join();
+  for (int i = 0; i < 8; i++) {
+    SCOPED_TRACE(absl::StrCat("trial = ", i));
+    EXPECT_THAT(reads[i], Eq(contents.substr(0, reads[i].size())));
+    if (i == 5) {
+      EXPECT_THAT(reads[i].size(), Eq(10000));
+    } else {
+      // Other trials finish before the match or get cancelled.
+      EXPECT_THAT(statuses[i].error_code(),
+                  testing::AnyOf(Eq(util::error::CANCELLED),
+                                 Eq(util::error::OUT_OF_RANGE)));
+    }
+  }
+}
+
+TEST(TrialRandomAccessSourceTest, TrialsShareThePrefix) {
+  std::string contents = subtle::Random::GetRandomBytes(1000);
+  auto source_stream = GetRandomAccessStream(contents);
+  TrialRandomAccessSource source(source_stream.get(),
+                                 /*max_buffered_size=*/500);
+  auto trial_0 = source.NewTrialStream(0);
+  auto trial_1 = source.NewTrialStream(1);
+  EXPECT_THAT(trial_0->size().ValueOrDie(), Eq(1000));
+  for (auto* trial : {trial_0.get(), trial_1.get()}) {
+    EXPECT_THAT(ReadAt(trial, 0, 100).ValueOrDie(),
+                Eq(contents.substr(0, 100)));
+    EXPECT_THAT(ReadAt(trial, 50, 300).ValueOrDie(),
+                Eq(contents.substr(50, 300)));
+    // Beyond the prefix.
+    EXPECT_THAT(ReadAt(trial, 400, 200).ValueOrDie(),
+                Eq(contents.substr(400, 200)));
+    EXPECT_THAT(ReadAt(trial, 900, 200).ValueOrDie(),
+                Eq(contents.substr(900)));
+    EXPECT_THAT(ReadAt(trial, 1000, 200).status(),
+                StatusIs(util::error::OUT_OF_RANGE));
+  }
+  EXPECT_TRUE(source.SetMatch(0));
+  EXPECT_FALSE(source.SetMatch(1));
+  EXPECT_THAT(ReadAt(trial_1.get(), 0, 10).status(),
+              StatusIs(util::error::CANCELLED));
+  EXPECT_THAT(ReadAt(trial_0.get(), 10, 20).ValueOrDie(),
+              Eq(contents.substr(10, 20)));
+}
+
+TEST(TrialRandomAccessSourceTest, PrefixWithTheWholeCiphertext) {
+  std::string contents = subtle::Random::GetRandomBytes(100);
+  auto source_stream = GetRandomAccessStream(contents);
+  TrialRandomAccessSource source(source_stream.get());
+  auto trial = source.NewTrialStream(0);
+  auto buffer = std::move(util::Buffer::New(200).ValueOrDie());
+  // The source may return fewer bytes before reaching its end.
+  auto status = trial->PRead(50, 200, buffer.get());
+  EXPECT_TRUE(status.ok() ||
+              status.error_code() == util::error::OUT_OF_RANGE);
+  EXPECT_THAT(std::string(buffer->get_mem_block(), buffer->size()),
+              Eq(contents.substr(50)));
+  EXPECT_THAT(trial->PRead(150, 10, buffer.get()),
+              StatusIs(util::error::OUT_OF_RANGE));
+  EXPECT_THAT(buffer->size(), Eq(0));
+  // Now the prefix holds the whole ciphertext.
+  EXPECT_THAT(trial->PRead(50, 200, buffer.get()),
+              StatusIs(util::error::OUT_OF_RANGE, HasSubstr("EOF")));
+  EXPECT_THAT(std::string(buffer->get_mem_block(), buffer->size()),
+              Eq(contents.substr(50)));
+  EXPECT_THAT(ReadAt(trial.get(), 0, 100).ValueOrDie(), Eq(contents));
+}
+
+}  // namespace
+}  // namespace streamingaead
+}  // namespace tink
+}  // namespace crypto
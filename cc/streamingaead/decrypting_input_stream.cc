@@ -22,9 +22,12 @@
 
 #include "absl/memory/memory.h"
 #include "tink/input_stream.h"
+#include "tink/internal/tracing_span.h"
 #include "tink/primitive_set.h"
 #include "tink/streaming_aead.h"
 #include "tink/streamingaead/buffered_input_stream.h"
+#include "tink/streamingaead/concurrent_trials.h"
+#include "tink/streamingaead/key_id_hint.h"
 #include "tink/streamingaead/shared_input_stream.h"
 #include "tink/util/errors.h"
 #include "tink/util/status.h"
@@ -44,11 +47,30 @@ StatusOr<std::unique_ptr<InputStream>> DecryptingInputStream::New(
     std::shared_ptr<PrimitiveSet<StreamingAead>> primitives,
     std::unique_ptr<crypto::tink::InputStream> ciphertext_source,
     absl::string_view associated_data) {
+  return New(std::move(primitives), std::move(ciphertext_source),
+             associated_data, BufferedInputStream::PrefetchOptions());
+}
+
+// static
+StatusOr<std::unique_ptr<InputStream>> DecryptingInputStream::New(
+    std::shared_ptr<PrimitiveSet<StreamingAead>> primitives,
+    std::unique_ptr<crypto::tink::InputStream> ciphertext_source,
+    absl::string_view associated_data,
+    BufferedInputStream::PrefetchOptions prefetch_options,
+    std::shared_ptr<KeyIdHint> key_id_hint, TrialOptions trial_options) {
+  if (prefetch_options.depth < 0 ||
+      (prefetch_options.depth > 0 && !prefetch_options.schedule)) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "prefetch depth must be non-negative, and schedule must be "
+                  "set for a positive depth");
+  }
   std::unique_ptr<DecryptingInputStream> dec_stream(
       new DecryptingInputStream());
   dec_stream->primitives_ = primitives;
-  dec_stream->buffered_ct_source_ =
-      std::make_shared<BufferedInputStream>(std::move(ciphertext_source));
+  dec_stream->buffered_ct_source_ = std::make_shared<BufferedInputStream>(
+      std::move(ciphertext_source), std::move(prefetch_options));
+  dec_stream->key_id_hint_ = std::move(key_id_hint);
+  dec_stream->trial_options_ = std::move(trial_options);
   dec_stream->associated_data_ = std::string(associated_data);
   dec_stream->attempted_matching_ = false;
   dec_stream->matching_stream_ = nullptr;
@@ -57,7 +79,9 @@ StatusOr<std::unique_ptr<InputStream>> DecryptingInputStream::New(
 
 util::StatusOr<int> DecryptingInputStream::Next(const void** data) {
   if (matching_stream_ != nullptr) {
-    return matching_stream_->Next(data);
+    auto next_result = matching_stream_->Next(data);
+    if (next_result.ok()) lifetime_span_.AddBytes(next_result.ValueOrDie());
+    return next_result;
   }
   if (attempted_matching_) {
     return Status(util::error::INVALID_ARGUMENT,
@@ -65,12 +89,28 @@ util::StatusOr<int> DecryptingInputStream::Next(const void** data) {
   }
   // Matching has not been attempted yet, so try it now.
   attempted_matching_ = true;
-  auto raw_primitives_result = primitives_->get_raw_primitives();
-  if (!raw_primitives_result.ok()) {
-    return Status(util::error::INTERNAL, "No RAW primitives found");
+  internal::TracingSpan span("tink.streaming_aead.match_header");
+  auto primitives_result =
+      GetPrimitivesInTrialOrder(*primitives_, key_id_hint_.get());
+  if (!primitives_result.ok()) {
+    span.SetOk(false);
+    return primitives_result.status();
+  }
+  if (trial_options_.schedule != nullptr &&
+      primitives_result.ValueOrDie().size() > 1) {
+    auto next_result =
+        MatchConcurrently(primitives_result.ValueOrDie(), &span, data);
+    if (next_result.ok()) {
+      span.AddBytes(next_result.ValueOrDie());
+      lifetime_span_.AddBytes(next_result.ValueOrDie());
+    } else if (matching_stream_ == nullptr) {
+      span.SetOk(false);
+    }
+    return next_result;
   }
-  for (auto& primitive : *(raw_primitives_result.ValueOrDie())) {
+  for (const auto* primitive : primitives_result.ValueOrDie()) {
     StreamingAead& streaming_aead = primitive->get_primitive();
+    span.AddKeyTrial();
     auto shared_ct = absl::make_unique<SharedInputStream>(
         buffered_ct_source_.get());
     auto decrypting_stream_result = streaming_aead.NewDecryptingStream(
@@ -81,22 +121,96 @@ util::StatusOr<int> DecryptingInputStream::Next(const void** data) {
           next_result.ok()) {  // Found a match.
         buffered_ct_source_->DisableRewinding();
         matching_stream_ = std::move(decrypting_stream_result.ValueOrDie());
+        primitive->RecordDecryption();
+        if (key_id_hint_ != nullptr) {
+          key_id_hint_->Set(primitive->get_key_id());
+        }
+        if (next_result.ok()) {
+          span.AddBytes(next_result.ValueOrDie());
+          lifetime_span_.AddBytes(next_result.ValueOrDie());
+        }
         return next_result;
       }
     }
     // Not a match, rewind and try the next primitive.
     Status s = buffered_ct_source_->Rewind();
     if (!s.ok()) {
+      span.SetOk(false);
       return s;
     }
   }
+  span.SetOk(false);
   return Status(util::error::INVALID_ARGUMENT,
                 "Could not find a decrypter matching the ciphertext stream.");
 }
 
+util::StatusOr<int> DecryptingInputStream::MatchConcurrently(
+    const std::vector<const Entry*>& primitives, internal::TracingSpan* span,
+    const void** data) {
+  // The trials share the buffered ciphertext of trial_source_, so
+  // buffered_ct_source_ does not need to be rewound.
+  buffered_ct_source_->DisableRewinding();
+  trial_source_ =
+      std::make_shared<TrialInputSource>(buffered_ct_source_.get());
+  struct Trial {
+    bool started = false;
+    std::unique_ptr<InputStream> stream;
+    Status status;
+    int count = 0;
+    const void* data = nullptr;
+  };
+  std::vector<Trial> trials(primitives.size());
+  TrialInputSource* trial_source = trial_source_.get();
+  auto run_trial = [&](int i) {
+    // Skips the trial if another one matched before it started.
+    if (trial_source->match() >= 0) return;
+    Trial& trial = trials[i];
+    trial.started = true;
+    auto stream_result = primitives[i]->get_primitive().NewDecryptingStream(
+        trial_source->NewTrialStream(i), associated_data_);
+    if (!stream_result.ok()) {
+      trial.status = stream_result.status();
+      return;
+    }
+    trial.stream = std::move(stream_result.ValueOrDie());
+    auto next_result = trial.stream->Next(&trial.data);
+    trial.status = next_result.status();
+    if (next_result.ok()) trial.count = next_result.ValueOrDie();
+    if (next_result.ok() ||
+        next_result.status().error_code() == util::error::OUT_OF_RANGE) {
+      trial_source->SetMatch(i);
+    }
+  };
+  int begin = 0;
+  if (key_id_hint_ != nullptr && key_id_hint_->Get().has_value()) {
+    // The hinted key most likely matches, so it is tried alone first.
+    run_trial(0);
+    begin = 1;
+  }
+  RunTrials(begin, primitives.size(), trial_options_.schedule, run_trial);
+  for (const Trial& trial : trials) {
+    if (trial.started) span->AddKeyTrial();
+  }
+  int match = trial_source->match();
+  if (match < 0) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "Could not find a decrypter matching the ciphertext stream.");
+  }
+  matching_stream_ = std::move(trials[match].stream);
+  primitives[match]->RecordDecryption();
+  if (key_id_hint_ != nullptr) {
+    key_id_hint_->Set(primitives[match]->get_key_id());
+  }
+  if (!trials[match].status.ok()) return trials[match].status;
+  *data = trials[match].data;
+  return trials[match].count;
+}
+
 void DecryptingInputStream::BackUp(int count) {
   if (matching_stream_ != nullptr) {
+    int64_t position = matching_stream_->Position();
     matching_stream_->BackUp(count);
+    lifetime_span_.AddBytes(matching_stream_->Position() - position);
   }
 }
 
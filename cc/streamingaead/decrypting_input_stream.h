@@ -21,10 +21,13 @@
 #include <vector>
 
 #include "tink/input_stream.h"
+#include "tink/internal/tracing_span.h"
 #include "tink/primitive_set.h"
 #include "tink/streaming_aead.h"
 #include "tink/util/statusor.h"
 #include "tink/streamingaead/buffered_input_stream.h"
+#include "tink/streamingaead/concurrent_trials.h"
+#include "tink/streamingaead/key_id_hint.h"
 
 namespace crypto {
 namespace tink {
@@ -35,6 +38,9 @@ namespace streamingaead {
 // initial portion of the wrapped InputStream, to find a matching
 // primitive, i.e. the primitive that is able to decrypt the stream.
 // Once a match is found, all subsequent calls are forwarded to it.
+//
+// The stream is traced from its creation to its destruction, see
+// TracingClient, with the number of bytes read from it.
 class DecryptingInputStream : public crypto::tink::InputStream {
  public:
   // Constructs an InputStream that wraps 'input_stream', and will use
@@ -47,16 +53,51 @@ class DecryptingInputStream : public crypto::tink::InputStream {
       std::unique_ptr<crypto::tink::InputStream> ciphertext_source,
       absl::string_view associated_data);
 
+  // Like above, but once a matching primitive is found, prefetches the
+  // ciphertext from 'ciphertext_source' as specified by 'prefetch_options',
+  // so that reading the next segments overlaps with their decryption.
+  // 'prefetch_options.depth' must be non-negative, and
+  // 'prefetch_options.schedule' must be set if the depth is positive.
+  // If 'key_id_hint' is non-null, the primitive of the hinted key is tried
+  // first, and the hint is updated with the key of the matching primitive.
+  // The primitives are tried concurrently if 'trial_options' has a schedule,
+  // in which case the trials share a single read of the ciphertext.
+  static util::StatusOr<std::unique_ptr<InputStream>> New(
+      std::shared_ptr<
+          crypto::tink::PrimitiveSet<crypto::tink::StreamingAead>> primitives,
+      std::unique_ptr<crypto::tink::InputStream> ciphertext_source,
+      absl::string_view associated_data,
+      BufferedInputStream::PrefetchOptions prefetch_options,
+      std::shared_ptr<KeyIdHint> key_id_hint = nullptr,
+      TrialOptions trial_options = TrialOptions());
+
   ~DecryptingInputStream() override {}
   util::StatusOr<int> Next(const void** data) override;
   void BackUp(int count) override;
   int64_t Position() const override;
 
  private:
+  using Entry = crypto::tink::PrimitiveSet<
+      crypto::tink::StreamingAead>::Entry<crypto::tink::StreamingAead>;
+
   DecryptingInputStream() {}
+
+  // Tries 'primitives' concurrently, and if one matches, makes its stream
+  // the matching_stream_ and returns the result of its first Next() call.
+  util::StatusOr<int> MatchConcurrently(
+      const std::vector<const Entry*>& primitives,
+      internal::TracingSpan* span, const void** data);
+
+  // Declared first, so that the span ends after the other members are gone.
+  internal::TracingSpan lifetime_span_{"tink.streaming_aead.decrypting_stream"};
   std::shared_ptr<
       crypto::tink::PrimitiveSet<crypto::tink::StreamingAead>> primitives_;
   std::shared_ptr<BufferedInputStream> buffered_ct_source_;
+  std::shared_ptr<KeyIdHint> key_id_hint_;
+  TrialOptions trial_options_;
+  // The ciphertext read by the concurrent trials, which the matching stream
+  // keeps reading from. Null unless the primitives are tried concurrently.
+  std::shared_ptr<TrialInputSource> trial_source_;
   std::string associated_data_;
   std::unique_ptr<crypto::tink::InputStream> matching_stream_;
   bool attempted_matching_;
@@ -16,13 +16,16 @@
 
 #include "tink/streamingaead/decrypting_input_stream.h"
 
+#include <functional>
 #include <sstream>
+#include <thread>  // NOLINT(build/c++11)
 #include <vector>
 
 #include "gtest/gtest.h"
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "tink/input_stream.h"
 #include "tink/output_stream.h"
 #include "tink/primitive_set.h"
@@ -167,6 +170,184 @@ TEST(DecryptingInputStreamTest, BasicDecryption) {
   }
 }
 
+TEST(DecryptingInputStreamTest, DecryptionWithPrefetching) {
+  auto saead_set = GetTestStreamingAeadSet(
+      {{1234543, "streaming_aead0"}, {726329, "streaming_aead1"}});
+  std::string aad = "some_aad";
+  for (int depth : {0, 1, 3}) {
+    for (int pt_size : {0, 10, 10000}) {
+      SCOPED_TRACE(absl::StrCat("depth = ", depth, ", pt_size = ", pt_size));
+      std::string plaintext = subtle::Random::GetRandomBytes(pt_size);
+      for (const auto& p : *(saead_set->get_raw_primitives().ValueOrDie())) {
+        std::vector<std::thread> threads;
+        BufferedInputStream::PrefetchOptions options;
+        options.depth = depth;
+        options.schedule = [&threads](std::function<void()> task) {
+          threads.emplace_back(std::move(task));
+        };
+        auto dec_stream_result = DecryptingInputStream::New(
+            saead_set,
+            GetCiphertextSource(&(p->get_primitive()), plaintext, aad), aad,
+            options);
+        ASSERT_THAT(dec_stream_result.status(), IsOk());
+        std::string decrypted;
+        EXPECT_THAT(ReadFromStream(dec_stream_result.ValueOrDie().get(),
+                                   &decrypted),
+                    IsOk());
+        EXPECT_EQ(plaintext, decrypted);
+        dec_stream_result.ValueOrDie().reset();
+        for (auto& thread : threads) thread.join();
+      }
+    }
+  }
+}
+
+TEST(DecryptingInputStreamTest, DecryptionWithKeyIdHint) {
+  uint32_t key_id_0 = 1234543;
+  uint32_t key_id_1 = 726329;
+  auto saead_set = GetTestStreamingAeadSet(
+      {{key_id_0, "streaming_aead0"}, {key_id_1, "streaming_aead1"}});
+  std::string aad = "some_aad";
+  std::string plaintext = subtle::Random::GetRandomBytes(1000);
+  auto& primitives = *(saead_set->get_raw_primitives().ValueOrDie());
+  // A wrong hint, a correct hint, and no hint.
+  for (uint32_t hinted_key_id : {key_id_1, key_id_0, 0u}) {
+    SCOPED_TRACE(absl::StrCat("hinted_key_id = ", hinted_key_id));
+    auto hint = hinted_key_id == 0 ? std::make_shared<KeyIdHint>()
+                                   : std::make_shared<KeyIdHint>(hinted_key_id);
+    auto dec_stream_result = DecryptingInputStream::New(
+        saead_set,
+        GetCiphertextSource(&(primitives[0]->get_primitive()), plaintext, aad),
+        aad, BufferedInputStream::PrefetchOptions(), hint);
+    ASSERT_THAT(dec_stream_result.status(), IsOk());
+    std::string decrypted;
+    EXPECT_THAT(
+        ReadFromStream(dec_stream_result.ValueOrDie().get(), &decrypted),
+        IsOk());
+    EXPECT_EQ(plaintext, decrypted);
+    EXPECT_EQ(key_id_0, hint->Get().value());
+  }
+}
+
+TEST(DecryptingInputStreamTest, InvalidPrefetchOptions) {
+  auto saead_set = GetTestStreamingAeadSet({{1234543, "streaming_aead0"}});
+  BufferedInputStream::PrefetchOptions options;
+  options.depth = -1;
+  options.schedule = [](std::function<void()> task) { task(); };
+  EXPECT_THAT(
+      DecryptingInputStream::New(saead_set, GetInputStream("ct"), "aad",
+                                 options)
+          .status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+  options.depth = 2;
+  options.schedule = nullptr;
+  EXPECT_THAT(
+      DecryptingInputStream::New(saead_set, GetInputStream("ct"), "aad",
+                                 options)
+          .status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(DecryptingInputStreamTest, ConcurrentTrials) {
+  auto saead_set = GetTestStreamingAeadSet(
+      {{1234543, "streaming_aead0"}, {726329, "streaming_aead1"},
+       {7213743, "streaming_aead2"}, {9873423, "streaming_aead3"}});
+  std::string aad = "some_aad";
+  auto& primitives = *(saead_set->get_raw_primitives().ValueOrDie());
+  for (int pt_size : {0, 1, 10, 10000}) {
+    std::string plaintext = subtle::Random::GetRandomBytes(pt_size);
+    for (const auto& p : primitives) {
+      for (bool with_hint : {false, true}) {
+        SCOPED_TRACE(absl::StrCat("pt_size = ", pt_size,
+                                  ", key_id = ", p->get_key_id(),
+                                  ", with_hint = ", with_hint));
+        std::vector<std::thread> threads;
+        TrialOptions trial_options;
+        trial_options.schedule = [&threads](std::function<void()> task) {
+          threads.emplace_back(std::move(task));
+        };
+        // A hint of another key, which is tried alone first.
+        auto hint = with_hint
+                        ? std::make_shared<KeyIdHint>(
+                              primitives[0]->get_key_id() == p->get_key_id()
+                                  ? primitives[1]->get_key_id()
+                                  : primitives[0]->get_key_id())
+                        : std::make_shared<KeyIdHint>();
+        auto dec_stream_result = DecryptingInputStream::New(
+            saead_set,
+            GetCiphertextSource(&(p->get_primitive()), plaintext, aad), aad,
+            BufferedInputStream::PrefetchOptions(), hint, trial_options);
+        ASSERT_THAT(dec_stream_result.status(), IsOk());
+        std::string decrypted;
+        EXPECT_THAT(ReadFromStream(dec_stream_result.ValueOrDie().get(),
+                                   &decrypted),
+                    IsOk());
+        EXPECT_EQ(plaintext, decrypted);
+        EXPECT_EQ(p->get_key_id(), hint->Get().value());
+        for (auto& thread : threads) thread.join();
+      }
+    }
+  }
+}
+
+TEST(DecryptingInputStreamTest, ConcurrentTrialsWithPrefetching) {
+  auto saead_set = GetTestStreamingAeadSet(
+      {{1234543, "streaming_aead0"}, {726329, "streaming_aead1"},
+       {7213743, "streaming_aead2"}});
+  std::string aad = "some_aad";
+  std::string plaintext = subtle::Random::GetRandomBytes(10000);
+  for (const auto& p : *(saead_set->get_raw_primitives().ValueOrDie())) {
+    SCOPED_TRACE(absl::StrCat("key_id = ", p->get_key_id()));
+    // Trials may start prefetching concurrently.
+    absl::Mutex threads_mutex;
+    std::vector<std::thread> threads;
+    auto schedule = [&threads_mutex, &threads](std::function<void()> task) {
+      absl::MutexLock lock(&threads_mutex);
+      threads.emplace_back(std::move(task));
+    };
+    BufferedInputStream::PrefetchOptions prefetch_options;
+    prefetch_options.depth = 2;
+    prefetch_options.schedule = schedule;
+    TrialOptions trial_options;
+    trial_options.schedule = schedule;
+    auto dec_stream_result = DecryptingInputStream::New(
+        saead_set, GetCiphertextSource(&(p->get_primitive()), plaintext, aad),
+        aad, prefetch_options, /*key_id_hint=*/nullptr, trial_options);
+    ASSERT_THAT(dec_stream_result.status(), IsOk());
+    std::string decrypted;
+    EXPECT_THAT(
+        ReadFromStream(dec_stream_result.ValueOrDie().get(), &decrypted),
+        IsOk());
+    EXPECT_EQ(plaintext, decrypted);
+    dec_stream_result.ValueOrDie().reset();
+    for (auto& thread : threads) thread.join();
+  }
+}
+
+TEST(DecryptingInputStreamTest, ConcurrentTrialsWithoutMatch) {
+  auto saead_set = GetTestStreamingAeadSet(
+      {{1234543, "streaming_aead0"}, {726329, "streaming_aead1"},
+       {7213743, "streaming_aead2"}});
+  for (int ct_size : {0, 10, 1000}) {
+    SCOPED_TRACE(absl::StrCat("ct_size = ", ct_size));
+    std::vector<std::thread> threads;
+    TrialOptions trial_options;
+    trial_options.schedule = [&threads](std::function<void()> task) {
+      threads.emplace_back(std::move(task));
+    };
+    auto dec_stream_result = DecryptingInputStream::New(
+        saead_set, GetInputStream(subtle::Random::GetRandomBytes(ct_size)),
+        "aad", BufferedInputStream::PrefetchOptions(),
+        /*key_id_hint=*/nullptr, trial_options);
+    ASSERT_THAT(dec_stream_result.status(), IsOk());
+    std::string decrypted;
+    EXPECT_THAT(
+        ReadFromStream(dec_stream_result.ValueOrDie().get(), &decrypted),
+        StatusIs(util::error::INVALID_ARGUMENT));
+    for (auto& thread : threads) thread.join();
+  }
+}
+
 TEST(DecryptingInputStreamTest, WrongAssociatedData) {
   uint32_t key_id_0 = 1234543;
   uint32_t key_id_1 = 726329;
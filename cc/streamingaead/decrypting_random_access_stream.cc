@@ -16,11 +16,16 @@
 
 #include "tink/streamingaead/decrypting_random_access_stream.h"
 
+#include <vector>
+
 #include "absl/memory/memory.h"
 #include "absl/synchronization/mutex.h"
+#include "tink/internal/tracing_span.h"
 #include "tink/random_access_stream.h"
 #include "tink/primitive_set.h"
 #include "tink/streaming_aead.h"
+#include "tink/streamingaead/concurrent_trials.h"
+#include "tink/streamingaead/key_id_hint.h"
 #include "tink/streamingaead/shared_random_access_stream.h"
 #include "tink/util/buffer.h"
 #include "tink/util/errors.h"
@@ -41,6 +46,16 @@ StatusOr<std::unique_ptr<RandomAccessStream>> DecryptingRandomAccessStream::New(
     std::shared_ptr<PrimitiveSet<StreamingAead>> primitives,
     std::unique_ptr<crypto::tink::RandomAccessStream> ciphertext_source,
     absl::string_view associated_data) {
+  return New(std::move(primitives), std::move(ciphertext_source),
+             associated_data, /*key_id_hint=*/nullptr);
+}
+
+// static
+StatusOr<std::unique_ptr<RandomAccessStream>> DecryptingRandomAccessStream::New(
+    std::shared_ptr<PrimitiveSet<StreamingAead>> primitives,
+    std::unique_ptr<crypto::tink::RandomAccessStream> ciphertext_source,
+    absl::string_view associated_data,
+    std::shared_ptr<KeyIdHint> key_id_hint, TrialOptions trial_options) {
   if (primitives == nullptr) {
     return Status(util::error::INVALID_ARGUMENT,
                   "primitives must be non-null.");
@@ -50,7 +65,8 @@ StatusOr<std::unique_ptr<RandomAccessStream>> DecryptingRandomAccessStream::New(
                   "ciphertext_source must be non-null.");
   }
   return {absl::WrapUnique(new DecryptingRandomAccessStream(
-      primitives, std::move(ciphertext_source), associated_data))};
+      primitives, std::move(ciphertext_source), associated_data,
+      std::move(key_id_hint), std::move(trial_options)))};
 }
 
 util::Status DecryptingRandomAccessStream::PRead(
@@ -72,62 +88,164 @@ util::Status DecryptingRandomAccessStream::PRead(
       return util::Status(util::error::INVALID_ARGUMENT,
                           "position cannot be negative");
     }
-    absl::ReaderMutexLock lock(&matching_mutex_);
-    if (matching_stream_ != nullptr) {
-      return matching_stream_->PRead(position, count, dest_buffer);
+    RandomAccessStream* matched_stream =
+        matched_stream_.load(std::memory_order_acquire);
+    if (matched_stream != nullptr) {
+      return matched_stream->PRead(position, count, dest_buffer);
     }
-    if (attempted_matching_) {
+    if (matching_failed_.load(std::memory_order_acquire)) {
       return Status(util::error::INVALID_ARGUMENT,
                     "Did not find a decrypter matching the ciphertext stream.");
     }
   }
   // Matching has not been attempted yet, so try it now.
+  return MatchWith([position, count, dest_buffer](RandomAccessStream* stream) {
+    return stream->PRead(position, count, dest_buffer);
+  });
+}
+
+util::Status DecryptingRandomAccessStream::MatchWith(
+    const std::function<util::Status(RandomAccessStream*)>& use_stream) {
   absl::MutexLock lock(&matching_mutex_);
 
   // Re-check that matching hasn't been attempted in the meantime.
   if (matching_stream_ != nullptr) {
-    return matching_stream_->PRead(position, count, dest_buffer);
+    return use_stream(matching_stream_.get());
   }
   if (attempted_matching_) {
     return Status(util::error::INVALID_ARGUMENT,
                   "Did not find a decrypter matching the ciphertext stream.");
   }
   attempted_matching_ = true;
-  auto raw_primitives_result = primitives_->get_raw_primitives();
-  if (!raw_primitives_result.ok()) {
-    return Status(util::error::INTERNAL, "No RAW primitives found");
+  internal::TracingSpan span("tink.streaming_aead.match_header");
+  auto primitives_result =
+      GetPrimitivesInTrialOrder(*primitives_, key_id_hint_.get());
+  if (!primitives_result.ok()) {
+    matching_failed_.store(true, std::memory_order_release);
+    span.SetOk(false);
+    return primitives_result.status();
+  }
+  if (trial_options_.schedule != nullptr &&
+      primitives_result.ValueOrDie().size() > 1) {
+    auto status = MatchConcurrently(primitives_result.ValueOrDie(), &span);
+    if (!status.ok()) {
+      matching_failed_.store(true, std::memory_order_release);
+      span.SetOk(false);
+      return status;
+    }
+    return use_stream(matching_stream_.get());
   }
-  for (auto& primitive : *(raw_primitives_result.ValueOrDie())) {
+  for (const auto* primitive : primitives_result.ValueOrDie()) {
     StreamingAead& streaming_aead = primitive->get_primitive();
+    span.AddKeyTrial();
     auto shared_ct = absl::make_unique<SharedRandomAccessStream>(
         ciphertext_source_.get());
     auto decrypting_stream_result =
         streaming_aead.NewDecryptingRandomAccessStream(
             std::move(shared_ct), associated_data_);
     if (decrypting_stream_result.ok()) {
-      auto status = decrypting_stream_result.ValueOrDie()->PRead(
-          position, count, dest_buffer);
+      auto status = use_stream(decrypting_stream_result.ValueOrDie().get());
       if (status.ok() || status.error_code() == util::error::OUT_OF_RANGE) {
         // Found a match.
         matching_stream_ = std::move(decrypting_stream_result.ValueOrDie());
+        matched_stream_.store(matching_stream_.get(),
+                              std::memory_order_release);
+        primitive->RecordDecryption();
+        if (key_id_hint_ != nullptr) {
+          key_id_hint_->Set(primitive->get_key_id());
+        }
         return status;
       }
     }
     // Not a match, try the next primitive.
   }
+  matching_failed_.store(true, std::memory_order_release);
+  span.SetOk(false);
   return Status(util::error::INVALID_ARGUMENT,
                 "Could not find a decrypter matching the ciphertext stream.");
 }
 
+util::Status DecryptingRandomAccessStream::MatchConcurrently(
+    const std::vector<const Entry*>& primitives,
+    internal::TracingSpan* span) {
+  trial_source_ =
+      absl::make_unique<TrialRandomAccessSource>(ciphertext_source_.get());
+  TrialRandomAccessSource* trial_source = trial_source_.get();
+  std::vector<std::unique_ptr<RandomAccessStream>> streams(primitives.size());
+  // Not a vector<bool>, whose elements the trials could not set concurrently.
+  std::vector<char> started(primitives.size(), false);
+  auto run_trial = [&](int i) {
+    // Skips the trial if another one matched before it started.
+    if (trial_source->match() >= 0) return;
+    started[i] = true;
+    auto stream_result =
+        primitives[i]->get_primitive().NewDecryptingRandomAccessStream(
+            trial_source->NewTrialStream(i), associated_data_);
+    if (!stream_result.ok()) return;
+    streams[i] = std::move(stream_result.ValueOrDie());
+    // Decrypting the first byte authenticates the header and the first
+    // segment, or finds that the plaintext is empty.
+    auto buffer = std::move(util::Buffer::New(1).ValueOrDie());
+    auto status = streams[i]->PRead(0, 1, buffer.get());
+    if (status.ok() || status.error_code() == util::error::OUT_OF_RANGE) {
+      trial_source->SetMatch(i);
+    }
+  };
+  int begin = 0;
+  if (key_id_hint_ != nullptr && key_id_hint_->Get().has_value()) {
+    // The hinted key most likely matches, so it is tried alone first.
+    run_trial(0);
+    begin = 1;
+  }
+  RunTrials(begin, primitives.size(), trial_options_.schedule, run_trial);
+  for (char trial_started : started) {
+    if (trial_started) span->AddKeyTrial();
+  }
+  int match = trial_source->match();
+  if (match < 0) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "Could not find a decrypter matching the ciphertext stream.");
+  }
+  matching_stream_ = std::move(streams[match]);
+  matched_stream_.store(matching_stream_.get(), std::memory_order_release);
+  primitives[match]->RecordDecryption();
+  if (key_id_hint_ != nullptr) {
+    key_id_hint_->Set(primitives[match]->get_key_id());
+  }
+  return util::OkStatus();
+}
+
 StatusOr<int64_t> DecryptingRandomAccessStream::size() {
-  absl::ReaderMutexLock lock(&matching_mutex_);
-  if (matching_stream_ != nullptr) {
-    return matching_stream_->size();
+  RandomAccessStream* matched_stream =
+      matched_stream_.load(std::memory_order_acquire);
+  if (matched_stream != nullptr) {
+    return matched_stream->size();
   }
   // TODO(b/139722894): attempt matching here?
   return Status(util::error::UNAVAILABLE, "no matching found yet");
 }
 
+StatusOr<int64_t> DecryptingRandomAccessStream::VerifiedSize() {
+  RandomAccessStream* matched_stream =
+      matched_stream_.load(std::memory_order_acquire);
+  if (matched_stream != nullptr) {
+    return matched_stream->VerifiedSize();
+  }
+  if (matching_failed_.load(std::memory_order_acquire)) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "Did not find a decrypter matching the ciphertext stream.");
+  }
+  int64_t size = 0;
+  auto status = MatchWith([&size](RandomAccessStream* stream) -> Status {
+    auto size_result = stream->VerifiedSize();
+    if (!size_result.ok()) return size_result.status();
+    size = size_result.ValueOrDie();
+    return Status::OK;
+  });
+  if (!status.ok()) return status;
+  return size;
+}
+
 }  // namespace streamingaead
 }  // namespace tink
 }  // namespace crypto
@@ -17,13 +17,18 @@
 #ifndef TINK_STREAMINGAEAD_DECRYPTING_RANDOM_ACCESS_STREAM_H_
 #define TINK_STREAMINGAEAD_DECRYPTING_RANDOM_ACCESS_STREAM_H_
 
+#include <atomic>
+#include <functional>
 #include <memory>
 #include <vector>
 
 #include "absl/synchronization/mutex.h"
+#include "tink/internal/tracing_span.h"
 #include "tink/random_access_stream.h"
 #include "tink/primitive_set.h"
 #include "tink/streaming_aead.h"
+#include "tink/streamingaead/concurrent_trials.h"
+#include "tink/streamingaead/key_id_hint.h"
 #include "tink/util/buffer.h"
 #include "tink/util/statusor.h"
 
@@ -32,10 +37,12 @@ namespace tink {
 namespace streamingaead {
 
 // A wrapper around a RandomAccessStream that holds a reference to a
-// set of StreamingAead-primitives and upon first PRead()-call attempts
-// to read the stream via the provided primitives to find a matching one,
+// set of StreamingAead-primitives and upon first PRead()- or
+// VerifiedSize()-call attempts to read the stream via the provided
+// primitives to find a matching one,
 // i.e. the primitive that is able to decrypt the stream.
-// Once a match is found, all subsequent calls are forwarded to it.
+// Once a match is found, all subsequent calls are forwarded to it without
+// taking a lock.
 class DecryptingRandomAccessStream : public crypto::tink::RandomAccessStream {
  public:
   // Constructs an RandomAccessStream that wraps 'random_access_stream',
@@ -48,30 +55,85 @@ class DecryptingRandomAccessStream : public crypto::tink::RandomAccessStream {
       std::unique_ptr<crypto::tink::RandomAccessStream> ciphertext_source,
       absl::string_view associated_data);
 
+  // Like above, but if 'key_id_hint' is non-null, the primitive of the
+  // hinted key is tried first, and the hint is updated with the key of
+  // the matching primitive. The primitives are tried concurrently if
+  // 'trial_options' has a schedule: each trial then reads the first byte of
+  // the plaintext, which authenticates the header and the first segment,
+  // from a single buffered read of their ciphertext, and the first call is
+  // forwarded to the matching stream once all trials returned.
+  static util::StatusOr<std::unique_ptr<RandomAccessStream>> New(
+      std::shared_ptr<
+          crypto::tink::PrimitiveSet<crypto::tink::StreamingAead>> primitives,
+      std::unique_ptr<crypto::tink::RandomAccessStream> ciphertext_source,
+      absl::string_view associated_data,
+      std::shared_ptr<KeyIdHint> key_id_hint,
+      TrialOptions trial_options = TrialOptions());
+
   ~DecryptingRandomAccessStream() override {}
   crypto::tink::util::Status PRead(int64_t position, int count,
       crypto::tink::util::Buffer* dest_buffer) override;
   crypto::tink::util::StatusOr<int64_t> size() override;
+  // Unlike size(), attempts matching if no match was found yet, in which case
+  // the matching and the verification share a single read of the last
+  // segment.
+  crypto::tink::util::StatusOr<int64_t> VerifiedSize() override;
 
  private:
   DecryptingRandomAccessStream(
       std::shared_ptr<
           crypto::tink::PrimitiveSet<crypto::tink::StreamingAead>> primitives,
       std::unique_ptr<crypto::tink::RandomAccessStream> ciphertext_source,
-      absl::string_view associated_data)
+      absl::string_view associated_data,
+      std::shared_ptr<KeyIdHint> key_id_hint, TrialOptions trial_options)
       : primitives_(primitives),
         ciphertext_source_(std::move(ciphertext_source)),
         associated_data_(associated_data),
+        key_id_hint_(std::move(key_id_hint)),
+        trial_options_(std::move(trial_options)),
         attempted_matching_(false),
-        matching_stream_(nullptr) {}
+        matching_stream_(nullptr),
+        matched_stream_(nullptr),
+        matching_failed_(false) {}
+  // Finds the primitive matching the ciphertext, unless matching has been
+  // attempted already, by calling 'use_stream' on the decrypting stream of
+  // each primitive until one returns OK or OUT_OF_RANGE, and returns the status
+  // of that call. If matching succeeded already, 'use_stream' is called on the
+  // matched stream.
+  crypto::tink::util::Status MatchWith(
+      const std::function<crypto::tink::util::Status(
+          crypto::tink::RandomAccessStream*)>& use_stream);
+
+  using Entry = crypto::tink::PrimitiveSet<
+      crypto::tink::StreamingAead>::Entry<crypto::tink::StreamingAead>;
+
+  // Tries 'primitives' concurrently, and if one matches, makes its stream
+  // the matching_stream_ and returns OK.
+  crypto::tink::util::Status MatchConcurrently(
+      const std::vector<const Entry*>& primitives,
+      crypto::tink::internal::TracingSpan* span)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(matching_mutex_);
+
   std::shared_ptr<
       crypto::tink::PrimitiveSet<crypto::tink::StreamingAead>> primitives_;
   std::unique_ptr<crypto::tink::RandomAccessStream> ciphertext_source_;
   std::string associated_data_;
+  const std::shared_ptr<KeyIdHint> key_id_hint_;  // may be null
+  const TrialOptions trial_options_;
   mutable absl::Mutex matching_mutex_;
   bool attempted_matching_ ABSL_GUARDED_BY(matching_mutex_);
+  // The ciphertext read by the concurrent trials, which the matching stream
+  // keeps reading from. Null unless the primitives are tried concurrently.
+  std::unique_ptr<TrialRandomAccessSource> trial_source_
+      ABSL_GUARDED_BY(matching_mutex_);
   std::unique_ptr<crypto::tink::RandomAccessStream> matching_stream_
       ABSL_GUARDED_BY(matching_mutex_);
+  // Published with release semantics once matching is done, so that PRead()
+  // and size() can read them without holding 'matching_mutex_'.
+  // 'matched_stream_' points to *matching_stream_ if a match was found, and
+  // 'matching_failed_' is set if none was.
+  std::atomic<crypto::tink::RandomAccessStream*> matched_stream_;
+  std::atomic<bool> matching_failed_;
 };
 
 }  // namespace streamingaead
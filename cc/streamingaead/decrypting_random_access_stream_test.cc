@@ -16,7 +16,9 @@
 
 #include "tink/streamingaead/decrypting_random_access_stream.h"
 
+#include <functional>
 #include <sstream>
+#include <thread>  // NOLINT(build/c++11)
 #include <vector>
 
 #include "gtest/gtest.h"
@@ -324,6 +326,104 @@ TEST(DecryptingRandomAccessStreamTest, WrongAssociatedData) {
   }
 }
 
+TEST(DecryptingRandomAccessStreamTest, VerifiedSize) {
+  uint32_t key_id_0 = 1234543;
+  uint32_t key_id_1 = 726329;
+  std::string saead_name_0 = "streaming_aead0";
+  std::string saead_name_1 = "streaming_aead1";
+
+  auto saead_set = GetTestStreamingAeadSet(
+      {{key_id_0, saead_name_0}, {key_id_1, saead_name_1}});
+
+  for (int pt_size : {0, 1, 100, 10000}) {
+    SCOPED_TRACE(absl::StrCat("pt_size = ", pt_size));
+    std::string plaintext = subtle::Random::GetRandomBytes(pt_size);
+    std::string aad = "some aad";
+    for (const auto& p : *(saead_set->get_raw_primitives().ValueOrDie())) {
+      auto ct = GetCiphertextSource(&(p->get_primitive()), plaintext, aad);
+      auto dec_stream_result =
+          DecryptingRandomAccessStream::New(saead_set, std::move(ct), aad);
+      ASSERT_THAT(dec_stream_result.status(), IsOk());
+      auto dec_stream = std::move(dec_stream_result.ValueOrDie());
+      // VerifiedSize() finds the matching primitive.
+      auto size_result = dec_stream->VerifiedSize();
+      ASSERT_THAT(size_result.status(), IsOk());
+      EXPECT_EQ(pt_size, size_result.ValueOrDie());
+      EXPECT_EQ(pt_size, dec_stream->size().ValueOrDie());
+      std::string decrypted;
+      EXPECT_THAT(ReadAll(dec_stream.get(), &decrypted),
+                  StatusIs(util::error::OUT_OF_RANGE, HasSubstr("EOF")));
+      EXPECT_EQ(plaintext, decrypted);
+    }
+    // Without a match, VerifiedSize() fails, also when called again.
+    auto dec_stream_result = DecryptingRandomAccessStream::New(
+        saead_set,
+        GetCiphertextSource(&(saead_set->get_primary()->get_primitive()),
+                            plaintext, aad),
+        "wrong aad");
+    ASSERT_THAT(dec_stream_result.status(), IsOk());
+    auto dec_stream = std::move(dec_stream_result.ValueOrDie());
+    EXPECT_THAT(dec_stream->VerifiedSize().status(),
+                StatusIs(util::error::INVALID_ARGUMENT));
+    EXPECT_THAT(dec_stream->VerifiedSize().status(),
+                StatusIs(util::error::INVALID_ARGUMENT));
+  }
+}
+
+TEST(DecryptingRandomAccessStreamTest, ConcurrentTrials) {
+  auto saead_set = GetTestStreamingAeadSet(
+      {{1234543, "streaming_aead0"}, {726329, "streaming_aead1"},
+       {7213743, "streaming_aead2"}, {9873423, "streaming_aead3"}});
+  std::string aad = "some aad";
+  for (int pt_size : {0, 1, 100, 10000}) {
+    std::string plaintext = subtle::Random::GetRandomBytes(pt_size);
+    for (const auto& p : *(saead_set->get_raw_primitives().ValueOrDie())) {
+      for (bool with_hint : {false, true}) {
+        SCOPED_TRACE(absl::StrCat("pt_size = ", pt_size,
+                                  ", key_id = ", p->get_key_id(),
+                                  ", with_hint = ", with_hint));
+        std::vector<std::thread> threads;
+        TrialOptions trial_options;
+        trial_options.schedule = [&threads](std::function<void()> task) {
+          threads.emplace_back(std::move(task));
+        };
+        auto hint = with_hint ? std::make_shared<KeyIdHint>(p->get_key_id())
+                              : std::make_shared<KeyIdHint>();
+        auto dec_stream_result = DecryptingRandomAccessStream::New(
+            saead_set,
+            GetCiphertextSource(&(p->get_primitive()), plaintext, aad), aad,
+            hint, trial_options);
+        ASSERT_THAT(dec_stream_result.status(), IsOk());
+        auto dec_stream = std::move(dec_stream_result.ValueOrDie());
+        auto size_result = dec_stream->VerifiedSize();
+        ASSERT_THAT(size_result.status(), IsOk());
+        EXPECT_EQ(pt_size, size_result.ValueOrDie());
+        std::string decrypted;
+        EXPECT_THAT(ReadAll(dec_stream.get(), &decrypted),
+                    StatusIs(util::error::OUT_OF_RANGE, HasSubstr("EOF")));
+        EXPECT_EQ(plaintext, decrypted);
+        EXPECT_EQ(p->get_key_id(), hint->Get().value());
+        for (auto& thread : threads) thread.join();
+      }
+    }
+    // Without a match, all trials fail.
+    std::vector<std::thread> threads;
+    TrialOptions trial_options;
+    trial_options.schedule = [&threads](std::function<void()> task) {
+      threads.emplace_back(std::move(task));
+    };
+    auto dec_stream_result = DecryptingRandomAccessStream::New(
+        saead_set,
+        GetRandomAccessStream(subtle::Random::GetRandomBytes(pt_size)), aad,
+        /*key_id_hint=*/nullptr, trial_options);
+    ASSERT_THAT(dec_stream_result.status(), IsOk());
+    std::string decrypted;
+    EXPECT_THAT(ReadAll(dec_stream_result.ValueOrDie().get(), &decrypted),
+                StatusIs(util::error::INVALID_ARGUMENT));
+    for (auto& thread : threads) thread.join();
+  }
+}
+
 TEST(DecryptingRandomAccessStreamTest, WrongCiphertext) {
   uint32_t key_id_0 = 1234543;
   uint32_t key_id_1 = 726329;
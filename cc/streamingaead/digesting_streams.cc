@@ -0,0 +1,183 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/streamingaead/digesting_streams.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "openssl/digest.h"
+#include "openssl/evp.h"
+#include "tink/subtle/subtle_util_boringssl.h"
+#include "tink/util/errors.h"
+
+namespace crypto {
+namespace tink {
+namespace streamingaead {
+
+using crypto::tink::subtle::StatefulMac;
+using crypto::tink::util::Status;
+using crypto::tink::util::StatusOr;
+
+namespace {
+
+// A StatefulMac computing an unkeyed hash.
+class StatefulHash : public StatefulMac {
+ public:
+  explicit StatefulHash(bssl::UniquePtr<EVP_MD_CTX> md_ctx)
+      : md_ctx_(std::move(md_ctx)) {}
+
+  Status Update(absl::string_view data) override {
+    if (1 != EVP_DigestUpdate(md_ctx_.get(), data.data(), data.size())) {
+      return Status(util::error::INTERNAL, "Could not compute digest.");
+    }
+    return util::OkStatus();
+  }
+
+  StatusOr<std::string> Finalize() override {
+    uint8_t digest[EVP_MAX_MD_SIZE];
+    unsigned int digest_size;
+    if (1 != EVP_DigestFinal_ex(md_ctx_.get(), digest, &digest_size)) {
+      return Status(util::error::INTERNAL, "Could not compute digest.");
+    }
+    return std::string(reinterpret_cast<char*>(digest), digest_size);
+  }
+
+ private:
+  const bssl::UniquePtr<EVP_MD_CTX> md_ctx_;
+};
+
+Status DigestNotReadyError() {
+  return Status(util::error::FAILED_PRECONDITION,
+                "The digest is available once the stream reached its end.");
+}
+
+}  // namespace
+
+StatusOr<std::unique_ptr<StatefulMac>> NewStatefulHash(
+    subtle::HashType hash_type) {
+  auto hash_result = subtle::SubtleUtilBoringSSL::EvpHash(hash_type);
+  if (!hash_result.ok()) return hash_result.status();
+  bssl::UniquePtr<EVP_MD_CTX> md_ctx(EVP_MD_CTX_new());
+  if (md_ctx == nullptr ||
+      1 != EVP_DigestInit_ex(md_ctx.get(), hash_result.ValueOrDie(),
+                             nullptr)) {
+    return Status(util::error::INTERNAL, "Could not initialize digest.");
+  }
+  return {absl::make_unique<StatefulHash>(std::move(md_ctx))};
+}
+
+DigestingOutputStream::DigestingOutputStream(
+    std::unique_ptr<crypto::tink::OutputStream> output_stream,
+    std::unique_ptr<StatefulMac> digest)
+    : output_stream_(std::move(output_stream)),
+      digest_(std::move(digest)),
+      digest_result_(DigestNotReadyError()) {}
+
+Status DigestingOutputStream::Absorb() {
+  if (pending_size_ > 0) {
+    status_ = digest_->Update(absl::string_view(pending_data_, pending_size_));
+  }
+  pending_data_ = nullptr;
+  pending_size_ = 0;
+  return status_;
+}
+
+StatusOr<int> DigestingOutputStream::Next(void** data) {
+  if (!status_.ok()) return status_;
+  // The wrapped stream may process the last buffer in this call, so it is
+  // digested first.
+  Status status = Absorb();
+  if (!status.ok()) return status;
+  auto next_result = output_stream_->Next(data);
+  if (!next_result.ok()) {
+    status_ = next_result.status();
+    return status_;
+  }
+  pending_data_ = static_cast<char*>(*data);
+  pending_size_ = next_result.ValueOrDie();
+  return next_result;
+}
+
+void DigestingOutputStream::BackUp(int count) {
+  output_stream_->BackUp(count);
+  pending_size_ -= std::min(std::max(0, count), pending_size_);
+}
+
+Status DigestingOutputStream::Close() {
+  if (!status_.ok()) return status_;
+  Status status = Absorb();
+  if (!status.ok()) return status;
+  status_ = output_stream_->Close();
+  if (!status_.ok()) return status_;
+  digest_result_ = digest_->Finalize();
+  status_ = Status(util::error::FAILED_PRECONDITION, "Stream closed");
+  return digest_result_.status();
+}
+
+int64_t DigestingOutputStream::Position() const {
+  return output_stream_->Position();
+}
+
+DigestingInputStream::DigestingInputStream(
+    std::unique_ptr<crypto::tink::InputStream> input_stream,
+    std::unique_ptr<StatefulMac> digest)
+    : input_stream_(std::move(input_stream)),
+      digest_(std::move(digest)),
+      digest_result_(DigestNotReadyError()) {}
+
+Status DigestingInputStream::Absorb() {
+  if (pending_size_ > 0) {
+    status_ = digest_->Update(absl::string_view(pending_data_, pending_size_));
+  }
+  pending_data_ = nullptr;
+  pending_size_ = 0;
+  return status_;
+}
+
+StatusOr<int> DigestingInputStream::Next(const void** data) {
+  if (!status_.ok()) return status_;
+  // Digests the last buffer only now, since its end might have been backed
+  // up and be returned again below.
+  Status status = Absorb();
+  if (!status.ok()) return status;
+  auto next_result = input_stream_->Next(data);
+  if (!next_result.ok()) {
+    status_ = next_result.status();
+    if (status_.error_code() == util::error::OUT_OF_RANGE) {
+      digest_result_ = digest_->Finalize();
+      if (!digest_result_.ok()) status_ = digest_result_.status();
+    }
+    return status_;
+  }
+  pending_data_ = static_cast<const char*>(*data);
+  pending_size_ = next_result.ValueOrDie();
+  return next_result;
+}
+
+void DigestingInputStream::BackUp(int count) {
+  input_stream_->BackUp(count);
+  pending_size_ -= std::min(std::max(0, count), pending_size_);
+}
+
+int64_t DigestingInputStream::Position() const {
+  return input_stream_->Position();
+}
+
+}  // namespace streamingaead
+}  // namespace tink
+}  // namespace crypto
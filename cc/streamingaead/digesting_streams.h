@@ -0,0 +1,121 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_STREAMINGAEAD_DIGESTING_STREAMS_H_
+#define TINK_STREAMINGAEAD_DIGESTING_STREAMS_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "tink/input_stream.h"
+#include "tink/output_stream.h"
+#include "tink/subtle/common_enums.h"
+#include "tink/subtle/mac/stateful_mac.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace streamingaead {
+
+// Returns a StatefulMac which computes the unkeyed hash 'hash_type' of the
+// data, for use with the streams below.
+crypto::tink::util::StatusOr<std::unique_ptr<subtle::StatefulMac>>
+NewStatefulHash(subtle::HashType hash_type);
+
+// An OutputStream which writes to another one, typically an encrypting
+// stream, and computes a digest of the bytes written as they pass through,
+// e.g. to obtain the hash of a plaintext while encrypting it. The digest is
+// computed over the buffers returned by Next() of the wrapped stream, so the
+// data is not copied.
+class DigestingOutputStream : public crypto::tink::OutputStream {
+ public:
+  // Constructs a stream writing to 'output_stream' and passing the written
+  // bytes to 'digest'.
+  DigestingOutputStream(
+      std::unique_ptr<crypto::tink::OutputStream> output_stream,
+      std::unique_ptr<subtle::StatefulMac> digest);
+
+  crypto::tink::util::StatusOr<int> Next(void** data) override;
+
+  void BackUp(int count) override;
+
+  crypto::tink::util::Status Close() override;
+
+  int64_t Position() const override;
+
+  // Returns the digest of all the bytes written, once Close() succeeded,
+  // and FAILED_PRECONDITION before that.
+  const crypto::tink::util::StatusOr<std::string>& digest() const {
+    return digest_result_;
+  }
+
+ private:
+  // Passes the part of the last buffer which was not backed up to digest_.
+  crypto::tink::util::Status Absorb();
+
+  std::unique_ptr<crypto::tink::OutputStream> output_stream_;
+  std::unique_ptr<subtle::StatefulMac> digest_;
+  crypto::tink::util::Status status_;
+  crypto::tink::util::StatusOr<std::string> digest_result_;
+  // The bytes returned by the last Next() which were not backed up.
+  char* pending_data_ = nullptr;
+  int pending_size_ = 0;
+};
+
+// An InputStream which reads from another one, typically a decrypting
+// stream, and computes a digest of the bytes read as they pass through.
+// Bytes which are backed up are digested only once, when they are returned
+// by Next() again.
+class DigestingInputStream : public crypto::tink::InputStream {
+ public:
+  // Constructs a stream reading from 'input_stream' and passing the read
+  // bytes to 'digest'.
+  DigestingInputStream(std::unique_ptr<crypto::tink::InputStream> input_stream,
+                       std::unique_ptr<subtle::StatefulMac> digest);
+
+  crypto::tink::util::StatusOr<int> Next(const void** data) override;
+
+  void BackUp(int count) override;
+
+  int64_t Position() const override;
+
+  // Returns the digest of all the bytes of 'input_stream', once Next()
+  // returned OUT_OF_RANGE, and FAILED_PRECONDITION before that.
+  const crypto::tink::util::StatusOr<std::string>& digest() const {
+    return digest_result_;
+  }
+
+ private:
+  // Passes the part of the last buffer which was not backed up to digest_.
+  crypto::tink::util::Status Absorb();
+
+  std::unique_ptr<crypto::tink::InputStream> input_stream_;
+  std::unique_ptr<subtle::StatefulMac> digest_;
+  crypto::tink::util::Status status_;
+  crypto::tink::util::StatusOr<std::string> digest_result_;
+  // The bytes returned by the last Next() which were not backed up.
+  const char* pending_data_ = nullptr;
+  int pending_size_ = 0;
+};
+
+}  // namespace streamingaead
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_STREAMINGAEAD_DIGESTING_STREAMS_H_
@@ -0,0 +1,178 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/streamingaead/digesting_streams.h"
+
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <utility>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "openssl/digest.h"
+#include "tink/subtle/common_enums.h"
+#include "tink/subtle/random.h"
+#include "tink/subtle/test_util.h"
+#include "tink/util/istream_input_stream.h"
+#include "tink/util/ostream_output_stream.h"
+#include "tink/util/status.h"
+#include "tink/util/test_matchers.h"
+#include "tink/util/test_util.h"
+
+namespace crypto {
+namespace tink {
+namespace streamingaead {
+namespace {
+
+using ::crypto::tink::subtle::HashType;
+using ::crypto::tink::subtle::Random;
+using ::crypto::tink::test::DummyStatefulMac;
+using ::crypto::tink::test::DummyStreamingAead;
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::crypto::tink::util::IstreamInputStream;
+using ::crypto::tink::util::OstreamOutputStream;
+using ::testing::Eq;
+
+std::string Sha256(absl::string_view data) {
+  uint8_t digest[EVP_MAX_MD_SIZE];
+  unsigned int digest_size;
+  EXPECT_EQ(1, EVP_Digest(data.data(), data.size(), digest, &digest_size,
+                          EVP_sha256(), nullptr));
+  return std::string(reinterpret_cast<char*>(digest), digest_size);
+}
+
+std::unique_ptr<subtle::StatefulMac> NewSha256() {
+  auto hash_result = NewStatefulHash(HashType::SHA256);
+  EXPECT_THAT(hash_result.status(), IsOk());
+  return std::move(hash_result.ValueOrDie());
+}
+
+TEST(DigestingOutputStreamTest, DigestsWrittenData) {
+  for (int size : {0, 1, 10, 100, 1000, 100000}) {
+    SCOPED_TRACE(size);
+    std::string data = Random::GetRandomBytes(size);
+    auto out = absl::make_unique<std::stringstream>();
+    std::stringstream* out_ptr = out.get();
+    DigestingOutputStream stream(
+        absl::make_unique<OstreamOutputStream>(std::move(out), 64),
+        NewSha256());
+    EXPECT_THAT(stream.digest().status(),
+                StatusIs(util::error::FAILED_PRECONDITION));
+    ASSERT_THAT(subtle::test::WriteToStream(&stream, data), IsOk());
+    EXPECT_THAT(out_ptr->str(), Eq(data));
+    ASSERT_THAT(stream.digest().status(), IsOk());
+    EXPECT_THAT(stream.digest().ValueOrDie(), Eq(Sha256(data)));
+  }
+}
+
+TEST(DigestingOutputStreamTest, BackedUpBytesAreNotDigested) {
+  auto out = absl::make_unique<std::stringstream>();
+  std::stringstream* out_ptr = out.get();
+  DigestingOutputStream stream(
+      absl::make_unique<OstreamOutputStream>(std::move(out), 64),
+      absl::make_unique<DummyStatefulMac>("mac"));
+  void* buffer;
+  auto next_result = stream.Next(&buffer);
+  ASSERT_THAT(next_result.status(), IsOk());
+  std::memcpy(buffer, "abc", 3);
+  stream.BackUp(next_result.ValueOrDie() - 3);
+  next_result = stream.Next(&buffer);
+  ASSERT_THAT(next_result.status(), IsOk());
+  std::memcpy(buffer, "de", 2);
+  stream.BackUp(next_result.ValueOrDie() - 2);
+  EXPECT_THAT(stream.Position(), Eq(5));
+  ASSERT_THAT(stream.Close(), IsOk());
+  EXPECT_THAT(out_ptr->str(), Eq("abcde"));
+
+  DummyStatefulMac expected("mac");
+  ASSERT_THAT(expected.Update("abcde"), IsOk());
+  EXPECT_THAT(stream.digest().ValueOrDie(),
+              Eq(expected.Finalize().ValueOrDie()));
+}
+
+TEST(DigestingInputStreamTest, DigestsReadData) {
+  for (int size : {0, 1, 10, 100, 1000, 100000}) {
+    SCOPED_TRACE(size);
+    std::string data = Random::GetRandomBytes(size);
+    DigestingInputStream stream(
+        absl::make_unique<IstreamInputStream>(
+            absl::make_unique<std::stringstream>(data), 64),
+        NewSha256());
+    std::string read;
+    ASSERT_THAT(subtle::test::ReadFromStream(&stream, &read), IsOk());
+    EXPECT_THAT(read, Eq(data));
+    ASSERT_THAT(stream.digest().status(), IsOk());
+    EXPECT_THAT(stream.digest().ValueOrDie(), Eq(Sha256(data)));
+  }
+}
+
+TEST(DigestingInputStreamTest, BackedUpBytesAreDigestedOnce) {
+  std::string data = Random::GetRandomBytes(1000);
+  DigestingInputStream stream(
+      absl::make_unique<IstreamInputStream>(
+          absl::make_unique<std::stringstream>(data), 64),
+      NewSha256());
+  const void* buffer;
+  auto next_result = stream.Next(&buffer);
+  ASSERT_THAT(next_result.status(), IsOk());
+  stream.BackUp(10);
+  stream.BackUp(5);
+  EXPECT_THAT(stream.Position(), Eq(next_result.ValueOrDie() - 15));
+  EXPECT_THAT(stream.digest().status(),
+              StatusIs(util::error::FAILED_PRECONDITION));
+  std::string read(static_cast<const char*>(buffer),
+                   next_result.ValueOrDie() - 15);
+  std::string rest;
+  ASSERT_THAT(subtle::test::ReadFromStream(&stream, &rest), IsOk());
+  EXPECT_THAT(read + rest, Eq(data));
+  ASSERT_THAT(stream.digest().status(), IsOk());
+  EXPECT_THAT(stream.digest().ValueOrDie(), Eq(Sha256(data)));
+}
+
+TEST(DigestingStreamsTest, DigestsPlaintextOfStreamingAead) {
+  DummyStreamingAead saead("saead");
+  std::string plaintext = Random::GetRandomBytes(10000);
+  auto ct = absl::make_unique<std::stringstream>();
+  std::stringstream* ct_ptr = ct.get();
+  auto enc_result = saead.NewEncryptingStream(
+      absl::make_unique<OstreamOutputStream>(std::move(ct)), "ad");
+  ASSERT_THAT(enc_result.status(), IsOk());
+  DigestingOutputStream enc_stream(std::move(enc_result.ValueOrDie()),
+                                   NewSha256());
+  ASSERT_THAT(subtle::test::WriteToStream(&enc_stream, plaintext), IsOk());
+  ASSERT_THAT(enc_stream.digest().status(), IsOk());
+  EXPECT_THAT(enc_stream.digest().ValueOrDie(), Eq(Sha256(plaintext)));
+
+  auto dec_result = saead.NewDecryptingStream(
+      absl::make_unique<IstreamInputStream>(
+          absl::make_unique<std::stringstream>(ct_ptr->str())),
+      "ad");
+  ASSERT_THAT(dec_result.status(), IsOk());
+  DigestingInputStream dec_stream(std::move(dec_result.ValueOrDie()),
+                                  NewSha256());
+  std::string decrypted;
+  ASSERT_THAT(subtle::test::ReadFromStream(&dec_stream, &decrypted), IsOk());
+  EXPECT_THAT(decrypted, Eq(plaintext));
+  EXPECT_THAT(dec_stream.digest().ValueOrDie(), Eq(Sha256(plaintext)));
+}
+
+}  // namespace
+}  // namespace streamingaead
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,349 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/streamingaead/file_encryption.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "tink/input_stream.h"
+#include "tink/output_stream.h"
+#include "tink/random_access_stream.h"
+#include "tink/streaming_aead.h"
+#include "tink/util/buffer.h"
+#include "tink/util/errors.h"
+#include "tink/util/file_input_stream.h"
+#include "tink/util/file_output_stream.h"
+#include "tink/util/file_random_access_stream.h"
+#include "tink/util/read_ahead_file_input_stream.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace streamingaead {
+
+using util::Status;
+using util::StatusOr;
+
+namespace {
+
+// Attempts to close file descriptor fd, while ignoring EINTR.
+// (code borrowed from ZeroCopy-streams)
+int close_ignoring_eintr(int fd) {
+  int result;
+  do {
+    result = close(fd);
+  } while (result < 0 && errno == EINTR);
+  return result;
+}
+
+Status Validate(StreamingAead* streaming_aead,
+                const FileEncryptionOptions& options) {
+  if (streaming_aead == nullptr) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "streaming_aead must be non-null");
+  }
+  if (options.max_chunks_in_flight <= 0 || options.chunk_size <= 0) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "max_chunks_in_flight and chunk_size must be positive");
+  }
+  return Status::OK;
+}
+
+// Returns a duplicate of 'fd', for a stream which takes the ownership of it.
+StatusOr<int> Duplicate(int fd) {
+  int result = dup(fd);
+  if (result < 0) {
+    return ToStatusF(util::error::INVALID_ARGUMENT,
+                     "Cannot duplicate file descriptor %d: %d", fd, errno);
+  }
+  return result;
+}
+
+// Writes all the 'count' bytes of 'data' to 'fd' at 'offset'.
+Status PWriteFully(int fd, const char* data, int count, int64_t offset) {
+  int written = 0;
+  while (written < count) {
+    ssize_t result =
+        pwrite(fd, data + written, count - written, offset + written);
+    if (result < 0 && errno == EINTR) continue;
+    if (result < 0) {
+      return ToStatusF(util::error::INTERNAL, "I/O error: %d", errno);
+    }
+    written += result;
+  }
+  return Status::OK;
+}
+
+// Decrypts the 'count' bytes of plaintext at 'position' from
+// 'plaintext_stream', and writes them to 'plaintext_fd' at the same offset.
+// Returns OUT_OF_RANGE if the plaintext ends earlier, after writing what
+// precedes the end.
+Status DecryptChunk(RandomAccessStream* plaintext_stream, int64_t position,
+                    int count, int plaintext_fd) {
+  auto buffer_result = util::Buffer::New(count);
+  if (!buffer_result.ok()) return buffer_result.status();
+  auto buffer = std::move(buffer_result.ValueOrDie());
+  Status read_status = plaintext_stream->PRead(position, count, buffer.get());
+  if (!read_status.ok() &&
+      read_status.error_code() != util::error::OUT_OF_RANGE) {
+    return read_status;
+  }
+  Status write_status = PWriteFully(plaintext_fd, buffer->get_mem_block(),
+                                    buffer->size(), position);
+  if (!write_status.ok()) return write_status;
+  if (buffer->size() < count) {
+    return Status(util::error::OUT_OF_RANGE, "EOF");
+  }
+  return Status::OK;
+}
+
+// The chunks being decrypted, shared with the decryption tasks.
+struct PendingChunks {
+  absl::Mutex mutex;
+  int max_count = 0;  // the maximal number of chunks in flight
+  int count ABSL_GUARDED_BY(mutex) = 0;
+  // The first error of a chunk, if any.
+  Status status ABSL_GUARDED_BY(mutex);
+};
+
+}  // namespace
+
+Status EncryptFile(StreamingAead* streaming_aead, int plaintext_fd,
+                   int ciphertext_fd, absl::string_view associated_data,
+                   const FileEncryptionOptions& options) {
+  Status status = Validate(streaming_aead, options);
+  if (!status.ok()) return status;
+  auto plaintext_fd_result = Duplicate(plaintext_fd);
+  if (!plaintext_fd_result.ok()) return plaintext_fd_result.status();
+  std::unique_ptr<InputStream> plaintext_source;
+  if (options.schedule) {
+    util::ReadAheadFileInputStream::Options read_ahead_options;
+    read_ahead_options.buffer_size = options.chunk_size;
+    read_ahead_options.read_ahead_count = options.max_chunks_in_flight;
+    read_ahead_options.schedule = options.schedule;
+    auto source_result = util::ReadAheadFileInputStream::New(
+        plaintext_fd_result.ValueOrDie(), read_ahead_options);
+    if (!source_result.ok()) return source_result.status();
+    plaintext_source = std::move(source_result.ValueOrDie());
+  } else {
+    plaintext_source = absl::make_unique<util::FileInputStream>(
+        plaintext_fd_result.ValueOrDie());
+  }
+  auto ciphertext_fd_result = Duplicate(ciphertext_fd);
+  if (!ciphertext_fd_result.ok()) return ciphertext_fd_result.status();
+  auto enc_stream_result = streaming_aead->NewEncryptingStream(
+      absl::make_unique<util::FileOutputStream>(
+          ciphertext_fd_result.ValueOrDie()),
+      associated_data);
+  if (!enc_stream_result.ok()) return enc_stream_result.status();
+  auto enc_stream = std::move(enc_stream_result.ValueOrDie());
+
+  while (true) {
+    const void* plaintext;
+    auto next_result = plaintext_source->Next(&plaintext);
+    if (next_result.status().error_code() == util::error::OUT_OF_RANGE) break;
+    if (!next_result.ok()) return next_result.status();
+    const char* input = static_cast<const char*>(plaintext);
+    int remaining = next_result.ValueOrDie();
+    while (remaining > 0) {
+      void* buffer;
+      auto enc_next_result = enc_stream->Next(&buffer);
+      if (!enc_next_result.ok()) return enc_next_result.status();
+      int available = enc_next_result.ValueOrDie();
+      int count = std::min(available, remaining);
+      std::memcpy(buffer, input, count);
+      if (count < available) enc_stream->BackUp(available - count);
+      input += count;
+      remaining -= count;
+    }
+  }
+  return enc_stream->Close();
+}
+
+Status DecryptFile(StreamingAead* streaming_aead, int ciphertext_fd,
+                   int plaintext_fd, absl::string_view associated_data,
+                   const FileEncryptionOptions& options) {
+  Status status = Validate(streaming_aead, options);
+  if (!status.ok()) return status;
+  auto ciphertext_fd_result = Duplicate(ciphertext_fd);
+  if (!ciphertext_fd_result.ok()) return ciphertext_fd_result.status();
+  auto dec_stream_result = streaming_aead->NewDecryptingRandomAccessStream(
+      absl::make_unique<util::FileRandomAccessStream>(
+          ciphertext_fd_result.ValueOrDie()),
+      associated_data);
+  if (!dec_stream_result.ok()) return dec_stream_result.status();
+  auto dec_stream = std::move(dec_stream_result.ValueOrDie());
+
+  // The first chunk is decrypted before the others, as it determines the
+  // matching key, and thereby the size of the plaintext.
+  status = DecryptChunk(dec_stream.get(), 0, options.chunk_size, plaintext_fd);
+  if (status.error_code() == util::error::OUT_OF_RANGE) return Status::OK;
+  if (!status.ok()) return status;
+  auto size_result = dec_stream->size();
+  if (!size_result.ok()) return size_result.status();
+  int64_t plaintext_size = size_result.ValueOrDie();
+
+  auto pending = std::make_shared<PendingChunks>();
+  pending->max_count = options.max_chunks_in_flight;
+  // The tasks may use dec_stream, as they finish before this function
+  // returns.
+  RandomAccessStream* plaintext_stream = dec_stream.get();
+  for (int64_t position = options.chunk_size; position < plaintext_size;
+       position += options.chunk_size) {
+    int count = static_cast<int>(
+        std::min<int64_t>(options.chunk_size, plaintext_size - position));
+    {
+      absl::MutexLock lock(&pending->mutex);
+      pending->mutex.Await(absl::Condition(
+          +[](PendingChunks* pending) {
+            return pending->count < pending->max_count;
+          },
+          pending.get()));
+      if (!pending->status.ok()) break;
+      pending->count++;
+    }
+    std::function<void()> task = [plaintext_stream, position, count,
+                                  plaintext_fd, pending]() {
+      Status chunk_status =
+          DecryptChunk(plaintext_stream, position, count, plaintext_fd);
+      absl::MutexLock lock(&pending->mutex);
+      if (!chunk_status.ok() && pending->status.ok()) {
+        pending->status = chunk_status;
+      }
+      pending->count--;
+    };
+    if (options.schedule) {
+      options.schedule(std::move(task));
+    } else {
+      task();
+    }
+  }
+  absl::MutexLock lock(&pending->mutex);
+  pending->mutex.Await(absl::Condition(
+      +[](int* count) { return *count == 0; }, &pending->count));
+  // A chunk ending early means that the ciphertext got shorter.
+  if (pending->status.error_code() == util::error::OUT_OF_RANGE) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "ciphertext changed during decryption");
+  }
+  return pending->status;
+}
+
+namespace {
+
+// Opens 'path' with 'flags', for EncryptFile() and DecryptFile().
+StatusOr<int> OpenFile(const std::string& path, int flags) {
+  int fd;
+  do {
+    fd = open(path.c_str(), flags, 0600);
+  } while (fd < 0 && errno == EINTR);
+  if (fd < 0) {
+    return ToStatusF(util::error::INVALID_ARGUMENT,
+                     "Cannot open file '%s': %d", path.c_str(), errno);
+  }
+  return fd;
+}
+
+// Creates a new temporary file next to 'path', and sets '*temp_path' to its
+// name. Being in the same directory, it can be renamed to 'path'.
+StatusOr<int> CreateTempFile(const std::string& path, std::string* temp_path) {
+  std::string name = path + ".tmpXXXXXX";
+  int fd = mkstemp(&name[0]);
+  if (fd < 0) {
+    return ToStatusF(util::error::INVALID_ARGUMENT,
+                     "Cannot create a file next to '%s': %d", path.c_str(),
+                     errno);
+  }
+  *temp_path = std::move(name);
+  return fd;
+}
+
+// Runs 'crypt' from the file 'input_path' to the file 'output_path'. The
+// output is written to a temporary file, which replaces 'output_path' only
+// once 'crypt' succeeded, and is removed otherwise.
+Status CryptFile(const std::string& input_path, const std::string& output_path,
+                 const std::function<Status(int, int)>& crypt) {
+  auto input_fd_result = OpenFile(input_path, O_RDONLY);
+  if (!input_fd_result.ok()) return input_fd_result.status();
+  int input_fd = input_fd_result.ValueOrDie();
+  std::string temp_path;
+  auto output_fd_result = CreateTempFile(output_path, &temp_path);
+  if (!output_fd_result.ok()) {
+    close_ignoring_eintr(input_fd);
+    return output_fd_result.status();
+  }
+  int output_fd = output_fd_result.ValueOrDie();
+  Status status = crypt(input_fd, output_fd);
+  close_ignoring_eintr(input_fd);
+  if (close_ignoring_eintr(output_fd) < 0 && status.ok()) {
+    status = ToStatusF(util::error::INTERNAL, "I/O error: %d", errno);
+  }
+  if (status.ok() && rename(temp_path.c_str(), output_path.c_str()) < 0) {
+    status = ToStatusF(util::error::INVALID_ARGUMENT,
+                       "Cannot replace file '%s': %d", output_path.c_str(),
+                       errno);
+  }
+  if (!status.ok()) unlink(temp_path.c_str());
+  return status;
+}
+
+}  // namespace
+
+Status EncryptFile(StreamingAead* streaming_aead,
+                   const std::string& plaintext_path,
+                   const std::string& ciphertext_path,
+                   absl::string_view associated_data,
+                   const FileEncryptionOptions& options) {
+  return CryptFile(plaintext_path, ciphertext_path,
+                   [&](int plaintext_fd, int ciphertext_fd) {
+                     return EncryptFile(streaming_aead, plaintext_fd,
+                                        ciphertext_fd, associated_data,
+                                        options);
+                   });
+}
+
+Status DecryptFile(StreamingAead* streaming_aead,
+                   const std::string& ciphertext_path,
+                   const std::string& plaintext_path,
+                   absl::string_view associated_data,
+                   const FileEncryptionOptions& options) {
+  return CryptFile(ciphertext_path, plaintext_path,
+                   [&](int ciphertext_fd, int plaintext_fd) {
+                     return DecryptFile(streaming_aead, ciphertext_fd,
+                                        plaintext_fd, associated_data,
+                                        options);
+                   });
+}
+
+}  // namespace streamingaead
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,93 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_STREAMINGAEAD_FILE_ENCRYPTION_H_
+#define TINK_STREAMINGAEAD_FILE_ENCRYPTION_H_
+
+#include <functional>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "tink/streaming_aead.h"
+#include "tink/util/status.h"
+
+namespace crypto {
+namespace tink {
+namespace streamingaead {
+
+// Helpers which encrypt or decrypt a whole file with a StreamingAead,
+// so that callers need not write their own copy loops over the streams.
+
+struct FileEncryptionOptions {
+  // Runs the decryption of chunks of the file, or the reads of the
+  // plaintext ahead of its encryption, e.g. on a thread pool owned by the
+  // caller. Tasks may run on any thread and in any order. If null,
+  // everything runs on the calling thread.
+  std::function<void(std::function<void()>)> schedule;
+  // The maximal number of chunks decrypted, or read ahead of the
+  // encryption, concurrently. Must be positive.
+  int max_chunks_in_flight = 8;
+  // The number of plaintext bytes of a chunk. Chunks are read from the
+  // decrypting RandomAccessStream, and written with pwrite(), independently
+  // of each other. Must be positive.
+  int chunk_size = 1024 * 1024;  // 1 MB
+};
+
+// Encrypts the contents of 'plaintext_fd', from its current offset to its
+// end, with 'streaming_aead' and 'associated_data', and writes the
+// ciphertext to 'ciphertext_fd' at its current offset. The file
+// descriptors are not closed. The segments are encrypted by a single
+// OutputStream of 'streaming_aead', but if 'options.schedule' is set, the
+// next chunks of the plaintext are read while the current one is
+// encrypted. 'plaintext_fd' must then be seekable.
+crypto::tink::util::Status EncryptFile(
+    crypto::tink::StreamingAead* streaming_aead, int plaintext_fd,
+    int ciphertext_fd, absl::string_view associated_data,
+    const FileEncryptionOptions& options = FileEncryptionOptions());
+
+// Decrypts the file 'ciphertext_fd' with 'streaming_aead' and
+// 'associated_data', and writes the plaintext to 'plaintext_fd', which must
+// support pwrite(), starting at offset 0. The chunks of the plaintext
+// are decrypted concurrently on 'options.schedule', via the
+// RandomAccessStream of 'streaming_aead'. If decryption fails, the
+// plaintext file may contain a part of the plaintext, and should be
+// discarded. The file descriptors are not closed.
+crypto::tink::util::Status DecryptFile(
+    crypto::tink::StreamingAead* streaming_aead, int ciphertext_fd,
+    int plaintext_fd, absl::string_view associated_data,
+    const FileEncryptionOptions& options = FileEncryptionOptions());
+
+// Like above, but for files specified by their paths. The output is written
+// to a new file in the directory of the output path, which replaces the
+// output file only if encryption or decryption succeeds; on failure, no
+// partial output is left behind.
+crypto::tink::util::Status EncryptFile(
+    crypto::tink::StreamingAead* streaming_aead,
+    const std::string& plaintext_path, const std::string& ciphertext_path,
+    absl::string_view associated_data,
+    const FileEncryptionOptions& options = FileEncryptionOptions());
+
+crypto::tink::util::Status DecryptFile(
+    crypto::tink::StreamingAead* streaming_aead,
+    const std::string& ciphertext_path, const std::string& plaintext_path,
+    absl::string_view associated_data,
+    const FileEncryptionOptions& options = FileEncryptionOptions());
+
+}  // namespace streamingaead
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_STREAMINGAEAD_FILE_ENCRYPTION_H_
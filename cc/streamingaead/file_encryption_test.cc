@@ -0,0 +1,275 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/streamingaead/file_encryption.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "tink/primitive_set.h"
+#include "tink/streaming_aead.h"
+#include "tink/streamingaead/streaming_aead_wrapper.h"
+#include "tink/subtle/aes_ctr_hmac_streaming.h"
+#include "tink/subtle/common_enums.h"
+#include "tink/subtle/random.h"
+#include "tink/subtle/test_util.h"
+#include "tink/util/status.h"
+#include "tink/util/test_matchers.h"
+#include "tink/util/test_util.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace streamingaead {
+namespace {
+
+using crypto::tink::subtle::AesCtrHmacStreaming;
+using crypto::tink::subtle::test::TestThreadPool;
+using crypto::tink::test::IsOk;
+using crypto::tink::test::StatusIs;
+using google::crypto::tink::KeysetInfo;
+using google::crypto::tink::KeyStatusType;
+using google::crypto::tink::OutputPrefixType;
+
+std::unique_ptr<StreamingAead> NewAesCtrHmacStreaming() {
+  AesCtrHmacStreaming::Params params;
+  params.ikm = subtle::Random::GetRandomKeyBytes(32);
+  params.hkdf_algo = subtle::SHA256;
+  params.key_size = 32;
+  params.ciphertext_segment_size = 4096;
+  params.ciphertext_offset = 0;
+  params.tag_algo = subtle::SHA256;
+  params.tag_size = 16;
+  return std::move(AesCtrHmacStreaming::New(params).ValueOrDie());
+}
+
+// Returns a keyset-wrapped StreamingAead of two keys, and sets
+// '*non_primary' to the primitive of the non-primary one.
+std::unique_ptr<StreamingAead> NewWrappedStreamingAead(
+    StreamingAead** non_primary) {
+  auto saead_set = absl::make_unique<PrimitiveSet<StreamingAead>>();
+  for (uint32_t key_id : {1, 2}) {
+    KeysetInfo::KeyInfo key_info;
+    key_info.set_output_prefix_type(OutputPrefixType::RAW);
+    key_info.set_key_id(key_id);
+    key_info.set_status(KeyStatusType::ENABLED);
+    auto saead = NewAesCtrHmacStreaming();
+    StreamingAead* saead_ptr = saead.get();
+    auto entry = saead_set->AddPrimitive(std::move(saead), key_info)
+                     .ValueOrDie();
+    if (key_id == 1) *non_primary = saead_ptr;
+    if (key_id == 2) {
+      EXPECT_THAT(saead_set->set_primary(entry), IsOk());
+    }
+  }
+  return std::move(StreamingAeadWrapper().Wrap(std::move(saead_set))
+                       .ValueOrDie());
+}
+
+std::string TestPath(absl::string_view filename) {
+  return absl::StrCat(test::TmpDir(), "/", filename);
+}
+
+void WriteFile(const std::string& path, absl::string_view contents) {
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file << contents;
+}
+
+std::string ReadFile(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  std::stringstream contents;
+  contents << file.rdbuf();
+  return contents.str();
+}
+
+TEST(FileEncryptionTest, EncryptAndDecryptPaths) {
+  auto saead = NewAesCtrHmacStreaming();
+  std::string pt_path = TestPath("file_encryption_pt");
+  std::string ct_path = TestPath("file_encryption_ct");
+  std::string dec_path = TestPath("file_encryption_dec");
+  std::string aad = "some aad";
+  for (int pt_size : {0, 1, 4000, 10000, 100000}) {
+    for (bool parallel : {false, true}) {
+      SCOPED_TRACE(absl::StrCat("pt_size = ", pt_size,
+                                ", parallel = ", parallel));
+      std::string plaintext = subtle::Random::GetRandomBytes(pt_size);
+      WriteFile(pt_path, plaintext);
+      TestThreadPool pool(4);
+      FileEncryptionOptions options;
+      options.chunk_size = 3000;
+      options.max_chunks_in_flight = 3;
+      if (parallel) {
+        options.schedule = [&pool](std::function<void()> task) {
+          pool.Schedule(std::move(task));
+        };
+      }
+      ASSERT_THAT(EncryptFile(saead.get(), pt_path, ct_path, aad, options),
+                  IsOk());
+      EXPECT_NE(plaintext, ReadFile(ct_path));
+      ASSERT_THAT(DecryptFile(saead.get(), ct_path, dec_path, aad, options),
+                  IsOk());
+      EXPECT_EQ(plaintext, ReadFile(dec_path));
+    }
+  }
+}
+
+TEST(FileEncryptionTest, DecryptWithKeyset) {
+  StreamingAead* non_primary;
+  auto saead = NewWrappedStreamingAead(&non_primary);
+  std::string pt_path = TestPath("file_encryption_keyset_pt");
+  std::string ct_path = TestPath("file_encryption_keyset_ct");
+  std::string dec_path = TestPath("file_encryption_keyset_dec");
+  std::string plaintext = subtle::Random::GetRandomBytes(50000);
+  WriteFile(pt_path, plaintext);
+  TestThreadPool pool(4);
+  FileEncryptionOptions options;
+  options.chunk_size = 5000;
+  options.schedule = [&pool](std::function<void()> task) {
+    pool.Schedule(std::move(task));
+  };
+  // Ciphertexts of the primary and of the non-primary key.
+  for (StreamingAead* encrypter : {saead.get(), non_primary}) {
+    ASSERT_THAT(EncryptFile(encrypter, pt_path, ct_path, "aad", options),
+                IsOk());
+    ASSERT_THAT(DecryptFile(saead.get(), ct_path, dec_path, "aad", options),
+                IsOk());
+    EXPECT_EQ(plaintext, ReadFile(dec_path));
+  }
+}
+
+TEST(FileEncryptionTest, EncryptFromCurrentOffset) {
+  auto saead = NewAesCtrHmacStreaming();
+  std::string pt_path = TestPath("file_encryption_offset_pt");
+  std::string ct_path = TestPath("file_encryption_offset_ct");
+  std::string dec_path = TestPath("file_encryption_offset_dec");
+  std::string plaintext = subtle::Random::GetRandomBytes(10000);
+  WriteFile(pt_path, plaintext);
+  int pt_fd = open(pt_path.c_str(), O_RDONLY);
+  ASSERT_EQ(100, lseek(pt_fd, 100, SEEK_SET));
+  int ct_fd = open(ct_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+  EXPECT_THAT(EncryptFile(saead.get(), pt_fd, ct_fd, "aad"), IsOk());
+  close(pt_fd);
+  close(ct_fd);
+  ASSERT_THAT(DecryptFile(saead.get(), ct_path, dec_path, "aad"), IsOk());
+  EXPECT_EQ(plaintext.substr(100), ReadFile(dec_path));
+}
+
+TEST(FileEncryptionTest, DecryptionFailures) {
+  auto saead = NewAesCtrHmacStreaming();
+  std::string pt_path = TestPath("file_encryption_fail_pt");
+  std::string ct_path = TestPath("file_encryption_fail_ct");
+  std::string dec_path = TestPath("file_encryption_fail_dec");
+  std::string plaintext = subtle::Random::GetRandomBytes(20000);
+  WriteFile(pt_path, plaintext);
+  FileEncryptionOptions options;
+  options.chunk_size = 1000;
+  ASSERT_THAT(EncryptFile(saead.get(), pt_path, ct_path, "aad", options),
+              IsOk());
+  // Wrong associated data.
+  EXPECT_FALSE(
+      DecryptFile(saead.get(), ct_path, dec_path, "other aad", options).ok());
+  // A modified segment after the first chunk.
+  std::string ciphertext = ReadFile(ct_path);
+  ciphertext[15000] ^= 1;
+  WriteFile(ct_path, ciphertext);
+  EXPECT_FALSE(
+      DecryptFile(saead.get(), ct_path, dec_path, "aad", options).ok());
+  // A missing input file.
+  EXPECT_THAT(DecryptFile(saead.get(), TestPath("file_encryption_missing"),
+                          dec_path, "aad", options),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+// Returns the names of the entries of test::TmpDir() starting with 'prefix'.
+std::vector<std::string> TmpDirEntries(absl::string_view prefix) {
+  std::vector<std::string> entries;
+  DIR* dir = opendir(test::TmpDir().c_str());
+  if (dir == nullptr) return entries;
+  while (struct dirent* entry = readdir(dir)) {
+    if (absl::StartsWith(entry->d_name, prefix)) {
+      entries.push_back(entry->d_name);
+    }
+  }
+  closedir(dir);
+  return entries;
+}
+
+TEST(FileEncryptionTest, FailedDecryptionLeavesNoOutput) {
+  auto saead = NewAesCtrHmacStreaming();
+  std::string pt_path = TestPath("file_encryption_nooutput_pt");
+  std::string ct_path = TestPath("file_encryption_nooutput_ct");
+  std::string dec_path = TestPath("file_encryption_nooutput_dec");
+  std::string plaintext = subtle::Random::GetRandomBytes(20000);
+  WriteFile(pt_path, plaintext);
+  unlink(dec_path.c_str());
+  FileEncryptionOptions options;
+  options.chunk_size = 1000;
+  ASSERT_THAT(EncryptFile(saead.get(), pt_path, ct_path, "aad", options),
+              IsOk());
+  // A modified segment in the middle of the ciphertext.
+  std::string ciphertext = ReadFile(ct_path);
+  ciphertext[ciphertext.size() / 2] ^= 1;
+  WriteFile(ct_path, ciphertext);
+  TestThreadPool pool(4);
+  options.schedule = [&pool](std::function<void()> task) {
+    pool.Schedule(std::move(task));
+  };
+  EXPECT_FALSE(
+      DecryptFile(saead.get(), ct_path, dec_path, "aad", options).ok());
+  EXPECT_NE(access(dec_path.c_str(), F_OK), 0);
+  EXPECT_TRUE(TmpDirEntries("file_encryption_nooutput_dec").empty());
+
+  // An existing output file is kept as it is.
+  WriteFile(dec_path, "previous contents");
+  EXPECT_FALSE(
+      DecryptFile(saead.get(), ct_path, dec_path, "aad", options).ok());
+  EXPECT_EQ("previous contents", ReadFile(dec_path));
+  EXPECT_EQ(std::vector<std::string>{"file_encryption_nooutput_dec"},
+            TmpDirEntries("file_encryption_nooutput_dec"));
+}
+
+TEST(FileEncryptionTest, InvalidOptions) {
+  auto saead = NewAesCtrHmacStreaming();
+  std::string pt_path = TestPath("file_encryption_options_pt");
+  std::string ct_path = TestPath("file_encryption_options_ct");
+  WriteFile(pt_path, "plaintext");
+  FileEncryptionOptions options;
+  options.chunk_size = 0;
+  EXPECT_THAT(EncryptFile(saead.get(), pt_path, ct_path, "aad", options),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  options.chunk_size = 100;
+  options.max_chunks_in_flight = 0;
+  EXPECT_THAT(DecryptFile(saead.get(), ct_path, pt_path, "aad", options),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(EncryptFile(nullptr, pt_path, ct_path, "aad"),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace streamingaead
+}  // namespace tink
+}  // namespace crypto
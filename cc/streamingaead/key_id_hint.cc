@@ -0,0 +1,72 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/streamingaead/key_id_hint.h"
+
+#include <vector>
+
+#include "absl/types/optional.h"
+#include "tink/primitive_set.h"
+#include "tink/streaming_aead.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace streamingaead {
+
+using crypto::tink::PrimitiveSet;
+using crypto::tink::StreamingAead;
+using util::Status;
+using util::StatusOr;
+
+using StreamingAeadEntry = PrimitiveSet<StreamingAead>::Entry<StreamingAead>;
+
+StatusOr<std::vector<const StreamingAeadEntry*>> GetPrimitivesInTrialOrder(
+    const PrimitiveSet<StreamingAead>& primitives, const KeyIdHint* hint) {
+  auto raw_primitives_result = primitives.get_raw_primitives();
+  if (!raw_primitives_result.ok()) {
+    return Status(util::error::INTERNAL, "No RAW primitives found");
+  }
+  const StreamingAeadEntry* hinted = nullptr;
+  absl::optional<uint32_t> hinted_key_id;
+  if (hint != nullptr) hinted_key_id = hint->Get();
+  const StreamingAeadEntry* primary = primitives.get_primary();
+  std::vector<const StreamingAeadEntry*> others;
+  for (const auto& entry : *raw_primitives_result.ValueOrDie()) {
+    if (hinted == nullptr && hinted_key_id.has_value() &&
+        entry->get_key_id() == *hinted_key_id) {
+      hinted = entry.get();
+    } else if (entry.get() != primary) {
+      others.push_back(entry.get());
+    }
+  }
+  std::vector<const StreamingAeadEntry*> entries;
+  entries.reserve(raw_primitives_result.ValueOrDie()->size());
+  if (hinted != nullptr) entries.push_back(hinted);
+  if (primary != nullptr && primary != hinted &&
+      primary->get_output_prefix_type() ==
+          google::crypto::tink::OutputPrefixType::RAW) {
+    entries.push_back(primary);
+  }
+  entries.insert(entries.end(), others.begin(), others.end());
+  return entries;
+}
+
+}  // namespace streamingaead
+}  // namespace tink
+}  // namespace crypto
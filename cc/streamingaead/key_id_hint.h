@@ -0,0 +1,77 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_STREAMINGAEAD_KEY_ID_HINT_H_
+#define TINK_STREAMINGAEAD_KEY_ID_HINT_H_
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include "absl/types/optional.h"
+#include "tink/primitive_set.h"
+#include "tink/streaming_aead.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace streamingaead {
+
+// The ID of a key which likely decrypts a ciphertext stream. The decrypting
+// streams try the primitive of this key first when they look for the one
+// matching the ciphertext, and update the hint with the key that matched.
+// Since every trial reads and authenticates the header and the first
+// segment, a correct hint saves the trials of all the other keys.
+//
+// A hint is only an optimization: the other keys are still tried if the
+// hinted one does not match. Instances of this class are thread safe, and
+// may be shared between streams.
+class KeyIdHint {
+ public:
+  KeyIdHint() {}
+  explicit KeyIdHint(uint32_t key_id) : key_id_(key_id) {}
+
+  // Returns the hinted key ID, if any.
+  absl::optional<uint32_t> Get() const {
+    int64_t key_id = key_id_.load(std::memory_order_relaxed);
+    if (key_id < 0) return absl::nullopt;
+    return static_cast<uint32_t>(key_id);
+  }
+
+  void Set(uint32_t key_id) {
+    key_id_.store(key_id, std::memory_order_relaxed);
+  }
+
+ private:
+  std::atomic<int64_t> key_id_{-1};  // -1 iff there is no hint
+};
+
+// Returns the RAW primitives of 'primitives' in the order in which they
+// should be tried for decryption: the one of the key hinted by 'hint'
+// (which may be null) first, then the primary one, then the others in the
+// order of the keyset.
+crypto::tink::util::StatusOr<std::vector<
+    const crypto::tink::PrimitiveSet<crypto::tink::StreamingAead>::Entry<
+        crypto::tink::StreamingAead>*>>
+GetPrimitivesInTrialOrder(
+    const crypto::tink::PrimitiveSet<crypto::tink::StreamingAead>& primitives,
+    const KeyIdHint* hint);
+
+}  // namespace streamingaead
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_STREAMINGAEAD_KEY_ID_HINT_H_
@@ -0,0 +1,115 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/streamingaead/key_id_hint.h"
+
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "tink/primitive_set.h"
+#include "tink/streaming_aead.h"
+#include "tink/util/test_matchers.h"
+#include "tink/util/test_util.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace streamingaead {
+namespace {
+
+using crypto::tink::test::DummyStreamingAead;
+using crypto::tink::test::IsOk;
+using crypto::tink::test::StatusIs;
+using google::crypto::tink::KeysetInfo;
+using google::crypto::tink::KeyStatusType;
+using google::crypto::tink::OutputPrefixType;
+
+// Returns a PrimitiveSet with RAW primitives for 'key_ids', in this order,
+// and with the primitive of 'primary_key_id' as the primary.
+std::unique_ptr<PrimitiveSet<StreamingAead>> GetTestStreamingAeadSet(
+    const std::vector<uint32_t>& key_ids, uint32_t primary_key_id) {
+  auto saead_set = absl::make_unique<PrimitiveSet<StreamingAead>>();
+  for (uint32_t key_id : key_ids) {
+    KeysetInfo::KeyInfo key_info;
+    key_info.set_output_prefix_type(OutputPrefixType::RAW);
+    key_info.set_key_id(key_id);
+    key_info.set_status(KeyStatusType::ENABLED);
+    auto entry_result = saead_set->AddPrimitive(
+        absl::make_unique<DummyStreamingAead>("saead"), key_info);
+    EXPECT_THAT(entry_result.status(), IsOk());
+    if (key_id == primary_key_id) {
+      EXPECT_THAT(saead_set->set_primary(entry_result.ValueOrDie()), IsOk());
+    }
+  }
+  return saead_set;
+}
+
+// Returns the key IDs of the primitives of 'saead_set' in trial order.
+std::vector<uint32_t> GetKeyIdsInTrialOrder(
+    const PrimitiveSet<StreamingAead>& saead_set, const KeyIdHint* hint) {
+  auto primitives_result = GetPrimitivesInTrialOrder(saead_set, hint);
+  EXPECT_THAT(primitives_result.status(), IsOk());
+  std::vector<uint32_t> key_ids;
+  for (const auto* entry : primitives_result.ValueOrDie()) {
+    key_ids.push_back(entry->get_key_id());
+  }
+  return key_ids;
+}
+
+TEST(KeyIdHintTest, GetAndSet) {
+  KeyIdHint hint;
+  EXPECT_FALSE(hint.Get().has_value());
+  hint.Set(0);
+  EXPECT_EQ(0, hint.Get().value());
+  hint.Set(0xffffffff);
+  EXPECT_EQ(0xffffffff, hint.Get().value());
+  EXPECT_EQ(42, KeyIdHint(42).Get().value());
+}
+
+TEST(KeyIdHintTest, TrialOrderWithoutHint) {
+  auto saead_set = GetTestStreamingAeadSet({1, 2, 3, 4}, 3);
+  std::vector<uint32_t> expected = {3, 1, 2, 4};
+  EXPECT_EQ(expected, GetKeyIdsInTrialOrder(*saead_set, nullptr));
+  KeyIdHint hint;
+  EXPECT_EQ(expected, GetKeyIdsInTrialOrder(*saead_set, &hint));
+}
+
+TEST(KeyIdHintTest, TrialOrderWithHint) {
+  auto saead_set = GetTestStreamingAeadSet({1, 2, 3, 4}, 3);
+  KeyIdHint hint(4);
+  EXPECT_EQ(std::vector<uint32_t>({4, 3, 1, 2}),
+            GetKeyIdsInTrialOrder(*saead_set, &hint));
+  hint.Set(3);
+  EXPECT_EQ(std::vector<uint32_t>({3, 1, 2, 4}),
+            GetKeyIdsInTrialOrder(*saead_set, &hint));
+  // A key which is not in the set is ignored.
+  hint.Set(5);
+  EXPECT_EQ(std::vector<uint32_t>({3, 1, 2, 4}),
+            GetKeyIdsInTrialOrder(*saead_set, &hint));
+}
+
+TEST(KeyIdHintTest, NoRawPrimitives) {
+  PrimitiveSet<StreamingAead> saead_set;
+  EXPECT_THAT(GetPrimitivesInTrialOrder(saead_set, nullptr).status(),
+              StatusIs(util::error::INTERNAL));
+}
+
+}  // namespace
+}  // namespace streamingaead
+}  // namespace tink
+}  // namespace crypto
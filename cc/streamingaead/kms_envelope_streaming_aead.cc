@@ -0,0 +1,273 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/streamingaead/kms_envelope_streaming_aead.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/internal/endian.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "tink/aead.h"
+#include "tink/input_stream.h"
+#include "tink/output_stream.h"
+#include "tink/random_access_stream.h"
+#include "tink/registry.h"
+#include "tink/streaming_aead.h"
+#include "tink/util/buffer.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace streamingaead {
+
+using crypto::tink::util::Status;
+using crypto::tink::util::StatusOr;
+using google::crypto::tink::KeyData;
+using google::crypto::tink::KeyTemplate;
+
+namespace {
+
+const int kEncryptedDekPrefixSize = 4;
+// Bounds the allocation for the encrypted DEK of a corrupted header. Wrapped
+// keys of KMS services are a few hundred bytes.
+const uint32_t kMaxEncryptedDekSize = 1 << 16;
+const char* kEmptyAssociatedData = "";
+
+// Writes all of 'data' to 'output'.
+Status WriteFully(absl::string_view data, OutputStream* output) {
+  while (!data.empty()) {
+    void* buffer;
+    auto next_result = output->Next(&buffer);
+    if (!next_result.ok()) return next_result.status();
+    int available = next_result.ValueOrDie();
+    int count = std::min<size_t>(available, data.size());
+    std::memcpy(buffer, data.data(), count);
+    data.remove_prefix(count);
+    if (count < available) output->BackUp(available - count);
+  }
+  return util::OkStatus();
+}
+
+// Reads exactly 'count' bytes from 'input' into 'data'.
+Status ReadFully(int count, InputStream* input, std::string* data) {
+  data->clear();
+  while (data->size() < static_cast<size_t>(count)) {
+    const void* buffer;
+    auto next_result = input->Next(&buffer);
+    if (next_result.status().error_code() == util::error::OUT_OF_RANGE) {
+      return Status(util::error::INVALID_ARGUMENT, "ciphertext too short");
+    }
+    if (!next_result.ok()) return next_result.status();
+    int available = next_result.ValueOrDie();
+    int needed = std::min<size_t>(available, count - data->size());
+    data->append(static_cast<const char*>(buffer), needed);
+    if (needed < available) input->BackUp(available - needed);
+  }
+  return util::OkStatus();
+}
+
+// Reads exactly 'count' bytes at 'position' of 'input' into 'data'.
+Status ReadFullyAt(int64_t position, int count, RandomAccessStream* input,
+                   std::string* data) {
+  auto buffer_result = util::Buffer::New(count);
+  if (!buffer_result.ok()) return buffer_result.status();
+  util::Buffer* buffer = buffer_result.ValueOrDie().get();
+  data->clear();
+  while (data->size() < static_cast<size_t>(count)) {
+    Status status = input->PRead(position + data->size(),
+                                 count - data->size(), buffer);
+    data->append(buffer->get_mem_block(), buffer->size());
+    if (status.error_code() == util::error::OUT_OF_RANGE) {
+      if (data->size() < static_cast<size_t>(count)) {
+        return Status(util::error::INVALID_ARGUMENT, "ciphertext too short");
+      }
+    } else if (!status.ok()) {
+      return status;
+    }
+  }
+  return util::OkStatus();
+}
+
+// Returns the length of the encrypted DEK stored in 'prefix'.
+StatusOr<int> ParseEncryptedDekSize(absl::string_view prefix) {
+  uint32_t encrypted_dek_size = absl::big_endian::Load32(prefix.data());
+  if (encrypted_dek_size == 0 || encrypted_dek_size > kMaxEncryptedDekSize) {
+    return Status(util::error::INVALID_ARGUMENT, "invalid ciphertext");
+  }
+  return static_cast<int>(encrypted_dek_size);
+}
+
+// The part of a RandomAccessStream after its first 'offset' bytes.
+class OffsetRandomAccessStream : public RandomAccessStream {
+ public:
+  OffsetRandomAccessStream(std::unique_ptr<RandomAccessStream> stream,
+                           int64_t offset)
+      : stream_(std::move(stream)), offset_(offset) {}
+
+  Status PRead(int64_t position, int count,
+               util::Buffer* dest_buffer) override {
+    if (position < 0) {
+      return Status(util::error::INVALID_ARGUMENT, "position is negative");
+    }
+    return stream_->PRead(position + offset_, count, dest_buffer);
+  }
+
+  std::vector<Status> PReadV(absl::Span<const ReadRequest> requests) override {
+    std::vector<ReadRequest> shifted(requests.begin(), requests.end());
+    for (auto& request : shifted) request.position += offset_;
+    return stream_->PReadV(shifted);
+  }
+
+  StatusOr<int64_t> size() override {
+    auto size_result = stream_->size();
+    if (!size_result.ok()) return size_result.status();
+    return std::max<int64_t>(0, size_result.ValueOrDie() - offset_);
+  }
+
+ private:
+  const std::unique_ptr<RandomAccessStream> stream_;
+  const int64_t offset_;
+};
+
+}  // namespace
+
+// static
+StatusOr<std::unique_ptr<StreamingAead>> KmsEnvelopeStreamingAead::New(
+    const KeyTemplate& dek_template, std::unique_ptr<Aead> remote_aead) {
+  if (remote_aead == nullptr) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "remote_aead must be non-null");
+  }
+  auto km_result =
+      Registry::get_key_manager<StreamingAead>(dek_template.type_url());
+  if (!km_result.ok()) return km_result.status();
+  return {absl::WrapUnique(
+      new KmsEnvelopeStreamingAead(dek_template, std::move(remote_aead)))};
+}
+
+StatusOr<std::unique_ptr<StreamingAead>> KmsEnvelopeStreamingAead::UnwrapDek(
+    absl::string_view encrypted_dek) const {
+  auto dek_decrypt_result =
+      remote_aead_->Decrypt(encrypted_dek, kEmptyAssociatedData);
+  if (!dek_decrypt_result.ok()) return dek_decrypt_result.status();
+  KeyData dek;
+  dek.set_type_url(dek_template_.type_url());
+  dek.set_value(dek_decrypt_result.ValueOrDie());
+  dek.set_key_material_type(KeyData::SYMMETRIC);
+  return Registry::GetPrimitive<StreamingAead>(dek);
+}
+
+StatusOr<std::unique_ptr<OutputStream>>
+KmsEnvelopeStreamingAead::NewEncryptingStream(
+    std::unique_ptr<OutputStream> ciphertext_destination,
+    absl::string_view associated_data) {
+  if (ciphertext_destination == nullptr) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "ciphertext_destination must be non-null");
+  }
+  // Generate DEK.
+  auto dek_result = Registry::NewKeyData(dek_template_);
+  if (!dek_result.ok()) return dek_result.status();
+  auto dek = std::move(dek_result.ValueOrDie());
+  auto streaming_aead_result = Registry::GetPrimitive<StreamingAead>(*dek);
+  if (!streaming_aead_result.ok()) return streaming_aead_result.status();
+
+  // Wrap DEK key values with remote.
+  auto dek_encrypt_result =
+      remote_aead_->Encrypt(dek->value(), kEmptyAssociatedData);
+  if (!dek_encrypt_result.ok()) return dek_encrypt_result.status();
+  const std::string& encrypted_dek = dek_encrypt_result.ValueOrDie();
+  if (encrypted_dek.empty() || encrypted_dek.size() > kMaxEncryptedDekSize) {
+    return Status(util::error::INTERNAL, "unexpected size of encrypted DEK");
+  }
+
+  char prefix[kEncryptedDekPrefixSize];
+  absl::big_endian::Store32(prefix, encrypted_dek.size());
+  Status status = WriteFully(absl::string_view(prefix, sizeof(prefix)),
+                             ciphertext_destination.get());
+  if (!status.ok()) return status;
+  status = WriteFully(encrypted_dek, ciphertext_destination.get());
+  if (!status.ok()) return status;
+  return streaming_aead_result.ValueOrDie()->NewEncryptingStream(
+      std::move(ciphertext_destination), associated_data);
+}
+
+StatusOr<std::unique_ptr<InputStream>>
+KmsEnvelopeStreamingAead::NewDecryptingStream(
+    std::unique_ptr<InputStream> ciphertext_source,
+    absl::string_view associated_data) {
+  if (ciphertext_source == nullptr) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "ciphertext_source must be non-null");
+  }
+  std::string prefix;
+  Status status = ReadFully(kEncryptedDekPrefixSize, ciphertext_source.get(),
+                            &prefix);
+  if (!status.ok()) return status;
+  auto size_result = ParseEncryptedDekSize(prefix);
+  if (!size_result.ok()) return size_result.status();
+  std::string encrypted_dek;
+  status = ReadFully(size_result.ValueOrDie(), ciphertext_source.get(),
+                     &encrypted_dek);
+  if (!status.ok()) return status;
+
+  auto streaming_aead_result = UnwrapDek(encrypted_dek);
+  if (!streaming_aead_result.ok()) return streaming_aead_result.status();
+  return streaming_aead_result.ValueOrDie()->NewDecryptingStream(
+      std::move(ciphertext_source), associated_data);
+}
+
+StatusOr<std::unique_ptr<RandomAccessStream>>
+KmsEnvelopeStreamingAead::NewDecryptingRandomAccessStream(
+    std::unique_ptr<RandomAccessStream> ciphertext_source,
+    absl::string_view associated_data) {
+  if (ciphertext_source == nullptr) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "ciphertext_source must be non-null");
+  }
+  std::string prefix;
+  Status status = ReadFullyAt(0, kEncryptedDekPrefixSize,
+                              ciphertext_source.get(), &prefix);
+  if (!status.ok()) return status;
+  auto size_result = ParseEncryptedDekSize(prefix);
+  if (!size_result.ok()) return size_result.status();
+  int encrypted_dek_size = size_result.ValueOrDie();
+  std::string encrypted_dek;
+  status = ReadFullyAt(kEncryptedDekPrefixSize, encrypted_dek_size,
+                       ciphertext_source.get(), &encrypted_dek);
+  if (!status.ok()) return status;
+
+  auto streaming_aead_result = UnwrapDek(encrypted_dek);
+  if (!streaming_aead_result.ok()) return streaming_aead_result.status();
+  return streaming_aead_result.ValueOrDie()->NewDecryptingRandomAccessStream(
+      absl::make_unique<OffsetRandomAccessStream>(
+          std::move(ciphertext_source),
+          kEncryptedDekPrefixSize + encrypted_dek_size),
+      associated_data);
+}
+
+}  // namespace streamingaead
+}  // namespace tink
+}  // namespace crypto
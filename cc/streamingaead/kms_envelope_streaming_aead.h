@@ -0,0 +1,92 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_STREAMINGAEAD_KMS_ENVELOPE_STREAMING_AEAD_H_
+#define TINK_STREAMINGAEAD_KMS_ENVELOPE_STREAMING_AEAD_H_
+
+#include <memory>
+#include <utility>
+
+#include "absl/strings/string_view.h"
+#include "tink/aead.h"
+#include "tink/input_stream.h"
+#include "tink/output_stream.h"
+#include "tink/random_access_stream.h"
+#include "tink/streaming_aead.h"
+#include "tink/util/statusor.h"
+#include "proto/tink.pb.h"
+
+namespace crypto {
+namespace tink {
+namespace streamingaead {
+
+// KMS envelope encryption for streams, the streaming counterpart of
+// KmsEnvelopeAead: every stream is encrypted with a fresh data encryption
+// key (DEK) of 'dek_template', which must be a StreamingAead key template
+// such as AES128_GCM_HKDF_4KB. The DEK is wrapped with 'remote_aead' once
+// per stream, so that encrypting or decrypting an object of any size takes
+// one remote call and constant memory.
+//
+// The ciphertext structure is as follows:
+//  - Length of encrypted DEK: 4 bytes (big endian)
+//  - Encrypted DEK: variable length that is equal to the value
+//    specified in the last 4 bytes.
+//  - The ciphertext stream of the DEK.
+class KmsEnvelopeStreamingAead : public crypto::tink::StreamingAead {
+ public:
+  static crypto::tink::util::StatusOr<std::unique_ptr<StreamingAead>> New(
+      const google::crypto::tink::KeyTemplate& dek_template,
+      std::unique_ptr<Aead> remote_aead);
+
+  crypto::tink::util::StatusOr<std::unique_ptr<crypto::tink::OutputStream>>
+  NewEncryptingStream(
+      std::unique_ptr<crypto::tink::OutputStream> ciphertext_destination,
+      absl::string_view associated_data) override;
+
+  // Reads the encrypted DEK from 'ciphertext_source' and unwraps it before
+  // returning.
+  crypto::tink::util::StatusOr<std::unique_ptr<crypto::tink::InputStream>>
+  NewDecryptingStream(
+      std::unique_ptr<crypto::tink::InputStream> ciphertext_source,
+      absl::string_view associated_data) override;
+
+  crypto::tink::util::StatusOr<
+      std::unique_ptr<crypto::tink::RandomAccessStream>>
+  NewDecryptingRandomAccessStream(
+      std::unique_ptr<crypto::tink::RandomAccessStream> ciphertext_source,
+      absl::string_view associated_data) override;
+
+  ~KmsEnvelopeStreamingAead() override {}
+
+ private:
+  KmsEnvelopeStreamingAead(
+      const google::crypto::tink::KeyTemplate& dek_template,
+      std::unique_ptr<Aead> remote_aead)
+      : dek_template_(dek_template), remote_aead_(std::move(remote_aead)) {}
+
+  // Returns the StreamingAead of the DEK wrapped in 'encrypted_dek'.
+  crypto::tink::util::StatusOr<std::unique_ptr<StreamingAead>> UnwrapDek(
+      absl::string_view encrypted_dek) const;
+
+  const google::crypto::tink::KeyTemplate dek_template_;
+  const std::unique_ptr<Aead> remote_aead_;
+};
+
+}  // namespace streamingaead
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_STREAMINGAEAD_KMS_ENVELOPE_STREAMING_AEAD_H_
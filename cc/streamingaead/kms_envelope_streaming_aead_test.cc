@@ -0,0 +1,175 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/streamingaead/kms_envelope_streaming_aead.h"
+
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "tink/aead/aead_key_templates.h"
+#include "tink/input_stream.h"
+#include "tink/output_stream.h"
+#include "tink/random_access_stream.h"
+#include "tink/streaming_aead.h"
+#include "tink/streamingaead/streaming_aead_config.h"
+#include "tink/streamingaead/streaming_aead_key_templates.h"
+#include "tink/subtle/random.h"
+#include "tink/subtle/test_util.h"
+#include "tink/util/buffer.h"
+#include "tink/util/file_random_access_stream.h"
+#include "tink/util/istream_input_stream.h"
+#include "tink/util/ostream_output_stream.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "tink/util/test_matchers.h"
+#include "tink/util/test_util.h"
+
+namespace crypto {
+namespace tink {
+namespace streamingaead {
+namespace {
+
+using crypto::tink::test::DummyAead;
+using crypto::tink::test::IsOk;
+using crypto::tink::test::StatusIs;
+using subtle::test::ReadFromStream;
+using subtle::test::WriteToStream;
+
+class KmsEnvelopeStreamingAeadTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    ASSERT_THAT(StreamingAeadConfig::Register(), IsOk());
+  }
+
+  std::unique_ptr<StreamingAead> NewEnvelopeStreamingAead(
+      absl::string_view remote_name) {
+    auto saead_result = KmsEnvelopeStreamingAead::New(
+        StreamingAeadKeyTemplates::Aes128GcmHkdf4KB(),
+        absl::make_unique<DummyAead>(remote_name));
+    EXPECT_THAT(saead_result.status(), IsOk());
+    return std::move(saead_result.ValueOrDie());
+  }
+
+  // Returns the ciphertext of 'plaintext'.
+  std::string Encrypt(StreamingAead* saead, absl::string_view plaintext,
+                      absl::string_view aad) {
+    auto ct_stream = absl::make_unique<std::stringstream>();
+    auto ct_buf = ct_stream->rdbuf();
+    auto enc_stream_result = saead->NewEncryptingStream(
+        absl::make_unique<util::OstreamOutputStream>(std::move(ct_stream)),
+        aad);
+    EXPECT_THAT(enc_stream_result.status(), IsOk());
+    EXPECT_THAT(WriteToStream(enc_stream_result.ValueOrDie().get(), plaintext),
+                IsOk());
+    return ct_buf->str();
+  }
+
+  util::StatusOr<std::string> Decrypt(StreamingAead* saead,
+                                      absl::string_view ciphertext,
+                                      absl::string_view aad) {
+    auto dec_stream_result = saead->NewDecryptingStream(
+        absl::make_unique<util::IstreamInputStream>(
+            absl::make_unique<std::stringstream>(std::string(ciphertext))),
+        aad);
+    if (!dec_stream_result.ok()) return dec_stream_result.status();
+    std::string decrypted;
+    auto status =
+        ReadFromStream(dec_stream_result.ValueOrDie().get(), &decrypted);
+    if (!status.ok()) return status;
+    return decrypted;
+  }
+};
+
+TEST_F(KmsEnvelopeStreamingAeadTest, NullRemoteAead) {
+  EXPECT_THAT(KmsEnvelopeStreamingAead::New(
+                  StreamingAeadKeyTemplates::Aes128GcmHkdf4KB(), nullptr)
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST_F(KmsEnvelopeStreamingAeadTest, NotAStreamingAeadTemplate) {
+  EXPECT_FALSE(KmsEnvelopeStreamingAead::New(
+                   AeadKeyTemplates::Aes128Gcm(),
+                   absl::make_unique<DummyAead>("remote"))
+                   .ok());
+}
+
+TEST_F(KmsEnvelopeStreamingAeadTest, EncryptDecrypt) {
+  auto saead = NewEnvelopeStreamingAead("remote");
+  for (int pt_size : {0, 1, 100, 10000}) {
+    std::string plaintext = subtle::Random::GetRandomBytes(pt_size);
+    std::string ciphertext = Encrypt(saead.get(), plaintext, "aad");
+    auto decrypt_result = Decrypt(saead.get(), ciphertext, "aad");
+    ASSERT_THAT(decrypt_result.status(), IsOk());
+    EXPECT_EQ(decrypt_result.ValueOrDie(), plaintext);
+
+    EXPECT_FALSE(Decrypt(saead.get(), ciphertext, "other aad").ok());
+    auto other_saead = NewEnvelopeStreamingAead("other remote");
+    EXPECT_FALSE(Decrypt(other_saead.get(), ciphertext, "aad").ok());
+  }
+}
+
+TEST_F(KmsEnvelopeStreamingAeadTest, TruncatedHeader) {
+  auto saead = NewEnvelopeStreamingAead("remote");
+  std::string ciphertext = Encrypt(saead.get(), "plaintext", "");
+  for (int size : {0, 3, 4, 10}) {
+    EXPECT_THAT(Decrypt(saead.get(), ciphertext.substr(0, size), "").status(),
+                StatusIs(util::error::INVALID_ARGUMENT))
+        << "size=" << size;
+  }
+  // A zero length of the encrypted DEK.
+  EXPECT_THAT(
+      Decrypt(saead.get(), std::string(4, '\0') + ciphertext, "").status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST_F(KmsEnvelopeStreamingAeadTest, RandomAccessDecryption) {
+  auto saead = NewEnvelopeStreamingAead("remote");
+  std::string plaintext = subtle::Random::GetRandomBytes(20000);
+  std::string ciphertext = Encrypt(saead.get(), plaintext, "aad");
+  int input_fd =
+      test::GetTestFileDescriptor("kms_envelope_streaming_ct.txt", ciphertext);
+  auto dec_stream_result = saead->NewDecryptingRandomAccessStream(
+      absl::make_unique<util::FileRandomAccessStream>(input_fd), "aad");
+  ASSERT_THAT(dec_stream_result.status(), IsOk());
+  auto dec_stream = std::move(dec_stream_result.ValueOrDie());
+
+  auto size_result = dec_stream->size();
+  ASSERT_THAT(size_result.status(), IsOk());
+  EXPECT_EQ(size_result.ValueOrDie(), plaintext.size());
+  auto buffer = std::move(util::Buffer::New(1000).ValueOrDie());
+  for (int64_t position : {0, 1, 4095, 10000, 19000}) {
+    ASSERT_THAT(dec_stream->PRead(position, 1000, buffer.get()), IsOk());
+    EXPECT_EQ(std::string(buffer->get_mem_block(), buffer->size()),
+              plaintext.substr(position, 1000))
+        << "position=" << position;
+  }
+  EXPECT_THAT(dec_stream->PRead(19500, 1000, buffer.get()),
+              StatusIs(util::error::OUT_OF_RANGE));
+  EXPECT_EQ(std::string(buffer->get_mem_block(), buffer->size()),
+            plaintext.substr(19500));
+}
+
+}  // namespace
+}  // namespace streamingaead
+}  // namespace tink
+}  // namespace crypto
@@ -17,6 +17,9 @@
 #ifndef TINK_STREAMINGAEAD_SHARED_RANDOM_ACCESS_STREAM_H_
 #define TINK_STREAMINGAEAD_SHARED_RANDOM_ACCESS_STREAM_H_
 
+#include <vector>
+
+#include "absl/types/span.h"
 #include "tink/random_access_stream.h"
 #include "tink/util/buffer.h"
 #include "tink/util/status.h"
@@ -46,6 +49,11 @@ class SharedRandomAccessStream : public crypto::tink::RandomAccessStream {
     return random_access_stream_->PRead(position, count, dest_buffer);
   }
 
+  std::vector<crypto::tink::util::Status> PReadV(
+      absl::Span<const ReadRequest> requests) override {
+    return random_access_stream_->PReadV(requests);
+  }
+
   crypto::tink::util::StatusOr<int64_t> size() override {
     return random_access_stream_->size();
   }
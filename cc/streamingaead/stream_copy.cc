@@ -0,0 +1,182 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/streamingaead/stream_copy.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "tink/input_stream.h"
+#include "tink/output_stream.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+
+namespace crypto {
+namespace tink {
+namespace streamingaead {
+
+using crypto::tink::util::Status;
+
+namespace {
+
+// Writes the 'size' bytes of 'data' to 'output_stream'.
+Status WriteFully(const uint8_t* data, int64_t size,
+                  OutputStream* output_stream) {
+  while (size > 0) {
+    void* buffer;
+    auto next_result = output_stream->Next(&buffer);
+    if (!next_result.ok()) return next_result.status();
+    int count = static_cast<int>(
+        std::min<int64_t>(next_result.ValueOrDie(), size));
+    std::memcpy(buffer, data, count);
+    output_stream->BackUp(next_result.ValueOrDie() - count);
+    data += count;
+    size -= count;
+  }
+  return util::OkStatus();
+}
+
+// The chunks read by the reading task and not yet written, shared with it.
+struct ChunkQueue {
+  absl::Mutex mutex;
+  std::deque<util::SecretData> chunks ABSL_GUARDED_BY(mutex);
+  // Buffers of written chunks, for reuse by the next reads.
+  std::vector<util::SecretData> free_buffers ABSL_GUARDED_BY(mutex);
+  // The status of the last read, e.g. OUT_OF_RANGE at the end of the stream.
+  // No further reads are scheduled once it is not OK.
+  Status status ABSL_GUARDED_BY(mutex);
+  bool reading ABSL_GUARDED_BY(mutex) = false;  // true iff a task runs
+  bool stopped ABSL_GUARDED_BY(mutex) = false;  // true iff copying ended
+};
+
+// Schedules a task which reads chunks of 'source' until 'depth' chunks wait
+// to be written, the stream fails or ends, or copying is stopped. The task
+// does not block, so that it cannot starve a small thread pool.
+void ScheduleReads(InputStream* source, int depth,
+                   std::shared_ptr<ChunkQueue> queue,
+                   const std::function<void(std::function<void()>)>& schedule) {
+  schedule([source, depth, queue]() {
+    while (true) {
+      util::SecretData buffer;
+      {
+        absl::MutexLock lock(&queue->mutex);
+        if (queue->stopped ||
+            queue->chunks.size() >= static_cast<size_t>(depth)) {
+          queue->reading = false;
+          return;
+        }
+        if (!queue->free_buffers.empty()) {
+          buffer = std::move(queue->free_buffers.back());
+          queue->free_buffers.pop_back();
+        }
+      }
+      const void* data;
+      auto next_result = source->Next(&data);
+      if (next_result.ok()) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        buffer.assign(bytes, bytes + next_result.ValueOrDie());
+      }
+      absl::MutexLock lock(&queue->mutex);
+      if (!next_result.ok()) {
+        queue->status = next_result.status();
+        queue->reading = false;
+        return;
+      }
+      queue->chunks.push_back(std::move(buffer));
+    }
+  });
+}
+
+Status CopySequentially(InputStream* source, OutputStream* destination) {
+  while (true) {
+    const void* data;
+    auto next_result = source->Next(&data);
+    if (next_result.status().error_code() == util::error::OUT_OF_RANGE) {
+      return util::OkStatus();
+    }
+    if (!next_result.ok()) return next_result.status();
+    Status status = WriteFully(static_cast<const uint8_t*>(data),
+                               next_result.ValueOrDie(), destination);
+    if (!status.ok()) return status;
+  }
+}
+
+}  // namespace
+
+Status CopyStream(InputStream* source, OutputStream* destination,
+                  const CopyOptions& options) {
+  if (!options.schedule) return CopySequentially(source, destination);
+  if (options.max_chunks_in_flight <= 0) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "max_chunks_in_flight must be positive");
+  }
+
+  auto queue = std::make_shared<ChunkQueue>();
+  Status status;
+  while (true) {
+    bool schedule;
+    {
+      absl::MutexLock lock(&queue->mutex);
+      schedule = !queue->reading && queue->status.ok();
+      if (schedule) queue->reading = true;
+    }
+    if (schedule) {
+      ScheduleReads(source, options.max_chunks_in_flight, queue,
+                    options.schedule);
+    }
+    util::SecretData chunk;
+    {
+      absl::MutexLock lock(&queue->mutex);
+      queue->mutex.Await(absl::Condition(
+          +[](ChunkQueue* queue) {
+            return !queue->chunks.empty() || !queue->reading;
+          },
+          queue.get()));
+      if (queue->chunks.empty()) {
+        status = queue->status;
+        break;
+      }
+      chunk = std::move(queue->chunks.front());
+      queue->chunks.pop_front();
+    }
+    status = WriteFully(chunk.data(), chunk.size(), destination);
+    if (!status.ok()) break;
+    absl::MutexLock lock(&queue->mutex);
+    queue->free_buffers.push_back(std::move(chunk));
+  }
+
+  // 'source' must outlive the reading task.
+  absl::MutexLock lock(&queue->mutex);
+  queue->stopped = true;
+  queue->mutex.Await(absl::Condition(
+      +[](bool* reading) { return !*reading; }, &queue->reading));
+  if (status.error_code() == util::error::OUT_OF_RANGE) {
+    return util::OkStatus();
+  }
+  return status;
+}
+
+}  // namespace streamingaead
+}  // namespace tink
+}  // namespace crypto
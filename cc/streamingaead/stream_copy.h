@@ -0,0 +1,56 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TINK_STREAMINGAEAD_STREAM_COPY_H_
+#define TINK_STREAMINGAEAD_STREAM_COPY_H_
+
+#include <functional>
+
+#include "tink/input_stream.h"
+#include "tink/output_stream.h"
+#include "tink/util/status.h"
+
+namespace crypto {
+namespace tink {
+namespace streamingaead {
+
+// Options for CopyStream().
+struct CopyOptions {
+  // If set, the source is read on tasks run by 'schedule', e.g. on a thread
+  // pool owned by the caller, while the calling thread writes the chunks
+  // read so far, so that reading and writing overlap. This pays off when
+  // both are expensive, e.g. when a decrypting stream is copied to an
+  // encrypting stream. If null, the source is read on the calling thread.
+  std::function<void(std::function<void()>)> schedule;
+  // The maximal number of chunks read ahead of the one being written.
+  // Must be positive if 'schedule' is set.
+  int max_chunks_in_flight = 4;
+};
+
+// Writes all the bytes of 'source' to 'destination', which is not closed.
+// Since 'source' may be a decrypting stream, chunks read ahead are kept in
+// buffers which are wiped when they are freed. Returns an error if reading
+// (other than OUT_OF_RANGE at the end of 'source') or writing fails.
+crypto::tink::util::Status CopyStream(crypto::tink::InputStream* source,
+                                      crypto::tink::OutputStream* destination,
+                                      const CopyOptions& options);
+
+}  // namespace streamingaead
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_STREAMINGAEAD_STREAM_COPY_H_
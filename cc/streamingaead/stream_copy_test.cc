@@ -0,0 +1,154 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/streamingaead/stream_copy.h"
+
+#include <sstream>
+#include <string>
+#include <utility>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "tink/subtle/random.h"
+#include "tink/subtle/test_util.h"
+#include "tink/util/istream_input_stream.h"
+#include "tink/util/ostream_output_stream.h"
+#include "tink/util/status.h"
+#include "tink/util/test_matchers.h"
+
+namespace crypto {
+namespace tink {
+namespace streamingaead {
+namespace {
+
+using ::crypto::tink::subtle::Random;
+using ::crypto::tink::subtle::test::TestThreadPool;
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::crypto::tink::util::IstreamInputStream;
+using ::crypto::tink::util::OstreamOutputStream;
+using ::testing::Eq;
+
+// An InputStream which returns 'chunks' chunks of zeros, and then fails.
+class FailingInputStream : public InputStream {
+ public:
+  explicit FailingInputStream(int chunks) : chunks_(chunks) {}
+  util::StatusOr<int> Next(const void** data) override {
+    if (chunks_ == 0) {
+      return util::Status(util::error::INTERNAL, "Next failed");
+    }
+    chunks_--;
+    *data = buffer_;
+    return sizeof(buffer_);
+  }
+  void BackUp(int count) override {}
+  int64_t Position() const override { return 0; }
+
+ private:
+  int chunks_;
+  char buffer_[16] = {0};
+};
+
+// An OutputStream whose Next() fails.
+class FailingOutputStream : public OutputStream {
+ public:
+  util::StatusOr<int> Next(void** data) override {
+    return util::Status(util::error::INTERNAL, "Next failed");
+  }
+  void BackUp(int count) override {}
+  util::Status Close() override { return util::Status::OK; }
+  int64_t Position() const override { return 0; }
+};
+
+class StreamCopyTest : public ::testing::Test {
+ protected:
+  CopyOptions GetOptions(bool parallel, int max_chunks_in_flight) {
+    CopyOptions options;
+    options.max_chunks_in_flight = max_chunks_in_flight;
+    if (parallel) {
+      options.schedule = [this](std::function<void()> task) {
+        pool_.Schedule(std::move(task));
+      };
+    }
+    return options;
+  }
+
+  // A single thread, so that blocking tasks would block the copy.
+  TestThreadPool pool_{1};
+};
+
+TEST_F(StreamCopyTest, CopiesAllBytes) {
+  for (bool parallel : {false, true}) {
+    for (int max_chunks_in_flight : {1, 4}) {
+      for (int chunk_size : {1, 100, 4096}) {
+        for (int size : {0, 1, 100, 101, 100000}) {
+          SCOPED_TRACE(testing::Message()
+                       << "parallel: " << parallel << " max_chunks_in_flight: "
+                       << max_chunks_in_flight << " chunk_size: " << chunk_size
+                       << " size: " << size);
+          std::string data = Random::GetRandomBytes(size);
+          IstreamInputStream source(
+              absl::make_unique<std::stringstream>(data), chunk_size);
+          auto contents = absl::make_unique<std::stringstream>();
+          std::stringstream* contents_ptr = contents.get();
+          OstreamOutputStream destination(std::move(contents));
+          EXPECT_THAT(
+              CopyStream(&source, &destination,
+                         GetOptions(parallel, max_chunks_in_flight)),
+              IsOk());
+          EXPECT_THAT(destination.Close(), IsOk());
+          EXPECT_THAT(contents_ptr->str(), Eq(data));
+        }
+      }
+    }
+  }
+}
+
+TEST_F(StreamCopyTest, FailsIfReadingFails) {
+  for (bool parallel : {false, true}) {
+    SCOPED_TRACE(testing::Message() << "parallel: " << parallel);
+    FailingInputStream source(/*chunks=*/10);
+    OstreamOutputStream destination(absl::make_unique<std::stringstream>());
+    EXPECT_THAT(CopyStream(&source, &destination, GetOptions(parallel, 2)),
+                StatusIs(util::error::INTERNAL));
+  }
+}
+
+TEST_F(StreamCopyTest, FailsIfWritingFails) {
+  for (bool parallel : {false, true}) {
+    SCOPED_TRACE(testing::Message() << "parallel: " << parallel);
+    IstreamInputStream source(
+        absl::make_unique<std::stringstream>(Random::GetRandomBytes(10000)),
+        100);
+    FailingOutputStream destination;
+    EXPECT_THAT(CopyStream(&source, &destination, GetOptions(parallel, 2)),
+                StatusIs(util::error::INTERNAL));
+  }
+}
+
+TEST_F(StreamCopyTest, RejectsNonPositiveChunksInFlight) {
+  IstreamInputStream source(absl::make_unique<std::stringstream>("data"));
+  OstreamOutputStream destination(absl::make_unique<std::stringstream>());
+  EXPECT_THAT(CopyStream(&source, &destination, GetOptions(true, 0)),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace streamingaead
+}  // namespace tink
+}  // namespace crypto
@@ -21,8 +21,10 @@
 #include "tink/config/tink_fips.h"
 #include "tink/registry.h"
 #include "tink/streamingaead/aes_ctr_hmac_streaming_key_manager.h"
+#include "tink/streamingaead/aes_gcm_hkdf_adaptive_streaming_key_manager.h"
 #include "tink/streamingaead/aes_gcm_hkdf_streaming_key_manager.h"
 #include "tink/streamingaead/streaming_aead_wrapper.h"
+#include "tink/streamingaead/xchacha20_poly1305_hkdf_streaming_key_manager.h"
 #include "tink/util/status.h"
 
 using google::crypto::tink::RegistryConfig;
@@ -48,12 +50,20 @@ util::Status StreamingAeadConfig::Register() {
     return util::OkStatus();
   }
 
-  status = Registry::RegisterKeyTypeManager(
-      absl::make_unique<AesGcmHkdfStreamingKeyManager>(), true);
+  status = Registry::RegisterKeyTypeManagerLazily<
+      AesGcmHkdfStreamingKeyManager>(true);
   if (!status.ok()) return status;
 
-  status = Registry::RegisterKeyTypeManager(
-      absl::make_unique<AesCtrHmacStreamingKeyManager>(), true);
+  status = Registry::RegisterKeyTypeManagerLazily<
+      AesCtrHmacStreamingKeyManager>(true);
+  if (!status.ok()) return status;
+
+  status = Registry::RegisterKeyTypeManagerLazily<
+      AesGcmHkdfAdaptiveStreamingKeyManager>(true);
+  if (!status.ok()) return status;
+
+  status = Registry::RegisterKeyTypeManagerLazily<
+      XChaCha20Poly1305HkdfStreamingKeyManager>(true);
   if (!status.ok()) return status;
 
   return util::OkStatus();
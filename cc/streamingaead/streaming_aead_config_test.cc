@@ -28,8 +28,10 @@
 #include "tink/registry.h"
 #include "tink/streaming_aead.h"
 #include "tink/streamingaead/aes_ctr_hmac_streaming_key_manager.h"
+#include "tink/streamingaead/aes_gcm_hkdf_adaptive_streaming_key_manager.h"
 #include "tink/streamingaead/aes_gcm_hkdf_streaming_key_manager.h"
 #include "tink/streamingaead/streaming_aead_key_templates.h"
+#include "tink/streamingaead/xchacha20_poly1305_hkdf_streaming_key_manager.h"
 #include "tink/util/status.h"
 #include "tink/util/test_matchers.h"
 #include "tink/util/test_util.h"
@@ -60,6 +62,14 @@ TEST_F(StreamingAeadConfigTest, Basic) {
                   AesCtrHmacStreamingKeyManager().get_key_type())
                   .status(),
               StatusIs(util::error::NOT_FOUND));
+  EXPECT_THAT(Registry::get_key_manager<StreamingAead>(
+                  AesGcmHkdfAdaptiveStreamingKeyManager().get_key_type())
+                  .status(),
+              StatusIs(util::error::NOT_FOUND));
+  EXPECT_THAT(Registry::get_key_manager<StreamingAead>(
+                  XChaCha20Poly1305HkdfStreamingKeyManager().get_key_type())
+                  .status(),
+              StatusIs(util::error::NOT_FOUND));
   EXPECT_THAT(StreamingAeadConfig::Register(), IsOk());
   EXPECT_THAT(Registry::get_key_manager<StreamingAead>(
                   AesGcmHkdfStreamingKeyManager().get_key_type())
@@ -69,6 +79,14 @@ TEST_F(StreamingAeadConfigTest, Basic) {
                   AesCtrHmacStreamingKeyManager().get_key_type())
                   .status(),
               IsOk());
+  EXPECT_THAT(Registry::get_key_manager<StreamingAead>(
+                  AesGcmHkdfAdaptiveStreamingKeyManager().get_key_type())
+                  .status(),
+              IsOk());
+  EXPECT_THAT(Registry::get_key_manager<StreamingAead>(
+                  XChaCha20Poly1305HkdfStreamingKeyManager().get_key_type())
+                  .status(),
+              IsOk());
 }
 
 // Tests that the StreamingAeadWrapper has been properly registered
@@ -117,6 +135,10 @@ TEST_F(StreamingAeadConfigTest, RegisterNonFipsTemplates) {
       StreamingAeadKeyTemplates::Aes256GcmHkdf1MB());
   non_fips_key_templates.push_back(
       StreamingAeadKeyTemplates::Aes256GcmHkdf4KB());
+  non_fips_key_templates.push_back(
+      StreamingAeadKeyTemplates::Aes256GcmHkdfAdaptive());
+  non_fips_key_templates.push_back(
+      StreamingAeadKeyTemplates::XChaCha20Poly1305Hkdf4KB());
 
   for (auto key_template : non_fips_key_templates) {
     EXPECT_THAT(KeysetHandle::GenerateNew(key_template).status(),
@@ -20,12 +20,15 @@
 #include "proto/aes_gcm_hkdf_streaming.pb.h"
 #include "proto/common.pb.h"
 #include "proto/tink.pb.h"
+#include "proto/xchacha20_poly1305_hkdf_streaming.pb.h"
 
 using google::crypto::tink::AesCtrHmacStreamingKeyFormat;
+using google::crypto::tink::AesGcmHkdfAdaptiveStreamingKeyFormat;
 using google::crypto::tink::AesGcmHkdfStreamingKeyFormat;
 using google::crypto::tink::HashType;
 using google::crypto::tink::KeyTemplate;
 using google::crypto::tink::OutputPrefixType;
+using google::crypto::tink::XChaCha20Poly1305HkdfStreamingKeyFormat;
 
 namespace crypto {
 namespace tink {
@@ -48,6 +51,23 @@ KeyTemplate* NewAesGcmHkdfStreamingKeyTemplate(int ikm_size_in_bytes,
   return key_template;
 }
 
+KeyTemplate* NewAesGcmHkdfAdaptiveStreamingKeyTemplate(int ikm_size_in_bytes) {
+  KeyTemplate* key_template = new KeyTemplate;
+  key_template->set_type_url(
+      "type.googleapis.com/google.crypto.tink.AesGcmHkdfAdaptiveStreamingKey");
+  key_template->set_output_prefix_type(OutputPrefixType::RAW);
+  AesGcmHkdfAdaptiveStreamingKeyFormat key_format;
+  key_format.set_key_size(ikm_size_in_bytes);
+  auto params = key_format.mutable_params();
+  for (int segment_size_in_bytes : {4096, 65536, 1048576}) {
+    params->add_ciphertext_segment_sizes(segment_size_in_bytes);
+  }
+  params->set_derived_key_size(ikm_size_in_bytes);
+  params->set_hkdf_hash_type(HashType::SHA256);
+  key_format.SerializeToString(key_template->mutable_value());
+  return key_template;
+}
+
 KeyTemplate* NewAesCtrHmacStreamingKeyTemplate(int ikm_size_in_bytes) {
   KeyTemplate* key_template = new KeyTemplate;
   key_template->set_type_url(
@@ -66,6 +86,22 @@ KeyTemplate* NewAesCtrHmacStreamingKeyTemplate(int ikm_size_in_bytes) {
   return key_template;
 }
 
+KeyTemplate* NewXChaCha20Poly1305HkdfStreamingKeyTemplate(
+    int segment_size_in_bytes) {
+  KeyTemplate* key_template = new KeyTemplate;
+  key_template->set_type_url(
+      "type.googleapis.com/"
+      "google.crypto.tink.XChaCha20Poly1305HkdfStreamingKey");
+  key_template->set_output_prefix_type(OutputPrefixType::RAW);
+  XChaCha20Poly1305HkdfStreamingKeyFormat key_format;
+  key_format.set_key_size(32);
+  auto params = key_format.mutable_params();
+  params->set_ciphertext_segment_size(segment_size_in_bytes);
+  params->set_hkdf_hash_type(HashType::SHA256);
+  key_format.SerializeToString(key_template->mutable_value());
+  return key_template;
+}
+
 }  // anonymous namespace
 
 // static
@@ -90,6 +126,12 @@ const KeyTemplate& StreamingAeadKeyTemplates::Aes256GcmHkdf1MB() {
 }
 
 // static
+const KeyTemplate& StreamingAeadKeyTemplates::Aes256GcmHkdfAdaptive() {
+  static const KeyTemplate* key_template =
+      NewAesGcmHkdfAdaptiveStreamingKeyTemplate(/* ikm_size_in_bytes= */ 32);
+  return *key_template;
+}
+
 const KeyTemplate& StreamingAeadKeyTemplates::Aes128CtrHmacSha256Segment4KB() {
   static const KeyTemplate* key_template =
       NewAesCtrHmacStreamingKeyTemplate(/* ikm_size_in_bytes= */ 16);
@@ -103,5 +145,13 @@ const KeyTemplate& StreamingAeadKeyTemplates::Aes256CtrHmacSha256Segment4KB() {
   return *key_template;
 }
 
+// static
+const KeyTemplate& StreamingAeadKeyTemplates::XChaCha20Poly1305Hkdf4KB() {
+  static const KeyTemplate* key_template =
+      NewXChaCha20Poly1305HkdfStreamingKeyTemplate(
+          /* segment_size_in_bytes= */ 4096);
+  return *key_template;
+}
+
 }  // namespace tink
 }  // namespace crypto
@@ -62,6 +62,15 @@ class StreamingAeadKeyTemplates {
   //   - OutputPrefixType: RAW
   static const google::crypto::tink::KeyTemplate& Aes256GcmHkdf1MB();
 
+  // Returns a KeyTemplate that generates new instances of
+  // AesGcmHkdfAdaptiveStreamingKey with the following parameters:
+  //   - main key (ikm) size: 32 bytes
+  //   - HKDF algorithm: HMAC-SHA256
+  //   - size of derived AES-GCM keys: 32 bytes
+  //   - ciphertext segment sizes: 4096, 65536 and 1048576 bytes
+  //   - OutputPrefixType: RAW
+  static const google::crypto::tink::KeyTemplate& Aes256GcmHkdfAdaptive();
+
   // Returns a KeyTemplate that generates new instances of
   // AesCtrHmacStreamingKey with the following parameters:
   //   - main key (ikm) size: 16 bytes
@@ -85,6 +94,14 @@ class StreamingAeadKeyTemplates {
   //   - OutputPrefixType: RAW
   static const google::crypto::tink::KeyTemplate&
   Aes256CtrHmacSha256Segment4KB();
+
+  // Returns a KeyTemplate that generates new instances of
+  // XChaCha20Poly1305HkdfStreamingKey with the following parameters:
+  //   - main key (ikm) size: 32 bytes
+  //   - HKDF algorithm: HMAC-SHA256
+  //   - ciphertext segment size: 4096 bytes
+  //   - OutputPrefixType: RAW
+  static const google::crypto::tink::KeyTemplate& XChaCha20Poly1305Hkdf4KB();
 };
 
 }  // namespace tink
@@ -19,24 +19,30 @@
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "tink/streamingaead/aes_ctr_hmac_streaming_key_manager.h"
+#include "tink/streamingaead/aes_gcm_hkdf_adaptive_streaming_key_manager.h"
 #include "tink/streamingaead/aes_gcm_hkdf_streaming_key_manager.h"
+#include "tink/streamingaead/xchacha20_poly1305_hkdf_streaming_key_manager.h"
 #include "tink/util/test_matchers.h"
 #include "proto/aes_ctr_hmac_streaming.pb.h"
 #include "proto/aes_gcm_hkdf_streaming.pb.h"
 #include "proto/common.pb.h"
 #include "proto/tink.pb.h"
+#include "proto/xchacha20_poly1305_hkdf_streaming.pb.h"
 
 using google::crypto::tink::AesCtrHmacStreamingKeyFormat;
+using google::crypto::tink::AesGcmHkdfAdaptiveStreamingKeyFormat;
 using google::crypto::tink::AesGcmHkdfStreamingKeyFormat;
 using google::crypto::tink::HashType;
 using google::crypto::tink::KeyTemplate;
 using google::crypto::tink::OutputPrefixType;
+using google::crypto::tink::XChaCha20Poly1305HkdfStreamingKeyFormat;
 
 namespace crypto {
 namespace tink {
 namespace {
 
 using ::crypto::tink::test::IsOk;
+using ::testing::ElementsAre;
 using ::testing::Eq;
 using ::testing::Ref;
 
@@ -160,6 +166,48 @@ TEST(Aes256GcmHkdf1MBTest, CheckValues) {
   EXPECT_THAT(key_format.params().hkdf_hash_type(), Eq(HashType::SHA256));
 }
 
+TEST(Aes256GcmHkdfAdaptiveTest, TypeUrl) {
+  EXPECT_THAT(StreamingAeadKeyTemplates::Aes256GcmHkdfAdaptive().type_url(),
+              Eq("type.googleapis.com/"
+                 "google.crypto.tink.AesGcmHkdfAdaptiveStreamingKey"));
+  EXPECT_THAT(StreamingAeadKeyTemplates::Aes256GcmHkdfAdaptive().type_url(),
+              Eq(AesGcmHkdfAdaptiveStreamingKeyManager().get_key_type()));
+}
+
+TEST(Aes256GcmHkdfAdaptiveTest, OutputPrefixType) {
+  EXPECT_THAT(
+      StreamingAeadKeyTemplates::Aes256GcmHkdfAdaptive().output_prefix_type(),
+      Eq(OutputPrefixType::RAW));
+}
+
+TEST(Aes256GcmHkdfAdaptiveTest, SameReference) {
+  // Check that reference to the same object is returned.
+  EXPECT_THAT(StreamingAeadKeyTemplates::Aes256GcmHkdfAdaptive(),
+              Ref(StreamingAeadKeyTemplates::Aes256GcmHkdfAdaptive()));
+}
+
+TEST(Aes256GcmHkdfAdaptiveTest, WorksWithKeyTypeManager) {
+  const KeyTemplate& key_template =
+      StreamingAeadKeyTemplates::Aes256GcmHkdfAdaptive();
+  AesGcmHkdfAdaptiveStreamingKeyFormat key_format;
+  EXPECT_TRUE(key_format.ParseFromString(key_template.value()));
+  EXPECT_THAT(
+      AesGcmHkdfAdaptiveStreamingKeyManager().ValidateKeyFormat(key_format),
+      IsOk());
+}
+
+TEST(Aes256GcmHkdfAdaptiveTest, CheckValues) {
+  const KeyTemplate& key_template =
+      StreamingAeadKeyTemplates::Aes256GcmHkdfAdaptive();
+  AesGcmHkdfAdaptiveStreamingKeyFormat key_format;
+  EXPECT_TRUE(key_format.ParseFromString(key_template.value()));
+  EXPECT_THAT(key_format.key_size(), Eq(32));
+  EXPECT_THAT(key_format.params().derived_key_size(), Eq(32));
+  EXPECT_THAT(key_format.params().ciphertext_segment_sizes(),
+              ElementsAre(4096, 65536, 1048576));
+  EXPECT_THAT(key_format.params().hkdf_hash_type(), Eq(HashType::SHA256));
+}
+
 TEST(Aes128CtrHmacSha256Segment4KBTest, TypeUrl) {
   EXPECT_THAT(
       StreamingAeadKeyTemplates::Aes128CtrHmacSha256Segment4KB().type_url(),
@@ -246,6 +294,46 @@ TEST(Aes256CtrHmacSha256Segment4KBTest, CheckValues) {
   EXPECT_THAT(key_format.params().hmac_params().tag_size(), Eq(32));
 }
 
+TEST(XChaCha20Poly1305Hkdf4KBTest, TypeUrl) {
+  EXPECT_THAT(StreamingAeadKeyTemplates::XChaCha20Poly1305Hkdf4KB().type_url(),
+              Eq("type.googleapis.com/"
+                 "google.crypto.tink.XChaCha20Poly1305HkdfStreamingKey"));
+  EXPECT_THAT(StreamingAeadKeyTemplates::XChaCha20Poly1305Hkdf4KB().type_url(),
+              Eq(XChaCha20Poly1305HkdfStreamingKeyManager().get_key_type()));
+}
+
+TEST(XChaCha20Poly1305Hkdf4KBTest, OutputPrefixType) {
+  EXPECT_THAT(StreamingAeadKeyTemplates::XChaCha20Poly1305Hkdf4KB()
+                  .output_prefix_type(),
+              Eq(OutputPrefixType::RAW));
+}
+
+TEST(XChaCha20Poly1305Hkdf4KBTest, SameReference) {
+  // Check that reference to the same object is returned.
+  EXPECT_THAT(StreamingAeadKeyTemplates::XChaCha20Poly1305Hkdf4KB(),
+              Ref(StreamingAeadKeyTemplates::XChaCha20Poly1305Hkdf4KB()));
+}
+
+TEST(XChaCha20Poly1305Hkdf4KBTest, WorksWithKeyTypeManager) {
+  const KeyTemplate& key_template =
+      StreamingAeadKeyTemplates::XChaCha20Poly1305Hkdf4KB();
+  XChaCha20Poly1305HkdfStreamingKeyFormat key_format;
+  EXPECT_TRUE(key_format.ParseFromString(key_template.value()));
+  EXPECT_THAT(
+      XChaCha20Poly1305HkdfStreamingKeyManager().ValidateKeyFormat(key_format),
+      IsOk());
+}
+
+TEST(XChaCha20Poly1305Hkdf4KBTest, CheckValues) {
+  const KeyTemplate& key_template =
+      StreamingAeadKeyTemplates::XChaCha20Poly1305Hkdf4KB();
+  XChaCha20Poly1305HkdfStreamingKeyFormat key_format;
+  EXPECT_TRUE(key_format.ParseFromString(key_template.value()));
+  EXPECT_THAT(key_format.key_size(), Eq(32));
+  EXPECT_THAT(key_format.params().ciphertext_segment_size(), Eq(4096));
+  EXPECT_THAT(key_format.params().hkdf_hash_type(), Eq(HashType::SHA256));
+}
+
 }  // namespace
 }  // namespace tink
 }  // namespace crypto
@@ -16,14 +16,28 @@
 
 #include "tink/streamingaead/streaming_aead_wrapper.h"
 
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
 #include "tink/streaming_aead.h"
 #include "tink/crypto_format.h"
 #include "tink/input_stream.h"
+#include "tink/internal/monitoring_util.h"
+#include "tink/key_usage.h"
+#include "tink/memory_stats.h"
+#include "tink/monitoring.h"
 #include "tink/output_stream.h"
 #include "tink/primitive_set.h"
 #include "tink/random_access_stream.h"
+#include "tink/streamingaead/buffered_input_stream.h"
 #include "tink/streamingaead/decrypting_input_stream.h"
 #include "tink/streamingaead/decrypting_random_access_stream.h"
+#include "tink/streamingaead/key_id_hint.h"
+#include "tink/streamingaead/shared_input_stream.h"
+#include "tink/streamingaead/stream_copy.h"
 #include "tink/util/status.h"
 #include "tink/util/statusor.h"
 
@@ -52,11 +66,16 @@ Status Validate(PrimitiveSet<StreamingAead>* primitives) {
   return Status::OK;
 }
 
-class StreamingAeadSetWrapper: public StreamingAead {
+class StreamingAeadSetWrapper : public StreamingAead,
+                                public MemoryStatsSource,
+                                public KeyUsageSource {
  public:
   explicit StreamingAeadSetWrapper(
       std::unique_ptr<PrimitiveSet<StreamingAead>> primitives)
-      : primitives_(std::move(primitives)) {}
+      : monitoring_(internal::MonitoringRecorder::ForPrimitiveSet(
+            *primitives, "streaming_aead")),
+        primitives_(std::move(primitives)),
+        last_matching_key_(std::make_shared<streamingaead::KeyIdHint>()) {}
 
   crypto::tink::util::StatusOr<std::unique_ptr<crypto::tink::OutputStream>>
   NewEncryptingStream(
@@ -74,23 +93,59 @@ class StreamingAeadSetWrapper: public StreamingAead {
       std::unique_ptr<crypto::tink::RandomAccessStream> ciphertext_source,
       absl::string_view associated_data) override;
 
+  crypto::tink::util::StatusOr<std::string> EncryptSmall(
+      absl::string_view plaintext, absl::string_view associated_data) override;
+
+  crypto::tink::util::StatusOr<std::string> DecryptSmall(
+      absl::string_view ciphertext, absl::string_view associated_data) override;
+
+  crypto::tink::util::Status ReEncrypt(
+      std::unique_ptr<crypto::tink::InputStream> ciphertext_source,
+      std::unique_ptr<crypto::tink::OutputStream> ciphertext_destination,
+      absl::string_view associated_data, ReEncryptOptions options) override;
+
+  MemoryStats GetMemoryStats() const override {
+    return primitives_->GetMemoryStats("streaming_aead", sizeof(*this));
+  }
+
+  std::vector<KeyUsage> GetKeyUsage() const override {
+    return primitives_->GetKeyUsage();
+  }
+
   ~StreamingAeadSetWrapper() override {}
 
  private:
+  // Decrypting streams find their key on the first read, so only encrypting
+  // streams and the one-shot methods are monitored.
+  internal::MonitoringRecorder monitoring_;
   // We use a shared_ptr here to ensure that primitives_ stays alive
   // as long as it might be needed by some decrypting stream returned
   // by NewDecryptingStream.  This can happen after this wrapper
   // is destroyed, as we refer to primitives_ only when the user attempts
   // to read some data from the decrypting stream.
   std::shared_ptr<PrimitiveSet<StreamingAead>> primitives_;
+  // The key of the last stream decrypted via this wrapper, which is tried
+  // first by the next decrypting streams: consecutive streams are usually
+  // encrypted with the same key.
+  std::shared_ptr<streamingaead::KeyIdHint> last_matching_key_;
 };  // class StreamingAeadSetWrapper
 
 StatusOr<std::unique_ptr<OutputStream>>
 StreamingAeadSetWrapper::NewEncryptingStream(
     std::unique_ptr<OutputStream> ciphertext_destination,
     absl::string_view associated_data) {
-  return primitives_->get_primary()->get_primitive().NewEncryptingStream(
-          std::move(ciphertext_destination), associated_data);
+  int64_t start = monitoring_.Start();
+  auto primary = primitives_->get_primary();
+  auto stream_result = primary->get_primitive().NewEncryptingStream(
+      std::move(ciphertext_destination), associated_data);
+  if (!stream_result.ok()) {
+    monitoring_.RecordFailure(start, MonitoringOperation::kNewEncryptingStream,
+                              /*num_bytes=*/0);
+    return stream_result;
+  }
+  monitoring_.RecordSuccess(start, MonitoringOperation::kNewEncryptingStream,
+                            primary->get_key_id(), /*num_bytes=*/0);
+  return stream_result;
 }
 
 StatusOr<std::unique_ptr<InputStream>>
@@ -98,7 +153,9 @@ StreamingAeadSetWrapper::NewDecryptingStream(
     std::unique_ptr<InputStream> ciphertext_source,
     absl::string_view associated_data) {
   return {streamingaead::DecryptingInputStream::New(
-      primitives_, std::move(ciphertext_source), associated_data)};
+      primitives_, std::move(ciphertext_source), associated_data,
+      streamingaead::BufferedInputStream::PrefetchOptions(),
+      last_matching_key_)};
 }
 
 StatusOr<std::unique_ptr<RandomAccessStream>>
@@ -106,7 +163,106 @@ StreamingAeadSetWrapper::NewDecryptingRandomAccessStream(
     std::unique_ptr<RandomAccessStream> ciphertext_source,
     absl::string_view associated_data) {
   return {streamingaead::DecryptingRandomAccessStream::New(
-      primitives_, std::move(ciphertext_source), associated_data)};
+      primitives_, std::move(ciphertext_source), associated_data,
+      last_matching_key_)};
+}
+
+StatusOr<std::string> StreamingAeadSetWrapper::EncryptSmall(
+    absl::string_view plaintext, absl::string_view associated_data) {
+  int64_t start = monitoring_.Start();
+  auto primary = primitives_->get_primary();
+  auto encrypt_result =
+      primary->get_primitive().EncryptSmall(plaintext, associated_data);
+  if (!encrypt_result.ok()) {
+    monitoring_.RecordFailure(start, MonitoringOperation::kEncrypt,
+                              plaintext.size());
+    return encrypt_result;
+  }
+  monitoring_.RecordSuccess(start, MonitoringOperation::kEncrypt,
+                            primary->get_key_id(), plaintext.size());
+  return encrypt_result;
+}
+
+StatusOr<std::string> StreamingAeadSetWrapper::DecryptSmall(
+    absl::string_view ciphertext, absl::string_view associated_data) {
+  int64_t start = monitoring_.Start();
+  auto primitives_result = streamingaead::GetPrimitivesInTrialOrder(
+      *primitives_, last_matching_key_.get());
+  if (!primitives_result.ok()) return primitives_result.status();
+  for (const auto* primitive : primitives_result.ValueOrDie()) {
+    auto decrypt_result =
+        primitive->get_primitive().DecryptSmall(ciphertext, associated_data);
+    if (decrypt_result.ok()) {
+      primitive->RecordDecryption();
+      last_matching_key_->Set(primitive->get_key_id());
+      monitoring_.RecordSuccess(start, MonitoringOperation::kDecrypt,
+                                primitive->get_key_id(), ciphertext.size());
+      return decrypt_result;
+    }
+  }
+  monitoring_.RecordFailure(start, MonitoringOperation::kDecrypt,
+                            ciphertext.size());
+  return Status(util::error::INVALID_ARGUMENT,
+                "Could not find a decrypter matching the ciphertext.");
+}
+
+Status StreamingAeadSetWrapper::ReEncrypt(
+    std::unique_ptr<InputStream> ciphertext_source,
+    std::unique_ptr<OutputStream> ciphertext_destination,
+    absl::string_view associated_data, ReEncryptOptions options) {
+  streamingaead::CopyOptions copy_options;
+  copy_options.schedule = std::move(options.schedule);
+  copy_options.max_chunks_in_flight = options.max_chunks_in_flight;
+  if (copy_options.schedule && copy_options.max_chunks_in_flight <= 0) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "max_chunks_in_flight must be positive");
+  }
+
+  // Streaming ciphertexts have no output prefix, so whether the primary
+  // encrypted the ciphertext is checked by decrypting its first segment.
+  auto buffered_source = absl::make_unique<streamingaead::BufferedInputStream>(
+      std::move(ciphertext_source));
+  bool encrypted_with_primary = false;
+  {
+    auto decrypting_result =
+        primitives_->get_primary()->get_primitive().NewDecryptingStream(
+            absl::make_unique<streamingaead::SharedInputStream>(
+                buffered_source.get()),
+            associated_data);
+    if (decrypting_result.ok()) {
+      const void* data;
+      encrypted_with_primary =
+          decrypting_result.ValueOrDie()->Next(&data).ok();
+    }
+  }
+  Status status = buffered_source->Rewind();
+  if (!status.ok()) return status;
+  buffered_source->DisableRewinding();
+
+  if (encrypted_with_primary) {
+    // The rest of the ciphertext is not authenticated: if it is invalid,
+    // it fails to decrypt just like before.
+    status = streamingaead::CopyStream(
+        buffered_source.get(), ciphertext_destination.get(), copy_options);
+    if (!status.ok()) return status;
+    return ciphertext_destination->Close();
+  }
+
+  // The plaintext is copied straight from the decrypting stream to the
+  // encrypting stream, or through wiped buffers if 'schedule' is set.
+  auto decrypting_result = streamingaead::DecryptingInputStream::New(
+      primitives_, std::move(buffered_source), associated_data,
+      streamingaead::BufferedInputStream::PrefetchOptions(),
+      last_matching_key_);
+  if (!decrypting_result.ok()) return decrypting_result.status();
+  auto encrypting_result = NewEncryptingStream(
+      std::move(ciphertext_destination), associated_data);
+  if (!encrypting_result.ok()) return encrypting_result.status();
+  status = streamingaead::CopyStream(decrypting_result.ValueOrDie().get(),
+                                     encrypting_result.ValueOrDie().get(),
+                                     copy_options);
+  if (!status.ok()) return status;
+  return encrypting_result.ValueOrDie()->Close();
 }
 
 }  // anonymous namespace
@@ -16,6 +16,7 @@
 
 #include "tink/streamingaead/streaming_aead_wrapper.h"
 
+#include <functional>
 #include <sstream>
 
 #include "gtest/gtest.h"
@@ -188,6 +189,95 @@ TEST(StreamingAeadSetWrapperTest, BasicEncryptionAndDecryption) {
   }
 }
 
+TEST(StreamingAeadSetWrapperTest, EncryptSmallAndDecryptSmall) {
+  uint32_t key_id_0 = 1234543;
+  uint32_t key_id_1 = 726329;
+  std::string saead_name_0 = "streaming_aead0";
+  std::string saead_name_1 = "streaming_aead1";
+
+  StreamingAeadWrapper wrapper;
+  auto wrap_result = wrapper.Wrap(GetTestStreamingAeadSet(
+      {{key_id_0, saead_name_0, OutputPrefixType::RAW},
+       {key_id_1, saead_name_1, OutputPrefixType::RAW}}));
+  ASSERT_THAT(wrap_result.status(), IsOk());
+  auto saead = std::move(wrap_result.ValueOrDie());
+  std::string plaintext = subtle::Random::GetRandomBytes(100);
+  std::string aad = "some_aad";
+
+  // Encrypts with the primary.
+  auto encrypt_result = saead->EncryptSmall(plaintext, aad);
+  ASSERT_THAT(encrypt_result.status(), IsOk());
+  EXPECT_EQ(absl::StrCat(saead_name_1, aad, plaintext),
+            encrypt_result.ValueOrDie());
+
+  // Decrypts with any key, as the decrypting streams.
+  for (const std::string& saead_name : {saead_name_0, saead_name_1}) {
+    SCOPED_TRACE(saead_name);
+    auto decrypt_result =
+        saead->DecryptSmall(absl::StrCat(saead_name, aad, plaintext), aad);
+    ASSERT_THAT(decrypt_result.status(), IsOk());
+    EXPECT_EQ(plaintext, decrypt_result.ValueOrDie());
+  }
+  EXPECT_THAT(
+      saead->DecryptSmall(absl::StrCat("other_saead", aad, plaintext), aad)
+          .status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(StreamingAeadSetWrapperTest, ReEncrypt) {
+  uint32_t key_id_0 = 1234543;
+  uint32_t key_id_1 = 726329;
+  std::string saead_name_0 = "streaming_aead0";
+  std::string saead_name_1 = "streaming_aead1";
+
+  StreamingAeadWrapper wrapper;
+  auto wrap_result = wrapper.Wrap(GetTestStreamingAeadSet(
+      {{key_id_0, saead_name_0, OutputPrefixType::RAW},
+       {key_id_1, saead_name_1, OutputPrefixType::RAW}}));
+  ASSERT_THAT(wrap_result.status(), IsOk());
+  auto saead = std::move(wrap_result.ValueOrDie());
+  subtle::test::TestThreadPool pool(2);
+  std::string aad = "some_aad";
+  for (bool parallel : {false, true}) {
+    for (int pt_size : {0, 1, 100, 100000}) {
+      std::string plaintext = subtle::Random::GetRandomBytes(pt_size);
+      // Ciphertexts of either key result in a ciphertext of the primary.
+      for (const std::string& saead_name : {saead_name_0, saead_name_1}) {
+        SCOPED_TRACE(absl::StrCat("parallel: ", parallel, " pt_size: ",
+                                  pt_size, " saead_name: ", saead_name));
+        StreamingAead::ReEncryptOptions options;
+        if (parallel) {
+          options.schedule = [&pool](std::function<void()> task) {
+            pool.Schedule(std::move(task));
+          };
+        }
+        // ReEncrypt() destroys the destination, which writes to 'ciphertext'.
+        std::stringstream ciphertext;
+        auto status = saead->ReEncrypt(
+            absl::make_unique<util::IstreamInputStream>(
+                absl::make_unique<std::stringstream>(
+                    absl::StrCat(saead_name, aad, plaintext))),
+            absl::make_unique<util::OstreamOutputStream>(
+                absl::make_unique<std::ostream>(ciphertext.rdbuf())),
+            aad, options);
+        ASSERT_THAT(status, IsOk());
+        EXPECT_EQ(absl::StrCat(saead_name_1, aad, plaintext), ciphertext.str());
+      }
+    }
+  }
+
+  for (const std::string& ciphertext :
+       {absl::StrCat("other_saead", aad, "plaintext"), std::string()}) {
+    auto status = saead->ReEncrypt(
+        absl::make_unique<util::IstreamInputStream>(
+            absl::make_unique<std::stringstream>(ciphertext)),
+        absl::make_unique<util::OstreamOutputStream>(
+            absl::make_unique<std::stringstream>()),
+        aad, StreamingAead::ReEncryptOptions());
+    EXPECT_FALSE(status.ok());
+  }
+}
+
 TEST(StreamingAeadSetWrapperTest, DecryptionWithRandomAccessStream) {
   uint32_t key_id_0 = 1234543;
   uint32_t key_id_1 = 726329;
@@ -0,0 +1,200 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/streamingaead/tee_output_stream.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "tink/util/errors.h"
+
+namespace crypto {
+namespace tink {
+namespace streamingaead {
+
+using crypto::tink::util::Status;
+using crypto::tink::util::StatusOr;
+
+namespace {
+
+// Writes the 'size' bytes of 'data' to 'output_stream'.
+Status WriteFully(const char* data, int size, OutputStream* output_stream) {
+  while (size > 0) {
+    void* buffer;
+    auto next_result = output_stream->Next(&buffer);
+    if (!next_result.ok()) return next_result.status();
+    int count = std::min(next_result.ValueOrDie(), size);
+    std::memcpy(buffer, data, count);
+    output_stream->BackUp(next_result.ValueOrDie() - count);
+    data += count;
+    size -= count;
+  }
+  return Status::OK;
+}
+
+}  // namespace
+
+// static
+StatusOr<std::unique_ptr<TeeOutputStream>> TeeOutputStream::New(
+    std::vector<std::unique_ptr<OutputStream>> output_streams,
+    Options options) {
+  if (output_streams.empty()) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "output_streams must be non-empty");
+  }
+  for (const auto& output_stream : output_streams) {
+    if (output_stream == nullptr) {
+      return Status(util::error::INVALID_ARGUMENT,
+                    "output_streams must be non-null");
+    }
+  }
+  if (options.buffer_size <= 0) {
+    return ToStatusF(util::error::INVALID_ARGUMENT,
+                     "Invalid buffer_size: %d", options.buffer_size);
+  }
+  return {absl::WrapUnique(
+      new TeeOutputStream(std::move(output_streams), std::move(options)))};
+}
+
+TeeOutputStream::TeeOutputStream(
+    std::vector<std::unique_ptr<OutputStream>> output_streams,
+    Options options)
+    : output_streams_(std::move(output_streams)),
+      options_(std::move(options)),
+      running_writes_(std::make_shared<RunningWrites>()) {}
+
+TeeOutputStream::~TeeOutputStream() {
+  absl::MutexLock lock(&running_writes_->mutex);
+  running_writes_->mutex.Await(absl::Condition(
+      +[](int* count) { return *count == 0; }, &running_writes_->count));
+}
+
+void TeeOutputStream::StartWrites(const char* data, int size) {
+  std::shared_ptr<RunningWrites> running_writes = running_writes_;
+  {
+    absl::MutexLock lock(&running_writes->mutex);
+    running_writes->count += output_streams_.size();
+  }
+  for (const auto& output_stream : output_streams_) {
+    OutputStream* destination = output_stream.get();
+    std::function<void()> write = [data, size, destination, running_writes]() {
+      Status status = WriteFully(data, size, destination);
+      absl::MutexLock lock(&running_writes->mutex);
+      if (!status.ok() && running_writes->status.ok()) {
+        running_writes->status = status;
+      }
+      running_writes->count--;
+    };
+    if (options_.schedule) {
+      options_.schedule(std::move(write));
+    } else {
+      write();
+    }
+  }
+}
+
+Status TeeOutputStream::FinishWrites() {
+  absl::MutexLock lock(&running_writes_->mutex);
+  running_writes_->mutex.Await(absl::Condition(
+      +[](int* count) { return *count == 0; }, &running_writes_->count));
+  return running_writes_->status;
+}
+
+StatusOr<int> TeeOutputStream::Next(void** data) {
+  if (!status_.ok()) return status_;
+  if (count_in_buffer_ > 0) {
+    // The other buffer may still be being written.
+    status_ = FinishWrites();
+    if (!status_.ok()) return status_;
+    StartWrites(buffers_[current_buffer_].get(), count_in_buffer_);
+    if (options_.schedule) {
+      current_buffer_ = 1 - current_buffer_;
+    } else {
+      status_ = FinishWrites();
+      if (!status_.ok()) return status_;
+    }
+  }
+  if (buffers_[current_buffer_] == nullptr) {
+    buffers_[current_buffer_].reset(new char[options_.buffer_size]);
+  }
+  *data = buffers_[current_buffer_].get();
+  count_in_buffer_ = options_.buffer_size;
+  position_ += options_.buffer_size;
+  return options_.buffer_size;
+}
+
+void TeeOutputStream::BackUp(int count) {
+  if (!status_.ok() || count <= 0) return;
+  count = std::min(count, count_in_buffer_);
+  count_in_buffer_ -= count;
+  position_ -= count;
+}
+
+Status TeeOutputStream::Close() {
+  if (!status_.ok()) return status_;
+  status_ = FinishWrites();
+  if (status_.ok() && count_in_buffer_ > 0) {
+    StartWrites(buffers_[current_buffer_].get(), count_in_buffer_);
+    status_ = FinishWrites();
+  }
+  count_in_buffer_ = 0;
+  for (const auto& output_stream : output_streams_) {
+    if (!status_.ok()) {
+      output_stream->Close().IgnoreError();
+      continue;
+    }
+    status_ = output_stream->Close();
+  }
+  if (!status_.ok()) return status_;
+  status_ = Status(util::error::FAILED_PRECONDITION, "Stream closed");
+  return Status::OK;
+}
+
+int64_t TeeOutputStream::Position() const { return position_; }
+
+StatusOr<std::unique_ptr<OutputStream>> NewTeeEncryptingStream(
+    const std::vector<StreamingAead*>& streaming_aeads,
+    std::vector<std::unique_ptr<OutputStream>> ciphertext_destinations,
+    absl::string_view associated_data, TeeOutputStream::Options options) {
+  if (streaming_aeads.size() != ciphertext_destinations.size()) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "Each streaming_aead needs one ciphertext_destination");
+  }
+  std::vector<std::unique_ptr<OutputStream>> encrypting_streams;
+  for (int i = 0; i < streaming_aeads.size(); ++i) {
+    if (streaming_aeads[i] == nullptr) {
+      return Status(util::error::INVALID_ARGUMENT,
+                    "streaming_aeads must be non-null");
+    }
+    auto encrypting_stream_result = streaming_aeads[i]->NewEncryptingStream(
+        std::move(ciphertext_destinations[i]), associated_data);
+    if (!encrypting_stream_result.ok()) {
+      return encrypting_stream_result.status();
+    }
+    encrypting_streams.push_back(
+        std::move(encrypting_stream_result.ValueOrDie()));
+  }
+  auto tee_result =
+      TeeOutputStream::New(std::move(encrypting_streams), std::move(options));
+  if (!tee_result.ok()) return tee_result.status();
+  return {std::move(tee_result.ValueOrDie())};
+}
+
+}  // namespace streamingaead
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,122 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_STREAMINGAEAD_TEE_OUTPUT_STREAM_H_
+#define TINK_STREAMINGAEAD_TEE_OUTPUT_STREAM_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "tink/output_stream.h"
+#include "tink/streaming_aead.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace streamingaead {
+
+// An OutputStream which writes the same bytes to several other streams,
+// typically encrypting streams of different keysets, e.g. when the same data
+// is replicated under a different key to each region. The plaintext is thus
+// written, and read from its source, only once.
+//
+// The bytes are written to the buffers returned by Next() of this stream, and
+// copied to each of the wrapped streams on the following Next() or Close().
+// If Options::schedule is set, the copies, and hence the encryption of the
+// segments, run on the scheduled tasks in parallel, while the caller fills
+// a second buffer.
+class TeeOutputStream : public crypto::tink::OutputStream {
+ public:
+  struct Options {
+    // The size of each buffer returned by Next().
+    int buffer_size = 64 * 1024;
+    // If set, runs the writes to the wrapped streams, e.g. by passing them to
+    // a thread pool. Otherwise they run on the calling thread.
+    std::function<void(std::function<void()>)> schedule;
+  };
+
+  // Creates a stream which writes to all of 'output_streams'. Closing it
+  // closes all of them.
+  static crypto::tink::util::StatusOr<std::unique_ptr<TeeOutputStream>> New(
+      std::vector<std::unique_ptr<crypto::tink::OutputStream>> output_streams,
+      Options options);
+
+  // Waits for the writes in flight before destroying the wrapped streams.
+  ~TeeOutputStream() override;
+
+  crypto::tink::util::StatusOr<int> Next(void** data) override;
+
+  void BackUp(int count) override;
+
+  crypto::tink::util::Status Close() override;
+
+  int64_t Position() const override;
+
+ private:
+  // Writes in flight, shared with the scheduled tasks.
+  struct RunningWrites {
+    absl::Mutex mutex;
+    int count ABSL_GUARDED_BY(mutex) = 0;
+    // The first error of a write.
+    crypto::tink::util::Status status ABSL_GUARDED_BY(mutex);
+  };
+
+  TeeOutputStream(
+      std::vector<std::unique_ptr<crypto::tink::OutputStream>> output_streams,
+      Options options);
+
+  // Starts writing the first 'size' bytes of 'data' to each of the wrapped
+  // streams. 'data' must stay valid until FinishWrites() returned.
+  void StartWrites(const char* data, int size);
+
+  // Waits for the writes started by StartWrites(), and returns their status.
+  crypto::tink::util::Status FinishWrites();
+
+  std::vector<std::unique_ptr<crypto::tink::OutputStream>> output_streams_;
+  const Options options_;
+  std::shared_ptr<RunningWrites> running_writes_;
+  // With options_.schedule one buffer is being written to the wrapped streams
+  // while the other one is filled by the caller.
+  std::unique_ptr<char[]> buffers_[2];
+  int current_buffer_ = 0;
+
+  crypto::tink::util::Status status_;
+  int64_t position_ = 0;
+  // The bytes of the current buffer returned by Next() and not backed up.
+  int count_in_buffer_ = 0;
+};
+
+// Returns a stream which encrypts the written plaintext with each of
+// 'streaming_aeads', using 'associated_data', and writes the ciphertext of
+// streaming_aeads[i] to ciphertext_destinations[i].
+crypto::tink::util::StatusOr<std::unique_ptr<crypto::tink::OutputStream>>
+NewTeeEncryptingStream(
+    const std::vector<crypto::tink::StreamingAead*>& streaming_aeads,
+    std::vector<std::unique_ptr<crypto::tink::OutputStream>>
+        ciphertext_destinations,
+    absl::string_view associated_data, TeeOutputStream::Options options);
+
+}  // namespace streamingaead
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_STREAMINGAEAD_TEE_OUTPUT_STREAM_H_
@@ -0,0 +1,208 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/streamingaead/tee_output_stream.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "tink/subtle/random.h"
+#include "tink/subtle/test_util.h"
+#include "tink/util/istream_input_stream.h"
+#include "tink/util/ostream_output_stream.h"
+#include "tink/util/status.h"
+#include "tink/util/test_matchers.h"
+#include "tink/util/test_util.h"
+
+namespace crypto {
+namespace tink {
+namespace streamingaead {
+namespace {
+
+using ::crypto::tink::subtle::Random;
+using ::crypto::tink::subtle::test::TestThreadPool;
+using ::crypto::tink::test::DummyStreamingAead;
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::crypto::tink::util::IstreamInputStream;
+using ::crypto::tink::util::OstreamOutputStream;
+using ::testing::Eq;
+
+// An OutputStream whose Next() fails.
+class FailingOutputStream : public OutputStream {
+ public:
+  util::StatusOr<int> Next(void** data) override {
+    return util::Status(util::error::INTERNAL, "Next failed");
+  }
+  void BackUp(int count) override {}
+  util::Status Close() override { return util::Status::OK; }
+  int64_t Position() const override { return 0; }
+};
+
+class TeeOutputStreamTest : public ::testing::Test {
+ protected:
+  // Returns 'count' streams writing to the strings in contents_.
+  std::vector<std::unique_ptr<OutputStream>> NewStreams(int count) {
+    contents_.clear();
+    std::vector<std::unique_ptr<OutputStream>> streams;
+    for (int i = 0; i < count; ++i) {
+      contents_.push_back(absl::make_unique<std::stringstream>());
+      streams.push_back(absl::make_unique<OstreamOutputStream>(
+          absl::make_unique<std::ostream>(contents_.back()->rdbuf())));
+    }
+    return streams;
+  }
+
+  TeeOutputStream::Options GetOptions(int buffer_size, bool parallel) {
+    TeeOutputStream::Options options;
+    options.buffer_size = buffer_size;
+    if (parallel) {
+      options.schedule = [this](std::function<void()> task) {
+        pool_.Schedule(std::move(task));
+      };
+    }
+    return options;
+  }
+
+  std::vector<std::unique_ptr<std::stringstream>> contents_;
+  TestThreadPool pool_{4};
+};
+
+TEST_F(TeeOutputStreamTest, WritesToAllStreams) {
+  for (bool parallel : {false, true}) {
+    for (int stream_count : {1, 3}) {
+      for (int buffer_size : {1, 10, 1000}) {
+        for (int size : {0, 1, 10, 11, 1000, 100000}) {
+          SCOPED_TRACE(absl::StrCat("parallel: ", parallel,
+                                    " stream_count: ", stream_count,
+                                    " buffer_size: ", buffer_size,
+                                    " size: ", size));
+          std::string plaintext = Random::GetRandomBytes(size);
+          auto tee_result = TeeOutputStream::New(
+              NewStreams(stream_count), GetOptions(buffer_size, parallel));
+          ASSERT_THAT(tee_result.status(), IsOk());
+          auto tee = std::move(tee_result.ValueOrDie());
+          EXPECT_THAT(subtle::test::WriteToStream(tee.get(), plaintext),
+                      IsOk());
+          EXPECT_THAT(tee->Position(), Eq(size));
+          for (const auto& contents : contents_) {
+            EXPECT_THAT(contents->str(), Eq(plaintext));
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST_F(TeeOutputStreamTest, BackUp) {
+  auto tee_result =
+      TeeOutputStream::New(NewStreams(2), GetOptions(10, /* parallel = */ true));
+  ASSERT_THAT(tee_result.status(), IsOk());
+  auto tee = std::move(tee_result.ValueOrDie());
+  void* buffer;
+  std::string expected;
+  for (int i = 0; i < 5; ++i) {
+    auto next_result = tee->Next(&buffer);
+    ASSERT_THAT(next_result.status(), IsOk());
+    ASSERT_THAT(next_result.ValueOrDie(), Eq(10));
+    std::memset(buffer, 'a' + i, 4);
+    tee->BackUp(3);
+    tee->BackUp(3);
+    expected += std::string(4, 'a' + i);
+    EXPECT_THAT(tee->Position(), Eq(expected.size()));
+  }
+  ASSERT_THAT(tee->Next(&buffer).status(), IsOk());
+  tee->BackUp(100);
+  EXPECT_THAT(tee->Position(), Eq(expected.size()));
+  EXPECT_THAT(tee->Close(), IsOk());
+  EXPECT_THAT(tee->Next(&buffer).status(),
+              StatusIs(util::error::FAILED_PRECONDITION));
+  for (const auto& contents : contents_) {
+    EXPECT_THAT(contents->str(), Eq(expected));
+  }
+}
+
+TEST_F(TeeOutputStreamTest, EncryptsWithEachStreamingAead) {
+  DummyStreamingAead aead_1("aead 1");
+  DummyStreamingAead aead_2("aead 2");
+  std::vector<StreamingAead*> aeads = {&aead_1, &aead_2};
+  std::string plaintext = Random::GetRandomBytes(10000);
+  auto tee_result = NewTeeEncryptingStream(
+      aeads, NewStreams(2), "associated data",
+      GetOptions(100, /* parallel = */ true));
+  ASSERT_THAT(tee_result.status(), IsOk());
+  EXPECT_THAT(
+      subtle::test::WriteToStream(tee_result.ValueOrDie().get(), plaintext),
+      IsOk());
+  for (int i = 0; i < aeads.size(); ++i) {
+    auto ciphertext_source = absl::make_unique<IstreamInputStream>(
+        absl::make_unique<std::stringstream>(contents_[i]->str()));
+    auto decrypting_result = aeads[i]->NewDecryptingStream(
+        std::move(ciphertext_source), "associated data");
+    ASSERT_THAT(decrypting_result.status(), IsOk());
+    std::string decrypted;
+    EXPECT_THAT(subtle::test::ReadFromStream(
+                    decrypting_result.ValueOrDie().get(), &decrypted),
+                IsOk());
+    EXPECT_THAT(decrypted, Eq(plaintext));
+  }
+}
+
+TEST_F(TeeOutputStreamTest, FailingStream) {
+  for (bool parallel : {false, true}) {
+    SCOPED_TRACE(absl::StrCat("parallel: ", parallel));
+    std::vector<std::unique_ptr<OutputStream>> streams = NewStreams(1);
+    streams.push_back(absl::make_unique<FailingOutputStream>());
+    auto tee_result =
+        TeeOutputStream::New(std::move(streams), GetOptions(10, parallel));
+    ASSERT_THAT(tee_result.status(), IsOk());
+    EXPECT_THAT(subtle::test::WriteToStream(tee_result.ValueOrDie().get(),
+                                            std::string(100, 'a')),
+                StatusIs(util::error::INTERNAL));
+  }
+}
+
+TEST_F(TeeOutputStreamTest, InvalidArguments) {
+  EXPECT_THAT(TeeOutputStream::New(NewStreams(0), GetOptions(10, false))
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  std::vector<std::unique_ptr<OutputStream>> streams = NewStreams(1);
+  streams.push_back(nullptr);
+  EXPECT_THAT(
+      TeeOutputStream::New(std::move(streams), GetOptions(10, false)).status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(TeeOutputStream::New(NewStreams(1), GetOptions(0, false))
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  DummyStreamingAead aead("aead");
+  EXPECT_THAT(NewTeeEncryptingStream({&aead}, NewStreams(2), "",
+                                     GetOptions(10, false))
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace streamingaead
+}  // namespace tink
+}  // namespace crypto
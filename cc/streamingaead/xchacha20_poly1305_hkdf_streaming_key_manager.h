@@ -0,0 +1,109 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_STREAMINGAEAD_XCHACHA20_POLY1305_HKDF_STREAMING_KEY_MANAGER_H_
+#define TINK_STREAMINGAEAD_XCHACHA20_POLY1305_HKDF_STREAMING_KEY_MANAGER_H_
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "tink/core/key_type_manager.h"
+#include "tink/input_stream.h"
+#include "tink/streaming_aead.h"
+#include "tink/subtle/xchacha20_poly1305_hkdf_streaming.h"
+#include "tink/util/constants.h"
+#include "tink/util/enums.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "proto/tink.pb.h"
+#include "proto/xchacha20_poly1305_hkdf_streaming.pb.h"
+
+namespace crypto {
+namespace tink {
+
+// Key manager for XChaCha20Poly1305HkdfStreamingKey, streaming encryption
+// with XChaCha20-Poly1305 for CPUs without AES instructions.
+class XChaCha20Poly1305HkdfStreamingKeyManager
+    : public KeyTypeManager<
+          google::crypto::tink::XChaCha20Poly1305HkdfStreamingKey,
+          google::crypto::tink::XChaCha20Poly1305HkdfStreamingKeyFormat,
+          List<StreamingAead>> {
+ public:
+  class StreamingAeadFactory : public PrimitiveFactory<StreamingAead> {
+    crypto::tink::util::StatusOr<std::unique_ptr<StreamingAead>> Create(
+        const google::crypto::tink::XChaCha20Poly1305HkdfStreamingKey& key)
+        const override {
+      subtle::XChaCha20Poly1305HkdfStreaming::Params params;
+      params.ikm = util::SecretDataFromStringView(key.key_value());
+      params.hkdf_hash = crypto::tink::util::Enums::ProtoToSubtle(
+          key.params().hkdf_hash_type());
+      params.ciphertext_segment_size = key.params().ciphertext_segment_size();
+      params.ciphertext_offset = 0;
+      auto streaming_result =
+          subtle::XChaCha20Poly1305HkdfStreaming::New(std::move(params));
+      if (!streaming_result.ok()) return streaming_result.status();
+      return {std::move(streaming_result.ValueOrDie())};
+    }
+  };
+
+  XChaCha20Poly1305HkdfStreamingKeyManager()
+      : KeyTypeManager(absl::make_unique<StreamingAeadFactory>()) {}
+
+  // Returns the version of this key manager.
+  uint32_t get_version() const override { return 0; }
+
+  google::crypto::tink::KeyData::KeyMaterialType key_material_type()
+      const override {
+    return google::crypto::tink::KeyData::SYMMETRIC;
+  }
+
+  const std::string& get_key_type() const override { return key_type_; }
+
+  crypto::tink::util::Status ValidateKey(
+      const google::crypto::tink::XChaCha20Poly1305HkdfStreamingKey& key)
+      const override;
+
+  crypto::tink::util::Status ValidateKeyFormat(
+      const google::crypto::tink::XChaCha20Poly1305HkdfStreamingKeyFormat&
+          key_format) const override;
+
+  crypto::tink::util::StatusOr<
+      google::crypto::tink::XChaCha20Poly1305HkdfStreamingKey>
+  CreateKey(const google::crypto::tink::XChaCha20Poly1305HkdfStreamingKeyFormat&
+                key_format) const override;
+
+  crypto::tink::util::StatusOr<
+      google::crypto::tink::XChaCha20Poly1305HkdfStreamingKey>
+  DeriveKey(const google::crypto::tink::XChaCha20Poly1305HkdfStreamingKeyFormat&
+                key_format,
+            InputStream* input_stream) const override;
+
+  ~XChaCha20Poly1305HkdfStreamingKeyManager() override {}
+
+ private:
+  const std::string key_type_ = absl::StrCat(
+      kTypeGoogleapisCom,
+      google::crypto::tink::XChaCha20Poly1305HkdfStreamingKey().GetTypeName());
+};
+
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_STREAMINGAEAD_XCHACHA20_POLY1305_HKDF_STREAMING_KEY_MANAGER_H_
@@ -0,0 +1,193 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/streamingaead/xchacha20_poly1305_hkdf_streaming_key_manager.h"
+
+#include <sstream>
+#include <string>
+#include <utility>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "tink/streaming_aead.h"
+#include "tink/subtle/common_enums.h"
+#include "tink/subtle/random.h"
+#include "tink/subtle/streaming_aead_test_util.h"
+#include "tink/subtle/xchacha20_poly1305_hkdf_streaming.h"
+#include "tink/util/istream_input_stream.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "tink/util/test_matchers.h"
+#include "proto/common.pb.h"
+#include "proto/tink.pb.h"
+#include "proto/xchacha20_poly1305_hkdf_streaming.pb.h"
+
+namespace crypto {
+namespace tink {
+
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::crypto::tink::util::IstreamInputStream;
+using ::crypto::tink::util::StatusOr;
+using ::google::crypto::tink::HashType;
+using ::google::crypto::tink::XChaCha20Poly1305HkdfStreamingKey;
+using ::google::crypto::tink::XChaCha20Poly1305HkdfStreamingKeyFormat;
+using ::testing::Eq;
+using ::testing::HasSubstr;
+using ::testing::Not;
+
+namespace {
+
+XChaCha20Poly1305HkdfStreamingKeyFormat ValidKeyFormat() {
+  XChaCha20Poly1305HkdfStreamingKeyFormat key_format;
+  key_format.set_key_size(32);
+  key_format.mutable_params()->set_hkdf_hash_type(HashType::SHA256);
+  key_format.mutable_params()->set_ciphertext_segment_size(1024);
+  return key_format;
+}
+
+TEST(XChaCha20Poly1305HkdfStreamingKeyManagerTest, Basics) {
+  EXPECT_THAT(XChaCha20Poly1305HkdfStreamingKeyManager().get_version(), Eq(0));
+  EXPECT_THAT(XChaCha20Poly1305HkdfStreamingKeyManager().key_material_type(),
+              Eq(google::crypto::tink::KeyData::SYMMETRIC));
+  EXPECT_THAT(XChaCha20Poly1305HkdfStreamingKeyManager().get_key_type(),
+              Eq("type.googleapis.com/"
+                 "google.crypto.tink.XChaCha20Poly1305HkdfStreamingKey"));
+}
+
+TEST(XChaCha20Poly1305HkdfStreamingKeyManagerTest, ValidateKeyFormat) {
+  EXPECT_THAT(XChaCha20Poly1305HkdfStreamingKeyManager().ValidateKeyFormat(
+                  ValidKeyFormat()),
+              IsOk());
+  EXPECT_THAT(XChaCha20Poly1305HkdfStreamingKeyManager().ValidateKeyFormat(
+                  XChaCha20Poly1305HkdfStreamingKeyFormat()),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(XChaCha20Poly1305HkdfStreamingKeyManagerTest, ValidateKeyFormatSmallKey) {
+  XChaCha20Poly1305HkdfStreamingKeyFormat key_format = ValidKeyFormat();
+  key_format.set_key_size(16);
+  EXPECT_THAT(
+      XChaCha20Poly1305HkdfStreamingKeyManager().ValidateKeyFormat(key_format),
+      StatusIs(util::error::INVALID_ARGUMENT, HasSubstr("key_size")));
+}
+
+TEST(XChaCha20Poly1305HkdfStreamingKeyManagerTest, ValidateKeyFormatWrongHash) {
+  XChaCha20Poly1305HkdfStreamingKeyFormat key_format = ValidKeyFormat();
+  key_format.mutable_params()->set_hkdf_hash_type(HashType::UNKNOWN_HASH);
+  EXPECT_THAT(
+      XChaCha20Poly1305HkdfStreamingKeyManager().ValidateKeyFormat(key_format),
+      StatusIs(util::error::INVALID_ARGUMENT, HasSubstr("hkdf_hash_type")));
+}
+
+TEST(XChaCha20Poly1305HkdfStreamingKeyManagerTest,
+     ValidateKeyFormatSegmentSize) {
+  XChaCha20Poly1305HkdfStreamingKeyFormat key_format = ValidKeyFormat();
+  // The first segment must hold 1 + 32 + 19 bytes of header and a tag.
+  key_format.mutable_params()->set_ciphertext_segment_size(68);
+  EXPECT_THAT(
+      XChaCha20Poly1305HkdfStreamingKeyManager().ValidateKeyFormat(key_format),
+      StatusIs(util::error::INVALID_ARGUMENT,
+               HasSubstr("ciphertext_segment_size")));
+  key_format.mutable_params()->set_ciphertext_segment_size(69);
+  EXPECT_THAT(
+      XChaCha20Poly1305HkdfStreamingKeyManager().ValidateKeyFormat(key_format),
+      IsOk());
+}
+
+TEST(XChaCha20Poly1305HkdfStreamingKeyManagerTest, ValidateKey) {
+  auto key_or =
+      XChaCha20Poly1305HkdfStreamingKeyManager().CreateKey(ValidKeyFormat());
+  ASSERT_THAT(key_or.status(), IsOk());
+  XChaCha20Poly1305HkdfStreamingKey key = key_or.ValueOrDie();
+  EXPECT_THAT(XChaCha20Poly1305HkdfStreamingKeyManager().ValidateKey(key),
+              IsOk());
+  key.set_version(1);
+  EXPECT_THAT(XChaCha20Poly1305HkdfStreamingKeyManager().ValidateKey(key),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  key.set_version(0);
+  key.set_key_value(subtle::Random::GetRandomBytes(31));
+  EXPECT_THAT(XChaCha20Poly1305HkdfStreamingKeyManager().ValidateKey(key),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(XChaCha20Poly1305HkdfStreamingKeyManagerTest, CreateKey) {
+  XChaCha20Poly1305HkdfStreamingKeyFormat key_format = ValidKeyFormat();
+  auto key_or =
+      XChaCha20Poly1305HkdfStreamingKeyManager().CreateKey(key_format);
+  ASSERT_THAT(key_or.status(), IsOk());
+  EXPECT_THAT(key_or.ValueOrDie().version(), Eq(0));
+  EXPECT_THAT(key_or.ValueOrDie().params().SerializeAsString(),
+              Eq(key_format.params().SerializeAsString()));
+  EXPECT_THAT(key_or.ValueOrDie().key_value().size(),
+              Eq(key_format.key_size()));
+}
+
+TEST(XChaCha20Poly1305HkdfStreamingKeyManagerTest, DeriveKey) {
+  XChaCha20Poly1305HkdfStreamingKeyFormat key_format = ValidKeyFormat();
+  IstreamInputStream input_stream{
+      absl::make_unique<std::stringstream>("01234567890123456789012345678901")};
+  StatusOr<XChaCha20Poly1305HkdfStreamingKey> key_or =
+      XChaCha20Poly1305HkdfStreamingKeyManager().DeriveKey(key_format,
+                                                           &input_stream);
+  ASSERT_THAT(key_or.status(), IsOk());
+  EXPECT_THAT(key_or.ValueOrDie().key_value(),
+              Eq("01234567890123456789012345678901"));
+  EXPECT_THAT(key_or.ValueOrDie().params().SerializeAsString(),
+              Eq(key_format.params().SerializeAsString()));
+
+  IstreamInputStream short_input_stream{
+      absl::make_unique<std::stringstream>("0123456789012345678901234567890")};
+  EXPECT_THAT(XChaCha20Poly1305HkdfStreamingKeyManager()
+                  .DeriveKey(key_format, &short_input_stream)
+                  .status(),
+              Not(IsOk()));
+}
+
+TEST(XChaCha20Poly1305HkdfStreamingKeyManagerTest, GetPrimitive) {
+  auto key_or =
+      XChaCha20Poly1305HkdfStreamingKeyManager().CreateKey(ValidKeyFormat());
+  ASSERT_THAT(key_or.status(), IsOk());
+  const XChaCha20Poly1305HkdfStreamingKey& key = key_or.ValueOrDie();
+  auto streaming_aead_from_manager_result =
+      XChaCha20Poly1305HkdfStreamingKeyManager().GetPrimitive<StreamingAead>(
+          key);
+  ASSERT_THAT(streaming_aead_from_manager_result.status(), IsOk());
+
+  subtle::XChaCha20Poly1305HkdfStreaming::Params params;
+  params.ikm = util::SecretDataFromStringView(key.key_value());
+  params.hkdf_hash = subtle::HashType::SHA256;
+  params.ciphertext_segment_size = 1024;
+  params.ciphertext_offset = 0;
+  auto streaming_aead_direct_result =
+      subtle::XChaCha20Poly1305HkdfStreaming::New(std::move(params));
+  ASSERT_THAT(streaming_aead_direct_result.status(), IsOk());
+
+  // Check that the two primitives are the same by encrypting with one, and
+  // decrypting with the other.
+  EXPECT_THAT(
+      EncryptThenDecrypt(streaming_aead_from_manager_result.ValueOrDie().get(),
+                         streaming_aead_direct_result.ValueOrDie().get(),
+                         subtle::Random::GetRandomBytes(10000),
+                         "some associated data", /* ciphertext_offset = */ 0),
+      IsOk());
+}
+
+}  // namespace
+}  // namespace tink
+}  // namespace crypto
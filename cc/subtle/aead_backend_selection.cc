@@ -0,0 +1,277 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/subtle/aead_backend_selection.h"
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "tink/aead.h"
+#include "tink/subtle/random.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+using util::Status;
+using util::StatusOr;
+
+namespace {
+
+// The largest message of each size class but the last.
+constexpr int64_t kSizeClassLimits[kNumAeadSizeClasses - 1] = {256, 4096,
+                                                               65536};
+// The message size measured for each size class.
+constexpr int64_t kCalibrationSizes[kNumAeadSizeClasses] = {256, 4096, 65536,
+                                                            1 << 20};
+
+absl::Mutex* ChoicesMutex() {
+  static absl::Mutex* mutex = new absl::Mutex();
+  return mutex;
+}
+
+// Guarded by ChoicesMutex().
+std::map<std::string, AeadBackendChoice>* RecordedChoices() {
+  static auto* choices = new std::map<std::string, AeadBackendChoice>();
+  return choices;
+}
+
+// Sends the messages of every size class to the Aead of that class.
+class SizeClassAead : public Aead {
+ public:
+  SizeClassAead(std::vector<std::unique_ptr<Aead>> aeads,
+                std::array<const Aead*, kNumAeadSizeClasses> by_size_class)
+      : aeads_(std::move(aeads)), by_size_class_(by_size_class) {}
+
+  StatusOr<std::string> Encrypt(
+      absl::string_view plaintext,
+      absl::string_view associated_data) const override {
+    return ForSize(plaintext.size())->Encrypt(plaintext, associated_data);
+  }
+
+  // Decryptions are dispatched by the size of the ciphertext, which is
+  // slightly larger than that of its plaintext. Since the backends are
+  // compatible, that only matters for performance.
+  StatusOr<std::string> Decrypt(
+      absl::string_view ciphertext,
+      absl::string_view associated_data) const override {
+    return ForSize(ciphertext.size())->Decrypt(ciphertext, associated_data);
+  }
+
+  StatusOr<int64_t> CiphertextSize(int64_t plaintext_size) const override {
+    return ForSize(plaintext_size)->CiphertextSize(plaintext_size);
+  }
+
+  StatusOr<int64_t> EncryptInto(absl::string_view plaintext,
+                                absl::string_view associated_data,
+                                absl::Span<char> buffer) const override {
+    return ForSize(plaintext.size())
+        ->EncryptInto(plaintext, associated_data, buffer);
+  }
+
+  StatusOr<int64_t> DecryptInto(absl::string_view ciphertext,
+                                absl::string_view associated_data,
+                                absl::Span<char> buffer) const override {
+    return ForSize(ciphertext.size())
+        ->DecryptInto(ciphertext, associated_data, buffer);
+  }
+
+ private:
+  const Aead* ForSize(int64_t size) const {
+    return by_size_class_[AeadSizeClass(size)];
+  }
+
+  const std::vector<std::unique_ptr<Aead>> aeads_;
+  const std::array<const Aead*, kNumAeadSizeClasses> by_size_class_;
+};
+
+// Returns the time of one encryption and decryption of 'plaintext' with
+// 'aead', averaged over as many as fit into 'duration'.
+StatusOr<absl::Duration> MeasureAead(const Aead& aead,
+                                     absl::string_view plaintext,
+                                     absl::Duration duration) {
+  int64_t iterations = 0;
+  absl::Time start = absl::Now();
+  absl::Duration elapsed;
+  do {
+    auto encrypt_result = aead.Encrypt(plaintext, "calibration");
+    if (!encrypt_result.ok()) return encrypt_result.status();
+    auto decrypt_result =
+        aead.Decrypt(encrypt_result.ValueOrDie(), "calibration");
+    if (!decrypt_result.ok()) return decrypt_result.status();
+    iterations++;
+    elapsed = absl::Now() - start;
+  } while (elapsed < duration);
+  return elapsed / iterations;
+}
+
+}  // namespace
+
+int AeadSizeClass(int64_t size) {
+  int size_class = 0;
+  while (size_class < kNumAeadSizeClasses - 1 &&
+         size > kSizeClassLimits[size_class]) {
+    size_class++;
+  }
+  return size_class;
+}
+
+std::string AeadBackendChoice::ToString() const {
+  std::string result;
+  for (int i = 0; i < kNumAeadSizeClasses; i++) {
+    if (i < kNumAeadSizeClasses - 1) {
+      absl::StrAppend(&result, i == 0 ? "" : " ", "<=", kSizeClassLimits[i],
+                      ":", backends[i]);
+    } else {
+      absl::StrAppend(&result, " >", kSizeClassLimits[i - 1], ":",
+                      backends[i]);
+    }
+  }
+  return result;
+}
+
+StatusOr<AeadBackendChoice> CalibrateAeadBackends(
+    const std::vector<AeadBackend>& backends, size_t key_size,
+    const AeadCalibrationOptions& options) {
+  if (backends.empty()) {
+    return Status(util::error::INVALID_ARGUMENT, "No backends given");
+  }
+  util::SecretData key = Random::GetRandomKeyBytes(key_size);
+  std::vector<std::unique_ptr<Aead>> aeads;
+  for (const AeadBackend& backend : backends) {
+    auto aead_result = backend.new_aead(key);
+    if (!aead_result.ok()) return aead_result.status();
+    aeads.push_back(std::move(aead_result.ValueOrDie()));
+  }
+  std::string message =
+      Random::GetRandomBytes(kCalibrationSizes[kNumAeadSizeClasses - 1]);
+
+  AeadBackendChoice choice;
+  for (int size_class = 0; size_class < kNumAeadSizeClasses; size_class++) {
+    absl::string_view plaintext =
+        absl::string_view(message).substr(0, kCalibrationSizes[size_class]);
+    // Checks that every backend decrypts the ciphertexts of the others, so
+    // that choosing different backends for different sizes is safe.
+    for (size_t i = 0; i < aeads.size(); i++) {
+      auto encrypt_result = aeads[i]->Encrypt(plaintext, "calibration");
+      if (!encrypt_result.ok()) return encrypt_result.status();
+      for (size_t j = 0; j < aeads.size(); j++) {
+        auto decrypt_result =
+            aeads[j]->Decrypt(encrypt_result.ValueOrDie(), "calibration");
+        if (!decrypt_result.ok() || decrypt_result.ValueOrDie() != plaintext) {
+          return Status(util::error::INTERNAL,
+                        absl::StrCat("Backend ", backends[j].name,
+                                     " does not decrypt the ciphertexts of ",
+                                     backends[i].name));
+        }
+      }
+    }
+    size_t fastest = 0;
+    absl::Duration fastest_time = absl::InfiniteDuration();
+    for (size_t i = 0; i < aeads.size(); i++) {
+      auto time_result =
+          MeasureAead(*aeads[i], plaintext, options.time_per_measurement);
+      if (!time_result.ok()) return time_result.status();
+      if (time_result.ValueOrDie() < fastest_time) {
+        fastest = i;
+        fastest_time = time_result.ValueOrDie();
+      }
+    }
+    choice.backends[size_class] = backends[fastest].name;
+  }
+  return choice;
+}
+
+void SetAeadBackendChoice(absl::string_view algorithm,
+                          const AeadBackendChoice& choice) {
+  absl::MutexLock lock(ChoicesMutex());
+  (*RecordedChoices())[std::string(algorithm)] = choice;
+}
+
+void ClearAeadBackendChoices() {
+  absl::MutexLock lock(ChoicesMutex());
+  RecordedChoices()->clear();
+}
+
+std::map<std::string, AeadBackendChoice> GetAeadBackendChoices() {
+  absl::MutexLock lock(ChoicesMutex());
+  return *RecordedChoices();
+}
+
+StatusOr<std::unique_ptr<Aead>> NewAeadWithBackends(
+    absl::string_view algorithm, const std::vector<AeadBackend>& backends,
+    const util::SecretData& key) {
+  if (backends.empty()) {
+    return Status(util::error::INVALID_ARGUMENT, "No backends given");
+  }
+  // The index of the backend of every size class.
+  std::array<size_t, kNumAeadSizeClasses> backend_indices = {};
+  bool single_backend = true;
+  if (backends.size() > 1) {
+    absl::MutexLock lock(ChoicesMutex());
+    auto it = RecordedChoices()->find(std::string(algorithm));
+    if (it != RecordedChoices()->end()) {
+      for (int size_class = 0; size_class < kNumAeadSizeClasses;
+           size_class++) {
+        for (size_t i = 0; i < backends.size(); i++) {
+          if (backends[i].name == it->second.backends[size_class]) {
+            backend_indices[size_class] = i;
+            break;
+          }
+        }
+        if (backend_indices[size_class] != backend_indices[0]) {
+          single_backend = false;
+        }
+      }
+    }
+  }
+  if (single_backend) return backends[backend_indices[0]].new_aead(key);
+
+  std::vector<std::unique_ptr<Aead>> aeads;
+  std::vector<const Aead*> aead_of_backend(backends.size(), nullptr);
+  std::array<const Aead*, kNumAeadSizeClasses> by_size_class;
+  for (int size_class = 0; size_class < kNumAeadSizeClasses; size_class++) {
+    size_t index = backend_indices[size_class];
+    if (aead_of_backend[index] == nullptr) {
+      auto aead_result = backends[index].new_aead(key);
+      if (!aead_result.ok()) return aead_result.status();
+      aeads.push_back(std::move(aead_result.ValueOrDie()));
+      aead_of_backend[index] = aeads.back().get();
+    }
+    by_size_class[size_class] = aead_of_backend[index];
+  }
+  return {absl::make_unique<SizeClassAead>(std::move(aeads), by_size_class)};
+}
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,117 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TINK_SUBTLE_AEAD_BACKEND_SELECTION_H_
+#define TINK_SUBTLE_AEAD_BACKEND_SELECTION_H_
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+#include "tink/aead.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+// Selection between several implementations ("backends") of the same AEAD
+// algorithm, e.g. AES-EAX with BoringSSL or with AES-NI intrinsics, per
+// message size class and for the CPU the process runs on.
+//
+// Calibrate once at startup, then create primitives as usual:
+//
+//   auto choice_result = CalibrateAeadBackends(backends, key_size, {});
+//   if (choice_result.ok()) {
+//     SetAeadBackendChoice("AES-EAX", choice_result.ValueOrDie());
+//   }
+//   ...
+//   auto aead_result = NewAeadWithBackends("AES-EAX", backends, key);
+//
+// Without a recorded choice, the first backend is used for all messages.
+// SetAeadBackendChoice() also overrides a calibrated choice, and
+// GetAeadBackendChoices() exports the choices, e.g. for diagnostics.
+
+// The number of message size classes: messages of at most 256 bytes, at
+// most 4 KiB, at most 64 KiB, and larger ones.
+constexpr int kNumAeadSizeClasses = 4;
+
+// Returns the size class of a message of 'size' bytes.
+int AeadSizeClass(int64_t size);
+
+// An implementation of an AEAD algorithm. The backends of an algorithm must
+// produce compatible ciphertexts, so that each decrypts those of the others.
+struct AeadBackend {
+  std::string name;
+  std::function<crypto::tink::util::StatusOr<std::unique_ptr<Aead>>(
+      const util::SecretData& key)>
+      new_aead;
+};
+
+// The names of the backends to use per size class.
+struct AeadBackendChoice {
+  std::array<std::string, kNumAeadSizeClasses> backends;
+
+  // E.g. "<=256:aesni <=4096:aesni <=65536:boringssl >65536:boringssl".
+  std::string ToString() const;
+};
+
+struct AeadCalibrationOptions {
+  // The time spent measuring each backend for each size class.
+  absl::Duration time_per_measurement = absl::Milliseconds(2);
+};
+
+// Measures the encryption and decryption time of each of 'backends' with a
+// random key of 'key_size' bytes, and returns the fastest one per size
+// class. Fails if a backend cannot be created, or if its ciphertexts are not
+// decrypted by the other backends.
+crypto::tink::util::StatusOr<AeadBackendChoice> CalibrateAeadBackends(
+    const std::vector<AeadBackend>& backends, size_t key_size,
+    const AeadCalibrationOptions& options);
+
+// Records 'choice' for 'algorithm' for the whole process, replacing the
+// previous choice, if any. Primitives created before the call keep the
+// backends they were created with.
+void SetAeadBackendChoice(absl::string_view algorithm,
+                          const AeadBackendChoice& choice);
+
+// Removes the recorded choices of all algorithms.
+void ClearAeadBackendChoices();
+
+// Returns the recorded choices, by algorithm.
+std::map<std::string, AeadBackendChoice> GetAeadBackendChoices();
+
+// Returns an Aead for 'key' which processes the messages of every size class
+// with the backend recorded for 'algorithm'. Size classes without a choice,
+// or whose backend is not one of 'backends', use the first backend. If all
+// size classes use the same backend, its Aead is returned directly.
+crypto::tink::util::StatusOr<std::unique_ptr<Aead>> NewAeadWithBackends(
+    absl::string_view algorithm, const std::vector<AeadBackend>& backends,
+    const util::SecretData& key);
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_SUBTLE_AEAD_BACKEND_SELECTION_H_
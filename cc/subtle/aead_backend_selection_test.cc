@@ -0,0 +1,285 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/subtle/aead_backend_selection.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "tink/aead.h"
+#include "tink/subtle/aes_eax_boringssl.h"
+#include "tink/subtle/random.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "tink/util/test_matchers.h"
+#include "tink/util/test_util.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+namespace {
+
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::testing::ElementsAre;
+using ::testing::Eq;
+using ::testing::HasSubstr;
+using ::testing::IsEmpty;
+using ::testing::Pair;
+
+// Encrypts with AES-EAX, counting its calls in 'calls', and sleeping
+// 'delay' per call for messages of at least 'slow_size' bytes.
+class TracingAead : public Aead {
+ public:
+  TracingAead(std::unique_ptr<Aead> aead, int* calls, int64_t slow_size,
+              absl::Duration delay)
+      : aead_(std::move(aead)),
+        calls_(calls),
+        slow_size_(slow_size),
+        delay_(delay) {}
+
+  util::StatusOr<std::string> Encrypt(
+      absl::string_view plaintext,
+      absl::string_view associated_data) const override {
+    Trace(plaintext.size());
+    return aead_->Encrypt(plaintext, associated_data);
+  }
+
+  util::StatusOr<std::string> Decrypt(
+      absl::string_view ciphertext,
+      absl::string_view associated_data) const override {
+    Trace(ciphertext.size());
+    return aead_->Decrypt(ciphertext, associated_data);
+  }
+
+ private:
+  void Trace(int64_t size) const {
+    (*calls_)++;
+    if (size >= slow_size_) absl::SleepFor(delay_);
+  }
+
+  const std::unique_ptr<Aead> aead_;
+  int* const calls_;
+  const int64_t slow_size_;
+  const absl::Duration delay_;
+};
+
+AeadBackend TracingBackend(const std::string& name, int* calls,
+                           int64_t slow_size = INT64_MAX,
+                           absl::Duration delay = absl::ZeroDuration()) {
+  return {name, [=](const util::SecretData& key)
+                    -> util::StatusOr<std::unique_ptr<Aead>> {
+            auto aead_result = AesEaxBoringSsl::New(key, 16);
+            if (!aead_result.ok()) return aead_result.status();
+            return {absl::make_unique<TracingAead>(
+                std::move(aead_result.ValueOrDie()), calls, slow_size,
+                delay)};
+          }};
+}
+
+AeadCalibrationOptions FastCalibration() {
+  AeadCalibrationOptions options;
+  options.time_per_measurement = absl::Microseconds(100);
+  return options;
+}
+
+class AeadBackendSelectionTest : public ::testing::Test {
+ protected:
+  void TearDown() override { ClearAeadBackendChoices(); }
+};
+
+TEST_F(AeadBackendSelectionTest, SizeClasses) {
+  EXPECT_THAT(AeadSizeClass(0), Eq(0));
+  EXPECT_THAT(AeadSizeClass(256), Eq(0));
+  EXPECT_THAT(AeadSizeClass(257), Eq(1));
+  EXPECT_THAT(AeadSizeClass(4096), Eq(1));
+  EXPECT_THAT(AeadSizeClass(4097), Eq(2));
+  EXPECT_THAT(AeadSizeClass(65536), Eq(2));
+  EXPECT_THAT(AeadSizeClass(65537), Eq(3));
+  EXPECT_THAT(AeadSizeClass(int64_t{1} << 40), Eq(3));
+}
+
+TEST_F(AeadBackendSelectionTest, ChoiceToString) {
+  AeadBackendChoice choice;
+  choice.backends = {"a", "b", "c", "d"};
+  EXPECT_THAT(choice.ToString(), Eq("<=256:a <=4096:b <=65536:c >65536:d"));
+}
+
+TEST_F(AeadBackendSelectionTest, CalibrationChoosesFastestBackend) {
+  int constant_calls = 0;
+  int growing_calls = 0;
+  // "constant" is slowed down for all messages, "growing" only for those
+  // of the two larger size classes, but more so.
+  std::vector<AeadBackend> backends = {
+      TracingBackend("constant", &constant_calls, 0, absl::Milliseconds(1)),
+      TracingBackend("growing", &growing_calls, 10000,
+                     absl::Milliseconds(5))};
+
+  auto choice_result =
+      CalibrateAeadBackends(backends, 16, FastCalibration());
+  ASSERT_THAT(choice_result.status(), IsOk());
+  EXPECT_THAT(choice_result.ValueOrDie().backends,
+              ElementsAre("growing", "growing", "constant", "constant"));
+  EXPECT_GT(constant_calls, 0);
+  EXPECT_GT(growing_calls, 0);
+}
+
+TEST_F(AeadBackendSelectionTest, CalibrationFailsWithoutBackends) {
+  EXPECT_THAT(CalibrateAeadBackends({}, 16, FastCalibration()).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST_F(AeadBackendSelectionTest, CalibrationFailsForIncompatibleBackends) {
+  int calls = 0;
+  std::vector<AeadBackend> backends = {
+      TracingBackend("eax", &calls),
+      {"dummy", [](const util::SecretData&)
+                    -> util::StatusOr<std::unique_ptr<Aead>> {
+         return {absl::make_unique<test::DummyAead>("dummy")};
+       }}};
+  EXPECT_THAT(
+      CalibrateAeadBackends(backends, 16, FastCalibration()).status(),
+      StatusIs(util::error::INTERNAL,
+               HasSubstr("dummy does not decrypt the ciphertexts of eax")));
+}
+
+TEST_F(AeadBackendSelectionTest, CalibrationPropagatesCreationErrors) {
+  int calls = 0;
+  std::vector<AeadBackend> backends = {TracingBackend("eax", &calls)};
+  // AES-EAX does not support 17 byte keys.
+  EXPECT_THAT(CalibrateAeadBackends(backends, 17, FastCalibration()).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST_F(AeadBackendSelectionTest, SetGetAndClearChoices) {
+  EXPECT_THAT(GetAeadBackendChoices(), IsEmpty());
+  AeadBackendChoice choice;
+  choice.backends = {"a", "a", "b", "b"};
+  SetAeadBackendChoice("algorithm", choice);
+  choice.backends = {"c", "c", "c", "c"};
+  SetAeadBackendChoice("other", choice);
+  choice.backends = {"b", "b", "b", "b"};
+  SetAeadBackendChoice("algorithm", choice);
+
+  auto choices = GetAeadBackendChoices();
+  ASSERT_THAT(choices.size(), Eq(2));
+  EXPECT_THAT(choices["algorithm"].backends, ElementsAre("b", "b", "b", "b"));
+  EXPECT_THAT(choices["other"].backends, ElementsAre("c", "c", "c", "c"));
+  ClearAeadBackendChoices();
+  EXPECT_THAT(GetAeadBackendChoices(), IsEmpty());
+}
+
+TEST_F(AeadBackendSelectionTest, UsesFirstBackendWithoutChoice) {
+  int first_calls = 0;
+  int second_calls = 0;
+  std::vector<AeadBackend> backends = {TracingBackend("first", &first_calls),
+                                       TracingBackend("second", &second_calls)};
+  auto aead_result = NewAeadWithBackends(
+      "algorithm", backends, Random::GetRandomKeyBytes(16));
+  ASSERT_THAT(aead_result.status(), IsOk());
+  auto ciphertext_result =
+      aead_result.ValueOrDie()->Encrypt(Random::GetRandomBytes(100000), "ad");
+  ASSERT_THAT(ciphertext_result.status(), IsOk());
+  EXPECT_THAT(first_calls, Eq(1));
+  EXPECT_THAT(second_calls, Eq(0));
+}
+
+TEST_F(AeadBackendSelectionTest, DispatchesBySizeClass) {
+  int small_calls = 0;
+  int large_calls = 0;
+  std::vector<AeadBackend> backends = {TracingBackend("large", &large_calls),
+                                       TracingBackend("small", &small_calls)};
+  AeadBackendChoice choice;
+  choice.backends = {"small", "small", "large", "unknown"};
+  SetAeadBackendChoice("algorithm", choice);
+  util::SecretData key = Random::GetRandomKeyBytes(16);
+  auto aead_result = NewAeadWithBackends("algorithm", backends, key);
+  ASSERT_THAT(aead_result.status(), IsOk());
+  const Aead& aead = *aead_result.ValueOrDie();
+
+  // An Aead of a single backend decrypts the ciphertexts of every size.
+  auto reference_result = AesEaxBoringSsl::New(key, 16);
+  ASSERT_THAT(reference_result.status(), IsOk());
+  for (int size : {0, 256, 1000, 4096, 5000, 65536, 100000}) {
+    SCOPED_TRACE(size);
+    std::string plaintext = Random::GetRandomBytes(size);
+    small_calls = 0;
+    large_calls = 0;
+    auto ciphertext_result = aead.Encrypt(plaintext, "ad");
+    ASSERT_THAT(ciphertext_result.status(), IsOk());
+    EXPECT_THAT(small_calls, Eq(size <= 4096 ? 1 : 0));
+    EXPECT_THAT(large_calls, Eq(size <= 4096 ? 0 : 1));
+    auto decrypt_result =
+        reference_result.ValueOrDie()->Decrypt(ciphertext_result.ValueOrDie(),
+                                               "ad");
+    ASSERT_THAT(decrypt_result.status(), IsOk());
+    EXPECT_THAT(decrypt_result.ValueOrDie(), Eq(plaintext));
+
+    auto reencrypted_result =
+        reference_result.ValueOrDie()->Encrypt(plaintext, "ad");
+    ASSERT_THAT(reencrypted_result.status(), IsOk());
+    decrypt_result = aead.Decrypt(reencrypted_result.ValueOrDie(), "ad");
+    ASSERT_THAT(decrypt_result.status(), IsOk());
+    EXPECT_THAT(decrypt_result.ValueOrDie(), Eq(plaintext));
+  }
+}
+
+TEST_F(AeadBackendSelectionTest, LaterChoicesDoNotAffectExistingAeads) {
+  int first_calls = 0;
+  int second_calls = 0;
+  std::vector<AeadBackend> backends = {TracingBackend("first", &first_calls),
+                                       TracingBackend("second", &second_calls)};
+  util::SecretData key = Random::GetRandomKeyBytes(16);
+  auto aead_result = NewAeadWithBackends("algorithm", backends, key);
+  ASSERT_THAT(aead_result.status(), IsOk());
+  AeadBackendChoice choice;
+  choice.backends = {"second", "second", "second", "second"};
+  SetAeadBackendChoice("algorithm", choice);
+  EXPECT_THAT(GetAeadBackendChoices(),
+              ElementsAre(Pair("algorithm", testing::_)));
+
+  ASSERT_THAT(aead_result.ValueOrDie()->Encrypt("message", "ad").status(),
+              IsOk());
+  EXPECT_THAT(first_calls, Eq(1));
+  EXPECT_THAT(second_calls, Eq(0));
+
+  auto new_aead_result = NewAeadWithBackends("algorithm", backends, key);
+  ASSERT_THAT(new_aead_result.status(), IsOk());
+  ASSERT_THAT(new_aead_result.ValueOrDie()->Encrypt("message", "ad").status(),
+              IsOk());
+  EXPECT_THAT(second_calls, Eq(1));
+}
+
+TEST_F(AeadBackendSelectionTest, NewAeadFailsWithoutBackends) {
+  EXPECT_THAT(
+      NewAeadWithBackends("algorithm", {}, Random::GetRandomKeyBytes(16))
+          .status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
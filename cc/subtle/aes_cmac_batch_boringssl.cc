@@ -0,0 +1,349 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/subtle/aes_cmac_batch_boringssl.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "openssl/aes.h"
+#include "openssl/mem.h"
+#include "tink/subtle/subtle_util.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define TINK_AES_CMAC_AESNI 1
+#include <immintrin.h>
+#endif
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+constexpr size_t AesCmacBatchBoringSsl::kTagSize;
+constexpr int AesCmacBatchBoringSsl::kLanes;
+constexpr int AesCmacBatchBoringSsl::kBlockSize;
+
+namespace {
+
+constexpr int kBlockSize = 16;
+
+// Multiplies 'in' by x in GF(2^128), as in RFC 4493, section 2.3.
+void MultiplyByX(const uint8_t in[kBlockSize], uint8_t out[kBlockSize]) {
+  uint8_t carry = in[0] >> 7;
+  for (int i = 0; i < kBlockSize - 1; i++) {
+    out[i] = (in[i] << 1) | (in[i + 1] >> 7);
+  }
+  // 0x87 if the top bit was set, without branching on it.
+  out[kBlockSize - 1] = (in[kBlockSize - 1] << 1) ^ ((0 - carry) & 0x87);
+}
+
+size_t NumBlocks(absl::string_view data) {
+  return data.empty() ? 1 : (data.size() + kBlockSize - 1) / kBlockSize;
+}
+
+// Writes the last block of 'data', which has 'num_blocks' blocks, xor K1
+// or K2 to 'out'.
+void LastBlock(absl::string_view data, size_t num_blocks, const uint8_t k1[],
+               const uint8_t k2[], uint8_t out[kBlockSize]) {
+  size_t offset = (num_blocks - 1) * kBlockSize;
+  size_t rest = data.size() - offset;
+  const uint8_t* subkey = k1;
+  if (rest == kBlockSize) {
+    std::memcpy(out, data.data() + offset, kBlockSize);
+  } else {
+    std::memset(out, 0, kBlockSize);
+    if (rest > 0) std::memcpy(out, data.data() + offset, rest);
+    out[rest] = 0x80;
+    subkey = k2;
+  }
+  for (int i = 0; i < kBlockSize; i++) out[i] ^= subkey[i];
+}
+
+#ifdef TINK_AES_CMAC_AESNI
+
+#define TINK_AESNI_TARGET __attribute__((target("aes,sse2")))
+
+bool HasAesNi() {
+  static const bool has_aesni = __builtin_cpu_supports("aes");
+  return has_aesni;
+}
+
+// One step of the AES key expansion: xors the prefix sums of the words of
+// 'key' with the word of 'assist' selected by the shuffle.
+TINK_AESNI_TARGET inline __m128i ExpandStep(__m128i key, __m128i assist) {
+  key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+  key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+  key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+  return _mm_xor_si128(key, assist);
+}
+
+TINK_AESNI_TARGET void ExpandKeyAesNi(const uint8_t* key, size_t key_size,
+                                      uint8_t round_keys[][kBlockSize]) {
+  __m128i rk[15];
+  rk[0] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key));
+  // _mm_aeskeygenassist_si128 takes the round constant as an immediate.
+#define TINK_EXPAND_128(i, rcon)                                          \
+  rk[i] = ExpandStep(rk[i - 1],                                           \
+                     _mm_shuffle_epi32(                                   \
+                         _mm_aeskeygenassist_si128(rk[i - 1], rcon), 0xff))
+#define TINK_EXPAND_256(i, rcon)                                          \
+  rk[i] = ExpandStep(rk[i - 2],                                           \
+                     _mm_shuffle_epi32(                                   \
+                         _mm_aeskeygenassist_si128(rk[i - 1], rcon), 0xff)); \
+  if (i < 14) {                                                           \
+    rk[i + 1] = ExpandStep(                                               \
+        rk[i - 1],                                                        \
+        _mm_shuffle_epi32(_mm_aeskeygenassist_si128(rk[i], 0), 0xaa));    \
+  }
+  int num_round_keys;
+  if (key_size == 16) {
+    TINK_EXPAND_128(1, 0x01);
+    TINK_EXPAND_128(2, 0x02);
+    TINK_EXPAND_128(3, 0x04);
+    TINK_EXPAND_128(4, 0x08);
+    TINK_EXPAND_128(5, 0x10);
+    TINK_EXPAND_128(6, 0x20);
+    TINK_EXPAND_128(7, 0x40);
+    TINK_EXPAND_128(8, 0x80);
+    TINK_EXPAND_128(9, 0x1b);
+    TINK_EXPAND_128(10, 0x36);
+    num_round_keys = 11;
+  } else {
+    rk[1] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key + 16));
+    TINK_EXPAND_256(2, 0x01);
+    TINK_EXPAND_256(4, 0x02);
+    TINK_EXPAND_256(6, 0x04);
+    TINK_EXPAND_256(8, 0x08);
+    TINK_EXPAND_256(10, 0x10);
+    TINK_EXPAND_256(12, 0x20);
+    TINK_EXPAND_256(14, 0x40);
+    num_round_keys = 15;
+  }
+#undef TINK_EXPAND_128
+#undef TINK_EXPAND_256
+  for (int i = 0; i < num_round_keys; i++) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(round_keys[i]), rk[i]);
+  }
+  OPENSSL_cleanse(rk, sizeof(rk));
+}
+
+// Encrypts 'count' independent blocks, round by round, so that the rounds
+// of different blocks overlap in the AES unit.
+TINK_AESNI_TARGET inline void EncryptBlocksAesNi(
+    const uint8_t round_keys[][kBlockSize], int rounds, __m128i* blocks,
+    int count) {
+  __m128i rk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(round_keys[0]));
+  for (int i = 0; i < count; i++) blocks[i] = _mm_xor_si128(blocks[i], rk);
+  for (int round = 1; round < rounds; round++) {
+    rk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(round_keys[round]));
+    for (int i = 0; i < count; i++) {
+      blocks[i] = _mm_aesenc_si128(blocks[i], rk);
+    }
+  }
+  rk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(round_keys[rounds]));
+  for (int i = 0; i < count; i++) {
+    blocks[i] = _mm_aesenclast_si128(blocks[i], rk);
+  }
+}
+
+// Computes the CMACs of 'count' <= AesCmacBatchBoringSsl::kLanes messages.
+// In every step, the next block of every unfinished message is encrypted.
+TINK_AESNI_TARGET void CmacGroupAesNi(const uint8_t round_keys[][kBlockSize],
+                                      int rounds, const uint8_t k1[],
+                                      const uint8_t k2[],
+                                      const absl::string_view* inputs,
+                                      int count, uint8_t* out) {
+  constexpr int kLanes = AesCmacBatchBoringSsl::kLanes;
+  __m128i state[kLanes];
+  size_t num_blocks[kLanes];
+  size_t max_blocks = 0;
+  for (int lane = 0; lane < count; lane++) {
+    state[lane] = _mm_setzero_si128();
+    num_blocks[lane] = NumBlocks(inputs[lane]);
+    max_blocks = std::max(max_blocks, num_blocks[lane]);
+  }
+  uint8_t last[kBlockSize];
+  for (size_t step = 0; step < max_blocks; step++) {
+    __m128i blocks[kLanes];
+    int lanes[kLanes];
+    int active = 0;
+    for (int lane = 0; lane < count; lane++) {
+      if (step >= num_blocks[lane]) continue;
+      __m128i block;
+      if (step + 1 == num_blocks[lane]) {
+        LastBlock(inputs[lane], num_blocks[lane], k1, k2, last);
+        block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(last));
+      } else {
+        block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(
+            inputs[lane].data() + step * kBlockSize));
+      }
+      blocks[active] = _mm_xor_si128(state[lane], block);
+      lanes[active] = lane;
+      active++;
+    }
+    EncryptBlocksAesNi(round_keys, rounds, blocks, active);
+    for (int i = 0; i < active; i++) state[lanes[i]] = blocks[i];
+  }
+  for (int lane = 0; lane < count; lane++) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + lane * kBlockSize),
+                     state[lane]);
+  }
+  OPENSSL_cleanse(last, sizeof(last));
+}
+
+#endif  // TINK_AES_CMAC_AESNI
+
+// Absorbs 'num_blocks' full blocks at 'in' into the CBC-MAC 'state'.
+void CbcMacBlocks(const AES_KEY* aes_key, const uint8_t* in,
+                  size_t num_blocks, uint8_t state[kBlockSize]) {
+  for (size_t i = 0; i < num_blocks; i++) {
+    for (int j = 0; j < kBlockSize; j++) state[j] ^= in[i * kBlockSize + j];
+    AES_encrypt(state, state, aes_key);
+  }
+}
+
+// Finishes a CMAC whose preceding blocks were absorbed into 'state', with the
+// remaining 'data'.
+void CmacPortableFinish(const AES_KEY* aes_key, const uint8_t k1[],
+                        const uint8_t k2[], absl::string_view data,
+                        uint8_t state[kBlockSize], uint8_t out[kBlockSize]) {
+  size_t num_blocks = NumBlocks(data);
+  CbcMacBlocks(aes_key, reinterpret_cast<const uint8_t*>(data.data()),
+               num_blocks - 1, state);
+  uint8_t last[kBlockSize];
+  LastBlock(data, num_blocks, k1, k2, last);
+  for (int j = 0; j < kBlockSize; j++) state[j] ^= last[j];
+  AES_encrypt(state, out, aes_key);
+  OPENSSL_cleanse(last, sizeof(last));
+}
+
+void CmacPortable(const AES_KEY* aes_key, const uint8_t k1[],
+                  const uint8_t k2[], absl::string_view data,
+                  uint8_t out[kBlockSize]) {
+  uint8_t state[kBlockSize] = {0};
+  CmacPortableFinish(aes_key, k1, k2, data, state, out);
+  OPENSSL_cleanse(state, sizeof(state));
+}
+
+}  // namespace
+
+// static
+util::StatusOr<std::unique_ptr<AesCmacBatchBoringSsl>>
+AesCmacBatchBoringSsl::New(const util::SecretData& key) {
+  if (key.size() != 16 && key.size() != 32) {
+    return util::Status(util::error::INVALID_ARGUMENT, "invalid key size");
+  }
+  auto keys = util::MakeSecretUniquePtr<KeySchedule>();
+  if (AES_set_encrypt_key(key.data(), 8 * key.size(), &keys->aes_key) != 0) {
+    return util::Status(util::error::INTERNAL, "could not expand AES key");
+  }
+  uint8_t l[kBlockSize] = {0};
+  AES_encrypt(l, l, &keys->aes_key);
+  MultiplyByX(l, keys->k1);
+  MultiplyByX(keys->k1, keys->k2);
+  OPENSSL_cleanse(l, sizeof(l));
+  keys->rounds = key.size() == 16 ? 10 : 14;
+  keys->use_aesni = false;
+#ifdef TINK_AES_CMAC_AESNI
+  if (HasAesNi()) {
+    ExpandKeyAesNi(key.data(), key.size(), keys->round_keys);
+    keys->use_aesni = true;
+  }
+#endif
+  return absl::WrapUnique(new AesCmacBatchBoringSsl(std::move(keys)));
+}
+
+void AesCmacBatchBoringSsl::ComputeGroup(const absl::string_view* inputs,
+                                         int count, uint8_t* out) const {
+#ifdef TINK_AES_CMAC_AESNI
+  if (keys_->use_aesni) {
+    CmacGroupAesNi(keys_->round_keys, keys_->rounds, keys_->k1, keys_->k2,
+                   inputs, count, out);
+    return;
+  }
+#endif
+  for (int i = 0; i < count; i++) {
+    CmacPortable(&keys_->aes_key, keys_->k1, keys_->k2, inputs[i],
+                 out + i * kTagSize);
+  }
+}
+
+void AesCmacBatchBoringSsl::Compute(absl::string_view data,
+                                    uint8_t out[kTagSize]) const {
+  ComputeGroup(&data, 1, out);
+}
+
+void AesCmacBatchBoringSsl::Compute(absl::string_view data,
+                                    absl::string_view suffix,
+                                    uint8_t out[kTagSize]) const {
+  if (suffix.empty()) {
+    Compute(data, out);
+    return;
+  }
+  // All full blocks of 'data' are followed by a byte of 'suffix', so none of
+  // them is the last block, which alone depends on where the message ends.
+  // They are absorbed in place, and only the partial block of 'data' that
+  // remains is copied together with 'suffix'.
+  size_t num_full_blocks = data.size() / kBlockSize;
+  uint8_t state[kBlockSize] = {0};
+  CbcMacBlocks(&keys_->aes_key, reinterpret_cast<const uint8_t*>(data.data()),
+               num_full_blocks, state);
+  std::string rest(data.substr(num_full_blocks * kBlockSize));
+  rest.append(suffix.data(), suffix.size());
+  CmacPortableFinish(&keys_->aes_key, keys_->k1, keys_->k2, rest, state, out);
+  OPENSSL_cleanse(state, sizeof(state));
+}
+
+void AesCmacBatchBoringSsl::ComputeTags(
+    absl::Span<const absl::string_view> inputs, uint8_t* out) const {
+  for (size_t i = 0; i < inputs.size(); i += kLanes) {
+    int count = std::min<size_t>(kLanes, inputs.size() - i);
+    ComputeGroup(&inputs[i], count, out + i * kTagSize);
+  }
+}
+
+util::Status AesCmacBatchBoringSsl::ComputeBatch(
+    absl::Span<const absl::string_view> inputs, size_t tag_size,
+    std::string* output) const {
+  if (tag_size > kTagSize) {
+    return util::Status(util::error::INVALID_ARGUMENT, "invalid tag size");
+  }
+  ResizeStringUninitialized(output, inputs.size() * tag_size);
+  uint8_t tags[kLanes * kTagSize];
+  for (size_t i = 0; i < inputs.size(); i += kLanes) {
+    int count = std::min<size_t>(kLanes, inputs.size() - i);
+    ComputeGroup(&inputs[i], count, tags);
+    for (int j = 0; j < count; j++) {
+      std::memcpy(&(*output)[(i + j) * tag_size], tags + j * kTagSize,
+                  tag_size);
+    }
+  }
+  return util::OkStatus();
+}
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
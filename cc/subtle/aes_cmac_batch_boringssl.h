@@ -0,0 +1,105 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_SUBTLE_AES_CMAC_BATCH_BORINGSSL_H_
+#define TINK_SUBTLE_AES_CMAC_BATCH_BORINGSSL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "openssl/aes.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+// Computes AES-CMACs (RFC 4493) of many independent messages under a single
+// key.
+//
+// The AES key schedule and the CMAC subkeys K1 and K2 are computed once, at
+// construction, so a CMAC costs only its block encryptions, without the
+// CMAC_CTX allocation and key setup of BoringSSL's AES_CMAC(). CMAC is
+// serial within a message, so on x86-64 CPUs with AES-NI the blocks of up to
+// kLanes messages are encrypted together, which hides the latency of the
+// AES rounds of each chain. Elsewhere BoringSSL's AES_encrypt() is used.
+//
+// Instances are immutable and thread-safe.
+class AesCmacBatchBoringSsl {
+ public:
+  static constexpr size_t kTagSize = 16;
+  static constexpr int kLanes = 8;
+
+  // The key must have 16 or 32 bytes.
+  static crypto::tink::util::StatusOr<std::unique_ptr<AesCmacBatchBoringSsl>>
+  New(const util::SecretData& key);
+
+  // Writes the CMAC of 'data' to 'out'.
+  void Compute(absl::string_view data, uint8_t out[kTagSize]) const;
+
+  // Writes the CMAC of 'data' followed by 'suffix' to 'out'. Only the bytes
+  // after the last full block of 'data' are copied, so a short suffix can be
+  // added to a long message cheaply.
+  void Compute(absl::string_view data, absl::string_view suffix,
+               uint8_t out[kTagSize]) const;
+
+  // Writes the CMAC of inputs[i] to out + i * kTagSize.
+  void ComputeTags(absl::Span<const absl::string_view> inputs,
+                   uint8_t* out) const;
+
+  // Computes the CMAC of each of 'inputs', truncated to 'tag_size' bytes,
+  // and stores the tags back-to-back in '*output', which is overwritten:
+  // the tag of inputs[i] starts at i * tag_size.
+  crypto::tink::util::Status ComputeBatch(
+      absl::Span<const absl::string_view> inputs, size_t tag_size,
+      std::string* output) const;
+
+ private:
+  static constexpr int kBlockSize = 16;
+
+  struct KeySchedule {
+    AES_KEY aes_key;
+    uint8_t k1[kBlockSize];
+    uint8_t k2[kBlockSize];
+    // The expanded key in the layout of the AES-NI instructions, if they
+    // are used.
+    uint8_t round_keys[15][kBlockSize];
+    int rounds;
+    bool use_aesni;
+  };
+
+  explicit AesCmacBatchBoringSsl(util::SecretUniquePtr<KeySchedule> keys)
+      : keys_(std::move(keys)) {}
+
+  // Computes the CMACs of up to kLanes messages.
+  void ComputeGroup(const absl::string_view* inputs, int count,
+                    uint8_t* out) const;
+
+  const util::SecretUniquePtr<KeySchedule> keys_;
+};
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_SUBTLE_AES_CMAC_BATCH_BORINGSSL_H_
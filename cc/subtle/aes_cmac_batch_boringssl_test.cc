@@ -0,0 +1,142 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/subtle/aes_cmac_batch_boringssl.h"
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "absl/strings/string_view.h"
+#include "tink/subtle/random.h"
+#include "tink/subtle/stateful_cmac_boringssl.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/test_matchers.h"
+#include "tink/util/test_util.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+namespace {
+
+using ::crypto::tink::test::HexDecodeOrDie;
+using ::crypto::tink::test::HexEncode;
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+
+std::string ComputeBatch(const AesCmacBatchBoringSsl& cmac,
+                         const std::vector<absl::string_view>& inputs,
+                         size_t tag_size) {
+  std::string output;
+  EXPECT_THAT(cmac.ComputeBatch(inputs, tag_size, &output), IsOk());
+  return output;
+}
+
+std::string StatefulCmac(const util::SecretData& key,
+                         absl::string_view data) {
+  auto cmac_result = StatefulCmacBoringSsl::New(16, key);
+  EXPECT_THAT(cmac_result.status(), IsOk());
+  if (!cmac_result.ok()) return "";
+  auto cmac = std::move(cmac_result.ValueOrDie());
+  EXPECT_THAT(cmac->Update(data), IsOk());
+  auto tag_result = cmac->Finalize();
+  EXPECT_THAT(tag_result.status(), IsOk());
+  if (!tag_result.ok()) return "";
+  return tag_result.ValueOrDie();
+}
+
+TEST(AesCmacBatchBoringSslTest, RfcTestVectors) {
+  // RFC 4493, section 4, examples 1 to 4.
+  util::SecretData key = util::SecretDataFromStringView(
+      HexDecodeOrDie("2b7e151628aed2a6abf7158809cf4f3c"));
+  std::string message = HexDecodeOrDie(
+      "6bc1bee22e409f96e93d7e117393172a"
+      "ae2d8a571e03ac9c9eb76fac45af8e51"
+      "30c81c46a35ce411e5fbc1191a0a52ef"
+      "f69f2445df4f9b17ad2b417be66c3710");
+  auto cmac_result = AesCmacBatchBoringSsl::New(key);
+  ASSERT_THAT(cmac_result.status(), IsOk());
+  std::vector<absl::string_view> inputs = {
+      absl::string_view(message).substr(0, 0),
+      absl::string_view(message).substr(0, 16),
+      absl::string_view(message).substr(0, 40),
+      absl::string_view(message)};
+  EXPECT_EQ(HexEncode(ComputeBatch(*cmac_result.ValueOrDie(), inputs, 16)),
+            "bb1d6929e95937287fa37d129b756746"
+            "070a16b46b4d4144f79bdd9dd04a287c"
+            "dfa66747de9ae63030ca32611497c827"
+            "51f0bebf7e3b9d92fc49741779363cfe");
+}
+
+TEST(AesCmacBatchBoringSslTest, MatchesStatefulCmac) {
+  for (int key_size : {16, 32}) {
+    util::SecretData key = Random::GetRandomKeyBytes(key_size);
+    auto cmac_result = AesCmacBatchBoringSsl::New(key);
+    ASSERT_THAT(cmac_result.status(), IsOk());
+    // More messages than lanes, of lengths around the block boundaries.
+    std::vector<std::string> messages;
+    for (int size = 0; size <= 100; size++) {
+      messages.push_back(Random::GetRandomBytes(size));
+    }
+    std::vector<absl::string_view> inputs(messages.begin(), messages.end());
+    std::string tags =
+        ComputeBatch(*cmac_result.ValueOrDie(), inputs, /*tag_size=*/16);
+    ASSERT_EQ(tags.size(), 16 * messages.size());
+    for (size_t i = 0; i < messages.size(); i++) {
+      EXPECT_EQ(HexEncode(tags.substr(16 * i, 16)),
+                HexEncode(StatefulCmac(key, messages[i])))
+          << "key_size=" << key_size << " size=" << i;
+    }
+  }
+}
+
+TEST(AesCmacBatchBoringSslTest, Truncation) {
+  util::SecretData key = Random::GetRandomKeyBytes(32);
+  auto cmac_result = AesCmacBatchBoringSsl::New(key);
+  ASSERT_THAT(cmac_result.status(), IsOk());
+  const AesCmacBatchBoringSsl& cmac = *cmac_result.ValueOrDie();
+  std::vector<absl::string_view> inputs = {"a", "bc", "def"};
+  std::string full = ComputeBatch(cmac, inputs, 16);
+  std::string truncated = ComputeBatch(cmac, inputs, 10);
+  ASSERT_EQ(truncated.size(), 30);
+  for (int i = 0; i < 3; i++) {
+    EXPECT_EQ(truncated.substr(10 * i, 10), full.substr(16 * i, 10));
+  }
+  EXPECT_EQ(ComputeBatch(cmac, {}, 16), "");
+}
+
+TEST(AesCmacBatchBoringSslTest, InvalidKeySizes) {
+  for (int key_size : {0, 15, 17, 24, 31, 33, 64}) {
+    util::SecretData key(key_size, 'k');
+    EXPECT_THAT(AesCmacBatchBoringSsl::New(key).status(),
+                StatusIs(util::error::INVALID_ARGUMENT))
+        << "key_size=" << key_size;
+  }
+}
+
+TEST(AesCmacBatchBoringSslTest, InvalidTagSizes) {
+  auto cmac_result = AesCmacBatchBoringSsl::New(Random::GetRandomKeyBytes(16));
+  ASSERT_THAT(cmac_result.status(), IsOk());
+  std::string output;
+  EXPECT_THAT(cmac_result.ValueOrDie()->ComputeBatch({"a"}, 17, &output),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
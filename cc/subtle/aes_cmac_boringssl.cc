@@ -17,12 +17,13 @@
 #include "tink/subtle/aes_cmac_boringssl.h"
 
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "absl/memory/memory.h"
-#include "openssl/cmac.h"
+#include "absl/types/span.h"
 #include "openssl/mem.h"
-#include "tink/subtle/subtle_util.h"
-#include "tink/subtle/subtle_util_boringssl.h"
+#include "tink/subtle/aes_cmac_batch_boringssl.h"
 #include "tink/util/status.h"
 
 namespace crypto {
@@ -41,51 +42,77 @@ util::StatusOr<std::unique_ptr<Mac>> AesCmacBoringSsl::New(util::SecretData key,
   if (tag_size > kMaxTagSize) {
     return util::Status(util::error::INVALID_ARGUMENT, "invalid tag size");
   }
-  return {absl::WrapUnique(new AesCmacBoringSsl(std::move(key), tag_size))};
+  auto cmac_result = AesCmacBatchBoringSsl::New(key);
+  if (!cmac_result.ok()) return cmac_result.status();
+  return {absl::WrapUnique(
+      new AesCmacBoringSsl(std::move(cmac_result.ValueOrDie()), tag_size))};
 }
 
 util::StatusOr<std::string> AesCmacBoringSsl::ComputeMac(
     absl::string_view data) const {
-  // BoringSSL expects a non-null pointer for data,
-  // regardless of whether the size is 0.
-  data = SubtleUtilBoringSSL::EnsureNonNull(data);
-
-  std::string result;
-  ResizeStringUninitialized(&result, kMaxTagSize);
-  const int res =
-      AES_CMAC(reinterpret_cast<uint8_t*>(&result[0]), key_.data(), key_.size(),
-               reinterpret_cast<const uint8_t*>(data.data()), data.size());
-  if (res == 0) {
-    return util::Status(util::error::INTERNAL,
-                        "BoringSSL failed to compute CMAC");
-  }
-  result.resize(tag_size_);
-  return result;
+  uint8_t buf[kMaxTagSize];
+  cmac_->Compute(data, buf);
+  return std::string(reinterpret_cast<const char*>(buf), tag_size_);
 }
 
 util::Status AesCmacBoringSsl::VerifyMac(absl::string_view mac,
                                          absl::string_view data) const {
-  // BoringSSL expects a non-null pointer for data,
-  // regardless of whether the size is 0.
-  data = SubtleUtilBoringSSL::EnsureNonNull(data);
+  return VerifyMacWithSuffix(mac, data, "");
+}
+
+util::StatusOr<std::string> AesCmacBoringSsl::ComputeMacWithPrefix(
+    absl::string_view output_prefix, absl::string_view data,
+    absl::string_view data_suffix) const {
+  uint8_t buf[kMaxTagSize];
+  cmac_->Compute(data, data_suffix, buf);
+  std::string mac;
+  mac.reserve(output_prefix.size() + tag_size_);
+  mac.append(output_prefix.data(), output_prefix.size());
+  mac.append(reinterpret_cast<const char*>(buf), tag_size_);
+  return mac;
+}
 
-  if (mac.size() != tag_size_) {
+util::Status AesCmacBoringSsl::VerifyMacWithSuffix(
+    absl::string_view mac_value, absl::string_view data,
+    absl::string_view data_suffix) const {
+  if (mac_value.size() != tag_size_) {
     return util::Status(util::error::INVALID_ARGUMENT, "incorrect tag size");
   }
   uint8_t buf[kMaxTagSize];
-  const int res =
-      AES_CMAC(buf, key_.data(), key_.size(),
-               reinterpret_cast<const uint8_t*>(data.data()), data.size());
-  if (res == 0) {
-    return util::Status(util::error::INTERNAL,
-                        "BoringSSL failed to compute CMAC");
-  }
-  if (CRYPTO_memcmp(buf, mac.data(), tag_size_) != 0) {
+  cmac_->Compute(data, data_suffix, buf);
+  if (CRYPTO_memcmp(buf, mac_value.data(), tag_size_) != 0) {
     return util::Status(util::error::INVALID_ARGUMENT, "verification failed");
   }
   return util::OkStatus();
 }
 
+std::vector<util::Status> AesCmacBoringSsl::BatchVerifyMac(
+    absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs)
+    const {
+  std::vector<absl::string_view> data;
+  data.reserve(inputs.size());
+  for (const auto& input : inputs) data.push_back(input.second);
+  std::vector<uint8_t> tags(inputs.size() * kMaxTagSize);
+  cmac_->ComputeTags(data, tags.data());
+
+  std::vector<util::Status> results;
+  results.reserve(inputs.size());
+  for (size_t i = 0; i < inputs.size(); i++) {
+    absl::string_view mac = inputs[i].first;
+    if (mac.size() != tag_size_) {
+      results.push_back(
+          util::Status(util::error::INVALID_ARGUMENT, "incorrect tag size"));
+    } else if (CRYPTO_memcmp(&tags[i * kMaxTagSize], mac.data(), tag_size_) !=
+               0) {
+      results.push_back(
+          util::Status(util::error::INVALID_ARGUMENT, "verification failed"));
+    } else {
+      results.push_back(util::OkStatus());
+    }
+  }
+  return results;
+}
+
 }  // namespace subtle
 }  // namespace tink
 }  // namespace crypto
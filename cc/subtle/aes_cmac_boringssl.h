@@ -19,9 +19,12 @@
 
 #include <memory>
 #include <utility>
+#include <vector>
 
+#include "absl/types/span.h"
 #include "tink/mac.h"
 #include "tink/config/tink_fips.h"
+#include "tink/subtle/aes_cmac_batch_boringssl.h"
 #include "tink/util/secret_data.h"
 #include "tink/util/statusor.h"
 
@@ -43,6 +46,21 @@ class AesCmacBoringSsl : public Mac {
   crypto::tink::util::Status VerifyMac(absl::string_view mac,
                                        absl::string_view data) const override;
 
+  // Authenticates 'data' and 'data_suffix' without concatenating them, and
+  // writes the MAC directly after 'output_prefix'.
+  crypto::tink::util::StatusOr<std::string> ComputeMacWithPrefix(
+      absl::string_view output_prefix, absl::string_view data,
+      absl::string_view data_suffix) const override;
+
+  crypto::tink::util::Status VerifyMacWithSuffix(
+      absl::string_view mac_value, absl::string_view data,
+      absl::string_view data_suffix) const override;
+
+  // Computes the CMACs of the batch together; see AesCmacBatchBoringSsl.
+  std::vector<crypto::tink::util::Status> BatchVerifyMac(
+      absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs)
+      const override;
+
   static constexpr crypto::tink::FipsCompatibility kFipsStatus =
       crypto::tink::FipsCompatibility::kNotFips;
 
@@ -56,10 +74,11 @@ class AesCmacBoringSsl : public Mac {
   static constexpr size_t kBigKeySize = 32;
   static constexpr size_t kMaxTagSize = 16;
 
-  AesCmacBoringSsl(util::SecretData key, uint32_t tag_size)
-      : key_(std::move(key)), tag_size_(tag_size) {}
+  AesCmacBoringSsl(std::unique_ptr<AesCmacBatchBoringSsl> cmac,
+                   uint32_t tag_size)
+      : cmac_(std::move(cmac)), tag_size_(tag_size) {}
 
-  const util::SecretData key_;
+  const std::unique_ptr<AesCmacBatchBoringSsl> cmac_;
   const uint32_t tag_size_;
 };
 
@@ -17,8 +17,12 @@
 #include "tink/subtle/aes_cmac_boringssl.h"
 
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
 #include "tink/config/tink_fips.h"
 #include "tink/mac.h"
 #include "tink/subtle/common_enums.h"
@@ -232,6 +236,76 @@ TEST(AesCmacBoringSslTest, InvalidTagSizes) {
   }
 }
 
+TEST(AesCmacBoringSslTest, BatchVerifyMac) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+
+  util::SecretData key = util::SecretDataFromStringView(test::HexDecodeOrDie(
+      "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"));
+  auto cmac_result = AesCmacBoringSsl::New(key, kSmallTagSize);
+  ASSERT_TRUE(cmac_result.ok()) << cmac_result.status();
+  auto cmac = std::move(cmac_result.ValueOrDie());
+
+  std::vector<std::string> data;
+  std::vector<std::string> tags;
+  for (int i = 0; i < 20; i++) {
+    data.push_back(std::string(3 * i, 'a' + i));
+    auto tag_result = cmac->ComputeMac(data.back());
+    ASSERT_TRUE(tag_result.ok()) << tag_result.status();
+    tags.push_back(tag_result.ValueOrDie());
+  }
+  tags[3][0] ^= 1;
+  tags[11].pop_back();
+  std::vector<std::pair<absl::string_view, absl::string_view>> inputs;
+  for (int i = 0; i < 20; i++) inputs.emplace_back(tags[i], data[i]);
+
+  std::vector<util::Status> results = cmac->BatchVerifyMac(inputs);
+  ASSERT_EQ(results.size(), inputs.size());
+  for (int i = 0; i < 20; i++) {
+    if (i == 3 || i == 11) {
+      EXPECT_THAT(results[i], StatusIs(util::error::INVALID_ARGUMENT))
+          << "i=" << i;
+    } else {
+      EXPECT_TRUE(results[i].ok()) << "i=" << i << " " << results[i];
+    }
+  }
+  EXPECT_TRUE(cmac->BatchVerifyMac({}).empty());
+}
+
+TEST(AesCmacBoringSslTest, ComputeAndVerifyWithSuffix) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+
+  util::SecretData key = util::SecretDataFromStringView(test::HexDecodeOrDie(
+      "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"));
+  auto cmac_result = AesCmacBoringSsl::New(key, kTagSize);
+  ASSERT_TRUE(cmac_result.ok()) << cmac_result.status();
+  auto cmac = std::move(cmac_result.ValueOrDie());
+
+  // Covers data which ends inside, and on the boundary of, a block.
+  for (int size : {0, 1, 15, 16, 17, 31, 32, 33, 100}) {
+    std::string data(size, 'x');
+    for (absl::string_view suffix :
+         {absl::string_view(""), absl::string_view("\0", 1),
+          absl::string_view("suffix")}) {
+      auto tag_result = cmac->ComputeMac(absl::StrCat(data, suffix));
+      ASSERT_TRUE(tag_result.ok()) << tag_result.status();
+      std::string tag = tag_result.ValueOrDie();
+
+      auto prefixed_result = cmac->ComputeMacWithPrefix("prefix", data, suffix);
+      ASSERT_TRUE(prefixed_result.ok()) << prefixed_result.status();
+      EXPECT_EQ(prefixed_result.ValueOrDie(), absl::StrCat("prefix", tag))
+          << "size=" << size;
+      EXPECT_TRUE(cmac->VerifyMacWithSuffix(tag, data, suffix).ok())
+          << "size=" << size;
+      EXPECT_FALSE(cmac->VerifyMacWithSuffix(tag, data, "other").ok())
+          << "size=" << size;
+    }
+  }
+}
+
 class AesCmacBoringSslTestVectorTest
     : public ::testing::TestWithParam<std::pair<int, std::string>> {
  public:
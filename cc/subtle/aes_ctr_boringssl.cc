@@ -16,9 +16,12 @@
 
 #include "tink/subtle/aes_ctr_boringssl.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <string>
 
 #include "absl/memory/memory.h"
+#include "absl/types/span.h"
 #include "openssl/evp.h"
 #include "tink/config/tink_fips.h"
 #include "tink/subtle/random.h"
@@ -49,33 +52,42 @@ util::StatusOr<std::unique_ptr<IndCpaCipher>> AesCtrBoringSsl::New(
 
 util::StatusOr<std::string> AesCtrBoringSsl::Encrypt(
     absl::string_view plaintext) const {
+  std::string ciphertext;
+  ResizeStringUninitialized(&ciphertext, iv_size_ + plaintext.size());
+  auto written_result = EncryptInto(plaintext, absl::MakeSpan(ciphertext));
+  if (!written_result.ok()) return written_result.status();
+  return ciphertext;
+}
+
+util::StatusOr<int64_t> AesCtrBoringSsl::CiphertextSize(
+    int64_t plaintext_size) const {
+  return iv_size_ + plaintext_size;
+}
+
+util::StatusOr<int64_t> AesCtrBoringSsl::EncryptInto(
+    absl::string_view plaintext, absl::Span<char> buffer) const {
   // BoringSSL expects a non-null pointer for plaintext, regardless of whether
   // the size is 0.
   plaintext = SubtleUtilBoringSSL::EnsureNonNull(plaintext);
-
-  bssl::UniquePtr<EVP_CIPHER_CTX> ctx(EVP_CIPHER_CTX_new());
-  if (ctx.get() == nullptr) {
-    return util::Status(util::error::INTERNAL,
-                        "could not initialize EVP_CIPHER_CTX");
+  if (buffer.size() < iv_size_ + plaintext.size()) {
+    return util::Status(util::error::INVALID_ARGUMENT, "Buffer too small");
   }
-  std::string ciphertext = Random::GetRandomBytes(iv_size_);
+
+  bssl::ScopedEVP_CIPHER_CTX ctx;
+  Random::FillRandomBytes(buffer.subspan(0, iv_size_));
   // OpenSSL expects that the IV must be a full block. We pad with zeros.
-  std::string iv_block = ciphertext;
   // Note that kBlockSize >= iv_size_ is checked in the factory method.
-  // We explicitly add the '\0' argument to stress that we need to initialize
-  // the new memory.
-  iv_block.resize(kBlockSize, '\0');
+  uint8_t iv_block[kBlockSize] = {0};
+  std::copy(buffer.begin(), buffer.begin() + iv_size_, iv_block);
 
-  int ret =
-      EVP_EncryptInit_ex(ctx.get(), cipher_, nullptr /* engine */, key_.data(),
-                         reinterpret_cast<const uint8_t*>(&iv_block[0]));
+  int ret = EVP_EncryptInit_ex(ctx.get(), cipher_, nullptr /* engine */,
+                               key_.data(), iv_block);
   if (ret != 1) {
     return util::Status(util::error::INTERNAL, "could not initialize ctx");
   }
-  ResizeStringUninitialized(&ciphertext, iv_size_ + plaintext.size());
   int len;
   ret = EVP_EncryptUpdate(
-      ctx.get(), reinterpret_cast<uint8_t*>(&ciphertext[iv_size_]), &len,
+      ctx.get(), reinterpret_cast<uint8_t*>(buffer.data() + iv_size_), &len,
       reinterpret_cast<const uint8_t*>(plaintext.data()), plaintext.size());
   if (ret != 1) {
     return util::Status(util::error::INTERNAL, "encryption failed");
@@ -83,7 +95,7 @@ util::StatusOr<std::string> AesCtrBoringSsl::Encrypt(
   if (len != plaintext.size()) {
     return util::Status(util::error::INTERNAL, "incorrect ciphertext size");
   }
-  return ciphertext;
+  return iv_size_ + plaintext.size();
 }
 
 util::StatusOr<std::string> AesCtrBoringSsl::Decrypt(
@@ -17,9 +17,12 @@
 #ifndef TINK_SUBTLE_AES_CTR_BORINGSSL_H_
 #define TINK_SUBTLE_AES_CTR_BORINGSSL_H_
 
+#include <cstdint>
 #include <memory>
 #include <utility>
 
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "openssl/evp.h"
 #include "tink/config/tink_fips.h"
 #include "tink/subtle/ind_cpa_cipher.h"
@@ -41,6 +44,12 @@ class AesCtrBoringSsl : public IndCpaCipher {
   crypto::tink::util::StatusOr<std::string> Decrypt(
       absl::string_view ciphertext) const override;
 
+  crypto::tink::util::StatusOr<int64_t> CiphertextSize(
+      int64_t plaintext_size) const override;
+
+  crypto::tink::util::StatusOr<int64_t> EncryptInto(
+      absl::string_view plaintext, absl::Span<char> buffer) const override;
+
   static constexpr crypto::tink::FipsCompatibility kFipsStatus =
       crypto::tink::FipsCompatibility::kRequiresBoringCrypto;
 
@@ -0,0 +1,345 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/subtle/aes_ctr_hmac_boringssl.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "openssl/mem.h"
+#include "tink/subtle/random.h"
+#include "tink/subtle/subtle_util.h"
+#include "tink/subtle/subtle_util_boringssl.h"
+#include "tink/util/errors.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+constexpr int AesCtrHmacBoringSsl::kMinIvSizeInBytes;
+constexpr int AesCtrHmacBoringSsl::kBlockSize;
+constexpr int AesCtrHmacBoringSsl::kMinTagSizeInBytes;
+constexpr size_t AesCtrHmacBoringSsl::kMinHmacKeySize;
+constexpr size_t AesCtrHmacBoringSsl::kChunkSize;
+
+namespace {
+
+util::Status CheckAdditionalDataSize(absl::string_view additional_data) {
+  uint64_t aad_size_in_bytes = additional_data.size();
+  uint64_t aad_size_in_bits = aad_size_in_bytes * 8;
+  if (aad_size_in_bits / 8 != aad_size_in_bytes /* overflow occured! */) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "additional data too long");
+  }
+  return util::OkStatus();
+}
+
+}  // namespace
+
+// static
+util::StatusOr<std::unique_ptr<Aead>> AesCtrHmacBoringSsl::New(
+    util::SecretData aes_key, int iv_size, HashType hash_type,
+    const util::SecretData& hmac_key, int tag_size) {
+  auto status = CheckFipsCompatibility<AesCtrHmacBoringSsl>();
+  if (!status.ok()) return status;
+
+  const EVP_CIPHER* cipher =
+      SubtleUtilBoringSSL::GetAesCtrCipherForKeySize(aes_key.size());
+  if (cipher == nullptr) {
+    return util::Status(util::error::INVALID_ARGUMENT, "invalid key size");
+  }
+  if (iv_size < kMinIvSizeInBytes || iv_size > kBlockSize) {
+    return util::Status(util::error::INVALID_ARGUMENT, "invalid iv size");
+  }
+  util::StatusOr<const EVP_MD*> md_result =
+      SubtleUtilBoringSSL::EvpHash(hash_type);
+  if (!md_result.ok()) return md_result.status();
+  const EVP_MD* md = md_result.ValueOrDie();
+  if (tag_size < kMinTagSizeInBytes ||
+      static_cast<int>(EVP_MD_size(md)) < tag_size) {
+    return util::Status(util::error::INVALID_ARGUMENT, "invalid tag size");
+  }
+  if (hmac_key.size() < kMinHmacKeySize) {
+    return util::Status(util::error::INVALID_ARGUMENT, "invalid key size");
+  }
+  bssl::UniquePtr<HMAC_CTX> hmac_context(HMAC_CTX_new());
+  if (hmac_context == nullptr ||
+      !HMAC_Init_ex(hmac_context.get(), hmac_key.data(), hmac_key.size(), md,
+                    nullptr /* engine */)) {
+    return util::Status(util::error::INTERNAL,
+                        "BoringSSL failed to initialize HMAC");
+  }
+  return {absl::WrapUnique(new AesCtrHmacBoringSsl(
+      std::move(aes_key), iv_size, cipher, tag_size,
+      std::move(hmac_context)))};
+}
+
+class AesCtrHmacBoringSsl::Bound : public BoundAead {
+ public:
+  Bound(const AesCtrHmacBoringSsl* aead, bssl::UniquePtr<HMAC_CTX> hmac_start,
+        uint64_t additional_data_size)
+      : aead_(aead),
+        hmac_start_(std::move(hmac_start)),
+        additional_data_size_(additional_data_size) {}
+
+  util::StatusOr<std::string> Encrypt(
+      absl::string_view plaintext) const override {
+    plaintext = SubtleUtilBoringSSL::EnsureNonNull(plaintext);
+    std::string ciphertext;
+    ResizeStringUninitialized(&ciphertext, aead_->iv_size_ + plaintext.size() +
+                                               aead_->tag_size_);
+    auto written_result = aead_->EncryptIntoFrom(
+        hmac_start_.get(), /*additional_data=*/"",
+        additional_data_size_, plaintext, absl::MakeSpan(ciphertext));
+    if (!written_result.ok()) return written_result.status();
+    return ciphertext;
+  }
+
+  util::StatusOr<std::string> Decrypt(
+      absl::string_view ciphertext) const override {
+    if (ciphertext.size() < aead_->iv_size_ + aead_->tag_size_) {
+      return util::Status(util::error::INVALID_ARGUMENT,
+                          "ciphertext too short");
+    }
+    std::string plaintext;
+    ResizeStringUninitialized(
+        &plaintext, ciphertext.size() - aead_->iv_size_ - aead_->tag_size_);
+    auto written_result = aead_->DecryptIntoFrom(
+        hmac_start_.get(), /*additional_data=*/"",
+        additional_data_size_, ciphertext, absl::MakeSpan(plaintext));
+    if (!written_result.ok()) return written_result.status();
+    return plaintext;
+  }
+
+ private:
+  const AesCtrHmacBoringSsl* const aead_;
+  // The HMAC state after the associated data.
+  const bssl::UniquePtr<HMAC_CTX> hmac_start_;
+  const uint64_t additional_data_size_;
+};
+
+util::Status AesCtrHmacBoringSsl::Init(const HMAC_CTX* hmac_start,
+                                       absl::string_view additional_data,
+                                       absl::string_view iv, int encrypt,
+                                       EVP_CIPHER_CTX* ctx,
+                                       HMAC_CTX* hmac) const {
+  // OpenSSL expects that the IV must be a full block. We pad with zeros.
+  uint8_t iv_block[kBlockSize] = {0};
+  std::copy(iv.begin(), iv.end(), iv_block);
+  if (!EVP_CipherInit_ex(ctx, cipher_, nullptr /* engine */, aes_key_.data(),
+                         iv_block, encrypt)) {
+    return util::Status(util::error::INTERNAL, "could not initialize ctx");
+  }
+  if (!HMAC_CTX_copy_ex(hmac, hmac_start) ||
+      !HMAC_Update(hmac,
+                   reinterpret_cast<const uint8_t*>(additional_data.data()),
+                   additional_data.size()) ||
+      !HMAC_Update(hmac, reinterpret_cast<const uint8_t*>(iv.data()),
+                   iv.size())) {
+    return util::Status(util::error::INTERNAL,
+                        "BoringSSL failed to compute HMAC");
+  }
+  return util::OkStatus();
+}
+
+util::Status AesCtrHmacBoringSsl::FinalizeTag(uint64_t additional_data_size,
+                                              HMAC_CTX* hmac,
+                                              uint8_t* tag) const {
+  uint64_t aad_size_in_bits = additional_data_size * 8;
+  uint8_t aad_size[8];
+  for (int i = 7; i >= 0; i--) {
+    aad_size[i] = aad_size_in_bits & 0xff;
+    aad_size_in_bits >>= 8;
+  }
+  unsigned int tag_len;
+  if (!HMAC_Update(hmac, aad_size, sizeof(aad_size)) ||
+      !HMAC_Final(hmac, tag, &tag_len)) {
+    return util::Status(util::error::INTERNAL,
+                        "BoringSSL failed to compute HMAC");
+  }
+  return util::OkStatus();
+}
+
+util::StatusOr<std::unique_ptr<BoundAead>>
+AesCtrHmacBoringSsl::BindAssociatedData(
+    absl::string_view associated_data) const {
+  // BoringSSL expects a non-null pointer for associated_data,
+  // regardless of whether the size is 0.
+  associated_data = SubtleUtilBoringSSL::EnsureNonNull(associated_data);
+  util::Status status = CheckAdditionalDataSize(associated_data);
+  if (!status.ok()) return status;
+  bssl::UniquePtr<HMAC_CTX> hmac_start(HMAC_CTX_new());
+  if (hmac_start == nullptr ||
+      !HMAC_CTX_copy_ex(hmac_start.get(), hmac_context_.get()) ||
+      !HMAC_Update(hmac_start.get(),
+                   reinterpret_cast<const uint8_t*>(associated_data.data()),
+                   associated_data.size())) {
+    return util::Status(util::error::INTERNAL,
+                        "BoringSSL failed to compute HMAC");
+  }
+  std::unique_ptr<BoundAead> bound(
+      new Bound(this, std::move(hmac_start), associated_data.size()));
+  return std::move(bound);
+}
+
+util::StatusOr<std::string> AesCtrHmacBoringSsl::Encrypt(
+    absl::string_view plaintext, absl::string_view additional_data) const {
+  std::string ciphertext;
+  ResizeStringUninitialized(&ciphertext,
+                            iv_size_ + plaintext.size() + tag_size_);
+  auto written_result =
+      EncryptInto(plaintext, additional_data, absl::MakeSpan(ciphertext));
+  if (!written_result.ok()) return written_result.status();
+  return ciphertext;
+}
+
+util::StatusOr<int64_t> AesCtrHmacBoringSsl::CiphertextSize(
+    int64_t plaintext_size) const {
+  return iv_size_ + plaintext_size + tag_size_;
+}
+
+util::StatusOr<int64_t> AesCtrHmacBoringSsl::EncryptInto(
+    absl::string_view plaintext, absl::string_view additional_data,
+    absl::Span<char> buffer) const {
+  // BoringSSL expects a non-null pointer for plaintext and additional_data,
+  // regardless of whether the size is 0.
+  plaintext = SubtleUtilBoringSSL::EnsureNonNull(plaintext);
+  additional_data = SubtleUtilBoringSSL::EnsureNonNull(additional_data);
+  util::Status status = CheckAdditionalDataSize(additional_data);
+  if (!status.ok()) return status;
+  return EncryptIntoFrom(hmac_context_.get(), additional_data,
+                         additional_data.size(), plaintext, buffer);
+}
+
+util::StatusOr<int64_t> AesCtrHmacBoringSsl::EncryptIntoFrom(
+    const HMAC_CTX* hmac_start, absl::string_view additional_data,
+    uint64_t additional_data_size, absl::string_view plaintext,
+    absl::Span<char> buffer) const {
+  if (buffer.size() < iv_size_ + plaintext.size() + tag_size_) {
+    return util::Status(util::error::INVALID_ARGUMENT, "Buffer too small");
+  }
+
+  Random::FillRandomBytes(buffer.subspan(0, iv_size_));
+  bssl::ScopedEVP_CIPHER_CTX ctx;
+  bssl::ScopedHMAC_CTX hmac;
+  util::Status status =
+      Init(hmac_start, additional_data,
+           absl::string_view(buffer.data(), iv_size_), /*encrypt=*/1,
+           ctx.get(), hmac.get());
+  if (!status.ok()) return status;
+
+  uint8_t* out = reinterpret_cast<uint8_t*>(buffer.data() + iv_size_);
+  const uint8_t* in = reinterpret_cast<const uint8_t*>(plaintext.data());
+  for (size_t offset = 0; offset < plaintext.size(); offset += kChunkSize) {
+    size_t chunk_size = std::min(kChunkSize, plaintext.size() - offset);
+    int len;
+    if (!EVP_EncryptUpdate(ctx.get(), out + offset, &len, in + offset,
+                           chunk_size) ||
+        len != chunk_size) {
+      return util::Status(util::error::INTERNAL, "encryption failed");
+    }
+    if (!HMAC_Update(hmac.get(), out + offset, chunk_size)) {
+      return util::Status(util::error::INTERNAL,
+                          "BoringSSL failed to compute HMAC");
+    }
+  }
+
+  uint8_t tag[EVP_MAX_MD_SIZE];
+  status = FinalizeTag(additional_data_size, hmac.get(), tag);
+  if (!status.ok()) return status;
+  std::copy(tag, tag + tag_size_, out + plaintext.size());
+  return iv_size_ + plaintext.size() + tag_size_;
+}
+
+util::StatusOr<std::string> AesCtrHmacBoringSsl::Decrypt(
+    absl::string_view ciphertext, absl::string_view additional_data) const {
+  if (ciphertext.size() < iv_size_ + tag_size_) {
+    return util::Status(util::error::INVALID_ARGUMENT, "ciphertext too short");
+  }
+  std::string plaintext;
+  ResizeStringUninitialized(&plaintext,
+                            ciphertext.size() - iv_size_ - tag_size_);
+  auto written_result =
+      DecryptInto(ciphertext, additional_data, absl::MakeSpan(plaintext));
+  if (!written_result.ok()) return written_result.status();
+  return plaintext;
+}
+
+util::StatusOr<int64_t> AesCtrHmacBoringSsl::DecryptInto(
+    absl::string_view ciphertext, absl::string_view additional_data,
+    absl::Span<char> buffer) const {
+  // BoringSSL expects a non-null pointer for additional_data,
+  // regardless of whether the size is 0.
+  additional_data = SubtleUtilBoringSSL::EnsureNonNull(additional_data);
+  util::Status status = CheckAdditionalDataSize(additional_data);
+  if (!status.ok()) return status;
+  return DecryptIntoFrom(hmac_context_.get(), additional_data,
+                         additional_data.size(), ciphertext, buffer);
+}
+
+util::StatusOr<int64_t> AesCtrHmacBoringSsl::DecryptIntoFrom(
+    const HMAC_CTX* hmac_start, absl::string_view additional_data,
+    uint64_t additional_data_size, absl::string_view ciphertext,
+    absl::Span<char> buffer) const {
+  if (ciphertext.size() < iv_size_ + tag_size_) {
+    return util::Status(util::error::INVALID_ARGUMENT, "ciphertext too short");
+  }
+  size_t plaintext_size = ciphertext.size() - iv_size_ - tag_size_;
+  if (buffer.size() < plaintext_size) {
+    return util::Status(util::error::INVALID_ARGUMENT, "Buffer too small");
+  }
+
+  bssl::ScopedEVP_CIPHER_CTX ctx;
+  bssl::ScopedHMAC_CTX hmac;
+  util::Status status =
+      Init(hmac_start, additional_data, ciphertext.substr(0, iv_size_),
+           /*encrypt=*/0, ctx.get(), hmac.get());
+  if (!status.ok()) return status;
+
+  // The plaintext is written to 'buffer' as the ciphertext is MACed, and
+  // wiped if the tag turns out to be wrong.
+  uint8_t* out = reinterpret_cast<uint8_t*>(buffer.data());
+  const uint8_t* in =
+      reinterpret_cast<const uint8_t*>(ciphertext.data() + iv_size_);
+  for (size_t offset = 0; offset < plaintext_size; offset += kChunkSize) {
+    size_t chunk_size = std::min(kChunkSize, plaintext_size - offset);
+    int len;
+    if (!HMAC_Update(hmac.get(), in + offset, chunk_size) ||
+        !EVP_DecryptUpdate(ctx.get(), out + offset, &len, in + offset,
+                           chunk_size) ||
+        len != chunk_size) {
+      OPENSSL_cleanse(out, plaintext_size);
+      return util::Status(util::error::INTERNAL, "decryption failed");
+    }
+  }
+
+  uint8_t tag[EVP_MAX_MD_SIZE];
+  status = FinalizeTag(additional_data_size, hmac.get(), tag);
+  if (!status.ok() ||
+      CRYPTO_memcmp(tag, in + plaintext_size, tag_size_) != 0) {
+    OPENSSL_cleanse(out, plaintext_size);
+    if (!status.ok()) return status;
+    return util::Status(util::error::INVALID_ARGUMENT, "verification failed");
+  }
+  return plaintext_size;
+}
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
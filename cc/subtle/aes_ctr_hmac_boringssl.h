@@ -0,0 +1,142 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_SUBTLE_AES_CTR_HMAC_BORINGSSL_H_
+#define TINK_SUBTLE_AES_CTR_HMAC_BORINGSSL_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "openssl/base.h"
+#include "openssl/evp.h"
+#include "openssl/hmac.h"
+#include "tink/aead.h"
+#include "tink/config/tink_fips.h"
+#include "tink/subtle/common_enums.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+// AES-CTR followed by HMAC, in a single pass over the data. The output is
+// identical to EncryptThenAuthenticate over AesCtrBoringSsl and
+// HmacBoringSsl with the same parameters: (iv || ciphertext || tag), where
+// the tag is the HMAC of (aad || iv || ciphertext || aad size in bits).
+//
+// The payload is processed in chunks which are encrypted and then MACed
+// while they are still in the L1 cache, instead of encrypting all of it and
+// reading it back from memory for the MAC. BoringSSL picks the AES and SHA
+// implementations for the CPU at runtime.
+class AesCtrHmacBoringSsl : public Aead {
+ public:
+  static crypto::tink::util::StatusOr<std::unique_ptr<Aead>> New(
+      util::SecretData aes_key, int iv_size, HashType hash_type,
+      const util::SecretData& hmac_key, int tag_size);
+
+  crypto::tink::util::StatusOr<std::string> Encrypt(
+      absl::string_view plaintext,
+      absl::string_view additional_data) const override;
+
+  crypto::tink::util::StatusOr<std::string> Decrypt(
+      absl::string_view ciphertext,
+      absl::string_view additional_data) const override;
+
+  crypto::tink::util::StatusOr<int64_t> CiphertextSize(
+      int64_t plaintext_size) const override;
+
+  crypto::tink::util::StatusOr<int64_t> EncryptInto(
+      absl::string_view plaintext, absl::string_view additional_data,
+      absl::Span<char> buffer) const override;
+
+  crypto::tink::util::StatusOr<int64_t> DecryptInto(
+      absl::string_view ciphertext, absl::string_view additional_data,
+      absl::Span<char> buffer) const override;
+
+  // The HMAC state after 'associated_data' is computed once, and copied by
+  // every operation of the returned BoundAead.
+  crypto::tink::util::StatusOr<std::unique_ptr<BoundAead>> BindAssociatedData(
+      absl::string_view associated_data) const override;
+
+  static constexpr crypto::tink::FipsCompatibility kFipsStatus =
+      crypto::tink::FipsCompatibility::kRequiresBoringCrypto;
+
+ private:
+  class Bound;
+
+  static constexpr int kMinIvSizeInBytes = 12;
+  static constexpr int kBlockSize = 16;
+  static constexpr int kMinTagSizeInBytes = 10;
+  static constexpr size_t kMinHmacKeySize = 16;
+  // The number of bytes which are encrypted before they are MACed. Small
+  // enough that a chunk stays in the L1 cache.
+  static constexpr size_t kChunkSize = 4096;
+
+  AesCtrHmacBoringSsl(util::SecretData aes_key, int iv_size,
+                      const EVP_CIPHER* cipher, int tag_size,
+                      bssl::UniquePtr<HMAC_CTX> hmac_context)
+      : aes_key_(std::move(aes_key)),
+        iv_size_(iv_size),
+        cipher_(cipher),
+        tag_size_(tag_size),
+        hmac_context_(std::move(hmac_context)) {}
+
+  // Initializes 'ctx' with the key and the IV 'iv', and 'hmac' with a copy
+  // of 'hmac_start', and MACs 'additional_data' and 'iv'.
+  crypto::tink::util::Status Init(const HMAC_CTX* hmac_start,
+                                  absl::string_view additional_data,
+                                  absl::string_view iv, int encrypt,
+                                  EVP_CIPHER_CTX* ctx, HMAC_CTX* hmac) const;
+
+  // MACs 'additional_data_size' in bits and writes the tag to 'tag', which
+  // holds EVP_MAX_MD_SIZE bytes.
+  crypto::tink::util::Status FinalizeTag(uint64_t additional_data_size,
+                                         HMAC_CTX* hmac, uint8_t* tag) const;
+
+  // EncryptInto() and DecryptInto() with the MAC started from 'hmac_start',
+  // which is either the keyed context or the state after some of the
+  // additional data. 'additional_data' is the rest of it, and
+  // 'additional_data_size' is the size of all of it.
+  crypto::tink::util::StatusOr<int64_t> EncryptIntoFrom(
+      const HMAC_CTX* hmac_start, absl::string_view additional_data,
+      uint64_t additional_data_size, absl::string_view plaintext,
+      absl::Span<char> buffer) const;
+  crypto::tink::util::StatusOr<int64_t> DecryptIntoFrom(
+      const HMAC_CTX* hmac_start, absl::string_view additional_data,
+      uint64_t additional_data_size, absl::string_view ciphertext,
+      absl::Span<char> buffer) const;
+
+  const util::SecretData aes_key_;
+  const int iv_size_;
+  // cipher_ is a singleton owned by BoringSsl.
+  const EVP_CIPHER* const cipher_;
+  const int tag_size_;
+  // HMAC context initialized with the key, which is copied for every
+  // operation.
+  const bssl::UniquePtr<HMAC_CTX> hmac_context_;
+};
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_SUBTLE_AES_CTR_HMAC_BORINGSSL_H_
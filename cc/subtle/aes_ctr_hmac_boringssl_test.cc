@@ -0,0 +1,215 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/subtle/aes_ctr_hmac_boringssl.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
+#include "tink/aead.h"
+#include "tink/subtle/aes_ctr_boringssl.h"
+#include "tink/subtle/common_enums.h"
+#include "tink/subtle/encrypt_then_authenticate.h"
+#include "tink/subtle/hmac_boringssl.h"
+#include "tink/subtle/random.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "tink/util/test_matchers.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+namespace {
+
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::testing::Eq;
+
+struct Params {
+  int aes_key_size;
+  int iv_size;
+  HashType hash_type;
+  int tag_size;
+};
+
+class AesCtrHmacBoringSslTest : public ::testing::TestWithParam<Params> {
+ protected:
+  void SetUp() override {
+    const Params& params = GetParam();
+    util::SecretData aes_key = Random::GetRandomKeyBytes(params.aes_key_size);
+    util::SecretData hmac_key = Random::GetRandomKeyBytes(32);
+    auto result = AesCtrHmacBoringSsl::New(aes_key, params.iv_size,
+                                           params.hash_type, hmac_key,
+                                           params.tag_size);
+    ASSERT_THAT(result.status(), IsOk());
+    aead_ = std::move(result.ValueOrDie());
+
+    auto aes_ctr_result = AesCtrBoringSsl::New(aes_key, params.iv_size);
+    ASSERT_THAT(aes_ctr_result.status(), IsOk());
+    auto hmac_result =
+        HmacBoringSsl::New(params.hash_type, params.tag_size, hmac_key);
+    ASSERT_THAT(hmac_result.status(), IsOk());
+    auto reference_result = EncryptThenAuthenticate::New(
+        std::move(aes_ctr_result.ValueOrDie()),
+        std::move(hmac_result.ValueOrDie()), params.tag_size);
+    ASSERT_THAT(reference_result.status(), IsOk());
+    reference_ = std::move(reference_result.ValueOrDie());
+  }
+
+  std::unique_ptr<Aead> aead_;
+  // EncryptThenAuthenticate with the same keys.
+  std::unique_ptr<Aead> reference_;
+};
+
+TEST_P(AesCtrHmacBoringSslTest, MatchesEncryptThenAuthenticate) {
+  const Params& params = GetParam();
+  // Sizes around the chunk size.
+  for (int size : {0, 1, 15, 16, 17, 4095, 4096, 4097, 10000}) {
+    std::string plaintext = Random::GetRandomBytes(size);
+    std::string aad = Random::GetRandomBytes(size % 37);
+
+    auto ciphertext = aead_->Encrypt(plaintext, aad);
+    ASSERT_THAT(ciphertext.status(), IsOk());
+    EXPECT_THAT(ciphertext.ValueOrDie().size(),
+                Eq(params.iv_size + size + params.tag_size));
+    auto decrypted = reference_->Decrypt(ciphertext.ValueOrDie(), aad);
+    ASSERT_THAT(decrypted.status(), IsOk()) << size;
+    EXPECT_THAT(decrypted.ValueOrDie(), Eq(plaintext));
+
+    ciphertext = reference_->Encrypt(plaintext, aad);
+    ASSERT_THAT(ciphertext.status(), IsOk());
+    decrypted = aead_->Decrypt(ciphertext.ValueOrDie(), aad);
+    ASSERT_THAT(decrypted.status(), IsOk()) << size;
+    EXPECT_THAT(decrypted.ValueOrDie(), Eq(plaintext));
+  }
+}
+
+TEST_P(AesCtrHmacBoringSslTest, ModifiedCiphertext) {
+  std::string plaintext = Random::GetRandomBytes(100);
+  std::string aad = "aad";
+  std::string ciphertext = aead_->Encrypt(plaintext, aad).ValueOrDie();
+
+  for (size_t i = 0; i < ciphertext.size(); i++) {
+    std::string modified = ciphertext;
+    modified[i] ^= 1;
+    EXPECT_FALSE(aead_->Decrypt(modified, aad).ok()) << i;
+  }
+  EXPECT_FALSE(aead_->Decrypt(ciphertext, "aae").ok());
+  for (size_t i = 0; i < ciphertext.size(); i++) {
+    EXPECT_FALSE(aead_->Decrypt(ciphertext.substr(0, i), aad).ok()) << i;
+  }
+
+  // The plaintext is not left in the buffer after a failed decryption.
+  ciphertext[10] ^= 1;
+  std::string buffer(plaintext.size(), 'x');
+  EXPECT_FALSE(
+      aead_->DecryptInto(ciphertext, aad, absl::MakeSpan(buffer)).ok());
+  EXPECT_THAT(buffer, Eq(std::string(plaintext.size(), '\0')));
+}
+
+TEST_P(AesCtrHmacBoringSslTest, EncryptIntoAndDecryptInto) {
+  std::string plaintext = Random::GetRandomBytes(5000);
+  auto size = aead_->CiphertextSize(plaintext.size());
+  ASSERT_THAT(size.status(), IsOk());
+  std::string ciphertext(size.ValueOrDie(), '\0');
+  auto written =
+      aead_->EncryptInto(plaintext, "aad", absl::MakeSpan(ciphertext));
+  ASSERT_THAT(written.status(), IsOk());
+  EXPECT_THAT(written.ValueOrDie(), Eq(size.ValueOrDie()));
+
+  std::string decrypted(ciphertext.size(), '\0');
+  written = aead_->DecryptInto(ciphertext, "aad", absl::MakeSpan(decrypted));
+  ASSERT_THAT(written.status(), IsOk());
+  decrypted.resize(written.ValueOrDie());
+  EXPECT_THAT(decrypted, Eq(plaintext));
+
+  std::string small_buffer(ciphertext.size() - 1, '\0');
+  EXPECT_THAT(aead_->EncryptInto(plaintext, "aad",
+                                 absl::MakeSpan(small_buffer))
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST_P(AesCtrHmacBoringSslTest, BindAssociatedData) {
+  for (int aad_size : {0, 1, 64, 1000}) {
+    std::string aad = Random::GetRandomBytes(aad_size);
+    auto bound_result = aead_->BindAssociatedData(aad);
+    ASSERT_THAT(bound_result.status(), IsOk());
+    const BoundAead& bound = *bound_result.ValueOrDie();
+    for (int size : {0, 1, 4097}) {
+      std::string plaintext = Random::GetRandomBytes(size);
+      auto ciphertext = bound.Encrypt(plaintext);
+      ASSERT_THAT(ciphertext.status(), IsOk());
+      auto decrypted = reference_->Decrypt(ciphertext.ValueOrDie(), aad);
+      ASSERT_THAT(decrypted.status(), IsOk()) << size;
+      EXPECT_THAT(decrypted.ValueOrDie(), Eq(plaintext));
+
+      ciphertext = aead_->Encrypt(plaintext, aad);
+      ASSERT_THAT(ciphertext.status(), IsOk());
+      decrypted = bound.Decrypt(ciphertext.ValueOrDie());
+      ASSERT_THAT(decrypted.status(), IsOk()) << size;
+      EXPECT_THAT(decrypted.ValueOrDie(), Eq(plaintext));
+
+      ciphertext = aead_->Encrypt(plaintext, absl::StrCat(aad, "x"));
+      ASSERT_THAT(ciphertext.status(), IsOk());
+      EXPECT_THAT(bound.Decrypt(ciphertext.ValueOrDie()).status(),
+                  StatusIs(util::error::INVALID_ARGUMENT));
+    }
+    EXPECT_THAT(bound.Decrypt("short").status(),
+                StatusIs(util::error::INVALID_ARGUMENT));
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(
+    AesCtrHmacBoringSslTests, AesCtrHmacBoringSslTest,
+    ::testing::Values(Params{16, 16, HashType::SHA256, 16},
+                      Params{32, 16, HashType::SHA256, 32},
+                      Params{16, 12, HashType::SHA1, 10},
+                      Params{32, 12, HashType::SHA512, 64}));
+
+TEST(AesCtrHmacBoringSslInvalidTest, InvalidParameters) {
+  util::SecretData hmac_key = Random::GetRandomKeyBytes(32);
+  EXPECT_FALSE(AesCtrHmacBoringSsl::New(Random::GetRandomKeyBytes(17), 16,
+                                        HashType::SHA256, hmac_key, 16)
+                   .ok());
+  EXPECT_FALSE(AesCtrHmacBoringSsl::New(Random::GetRandomKeyBytes(16), 11,
+                                        HashType::SHA256, hmac_key, 16)
+                   .ok());
+  EXPECT_FALSE(AesCtrHmacBoringSsl::New(Random::GetRandomKeyBytes(16), 17,
+                                        HashType::SHA256, hmac_key, 16)
+                   .ok());
+  EXPECT_FALSE(AesCtrHmacBoringSsl::New(Random::GetRandomKeyBytes(16), 16,
+                                        HashType::SHA256, hmac_key, 9)
+                   .ok());
+  EXPECT_FALSE(AesCtrHmacBoringSsl::New(Random::GetRandomKeyBytes(16), 16,
+                                        HashType::SHA256, hmac_key, 33)
+                   .ok());
+  EXPECT_FALSE(AesCtrHmacBoringSsl::New(Random::GetRandomKeyBytes(16), 16,
+                                        HashType::SHA256,
+                                        Random::GetRandomKeyBytes(15), 16)
+                   .ok());
+}
+
+}  // namespace
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
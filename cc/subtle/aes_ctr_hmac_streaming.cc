@@ -14,6 +14,7 @@
 
 #include "tink/subtle/aes_ctr_hmac_streaming.h"
 
+#include <cstring>
 #include <limits>
 #include <string>
 #include <vector>
@@ -21,17 +22,17 @@
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "openssl/aes.h"
 #include "openssl/base.h"
-#include "openssl/cipher.h"
+#include "openssl/digest.h"
 #include "openssl/err.h"
-#include "openssl/evp.h"
+#include "openssl/hmac.h"
+#include "openssl/mem.h"
 #include "tink/subtle/common_enums.h"
 #include "tink/subtle/hkdf.h"
-#include "tink/subtle/hmac_boringssl.h"
 #include "tink/subtle/random.h"
 #include "tink/subtle/stream_segment_decrypter.h"
 #include "tink/subtle/stream_segment_encrypter.h"
-#include "tink/subtle/subtle_util.h"
 #include "tink/subtle/subtle_util_boringssl.h"
 #include "tink/util/errors.h"
 #include "tink/util/secret_data.h"
@@ -42,13 +43,78 @@ namespace crypto {
 namespace tink {
 namespace subtle {
 
-static std::string NonceForSegment(absl::string_view nonce_prefix,
-                                   int64_t segment_number,
-                                   bool is_last_segment) {
-  return absl::StrCat(
-      nonce_prefix, BigEndian32(segment_number),
-      is_last_segment ? std::string(1, '\x01') : std::string(1, '\x00'),
-      std::string(4, '\x00'));
+// Writes the nonce of the specified segment to 'nonce'.
+static void NonceForSegment(
+    absl::string_view nonce_prefix, int64_t segment_number,
+    bool is_last_segment,
+    uint8_t nonce[AesCtrHmacStreaming::kNonceSizeInBytes]) {
+  std::memset(nonce, 0, AesCtrHmacStreaming::kNonceSizeInBytes);
+  std::memcpy(nonce, nonce_prefix.data(), nonce_prefix.size());
+  uint8_t* ctr = nonce + nonce_prefix.size();
+  uint32_t segment = static_cast<uint32_t>(segment_number);
+  ctr[0] = static_cast<uint8_t>(segment >> 24);
+  ctr[1] = static_cast<uint8_t>(segment >> 16);
+  ctr[2] = static_cast<uint8_t>(segment >> 8);
+  ctr[3] = static_cast<uint8_t>(segment);
+  ctr[4] = is_last_segment ? 1 : 0;
+}
+
+// Expands the AES key once per stream, so that segments do not need a cipher
+// context keyed from scratch.
+static util::StatusOr<util::SecretUniquePtr<AES_KEY>> NewAesKey(
+    const util::SecretData& key_value) {
+  util::SecretUniquePtr<AES_KEY> aes_key = util::MakeSecretUniquePtr<AES_KEY>();
+  if (AES_set_encrypt_key(key_value.data(), 8 * key_value.size(),
+                          aes_key.get()) != 0) {
+    return util::Status(util::error::INTERNAL, "could not initialize aes key");
+  }
+  return std::move(aes_key);
+}
+
+// Returns an HMAC context keyed with 'hmac_key_value', whose copies compute
+// the tags of the segments.
+static util::StatusOr<bssl::UniquePtr<HMAC_CTX>> NewHmacContext(
+    HashType tag_algo, const util::SecretData& hmac_key_value) {
+  auto md_result = SubtleUtilBoringSSL::EvpHash(tag_algo);
+  if (!md_result.ok()) return md_result.status();
+  bssl::UniquePtr<HMAC_CTX> hmac_context(HMAC_CTX_new());
+  if (hmac_context == nullptr ||
+      !HMAC_Init_ex(hmac_context.get(), hmac_key_value.data(),
+                    hmac_key_value.size(), md_result.ValueOrDie(),
+                    nullptr /* engine */)) {
+    return util::Status(util::error::INTERNAL, "could not initialize hmac");
+  }
+  return std::move(hmac_context);
+}
+
+// Computes the untruncated tag nonce || ciphertext of a segment into 'tag',
+// which must hold at least EVP_MAX_MD_SIZE bytes.
+static util::Status ComputeTag(
+    const HMAC_CTX* hmac_context,
+    const uint8_t nonce[AesCtrHmacStreaming::kNonceSizeInBytes],
+    const uint8_t* ciphertext, size_t ciphertext_size, uint8_t* tag) {
+  // Only the keyed state is copied; the key is not hashed again.
+  bssl::ScopedHMAC_CTX ctx;
+  unsigned int tag_size;
+  if (!HMAC_CTX_copy_ex(ctx.get(), hmac_context) ||
+      !HMAC_Update(ctx.get(), nonce, AesCtrHmacStreaming::kNonceSizeInBytes) ||
+      !HMAC_Update(ctx.get(), ciphertext, ciphertext_size) ||
+      !HMAC_Final(ctx.get(), tag, &tag_size)) {
+    return util::Status(util::error::INTERNAL, "could not compute hmac");
+  }
+  return util::OkStatus();
+}
+
+// Applies the AES-CTR keystream starting at 'nonce' to 'size' bytes at 'in',
+// and writes the result to 'out', which may be equal to 'in'.
+static void CtrCrypt(const AES_KEY* aes_key,
+                     const uint8_t nonce[AesCtrHmacStreaming::kNonceSizeInBytes],
+                     const uint8_t* in, size_t size, uint8_t* out) {
+  uint8_t counter[AES_BLOCK_SIZE];
+  std::memcpy(counter, nonce, AES_BLOCK_SIZE);
+  uint8_t ecount_buf[AES_BLOCK_SIZE] = {0};
+  unsigned int num = 0;
+  AES_ctr128_encrypt(in, out, size, aes_key, counter, ecount_buf, &num);
 }
 
 static util::Status DeriveKeys(const util::SecretData& ikm, HashType hkdf_algo,
@@ -128,6 +194,13 @@ AesCtrHmacStreaming::NewSegmentEncrypter(
   return AesCtrHmacStreamSegmentEncrypter::New(params_, associated_data);
 }
 
+util::StatusOr<std::unique_ptr<StreamSegmentEncrypter>>
+AesCtrHmacStreaming::NewSegmentEncrypterForHeader(
+    absl::string_view associated_data, absl::string_view header) const {
+  return AesCtrHmacStreamSegmentEncrypter::NewForHeader(
+      params_, associated_data, header);
+}
+
 // static
 util::StatusOr<std::unique_ptr<StreamSegmentDecrypter>>
 AesCtrHmacStreaming::NewSegmentDecrypter(
@@ -153,84 +226,123 @@ AesCtrHmacStreamSegmentEncrypter::New(const AesCtrHmacStreaming::Params& params,
   std::string salt = Random::GetRandomBytes(params.key_size);
   std::string nonce_prefix =
       Random::GetRandomBytes(AesCtrHmacStreaming::kNoncePrefixSizeInBytes);
+  return New(params, associated_data, salt, nonce_prefix);
+}
+
+// static
+util::StatusOr<std::unique_ptr<StreamSegmentEncrypter>>
+AesCtrHmacStreamSegmentEncrypter::NewForHeader(
+    const AesCtrHmacStreaming::Params& params,
+    absl::string_view associated_data, absl::string_view header) {
+  auto status = Validate(params);
+  if (!status.ok()) return status;
+
+  size_t header_size =
+      1 + params.key_size + AesCtrHmacStreaming::kNoncePrefixSizeInBytes;
+  if (header.size() != header_size ||
+      static_cast<uint8_t>(header[0]) != header_size) {
+    return util::Status(util::error::INVALID_ARGUMENT, "Invalid header");
+  }
+  return New(params, associated_data, header.substr(1, params.key_size),
+             header.substr(1 + params.key_size));
+}
+
+// static
+util::StatusOr<std::unique_ptr<StreamSegmentEncrypter>>
+AesCtrHmacStreamSegmentEncrypter::New(const AesCtrHmacStreaming::Params& params,
+                                      absl::string_view associated_data,
+                                      absl::string_view salt,
+                                      absl::string_view nonce_prefix) {
   std::string header = MakeHeader(salt, nonce_prefix);
 
   util::SecretData key_value;
   util::SecretData hmac_key_value;
-  status = DeriveKeys(params.ikm, params.hkdf_algo, salt, associated_data,
-                      params.key_size, &key_value, &hmac_key_value);
+  auto status = DeriveKeys(params.ikm, params.hkdf_algo, salt, associated_data,
+                           params.key_size, &key_value, &hmac_key_value);
   if (!status.ok()) return status;
 
-  auto cipher = SubtleUtilBoringSSL::GetAesCtrCipherForKeySize(params.key_size);
-  if (cipher == nullptr) {
-    return util::Status(util::error::INTERNAL, "invalid key size");
-  }
-
-  auto hmac_result = HmacBoringSsl::New(params.tag_algo, params.tag_size,
-                                        std::move(hmac_key_value));
+  auto aes_key_result = NewAesKey(key_value);
+  if (!aes_key_result.ok()) return aes_key_result.status();
+  auto hmac_result = NewHmacContext(params.tag_algo, hmac_key_value);
   if (!hmac_result.ok()) return hmac_result.status();
-  auto mac = std::move(hmac_result.ValueOrDie());
 
   return {absl::WrapUnique(new AesCtrHmacStreamSegmentEncrypter(
-      std::move(key_value), header, nonce_prefix,
-      params.ciphertext_segment_size, params.ciphertext_offset, params.tag_size,
-      cipher, std::move(mac)))};
+      std::move(aes_key_result.ValueOrDie()),
+      std::move(hmac_result.ValueOrDie()), header, nonce_prefix,
+      params.ciphertext_segment_size, params.ciphertext_offset,
+      params.tag_size))};
 }
 
 util::Status AesCtrHmacStreamSegmentEncrypter::EncryptSegment(
     const std::vector<uint8_t>& plaintext, bool is_last_segment,
     std::vector<uint8_t>* ciphertext_buffer) {
-  if (plaintext.size() > get_plaintext_segment_size()) {
-    return util::Status(util::error::INVALID_ARGUMENT, "plaintext too long");
-  }
+  auto status = EncryptSegmentAt(plaintext, get_segment_number(),
+                                 is_last_segment, ciphertext_buffer);
+  if (!status.ok()) return status;
+  IncSegmentNumber();
+  return util::OkStatus();
+}
+
+util::Status AesCtrHmacStreamSegmentEncrypter::EncryptSegmentAt(
+    const std::vector<uint8_t>& plaintext, int64_t segment_number,
+    bool is_last_segment, std::vector<uint8_t>* ciphertext_buffer) const {
   if (ciphertext_buffer == nullptr) {
     return util::Status(util::error::INVALID_ARGUMENT,
                         "ciphertext_buffer must be non-null");
   }
-  if (get_segment_number() > std::numeric_limits<uint32_t>::max() ||
-      (get_segment_number() == std::numeric_limits<uint32_t>::max() &&
-       !is_last_segment)) {
-    return util::Status(util::error::INVALID_ARGUMENT, "too many segments");
-  }
-
-  int ct_size = plaintext.size() + tag_size_;
-  ciphertext_buffer->resize(ct_size);
-
-  std::string nonce =
-      NonceForSegment(nonce_prefix_, segment_number_, is_last_segment);
+  auto status =
+      CheckSegment(plaintext.size(), segment_number, is_last_segment);
+  if (!status.ok()) return status;
+  ciphertext_buffer->resize(plaintext.size() + tag_size_);
+  return Seal(plaintext.data(), plaintext.size(), segment_number,
+              is_last_segment, ciphertext_buffer->data());
+}
 
-  // Encrypt.
-  bssl::UniquePtr<EVP_CIPHER_CTX> ctx(EVP_CIPHER_CTX_new());
-  if (ctx.get() == nullptr) {
-    return util::Status(util::error::INTERNAL,
-                        "could not initialize EVP_CIPHER_CTX");
-  }
-  if (EVP_EncryptInit_ex(ctx.get(), cipher_, nullptr /* engine */,
-                         reinterpret_cast<const uint8_t*>(key_value_.data()),
-                         reinterpret_cast<const uint8_t*>(nonce.data())) != 1) {
-    return util::Status(util::error::INTERNAL, "could not initialize ctx");
+util::Status AesCtrHmacStreamSegmentEncrypter::EncryptSegmentInPlace(
+    int64_t segment_number, bool is_last_segment,
+    std::vector<uint8_t>* segment) const {
+  if (segment == nullptr) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "segment must be non-null");
   }
+  size_t pt_size = segment->size();
+  auto status = CheckSegment(pt_size, segment_number, is_last_segment);
+  if (!status.ok()) return status;
+  segment->resize(pt_size + tag_size_);
+  return Seal(segment->data(), pt_size, segment_number, is_last_segment,
+              segment->data());
+}
 
-  int out_len;
-  if (EVP_EncryptUpdate(ctx.get(), ciphertext_buffer->data(), &out_len,
-                        plaintext.data(), plaintext.size()) != 1) {
-    return util::Status(util::error::INTERNAL, "encryption failed");
+util::Status AesCtrHmacStreamSegmentEncrypter::CheckSegment(
+    size_t plaintext_size, int64_t segment_number,
+    bool is_last_segment) const {
+  if (plaintext_size > get_plaintext_segment_size()) {
+    return util::Status(util::error::INVALID_ARGUMENT, "plaintext too long");
   }
-  if (out_len != plaintext.size()) {
-    return util::Status(util::error::INTERNAL, "incorrect ciphertext size");
+  if (segment_number > std::numeric_limits<uint32_t>::max() ||
+      (segment_number == std::numeric_limits<uint32_t>::max() &&
+       !is_last_segment)) {
+    return util::Status(util::error::INVALID_ARGUMENT, "too many segments");
   }
+  return util::OkStatus();
+}
+
+util::Status AesCtrHmacStreamSegmentEncrypter::Seal(
+    const uint8_t* plaintext, size_t plaintext_size, int64_t segment_number,
+    bool is_last_segment, uint8_t* ciphertext) const {
+  uint8_t nonce[AesCtrHmacStreaming::kNonceSizeInBytes];
+  NonceForSegment(nonce_prefix_, segment_number, is_last_segment, nonce);
+
+  // Encrypt. AES-CTR supports encrypting in place.
+  CtrCrypt(aes_key_.get(), nonce, plaintext, plaintext_size, ciphertext);
 
   // Add MAC tag.
-  absl::string_view ciphertext_string(
-      reinterpret_cast<const char*>(ciphertext_buffer->data()),
-      plaintext.size());
-  auto tag_result = mac_->ComputeMac(absl::StrCat(nonce, ciphertext_string));
-  if (!tag_result.ok()) return tag_result.status();
-  std::string tag = tag_result.ValueOrDie();
-  memcpy(ciphertext_buffer->data() + plaintext.size(),
-         reinterpret_cast<const uint8_t*>(tag.data()), tag_size_);
+  uint8_t tag[EVP_MAX_MD_SIZE];
+  auto status = ComputeTag(hmac_context_.get(), nonce, ciphertext,
+                           plaintext_size, tag);
+  if (!status.ok()) return status;
+  memcpy(ciphertext + plaintext_size, tag, tag_size_);
 
-  IncSegmentNumber();
   return util::OkStatus();
 }
 
@@ -269,20 +381,18 @@ util::Status AesCtrHmacStreamSegmentDecrypter::Init(
       std::string(reinterpret_cast<const char*>(header.data() + 1 + key_size_),
                   AesCtrHmacStreaming::kNoncePrefixSizeInBytes);
 
+  util::SecretData key_value;
   util::SecretData hmac_key_value;
   auto status = DeriveKeys(ikm_, hkdf_algo_, salt, associated_data_, key_size_,
-                           &key_value_, &hmac_key_value);
+                           &key_value, &hmac_key_value);
   if (!status.ok()) return status;
 
-  cipher_ = SubtleUtilBoringSSL::GetAesCtrCipherForKeySize(key_size_);
-  if (cipher_ == nullptr) {
-    return util::Status(util::error::INTERNAL, "invalid key size");
-  }
-
-  auto hmac_result =
-      HmacBoringSsl::New(tag_algo_, tag_size_, std::move(hmac_key_value));
+  auto aes_key_result = NewAesKey(key_value);
+  if (!aes_key_result.ok()) return aes_key_result.status();
+  aes_key_ = std::move(aes_key_result.ValueOrDie());
+  auto hmac_result = NewHmacContext(tag_algo_, hmac_key_value);
   if (!hmac_result.ok()) return hmac_result.status();
-  mac_ = std::move(hmac_result.ValueOrDie());
+  hmac_context_ = std::move(hmac_result.ValueOrDie());
 
   is_initialized_ = true;
   return util::OkStatus();
@@ -291,61 +401,97 @@ util::Status AesCtrHmacStreamSegmentDecrypter::Init(
 util::Status AesCtrHmacStreamSegmentDecrypter::DecryptSegment(
     const std::vector<uint8_t>& ciphertext, int64_t segment_number,
     bool is_last_segment, std::vector<uint8_t>* plaintext_buffer) {
+  auto status =
+      CheckSegment(ciphertext.size(), segment_number, is_last_segment);
+  if (!status.ok()) return status;
+  if (plaintext_buffer == nullptr) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "plaintext_buffer must be non-null");
+  }
+  plaintext_buffer->resize(ciphertext.size() - tag_size_);
+  return Open(ciphertext.data(), ciphertext.size(), segment_number,
+              is_last_segment, plaintext_buffer->data());
+}
+
+util::Status AesCtrHmacStreamSegmentDecrypter::DecryptSegmentInPlace(
+    int64_t segment_number, bool is_last_segment,
+    std::vector<uint8_t>* segment) {
+  if (segment == nullptr) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "segment must be non-null");
+  }
+  auto status = CheckSegment(segment->size(), segment_number, is_last_segment);
+  if (!status.ok()) return status;
+  status = Open(segment->data(), segment->size(), segment_number,
+                is_last_segment, segment->data());
+  if (!status.ok()) return status;
+  segment->resize(segment->size() - tag_size_);
+  return util::OkStatus();
+}
+
+util::Status AesCtrHmacStreamSegmentDecrypter::VerifySegment(
+    int64_t segment_number, bool is_last_segment,
+    std::vector<uint8_t>* segment) {
+  if (segment == nullptr) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "segment must be non-null");
+  }
+  auto status = CheckSegment(segment->size(), segment_number, is_last_segment);
+  if (!status.ok()) return status;
+  uint8_t nonce[AesCtrHmacStreaming::kNonceSizeInBytes];
+  return VerifyTag(segment->data(), segment->size(), segment_number,
+                   is_last_segment, nonce);
+}
+
+util::Status AesCtrHmacStreamSegmentDecrypter::CheckSegment(
+    size_t ciphertext_size, int64_t segment_number,
+    bool is_last_segment) const {
   if (!is_initialized_) {
     return util::Status(util::error::FAILED_PRECONDITION,
                         "decrypter not initialized");
   }
-  if (ciphertext.size() > get_ciphertext_segment_size()) {
+  if (ciphertext_size > get_ciphertext_segment_size()) {
     return util::Status(util::error::INVALID_ARGUMENT, "ciphertext too long");
   }
-  if (ciphertext.size() < tag_size_) {
+  if (ciphertext_size < tag_size_) {
     return util::Status(util::error::INVALID_ARGUMENT, "ciphertext too short");
   }
-  if (plaintext_buffer == nullptr) {
-    return util::Status(util::error::INVALID_ARGUMENT,
-                        "plaintext_buffer must be non-null");
-  }
   if (segment_number > std::numeric_limits<uint32_t>::max() ||
       (segment_number == std::numeric_limits<uint32_t>::max() &&
        !is_last_segment)) {
     return util::Status(util::error::INVALID_ARGUMENT, "too many segments");
   }
+  return util::OkStatus();
+}
 
-  int pt_size = ciphertext.size() - tag_size_;
-  plaintext_buffer->resize(pt_size);
-
-  std::string nonce =
-      NonceForSegment(nonce_prefix_, segment_number, is_last_segment);
-
-  // Verify MAC tag.
-  absl::string_view tag(
-      reinterpret_cast<const char*>(ciphertext.data() + pt_size), tag_size_);
-  absl::string_view ciphertext_string(
-      reinterpret_cast<const char*>(ciphertext.data()), pt_size);
-  auto status = mac_->VerifyMac(tag, absl::StrCat(nonce, ciphertext_string));
+util::Status AesCtrHmacStreamSegmentDecrypter::Open(
+    const uint8_t* ciphertext, size_t ciphertext_size, int64_t segment_number,
+    bool is_last_segment, uint8_t* plaintext) const {
+  uint8_t nonce[AesCtrHmacStreaming::kNonceSizeInBytes];
+  auto status = VerifyTag(ciphertext, ciphertext_size, segment_number,
+                          is_last_segment, nonce);
   if (!status.ok()) return status;
 
-  // Decrypt.
-  bssl::UniquePtr<EVP_CIPHER_CTX> ctx(EVP_CIPHER_CTX_new());
-  if (ctx.get() == nullptr) {
-    return util::Status(util::error::INTERNAL,
-                        "could not initialize EVP_CIPHER_CTX");
-  }
-  if (EVP_DecryptInit_ex(ctx.get(), cipher_, nullptr /* engine */,
-                         reinterpret_cast<const uint8_t*>(key_value_.data()),
-                         reinterpret_cast<const uint8_t*>(nonce.data())) != 1) {
-    return util::Status(util::error::INTERNAL, "could not initialize ctx");
-  }
+  // Decrypt. AES-CTR supports decrypting in place.
+  CtrCrypt(aes_key_.get(), nonce, ciphertext, ciphertext_size - tag_size_,
+           plaintext);
 
-  int out_len;
-  if (EVP_DecryptUpdate(ctx.get(), plaintext_buffer->data(), &out_len,
-                        ciphertext.data(), pt_size) != 1) {
-    return util::Status(util::error::INTERNAL, "decryption failed");
-  }
-  if (out_len != pt_size) {
-    return util::Status(util::error::INTERNAL, "incorrect plaintext size");
-  }
+  return util::OkStatus();
+}
 
+util::Status AesCtrHmacStreamSegmentDecrypter::VerifyTag(
+    const uint8_t* ciphertext, size_t ciphertext_size, int64_t segment_number,
+    bool is_last_segment,
+    uint8_t nonce[AesCtrHmacStreaming::kNonceSizeInBytes]) const {
+  int pt_size = ciphertext_size - tag_size_;
+  NonceForSegment(nonce_prefix_, segment_number, is_last_segment, nonce);
+  uint8_t tag[EVP_MAX_MD_SIZE];
+  auto status =
+      ComputeTag(hmac_context_.get(), nonce, ciphertext, pt_size, tag);
+  if (!status.ok()) return status;
+  if (CRYPTO_memcmp(tag, ciphertext + pt_size, tag_size_) != 0) {
+    return util::Status(util::error::INVALID_ARGUMENT, "verification failed");
+  }
   return util::OkStatus();
 }
 
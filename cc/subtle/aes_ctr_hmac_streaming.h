@@ -19,8 +19,9 @@
 #include <vector>
 
 #include "absl/strings/string_view.h"
-#include "openssl/evp.h"
-#include "tink/mac.h"
+#include "openssl/aes.h"
+#include "openssl/base.h"
+#include "openssl/hmac.h"
 #include "tink/config/tink_fips.h"
 #include "tink/subtle/common_enums.h"
 #include "tink/subtle/nonce_based_streaming_aead.h"
@@ -96,6 +97,10 @@ class AesCtrHmacStreaming : public NonceBasedStreamingAead {
   util::StatusOr<std::unique_ptr<StreamSegmentDecrypter>> NewSegmentDecrypter(
       absl::string_view associated_data) const override;
 
+  util::StatusOr<std::unique_ptr<StreamSegmentEncrypter>>
+  NewSegmentEncrypterForHeader(absl::string_view associated_data,
+                               absl::string_view header) const override;
+
  private:
   explicit AesCtrHmacStreaming(Params params) : params_(std::move(params)) {}
   const Params params_;
@@ -108,11 +113,28 @@ class AesCtrHmacStreamSegmentEncrypter : public StreamSegmentEncrypter {
       const AesCtrHmacStreaming::Params& params,
       absl::string_view associated_data);
 
+  // Like New(), but continues the stream with the given 'header', i.e. uses
+  // the salt and the nonce prefix of an earlier encrypter, so that the new
+  // encrypter produces the same segments. Used to resume an interrupted
+  // encryption.
+  static util::StatusOr<std::unique_ptr<StreamSegmentEncrypter>> NewForHeader(
+      const AesCtrHmacStreaming::Params& params,
+      absl::string_view associated_data, absl::string_view header);
+
   // Overridden methods of StreamSegmentEncrypter.
   util::Status EncryptSegment(const std::vector<uint8_t>& plaintext,
                               bool is_last_segment,
                               std::vector<uint8_t>* ciphertext_buffer) override;
 
+  util::Status EncryptSegmentAt(
+      const std::vector<uint8_t>& plaintext, int64_t segment_number,
+      bool is_last_segment,
+      std::vector<uint8_t>* ciphertext_buffer) const override;
+
+  util::Status EncryptSegmentInPlace(
+      int64_t segment_number, bool is_last_segment,
+      std::vector<uint8_t>* segment) const override;
+
   const std::vector<uint8_t>& get_header() const override { return header_; }
   int64_t get_segment_number() const override { return segment_number_; }
   int get_plaintext_segment_size() const override {
@@ -127,31 +149,50 @@ class AesCtrHmacStreamSegmentEncrypter : public StreamSegmentEncrypter {
   void IncSegmentNumber() override { segment_number_++; }
 
  private:
-  AesCtrHmacStreamSegmentEncrypter(util::SecretData key_value,
+  AesCtrHmacStreamSegmentEncrypter(util::SecretUniquePtr<AES_KEY> aes_key,
+                                   bssl::UniquePtr<HMAC_CTX> hmac_context,
                                    absl::string_view header,
                                    absl::string_view nonce_prefix,
                                    int ciphertext_segment_size,
-                                   int ciphertext_offset, int tag_size,
-                                   const EVP_CIPHER* cipher,
-                                   std::unique_ptr<Mac> mac)
-      : key_value_(std::move(key_value)),
+                                   int ciphertext_offset, int tag_size)
+      : aes_key_(std::move(aes_key)),
+        hmac_context_(std::move(hmac_context)),
         header_(header.begin(), header.end()),
         nonce_prefix_(nonce_prefix),
         ciphertext_segment_size_(ciphertext_segment_size),
         ciphertext_offset_(ciphertext_offset),
         tag_size_(tag_size),
-        cipher_(cipher),
-        mac_(std::move(mac)),
         segment_number_(0) {}
 
-  const util::SecretData key_value_;
+  // Creates an encrypter with the given salt and nonce prefix. It is assumed
+  // that 'params' are valid.
+  static util::StatusOr<std::unique_ptr<StreamSegmentEncrypter>> New(
+      const AesCtrHmacStreaming::Params& params,
+      absl::string_view associated_data, absl::string_view salt,
+      absl::string_view nonce_prefix);
+
+  // Returns an error if a plaintext of 'plaintext_size' bytes cannot be
+  // encrypted as the specified segment.
+  util::Status CheckSegment(size_t plaintext_size, int64_t segment_number,
+                            bool is_last_segment) const;
+
+  // Encrypts 'plaintext_size' bytes at 'plaintext' as the specified segment,
+  // and writes the ciphertext of plaintext_size + tag_size_ bytes
+  // to 'ciphertext', which may be equal to 'plaintext'.
+  util::Status Seal(const uint8_t* plaintext, size_t plaintext_size,
+                    int64_t segment_number, bool is_last_segment,
+                    uint8_t* ciphertext) const;
+
+  // The expanded AES key and the HMAC context holding the keyed inner and
+  // outer hash states are computed once for the stream. They are never
+  // modified, so that segments can be encrypted concurrently.
+  const util::SecretUniquePtr<AES_KEY> aes_key_;
+  const bssl::UniquePtr<HMAC_CTX> hmac_context_;
   const std::vector<uint8_t> header_;
   const std::string nonce_prefix_;
   const int ciphertext_segment_size_;
   const int ciphertext_offset_;
   const int tag_size_;
-  const EVP_CIPHER* cipher_;
-  const std::unique_ptr<Mac> mac_;
   int64_t segment_number_;
 };
 
@@ -169,6 +210,15 @@ class AesCtrHmacStreamSegmentDecrypter : public StreamSegmentDecrypter {
                               int64_t segment_number, bool is_last_segment,
                               std::vector<uint8_t>* plaintext_buffer) override;
 
+  util::Status DecryptSegmentInPlace(int64_t segment_number,
+                                     bool is_last_segment,
+                                     std::vector<uint8_t>* segment) override;
+
+  // Only checks the HMAC tag of the segment, which covers the ciphertext, so
+  // the segment is not decrypted and is left unchanged.
+  util::Status VerifySegment(int64_t segment_number, bool is_last_segment,
+                             std::vector<uint8_t>* segment) override;
+
   int get_header_size() const override {
     return 1 + key_size_ + AesCtrHmacStreaming::kNoncePrefixSizeInBytes;
   }
@@ -197,6 +247,26 @@ class AesCtrHmacStreamSegmentDecrypter : public StreamSegmentDecrypter {
         tag_algo_(tag_algo),
         tag_size_(tag_size) {}
 
+  // Returns an error if a ciphertext of 'ciphertext_size' bytes cannot be
+  // decrypted as the specified segment.
+  util::Status CheckSegment(size_t ciphertext_size, int64_t segment_number,
+                            bool is_last_segment) const;
+
+  // Verifies the tag of the 'ciphertext_size' bytes at 'ciphertext' as the
+  // specified segment, whose nonce is written to 'nonce'.
+  util::Status VerifyTag(
+      const uint8_t* ciphertext, size_t ciphertext_size, int64_t segment_number,
+      bool is_last_segment,
+      uint8_t nonce[AesCtrHmacStreaming::kNonceSizeInBytes]) const;
+
+  // Verifies and decrypts 'ciphertext_size' bytes at 'ciphertext' as the
+  // specified segment, and writes the plaintext of ciphertext_size - tag_size_
+  // bytes to 'plaintext', which may be equal to 'ciphertext'. Nothing is
+  // written if the verification fails.
+  util::Status Open(const uint8_t* ciphertext, size_t ciphertext_size,
+                    int64_t segment_number, bool is_last_segment,
+                    uint8_t* plaintext) const;
+
   // Parameters set upon decrypter creation.
   const util::SecretData ikm_;
   const HashType hkdf_algo_;
@@ -209,10 +279,9 @@ class AesCtrHmacStreamSegmentDecrypter : public StreamSegmentDecrypter {
 
   // Parameters set when initializing with data from stream header.
   bool is_initialized_ = false;
-  util::SecretData key_value_;
   std::string nonce_prefix_;
-  const EVP_CIPHER* cipher_;
-  std::unique_ptr<Mac> mac_;
+  util::SecretUniquePtr<AES_KEY> aes_key_;
+  bssl::UniquePtr<HMAC_CTX> hmac_context_;
 };
 
 }  // namespace subtle
@@ -15,17 +15,28 @@
 #include "tink/subtle/aes_ctr_hmac_streaming.h"
 
 #include <memory>
+#include <sstream>
 #include <string>
 #include <vector>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
+#include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
+#include "openssl/cipher.h"
 #include "tink/subtle/common_enums.h"
+#include "tink/subtle/hkdf.h"
+#include "tink/subtle/hmac_boringssl.h"
 #include "tink/subtle/random.h"
 #include "tink/subtle/stream_segment_decrypter.h"
 #include "tink/subtle/stream_segment_encrypter.h"
+#include "tink/subtle/streaming_aead_encrypting_stream.h"
 #include "tink/subtle/streaming_aead_test_util.h"
+#include "tink/subtle/subtle_util_boringssl.h"
+#include "tink/subtle/test_util.h"
+#include "tink/util/istream_input_stream.h"
+#include "tink/util/ostream_output_stream.h"
+#include "tink/util/secret_data.h"
 #include "tink/util/status.h"
 #include "tink/util/statusor.h"
 #include "tink/util/test_matchers.h"
@@ -160,6 +171,112 @@ TEST(AesCtrHmacStreamSegmentEncrypterTest, EncryptNullCtBuffer) {
       StatusIs(util::error::INVALID_ARGUMENT, HasSubstr("must be non-null")));
 }
 
+TEST(AesCtrHmacStreamSegmentEncrypterTest, EncryptInPlace) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  AesCtrHmacStreaming::Params params = ValidParams();
+  auto enc = std::move(
+      AesCtrHmacStreamSegmentEncrypter::New(params, "associated data")
+          .ValueOrDie());
+  for (int pt_size : {0, 1, 10, enc->get_plaintext_segment_size()}) {
+    for (bool is_last_segment : {false, true}) {
+      SCOPED_TRACE(absl::StrCat("plaintext_size = ", pt_size,
+                                ", is_last_segment = ", is_last_segment));
+      std::vector<uint8_t> pt(pt_size, 'p');
+      std::vector<uint8_t> ct;
+      EXPECT_THAT(enc->EncryptSegmentAt(pt, 5, is_last_segment, &ct), IsOk());
+      std::vector<uint8_t> segment = pt;
+      EXPECT_THAT(enc->EncryptSegmentInPlace(5, is_last_segment, &segment),
+                  IsOk());
+      EXPECT_EQ(ct, segment);
+      EXPECT_EQ(0, enc->get_segment_number());
+    }
+  }
+  std::vector<uint8_t> segment(enc->get_plaintext_segment_size() + 1, 'p');
+  EXPECT_THAT(enc->EncryptSegmentInPlace(0, true, &segment),
+              StatusIs(util::error::INVALID_ARGUMENT,
+                       HasSubstr("plaintext too long")));
+  EXPECT_THAT(enc->EncryptSegmentInPlace(0, true, nullptr),
+              StatusIs(util::error::INVALID_ARGUMENT,
+                       HasSubstr("must be non-null")));
+}
+
+// Recomputes the segments with AES-CTR and HMAC from the derived keys, to
+// check the ciphertext format independently of the segment encrypter.
+TEST(AesCtrHmacStreamSegmentEncrypterTest, MatchesReferenceEncryption) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  for (int key_size : {16, 32}) {
+    for (HashType tag_algo : {SHA1, SHA256, SHA512}) {
+      SCOPED_TRACE(absl::StrCat("key_size = ", key_size,
+                                ", tag_algo = ", EnumToString(tag_algo)));
+      AesCtrHmacStreaming::Params params = ValidParams();
+      params.key_size = key_size;
+      params.tag_algo = tag_algo;
+      std::string associated_data = "associated data";
+      auto enc = std::move(
+          AesCtrHmacStreamSegmentEncrypter::New(params, associated_data)
+              .ValueOrDie());
+      std::vector<uint8_t> header = enc->get_header();
+      std::string salt(reinterpret_cast<const char*>(header.data() + 1),
+                       key_size);
+      std::string nonce_prefix(
+          reinterpret_cast<const char*>(header.data() + 1 + key_size),
+          AesCtrHmacStreaming::kNoncePrefixSizeInBytes);
+      util::SecretData key_material =
+          Hkdf::ComputeHkdf(params.hkdf_algo, params.ikm, salt,
+                            associated_data,
+                            key_size + AesCtrHmacStreaming::kHmacKeySizeInBytes)
+              .ValueOrDie();
+      util::SecretData key_value(key_material.begin(),
+                                 key_material.begin() + key_size);
+      util::SecretData hmac_key_value(key_material.begin() + key_size,
+                                      key_material.end());
+      auto mac = std::move(HmacBoringSsl::New(tag_algo, params.tag_size,
+                                              hmac_key_value)
+                               .ValueOrDie());
+
+      for (int64_t segment_number : {0, 1, 300}) {
+        for (bool is_last_segment : {false, true}) {
+          std::string nonce = absl::StrCat(
+              nonce_prefix,
+              std::string({static_cast<char>(segment_number >> 24),
+                           static_cast<char>(segment_number >> 16),
+                           static_cast<char>(segment_number >> 8),
+                           static_cast<char>(segment_number),
+                           static_cast<char>(is_last_segment ? 1 : 0)}),
+              std::string(4, '\0'));
+          std::vector<uint8_t> pt(enc->get_plaintext_segment_size() - 3, 'p');
+          std::vector<uint8_t> ct;
+          ASSERT_THAT(enc->EncryptSegmentAt(pt, segment_number,
+                                            is_last_segment, &ct),
+                      IsOk());
+
+          bssl::UniquePtr<EVP_CIPHER_CTX> ctx(EVP_CIPHER_CTX_new());
+          int len;
+          std::string expected_ct(pt.size(), '\0');
+          ASSERT_EQ(1, EVP_EncryptInit_ex(
+                           ctx.get(),
+                           SubtleUtilBoringSSL::GetAesCtrCipherForKeySize(
+                               key_size),
+                           nullptr, key_value.data(),
+                           reinterpret_cast<const uint8_t*>(nonce.data())));
+          ASSERT_EQ(1, EVP_EncryptUpdate(
+                           ctx.get(),
+                           reinterpret_cast<uint8_t*>(&expected_ct[0]), &len,
+                           pt.data(), pt.size()));
+          std::string tag =
+              mac->ComputeMac(absl::StrCat(nonce, expected_ct)).ValueOrDie();
+          std::string expected = absl::StrCat(expected_ct, tag);
+          EXPECT_EQ(expected, std::string(ct.begin(), ct.end()));
+        }
+      }
+    }
+  }
+}
+
 TEST(AesCtrHmacStreamSegmentDecrypterTest, Basic) {
   if (kUseOnlyFips) {
     GTEST_SKIP() << "Not supported in FIPS-only mode";
@@ -243,6 +360,90 @@ TEST(AesCtrHmacStreamSegmentDecrypterTest, Basic) {
   }
 }
 
+TEST(AesCtrHmacStreamSegmentDecrypterTest, DecryptInPlace) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  AesCtrHmacStreaming::Params params = ValidParams();
+  std::string associated_data = "associated data";
+  auto enc = std::move(
+      AesCtrHmacStreamSegmentEncrypter::New(params, associated_data)
+          .ValueOrDie());
+  auto dec = std::move(
+      AesCtrHmacStreamSegmentDecrypter::New(params, associated_data)
+          .ValueOrDie());
+  std::vector<uint8_t> segment;
+  EXPECT_THAT(dec->DecryptSegmentInPlace(0, false, &segment),
+              StatusIs(util::error::FAILED_PRECONDITION,
+                       HasSubstr("decrypter not initialized")));
+  ASSERT_THAT(dec->Init(enc->get_header()), IsOk());
+  for (int pt_size : {0, 1, 10, dec->get_plaintext_segment_size()}) {
+    for (bool is_last_segment : {false, true}) {
+      SCOPED_TRACE(absl::StrCat("plaintext_size = ", pt_size,
+                                ", is_last_segment = ", is_last_segment));
+      std::vector<uint8_t> pt(pt_size, 'p');
+      std::vector<uint8_t> ct;
+      EXPECT_THAT(enc->EncryptSegmentAt(pt, 3, is_last_segment, &ct), IsOk());
+      segment = ct;
+      EXPECT_THAT(dec->DecryptSegmentInPlace(3, is_last_segment, &segment),
+                  IsOk());
+      EXPECT_EQ(pt, segment);
+
+      // A segment which fails verification is left unchanged.
+      segment = ct;
+      EXPECT_FALSE(
+          dec->DecryptSegmentInPlace(3, !is_last_segment, &segment).ok());
+      EXPECT_EQ(ct, segment);
+    }
+  }
+  EXPECT_THAT(dec->DecryptSegmentInPlace(0, true, nullptr),
+              StatusIs(util::error::INVALID_ARGUMENT,
+                       HasSubstr("must be non-null")));
+}
+
+TEST(AesCtrHmacStreamSegmentDecrypterTest, VerifySegment) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  AesCtrHmacStreaming::Params params = ValidParams();
+  std::string associated_data = "associated data";
+  auto enc = std::move(
+      AesCtrHmacStreamSegmentEncrypter::New(params, associated_data)
+          .ValueOrDie());
+  auto dec = std::move(
+      AesCtrHmacStreamSegmentDecrypter::New(params, associated_data)
+          .ValueOrDie());
+  std::vector<uint8_t> segment;
+  EXPECT_THAT(dec->VerifySegment(0, false, &segment),
+              StatusIs(util::error::FAILED_PRECONDITION,
+                       HasSubstr("decrypter not initialized")));
+  ASSERT_THAT(dec->Init(enc->get_header()), IsOk());
+  for (int pt_size : {0, 1, 10, dec->get_plaintext_segment_size()}) {
+    for (bool is_last_segment : {false, true}) {
+      SCOPED_TRACE(absl::StrCat("plaintext_size = ", pt_size,
+                                ", is_last_segment = ", is_last_segment));
+      std::vector<uint8_t> pt(pt_size, 'p');
+      std::vector<uint8_t> ct;
+      EXPECT_THAT(enc->EncryptSegmentAt(pt, 3, is_last_segment, &ct), IsOk());
+      // Only the tag is checked, the segment is not decrypted.
+      segment = ct;
+      EXPECT_THAT(dec->VerifySegment(3, is_last_segment, &segment), IsOk());
+      EXPECT_EQ(ct, segment);
+
+      EXPECT_THAT(dec->VerifySegment(3, !is_last_segment, &segment),
+                  StatusIs(util::error::INVALID_ARGUMENT));
+      EXPECT_THAT(dec->VerifySegment(4, is_last_segment, &segment),
+                  StatusIs(util::error::INVALID_ARGUMENT));
+      segment[0] ^= 1;
+      EXPECT_THAT(dec->VerifySegment(3, is_last_segment, &segment),
+                  StatusIs(util::error::INVALID_ARGUMENT));
+    }
+  }
+  EXPECT_THAT(dec->VerifySegment(0, true, nullptr),
+              StatusIs(util::error::INVALID_ARGUMENT,
+                       HasSubstr("must be non-null")));
+}
+
 TEST(AesCtrHmacStreamSegmentDecrypterTest, AlreadyInit) {
   if (kUseOnlyFips) {
     GTEST_SKIP() << "Not supported in FIPS-only mode";
@@ -537,6 +738,71 @@ TEST(ValidateTest, WrongTagAlgo) {
                        HasSubstr("unsupported tag_algo")));
 }
 
+TEST(AesCtrHmacStreamingTest, ResumeEncryption) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  auto streaming_aead =
+      std::move(AesCtrHmacStreaming::New(ValidParams()).ValueOrDie());
+  std::string plaintext = Random::GetRandomBytes(5000);
+  std::string associated_data = "associated data";
+
+  auto ct_stream = absl::make_unique<std::stringstream>();
+  std::stringbuf* ct_buf = ct_stream->rdbuf();
+  auto enc_stream = std::move(
+      streaming_aead
+          ->NewResumableEncryptingStream(
+              absl::make_unique<util::OstreamOutputStream>(
+                  std::move(ct_stream)),
+              associated_data)
+          .ValueOrDie());
+  ASSERT_THAT(test::WriteToStream(enc_stream.get(),
+                                  plaintext.substr(0, 2000), false),
+              IsOk());
+  StreamingAeadEncryptingStream::Checkpoint checkpoint =
+      enc_stream->GetCheckpoint();
+  EXPECT_GT(checkpoint.segment_count, 0);
+  ASSERT_THAT(test::WriteToStream(enc_stream.get(), plaintext.substr(2000)),
+              IsOk());
+  std::string ciphertext = ct_buf->str();
+
+  // Resume the encryption with a new segment encrypter.
+  ct_stream = absl::make_unique<std::stringstream>();
+  ct_buf = ct_stream->rdbuf();
+  auto resumed_result = streaming_aead->ResumeEncryptingStream(
+      absl::make_unique<util::OstreamOutputStream>(std::move(ct_stream)),
+      associated_data, checkpoint);
+  ASSERT_THAT(resumed_result.status(), IsOk());
+  ASSERT_THAT(
+      test::WriteToStream(resumed_result.ValueOrDie().get(),
+                          plaintext.substr(checkpoint.plaintext_position)),
+      IsOk());
+  std::string resumed_ciphertext =
+      ciphertext.substr(0, checkpoint.ciphertext_position) + ct_buf->str();
+  EXPECT_EQ(ciphertext, resumed_ciphertext);
+
+  auto dec_stream = std::move(
+      streaming_aead
+          ->NewDecryptingStream(
+              absl::make_unique<util::IstreamInputStream>(
+                  absl::make_unique<std::stringstream>(resumed_ciphertext)),
+              associated_data)
+          .ValueOrDie());
+  std::string decrypted;
+  ASSERT_THAT(test::ReadFromStream(dec_stream.get(), &decrypted), IsOk());
+  EXPECT_EQ(plaintext, decrypted);
+
+  // The checkpoint must belong to a stream of this key.
+  checkpoint.header[0] ^= 1;
+  EXPECT_THAT(streaming_aead
+                  ->ResumeEncryptingStream(
+                      absl::make_unique<util::OstreamOutputStream>(
+                          absl::make_unique<std::stringstream>()),
+                      associated_data, checkpoint)
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
 // FIPS only mode tests
 TEST(AesCtrHmacStreamingTest, TestFipsOnly) {
   if (!kUseOnlyFips) {
@@ -27,6 +27,7 @@
 
 #include <algorithm>
 #include <array>
+#include <cstdint>
 #include <memory>
 #include <string>
 
@@ -81,9 +82,9 @@ inline __m128i Increment(__m128i x) {
 // So far I've not found a simple way to compute and add the carry using
 // xmm instructions. However, optimizing this function is not important,
 // since it is used just once during decryption.
-inline __m128i Add(__m128i x, uint64 y) {
-  // Convert to a vector of two uint64.
-  uint64 vec[2];
+inline __m128i Add(__m128i x, uint64_t y) {
+  // Convert to a vector of two uint64_t.
+  uint64_t vec[2];
   _mm_storeu_si128(reinterpret_cast<__m128i*>(vec), x);
   // Perform the addition on the vector.
   vec[0] += y;
@@ -163,7 +164,7 @@ uint8_t Rcon(int round) {
 // This performs a rotation and a substitution with an S-box.
 // This implementation uses AESKEYGENASSIST to compute the result twice
 // and checks that the two results match.
-inline uint32 SubRot(uint32 tmp) {
+inline uint32_t SubRot(uint32_t tmp) {
   __m128i inp = _mm_set_epi32(0, 0, tmp, 0);
   __m128i out = _mm_aeskeygenassist_si128(inp, 0x00);
   return _mm_extract_epi32(out, 1);
@@ -172,7 +173,7 @@ inline uint32 SubRot(uint32 tmp) {
 // Apply the S-box to the 4 bytes in a word.
 // This operation is used in the key expansion of 256-bit keys.
 // This implementation computes the result twice and checks equality.
-inline uint32 SubWord(uint32 tmp) {
+inline uint32_t SubWord(uint32_t tmp) {
   __m128i inp = _mm_set_epi32(0, 0, tmp, 0);
   __m128i out = _mm_aeskeygenassist_si128(inp, 0x00);
   return _mm_extract_epi32(out, 0);
@@ -184,12 +185,12 @@ void Aes128KeyExpansion(const uint8_t* key, __m128i *round_key) {
   const int Nk = 4;  // Number of words in the key
   const int Nb = 4;  // Number of words per round key
   const int Nr = 10;  // Number or rounds
-  uint32 *w = reinterpret_cast<uint32*>(round_key);
-  const uint32 *keywords = reinterpret_cast<const uint32*>(key);
+  uint32_t *w = reinterpret_cast<uint32_t*>(round_key);
+  const uint32_t *keywords = reinterpret_cast<const uint32_t*>(key);
   for (int i = 0; i < Nk; i++) {
     w[i] = keywords[i];
   }
-  uint32 tmp = w[Nk - 1];
+  uint32_t tmp = w[Nk - 1];
   for (int i = Nk; i < Nb * (Nr + 1); i++) {
     if (i % Nk == 0) {
       tmp = SubRot(tmp) ^ Rcon(i / Nk);
@@ -203,12 +204,12 @@ void Aes256KeyExpansion(const uint8_t* key, __m128i *round_key) {
   const int Nk = 8;  // Number of words in the key
   const int Nb = 4;  // Number of words per round key
   const int Nr = 14;  // Number or rounds
-  uint32 *w = reinterpret_cast<uint32*>(round_key);
-  const uint32 *keywords = reinterpret_cast<const uint32*>(key);
+  uint32_t *w = reinterpret_cast<uint32_t*>(round_key);
+  const uint32_t *keywords = reinterpret_cast<const uint32_t*>(key);
   for (int i = 0; i < Nk; i++) {
     w[i] = keywords[i];
   }
-  uint32 tmp = w[Nk - 1];
+  uint32_t tmp = w[Nk - 1];
   for (int i = Nk; i < Nb * (Nr + 1); i++) {
     if (i % Nk == 0) {
       tmp = SubRot(tmp) ^ Rcon(i / Nk);
@@ -337,24 +338,47 @@ __m128i AesEaxAesni::Pad(const uint8_t* data, int len) const {
   }
 }
 
-__m128i AesEaxAesni::OMAC(absl::string_view blob, int tag) const {
+size_t AesEaxAesni::OMACSteps(size_t blob_size) {
+  if (blob_size == 0) return 1;
+  return (blob_size + kBlockSize - 1) / kBlockSize + 1;
+}
+
+__m128i AesEaxAesni::OMACInput(absl::string_view blob, int tag,
+                               size_t step) const {
   const uint8_t* data = reinterpret_cast<const uint8_t*>(blob.data());
   size_t len = blob.size();
-  __m128i state = _mm_set_epi32(tag << 24, 0, 0, 0);
-  if (len == 0) {
-    state = _mm_xor_si128(state, *B_);
-  } else {
-    state = EncryptBlock(state);
-    size_t idx = 0;
-    while (len - idx > kBlockSize) {
-      __m128i in = _mm_loadu_si128((__m128i*) (data + idx));
-      state = _mm_xor_si128(in, state);
-      state = EncryptBlock(state);
-      idx += kBlockSize;
-    }
-    state = _mm_xor_si128(state, Pad(data + idx, len - idx));
+  if (step == 0) {
+    __m128i tag_block = _mm_set_epi32(tag << 24, 0, 0, 0);
+    return len == 0 ? _mm_xor_si128(tag_block, *B_) : tag_block;
+  }
+  size_t idx = (step - 1) * kBlockSize;
+  if (len - idx > kBlockSize) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + idx));
+  }
+  return Pad(data + idx, len - idx);
+}
+
+void AesEaxAesni::NonceAndHeaderOMAC(absl::string_view nonce,
+                                     absl::string_view additional_data,
+                                     __m128i* N, __m128i* H) const {
+  const size_t nonce_steps = OMACSteps(nonce.size());
+  const size_t header_steps = OMACSteps(additional_data.size());
+  __m128i n = _mm_setzero_si128();
+  __m128i h = _mm_setzero_si128();
+  size_t step = 0;
+  for (; step < nonce_steps && step < header_steps; step++) {
+    Encrypt2Blocks(_mm_xor_si128(n, OMACInput(nonce, 0, step)),
+                   _mm_xor_si128(h, OMACInput(additional_data, 1, step)), &n,
+                   &h);
+  }
+  for (; step < nonce_steps; step++) {
+    n = EncryptBlock(_mm_xor_si128(n, OMACInput(nonce, 0, step)));
+  }
+  for (; step < header_steps; step++) {
+    h = EncryptBlock(_mm_xor_si128(h, OMACInput(additional_data, 1, step)));
   }
-  return EncryptBlock(state);
+  *N = n;
+  *H = h;
 }
 
 bool AesEaxAesni::RawEncrypt(absl::string_view nonce, absl::string_view in,
@@ -369,8 +393,9 @@ bool AesEaxAesni::RawEncrypt(absl::string_view nonce, absl::string_view in,
   // NOTE(bleichen): The author of EAX designed this mode, so that
   //   it would be possible to compute N and H independently of the encryption.
   //   So far this possiblity is not used in this implementation.
-  const __m128i N = OMAC(nonce, 0);
-  const __m128i H = OMAC(additional_data, 1);
+  __m128i N;
+  __m128i H;
+  NonceAndHeaderOMAC(nonce, additional_data, &N, &H);
 
   // Compute the initial counter in little endian order.
   // EAX uses big endian order, but it is easier to increment
@@ -423,8 +448,9 @@ bool AesEaxAesni::RawEncrypt(absl::string_view nonce, absl::string_view in,
 bool AesEaxAesni::RawDecrypt(absl::string_view nonce, absl::string_view in,
                              absl::string_view additional_data,
                              absl::Span<uint8_t> plaintext) const {
-  __m128i N = OMAC(nonce, 0);
-  __m128i H = OMAC(additional_data, 1);
+  __m128i N;
+  __m128i H;
+  NonceAndHeaderOMAC(nonce, additional_data, &N, &H);
 
   const uint8_t* ciphertext = reinterpret_cast<const uint8_t*>(in.data());
   const size_t ciphertext_size = in.size();
@@ -530,10 +556,10 @@ crypto::tink::util::StatusOr<std::string> AesEaxAesni::Encrypt(
   size_t ciphertext_size = plaintext.size() + nonce_size_ + kTagSize;
   std::string ciphertext;
   ResizeStringUninitialized(&ciphertext, ciphertext_size);
-  const std::string nonce = Random::GetRandomBytes(nonce_size_);
-  absl::c_copy(nonce, ciphertext.begin());
+  Random::FillRandomBytes(absl::MakeSpan(&ciphertext[0], nonce_size_));
   bool result = RawEncrypt(
-      nonce, plaintext, additional_data,
+      absl::string_view(ciphertext.data(), nonce_size_), plaintext,
+      additional_data,
       absl::MakeSpan(reinterpret_cast<uint8_t*>(&ciphertext[nonce_size_]),
                      ciphertext_size - nonce_size_));
   if (!result) {
@@ -550,7 +576,7 @@ crypto::tink::util::StatusOr<std::string> AesEaxAesni::Decrypt(
 
   size_t ct_size = ciphertext.size();
   if (ct_size < nonce_size_ + kTagSize) {
-    return util::Status(util::error::INVALID_ARGUMENT, "Ciphertext too short");
+    return util::CiphertextTooShortError();
   }
   size_t out_size = ct_size - kTagSize - nonce_size_;
   absl::string_view nonce = ciphertext.substr(0, nonce_size_);
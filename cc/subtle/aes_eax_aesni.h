@@ -102,8 +102,20 @@ class AesEaxAesni : public Aead {
   // Pads a partial block of size 1 .. 16.
   __m128i Pad(const uint8_t* data, int len) const;
 
-  // Computes an OMAC.
-  __m128i OMAC(absl::string_view blob, int tag) const;
+  // Returns the number of block encryptions in an OMAC of a blob of
+  // blob_size bytes.
+  static size_t OMACSteps(size_t blob_size);
+
+  // Returns the block which the OMAC of blob with the given tag xors into its
+  // state before the block encryption number step.
+  __m128i OMACInput(absl::string_view blob, int tag, size_t step) const;
+
+  // Computes the OMACs of the nonce (with tag 0) and of the additional data
+  // (with tag 1). The two CBC-MAC chains are independent, so they are computed
+  // concurrently, which hides the latency of the shorter one.
+  void NonceAndHeaderOMAC(absl::string_view nonce,
+                          absl::string_view additional_data, __m128i* N,
+                          __m128i* H) const;
 
   static constexpr int kMaxRounds = 14;  // maximal number of rounds
   static constexpr int kMaxRoundKeys =
@@ -23,6 +23,9 @@
 #include <vector>
 
 #include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "tink/subtle/aes_eax_boringssl.h"
+#include "tink/subtle/random.h"
 #include "tink/subtle/wycheproof_util.h"
 #include "tink/util/secret_data.h"
 #include "tink/util/status.h"
@@ -34,7 +37,18 @@ namespace tink {
 namespace subtle {
 namespace {
 
-TEST(AesEaxAesniTest, testBasic) {
+// The code generation flags only say that the compiler may use AES-NI, not
+// that the CPU running the test supports it.
+class AesEaxAesniTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    if (!__builtin_cpu_supports("sse4.1") || !__builtin_cpu_supports("aes")) {
+      GTEST_SKIP() << "The CPU does not support SSE4.1 and AES-NI";
+    }
+  }
+};
+
+TEST_F(AesEaxAesniTest, testBasic) {
   util::SecretData key = util::SecretDataFromStringView(
       test::HexDecodeOrDie("000102030405060708090a0b0c0d0e0f"));
   size_t nonce_size = 12;
@@ -51,7 +65,7 @@ TEST(AesEaxAesniTest, testBasic) {
   EXPECT_EQ(pt.ValueOrDie(), message);
 }
 
-TEST(AesEaxAesniTest, testMessageSize) {
+TEST_F(AesEaxAesniTest, testMessageSize) {
   util::SecretData key = util::SecretDataFromStringView(
       test::HexDecodeOrDie("000102030405060708090a0b0c0d0e0f"));
   size_t nonce_size = 12;
@@ -70,7 +84,7 @@ TEST(AesEaxAesniTest, testMessageSize) {
   }
 }
 
-TEST(AesEaxAesniTest, testAadSize) {
+TEST_F(AesEaxAesniTest, testAadSize) {
   util::SecretData key = util::SecretDataFromStringView(
       test::HexDecodeOrDie("000102030405060708090a0b0c0d0e0f"));
   size_t nonce_size = 12;
@@ -89,7 +103,7 @@ TEST(AesEaxAesniTest, testAadSize) {
   }
 }
 
-TEST(AesEaxAesniTest, testLongNonce) {
+TEST_F(AesEaxAesniTest, testLongNonce) {
   util::SecretData key = util::SecretDataFromStringView(
       test::HexDecodeOrDie("000102030405060708090a0b0c0d0e0f"));
   size_t nonce_size = 16;
@@ -106,7 +120,7 @@ TEST(AesEaxAesniTest, testLongNonce) {
   EXPECT_EQ(pt.ValueOrDie(), message);
 }
 
-TEST(AesEaxAesniTest, testModification) {
+TEST_F(AesEaxAesniTest, testModification) {
   size_t nonce_size = 12;
   util::SecretData key = util::SecretDataFromStringView(
       test::HexDecodeOrDie("000102030405060708090a0b0c0d0e0f"));
@@ -135,7 +149,7 @@ TEST(AesEaxAesniTest, testModification) {
   }
 }
 
-TEST(AesEaxAesniTest, testInvalidKeySizes) {
+TEST_F(AesEaxAesniTest, testInvalidKeySizes) {
   size_t nonce_size = 12;
   for (int keysize = 0; keysize < 65; keysize++) {
     if (keysize == 16 || keysize == 32) {
@@ -147,7 +161,7 @@ TEST(AesEaxAesniTest, testInvalidKeySizes) {
   }
 }
 
-TEST(AesEaxAesniTest, testEmpty) {
+TEST_F(AesEaxAesniTest, testEmpty) {
   size_t nonce_size = 12;
   util::SecretData key = util::SecretDataFromStringView(
       test::HexDecodeOrDie("bedcfb5a011ebc84600fcb296c15af0d"));
@@ -203,6 +217,44 @@ TEST(AesEaxAesniTest, testEmpty) {
   EXPECT_EQ(0, pt.ValueOrDie().size());
 }
 
+// AES-EAX is deterministic for a given nonce, so an implementation which
+// decrypts a ciphertext to the plaintext it was computed from produces the
+// same ciphertext for that nonce. Checking this both ways compares the
+// ciphertexts of AesEaxAesni and AesEaxBoringSsl.
+TEST_F(AesEaxAesniTest, SameCiphertextsAsBoringSsl) {
+  for (int key_size : {16, 32}) {
+    for (int nonce_size : {12, 16}) {
+      util::SecretData key = Random::GetRandomKeyBytes(key_size);
+      auto aesni = std::move(AesEaxAesni::New(key, nonce_size).ValueOrDie());
+      auto boringssl =
+          std::move(AesEaxBoringSsl::New(key, nonce_size).ValueOrDie());
+      for (int message_size :
+           {0, 1, 15, 16, 17, 31, 32, 33, 47, 48, 49, 255, 256, 257}) {
+        for (int aad_size : {0, 1, 15, 16, 17, 32, 33}) {
+          SCOPED_TRACE(absl::StrCat("key_size: ", key_size,
+                                    " nonce_size: ", nonce_size,
+                                    " message_size: ", message_size,
+                                    " aad_size: ", aad_size));
+          std::string message = Random::GetRandomBytes(message_size);
+          std::string aad = Random::GetRandomBytes(aad_size);
+
+          auto ciphertext = aesni->Encrypt(message, aad);
+          ASSERT_TRUE(ciphertext.ok()) << ciphertext.status();
+          auto decrypted = boringssl->Decrypt(ciphertext.ValueOrDie(), aad);
+          ASSERT_TRUE(decrypted.ok()) << decrypted.status();
+          EXPECT_EQ(decrypted.ValueOrDie(), message);
+
+          ciphertext = boringssl->Encrypt(message, aad);
+          ASSERT_TRUE(ciphertext.ok()) << ciphertext.status();
+          decrypted = aesni->Decrypt(ciphertext.ValueOrDie(), aad);
+          ASSERT_TRUE(decrypted.ok()) << decrypted.status();
+          EXPECT_EQ(decrypted.ValueOrDie(), message);
+        }
+      }
+    }
+  }
+}
+
 // Test with test vectors from project Wycheproof.
 // AesEaxAesni does not allow to pass in IVs. Therefore this test
 // can only test decryption.
@@ -266,7 +318,7 @@ bool WycheproofTest(const rapidjson::Document &root) {
   return errors == 0;
 }
 
-TEST(AesEaxAesniTest, TestVectors) {
+TEST_F(AesEaxAesniTest, TestVectors) {
   std::unique_ptr<rapidjson::Document> root =
       WycheproofUtil::ReadTestVectors("aes_eax_test.json");
   ASSERT_TRUE(WycheproofTest(*root));
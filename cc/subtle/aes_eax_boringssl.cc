@@ -25,8 +25,10 @@
 #include "absl/algorithm/container.h"
 #include "absl/base/config.h"
 #include "absl/memory/memory.h"
+#include "openssl/aes.h"
 #include "openssl/err.h"
 #include "openssl/evp.h"
+#include "openssl/mem.h"
 #include "tink/aead.h"
 #include "tink/config/tink_fips.h"
 #include "tink/subtle/random.h"
@@ -42,6 +44,10 @@ namespace subtle {
 
 namespace {
 
+// The number of blocks which are passed to AES_cbc_encrypt at a time when
+// computing an OMAC.
+constexpr size_t kCbcMacChunkBlocks = 16;
+
 // Loads and stores 8 bytes. The endianness of the two routines
 // does not matter, as long as the two routines use the same order.
 uint64_t Load64(const uint8_t src[8]) {
@@ -186,6 +192,21 @@ void AesEaxBoringSsl::EncryptBlock(Block* block) const {
   AES_encrypt(block->data(), block->data(), aeskey_.get());
 }
 
+void AesEaxBoringSsl::CbcMacBlocks(absl::Span<const uint8_t> data,
+                                   Block* mac) const {
+  // AES_cbc_encrypt leaves the last ciphertext block, i.e. the CBC-MAC, in
+  // the IV. BoringSSL processes the whole input with AES-NI or the ARMv8
+  // Crypto Extensions when the CPU has them, which is much faster than a
+  // call to AES_encrypt per block. The ciphertext itself is discarded.
+  uint8_t scratch[kCbcMacChunkBlocks * kBlockSize];
+  for (size_t idx = 0; idx < data.size(); idx += sizeof(scratch)) {
+    size_t len = std::min(sizeof(scratch), data.size() - idx);
+    AES_cbc_encrypt(&data[idx], scratch, len, aeskey_.get(), mac->data(),
+                    AES_ENCRYPT);
+  }
+  OPENSSL_cleanse(scratch, sizeof(scratch));
+}
+
 AesEaxBoringSsl::Block AesEaxBoringSsl::Omac(absl::string_view blob,
                                              int tag) const {
   return Omac(absl::MakeSpan(reinterpret_cast<const uint8_t*>(blob.data()),
@@ -204,12 +225,9 @@ AesEaxBoringSsl::Block AesEaxBoringSsl::Omac(absl::Span<const uint8_t> data,
     return mac;
   }
   EncryptBlock(&mac);
-  int idx = 0;
-  while (data.size() - idx > kBlockSize) {
-    XorBlock(&data[idx], &mac);
-    EncryptBlock(&mac);
-    idx += kBlockSize;
-  }
+  // All blocks but the last, which is padded.
+  const size_t idx = kBlockSize * ((data.size() - 1) / kBlockSize);
+  CbcMacBlocks(data.subspan(0, idx), &mac);
   const Block padded_block = Pad(absl::MakeSpan(data).subspan(idx));
   XorBlock(padded_block.data(), &mac);
   EncryptBlock(&mac);
@@ -231,18 +249,49 @@ void AesEaxBoringSsl::CtrCrypt(const Block& N, absl::Span<const uint8_t> in,
 
 crypto::tink::util::StatusOr<std::string> AesEaxBoringSsl::Encrypt(
     absl::string_view plaintext, absl::string_view additional_data) const {
+  std::string ciphertext;
+  ResizeStringUninitialized(&ciphertext,
+                            plaintext.size() + nonce_size_ + kTagSize);
+  auto written_result =
+      EncryptInto(plaintext, additional_data, absl::MakeSpan(ciphertext));
+  if (!written_result.ok()) return written_result.status();
+  return ciphertext;
+}
+
+crypto::tink::util::StatusOr<std::string> AesEaxBoringSsl::Decrypt(
+    absl::string_view ciphertext, absl::string_view additional_data) const {
+  if (ciphertext.size() < nonce_size_ + kTagSize) {
+    return util::CiphertextTooShortError();
+  }
+  std::string res;
+  ResizeStringUninitialized(&res, ciphertext.size() - kTagSize - nonce_size_);
+  auto written_result =
+      DecryptInto(ciphertext, additional_data, absl::MakeSpan(res));
+  if (!written_result.ok()) return written_result.status();
+  return res;
+}
+
+crypto::tink::util::StatusOr<int64_t> AesEaxBoringSsl::CiphertextSize(
+    int64_t plaintext_size) const {
+  return plaintext_size + nonce_size_ + kTagSize;
+}
+
+crypto::tink::util::StatusOr<int64_t> AesEaxBoringSsl::EncryptInto(
+    absl::string_view plaintext, absl::string_view additional_data,
+    absl::Span<char> buffer) const {
   // BoringSSL expects a non-null pointer for plaintext and additional_data,
   // regardless of whether the size is 0.
   plaintext = SubtleUtilBoringSSL::EnsureNonNull(plaintext);
   additional_data = SubtleUtilBoringSSL::EnsureNonNull(additional_data);
 
   size_t ciphertext_size = plaintext.size() + nonce_size_ + kTagSize;
-  std::string ciphertext;
-  ResizeStringUninitialized(&ciphertext, ciphertext_size);
-  const std::string nonce = Random::GetRandomBytes(nonce_size_);
-  const Block N = Omac(nonce, 0);
+  if (buffer.size() < ciphertext_size) {
+    return util::Status(util::error::INVALID_ARGUMENT, "Buffer too small");
+  }
+  Random::FillRandomBytes(buffer.subspan(0, nonce_size_));
+  const Block N = Omac(absl::string_view(buffer.data(), nonce_size_), 0);
   const Block H = Omac(additional_data, 1);
-  uint8_t* ct_start = reinterpret_cast<uint8_t*>(&ciphertext[nonce_size_]);
+  uint8_t* ct_start = reinterpret_cast<uint8_t*>(&buffer[nonce_size_]);
   CtrCrypt(N,
            absl::MakeSpan(reinterpret_cast<const uint8_t*>(plaintext.data()),
                           plaintext.size()),
@@ -250,22 +299,25 @@ crypto::tink::util::StatusOr<std::string> AesEaxBoringSsl::Encrypt(
   Block mac = Omac(absl::MakeSpan(ct_start, plaintext.size()), 2);
   XorBlock(N.data(), &mac);
   XorBlock(H.data(), &mac);
-  absl::c_copy(nonce, ciphertext.begin());
-  std::copy_n(mac.begin(), kTagSize, &ciphertext[ciphertext_size - kTagSize]);
-  return ciphertext;
+  std::copy_n(mac.begin(), kTagSize, &buffer[ciphertext_size - kTagSize]);
+  return ciphertext_size;
 }
 
-crypto::tink::util::StatusOr<std::string> AesEaxBoringSsl::Decrypt(
-    absl::string_view ciphertext, absl::string_view additional_data) const {
+crypto::tink::util::StatusOr<int64_t> AesEaxBoringSsl::DecryptInto(
+    absl::string_view ciphertext, absl::string_view additional_data,
+    absl::Span<char> buffer) const {
   // BoringSSL expects a non-null pointer for additional_data,
   // regardless of whether the size is 0.
   additional_data = SubtleUtilBoringSSL::EnsureNonNull(additional_data);
 
   size_t ct_size = ciphertext.size();
   if (ct_size < nonce_size_ + kTagSize) {
-    return util::Status(util::error::INVALID_ARGUMENT, "Ciphertext too short");
+    return util::CiphertextTooShortError();
   }
   size_t out_size = ct_size - kTagSize - nonce_size_;
+  if (buffer.size() < out_size) {
+    return util::Status(util::error::INVALID_ARGUMENT, "Buffer too small");
+  }
   absl::string_view nonce = ciphertext.substr(0, nonce_size_);
   absl::string_view encrypted = ciphertext.substr(nonce_size_, out_size);
   absl::string_view tag = ciphertext.substr(ct_size - kTagSize, kTagSize);
@@ -278,13 +330,16 @@ crypto::tink::util::StatusOr<std::string> AesEaxBoringSsl::Decrypt(
   if (!EqualBlocks(mac.data(), sig)) {
     return util::Status(util::error::INVALID_ARGUMENT, "Tag mismatch");
   }
-  std::string res;
-  ResizeStringUninitialized(&res, out_size);
+  // BoringSSL expects a non-null pointer for the output, regardless of
+  // whether the size is 0.
+  char dummy;
+  uint8_t* out = reinterpret_cast<uint8_t*>(
+      buffer.data() != nullptr ? buffer.data() : &dummy);
   CtrCrypt(N,
            absl::MakeSpan(reinterpret_cast<const uint8_t*>(encrypted.data()),
                           encrypted.size()),
-           reinterpret_cast<uint8_t*>(&res[0]));
-  return res;
+           out);
+  return out_size;
 }
 
 }  // namespace subtle
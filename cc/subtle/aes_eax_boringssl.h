@@ -51,6 +51,17 @@ class AesEaxBoringSsl : public Aead {
       absl::string_view ciphertext,
       absl::string_view additional_data) const override;
 
+  crypto::tink::util::StatusOr<int64_t> CiphertextSize(
+      int64_t plaintext_size) const override;
+
+  crypto::tink::util::StatusOr<int64_t> EncryptInto(
+      absl::string_view plaintext, absl::string_view additional_data,
+      absl::Span<char> buffer) const override;
+
+  crypto::tink::util::StatusOr<int64_t> DecryptInto(
+      absl::string_view ciphertext, absl::string_view additional_data,
+      absl::Span<char> buffer) const override;
+
   static constexpr crypto::tink::FipsCompatibility kFipsStatus =
       crypto::tink::FipsCompatibility::kNotFips;
 
@@ -93,6 +104,10 @@ class AesEaxBoringSsl : public Aead {
   void EncryptBlock(Block* block) const;
   void EncryptBlock(util::SecretData* block) const;
 
+  // CBC-encrypts the blocks of data into mac, i.e. the part of an OMAC
+  // before the final block. The size of data must be a multiple of 16 bytes.
+  void CbcMacBlocks(absl::Span<const uint8_t> data, Block* mac) const;
+
   // Pads a partial data block of size 0 <= len <= kBlockSize.
   Block Pad(absl::Span<const uint8_t> data) const;
 
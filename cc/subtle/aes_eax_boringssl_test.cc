@@ -19,8 +19,10 @@
 #include <string>
 #include <vector>
 
+#include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
 #include "openssl/err.h"
 #include "tink/subtle/wycheproof_util.h"
 #include "tink/util/secret_data.h"
@@ -57,6 +59,58 @@ TEST(AesEaxBoringSslTest, TestBasic) {
   EXPECT_EQ(pt.ValueOrDie(), message);
 }
 
+TEST(AesEaxBoringSslTest, TestEncryptIntoDecryptInto) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+
+  util::SecretData key = util::SecretDataFromStringView(
+      test::HexDecodeOrDie("000102030405060708090a0b0c0d0e0f"));
+  auto res = AesEaxBoringSsl::New(key, 16);
+  ASSERT_TRUE(res.ok()) << res.status();
+  auto cipher = std::move(res.ValueOrDie());
+  std::string message = "Some data to encrypt.";
+  std::string aad = "Some data to authenticate.";
+
+  auto size_result = cipher->CiphertextSize(message.size());
+  ASSERT_TRUE(size_result.ok()) << size_result.status();
+  EXPECT_EQ(size_result.ValueOrDie(), message.size() + 16 + 16);
+
+  // Too small buffers are rejected.
+  std::string ct(size_result.ValueOrDie() - 1, '\0');
+  EXPECT_THAT(
+      cipher->EncryptInto(message, aad, absl::MakeSpan(ct)).status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+
+  ct.resize(size_result.ValueOrDie());
+  auto written = cipher->EncryptInto(message, aad, absl::MakeSpan(ct));
+  ASSERT_TRUE(written.ok()) << written.status();
+  EXPECT_EQ(written.ValueOrDie(), ct.size());
+
+  // Ciphertexts of EncryptInto() and Encrypt() are interchangeable.
+  auto pt = cipher->Decrypt(ct, aad);
+  ASSERT_TRUE(pt.ok()) << pt.status();
+  EXPECT_EQ(pt.ValueOrDie(), message);
+
+  std::string decrypted(message.size() - 1, '\0');
+  EXPECT_THAT(
+      cipher->DecryptInto(ct, aad, absl::MakeSpan(decrypted)).status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+  decrypted.resize(ct.size());
+  written = cipher->DecryptInto(ct, aad, absl::MakeSpan(decrypted));
+  ASSERT_TRUE(written.ok()) << written.status();
+  EXPECT_EQ(decrypted.substr(0, written.ValueOrDie()), message);
+
+  std::string ct2 = cipher->Encrypt(message, aad).ValueOrDie();
+  written = cipher->DecryptInto(ct2, aad, absl::MakeSpan(decrypted));
+  ASSERT_TRUE(written.ok()) << written.status();
+  EXPECT_EQ(decrypted.substr(0, written.ValueOrDie()), message);
+
+  // Modified ciphertexts fail.
+  ct[ct.size() - 1] ^= 1;
+  EXPECT_FALSE(cipher->DecryptInto(ct, aad, absl::MakeSpan(decrypted)).ok());
+}
+
 TEST(AesEaxBoringSslTest, TestMessageSize) {
   if (kUseOnlyFips) {
     GTEST_SKIP() << "Not supported in FIPS-only mode";
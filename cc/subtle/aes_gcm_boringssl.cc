@@ -16,10 +16,15 @@
 
 #include "tink/subtle/aes_gcm_boringssl.h"
 
+#include <algorithm>
+#include <cstring>
+#include <string>
 #include <utility>
+#include <vector>
 
 #include "absl/memory/memory.h"
 #include "openssl/aead.h"
+#include "openssl/cipher.h"
 #include "tink/config/tink_fips.h"
 #include "tink/subtle/random.h"
 #include "tink/subtle/subtle_util.h"
@@ -46,40 +51,205 @@ util::StatusOr<std::unique_ptr<Aead>> AesGcmBoringSsl::New(
     return util::Status(util::error::INTERNAL,
                         "could not initialize EVP_AEAD_CTX");
   }
-  return {absl::WrapUnique(new AesGcmBoringSsl(std::move(ctx)))};
+  bssl::UniquePtr<EVP_CIPHER_CTX> cipher_ctx(EVP_CIPHER_CTX_new());
+  if (!cipher_ctx ||
+      !EVP_EncryptInit_ex(cipher_ctx.get(),
+                          SubtleUtilBoringSSL::GetAesGcmCipherForKeySize(
+                              key.size()),
+                          nullptr, reinterpret_cast<const uint8_t*>(key.data()),
+                          nullptr)) {
+    return util::Status(util::error::INTERNAL,
+                        "could not initialize EVP_CIPHER_CTX");
+  }
+  return {absl::WrapUnique(
+      new AesGcmBoringSsl(std::move(ctx), std::move(cipher_ctx)))};
 }
 
 util::StatusOr<std::string> AesGcmBoringSsl::Encrypt(
     absl::string_view plaintext, absl::string_view additional_data) const {
-  std::string result = Random::GetRandomBytes(kIvSizeInBytes);
+  std::string result;
   ResizeStringUninitialized(
       &result, kIvSizeInBytes + plaintext.size() + kTagSizeInBytes);
+  auto written_result =
+      EncryptInto(plaintext, additional_data, absl::MakeSpan(result));
+  if (!written_result.ok()) return written_result.status();
+  return result;
+}
+
+util::StatusOr<std::string> AesGcmBoringSsl::Decrypt(
+    absl::string_view ciphertext, absl::string_view additional_data) const {
+  if (ciphertext.size() < kIvSizeInBytes + kTagSizeInBytes) {
+    return util::CiphertextTooShortError();
+  }
+
+  std::string result;
+  ResizeStringUninitialized(
+      &result, ciphertext.size() - kIvSizeInBytes - kTagSizeInBytes);
+  auto written_result =
+      DecryptInto(ciphertext, additional_data, absl::MakeSpan(result));
+  if (!written_result.ok()) return written_result.status();
+  return result;
+}
+
+util::StatusOr<int64_t> AesGcmBoringSsl::CiphertextSize(
+    int64_t plaintext_size) const {
+  return kIvSizeInBytes + plaintext_size + kTagSizeInBytes;
+}
+
+util::StatusOr<int64_t> AesGcmBoringSsl::EncryptInto(
+    absl::string_view plaintext, absl::string_view additional_data,
+    absl::Span<char> buffer) const {
+  // BoringSSL expects a non-null pointer for plaintext and additional_data,
+  // regardless of whether the size is 0.
+  plaintext = SubtleUtilBoringSSL::EnsureNonNull(plaintext);
+  additional_data = SubtleUtilBoringSSL::EnsureNonNull(additional_data);
+
+  size_t ciphertext_size = kIvSizeInBytes + plaintext.size() + kTagSizeInBytes;
+  if (buffer.size() < ciphertext_size) {
+    return util::Status(util::error::INVALID_ARGUMENT, "Buffer too small");
+  }
+  Random::FillRandomBytes(buffer.subspan(0, kIvSizeInBytes));
+  return SealWithIv(plaintext, additional_data, buffer.data());
+}
+
+util::StatusOr<int64_t> AesGcmBoringSsl::SealWithIv(
+    absl::string_view plaintext, absl::string_view additional_data,
+    char* out) const {
   size_t len;
   if (EVP_AEAD_CTX_seal(
-          ctx_.get(), reinterpret_cast<uint8_t*>(&result[kIvSizeInBytes]), &len,
+          ctx_.get(), reinterpret_cast<uint8_t*>(out + kIvSizeInBytes), &len,
           plaintext.size() + kTagSizeInBytes,
-          reinterpret_cast<const uint8_t*>(&result[0]), kIvSizeInBytes,
+          reinterpret_cast<const uint8_t*>(out), kIvSizeInBytes,
           reinterpret_cast<const uint8_t*>(plaintext.data()), plaintext.size(),
           reinterpret_cast<const uint8_t*>(additional_data.data()),
           additional_data.size()) != 1) {
     return util::Status(util::error::INTERNAL, "Encryption failed");
   }
-  return result;
+  return kIvSizeInBytes + len;
 }
 
-util::StatusOr<std::string> AesGcmBoringSsl::Decrypt(
-    absl::string_view ciphertext, absl::string_view additional_data) const {
-  if (ciphertext.size() < kIvSizeInBytes + kTagSizeInBytes) {
-    return util::Status(util::error::INVALID_ARGUMENT, "Ciphertext too short");
+util::StatusOr<int64_t> AesGcmBoringSsl::EncryptFragmentsInto(
+    absl::Span<const absl::string_view> plaintext,
+    absl::Span<const absl::string_view> additional_data,
+    absl::Span<const absl::Span<char>> buffers) const {
+  int64_t ciphertext_size = kIvSizeInBytes + kTagSizeInBytes;
+  for (absl::string_view fragment : plaintext) {
+    ciphertext_size += fragment.size();
+  }
+  int64_t buffers_size = 0;
+  for (absl::Span<char> buffer : buffers) buffers_size += buffer.size();
+  if (buffers_size < ciphertext_size) {
+    return util::Status(util::error::INVALID_ARGUMENT, "Buffer too small");
   }
 
-  std::string result;
-  ResizeStringUninitialized(
-      &result, ciphertext.size() - kIvSizeInBytes - kTagSizeInBytes);
+  char iv[kIvSizeInBytes];
+  Random::FillRandomBytes(absl::MakeSpan(iv));
+  std::vector<absl::Span<char>> out;
+  auto status = ScatterInto(absl::string_view(iv, kIvSizeInBytes), buffers,
+                            &out);
+  if (!status.ok()) return status;
+
+  bssl::ScopedEVP_CIPHER_CTX ctx;
+  if (!EVP_CIPHER_CTX_copy(ctx.get(), cipher_ctx_.get()) ||
+      !EVP_EncryptInit_ex(ctx.get(), nullptr, nullptr, nullptr,
+                          reinterpret_cast<const uint8_t*>(iv))) {
+    return util::Status(util::error::INTERNAL, "Encryption init failed");
+  }
+  int len;
+  // Empty fragments are skipped, since a null input finalizes the tag.
+  for (absl::string_view fragment : additional_data) {
+    if (fragment.empty()) continue;
+    if (!EVP_EncryptUpdate(ctx.get(), nullptr, &len,
+                           reinterpret_cast<const uint8_t*>(fragment.data()),
+                           fragment.size())) {
+      return util::Status(util::error::INTERNAL, "Encryption failed");
+    }
+  }
+  // GCM is a stream mode, so every update writes exactly as many bytes as it
+  // reads, and a fragment can be split wherever an output buffer ends.
+  size_t out_index = 0;
+  for (absl::string_view fragment : plaintext) {
+    while (!fragment.empty()) {
+      absl::Span<char>& buffer = out[out_index];
+      size_t size = std::min(fragment.size(), buffer.size());
+      if (!EVP_EncryptUpdate(ctx.get(),
+                             reinterpret_cast<uint8_t*>(buffer.data()), &len,
+                             reinterpret_cast<const uint8_t*>(fragment.data()),
+                             size)) {
+        return util::Status(util::error::INTERNAL, "Encryption failed");
+      }
+      fragment.remove_prefix(size);
+      buffer.remove_prefix(size);
+      if (buffer.empty()) out_index++;
+    }
+  }
+  char tag[kTagSizeInBytes];
+  if (!EVP_EncryptFinal_ex(ctx.get(), nullptr, &len) ||
+      !EVP_CIPHER_CTX_ctrl(ctx.get(), EVP_CTRL_GCM_GET_TAG, kTagSizeInBytes,
+                           tag)) {
+    return util::Status(util::error::INTERNAL, "Encryption failed");
+  }
+  status = ScatterInto(absl::string_view(tag, kTagSizeInBytes),
+                       absl::MakeConstSpan(out).subspan(out_index), nullptr);
+  if (!status.ok()) return status;
+  return ciphertext_size;
+}
+
+util::Status AesGcmBoringSsl::BatchEncrypt(
+    absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs,
+    std::string* arena, std::vector<absl::string_view>* ciphertexts) const {
+  int64_t total_size = 0;
+  for (const auto& input : inputs) {
+    total_size += kIvSizeInBytes + input.first.size() + kTagSizeInBytes;
+  }
+  ResizeStringUninitialized(arena, total_size);
+
+  // A single call to the RNG for the whole batch.
+  std::string ivs;
+  ResizeStringUninitialized(&ivs, inputs.size() * kIvSizeInBytes);
+  Random::FillRandomBytes(absl::MakeSpan(ivs));
+
+  std::vector<int64_t> sizes;
+  sizes.reserve(inputs.size());
+  int64_t offset = 0;
+  for (size_t i = 0; i < inputs.size(); i++) {
+    char* out = &(*arena)[0] + offset;
+    std::memcpy(out, &ivs[i * kIvSizeInBytes], kIvSizeInBytes);
+    // BoringSSL expects a non-null pointer for plaintext and additional_data,
+    // regardless of whether the size is 0.
+    auto written_result =
+        SealWithIv(SubtleUtilBoringSSL::EnsureNonNull(inputs[i].first),
+                   SubtleUtilBoringSSL::EnsureNonNull(inputs[i].second), out);
+    if (!written_result.ok()) return written_result.status();
+    sizes.push_back(written_result.ValueOrDie());
+    offset += written_result.ValueOrDie();
+  }
+  SplitArena(*arena, sizes, ciphertexts);
+  return util::Status::OK;
+}
+
+util::StatusOr<int64_t> AesGcmBoringSsl::DecryptInto(
+    absl::string_view ciphertext, absl::string_view additional_data,
+    absl::Span<char> buffer) const {
+  // BoringSSL expects a non-null pointer for additional_data,
+  // regardless of whether the size is 0.
+  additional_data = SubtleUtilBoringSSL::EnsureNonNull(additional_data);
+
+  if (ciphertext.size() < kIvSizeInBytes + kTagSizeInBytes) {
+    return util::CiphertextTooShortError();
+  }
+  size_t plaintext_size = ciphertext.size() - kIvSizeInBytes - kTagSizeInBytes;
+  if (buffer.size() < plaintext_size) {
+    return util::Status(util::error::INVALID_ARGUMENT, "Buffer too small");
+  }
+  // BoringSSL expects a non-null pointer for the output, regardless of
+  // whether the size is 0.
+  char dummy;
+  uint8_t* out = reinterpret_cast<uint8_t*>(
+      buffer.data() != nullptr ? buffer.data() : &dummy);
   size_t len;
   if (EVP_AEAD_CTX_open(
-          ctx_.get(), reinterpret_cast<uint8_t*>(&result[0]), &len,
-          result.size(),
+          ctx_.get(), out, &len, plaintext_size,
           // The nonce is the first |kIvSizeInBytes| bytes of |ciphertext|.
           reinterpret_cast<const uint8_t*>(ciphertext.data()), kIvSizeInBytes,
           // The input is the remainder.
@@ -87,9 +257,9 @@ util::StatusOr<std::string> AesGcmBoringSsl::Decrypt(
           ciphertext.size() - kIvSizeInBytes,
           reinterpret_cast<const uint8_t*>(additional_data.data()),
           additional_data.size()) != 1) {
-    return util::Status(util::error::INTERNAL, "Authentication failed");
+    return util::AuthenticationFailedError();
   }
-  return result;
+  return len;
 }
 
 }  // namespace subtle
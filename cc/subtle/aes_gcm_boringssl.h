@@ -18,10 +18,14 @@
 #define TINK_SUBTLE_AES_GCM_BORINGSSL_H_
 
 #include <memory>
+#include <string>
 #include <utility>
+#include <vector>
 
 #include "absl/base/macros.h"
+#include "absl/types/span.h"
 #include "openssl/aead.h"
+#include "openssl/cipher.h"
 #include "tink/aead.h"
 #include "tink/config/tink_fips.h"
 #include "tink/util/secret_data.h"
@@ -49,6 +53,31 @@ class AesGcmBoringSsl : public Aead {
       absl::string_view ciphertext,
       absl::string_view additional_data) const override;
 
+  crypto::tink::util::StatusOr<int64_t> CiphertextSize(
+      int64_t plaintext_size) const override;
+
+  crypto::tink::util::StatusOr<int64_t> EncryptInto(
+      absl::string_view plaintext, absl::string_view additional_data,
+      absl::Span<char> buffer) const override;
+
+  crypto::tink::util::StatusOr<int64_t> DecryptInto(
+      absl::string_view ciphertext, absl::string_view additional_data,
+      absl::Span<char> buffer) const override;
+
+  // Feeds the fragments to an EVP_CIPHER context one by one, writing the
+  // ciphertext directly into 'buffers'.
+  crypto::tink::util::StatusOr<int64_t> EncryptFragmentsInto(
+      absl::Span<const absl::string_view> plaintext,
+      absl::Span<const absl::string_view> additional_data,
+      absl::Span<const absl::Span<char>> buffers) const override;
+
+  // Generates the IVs of the whole batch at once and seals all inputs
+  // back-to-back into '*arena'.
+  crypto::tink::util::Status BatchEncrypt(
+      absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs,
+      std::string* arena,
+      std::vector<absl::string_view>* ciphertexts) const override;
+
   static constexpr crypto::tink::FipsCompatibility kFipsStatus =
       crypto::tink::FipsCompatibility::kRequiresBoringCrypto;
 
@@ -56,10 +85,21 @@ class AesGcmBoringSsl : public Aead {
   static constexpr int kIvSizeInBytes = 12;
   static constexpr int kTagSizeInBytes = 16;
 
-  explicit AesGcmBoringSsl(bssl::UniquePtr<EVP_AEAD_CTX> ctx)
-      : ctx_(std::move(ctx)) {}
+  AesGcmBoringSsl(bssl::UniquePtr<EVP_AEAD_CTX> ctx,
+                  bssl::UniquePtr<EVP_CIPHER_CTX> cipher_ctx)
+      : ctx_(std::move(ctx)), cipher_ctx_(std::move(cipher_ctx)) {}
+
+  // Seals 'plaintext' with the IV already stored in the first
+  // kIvSizeInBytes bytes of 'out', which must have room for the whole
+  // ciphertext. Returns the size of the ciphertext.
+  crypto::tink::util::StatusOr<int64_t> SealWithIv(
+      absl::string_view plaintext, absl::string_view additional_data,
+      char* out) const;
 
   bssl::UniquePtr<EVP_AEAD_CTX> ctx_;
+  // Holds the expanded key for EncryptFragmentsInto(), which works on a copy
+  // with the IV set, since EVP_AEAD has no incremental interface.
+  bssl::UniquePtr<EVP_CIPHER_CTX> cipher_ctx_;
 };
 
 }  // namespace subtle
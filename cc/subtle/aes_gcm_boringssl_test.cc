@@ -17,11 +17,13 @@
 #include "tink/subtle/aes_gcm_boringssl.h"
 
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
 #include "openssl/err.h"
 #include "include/rapidjson/document.h"
 #include "tink/config/tink_fips.h"
@@ -62,6 +64,153 @@ TEST(AesGcmBoringSslTest, testBasic) {
   EXPECT_EQ(pt.ValueOrDie(), message);
 }
 
+TEST(AesGcmBoringSslTest, testEncryptIntoDecryptInto) {
+  if (kUseOnlyFips && !FIPS_mode()) {
+    GTEST_SKIP()
+        << "Test should not run in FIPS mode when BoringCrypto is unavailable.";
+  }
+
+  util::SecretData key = util::SecretDataFromStringView(
+      test::HexDecodeOrDie("000102030405060708090a0b0c0d0e0f"));
+  auto res = AesGcmBoringSsl::New(key);
+  ASSERT_TRUE(res.ok()) << res.status();
+  auto cipher = std::move(res.ValueOrDie());
+  std::string message = "Some data to encrypt.";
+  std::string aad = "Some data to authenticate.";
+
+  auto size_result = cipher->CiphertextSize(message.size());
+  ASSERT_TRUE(size_result.ok()) << size_result.status();
+  EXPECT_EQ(size_result.ValueOrDie(), message.size() + 12 + 16);
+
+  // Too small buffers are rejected.
+  std::string ct(size_result.ValueOrDie() - 1, '\0');
+  EXPECT_THAT(
+      cipher->EncryptInto(message, aad, absl::MakeSpan(ct)).status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+
+  ct.resize(size_result.ValueOrDie());
+  auto written = cipher->EncryptInto(message, aad, absl::MakeSpan(ct));
+  ASSERT_TRUE(written.ok()) << written.status();
+  EXPECT_EQ(written.ValueOrDie(), ct.size());
+
+  // Ciphertexts of EncryptInto() and Encrypt() are interchangeable.
+  auto pt = cipher->Decrypt(ct, aad);
+  ASSERT_TRUE(pt.ok()) << pt.status();
+  EXPECT_EQ(pt.ValueOrDie(), message);
+
+  std::string decrypted(message.size() - 1, '\0');
+  EXPECT_THAT(
+      cipher->DecryptInto(ct, aad, absl::MakeSpan(decrypted)).status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+  decrypted.resize(ct.size());
+  written = cipher->DecryptInto(ct, aad, absl::MakeSpan(decrypted));
+  ASSERT_TRUE(written.ok()) << written.status();
+  EXPECT_EQ(decrypted.substr(0, written.ValueOrDie()), message);
+
+  std::string ct2 = cipher->Encrypt(message, aad).ValueOrDie();
+  written = cipher->DecryptInto(ct2, aad, absl::MakeSpan(decrypted));
+  ASSERT_TRUE(written.ok()) << written.status();
+  EXPECT_EQ(decrypted.substr(0, written.ValueOrDie()), message);
+
+  // Modified ciphertexts fail.
+  ct[ct.size() - 1] ^= 1;
+  EXPECT_FALSE(cipher->DecryptInto(ct, aad, absl::MakeSpan(decrypted)).ok());
+}
+
+TEST(AesGcmBoringSslTest, testEncryptFragmentsInto) {
+  if (kUseOnlyFips && !FIPS_mode()) {
+    GTEST_SKIP()
+        << "Test should not run in FIPS mode when BoringCrypto is unavailable.";
+  }
+
+  util::SecretData key = util::SecretDataFromStringView(
+      test::HexDecodeOrDie("000102030405060708090a0b0c0d0e0f"));
+  auto res = AesGcmBoringSsl::New(key);
+  ASSERT_TRUE(res.ok()) << res.status();
+  auto cipher = std::move(res.ValueOrDie());
+  std::vector<absl::string_view> message = {"Some ", "", "data to encrypt",
+                                            "."};
+  std::vector<absl::string_view> aad = {"Some data", "", " to authenticate."};
+  const int ct_size = 21 + 12 + 16;
+
+  // The ciphertext is split across the buffers at various positions,
+  // including inside the IV and the tag.
+  for (int split : {0, 1, 12, 13, 20, 33, 34, 48, 49}) {
+    SCOPED_TRACE(absl::StrCat("split: ", split));
+    std::string ct(ct_size, '\0');
+    std::vector<absl::Span<char>> buffers = {
+        absl::MakeSpan(&ct[0], split), absl::MakeSpan(&ct[0] + split, 0),
+        absl::MakeSpan(&ct[0] + split, ct_size - split)};
+    auto written = cipher->EncryptFragmentsInto(message, aad, buffers);
+    ASSERT_TRUE(written.ok()) << written.status();
+    EXPECT_EQ(written.ValueOrDie(), ct_size);
+    auto pt = cipher->Decrypt(ct, "Some data to authenticate.");
+    ASSERT_TRUE(pt.ok()) << pt.status();
+    EXPECT_EQ(pt.ValueOrDie(), "Some data to encrypt.");
+  }
+
+  // Empty inputs.
+  std::string ct(12 + 16, '\0');
+  std::vector<absl::Span<char>> buffers = {absl::MakeSpan(ct)};
+  auto written = cipher->EncryptFragmentsInto({}, {}, buffers);
+  ASSERT_TRUE(written.ok()) << written.status();
+  auto pt = cipher->Decrypt(ct, "");
+  ASSERT_TRUE(pt.ok()) << pt.status();
+  EXPECT_EQ(pt.ValueOrDie(), "");
+
+  // Too small buffers are rejected.
+  buffers = {absl::MakeSpan(ct)};
+  EXPECT_THAT(cipher->EncryptFragmentsInto(message, aad, buffers).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(AesGcmBoringSslTest, testBatchEncryptDecrypt) {
+  if (kUseOnlyFips && !FIPS_mode()) {
+    GTEST_SKIP()
+        << "Test should not run in FIPS mode when BoringCrypto is unavailable.";
+  }
+
+  util::SecretData key = util::SecretDataFromStringView(
+      test::HexDecodeOrDie("000102030405060708090a0b0c0d0e0f"));
+  auto res = AesGcmBoringSsl::New(key);
+  ASSERT_TRUE(res.ok()) << res.status();
+  auto cipher = std::move(res.ValueOrDie());
+  std::vector<std::pair<absl::string_view, absl::string_view>> inputs = {
+      {"Some data to encrypt.", "Some data to authenticate."},
+      {"", ""},
+      {"Some more data to encrypt.", ""}};
+
+  std::string ct_arena;
+  std::vector<absl::string_view> cts;
+  auto status = cipher->BatchEncrypt(inputs, &ct_arena, &cts);
+  ASSERT_TRUE(status.ok()) << status;
+  ASSERT_EQ(cts.size(), inputs.size());
+  std::vector<std::pair<absl::string_view, absl::string_view>> ct_inputs;
+  for (int i = 0; i < inputs.size(); i++) {
+    EXPECT_EQ(cts[i].size(), inputs[i].first.size() + 12 + 16);
+    auto pt = cipher->Decrypt(cts[i], inputs[i].second);
+    ASSERT_TRUE(pt.ok()) << pt.status();
+    EXPECT_EQ(pt.ValueOrDie(), inputs[i].first);
+    ct_inputs.push_back({cts[i], inputs[i].second});
+  }
+  // Every ciphertext has its own IV.
+  EXPECT_NE(cts[0].substr(0, 12), cts[1].substr(0, 12));
+  EXPECT_NE(cts[1].substr(0, 12), cts[2].substr(0, 12));
+
+  std::string pt_arena;
+  std::vector<absl::string_view> pts;
+  status = cipher->BatchDecrypt(ct_inputs, &pt_arena, &pts);
+  ASSERT_TRUE(status.ok()) << status;
+  ASSERT_EQ(pts.size(), inputs.size());
+  for (int i = 0; i < inputs.size(); i++) {
+    EXPECT_EQ(pts[i], inputs[i].first);
+  }
+
+  // A modified ciphertext fails the whole batch.
+  ct_arena[ct_arena.size() - 1] ^= 1;
+  EXPECT_FALSE(cipher->BatchDecrypt(ct_inputs, &pt_arena, &pts).ok());
+}
+
 TEST(AesGcmBoringSslTest, testModification) {
   if (kUseOnlyFips && !FIPS_mode()) {
     GTEST_SKIP()
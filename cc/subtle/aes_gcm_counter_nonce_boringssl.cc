@@ -0,0 +1,288 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/subtle/aes_gcm_counter_nonce_boringssl.h"
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+
+#if !defined(_WIN32)
+#include <pthread.h>
+#endif
+
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+#include "openssl/aead.h"
+#include "tink/config/tink_fips.h"
+#include "tink/subtle/common_enums.h"
+#include "tink/subtle/hkdf.h"
+#include "tink/subtle/random.h"
+#include "tink/subtle/subtle_util.h"
+#include "tink/subtle/subtle_util_boringssl.h"
+#include "tink/util/status.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+namespace {
+
+// Incremented in the child process after a fork(), so that the child picks
+// a new prefix instead of continuing the counter of the parent.
+std::atomic<uint64_t> fork_generation{0};
+
+void IncrementForkGeneration() {
+  fork_generation.fetch_add(1, std::memory_order_relaxed);
+}
+
+void RegisterForkHandler() {
+#if !defined(_WIN32)
+  static const bool registered =
+      pthread_atfork(nullptr, nullptr, &IncrementForkGeneration) == 0;
+  (void)registered;
+#endif
+}
+
+}  // namespace
+
+constexpr uint64_t AesGcmCounterNonceBoringSsl::kMaxMessagesPerSubkey;
+constexpr int AesGcmCounterNonceBoringSsl::kPrefixSizeInBytes;
+constexpr int AesGcmCounterNonceBoringSsl::kCounterSizeInBytes;
+constexpr int AesGcmCounterNonceBoringSsl::kNonceSizeInBytes;
+constexpr int AesGcmCounterNonceBoringSsl::kTagSizeInBytes;
+constexpr int AesGcmCounterNonceBoringSsl::kMaxCachedSubkeys;
+
+// static
+util::StatusOr<std::unique_ptr<Aead>> AesGcmCounterNonceBoringSsl::New(
+    const util::SecretData& key, uint64_t messages_per_subkey) {
+  auto status = CheckFipsCompatibility<AesGcmCounterNonceBoringSsl>();
+  if (!status.ok()) return status;
+
+  const EVP_AEAD* aead =
+      SubtleUtilBoringSSL::GetAesGcmAeadForKeySize(key.size());
+  if (aead == nullptr) {
+    return util::Status(util::error::INVALID_ARGUMENT, "invalid key size");
+  }
+  if (messages_per_subkey == 0 ||
+      messages_per_subkey > kMaxMessagesPerSubkey) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "invalid number of messages per subkey");
+  }
+  // Registered before the first subkey is picked, so that no fork goes
+  // unnoticed.
+  RegisterForkHandler();
+  auto aes_gcm = absl::WrapUnique(
+      new AesGcmCounterNonceBoringSsl(key, aead, messages_per_subkey));
+  status = aes_gcm->Rotate(nullptr);
+  if (!status.ok()) return status;
+  std::unique_ptr<Aead> result = std::move(aes_gcm);
+  return std::move(result);
+}
+
+util::StatusOr<std::unique_ptr<AesGcmCounterNonceBoringSsl::Subkey>>
+AesGcmCounterNonceBoringSsl::DeriveSubkey(absl::string_view prefix) const {
+  auto subkey_bytes_result = Hkdf::ComputeHkdf(
+      HashType::SHA256, key_, prefix, /*info=*/"", key_.size());
+  if (!subkey_bytes_result.ok()) return subkey_bytes_result.status();
+  const util::SecretData& subkey_bytes = subkey_bytes_result.ValueOrDie();
+  auto subkey = absl::make_unique<Subkey>();
+  subkey->prefix = std::string(prefix);
+  subkey->ctx.reset(EVP_AEAD_CTX_new(aead_, subkey_bytes.data(),
+                                     subkey_bytes.size(),
+                                     EVP_AEAD_DEFAULT_TAG_LENGTH));
+  if (!subkey->ctx) {
+    return util::Status(util::error::INTERNAL,
+                        "could not initialize EVP_AEAD_CTX");
+  }
+  return std::move(subkey);
+}
+
+util::Status AesGcmCounterNonceBoringSsl::Rotate(
+    const Subkey* exhausted) const {
+  absl::MutexLock lock(&mutex_);
+  if (current_.get() != exhausted) return util::OkStatus();
+  uint64_t generation = fork_generation.load(std::memory_order_relaxed);
+  auto subkey_result =
+      DeriveSubkey(Random::GetRandomBytes(kPrefixSizeInBytes));
+  if (!subkey_result.ok()) return subkey_result.status();
+  std::shared_ptr<Subkey> subkey = std::move(subkey_result.ValueOrDie());
+  subkey->fork_generation = generation;
+  // Ciphertexts of the replaced subkey are still decrypted without deriving
+  // it, until it is evicted from the cache.
+  if (current_ != nullptr) CacheSubkey(current_);
+  std::atomic_store(&current_, std::move(subkey));
+  return util::OkStatus();
+}
+
+util::StatusOr<std::shared_ptr<const AesGcmCounterNonceBoringSsl::Subkey>>
+AesGcmCounterNonceBoringSsl::GetDecryptionSubkey(
+    absl::string_view prefix) const {
+  std::shared_ptr<const Subkey> current = std::atomic_load(&current_);
+  if (current->prefix == prefix) return current;
+  std::string prefix_string(prefix);
+  {
+    absl::MutexLock lock(&mutex_);
+    auto it = subkey_cache_.find(prefix_string);
+    if (it != subkey_cache_.end()) {
+      subkey_lru_.splice(subkey_lru_.begin(), subkey_lru_,
+                         it->second.lru_position);
+      return it->second.subkey;
+    }
+  }
+  // Derived without the mutex, so that misses do not block other threads.
+  auto subkey_result = DeriveSubkey(prefix);
+  if (!subkey_result.ok()) return subkey_result.status();
+  std::shared_ptr<const Subkey> subkey = std::move(subkey_result.ValueOrDie());
+  absl::MutexLock lock(&mutex_);
+  CacheSubkey(subkey);
+  return subkey;
+}
+
+void AesGcmCounterNonceBoringSsl::CacheSubkey(
+    std::shared_ptr<const Subkey> subkey) const {
+  std::string prefix = subkey->prefix;
+  if (subkey_cache_.find(prefix) != subkey_cache_.end()) return;
+  if (subkey_cache_.size() >= kMaxCachedSubkeys) {
+    subkey_cache_.erase(subkey_lru_.back());
+    subkey_lru_.pop_back();
+  }
+  subkey_lru_.push_front(prefix);
+  subkey_cache_[prefix] = {std::move(subkey), subkey_lru_.begin()};
+}
+
+util::StatusOr<std::string> AesGcmCounterNonceBoringSsl::Encrypt(
+    absl::string_view plaintext, absl::string_view additional_data) const {
+  std::string result;
+  ResizeStringUninitialized(
+      &result, kNonceSizeInBytes + plaintext.size() + kTagSizeInBytes);
+  auto written_result =
+      EncryptInto(plaintext, additional_data, absl::MakeSpan(result));
+  if (!written_result.ok()) return written_result.status();
+  return result;
+}
+
+util::StatusOr<std::string> AesGcmCounterNonceBoringSsl::Decrypt(
+    absl::string_view ciphertext, absl::string_view additional_data) const {
+  if (ciphertext.size() < kNonceSizeInBytes + kTagSizeInBytes) {
+    return util::CiphertextTooShortError();
+  }
+  std::string result;
+  ResizeStringUninitialized(
+      &result, ciphertext.size() - kNonceSizeInBytes - kTagSizeInBytes);
+  auto written_result =
+      DecryptInto(ciphertext, additional_data, absl::MakeSpan(result));
+  if (!written_result.ok()) return written_result.status();
+  return result;
+}
+
+util::StatusOr<int64_t> AesGcmCounterNonceBoringSsl::CiphertextSize(
+    int64_t plaintext_size) const {
+  return kNonceSizeInBytes + plaintext_size + kTagSizeInBytes;
+}
+
+util::StatusOr<int64_t> AesGcmCounterNonceBoringSsl::EncryptInto(
+    absl::string_view plaintext, absl::string_view additional_data,
+    absl::Span<char> buffer) const {
+  // BoringSSL expects a non-null pointer for plaintext and additional_data,
+  // regardless of whether the size is 0.
+  plaintext = SubtleUtilBoringSSL::EnsureNonNull(plaintext);
+  additional_data = SubtleUtilBoringSSL::EnsureNonNull(additional_data);
+  if (buffer.size() < kNonceSizeInBytes + plaintext.size() + kTagSizeInBytes) {
+    return util::Status(util::error::INVALID_ARGUMENT, "Buffer too small");
+  }
+
+  std::shared_ptr<Subkey> subkey;
+  uint64_t counter;
+  while (true) {
+    subkey = std::atomic_load(&current_);
+    // A subkey picked before a fork() is used by both processes, so each of
+    // them picks a new one instead.
+    if (subkey->fork_generation ==
+        fork_generation.load(std::memory_order_relaxed)) {
+      counter = subkey->next_counter.fetch_add(1, std::memory_order_relaxed);
+      if (counter < messages_per_subkey_) break;
+    }
+    util::Status status = Rotate(subkey.get());
+    if (!status.ok()) return status;
+  }
+  std::memcpy(buffer.data(), subkey->prefix.data(), kPrefixSizeInBytes);
+  for (int i = kNonceSizeInBytes - 1; i >= kPrefixSizeInBytes; i--) {
+    buffer[i] = static_cast<char>(counter & 0xff);
+    counter >>= 8;
+  }
+
+  size_t len;
+  if (EVP_AEAD_CTX_seal(
+          subkey->ctx.get(),
+          reinterpret_cast<uint8_t*>(buffer.data() + kNonceSizeInBytes), &len,
+          plaintext.size() + kTagSizeInBytes,
+          reinterpret_cast<const uint8_t*>(buffer.data()), kNonceSizeInBytes,
+          reinterpret_cast<const uint8_t*>(plaintext.data()), plaintext.size(),
+          reinterpret_cast<const uint8_t*>(additional_data.data()),
+          additional_data.size()) != 1) {
+    return util::Status(util::error::INTERNAL, "Encryption failed");
+  }
+  return kNonceSizeInBytes + len;
+}
+
+util::StatusOr<int64_t> AesGcmCounterNonceBoringSsl::DecryptInto(
+    absl::string_view ciphertext, absl::string_view additional_data,
+    absl::Span<char> buffer) const {
+  // BoringSSL expects a non-null pointer for additional_data,
+  // regardless of whether the size is 0.
+  additional_data = SubtleUtilBoringSSL::EnsureNonNull(additional_data);
+
+  if (ciphertext.size() < kNonceSizeInBytes + kTagSizeInBytes) {
+    return util::CiphertextTooShortError();
+  }
+  size_t plaintext_size =
+      ciphertext.size() - kNonceSizeInBytes - kTagSizeInBytes;
+  if (buffer.size() < plaintext_size) {
+    return util::Status(util::error::INVALID_ARGUMENT, "Buffer too small");
+  }
+
+  auto subkey_result =
+      GetDecryptionSubkey(ciphertext.substr(0, kPrefixSizeInBytes));
+  if (!subkey_result.ok()) return subkey_result.status();
+  const Subkey* subkey = subkey_result.ValueOrDie().get();
+
+  // BoringSSL expects a non-null pointer for the output, regardless of
+  // whether the size is 0.
+  char dummy;
+  uint8_t* out = reinterpret_cast<uint8_t*>(
+      buffer.data() != nullptr ? buffer.data() : &dummy);
+  size_t len;
+  if (EVP_AEAD_CTX_open(
+          subkey->ctx.get(), out, &len, plaintext_size,
+          reinterpret_cast<const uint8_t*>(ciphertext.data()),
+          kNonceSizeInBytes,
+          reinterpret_cast<const uint8_t*>(ciphertext.data()) +
+              kNonceSizeInBytes,
+          ciphertext.size() - kNonceSizeInBytes,
+          reinterpret_cast<const uint8_t*>(additional_data.data()),
+          additional_data.size()) != 1) {
+    return util::AuthenticationFailedError();
+  }
+  return len;
+}
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
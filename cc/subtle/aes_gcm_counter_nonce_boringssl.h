@@ -0,0 +1,166 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TINK_SUBTLE_AES_GCM_COUNTER_NONCE_BORINGSSL_H_
+#define TINK_SUBTLE_AES_GCM_COUNTER_NONCE_BORINGSSL_H_
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "openssl/aead.h"
+#include "tink/aead.h"
+#include "tink/config/tink_fips.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+// AES-GCM with nonces from a counter instead of the random number generator,
+// for processes which encrypt many messages with one key.
+//
+// Each instance picks a random 8-byte nonce prefix, and encrypts with the
+// subkey HKDF-SHA256(key, salt = prefix), of the same size as the key. The
+// 12-byte nonce is the prefix followed by a 4-byte big-endian counter, which
+// is incremented atomically for every message. Before the counter runs out,
+// a new random prefix, and with it a new subkey, is picked. The ciphertext
+// format is (prefix || counter || ciphertext || tag), so it is as long as an
+// AesGcmBoringSsl ciphertext, and any instance with the same key decrypts
+// it.
+//
+// Since nonces do not repeat under one subkey, the number of messages is
+// limited by collisions of the 64-bit prefixes, which happen after about
+// 2^32 subkeys, instead of by random 96-bit nonces, which limit a key to
+// about 2^32 messages. After a fork(), the first encryption in each process
+// picks a new prefix, so that parent and child do not reuse nonces.
+//
+// The subkeys of the most recently decrypted foreign prefixes, and of the
+// prefixes this instance encrypted with before, are cached.
+class AesGcmCounterNonceBoringSsl : public Aead {
+ public:
+  // The number of messages encrypted with one subkey, unless a smaller
+  // 'messages_per_subkey' is given to New().
+  static constexpr uint64_t kMaxMessagesPerSubkey = uint64_t{1} << 32;
+
+  static crypto::tink::util::StatusOr<std::unique_ptr<Aead>> New(
+      const util::SecretData& key,
+      uint64_t messages_per_subkey = kMaxMessagesPerSubkey);
+
+  crypto::tink::util::StatusOr<std::string> Encrypt(
+      absl::string_view plaintext,
+      absl::string_view additional_data) const override;
+
+  crypto::tink::util::StatusOr<std::string> Decrypt(
+      absl::string_view ciphertext,
+      absl::string_view additional_data) const override;
+
+  crypto::tink::util::StatusOr<int64_t> CiphertextSize(
+      int64_t plaintext_size) const override;
+
+  crypto::tink::util::StatusOr<int64_t> EncryptInto(
+      absl::string_view plaintext, absl::string_view additional_data,
+      absl::Span<char> buffer) const override;
+
+  crypto::tink::util::StatusOr<int64_t> DecryptInto(
+      absl::string_view ciphertext, absl::string_view additional_data,
+      absl::Span<char> buffer) const override;
+
+  static constexpr crypto::tink::FipsCompatibility kFipsStatus =
+      crypto::tink::FipsCompatibility::kRequiresBoringCrypto;
+
+ private:
+  static constexpr int kPrefixSizeInBytes = 8;
+  static constexpr int kCounterSizeInBytes = 4;
+  static constexpr int kNonceSizeInBytes =
+      kPrefixSizeInBytes + kCounterSizeInBytes;
+  static constexpr int kTagSizeInBytes = 16;
+  // The number of subkeys kept for decryption besides the current one.
+  static constexpr int kMaxCachedSubkeys = 16;
+
+  // A subkey with its nonce prefix, and the counter of the nonces used.
+  struct Subkey {
+    std::string prefix;
+    bssl::UniquePtr<EVP_AEAD_CTX> ctx;
+    std::atomic<uint64_t> next_counter{0};
+    // The fork generation of the process the subkey was picked in. It is
+    // not used for encryption in other processes.
+    uint64_t fork_generation = 0;
+  };
+
+  struct CachedSubkey {
+    std::shared_ptr<const Subkey> subkey;
+    // The position of the entry in subkey_lru_.
+    std::list<std::string>::iterator lru_position;
+  };
+
+  AesGcmCounterNonceBoringSsl(util::SecretData key, const EVP_AEAD* aead,
+                              uint64_t messages_per_subkey)
+      : key_(std::move(key)),
+        aead_(aead),
+        messages_per_subkey_(messages_per_subkey) {}
+
+  // Returns the subkey for 'prefix'.
+  crypto::tink::util::StatusOr<std::unique_ptr<Subkey>> DeriveSubkey(
+      absl::string_view prefix) const;
+
+  // Replaces 'exhausted' as the current subkey by a new one, unless another
+  // thread did already. 'exhausted' is moved to the cache of subkeys.
+  crypto::tink::util::Status Rotate(const Subkey* exhausted) const
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns the subkey for 'prefix' used to decrypt, deriving it on a miss.
+  crypto::tink::util::StatusOr<std::shared_ptr<const Subkey>>
+  GetDecryptionSubkey(absl::string_view prefix) const
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Caches 'subkey', evicting the least recently used subkey if the cache is
+  // full.
+  void CacheSubkey(std::shared_ptr<const Subkey> subkey) const
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const util::SecretData key_;
+  // aead_ is a singleton owned by BoringSsl.
+  const EVP_AEAD* const aead_;
+  const uint64_t messages_per_subkey_;
+
+  mutable absl::Mutex mutex_;
+  // The subkey used to encrypt. It is replaced under mutex_, and read with
+  // std::atomic_load without it. Encryptions which still use a replaced
+  // subkey keep it alive.
+  mutable std::shared_ptr<Subkey> current_;
+  mutable std::unordered_map<std::string, CachedSubkey> subkey_cache_
+      ABSL_GUARDED_BY(mutex_);
+  // Prefixes of subkey_cache_, most recently used first.
+  mutable std::list<std::string> subkey_lru_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_SUBTLE_AES_GCM_COUNTER_NONCE_BORINGSSL_H_
@@ -0,0 +1,267 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/subtle/aes_gcm_counter_nonce_boringssl.h"
+
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "tink/aead.h"
+#include "tink/subtle/random.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "tink/util/test_matchers.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+namespace {
+
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::testing::Eq;
+using ::testing::Ge;
+using ::testing::Ne;
+
+constexpr int kPrefixSize = 8;
+constexpr int kNonceSize = 12;
+constexpr int kTagSize = 16;
+
+std::unique_ptr<Aead> NewAead(const util::SecretData& key,
+                              uint64_t messages_per_subkey) {
+  auto aead_result = AesGcmCounterNonceBoringSsl::New(key, messages_per_subkey);
+  EXPECT_THAT(aead_result.status(), IsOk());
+  return std::move(aead_result.ValueOrDie());
+}
+
+// Returns the counter in the nonce of 'ciphertext'.
+uint32_t Counter(absl::string_view ciphertext) {
+  uint32_t counter = 0;
+  for (int i = kPrefixSize; i < kNonceSize; i++) {
+    counter = (counter << 8) | static_cast<uint8_t>(ciphertext[i]);
+  }
+  return counter;
+}
+
+TEST(AesGcmCounterNonceBoringSslTest, EncryptDecrypt) {
+  for (int key_size : {16, 32}) {
+    util::SecretData key = Random::GetRandomKeyBytes(key_size);
+    auto aead =
+        NewAead(key, AesGcmCounterNonceBoringSsl::kMaxMessagesPerSubkey);
+    // Another instance has another prefix, but decrypts all ciphertexts.
+    auto other_aead =
+        NewAead(key, AesGcmCounterNonceBoringSsl::kMaxMessagesPerSubkey);
+    for (int size : {0, 1, 16, 17, 1000}) {
+      SCOPED_TRACE(absl::StrCat("key_size: ", key_size, " size: ", size));
+      std::string plaintext = Random::GetRandomBytes(size);
+      auto ciphertext = aead->Encrypt(plaintext, "aad");
+      ASSERT_THAT(ciphertext.status(), IsOk());
+      EXPECT_THAT(ciphertext.ValueOrDie().size(),
+                  Eq(kNonceSize + size + kTagSize));
+      EXPECT_THAT(aead->CiphertextSize(size).ValueOrDie(),
+                  Eq(ciphertext.ValueOrDie().size()));
+      for (const Aead* decrypter : {aead.get(), other_aead.get()}) {
+        auto decrypted = decrypter->Decrypt(ciphertext.ValueOrDie(), "aad");
+        ASSERT_THAT(decrypted.status(), IsOk());
+        EXPECT_THAT(decrypted.ValueOrDie(), Eq(plaintext));
+      }
+    }
+  }
+}
+
+TEST(AesGcmCounterNonceBoringSslTest, NoncesCountUp) {
+  auto aead = NewAead(Random::GetRandomKeyBytes(16),
+                      AesGcmCounterNonceBoringSsl::kMaxMessagesPerSubkey);
+  std::string first = aead->Encrypt("plaintext", "aad").ValueOrDie();
+  for (uint32_t i = 1; i < 5; i++) {
+    std::string ciphertext = aead->Encrypt("plaintext", "aad").ValueOrDie();
+    EXPECT_THAT(ciphertext.substr(0, kPrefixSize),
+                Eq(first.substr(0, kPrefixSize)));
+    EXPECT_THAT(Counter(ciphertext), Eq(Counter(first) + i));
+  }
+}
+
+TEST(AesGcmCounterNonceBoringSslTest, RotatesSubkeys) {
+  util::SecretData key = Random::GetRandomKeyBytes(32);
+  auto aead = NewAead(key, /*messages_per_subkey=*/3);
+  auto other_aead = NewAead(key, /*messages_per_subkey=*/3);
+  std::set<std::string> prefixes;
+  for (int i = 0; i < 10; i++) {
+    std::string plaintext = absl::StrCat("plaintext", i);
+    std::string ciphertext = aead->Encrypt(plaintext, "aad").ValueOrDie();
+    prefixes.insert(ciphertext.substr(0, kPrefixSize));
+    EXPECT_THAT(Counter(ciphertext), Eq(i % 3));
+    auto decrypted = other_aead->Decrypt(ciphertext, "aad");
+    ASSERT_THAT(decrypted.status(), IsOk());
+    EXPECT_THAT(decrypted.ValueOrDie(), Eq(plaintext));
+  }
+  EXPECT_THAT(prefixes.size(), Eq(4));
+}
+
+TEST(AesGcmCounterNonceBoringSslTest, ConcurrentEncryptionsUseDistinctNonces) {
+  auto aead = NewAead(Random::GetRandomKeyBytes(16),
+                      /*messages_per_subkey=*/7);
+  absl::Mutex mutex;
+  std::set<std::string> nonces;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&aead, &mutex, &nonces]() {
+      for (int i = 0; i < 100; i++) {
+        auto ciphertext = aead->Encrypt("plaintext", "aad");
+        ASSERT_THAT(ciphertext.status(), IsOk());
+        EXPECT_THAT(aead->Decrypt(ciphertext.ValueOrDie(), "aad").status(),
+                    IsOk());
+        absl::MutexLock lock(&mutex);
+        nonces.insert(ciphertext.ValueOrDie().substr(0, kNonceSize));
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  EXPECT_THAT(nonces.size(), Eq(400));
+}
+
+TEST(AesGcmCounterNonceBoringSslTest, DecryptsCiphertextsOfEarlierSubkeys) {
+  util::SecretData key = Random::GetRandomKeyBytes(16);
+  auto aead = NewAead(key, /*messages_per_subkey=*/1);
+  std::vector<std::string> ciphertexts;
+  for (int i = 0; i < 40; i++) {
+    ciphertexts.push_back(
+        aead->Encrypt(absl::StrCat("plaintext", i), "aad").ValueOrDie());
+  }
+  // Both the subkeys still cached and the evicted ones decrypt.
+  for (int i = 0; i < 40; i++) {
+    auto decrypted = aead->Decrypt(ciphertexts[i], "aad");
+    ASSERT_THAT(decrypted.status(), IsOk());
+    EXPECT_THAT(decrypted.ValueOrDie(), Eq(absl::StrCat("plaintext", i)));
+  }
+}
+
+#if !defined(_WIN32)
+TEST(AesGcmCounterNonceBoringSslTest, ForkedProcessesUseDistinctNonces) {
+  util::SecretData key = Random::GetRandomKeyBytes(16);
+  auto aead = NewAead(key, AesGcmCounterNonceBoringSsl::kMaxMessagesPerSubkey);
+  std::string before_fork = aead->Encrypt("plaintext", "aad").ValueOrDie();
+
+  int fds[2];
+  ASSERT_THAT(pipe(fds), Eq(0));
+  pid_t pid = fork();
+  ASSERT_THAT(pid, Ge(0));
+  if (pid == 0) {
+    close(fds[0]);
+    auto ciphertext = aead->Encrypt("plaintext", "aad");
+    int exit_code = 1;
+    if (ciphertext.ok() &&
+        write(fds[1], ciphertext.ValueOrDie().data(), kNonceSize) ==
+            kNonceSize) {
+      exit_code = 0;
+    }
+    _exit(exit_code);
+  }
+  close(fds[1]);
+  std::string child_nonce(kNonceSize, '\0');
+  ssize_t read_size = read(fds[0], &child_nonce[0], kNonceSize);
+  close(fds[0]);
+  int status;
+  ASSERT_THAT(waitpid(pid, &status, 0), Eq(pid));
+  ASSERT_TRUE(WIFEXITED(status));
+  ASSERT_THAT(WEXITSTATUS(status), Eq(0));
+  ASSERT_THAT(read_size, Eq(kNonceSize));
+
+  std::string parent_nonce = aead->Encrypt("plaintext", "aad")
+                                 .ValueOrDie()
+                                 .substr(0, kNonceSize);
+  // Without the fork handling, the child would have continued the counter of
+  // the parent under the same prefix, and used the parent's next nonce.
+  EXPECT_THAT(child_nonce, Ne(parent_nonce));
+  EXPECT_THAT(child_nonce.substr(0, kPrefixSize),
+              Ne(before_fork.substr(0, kPrefixSize)));
+}
+#endif
+
+TEST(AesGcmCounterNonceBoringSslTest, ModifiedCiphertext) {
+  auto aead = NewAead(Random::GetRandomKeyBytes(16),
+                      AesGcmCounterNonceBoringSsl::kMaxMessagesPerSubkey);
+  std::string ciphertext = aead->Encrypt("plaintext", "aad").ValueOrDie();
+  for (size_t i = 0; i < ciphertext.size(); i++) {
+    std::string modified = ciphertext;
+    modified[i] ^= 1;
+    EXPECT_FALSE(aead->Decrypt(modified, "aad").ok()) << i;
+  }
+  EXPECT_FALSE(aead->Decrypt(ciphertext, "aae").ok());
+  EXPECT_THAT(
+      aead->Decrypt(ciphertext.substr(0, kNonceSize + kTagSize - 1), "aad")
+          .status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+  auto other_aead = NewAead(Random::GetRandomKeyBytes(16),
+                            AesGcmCounterNonceBoringSsl::kMaxMessagesPerSubkey);
+  EXPECT_FALSE(other_aead->Decrypt(ciphertext, "aad").ok());
+}
+
+TEST(AesGcmCounterNonceBoringSslTest, EncryptIntoAndDecryptInto) {
+  auto aead = NewAead(Random::GetRandomKeyBytes(32),
+                      AesGcmCounterNonceBoringSsl::kMaxMessagesPerSubkey);
+  std::string plaintext = Random::GetRandomBytes(100);
+  std::string ciphertext(kNonceSize + plaintext.size() + kTagSize, '\0');
+  auto written =
+      aead->EncryptInto(plaintext, "aad", absl::MakeSpan(ciphertext));
+  ASSERT_THAT(written.status(), IsOk());
+  EXPECT_THAT(written.ValueOrDie(), Eq(ciphertext.size()));
+  std::string decrypted(plaintext.size(), '\0');
+  written = aead->DecryptInto(ciphertext, "aad", absl::MakeSpan(decrypted));
+  ASSERT_THAT(written.status(), IsOk());
+  EXPECT_THAT(decrypted, Eq(plaintext));
+
+  std::string small_buffer(ciphertext.size() - 1, '\0');
+  EXPECT_THAT(
+      aead->EncryptInto(plaintext, "aad", absl::MakeSpan(small_buffer))
+          .status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(AesGcmCounterNonceBoringSslTest, InvalidParameters) {
+  EXPECT_THAT(AesGcmCounterNonceBoringSsl::New(Random::GetRandomKeyBytes(24))
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  util::SecretData key = Random::GetRandomKeyBytes(16);
+  EXPECT_THAT(AesGcmCounterNonceBoringSsl::New(key, 0).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(
+      AesGcmCounterNonceBoringSsl::New(
+          key, AesGcmCounterNonceBoringSsl::kMaxMessagesPerSubkey + 1)
+          .status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,290 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/subtle/aes_gcm_hkdf_adaptive_streaming.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/internal/endian.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "tink/input_stream.h"
+#include "tink/output_stream.h"
+#include "tink/random_access_stream.h"
+#include "tink/subtle/aes_gcm_hkdf_stream_segment_encrypter.h"
+#include "tink/subtle/aes_gcm_hkdf_streaming.h"
+#include "tink/subtle/hkdf.h"
+#include "tink/util/buffer.h"
+#include "tink/util/input_stream_util.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+namespace {
+
+constexpr char kIkmInfoPrefix[] = "AesGcmHkdfAdaptiveStreaming segment size ";
+
+// Returns the input key material of the streams with the given segment size.
+util::StatusOr<util::SecretData> DeriveIkm(HashType hkdf_hash,
+                                           const util::SecretData& ikm,
+                                           int ciphertext_segment_size) {
+  char segment_size[AesGcmHkdfAdaptiveStreaming::kSegmentSizeFieldSize];
+  absl::big_endian::Store32(segment_size, ciphertext_segment_size);
+  return Hkdf::ComputeHkdf(
+      hkdf_hash, ikm, /* salt = */ "",
+      absl::StrCat(kIkmInfoPrefix,
+                   absl::string_view(segment_size, sizeof(segment_size))),
+      ikm.size());
+}
+
+util::Status WriteFully(absl::string_view data, OutputStream* output) {
+  while (!data.empty()) {
+    void* buffer;
+    auto next_result = output->Next(&buffer);
+    if (!next_result.ok()) return next_result.status();
+    int available = next_result.ValueOrDie();
+    int count = std::min<size_t>(available, data.size());
+    std::memcpy(buffer, data.data(), count);
+    data.remove_prefix(count);
+    if (count < available) output->BackUp(available - count);
+  }
+  return util::OkStatus();
+}
+
+util::StatusOr<std::string> ReadPrefixAt(RandomAccessStream* input) {
+  const size_t count = AesGcmHkdfAdaptiveStreaming::kSegmentSizeFieldSize;
+  auto buffer_result = util::Buffer::New(count);
+  if (!buffer_result.ok()) return buffer_result.status();
+  util::Buffer* buffer = buffer_result.ValueOrDie().get();
+  std::string prefix;
+  while (prefix.size() < count) {
+    util::Status status =
+        input->PRead(prefix.size(), count - prefix.size(), buffer);
+    prefix.append(buffer->get_mem_block(), buffer->size());
+    if (status.error_code() == util::error::OUT_OF_RANGE) {
+      if (prefix.size() < count) {
+        return util::Status(util::error::INVALID_ARGUMENT,
+                            "ciphertext too short");
+      }
+    } else if (!status.ok()) {
+      return status;
+    }
+  }
+  return prefix;
+}
+
+}  // namespace
+
+// static
+util::StatusOr<std::unique_ptr<AesGcmHkdfAdaptiveStreaming>>
+AesGcmHkdfAdaptiveStreaming::New(Params params) {
+  auto status = CheckFipsCompatibility<AesGcmHkdfAdaptiveStreaming>();
+  if (!status.ok()) return status;
+
+  if (params.ciphertext_segment_sizes.empty()) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "ciphertext_segment_sizes must not be empty");
+  }
+  const int header_size =
+      1 + params.derived_key_size +
+      AesGcmHkdfStreamSegmentEncrypter::kNoncePrefixSizeInBytes;
+  std::vector<Variant> variants;
+  for (int ciphertext_segment_size : params.ciphertext_segment_sizes) {
+    if (!variants.empty() &&
+        ciphertext_segment_size <= variants.back().ciphertext_segment_size) {
+      return util::Status(
+          util::error::INVALID_ARGUMENT,
+          "ciphertext_segment_sizes must be in strictly increasing order");
+    }
+    auto ikm_result =
+        DeriveIkm(params.hkdf_hash, params.ikm, ciphertext_segment_size);
+    if (!ikm_result.ok()) return ikm_result.status();
+    AesGcmHkdfStreaming::Params streaming_params;
+    streaming_params.ikm = std::move(ikm_result).ValueOrDie();
+    streaming_params.hkdf_hash = params.hkdf_hash;
+    streaming_params.derived_key_size = params.derived_key_size;
+    streaming_params.ciphertext_segment_size = ciphertext_segment_size;
+    streaming_params.ciphertext_offset = kSegmentSizeFieldSize;
+    // This also validates the parameters, in particular the segment size.
+    auto streaming_result =
+        AesGcmHkdfStreaming::New(std::move(streaming_params));
+    if (!streaming_result.ok()) return streaming_result.status();
+    Variant variant;
+    variant.ciphertext_segment_size = ciphertext_segment_size;
+    variant.max_small_plaintext_size =
+        ciphertext_segment_size - kSegmentSizeFieldSize - header_size -
+        AesGcmHkdfStreamSegmentEncrypter::kTagSizeInBytes;
+    if (variant.max_small_plaintext_size <= 0) {
+      return util::Status(util::error::INVALID_ARGUMENT,
+                          "ciphertext_segment_size too small");
+    }
+    variant.streaming = std::move(streaming_result).ValueOrDie();
+    variants.push_back(std::move(variant));
+  }
+  return {absl::WrapUnique(
+      new AesGcmHkdfAdaptiveStreaming(std::move(variants)))};
+}
+
+const AesGcmHkdfAdaptiveStreaming::Variant&
+AesGcmHkdfAdaptiveStreaming::ChooseVariant(int64_t plaintext_size) const {
+  if (plaintext_size < 0) return variants_.back();
+  const Variant* chosen = &variants_.front();
+  for (const Variant& variant : variants_) {
+    if (plaintext_size / kMinSegmentsPerStream >=
+        variant.ciphertext_segment_size) {
+      chosen = &variant;
+    }
+  }
+  return *chosen;
+}
+
+int AesGcmHkdfAdaptiveStreaming::GetCiphertextSegmentSize(
+    int64_t plaintext_size) const {
+  return ChooseVariant(plaintext_size).ciphertext_segment_size;
+}
+
+util::StatusOr<const AesGcmHkdfAdaptiveStreaming::Variant*>
+AesGcmHkdfAdaptiveStreaming::ParseSegmentSize(absl::string_view prefix) const {
+  uint32_t ciphertext_segment_size = absl::big_endian::Load32(prefix.data());
+  for (const Variant& variant : variants_) {
+    if (static_cast<uint32_t>(variant.ciphertext_segment_size) ==
+        ciphertext_segment_size) {
+      return &variant;
+    }
+  }
+  return util::Status(util::error::INVALID_ARGUMENT,
+                      "unsupported ciphertext segment size");
+}
+
+util::StatusOr<std::unique_ptr<OutputStream>>
+AesGcmHkdfAdaptiveStreaming::NewEncryptingStreamForVariant(
+    const Variant& variant,
+    std::unique_ptr<OutputStream> ciphertext_destination,
+    absl::string_view associated_data) {
+  if (ciphertext_destination == nullptr) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "ciphertext_destination must be non-null");
+  }
+  char prefix[kSegmentSizeFieldSize];
+  absl::big_endian::Store32(prefix, variant.ciphertext_segment_size);
+  auto status = WriteFully(absl::string_view(prefix, sizeof(prefix)),
+                           ciphertext_destination.get());
+  if (!status.ok()) return status;
+  return variant.streaming->NewEncryptingStream(
+      std::move(ciphertext_destination), associated_data);
+}
+
+util::StatusOr<std::unique_ptr<OutputStream>>
+AesGcmHkdfAdaptiveStreaming::NewEncryptingStream(
+    std::unique_ptr<OutputStream> ciphertext_destination,
+    absl::string_view associated_data) {
+  return NewEncryptingStreamForVariant(
+      variants_.back(), std::move(ciphertext_destination), associated_data);
+}
+
+util::StatusOr<std::unique_ptr<OutputStream>>
+AesGcmHkdfAdaptiveStreaming::NewEncryptingStream(
+    std::unique_ptr<OutputStream> ciphertext_destination,
+    absl::string_view associated_data, int64_t size_hint) {
+  return NewEncryptingStreamForVariant(ChooseVariant(size_hint),
+                                       std::move(ciphertext_destination),
+                                       associated_data);
+}
+
+util::StatusOr<std::unique_ptr<InputStream>>
+AesGcmHkdfAdaptiveStreaming::NewDecryptingStream(
+    std::unique_ptr<InputStream> ciphertext_source,
+    absl::string_view associated_data) {
+  if (ciphertext_source == nullptr) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "ciphertext_source must be non-null");
+  }
+  auto prefix_result =
+      ReadBytesFromStream(kSegmentSizeFieldSize, ciphertext_source.get());
+  if (!prefix_result.ok()) {
+    if (prefix_result.status().error_code() == util::error::OUT_OF_RANGE) {
+      return util::Status(util::error::INVALID_ARGUMENT,
+                          "ciphertext too short");
+    }
+    return prefix_result.status();
+  }
+  auto variant_result = ParseSegmentSize(prefix_result.ValueOrDie());
+  if (!variant_result.ok()) return variant_result.status();
+  return variant_result.ValueOrDie()->streaming->NewDecryptingStream(
+      std::move(ciphertext_source), associated_data);
+}
+
+util::StatusOr<std::unique_ptr<RandomAccessStream>>
+AesGcmHkdfAdaptiveStreaming::NewDecryptingRandomAccessStream(
+    std::unique_ptr<RandomAccessStream> ciphertext_source,
+    absl::string_view associated_data) {
+  if (ciphertext_source == nullptr) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "ciphertext_source must be non-null");
+  }
+  auto prefix_result = ReadPrefixAt(ciphertext_source.get());
+  if (!prefix_result.ok()) return prefix_result.status();
+  auto variant_result = ParseSegmentSize(prefix_result.ValueOrDie());
+  if (!variant_result.ok()) return variant_result.status();
+  // The ciphertext offset of the variants skips the segment size.
+  return variant_result.ValueOrDie()->streaming
+      ->NewDecryptingRandomAccessStream(std::move(ciphertext_source),
+                                        associated_data);
+}
+
+util::StatusOr<std::string> AesGcmHkdfAdaptiveStreaming::EncryptSmall(
+    absl::string_view plaintext, absl::string_view associated_data) {
+  const Variant* variant = &ChooseVariant(plaintext.size());
+  while (plaintext.size() >
+             static_cast<size_t>(variant->max_small_plaintext_size) &&
+         variant != &variants_.back()) {
+    variant++;
+  }
+  auto encrypt_result =
+      variant->streaming->EncryptSmall(plaintext, associated_data);
+  if (!encrypt_result.ok()) return encrypt_result.status();
+  char prefix[kSegmentSizeFieldSize];
+  absl::big_endian::Store32(prefix, variant->ciphertext_segment_size);
+  return absl::StrCat(absl::string_view(prefix, sizeof(prefix)),
+                      encrypt_result.ValueOrDie());
+}
+
+util::StatusOr<std::string> AesGcmHkdfAdaptiveStreaming::DecryptSmall(
+    absl::string_view ciphertext, absl::string_view associated_data) {
+  if (ciphertext.size() < kSegmentSizeFieldSize) {
+    return util::Status(util::error::INVALID_ARGUMENT, "ciphertext too short");
+  }
+  auto variant_result =
+      ParseSegmentSize(ciphertext.substr(0, kSegmentSizeFieldSize));
+  if (!variant_result.ok()) return variant_result.status();
+  return variant_result.ValueOrDie()->streaming->DecryptSmall(
+      ciphertext.substr(kSegmentSizeFieldSize), associated_data);
+}
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
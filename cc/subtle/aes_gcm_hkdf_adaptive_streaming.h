@@ -0,0 +1,153 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_SUBTLE_AES_GCM_HKDF_ADAPTIVE_STREAMING_H_
+#define TINK_SUBTLE_AES_GCM_HKDF_ADAPTIVE_STREAMING_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "tink/config/tink_fips.h"
+#include "tink/input_stream.h"
+#include "tink/output_stream.h"
+#include "tink/random_access_stream.h"
+#include "tink/streaming_aead.h"
+#include "tink/subtle/aes_gcm_hkdf_streaming.h"
+#include "tink/subtle/common_enums.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+// Streaming AEAD like AesGcmHkdfStreaming, where the encrypter chooses the
+// ciphertext segment size of every stream from a fixed set: small segments
+// for small plaintexts, which allows fine-grained random access, and large
+// segments for large plaintexts, which have less overhead.
+//
+// A ciphertext stream is
+//   segment_size || AesGcmHkdfStreaming ciphertext
+// where segment_size is the ciphertext segment size of the stream, as
+// a 4-byte big-endian integer, and the AesGcmHkdfStreaming ciphertext uses
+// that segment size and a ciphertext offset of 4. Decryption reads the
+// segment size from the stream, and rejects sizes which are not in the set.
+// Every segment size uses its own input key material, derived from 'ikm'
+// with HKDF, so that changing the segment size of a stream makes its
+// decryption fail.
+class AesGcmHkdfAdaptiveStreaming : public StreamingAead {
+ public:
+  struct Params {
+    util::SecretData ikm;
+    HashType hkdf_hash;
+    int derived_key_size;
+    // The ciphertext segment sizes to choose from, in increasing order.
+    std::vector<int> ciphertext_segment_sizes;
+  };
+
+  // The size of the segment size at the start of a ciphertext stream.
+  static constexpr int kSegmentSizeFieldSize = 4;
+  // A stream uses the largest segment size which still yields this many
+  // segments for its plaintext.
+  static constexpr int kMinSegmentsPerStream = 16;
+
+  static util::StatusOr<std::unique_ptr<AesGcmHkdfAdaptiveStreaming>> New(
+      Params params);
+
+  // Returns the ciphertext segment size of a stream with a plaintext of
+  // 'plaintext_size' bytes. If 'plaintext_size' is negative, i.e. unknown,
+  // returns the largest segment size.
+  int GetCiphertextSegmentSize(int64_t plaintext_size) const;
+
+  // Encrypts with the largest segment size. If the size of the plaintext is
+  // known, use the overload with a size hint instead.
+  crypto::tink::util::StatusOr<std::unique_ptr<crypto::tink::OutputStream>>
+  NewEncryptingStream(
+      std::unique_ptr<crypto::tink::OutputStream> ciphertext_destination,
+      absl::string_view associated_data) override;
+
+  // Encrypts with the segment size for a plaintext of about 'size_hint'
+  // bytes. The plaintext may be shorter or longer than the hint.
+  crypto::tink::util::StatusOr<std::unique_ptr<crypto::tink::OutputStream>>
+  NewEncryptingStream(
+      std::unique_ptr<crypto::tink::OutputStream> ciphertext_destination,
+      absl::string_view associated_data, int64_t size_hint);
+
+  // Reads the segment size from 'ciphertext_source' before returning.
+  crypto::tink::util::StatusOr<std::unique_ptr<crypto::tink::InputStream>>
+  NewDecryptingStream(
+      std::unique_ptr<crypto::tink::InputStream> ciphertext_source,
+      absl::string_view associated_data) override;
+
+  // Reads the segment size from 'ciphertext_source' before returning.
+  crypto::tink::util::StatusOr<
+      std::unique_ptr<crypto::tink::RandomAccessStream>>
+  NewDecryptingRandomAccessStream(
+      std::unique_ptr<crypto::tink::RandomAccessStream> ciphertext_source,
+      absl::string_view associated_data) override;
+
+  // Uses the segment size of GetCiphertextSegmentSize(), or if the plaintext
+  // does not fit a single segment of that size, the smallest segment size
+  // which it fits.
+  crypto::tink::util::StatusOr<std::string> EncryptSmall(
+      absl::string_view plaintext, absl::string_view associated_data) override;
+
+  crypto::tink::util::StatusOr<std::string> DecryptSmall(
+      absl::string_view ciphertext, absl::string_view associated_data) override;
+
+  static constexpr crypto::tink::FipsCompatibility kFipsStatus =
+      crypto::tink::FipsCompatibility::kNotFips;
+
+ private:
+  struct Variant {
+    int ciphertext_segment_size;
+    // The largest plaintext which fits the first segment of a stream.
+    int max_small_plaintext_size;
+    std::unique_ptr<AesGcmHkdfStreaming> streaming;
+  };
+
+  explicit AesGcmHkdfAdaptiveStreaming(std::vector<Variant> variants)
+      : variants_(std::move(variants)) {}
+
+  // Returns the variant for a plaintext of 'plaintext_size' bytes, see
+  // GetCiphertextSegmentSize().
+  const Variant& ChooseVariant(int64_t plaintext_size) const;
+
+  // Returns the variant of the ciphertext stream starting with 'prefix' of
+  // kSegmentSizeFieldSize bytes.
+  crypto::tink::util::StatusOr<const Variant*> ParseSegmentSize(
+      absl::string_view prefix) const;
+
+  util::StatusOr<std::unique_ptr<crypto::tink::OutputStream>>
+  NewEncryptingStreamForVariant(
+      const Variant& variant,
+      std::unique_ptr<crypto::tink::OutputStream> ciphertext_destination,
+      absl::string_view associated_data);
+
+  // In increasing order of the segment size.
+  const std::vector<Variant> variants_;
+};
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_SUBTLE_AES_GCM_HKDF_ADAPTIVE_STREAMING_H_
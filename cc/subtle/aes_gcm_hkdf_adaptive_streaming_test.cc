@@ -0,0 +1,230 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/subtle/aes_gcm_hkdf_adaptive_streaming.h"
+
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "absl/base/internal/endian.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "tink/output_stream.h"
+#include "tink/subtle/common_enums.h"
+#include "tink/subtle/random.h"
+#include "tink/subtle/streaming_aead_test_util.h"
+#include "tink/subtle/test_util.h"
+#include "tink/util/istream_input_stream.h"
+#include "tink/util/ostream_output_stream.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "tink/util/test_matchers.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+namespace {
+
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+
+std::unique_ptr<AesGcmHkdfAdaptiveStreaming> NewStreaming(
+    const util::SecretData& ikm, std::vector<int> segment_sizes) {
+  AesGcmHkdfAdaptiveStreaming::Params params;
+  params.ikm = ikm;
+  params.hkdf_hash = SHA256;
+  params.derived_key_size = 16;
+  params.ciphertext_segment_sizes = std::move(segment_sizes);
+  auto result = AesGcmHkdfAdaptiveStreaming::New(std::move(params));
+  EXPECT_THAT(result.status(), IsOk());
+  return std::move(result.ValueOrDie());
+}
+
+// Encrypts 'plaintext' with a stream for 'size_hint', and returns the
+// ciphertext.
+std::string EncryptWithSizeHint(AesGcmHkdfAdaptiveStreaming* streaming,
+                                absl::string_view plaintext,
+                                absl::string_view associated_data,
+                                int64_t size_hint) {
+  auto ct_stream = absl::make_unique<std::stringstream>();
+  std::stringbuf* ct_buf = ct_stream->rdbuf();
+  auto enc_stream_result = streaming->NewEncryptingStream(
+      absl::make_unique<util::OstreamOutputStream>(std::move(ct_stream)),
+      associated_data, size_hint);
+  EXPECT_THAT(enc_stream_result.status(), IsOk());
+  EXPECT_THAT(
+      test::WriteToStream(enc_stream_result.ValueOrDie().get(), plaintext),
+      IsOk());
+  return ct_buf->str();
+}
+
+std::string Decrypt(AesGcmHkdfAdaptiveStreaming* streaming,
+                    absl::string_view ciphertext,
+                    absl::string_view associated_data) {
+  auto dec_stream_result = streaming->NewDecryptingStream(
+      absl::make_unique<util::IstreamInputStream>(
+          absl::make_unique<std::stringstream>(std::string(ciphertext))),
+      associated_data);
+  EXPECT_THAT(dec_stream_result.status(), IsOk());
+  std::string decrypted;
+  EXPECT_THAT(
+      test::ReadFromStream(dec_stream_result.ValueOrDie().get(), &decrypted),
+      IsOk());
+  return decrypted;
+}
+
+int SegmentSizeOf(absl::string_view ciphertext) {
+  return absl::big_endian::Load32(ciphertext.data());
+}
+
+TEST(AesGcmHkdfAdaptiveStreamingTest, EncryptThenDecrypt) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  auto streaming = NewStreaming(Random::GetRandomKeyBytes(32), {128, 1024});
+  for (int pt_size : {0, 16, 100, 1000, 10000}) {
+    SCOPED_TRACE(absl::StrCat("pt_size = ", pt_size));
+    std::string pt = Random::GetRandomBytes(pt_size);
+    // Also decrypts with NewDecryptingRandomAccessStream().
+    EXPECT_THAT(EncryptThenDecrypt(streaming.get(), streaming.get(), pt,
+                                   "some associated data",
+                                   /* ciphertext_offset = */ 0),
+                IsOk());
+  }
+}
+
+TEST(AesGcmHkdfAdaptiveStreamingTest, ChoosesSegmentSize) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  auto streaming =
+      NewStreaming(Random::GetRandomKeyBytes(32), {128, 1024, 8192});
+  EXPECT_EQ(128, streaming->GetCiphertextSegmentSize(0));
+  EXPECT_EQ(128, streaming->GetCiphertextSegmentSize(16 * 1024 - 1));
+  EXPECT_EQ(1024, streaming->GetCiphertextSegmentSize(16 * 1024));
+  EXPECT_EQ(8192, streaming->GetCiphertextSegmentSize(16 * 8192));
+  EXPECT_EQ(8192, streaming->GetCiphertextSegmentSize(1 << 30));
+  EXPECT_EQ(8192, streaming->GetCiphertextSegmentSize(-1));
+
+  std::string associated_data = "some associated data";
+  for (int size_hint : {100, 20000, 200000}) {
+    SCOPED_TRACE(absl::StrCat("size_hint = ", size_hint));
+    std::string pt = Random::GetRandomBytes(size_hint);
+    std::string ct =
+        EncryptWithSizeHint(streaming.get(), pt, associated_data, size_hint);
+    EXPECT_EQ(streaming->GetCiphertextSegmentSize(size_hint),
+              SegmentSizeOf(ct));
+    EXPECT_EQ(pt, Decrypt(streaming.get(), ct, associated_data));
+  }
+}
+
+TEST(AesGcmHkdfAdaptiveStreamingTest, EncryptSmall) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  auto streaming = NewStreaming(Random::GetRandomKeyBytes(32), {128, 1024});
+  std::string associated_data = "some associated data";
+  // The first segment of 128 bytes holds 128 - 4 - 24 - 16 bytes.
+  for (int pt_size : {0, 84, 85, 900}) {
+    SCOPED_TRACE(absl::StrCat("pt_size = ", pt_size));
+    std::string pt = Random::GetRandomBytes(pt_size);
+    auto encrypt_result = streaming->EncryptSmall(pt, associated_data);
+    ASSERT_THAT(encrypt_result.status(), IsOk());
+    std::string ct = encrypt_result.ValueOrDie();
+    EXPECT_EQ(pt_size <= 84 ? 128 : 1024, SegmentSizeOf(ct));
+    EXPECT_EQ(pt, Decrypt(streaming.get(), ct, associated_data));
+    auto decrypt_result = streaming->DecryptSmall(ct, associated_data);
+    ASSERT_THAT(decrypt_result.status(), IsOk());
+    EXPECT_EQ(pt, decrypt_result.ValueOrDie());
+  }
+  EXPECT_THAT(
+      streaming->EncryptSmall(Random::GetRandomBytes(2000), associated_data)
+          .status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(AesGcmHkdfAdaptiveStreamingTest, ModifiedSegmentSize) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  util::SecretData ikm = Random::GetRandomKeyBytes(32);
+  auto streaming = NewStreaming(ikm, {128, 1024});
+  std::string associated_data = "some associated data";
+  std::string pt = Random::GetRandomBytes(50);
+  std::string ct = streaming->EncryptSmall(pt, associated_data).ValueOrDie();
+  ASSERT_EQ(128, SegmentSizeOf(ct));
+
+  // The ciphertext also fits a segment of 1024 bytes, but its key differs.
+  std::string modified_ct = ct;
+  absl::big_endian::Store32(&modified_ct[0], 1024);
+  EXPECT_FALSE(streaming->DecryptSmall(modified_ct, associated_data).ok());
+
+  // Segment sizes not in the set are rejected.
+  absl::big_endian::Store32(&modified_ct[0], 256);
+  EXPECT_THAT(streaming->DecryptSmall(modified_ct, associated_data).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(NewStreaming(ikm, {1024})
+                  ->DecryptSmall(ct, associated_data)
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(streaming->DecryptSmall("abc", associated_data).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(streaming
+                  ->NewDecryptingStream(
+                      absl::make_unique<util::IstreamInputStream>(
+                          absl::make_unique<std::stringstream>("abc")),
+                      associated_data)
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(AesGcmHkdfAdaptiveStreamingTest, InvalidParams) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  for (const std::vector<int>& segment_sizes :
+       std::vector<std::vector<int>>{{}, {1024, 128}, {128, 128}, {40}}) {
+    AesGcmHkdfAdaptiveStreaming::Params params;
+    params.ikm = Random::GetRandomKeyBytes(32);
+    params.hkdf_hash = SHA256;
+    params.derived_key_size = 16;
+    params.ciphertext_segment_sizes = segment_sizes;
+    EXPECT_THAT(AesGcmHkdfAdaptiveStreaming::New(std::move(params)).status(),
+                StatusIs(util::error::INVALID_ARGUMENT));
+  }
+}
+
+TEST(AesGcmHkdfAdaptiveStreamingTest, TestFipsOnly) {
+  if (!kUseOnlyFips) {
+    GTEST_SKIP() << "Only supported in FIPS-only mode";
+  }
+  AesGcmHkdfAdaptiveStreaming::Params params;
+  params.ikm = Random::GetRandomKeyBytes(32);
+  params.hkdf_hash = SHA256;
+  params.derived_key_size = 16;
+  params.ciphertext_segment_sizes = {128, 1024};
+  EXPECT_THAT(AesGcmHkdfAdaptiveStreaming::New(std::move(params)).status(),
+              StatusIs(util::error::INTERNAL));
+}
+
+}  // namespace
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
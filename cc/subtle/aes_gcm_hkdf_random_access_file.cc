@@ -0,0 +1,297 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/subtle/aes_gcm_hkdf_random_access_file.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "openssl/aead.h"
+#include "tink/subtle/common_enums.h"
+#include "tink/subtle/hkdf.h"
+#include "tink/subtle/random.h"
+#include "tink/subtle/subtle_util_boringssl.h"
+#include "tink/util/errors.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+namespace {
+
+constexpr int kSegmentNumberSizeInBytes = 8;
+
+util::Status Validate(const AesGcmHkdfRandomAccessFile::Params& params) {
+  if (!(params.hkdf_hash == SHA1 || params.hkdf_hash == SHA256 ||
+        params.hkdf_hash == SHA512)) {
+    return util::Status(util::error::INVALID_ARGUMENT, "unsupported hkdf_hash");
+  }
+  if (params.ikm.size() < 16 || params.ikm.size() < params.derived_key_size) {
+    return util::Status(util::error::INVALID_ARGUMENT, "ikm too small");
+  }
+  if (params.derived_key_size != 16 && params.derived_key_size != 32) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "derived_key_size must be 16 or 32");
+  }
+  if (params.plaintext_segment_size <= 0 ||
+      params.plaintext_segment_size >
+          std::numeric_limits<int>::max() -
+              AesGcmHkdfRandomAccessFile::kNonceSizeInBytes -
+              AesGcmHkdfRandomAccessFile::kTagSizeInBytes) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "invalid plaintext_segment_size");
+  }
+  return util::OkStatus();
+}
+
+// Attempts to close file descriptor fd, while ignoring EINTR.
+int close_ignoring_eintr(int fd) {
+  int result;
+  do {
+    result = close(fd);
+  } while (result < 0 && errno == EINTR);
+  return result;
+}
+
+// Writes all 'count' bytes at 'data' to 'fd' at 'offset'.
+util::Status PWriteAll(int fd, const uint8_t* data, size_t count,
+                       int64_t offset) {
+  while (count > 0) {
+    ssize_t result = pwrite(fd, data, count, offset);
+    if (result < 0) {
+      if (errno == EINTR) continue;
+      return ToStatusF(util::error::INTERNAL, "I/O error upon pwrite: %d",
+                       errno);
+    }
+    if (result == 0) {
+      return util::Status(util::error::INTERNAL,
+                          "I/O error: pwrite made no progress");
+    }
+    data += result;
+    count -= result;
+    offset += result;
+  }
+  return util::OkStatus();
+}
+
+// Reads up to 'count' bytes from 'fd' at 'offset' into 'data', and returns
+// the number of bytes read, which is smaller than 'count' only at the end of
+// the file.
+util::StatusOr<size_t> PReadAll(int fd, uint8_t* data, size_t count,
+                                int64_t offset) {
+  size_t total = 0;
+  while (total < count) {
+    ssize_t result = pread(fd, data + total, count - total, offset + total);
+    if (result < 0) {
+      if (errno == EINTR) continue;
+      return ToStatusF(util::error::INTERNAL, "I/O error upon pread: %d",
+                       errno);
+    }
+    if (result == 0) break;  // EOF
+    total += result;
+  }
+  return total;
+}
+
+void BigEndianStore64(uint8_t dst[kSegmentNumberSizeInBytes], uint64_t val) {
+  for (int i = kSegmentNumberSizeInBytes - 1; i >= 0; i--) {
+    dst[i] = static_cast<uint8_t>(val & 0xff);
+    val >>= 8;
+  }
+}
+
+}  // namespace
+
+// static
+util::StatusOr<std::unique_ptr<AesGcmHkdfRandomAccessFile>>
+AesGcmHkdfRandomAccessFile::New(const Params& params,
+                                absl::string_view associated_data,
+                                absl::string_view salt, int file_descriptor) {
+  auto hkdf_result = Hkdf::ComputeHkdf(params.hkdf_hash, params.ikm, salt,
+                                       associated_data,
+                                       params.derived_key_size);
+  if (!hkdf_result.ok()) {
+    close_ignoring_eintr(file_descriptor);
+    return hkdf_result.status();
+  }
+  util::SecretData key = std::move(hkdf_result).ValueOrDie();
+  const EVP_AEAD* aead =
+      SubtleUtilBoringSSL::GetAesGcmAeadForKeySize(key.size());
+  bssl::UniquePtr<EVP_AEAD_CTX> ctx;
+  if (aead != nullptr) {
+    ctx.reset(EVP_AEAD_CTX_new(aead, key.data(), key.size(), kTagSizeInBytes));
+  }
+  if (!ctx) {
+    close_ignoring_eintr(file_descriptor);
+    return util::Status(util::error::INTERNAL,
+                        "could not initialize EVP_AEAD_CTX");
+  }
+  return {absl::WrapUnique(new AesGcmHkdfRandomAccessFile(
+      std::move(ctx), params.plaintext_segment_size, 1 + salt.size(),
+      file_descriptor))};
+}
+
+// static
+util::StatusOr<std::unique_ptr<AesGcmHkdfRandomAccessFile>>
+AesGcmHkdfRandomAccessFile::Create(Params params,
+                                   absl::string_view associated_data,
+                                   int file_descriptor) {
+  auto status = Validate(params);
+  if (!status.ok()) {
+    close_ignoring_eintr(file_descriptor);
+    return status;
+  }
+  std::string salt = Random::GetRandomBytes(params.derived_key_size);
+  std::vector<uint8_t> header(1 + salt.size());
+  header[0] = static_cast<uint8_t>(header.size());
+  std::memcpy(header.data() + 1, salt.data(), salt.size());
+  status = PWriteAll(file_descriptor, header.data(), header.size(), 0);
+  if (!status.ok()) {
+    close_ignoring_eintr(file_descriptor);
+    return status;
+  }
+  return New(params, associated_data, salt, file_descriptor);
+}
+
+// static
+util::StatusOr<std::unique_ptr<AesGcmHkdfRandomAccessFile>>
+AesGcmHkdfRandomAccessFile::Open(Params params,
+                                 absl::string_view associated_data,
+                                 int file_descriptor) {
+  auto status = Validate(params);
+  if (!status.ok()) {
+    close_ignoring_eintr(file_descriptor);
+    return status;
+  }
+  std::vector<uint8_t> header(1 + params.derived_key_size);
+  auto read_result =
+      PReadAll(file_descriptor, header.data(), header.size(), 0);
+  if (!read_result.ok()) {
+    close_ignoring_eintr(file_descriptor);
+    return read_result.status();
+  }
+  if (read_result.ValueOrDie() != header.size() ||
+      header[0] != header.size()) {
+    close_ignoring_eintr(file_descriptor);
+    return util::Status(util::error::INVALID_ARGUMENT, "Invalid header");
+  }
+  absl::string_view salt(reinterpret_cast<const char*>(header.data() + 1),
+                         header.size() - 1);
+  return New(params, associated_data, salt, file_descriptor);
+}
+
+AesGcmHkdfRandomAccessFile::~AesGcmHkdfRandomAccessFile() {
+  close_ignoring_eintr(fd_);
+}
+
+util::Status AesGcmHkdfRandomAccessFile::WriteSegment(
+    int64_t segment_number, absl::string_view plaintext) const {
+  if (segment_number < 0 ||
+      segment_number > (std::numeric_limits<int64_t>::max() - header_size_) /
+                           get_ciphertext_segment_size()) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "invalid segment_number");
+  }
+  if (plaintext.size() != static_cast<size_t>(plaintext_segment_size_)) {
+    return util::Status(
+        util::error::INVALID_ARGUMENT,
+        absl::StrCat("plaintext must have ", plaintext_segment_size_,
+                     " bytes, got ", plaintext.size()));
+  }
+  std::vector<uint8_t> segment(get_ciphertext_segment_size());
+  std::string nonce = Random::GetRandomBytes(kNonceSizeInBytes);
+  std::memcpy(segment.data(), nonce.data(), kNonceSizeInBytes);
+  uint8_t aad[kSegmentNumberSizeInBytes];
+  BigEndianStore64(aad, segment_number);
+  size_t out_len;
+  if (!EVP_AEAD_CTX_seal(
+          ctx_.get(), segment.data() + kNonceSizeInBytes, &out_len,
+          segment.size() - kNonceSizeInBytes, segment.data(),
+          kNonceSizeInBytes, reinterpret_cast<const uint8_t*>(plaintext.data()),
+          plaintext.size(), aad, sizeof(aad))) {
+    return util::Status(util::error::INTERNAL, "Segment encryption failed");
+  }
+  return PWriteAll(fd_, segment.data(), segment.size(),
+                   GetSegmentOffset(segment_number));
+}
+
+util::StatusOr<std::string> AesGcmHkdfRandomAccessFile::ReadSegment(
+    int64_t segment_number) const {
+  if (segment_number < 0 ||
+      segment_number > (std::numeric_limits<int64_t>::max() - header_size_) /
+                           get_ciphertext_segment_size()) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "invalid segment_number");
+  }
+  std::vector<uint8_t> segment(get_ciphertext_segment_size());
+  auto read_result = PReadAll(fd_, segment.data(), segment.size(),
+                              GetSegmentOffset(segment_number));
+  if (!read_result.ok()) return read_result.status();
+  if (read_result.ValueOrDie() == 0) {
+    return util::Status(util::error::OUT_OF_RANGE,
+                        absl::StrCat("segment ", segment_number,
+                                     " is beyond the end of the file"));
+  }
+  if (read_result.ValueOrDie() != segment.size()) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        absl::StrCat("segment ", segment_number,
+                                     " is truncated"));
+  }
+  std::string plaintext(plaintext_segment_size_, '\0');
+  uint8_t aad[kSegmentNumberSizeInBytes];
+  BigEndianStore64(aad, segment_number);
+  size_t out_len;
+  if (!EVP_AEAD_CTX_open(
+          ctx_.get(), reinterpret_cast<uint8_t*>(&plaintext[0]), &out_len,
+          plaintext.size(), segment.data(), kNonceSizeInBytes,
+          segment.data() + kNonceSizeInBytes,
+          segment.size() - kNonceSizeInBytes, aad, sizeof(aad))) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        absl::StrCat("decryption of segment ", segment_number,
+                                     " failed"));
+  }
+  return plaintext;
+}
+
+util::StatusOr<int64_t> AesGcmHkdfRandomAccessFile::GetNumberOfSegments()
+    const {
+  struct stat s;
+  if (fstat(fd_, &s) == -1) {
+    return util::Status(util::error::UNAVAILABLE, "size unavailable");
+  }
+  if (s.st_size <= header_size_) return 0;
+  int64_t ciphertext_size = s.st_size - header_size_;
+  // A truncated last segment is counted, so that reading it fails.
+  return (ciphertext_size + get_ciphertext_segment_size() - 1) /
+         get_ciphertext_segment_size();
+}
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,152 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_SUBTLE_AES_GCM_HKDF_RANDOM_ACCESS_FILE_H_
+#define TINK_SUBTLE_AES_GCM_HKDF_RANDOM_ACCESS_FILE_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/strings/string_view.h"
+#include "openssl/aead.h"
+#include "tink/subtle/common_enums.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+// An encrypted file of fixed-size segments, each of which can be written,
+// rewritten and read independently, e.g. the pages of a page store. Unlike
+// the ciphertexts of AesGcmHkdfStreaming, where a segment can never be
+// rewritten since its nonce is determined by its position, every write of a
+// segment uses a fresh random nonce, stored with the segment.
+//
+// The AES-GCM key of a file is derived with HKDF from the key derivation key,
+// a random salt chosen when the file is created, and the associated data of
+// the file.
+//
+// The format of the file is
+//   header || segment_0 || segment_1 || ... || segment_k
+// where
+//  - header is header_size || salt, where header_size is 1 byte determining
+//    the size of the header,
+//  - segment_i is nonce_i || AES-GCM(plaintext_i, aad = i) || tag_i, of
+//    get_ciphertext_segment_size() bytes at offset GetSegmentOffset(i),
+//    with a 12 byte nonce_i chosen randomly on each write, and the segment
+//    number i as a big-endian 64 bit integer as associated data. This binds
+//    each segment to its position in the file.
+//
+// All segments have get_plaintext_segment_size() bytes of plaintext.
+// Segments can be written in any order; reading a segment that was never
+// written fails.
+//
+// Limitations: an attacker who can modify the file can replace a segment
+// with an earlier version of the same segment, or truncate the file after any
+// segment, without this being detected. Since the nonces are random, a file
+// should see at most 2^32 segment writes in total.
+//
+// The methods of this class are thread-safe: segments are read and written
+// with pread() and pwrite() at their own offsets, so distinct segments can be
+// encrypted and written in parallel from several threads.
+class AesGcmHkdfRandomAccessFile {
+ public:
+  // The size of the random nonces stored with each segment.
+  static constexpr int kNonceSizeInBytes = 12;
+  // The size of the tags of each segment.
+  static constexpr int kTagSizeInBytes = 16;
+
+  struct Params {
+    util::SecretData ikm;
+    HashType hkdf_hash;
+    int derived_key_size;
+    int plaintext_segment_size;
+  };
+
+  // Writes the header of a new file to 'file_descriptor', at offset 0, and
+  // returns the file. Takes the ownership of the file, and will close it upon
+  // destruction, also if an error is returned.
+  static util::StatusOr<std::unique_ptr<AesGcmHkdfRandomAccessFile>> Create(
+      Params params, absl::string_view associated_data, int file_descriptor);
+
+  // Returns the file that was created with Create() in 'file_descriptor', with
+  // the same 'params' and 'associated_data'. Takes the ownership of the file,
+  // and will close it upon destruction, also if an error is returned.
+  static util::StatusOr<std::unique_ptr<AesGcmHkdfRandomAccessFile>> Open(
+      Params params, absl::string_view associated_data, int file_descriptor);
+
+  AesGcmHkdfRandomAccessFile(const AesGcmHkdfRandomAccessFile&) = delete;
+  AesGcmHkdfRandomAccessFile& operator=(const AesGcmHkdfRandomAccessFile&) =
+      delete;
+
+  ~AesGcmHkdfRandomAccessFile();
+
+  // Encrypts 'plaintext', of exactly get_plaintext_segment_size() bytes, and
+  // writes it as the segment 'segment_number', replacing the segment if it
+  // was written before.
+  util::Status WriteSegment(int64_t segment_number,
+                            absl::string_view plaintext) const;
+
+  // Reads and decrypts the segment 'segment_number'. Returns OUT_OF_RANGE if
+  // the segment is beyond the end of the file, and INVALID_ARGUMENT if its
+  // ciphertext cannot be authenticated, e.g. since it was never written.
+  util::StatusOr<std::string> ReadSegment(int64_t segment_number) const;
+
+  // Returns the number of segments in the file, including the segments that
+  // were never written but precede a written segment.
+  util::StatusOr<int64_t> GetNumberOfSegments() const;
+
+  // Returns the offset of the segment 'segment_number' in the file.
+  int64_t GetSegmentOffset(int64_t segment_number) const {
+    return header_size_ + segment_number * get_ciphertext_segment_size();
+  }
+
+  int get_plaintext_segment_size() const { return plaintext_segment_size_; }
+  int get_ciphertext_segment_size() const {
+    return kNonceSizeInBytes + plaintext_segment_size_ + kTagSizeInBytes;
+  }
+  int get_header_size() const { return header_size_; }
+
+ private:
+  AesGcmHkdfRandomAccessFile(bssl::UniquePtr<EVP_AEAD_CTX> ctx,
+                             int plaintext_segment_size, int header_size,
+                             int file_descriptor)
+      : ctx_(std::move(ctx)),
+        plaintext_segment_size_(plaintext_segment_size),
+        header_size_(header_size),
+        fd_(file_descriptor) {}
+
+  // Returns the file with the given salt, and closes 'file_descriptor' if an
+  // error is returned.
+  static util::StatusOr<std::unique_ptr<AesGcmHkdfRandomAccessFile>> New(
+      const Params& params, absl::string_view associated_data,
+      absl::string_view salt, int file_descriptor);
+
+  const bssl::UniquePtr<EVP_AEAD_CTX> ctx_;
+  const int plaintext_segment_size_;
+  const int header_size_;
+  const int fd_;
+};
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_SUBTLE_AES_GCM_HKDF_RANDOM_ACCESS_FILE_H_
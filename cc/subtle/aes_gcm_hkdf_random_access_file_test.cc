@@ -0,0 +1,260 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/subtle/aes_gcm_hkdf_random_access_file.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <limits>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "tink/subtle/common_enums.h"
+#include "tink/subtle/random.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/test_matchers.h"
+#include "tink/util/test_util.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+namespace {
+
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+
+constexpr int kPageSize = 4096;
+
+AesGcmHkdfRandomAccessFile::Params ValidParams() {
+  AesGcmHkdfRandomAccessFile::Params params;
+  params.ikm = Random::GetRandomKeyBytes(32);
+  params.hkdf_hash = SHA256;
+  params.derived_key_size = 32;
+  params.plaintext_segment_size = kPageSize;
+  return params;
+}
+
+// Returns a file descriptor for reading and writing the test file 'filename',
+// which is truncated if 'truncate' is set.
+int OpenTestFile(absl::string_view filename, bool truncate = true) {
+  std::string full_filename = absl::StrCat(test::TmpDir(), "/", filename);
+  int fd = open(full_filename.c_str(),
+                O_RDWR | O_CREAT | (truncate ? O_TRUNC : 0), 0600);
+  EXPECT_NE(fd, -1) << "Cannot open " << full_filename;
+  return fd;
+}
+
+std::unique_ptr<AesGcmHkdfRandomAccessFile> CreateFile(
+    const AesGcmHkdfRandomAccessFile::Params& params,
+    absl::string_view filename) {
+  auto file_result = AesGcmHkdfRandomAccessFile::Create(
+      params, "associated data", OpenTestFile(filename));
+  EXPECT_THAT(file_result.status(), IsOk());
+  return std::move(file_result).ValueOrDie();
+}
+
+TEST(AesGcmHkdfRandomAccessFileTest, WriteAndReadSegments) {
+  for (int derived_key_size : {16, 32}) {
+    for (int plaintext_segment_size : {1, 100, kPageSize}) {
+      SCOPED_TRACE(absl::StrCat("derived_key_size = ", derived_key_size,
+                                ", plaintext_segment_size = ",
+                                plaintext_segment_size));
+      auto params = ValidParams();
+      params.derived_key_size = derived_key_size;
+      params.plaintext_segment_size = plaintext_segment_size;
+      auto file = CreateFile(params, "write_and_read_test.bin");
+      EXPECT_EQ(1 + derived_key_size, file->get_header_size());
+      EXPECT_EQ(plaintext_segment_size + 28,
+                file->get_ciphertext_segment_size());
+      EXPECT_EQ(0, file->GetNumberOfSegments().ValueOrDie());
+
+      // Segments can be written in any order.
+      std::vector<std::string> plaintexts;
+      for (int i = 0; i < 5; i++) {
+        plaintexts.push_back(Random::GetRandomBytes(plaintext_segment_size));
+      }
+      for (int i : {3, 0, 4, 1, 2}) {
+        EXPECT_THAT(file->WriteSegment(i, plaintexts[i]), IsOk());
+      }
+      EXPECT_EQ(5, file->GetNumberOfSegments().ValueOrDie());
+      for (int i = 0; i < 5; i++) {
+        auto read_result = file->ReadSegment(i);
+        ASSERT_THAT(read_result.status(), IsOk());
+        EXPECT_EQ(plaintexts[i], read_result.ValueOrDie());
+      }
+      EXPECT_THAT(file->ReadSegment(5).status(),
+                  StatusIs(util::error::OUT_OF_RANGE));
+    }
+  }
+}
+
+TEST(AesGcmHkdfRandomAccessFileTest, RewriteSegmentUsesFreshNonce) {
+  auto params = ValidParams();
+  std::string filename = "rewrite_test.bin";
+  auto file = CreateFile(params, filename);
+  std::string plaintext = Random::GetRandomBytes(kPageSize);
+  ASSERT_THAT(file->WriteSegment(0, plaintext), IsOk());
+  std::string first_ciphertext = test::ReadTestFile(filename);
+
+  // Rewriting the same plaintext results in a different ciphertext.
+  ASSERT_THAT(file->WriteSegment(0, plaintext), IsOk());
+  std::string second_ciphertext = test::ReadTestFile(filename);
+  EXPECT_EQ(first_ciphertext.size(), second_ciphertext.size());
+  EXPECT_NE(first_ciphertext, second_ciphertext);
+  EXPECT_EQ(plaintext, file->ReadSegment(0).ValueOrDie());
+
+  std::string new_plaintext = Random::GetRandomBytes(kPageSize);
+  ASSERT_THAT(file->WriteSegment(0, new_plaintext), IsOk());
+  EXPECT_EQ(new_plaintext, file->ReadSegment(0).ValueOrDie());
+  EXPECT_EQ(1, file->GetNumberOfSegments().ValueOrDie());
+}
+
+TEST(AesGcmHkdfRandomAccessFileTest, Reopen) {
+  auto params = ValidParams();
+  std::string filename = "reopen_test.bin";
+  std::string plaintext = Random::GetRandomBytes(kPageSize);
+  CreateFile(params, filename)->WriteSegment(2, plaintext).IgnoreError();
+
+  auto file_result = AesGcmHkdfRandomAccessFile::Open(
+      params, "associated data", OpenTestFile(filename, false));
+  ASSERT_THAT(file_result.status(), IsOk());
+  auto file = std::move(file_result).ValueOrDie();
+  EXPECT_EQ(3, file->GetNumberOfSegments().ValueOrDie());
+  EXPECT_EQ(plaintext, file->ReadSegment(2).ValueOrDie());
+  // Segments that were never written cannot be read.
+  EXPECT_THAT(file->ReadSegment(0).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+
+  // Other associated data results in another key.
+  auto other_file_result = AesGcmHkdfRandomAccessFile::Open(
+      params, "other associated data", OpenTestFile(filename, false));
+  ASSERT_THAT(other_file_result.status(), IsOk());
+  EXPECT_THAT(other_file_result.ValueOrDie()->ReadSegment(2).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+
+  // Other key sizes do not match the header.
+  params.derived_key_size = 16;
+  EXPECT_THAT(AesGcmHkdfRandomAccessFile::Open(params, "associated data",
+                                               OpenTestFile(filename, false))
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(AesGcmHkdfRandomAccessFileTest, SegmentsAreBoundToTheirPosition) {
+  auto params = ValidParams();
+  params.plaintext_segment_size = 100;
+  std::string filename = "swap_test.bin";
+  auto file = CreateFile(params, filename);
+  ASSERT_THAT(file->WriteSegment(0, Random::GetRandomBytes(100)), IsOk());
+  ASSERT_THAT(file->WriteSegment(1, Random::GetRandomBytes(100)), IsOk());
+
+  // Swap the two segments in the file.
+  std::string ciphertext = test::ReadTestFile(filename);
+  int header_size = file->get_header_size();
+  int segment_size = file->get_ciphertext_segment_size();
+  std::string swapped = ciphertext.substr(0, header_size) +
+                        ciphertext.substr(header_size + segment_size) +
+                        ciphertext.substr(header_size, segment_size);
+  int fd = OpenTestFile(filename);
+  ASSERT_EQ(swapped.size(), write(fd, swapped.data(), swapped.size()));
+  close(fd);
+
+  EXPECT_THAT(file->ReadSegment(0).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(file->ReadSegment(1).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(AesGcmHkdfRandomAccessFileTest, TruncatedSegment) {
+  auto params = ValidParams();
+  std::string filename = "truncated_test.bin";
+  auto file = CreateFile(params, filename);
+  ASSERT_THAT(file->WriteSegment(0, Random::GetRandomBytes(kPageSize)),
+              IsOk());
+  std::string full_filename = absl::StrCat(test::TmpDir(), "/", filename);
+  ASSERT_EQ(0, truncate(full_filename.c_str(), file->GetSegmentOffset(1) - 1));
+  EXPECT_EQ(1, file->GetNumberOfSegments().ValueOrDie());
+  EXPECT_THAT(file->ReadSegment(0).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(AesGcmHkdfRandomAccessFileTest, InvalidArguments) {
+  auto file = CreateFile(ValidParams(), "invalid_arguments_test.bin");
+  EXPECT_THAT(file->WriteSegment(-1, std::string(kPageSize, 'a')),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(file->WriteSegment(0, std::string(kPageSize - 1, 'a')),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(file->WriteSegment(0, std::string(kPageSize + 1, 'a')),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(file->WriteSegment(std::numeric_limits<int64_t>::max(),
+                                 std::string(kPageSize, 'a')),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(file->ReadSegment(-1).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(AesGcmHkdfRandomAccessFileTest, InvalidParams) {
+  std::vector<AesGcmHkdfRandomAccessFile::Params> invalid_params;
+  for (int i = 0; i < 5; i++) invalid_params.push_back(ValidParams());
+  invalid_params[0].hkdf_hash = UNKNOWN_HASH;
+  invalid_params[1].ikm = Random::GetRandomKeyBytes(15);
+  invalid_params[2].derived_key_size = 24;
+  invalid_params[3].plaintext_segment_size = 0;
+  invalid_params[4].ikm = Random::GetRandomKeyBytes(16);
+  for (size_t i = 0; i < invalid_params.size(); i++) {
+    SCOPED_TRACE(absl::StrCat("invalid_params[", i, "]"));
+    EXPECT_THAT(AesGcmHkdfRandomAccessFile::Create(
+                    invalid_params[i], "aad",
+                    OpenTestFile("invalid_params_test.bin"))
+                    .status(),
+                StatusIs(util::error::INVALID_ARGUMENT));
+  }
+}
+
+TEST(AesGcmHkdfRandomAccessFileTest, ParallelWrites) {
+  auto file = CreateFile(ValidParams(), "parallel_writes_test.bin");
+  constexpr int kThreads = 8;
+  constexpr int kSegmentsPerThread = 16;
+  std::vector<std::string> plaintexts;
+  for (int i = 0; i < kThreads * kSegmentsPerThread; i++) {
+    plaintexts.push_back(Random::GetRandomBytes(kPageSize));
+  }
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; t++) {
+    threads.emplace_back([&file, &plaintexts, t]() {
+      // Thread t writes the segments t, t + kThreads, ...
+      for (size_t i = t; i < plaintexts.size(); i += kThreads) {
+        EXPECT_THAT(file->WriteSegment(i, plaintexts[i]), IsOk());
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  EXPECT_EQ(plaintexts.size(), file->GetNumberOfSegments().ValueOrDie());
+  for (size_t i = 0; i < plaintexts.size(); i++) {
+    EXPECT_EQ(plaintexts[i], file->ReadSegment(i).ValueOrDie());
+  }
+}
+
+}  // namespace
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
@@ -19,6 +19,7 @@
 #include <cstdint>
 #include <cstring>
 #include <limits>
+#include <memory>
 #include <utility>
 
 #include "absl/algorithm/container.h"
@@ -56,6 +57,8 @@ void BigEndianStore32(uint8_t dst[4], uint32_t val) {
 }
 
 util::Status Validate(const AesGcmHkdfStreamSegmentDecrypter::Params& params) {
+  const util::SecretData& ikm =
+      params.shared_ikm != nullptr ? *params.shared_ikm : params.ikm;
   if (!(params.hkdf_hash == SHA1 || params.hkdf_hash == SHA256 ||
         params.hkdf_hash == SHA512)) {
     return util::Status(util::error::INVALID_ARGUMENT, "unsupported hkdf_hash");
@@ -64,7 +67,7 @@ util::Status Validate(const AesGcmHkdfStreamSegmentDecrypter::Params& params) {
     return util::Status(util::error::INVALID_ARGUMENT,
                         "derived_key_size must be 16 or 32");
   }
-  if (params.ikm.size() < 16 || params.ikm.size() < params.derived_key_size) {
+  if (ikm.size() < 16 || ikm.size() < params.derived_key_size) {
     return util::Status(util::error::INVALID_ARGUMENT, "ikm too small");
   }
   if (params.ciphertext_offset < 0) {
@@ -86,7 +89,10 @@ util::Status Validate(const AesGcmHkdfStreamSegmentDecrypter::Params& params) {
 
 AesGcmHkdfStreamSegmentDecrypter::AesGcmHkdfStreamSegmentDecrypter(
     Params params)
-    : ikm_(std::move(params.ikm)),
+    : ikm_(params.shared_ikm != nullptr
+               ? std::move(params.shared_ikm)
+               : std::make_shared<const util::SecretData>(
+                     std::move(params.ikm))),
       hkdf_hash_(params.hkdf_hash),
       derived_key_size_(params.derived_key_size),
       ciphertext_offset_(params.ciphertext_offset),
@@ -131,7 +137,7 @@ util::Status AesGcmHkdfStreamSegmentDecrypter::Init(
 
   // Derive symmetric key.
   auto hkdf_result = Hkdf::ComputeHkdf(
-      hkdf_hash_, ikm_,
+      hkdf_hash_, *ikm_,
       absl::string_view(reinterpret_cast<const char*>(salt_.data()),
                         derived_key_size_),
       associated_data_, derived_key_size_);
@@ -144,10 +150,9 @@ util::Status AesGcmHkdfStreamSegmentDecrypter::Init(
   if (aead == nullptr) {
     return util::Status(util::error::INTERNAL, "invalid key size");
   }
-  ctx_.reset(
-      EVP_AEAD_CTX_new(aead, key.data(), key.size(),
-                       AesGcmHkdfStreamSegmentEncrypter::kTagSizeInBytes));
-  if (!ctx_) {
+  if (!EVP_AEAD_CTX_init(ctx_.get(), aead, key.data(), key.size(),
+                         AesGcmHkdfStreamSegmentEncrypter::kTagSizeInBytes,
+                         /* engine = */ nullptr)) {
     return util::Status(util::error::INTERNAL,
                         "could not initialize EVP_AEAD_CTX");
   }
@@ -165,51 +170,84 @@ util::Status AesGcmHkdfStreamSegmentDecrypter::DecryptSegment(
     int64_t segment_number,
     bool is_last_segment,
     std::vector<uint8_t>* plaintext_buffer) {
+  auto status =
+      CheckSegment(ciphertext.size(), segment_number, is_last_segment);
+  if (!status.ok()) return status;
+  if (plaintext_buffer == nullptr) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "plaintext_buffer must be non-null");
+  }
+  plaintext_buffer->resize(
+      ciphertext.size() - AesGcmHkdfStreamSegmentEncrypter::kTagSizeInBytes);
+  return Open(ciphertext.data(), ciphertext.size(), segment_number,
+              is_last_segment, plaintext_buffer->data());
+}
+
+util::Status AesGcmHkdfStreamSegmentDecrypter::DecryptSegmentInPlace(
+    int64_t segment_number, bool is_last_segment,
+    std::vector<uint8_t>* segment) {
+  if (segment == nullptr) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "segment must be non-null");
+  }
+  auto status = CheckSegment(segment->size(), segment_number, is_last_segment);
+  if (!status.ok()) return status;
+  status = Open(segment->data(), segment->size(), segment_number,
+                is_last_segment, segment->data());
+  if (!status.ok()) return status;
+  segment->resize(segment->size() -
+                  AesGcmHkdfStreamSegmentEncrypter::kTagSizeInBytes);
+  return util::OkStatus();
+}
+
+util::Status AesGcmHkdfStreamSegmentDecrypter::CheckSegment(
+    size_t ciphertext_size, int64_t segment_number,
+    bool is_last_segment) const {
   if (!is_initialized_) {
     return util::Status(util::error::FAILED_PRECONDITION,
                         "decrypter not initialized");
   }
-  if (ciphertext.size() > get_ciphertext_segment_size()) {
+  if (ciphertext_size > get_ciphertext_segment_size()) {
     return util::Status(util::error::INVALID_ARGUMENT, "ciphertext too long");
   }
-  if (ciphertext.size() < AesGcmHkdfStreamSegmentEncrypter::kTagSizeInBytes) {
+  if (ciphertext_size < AesGcmHkdfStreamSegmentEncrypter::kTagSizeInBytes) {
     return util::Status(util::error::INVALID_ARGUMENT, "ciphertext too short");
   }
-  if (plaintext_buffer == nullptr) {
-    return util::Status(util::error::INVALID_ARGUMENT,
-                        "plaintext_buffer must be non-null");
-  }
   if (segment_number > std::numeric_limits<uint32_t>::max() ||
       (segment_number == std::numeric_limits<uint32_t>::max() &&
        !is_last_segment)) {
     return util::Status(util::error::INVALID_ARGUMENT, "too many segments");
   }
+  return util::OkStatus();
+}
 
-  int pt_size =
-      ciphertext.size() - AesGcmHkdfStreamSegmentEncrypter::kTagSizeInBytes;
-  plaintext_buffer->resize(pt_size);
+util::Status AesGcmHkdfStreamSegmentDecrypter::Open(
+    const uint8_t* ciphertext, size_t ciphertext_size, int64_t segment_number,
+    bool is_last_segment, uint8_t* plaintext) const {
+  size_t pt_size =
+      ciphertext_size - AesGcmHkdfStreamSegmentEncrypter::kTagSizeInBytes;
 
   // Construct IV.
-  std::vector<uint8_t> iv(AesGcmHkdfStreamSegmentEncrypter::kNonceSizeInBytes);
-  absl::c_copy(nonce_prefix_, iv.begin());
+  uint8_t iv[AesGcmHkdfStreamSegmentEncrypter::kNonceSizeInBytes];
+  absl::c_copy(nonce_prefix_, iv);
   BigEndianStore32(
-      iv.data() + AesGcmHkdfStreamSegmentEncrypter::kNoncePrefixSizeInBytes,
+      iv + AesGcmHkdfStreamSegmentEncrypter::kNoncePrefixSizeInBytes,
       static_cast<uint32_t>(segment_number));
-  iv.back() = is_last_segment ? 1 : 0;
+  iv[AesGcmHkdfStreamSegmentEncrypter::kNonceSizeInBytes - 1] =
+      is_last_segment ? 1 : 0;
 
-  // Decrypt.
+  // Decrypt. EVP_AEAD_CTX_open() supports decrypting in place.
   size_t out_len;
   if (!EVP_AEAD_CTX_open(
-          ctx_.get(), plaintext_buffer->data(), &out_len,
-          plaintext_buffer->size(),
-          iv.data(), iv.size(),
-          ciphertext.data(), ciphertext.size(),
+          ctx_.get(), plaintext, &out_len, pt_size,
+          iv, sizeof(iv),
+          ciphertext, ciphertext_size,
           /* ad = */ nullptr, /* ad.length() = */ 0)) {
     return util::Status(util::error::INTERNAL,
                         absl::StrCat("Decryption failed: ",
                                      SubtleUtilBoringSSL::GetErrors()));
   }
-  if (out_len != plaintext_buffer->size()) {
+  if (out_len != pt_size) {
     return util::Status(util::error::INTERNAL, "incorrect plaintext size");
   }
   return util::OkStatus();
@@ -62,6 +62,9 @@ class AesGcmHkdfStreamSegmentDecrypter : public StreamSegmentDecrypter {
   // All sizes are in bytes.
   struct Params {
     util::SecretData ikm;
+    // If set, used instead of 'ikm'. Lets the decrypters of one key share
+    // the key derivation key, instead of copying it for every stream.
+    std::shared_ptr<const util::SecretData> shared_ikm;
     HashType hkdf_hash;
     int derived_key_size;
     int ciphertext_offset;
@@ -82,6 +85,10 @@ class AesGcmHkdfStreamSegmentDecrypter : public StreamSegmentDecrypter {
       bool is_last_segment,
       std::vector<uint8_t>* plaintext_buffer) override;
 
+  util::Status DecryptSegmentInPlace(int64_t segment_number,
+                                     bool is_last_segment,
+                                     std::vector<uint8_t>* segment) override;
+
   int get_header_size() const override {
     return header_size_;
   }
@@ -98,9 +105,21 @@ class AesGcmHkdfStreamSegmentDecrypter : public StreamSegmentDecrypter {
  private:
   explicit AesGcmHkdfStreamSegmentDecrypter(Params params);
 
+  // Returns an error if a ciphertext of 'ciphertext_size' bytes cannot be
+  // decrypted as the specified segment.
+  util::Status CheckSegment(size_t ciphertext_size, int64_t segment_number,
+                            bool is_last_segment) const;
+
+  // Decrypts 'ciphertext_size' bytes at 'ciphertext' as the specified segment,
+  // and writes the plaintext of ciphertext_size - kTagSizeInBytes bytes
+  // to 'plaintext', which may be equal to 'ciphertext'.
+  util::Status Open(const uint8_t* ciphertext, size_t ciphertext_size,
+                    int64_t segment_number, bool is_last_segment,
+                    uint8_t* plaintext) const;
+
   // Parameters set upon decrypter creation.
   // All sizes are in bytes.
-  const util::SecretData ikm_;
+  const std::shared_ptr<const util::SecretData> ikm_;
   const HashType hkdf_hash_;
   const int derived_key_size_;
   const int ciphertext_offset_;
@@ -112,7 +131,9 @@ class AesGcmHkdfStreamSegmentDecrypter : public StreamSegmentDecrypter {
   bool is_initialized_ = false;
   std::vector<uint8_t> salt_;
   std::vector<uint8_t> nonce_prefix_;
-  bssl::UniquePtr<EVP_AEAD_CTX> ctx_;
+  // Allocated with the decrypter, since decrypters for short streams are
+  // created at a high rate.
+  bssl::ScopedEVP_AEAD_CTX ctx_;
 };
 
 }  // namespace subtle
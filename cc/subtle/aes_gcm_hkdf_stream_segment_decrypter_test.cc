@@ -146,6 +146,60 @@ TEST(AesGcmHkdfStreamSegmentDecrypterTest, testBasic) {
 }
 
 
+TEST(AesGcmHkdfStreamSegmentDecrypterTest, testDecryptSegmentInPlace) {
+  AesGcmHkdfStreamSegmentDecrypter::Params params;
+  params.ikm = Random::GetRandomKeyBytes(16);
+  params.hkdf_hash = SHA256;
+  params.derived_key_size = 16;
+  params.ciphertext_offset = 0;
+  params.ciphertext_segment_size = 128;
+  params.associated_data = "associated data";
+  auto result = AesGcmHkdfStreamSegmentDecrypter::New(params);
+  ASSERT_TRUE(result.ok()) << result.status();
+  auto dec = std::move(result.ValueOrDie());
+  std::vector<uint8_t> segment;
+  auto status = dec->DecryptSegmentInPlace(0, false, &segment);
+  EXPECT_EQ(util::error::FAILED_PRECONDITION, status.error_code());
+
+  auto enc = std::move(
+      GetEncrypter(params.ikm, params.hkdf_hash, params.derived_key_size,
+                   params.ciphertext_offset, params.ciphertext_segment_size,
+                   params.associated_data).ValueOrDie());
+  status = dec->Init(enc->get_header());
+  EXPECT_TRUE(status.ok()) << status;
+  for (int pt_size : {0, 1, 50, dec->get_plaintext_segment_size()}) {
+    for (bool is_last_segment : {false, true}) {
+      SCOPED_TRACE(absl::StrCat("plaintext_size = ", pt_size,
+                                ", is_last_segment = ", is_last_segment));
+      std::vector<uint8_t> pt(pt_size, 'p');
+      std::vector<uint8_t> ct;
+      status = enc->EncryptSegmentAt(pt, 3, is_last_segment, &ct);
+      EXPECT_TRUE(status.ok()) << status;
+      segment = ct;
+      status = dec->DecryptSegmentInPlace(3, is_last_segment, &segment);
+      EXPECT_TRUE(status.ok()) << status;
+      EXPECT_EQ(pt, segment);
+
+      // A wrong segment number or last segment flag is detected.
+      segment = ct;
+      status = dec->DecryptSegmentInPlace(4, is_last_segment, &segment);
+      EXPECT_FALSE(status.ok());
+      segment = ct;
+      status = dec->DecryptSegmentInPlace(3, !is_last_segment, &segment);
+      EXPECT_FALSE(status.ok());
+    }
+  }
+
+  // Try decryption with wrong params.
+  segment.assign(dec->get_ciphertext_segment_size() + 1, 'c');
+  status = dec->DecryptSegmentInPlace(0, true, &segment);
+  EXPECT_PRED_FORMAT2(testing::IsSubstring, "ciphertext too long",
+                      status.error_message());
+  status = dec->DecryptSegmentInPlace(0, true, nullptr);
+  EXPECT_PRED_FORMAT2(testing::IsSubstring, "must be non-null",
+                      status.error_message());
+}
+
 TEST(AesGcmHkdfStreamSegmentDecrypterTest, testWrongDerivedKeySize) {
   for (int derived_key_size : {12, 24, 64}) {
     for (HashType hkdf_hash : {SHA1, SHA256, SHA512}) {
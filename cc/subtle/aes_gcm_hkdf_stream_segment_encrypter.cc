@@ -60,6 +60,12 @@ util::Status Validate(const AesGcmHkdfStreamSegmentEncrypter::Params& params) {
     return util::Status(util::error::INVALID_ARGUMENT,
                         "salt must have same size as the key");
   }
+  if (!params.nonce_prefix.empty() &&
+      params.nonce_prefix.size() !=
+          AesGcmHkdfStreamSegmentEncrypter::kNoncePrefixSizeInBytes) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "nonce_prefix has wrong size");
+  }
   if (params.ciphertext_offset < 0) {
     return util::Status(util::error::INVALID_ARGUMENT,
                         "ciphertext_offset must be non-negative");
@@ -75,21 +81,19 @@ util::Status Validate(const AesGcmHkdfStreamSegmentEncrypter::Params& params) {
   return util::OkStatus();
 }
 
-util::StatusOr<bssl::UniquePtr<EVP_AEAD_CTX>> CreateAeadCtx(
-    const util::SecretData& key) {
+util::Status InitAeadCtx(const util::SecretData& key, EVP_AEAD_CTX* ctx) {
   const EVP_AEAD* aead =
       SubtleUtilBoringSSL::GetAesGcmAeadForKeySize(key.size());
   if (aead == nullptr) {
     return util::Status(util::error::INVALID_ARGUMENT, "invalid key size");
   }
-  bssl::UniquePtr<EVP_AEAD_CTX> ctx(
-      EVP_AEAD_CTX_new(aead, key.data(), key.size(),
-                       AesGcmHkdfStreamSegmentEncrypter::kTagSizeInBytes));
-  if (!ctx) {
+  if (!EVP_AEAD_CTX_init(ctx, aead, key.data(), key.size(),
+                         AesGcmHkdfStreamSegmentEncrypter::kTagSizeInBytes,
+                         /* engine = */ nullptr)) {
     return util::Status(util::error::INTERNAL,
                         "could not initialize EVP_AEAD_CTX");
   }
-  return ctx;
+  return util::OkStatus();
 }
 
 std::vector<uint8_t> CreateHeader(absl::string_view salt,
@@ -111,9 +115,10 @@ int AesGcmHkdfStreamSegmentEncrypter::get_plaintext_segment_size() const {
 }
 
 AesGcmHkdfStreamSegmentEncrypter::AesGcmHkdfStreamSegmentEncrypter(
-    bssl::UniquePtr<EVP_AEAD_CTX> ctx, const Params& params)
-    : ctx_(std::move(ctx)),
-      nonce_prefix_(Random::GetRandomBytes(kNoncePrefixSizeInBytes)),
+    const Params& params)
+    : nonce_prefix_(params.nonce_prefix.empty()
+                        ? Random::GetRandomBytes(kNoncePrefixSizeInBytes)
+                        : params.nonce_prefix),
       header_(CreateHeader(params.salt, nonce_prefix_)),
       ciphertext_segment_size_(params.ciphertext_segment_size),
       ciphertext_offset_(params.ciphertext_offset) {}
@@ -123,51 +128,88 @@ util::StatusOr<std::unique_ptr<StreamSegmentEncrypter>>
 AesGcmHkdfStreamSegmentEncrypter::New(Params params) {
   auto status = Validate(params);
   if (!status.ok()) return status;
-  auto ctx_or = CreateAeadCtx(params.key);
-  if (!ctx_or.ok()) return ctx_or.status();
-  auto ctx = std::move(ctx_or).ValueOrDie();
-  return {absl::WrapUnique(
-      new AesGcmHkdfStreamSegmentEncrypter(std::move(ctx), params))};
+  auto encrypter =
+      absl::WrapUnique(new AesGcmHkdfStreamSegmentEncrypter(params));
+  status = InitAeadCtx(params.key, encrypter->ctx_.get());
+  if (!status.ok()) return status;
+  return {std::move(encrypter)};
 }
 
 util::Status AesGcmHkdfStreamSegmentEncrypter::EncryptSegment(
-    const std::vector<uint8_t>& plaintext,
-    bool is_last_segment,
+    const std::vector<uint8_t>& plaintext, bool is_last_segment,
     std::vector<uint8_t>* ciphertext_buffer) {
-  if (plaintext.size() > get_plaintext_segment_size()) {
-    return util::Status(util::error::INVALID_ARGUMENT, "plaintext too long");
-  }
+  auto status = EncryptSegmentAt(plaintext, get_segment_number(),
+                                 is_last_segment, ciphertext_buffer);
+  if (!status.ok()) return status;
+  IncSegmentNumber();
+  return util::OkStatus();
+}
+
+util::Status AesGcmHkdfStreamSegmentEncrypter::EncryptSegmentAt(
+    const std::vector<uint8_t>& plaintext, int64_t segment_number,
+    bool is_last_segment, std::vector<uint8_t>* ciphertext_buffer) const {
+  auto status =
+      CheckSegment(plaintext.size(), segment_number, is_last_segment);
+  if (!status.ok()) return status;
   if (ciphertext_buffer == nullptr) {
     return util::Status(util::error::INVALID_ARGUMENT,
                         "ciphertext_buffer must be non-null");
   }
-  if (get_segment_number() > std::numeric_limits<uint32_t>::max() ||
-      (get_segment_number() == std::numeric_limits<uint32_t>::max() &&
+  ciphertext_buffer->resize(plaintext.size() + kTagSizeInBytes);
+  return Seal(plaintext.data(), plaintext.size(), segment_number,
+              is_last_segment, ciphertext_buffer->data());
+}
+
+util::Status AesGcmHkdfStreamSegmentEncrypter::EncryptSegmentInPlace(
+    int64_t segment_number, bool is_last_segment,
+    std::vector<uint8_t>* segment) const {
+  if (segment == nullptr) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "segment must be non-null");
+  }
+  size_t pt_size = segment->size();
+  auto status = CheckSegment(pt_size, segment_number, is_last_segment);
+  if (!status.ok()) return status;
+  segment->resize(pt_size + kTagSizeInBytes);
+  return Seal(segment->data(), pt_size, segment_number, is_last_segment,
+              segment->data());
+}
+
+util::Status AesGcmHkdfStreamSegmentEncrypter::CheckSegment(
+    size_t plaintext_size, int64_t segment_number,
+    bool is_last_segment) const {
+  if (plaintext_size > get_plaintext_segment_size()) {
+    return util::Status(util::error::INVALID_ARGUMENT, "plaintext too long");
+  }
+  if (segment_number > std::numeric_limits<uint32_t>::max() ||
+      (segment_number == std::numeric_limits<uint32_t>::max() &&
        !is_last_segment)) {
     return util::Status(util::error::INVALID_ARGUMENT, "too many segments");
   }
+  return util::OkStatus();
+}
 
-  int ct_size = plaintext.size() + kTagSizeInBytes;
-  ciphertext_buffer->resize(ct_size);
-
+util::Status AesGcmHkdfStreamSegmentEncrypter::Seal(
+    const uint8_t* plaintext, size_t plaintext_size, int64_t segment_number,
+    bool is_last_segment, uint8_t* ciphertext) const {
   // Construct IV.
-  std::vector<uint8_t> iv(kNonceSizeInBytes);
-  memcpy(iv.data(), nonce_prefix_.data(), kNoncePrefixSizeInBytes);
-  BigEndianStore32(iv.data() + kNoncePrefixSizeInBytes,
-                   static_cast<uint32_t>(get_segment_number()));
-  iv.back() = is_last_segment ? 1 : 0;
+  uint8_t iv[kNonceSizeInBytes];
+  memcpy(iv, nonce_prefix_.data(), kNoncePrefixSizeInBytes);
+  BigEndianStore32(iv + kNoncePrefixSizeInBytes,
+                   static_cast<uint32_t>(segment_number));
+  iv[kNonceSizeInBytes - 1] = is_last_segment ? 1 : 0;
   size_t out_len;
+  // EVP_AEAD_CTX_seal() supports encrypting in place.
   if (!EVP_AEAD_CTX_seal(
-          ctx_.get(), ciphertext_buffer->data(), &out_len,
-          ciphertext_buffer->size(),
-          iv.data(), iv.size(),
-          plaintext.data(), plaintext.size(),
+          ctx_.get(), ciphertext, &out_len,
+          plaintext_size + kTagSizeInBytes,
+          iv, kNonceSizeInBytes,
+          plaintext, plaintext_size,
           /* ad = */ nullptr, /* ad.length() = */ 0)) {
     return util::Status(util::error::INTERNAL,
                         absl::StrCat("Encryption failed: ",
                                      SubtleUtilBoringSSL::GetErrors()));
   }
-  IncSegmentNumber();
   return util::OkStatus();
 }
 
@@ -76,6 +76,11 @@ class AesGcmHkdfStreamSegmentEncrypter : public StreamSegmentEncrypter {
     std::string salt;
     int ciphertext_offset;
     int ciphertext_segment_size;
+    // The nonce prefix of the stream, which is chosen randomly if empty.
+    // Set only to resume an interrupted encryption, with the nonce prefix
+    // from the header of the earlier encrypter; must then have
+    // kNoncePrefixSizeInBytes bytes.
+    std::string nonce_prefix;
   };
 
   // A factory.
@@ -88,6 +93,15 @@ class AesGcmHkdfStreamSegmentEncrypter : public StreamSegmentEncrypter {
       bool is_last_segment,
       std::vector<uint8_t>* ciphertext_buffer) override;
 
+  util::Status EncryptSegmentAt(
+      const std::vector<uint8_t>& plaintext, int64_t segment_number,
+      bool is_last_segment,
+      std::vector<uint8_t>* ciphertext_buffer) const override;
+
+  util::Status EncryptSegmentInPlace(
+      int64_t segment_number, bool is_last_segment,
+      std::vector<uint8_t>* segment) const override;
+
   const std::vector<uint8_t>& get_header() const override {
     return header_;
   }
@@ -108,10 +122,23 @@ class AesGcmHkdfStreamSegmentEncrypter : public StreamSegmentEncrypter {
   }
 
  private:
-  AesGcmHkdfStreamSegmentEncrypter(bssl::UniquePtr<EVP_AEAD_CTX> ctx,
-                                   const Params& params);
-
-  bssl::UniquePtr<EVP_AEAD_CTX> ctx_;
+  explicit AesGcmHkdfStreamSegmentEncrypter(const Params& params);
+
+  // Returns an error if a plaintext of 'plaintext_size' bytes cannot be
+  // encrypted as the specified segment.
+  util::Status CheckSegment(size_t plaintext_size, int64_t segment_number,
+                            bool is_last_segment) const;
+
+  // Encrypts 'plaintext_size' bytes at 'plaintext' as the specified segment,
+  // and writes the ciphertext of plaintext_size + kTagSizeInBytes bytes
+  // to 'ciphertext', which may be equal to 'plaintext'.
+  util::Status Seal(const uint8_t* plaintext, size_t plaintext_size,
+                    int64_t segment_number, bool is_last_segment,
+                    uint8_t* ciphertext) const;
+
+  // Allocated with the encrypter, since encrypters for short streams are
+  // created at a high rate.
+  bssl::ScopedEVP_AEAD_CTX ctx_;
   const std::string nonce_prefix_;
   const std::vector<uint8_t> header_;
   const int ciphertext_segment_size_;
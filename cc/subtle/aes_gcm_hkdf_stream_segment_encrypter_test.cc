@@ -96,6 +96,72 @@ TEST(AesGcmHkdfStreamSegmentEncrypterTest, testBasic) {
   }
 }
 
+TEST(AesGcmHkdfStreamSegmentEncrypterTest, testEncryptSegmentAt) {
+  AesGcmHkdfStreamSegmentEncrypter::Params params;
+  params.key = Random::GetRandomKeyBytes(16);
+  params.salt = Random::GetRandomBytes(16);
+  params.ciphertext_offset = 0;
+  params.ciphertext_segment_size = 128;
+  auto result = AesGcmHkdfStreamSegmentEncrypter::New(params);
+  ASSERT_TRUE(result.ok()) << result.status();
+  auto enc = std::move(result.ValueOrDie());
+
+  for (int segment_number = 0; segment_number < 3; segment_number++) {
+    bool is_last_segment = segment_number == 2;
+    std::vector<uint8_t> pt(50, 'p' + segment_number);
+    // EncryptSegmentAt() does not change the segment number.
+    std::vector<uint8_t> ct_at;
+    auto status =
+        enc->EncryptSegmentAt(pt, segment_number, is_last_segment, &ct_at);
+    EXPECT_TRUE(status.ok()) << status;
+    EXPECT_EQ(segment_number, enc->get_segment_number());
+
+    // The output is identical to the one of EncryptSegment().
+    std::vector<uint8_t> ct;
+    status = enc->EncryptSegment(pt, is_last_segment, &ct);
+    EXPECT_TRUE(status.ok()) << status;
+    EXPECT_EQ(ct, ct_at);
+  }
+}
+
+TEST(AesGcmHkdfStreamSegmentEncrypterTest, testEncryptSegmentInPlace) {
+  AesGcmHkdfStreamSegmentEncrypter::Params params;
+  params.key = Random::GetRandomKeyBytes(16);
+  params.salt = Random::GetRandomBytes(16);
+  params.ciphertext_offset = 0;
+  params.ciphertext_segment_size = 128;
+  auto result = AesGcmHkdfStreamSegmentEncrypter::New(params);
+  ASSERT_TRUE(result.ok()) << result.status();
+  auto enc = std::move(result.ValueOrDie());
+
+  for (int pt_size : {0, 1, 50, enc->get_plaintext_segment_size()}) {
+    for (bool is_last_segment : {false, true}) {
+      SCOPED_TRACE(absl::StrCat("plaintext_size = ", pt_size,
+                                ", is_last_segment = ", is_last_segment));
+      std::vector<uint8_t> pt(pt_size, 'p');
+      std::vector<uint8_t> ct;
+      auto status = enc->EncryptSegmentAt(pt, 7, is_last_segment, &ct);
+      EXPECT_TRUE(status.ok()) << status;
+
+      // The output is identical to the one of EncryptSegmentAt().
+      std::vector<uint8_t> segment = pt;
+      status = enc->EncryptSegmentInPlace(7, is_last_segment, &segment);
+      EXPECT_TRUE(status.ok()) << status;
+      EXPECT_EQ(ct, segment);
+      EXPECT_EQ(0, enc->get_segment_number());
+    }
+  }
+
+  // Try encryption with wrong params.
+  std::vector<uint8_t> segment(enc->get_plaintext_segment_size() + 1, 'p');
+  auto status = enc->EncryptSegmentInPlace(0, true, &segment);
+  EXPECT_FALSE(status.ok());
+  EXPECT_THAT(status.error_message(), HasSubstr("plaintext too long"));
+  status = enc->EncryptSegmentInPlace(0, true, nullptr);
+  EXPECT_FALSE(status.ok());
+  EXPECT_THAT(status.error_message(), HasSubstr("must be non-null"));
+}
+
 TEST(AesGcmHkdfStreamSegmentEncrypterTest, testWrongKeySize) {
   for (int key_size : {12, 24, 64}) {
     for (int ciphertext_offset : {0, 5, 10}) {
@@ -72,8 +72,35 @@ util::StatusOr<std::unique_ptr<StreamSegmentEncrypter>>
 AesGcmHkdfStreaming::NewSegmentEncrypter(
     absl::string_view associated_data) const {
   AesGcmHkdfStreamSegmentEncrypter::Params params;
-  params.salt = Random::GetRandomBytes(derived_key_size_);
-  auto hkdf_result = Hkdf::ComputeHkdf(hkdf_hash_, ikm_, params.salt,
+  // The salt and the nonce prefix, with a single call to the RNG.
+  std::string random_bytes = Random::GetRandomBytes(
+      derived_key_size_ +
+      AesGcmHkdfStreamSegmentEncrypter::kNoncePrefixSizeInBytes);
+  params.salt = random_bytes.substr(0, derived_key_size_);
+  params.nonce_prefix = random_bytes.substr(derived_key_size_);
+  auto hkdf_result = Hkdf::ComputeHkdf(hkdf_hash_, *ikm_, params.salt,
+                                       associated_data, derived_key_size_);
+  if (!hkdf_result.ok()) return hkdf_result.status();
+  params.key = std::move(hkdf_result).ValueOrDie();
+  params.ciphertext_offset = ciphertext_offset_;
+  params.ciphertext_segment_size = ciphertext_segment_size_;
+  return AesGcmHkdfStreamSegmentEncrypter::New(std::move(params));
+}
+
+util::StatusOr<std::unique_ptr<StreamSegmentEncrypter>>
+AesGcmHkdfStreaming::NewSegmentEncrypterForHeader(
+    absl::string_view associated_data, absl::string_view header) const {
+  size_t header_size =
+      1 + derived_key_size_ +
+      AesGcmHkdfStreamSegmentEncrypter::kNoncePrefixSizeInBytes;
+  if (header.size() != header_size ||
+      static_cast<uint8_t>(header[0]) != header_size) {
+    return util::Status(util::error::INVALID_ARGUMENT, "Invalid header");
+  }
+  AesGcmHkdfStreamSegmentEncrypter::Params params;
+  params.salt = std::string(header.substr(1, derived_key_size_));
+  params.nonce_prefix = std::string(header.substr(1 + derived_key_size_));
+  auto hkdf_result = Hkdf::ComputeHkdf(hkdf_hash_, *ikm_, params.salt,
                                        associated_data, derived_key_size_);
   if (!hkdf_result.ok()) return hkdf_result.status();
   params.key = std::move(hkdf_result).ValueOrDie();
@@ -86,7 +113,7 @@ util::StatusOr<std::unique_ptr<StreamSegmentDecrypter>>
 AesGcmHkdfStreaming::NewSegmentDecrypter(
     absl::string_view associated_data) const {
   AesGcmHkdfStreamSegmentDecrypter::Params params;
-  params.ikm = ikm_;
+  params.shared_ikm = ikm_;
   params.hkdf_hash = hkdf_hash_;
   params.derived_key_size = derived_key_size_;
   params.ciphertext_offset = ciphertext_offset_;
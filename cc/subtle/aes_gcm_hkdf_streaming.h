@@ -53,15 +53,20 @@ class AesGcmHkdfStreaming : public NonceBasedStreamingAead {
   util::StatusOr<std::unique_ptr<StreamSegmentDecrypter>> NewSegmentDecrypter(
       absl::string_view associated_data) const override;
 
+  util::StatusOr<std::unique_ptr<StreamSegmentEncrypter>>
+  NewSegmentEncrypterForHeader(absl::string_view associated_data,
+                               absl::string_view header) const override;
+
  private:
   explicit AesGcmHkdfStreaming(Params params)
-      : ikm_(std::move(params.ikm)),
+      : ikm_(std::make_shared<const util::SecretData>(std::move(params.ikm))),
         hkdf_hash_(params.hkdf_hash),
         derived_key_size_(params.derived_key_size),
         ciphertext_segment_size_(params.ciphertext_segment_size),
         ciphertext_offset_(params.ciphertext_offset) {}
 
-  const util::SecretData ikm_;
+  // Shared with the decrypters, so that creating one does not copy it.
+  const std::shared_ptr<const util::SecretData> ikm_;
   const HashType hkdf_hash_;
   const int derived_key_size_;
   const int ciphertext_segment_size_;
@@ -25,6 +25,8 @@
 #include "tink/output_stream.h"
 #include "tink/subtle/common_enums.h"
 #include "tink/subtle/random.h"
+#include "tink/subtle/streaming_aead_decrypting_stream.h"
+#include "tink/subtle/streaming_aead_encrypting_stream.h"
 #include "tink/subtle/streaming_aead_test_util.h"
 #include "tink/subtle/test_util.h"
 #include "tink/util/istream_input_stream.h"
@@ -94,6 +96,239 @@ TEST(AesGcmHkdfStreamingTest, testBasic) {
   }
 }
 
+TEST(AesGcmHkdfStreamingTest, testResumeEncryption) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  AesGcmHkdfStreaming::Params params;
+  params.ikm = Random::GetRandomKeyBytes(32);
+  params.hkdf_hash = SHA256;
+  params.derived_key_size = 32;
+  params.ciphertext_segment_size = 256;
+  params.ciphertext_offset = 0;
+  auto streaming_aead =
+      std::move(AesGcmHkdfStreaming::New(std::move(params)).ValueOrDie());
+  std::string pt = Random::GetRandomBytes(5000);
+  std::string associated_data = "some associated data";
+
+  auto ct_stream = absl::make_unique<std::stringstream>();
+  std::stringbuf* ct_buf = ct_stream->rdbuf();
+  auto enc_stream = std::move(
+      streaming_aead
+          ->NewResumableEncryptingStream(
+              absl::make_unique<util::OstreamOutputStream>(
+                  std::move(ct_stream)),
+              associated_data)
+          .ValueOrDie());
+  ASSERT_THAT(test::WriteToStream(enc_stream.get(), pt.substr(0, 2000), false),
+              IsOk());
+  StreamingAeadEncryptingStream::Checkpoint checkpoint =
+      enc_stream->GetCheckpoint();
+  EXPECT_GT(checkpoint.segment_count, 0);
+  ASSERT_THAT(test::WriteToStream(enc_stream.get(), pt.substr(2000)), IsOk());
+  std::string ct = ct_buf->str();
+
+  ct_stream = absl::make_unique<std::stringstream>();
+  ct_buf = ct_stream->rdbuf();
+  auto resumed_result = streaming_aead->ResumeEncryptingStream(
+      absl::make_unique<util::OstreamOutputStream>(std::move(ct_stream)),
+      associated_data, checkpoint);
+  ASSERT_THAT(resumed_result.status(), IsOk());
+  ASSERT_THAT(test::WriteToStream(resumed_result.ValueOrDie().get(),
+                                  pt.substr(checkpoint.plaintext_position)),
+              IsOk());
+  EXPECT_EQ(ct, ct.substr(0, checkpoint.ciphertext_position) + ct_buf->str());
+
+  checkpoint.header.pop_back();
+  EXPECT_THAT(streaming_aead
+                  ->ResumeEncryptingStream(
+                      absl::make_unique<util::OstreamOutputStream>(
+                          absl::make_unique<std::stringstream>()),
+                      associated_data, checkpoint)
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(AesGcmHkdfStreamingTest, testMultipartEncryption) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  AesGcmHkdfStreaming::Params params;
+  params.ikm = Random::GetRandomKeyBytes(32);
+  params.hkdf_hash = SHA256;
+  params.derived_key_size = 32;
+  params.ciphertext_segment_size = 256;
+  params.ciphertext_offset = 0;
+  auto streaming_aead =
+      std::move(AesGcmHkdfStreaming::New(std::move(params)).ValueOrDie());
+  std::string pt = Random::GetRandomBytes(5000);
+  std::string associated_data = "some associated data";
+
+  auto plan_result =
+      streaming_aead->NewMultipartEncryptionPlan(associated_data);
+  ASSERT_THAT(plan_result.status(), IsOk());
+  auto& plan = plan_result.ValueOrDie();
+  // The second part is encrypted as if on another machine.
+  auto other_plan_result = streaming_aead->GetMultipartEncryptionPlan(
+      associated_data, plan->header());
+  ASSERT_THAT(other_plan_result.status(), IsOk());
+  auto& other_plan = other_plan_result.ValueOrDie();
+
+  const int64_t split = plan->PlaintextPosition(5);
+  auto first_part_result = plan->EncryptPart(0, pt.substr(0, split), false);
+  ASSERT_THAT(first_part_result.status(), IsOk());
+  auto second_part_result =
+      other_plan->EncryptPart(5, pt.substr(split), true);
+  ASSERT_THAT(second_part_result.status(), IsOk());
+  EXPECT_EQ(plan->CiphertextPosition(5),
+            first_part_result.ValueOrDie().size());
+  std::string ct =
+      first_part_result.ValueOrDie() + second_part_result.ValueOrDie();
+
+  auto dec_stream_result = streaming_aead->NewDecryptingStream(
+      absl::make_unique<util::IstreamInputStream>(
+          absl::make_unique<std::stringstream>(ct)),
+      associated_data);
+  ASSERT_THAT(dec_stream_result.status(), IsOk());
+  std::string decrypted;
+  ASSERT_THAT(
+      test::ReadFromStream(dec_stream_result.ValueOrDie().get(), &decrypted),
+      IsOk());
+  EXPECT_EQ(pt, decrypted);
+}
+
+TEST(AesGcmHkdfStreamingTest, testChunkedDecryption) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  AesGcmHkdfStreaming::Params params;
+  params.ikm = Random::GetRandomKeyBytes(32);
+  params.hkdf_hash = SHA256;
+  params.derived_key_size = 32;
+  params.ciphertext_segment_size = 256;
+  params.ciphertext_offset = 0;
+  auto streaming_aead =
+      std::move(AesGcmHkdfStreaming::New(std::move(params)).ValueOrDie());
+  std::string pt = Random::GetRandomBytes(10000);
+  std::string associated_data = "some associated data";
+
+  auto ct_stream = absl::make_unique<std::stringstream>();
+  std::stringbuf* ct_buf = ct_stream->rdbuf();
+  auto enc_stream_result = streaming_aead->NewEncryptingStream(
+      absl::make_unique<util::OstreamOutputStream>(std::move(ct_stream)),
+      associated_data);
+  ASSERT_THAT(enc_stream_result.status(), IsOk());
+  ASSERT_THAT(test::WriteToStream(enc_stream_result.ValueOrDie().get(), pt),
+              IsOk());
+  std::string ct = ct_buf->str();
+
+  StreamingAeadDecryptingStream::ChunkedOptions options;
+  options.target_chunk_size = 4096;
+  auto dec_stream_result = streaming_aead->NewChunkedDecryptingStream(
+      absl::make_unique<util::IstreamInputStream>(
+          absl::make_unique<std::stringstream>(ct)),
+      associated_data, options);
+  ASSERT_THAT(dec_stream_result.status(), IsOk());
+  std::string decrypted;
+  ASSERT_THAT(
+      test::ReadFromStream(dec_stream_result.ValueOrDie().get(), &decrypted),
+      IsOk());
+  EXPECT_EQ(pt, decrypted);
+
+  // A modified segment fails the stream after the chunks before it.
+  ct[20 * 256] ^= 1;
+  auto modified_stream_result = streaming_aead->NewChunkedDecryptingStream(
+      absl::make_unique<util::IstreamInputStream>(
+          absl::make_unique<std::stringstream>(ct)),
+      associated_data, options);
+  ASSERT_THAT(modified_stream_result.status(), IsOk());
+  auto status = test::ReadFromStream(
+      modified_stream_result.ValueOrDie().get(), &decrypted);
+  EXPECT_FALSE(status.ok());
+  EXPECT_NE(util::error::OUT_OF_RANGE, status.error_code());
+}
+
+TEST(AesGcmHkdfStreamingTest, testEncryptSmall) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  for (int ciphertext_offset : {0, 10}) {
+    SCOPED_TRACE(absl::StrCat("ciphertext_offset = ", ciphertext_offset));
+    AesGcmHkdfStreaming::Params params;
+    params.ikm = Random::GetRandomKeyBytes(32);
+    params.hkdf_hash = SHA256;
+    params.derived_key_size = 32;
+    params.ciphertext_segment_size = 256;
+    params.ciphertext_offset = ciphertext_offset;
+    auto streaming_aead =
+        std::move(AesGcmHkdfStreaming::New(std::move(params)).ValueOrDie());
+    std::string associated_data = "some associated data";
+    // The first segment holds 256 - 16 bytes of ciphertext, less the
+    // header of 1 + 32 + 7 bytes.
+    const int max_size = 256 - 16 - ciphertext_offset - 40;
+    for (int pt_size : {0, 1, 100, max_size}) {
+      SCOPED_TRACE(absl::StrCat("pt_size = ", pt_size));
+      std::string pt = Random::GetRandomBytes(pt_size);
+      auto encrypt_result = streaming_aead->EncryptSmall(pt, associated_data);
+      ASSERT_THAT(encrypt_result.status(), IsOk());
+      std::string ct = encrypt_result.ValueOrDie();
+      EXPECT_EQ(40 + pt_size + 16, ct.size());
+
+      // The ciphertext is that of a stream.
+      auto dec_stream_result = streaming_aead->NewDecryptingStream(
+          absl::make_unique<util::IstreamInputStream>(
+              absl::make_unique<std::stringstream>(ct)),
+          associated_data);
+      ASSERT_THAT(dec_stream_result.status(), IsOk());
+      std::string decrypted;
+      ASSERT_THAT(
+          test::ReadFromStream(dec_stream_result.ValueOrDie().get(),
+                               &decrypted),
+          IsOk());
+      EXPECT_EQ(pt, decrypted);
+
+      // And the ciphertext of a stream decrypts in one shot.
+      auto ct_stream = absl::make_unique<std::stringstream>();
+      std::stringbuf* ct_buf = ct_stream->rdbuf();
+      auto enc_stream_result = streaming_aead->NewEncryptingStream(
+          absl::make_unique<util::OstreamOutputStream>(std::move(ct_stream)),
+          associated_data);
+      ASSERT_THAT(enc_stream_result.status(), IsOk());
+      ASSERT_THAT(
+          test::WriteToStream(enc_stream_result.ValueOrDie().get(), pt),
+          IsOk());
+      auto decrypt_result =
+          streaming_aead->DecryptSmall(ct_buf->str(), associated_data);
+      ASSERT_THAT(decrypt_result.status(), IsOk());
+      EXPECT_EQ(pt, decrypt_result.ValueOrDie());
+
+      EXPECT_FALSE(
+          streaming_aead->DecryptSmall(ct, "wrong associated data").ok());
+      EXPECT_THAT(streaming_aead->DecryptSmall(ct.substr(0, 39),
+                                               associated_data)
+                      .status(),
+                  StatusIs(util::error::INVALID_ARGUMENT));
+    }
+
+    // Longer plaintexts and ciphertexts need the streams.
+    std::string pt = Random::GetRandomBytes(max_size + 1);
+    EXPECT_THAT(streaming_aead->EncryptSmall(pt, associated_data).status(),
+                StatusIs(util::error::INVALID_ARGUMENT));
+    auto ct_stream = absl::make_unique<std::stringstream>();
+    std::stringbuf* ct_buf = ct_stream->rdbuf();
+    auto enc_stream = std::move(
+        streaming_aead
+            ->NewEncryptingStream(absl::make_unique<util::OstreamOutputStream>(
+                                      std::move(ct_stream)),
+                                  associated_data)
+            .ValueOrDie());
+    ASSERT_THAT(test::WriteToStream(enc_stream.get(), pt), IsOk());
+    EXPECT_THAT(
+        streaming_aead->DecryptSmall(ct_buf->str(), associated_data).status(),
+        StatusIs(util::error::INVALID_ARGUMENT));
+  }
+}
+
 TEST(AesGcmHkdfStreamingTest, testIkmSmallerThanDerivedKey) {
   if (kUseOnlyFips) {
     GTEST_SKIP() << "Not supported in FIPS-only mode";
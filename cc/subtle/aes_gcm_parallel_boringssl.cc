@@ -0,0 +1,378 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/subtle/aes_gcm_parallel_boringssl.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/synchronization/blocking_counter.h"
+#include "openssl/cipher.h"
+#include "openssl/mem.h"
+#include "tink/config/tink_fips.h"
+#include "tink/subtle/aes_gcm_boringssl.h"
+#include "tink/subtle/random.h"
+#include "tink/subtle/subtle_util.h"
+#include "tink/subtle/subtle_util_boringssl.h"
+#include "tink/util/status.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+constexpr int64_t AesGcmParallelBoringSsl::kDefaultChunkSize;
+constexpr int64_t AesGcmParallelBoringSsl::kDefaultMinParallelSize;
+constexpr int AesGcmParallelBoringSsl::kIvSizeInBytes;
+constexpr int AesGcmParallelBoringSsl::kTagSizeInBytes;
+constexpr int AesGcmParallelBoringSsl::kBlockSize;
+constexpr int64_t AesGcmParallelBoringSsl::kMaxChunkSize;
+
+namespace {
+
+using FieldElement = AesGcmParallelBoringSsl::FieldElement;
+
+// GCM limits the plaintext to 2^32 - 2 blocks, so that the 32-bit counter
+// does not wrap around.
+constexpr int64_t kMaxPlaintextSize = ((int64_t{1} << 32) - 2) * 16;
+
+uint64_t LoadBigEndian64(const uint8_t* bytes) {
+  uint64_t value = 0;
+  for (int i = 0; i < 8; i++) value = (value << 8) | bytes[i];
+  return value;
+}
+
+void StoreBigEndian64(uint64_t value, uint8_t* bytes) {
+  for (int i = 7; i >= 0; i--) {
+    bytes[i] = static_cast<uint8_t>(value & 0xff);
+    value >>= 8;
+  }
+}
+
+FieldElement Load(const uint8_t* bytes) {
+  return FieldElement{LoadBigEndian64(bytes), LoadBigEndian64(bytes + 8)};
+}
+
+void Store(const FieldElement& x, uint8_t* bytes) {
+  StoreBigEndian64(x.hi, bytes);
+  StoreBigEndian64(x.lo, bytes + 8);
+}
+
+FieldElement Add(const FieldElement& x, const FieldElement& y) {
+  return FieldElement{x.hi ^ y.hi, x.lo ^ y.lo};
+}
+
+// Multiplication in GF(2^128) as in Algorithm 1 of NIST SP 800-38D. It is
+// only used a few times per chunk, so a constant-time bitwise loop is fast
+// enough.
+FieldElement Multiply(const FieldElement& x, const FieldElement& y) {
+  FieldElement z{0, 0};
+  FieldElement v = y;
+  for (int i = 0; i < 128; i++) {
+    uint64_t bit = (i < 64 ? x.hi >> (63 - i) : x.lo >> (127 - i)) & 1;
+    uint64_t mask = 0 - bit;
+    z.hi ^= v.hi & mask;
+    z.lo ^= v.lo & mask;
+    uint64_t reduce = 0 - (v.lo & 1);
+    v.lo = (v.lo >> 1) | (v.hi << 63);
+    v.hi = (v.hi >> 1) ^ (reduce & 0xe100000000000000);
+  }
+  return z;
+}
+
+// Returns x^n.
+FieldElement Power(FieldElement x, uint64_t n) {
+  FieldElement result{uint64_t{1} << 63, 0};
+  while (n > 0) {
+    if (n & 1) result = Multiply(result, x);
+    x = Multiply(x, x);
+    n >>= 1;
+  }
+  return result;
+}
+
+// Returns the number of blocks of 'size' bytes, zero-padded.
+uint64_t Blocks(uint64_t size) { return (size + 15) / 16; }
+
+// Returns AES(key, counter_block), as the first block of the AES-CTR
+// keystream from 'counter_block'.
+util::StatusOr<FieldElement> EncryptBlock(const EVP_CIPHER* ctr_cipher,
+                                          const util::SecretData& key,
+                                          const uint8_t* counter_block) {
+  uint8_t block[16] = {0};
+  int len;
+  bssl::ScopedEVP_CIPHER_CTX ctx;
+  if (!EVP_EncryptInit_ex(ctx.get(), ctr_cipher, nullptr, key.data(),
+                          counter_block) ||
+      !EVP_EncryptUpdate(ctx.get(), block, &len, block, sizeof(block))) {
+    return util::Status(util::error::INTERNAL, "AES encryption failed");
+  }
+  return Load(block);
+}
+
+// Writes the counter block (iv || counter) to 'block'.
+void CounterBlock(absl::string_view iv, uint32_t counter, uint8_t* block) {
+  std::memcpy(block, iv.data(), iv.size());
+  for (int i = 15; i >= 12; i--) {
+    block[i] = static_cast<uint8_t>(counter & 0xff);
+    counter >>= 8;
+  }
+}
+
+}  // namespace
+
+// static
+util::StatusOr<std::unique_ptr<Aead>> AesGcmParallelBoringSsl::New(
+    const util::SecretData& key, util::Executor* executor, int64_t chunk_size,
+    int64_t min_parallel_size) {
+  auto status = CheckFipsCompatibility<AesGcmParallelBoringSsl>();
+  if (!status.ok()) return status;
+
+  const EVP_CIPHER* gcm_cipher =
+      SubtleUtilBoringSSL::GetAesGcmCipherForKeySize(key.size());
+  const EVP_CIPHER* ctr_cipher =
+      SubtleUtilBoringSSL::GetAesCtrCipherForKeySize(key.size());
+  if (gcm_cipher == nullptr || ctr_cipher == nullptr) {
+    return util::Status(util::error::INVALID_ARGUMENT, "invalid key size");
+  }
+  if (chunk_size <= 0 || chunk_size > kMaxChunkSize ||
+      chunk_size % kBlockSize != 0) {
+    return util::Status(util::error::INVALID_ARGUMENT, "invalid chunk size");
+  }
+  auto small_message_aead_result = AesGcmBoringSsl::New(key);
+  if (!small_message_aead_result.ok()) {
+    return small_message_aead_result.status();
+  }
+  bssl::UniquePtr<EVP_CIPHER_CTX> gcm_ctx(EVP_CIPHER_CTX_new());
+  if (!gcm_ctx || !EVP_EncryptInit_ex(gcm_ctx.get(), gcm_cipher, nullptr,
+                                      key.data(), nullptr)) {
+    return util::Status(util::error::INTERNAL,
+                        "could not initialize EVP_CIPHER_CTX");
+  }
+  uint8_t counter_block[16] = {0};
+  auto h_result = EncryptBlock(ctr_cipher, key, counter_block);
+  if (!h_result.ok()) return h_result.status();
+  counter_block[15] = 1;
+  auto mask_result = EncryptBlock(ctr_cipher, key, counter_block);
+  if (!mask_result.ok()) return mask_result.status();
+
+  std::unique_ptr<Aead> aead(new AesGcmParallelBoringSsl(
+      key, executor, chunk_size, min_parallel_size,
+      std::move(small_message_aead_result.ValueOrDie()), ctr_cipher,
+      std::move(gcm_ctx), h_result.ValueOrDie(), mask_result.ValueOrDie()));
+  return std::move(aead);
+}
+
+util::StatusOr<FieldElement> AesGcmParallelBoringSsl::HashChunk(
+    const uint8_t* data, size_t size) const {
+  // The tag of GCM with the all-zero IV, 'data' as the associated data and
+  // an empty plaintext is (S + L) * H + zero_iv_mask_, where L is the size
+  // block.
+  const uint8_t zero_iv[kIvSizeInBytes] = {0};
+  uint8_t tag[kTagSizeInBytes];
+  int len;
+  bssl::ScopedEVP_CIPHER_CTX ctx;
+  if (!EVP_CIPHER_CTX_copy(ctx.get(), gcm_ctx_.get()) ||
+      !EVP_EncryptInit_ex(ctx.get(), nullptr, nullptr, nullptr, zero_iv) ||
+      (size > 0 && !EVP_EncryptUpdate(ctx.get(), nullptr, &len, data, size)) ||
+      !EVP_EncryptFinal_ex(ctx.get(), nullptr, &len) ||
+      !EVP_CIPHER_CTX_ctrl(ctx.get(), EVP_CTRL_GCM_GET_TAG, kTagSizeInBytes,
+                           tag)) {
+    return util::Status(util::error::INTERNAL, "GHASH failed");
+  }
+  FieldElement size_block{static_cast<uint64_t>(size) * 8, 0};
+  return Add(Add(Load(tag), zero_iv_mask_), Multiply(size_block, h_));
+}
+
+util::Status AesGcmParallelBoringSsl::ProcessChunk(
+    absl::string_view iv, uint32_t counter, bool encrypt, const uint8_t* in,
+    size_t size, uint8_t* out, FieldElement* hash) const {
+  util::StatusOr<FieldElement> hash_result;
+  if (!encrypt) hash_result = HashChunk(in, size);
+  uint8_t counter_block[16];
+  CounterBlock(iv, counter, counter_block);
+  int len;
+  bssl::ScopedEVP_CIPHER_CTX ctx;
+  if (!EVP_EncryptInit_ex(ctx.get(), ctr_cipher_, nullptr, key_.data(),
+                          counter_block) ||
+      (size > 0 && !EVP_EncryptUpdate(ctx.get(), out, &len, in, size))) {
+    return util::Status(util::error::INTERNAL, "AES-CTR failed");
+  }
+  if (encrypt) hash_result = HashChunk(out, size);
+  if (!hash_result.ok()) return hash_result.status();
+  *hash = hash_result.ValueOrDie();
+  return util::OkStatus();
+}
+
+util::Status AesGcmParallelBoringSsl::Process(
+    absl::string_view iv, bool encrypt, absl::string_view additional_data,
+    const uint8_t* in, size_t size, uint8_t* out, uint8_t* tag) const {
+  size_t chunk_count = std::max<size_t>(1, (size + chunk_size_ - 1) /
+                                               chunk_size_);
+  std::vector<FieldElement> hashes(chunk_count);
+  std::vector<util::Status> statuses(chunk_count);
+  auto process_chunk = [&](size_t i) {
+    size_t offset = i * chunk_size_;
+    size_t chunk_size = std::min<size_t>(chunk_size_, size - offset);
+    // The counter of J0 is 1, and the payload starts at 2.
+    statuses[i] = ProcessChunk(iv, 2 + offset / kBlockSize, encrypt,
+                               in + offset, chunk_size, out + offset,
+                               &hashes[i]);
+  };
+  absl::BlockingCounter done(chunk_count - 1);
+  for (size_t i = 1; i < chunk_count; i++) {
+    if (executor_ == nullptr) {
+      process_chunk(i);
+      done.DecrementCount();
+    } else {
+      executor_->Schedule([&process_chunk, &done, i]() {
+        process_chunk(i);
+        done.DecrementCount();
+      });
+    }
+  }
+  process_chunk(0);
+  auto additional_data_hash_result = HashChunk(
+      reinterpret_cast<const uint8_t*>(additional_data.data()),
+      additional_data.size());
+  done.Wait();
+  if (!additional_data_hash_result.ok()) {
+    return additional_data_hash_result.status();
+  }
+  for (const util::Status& status : statuses) {
+    if (!status.ok()) return status;
+  }
+
+  // GHASH(a || b) = GHASH(a) * H^blocks(b) + GHASH(b), so the hashes are
+  // combined with Horner's method.
+  FieldElement chunk_power = Power(h_, Blocks(chunk_size_));
+  FieldElement sum = additional_data_hash_result.ValueOrDie();
+  for (size_t i = 0; i < chunk_count; i++) {
+    size_t chunk_size = std::min<size_t>(chunk_size_, size - i * chunk_size_);
+    FieldElement power = chunk_size == chunk_size_
+                             ? chunk_power
+                             : Power(h_, Blocks(chunk_size));
+    sum = Add(Multiply(sum, power), hashes[i]);
+  }
+  FieldElement size_block{static_cast<uint64_t>(additional_data.size()) * 8,
+                          static_cast<uint64_t>(size) * 8};
+  sum = Add(sum, Multiply(size_block, h_));
+  uint8_t counter_block[16];
+  CounterBlock(iv, 1, counter_block);
+  auto mask_result = EncryptBlock(ctr_cipher_, key_, counter_block);
+  if (!mask_result.ok()) return mask_result.status();
+  Store(Add(sum, mask_result.ValueOrDie()), tag);
+  return util::OkStatus();
+}
+
+util::StatusOr<std::string> AesGcmParallelBoringSsl::Encrypt(
+    absl::string_view plaintext, absl::string_view additional_data) const {
+  std::string result;
+  ResizeStringUninitialized(
+      &result, kIvSizeInBytes + plaintext.size() + kTagSizeInBytes);
+  auto written_result =
+      EncryptInto(plaintext, additional_data, absl::MakeSpan(result));
+  if (!written_result.ok()) return written_result.status();
+  return result;
+}
+
+util::StatusOr<std::string> AesGcmParallelBoringSsl::Decrypt(
+    absl::string_view ciphertext, absl::string_view additional_data) const {
+  if (ciphertext.size() < kIvSizeInBytes + kTagSizeInBytes) {
+    return util::CiphertextTooShortError();
+  }
+  std::string result;
+  ResizeStringUninitialized(
+      &result, ciphertext.size() - kIvSizeInBytes - kTagSizeInBytes);
+  auto written_result =
+      DecryptInto(ciphertext, additional_data, absl::MakeSpan(result));
+  if (!written_result.ok()) return written_result.status();
+  return result;
+}
+
+util::StatusOr<int64_t> AesGcmParallelBoringSsl::CiphertextSize(
+    int64_t plaintext_size) const {
+  return kIvSizeInBytes + plaintext_size + kTagSizeInBytes;
+}
+
+util::StatusOr<int64_t> AesGcmParallelBoringSsl::EncryptInto(
+    absl::string_view plaintext, absl::string_view additional_data,
+    absl::Span<char> buffer) const {
+  if (static_cast<int64_t>(plaintext.size()) < min_parallel_size_) {
+    return small_message_aead_->EncryptInto(plaintext, additional_data,
+                                            buffer);
+  }
+  if (static_cast<int64_t>(plaintext.size()) > kMaxPlaintextSize) {
+    return util::Status(util::error::INVALID_ARGUMENT, "plaintext too long");
+  }
+  size_t ciphertext_size = kIvSizeInBytes + plaintext.size() + kTagSizeInBytes;
+  if (buffer.size() < ciphertext_size) {
+    return util::Status(util::error::INVALID_ARGUMENT, "Buffer too small");
+  }
+  Random::FillRandomBytes(buffer.subspan(0, kIvSizeInBytes));
+  uint8_t* out = reinterpret_cast<uint8_t*>(buffer.data()) + kIvSizeInBytes;
+  util::Status status =
+      Process(absl::string_view(buffer.data(), kIvSizeInBytes),
+              /*encrypt=*/true, additional_data,
+              reinterpret_cast<const uint8_t*>(plaintext.data()),
+              plaintext.size(), out, out + plaintext.size());
+  if (!status.ok()) return status;
+  return ciphertext_size;
+}
+
+util::StatusOr<int64_t> AesGcmParallelBoringSsl::DecryptInto(
+    absl::string_view ciphertext, absl::string_view additional_data,
+    absl::Span<char> buffer) const {
+  if (ciphertext.size() < kIvSizeInBytes + kTagSizeInBytes) {
+    return util::CiphertextTooShortError();
+  }
+  size_t plaintext_size = ciphertext.size() - kIvSizeInBytes - kTagSizeInBytes;
+  if (static_cast<int64_t>(plaintext_size) < min_parallel_size_) {
+    return small_message_aead_->DecryptInto(ciphertext, additional_data,
+                                            buffer);
+  }
+  if (static_cast<int64_t>(plaintext_size) > kMaxPlaintextSize) {
+    return util::AuthenticationFailedError();
+  }
+  if (buffer.size() < plaintext_size) {
+    return util::Status(util::error::INVALID_ARGUMENT, "Buffer too small");
+  }
+  uint8_t* out = reinterpret_cast<uint8_t*>(buffer.data());
+  const uint8_t* in =
+      reinterpret_cast<const uint8_t*>(ciphertext.data()) + kIvSizeInBytes;
+  uint8_t tag[kTagSizeInBytes];
+  util::Status status =
+      Process(ciphertext.substr(0, kIvSizeInBytes), /*encrypt=*/false,
+              additional_data, in, plaintext_size, out, tag);
+  // The plaintext is only released if the tag is correct.
+  if (!status.ok() ||
+      CRYPTO_memcmp(tag, in + plaintext_size, kTagSizeInBytes) != 0) {
+    OPENSSL_cleanse(out, plaintext_size);
+    if (!status.ok()) return status;
+    return util::AuthenticationFailedError();
+  }
+  return plaintext_size;
+}
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
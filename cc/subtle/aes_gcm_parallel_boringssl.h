@@ -0,0 +1,157 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TINK_SUBTLE_AES_GCM_PARALLEL_BORINGSSL_H_
+#define TINK_SUBTLE_AES_GCM_PARALLEL_BORINGSSL_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "openssl/base.h"
+#include "openssl/cipher.h"
+#include "tink/aead.h"
+#include "tink/config/tink_fips.h"
+#include "tink/util/executor.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+// AES-GCM which encrypts and decrypts large messages in chunks on an
+// executor. The ciphertexts are those of AesGcmBoringSsl:
+// (iv || ciphertext || tag), so that either decrypts the other's.
+//
+// Each chunk is encrypted with AES-CTR from its own counter, and its GHASH is
+// computed by BoringSSL's GCM with the chunk as the associated data, which
+// uses the same hardware support as encryption. Since GHASH is a polynomial
+// in H, the hashes of the chunks are combined into the tag of the whole
+// message with a few multiplications by powers of H. Messages smaller than
+// 'min_parallel_size' are processed by AesGcmBoringSsl in the calling thread.
+class AesGcmParallelBoringSsl : public Aead {
+ public:
+  static constexpr int64_t kDefaultChunkSize = 4 * 1024 * 1024;
+  static constexpr int64_t kDefaultMinParallelSize = 16 * 1024 * 1024;
+
+  // The chunks run on 'executor', which must outlive the returned Aead, and
+  // must run tasks without waiting for the thread which scheduled them. If
+  // 'executor' is null, they run in the calling thread. 'chunk_size' must be
+  // a positive multiple of 16 of at most 1 GiB.
+  static crypto::tink::util::StatusOr<std::unique_ptr<Aead>> New(
+      const util::SecretData& key, util::Executor* executor,
+      int64_t chunk_size = kDefaultChunkSize,
+      int64_t min_parallel_size = kDefaultMinParallelSize);
+
+  crypto::tink::util::StatusOr<std::string> Encrypt(
+      absl::string_view plaintext,
+      absl::string_view additional_data) const override;
+
+  crypto::tink::util::StatusOr<std::string> Decrypt(
+      absl::string_view ciphertext,
+      absl::string_view additional_data) const override;
+
+  crypto::tink::util::StatusOr<int64_t> CiphertextSize(
+      int64_t plaintext_size) const override;
+
+  crypto::tink::util::StatusOr<int64_t> EncryptInto(
+      absl::string_view plaintext, absl::string_view additional_data,
+      absl::Span<char> buffer) const override;
+
+  crypto::tink::util::StatusOr<int64_t> DecryptInto(
+      absl::string_view ciphertext, absl::string_view additional_data,
+      absl::Span<char> buffer) const override;
+
+  static constexpr crypto::tink::FipsCompatibility kFipsStatus =
+      crypto::tink::FipsCompatibility::kRequiresBoringCrypto;
+
+  // An element of GF(2^128), with the bit order of GCM: the most significant
+  // bit of 'hi' is the coefficient of x^0. Used by the implementation.
+  struct FieldElement {
+    uint64_t hi;
+    uint64_t lo;
+  };
+
+ private:
+  static constexpr int kIvSizeInBytes = 12;
+  static constexpr int kTagSizeInBytes = 16;
+  static constexpr int kBlockSize = 16;
+  static constexpr int64_t kMaxChunkSize = int64_t{1} << 30;
+
+  AesGcmParallelBoringSsl(util::SecretData key, util::Executor* executor,
+                          int64_t chunk_size, int64_t min_parallel_size,
+                          std::unique_ptr<Aead> small_message_aead,
+                          const EVP_CIPHER* ctr_cipher,
+                          bssl::UniquePtr<EVP_CIPHER_CTX> gcm_ctx,
+                          FieldElement h, FieldElement zero_iv_mask)
+      : key_(std::move(key)),
+        executor_(executor),
+        chunk_size_(chunk_size),
+        min_parallel_size_(min_parallel_size),
+        small_message_aead_(std::move(small_message_aead)),
+        ctr_cipher_(ctr_cipher),
+        gcm_ctx_(std::move(gcm_ctx)),
+        h_(h),
+        zero_iv_mask_(zero_iv_mask) {}
+
+  // Encrypts or decrypts 'size' bytes of 'in' into 'out' with AES-CTR, from
+  // the counter block (iv || counter), and sets '*hash' to HashChunk() of
+  // the ciphertext.
+  crypto::tink::util::Status ProcessChunk(absl::string_view iv,
+                                          uint32_t counter, bool encrypt,
+                                          const uint8_t* in, size_t size,
+                                          uint8_t* out,
+                                          FieldElement* hash) const;
+
+  // Returns S * H, where S is the GHASH state after the zero-padded blocks
+  // of 'data', without a size block.
+  crypto::tink::util::StatusOr<FieldElement> HashChunk(const uint8_t* data,
+                                                       size_t size) const;
+
+  // Encrypts or decrypts the payload of 'size' bytes of 'in' into 'out' in
+  // chunks, and writes the tag of 'additional_data' and the ciphertext to
+  // 'tag'.
+  crypto::tink::util::Status Process(absl::string_view iv, bool encrypt,
+                                     absl::string_view additional_data,
+                                     const uint8_t* in, size_t size,
+                                     uint8_t* out, uint8_t* tag) const;
+
+  const util::SecretData key_;
+  util::Executor* const executor_;
+  const int64_t chunk_size_;
+  const int64_t min_parallel_size_;
+  const std::unique_ptr<Aead> small_message_aead_;
+  // ctr_cipher_ is a singleton owned by BoringSsl.
+  const EVP_CIPHER* const ctr_cipher_;
+  // AES-GCM keyed with the key, which is copied to hash chunks.
+  const bssl::UniquePtr<EVP_CIPHER_CTX> gcm_ctx_;
+  // The hash key AES(key, 0^128).
+  const FieldElement h_;
+  // The mask AES(key, J0) of the tag for the all-zero IV.
+  const FieldElement zero_iv_mask_;
+};
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_SUBTLE_AES_GCM_PARALLEL_BORINGSSL_H_
@@ -0,0 +1,167 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/subtle/aes_gcm_parallel_boringssl.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "tink/aead.h"
+#include "tink/subtle/aes_gcm_boringssl.h"
+#include "tink/subtle/random.h"
+#include "tink/util/executor.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "tink/util/test_matchers.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+namespace {
+
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::testing::Eq;
+
+// Runs every task on a new thread.
+class ThreadPerTaskExecutor : public util::Executor {
+ public:
+  ~ThreadPerTaskExecutor() override {
+    absl::MutexLock lock(&mutex_);
+    for (auto& thread : threads_) thread.join();
+  }
+
+  void Schedule(std::function<void()> task) override {
+    absl::MutexLock lock(&mutex_);
+    threads_.emplace_back(std::move(task));
+  }
+
+ private:
+  absl::Mutex mutex_;
+  std::vector<std::thread> threads_;
+};
+
+std::unique_ptr<Aead> NewAead(const util::SecretData& key,
+                              util::Executor* executor, int64_t chunk_size,
+                              int64_t min_parallel_size) {
+  auto aead_result = AesGcmParallelBoringSsl::New(key, executor, chunk_size,
+                                                  min_parallel_size);
+  EXPECT_THAT(aead_result.status(), IsOk());
+  return std::move(aead_result.ValueOrDie());
+}
+
+TEST(AesGcmParallelBoringSslTest, MatchesAesGcmBoringSsl) {
+  ThreadPerTaskExecutor executor;
+  for (int key_size : {16, 32}) {
+    util::SecretData key = Random::GetRandomKeyBytes(key_size);
+    auto reference = AesGcmBoringSsl::New(key).ValueOrDie();
+    for (util::Executor* chunk_executor :
+         {static_cast<util::Executor*>(&executor),
+          static_cast<util::Executor*>(nullptr)}) {
+      auto aead = NewAead(key, chunk_executor, /*chunk_size=*/64,
+                          /*min_parallel_size=*/0);
+      for (int size : {0, 1, 15, 16, 17, 63, 64, 65, 128, 1000, 4097}) {
+        SCOPED_TRACE(absl::StrCat("key_size: ", key_size, " size: ", size));
+        std::string plaintext = Random::GetRandomBytes(size);
+        std::string aad = Random::GetRandomBytes(size % 40);
+
+        auto ciphertext = aead->Encrypt(plaintext, aad);
+        ASSERT_THAT(ciphertext.status(), IsOk());
+        auto decrypted = reference->Decrypt(ciphertext.ValueOrDie(), aad);
+        ASSERT_THAT(decrypted.status(), IsOk());
+        EXPECT_THAT(decrypted.ValueOrDie(), Eq(plaintext));
+
+        ciphertext = reference->Encrypt(plaintext, aad);
+        ASSERT_THAT(ciphertext.status(), IsOk());
+        decrypted = aead->Decrypt(ciphertext.ValueOrDie(), aad);
+        ASSERT_THAT(decrypted.status(), IsOk());
+        EXPECT_THAT(decrypted.ValueOrDie(), Eq(plaintext));
+      }
+    }
+  }
+}
+
+TEST(AesGcmParallelBoringSslTest, SmallMessages) {
+  ThreadPerTaskExecutor executor;
+  util::SecretData key = Random::GetRandomKeyBytes(16);
+  auto reference = AesGcmBoringSsl::New(key).ValueOrDie();
+  auto aead = NewAead(key, &executor, /*chunk_size=*/64,
+                      /*min_parallel_size=*/1000);
+  for (int size : {0, 100, 999, 1000, 2000}) {
+    std::string plaintext = Random::GetRandomBytes(size);
+    auto ciphertext = aead->Encrypt(plaintext, "aad");
+    ASSERT_THAT(ciphertext.status(), IsOk());
+    EXPECT_THAT(aead->CiphertextSize(size).ValueOrDie(),
+                Eq(ciphertext.ValueOrDie().size()));
+    auto decrypted = reference->Decrypt(ciphertext.ValueOrDie(), "aad");
+    ASSERT_THAT(decrypted.status(), IsOk()) << size;
+    EXPECT_THAT(decrypted.ValueOrDie(), Eq(plaintext));
+  }
+}
+
+TEST(AesGcmParallelBoringSslTest, ModifiedCiphertext) {
+  ThreadPerTaskExecutor executor;
+  auto aead = NewAead(Random::GetRandomKeyBytes(16), &executor,
+                      /*chunk_size=*/32, /*min_parallel_size=*/0);
+  std::string plaintext = Random::GetRandomBytes(100);
+  std::string ciphertext = aead->Encrypt(plaintext, "aad").ValueOrDie();
+  for (size_t i = 0; i < ciphertext.size(); i++) {
+    std::string modified = ciphertext;
+    modified[i] ^= 1;
+    EXPECT_FALSE(aead->Decrypt(modified, "aad").ok()) << i;
+  }
+  EXPECT_FALSE(aead->Decrypt(ciphertext, "aae").ok());
+  EXPECT_THAT(aead->Decrypt(ciphertext.substr(0, 27), "aad").status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+
+  // The plaintext is not left in the buffer after a failed decryption.
+  ciphertext[20] ^= 1;
+  std::string buffer(plaintext.size(), 'x');
+  EXPECT_FALSE(aead->DecryptInto(ciphertext, "aad", absl::MakeSpan(buffer))
+                   .ok());
+  EXPECT_THAT(buffer, Eq(std::string(plaintext.size(), '\0')));
+}
+
+TEST(AesGcmParallelBoringSslTest, InvalidParameters) {
+  util::SecretData key = Random::GetRandomKeyBytes(16);
+  for (int64_t chunk_size :
+       {int64_t{0}, int64_t{-16}, int64_t{17}, (int64_t{1} << 30) + 16}) {
+    EXPECT_THAT(
+        AesGcmParallelBoringSsl::New(key, nullptr, chunk_size).status(),
+        StatusIs(util::error::INVALID_ARGUMENT))
+        << chunk_size;
+  }
+  EXPECT_THAT(
+      AesGcmParallelBoringSsl::New(Random::GetRandomKeyBytes(24), nullptr)
+          .status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
@@ -16,14 +16,23 @@
 
 #include "tink/subtle/aes_gcm_siv_boringssl.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "absl/memory/memory.h"
 #include "openssl/aead.h"
+#include "openssl/cipher.h"
+#include "openssl/crypto.h"
+#include "openssl/mem.h"
 #include "tink/config/tink_fips.h"
+#include "tink/subtle/polyval.h"
 #include "tink/subtle/random.h"
 #include "tink/subtle/subtle_util.h"
+#include "tink/subtle/subtle_util_boringssl.h"
 #include "tink/util/status.h"
 
 namespace crypto {
@@ -41,6 +50,196 @@ const EVP_AEAD* GetCipherForKeySize(int size_in_bytes) {
       return nullptr;
   }
 }
+
+constexpr int kBlockSize = 16;
+constexpr int kNonceSize = 12;
+// The number of messages whose keys are derived together.
+constexpr int kGroupSize = 8;
+// The number of keystream blocks encrypted by one call.
+constexpr int kCtrChunkBlocks = 32;
+
+const EVP_CIPHER* GetEcbCipherForKeySize(int size_in_bytes) {
+  switch (size_in_bytes) {
+    case 16:
+      return EVP_aes_128_ecb();
+    case 32:
+      return EVP_aes_256_ecb();
+    default:
+      return nullptr;
+  }
+}
+
+// Encrypts 'num_blocks' blocks in place with 'ctx', an AES-ECB context
+// without padding.
+void EcbEncrypt(EVP_CIPHER_CTX* ctx, uint8_t* blocks, size_t num_blocks) {
+  int len;
+  EVP_EncryptUpdate(ctx, blocks, &len, blocks, num_blocks * kBlockSize);
+}
+
+void StoreLe32(uint32_t value, uint8_t* out) {
+  for (int i = 0; i < 4; i++) out[i] = value >> (8 * i);
+}
+
+uint32_t LoadLe32(const uint8_t* in) {
+  return in[0] | in[1] << 8 | in[2] << 16 | static_cast<uint32_t>(in[3]) << 24;
+}
+
+void StoreLe64(uint64_t value, uint8_t* out) {
+  for (int i = 0; i < 8; i++) out[i] = value >> (8 * i);
+}
+
+const uint8_t* ToUint8(const char* data) {
+  return reinterpret_cast<const uint8_t*>(data);
+}
+
+// One message of a batch.
+struct SivMessage {
+  // The plaintext, or the ciphertext without nonce and tag.
+  absl::string_view input;
+  absl::string_view associated_data;
+  const uint8_t* nonce;
+  // Receives input.size() bytes. When sealing, the tag is written after
+  // them; when opening, it follows the input.
+  uint8_t* output;
+};
+
+// The keys which RFC 8452, section 4, derives from a nonce.
+struct DerivedKeys {
+  uint8_t auth_key[kBlockSize];
+  uint8_t enc_key[32];
+};
+
+// Derives the keys of all 'messages' with a single pass of 'kdf_ctx', which
+// is AES-ECB with the key-generating key of 'key_size' bytes.
+void DeriveKeys(EVP_CIPHER_CTX* kdf_ctx, int key_size,
+                absl::Span<const SivMessage> messages,
+                DerivedKeys keys[kGroupSize]) {
+  const int blocks_per_message = 2 + key_size / 8;
+  uint8_t blocks[kGroupSize * 6][kBlockSize];
+  for (size_t i = 0; i < messages.size(); i++) {
+    for (int j = 0; j < blocks_per_message; j++) {
+      uint8_t* block = blocks[i * blocks_per_message + j];
+      StoreLe32(j, block);
+      std::memcpy(block + 4, messages[i].nonce, kNonceSize);
+    }
+  }
+  EcbEncrypt(kdf_ctx, blocks[0], messages.size() * blocks_per_message);
+  // Only the first half of every block is used.
+  for (size_t i = 0; i < messages.size(); i++) {
+    const uint8_t* derived = blocks[i * blocks_per_message];
+    std::memcpy(keys[i].auth_key, derived, 8);
+    std::memcpy(keys[i].auth_key + 8, derived + kBlockSize, 8);
+    for (int j = 2; j < blocks_per_message; j++) {
+      std::memcpy(keys[i].enc_key + 8 * (j - 2), derived + j * kBlockSize, 8);
+    }
+  }
+  OPENSSL_cleanse(blocks, sizeof(blocks));
+}
+
+// Computes the tag of 'plaintext' as in RFC 8452, section 4, with the
+// message encryption key in 'enc_ctx'.
+void ComputeTag(EVP_CIPHER_CTX* enc_ctx, const uint8_t auth_key[kBlockSize],
+                const uint8_t nonce[kNonceSize],
+                absl::string_view associated_data,
+                absl::Span<const uint8_t> plaintext, uint8_t tag[kBlockSize]) {
+  Polyval polyval(auth_key);
+  polyval.Update(absl::MakeConstSpan(ToUint8(associated_data.data()),
+                                     associated_data.size()));
+  polyval.Update(plaintext);
+  uint8_t lengths[kBlockSize];
+  StoreLe64(static_cast<uint64_t>(associated_data.size()) * 8, lengths);
+  StoreLe64(static_cast<uint64_t>(plaintext.size()) * 8, lengths + 8);
+  polyval.Update(absl::MakeConstSpan(lengths));
+  polyval.Finish(tag);
+  for (int i = 0; i < kNonceSize; i++) tag[i] ^= nonce[i];
+  tag[15] &= 0x7f;
+  EcbEncrypt(enc_ctx, tag, 1);
+}
+
+// XORs the AES-CTR keystream of RFC 8452, with the initial counter block
+// derived from 'tag', into 'in' and writes the result to 'out'.
+void CtrCrypt(EVP_CIPHER_CTX* enc_ctx, const uint8_t tag[kBlockSize],
+              absl::Span<const uint8_t> in, uint8_t* out) {
+  uint8_t keystream[kCtrChunkBlocks][kBlockSize];
+  uint32_t counter = LoadLe32(tag);
+  for (size_t offset = 0; offset < in.size();
+       offset += kCtrChunkBlocks * kBlockSize) {
+    size_t size = std::min<size_t>(kCtrChunkBlocks * kBlockSize,
+                                   in.size() - offset);
+    size_t num_blocks = (size + kBlockSize - 1) / kBlockSize;
+    for (size_t i = 0; i < num_blocks; i++) {
+      std::memcpy(keystream[i], tag, kBlockSize);
+      keystream[i][15] |= 0x80;
+      // The 32-bit counter wraps around.
+      StoreLe32(counter++, keystream[i]);
+    }
+    EcbEncrypt(enc_ctx, keystream[0], num_blocks);
+    for (size_t i = 0; i < size; i++) {
+      out[offset + i] = in[offset + i] ^ keystream[0][i];
+    }
+  }
+  OPENSSL_cleanse(keystream, sizeof(keystream));
+}
+
+// Sets up 'enc_ctx' for AES-ECB with the message encryption key of 'keys'.
+void InitEncCtx(const EVP_CIPHER* cipher, const DerivedKeys& keys,
+                EVP_CIPHER_CTX* enc_ctx) {
+  EVP_EncryptInit_ex(enc_ctx, cipher, nullptr, keys.enc_key, nullptr);
+  EVP_CIPHER_CTX_set_padding(enc_ctx, 0);
+}
+
+// Encrypts up to kGroupSize messages. 'kdf_ctx' is a copy of the key
+// derivation context of the primitive.
+void SealGroup(EVP_CIPHER_CTX* kdf_ctx, int key_size,
+               absl::Span<const SivMessage> messages) {
+  DerivedKeys keys[kGroupSize];
+  DeriveKeys(kdf_ctx, key_size, messages, keys);
+  const EVP_CIPHER* cipher = GetEcbCipherForKeySize(key_size);
+  bssl::ScopedEVP_CIPHER_CTX enc_ctx;
+  for (size_t i = 0; i < messages.size(); i++) {
+    const SivMessage& message = messages[i];
+    InitEncCtx(cipher, keys[i], enc_ctx.get());
+    absl::Span<const uint8_t> plaintext = absl::MakeConstSpan(
+        ToUint8(message.input.data()), message.input.size());
+    uint8_t* tag = message.output + message.input.size();
+    ComputeTag(enc_ctx.get(), keys[i].auth_key, message.nonce,
+               message.associated_data, plaintext, tag);
+    CtrCrypt(enc_ctx.get(), tag, plaintext, message.output);
+  }
+  OPENSSL_cleanse(keys, sizeof(keys));
+}
+
+// Decrypts up to kGroupSize messages. Returns false if a tag is invalid, in
+// which case the output of that message is wiped.
+bool OpenGroup(EVP_CIPHER_CTX* kdf_ctx, int key_size,
+               absl::Span<const SivMessage> messages) {
+  DerivedKeys keys[kGroupSize];
+  DeriveKeys(kdf_ctx, key_size, messages, keys);
+  const EVP_CIPHER* cipher = GetEcbCipherForKeySize(key_size);
+  bssl::ScopedEVP_CIPHER_CTX enc_ctx;
+  bool valid = true;
+  for (size_t i = 0; i < messages.size() && valid; i++) {
+    const SivMessage& message = messages[i];
+    InitEncCtx(cipher, keys[i], enc_ctx.get());
+    const uint8_t* tag = ToUint8(message.input.data()) + message.input.size();
+    CtrCrypt(enc_ctx.get(), tag,
+             absl::MakeConstSpan(ToUint8(message.input.data()),
+                                 message.input.size()),
+             message.output);
+    uint8_t expected_tag[kBlockSize];
+    ComputeTag(enc_ctx.get(), keys[i].auth_key, message.nonce,
+               message.associated_data,
+               absl::MakeConstSpan(message.output, message.input.size()),
+               expected_tag);
+    if (CRYPTO_memcmp(expected_tag, tag, kBlockSize) != 0) {
+      OPENSSL_cleanse(message.output, message.input.size());
+      valid = false;
+    }
+  }
+  OPENSSL_cleanse(keys, sizeof(keys));
+  return valid;
+}
+
 }  // namespace
 
 util::StatusOr<std::unique_ptr<Aead>> AesGcmSivBoringSsl::New(
@@ -58,43 +257,100 @@ util::StatusOr<std::unique_ptr<Aead>> AesGcmSivBoringSsl::New(
     return util::Status(util::error::INTERNAL,
                         "could not initialize EVP_AEAD_CTX");
   }
-  return {absl::WrapUnique(new AesGcmSivBoringSsl(std::move(ctx)))};
+  bssl::UniquePtr<EVP_CIPHER_CTX> kdf_ctx(EVP_CIPHER_CTX_new());
+  if (!kdf_ctx ||
+      EVP_EncryptInit_ex(kdf_ctx.get(), GetEcbCipherForKeySize(key.size()),
+                         nullptr, key.data(), nullptr) != 1) {
+    return util::Status(util::error::INTERNAL,
+                        "could not initialize EVP_CIPHER_CTX");
+  }
+  EVP_CIPHER_CTX_set_padding(kdf_ctx.get(), 0);
+  return {absl::WrapUnique(
+      new AesGcmSivBoringSsl(std::move(ctx), std::move(kdf_ctx)))};
 }
 
 util::StatusOr<std::string> AesGcmSivBoringSsl::Encrypt(
     absl::string_view plaintext, absl::string_view additional_data) const {
-  std::string ciphertext = Random::GetRandomBytes(kIvSizeInBytes);
+  std::string ciphertext;
   ResizeStringUninitialized(
       &ciphertext, kIvSizeInBytes + plaintext.size() + kTagSizeInBytes);
+  auto written_result =
+      EncryptInto(plaintext, additional_data, absl::MakeSpan(ciphertext));
+  if (!written_result.ok()) return written_result.status();
+  return ciphertext;
+}
+
+util::StatusOr<std::string> AesGcmSivBoringSsl::Decrypt(
+    absl::string_view ciphertext, absl::string_view additional_data) const {
+  if (ciphertext.size() < kIvSizeInBytes + kTagSizeInBytes) {
+    return util::CiphertextTooShortError();
+  }
+
+  std::string plaintext;
+  ResizeStringUninitialized(
+      &plaintext, ciphertext.size() - kIvSizeInBytes - kTagSizeInBytes);
+  auto written_result =
+      DecryptInto(ciphertext, additional_data, absl::MakeSpan(plaintext));
+  if (!written_result.ok()) return written_result.status();
+  return plaintext;
+}
+
+util::StatusOr<int64_t> AesGcmSivBoringSsl::CiphertextSize(
+    int64_t plaintext_size) const {
+  return kIvSizeInBytes + plaintext_size + kTagSizeInBytes;
+}
+
+util::StatusOr<int64_t> AesGcmSivBoringSsl::EncryptInto(
+    absl::string_view plaintext, absl::string_view additional_data,
+    absl::Span<char> buffer) const {
+  // BoringSSL expects a non-null pointer for plaintext and additional_data,
+  // regardless of whether the size is 0.
+  plaintext = SubtleUtilBoringSSL::EnsureNonNull(plaintext);
+  additional_data = SubtleUtilBoringSSL::EnsureNonNull(additional_data);
+
+  size_t ciphertext_size = kIvSizeInBytes + plaintext.size() + kTagSizeInBytes;
+  if (buffer.size() < ciphertext_size) {
+    return util::Status(util::error::INVALID_ARGUMENT, "Buffer too small");
+  }
+  Random::FillRandomBytes(buffer.subspan(0, kIvSizeInBytes));
   size_t len;
   if (EVP_AEAD_CTX_seal(
-          ctx_.get(), reinterpret_cast<uint8_t*>(&ciphertext[kIvSizeInBytes]),
-          &len, ciphertext.size() - kIvSizeInBytes,
-          reinterpret_cast<const uint8_t*>(&ciphertext[0]), kIvSizeInBytes,
+          ctx_.get(), reinterpret_cast<uint8_t*>(&buffer[kIvSizeInBytes]),
+          &len, ciphertext_size - kIvSizeInBytes,
+          reinterpret_cast<const uint8_t*>(buffer.data()), kIvSizeInBytes,
           reinterpret_cast<const uint8_t*>(plaintext.data()), plaintext.size(),
           reinterpret_cast<const uint8_t*>(additional_data.data()),
           additional_data.size()) != 1) {
     return util::Status(util::error::INTERNAL, "Encryption failed");
   }
-  if (len != ciphertext.size() - kIvSizeInBytes) {
+  if (len != ciphertext_size - kIvSizeInBytes) {
     return util::Status(util::error::INTERNAL, "incorrect ciphertext size");
   }
-  return ciphertext;
+  return ciphertext_size;
 }
 
-util::StatusOr<std::string> AesGcmSivBoringSsl::Decrypt(
-    absl::string_view ciphertext, absl::string_view additional_data) const {
+util::StatusOr<int64_t> AesGcmSivBoringSsl::DecryptInto(
+    absl::string_view ciphertext, absl::string_view additional_data,
+    absl::Span<char> buffer) const {
+  // BoringSSL expects a non-null pointer for additional_data,
+  // regardless of whether the size is 0.
+  additional_data = SubtleUtilBoringSSL::EnsureNonNull(additional_data);
+
   if (ciphertext.size() < kIvSizeInBytes + kTagSizeInBytes) {
-    return util::Status(util::error::INVALID_ARGUMENT, "Ciphertext too short");
+    return util::CiphertextTooShortError();
   }
-
-  std::string plaintext;
-  ResizeStringUninitialized(
-      &plaintext, ciphertext.size() - kIvSizeInBytes - kTagSizeInBytes);
+  size_t plaintext_size = ciphertext.size() - kIvSizeInBytes - kTagSizeInBytes;
+  if (buffer.size() < plaintext_size) {
+    return util::Status(util::error::INVALID_ARGUMENT, "Buffer too small");
+  }
+  // BoringSSL expects a non-null pointer for the output, regardless of
+  // whether the size is 0.
+  char dummy;
+  uint8_t* out = reinterpret_cast<uint8_t*>(
+      buffer.data() != nullptr ? buffer.data() : &dummy);
   size_t len;
   if (EVP_AEAD_CTX_open(
-          ctx_.get(), reinterpret_cast<uint8_t*>(&plaintext[0]), &len,
-          plaintext.size(),
+          ctx_.get(), out, &len, plaintext_size,
           // The nonce is the first |kIvSizeInBytes| bytes of |ciphertext|.
           reinterpret_cast<const uint8_t*>(ciphertext.data()), kIvSizeInBytes,
           // The input is the remainder.
@@ -102,12 +358,110 @@ util::StatusOr<std::string> AesGcmSivBoringSsl::Decrypt(
           ciphertext.size() - kIvSizeInBytes,
           reinterpret_cast<const uint8_t*>(additional_data.data()),
           additional_data.size()) != 1) {
-    return util::Status(util::error::INTERNAL, "Authentication failed");
+    return util::AuthenticationFailedError();
   }
-  if (len != plaintext.size()) {
+  if (len != plaintext_size) {
     return util::Status(util::error::INTERNAL, "incorrect ciphertext size");
   }
-  return plaintext;
+  return len;
+}
+
+util::Status AesGcmSivBoringSsl::BatchEncrypt(
+    absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs,
+    std::string* arena, std::vector<absl::string_view>* ciphertexts) const {
+  if (!Polyval::IsAccelerated()) {
+    return Aead::BatchEncrypt(inputs, arena, ciphertexts);
+  }
+  std::vector<int64_t> sizes;
+  sizes.reserve(inputs.size());
+  int64_t total_size = 0;
+  for (const auto& input : inputs) {
+    sizes.push_back(kIvSizeInBytes + input.first.size() + kTagSizeInBytes);
+    total_size += sizes.back();
+  }
+  ResizeStringUninitialized(arena, total_size);
+
+  bssl::ScopedEVP_CIPHER_CTX kdf_ctx;
+  if (EVP_CIPHER_CTX_copy(kdf_ctx.get(), kdf_ctx_.get()) != 1) {
+    return util::Status(util::error::INTERNAL, "EVP_CIPHER_CTX_copy failed");
+  }
+  const int key_size = EVP_CIPHER_CTX_key_length(kdf_ctx.get());
+  std::vector<SivMessage> messages;
+  messages.reserve(kGroupSize);
+  int64_t offset = 0;
+  for (size_t i = 0; i < inputs.size(); i++) {
+    char* out = &(*arena)[0] + offset;
+    offset += sizes[i];
+    if (inputs[i].first.size() > kMaxBatchMessageSize) {
+      auto written_result = EncryptInto(inputs[i].first, inputs[i].second,
+                                        absl::MakeSpan(out, sizes[i]));
+      if (!written_result.ok()) return written_result.status();
+      continue;
+    }
+    Random::FillRandomBytes(absl::MakeSpan(out, kIvSizeInBytes));
+    messages.push_back({inputs[i].first, inputs[i].second, ToUint8(out),
+                        reinterpret_cast<uint8_t*>(out) + kIvSizeInBytes});
+    if (messages.size() == kGroupSize) {
+      SealGroup(kdf_ctx.get(), key_size, messages);
+      messages.clear();
+    }
+  }
+  if (!messages.empty()) SealGroup(kdf_ctx.get(), key_size, messages);
+  SplitArena(*arena, sizes, ciphertexts);
+  return util::Status::OK;
+}
+
+util::Status AesGcmSivBoringSsl::BatchDecrypt(
+    absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs,
+    std::string* arena, std::vector<absl::string_view>* plaintexts) const {
+  if (!Polyval::IsAccelerated()) {
+    return Aead::BatchDecrypt(inputs, arena, plaintexts);
+  }
+  std::vector<int64_t> sizes;
+  sizes.reserve(inputs.size());
+  int64_t total_size = 0;
+  for (const auto& input : inputs) {
+    if (input.first.size() < kIvSizeInBytes + kTagSizeInBytes) {
+      return util::CiphertextTooShortError();
+    }
+    sizes.push_back(input.first.size() - kIvSizeInBytes - kTagSizeInBytes);
+    total_size += sizes.back();
+  }
+  ResizeStringUninitialized(arena, total_size);
+
+  bssl::ScopedEVP_CIPHER_CTX kdf_ctx;
+  if (EVP_CIPHER_CTX_copy(kdf_ctx.get(), kdf_ctx_.get()) != 1) {
+    return util::Status(util::error::INTERNAL, "EVP_CIPHER_CTX_copy failed");
+  }
+  const int key_size = EVP_CIPHER_CTX_key_length(kdf_ctx.get());
+  std::vector<SivMessage> messages;
+  messages.reserve(kGroupSize);
+  int64_t offset = 0;
+  for (size_t i = 0; i < inputs.size(); i++) {
+    char* out = &(*arena)[0] + offset;
+    offset += sizes[i];
+    absl::string_view ciphertext = inputs[i].first;
+    if (static_cast<size_t>(sizes[i]) > kMaxBatchMessageSize) {
+      auto written_result = DecryptInto(ciphertext, inputs[i].second,
+                                        absl::MakeSpan(out, sizes[i]));
+      if (!written_result.ok()) return written_result.status();
+      continue;
+    }
+    messages.push_back({ciphertext.substr(kIvSizeInBytes, sizes[i]),
+                        inputs[i].second, ToUint8(ciphertext.data()),
+                        reinterpret_cast<uint8_t*>(out)});
+    if (messages.size() == kGroupSize) {
+      if (!OpenGroup(kdf_ctx.get(), key_size, messages)) {
+        return util::AuthenticationFailedError();
+      }
+      messages.clear();
+    }
+  }
+  if (!messages.empty() && !OpenGroup(kdf_ctx.get(), key_size, messages)) {
+    return util::AuthenticationFailedError();
+  }
+  SplitArena(*arena, sizes, plaintexts);
+  return util::Status::OK;
 }
 
 }  // namespace subtle
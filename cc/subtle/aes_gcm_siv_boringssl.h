@@ -18,10 +18,14 @@
 #define TINK_SUBTLE_AES_GCM_SIV_BORINGSSL_H_
 
 #include <memory>
+#include <string>
 #include <utility>
+#include <vector>
 
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "openssl/aead.h"
+#include "openssl/cipher.h"
 #include "tink/aead.h"
 #include "tink/config/tink_fips.h"
 #include "tink/util/secret_data.h"
@@ -61,6 +65,31 @@ class AesGcmSivBoringSsl : public Aead {
       absl::string_view ciphertext,
       absl::string_view additional_data) const override;
 
+  crypto::tink::util::StatusOr<int64_t> CiphertextSize(
+      int64_t plaintext_size) const override;
+
+  crypto::tink::util::StatusOr<int64_t> EncryptInto(
+      absl::string_view plaintext, absl::string_view additional_data,
+      absl::Span<char> buffer) const override;
+
+  crypto::tink::util::StatusOr<int64_t> DecryptInto(
+      absl::string_view ciphertext, absl::string_view additional_data,
+      absl::Span<char> buffer) const override;
+
+  // The batch methods derive the per-nonce keys of up to eight messages with
+  // one pipelined AES-ECB pass, and compute POLYVAL with carry-less
+  // multiplication, see Polyval. Without it, and for long messages, they
+  // fall back to EncryptInto() and DecryptInto().
+  crypto::tink::util::Status BatchEncrypt(
+      absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs,
+      std::string* arena,
+      std::vector<absl::string_view>* ciphertexts) const override;
+
+  crypto::tink::util::Status BatchDecrypt(
+      absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs,
+      std::string* arena,
+      std::vector<absl::string_view>* plaintexts) const override;
+
   static constexpr crypto::tink::FipsCompatibility kFipsStatus =
       crypto::tink::FipsCompatibility::kNotFips;
 
@@ -68,10 +97,19 @@ class AesGcmSivBoringSsl : public Aead {
   static constexpr int kIvSizeInBytes = 12;
   static constexpr int kTagSizeInBytes = 16;
 
-  explicit AesGcmSivBoringSsl(bssl::UniquePtr<EVP_AEAD_CTX> ctx)
-      : ctx_(std::move(ctx)) {}
+  // Messages of up to this many bytes are processed by the batch engine.
+  // BoringSSL is as fast for longer ones.
+  static constexpr size_t kMaxBatchMessageSize = 4096;
+
+  AesGcmSivBoringSsl(bssl::UniquePtr<EVP_AEAD_CTX> ctx,
+                     bssl::UniquePtr<EVP_CIPHER_CTX> kdf_ctx)
+      : ctx_(std::move(ctx)), kdf_ctx_(std::move(kdf_ctx)) {}
 
   bssl::UniquePtr<EVP_AEAD_CTX> ctx_;
+  // AES-ECB with the key-generating key, for the key derivation of the
+  // batch methods. Copied for every batch, as EVP_CIPHER_CTX is not
+  // thread-safe.
+  const bssl::UniquePtr<EVP_CIPHER_CTX> kdf_ctx_;
 };
 
 }  // namespace subtle
@@ -17,12 +17,16 @@
 #include "tink/subtle/aes_gcm_siv_boringssl.h"
 
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
 #include "openssl/err.h"
 #include "include/rapidjson/document.h"
+#include "tink/subtle/random.h"
 #include "tink/subtle/wycheproof_util.h"
 #include "tink/util/secret_data.h"
 #include "tink/util/status.h"
@@ -35,6 +39,7 @@ namespace tink {
 namespace subtle {
 namespace {
 
+using ::crypto::tink::test::IsOk;
 using ::crypto::tink::test::StatusIs;
 
 TEST(AesGcmSivBoringSslTest, Basic) {
@@ -61,6 +66,58 @@ TEST(AesGcmSivBoringSslTest, Basic) {
   EXPECT_EQ(pt.ValueOrDie(), message);
 }
 
+TEST(AesGcmSivBoringSslTest, EncryptIntoDecryptInto) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+
+  util::SecretData key = util::SecretDataFromStringView(
+      test::HexDecodeOrDie("000102030405060708090a0b0c0d0e0f"));
+  auto res = AesGcmSivBoringSsl::New(key);
+  ASSERT_TRUE(res.ok()) << res.status();
+  auto cipher = std::move(res.ValueOrDie());
+  std::string message = "Some data to encrypt.";
+  std::string aad = "Some data to authenticate.";
+
+  auto size_result = cipher->CiphertextSize(message.size());
+  ASSERT_TRUE(size_result.ok()) << size_result.status();
+  EXPECT_EQ(size_result.ValueOrDie(), message.size() + 12 + 16);
+
+  // Too small buffers are rejected.
+  std::string ct(size_result.ValueOrDie() - 1, '\0');
+  EXPECT_THAT(
+      cipher->EncryptInto(message, aad, absl::MakeSpan(ct)).status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+
+  ct.resize(size_result.ValueOrDie());
+  auto written = cipher->EncryptInto(message, aad, absl::MakeSpan(ct));
+  ASSERT_TRUE(written.ok()) << written.status();
+  EXPECT_EQ(written.ValueOrDie(), ct.size());
+
+  // Ciphertexts of EncryptInto() and Encrypt() are interchangeable.
+  auto pt = cipher->Decrypt(ct, aad);
+  ASSERT_TRUE(pt.ok()) << pt.status();
+  EXPECT_EQ(pt.ValueOrDie(), message);
+
+  std::string decrypted(message.size() - 1, '\0');
+  EXPECT_THAT(
+      cipher->DecryptInto(ct, aad, absl::MakeSpan(decrypted)).status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+  decrypted.resize(ct.size());
+  written = cipher->DecryptInto(ct, aad, absl::MakeSpan(decrypted));
+  ASSERT_TRUE(written.ok()) << written.status();
+  EXPECT_EQ(decrypted.substr(0, written.ValueOrDie()), message);
+
+  std::string ct2 = cipher->Encrypt(message, aad).ValueOrDie();
+  written = cipher->DecryptInto(ct2, aad, absl::MakeSpan(decrypted));
+  ASSERT_TRUE(written.ok()) << written.status();
+  EXPECT_EQ(decrypted.substr(0, written.ValueOrDie()), message);
+
+  // Modified ciphertexts fail.
+  ct[ct.size() - 1] ^= 1;
+  EXPECT_FALSE(cipher->DecryptInto(ct, aad, absl::MakeSpan(decrypted)).ok());
+}
+
 TEST(AesGcmSivBoringSslTest, Sizes) {
   if (kUseOnlyFips) {
     GTEST_SKIP() << "Not supported in FIPS-only mode";
@@ -242,6 +299,91 @@ TEST(AesGcmSivBoringSslTest, InvalidKeySizes) {
   }
 }
 
+// Plaintexts of many sizes, including some which exceed the size limit of
+// the batch engine.
+std::vector<std::string> BatchPlaintexts() {
+  std::vector<std::string> plaintexts;
+  for (int size = 0; size < 300; size += 13) {
+    plaintexts.push_back(Random::GetRandomBytes(size));
+  }
+  plaintexts.push_back(Random::GetRandomBytes(4096));
+  plaintexts.push_back(Random::GetRandomBytes(4097));
+  return plaintexts;
+}
+
+TEST(AesGcmSivBoringSslTest, BatchEncrypt) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+
+  for (int key_size : {16, 32}) {
+    util::SecretData key = Random::GetRandomKeyBytes(key_size);
+    auto cipher = std::move(AesGcmSivBoringSsl::New(key).ValueOrDie());
+    std::vector<std::string> plaintexts = BatchPlaintexts();
+    std::vector<std::string> aads;
+    for (size_t i = 0; i < plaintexts.size(); i++) {
+      aads.push_back(Random::GetRandomBytes(i % 37));
+    }
+    std::vector<std::pair<absl::string_view, absl::string_view>> inputs;
+    for (size_t i = 0; i < plaintexts.size(); i++) {
+      inputs.push_back({plaintexts[i], aads[i]});
+    }
+
+    std::string arena;
+    std::vector<absl::string_view> ciphertexts;
+    ASSERT_THAT(cipher->BatchEncrypt(inputs, &arena, &ciphertexts), IsOk());
+    ASSERT_EQ(ciphertexts.size(), plaintexts.size());
+    for (size_t i = 0; i < plaintexts.size(); i++) {
+      auto pt = cipher->Decrypt(ciphertexts[i], aads[i]);
+      ASSERT_TRUE(pt.ok()) << "size " << plaintexts[i].size() << ": "
+                           << pt.status();
+      EXPECT_EQ(pt.ValueOrDie(), plaintexts[i]);
+    }
+  }
+}
+
+TEST(AesGcmSivBoringSslTest, BatchDecrypt) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+
+  for (int key_size : {16, 32}) {
+    util::SecretData key = Random::GetRandomKeyBytes(key_size);
+    auto cipher = std::move(AesGcmSivBoringSsl::New(key).ValueOrDie());
+    std::vector<std::string> plaintexts = BatchPlaintexts();
+    std::string aad = "Some data to authenticate.";
+    std::vector<std::string> ciphertexts;
+    for (const std::string& plaintext : plaintexts) {
+      ciphertexts.push_back(cipher->Encrypt(plaintext, aad).ValueOrDie());
+    }
+    std::vector<std::pair<absl::string_view, absl::string_view>> inputs;
+    for (const std::string& ciphertext : ciphertexts) {
+      inputs.push_back({ciphertext, aad});
+    }
+
+    std::string arena;
+    std::vector<absl::string_view> decrypted;
+    ASSERT_THAT(cipher->BatchDecrypt(inputs, &arena, &decrypted), IsOk());
+    ASSERT_EQ(decrypted.size(), plaintexts.size());
+    for (size_t i = 0; i < plaintexts.size(); i++) {
+      EXPECT_EQ(decrypted[i], plaintexts[i]);
+    }
+
+    for (size_t i : {0, 5, 11}) {
+      std::string modified = ciphertexts[i];
+      modified[modified.size() - 1] ^= 1;
+      auto modified_inputs = inputs;
+      modified_inputs[i].first = modified;
+      EXPECT_THAT(cipher->BatchDecrypt(modified_inputs, &arena, &decrypted),
+                  StatusIs(util::error::INTERNAL));
+    }
+    auto modified_inputs = inputs;
+    modified_inputs[3].first = ciphertexts[3].substr(0, 27);
+    EXPECT_THAT(cipher->BatchDecrypt(modified_inputs, &arena, &decrypted),
+                StatusIs(util::error::INVALID_ARGUMENT));
+  }
+}
+
 // Test with test vectors from Wycheproof project.
 bool WycheproofTest(const rapidjson::Document& root) {
   int errors = 0;
@@ -271,6 +413,19 @@ bool WycheproofTest(const rapidjson::Document& root) {
       // Tests decryption only, since the AEAD interface does
       // not allow to set the nonce.
       auto dec = cipher->Decrypt(nonce + ct + tag, aad);
+      // The batch path has its own implementation, and must agree.
+      std::string ciphertext = nonce + ct + tag;
+      std::vector<std::pair<absl::string_view, absl::string_view>> inputs = {
+          {ciphertext, aad}};
+      std::string arena;
+      std::vector<absl::string_view> batch_decrypted;
+      auto batch_status =
+          cipher->BatchDecrypt(inputs, &arena, &batch_decrypted);
+      if (batch_status.ok() != dec.ok() ||
+          (dec.ok() && batch_decrypted[0] != dec.ValueOrDie())) {
+        ADD_FAILURE() << "BatchDecrypt disagrees with Decrypt:" << id;
+        errors++;
+      }
       if (dec.ok()) {
         std::string decrypted = dec.ValueOrDie();
         if (expected == "invalid") {
@@ -0,0 +1,169 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/subtle/aes_gcm_siv_deterministic_boringssl.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/types/span.h"
+#include "openssl/aead.h"
+#include "openssl/aes.h"
+#include "openssl/crypto.h"
+#include "tink/config/tink_fips.h"
+#include "tink/subtle/polyval.h"
+#include "tink/subtle/subtle_util.h"
+#include "tink/subtle/subtle_util_boringssl.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+namespace {
+
+constexpr int kKeySizeInBytes = 32;
+
+void StoreLe64(uint64_t value, uint8_t* out) {
+  for (int i = 0; i < 8; i++) out[i] = value >> (8 * i);
+}
+
+absl::Span<const uint8_t> ToSpan(absl::string_view data) {
+  return absl::MakeConstSpan(reinterpret_cast<const uint8_t*>(data.data()),
+                             data.size());
+}
+
+}  // namespace
+
+// static
+util::StatusOr<std::unique_ptr<DeterministicAead>>
+AesGcmSivDeterministicBoringSsl::New(const util::SecretData& key) {
+  auto status = CheckFipsCompatibility<AesGcmSivDeterministicBoringSsl>();
+  if (!status.ok()) return status;
+
+  if (!IsValidKeySizeInBytes(key.size())) {
+    return util::Status(util::error::INVALID_ARGUMENT, "invalid key size");
+  }
+  util::SecretUniquePtr<NonceKeys> nonce_keys =
+      util::MakeSecretUniquePtr<NonceKeys>();
+  if (AES_set_encrypt_key(key.data(), 8 * kKeySizeInBytes,
+                          &nonce_keys->aes_key) != 0) {
+    return util::Status(util::error::INTERNAL, "could not initialize aes key");
+  }
+  uint8_t zero[kBlockSize] = {0};
+  AES_encrypt(zero, nonce_keys->polyval_key, &nonce_keys->aes_key);
+  bssl::UniquePtr<EVP_AEAD_CTX> ctx(
+      EVP_AEAD_CTX_new(EVP_aead_aes_256_gcm_siv(), key.data() + kKeySizeInBytes,
+                       kKeySizeInBytes, EVP_AEAD_DEFAULT_TAG_LENGTH));
+  if (!ctx) {
+    return util::Status(util::error::INTERNAL,
+                        "could not initialize EVP_AEAD_CTX");
+  }
+  return {absl::WrapUnique(new AesGcmSivDeterministicBoringSsl(
+      std::move(nonce_keys), std::move(ctx)))};
+}
+
+void AesGcmSivDeterministicBoringSsl::ComputeNonce(
+    absl::string_view plaintext, absl::string_view associated_data,
+    uint8_t nonce[kNonceSizeInBytes]) const {
+  Polyval polyval(nonce_keys_->polyval_key);
+  polyval.Update(ToSpan(associated_data));
+  polyval.Update(ToSpan(plaintext));
+  uint8_t lengths[kBlockSize];
+  StoreLe64(static_cast<uint64_t>(associated_data.size()) * 8, lengths);
+  StoreLe64(static_cast<uint64_t>(plaintext.size()) * 8, lengths + 8);
+  polyval.Update(absl::MakeConstSpan(lengths));
+  uint8_t block[kBlockSize];
+  polyval.Finish(block);
+  // Setting the most significant bit separates the inputs of the PRF from
+  // the zero block, from which the POLYVAL key is derived.
+  block[kBlockSize - 1] |= 0x80;
+  AES_encrypt(block, block, &nonce_keys_->aes_key);
+  std::memcpy(nonce, block, kNonceSizeInBytes);
+}
+
+util::StatusOr<std::string>
+AesGcmSivDeterministicBoringSsl::EncryptDeterministically(
+    absl::string_view plaintext, absl::string_view associated_data) const {
+  // BoringSSL expects a non-null pointer for plaintext and associated_data,
+  // regardless of whether the size is 0.
+  plaintext = SubtleUtilBoringSSL::EnsureNonNull(plaintext);
+  associated_data = SubtleUtilBoringSSL::EnsureNonNull(associated_data);
+
+  std::string ciphertext;
+  ResizeStringUninitialized(
+      &ciphertext, kNonceSizeInBytes + plaintext.size() + kTagSizeInBytes);
+  uint8_t* out = reinterpret_cast<uint8_t*>(&ciphertext[0]);
+  ComputeNonce(plaintext, associated_data, out);
+  size_t len;
+  if (EVP_AEAD_CTX_seal(
+          ctx_.get(), out + kNonceSizeInBytes, &len,
+          ciphertext.size() - kNonceSizeInBytes, out, kNonceSizeInBytes,
+          reinterpret_cast<const uint8_t*>(plaintext.data()), plaintext.size(),
+          reinterpret_cast<const uint8_t*>(associated_data.data()),
+          associated_data.size()) != 1) {
+    return util::Status(util::error::INTERNAL, "Encryption failed");
+  }
+  if (len != ciphertext.size() - kNonceSizeInBytes) {
+    return util::Status(util::error::INTERNAL, "incorrect ciphertext size");
+  }
+  return ciphertext;
+}
+
+util::StatusOr<std::string>
+AesGcmSivDeterministicBoringSsl::DecryptDeterministically(
+    absl::string_view ciphertext, absl::string_view associated_data) const {
+  associated_data = SubtleUtilBoringSSL::EnsureNonNull(associated_data);
+
+  if (ciphertext.size() < kNonceSizeInBytes + kTagSizeInBytes) {
+    return util::CiphertextTooShortError();
+  }
+  const uint8_t* nonce = reinterpret_cast<const uint8_t*>(ciphertext.data());
+  std::string plaintext;
+  ResizeStringUninitialized(
+      &plaintext, ciphertext.size() - kNonceSizeInBytes - kTagSizeInBytes);
+  // BoringSSL expects a non-null pointer for the output, regardless of
+  // whether the size is 0.
+  uint8_t dummy;
+  uint8_t* out =
+      plaintext.empty() ? &dummy : reinterpret_cast<uint8_t*>(&plaintext[0]);
+  size_t len;
+  if (EVP_AEAD_CTX_open(
+          ctx_.get(), out, &len, plaintext.size(), nonce, kNonceSizeInBytes,
+          nonce + kNonceSizeInBytes, ciphertext.size() - kNonceSizeInBytes,
+          reinterpret_cast<const uint8_t*>(associated_data.data()),
+          associated_data.size()) != 1) {
+    return util::AuthenticationFailedError();
+  }
+  if (len != plaintext.size()) {
+    return util::Status(util::error::INTERNAL, "incorrect ciphertext size");
+  }
+  uint8_t expected_nonce[kNonceSizeInBytes];
+  ComputeNonce(plaintext, associated_data, expected_nonce);
+  if (CRYPTO_memcmp(expected_nonce, nonce, kNonceSizeInBytes) != 0) {
+    util::SafeZeroMemory(&plaintext[0], plaintext.size());
+    return util::AuthenticationFailedError();
+  }
+  return plaintext;
+}
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
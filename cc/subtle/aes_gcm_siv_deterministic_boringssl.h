@@ -0,0 +1,102 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_SUBTLE_AES_GCM_SIV_DETERMINISTIC_BORINGSSL_H_
+#define TINK_SUBTLE_AES_GCM_SIV_DETERMINISTIC_BORINGSSL_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/strings/string_view.h"
+#include "openssl/aead.h"
+#include "openssl/aes.h"
+#include "tink/config/tink_fips.h"
+#include "tink/deterministic_aead.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+// A deterministic AEAD which encrypts with AES-256-GCM-SIV (RFC 8452) under
+// a synthetic nonce. The ciphertext of a plaintext P with associated data A
+// is
+//   N || AES-GCM-SIV(K2, N, P, A),
+// where the 12-byte nonce N is the first bytes of AES-256(K1, S | 2^127),
+// and S is the POLYVAL under H = AES-256(K1, 0^128) of A and P, padded and
+// followed by their lengths as in the tag of AES-GCM-SIV. The nonce is a
+// PRF of (A, P), and as AES-GCM-SIV is nonce misuse-resistant, encrypting
+// equal pairs with equal nonces reveals only that they are equal.
+//
+// Both passes over the message are POLYVAL and AES-CTR, so on CPUs with
+// AES and carry-less multiplication instructions this is several times
+// faster per byte than AES-SIV, whose S2V uses AES-CMAC. Decryption checks
+// that the nonce is the synthetic nonce of the decrypted plaintext, so that
+// every plaintext has a single valid ciphertext.
+//
+// Thread safety: This class is thread safe and thus can be used
+// concurrently.
+class AesGcmSivDeterministicBoringSsl : public DeterministicAead {
+ public:
+  // 'key' is K1 || K2, of 32 bytes each.
+  static crypto::tink::util::StatusOr<std::unique_ptr<DeterministicAead>> New(
+      const util::SecretData& key);
+
+  crypto::tink::util::StatusOr<std::string> EncryptDeterministically(
+      absl::string_view plaintext,
+      absl::string_view associated_data) const override;
+
+  crypto::tink::util::StatusOr<std::string> DecryptDeterministically(
+      absl::string_view ciphertext,
+      absl::string_view associated_data) const override;
+
+  static bool IsValidKeySizeInBytes(size_t size) { return size == 64; }
+
+  static constexpr crypto::tink::FipsCompatibility kFipsStatus =
+      crypto::tink::FipsCompatibility::kNotFips;
+
+ private:
+  static constexpr int kBlockSize = 16;
+  static constexpr int kNonceSizeInBytes = 12;
+  static constexpr int kTagSizeInBytes = 16;
+
+  // The key material of the nonce PRF.
+  struct NonceKeys {
+    AES_KEY aes_key;
+    uint8_t polyval_key[kBlockSize];
+  };
+
+  AesGcmSivDeterministicBoringSsl(util::SecretUniquePtr<NonceKeys> nonce_keys,
+                                  bssl::UniquePtr<EVP_AEAD_CTX> ctx)
+      : nonce_keys_(std::move(nonce_keys)), ctx_(std::move(ctx)) {}
+
+  // Writes the synthetic nonce of ('plaintext', 'associated_data').
+  void ComputeNonce(absl::string_view plaintext,
+                    absl::string_view associated_data,
+                    uint8_t nonce[kNonceSizeInBytes]) const;
+
+  const util::SecretUniquePtr<NonceKeys> nonce_keys_;
+  const bssl::UniquePtr<EVP_AEAD_CTX> ctx_;
+};
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_SUBTLE_AES_GCM_SIV_DETERMINISTIC_BORINGSSL_H_
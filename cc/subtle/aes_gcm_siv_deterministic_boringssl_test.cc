@@ -0,0 +1,223 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/subtle/aes_gcm_siv_deterministic_boringssl.h"
+
+#include <string>
+#include <utility>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "openssl/aead.h"
+#include "tink/config/tink_fips.h"
+#include "tink/subtle/random.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "tink/util/test_matchers.h"
+#include "tink/util/test_util.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+namespace {
+
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::testing::Eq;
+using ::testing::Ne;
+
+util::SecretData TestKey() {
+  return util::SecretDataFromStringView(test::HexDecodeOrDie(
+      "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"
+      "00112233445566778899aabbccddeefff0f1f2f3f4f5f6f7f8f9fafbfcfdfeff"));
+}
+
+TEST(AesGcmSivDeterministicBoringSslTest, EncryptDecrypt) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  auto cipher =
+      std::move(AesGcmSivDeterministicBoringSsl::New(TestKey()).ValueOrDie());
+  for (int pt_size : {0, 1, 15, 16, 17, 100, 1000}) {
+    for (int aad_size : {0, 1, 16, 33}) {
+      SCOPED_TRACE(absl::StrCat("pt_size = ", pt_size,
+                                ", aad_size = ", aad_size));
+      std::string message = Random::GetRandomBytes(pt_size);
+      std::string aad = Random::GetRandomBytes(aad_size);
+      auto ct = cipher->EncryptDeterministically(message, aad);
+      ASSERT_THAT(ct.status(), IsOk());
+      EXPECT_THAT(ct.ValueOrDie().size(), Eq(12 + pt_size + 16));
+      auto pt = cipher->DecryptDeterministically(ct.ValueOrDie(), aad);
+      ASSERT_THAT(pt.status(), IsOk());
+      EXPECT_THAT(pt.ValueOrDie(), Eq(message));
+    }
+  }
+}
+
+TEST(AesGcmSivDeterministicBoringSslTest, NullPtrStringView) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  auto cipher =
+      std::move(AesGcmSivDeterministicBoringSsl::New(TestKey()).ValueOrDie());
+  absl::string_view null;
+  auto ct = cipher->EncryptDeterministically(null, null);
+  ASSERT_THAT(ct.status(), IsOk());
+  auto pt = cipher->DecryptDeterministically(ct.ValueOrDie(), null);
+  ASSERT_THAT(pt.status(), IsOk());
+  EXPECT_THAT(pt.ValueOrDie(), Eq(""));
+  // The empty and the null string are the same.
+  EXPECT_THAT(cipher->EncryptDeterministically("", "").ValueOrDie(),
+              Eq(ct.ValueOrDie()));
+}
+
+TEST(AesGcmSivDeterministicBoringSslTest, Deterministic) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  auto cipher =
+      std::move(AesGcmSivDeterministicBoringSsl::New(TestKey()).ValueOrDie());
+  std::string ct = cipher->EncryptDeterministically("message", "aad")
+                       .ValueOrDie();
+  EXPECT_THAT(cipher->EncryptDeterministically("message", "aad").ValueOrDie(),
+              Eq(ct));
+  // Moving bytes between the plaintext and the associated data changes the
+  // nonce.
+  EXPECT_THAT(
+      cipher->EncryptDeterministically("messag", "aad").ValueOrDie().substr(
+          0, 12),
+      Ne(ct.substr(0, 12)));
+  EXPECT_THAT(
+      cipher->EncryptDeterministically("message", "aa").ValueOrDie().substr(
+          0, 12),
+      Ne(ct.substr(0, 12)));
+  EXPECT_THAT(
+      cipher->EncryptDeterministically("aad", "message").ValueOrDie().substr(
+          0, 12),
+      Ne(ct.substr(0, 12)));
+  // Another key gives another ciphertext.
+  auto other_cipher = std::move(
+      AesGcmSivDeterministicBoringSsl::New(
+          util::SecretDataFromStringView(Random::GetRandomBytes(64)))
+          .ValueOrDie());
+  EXPECT_THAT(
+      other_cipher->EncryptDeterministically("message", "aad").ValueOrDie(),
+      Ne(ct));
+  EXPECT_THAT(other_cipher->DecryptDeterministically(ct, "aad").status(),
+              StatusIs(util::error::INTERNAL));
+}
+
+TEST(AesGcmSivDeterministicBoringSslTest, InvalidKeySizes) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  for (int key_size : {0, 16, 32, 48, 63, 65, 128}) {
+    SCOPED_TRACE(absl::StrCat("key_size = ", key_size));
+    EXPECT_THAT(AesGcmSivDeterministicBoringSsl::New(
+                    util::SecretDataFromStringView(
+                        Random::GetRandomBytes(key_size)))
+                    .status(),
+                StatusIs(util::error::INVALID_ARGUMENT));
+  }
+}
+
+TEST(AesGcmSivDeterministicBoringSslTest, DecryptModification) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  auto cipher =
+      std::move(AesGcmSivDeterministicBoringSsl::New(TestKey()).ValueOrDie());
+  std::string aad = "Additional data";
+  for (int i = 0; i < 40; ++i) {
+    std::string ciphertext =
+        cipher->EncryptDeterministically(std::string(i, 'a'), aad)
+            .ValueOrDie();
+    for (size_t b = 0; b < ciphertext.size(); ++b) {
+      for (int bit = 0; bit < 8; ++bit) {
+        std::string modified = ciphertext;
+        modified[b] ^= (1 << bit);
+        EXPECT_THAT(cipher->DecryptDeterministically(modified, aad).status(),
+                    StatusIs(util::error::INTERNAL))
+            << "byte: " << b << " bit: " << bit;
+      }
+    }
+    for (size_t size = 0; size < ciphertext.size(); ++size) {
+      EXPECT_FALSE(cipher->DecryptDeterministically(
+                             ciphertext.substr(0, size), aad)
+                       .ok());
+    }
+    EXPECT_FALSE(cipher->DecryptDeterministically(ciphertext, "").ok());
+  }
+}
+
+// A ciphertext which is valid for AES-GCM-SIV, but under a nonce other than
+// the synthetic nonce, is rejected.
+TEST(AesGcmSivDeterministicBoringSslTest, RejectsOtherNonces) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  util::SecretData key = TestKey();
+  auto cipher =
+      std::move(AesGcmSivDeterministicBoringSsl::New(key).ValueOrDie());
+  std::string message = "Some data to encrypt.";
+  std::string aad = "Additional data";
+  std::string nonce = Random::GetRandomBytes(12);
+  bssl::UniquePtr<EVP_AEAD_CTX> ctx(
+      EVP_AEAD_CTX_new(EVP_aead_aes_256_gcm_siv(), key.data() + 32, 32,
+                       EVP_AEAD_DEFAULT_TAG_LENGTH));
+  ASSERT_TRUE(ctx != nullptr);
+  std::string sealed(message.size() + 16, '\0');
+  size_t len;
+  ASSERT_EQ(
+      1, EVP_AEAD_CTX_seal(
+             ctx.get(), reinterpret_cast<uint8_t*>(&sealed[0]), &len,
+             sealed.size(), reinterpret_cast<const uint8_t*>(nonce.data()),
+             nonce.size(), reinterpret_cast<const uint8_t*>(message.data()),
+             message.size(), reinterpret_cast<const uint8_t*>(aad.data()),
+             aad.size()));
+  EXPECT_THAT(cipher->DecryptDeterministically(nonce + sealed, aad).status(),
+              StatusIs(util::error::INTERNAL));
+
+  // With the synthetic nonce, the same construction is accepted.
+  std::string ct = cipher->EncryptDeterministically(message, aad).ValueOrDie();
+  std::string synthetic_nonce = ct.substr(0, 12);
+  ASSERT_EQ(
+      1,
+      EVP_AEAD_CTX_seal(
+          ctx.get(), reinterpret_cast<uint8_t*>(&sealed[0]), &len,
+          sealed.size(),
+          reinterpret_cast<const uint8_t*>(synthetic_nonce.data()),
+          synthetic_nonce.size(),
+          reinterpret_cast<const uint8_t*>(message.data()), message.size(),
+          reinterpret_cast<const uint8_t*>(aad.data()), aad.size()));
+  EXPECT_THAT(synthetic_nonce + sealed, Eq(ct));
+}
+
+TEST(AesGcmSivDeterministicBoringSslTest, TestFipsOnly) {
+  if (!kUseOnlyFips) {
+    GTEST_SKIP() << "Only supported in FIPS-only mode";
+  }
+  EXPECT_THAT(AesGcmSivDeterministicBoringSsl::New(TestKey()).status(),
+              StatusIs(util::error::INTERNAL));
+}
+
+}  // namespace
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
@@ -18,11 +18,15 @@
 
 #include <algorithm>
 #include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "absl/memory/memory.h"
 #include "openssl/aes.h"
 #include "openssl/mem.h"
 #include "tink/deterministic_aead.h"
+#include "tink/subtle/subtle_util.h"
 #include "tink/util/errors.h"
 #include "tink/util/status.h"
 #include "tink/util/statusor.h"
@@ -32,14 +36,15 @@ namespace tink {
 namespace subtle {
 namespace {
 
-crypto::tink::util::StatusOr<util::SecretUniquePtr<AES_KEY>> InitializeAesKey(
-    absl::Span<const uint8_t> key) {
-  util::SecretUniquePtr<AES_KEY> aes_key = util::MakeSecretUniquePtr<AES_KEY>();
-  if (AES_set_encrypt_key(reinterpret_cast<const uint8_t*>(key.data()),
-                          8 * key.size(), aes_key.get()) != 0) {
-    return util::Status(util::error::INTERNAL, "could not initialize aes key");
-  }
-  return aes_key;
+// The number of blocks which are decrypted before they are MACed.
+constexpr size_t kDecryptChunkBlocks = 16;
+
+// The number of blocks which are passed to AES_cbc_encrypt at a time when
+// computing a CMAC.
+constexpr size_t kCbcMacChunkBlocks = 16;
+
+absl::Span<const uint8_t> ToSpan(absl::string_view s) {
+  return absl::MakeSpan(reinterpret_cast<const uint8_t*>(s.data()), s.size());
 }
 
 }  // namespace
@@ -53,30 +58,27 @@ AesSivBoringSsl::New(const util::SecretData& key) {
   if (!IsValidKeySizeInBytes(key.size())) {
     return util::Status(util::error::INVALID_ARGUMENT, "invalid key size");
   }
-  auto k1_or = InitializeAesKey(absl::MakeSpan(key).subspan(0, key.size() / 2));
-  if (!k1_or.ok()) {
-    return k1_or.status();
-  }
-  util::SecretUniquePtr<AES_KEY> k1 = std::move(k1_or).ValueOrDie();
-  auto k2_or = InitializeAesKey(absl::MakeSpan(key).subspan(key.size() / 2));
-  if (!k2_or.ok()) {
-    return k2_or.status();
+  util::SecretUniquePtr<KeySchedule> keys =
+      util::MakeSecretUniquePtr<KeySchedule>();
+  const size_t half = key.size() / 2;
+  if (AES_set_encrypt_key(key.data(), 8 * half, &keys->k1) != 0 ||
+      AES_set_encrypt_key(key.data() + half, 8 * half, &keys->k2) != 0) {
+    return util::Status(util::error::INTERNAL, "could not initialize aes key");
   }
-  util::SecretUniquePtr<AES_KEY> k2 = std::move(k2_or).ValueOrDie();
-  return {absl::WrapUnique(new AesSivBoringSsl(std::move(k1), std::move(k2)))};
+  return {absl::WrapUnique(new AesSivBoringSsl(std::move(keys)))};
 }
 
-util::SecretData AesSivBoringSsl::ComputeCmacK1() const {
-  util::SecretData cmac_k1(kBlockSize, 0);
-  EncryptBlock(cmac_k1.data(), cmac_k1.data());
-  MultiplyByX(cmac_k1.data());
-  return cmac_k1;
-}
-
-util::SecretData AesSivBoringSsl::ComputeCmacK2() const {
-  util::SecretData cmac_k2(cmac_k1_);
-  MultiplyByX(cmac_k2.data());
-  return cmac_k2;
+AesSivBoringSsl::AesSivBoringSsl(util::SecretUniquePtr<KeySchedule> keys)
+    : keys_(std::move(keys)) {
+  std::fill(std::begin(keys_->cmac_k1), std::end(keys_->cmac_k1), 0);
+  EncryptBlock(keys_->cmac_k1, keys_->cmac_k1);
+  MultiplyByX(keys_->cmac_k1);
+  std::copy_n(keys_->cmac_k1, kBlockSize, keys_->cmac_k2);
+  MultiplyByX(keys_->cmac_k2);
+  uint8_t zero[kBlockSize] = {0};
+  Cmac(absl::MakeConstSpan(zero), keys_->cmac_zero);
+  std::copy_n(keys_->cmac_zero, kBlockSize, keys_->cmac_zero_doubled);
+  MultiplyByX(keys_->cmac_zero_doubled);
 }
 
 void AesSivBoringSsl::CtrCrypt(const uint8_t siv[kBlockSize],
@@ -89,13 +91,13 @@ void AesSivBoringSsl::CtrCrypt(const uint8_t siv[kBlockSize],
   unsigned int num = 0;
   uint8_t ecount_buf[kBlockSize];
   std::fill(std::begin(ecount_buf), std::end(ecount_buf), 0);
-  AES_ctr128_encrypt(in.data(), out, in.size(), k2_.get(), iv, ecount_buf,
+  AES_ctr128_encrypt(in.data(), out, in.size(), &keys_->k2, iv, ecount_buf,
                      &num);
 }
 
 void AesSivBoringSsl::EncryptBlock(const uint8_t in[kBlockSize],
                                    uint8_t out[kBlockSize]) const {
-  AES_encrypt(in, out, k1_.get());
+  AES_encrypt(in, out, &keys_->k1);
 }
 
 // static
@@ -126,68 +128,118 @@ void AesSivBoringSsl::Cmac(absl::Span<const uint8_t> data,
   const size_t last_block_size = data.size() - last_block_idx;
   uint8_t block[kBlockSize];
   std::fill(std::begin(block), std::end(block), 0);
-  for (size_t idx = 0; idx < last_block_idx; idx += kBlockSize) {
-    XorBlock(block, &data[idx], block);
-    EncryptBlock(block, block);
-  }
+  CbcMacBlocks(data.subspan(0, last_block_idx), block);
   for (size_t j = 0; j < last_block_size; j++) {
     block[j] ^= data[last_block_idx + j];
   }
   if (last_block_size == kBlockSize) {
-    XorBlock(block, cmac_k1_.data(), block);
+    XorBlock(block, keys_->cmac_k1, block);
   } else {
     block[last_block_size] ^= 0x80;
-    XorBlock(block, cmac_k2_.data(), block);
+    XorBlock(block, keys_->cmac_k2, block);
   }
   EncryptBlock(block, mac);
 }
 
+void AesSivBoringSsl::CbcMacBlocks(absl::Span<const uint8_t> data,
+                                   uint8_t state[kBlockSize]) const {
+  // AES_cbc_encrypt leaves the last ciphertext block, i.e. the CBC-MAC, in
+  // the IV. BoringSSL processes the whole input with AES-NI or the ARMv8
+  // Crypto Extensions when the CPU has them, which is much faster than a
+  // call to AES_encrypt per block. The ciphertext itself is discarded.
+  uint8_t scratch[kCbcMacChunkBlocks * kBlockSize];
+  for (size_t idx = 0; idx < data.size(); idx += sizeof(scratch)) {
+    size_t len = std::min(sizeof(scratch), data.size() - idx);
+    AES_cbc_encrypt(&data[idx], scratch, len, &keys_->k1, state, AES_ENCRYPT);
+  }
+  OPENSSL_cleanse(scratch, sizeof(scratch));
+}
+
 // Computes Cmac(XorEnd(data, last))
 void AesSivBoringSsl::CmacLong(absl::Span<const uint8_t> data,
                                const uint8_t last[kBlockSize],
                                uint8_t mac[kBlockSize]) const {
-  uint8_t block[kBlockSize];
-  std::copy_n(data.begin(), kBlockSize, block);
-  size_t idx = kBlockSize;
-  while (kBlockSize <= data.size() - idx) {
-    EncryptBlock(block, block);
-    XorBlock(block, &data[idx], block);
-    idx += kBlockSize;
-  }
-  size_t remaining = data.size() - idx;
-  for (int j = 0; j < kBlockSize - remaining; ++j) {
+  size_t prefix_size = kBlockSize * CmacLongPrefixBlocks(data.size());
+  uint8_t state[kBlockSize];
+  std::fill(std::begin(state), std::end(state), 0);
+  CbcMacBlocks(data.subspan(0, prefix_size), state);
+  CmacLongTail(data.subspan(prefix_size), last, state, mac);
+}
+
+void AesSivBoringSsl::CmacLongTail(absl::Span<const uint8_t> tail,
+                                   const uint8_t last[kBlockSize],
+                                   uint8_t state[kBlockSize],
+                                   uint8_t mac[kBlockSize]) const {
+  // XorEnd(tail, last), with 16 <= tail.size() < 32.
+  uint8_t block[2 * kBlockSize];
+  std::copy(tail.begin(), tail.end(), block);
+  const size_t remaining = tail.size() - kBlockSize;
+  for (size_t j = 0; j < kBlockSize; ++j) {
     block[remaining + j] ^= last[j];
   }
+  XorBlock(state, block, state);
   if (remaining == 0) {
-    XorBlock(block, cmac_k1_.data(), block);
+    XorBlock(state, keys_->cmac_k1, state);
   } else {
-    EncryptBlock(block, block);
-    for (int j = 0; j < remaining; ++j) {
-      block[j] ^= last[kBlockSize - remaining + j];
-      block[j] ^= data[idx + j];
+    EncryptBlock(state, state);
+    for (size_t j = 0; j < remaining; ++j) {
+      state[j] ^= block[kBlockSize + j];
     }
-    block[remaining] ^= 0x80;
-    XorBlock(block, cmac_k2_.data(), block);
+    state[remaining] ^= 0x80;
+    XorBlock(state, keys_->cmac_k2, state);
   }
-  EncryptBlock(block, mac);
+  EncryptBlock(state, mac);
 }
 
-void AesSivBoringSsl::S2v(absl::Span<const uint8_t> aad,
-                          absl::Span<const uint8_t> msg,
-                          uint8_t siv[kBlockSize]) const {
-  // This stuff could be precomputed.
-  uint8_t block[kBlockSize];
-  std::fill(std::begin(block), std::end(block), 0);
-  Cmac(block, block);
-  MultiplyByX(block);
-
+void AesSivBoringSsl::S2vAad(absl::Span<const uint8_t> aad,
+                             uint8_t d[kBlockSize]) const {
   uint8_t aad_mac[kBlockSize];
   Cmac(aad, aad_mac);
-  XorBlock(block, aad_mac, block);
+  XorBlock(keys_->cmac_zero_doubled, aad_mac, d);
+}
 
+void AesSivBoringSsl::S2vComponents(
+    absl::Span<const absl::string_view> components,
+    uint8_t d[kBlockSize]) const {
+  uint8_t mac[kBlockSize];
+  for (absl::string_view component : components) {
+    MultiplyByX(d);
+    Cmac(ToSpan(component), mac);
+    XorBlock(d, mac, d);
+  }
+}
+
+AesSivBoringSsl::PreparedAssociatedData AesSivBoringSsl::EmptyPrefix() const {
+  PreparedAssociatedData prefix(this, 0);
+  std::copy_n(keys_->cmac_zero, kBlockSize, prefix.d_);
+  return prefix;
+}
+
+util::Status AesSivBoringSsl::S2vPrefixAndComponents(
+    const PreparedAssociatedData& prefix,
+    absl::Span<const absl::string_view> components,
+    uint8_t d[kBlockSize]) const {
+  if (prefix.owner_ != this) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "associated data prepared by another instance");
+  }
+  if (prefix.size_ + components.size() > kMaxAssociatedDataComponents) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "too many associated data components");
+  }
+  std::copy_n(prefix.d_, kBlockSize, d);
+  S2vComponents(components, d);
+  return util::OkStatus();
+}
+
+void AesSivBoringSsl::S2vFinal(const uint8_t d[kBlockSize],
+                               absl::Span<const uint8_t> msg,
+                               uint8_t siv[kBlockSize]) const {
   if (msg.size() >= kBlockSize) {
-    CmacLong(msg, block, siv);
+    CmacLong(msg, d, siv);
   } else {
+    uint8_t block[kBlockSize];
+    std::copy_n(d, kBlockSize, block);
     MultiplyByX(block);
     for (size_t i = 0; i < msg.size(); ++i) {
       block[i] ^= msg[i];
@@ -197,44 +249,216 @@ void AesSivBoringSsl::S2v(absl::Span<const uint8_t> aad,
   }
 }
 
+std::string AesSivBoringSsl::Encrypt(const uint8_t d[kBlockSize],
+                                     absl::string_view plaintext) const {
+  std::string ciphertext;
+  ResizeStringUninitialized(&ciphertext, kBlockSize + plaintext.size());
+  EncryptInto(d, plaintext, reinterpret_cast<uint8_t*>(&ciphertext[0]));
+  return ciphertext;
+}
+
+util::StatusOr<std::string> AesSivBoringSsl::Decrypt(
+    const uint8_t d[kBlockSize], absl::string_view ciphertext) const {
+  if (ciphertext.size() < kBlockSize) {
+    return util::Status(util::error::INVALID_ARGUMENT, "ciphertext too short");
+  }
+  std::string plaintext;
+  ResizeStringUninitialized(&plaintext, ciphertext.size() - kBlockSize);
+  if (!DecryptInto(d, ciphertext, reinterpret_cast<uint8_t*>(&plaintext[0]))) {
+    return util::Status(util::error::INVALID_ARGUMENT, "invalid ciphertext");
+  }
+  return plaintext;
+}
+
+void AesSivBoringSsl::EncryptInto(const uint8_t d[kBlockSize],
+                                  absl::string_view plaintext,
+                                  uint8_t* out) const {
+  absl::Span<const uint8_t> pt = ToSpan(plaintext);
+  S2vFinal(d, pt, out);
+  CtrCrypt(out, pt, out + kBlockSize);
+}
+
+bool AesSivBoringSsl::DecryptInto(const uint8_t d[kBlockSize],
+                                  absl::string_view ciphertext,
+                                  uint8_t* out) const {
+  size_t plaintext_size = ciphertext.size() - kBlockSize;
+  const uint8_t* siv = reinterpret_cast<const uint8_t*>(ciphertext.data());
+  uint8_t s2v[kBlockSize];
+  CtrDecryptAndS2v(siv, d, absl::MakeSpan(siv + kBlockSize, plaintext_size),
+                   absl::MakeSpan(out, plaintext_size), s2v);
+  return CRYPTO_memcmp(siv, s2v, kBlockSize) == 0;
+}
+
+void AesSivBoringSsl::CtrDecryptAndS2v(const uint8_t siv[kBlockSize],
+                                       const uint8_t d[kBlockSize],
+                                       absl::Span<const uint8_t> ciphertext,
+                                       absl::Span<uint8_t> plaintext,
+                                       uint8_t s2v[kBlockSize]) const {
+  if (plaintext.size() < kBlockSize) {
+    CtrCrypt(siv, ciphertext, plaintext.data());
+    S2vFinal(d, plaintext, s2v);
+    return;
+  }
+  uint8_t iv[kBlockSize];
+  std::copy_n(siv, kBlockSize, iv);
+  iv[8] &= 0x7f;
+  iv[12] &= 0x7f;
+  unsigned int num = 0;
+  uint8_t ecount_buf[kBlockSize];
+  std::fill(std::begin(ecount_buf), std::end(ecount_buf), 0);
+  uint8_t state[kBlockSize];
+  std::fill(std::begin(state), std::end(state), 0);
+
+  // Only the blocks in front of the tail of CmacLong are MACed per chunk;
+  // the chunks are block-aligned, so CTR stays in sync across them.
+  const size_t prefix_size =
+      kBlockSize * CmacLongPrefixBlocks(plaintext.size());
+  const size_t chunk_size = kBlockSize * kDecryptChunkBlocks;
+  size_t maced = 0;
+  for (size_t idx = 0; idx < plaintext.size(); idx += chunk_size) {
+    size_t len = std::min(chunk_size, plaintext.size() - idx);
+    AES_ctr128_encrypt(&ciphertext[idx], &plaintext[idx], len, &keys_->k2, iv,
+                       ecount_buf, &num);
+    size_t mac_end = std::min(idx + len, prefix_size);
+    CbcMacBlocks(plaintext.subspan(maced, mac_end - maced), state);
+    maced = mac_end;
+  }
+  CmacLongTail(plaintext.subspan(prefix_size), d, state, s2v);
+}
+
 util::StatusOr<std::string> AesSivBoringSsl::EncryptDeterministically(
     absl::string_view plaintext, absl::string_view additional_data) const {
-  uint8_t siv[kBlockSize];
-  S2v(absl::MakeSpan(reinterpret_cast<const uint8_t*>(additional_data.data()),
-                     additional_data.size()),
-      absl::MakeSpan(reinterpret_cast<const uint8_t*>(plaintext.data()),
-                     plaintext.size()),
-      siv);
-  size_t ciphertext_size = plaintext.size() + kBlockSize;
-  std::vector<uint8_t> ct(ciphertext_size);
-  std::copy(std::begin(siv), std::end(siv), ct.begin());
-  CtrCrypt(siv,
-           absl::MakeSpan(reinterpret_cast<const uint8_t*>(plaintext.data()),
-                          plaintext.size()),
-           ct.data() + kBlockSize);
-  return std::string(reinterpret_cast<const char*>(ct.data()), ciphertext_size);
+  uint8_t d[kBlockSize];
+  S2vAad(ToSpan(additional_data), d);
+  return Encrypt(d, plaintext);
+}
+
+util::StatusOr<std::vector<std::string>>
+AesSivBoringSsl::EncryptDeterministicallyBatch(
+    absl::Span<const absl::string_view> plaintexts,
+    absl::string_view additional_data) const {
+  uint8_t d[kBlockSize];
+  S2vAad(ToSpan(additional_data), d);
+  std::vector<std::string> ciphertexts;
+  ciphertexts.reserve(plaintexts.size());
+  for (absl::string_view plaintext : plaintexts) {
+    ciphertexts.push_back(Encrypt(d, plaintext));
+  }
+  return ciphertexts;
 }
 
 util::StatusOr<std::string> AesSivBoringSsl::DecryptDeterministically(
     absl::string_view ciphertext, absl::string_view additional_data) const {
-  if (ciphertext.size() < kBlockSize) {
-    return util::Status(util::error::INVALID_ARGUMENT, "ciphertext too short");
+  uint8_t d[kBlockSize];
+  S2vAad(ToSpan(additional_data), d);
+  return Decrypt(d, ciphertext);
+}
+
+util::StatusOr<AesSivBoringSsl::PreparedAssociatedData>
+AesSivBoringSsl::PrepareAssociatedData(
+    absl::Span<const absl::string_view> components) const {
+  if (components.size() > kMaxAssociatedDataComponents) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "too many associated data components");
   }
-  size_t plaintext_size = ciphertext.size() - kBlockSize;
-  std::vector<uint8_t> pt(plaintext_size);
-  const uint8_t *siv = reinterpret_cast<const uint8_t*>(&ciphertext[0]);
-  const uint8_t* ct =
-      reinterpret_cast<const uint8_t*>(&ciphertext[0]) + kBlockSize;
-  CtrCrypt(siv, absl::MakeSpan(ct, plaintext_size), pt.data());
+  PreparedAssociatedData prefix = EmptyPrefix();
+  prefix.size_ = components.size();
+  S2vComponents(components, prefix.d_);
+  return prefix;
+}
 
-  uint8_t s2v[kBlockSize];
-  S2v(absl::MakeSpan(reinterpret_cast<const uint8_t*>(additional_data.data()),
-                     additional_data.size()),
-      absl::MakeSpan(pt), s2v);
-  if (CRYPTO_memcmp(siv, s2v, kBlockSize) != 0) {
-    return util::Status(util::error::INVALID_ARGUMENT, "invalid ciphertext");
+util::StatusOr<std::string>
+AesSivBoringSsl::EncryptDeterministicallyWithComponents(
+    absl::string_view plaintext,
+    absl::Span<const absl::string_view> associated_data) const {
+  return EncryptDeterministicallyWithComponents(
+      plaintext, EmptyPrefix(), associated_data);
+}
+
+util::StatusOr<std::string>
+AesSivBoringSsl::DecryptDeterministicallyWithComponents(
+    absl::string_view ciphertext,
+    absl::Span<const absl::string_view> associated_data) const {
+  return DecryptDeterministicallyWithComponents(
+      ciphertext, EmptyPrefix(), associated_data);
+}
+
+util::StatusOr<std::string>
+AesSivBoringSsl::EncryptDeterministicallyWithComponents(
+    absl::string_view plaintext, const PreparedAssociatedData& prefix,
+    absl::Span<const absl::string_view> associated_data) const {
+  uint8_t d[kBlockSize];
+  auto status = S2vPrefixAndComponents(prefix, associated_data, d);
+  if (!status.ok()) return status;
+  return Encrypt(d, plaintext);
+}
+
+util::StatusOr<std::string>
+AesSivBoringSsl::DecryptDeterministicallyWithComponents(
+    absl::string_view ciphertext, const PreparedAssociatedData& prefix,
+    absl::Span<const absl::string_view> associated_data) const {
+  uint8_t d[kBlockSize];
+  auto status = S2vPrefixAndComponents(prefix, associated_data, d);
+  if (!status.ok()) return status;
+  return Decrypt(d, ciphertext);
+}
+
+util::Status AesSivBoringSsl::EncryptDeterministicallyBatch(
+    absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs,
+    std::string* arena, std::vector<absl::string_view>* ciphertexts) const {
+  std::vector<int64_t> sizes;
+  sizes.reserve(inputs.size());
+  int64_t total_size = 0;
+  for (const auto& input : inputs) {
+    sizes.push_back(kBlockSize + input.first.size());
+    total_size += sizes.back();
+  }
+  ResizeStringUninitialized(arena, total_size);
+  uint8_t* out = reinterpret_cast<uint8_t*>(&(*arena)[0]);
+  uint8_t d[kBlockSize];
+  for (size_t i = 0; i < inputs.size(); i++) {
+    if (i == 0 || inputs[i].second != inputs[i - 1].second) {
+      S2vAad(ToSpan(inputs[i].second), d);
+    }
+    EncryptInto(d, inputs[i].first, out);
+    out += sizes[i];
+  }
+  SplitArena(*arena, sizes, ciphertexts);
+  return util::OkStatus();
+}
+
+util::Status AesSivBoringSsl::DecryptDeterministicallyBatch(
+    absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs,
+    std::string* arena, std::vector<absl::string_view>* plaintexts) const {
+  std::vector<int64_t> sizes;
+  sizes.reserve(inputs.size());
+  int64_t total_size = 0;
+  for (const auto& input : inputs) {
+    if (input.first.size() < kBlockSize) {
+      return util::Status(util::error::INVALID_ARGUMENT,
+                          "ciphertext too short");
+    }
+    sizes.push_back(input.first.size() - kBlockSize);
+    total_size += sizes.back();
+  }
+  ResizeStringUninitialized(arena, total_size);
+  uint8_t* out = reinterpret_cast<uint8_t*>(&(*arena)[0]);
+  uint8_t d[kBlockSize];
+  for (size_t i = 0; i < inputs.size(); i++) {
+    if (i == 0 || inputs[i].second != inputs[i - 1].second) {
+      S2vAad(ToSpan(inputs[i].second), d);
+    }
+    if (!DecryptInto(d, inputs[i].first, out)) {
+      // Do not leave unauthenticated plaintext in the arena.
+      OPENSSL_cleanse(&(*arena)[0], arena->size());
+      arena->clear();
+      plaintexts->clear();
+      return util::Status(util::error::INVALID_ARGUMENT, "invalid ciphertext");
+    }
+    out += sizes[i];
   }
-  return std::string(reinterpret_cast<const char*>(pt.data()), plaintext_size);
+  SplitArena(*arena, sizes, plaintexts);
+  return util::OkStatus();
 }
 
 }  // namespace subtle
@@ -18,6 +18,9 @@
 #define TINK_SUBTLE_AES_SIV_BORINGSSL_H_
 
 #include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include "absl/strings/string_view.h"
 #include "absl/types/span.h"
@@ -35,8 +38,8 @@ namespace subtle {
 // AesSivBoringSsl is an implemenatation of AES-SIV-CMAC as defined in
 // https://tools.ietf.org/html/rfc5297 .
 // AesSivBoringSsl implements a deterministic encryption with additional
-// data (i.e. the DeterministicAead interface). Hence the implementation
-// below is restricted to one AD component.
+// data (i.e. the DeterministicAead interface). Several AD components, as
+// supported by S2V, can be passed to EncryptDeterministicallyWithComponents().
 //
 // Thread safety: This class is thread safe and thus can be used
 // concurrently.
@@ -67,6 +70,65 @@ class AesSivBoringSsl : public DeterministicAead {
       absl::string_view ciphertext,
       absl::string_view additional_data) const override;
 
+  // Encrypts each of the plaintexts with the same additional data. This is
+  // equivalent to calling EncryptDeterministically() for each plaintext, but
+  // the CMAC of the additional data is only computed once, which matters when
+  // encrypting many small values (e.g. for tokenization).
+  crypto::tink::util::StatusOr<std::vector<std::string>>
+  EncryptDeterministicallyBatch(absl::Span<const absl::string_view> plaintexts,
+                                absl::string_view additional_data) const;
+
+  // The batch methods of DeterministicAead. The ciphertexts or plaintexts
+  // are written directly into the arena, and the part of S2V which depends
+  // on the additional data is computed only once for consecutive inputs with
+  // the same additional data, e.g. for the values of a column.
+  crypto::tink::util::Status EncryptDeterministicallyBatch(
+      absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs,
+      std::string* arena,
+      std::vector<absl::string_view>* ciphertexts) const override;
+
+  crypto::tink::util::Status DecryptDeterministicallyBatch(
+      absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs,
+      std::string* arena,
+      std::vector<absl::string_view>* plaintexts) const override;
+
+  // The S2V state after a sequence of leading associated data components.
+  class PreparedAssociatedData;
+
+  // The multi-component methods of DeterministicAead. S2V is computed over
+  // the vector of associated data components as defined in RFC 5297, which
+  // allows at most kMaxAssociatedDataComponents components.
+  crypto::tink::util::StatusOr<std::string>
+  EncryptDeterministicallyWithComponents(
+      absl::string_view plaintext,
+      absl::Span<const absl::string_view> associated_data) const override;
+
+  crypto::tink::util::StatusOr<std::string>
+  DecryptDeterministicallyWithComponents(
+      absl::string_view ciphertext,
+      absl::Span<const absl::string_view> associated_data) const override;
+
+  // Computes the part of S2V which depends on the given leading associated
+  // data components, e.g. the table and the column of the values to be
+  // encrypted, so that their CMACs are not recomputed for every value. The
+  // result can only be used with this instance.
+  crypto::tink::util::StatusOr<PreparedAssociatedData> PrepareAssociatedData(
+      absl::Span<const absl::string_view> components) const;
+
+  // Like the methods above, with the components of 'prefix' followed by
+  // 'associated_data' as the associated data components.
+  crypto::tink::util::StatusOr<std::string>
+  EncryptDeterministicallyWithComponents(
+      absl::string_view plaintext, const PreparedAssociatedData& prefix,
+      absl::Span<const absl::string_view> associated_data) const;
+
+  crypto::tink::util::StatusOr<std::string>
+  DecryptDeterministicallyWithComponents(
+      absl::string_view ciphertext, const PreparedAssociatedData& prefix,
+      absl::Span<const absl::string_view> associated_data) const;
+
+  static constexpr size_t kMaxAssociatedDataComponents = 126;
+
   static bool IsValidKeySizeInBytes(size_t size) {
     return size == 64;
   }
@@ -77,17 +139,20 @@ class AesSivBoringSsl : public DeterministicAead {
  private:
   static constexpr size_t kBlockSize = 16;
 
-  AesSivBoringSsl(util::SecretUniquePtr<AES_KEY> k1,
-                  util::SecretUniquePtr<AES_KEY> k2)
-      : k1_(std::move(k1)),
-        k2_(std::move(k2)),
-        cmac_k1_(ComputeCmacK1()),
-        cmac_k2_(ComputeCmacK2()) {}
+  // All key material of an instance, kept in a single allocation.
+  struct KeySchedule {
+    AES_KEY k1;
+    AES_KEY k2;
+    uint8_t cmac_k1[kBlockSize];
+    uint8_t cmac_k2[kBlockSize];
+    // CMAC(<zero>), the S2V state before any associated data.
+    uint8_t cmac_zero[kBlockSize];
+    // dbl(CMAC(<zero>)), the initial value of S2V.
+    uint8_t cmac_zero_doubled[kBlockSize];
+  };
 
-  // Precomputes cmac_k1
-  util::SecretData ComputeCmacK1() const;
-  // Precomputes cmac_k2
-  util::SecretData ComputeCmacK2() const;
+  // 'keys' must have k1 and k2 set; the CMAC subkeys are computed here.
+  explicit AesSivBoringSsl(util::SecretUniquePtr<KeySchedule> keys);
 
   // Encrypts (or decrypts) the bytes in in using an SIV and
   // writes the result to out.
@@ -102,12 +167,29 @@ class AesSivBoringSsl : public DeterministicAead {
   // Computes a CMAC of some data.
   void Cmac(absl::Span<const uint8_t> data, uint8_t mac[kBlockSize]) const;
 
+  // CBC-encrypts the blocks of data into state, i.e. the part of a CMAC
+  // before the final block. The size of data must be a multiple of 16 bytes.
+  void CbcMacBlocks(absl::Span<const uint8_t> data,
+                    uint8_t state[kBlockSize]) const;
+
+  // Returns the number of leading blocks of the data of CmacLong which are
+  // not affected by XorEnd, i.e. which can be processed by CbcMacBlocks.
+  static size_t CmacLongPrefixBlocks(size_t data_size) {
+    return (data_size - kBlockSize) / kBlockSize;
+  }
+
   // Computes CMAC(XorEnd(data, last)), where XorEnd
   // xors the bytes in last to the last bytes in data.
   // The size of the data must be at least 16 bytes.
   void CmacLong(absl::Span<const uint8_t> data, const uint8_t last[kBlockSize],
                 uint8_t mac[kBlockSize]) const;
 
+  // Completes CmacLong, given the remaining 16 to 31 bytes of data in tail and
+  // the state after CbcMacBlocks over the CmacLongPrefixBlocks() first blocks.
+  void CmacLongTail(absl::Span<const uint8_t> tail,
+                    const uint8_t last[kBlockSize], uint8_t state[kBlockSize],
+                    uint8_t mac[kBlockSize]) const;
+
   // Multiplying an element in GF(2^128) by its generator.
   // This functions is incorrectly named "doubling" in section 2.3 of RFC 5297.
   static void MultiplyByX(uint8_t block[kBlockSize]);
@@ -117,13 +199,81 @@ class AesSivBoringSsl : public DeterministicAead {
   static void XorBlock(const uint8_t x[kBlockSize], const uint8_t y[kBlockSize],
                        uint8_t res[kBlockSize]);
 
-  void S2v(absl::Span<const uint8_t> aad, absl::Span<const uint8_t> msg,
-           uint8_t siv[kBlockSize]) const;
+  // Computes the part of S2V which depends only on the additional data, i.e.
+  // dbl(CMAC(<zero>)) xor CMAC(aad).
+  void S2vAad(absl::Span<const uint8_t> aad, uint8_t d[kBlockSize]) const;
+
+  // Advances the S2V state d over the associated data components, i.e.
+  // sets d = dbl(d) xor CMAC(component) for each of them in turn.
+  void S2vComponents(absl::Span<const absl::string_view> components,
+                     uint8_t d[kBlockSize]) const;
+
+  // Returns the prefix without any components.
+  PreparedAssociatedData EmptyPrefix() const;
+
+  // Computes the S2V state after 'prefix' and 'components' into d, and
+  // fails if 'prefix' is from another instance or there are too many
+  // components.
+  crypto::tink::util::Status S2vPrefixAndComponents(
+      const PreparedAssociatedData& prefix,
+      absl::Span<const absl::string_view> components,
+      uint8_t d[kBlockSize]) const;
+
+  // Completes S2V for the message msg, given d as computed by S2vAad.
+  void S2vFinal(const uint8_t d[kBlockSize], absl::Span<const uint8_t> msg,
+                uint8_t siv[kBlockSize]) const;
+
+  // Encrypts plaintext, with d computed by S2vAad from the additional data.
+  std::string Encrypt(const uint8_t d[kBlockSize],
+                      absl::string_view plaintext) const;
+
+  // Decrypts ciphertext, with d computed by S2vAad from the additional data.
+  crypto::tink::util::StatusOr<std::string> Decrypt(
+      const uint8_t d[kBlockSize], absl::string_view ciphertext) const;
+
+  // Like Encrypt(), but writes the kBlockSize + plaintext.size() bytes of
+  // the ciphertext to out.
+  void EncryptInto(const uint8_t d[kBlockSize], absl::string_view plaintext,
+                   uint8_t* out) const;
+
+  // Decrypts ciphertext, which must have at least kBlockSize bytes, with d
+  // computed by S2vAad from the additional data, and writes the
+  // ciphertext.size() - kBlockSize bytes of the plaintext to out. Returns
+  // false if the ciphertext is invalid, in which case out holds
+  // unauthenticated data.
+  bool DecryptInto(const uint8_t d[kBlockSize], absl::string_view ciphertext,
+                   uint8_t* out) const;
+
+  // Decrypts ciphertext with the SIV siv into plaintext and computes S2V of
+  // the result in the same pass, i.e. each chunk of the plaintext is MACed
+  // while it is still in cache.
+  void CtrDecryptAndS2v(const uint8_t siv[kBlockSize],
+                        const uint8_t d[kBlockSize],
+                        absl::Span<const uint8_t> ciphertext,
+                        absl::Span<uint8_t> plaintext,
+                        uint8_t s2v[kBlockSize]) const;
+
+  const util::SecretUniquePtr<KeySchedule> keys_;
+};
+
+class AesSivBoringSsl::PreparedAssociatedData {
+ public:
+  // Constructs a value which is only usable once it is assigned the result
+  // of PrepareAssociatedData().
+  PreparedAssociatedData() : owner_(nullptr), size_(0), d_() {}
+
+  // The number of components in the prefix.
+  size_t size() const { return size_; }
+
+ private:
+  friend class AesSivBoringSsl;
+
+  PreparedAssociatedData(const AesSivBoringSsl* owner, size_t size)
+      : owner_(owner), size_(size), d_() {}
 
-  const util::SecretUniquePtr<AES_KEY> k1_;
-  const util::SecretUniquePtr<AES_KEY> k2_;
-  const util::SecretData cmac_k1_;
-  const util::SecretData cmac_k2_;
+  const AesSivBoringSsl* owner_;
+  size_t size_;
+  uint8_t d_[kBlockSize];
 };
 
 }  // namespace subtle
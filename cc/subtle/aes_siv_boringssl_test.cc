@@ -17,9 +17,13 @@
 #include "tink/subtle/aes_siv_boringssl.h"
 
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "tink/subtle/wycheproof_util.h"
 #include "tink/util/secret_data.h"
 #include "tink/util/status.h"
@@ -176,6 +180,221 @@ TEST(AesSivBoringSslTest, testEncryptDecryptAadSize) {
   }
 }
 
+TEST(AesSivBoringSslTest, testEncryptDeterministicallyBatch) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  util::SecretData key = util::SecretDataFromStringView(test::HexDecodeOrDie(
+      "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"
+      "00112233445566778899aabbccddeefff0f1f2f3f4f5f6f7f8f9fafbfcfdfeff"));
+  auto res = AesSivBoringSsl::New(key);
+  EXPECT_TRUE(res.ok()) << res.status();
+  auto cipher = std::move(res.ValueOrDie());
+  std::string aad = "Additional data";
+  std::vector<std::string> messages;
+  for (int i = 0; i < 70; ++i) {
+    messages.push_back(std::string(i, 'a' + i % 26));
+  }
+  std::vector<absl::string_view> plaintexts(messages.begin(), messages.end());
+  auto batch_result = static_cast<AesSivBoringSsl*>(cipher.get())
+                          ->EncryptDeterministicallyBatch(plaintexts, aad);
+  ASSERT_TRUE(batch_result.ok()) << batch_result.status();
+  const std::vector<std::string>& ciphertexts = batch_result.ValueOrDie();
+  ASSERT_EQ(ciphertexts.size(), messages.size());
+  for (int i = 0; i < messages.size(); ++i) {
+    auto ct = cipher->EncryptDeterministically(messages[i], aad);
+    EXPECT_TRUE(ct.ok()) << ct.status();
+    EXPECT_EQ(ciphertexts[i], ct.ValueOrDie());
+    auto pt = cipher->DecryptDeterministically(ciphertexts[i], aad);
+    EXPECT_TRUE(pt.ok()) << pt.status();
+    EXPECT_EQ(pt.ValueOrDie(), messages[i]);
+  }
+}
+
+TEST(AesSivBoringSslTest, testAssociatedDataComponents) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  util::SecretData key = util::SecretDataFromStringView(test::HexDecodeOrDie(
+      "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"
+      "202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f"));
+  auto res = AesSivBoringSsl::New(key);
+  ASSERT_TRUE(res.ok()) << res.status();
+  auto cipher = std::move(res.ValueOrDie());
+  std::string message = "Some value to tokenize.";
+  std::vector<absl::string_view> aad = {"table", "column", "tenant"};
+
+  // Computed with the AES-256-SIV of OpenSSL, which passes each
+  // EVP_EncryptUpdate() of associated data to S2V as a separate component.
+  struct {
+    int components;
+    std::string ciphertext;
+  } test_vectors[] = {
+      {0, "8493b227ca019f11c67eb1653e9da16f4de69e7df7acdab39c6ef8c6b0d64b2c"
+          "4b888de41303ad"},
+      {1, "a2919558fe4acfc9838b7f70f78afdb9fde260fcf2daaf7d5e5c3522309800d3"
+          "0860ac6fdd79e9"},
+      {3, "b4084d005f64120d1c5163628e1a64f519f45ba123ebeb3e17e0b446a5de8f49"
+          "c5ca02b02afae0"},
+  };
+  for (const auto& test_vector : test_vectors) {
+    SCOPED_TRACE(absl::StrCat("components: ", test_vector.components));
+    absl::Span<const absl::string_view> components =
+        absl::MakeConstSpan(aad).subspan(0, test_vector.components);
+    auto ct = cipher->EncryptDeterministicallyWithComponents(message,
+                                                             components);
+    ASSERT_TRUE(ct.ok()) << ct.status();
+    EXPECT_EQ(test::HexEncode(ct.ValueOrDie()), test_vector.ciphertext);
+    auto pt = cipher->DecryptDeterministicallyWithComponents(ct.ValueOrDie(),
+                                                             components);
+    ASSERT_TRUE(pt.ok()) << pt.status();
+    EXPECT_EQ(pt.ValueOrDie(), message);
+  }
+
+  // A single component is the same as EncryptDeterministically().
+  EXPECT_EQ(cipher->EncryptDeterministicallyWithComponents(message, {"table"})
+                .ValueOrDie(),
+            cipher->EncryptDeterministically(message, "table").ValueOrDie());
+
+  // Components are not concatenated.
+  auto ct = cipher->EncryptDeterministicallyWithComponents(message, aad);
+  ASSERT_TRUE(ct.ok()) << ct.status();
+  EXPECT_FALSE(cipher
+                   ->DecryptDeterministicallyWithComponents(
+                       ct.ValueOrDie(), {"tablecolumn", "tenant"})
+                   .ok());
+  EXPECT_FALSE(cipher
+                   ->DecryptDeterministicallyWithComponents(
+                       ct.ValueOrDie(), {"column", "table", "tenant"})
+                   .ok());
+
+  std::vector<absl::string_view> too_many(
+      AesSivBoringSsl::kMaxAssociatedDataComponents + 1, "a");
+  EXPECT_THAT(
+      cipher->EncryptDeterministicallyWithComponents(message, too_many)
+          .status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(AesSivBoringSslTest, testPreparedAssociatedData) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  util::SecretData key = util::SecretDataFromStringView(test::HexDecodeOrDie(
+      "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"
+      "00112233445566778899aabbccddeefff0f1f2f3f4f5f6f7f8f9fafbfcfdfeff"));
+  auto res = AesSivBoringSsl::New(key);
+  ASSERT_TRUE(res.ok()) << res.status();
+  auto* cipher = static_cast<AesSivBoringSsl*>(res.ValueOrDie().get());
+  std::vector<absl::string_view> aad = {"table", "column", "tenant"};
+
+  for (int prefix_size = 0; prefix_size <= 3; prefix_size++) {
+    SCOPED_TRACE(absl::StrCat("prefix_size: ", prefix_size));
+    absl::Span<const absl::string_view> components = aad;
+    auto prefix_result =
+        cipher->PrepareAssociatedData(components.subspan(0, prefix_size));
+    ASSERT_TRUE(prefix_result.ok()) << prefix_result.status();
+    const AesSivBoringSsl::PreparedAssociatedData& prefix =
+        prefix_result.ValueOrDie();
+    EXPECT_EQ(prefix.size(), prefix_size);
+    for (int i = 0; i < 40; ++i) {
+      std::string message(i, 'a' + i % 26);
+      auto ct = cipher->EncryptDeterministicallyWithComponents(
+          message, prefix, components.subspan(prefix_size));
+      ASSERT_TRUE(ct.ok()) << ct.status();
+      EXPECT_EQ(ct.ValueOrDie(),
+                cipher->EncryptDeterministicallyWithComponents(message, aad)
+                    .ValueOrDie());
+      auto pt = cipher->DecryptDeterministicallyWithComponents(
+          ct.ValueOrDie(), prefix, components.subspan(prefix_size));
+      ASSERT_TRUE(pt.ok()) << pt.status();
+      EXPECT_EQ(pt.ValueOrDie(), message);
+    }
+  }
+
+  // Prepared associated data can only be used by the instance which
+  // prepared it.
+  auto other = AesSivBoringSsl::New(key);
+  ASSERT_TRUE(other.ok()) << other.status();
+  auto prefix_result = static_cast<AesSivBoringSsl*>(other.ValueOrDie().get())
+                           ->PrepareAssociatedData(aad);
+  ASSERT_TRUE(prefix_result.ok()) << prefix_result.status();
+  EXPECT_THAT(cipher
+                  ->EncryptDeterministicallyWithComponents(
+                      "message", prefix_result.ValueOrDie(), {})
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(cipher
+                  ->EncryptDeterministicallyWithComponents(
+                      "message", AesSivBoringSsl::PreparedAssociatedData(), {})
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(AesSivBoringSslTest, testBatchWithArena) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  util::SecretData key = util::SecretDataFromStringView(test::HexDecodeOrDie(
+      "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"
+      "00112233445566778899aabbccddeefff0f1f2f3f4f5f6f7f8f9fafbfcfdfeff"));
+  auto res = AesSivBoringSsl::New(key);
+  EXPECT_TRUE(res.ok()) << res.status();
+  auto cipher = std::move(res.ValueOrDie());
+  // Runs of equal and of changing additional data.
+  std::vector<std::string> messages;
+  std::vector<std::string> aads;
+  for (int i = 0; i < 70; ++i) {
+    messages.push_back(std::string(i, 'a' + i % 26));
+    aads.push_back(i < 40 ? "column 1" : absl::StrCat("row ", i % 3));
+  }
+  std::vector<std::pair<absl::string_view, absl::string_view>> inputs;
+  for (int i = 0; i < messages.size(); ++i) {
+    inputs.emplace_back(messages[i], aads[i]);
+  }
+  std::string arena;
+  std::vector<absl::string_view> ciphertexts;
+  ASSERT_THAT(
+      cipher->EncryptDeterministicallyBatch(inputs, &arena, &ciphertexts),
+      test::IsOk());
+  ASSERT_EQ(ciphertexts.size(), messages.size());
+  std::vector<std::string> expected_ciphertexts;
+  for (int i = 0; i < messages.size(); ++i) {
+    auto ct = cipher->EncryptDeterministically(messages[i], aads[i]);
+    EXPECT_TRUE(ct.ok()) << ct.status();
+    EXPECT_EQ(ct.ValueOrDie(), ciphertexts[i]);
+    expected_ciphertexts.push_back(ct.ValueOrDie());
+  }
+
+  std::vector<std::pair<absl::string_view, absl::string_view>> ct_inputs;
+  for (int i = 0; i < messages.size(); ++i) {
+    ct_inputs.emplace_back(expected_ciphertexts[i], aads[i]);
+  }
+  std::string pt_arena;
+  std::vector<absl::string_view> plaintexts;
+  ASSERT_THAT(
+      cipher->DecryptDeterministicallyBatch(ct_inputs, &pt_arena, &plaintexts),
+      test::IsOk());
+  ASSERT_EQ(plaintexts.size(), messages.size());
+  for (int i = 0; i < messages.size(); ++i) {
+    EXPECT_EQ(messages[i], plaintexts[i]);
+  }
+
+  // A modified ciphertext fails the batch and leaves no plaintext behind.
+  std::string modified = expected_ciphertexts[50];
+  modified[20] ^= 1;
+  ct_inputs[50].first = modified;
+  EXPECT_THAT(
+      cipher->DecryptDeterministicallyBatch(ct_inputs, &pt_arena, &plaintexts),
+      StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_TRUE(pt_arena.empty());
+  EXPECT_TRUE(plaintexts.empty());
+  ct_inputs[50].first = "too short";
+  EXPECT_THAT(
+      cipher->DecryptDeterministicallyBatch(ct_inputs, &pt_arena, &plaintexts),
+      StatusIs(util::error::INVALID_ARGUMENT));
+}
+
 TEST(AesSivBoringSslTest, testDecryptModification) {
   if (kUseOnlyFips) {
     GTEST_SKIP() << "Not supported in FIPS-only mode";
@@ -0,0 +1,477 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/subtle/blake3.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/blocking_counter.h"
+#include "absl/types/span.h"
+#include "openssl/mem.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define TINK_BLAKE3_AVX2 1
+// Makes sure that the lane code is compiled for each target it is used in.
+#define TINK_BLAKE3_LANES_INLINE inline __attribute__((always_inline))
+#else
+#define TINK_BLAKE3_LANES_INLINE inline
+#endif
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+constexpr int Blake3Hasher::kKeySize;
+constexpr int Blake3Hasher::kOutputSize;
+constexpr int Blake3Hasher::kChunkSize;
+constexpr int Blake3Hasher::kLanes;
+constexpr int Blake3Hasher::kBlockSize;
+constexpr int Blake3Hasher::kMaxDepth;
+
+namespace {
+
+constexpr int kLanes = Blake3Hasher::kLanes;
+constexpr int kBlockSize = 64;
+constexpr int kBlocksPerChunk = Blake3Hasher::kChunkSize / kBlockSize;
+
+constexpr uint32_t kIv[8] = {0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A,
+                             0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19};
+
+// The message words used by each of the 7 rounds.
+constexpr uint8_t kMessageSchedule[7][16] = {
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+    {2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8},
+    {3, 4, 10, 12, 13, 2, 7, 14, 6, 5, 9, 0, 11, 15, 8, 1},
+    {10, 7, 12, 9, 14, 3, 13, 15, 4, 0, 11, 2, 5, 8, 1, 6},
+    {12, 13, 9, 11, 15, 10, 14, 8, 7, 2, 5, 3, 0, 1, 6, 4},
+    {9, 14, 11, 5, 8, 12, 15, 1, 13, 3, 0, 10, 2, 6, 4, 7},
+    {11, 15, 5, 0, 1, 9, 8, 6, 14, 10, 2, 12, 3, 4, 7, 13},
+};
+
+// Domain separation flags.
+constexpr uint32_t kChunkStart = 1 << 0;
+constexpr uint32_t kChunkEnd = 1 << 1;
+constexpr uint32_t kParent = 1 << 2;
+constexpr uint32_t kRoot = 1 << 3;
+constexpr uint32_t kKeyedHash = 1 << 4;
+
+uint32_t LoadLe32(const uint8_t* in) {
+  return static_cast<uint32_t>(in[0]) | static_cast<uint32_t>(in[1]) << 8 |
+         static_cast<uint32_t>(in[2]) << 16 |
+         static_cast<uint32_t>(in[3]) << 24;
+}
+
+void StoreLe32(uint32_t value, uint8_t* out) {
+  out[0] = value;
+  out[1] = value >> 8;
+  out[2] = value >> 16;
+  out[3] = value >> 24;
+}
+
+inline uint32_t Rotr(uint32_t value, int shift) {
+  return (value >> shift) | (value << (32 - shift));
+}
+
+inline void G(uint32_t s[16], int a, int b, int c, int d, uint32_t mx,
+              uint32_t my) {
+  s[a] += s[b] + mx;
+  s[d] = Rotr(s[d] ^ s[a], 16);
+  s[c] += s[d];
+  s[b] = Rotr(s[b] ^ s[c], 12);
+  s[a] += s[b] + my;
+  s[d] = Rotr(s[d] ^ s[a], 8);
+  s[c] += s[d];
+  s[b] = Rotr(s[b] ^ s[c], 7);
+}
+
+// The compression function on a single block, which is zero-padded to
+// kBlockSize bytes.
+void Compress(const uint32_t cv[8], const uint8_t block[kBlockSize],
+              uint32_t block_length, uint64_t counter, uint32_t flags,
+              uint32_t out[16]) {
+  uint32_t m[16];
+  for (int i = 0; i < 16; i++) m[i] = LoadLe32(block + 4 * i);
+  uint32_t s[16];
+  for (int i = 0; i < 8; i++) s[i] = cv[i];
+  for (int i = 0; i < 4; i++) s[8 + i] = kIv[i];
+  s[12] = static_cast<uint32_t>(counter);
+  s[13] = static_cast<uint32_t>(counter >> 32);
+  s[14] = block_length;
+  s[15] = flags;
+  for (int r = 0; r < 7; r++) {
+    const uint8_t* w = kMessageSchedule[r];
+    G(s, 0, 4, 8, 12, m[w[0]], m[w[1]]);
+    G(s, 1, 5, 9, 13, m[w[2]], m[w[3]]);
+    G(s, 2, 6, 10, 14, m[w[4]], m[w[5]]);
+    G(s, 3, 7, 11, 15, m[w[6]], m[w[7]]);
+    G(s, 0, 5, 10, 15, m[w[8]], m[w[9]]);
+    G(s, 1, 6, 11, 12, m[w[10]], m[w[11]]);
+    G(s, 2, 7, 8, 13, m[w[12]], m[w[13]]);
+    G(s, 3, 4, 9, 14, m[w[14]], m[w[15]]);
+  }
+  for (int i = 0; i < 8; i++) {
+    out[i] = s[i] ^ s[i + 8];
+    out[i + 8] = s[i + 8] ^ cv[i];
+  }
+  OPENSSL_cleanse(s, sizeof(s));
+}
+
+// The input of the compression which computes a node's chaining value, or,
+// for the root, the output.
+struct Output {
+  uint32_t cv[8];
+  uint8_t block[kBlockSize];
+  uint32_t block_length;
+  uint64_t counter;
+  uint32_t flags;
+};
+
+void ChainingValue(const Output& output, uint32_t cv[8]) {
+  uint32_t words[16];
+  Compress(output.cv, output.block, output.block_length, output.counter,
+           output.flags, words);
+  std::memcpy(cv, words, 8 * sizeof(uint32_t));
+  OPENSSL_cleanse(words, sizeof(words));
+}
+
+void ParentOutput(const uint32_t left[8], const uint32_t right[8],
+                  const uint32_t key_words[8], uint32_t flags,
+                  Output* output) {
+  std::memcpy(output->cv, key_words, sizeof(output->cv));
+  for (int i = 0; i < 8; i++) {
+    StoreLe32(left[i], output->block + 4 * i);
+    StoreLe32(right[i], output->block + 32 + 4 * i);
+  }
+  output->block_length = kBlockSize;
+  output->counter = 0;
+  output->flags = flags | kParent;
+}
+
+// The state of a compression in rows 0 to 15 and the message block in rows
+// 16 to 31, one column per lane. The rows are template parameters, so that
+// the compiler knows that they do not alias and vectorizes the loop over the
+// lanes.
+template <int A, int B, int C, int D, int X, int Y>
+TINK_BLAKE3_LANES_INLINE void LanesG(uint32_t v[32][kLanes]) {
+  for (int i = 0; i < kLanes; i++) {
+    v[A][i] += v[B][i] + v[X][i];
+    v[D][i] = Rotr(v[D][i] ^ v[A][i], 16);
+    v[C][i] += v[D][i];
+    v[B][i] = Rotr(v[B][i] ^ v[C][i], 12);
+    v[A][i] += v[B][i] + v[Y][i];
+    v[D][i] = Rotr(v[D][i] ^ v[A][i], 8);
+    v[C][i] += v[D][i];
+    v[B][i] = Rotr(v[B][i] ^ v[C][i], 7);
+  }
+}
+
+template <int R>
+TINK_BLAKE3_LANES_INLINE void LanesRound(uint32_t v[32][kLanes]) {
+  constexpr int kM = 16;
+  LanesG<0, 4, 8, 12, kM + kMessageSchedule[R][0],
+         kM + kMessageSchedule[R][1]>(v);
+  LanesG<1, 5, 9, 13, kM + kMessageSchedule[R][2],
+         kM + kMessageSchedule[R][3]>(v);
+  LanesG<2, 6, 10, 14, kM + kMessageSchedule[R][4],
+         kM + kMessageSchedule[R][5]>(v);
+  LanesG<3, 7, 11, 15, kM + kMessageSchedule[R][6],
+         kM + kMessageSchedule[R][7]>(v);
+  LanesG<0, 5, 10, 15, kM + kMessageSchedule[R][8],
+         kM + kMessageSchedule[R][9]>(v);
+  LanesG<1, 6, 11, 12, kM + kMessageSchedule[R][10],
+         kM + kMessageSchedule[R][11]>(v);
+  LanesG<2, 7, 8, 13, kM + kMessageSchedule[R][12],
+         kM + kMessageSchedule[R][13]>(v);
+  LanesG<3, 4, 9, 14, kM + kMessageSchedule[R][14],
+         kM + kMessageSchedule[R][15]>(v);
+}
+
+// Writes the chaining values of the kLanes full chunks starting at 'chunks',
+// the first of which has the number 'counter', to cvs[8 * lane + i].
+TINK_BLAKE3_LANES_INLINE void HashChunkLanesImpl(const uint32_t key_words[8],
+                                                 const uint8_t* chunks,
+                                                 uint64_t counter,
+                                                 uint32_t flags,
+                                                 uint32_t* cvs) {
+  uint32_t h[8][kLanes];
+  uint32_t v[32][kLanes];
+  for (int i = 0; i < 8; i++) {
+    for (int lane = 0; lane < kLanes; lane++) h[i][lane] = key_words[i];
+  }
+  for (int block = 0; block < kBlocksPerChunk; block++) {
+    uint32_t block_flags = flags;
+    if (block == 0) block_flags |= kChunkStart;
+    if (block == kBlocksPerChunk - 1) block_flags |= kChunkEnd;
+    for (int lane = 0; lane < kLanes; lane++) {
+      const uint8_t* in =
+          chunks + lane * Blake3Hasher::kChunkSize + block * kBlockSize;
+      for (int i = 0; i < 16; i++) v[16 + i][lane] = LoadLe32(in + 4 * i);
+    }
+    for (int lane = 0; lane < kLanes; lane++) {
+      for (int i = 0; i < 8; i++) v[i][lane] = h[i][lane];
+      for (int i = 0; i < 4; i++) v[8 + i][lane] = kIv[i];
+      v[12][lane] = static_cast<uint32_t>(counter + lane);
+      v[13][lane] = static_cast<uint32_t>((counter + lane) >> 32);
+      v[14][lane] = kBlockSize;
+      v[15][lane] = block_flags;
+    }
+    LanesRound<0>(v);
+    LanesRound<1>(v);
+    LanesRound<2>(v);
+    LanesRound<3>(v);
+    LanesRound<4>(v);
+    LanesRound<5>(v);
+    LanesRound<6>(v);
+    for (int i = 0; i < 8; i++) {
+      for (int lane = 0; lane < kLanes; lane++) {
+        h[i][lane] = v[i][lane] ^ v[i + 8][lane];
+      }
+    }
+  }
+  for (int lane = 0; lane < kLanes; lane++) {
+    for (int i = 0; i < 8; i++) cvs[8 * lane + i] = h[i][lane];
+  }
+  OPENSSL_cleanse(h, sizeof(h));
+  OPENSSL_cleanse(v, sizeof(v));
+}
+
+void HashChunkLanesPortable(const uint32_t key_words[8],
+                            const uint8_t* chunks, uint64_t counter,
+                            uint32_t flags, uint32_t* cvs) {
+  HashChunkLanesImpl(key_words, chunks, counter, flags, cvs);
+}
+
+#ifdef TINK_BLAKE3_AVX2
+// The same code, where a row of the lanes fits into one 256-bit register.
+__attribute__((target("avx2"))) void HashChunkLanesAvx2(
+    const uint32_t key_words[8], const uint8_t* chunks, uint64_t counter,
+    uint32_t flags, uint32_t* cvs) {
+  HashChunkLanesImpl(key_words, chunks, counter, flags, cvs);
+}
+#endif
+
+void HashChunkLanes(const uint32_t key_words[8], const uint8_t* chunks,
+                    uint64_t counter, uint32_t flags, uint32_t* cvs) {
+#ifdef TINK_BLAKE3_AVX2
+  static const bool avx2 = __builtin_cpu_supports("avx2");
+  if (avx2) {
+    HashChunkLanesAvx2(key_words, chunks, counter, flags, cvs);
+    return;
+  }
+#endif
+  HashChunkLanesPortable(key_words, chunks, counter, flags, cvs);
+}
+
+}  // namespace
+
+Blake3Hasher::Blake3Hasher() : flags_(0) {
+  std::memcpy(key_words_, kIv, sizeof(key_words_));
+  Reset();
+}
+
+Blake3Hasher::Blake3Hasher(const uint8_t key[kKeySize])
+    : flags_(kKeyedHash) {
+  for (int i = 0; i < 8; i++) key_words_[i] = LoadLe32(key + 4 * i);
+  Reset();
+}
+
+Blake3Hasher::~Blake3Hasher() {
+  OPENSSL_cleanse(key_words_, sizeof(key_words_));
+  OPENSSL_cleanse(chunk_cv_, sizeof(chunk_cv_));
+  OPENSSL_cleanse(block_, sizeof(block_));
+  OPENSSL_cleanse(cv_stack_, sizeof(cv_stack_));
+}
+
+void Blake3Hasher::Reset() {
+  cv_stack_length_ = 0;
+  StartChunk(0);
+}
+
+void Blake3Hasher::StartChunk(uint64_t chunk_counter) {
+  std::memcpy(chunk_cv_, key_words_, sizeof(chunk_cv_));
+  chunk_counter_ = chunk_counter;
+  std::memset(block_, 0, sizeof(block_));
+  block_length_ = 0;
+  blocks_compressed_ = 0;
+}
+
+void Blake3Hasher::Update(absl::string_view data) {
+  UpdateInternal(data, nullptr);
+}
+
+void Blake3Hasher::Update(absl::string_view data,
+                          const ParallelOptions& options) {
+  UpdateInternal(data, &options);
+}
+
+void Blake3Hasher::UpdateInternal(absl::string_view data,
+                                  const ParallelOptions* options) {
+  const uint8_t* in = reinterpret_cast<const uint8_t*>(data.data());
+  size_t size = data.size();
+  while (size > 0) {
+    // A chunk is only finished once more input follows, as the last chunk
+    // may be the root.
+    if (ChunkLength() == kChunkSize) {
+      uint32_t words[16];
+      Compress(chunk_cv_, block_, kBlockSize, chunk_counter_,
+               flags_ | kChunkEnd, words);
+      AddChunkChainingValue(words, chunk_counter_ + 1);
+      OPENSSL_cleanse(words, sizeof(words));
+      StartChunk(chunk_counter_ + 1);
+    }
+    if (ChunkLength() == 0) {
+      // Full chunks which are followed by more input.
+      int64_t num_chunks = (size - 1) / kChunkSize / kLanes * kLanes;
+      if (num_chunks > 0) {
+        HashChunks(in, num_chunks, options);
+        in += num_chunks * kChunkSize;
+        size -= num_chunks * kChunkSize;
+        continue;
+      }
+    }
+    int take = std::min<size_t>(kChunkSize - ChunkLength(), size);
+    UpdateChunk(in, take);
+    in += take;
+    size -= take;
+  }
+}
+
+void Blake3Hasher::UpdateChunk(const uint8_t* data, int size) {
+  while (size > 0) {
+    // As for chunks, the last block is only compressed once more input
+    // follows.
+    if (block_length_ == kBlockSize) {
+      uint32_t words[16];
+      Compress(chunk_cv_, block_, kBlockSize, chunk_counter_,
+               flags_ | (blocks_compressed_ == 0 ? kChunkStart : 0), words);
+      std::memcpy(chunk_cv_, words, sizeof(chunk_cv_));
+      OPENSSL_cleanse(words, sizeof(words));
+      blocks_compressed_++;
+      std::memset(block_, 0, sizeof(block_));
+      block_length_ = 0;
+    }
+    int take = std::min(kBlockSize - block_length_, size);
+    std::memcpy(block_ + block_length_, data, take);
+    block_length_ += take;
+    data += take;
+    size -= take;
+  }
+}
+
+void Blake3Hasher::HashChunks(const uint8_t* data, int64_t num_chunks,
+                              const ParallelOptions* options) {
+  int64_t chunks_per_task = num_chunks;
+  if (options != nullptr && num_chunks * kChunkSize >= 2 * options->task_size) {
+    chunks_per_task =
+        std::max<int64_t>(options->task_size / kChunkSize / kLanes, 1) *
+        kLanes;
+  }
+  // Bounds the memory for the chaining values of a call on a large input.
+  const int64_t max_batch = std::max<int64_t>(chunks_per_task, 1 << 14);
+  std::vector<uint32_t> cvs(std::min(num_chunks, max_batch) * 8);
+  while (num_chunks > 0) {
+    int64_t batch = std::min(num_chunks, max_batch);
+    const uint8_t* batch_data = data;
+    const uint64_t counter = chunk_counter_;
+    uint32_t* batch_cvs = cvs.data();
+    auto hash_range = [this, batch_data, counter, batch_cvs](int64_t begin,
+                                                              int64_t end) {
+      for (int64_t i = begin; i < end; i += kLanes) {
+        HashChunkLanes(key_words_, batch_data + i * kChunkSize, counter + i,
+                       flags_, batch_cvs + 8 * i);
+      }
+    };
+    if (batch <= chunks_per_task) {
+      hash_range(0, batch);
+    } else {
+      int64_t num_tasks = (batch + chunks_per_task - 1) / chunks_per_task;
+      absl::BlockingCounter done(num_tasks);
+      for (int64_t begin = 0; begin < batch; begin += chunks_per_task) {
+        int64_t end = std::min(begin + chunks_per_task, batch);
+        options->schedule([&hash_range, &done, begin, end]() {
+          hash_range(begin, end);
+          done.DecrementCount();
+        });
+      }
+      done.Wait();
+    }
+    for (int64_t i = 0; i < batch; i++) {
+      AddChunkChainingValue(&cvs[8 * i], counter + i + 1);
+    }
+    StartChunk(counter + batch);
+    data += batch * kChunkSize;
+    num_chunks -= batch;
+  }
+  OPENSSL_cleanse(cvs.data(), cvs.size() * sizeof(uint32_t));
+}
+
+void Blake3Hasher::AddChunkChainingValue(const uint32_t cv[8],
+                                         uint64_t total_chunks) {
+  uint32_t new_cv[8];
+  std::memcpy(new_cv, cv, sizeof(new_cv));
+  // Every trailing zero bit of the chunk count completes a subtree.
+  while ((total_chunks & 1) == 0) {
+    cv_stack_length_--;
+    Output parent;
+    ParentOutput(cv_stack_[cv_stack_length_], new_cv, key_words_, flags_,
+                 &parent);
+    ChainingValue(parent, new_cv);
+    OPENSSL_cleanse(&parent, sizeof(parent));
+    total_chunks >>= 1;
+  }
+  std::memcpy(cv_stack_[cv_stack_length_], new_cv, sizeof(new_cv));
+  cv_stack_length_++;
+  OPENSSL_cleanse(new_cv, sizeof(new_cv));
+}
+
+void Blake3Hasher::Finish(absl::Span<uint8_t> out) const {
+  Output output;
+  std::memcpy(output.cv, chunk_cv_, sizeof(output.cv));
+  std::memcpy(output.block, block_, sizeof(output.block));
+  output.block_length = block_length_;
+  output.counter = chunk_counter_;
+  output.flags =
+      flags_ | kChunkEnd | (blocks_compressed_ == 0 ? kChunkStart : 0);
+  for (int i = cv_stack_length_ - 1; i >= 0; i--) {
+    uint32_t cv[8];
+    ChainingValue(output, cv);
+    ParentOutput(cv_stack_[i], cv, key_words_, flags_, &output);
+    OPENSSL_cleanse(cv, sizeof(cv));
+  }
+  // The output is the root compression for consecutive counters.
+  uint32_t words[16];
+  for (size_t offset = 0, counter = 0; offset < out.size();
+       offset += 4 * 16, counter++) {
+    Compress(output.cv, output.block, output.block_length, counter,
+             output.flags | kRoot, words);
+    for (int i = 0; i < 16 && offset + 4 * i < out.size(); i++) {
+      uint8_t bytes[4];
+      StoreLe32(words[i], bytes);
+      size_t n = std::min<size_t>(4, out.size() - offset - 4 * i);
+      std::memcpy(out.data() + offset + 4 * i, bytes, n);
+    }
+  }
+  OPENSSL_cleanse(words, sizeof(words));
+  OPENSSL_cleanse(&output, sizeof(output));
+}
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
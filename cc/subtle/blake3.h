@@ -0,0 +1,124 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_SUBTLE_BLAKE3_H_
+#define TINK_SUBTLE_BLAKE3_H_
+
+#include <cstdint>
+#include <functional>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+// BLAKE3 (https://github.com/BLAKE3-team/BLAKE3-specs) in the hash and in
+// the keyed hash mode, with extendable output.
+//
+// Runs of full chunks are compressed kLanes chunks at a time. As in
+// ChaCha20Lanes, the state is kept word-major, so that every step of a round
+// is one loop over the lanes, which the compiler turns into AVX2 or NEON
+// instructions. Update() can in addition spread the chunks of a large input
+// over several threads, see ParallelOptions; the result does not depend on
+// how the input is split or hashed.
+class Blake3Hasher {
+ public:
+  static constexpr int kKeySize = 32;
+  static constexpr int kOutputSize = 32;
+  static constexpr int kChunkSize = 1024;
+  static constexpr int kLanes = 8;
+
+  struct ParallelOptions {
+    // Runs the given task, typically on a thread pool owned by the caller.
+    // Tasks may run on any thread and in any order. Must be non-null,
+    // and must eventually run every task it has been given.
+    std::function<void(std::function<void()>)> schedule;
+    // The number of bytes hashed by one task. Inputs shorter than twice
+    // this are hashed on the calling thread. Must be positive.
+    int64_t task_size = 1 << 18;
+  };
+
+  // The hash mode.
+  Blake3Hasher();
+  // The keyed hash mode, e.g. for a MAC or a PRF.
+  explicit Blake3Hasher(const uint8_t key[kKeySize]);
+  ~Blake3Hasher();
+
+  Blake3Hasher(const Blake3Hasher&) = delete;
+  Blake3Hasher& operator=(const Blake3Hasher&) = delete;
+
+  // Absorbs 'data'.
+  void Update(absl::string_view data);
+
+  // Like Update(), but hashes the chunks of 'data' concurrently with
+  // options.schedule. Returns once all of them are hashed.
+  void Update(absl::string_view data, const ParallelOptions& options);
+
+  // Writes out.size() bytes of the output for the data absorbed so far.
+  // Does not change the state, so more data may be absorbed afterwards.
+  void Finish(absl::Span<uint8_t> out) const;
+
+  // Returns to the state after construction.
+  void Reset();
+
+ private:
+  static constexpr int kBlockSize = 64;
+  // Enough for 2^64 bytes of input.
+  static constexpr int kMaxDepth = 54;
+
+  void UpdateInternal(absl::string_view data, const ParallelOptions* options);
+
+  // Absorbs 'size' bytes into the current chunk, which must fit.
+  void UpdateChunk(const uint8_t* data, int size);
+
+  // Hashes the 'num_chunks' full chunks in 'data', a multiple of kLanes,
+  // which follow the current chunk. The current chunk must be empty, and
+  // must not be the last one.
+  void HashChunks(const uint8_t* data, int64_t num_chunks,
+                  const ParallelOptions* options);
+
+  // Pushes the chaining value of the chunk 'total_chunks - 1', merging the
+  // subtrees it completes.
+  void AddChunkChainingValue(const uint32_t cv[8], uint64_t total_chunks);
+
+  void StartChunk(uint64_t chunk_counter);
+  int ChunkLength() const {
+    return blocks_compressed_ * kBlockSize + block_length_;
+  }
+
+  uint32_t key_words_[8];
+  uint32_t flags_;
+
+  // The current chunk.
+  uint32_t chunk_cv_[8];
+  uint64_t chunk_counter_;
+  uint8_t block_[kBlockSize];
+  int block_length_;
+  int blocks_compressed_;
+
+  // The chaining values of the complete subtrees to the left of the current
+  // chunk, largest first.
+  uint32_t cv_stack_[kMaxDepth][8];
+  int cv_stack_length_;
+};
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_SUBTLE_BLAKE3_H_
@@ -0,0 +1,159 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/subtle/blake3_mac.h"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "openssl/mem.h"
+#include "tink/mac.h"
+#include "tink/subtle/blake3.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+constexpr int Blake3Mac::kKeySize;
+constexpr int Blake3Mac::kMaxTagSize;
+
+namespace {
+
+util::Status ValidateParameters(uint32_t tag_size,
+                                const util::SecretData& key) {
+  if (key.size() != Blake3Mac::kKeySize) {
+    return util::Status(util::error::INVALID_ARGUMENT, "invalid key size");
+  }
+  if (tag_size == 0 || tag_size > Blake3Mac::kMaxTagSize) {
+    return util::Status(util::error::INVALID_ARGUMENT, "invalid tag size");
+  }
+  return util::OkStatus();
+}
+
+}  // namespace
+
+// static
+util::StatusOr<std::unique_ptr<Mac>> Blake3Mac::New(util::SecretData key,
+                                                    uint32_t tag_size) {
+  auto status = CheckFipsCompatibility<Blake3Mac>();
+  if (!status.ok()) return status;
+  status = ValidateParameters(tag_size, key);
+  if (!status.ok()) return status;
+  return {absl::WrapUnique(new Blake3Mac(std::move(key), tag_size, nullptr))};
+}
+
+// static
+util::StatusOr<std::unique_ptr<Mac>> Blake3Mac::New(
+    util::SecretData key, uint32_t tag_size,
+    const Blake3Hasher::ParallelOptions& options) {
+  auto status = CheckFipsCompatibility<Blake3Mac>();
+  if (!status.ok()) return status;
+  status = ValidateParameters(tag_size, key);
+  if (!status.ok()) return status;
+  if (!options.schedule || options.task_size <= 0) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "invalid parallel options");
+  }
+  return {absl::WrapUnique(new Blake3Mac(
+      std::move(key), tag_size,
+      absl::make_unique<Blake3Hasher::ParallelOptions>(options)))};
+}
+
+void Blake3Mac::ComputeTag(absl::string_view data,
+                           absl::string_view data_suffix,
+                           uint8_t* out) const {
+  Blake3Hasher hasher(key_.data());
+  if (options_ != nullptr) {
+    hasher.Update(data, *options_);
+  } else {
+    hasher.Update(data);
+  }
+  hasher.Update(data_suffix);
+  hasher.Finish(absl::MakeSpan(out, tag_size_));
+}
+
+util::StatusOr<std::string> Blake3Mac::ComputeMac(
+    absl::string_view data) const {
+  return ComputeMacWithPrefix("", data, "");
+}
+
+util::Status Blake3Mac::VerifyMac(absl::string_view mac,
+                                  absl::string_view data) const {
+  return VerifyMacWithSuffix(mac, data, "");
+}
+
+util::StatusOr<std::string> Blake3Mac::ComputeMacWithPrefix(
+    absl::string_view output_prefix, absl::string_view data,
+    absl::string_view data_suffix) const {
+  std::string mac(output_prefix.size() + tag_size_, '\0');
+  std::copy(output_prefix.begin(), output_prefix.end(), mac.begin());
+  ComputeTag(data, data_suffix,
+             reinterpret_cast<uint8_t*>(&mac[output_prefix.size()]));
+  return mac;
+}
+
+util::Status Blake3Mac::VerifyMacWithSuffix(
+    absl::string_view mac_value, absl::string_view data,
+    absl::string_view data_suffix) const {
+  if (mac_value.size() != tag_size_) {
+    return util::Status(util::error::INVALID_ARGUMENT, "incorrect tag size");
+  }
+  uint8_t buf[kMaxTagSize];
+  ComputeTag(data, data_suffix, buf);
+  if (CRYPTO_memcmp(buf, mac_value.data(), tag_size_) != 0) {
+    return util::Status(util::error::INVALID_ARGUMENT, "verification failed");
+  }
+  return util::OkStatus();
+}
+
+// static
+util::StatusOr<std::unique_ptr<StatefulMac>> StatefulBlake3Mac::New(
+    uint32_t tag_size, const util::SecretData& key) {
+  auto status = CheckFipsCompatibility<Blake3Mac>();
+  if (!status.ok()) return status;
+  status = ValidateParameters(tag_size, key);
+  if (!status.ok()) return status;
+  return {absl::WrapUnique(new StatefulBlake3Mac(tag_size, key))};
+}
+
+util::Status StatefulBlake3Mac::Update(absl::string_view data) {
+  hasher_.Update(data);
+  return util::OkStatus();
+}
+
+util::StatusOr<std::string> StatefulBlake3Mac::Finalize() {
+  std::string tag(tag_size_, '\0');
+  hasher_.Finish(
+      absl::MakeSpan(reinterpret_cast<uint8_t*>(&tag[0]), tag.size()));
+  return tag;
+}
+
+util::Status StatefulBlake3Mac::Reset() {
+  hasher_.Reset();
+  return util::OkStatus();
+}
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,126 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_SUBTLE_BLAKE3_MAC_H_
+#define TINK_SUBTLE_BLAKE3_MAC_H_
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/strings/string_view.h"
+#include "tink/config/tink_fips.h"
+#include "tink/mac.h"
+#include "tink/subtle/blake3.h"
+#include "tink/subtle/mac/stateful_mac.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+// BLAKE3 in the keyed hash mode, truncated (or extended) to the tag size.
+class Blake3Mac : public Mac {
+ public:
+  static constexpr int kKeySize = Blake3Hasher::kKeySize;
+  static constexpr int kMaxTagSize = 64;
+
+  static crypto::tink::util::StatusOr<std::unique_ptr<Mac>> New(
+      util::SecretData key, uint32_t tag_size);
+
+  // Like New(), but messages of at least 2 * options.task_size bytes are
+  // hashed concurrently with options.schedule.
+  static crypto::tink::util::StatusOr<std::unique_ptr<Mac>> New(
+      util::SecretData key, uint32_t tag_size,
+      const Blake3Hasher::ParallelOptions& options);
+
+  crypto::tink::util::StatusOr<std::string> ComputeMac(
+      absl::string_view data) const override;
+
+  crypto::tink::util::Status VerifyMac(
+      absl::string_view mac,
+      absl::string_view data) const override;
+
+  // Hashes 'data' and 'data_suffix' without concatenating them, and writes
+  // the MAC directly after 'output_prefix'.
+  crypto::tink::util::StatusOr<std::string> ComputeMacWithPrefix(
+      absl::string_view output_prefix, absl::string_view data,
+      absl::string_view data_suffix) const override;
+
+  crypto::tink::util::Status VerifyMacWithSuffix(
+      absl::string_view mac_value, absl::string_view data,
+      absl::string_view data_suffix) const override;
+
+  static constexpr crypto::tink::FipsCompatibility kFipsStatus =
+      crypto::tink::FipsCompatibility::kNotFips;
+
+ private:
+  Blake3Mac(util::SecretData key, uint32_t tag_size,
+            std::unique_ptr<Blake3Hasher::ParallelOptions> options)
+      : key_(std::move(key)), tag_size_(tag_size),
+        options_(std::move(options)) {}
+
+  // Writes the tag of 'data' followed by 'data_suffix' to 'out', which must
+  // hold tag_size_ bytes.
+  void ComputeTag(absl::string_view data, absl::string_view data_suffix,
+                  uint8_t* out) const;
+
+  const util::SecretData key_;
+  const uint32_t tag_size_;
+  // Null if messages are hashed on the calling thread.
+  const std::unique_ptr<Blake3Hasher::ParallelOptions> options_;
+};
+
+// The MAC of Blake3Mac, computed incrementally, e.g. for StreamingMacImpl.
+class StatefulBlake3Mac : public StatefulMac {
+ public:
+  static crypto::tink::util::StatusOr<std::unique_ptr<StatefulMac>> New(
+      uint32_t tag_size, const util::SecretData& key);
+
+  crypto::tink::util::Status Update(absl::string_view data) override;
+  crypto::tink::util::StatusOr<std::string> Finalize() override;
+  crypto::tink::util::Status Reset() override;
+
+ private:
+  StatefulBlake3Mac(uint32_t tag_size, const util::SecretData& key)
+      : hasher_(key.data()), tag_size_(tag_size) {}
+
+  Blake3Hasher hasher_;
+  const uint32_t tag_size_;
+};
+
+class StatefulBlake3MacFactory : public StatefulMacFactory {
+ public:
+  StatefulBlake3MacFactory(uint32_t tag_size, const util::SecretData& key)
+      : tag_size_(tag_size), key_(key) {}
+
+  crypto::tink::util::StatusOr<std::unique_ptr<StatefulMac>> Create()
+      const override {
+    return StatefulBlake3Mac::New(tag_size_, key_);
+  }
+
+ private:
+  const uint32_t tag_size_;
+  const util::SecretData key_;
+};
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_SUBTLE_BLAKE3_MAC_H_
@@ -0,0 +1,212 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/subtle/blake3_mac.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "tink/config/tink_fips.h"
+#include "tink/mac.h"
+#include "tink/subtle/mac/stateful_mac.h"
+#include "tink/subtle/random.h"
+#include "tink/subtle/streaming_mac_impl.h"
+#include "tink/subtle/test_util.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "tink/util/test_matchers.h"
+#include "tink/util/test_util.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+namespace {
+
+using ::crypto::tink::test::HexEncode;
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::testing::Eq;
+using ::testing::Not;
+
+constexpr char kTestKey[] = "whats the Elvish word for friend";
+
+util::SecretData TestKey() {
+  return util::SecretDataFromStringView(kTestKey);
+}
+
+// The input of the official BLAKE3 test vectors.
+std::string TestInput(int size) {
+  std::string input(size, '\0');
+  for (int i = 0; i < size; i++) input[i] = i % 251;
+  return input;
+}
+
+TEST(Blake3MacTest, TestVectors) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  auto mac = Blake3Mac::New(TestKey(), 32);
+  ASSERT_THAT(mac.status(), IsOk());
+  EXPECT_THAT(
+      HexEncode(mac.ValueOrDie()->ComputeMac("").ValueOrDie()),
+      Eq("92b2b75604ed3c761f9d6f62392c8a9227ad0ea3f09573e783f1498a4ed60d26"));
+
+  // Shorter and longer tags are prefixes of the extendable output.
+  std::string long_tag =
+      "9f29700902f7c86e514ddc4df1e3049f258b2472b6dd5267f61bf13983b78dd5"
+      "f9a88abfefdfa1e00b418971f2b39c64ca621e8eb37fceac57fd0c8fc8e117d4";
+  for (uint32_t tag_size : {16, 32, 64}) {
+    auto mac = Blake3Mac::New(TestKey(), tag_size);
+    ASSERT_THAT(mac.status(), IsOk());
+    std::string tag =
+        mac.ValueOrDie()->ComputeMac(TestInput(2049)).ValueOrDie();
+    EXPECT_THAT(HexEncode(tag), Eq(long_tag.substr(0, 2 * tag_size)));
+    EXPECT_THAT(mac.ValueOrDie()->VerifyMac(tag, TestInput(2049)), IsOk());
+  }
+}
+
+TEST(Blake3MacTest, VerifyRejectsModifiedInputs) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  std::unique_ptr<Mac> mac = Blake3Mac::New(TestKey(), 16).ValueOrDie();
+  std::string data = Random::GetRandomBytes(3000);
+  std::string tag = mac->ComputeMac(data).ValueOrDie();
+  EXPECT_THAT(mac->VerifyMac(tag, data), IsOk());
+  EXPECT_THAT(mac->VerifyMac(tag, data.substr(1)),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(mac->VerifyMac(tag.substr(1), data),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  for (int i = 0; i < tag.size(); i++) {
+    std::string modified_tag = tag;
+    modified_tag[i] ^= 1;
+    EXPECT_THAT(mac->VerifyMac(modified_tag, data),
+                StatusIs(util::error::INVALID_ARGUMENT));
+  }
+}
+
+TEST(Blake3MacTest, PrefixAndSuffix) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  std::unique_ptr<Mac> mac = Blake3Mac::New(TestKey(), 20).ValueOrDie();
+  std::string data = Random::GetRandomBytes(1500);
+  std::string tag = mac->ComputeMac(absl::StrCat(data, "x")).ValueOrDie();
+  EXPECT_THAT(mac->ComputeMacWithPrefix("prefix", data, "x").ValueOrDie(),
+              Eq(absl::StrCat("prefix", tag)));
+  EXPECT_THAT(mac->VerifyMacWithSuffix(tag, data, "x"), IsOk());
+  EXPECT_THAT(mac->VerifyMacWithSuffix(tag, data, "y"), Not(IsOk()));
+}
+
+TEST(Blake3MacTest, Parallel) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  int tasks = 0;
+  Blake3Hasher::ParallelOptions options;
+  options.schedule = [&tasks](std::function<void()> task) {
+    tasks++;
+    task();
+  };
+  options.task_size = 4 * Blake3Hasher::kChunkSize;
+  std::unique_ptr<Mac> mac = Blake3Mac::New(TestKey(), 32).ValueOrDie();
+  std::unique_ptr<Mac> parallel_mac =
+      Blake3Mac::New(TestKey(), 32, options).ValueOrDie();
+  std::string data = Random::GetRandomBytes(100000);
+  std::string tag = mac->ComputeMac(data).ValueOrDie();
+  EXPECT_THAT(parallel_mac->ComputeMac(data).ValueOrDie(), Eq(tag));
+  EXPECT_THAT(parallel_mac->VerifyMac(tag, data), IsOk());
+  EXPECT_THAT(tasks, testing::Gt(0));
+
+  options.schedule = nullptr;
+  EXPECT_THAT(Blake3Mac::New(TestKey(), 32, options).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(Blake3MacTest, InvalidParameters) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  EXPECT_THAT(Blake3Mac::New(TestKey(), 0).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(Blake3Mac::New(TestKey(), 65).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(
+      Blake3Mac::New(util::SecretDataFromStringView("short key"), 16).status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(StatefulBlake3Mac::New(16, util::SecretData(31)).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(Blake3MacTest, StatefulMacMatchesMac) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  std::unique_ptr<Mac> mac = Blake3Mac::New(TestKey(), 16).ValueOrDie();
+  std::unique_ptr<StatefulMac> stateful_mac =
+      StatefulBlake3Mac::New(16, TestKey()).ValueOrDie();
+  std::string data = Random::GetRandomBytes(10000);
+  for (int split : {0, 1, 1024, 5000}) {
+    SCOPED_TRACE(absl::StrCat("split: ", split));
+    ASSERT_THAT(stateful_mac->Reset(), IsOk());
+    ASSERT_THAT(stateful_mac->Update(data.substr(0, split)), IsOk());
+    ASSERT_THAT(stateful_mac->Update(data.substr(split)), IsOk());
+    EXPECT_THAT(stateful_mac->Finalize().ValueOrDie(),
+                Eq(mac->ComputeMac(data).ValueOrDie()));
+  }
+}
+
+TEST(Blake3MacTest, StreamingMac) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  std::unique_ptr<Mac> mac = Blake3Mac::New(TestKey(), 32).ValueOrDie();
+  StreamingMacImpl streaming_mac(
+      absl::make_unique<StatefulBlake3MacFactory>(32, TestKey()));
+  for (int size : {0, 10, 1000, 100000}) {
+    SCOPED_TRACE(absl::StrCat("size: ", size));
+    std::string data = Random::GetRandomBytes(size);
+    std::string tag = mac->ComputeMac(data).ValueOrDie();
+
+    auto compute_stream = streaming_mac.NewComputeMacOutputStream();
+    ASSERT_THAT(compute_stream.status(), IsOk());
+    ASSERT_THAT(
+        test::WriteToStream(compute_stream.ValueOrDie().get(), data, false),
+        IsOk());
+    EXPECT_THAT(compute_stream.ValueOrDie()->CloseAndGetResult().ValueOrDie(),
+                Eq(tag));
+
+    auto verify_stream = streaming_mac.NewVerifyMacOutputStream(tag);
+    ASSERT_THAT(verify_stream.status(), IsOk());
+    ASSERT_THAT(
+        test::WriteToStream(verify_stream.ValueOrDie().get(), data, false),
+        IsOk());
+    EXPECT_THAT(verify_stream.ValueOrDie()->CloseAndGetResult(), IsOk());
+  }
+}
+
+}  // namespace
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
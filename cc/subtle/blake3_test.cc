@@ -0,0 +1,221 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/subtle/blake3.h"
+
+#include <functional>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/escaping.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "tink/subtle/random.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+namespace {
+
+using ::testing::Eq;
+using ::testing::Ne;
+
+constexpr char kTestKey[] = "whats the Elvish word for friend";
+
+// The input of the official test vectors.
+std::string TestInput(int size) {
+  std::string input(size, '\0');
+  for (int i = 0; i < size; i++) input[i] = i % 251;
+  return input;
+}
+
+const uint8_t* TestKey() { return reinterpret_cast<const uint8_t*>(kTestKey); }
+
+std::string HexOutput(const Blake3Hasher& hasher, int size) {
+  std::vector<uint8_t> out(size);
+  hasher.Finish(absl::MakeSpan(out));
+  return absl::BytesToHexString(
+      absl::string_view(reinterpret_cast<const char*>(out.data()), size));
+}
+
+struct TestVector {
+  int input_size;
+  std::string hash;
+  std::string keyed_hash;
+};
+
+// The first 32 bytes of the outputs of the official test vectors,
+// https://github.com/BLAKE3-team/BLAKE3/blob/master/test_vectors.
+std::vector<TestVector> TestVectors() {
+  return {
+    {0, "af1349b9f5f9a1a6a0404dea36dcc9499bcb25c9adc112b7cc9a93cae41f3262",
+     "92b2b75604ed3c761f9d6f62392c8a9227ad0ea3f09573e783f1498a4ed60d26"},
+    {1, "2d3adedff11b61f14c886e35afa036736dcd87a74d27b5c1510225d0f592e213",
+     "6d7878dfff2f485635d39013278ae14f1454b8c0a3a2d34bc1ab38228a80c95b"},
+    {63, "e9bc37a594daad83be9470df7f7b3798297c3d834ce80ba85d6e207627b7db7b",
+     "bb1eb5d4afa793c1ebdd9fb08def6c36d10096986ae0cfe148cd101170ce37ae"},
+    {64, "4eed7141ea4a5cd4b788606bd23f46e212af9cacebacdc7d1f4c6dc7f2511b98",
+     "ba8ced36f327700d213f120b1a207a3b8c04330528586f414d09f2f7d9ccb7e6"},
+    {65, "de1e5fa0be70df6d2be8fffd0e99ceaa8eb6e8c93a63f2d8d1c30ecb6b263dee",
+     "c0a4edefa2d2accb9277c371ac12fcdbb52988a86edc54f0716e1591b4326e72"},
+    {1023, "10108970eeda3eb932baac1428c7a2163b0e924c9a9e25b35bba72b28f70bd11",
+     "c951ecdf03288d0fcc96ee3413563d8a6d3589547f2c2fb36d9786470f1b9d6e"},
+    {1024, "42214739f095a406f3fc83deb889744ac00df831c10daa55189b5d121c855af7",
+     "75c46f6f3d9eb4f55ecaaee480db732e6c2105546f1e675003687c31719c7ba4"},
+    {1025, "d00278ae47eb27b34faecf67b4fe263f82d5412916c1ffd97c8cb7fb814b8444",
+     "357dc55de0c7e382c900fd6e320acc04146be01db6a8ce7210b7189bd664ea69"},
+    {2048, "e776b6028c7cd22a4d0ba182a8bf62205d2ef576467e838ed6f2529b85fba24a",
+     "879cf1fa2ea0e79126cb1063617a05b6ad9d0b696d0d757cf053439f60a99dd1"},
+    {2049, "5f4d72f40d7a5f82b15ca2b2e44b1de3c2ef86c426c95c1af0b6879522563030",
+     "9f29700902f7c86e514ddc4df1e3049f258b2472b6dd5267f61bf13983b78dd5"},
+    {8192, "aae792484c8efe4f19e2ca7d371d8c467ffb10748d8a5a1ae579948f718a2a63",
+     "dc9637c8845a770b4cbf76b8daec0eebf7dc2eac11498517f08d44c8fc00d58a"},
+    {8193, "bab6c09cb8ce8cf459261398d2e7aef35700bf488116ceb94a36d0f5f1b7bc3b",
+     "954a2a75420c8d6547e3ba5b98d963e6fa6491addc8c023189cc519821b4a1f5"},
+    {16384, "f875d6646de28985646f34ee13be9a576fd515f76b5b0a26bb324735041ddde4",
+     "9e9fc4eb7cf081ea7c47d1807790ed211bfec56aa25bb7037784c13c4b707b0d"},
+    {31744, "62b6960e1a44bcc1eb1a611a8d6235b6b4b78f32e7abc4fb4c6cdcce94895c47",
+     "efa53b389ab67c593dba624d898d0f7353ab99e4ac9d42302ee64cbf9939a419"},
+    {102400,
+     "bc3e3d41a1146b069abffad3c0d44860cf664390afce4d9661f7902e7943e085",
+     "1c35d1a5811083fd7119f5d5d1ba027b4d01c0c6c49fb6ff2cf75393ea5db4a7"},
+  };
+}
+
+TEST(Blake3HasherTest, TestVectors) {
+  for (const TestVector& test : TestVectors()) {
+    SCOPED_TRACE(absl::StrCat("input_size: ", test.input_size));
+    std::string input = TestInput(test.input_size);
+    Blake3Hasher hasher;
+    hasher.Update(input);
+    EXPECT_THAT(HexOutput(hasher, 32), Eq(test.hash));
+    Blake3Hasher keyed_hasher(TestKey());
+    keyed_hasher.Update(input);
+    EXPECT_THAT(HexOutput(keyed_hasher, 32), Eq(test.keyed_hash));
+  }
+}
+
+TEST(Blake3HasherTest, ExtendedOutput) {
+  Blake3Hasher hasher(TestKey());
+  hasher.Update(TestInput(3073));
+  EXPECT_THAT(
+      HexOutput(hasher, 131),
+      Eq("68dede9bef00ba89e43f31a6825f4cf433389fedae75c04ee9f0cf16a427c95a96d6"
+         "da3fe985054d3478865be9a092250839a697bbda74e279e8a9e69f0025e4cfddd6c"
+         "fb434b1cd9543aaf97c635d1b451a4386041e4bb100f5e45407cbbc24fa53ea2de3"
+         "536ccb329e4eb9466ec37093a42cf62b82903c696a93a50b702c80f3c3c5"));
+  // Shorter outputs are prefixes of longer ones.
+  for (int size : {0, 1, 31, 32, 33, 64, 65, 130}) {
+    EXPECT_THAT(HexOutput(hasher, size),
+                Eq(HexOutput(hasher, 131).substr(0, 2 * size)));
+  }
+}
+
+TEST(Blake3HasherTest, UpdateInPieces) {
+  std::string input = subtle::Random::GetRandomBytes(40000);
+  Blake3Hasher reference(TestKey());
+  reference.Update(input);
+  std::string expected = HexOutput(reference, 32);
+  for (int piece_size : {1, 63, 64, 65, 1000, 1024, 1025, 8192, 9000}) {
+    SCOPED_TRACE(absl::StrCat("piece_size: ", piece_size));
+    Blake3Hasher hasher(TestKey());
+    absl::string_view remaining = input;
+    while (!remaining.empty()) {
+      hasher.Update(remaining.substr(0, piece_size));
+      remaining.remove_prefix(std::min<size_t>(piece_size, remaining.size()));
+    }
+    EXPECT_THAT(HexOutput(hasher, 32), Eq(expected));
+  }
+  // Finish() does not change the state.
+  Blake3Hasher hasher(TestKey());
+  hasher.Update(absl::string_view(input).substr(0, 12345));
+  HexOutput(hasher, 32);
+  hasher.Update(absl::string_view(input).substr(12345));
+  EXPECT_THAT(HexOutput(hasher, 32), Eq(expected));
+}
+
+TEST(Blake3HasherTest, Reset) {
+  Blake3Hasher hasher(TestKey());
+  hasher.Update(TestInput(5000));
+  hasher.Reset();
+  hasher.Update(TestInput(1025));
+  EXPECT_THAT(
+      HexOutput(hasher, 32),
+      Eq("357dc55de0c7e382c900fd6e320acc04146be01db6a8ce7210b7189bd664ea69"));
+}
+
+TEST(Blake3HasherTest, KeysGiveDifferentOutputs) {
+  std::string input = TestInput(100);
+  Blake3Hasher hasher;
+  hasher.Update(input);
+  std::string other_key = subtle::Random::GetRandomBytes(32);
+  Blake3Hasher other_hasher(reinterpret_cast<const uint8_t*>(&other_key[0]));
+  other_hasher.Update(input);
+  Blake3Hasher keyed_hasher(TestKey());
+  keyed_hasher.Update(input);
+  EXPECT_THAT(HexOutput(keyed_hasher, 32), Ne(HexOutput(hasher, 32)));
+  EXPECT_THAT(HexOutput(keyed_hasher, 32), Ne(HexOutput(other_hasher, 32)));
+}
+
+TEST(Blake3HasherTest, Parallel) {
+  absl::Mutex mutex;
+  std::vector<std::thread> threads;
+  int tasks = 0;
+  Blake3Hasher::ParallelOptions options;
+  options.schedule = [&](std::function<void()> task) {
+    absl::MutexLock lock(&mutex);
+    tasks++;
+    threads.emplace_back(std::move(task));
+  };
+  options.task_size = 8 * Blake3Hasher::kChunkSize;
+  for (int size : {0, 1000, 16 * 1024, 16 * 1024 + 1, 100000, 102400,
+                   (1 << 20) + 3}) {
+    SCOPED_TRACE(absl::StrCat("size: ", size));
+    std::string input = TestInput(size);
+    Blake3Hasher reference(TestKey());
+    reference.Update(input);
+    // Some bytes before the large update, so that it starts in the middle
+    // of the tree.
+    for (int prefix_size : {0, 1, 1024, 3000}) {
+      if (prefix_size > size) continue;
+      Blake3Hasher hasher(TestKey());
+      hasher.Update(absl::string_view(input).substr(0, prefix_size));
+      hasher.Update(absl::string_view(input).substr(prefix_size), options);
+      EXPECT_THAT(HexOutput(hasher, 32), Eq(HexOutput(reference, 32)));
+    }
+  }
+  for (std::thread& thread : threads) thread.join();
+  EXPECT_THAT(tasks, testing::Gt(0));
+
+  Blake3Hasher hasher(TestKey());
+  hasher.Update(TestInput(102400), options);
+  for (std::thread& thread : threads) {
+    if (thread.joinable()) thread.join();
+  }
+  EXPECT_THAT(
+      HexOutput(hasher, 32),
+      Eq("1c35d1a5811083fd7119f5d5d1ba027b4d01c0c6c49fb6ff2cf75393ea5db4a7"));
+}
+
+}  // namespace
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,149 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/subtle/chacha20_lanes.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include "openssl/mem.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+constexpr int ChaCha20Lanes::kLanes;
+constexpr int ChaCha20Lanes::kKeySize;
+constexpr int ChaCha20Lanes::kNonceSize;
+constexpr int ChaCha20Lanes::kHChaCha20NonceSize;
+constexpr int ChaCha20Lanes::kBlockSize;
+
+namespace {
+
+constexpr int kLanes = ChaCha20Lanes::kLanes;
+
+// "expand 32-byte k"
+constexpr uint32_t kSigma[4] = {0x61707865, 0x3320646e, 0x79622d32,
+                                0x6b206574};
+
+uint32_t LoadLe32(const uint8_t* in) {
+  return static_cast<uint32_t>(in[0]) | static_cast<uint32_t>(in[1]) << 8 |
+         static_cast<uint32_t>(in[2]) << 16 |
+         static_cast<uint32_t>(in[3]) << 24;
+}
+
+void StoreLe32(uint32_t value, uint8_t* out) {
+  out[0] = value;
+  out[1] = value >> 8;
+  out[2] = value >> 16;
+  out[3] = value >> 24;
+}
+
+inline uint32_t Rotl(uint32_t value, int shift) {
+  return (value << shift) | (value >> (32 - shift));
+}
+
+// The rows are template parameters, so that the compiler knows that they do
+// not alias and vectorizes the loop over the lanes.
+template <int A, int B, int C, int D>
+inline void QuarterRound(uint32_t x[16][kLanes]) {
+  for (int i = 0; i < kLanes; i++) {
+    x[A][i] += x[B][i];
+    x[D][i] = Rotl(x[D][i] ^ x[A][i], 16);
+    x[C][i] += x[D][i];
+    x[B][i] = Rotl(x[B][i] ^ x[C][i], 12);
+    x[A][i] += x[B][i];
+    x[D][i] = Rotl(x[D][i] ^ x[A][i], 8);
+    x[C][i] += x[D][i];
+    x[B][i] = Rotl(x[B][i] ^ x[C][i], 7);
+  }
+}
+
+// The 20 rounds of ChaCha20 on the state 'x' of all lanes.
+void Rounds(uint32_t x[16][kLanes]) {
+  for (int i = 0; i < 10; i++) {
+    QuarterRound<0, 4, 8, 12>(x);
+    QuarterRound<1, 5, 9, 13>(x);
+    QuarterRound<2, 6, 10, 14>(x);
+    QuarterRound<3, 7, 11, 15>(x);
+    QuarterRound<0, 5, 10, 15>(x);
+    QuarterRound<1, 6, 11, 12>(x);
+    QuarterRound<2, 7, 8, 13>(x);
+    QuarterRound<3, 4, 9, 14>(x);
+  }
+}
+
+}  // namespace
+
+ChaCha20Lanes::ChaCha20Lanes() {
+  for (int word = 0; word < 16; word++) {
+    for (int lane = 0; lane < kLanes; lane++) {
+      input_[word][lane] = word < 4 ? kSigma[word] : 0;
+    }
+  }
+}
+
+ChaCha20Lanes::~ChaCha20Lanes() { OPENSSL_cleanse(input_, sizeof(input_)); }
+
+void ChaCha20Lanes::SetLane(int lane, const uint8_t key[kKeySize],
+                            const uint8_t nonce[kNonceSize]) {
+  for (int i = 0; i < 8; i++) input_[4 + i][lane] = LoadLe32(key + 4 * i);
+  for (int i = 0; i < 3; i++) input_[13 + i][lane] = LoadLe32(nonce + 4 * i);
+}
+
+void ChaCha20Lanes::Blocks(uint32_t counter,
+                           uint8_t blocks[kLanes][kBlockSize]) const {
+  uint32_t x[16][kLanes];
+  std::memcpy(x, input_, sizeof(x));
+  for (int lane = 0; lane < kLanes; lane++) x[12][lane] = counter;
+  Rounds(x);
+  for (int word = 0; word < 16; word++) {
+    for (int lane = 0; lane < kLanes; lane++) {
+      uint32_t input = word == 12 ? counter : input_[word][lane];
+      StoreLe32(x[word][lane] + input, &blocks[lane][4 * word]);
+    }
+  }
+  OPENSSL_cleanse(x, sizeof(x));
+}
+
+// static
+void ChaCha20Lanes::HChaCha20(
+    const uint8_t key[kKeySize],
+    const uint8_t nonces[kLanes][kHChaCha20NonceSize],
+    uint8_t subkeys[kLanes][kKeySize]) {
+  uint32_t x[16][kLanes];
+  for (int lane = 0; lane < kLanes; lane++) {
+    for (int i = 0; i < 4; i++) x[i][lane] = kSigma[i];
+    for (int i = 0; i < 8; i++) x[4 + i][lane] = LoadLe32(key + 4 * i);
+    for (int i = 0; i < 4; i++) {
+      x[12 + i][lane] = LoadLe32(nonces[lane] + 4 * i);
+    }
+  }
+  Rounds(x);
+  // The subkey consists of the first and the last row, without the
+  // feed-forward of the input.
+  for (int lane = 0; lane < kLanes; lane++) {
+    for (int i = 0; i < 4; i++) {
+      StoreLe32(x[i][lane], &subkeys[lane][4 * i]);
+      StoreLe32(x[12 + i][lane], &subkeys[lane][16 + 4 * i]);
+    }
+  }
+  OPENSSL_cleanse(x, sizeof(x));
+}
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
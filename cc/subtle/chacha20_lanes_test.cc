@@ -0,0 +1,107 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/subtle/chacha20_lanes.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "absl/types/span.h"
+#include "openssl/chacha.h"
+#include "tink/subtle/random.h"
+#include "tink/util/test_util.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+namespace {
+
+constexpr int kLanes = ChaCha20Lanes::kLanes;
+
+std::string ToHex(const uint8_t* data, size_t size) {
+  return test::HexEncode(
+      std::string(reinterpret_cast<const char*>(data), size));
+}
+
+// RFC 8439, section 2.3.2.
+TEST(ChaCha20LanesTest, BlockTestVector) {
+  uint8_t key[ChaCha20Lanes::kKeySize];
+  for (int i = 0; i < ChaCha20Lanes::kKeySize; i++) key[i] = i;
+  const uint8_t nonce[ChaCha20Lanes::kNonceSize] = {0, 0, 0, 0x09, 0, 0,
+                                                    0, 0x4a, 0, 0, 0, 0};
+  ChaCha20Lanes lanes;
+  for (int lane = 0; lane < kLanes; lane++) lanes.SetLane(lane, key, nonce);
+  uint8_t blocks[kLanes][ChaCha20Lanes::kBlockSize];
+  lanes.Blocks(1, blocks);
+  for (int lane = 0; lane < kLanes; lane++) {
+    EXPECT_EQ(
+        "10f1e7e4d13b5915500fdd1fa32071c4c7d1f4c733c068030422aa9ac3d46c4e"
+        "d2826446079faa0914c2d705d98b02a2b5129cd1de164eb9cbd083e8a2503c4e",
+        ToHex(blocks[lane], ChaCha20Lanes::kBlockSize));
+  }
+}
+
+// draft-irtf-cfrg-xchacha-03, section 2.2.1.
+TEST(ChaCha20LanesTest, HChaCha20TestVector) {
+  uint8_t key[ChaCha20Lanes::kKeySize];
+  for (int i = 0; i < ChaCha20Lanes::kKeySize; i++) key[i] = i;
+  const uint8_t nonce[ChaCha20Lanes::kHChaCha20NonceSize] = {
+      0, 0, 0, 0x09, 0, 0, 0, 0x4a, 0, 0, 0, 0, 0x31, 0x41, 0x59, 0x27};
+  uint8_t nonces[kLanes][ChaCha20Lanes::kHChaCha20NonceSize];
+  for (int lane = 0; lane < kLanes; lane++) {
+    std::memcpy(nonces[lane], nonce, sizeof(nonce));
+  }
+  uint8_t subkeys[kLanes][ChaCha20Lanes::kKeySize];
+  ChaCha20Lanes::HChaCha20(key, nonces, subkeys);
+  for (int lane = 0; lane < kLanes; lane++) {
+    EXPECT_EQ(
+        "82413b4227b27bfed30e42508a877d73a0f9e4d58a74a853c12ec41326d3ecdc",
+        ToHex(subkeys[lane], ChaCha20Lanes::kKeySize));
+  }
+}
+
+// Every lane computes the same keystream as BoringSSL for its own key and
+// nonce.
+TEST(ChaCha20LanesTest, IndependentLanes) {
+  uint8_t keys[kLanes][ChaCha20Lanes::kKeySize];
+  uint8_t nonces[kLanes][ChaCha20Lanes::kNonceSize];
+  ChaCha20Lanes lanes;
+  for (int lane = 0; lane < kLanes; lane++) {
+    Random::FillRandomBytes(absl::MakeSpan(keys[lane]));
+    Random::FillRandomBytes(absl::MakeSpan(nonces[lane]));
+    lanes.SetLane(lane, keys[lane], nonces[lane]);
+  }
+  for (uint32_t counter : {0u, 1u, 7u, 0xffffffffu}) {
+    uint8_t blocks[kLanes][ChaCha20Lanes::kBlockSize];
+    lanes.Blocks(counter, blocks);
+    for (int lane = 0; lane < kLanes; lane++) {
+      uint8_t zeros[ChaCha20Lanes::kBlockSize] = {0};
+      uint8_t expected[ChaCha20Lanes::kBlockSize];
+      CRYPTO_chacha_20(expected, zeros, sizeof(zeros), keys[lane],
+                       nonces[lane], counter);
+      EXPECT_EQ(ToHex(expected, sizeof(expected)),
+                ToHex(blocks[lane], ChaCha20Lanes::kBlockSize))
+          << "lane " << lane << ", counter " << counter;
+    }
+  }
+}
+
+}  // namespace
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
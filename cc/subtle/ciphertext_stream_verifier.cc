@@ -0,0 +1,229 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/subtle/ciphertext_stream_verifier.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "tink/random_access_stream.h"
+#include "tink/subtle/stream_segment_decrypter.h"
+#include "tink/util/buffer.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+using ::crypto::tink::util::Buffer;
+using ::crypto::tink::util::Status;
+
+namespace {
+
+// The layout of a ciphertext stream, as computed by
+// DecryptingRandomAccessStream.
+struct StreamLayout {
+  int header_end;
+  int ct_segment_size;
+  int64_t ct_size;
+  int64_t segment_count;
+};
+
+// The shared state of the tasks verifying the segments of a stream.
+struct Verification {
+  Verification(StreamSegmentDecrypter* decrypter, RandomAccessStream* source,
+               StreamLayout layout)
+      : segment_decrypter(decrypter), ciphertext_source(source),
+        layout(layout), first_invalid_segment(layout.segment_count) {}
+
+  // Takes the next segment to verify into '*segment_nr', and returns false
+  // if there is none left, or all remaining ones follow an invalid segment.
+  bool NextSegment(int64_t* segment_nr) ABSL_LOCKS_EXCLUDED(mutex) {
+    absl::MutexLock lock(&mutex);
+    if (next_segment >= first_invalid_segment) return false;
+    *segment_nr = next_segment++;
+    return true;
+  }
+
+  // Reads and verifies the specified segment into 'segment'.
+  Status VerifySegment(int64_t segment_nr, std::vector<uint8_t>* segment) {
+    int64_t ct_position = segment_nr * layout.ct_segment_size;
+    if (segment_nr == 0) ct_position = layout.header_end;
+    int64_t segment_end = std::min<int64_t>(
+        (segment_nr + 1) * layout.ct_segment_size, layout.ct_size);
+    int ct_count = segment_end - ct_position;
+    segment->resize(ct_count);
+    auto buffer_result = Buffer::NewNonOwning(
+        reinterpret_cast<char*>(segment->data()), ct_count);
+    if (!buffer_result.ok()) return buffer_result.status();
+    Buffer* buffer = buffer_result.ValueOrDie().get();
+    Status status = ciphertext_source->PRead(ct_position, ct_count, buffer);
+    // Reading up to the end of the stream may report OUT_OF_RANGE.
+    if (!status.ok() && !(status.error_code() == util::error::OUT_OF_RANGE &&
+                          buffer->size() == ct_count)) {
+      return status;
+    }
+    if (buffer->size() != ct_count) {
+      return Status(util::error::INVALID_ARGUMENT, "could not read segment");
+    }
+    return segment_decrypter->VerifySegment(
+        segment_nr, segment_nr == layout.segment_count - 1, segment);
+  }
+
+  // Verifies segments until none are left.
+  void Run() ABSL_LOCKS_EXCLUDED(mutex) {
+    std::vector<uint8_t> segment;
+    int64_t segment_nr;
+    while (NextSegment(&segment_nr)) {
+      Status status = VerifySegment(segment_nr, &segment);
+      if (status.ok()) continue;
+      absl::MutexLock lock(&mutex);
+      if (segment_nr < first_invalid_segment) {
+        first_invalid_segment = segment_nr;
+        first_invalid_status = Status(
+            status.CanonicalCode(),
+            absl::StrCat("segment ", segment_nr, ": ", status.error_message()));
+      }
+    }
+    absl::MutexLock lock(&mutex);
+    running_tasks--;
+  }
+
+  StreamSegmentDecrypter* const segment_decrypter;
+  RandomAccessStream* const ciphertext_source;
+  const StreamLayout layout;
+
+  absl::Mutex mutex;
+  int64_t next_segment ABSL_GUARDED_BY(mutex) = 0;
+  // Segments are taken in increasing order, so once all tasks are done, this
+  // is the first invalid segment, or segment_count if there is none.
+  int64_t first_invalid_segment ABSL_GUARDED_BY(mutex);
+  Status first_invalid_status ABSL_GUARDED_BY(mutex);
+  int running_tasks ABSL_GUARDED_BY(mutex) = 0;
+};
+
+// Reads the header of the stream into 'segment_decrypter' and computes the
+// layout of the stream.
+util::StatusOr<StreamLayout> InitializeStream(
+    StreamSegmentDecrypter* segment_decrypter,
+    RandomAccessStream* ciphertext_source) {
+  int header_size = segment_decrypter->get_header_size();
+  int ct_offset = segment_decrypter->get_ciphertext_offset();
+  auto buffer_result = Buffer::New(header_size);
+  if (!buffer_result.ok()) return buffer_result.status();
+  Buffer* buffer = buffer_result.ValueOrDie().get();
+  Status status = ciphertext_source->PRead(ct_offset, header_size, buffer);
+  if (!status.ok() || buffer->size() != header_size) {
+    if (status.ok() || status.error_code() == util::error::OUT_OF_RANGE) {
+      return Status(util::error::INVALID_ARGUMENT, "could not read header");
+    }
+    return status;
+  }
+  status = segment_decrypter->Init(std::vector<uint8_t>(
+      buffer->get_mem_block(), buffer->get_mem_block() + header_size));
+  if (!status.ok()) return status;
+
+  StreamLayout layout;
+  layout.header_end = ct_offset + header_size;
+  layout.ct_segment_size = segment_decrypter->get_ciphertext_segment_size();
+  auto ct_size_result = ciphertext_source->size();
+  if (!ct_size_result.ok()) return ct_size_result.status();
+  layout.ct_size = ct_size_result.ValueOrDie();
+  layout.segment_count = (layout.ct_size + layout.ct_segment_size - 1) /
+                         layout.ct_segment_size;
+  // Tink supports up to 2^32 segments.
+  if (layout.segment_count - 1 > std::numeric_limits<uint32_t>::max()) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  absl::StrCat("too many segments: ", layout.segment_count));
+  }
+  int segment_overhead = layout.ct_segment_size -
+                         segment_decrypter->get_plaintext_segment_size();
+  if (segment_overhead * layout.segment_count + layout.header_end >
+      layout.ct_size) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "ciphertext stream is too short");
+  }
+  return layout;
+}
+
+}  // namespace
+
+// static
+Status CiphertextStreamVerifier::Verify(
+    std::unique_ptr<StreamSegmentDecrypter> segment_decrypter,
+    RandomAccessStream* ciphertext_source, const Options& options,
+    int64_t* invalid_segment) {
+  if (invalid_segment != nullptr) *invalid_segment = -1;
+  if (segment_decrypter == nullptr) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "segment_decrypter must be non-null");
+  }
+  if (ciphertext_source == nullptr) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "ciphertext_source must be non-null");
+  }
+  if (options.max_segments_in_flight <= 0) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "max_segments_in_flight must be positive");
+  }
+  auto layout_result =
+      InitializeStream(segment_decrypter.get(), ciphertext_source);
+  if (!layout_result.ok()) return layout_result.status();
+
+  // Shared with the tasks, so that it outlives the last of them.
+  auto verification = std::make_shared<Verification>(
+      segment_decrypter.get(), ciphertext_source, layout_result.ValueOrDie());
+  int num_tasks = 1;
+  if (options.schedule) {
+    num_tasks = static_cast<int>(std::min<int64_t>(
+        options.max_segments_in_flight,
+        std::max<int64_t>(1, verification->layout.segment_count)));
+  }
+  {
+    absl::MutexLock lock(&verification->mutex);
+    verification->running_tasks = num_tasks;
+  }
+  for (int i = 1; i < num_tasks; i++) {
+    options.schedule([verification]() { verification->Run(); });
+  }
+  verification->Run();
+
+  absl::MutexLock lock(&verification->mutex);
+  verification->mutex.Await(absl::Condition(
+      +[](int* count) { return *count == 0; },
+      &verification->running_tasks));
+  if (verification->first_invalid_segment ==
+      verification->layout.segment_count) {
+    return util::OkStatus();
+  }
+  if (invalid_segment != nullptr) {
+    *invalid_segment = verification->first_invalid_segment;
+  }
+  return verification->first_invalid_status;
+}
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
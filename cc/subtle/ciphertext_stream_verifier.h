@@ -0,0 +1,69 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TINK_SUBTLE_CIPHERTEXT_STREAM_VERIFIER_H_
+#define TINK_SUBTLE_CIPHERTEXT_STREAM_VERIFIER_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+#include "tink/random_access_stream.h"
+#include "tink/subtle/stream_segment_decrypter.h"
+#include "tink/util/status.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+// Checks that a ciphertext stream is authentic without producing its
+// plaintext, e.g. for scrubbing stored backups: every segment is read from
+// the ciphertext source and passed to StreamSegmentDecrypter::VerifySegment(),
+// which for some schemes (like AES-CTR-HMAC) does not decrypt at all. Several
+// segments can be verified concurrently.
+class CiphertextStreamVerifier {
+ public:
+  struct Options {
+    // If set, runs the given task, typically on a thread pool owned by the
+    // caller, so that up to max_segments_in_flight segments are verified
+    // concurrently. Tasks may run on any thread and in any order, and must
+    // all eventually run. If null, the segments are verified one after the
+    // other on the calling thread.
+    std::function<void(std::function<void()>)> schedule;
+    // The maximal number of segments verified concurrently. Must be
+    // positive.
+    int max_segments_in_flight = 8;
+  };
+
+  // Verifies the ciphertext stream in 'ciphertext_source' with
+  // 'segment_decrypter', which must not have been initialized yet. Returns
+  // OK if every segment is authentic, and otherwise the error of the first
+  // invalid segment. If 'invalid_segment' is non-null, it is set to the
+  // number of that segment, or to -1 if all segments are authentic or the
+  // stream is invalid as a whole (e.g. its header is). 'ciphertext_source'
+  // must support concurrent PRead()s if options.schedule is set.
+  static crypto::tink::util::Status Verify(
+      std::unique_ptr<StreamSegmentDecrypter> segment_decrypter,
+      crypto::tink::RandomAccessStream* ciphertext_source,
+      const Options& options, int64_t* invalid_segment = nullptr);
+};
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_SUBTLE_CIPHERTEXT_STREAM_VERIFIER_H_
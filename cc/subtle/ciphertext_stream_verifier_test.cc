@@ -0,0 +1,235 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/subtle/ciphertext_stream_verifier.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "tink/output_stream.h"
+#include "tink/random_access_stream.h"
+#include "tink/subtle/random.h"
+#include "tink/subtle/test_util.h"
+#include "tink/util/buffer.h"
+#include "tink/util/ostream_output_stream.h"
+#include "tink/util/status.h"
+#include "tink/util/test_matchers.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+namespace {
+
+using ::crypto::tink::subtle::test::DummyStreamingAead;
+using ::crypto::tink::subtle::test::DummyStreamSegmentDecrypter;
+using ::crypto::tink::subtle::test::DummyStreamSegmentEncrypter;
+using ::crypto::tink::subtle::test::TestThreadPool;
+using ::crypto::tink::subtle::test::WriteToStream;
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::testing::Eq;
+using ::testing::HasSubstr;
+
+constexpr int kPtSegmentSize = 100;
+constexpr int kHeaderSize = 10;
+constexpr int kCtOffset = 5;
+constexpr int kCtSegmentSize =
+    kPtSegmentSize + DummyStreamSegmentEncrypter::kSegmentTagSize;
+
+// A RandomAccessStream reading from a string.
+class StringRandomAccessStream : public RandomAccessStream {
+ public:
+  explicit StringRandomAccessStream(std::string data)
+      : data_(std::move(data)) {}
+
+  util::Status PRead(int64_t position, int count,
+                     util::Buffer* dest_buffer) override {
+    if (position >= data_.size()) {
+      dest_buffer->set_size(0).IgnoreError();
+      return util::Status(util::error::OUT_OF_RANGE, "EOF");
+    }
+    int read_count = std::min<int64_t>(count, data_.size() - position);
+    std::memcpy(dest_buffer->get_mem_block(), data_.data() + position,
+                read_count);
+    auto status = dest_buffer->set_size(read_count);
+    if (!status.ok()) return status;
+    if (read_count < count) {
+      return util::Status(util::error::OUT_OF_RANGE, "EOF");
+    }
+    return util::OkStatus();
+  }
+
+  util::StatusOr<int64_t> size() override { return data_.size(); }
+
+ private:
+  const std::string data_;
+};
+
+// Returns the ciphertext of 'plaintext', preceded by kCtOffset bytes.
+std::string GetCiphertext(absl::string_view plaintext) {
+  DummyStreamingAead saead(kPtSegmentSize, kHeaderSize, kCtOffset);
+  auto ct_stream = absl::make_unique<std::stringstream>();
+  *ct_stream << std::string(kCtOffset, 'o');
+  auto ct_buf = ct_stream->rdbuf();
+  auto enc_stream_result = saead.NewEncryptingStream(
+      absl::make_unique<util::OstreamOutputStream>(std::move(ct_stream)),
+      "aad");
+  EXPECT_THAT(enc_stream_result.status(), IsOk());
+  EXPECT_THAT(WriteToStream(enc_stream_result.ValueOrDie().get(), plaintext),
+              IsOk());
+  return ct_buf->str();
+}
+
+// Corrupts the last-segment marker of the specified segment.
+void CorruptSegment(int64_t segment_nr, std::string* ciphertext) {
+  size_t position = std::min<size_t>((segment_nr + 1) * kCtSegmentSize,
+                                     ciphertext->size()) - 1;
+  (*ciphertext)[position] = 'x';
+}
+
+util::Status Verify(const std::string& ciphertext, TestThreadPool* pool,
+                    int max_segments_in_flight, int64_t* invalid_segment) {
+  CiphertextStreamVerifier::Options options;
+  if (pool != nullptr) {
+    options.schedule = [pool](std::function<void()> task) {
+      pool->Schedule(std::move(task));
+    };
+  }
+  options.max_segments_in_flight = max_segments_in_flight;
+  StringRandomAccessStream source(ciphertext);
+  return CiphertextStreamVerifier::Verify(
+      absl::make_unique<DummyStreamSegmentDecrypter>(kPtSegmentSize,
+                                                     kHeaderSize, kCtOffset),
+      &source, options, invalid_segment);
+}
+
+TEST(CiphertextStreamVerifierTest, AuthenticStreams) {
+  TestThreadPool pool(4);
+  for (int pt_size : {0, 1, 84, 85, 86, 1000, 10000}) {
+    std::string ciphertext =
+        GetCiphertext(subtle::Random::GetRandomBytes(pt_size));
+    for (TestThreadPool* scheduler_pool :
+         {&pool, static_cast<TestThreadPool*>(nullptr)}) {
+      for (int max_segments_in_flight : {1, 3, 16}) {
+        SCOPED_TRACE(absl::StrCat("pt_size = ", pt_size,
+                                  ", serial = ", scheduler_pool == nullptr,
+                                  ", max_segments_in_flight = ",
+                                  max_segments_in_flight));
+        int64_t invalid_segment = 42;
+        EXPECT_THAT(Verify(ciphertext, scheduler_pool, max_segments_in_flight,
+                           &invalid_segment),
+                    IsOk());
+        EXPECT_THAT(invalid_segment, Eq(-1));
+      }
+    }
+  }
+}
+
+TEST(CiphertextStreamVerifierTest, ReportsFirstInvalidSegment) {
+  TestThreadPool pool(4);
+  std::string plaintext = subtle::Random::GetRandomBytes(5000);
+  for (int64_t bad_segment : {0, 1, 17, 50}) {
+    std::string ciphertext = GetCiphertext(plaintext);
+    CorruptSegment(bad_segment, &ciphertext);
+    // Segments after the first invalid one do not change the result.
+    if (bad_segment + 2 <= 50) CorruptSegment(bad_segment + 2, &ciphertext);
+    for (TestThreadPool* scheduler_pool :
+         {&pool, static_cast<TestThreadPool*>(nullptr)}) {
+      SCOPED_TRACE(absl::StrCat("bad_segment = ", bad_segment,
+                                ", serial = ", scheduler_pool == nullptr));
+      int64_t invalid_segment = -1;
+      EXPECT_THAT(Verify(ciphertext, scheduler_pool, 8, &invalid_segment),
+                  StatusIs(util::error::INVALID_ARGUMENT,
+                           HasSubstr(absl::StrCat("segment ", bad_segment))));
+      EXPECT_THAT(invalid_segment, Eq(bad_segment));
+    }
+  }
+}
+
+TEST(CiphertextStreamVerifierTest, TruncatedStream) {
+  std::string ciphertext = GetCiphertext(subtle::Random::GetRandomBytes(1000));
+  int64_t invalid_segment;
+  // Cutting the stream at a segment boundary makes the new last segment
+  // fail its last-segment check.
+  EXPECT_THAT(Verify(ciphertext.substr(0, 5 * kCtSegmentSize), nullptr, 1,
+                     &invalid_segment),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(invalid_segment, Eq(4));
+  EXPECT_THAT(Verify(ciphertext.substr(0, kCtOffset + kHeaderSize - 1),
+                     nullptr, 1, &invalid_segment),
+              StatusIs(util::error::INVALID_ARGUMENT,
+                       HasSubstr("could not read header")));
+  EXPECT_THAT(invalid_segment, Eq(-1));
+  EXPECT_THAT(Verify(ciphertext.substr(0, kCtOffset + kHeaderSize), nullptr,
+                     1, &invalid_segment),
+              StatusIs(util::error::INVALID_ARGUMENT, HasSubstr("too short")));
+}
+
+TEST(CiphertextStreamVerifierTest, InvalidHeader) {
+  std::string ciphertext = GetCiphertext("plaintext");
+  ciphertext[kCtOffset] = 'x';
+  EXPECT_THAT(Verify(ciphertext, nullptr, 1, nullptr),
+              StatusIs(util::error::INVALID_ARGUMENT,
+                       HasSubstr("Invalid stream header")));
+}
+
+TEST(CiphertextStreamVerifierTest, InvalidArguments) {
+  std::string ciphertext = GetCiphertext("plaintext");
+  EXPECT_THAT(Verify(ciphertext, nullptr, 0, nullptr),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  StringRandomAccessStream source(ciphertext);
+  EXPECT_THAT(CiphertextStreamVerifier::Verify(
+                  nullptr, &source, CiphertextStreamVerifier::Options()),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(CiphertextStreamVerifier::Verify(
+                  absl::make_unique<DummyStreamSegmentDecrypter>(
+                      kPtSegmentSize, kHeaderSize, kCtOffset),
+                  nullptr, CiphertextStreamVerifier::Options()),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(CiphertextStreamVerifierTest, NonceBasedStreamingAead) {
+  DummyStreamingAead saead(kPtSegmentSize, kHeaderSize, kCtOffset);
+  std::string ciphertext = GetCiphertext(subtle::Random::GetRandomBytes(500));
+  StringRandomAccessStream source(ciphertext);
+  EXPECT_THAT(saead.VerifyCiphertext(&source, "aad",
+                                     CiphertextStreamVerifier::Options()),
+              IsOk());
+  CorruptSegment(3, &ciphertext);
+  StringRandomAccessStream corrupted_source(ciphertext);
+  int64_t invalid_segment;
+  EXPECT_THAT(saead.VerifyCiphertext(&corrupted_source, "aad",
+                                     CiphertextStreamVerifier::Options(),
+                                     &invalid_segment),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(invalid_segment, Eq(3));
+}
+
+}  // namespace
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
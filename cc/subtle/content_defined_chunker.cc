@@ -0,0 +1,119 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/subtle/content_defined_chunker.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+namespace {
+
+constexpr int kMinAverageSize = 64;
+constexpr int kMaxAverageSize = 1 << 30;
+
+// The Gear table, 256 pseudorandom 64-bit values from SplitMix64 with seed 0.
+// Changing it changes all chunk boundaries, and hence breaks deduplication
+// with data chunked before.
+const std::array<uint64_t, 256>& GearTable() {
+  static const std::array<uint64_t, 256>* table = []() {
+    auto* gear = new std::array<uint64_t, 256>();
+    uint64_t state = 0;
+    for (uint64_t& value : *gear) {
+      state += 0x9e3779b97f4a7c15ULL;
+      uint64_t z = state;
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+      value = z ^ (z >> 31);
+    }
+    return gear;
+  }();
+  return *table;
+}
+
+// Returns a mask of the 'bits' most significant bits. The most significant
+// bits of the Gear hash depend on all of the last 64 bytes.
+uint64_t HighBitsMask(int bits) { return ~uint64_t{0} << (64 - bits); }
+
+}  // namespace
+
+// static
+util::StatusOr<std::unique_ptr<ContentDefinedChunker>>
+ContentDefinedChunker::New(const Params& params) {
+  if (params.average_size < kMinAverageSize ||
+      params.average_size > kMaxAverageSize ||
+      (params.average_size & (params.average_size - 1)) != 0) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "average_size must be a power of 2 in [64, 2^30]");
+  }
+  if (params.min_size <= 0 || params.min_size > params.average_size ||
+      params.max_size < params.average_size) {
+    return util::Status(
+        util::error::INVALID_ARGUMENT,
+        "must have 0 < min_size <= average_size <= max_size");
+  }
+  int bits = 0;
+  while ((1 << bits) < params.average_size) bits++;
+  // Normalized chunking of level 2: before average_size boundaries are 4
+  // times less likely, after it 4 times more likely.
+  return {absl::WrapUnique(new ContentDefinedChunker(
+      params, HighBitsMask(bits + 2), HighBitsMask(bits - 2)))};
+}
+
+int ContentDefinedChunker::FindChunkEnd(absl::string_view data) const {
+  const int size = std::min<size_t>(data.size(), max_size_);
+  if (size <= min_size_) return size;
+  const std::array<uint64_t, 256>& gear = GearTable();
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data.data());
+  const int normal_size = std::min(size, average_size_);
+  uint64_t hash = 0;
+  int i = min_size_;
+  for (; i < normal_size; i++) {
+    hash = (hash << 1) + gear[bytes[i]];
+    if ((hash & mask_small_) == 0) return i + 1;
+  }
+  for (; i < size; i++) {
+    hash = (hash << 1) + gear[bytes[i]];
+    if ((hash & mask_large_) == 0) return i + 1;
+  }
+  return size;
+}
+
+std::vector<absl::string_view> ContentDefinedChunker::Split(
+    absl::string_view data) const {
+  std::vector<absl::string_view> chunks;
+  while (!data.empty()) {
+    int chunk_size = FindChunkEnd(data);
+    chunks.push_back(data.substr(0, chunk_size));
+    data.remove_prefix(chunk_size);
+  }
+  return chunks;
+}
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
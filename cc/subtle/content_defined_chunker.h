@@ -0,0 +1,96 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_SUBTLE_CONTENT_DEFINED_CHUNKER_H_
+#define TINK_SUBTLE_CONTENT_DEFINED_CHUNKER_H_
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+// Splits data into chunks whose boundaries depend only on the content around
+// them, so that an insertion or deletion in the data changes only the chunks
+// near it. This allows deduplicating the chunks of similar data.
+//
+// The boundaries are found with FastCDC (Xia et al., "FastCDC: a Fast and
+// Efficient Content-Defined Chunking Approach for Data Deduplication", USENIX
+// ATC 2016): a Gear rolling hash over the last 64 bytes, with normalized
+// chunking around the average size. The Gear table is fixed, so that the
+// boundaries are the same across processes and versions.
+//
+// The boundaries are not secret: they leak information about the data, such
+// as the positions of repeated content.
+//
+// This class is thread-safe.
+class ContentDefinedChunker {
+ public:
+  struct Params {
+    // No chunk, except the last one, is shorter than min_size.
+    int min_size;
+    // The expected size of the chunks, must be a power of 2.
+    int average_size;
+    // No chunk is longer than max_size.
+    int max_size;
+  };
+
+  static util::StatusOr<std::unique_ptr<ContentDefinedChunker>> New(
+      const Params& params);
+
+  // Returns the size of the first chunk of 'data'. If 'data' has fewer than
+  // max_size bytes and no chunk boundary is found, returns data.size(): then
+  // the chunk is only complete if 'data' is the rest of the stream. Hence,
+  // when splitting a stream, 'data' must have at least max_size bytes except
+  // at the end of the stream, so that the boundaries do not depend on how the
+  // stream is buffered.
+  int FindChunkEnd(absl::string_view data) const;
+
+  // Splits 'data' into all of its chunks.
+  std::vector<absl::string_view> Split(absl::string_view data) const;
+
+  int min_size() const { return min_size_; }
+  int average_size() const { return average_size_; }
+  int max_size() const { return max_size_; }
+
+ private:
+  ContentDefinedChunker(const Params& params, uint64_t mask_small,
+                        uint64_t mask_large)
+      : min_size_(params.min_size),
+        average_size_(params.average_size),
+        max_size_(params.max_size),
+        mask_small_(mask_small),
+        mask_large_(mask_large) {}
+
+  const int min_size_;
+  const int average_size_;
+  const int max_size_;
+  // Masks of the hash bits that must be zero at a boundary, before and after
+  // average_size_. mask_small_ has more bits, making short chunks less likely.
+  const uint64_t mask_small_;
+  const uint64_t mask_large_;
+};
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_SUBTLE_CONTENT_DEFINED_CHUNKER_H_
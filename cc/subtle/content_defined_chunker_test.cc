@@ -0,0 +1,160 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/subtle/content_defined_chunker.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "tink/subtle/random.h"
+#include "tink/util/status.h"
+#include "tink/util/test_matchers.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+namespace {
+
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::testing::ElementsAreArray;
+
+std::unique_ptr<ContentDefinedChunker> NewChunker(int min_size,
+                                                  int average_size,
+                                                  int max_size) {
+  auto chunker_result =
+      ContentDefinedChunker::New({min_size, average_size, max_size});
+  EXPECT_THAT(chunker_result.status(), IsOk());
+  return std::move(chunker_result).ValueOrDie();
+}
+
+std::vector<int> ChunkSizes(const std::vector<absl::string_view>& chunks) {
+  std::vector<int> sizes;
+  for (absl::string_view chunk : chunks) sizes.push_back(chunk.size());
+  return sizes;
+}
+
+// Returns 'size' bytes which are the same in every run.
+std::string DeterministicBytes(int size) {
+  std::string bytes(size, '\0');
+  uint32_t state = 1;
+  for (char& byte : bytes) {
+    state = state * 1103515245 + 12345;
+    byte = static_cast<char>(state >> 24);
+  }
+  return bytes;
+}
+
+TEST(ContentDefinedChunkerTest, SplitRespectsSizes) {
+  auto chunker = NewChunker(1024, 4096, 16384);
+  std::string data = Random::GetRandomBytes(4 * 1024 * 1024);
+  std::vector<absl::string_view> chunks = chunker->Split(data);
+  ASSERT_FALSE(chunks.empty());
+  std::string joined;
+  for (size_t i = 0; i < chunks.size(); i++) {
+    if (i + 1 < chunks.size()) {
+      EXPECT_GE(chunks[i].size(), 1024);
+    }
+    EXPECT_LE(chunks[i].size(), 16384);
+    joined.append(chunks[i].data(), chunks[i].size());
+  }
+  EXPECT_EQ(data, joined);
+
+  // Normalized chunking keeps the sizes close to the average.
+  double average = static_cast<double>(data.size()) / chunks.size();
+  EXPECT_GT(average, 4096 / 2);
+  EXPECT_LT(average, 4096 * 2);
+}
+
+TEST(ContentDefinedChunkerTest, ShortAndEmptyData) {
+  auto chunker = NewChunker(64, 128, 256);
+  EXPECT_TRUE(chunker->Split("").empty());
+  EXPECT_EQ(10, chunker->FindChunkEnd(std::string(10, 'a')));
+  // Without boundaries, e.g. in constant data, chunks have max_size.
+  EXPECT_THAT(ChunkSizes(chunker->Split(std::string(1000, '\0'))),
+              ElementsAreArray({256, 256, 256, 232}));
+}
+
+TEST(ContentDefinedChunkerTest, BoundariesAreStable) {
+  // Chunk boundaries must not change across versions, or deduplication
+  // with data chunked earlier breaks.
+  const std::vector<int> kStableChunkSizes = {
+      360, 272, 291, 267, 343, 148, 318, 276,
+      291, 329, 331, 257, 222, 89,  67,  235};
+  auto chunker = NewChunker(64, 256, 1024);
+  std::vector<int> sizes =
+      ChunkSizes(chunker->Split(DeterministicBytes(4096)));
+  EXPECT_THAT(sizes, ElementsAreArray(kStableChunkSizes));
+}
+
+TEST(ContentDefinedChunkerTest, BoundariesDoNotDependOnBuffering) {
+  auto chunker = NewChunker(256, 1024, 4096);
+  std::string data = Random::GetRandomBytes(256 * 1024);
+  std::vector<int> expected_sizes = ChunkSizes(chunker->Split(data));
+
+  // Find the boundaries as a stream does, with max_size bytes at a time.
+  std::vector<int> sizes;
+  absl::string_view rest = data;
+  while (!rest.empty()) {
+    int chunk_size = chunker->FindChunkEnd(
+        rest.substr(0, chunker->max_size()));
+    sizes.push_back(chunk_size);
+    rest.remove_prefix(chunk_size);
+  }
+  EXPECT_EQ(expected_sizes, sizes);
+}
+
+TEST(ContentDefinedChunkerTest, InsertionChangesOnlyNearbyChunks) {
+  auto chunker = NewChunker(256, 1024, 4096);
+  std::string data = Random::GetRandomBytes(1024 * 1024);
+  std::string edited_data = data.substr(0, data.size() / 2) + "inserted" +
+                            data.substr(data.size() / 2);
+  std::vector<absl::string_view> chunks = chunker->Split(data);
+  std::vector<absl::string_view> edited_chunks = chunker->Split(edited_data);
+  std::set<absl::string_view> chunk_set(chunks.begin(), chunks.end());
+  int shared = 0;
+  for (absl::string_view chunk : edited_chunks) {
+    if (chunk_set.count(chunk) > 0) shared++;
+  }
+  EXPECT_GE(shared, static_cast<int>(edited_chunks.size()) - 3);
+}
+
+TEST(ContentDefinedChunkerTest, InvalidParams) {
+  for (const ContentDefinedChunker::Params& params :
+       std::vector<ContentDefinedChunker::Params>{{0, 1024, 4096},
+                                                  {2048, 1024, 4096},
+                                                  {256, 1024, 512},
+                                                  {256, 1000, 4096},
+                                                  {16, 32, 4096}}) {
+    SCOPED_TRACE(absl::StrCat(params.min_size, ", ", params.average_size,
+                              ", ", params.max_size));
+    EXPECT_THAT(ContentDefinedChunker::New(params).status(),
+                StatusIs(util::error::INVALID_ARGUMENT));
+  }
+}
+
+}  // namespace
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,88 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/subtle/convergent_chunk_encrypter.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "tink/deterministic_aead.h"
+#include "tink/subtle/aes_siv_boringssl.h"
+#include "tink/subtle/content_defined_chunker.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+// static
+util::StatusOr<std::unique_ptr<ConvergentChunkEncrypter>>
+ConvergentChunkEncrypter::New(
+    const util::SecretData& key,
+    const ContentDefinedChunker::Params& chunker_params) {
+  auto daead_result = AesSivBoringSsl::New(key);
+  if (!daead_result.ok()) return daead_result.status();
+  return New(std::move(daead_result).ValueOrDie(), chunker_params);
+}
+
+// static
+util::StatusOr<std::unique_ptr<ConvergentChunkEncrypter>>
+ConvergentChunkEncrypter::New(
+    std::unique_ptr<DeterministicAead> daead,
+    const ContentDefinedChunker::Params& chunker_params) {
+  if (daead == nullptr) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "daead must be non-null");
+  }
+  auto chunker_result = ContentDefinedChunker::New(chunker_params);
+  if (!chunker_result.ok()) return chunker_result.status();
+  return {absl::WrapUnique(new ConvergentChunkEncrypter(
+      std::move(daead), std::move(chunker_result).ValueOrDie()))};
+}
+
+util::StatusOr<std::vector<std::string>> ConvergentChunkEncrypter::Encrypt(
+    absl::string_view plaintext, absl::string_view associated_data) const {
+  std::vector<std::string> encrypted_chunks;
+  for (absl::string_view chunk : SplitPlaintext(plaintext)) {
+    auto encrypt_result = EncryptChunk(chunk, associated_data);
+    if (!encrypt_result.ok()) return encrypt_result.status();
+    encrypted_chunks.push_back(std::move(encrypt_result).ValueOrDie());
+  }
+  return std::move(encrypted_chunks);
+}
+
+util::StatusOr<std::string> ConvergentChunkEncrypter::Decrypt(
+    absl::Span<const std::string> encrypted_chunks,
+    absl::string_view associated_data) const {
+  std::string plaintext;
+  for (const std::string& encrypted_chunk : encrypted_chunks) {
+    auto decrypt_result = DecryptChunk(encrypted_chunk, associated_data);
+    if (!decrypt_result.ok()) return decrypt_result.status();
+    plaintext.append(decrypt_result.ValueOrDie());
+  }
+  return std::move(plaintext);
+}
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,110 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_SUBTLE_CONVERGENT_CHUNK_ENCRYPTER_H_
+#define TINK_SUBTLE_CONVERGENT_CHUNK_ENCRYPTER_H_
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "tink/deterministic_aead.h"
+#include "tink/subtle/content_defined_chunker.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+// Encrypts data for deduplicating stores, such as backups: the plaintext is
+// split into content-defined chunks with ContentDefinedChunker, and each
+// chunk is encrypted deterministically with AES-SIV. Equal chunks, also of
+// different files, hence have equal ciphertexts, which the store can
+// deduplicate without access to the key, e.g. by a hash of the ciphertext.
+//
+// Unlike AesGcmHkdfStreaming, which encrypts every stream with a fresh key
+// and hence never produces equal ciphertexts, this leaks which chunks are
+// equal, and the sizes and order of the chunks. Whoever knows the key can
+// also confirm a guess of a chunk. Use the associated data to scope
+// deduplication, e.g. to one tenant: chunks are only deduplicated within the
+// same associated data.
+//
+// The chunks are encrypted independently, and the methods of this class are
+// thread-safe, so callers can encrypt and decrypt the chunks of
+// SplitPlaintext() in parallel with EncryptChunk() and DecryptChunk().
+class ConvergentChunkEncrypter {
+ public:
+  // 'key' is a key of AesSivBoringSsl, of 64 bytes.
+  static util::StatusOr<std::unique_ptr<ConvergentChunkEncrypter>> New(
+      const util::SecretData& key,
+      const ContentDefinedChunker::Params& chunker_params);
+
+  // Uses 'daead' to encrypt the chunks, which must be deterministic.
+  static util::StatusOr<std::unique_ptr<ConvergentChunkEncrypter>> New(
+      std::unique_ptr<DeterministicAead> daead,
+      const ContentDefinedChunker::Params& chunker_params);
+
+  // Returns the chunks of 'plaintext'.
+  std::vector<absl::string_view> SplitPlaintext(
+      absl::string_view plaintext) const {
+    return chunker_->Split(plaintext);
+  }
+
+  // Encrypts one chunk of the plaintext.
+  util::StatusOr<std::string> EncryptChunk(
+      absl::string_view chunk, absl::string_view associated_data) const {
+    return daead_->EncryptDeterministically(chunk, associated_data);
+  }
+
+  // Decrypts one chunk of the plaintext.
+  util::StatusOr<std::string> DecryptChunk(
+      absl::string_view encrypted_chunk,
+      absl::string_view associated_data) const {
+    return daead_->DecryptDeterministically(encrypted_chunk, associated_data);
+  }
+
+  // Splits 'plaintext' into chunks, and returns the encrypted chunks, in the
+  // order of the plaintext.
+  util::StatusOr<std::vector<std::string>> Encrypt(
+      absl::string_view plaintext, absl::string_view associated_data) const;
+
+  // Decrypts the 'encrypted_chunks' of a plaintext, and returns their
+  // concatenation.
+  util::StatusOr<std::string> Decrypt(
+      absl::Span<const std::string> encrypted_chunks,
+      absl::string_view associated_data) const;
+
+  const ContentDefinedChunker& chunker() const { return *chunker_; }
+
+ private:
+  ConvergentChunkEncrypter(std::unique_ptr<DeterministicAead> daead,
+                           std::unique_ptr<ContentDefinedChunker> chunker)
+      : daead_(std::move(daead)), chunker_(std::move(chunker)) {}
+
+  const std::unique_ptr<DeterministicAead> daead_;
+  const std::unique_ptr<ContentDefinedChunker> chunker_;
+};
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_SUBTLE_CONVERGENT_CHUNK_ENCRYPTER_H_
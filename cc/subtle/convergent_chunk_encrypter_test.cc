@@ -0,0 +1,141 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/subtle/convergent_chunk_encrypter.h"
+
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "tink/subtle/content_defined_chunker.h"
+#include "tink/subtle/random.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/test_matchers.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+namespace {
+
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+
+constexpr ContentDefinedChunker::Params kChunkerParams = {256, 1024, 4096};
+
+std::unique_ptr<ConvergentChunkEncrypter> NewEncrypter(
+    const util::SecretData& key) {
+  auto encrypter_result = ConvergentChunkEncrypter::New(key, kChunkerParams);
+  EXPECT_THAT(encrypter_result.status(), IsOk());
+  return std::move(encrypter_result).ValueOrDie();
+}
+
+// Returns the number of elements of 'chunks' which are in 'other_chunks'.
+int CountShared(const std::vector<std::string>& chunks,
+                const std::vector<std::string>& other_chunks) {
+  std::set<std::string> other_set(other_chunks.begin(), other_chunks.end());
+  int shared = 0;
+  for (const std::string& chunk : chunks) {
+    if (other_set.count(chunk) > 0) shared++;
+  }
+  return shared;
+}
+
+TEST(ConvergentChunkEncrypterTest, EncryptDecrypt) {
+  auto encrypter = NewEncrypter(Random::GetRandomKeyBytes(64));
+  for (int size : {0, 1, 100, 10000, 1000000}) {
+    SCOPED_TRACE(size);
+    std::string plaintext = Random::GetRandomBytes(size);
+    auto encrypt_result = encrypter->Encrypt(plaintext, "backup");
+    ASSERT_THAT(encrypt_result.status(), IsOk());
+    EXPECT_EQ(encrypter->SplitPlaintext(plaintext).size(),
+              encrypt_result.ValueOrDie().size());
+    auto decrypt_result =
+        encrypter->Decrypt(encrypt_result.ValueOrDie(), "backup");
+    ASSERT_THAT(decrypt_result.status(), IsOk());
+    EXPECT_EQ(plaintext, decrypt_result.ValueOrDie());
+    if (size > 0) {
+      EXPECT_THAT(
+          encrypter->Decrypt(encrypt_result.ValueOrDie(), "other").status(),
+          StatusIs(util::error::INVALID_ARGUMENT));
+    }
+  }
+}
+
+TEST(ConvergentChunkEncrypterTest, SimilarFilesShareEncryptedChunks) {
+  util::SecretData key = Random::GetRandomKeyBytes(64);
+  auto encrypter = NewEncrypter(key);
+  std::string file = Random::GetRandomBytes(512 * 1024);
+  std::string edited_file = "new header" + file;
+  auto chunks = encrypter->Encrypt(file, "backup").ValueOrDie();
+  auto edited_chunks = encrypter->Encrypt(edited_file, "backup").ValueOrDie();
+  EXPECT_GE(CountShared(edited_chunks, chunks),
+            static_cast<int>(edited_chunks.size()) - 2);
+
+  // Encrypters with the same key produce the same chunks.
+  auto other_encrypter = NewEncrypter(key);
+  EXPECT_EQ(chunks, other_encrypter->Encrypt(file, "backup").ValueOrDie());
+
+  // Other associated data or keys result in other chunks.
+  EXPECT_EQ(0, CountShared(encrypter->Encrypt(file, "other").ValueOrDie(),
+                           chunks));
+  EXPECT_EQ(0, CountShared(NewEncrypter(Random::GetRandomKeyBytes(64))
+                               ->Encrypt(file, "backup")
+                               .ValueOrDie(),
+                           chunks));
+}
+
+TEST(ConvergentChunkEncrypterTest, ParallelChunkEncryption) {
+  auto encrypter = NewEncrypter(Random::GetRandomKeyBytes(64));
+  std::string plaintext = Random::GetRandomBytes(256 * 1024);
+  std::vector<absl::string_view> chunks = encrypter->SplitPlaintext(plaintext);
+  std::vector<std::string> encrypted_chunks(chunks.size());
+  constexpr int kThreads = 4;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; t++) {
+    threads.emplace_back([&, t]() {
+      for (size_t i = t; i < chunks.size(); i += kThreads) {
+        auto encrypt_result = encrypter->EncryptChunk(chunks[i], "aad");
+        ASSERT_THAT(encrypt_result.status(), IsOk());
+        encrypted_chunks[i] = encrypt_result.ValueOrDie();
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  EXPECT_EQ(encrypter->Encrypt(plaintext, "aad").ValueOrDie(),
+            encrypted_chunks);
+}
+
+TEST(ConvergentChunkEncrypterTest, InvalidParameters) {
+  EXPECT_THAT(ConvergentChunkEncrypter::New(Random::GetRandomKeyBytes(32),
+                                            kChunkerParams)
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(ConvergentChunkEncrypter::New(Random::GetRandomKeyBytes(64),
+                                            {256, 1000, 4096})
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(ConvergentChunkEncrypter::New(nullptr, kChunkerParams).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
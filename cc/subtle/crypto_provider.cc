@@ -0,0 +1,171 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/subtle/crypto_provider.h"
+
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "tink/util/status.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+using util::Status;
+using util::StatusOr;
+
+namespace {
+
+absl::Mutex* ProviderMutex() {
+  static absl::Mutex* mutex = new absl::Mutex();
+  return mutex;
+}
+
+// Guarded by ProviderMutex().
+std::shared_ptr<const CryptoProvider>* InstalledProvider() {
+  static auto* provider = new std::shared_ptr<const CryptoProvider>();
+  return provider;
+}
+
+bool IsUnavailable(const Status& status) {
+  return status.error_code() == util::error::UNAVAILABLE;
+}
+
+// Sends messages of at least 'min_message_size' bytes to 'offloaded', and
+// all others, as well as those 'offloaded' fails with UNAVAILABLE, to
+// 'software'.
+class ProviderAead : public Aead {
+ public:
+  ProviderAead(std::unique_ptr<Aead> software, std::unique_ptr<Aead> offloaded,
+               int64_t min_message_size)
+      : software_(std::move(software)),
+        offloaded_(std::move(offloaded)),
+        min_message_size_(min_message_size) {}
+
+  StatusOr<std::string> Encrypt(
+      absl::string_view plaintext,
+      absl::string_view associated_data) const override {
+    if (static_cast<int64_t>(plaintext.size()) >= min_message_size_) {
+      auto result = offloaded_->Encrypt(plaintext, associated_data);
+      if (!IsUnavailable(result.status())) return result;
+    }
+    return software_->Encrypt(plaintext, associated_data);
+  }
+
+  StatusOr<std::string> Decrypt(
+      absl::string_view ciphertext,
+      absl::string_view associated_data) const override {
+    if (static_cast<int64_t>(ciphertext.size()) >= min_message_size_) {
+      auto result = offloaded_->Decrypt(ciphertext, associated_data);
+      if (!IsUnavailable(result.status())) return result;
+    }
+    return software_->Decrypt(ciphertext, associated_data);
+  }
+
+  StatusOr<int64_t> CiphertextSize(int64_t plaintext_size) const override {
+    return software_->CiphertextSize(plaintext_size);
+  }
+
+  StatusOr<int64_t> EncryptInto(absl::string_view plaintext,
+                                absl::string_view associated_data,
+                                absl::Span<char> buffer) const override {
+    if (static_cast<int64_t>(plaintext.size()) >= min_message_size_) {
+      auto result =
+          offloaded_->EncryptInto(plaintext, associated_data, buffer);
+      if (!IsUnavailable(result.status())) return result;
+    }
+    return software_->EncryptInto(plaintext, associated_data, buffer);
+  }
+
+ private:
+  const std::unique_ptr<Aead> software_;
+  const std::unique_ptr<Aead> offloaded_;
+  const int64_t min_message_size_;
+};
+
+// Signs with 'offloaded', or with 'software' if 'offloaded' fails with
+// UNAVAILABLE.
+class ProviderPublicKeySign : public PublicKeySign {
+ public:
+  ProviderPublicKeySign(std::unique_ptr<PublicKeySign> software,
+                        std::unique_ptr<PublicKeySign> offloaded)
+      : software_(std::move(software)), offloaded_(std::move(offloaded)) {}
+
+  StatusOr<std::string> Sign(absl::string_view data) const override {
+    auto result = offloaded_->Sign(data);
+    if (!IsUnavailable(result.status())) return result;
+    return software_->Sign(data);
+  }
+
+ private:
+  const std::unique_ptr<PublicKeySign> software_;
+  const std::unique_ptr<PublicKeySign> offloaded_;
+};
+
+}  // namespace
+
+StatusOr<std::unique_ptr<Aead>> CryptoProvider::NewAesGcm(
+    const util::SecretData& key) const {
+  return Status(util::error::UNIMPLEMENTED, "AES-GCM is not supported");
+}
+
+StatusOr<std::unique_ptr<PublicKeySign>> CryptoProvider::NewRsaSsaPkcs1Sign(
+    const SubtleUtilBoringSSL::RsaPrivateKey& private_key,
+    const SubtleUtilBoringSSL::RsaSsaPkcs1Params& params) const {
+  return Status(util::error::UNIMPLEMENTED, "RSA-SSA-PKCS1 is not supported");
+}
+
+void SetCryptoProvider(std::shared_ptr<const CryptoProvider> provider) {
+  absl::MutexLock lock(ProviderMutex());
+  InstalledProvider()->swap(provider);
+}
+
+std::shared_ptr<const CryptoProvider> GetCryptoProvider() {
+  absl::MutexLock lock(ProviderMutex());
+  return *InstalledProvider();
+}
+
+std::unique_ptr<Aead> WithProviderAesGcm(const util::SecretData& key,
+                                         std::unique_ptr<Aead> software) {
+  auto crypto_provider = GetCryptoProvider();
+  if (crypto_provider == nullptr) return software;
+  auto offloaded_result = crypto_provider->NewAesGcm(key);
+  if (!offloaded_result.ok()) return software;
+  return absl::make_unique<ProviderAead>(
+      std::move(software), std::move(offloaded_result.ValueOrDie()),
+      crypto_provider->min_aead_message_size());
+}
+
+std::unique_ptr<PublicKeySign> WithProviderRsaSsaPkcs1Sign(
+    const SubtleUtilBoringSSL::RsaPrivateKey& private_key,
+    const SubtleUtilBoringSSL::RsaSsaPkcs1Params& params,
+    std::unique_ptr<PublicKeySign> software) {
+  auto crypto_provider = GetCryptoProvider();
+  if (crypto_provider == nullptr) return software;
+  auto offloaded_result =
+      crypto_provider->NewRsaSsaPkcs1Sign(private_key, params);
+  if (!offloaded_result.ok()) return software;
+  return absl::make_unique<ProviderPublicKeySign>(
+      std::move(software), std::move(offloaded_result.ValueOrDie()));
+}
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,94 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_SUBTLE_CRYPTO_PROVIDER_H_
+#define TINK_SUBTLE_CRYPTO_PROVIDER_H_
+
+#include <cstdint>
+#include <memory>
+
+#include "tink/aead.h"
+#include "tink/public_key_sign.h"
+#include "tink/subtle/subtle_util_boringssl.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+// An alternative implementation of some of the subtle primitives, e.g. one
+// which offloads them to a hardware accelerator. The primitives it returns
+// must produce outputs which are byte-compatible with the BoringSSL-based
+// ones, so that either implementation can process the outputs of the other.
+//
+// Once installed with SetCryptoProvider(), the key managers of the supported
+// key types consult the provider whenever they create a primitive, and fall
+// back to BoringSSL for what the provider does not support.
+class CryptoProvider {
+ public:
+  virtual ~CryptoProvider() {}
+
+  // Returns an AES-GCM Aead for 'key', compatible with AesGcmBoringSsl, or
+  // an error if the provider does not support it. The default implementation
+  // returns UNIMPLEMENTED.
+  virtual crypto::tink::util::StatusOr<std::unique_ptr<Aead>> NewAesGcm(
+      const util::SecretData& key) const;
+
+  // Returns an RSA-SSA-PKCS1 signer, compatible with
+  // RsaSsaPkcs1SignBoringSsl, or an error if the provider does not support
+  // it. The default implementation returns UNIMPLEMENTED.
+  virtual crypto::tink::util::StatusOr<std::unique_ptr<PublicKeySign>>
+  NewRsaSsaPkcs1Sign(
+      const SubtleUtilBoringSSL::RsaPrivateKey& private_key,
+      const SubtleUtilBoringSSL::RsaSsaPkcs1Params& params) const;
+
+  // Messages shorter than this many bytes are encrypted and decrypted with
+  // BoringSSL instead of the provider's Aead, since the cost of offloading
+  // typically exceeds the benefit for them.
+  virtual int64_t min_aead_message_size() const { return 16 * 1024; }
+};
+
+// Installs 'provider' for the whole process, replacing the previous one, if
+// any. A null 'provider' uninstalls it. Primitives created before the call
+// keep using the provider they were created with.
+void SetCryptoProvider(std::shared_ptr<const CryptoProvider> provider);
+
+// Returns the installed provider, or null if there is none.
+std::shared_ptr<const CryptoProvider> GetCryptoProvider();
+
+// Returns 'software', unless the installed provider supports AES-GCM with
+// 'key'. In that case, returns an Aead which processes messages of at least
+// min_aead_message_size() bytes with the provider's Aead, and all others with
+// 'software'. Calls which the provider's Aead fails with UNAVAILABLE, e.g.
+// because the device is busy or gone, are retried with 'software'.
+std::unique_ptr<Aead> WithProviderAesGcm(const util::SecretData& key,
+                                         std::unique_ptr<Aead> software);
+
+// Like WithProviderAesGcm(), for RSA-SSA-PKCS1 signing. Since RSA private
+// key operations are expensive regardless of the message size, all messages
+// are signed by the provider, and by 'software' if that fails with
+// UNAVAILABLE.
+std::unique_ptr<PublicKeySign> WithProviderRsaSsaPkcs1Sign(
+    const SubtleUtilBoringSSL::RsaPrivateKey& private_key,
+    const SubtleUtilBoringSSL::RsaSsaPkcs1Params& params,
+    std::unique_ptr<PublicKeySign> software);
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_SUBTLE_CRYPTO_PROVIDER_H_
@@ -0,0 +1,206 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/subtle/crypto_provider.h"
+
+#include <string>
+#include <utility>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/test_matchers.h"
+#include "tink/util/test_util.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+namespace {
+
+using ::crypto::tink::test::DummyAead;
+using ::crypto::tink::test::DummyPublicKeySign;
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::testing::Eq;
+
+constexpr int64_t kMinMessageSize = 100;
+
+// An Aead which counts its calls, and fails them with UNAVAILABLE if
+// 'unavailable' is set.
+class CountingAead : public DummyAead {
+ public:
+  CountingAead(int* calls, bool unavailable)
+      : DummyAead("aead"), calls_(calls), unavailable_(unavailable) {}
+
+  util::StatusOr<std::string> Encrypt(
+      absl::string_view plaintext,
+      absl::string_view associated_data) const override {
+    ++*calls_;
+    if (unavailable_) return util::Status(util::error::UNAVAILABLE, "busy");
+    return DummyAead::Encrypt(plaintext, associated_data);
+  }
+
+  util::StatusOr<std::string> Decrypt(
+      absl::string_view ciphertext,
+      absl::string_view associated_data) const override {
+    ++*calls_;
+    if (unavailable_) return util::Status(util::error::UNAVAILABLE, "busy");
+    return DummyAead::Decrypt(ciphertext, associated_data);
+  }
+
+ private:
+  int* calls_;
+  bool unavailable_;
+};
+
+class FakeProvider : public CryptoProvider {
+ public:
+  explicit FakeProvider(bool unavailable) : unavailable_(unavailable) {}
+
+  util::StatusOr<std::unique_ptr<Aead>> NewAesGcm(
+      const util::SecretData& key) const override {
+    return {absl::make_unique<CountingAead>(&aead_calls, unavailable_)};
+  }
+
+  util::StatusOr<std::unique_ptr<PublicKeySign>> NewRsaSsaPkcs1Sign(
+      const SubtleUtilBoringSSL::RsaPrivateKey& private_key,
+      const SubtleUtilBoringSSL::RsaSsaPkcs1Params& params) const override {
+    if (unavailable_) {
+      return util::Status(util::error::UNIMPLEMENTED, "not supported");
+    }
+    return {absl::make_unique<DummyPublicKeySign>("offloaded")};
+  }
+
+  int64_t min_aead_message_size() const override { return kMinMessageSize; }
+
+  mutable int aead_calls = 0;
+
+ private:
+  bool unavailable_;
+};
+
+class CryptoProviderTest : public ::testing::Test {
+ protected:
+  void TearDown() override { SetCryptoProvider(nullptr); }
+
+  std::unique_ptr<Aead> NewAead() {
+    return WithProviderAesGcm(util::SecretDataFromStringView("key"),
+                              absl::make_unique<CountingAead>(
+                                  &software_calls_, /*unavailable=*/false));
+  }
+
+  int software_calls_ = 0;
+};
+
+TEST_F(CryptoProviderTest, NoProvider) {
+  EXPECT_THAT(GetCryptoProvider(), Eq(nullptr));
+  std::unique_ptr<Aead> aead = NewAead();
+  ASSERT_THAT(aead->Encrypt(std::string(kMinMessageSize, 'a'), "").status(),
+              IsOk());
+  EXPECT_THAT(software_calls_, Eq(1));
+}
+
+TEST_F(CryptoProviderTest, LargeMessagesAreOffloaded) {
+  auto provider = std::make_shared<FakeProvider>(/*unavailable=*/false);
+  SetCryptoProvider(provider);
+  EXPECT_THAT(GetCryptoProvider(), Eq(provider));
+  std::unique_ptr<Aead> aead = NewAead();
+
+  std::string small(kMinMessageSize - 1, 'a');
+  auto small_result = aead->Encrypt(small, "ad");
+  ASSERT_THAT(small_result.status(), IsOk());
+  EXPECT_THAT(software_calls_, Eq(1));
+  EXPECT_THAT(provider->aead_calls, Eq(0));
+
+  std::string large(kMinMessageSize, 'a');
+  auto large_result = aead->Encrypt(large, "ad");
+  ASSERT_THAT(large_result.status(), IsOk());
+  EXPECT_THAT(software_calls_, Eq(1));
+  EXPECT_THAT(provider->aead_calls, Eq(1));
+
+  auto decrypt_result = aead->Decrypt(large_result.ValueOrDie(), "ad");
+  ASSERT_THAT(decrypt_result.status(), IsOk());
+  EXPECT_THAT(decrypt_result.ValueOrDie(), Eq(large));
+  EXPECT_THAT(provider->aead_calls, Eq(2));
+}
+
+TEST_F(CryptoProviderTest, UnavailableProviderFallsBack) {
+  auto provider = std::make_shared<FakeProvider>(/*unavailable=*/true);
+  SetCryptoProvider(provider);
+  std::unique_ptr<Aead> aead = NewAead();
+  std::string large(kMinMessageSize, 'a');
+  auto encrypt_result = aead->Encrypt(large, "ad");
+  ASSERT_THAT(encrypt_result.status(), IsOk());
+  EXPECT_THAT(provider->aead_calls, Eq(1));
+  EXPECT_THAT(software_calls_, Eq(1));
+}
+
+TEST_F(CryptoProviderTest, ErrorsOtherThanUnavailableAreReturned) {
+  auto provider = std::make_shared<FakeProvider>(/*unavailable=*/false);
+  SetCryptoProvider(provider);
+  std::unique_ptr<Aead> aead = NewAead();
+  EXPECT_THAT(aead->Decrypt(std::string(kMinMessageSize, 'x'), "ad").status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(software_calls_, Eq(0));
+}
+
+TEST_F(CryptoProviderTest, PrimitivesKeepTheirProvider) {
+  auto provider = std::make_shared<FakeProvider>(/*unavailable=*/false);
+  SetCryptoProvider(provider);
+  std::unique_ptr<Aead> aead = NewAead();
+  SetCryptoProvider(nullptr);
+  ASSERT_THAT(aead->Encrypt(std::string(kMinMessageSize, 'a'), "").status(),
+              IsOk());
+  EXPECT_THAT(provider->aead_calls, Eq(1));
+}
+
+TEST_F(CryptoProviderTest, Sign) {
+  SubtleUtilBoringSSL::RsaPrivateKey private_key;
+  SubtleUtilBoringSSL::RsaSsaPkcs1Params params;
+  params.hash_type = HashType::SHA256;
+
+  SetCryptoProvider(std::make_shared<FakeProvider>(/*unavailable=*/false));
+  auto signer = WithProviderRsaSsaPkcs1Sign(
+      private_key, params, absl::make_unique<DummyPublicKeySign>("software"));
+  EXPECT_THAT(signer->Sign("data").ValueOrDie(),
+              Eq(DummyPublicKeySign("offloaded").Sign("data").ValueOrDie()));
+
+  // Providers which do not support the key type leave the signer alone.
+  SetCryptoProvider(std::make_shared<FakeProvider>(/*unavailable=*/true));
+  signer = WithProviderRsaSsaPkcs1Sign(
+      private_key, params, absl::make_unique<DummyPublicKeySign>("software"));
+  EXPECT_THAT(signer->Sign("data").ValueOrDie(),
+              Eq(DummyPublicKeySign("software").Sign("data").ValueOrDie()));
+}
+
+TEST(CryptoProviderDefaultsTest, UnsupportedByDefault) {
+  CryptoProvider provider;
+  EXPECT_THAT(
+      provider.NewAesGcm(util::SecretDataFromStringView("key")).status(),
+      StatusIs(util::error::UNIMPLEMENTED));
+  EXPECT_THAT(provider
+                  .NewRsaSsaPkcs1Sign(SubtleUtilBoringSSL::RsaPrivateKey(),
+                                      SubtleUtilBoringSSL::RsaSsaPkcs1Params())
+                  .status(),
+              StatusIs(util::error::UNIMPLEMENTED));
+}
+
+}  // namespace
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
@@ -18,6 +18,10 @@
 
 #include <algorithm>
 #include <cstring>
+#include <deque>
+#include <iterator>
+#include <map>
+#include <utility>
 #include <vector>
 
 #include "absl/base/thread_annotations.h"
@@ -27,6 +31,7 @@
 #include "tink/random_access_stream.h"
 #include "tink/subtle/stream_segment_decrypter.h"
 #include "tink/util/buffer.h"
+#include "tink/util/buffer_pool.h"
 #include "tink/util/errors.h"
 #include "tink/util/status.h"
 #include "tink/util/statusor.h"
@@ -76,6 +81,103 @@ StatusOr<std::unique_ptr<RandomAccessStream>> DecryptingRandomAccessStream::New(
   return {std::move(dec_stream)};
 }
 
+// static
+StatusOr<std::unique_ptr<RandomAccessStream>>
+DecryptingRandomAccessStream::NewParallel(
+    std::unique_ptr<StreamSegmentDecrypter> segment_decrypter,
+    std::unique_ptr<RandomAccessStream> ciphertext_source,
+    ParallelOptions options) {
+  if (options.schedule == nullptr) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "options.schedule must be non-null");
+  }
+  if (options.max_segments_in_flight <= 0) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "options.max_segments_in_flight must be positive");
+  }
+  if (options.read_ahead_segments < 0) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "options.read_ahead_segments cannot be negative");
+  }
+  if (options.segment_cache_size_in_bytes < 0) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "options.segment_cache_size_in_bytes cannot be negative");
+  }
+  auto stream_result =
+      New(std::move(segment_decrypter), std::move(ciphertext_source));
+  if (!stream_result.ok()) return stream_result.status();
+  std::unique_ptr<DecryptingRandomAccessStream> dec_stream(
+      static_cast<DecryptingRandomAccessStream*>(
+          stream_result.ValueOrDie().release()));
+  dec_stream->schedule_ = std::move(options.schedule);
+  dec_stream->max_segments_in_flight_ = options.max_segments_in_flight;
+  dec_stream->read_ahead_segments_ = options.read_ahead_segments;
+  dec_stream->running_tasks_ = std::make_shared<RunningTasks>();
+  dec_stream->max_cache_size_in_bytes_ = options.segment_cache_size_in_bytes;
+  dec_stream->buffer_pool_ = std::move(options.buffer_pool);
+  return {std::move(dec_stream)};
+}
+
+// static
+StatusOr<std::unique_ptr<DecryptingRandomAccessStream>>
+DecryptingRandomAccessStream::NewWithSegmentCache(
+    std::unique_ptr<StreamSegmentDecrypter> segment_decrypter,
+    std::unique_ptr<RandomAccessStream> ciphertext_source,
+    int64_t max_cache_size_in_bytes) {
+  if (max_cache_size_in_bytes < 0) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "max_cache_size_in_bytes cannot be negative");
+  }
+  auto stream_result =
+      New(std::move(segment_decrypter), std::move(ciphertext_source));
+  if (!stream_result.ok()) return stream_result.status();
+  std::unique_ptr<DecryptingRandomAccessStream> dec_stream(
+      static_cast<DecryptingRandomAccessStream*>(
+          stream_result.ValueOrDie().release()));
+  dec_stream->max_cache_size_in_bytes_ = max_cache_size_in_bytes;
+  return {std::move(dec_stream)};
+}
+
+// static
+StatusOr<std::unique_ptr<DecryptingRandomAccessStream>>
+DecryptingRandomAccessStream::NewWithBufferPool(
+    std::unique_ptr<StreamSegmentDecrypter> segment_decrypter,
+    std::unique_ptr<RandomAccessStream> ciphertext_source,
+    std::shared_ptr<util::BufferPool> buffer_pool) {
+  if (buffer_pool == nullptr) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "buffer_pool must be non-null");
+  }
+  auto stream_result =
+      New(std::move(segment_decrypter), std::move(ciphertext_source));
+  if (!stream_result.ok()) return stream_result.status();
+  std::unique_ptr<DecryptingRandomAccessStream> dec_stream(
+      static_cast<DecryptingRandomAccessStream*>(
+          stream_result.ValueOrDie().release()));
+  dec_stream->buffer_pool_ = std::move(buffer_pool);
+  return {std::move(dec_stream)};
+}
+
+StatusOr<std::unique_ptr<Buffer>>
+DecryptingRandomAccessStream::NewSegmentBuffer(int size) {
+  if (buffer_pool_ == nullptr) return Buffer::New(size);
+  return buffer_pool_->Get(size);
+}
+
+DecryptingRandomAccessStream::SegmentCacheStats
+DecryptingRandomAccessStream::GetSegmentCacheStats() const {
+  absl::MutexLock lock(&cache_mutex_);
+  return cache_stats_;
+}
+
+DecryptingRandomAccessStream::~DecryptingRandomAccessStream() {
+  if (running_tasks_ == nullptr) return;
+  // The scheduled tasks refer to this stream.
+  running_tasks_->mutex.LockWhen(absl::Condition(
+      +[](int* count) { return *count == 0; }, &running_tasks_->count));
+  running_tasks_->mutex.Unlock();
+}
+
 util::Status DecryptingRandomAccessStream::PRead(int64_t position, int count,
                                                  Buffer* dest_buffer) {
   if (dest_buffer == nullptr) {
@@ -197,39 +299,259 @@ int64_t DecryptingRandomAccessStream::GetSegmentNr(int64_t pt_position) {
   return (pt_position + ct_offset_ + header_size_) / pt_segment_size_;
 }
 
-util::Status DecryptingRandomAccessStream::ReadAndDecryptSegment(
-    int64_t segment_nr, Buffer* ct_buffer, std::vector<uint8_t>* pt_segment) {
-  int64_t ct_position = segment_nr * ct_segment_size_;
-  if (ct_position / ct_segment_size_ != segment_nr /* overflow occured! */) {
+util::Status DecryptingRandomAccessStream::GetCiphertextRange(
+    int64_t segment_nr, int64_t* ct_position, int* ct_count) {
+  *ct_position = segment_nr * ct_segment_size_;
+  if (*ct_position / ct_segment_size_ != segment_nr /* overflow occured! */) {
     return Status(util::error::OUT_OF_RANGE,
                   absl::StrCat("segment_nr * ct_segment_size too large: ",
                                segment_nr, ct_segment_size_));
   }
-  int segment_size = ct_segment_size_;
+  *ct_count = ct_segment_size_;
   if (segment_nr == 0) {
     // The sum of ct_offset_ and header_size is always smaller than
     // ct_segment_size_, which is an int, therefore the next two statements
     // should never overflow.
-    ct_position = ct_offset_ + header_size_;
-    segment_size = ct_segment_size_ - ct_position;
+    *ct_position = ct_offset_ + header_size_;
+    *ct_count = ct_segment_size_ - *ct_position;
   }
+  return Status::OK;
+}
+
+util::Status DecryptingRandomAccessStream::DecryptReadSegment(
+    int64_t segment_nr, const Status& read_status, Buffer* ct_buffer,
+    std::vector<uint8_t>* pt_segment) {
   bool is_last_segment = (segment_nr == segment_count_ - 1);
-  auto pread_status = ct_source_->PRead(ct_position, segment_size, ct_buffer);
-  if (pread_status.ok() ||
+  if (read_status.ok() ||
       (is_last_segment && ct_buffer->size() > 0 &&
-       pread_status.error_code() == util::error::OUT_OF_RANGE)) {
+       read_status.error_code() == util::error::OUT_OF_RANGE)) {
     // some bytes were read
-    auto dec_status = segment_decrypter_->DecryptSegment(
-        std::vector<uint8_t>(ct_buffer->get_mem_block(),
-                             ct_buffer->get_mem_block() + ct_buffer->size()),
+    pt_segment->assign(ct_buffer->get_mem_block(),
+                       ct_buffer->get_mem_block() + ct_buffer->size());
+    auto dec_status = segment_decrypter_->DecryptSegmentInPlace(
         segment_nr, is_last_segment, pt_segment);
-    if (dec_status.ok()) {
-      return is_last_segment ?
-          Status(util::error::OUT_OF_RANGE, "EOF") : Status::OK;
+    if (dec_status.error_code() != util::error::UNIMPLEMENTED) {
+      return dec_status;
     }
-    return dec_status;
+    std::vector<uint8_t> ct_segment;
+    ct_segment.swap(*pt_segment);
+    return segment_decrypter_->DecryptSegment(ct_segment, segment_nr,
+                                              is_last_segment, pt_segment);
+  }
+  return read_status;
+}
+
+util::Status DecryptingRandomAccessStream::ReadAndDecryptSegment(
+    int64_t segment_nr, Buffer* ct_buffer, std::vector<uint8_t>* pt_segment) {
+  int64_t ct_position;
+  int segment_size;
+  auto status = GetCiphertextRange(segment_nr, &ct_position, &segment_size);
+  if (!status.ok()) return status;
+  auto pread_status = ct_source_->PRead(ct_position, segment_size, ct_buffer);
+  return DecryptReadSegment(segment_nr, pread_status, ct_buffer, pt_segment);
+}
+
+void DecryptingRandomAccessStream::GetSegments(
+    int64_t first_segment_nr, int64_t last_segment_nr,
+    std::deque<DecryptedSegment>* segments) {
+  std::vector<RandomAccessStream::ReadRequest> requests;
+  std::vector<std::unique_ptr<Buffer>> ct_buffers;
+  // The index in 'segments' of the segment read by each request.
+  std::vector<size_t> request_segments;
+  const size_t first_index = segments->size();
+  for (int64_t segment_nr = first_segment_nr; segment_nr <= last_segment_nr;
+       segment_nr++) {
+    segments->push_back({Status::OK, LookupCachedSegment(segment_nr)});
+    if (segments->back().plaintext != nullptr) continue;
+    int64_t ct_position;
+    int segment_size;
+    auto status = GetCiphertextRange(segment_nr, &ct_position, &segment_size);
+    if (!status.ok()) {
+      segments->back().status = status;
+      continue;
+    }
+    auto ct_buffer_result = NewSegmentBuffer(segment_size);
+    if (!ct_buffer_result.ok()) {
+      segments->back().status = ct_buffer_result.status();
+      continue;
+    }
+    ct_buffers.push_back(std::move(ct_buffer_result.ValueOrDie()));
+    requests.push_back({ct_position, segment_size, ct_buffers.back().get()});
+    request_segments.push_back(segments->size() - 1);
+  }
+  if (requests.empty()) return;
+  std::vector<Status> read_statuses = ct_source_->PReadV(requests);
+  if (read_statuses.size() != requests.size()) {
+    read_statuses.assign(requests.size(),
+                         Status(util::error::INTERNAL,
+                                "PReadV returned a wrong number of results"));
+  }
+  for (size_t i = 0; i < requests.size(); i++) {
+    DecryptedSegment& segment = (*segments)[request_segments[i]];
+    int64_t segment_nr = first_segment_nr + (request_segments[i] - first_index);
+    auto plaintext = std::make_shared<std::vector<uint8_t>>();
+    segment.status = DecryptReadSegment(segment_nr, read_statuses[i],
+                                        ct_buffers[i].get(), plaintext.get());
+    if (segment.status.ok()) CacheSegment(segment_nr, plaintext);
+    segment.plaintext = std::move(plaintext);
+  }
+}
+
+void DecryptingRandomAccessStream::ScheduleSegment(
+    int64_t segment_nr, std::shared_ptr<SegmentJob> job) {
+  std::shared_ptr<RunningTasks> running_tasks = running_tasks_;
+  {
+    absl::MutexLock lock(&running_tasks->mutex);
+    running_tasks->count++;
+  }
+  schedule_([this, segment_nr, job, running_tasks]() {
+    Status status;
+    auto plaintext = std::make_shared<std::vector<uint8_t>>();
+    auto ct_buffer_result = NewSegmentBuffer(ct_segment_size_);
+    if (ct_buffer_result.ok()) {
+      status = ReadAndDecryptSegment(
+          segment_nr, ct_buffer_result.ValueOrDie().get(), plaintext.get());
+    } else {
+      status = ct_buffer_result.status();
+    }
+    {
+      absl::MutexLock lock(&job->mutex);
+      job->plaintext = std::move(plaintext);
+      job->status = status;
+      job->done = true;
+    }
+    absl::MutexLock lock(&running_tasks->mutex);
+    running_tasks->count--;
+  });
+}
+
+std::shared_ptr<DecryptingRandomAccessStream::SegmentJob>
+DecryptingRandomAccessStream::GetOrScheduleSegment(int64_t segment_nr) {
+  {
+    absl::MutexLock lock(&read_ahead_mutex_);
+    auto it = read_ahead_.find(segment_nr);
+    if (it != read_ahead_.end()) {
+      std::shared_ptr<SegmentJob> job = std::move(it->second);
+      read_ahead_.erase(it);
+      return job;
+    }
+  }
+  auto job = std::make_shared<SegmentJob>();
+  auto cached_segment = LookupCachedSegment(segment_nr);
+  if (cached_segment != nullptr) {
+    absl::MutexLock lock(&job->mutex);
+    job->plaintext = std::move(cached_segment);
+    job->status = Status::OK;
+    job->done = true;
+    return job;
+  }
+  ScheduleSegment(segment_nr, job);
+  return job;
+}
+
+// static
+util::Status DecryptingRandomAccessStream::WaitForSegment(
+    SegmentJob* job, std::shared_ptr<const std::vector<uint8_t>>* pt_segment) {
+  job->mutex.LockWhen(absl::Condition(&job->done));
+  Status status = job->status;
+  *pt_segment = job->plaintext;
+  job->mutex.Unlock();
+  return status;
+}
+
+util::Status DecryptingRandomAccessStream::SegmentStatus(int64_t segment_nr) {
+  if (segment_nr != segment_count_ - 1) return Status::OK;
+  size_verified_.store(true, std::memory_order_release);
+  return Status(util::error::OUT_OF_RANGE, "EOF");
+}
+
+util::Status DecryptingRandomAccessStream::GetSegment(
+    int64_t segment_nr, Buffer* ct_buffer,
+    std::shared_ptr<const std::vector<uint8_t>>* pt_segment) {
+  auto cached_segment = LookupCachedSegment(segment_nr);
+  if (cached_segment != nullptr) {
+    *pt_segment = std::move(cached_segment);
+    return Status::OK;
+  }
+  auto plaintext = std::make_shared<std::vector<uint8_t>>();
+  auto status = ReadAndDecryptSegment(segment_nr, ct_buffer, plaintext.get());
+  if (status.ok()) CacheSegment(segment_nr, plaintext);
+  *pt_segment = std::move(plaintext);
+  return status;
+}
+
+std::shared_ptr<const std::vector<uint8_t>>
+DecryptingRandomAccessStream::LookupCachedSegment(int64_t segment_nr) {
+  if (max_cache_size_in_bytes_ == 0) return nullptr;
+  absl::MutexLock lock(&cache_mutex_);
+  auto it = cache_.find(segment_nr);
+  if (it == cache_.end()) {
+    cache_stats_.misses++;
+    return nullptr;
+  }
+  cache_stats_.hits++;
+  cache_lru_.splice(cache_lru_.begin(), cache_lru_, it->second.lru_position);
+  return it->second.plaintext;
+}
+
+bool DecryptingRandomAccessStream::IsSegmentCached(int64_t segment_nr) {
+  if (max_cache_size_in_bytes_ == 0) return false;
+  absl::MutexLock lock(&cache_mutex_);
+  return cache_.count(segment_nr) > 0;
+}
+
+void DecryptingRandomAccessStream::CacheSegment(
+    int64_t segment_nr,
+    std::shared_ptr<const std::vector<uint8_t>> pt_segment) {
+  if (pt_segment == nullptr || pt_segment->size() > max_cache_size_in_bytes_) {
+    return;
+  }
+  absl::MutexLock lock(&cache_mutex_);
+  auto it = cache_.find(segment_nr);
+  if (it != cache_.end()) {
+    // Another reader cached the segment concurrently.
+    cache_lru_.splice(cache_lru_.begin(), cache_lru_, it->second.lru_position);
+    return;
+  }
+  while (cache_stats_.size_in_bytes + pt_segment->size() >
+         max_cache_size_in_bytes_) {
+    auto evicted = cache_.find(cache_lru_.back());
+    cache_stats_.size_in_bytes -= evicted->second.plaintext->size();
+    cache_.erase(evicted);
+    cache_lru_.pop_back();
+  }
+  cache_stats_.size_in_bytes += pt_segment->size();
+  cache_lru_.push_front(segment_nr);
+  cache_.emplace(segment_nr,
+                 CachedSegment{std::move(pt_segment), cache_lru_.begin()});
+}
+
+void DecryptingRandomAccessStream::ReadAhead(
+    int64_t first_read_segment_nr, int64_t first_unused_segment_nr,
+    std::deque<std::shared_ptr<SegmentJob>>* unused_jobs) {
+  absl::MutexLock lock(&read_ahead_mutex_);
+  // Segments before the current read are unlikely to be read again soon.
+  read_ahead_.erase(read_ahead_.begin(),
+                    read_ahead_.lower_bound(first_read_segment_nr));
+  int64_t segment_nr = first_unused_segment_nr;
+  for (auto& job : *unused_jobs) {
+    read_ahead_.emplace(segment_nr++, std::move(job));
+  }
+  unused_jobs->clear();
+  for (int i = 0; i < read_ahead_segments_ && segment_nr < segment_count_;
+       i++, segment_nr++) {
+    if (read_ahead_.count(segment_nr) == 0 && !IsSegmentCached(segment_nr)) {
+      auto job = std::make_shared<SegmentJob>();
+      ScheduleSegment(segment_nr, job);
+      read_ahead_.emplace(segment_nr, std::move(job));
+    }
+  }
+  // Bounds the memory used when concurrent PRead()s access unrelated
+  // parts of the stream.
+  while (read_ahead_.size() >
+         static_cast<size_t>(max_segments_in_flight_ + read_ahead_segments_)) {
+    read_ahead_.erase(read_ahead_.begin());
   }
-  return pread_status;
 }
 
 util::Status DecryptingRandomAccessStream::PReadAndDecrypt(
@@ -256,39 +578,89 @@ util::Status DecryptingRandomAccessStream::PReadAndDecrypt(
                     "position is larger than stream size");
     }
   }
-  auto ct_buffer_result = Buffer::New(ct_segment_size_);
+  auto ct_buffer_result = NewSegmentBuffer(ct_segment_size_);
   if (!ct_buffer_result.ok()) {
     return ToStatusF(util::error::INVALID_ARGUMENT,
                      "Invalid ciphertext segment size %d.",
                      ct_segment_size_);
   }
   auto ct_buffer = std::move(ct_buffer_result.ValueOrDie());
-  std::vector<uint8_t> pt_segment;
   int remaining = count;
   int read_count = 0;
   int pt_offset = GetPlaintextOffset(position);
+
+  // In parallel mode, the segments up to last_segment_nr are decrypted by
+  // 'jobs', which holds at most max_segments_in_flight_ of them, starting
+  // with the segment read next.
+  int64_t first_segment_nr = GetSegmentNr(position);
+  int64_t last_segment_nr = std::max(
+      first_segment_nr,
+      GetSegmentNr(std::min(position + count, pt_size_) - 1));
+  int64_t next_job_segment_nr = first_segment_nr;
+  std::deque<std::shared_ptr<SegmentJob>> jobs;
+  // In sequential mode, the segments following the one read next, if they
+  // were fetched in a batch.
+  std::deque<DecryptedSegment> batch;
+
+  Status result = Status::OK;
   while (remaining > 0) {
     auto segment_nr = GetSegmentNr(position + read_count);
-    auto status =
-        ReadAndDecryptSegment(segment_nr, ct_buffer.get(), &pt_segment);
+    Status status;
+    std::shared_ptr<const std::vector<uint8_t>> segment;
+    if (schedule_ != nullptr && segment_nr <= last_segment_nr) {
+      while (next_job_segment_nr <= last_segment_nr &&
+             jobs.size() < static_cast<size_t>(max_segments_in_flight_)) {
+        jobs.push_back(GetOrScheduleSegment(next_job_segment_nr++));
+      }
+      std::shared_ptr<SegmentJob> job = std::move(jobs.front());
+      jobs.pop_front();
+      status = WaitForSegment(job.get(), &segment);
+      if (status.ok() && max_cache_size_in_bytes_ > 0) {
+        CacheSegment(segment_nr, segment);
+      }
+    } else if (schedule_ == nullptr &&
+               (!batch.empty() || segment_nr < last_segment_nr)) {
+      if (batch.empty()) {
+        GetSegments(segment_nr,
+                    std::min<int64_t>(last_segment_nr,
+                                      segment_nr + kMaxSegmentsPerBatch - 1),
+                    &batch);
+      }
+      status = batch.front().status;
+      segment = std::move(batch.front().plaintext);
+      batch.pop_front();
+    } else {
+      status = GetSegment(segment_nr, ct_buffer.get(), &segment);
+    }
+    // Reaching the last segment is reported as OUT_OF_RANGE.
+    if (status.ok()) status = SegmentStatus(segment_nr);
     if (status.ok() || status.error_code() == util::error::OUT_OF_RANGE) {
-      int pt_count = pt_segment.size() - pt_offset;
+      int pt_count = segment->size() - pt_offset;
       int to_copy_count = std::min(pt_count, remaining);
       auto s = dest_buffer->set_size(read_count + to_copy_count);
-      if (!s.ok()) return s;
+      if (!s.ok()) {
+        result = s;
+        break;
+      }
       std::memcpy(dest_buffer->get_mem_block() + read_count,
-                  pt_segment.data() + pt_offset, to_copy_count);
+                  segment->data() + pt_offset, to_copy_count);
       pt_offset = 0;
       if (status.error_code() == util::error::OUT_OF_RANGE &&
-          to_copy_count == pt_count)
-        return status;
+          to_copy_count == pt_count) {
+        result = status;
+        break;
+      }
       read_count += to_copy_count;
       remaining = count - dest_buffer->size();
     } else {  // some other error happened
-      return status;
+      result = status;
+      break;
     }
   }
-  return util::Status::OK;
+  if (schedule_ != nullptr) {
+    ReadAhead(first_segment_nr, next_job_segment_nr - jobs.size(), &jobs);
+  }
+  return result;
 }
 
 StatusOr<int64_t> DecryptingRandomAccessStream::size() {
@@ -300,6 +672,27 @@ StatusOr<int64_t> DecryptingRandomAccessStream::size() {
   return pt_size_;
 }
 
+StatusOr<int64_t> DecryptingRandomAccessStream::VerifiedSize() {
+  {  // Initialize, if not initialized yet.
+    absl::MutexLock lock(&status_mutex_);
+    InitializeIfNeeded();
+    if (!status_.ok()) return status_;
+  }
+  if (size_verified_.load(std::memory_order_acquire)) return pt_size_;
+  absl::MutexLock lock(&size_verification_mutex_);
+  // Another caller may have verified the size in the meantime.
+  if (size_verified_.load(std::memory_order_acquire)) return pt_size_;
+  auto ct_buffer_result = NewSegmentBuffer(ct_segment_size_);
+  if (!ct_buffer_result.ok()) return ct_buffer_result.status();
+  std::shared_ptr<const std::vector<uint8_t>> segment;
+  // Failures are not cached, as they may be transient read errors.
+  auto status = GetSegment(segment_count_ - 1,
+                           ct_buffer_result.ValueOrDie().get(), &segment);
+  if (!status.ok()) return status;
+  size_verified_.store(true, std::memory_order_release);
+  return pt_size_;
+}
+
 }  // namespace subtle
 }  // namespace tink
 }  // namespace crypto
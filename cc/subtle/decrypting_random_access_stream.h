@@ -15,12 +15,21 @@
 #ifndef TINK_SUBTLE_DECRYPTING_RANDOM_ACCESS_STREAM_H_
 #define TINK_SUBTLE_DECRYPTING_RANDOM_ACCESS_STREAM_H_
 
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <list>
+#include <map>
 #include <memory>
+#include <unordered_map>
 #include <vector>
 
+#include "absl/base/thread_annotations.h"
 #include "absl/synchronization/mutex.h"
 #include "tink/random_access_stream.h"
 #include "tink/subtle/stream_segment_decrypter.h"
+#include "tink/util/buffer.h"
+#include "tink/util/buffer_pool.h"
 #include "tink/util/statusor.h"
 
 namespace crypto {
@@ -49,23 +58,180 @@ class DecryptingRandomAccessStream : public crypto::tink::RandomAccessStream {
   New(std::unique_ptr<StreamSegmentDecrypter> segment_decrypter,
       std::unique_ptr<crypto::tink::RandomAccessStream> ciphertext_source);
 
+  // Options for decrypting several segments of a stream concurrently.
+  struct ParallelOptions {
+    // Runs the given task, typically on a thread pool owned by the caller.
+    // Tasks may run on any thread and in any order. Must be non-null,
+    // and must eventually run every task it has been given.
+    std::function<void(std::function<void()>)> schedule;
+    // The maximal number of segments a single PRead() decrypts concurrently.
+    // Must be positive.
+    int max_segments_in_flight = 8;
+    // The number of segments following the end of a PRead() which are read
+    // and decrypted in the background, in anticipation of a sequential read.
+    // 0 disables read-ahead. Must be non-negative.
+    int read_ahead_segments = 0;
+    // The maximal total size of decrypted segments kept in a cache,
+    // see NewWithSegmentCache(). 0 disables the cache.
+    int64_t segment_cache_size_in_bytes = 0;
+    // If non-null, the buffers for ciphertext segments are taken from this
+    // pool, see NewWithBufferPool().
+    std::shared_ptr<crypto::tink::util::BufferPool> buffer_pool;
+  };
+
+  // Like New(), but PRead()s spanning several segments decrypt them
+  // concurrently using options.schedule, and segments following a PRead()
+  // are optionally prefetched. The returned plaintext is identical to the
+  // one of a stream returned by New(). 'ciphertext_source' must support
+  // concurrent PRead()s.
+  static crypto::tink::util::StatusOr<
+      std::unique_ptr<crypto::tink::RandomAccessStream>>
+  NewParallel(
+      std::unique_ptr<StreamSegmentDecrypter> segment_decrypter,
+      std::unique_ptr<crypto::tink::RandomAccessStream> ciphertext_source,
+      ParallelOptions options);
+
+  // Like New(), but keeps recently used decrypted segments in a cache of
+  // at most 'max_cache_size_in_bytes' bytes of plaintext, so that PRead()s
+  // hitting the same segments do not read and authenticate them again.
+  // Segments are evicted in least-recently-used order.
+  static crypto::tink::util::StatusOr<
+      std::unique_ptr<DecryptingRandomAccessStream>>
+  NewWithSegmentCache(
+      std::unique_ptr<StreamSegmentDecrypter> segment_decrypter,
+      std::unique_ptr<crypto::tink::RandomAccessStream> ciphertext_source,
+      int64_t max_cache_size_in_bytes);
+
+  // Like New(), but reads ciphertext segments into buffers taken from
+  // 'buffer_pool', which must be non-null and may be shared by many streams,
+  // instead of allocating a new buffer for every PRead().
+  static crypto::tink::util::StatusOr<
+      std::unique_ptr<DecryptingRandomAccessStream>>
+  NewWithBufferPool(
+      std::unique_ptr<StreamSegmentDecrypter> segment_decrypter,
+      std::unique_ptr<crypto::tink::RandomAccessStream> ciphertext_source,
+      std::shared_ptr<crypto::tink::util::BufferPool> buffer_pool);
+
+  // Statistics of the cache of decrypted segments.
+  struct SegmentCacheStats {
+    // The number of segment lookups which were served from the cache.
+    int64_t hits = 0;
+    // The number of segment lookups which had to decrypt the segment.
+    int64_t misses = 0;
+    // The total size of the cached plaintext segments.
+    int64_t size_in_bytes = 0;
+  };
+
+  // Returns the current statistics of the segment cache. All values are 0
+  // if the cache is disabled.
+  SegmentCacheStats GetSegmentCacheStats() const;
+
+  // Waits for all segments which are still being decrypted.
+  ~DecryptingRandomAccessStream() override;
+
   // -----------------------
   // Methods of RandomAccessStream-interface implemented by this class.
   crypto::tink::util::Status PRead(
       int64_t position, int count,
       crypto::tink::util::Buffer* dest_buffer) override;
   crypto::tink::util::StatusOr<int64_t> size() override;
+  // Decrypts the last segment, unless a PRead() or an earlier call did, with a
+  // single PRead() of the ciphertext. Concurrent callers wait for the same
+  // verification. If the segment cache is enabled, the decrypted segment is
+  // cached for later PRead()s.
+  crypto::tink::util::StatusOr<int64_t> VerifiedSize() override;
 
  private:
+  // A segment which is read and decrypted by a task given to
+  // ParallelOptions::schedule.
+  struct SegmentJob {
+    absl::Mutex mutex;
+    std::shared_ptr<const std::vector<uint8_t>> plaintext
+        ABSL_GUARDED_BY(mutex);
+    crypto::tink::util::Status status ABSL_GUARDED_BY(mutex);
+    bool done ABSL_GUARDED_BY(mutex) = false;
+  };
+
+  // The number of scheduled tasks which have not finished yet. Shared with
+  // the tasks, so that it outlives the last of them.
+  struct RunningTasks {
+    absl::Mutex mutex;
+    int count ABSL_GUARDED_BY(mutex) = 0;
+  };
+
+  // A segment read and decrypted as part of a batch, see GetSegments().
+  struct DecryptedSegment {
+    crypto::tink::util::Status status;
+    std::shared_ptr<const std::vector<uint8_t>> plaintext;
+  };
+
+  // The maximal number of segments whose ciphertext is fetched with a single
+  // PReadV() call.
+  static constexpr int kMaxSegmentsPerBatch = 16;
+
   DecryptingRandomAccessStream() {}
+  // Returns a buffer of 'size' bytes for a ciphertext segment, taken from
+  // buffer_pool_ if it is set.
+  crypto::tink::util::StatusOr<std::unique_ptr<crypto::tink::util::Buffer>>
+  NewSegmentBuffer(int size);
   crypto::tink::util::Status PReadAndDecrypt(
       int64_t position, int count, crypto::tink::util::Buffer* dest_buffer);
   // Reads the specified ciphertext segment from ct_source_, decrypts it,
   // and writes the resulting plaintext bytes to pt_segment.
   // Uses the provided ct_buffer as a buffer for the ciphertext segment.
+  // Returns OK iff the segment was decrypted, also for the last segment.
   crypto::tink::util::Status ReadAndDecryptSegment(
       int64_t segment_nr, crypto::tink::util::Buffer* ct_buffer,
       std::vector<uint8_t>* pt_segment);
+  // Computes the position and the size of the specified segment in the
+  // ciphertext.
+  crypto::tink::util::Status GetCiphertextRange(int64_t segment_nr,
+                                                int64_t* ct_position,
+                                                int* ct_count);
+  // Decrypts the specified segment from 'ct_buffer', into which it was read
+  // with the result 'read_status'.
+  crypto::tink::util::Status DecryptReadSegment(
+      int64_t segment_nr, const crypto::tink::util::Status& read_status,
+      crypto::tink::util::Buffer* ct_buffer, std::vector<uint8_t>* pt_segment);
+  // Like GetSegment() for each of the segments from 'first_segment_nr' to
+  // 'last_segment_nr', appended to 'segments' in this order, but all
+  // segments which are not cached are read with a single PReadV().
+  void GetSegments(int64_t first_segment_nr, int64_t last_segment_nr,
+                   std::deque<DecryptedSegment>* segments);
+  // Like ReadAndDecryptSegment(), but serves the segment from the segment
+  // cache if possible, and adds it to the cache otherwise.
+  crypto::tink::util::Status GetSegment(
+      int64_t segment_nr, crypto::tink::util::Buffer* ct_buffer,
+      std::shared_ptr<const std::vector<uint8_t>>* pt_segment);
+  // Returns the status PRead() reports for a successfully decrypted segment:
+  // OUT_OF_RANGE for the last segment, OK otherwise.
+  crypto::tink::util::Status SegmentStatus(int64_t segment_nr);
+  // Returns the cached plaintext of the specified segment, or nullptr if the
+  // segment is not cached, and updates the cache statistics.
+  std::shared_ptr<const std::vector<uint8_t>> LookupCachedSegment(
+      int64_t segment_nr);
+  // Returns true if the specified segment is in the segment cache.
+  bool IsSegmentCached(int64_t segment_nr);
+  // Adds the plaintext of the specified segment to the cache, evicting the
+  // least recently used segments as needed.
+  void CacheSegment(int64_t segment_nr,
+                    std::shared_ptr<const std::vector<uint8_t>> pt_segment);
+  // Returns a job for the specified segment, either a prefetched or cached
+  // one, or a newly scheduled one.
+  std::shared_ptr<SegmentJob> GetOrScheduleSegment(int64_t segment_nr);
+  // Schedules reading and decrypting the specified segment into 'job'.
+  void ScheduleSegment(int64_t segment_nr, std::shared_ptr<SegmentJob> job);
+  // Waits until 'job' is done, sets '*pt_segment' to its plaintext and
+  // returns its status.
+  static crypto::tink::util::Status WaitForSegment(
+      SegmentJob* job, std::shared_ptr<const std::vector<uint8_t>>* pt_segment);
+  // Stores the jobs in 'unused_jobs', which start at segment
+  // 'first_unused_segment_nr', for later PRead()s, and prefetches the
+  // read_ahead_segments_ segments following them. Discards prefetched
+  // segments before 'first_read_segment_nr'.
+  void ReadAhead(int64_t first_read_segment_nr,
+                 int64_t first_unused_segment_nr,
+                 std::deque<std::shared_ptr<SegmentJob>>* unused_jobs);
   // Returns the segment number that contains the specified 'pt_position'.
   int64_t GetSegmentNr(int64_t pt_position);
   // Returns the offset within a segment for the specified 'pt_position'.
@@ -86,6 +252,39 @@ class DecryptingRandomAccessStream : public crypto::tink::RandomAccessStream {
   int ct_segment_overhead_;
   int64_t segment_count_;
   int64_t pt_size_;
+  std::shared_ptr<crypto::tink::util::BufferPool> buffer_pool_;
+
+  // Set once the last segment has been decrypted, so that pt_size_ is
+  // authentic.
+  std::atomic<bool> size_verified_{false};
+  // Serializes the verifications of VerifiedSize().
+  absl::Mutex size_verification_mutex_;
+
+  // State of the parallel mode, which is used iff schedule_ is non-null.
+  std::function<void(std::function<void()>)> schedule_;
+  int max_segments_in_flight_ = 0;
+  int read_ahead_segments_ = 0;
+  std::shared_ptr<RunningTasks> running_tasks_;
+  absl::Mutex read_ahead_mutex_;
+  // Segments which were scheduled but not consumed by a PRead() yet,
+  // by segment number.
+  std::map<int64_t, std::shared_ptr<SegmentJob>> read_ahead_
+      ABSL_GUARDED_BY(read_ahead_mutex_);
+
+  // The cache of decrypted segments, which is used iff
+  // max_cache_size_in_bytes_ is positive.
+  struct CachedSegment {
+    std::shared_ptr<const std::vector<uint8_t>> plaintext;
+    // The position of the segment in cache_lru_.
+    std::list<int64_t>::iterator lru_position;
+  };
+  int64_t max_cache_size_in_bytes_ = 0;
+  mutable absl::Mutex cache_mutex_;
+  std::unordered_map<int64_t, CachedSegment> cache_
+      ABSL_GUARDED_BY(cache_mutex_);
+  // Numbers of the cached segments, most recently used first.
+  std::list<int64_t> cache_lru_ ABSL_GUARDED_BY(cache_mutex_);
+  SegmentCacheStats cache_stats_ ABSL_GUARDED_BY(cache_mutex_);
 };
 
 }  // namespace subtle
@@ -16,18 +16,23 @@
 
 #include "tink/subtle/decrypting_random_access_stream.h"
 
+#include <atomic>
+#include <functional>
 #include <sstream>
+#include <thread>  // NOLINT(build/c++11)
 #include <vector>
 
 #include "gtest/gtest.h"
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "tink/output_stream.h"
 #include "tink/random_access_stream.h"
 #include "tink/streaming_aead.h"
 #include "tink/subtle/random.h"
 #include "tink/subtle/test_util.h"
+#include "tink/util/buffer_pool.h"
 #include "tink/util/file_random_access_stream.h"
 #include "tink/util/ostream_output_stream.h"
 #include "tink/util/status.h"
@@ -40,7 +45,9 @@ namespace subtle {
 namespace {
 
 using crypto::tink::subtle::test::DummyStreamingAead;
+using crypto::tink::subtle::test::DummyStreamSegmentEncrypter;
 using crypto::tink::subtle::test::DummyStreamSegmentDecrypter;
+using crypto::tink::subtle::test::TestThreadPool;
 using crypto::tink::test::GetTestFileDescriptor;
 using crypto::tink::test::IsOk;
 using crypto::tink::test::StatusIs;
@@ -73,6 +80,66 @@ class DummyRandomAccessStream : public RandomAccessStream {
   int ct_offset_;
 };
 
+// A RandomAccessStream that counts the PRead()-calls to another stream.
+class CountingRandomAccessStream : public RandomAccessStream {
+ public:
+  explicit CountingRandomAccessStream(std::unique_ptr<RandomAccessStream> inner,
+                                      std::atomic<int>* pread_count)
+      : inner_(std::move(inner)), pread_count_(pread_count) {}
+
+  crypto::tink::util::Status PRead(
+      int64_t position, int count,
+      crypto::tink::util::Buffer* dest_buffer) override {
+    (*pread_count_)++;
+    return inner_->PRead(position, count, dest_buffer);
+  }
+
+  crypto::tink::util::StatusOr<int64_t> size() override {
+    return inner_->size();
+  }
+
+ private:
+  std::unique_ptr<RandomAccessStream> inner_;
+  std::atomic<int>* pread_count_;
+};
+
+// A RandomAccessStream that records the PReadV()-calls to another stream.
+class BatchingRandomAccessStream : public RandomAccessStream {
+ public:
+  explicit BatchingRandomAccessStream(std::unique_ptr<RandomAccessStream> inner)
+      : inner_(std::move(inner)) {}
+
+  crypto::tink::util::Status PRead(
+      int64_t position, int count,
+      crypto::tink::util::Buffer* dest_buffer) override {
+    pread_count_++;
+    return inner_->PRead(position, count, dest_buffer);
+  }
+
+  std::vector<crypto::tink::util::Status> PReadV(
+      absl::Span<const ReadRequest> requests) override {
+    batch_sizes_.push_back(requests.size());
+    std::vector<crypto::tink::util::Status> results;
+    for (const auto& request : requests) {
+      results.push_back(
+          inner_->PRead(request.position, request.count, request.dest_buffer));
+    }
+    return results;
+  }
+
+  crypto::tink::util::StatusOr<int64_t> size() override {
+    return inner_->size();
+  }
+
+  int pread_count() const { return pread_count_; }
+  const std::vector<int>& batch_sizes() const { return batch_sizes_; }
+
+ private:
+  std::unique_ptr<RandomAccessStream> inner_;
+  int pread_count_ = 0;
+  std::vector<int> batch_sizes_;
+};
+
 // Creates a RandomAccessStream with the specified contents.
 std::unique_ptr<RandomAccessStream> GetRandomAccessStream(
     absl::string_view contents) {
@@ -131,6 +198,24 @@ util::Status ReadAll(RandomAccessStream* ra_stream, std::string* contents) {
   return status;
 }
 
+// Returns ParallelOptions which schedule tasks on 'pool', or run them
+// inline if 'pool' is null.
+DecryptingRandomAccessStream::ParallelOptions GetParallelOptions(
+    TestThreadPool* pool, int max_segments_in_flight,
+    int read_ahead_segments) {
+  DecryptingRandomAccessStream::ParallelOptions options;
+  if (pool == nullptr) {
+    options.schedule = [](std::function<void()> task) { task(); };
+  } else {
+    options.schedule = [pool](std::function<void()> task) {
+      pool->Schedule(std::move(task));
+    };
+  }
+  options.max_segments_in_flight = max_segments_in_flight;
+  options.read_ahead_segments = read_ahead_segments;
+  return options;
+}
+
 TEST(DecryptingRandomAccessStreamTest, NegativeCiphertextOffset) {
   int pt_segment_size = 100;
   int header_size = 20;
@@ -387,6 +472,509 @@ TEST(DecryptingRandomAccessStreamTest, WrongCiphertext) {
   }
 }
 
+TEST(DecryptingRandomAccessStreamTest, BatchedSegmentReads) {
+  int pt_segment_size = 100;
+  int header_size = 10;
+  for (int ct_offset : {0, 7}) {
+    SCOPED_TRACE(absl::StrCat("ct_offset = ", ct_offset));
+    int pt_size = 4000;
+    std::string plaintext = subtle::Random::GetRandomBytes(pt_size);
+    DummyStreamingAead saead(pt_segment_size, header_size, ct_offset);
+    auto ct_source = absl::make_unique<BatchingRandomAccessStream>(
+        GetCiphertextSource(&saead, plaintext, "some aad", ct_offset));
+    BatchingRandomAccessStream* batching_source = ct_source.get();
+    auto dec_stream_result = DecryptingRandomAccessStream::New(
+        absl::make_unique<DummyStreamSegmentDecrypter>(
+            pt_segment_size, header_size, ct_offset),
+        std::move(ct_source));
+    ASSERT_THAT(dec_stream_result.status(), IsOk());
+    auto dec_stream = std::move(dec_stream_result.ValueOrDie());
+    auto buffer = std::move(util::Buffer::New(pt_size).ValueOrDie());
+
+    // A read within a single segment does not batch.
+    ASSERT_THAT(dec_stream->PRead(150, 10, buffer.get()), IsOk());
+    EXPECT_EQ(0, std::memcmp(plaintext.data() + 150,
+                             buffer->get_mem_block(), 10));
+    EXPECT_TRUE(batching_source->batch_sizes().empty());
+    int pread_count = batching_source->pread_count();
+
+    // A read of four segments fetches them with one PReadV().
+    ASSERT_THAT(dec_stream->PRead(250, 300, buffer.get()), IsOk());
+    EXPECT_EQ(0, std::memcmp(plaintext.data() + 250,
+                             buffer->get_mem_block(), 300));
+    EXPECT_EQ(std::vector<int>({4}), batching_source->batch_sizes());
+    EXPECT_EQ(pread_count, batching_source->pread_count());
+
+    // The whole stream is fetched in batches of at most 16 segments.
+    EXPECT_THAT(dec_stream->PRead(0, pt_size, buffer.get()),
+                StatusIs(util::error::OUT_OF_RANGE, HasSubstr("EOF")));
+    EXPECT_EQ(plaintext,
+              std::string(buffer->get_mem_block(), buffer->size()));
+    ASSERT_EQ(4, batching_source->batch_sizes().size());
+    int segment_count = 0;
+    for (int i = 1; i < 4; i++) {
+      EXPECT_LE(batching_source->batch_sizes()[i], 16);
+      segment_count += batching_source->batch_sizes()[i];
+    }
+    EXPECT_EQ(41, segment_count);
+    EXPECT_EQ(pread_count, batching_source->pread_count());
+  }
+}
+
+TEST(DecryptingRandomAccessStreamTest, ParallelDecryption) {
+  int pt_segment_size = 100;
+  int header_size = 10;
+  int ct_offset = 5;
+  TestThreadPool pool(4);
+  for (int pt_size : {0, 1, 99, 1000, 10000}) {
+    std::string plaintext = subtle::Random::GetRandomBytes(pt_size);
+    DummyStreamingAead saead(pt_segment_size, header_size, ct_offset);
+    std::string ciphertext =
+        GetCiphertext(&saead, plaintext, "some aad", ct_offset);
+    // A null pool runs the tasks inline.
+    for (TestThreadPool* scheduler_pool :
+         {&pool, static_cast<TestThreadPool*>(nullptr)}) {
+      for (int max_segments_in_flight : {1, 3, 16}) {
+        for (int read_ahead_segments : {0, 2, 8}) {
+          for (int chunk_size : {42, 250, 20000}) {
+            SCOPED_TRACE(absl::StrCat(
+                "pt_size = ", pt_size, ", inline = ", scheduler_pool == nullptr,
+                ", max_segments_in_flight = ", max_segments_in_flight,
+                ", read_ahead_segments = ", read_ahead_segments,
+                ", chunk_size = ", chunk_size));
+            auto dec_stream_result = DecryptingRandomAccessStream::NewParallel(
+                absl::make_unique<DummyStreamSegmentDecrypter>(
+                    pt_segment_size, header_size, ct_offset),
+                GetRandomAccessStream(ciphertext),
+                GetParallelOptions(scheduler_pool, max_segments_in_flight,
+                                   read_ahead_segments));
+            ASSERT_THAT(dec_stream_result.status(), IsOk());
+            auto dec_stream = std::move(dec_stream_result.ValueOrDie());
+            EXPECT_EQ(pt_size, dec_stream->size().ValueOrDie());
+
+            // Read the entire stream sequentially.
+            std::string decrypted;
+            auto buffer = std::move(util::Buffer::New(chunk_size).ValueOrDie());
+            auto status = util::Status::OK;
+            while (status.ok()) {
+              status = dec_stream->PRead(decrypted.size(), chunk_size,
+                                         buffer.get());
+              decrypted.append(buffer->get_mem_block(), buffer->size());
+            }
+            EXPECT_THAT(status,
+                        StatusIs(util::error::OUT_OF_RANGE, HasSubstr("EOF")));
+            EXPECT_EQ(plaintext, decrypted);
+
+            // Read some chunks in random order.
+            for (int position : {pt_size / 2, 0, pt_size / 3, pt_size - 1}) {
+              if (position < 0) continue;
+              status = dec_stream->PRead(position, chunk_size, buffer.get());
+              EXPECT_TRUE(status.ok() ||
+                          status.error_code() == util::error::OUT_OF_RANGE);
+              EXPECT_EQ(std::min(chunk_size, pt_size - position),
+                        buffer->size());
+              EXPECT_EQ(0, std::memcmp(plaintext.data() + position,
+                                       buffer->get_mem_block(),
+                                       buffer->size()));
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST(DecryptingRandomAccessStreamTest, ParallelWrongCiphertext) {
+  int pt_segment_size = 100;
+  int header_size = 10;
+  int ct_offset = 0;
+  TestThreadPool pool(4);
+  DummyStreamingAead saead(pt_segment_size, header_size, ct_offset);
+  std::string ciphertext = GetCiphertext(
+      &saead, subtle::Random::GetRandomBytes(1000), "some aad", ct_offset);
+  // Corrupt a segment in the middle of the stream.
+  ciphertext[3 * (pt_segment_size +
+                  DummyStreamSegmentEncrypter::kSegmentTagSize) - 1] = 'x';
+  auto dec_stream_result = DecryptingRandomAccessStream::NewParallel(
+      absl::make_unique<DummyStreamSegmentDecrypter>(
+          pt_segment_size, header_size, ct_offset),
+      GetRandomAccessStream(ciphertext),
+      GetParallelOptions(&pool, /* max_segments_in_flight = */ 4,
+                         /* read_ahead_segments = */ 4));
+  ASSERT_THAT(dec_stream_result.status(), IsOk());
+  auto dec_stream = std::move(dec_stream_result.ValueOrDie());
+  auto buffer = std::move(util::Buffer::New(1000).ValueOrDie());
+  EXPECT_THAT(dec_stream->PRead(0, 1000, buffer.get()),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  // Segments before the corrupted one can still be read.
+  EXPECT_THAT(dec_stream->PRead(0, 100, buffer.get()), IsOk());
+}
+
+TEST(DecryptingRandomAccessStreamTest, ParallelInvalidOptions) {
+  auto GetStream = [](DecryptingRandomAccessStream::ParallelOptions options) {
+    return DecryptingRandomAccessStream::NewParallel(
+        absl::make_unique<DummyStreamSegmentDecrypter>(100, 10, 0),
+        GetRandomAccessStream("some ciphertext contents"), std::move(options));
+  };
+  DecryptingRandomAccessStream::ParallelOptions options;
+  EXPECT_THAT(GetStream(options).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(GetStream(GetParallelOptions(nullptr, 0, 0)).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(GetStream(GetParallelOptions(nullptr, 1, -1)).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(GetStream(GetParallelOptions(nullptr, 1, 0)).status(), IsOk());
+}
+
+TEST(DecryptingRandomAccessStreamTest, SegmentCache) {
+  int pt_segment_size = 100;
+  int header_size = 10;
+  int ct_offset = 0;
+  int pt_size = 1000;
+  std::string plaintext = subtle::Random::GetRandomBytes(pt_size);
+  DummyStreamingAead saead(pt_segment_size, header_size, ct_offset);
+  std::atomic<int> pread_count(0);
+  // The cache fits three full segments.
+  auto dec_stream_result = DecryptingRandomAccessStream::NewWithSegmentCache(
+      absl::make_unique<DummyStreamSegmentDecrypter>(pt_segment_size,
+                                                     header_size, ct_offset),
+      absl::make_unique<CountingRandomAccessStream>(
+          GetCiphertextSource(&saead, plaintext, "some aad", ct_offset),
+          &pread_count),
+      3 * pt_segment_size);
+  ASSERT_THAT(dec_stream_result.status(), IsOk());
+  auto dec_stream = std::move(dec_stream_result.ValueOrDie());
+  auto buffer = std::move(util::Buffer::New(pt_size).ValueOrDie());
+
+  // Reads within the second segment decrypt it only once.
+  ASSERT_THAT(dec_stream->PRead(100, 10, buffer.get()), IsOk());
+  int initial_pread_count = pread_count;
+  for (int position : {100, 120, 150, 180}) {
+    ASSERT_THAT(dec_stream->PRead(position, 10, buffer.get()), IsOk());
+    EXPECT_EQ(0, std::memcmp(plaintext.data() + position,
+                             buffer->get_mem_block(), 10));
+  }
+  EXPECT_EQ(initial_pread_count, pread_count);
+  auto stats = dec_stream->GetSegmentCacheStats();
+  EXPECT_EQ(4, stats.hits);
+  EXPECT_EQ(1, stats.misses);
+  EXPECT_EQ(pt_segment_size, stats.size_in_bytes);
+
+  // Reading the whole stream keeps the cache bounded.
+  EXPECT_THAT(dec_stream->PRead(0, pt_size, buffer.get()),
+              StatusIs(util::error::OUT_OF_RANGE, HasSubstr("EOF")));
+  EXPECT_EQ(plaintext,
+            std::string(buffer->get_mem_block(), buffer->size()));
+  stats = dec_stream->GetSegmentCacheStats();
+  EXPECT_LE(stats.size_in_bytes, 3 * pt_segment_size);
+
+  // The last segments are cached, and reading them reports EOF.
+  int pread_count_before = pread_count;
+  EXPECT_THAT(dec_stream->PRead(pt_size - 10, 10, buffer.get()),
+              StatusIs(util::error::OUT_OF_RANGE, HasSubstr("EOF")));
+  EXPECT_EQ(pread_count_before, pread_count);
+  EXPECT_EQ(0, std::memcmp(plaintext.data() + pt_size - 10,
+                           buffer->get_mem_block(), 10));
+  // The first segment was evicted.
+  EXPECT_THAT(dec_stream->PRead(0, 10, buffer.get()), IsOk());
+  EXPECT_EQ(pread_count_before + 1, pread_count);
+}
+
+TEST(DecryptingRandomAccessStreamTest, SegmentCacheConcurrentReaders) {
+  int pt_segment_size = 100;
+  int header_size = 10;
+  int ct_offset = 5;
+  int pt_size = 5000;
+  std::string plaintext = subtle::Random::GetRandomBytes(pt_size);
+  DummyStreamingAead saead(pt_segment_size, header_size, ct_offset);
+  auto dec_stream_result = DecryptingRandomAccessStream::NewWithSegmentCache(
+      absl::make_unique<DummyStreamSegmentDecrypter>(pt_segment_size,
+                                                     header_size, ct_offset),
+      GetCiphertextSource(&saead, plaintext, "some aad", ct_offset),
+      10 * pt_segment_size);
+  ASSERT_THAT(dec_stream_result.status(), IsOk());
+  auto dec_stream = std::move(dec_stream_result.ValueOrDie());
+
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 8; i++) {
+    readers.emplace_back([&dec_stream, &plaintext, pt_size, i]() {
+      auto buffer = std::move(util::Buffer::New(250).ValueOrDie());
+      for (int j = 0; j < 200; j++) {
+        int position = (i * 977 + j * 131) % pt_size;
+        auto status = dec_stream->PRead(position, 250, buffer.get());
+        EXPECT_TRUE(status.ok() ||
+                    status.error_code() == util::error::OUT_OF_RANGE);
+        EXPECT_EQ(0, std::memcmp(plaintext.data() + position,
+                                 buffer->get_mem_block(), buffer->size()));
+      }
+    });
+  }
+  for (auto& reader : readers) reader.join();
+  auto stats = dec_stream->GetSegmentCacheStats();
+  EXPECT_GT(stats.hits, 0);
+  EXPECT_LE(stats.size_in_bytes, 10 * pt_segment_size);
+}
+
+TEST(DecryptingRandomAccessStreamTest, ParallelWithSegmentCache) {
+  int pt_segment_size = 100;
+  int header_size = 10;
+  int ct_offset = 0;
+  int pt_size = 2000;
+  std::string plaintext = subtle::Random::GetRandomBytes(pt_size);
+  DummyStreamingAead saead(pt_segment_size, header_size, ct_offset);
+  TestThreadPool pool(4);
+  auto options = GetParallelOptions(&pool, /* max_segments_in_flight = */ 4,
+                                    /* read_ahead_segments = */ 2);
+  options.segment_cache_size_in_bytes = pt_size;
+  auto dec_stream_result = DecryptingRandomAccessStream::NewParallel(
+      absl::make_unique<DummyStreamSegmentDecrypter>(pt_segment_size,
+                                                     header_size, ct_offset),
+      GetCiphertextSource(&saead, plaintext, "some aad", ct_offset),
+      std::move(options));
+  ASSERT_THAT(dec_stream_result.status(), IsOk());
+  auto dec_stream = std::move(dec_stream_result.ValueOrDie());
+  auto buffer = std::move(util::Buffer::New(pt_size).ValueOrDie());
+  for (int i = 0; i < 2; i++) {
+    EXPECT_THAT(dec_stream->PRead(0, pt_size, buffer.get()),
+                StatusIs(util::error::OUT_OF_RANGE, HasSubstr("EOF")));
+    EXPECT_EQ(plaintext,
+              std::string(buffer->get_mem_block(), buffer->size()));
+  }
+}
+
+TEST(DecryptingRandomAccessStreamTest, SegmentCacheNegativeSize) {
+  EXPECT_THAT(DecryptingRandomAccessStream::NewWithSegmentCache(
+                  absl::make_unique<DummyStreamSegmentDecrypter>(100, 10, 0),
+                  GetRandomAccessStream("some ciphertext contents"), -1)
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(DecryptingRandomAccessStreamTest, VerifiedSize) {
+  int pt_segment_size = 100;
+  int header_size = 10;
+  int ct_offset = 5;
+  for (int pt_size : {0, 50, 1000, 1050}) {
+    SCOPED_TRACE(absl::StrCat("pt_size = ", pt_size));
+    std::string plaintext = subtle::Random::GetRandomBytes(pt_size);
+    DummyStreamingAead saead(pt_segment_size, header_size, ct_offset);
+    std::atomic<int> pread_count(0);
+    auto dec_stream_result = DecryptingRandomAccessStream::New(
+        absl::make_unique<DummyStreamSegmentDecrypter>(pt_segment_size,
+                                                       header_size, ct_offset),
+        absl::make_unique<CountingRandomAccessStream>(
+            GetCiphertextSource(&saead, plaintext, "some aad", ct_offset),
+            &pread_count));
+    ASSERT_THAT(dec_stream_result.status(), IsOk());
+    auto dec_stream = std::move(dec_stream_result.ValueOrDie());
+    auto size_result = dec_stream->VerifiedSize();
+    ASSERT_THAT(size_result.status(), IsOk());
+    EXPECT_EQ(pt_size, size_result.ValueOrDie());
+    // One PRead() for the header and one for the last segment.
+    EXPECT_EQ(2, pread_count);
+    // The verified size is cached.
+    size_result = dec_stream->VerifiedSize();
+    ASSERT_THAT(size_result.status(), IsOk());
+    EXPECT_EQ(pt_size, size_result.ValueOrDie());
+    EXPECT_EQ(2, pread_count);
+  }
+}
+
+TEST(DecryptingRandomAccessStreamTest, VerifiedSizeAfterReadingLastSegment) {
+  int pt_segment_size = 100;
+  int header_size = 10;
+  int ct_offset = 0;
+  int pt_size = 1000;
+  std::string plaintext = subtle::Random::GetRandomBytes(pt_size);
+  DummyStreamingAead saead(pt_segment_size, header_size, ct_offset);
+  std::atomic<int> pread_count(0);
+  auto dec_stream_result = DecryptingRandomAccessStream::New(
+      absl::make_unique<DummyStreamSegmentDecrypter>(pt_segment_size,
+                                                     header_size, ct_offset),
+      absl::make_unique<CountingRandomAccessStream>(
+          GetCiphertextSource(&saead, plaintext, "some aad", ct_offset),
+          &pread_count));
+  ASSERT_THAT(dec_stream_result.status(), IsOk());
+  auto dec_stream = std::move(dec_stream_result.ValueOrDie());
+  auto buffer = std::move(util::Buffer::New(pt_size).ValueOrDie());
+  EXPECT_THAT(dec_stream->PRead(pt_size - 10, 10, buffer.get()),
+              StatusIs(util::error::OUT_OF_RANGE, HasSubstr("EOF")));
+  int pread_count_before = pread_count;
+  auto size_result = dec_stream->VerifiedSize();
+  ASSERT_THAT(size_result.status(), IsOk());
+  EXPECT_EQ(pt_size, size_result.ValueOrDie());
+  EXPECT_EQ(pread_count_before, pread_count);
+}
+
+TEST(DecryptingRandomAccessStreamTest, VerifiedSizeWithSegmentCache) {
+  int pt_segment_size = 100;
+  int header_size = 10;
+  int ct_offset = 0;
+  int pt_size = 1050;
+  std::string plaintext = subtle::Random::GetRandomBytes(pt_size);
+  DummyStreamingAead saead(pt_segment_size, header_size, ct_offset);
+  std::atomic<int> pread_count(0);
+  auto dec_stream_result = DecryptingRandomAccessStream::NewWithSegmentCache(
+      absl::make_unique<DummyStreamSegmentDecrypter>(pt_segment_size,
+                                                     header_size, ct_offset),
+      absl::make_unique<CountingRandomAccessStream>(
+          GetCiphertextSource(&saead, plaintext, "some aad", ct_offset),
+          &pread_count),
+      3 * pt_segment_size);
+  ASSERT_THAT(dec_stream_result.status(), IsOk());
+  auto dec_stream = std::move(dec_stream_result.ValueOrDie());
+  auto size_result = dec_stream->VerifiedSize();
+  ASSERT_THAT(size_result.status(), IsOk());
+  EXPECT_EQ(pt_size, size_result.ValueOrDie());
+  // Reading the tail of the stream uses the segment verified for the size.
+  int pread_count_before = pread_count;
+  auto buffer = std::move(util::Buffer::New(pt_size).ValueOrDie());
+  EXPECT_THAT(dec_stream->PRead(pt_size - 10, 10, buffer.get()),
+              StatusIs(util::error::OUT_OF_RANGE, HasSubstr("EOF")));
+  EXPECT_EQ(pread_count_before, pread_count);
+  EXPECT_EQ(0, std::memcmp(plaintext.data() + pt_size - 10,
+                           buffer->get_mem_block(), 10));
+}
+
+TEST(DecryptingRandomAccessStreamTest, VerifiedSizeConcurrentCallers) {
+  int pt_segment_size = 100;
+  int header_size = 10;
+  int ct_offset = 5;
+  int pt_size = 5000;
+  std::string plaintext = subtle::Random::GetRandomBytes(pt_size);
+  DummyStreamingAead saead(pt_segment_size, header_size, ct_offset);
+  std::atomic<int> pread_count(0);
+  auto dec_stream_result = DecryptingRandomAccessStream::New(
+      absl::make_unique<DummyStreamSegmentDecrypter>(pt_segment_size,
+                                                     header_size, ct_offset),
+      absl::make_unique<CountingRandomAccessStream>(
+          GetCiphertextSource(&saead, plaintext, "some aad", ct_offset),
+          &pread_count));
+  ASSERT_THAT(dec_stream_result.status(), IsOk());
+  auto dec_stream = std::move(dec_stream_result.ValueOrDie());
+
+  std::vector<std::thread> callers;
+  for (int i = 0; i < 8; i++) {
+    callers.emplace_back([&dec_stream, pt_size]() {
+      auto size_result = dec_stream->VerifiedSize();
+      ASSERT_THAT(size_result.status(), IsOk());
+      EXPECT_EQ(pt_size, size_result.ValueOrDie());
+    });
+  }
+  for (auto& caller : callers) caller.join();
+  // The last segment was verified only once.
+  EXPECT_EQ(2, pread_count);
+}
+
+TEST(DecryptingRandomAccessStreamTest, VerifiedSizeOfTruncatedCiphertext) {
+  int pt_segment_size = 100;
+  int header_size = 10;
+  int ct_offset = 0;
+  int pt_size = 1000;
+  std::string plaintext = subtle::Random::GetRandomBytes(pt_size);
+  DummyStreamingAead saead(pt_segment_size, header_size, ct_offset);
+  auto ct = GetCiphertext(&saead, plaintext, "some aad", ct_offset);
+  DummyStreamSegmentDecrypter seg_decrypter(pt_segment_size, header_size,
+                                            ct_offset);
+  for (int trunc_ct_size :
+       {static_cast<int>(ct.size()) - 1,
+        static_cast<int>(ct.size()) - pt_segment_size,
+        static_cast<int>(ct.size()) -
+            seg_decrypter.get_ciphertext_segment_size()}) {
+    SCOPED_TRACE(absl::StrCat("trunc_ct_size = ", trunc_ct_size));
+    auto dec_stream_result = DecryptingRandomAccessStream::New(
+        absl::make_unique<DummyStreamSegmentDecrypter>(pt_segment_size,
+                                                       header_size, ct_offset),
+        GetRandomAccessStream(ct.substr(0, trunc_ct_size)));
+    ASSERT_THAT(dec_stream_result.status(), IsOk());
+    auto dec_stream = std::move(dec_stream_result.ValueOrDie());
+    // size() is computed from the ciphertext size alone, VerifiedSize() is
+    // not fooled.
+    EXPECT_THAT(dec_stream->size().status(), IsOk());
+    EXPECT_THAT(dec_stream->VerifiedSize().status(),
+                StatusIs(util::error::INVALID_ARGUMENT));
+    // Failures are not cached.
+    EXPECT_THAT(dec_stream->VerifiedSize().status(),
+                StatusIs(util::error::INVALID_ARGUMENT));
+  }
+}
+
+TEST(DecryptingRandomAccessStreamTest, BufferPool) {
+  int pt_segment_size = 100;
+  int header_size = 10;
+  int ct_offset = 0;
+  int pt_size = 1000;
+  std::string plaintext = subtle::Random::GetRandomBytes(pt_size);
+  DummyStreamingAead saead(pt_segment_size, header_size, ct_offset);
+  std::shared_ptr<util::BufferPool> buffer_pool =
+      std::move(util::BufferPool::New(util::BufferPool::Options()).ValueOrDie());
+  // Two streams share the pool.
+  for (int i = 0; i < 2; i++) {
+    auto dec_stream_result = DecryptingRandomAccessStream::NewWithBufferPool(
+        absl::make_unique<DummyStreamSegmentDecrypter>(pt_segment_size,
+                                                       header_size, ct_offset),
+        GetCiphertextSource(&saead, plaintext, "some aad", ct_offset),
+        buffer_pool);
+    ASSERT_THAT(dec_stream_result.status(), IsOk());
+    auto dec_stream = std::move(dec_stream_result.ValueOrDie());
+    auto buffer = std::move(util::Buffer::New(pt_size).ValueOrDie());
+    for (int position : {0, 150, 420, 990}) {
+      auto status = dec_stream->PRead(position, 10, buffer.get());
+      EXPECT_TRUE(status.ok() ||
+                  status.error_code() == util::error::OUT_OF_RANGE);
+      EXPECT_EQ(0, std::memcmp(plaintext.data() + position,
+                               buffer->get_mem_block(), buffer->size()));
+    }
+    EXPECT_THAT(dec_stream->PRead(0, pt_size, buffer.get()),
+                StatusIs(util::error::OUT_OF_RANGE, HasSubstr("EOF")));
+    EXPECT_EQ(plaintext,
+              std::string(buffer->get_mem_block(), buffer->size()));
+  }
+  // The second stream reads its segments into the blocks released by the
+  // first one.
+  util::BufferPool::Stats stats = buffer_pool->GetStats();
+  EXPECT_GT(stats.allocated_blocks, 0);
+  EXPECT_GE(stats.reused_blocks, stats.allocated_blocks);
+}
+
+TEST(DecryptingRandomAccessStreamTest, ParallelWithBufferPool) {
+  int pt_segment_size = 100;
+  int header_size = 10;
+  int ct_offset = 5;
+  int pt_size = 2000;
+  std::string plaintext = subtle::Random::GetRandomBytes(pt_size);
+  DummyStreamingAead saead(pt_segment_size, header_size, ct_offset);
+  TestThreadPool pool(4);
+  auto options = GetParallelOptions(&pool, /* max_segments_in_flight = */ 4,
+                                    /* read_ahead_segments = */ 2);
+  options.buffer_pool =
+      std::move(util::BufferPool::New(util::BufferPool::Options()).ValueOrDie());
+  std::shared_ptr<util::BufferPool> buffer_pool = options.buffer_pool;
+  auto dec_stream_result = DecryptingRandomAccessStream::NewParallel(
+      absl::make_unique<DummyStreamSegmentDecrypter>(pt_segment_size,
+                                                     header_size, ct_offset),
+      GetCiphertextSource(&saead, plaintext, "some aad", ct_offset),
+      std::move(options));
+  ASSERT_THAT(dec_stream_result.status(), IsOk());
+  auto dec_stream = std::move(dec_stream_result.ValueOrDie());
+  auto buffer = std::move(util::Buffer::New(pt_size).ValueOrDie());
+  for (int i = 0; i < 2; i++) {
+    EXPECT_THAT(dec_stream->PRead(0, pt_size, buffer.get()),
+                StatusIs(util::error::OUT_OF_RANGE, HasSubstr("EOF")));
+    EXPECT_EQ(plaintext,
+              std::string(buffer->get_mem_block(), buffer->size()));
+  }
+  EXPECT_GT(buffer_pool->GetStats().reused_blocks, 0);
+}
+
+TEST(DecryptingRandomAccessStreamTest, NullBufferPool) {
+  EXPECT_THAT(DecryptingRandomAccessStream::NewWithBufferPool(
+                  absl::make_unique<DummyStreamSegmentDecrypter>(100, 10, 0),
+                  GetRandomAccessStream("some ciphertext contents"), nullptr)
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
 TEST(DecryptingRandomAccessStreamTest, NullSegmentDecrypter) {
   auto ct_stream = GetRandomAccessStream("some ciphertext contents");
   auto dec_stream_result =
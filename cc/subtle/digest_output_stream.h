@@ -0,0 +1,129 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_SUBTLE_DIGEST_OUTPUT_STREAM_H_
+#define TINK_SUBTLE_DIGEST_OUTPUT_STREAM_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/types/span.h"
+#include "openssl/digest.h"
+#include "openssl/evp.h"
+#include "tink/output_stream_with_result.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+// An OutputStreamWithResult which hashes the data written to it, and when
+// closed returns the result of a function on the digest. Hash-then-sign
+// schemes use it to sign and verify data of any size in constant memory.
+template <class T>
+class DigestOutputStream : public OutputStreamWithResult<T> {
+ public:
+  using ResultType = typename OutputStreamWithResult<T>::ResultType;
+  using DigestFunction =
+      std::function<ResultType(absl::Span<const uint8_t> digest)>;
+
+  // Returns a stream hashing with 'hash', which must outlive it, and
+  // computing the result with 'digest_function'.
+  static crypto::tink::util::StatusOr<
+      std::unique_ptr<OutputStreamWithResult<T>>>
+  New(const EVP_MD* hash, DigestFunction digest_function) {
+    bssl::UniquePtr<EVP_MD_CTX> md_ctx(EVP_MD_CTX_new());
+    if (md_ctx == nullptr ||
+        1 != EVP_DigestInit_ex(md_ctx.get(), hash, nullptr)) {
+      return util::Status(util::error::INTERNAL,
+                          "Could not initialize digest.");
+    }
+    return {absl::WrapUnique(new DigestOutputStream(
+        std::move(md_ctx), std::move(digest_function)))};
+  }
+
+  void BackUp(int count) override {
+    count = std::min(std::max(0, count), buffer_position_);
+    buffer_position_ -= count;
+    position_ -= count;
+  }
+
+  int64_t Position() const override { return position_; }
+
+ protected:
+  util::StatusOr<int> NextBuffer(void** data) override {
+    util::Status status = Absorb();
+    if (!status.ok()) return status;
+    *data = buffer_.data();
+    buffer_position_ = buffer_.size();
+    position_ += buffer_.size();
+    return buffer_position_;
+  }
+
+  ResultType CloseStreamAndComputeResult() override {
+    util::Status status = Absorb();
+    if (!status.ok()) return status;
+    uint8_t digest[EVP_MAX_MD_SIZE];
+    unsigned int digest_size;
+    if (1 != EVP_DigestFinal_ex(md_ctx_.get(), digest, &digest_size)) {
+      return util::Status(util::error::INTERNAL, "Could not compute digest.");
+    }
+    return digest_function_(absl::MakeConstSpan(digest, digest_size));
+  }
+
+ private:
+  static constexpr size_t kBufferSize = 4096;
+
+  DigestOutputStream(bssl::UniquePtr<EVP_MD_CTX> md_ctx,
+                     DigestFunction digest_function)
+      : md_ctx_(std::move(md_ctx)),
+        digest_function_(std::move(digest_function)),
+        buffer_(kBufferSize) {}
+
+  // Hashes the data written to the buffer since the last call.
+  util::Status Absorb() {
+    if (!status_.ok()) return status_;
+    if (buffer_position_ > 0 &&
+        1 != EVP_DigestUpdate(md_ctx_.get(), buffer_.data(),
+                              buffer_position_)) {
+      status_ =
+          util::Status(util::error::INTERNAL, "Could not compute digest.");
+    }
+    buffer_position_ = 0;
+    return status_;
+  }
+
+  const bssl::UniquePtr<EVP_MD_CTX> md_ctx_;
+  const DigestFunction digest_function_;
+  util::Status status_;
+  std::vector<uint8_t> buffer_;
+  // The number of bytes of buffer_ which were returned by the last
+  // NextBuffer() and not backed up.
+  int buffer_position_ = 0;
+  int64_t position_ = 0;
+};
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_SUBTLE_DIGEST_OUTPUT_STREAM_H_
@@ -0,0 +1,115 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/subtle/digest_output_stream.h"
+
+#include <cstring>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "openssl/digest.h"
+#include "tink/subtle/random.h"
+#include "tink/subtle/test_util.h"
+#include "tink/util/status.h"
+#include "tink/util/test_matchers.h"
+#include "tink/util/test_util.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+namespace {
+
+using ::crypto::tink::test::HexEncode;
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+
+std::string Digest(absl::Span<const uint8_t> digest) {
+  return std::string(reinterpret_cast<const char*>(digest.data()),
+                     digest.size());
+}
+
+std::unique_ptr<OutputStreamWithResult<std::string>> NewSha256Stream() {
+  auto stream_result =
+      DigestOutputStream<std::string>::New(EVP_sha256(), Digest);
+  EXPECT_THAT(stream_result.status(), IsOk());
+  return std::move(stream_result.ValueOrDie());
+}
+
+TEST(DigestOutputStreamTest, ComputesDigest) {
+  for (size_t size : {0, 1, 4095, 4096, 4097, 100000}) {
+    SCOPED_TRACE(size);
+    std::string data = Random::GetRandomBytes(size);
+    auto stream = NewSha256Stream();
+    ASSERT_THAT(test::WriteToStream(stream.get(), data), IsOk());
+    EXPECT_EQ(size, stream->Position());
+    auto result = stream->GetResult();
+    ASSERT_THAT(result.status(), IsOk());
+
+    uint8_t expected[EVP_MAX_MD_SIZE];
+    unsigned int expected_size;
+    ASSERT_EQ(1, EVP_Digest(data.data(), data.size(), expected,
+                            &expected_size, EVP_sha256(), nullptr));
+    EXPECT_EQ(HexEncode(Digest(absl::MakeConstSpan(expected, expected_size))),
+              HexEncode(result.ValueOrDie()));
+  }
+}
+
+TEST(DigestOutputStreamTest, BackUp) {
+  auto stream = NewSha256Stream();
+  void* buffer;
+  auto next_result = stream->Next(&buffer);
+  ASSERT_THAT(next_result.status(), IsOk());
+  int size = next_result.ValueOrDie();
+  ASSERT_GT(size, 10);
+  std::memcpy(buffer, "abc", 3);
+  stream->BackUp(size - 3);
+  EXPECT_EQ(3, stream->Position());
+  // Backing up is limited to the data in the last buffer.
+  stream->BackUp(size);
+  EXPECT_EQ(0, stream->Position());
+  ASSERT_THAT(test::WriteToStream(stream.get(), "abc"), IsOk());
+  EXPECT_EQ(
+      "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad",
+      HexEncode(stream->GetResult().ValueOrDie()));
+}
+
+TEST(DigestOutputStreamTest, ClosedStream) {
+  auto stream = NewSha256Stream();
+  ASSERT_THAT(stream->Close(), IsOk());
+  void* buffer;
+  EXPECT_THAT(stream->Next(&buffer).status(),
+              StatusIs(util::error::FAILED_PRECONDITION));
+  EXPECT_THAT(stream->Close(), StatusIs(util::error::FAILED_PRECONDITION));
+}
+
+TEST(DigestOutputStreamTest, ReturnsStatusOfDigestFunction) {
+  auto stream_result = DigestOutputStream<util::Status>::New(
+      EVP_sha256(), [](absl::Span<const uint8_t> digest) {
+        return util::Status(util::error::INVALID_ARGUMENT, "invalid");
+      });
+  ASSERT_THAT(stream_result.status(), IsOk());
+  auto& stream = stream_result.ValueOrDie();
+  ASSERT_THAT(test::WriteToStream(stream.get(), "data", false), IsOk());
+  EXPECT_THAT(stream->CloseAndGetResult(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
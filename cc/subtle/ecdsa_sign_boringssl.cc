@@ -16,10 +16,15 @@
 
 #include "tink/subtle/ecdsa_sign_boringssl.h"
 
-#include <vector>
+#include <algorithm>
+#include <string>
+#include <utility>
 
 #include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
 #include "tink/subtle/common_enums.h"
+#include "tink/subtle/digest_output_stream.h"
+#include "tink/subtle/subtle_util.h"
 #include "tink/subtle/subtle_util_boringssl.h"
 #include "tink/util/errors.h"
 #include "openssl/bn.h"
@@ -31,41 +36,6 @@ namespace crypto {
 namespace tink {
 namespace subtle {
 
-namespace {
-
-// Transforms ECDSA DER signature encoding to IEEE_P1363 encoding.
-//
-// The IEEE_P1363 signature's format is r || s, where r and s are zero-padded
-// and have the same size in bytes as the order of the curve. For example, for
-// NIST P-256 curve, r and s are zero-padded to 32 bytes.
-//
-// The DER signature is encoded using ASN.1
-// (https://tools.ietf.org/html/rfc5480#appendix-A): ECDSA-Sig-Value :: =
-// SEQUENCE { r INTEGER, s INTEGER }. In particular, the encoding is: 0x30 ||
-// totalLength || 0x02 || r's length || r || 0x02 || s's length || s.
-crypto::tink::util::StatusOr<std::string> DerToIeee(absl::string_view der,
-                                                    const EC_KEY* key) {
-  size_t field_size_in_bytes =
-      (EC_GROUP_get_degree(EC_KEY_get0_group(key)) + 7) / 8;
-  bssl::UniquePtr<ECDSA_SIG> ecdsa(ECDSA_SIG_from_bytes(
-      reinterpret_cast<const uint8_t*>(der.data()), der.size()));
-  if (ecdsa.get() == nullptr) {
-    return util::Status(util::error::INTERNAL,
-                        "Internal BoringSSL ECDSA_SIG_from_bytes's error");
-  }
-  auto status_or_r = SubtleUtilBoringSSL::bn2str(ecdsa->r, field_size_in_bytes);
-  if (!status_or_r.ok()) {
-    return status_or_r.status();
-  }
-  auto status_or_s = SubtleUtilBoringSSL::bn2str(ecdsa->s, field_size_in_bytes);
-  if (!status_or_s.ok()) {
-    return status_or_s.status();
-  }
-  return status_or_r.ValueOrDie() + status_or_s.ValueOrDie();
-}
-
-}  // namespace
-
 // static
 util::StatusOr<std::unique_ptr<EcdsaSignBoringSsl>> EcdsaSignBoringSsl::New(
     const SubtleUtilBoringSSL::EcKey& ec_key, HashType hash_type,
@@ -118,41 +88,130 @@ util::StatusOr<std::unique_ptr<EcdsaSignBoringSsl>> EcdsaSignBoringSsl::New(
 EcdsaSignBoringSsl::EcdsaSignBoringSsl(bssl::UniquePtr<EC_KEY> key,
                                        const EVP_MD* hash,
                                        EcdsaSignatureEncoding encoding)
-    : key_(std::move(key)), hash_(hash), encoding_(encoding) {}
+    : key_(std::move(key)),
+      hash_(hash),
+      encoding_(encoding),
+      field_size_in_bytes_(
+          (EC_GROUP_get_degree(EC_KEY_get0_group(key_.get())) + 7) / 8),
+      max_signature_size_(encoding_ == EcdsaSignatureEncoding::IEEE_P1363
+                              ? 2 * field_size_in_bytes_
+                              : ECDSA_size(key_.get())) {}
 
 util::StatusOr<std::string> EcdsaSignBoringSsl::Sign(
     absl::string_view data) const {
+  return SignWithPrefix("", data, "");
+}
+
+util::StatusOr<std::string> EcdsaSignBoringSsl::SignWithPrefix(
+    absl::string_view output_prefix, absl::string_view data,
+    absl::string_view data_suffix) const {
   // BoringSSL expects a non-null pointer for data,
   // regardless of whether the size is 0.
   data = SubtleUtilBoringSSL::EnsureNonNull(data);
 
   // Compute the digest.
-  unsigned int digest_size;
   uint8_t digest[EVP_MAX_MD_SIZE];
-  if (1 != EVP_Digest(data.data(), data.size(), digest, &digest_size, hash_,
-                  nullptr)) {
-    return util::Status(util::error::INTERNAL, "Could not compute digest.");
+  auto digest_size_or =
+      boringssl::ComputeHash(data, data_suffix, *hash_, digest);
+  if (!digest_size_or.ok()) return digest_size_or.status();
+  return SignDigest(output_prefix,
+                    absl::MakeConstSpan(digest, digest_size_or.ValueOrDie()));
+}
+
+util::StatusOr<std::unique_ptr<OutputStreamWithResult<std::string>>>
+EcdsaSignBoringSsl::NewSignOutputStream() const {
+  return DigestOutputStream<std::string>::New(
+      hash_, [this](absl::Span<const uint8_t> digest) {
+        return SignDigest("", digest);
+      });
+}
+
+util::Status EcdsaSignBoringSsl::SignBatchWithPrefix(
+    absl::string_view output_prefix, absl::Span<const absl::string_view> data,
+    absl::string_view data_suffix, std::string* arena,
+    std::vector<absl::string_view>* signatures) const {
+  // Hashes all messages first, reusing one digest context.
+  const size_t digest_size = EVP_MD_size(hash_);
+  std::vector<uint8_t> digests(data.size() * digest_size);
+  bssl::ScopedEVP_MD_CTX md_ctx;
+  for (size_t i = 0; i < data.size(); i++) {
+    absl::string_view message = SubtleUtilBoringSSL::EnsureNonNull(data[i]);
+    unsigned int size = 0;
+    if (EVP_DigestInit_ex(md_ctx.get(), hash_, /*engine=*/nullptr) != 1 ||
+        EVP_DigestUpdate(md_ctx.get(), message.data(), message.size()) != 1 ||
+        EVP_DigestUpdate(md_ctx.get(), data_suffix.data(),
+                         data_suffix.size()) != 1 ||
+        EVP_DigestFinal_ex(md_ctx.get(), &digests[i * digest_size], &size) !=
+            1 ||
+        size != digest_size) {
+      return util::Status(
+          util::error::INTERNAL,
+          absl::StrCat("Openssl internal error computing hash: ",
+                       SubtleUtilBoringSSL::GetErrors()));
+    }
   }
 
-  // Compute the signature.
-  std::vector<uint8_t> buffer(ECDSA_size(key_.get()));
-  unsigned int sig_length;
-  if (1 != ECDSA_sign(0 /* unused */, digest, digest_size, buffer.data(),
-                  &sig_length, key_.get())) {
-    return util::Status(util::error::INTERNAL, "Signing failed.");
+  // DER signatures are shorter than max_signature_size_ in general, so every
+  // signature is written directly after the previous one.
+  ResizeStringUninitialized(
+      arena, data.size() * (output_prefix.size() + max_signature_size_));
+  std::vector<int64_t> sizes;
+  sizes.reserve(data.size());
+  size_t offset = 0;
+  for (size_t i = 0; i < data.size(); i++) {
+    char* out = &(*arena)[0] + offset;
+    std::copy(output_prefix.begin(), output_prefix.end(), out);
+    auto size_result = SignDigestInto(
+        absl::MakeConstSpan(&digests[i * digest_size], digest_size),
+        reinterpret_cast<uint8_t*>(out + output_prefix.size()));
+    if (!size_result.ok()) return size_result.status();
+    sizes.push_back(output_prefix.size() + size_result.ValueOrDie());
+    offset += sizes.back();
   }
+  arena->resize(offset);
+  SplitArena(*arena, sizes, signatures);
+  return util::OkStatus();
+}
 
+util::StatusOr<std::string> EcdsaSignBoringSsl::SignDigest(
+    absl::string_view output_prefix, absl::Span<const uint8_t> digest) const {
+  std::string signature;
+  ResizeStringUninitialized(&signature,
+                            output_prefix.size() + max_signature_size_);
+  std::copy(output_prefix.begin(), output_prefix.end(), signature.begin());
+  auto size_result = SignDigestInto(
+      digest, reinterpret_cast<uint8_t*>(&signature[output_prefix.size()]));
+  if (!size_result.ok()) return size_result.status();
+  signature.resize(output_prefix.size() + size_result.ValueOrDie());
+  return signature;
+}
+
+util::StatusOr<size_t> EcdsaSignBoringSsl::SignDigestInto(
+    absl::Span<const uint8_t> digest, uint8_t* out) const {
   if (encoding_ == subtle::EcdsaSignatureEncoding::IEEE_P1363) {
-    auto status_or_sig = DerToIeee(
-        std::string(reinterpret_cast<char*>(buffer.data()), sig_length),
-        key_.get());
-    if (!status_or_sig.ok()) {
-      return status_or_sig.status();
+    // The IEEE_P1363 signature's format is r || s, where r and s are
+    // zero-padded to the size of the field in bytes. They are written directly
+    // from the ECDSA_SIG, rather than encoded in DER and parsed again.
+    bssl::UniquePtr<ECDSA_SIG> ecdsa(
+        ECDSA_do_sign(digest.data(), digest.size(), key_.get()));
+    if (ecdsa == nullptr) {
+      return util::Status(util::error::INTERNAL, "Signing failed.");
+    }
+    if (1 != BN_bn2bin_padded(out, field_size_in_bytes_, ecdsa->r) ||
+        1 != BN_bn2bin_padded(out + field_size_in_bytes_,
+                              field_size_in_bytes_, ecdsa->s)) {
+      return util::Status(util::error::INTERNAL,
+                          "Internal BoringSSL BN_bn2bin_padded's error");
     }
-    return status_or_sig.ValueOrDie();
+    return 2 * field_size_in_bytes_;
   }
 
-  return std::string(reinterpret_cast<char*>(buffer.data()), sig_length);
+  unsigned int sig_length;
+  if (1 != ECDSA_sign(0 /* unused */, digest.data(), digest.size(), out,
+                      &sig_length, key_.get())) {
+    return util::Status(util::error::INTERNAL, "Signing failed.");
+  }
+  return sig_length;
 }
 
 }  // namespace subtle
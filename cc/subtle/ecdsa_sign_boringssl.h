@@ -18,9 +18,13 @@
 #define TINK_SUBTLE_ECDSA_SIGN_BORINGSSL_H_
 
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "tink/config/tink_fips.h"
+#include "tink/output_stream_with_result.h"
 #include "tink/subtle/common_enums.h"
 #include "tink/subtle/subtle_util_boringssl.h"
 #include "tink/public_key_sign.h"
@@ -43,6 +47,25 @@ class EcdsaSignBoringSsl : public PublicKeySign {
   crypto::tink::util::StatusOr<std::string> Sign(
       absl::string_view data) const override;
 
+  // Hashes 'data' and 'data_suffix' without concatenating them, and writes
+  // the signature directly after 'output_prefix'.
+  crypto::tink::util::StatusOr<std::string> SignWithPrefix(
+      absl::string_view output_prefix, absl::string_view data,
+      absl::string_view data_suffix) const override;
+
+  // Hashes all messages with one digest context, then signs the digests into
+  // a single buffer.
+  crypto::tink::util::Status SignBatchWithPrefix(
+      absl::string_view output_prefix,
+      absl::Span<const absl::string_view> data, absl::string_view data_suffix,
+      std::string* arena,
+      std::vector<absl::string_view>* signatures) const override;
+
+  // Hashes the data as it is written, so only the digest is kept in memory.
+  crypto::tink::util::StatusOr<
+      std::unique_ptr<OutputStreamWithResult<std::string>>>
+  NewSignOutputStream() const override;
+
   static constexpr crypto::tink::FipsCompatibility kFipsStatus =
       crypto::tink::FipsCompatibility::kRequiresBoringCrypto;
 
@@ -50,9 +73,23 @@ class EcdsaSignBoringSsl : public PublicKeySign {
   EcdsaSignBoringSsl(bssl::UniquePtr<EC_KEY> key, const EVP_MD* hash,
                      EcdsaSignatureEncoding encoding);
 
+  // Returns 'output_prefix' followed by the signature for the hash_ digest
+  // of the data.
+  crypto::tink::util::StatusOr<std::string> SignDigest(
+      absl::string_view output_prefix, absl::Span<const uint8_t> digest) const;
+
+  // Writes the signature for 'digest' to 'out', which must hold
+  // max_signature_size_ bytes, and returns its size.
+  crypto::tink::util::StatusOr<size_t> SignDigestInto(
+      absl::Span<const uint8_t> digest, uint8_t* out) const;
+
   bssl::UniquePtr<EC_KEY> key_;
   const EVP_MD* hash_;  // Owned by BoringSSL.
   EcdsaSignatureEncoding encoding_;
+  // The size of r and s in IEEE_P1363 signatures.
+  size_t field_size_in_bytes_;
+  // The size of IEEE_P1363 signatures, and the maximum size of DER ones.
+  size_t max_signature_size_;
 };
 
 }  // namespace subtle
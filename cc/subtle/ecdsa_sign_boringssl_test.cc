@@ -17,14 +17,18 @@
 #include "tink/subtle/ecdsa_sign_boringssl.h"
 
 #include <string>
+#include <vector>
 
 #include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
 #include "tink/public_key_sign.h"
 #include "tink/public_key_verify.h"
 #include "tink/subtle/common_enums.h"
 #include "tink/subtle/ec_util.h"
 #include "tink/subtle/ecdsa_verify_boringssl.h"
+#include "tink/subtle/random.h"
 #include "tink/subtle/subtle_util_boringssl.h"
+#include "tink/subtle/test_util.h"
 #include "tink/util/status.h"
 #include "tink/util/statusor.h"
 #include "tink/util/test_matchers.h"
@@ -81,6 +85,138 @@ TEST_F(EcdsaSignBoringSslTest, testBasicSigning) {
   }
 }
 
+TEST_F(EcdsaSignBoringSslTest, testSignWithPrefix) {
+  if (kUseOnlyFips && !FIPS_mode()) {
+    GTEST_SKIP()
+        << "Test is skipped if kOnlyUseFips but BoringCrypto is unavailable.";
+  }
+  subtle::EcdsaSignatureEncoding encodings[2] = {
+      EcdsaSignatureEncoding::DER, EcdsaSignatureEncoding::IEEE_P1363};
+  for (EcdsaSignatureEncoding encoding : encodings) {
+    auto ec_key = SubtleUtilBoringSSL::GetNewEcKey(EllipticCurveType::NIST_P256)
+                      .ValueOrDie();
+    auto signer_result =
+        EcdsaSignBoringSsl::New(ec_key, HashType::SHA256, encoding);
+    ASSERT_TRUE(signer_result.ok()) << signer_result.status();
+    auto signer = std::move(signer_result.ValueOrDie());
+    auto verifier_result =
+        EcdsaVerifyBoringSsl::New(ec_key, HashType::SHA256, encoding);
+    ASSERT_TRUE(verifier_result.ok()) << verifier_result.status();
+    auto verifier = std::move(verifier_result.ValueOrDie());
+
+    std::string prefix = "\x01\x02\x03\x04\x05";
+    std::string message = "some data to be signed";
+    auto sign_result = signer->SignWithPrefix(prefix, message, "suffix");
+    ASSERT_TRUE(sign_result.ok()) << sign_result.status();
+    absl::string_view signature = sign_result.ValueOrDie();
+    ASSERT_EQ(signature.substr(0, prefix.size()), prefix);
+    signature.remove_prefix(prefix.size());
+    auto status = verifier->Verify(signature, message + "suffix");
+    EXPECT_TRUE(status.ok()) << status;
+    EXPECT_FALSE(verifier->Verify(signature, message).ok());
+  }
+}
+
+TEST_F(EcdsaSignBoringSslTest, testSignBatch) {
+  if (kUseOnlyFips && !FIPS_mode()) {
+    GTEST_SKIP()
+        << "Test is skipped if kOnlyUseFips but BoringCrypto is unavailable.";
+  }
+  subtle::EcdsaSignatureEncoding encodings[2] = {
+      EcdsaSignatureEncoding::DER, EcdsaSignatureEncoding::IEEE_P1363};
+  for (EcdsaSignatureEncoding encoding : encodings) {
+    auto ec_key = SubtleUtilBoringSSL::GetNewEcKey(EllipticCurveType::NIST_P256)
+                      .ValueOrDie();
+    auto signer_result =
+        EcdsaSignBoringSsl::New(ec_key, HashType::SHA256, encoding);
+    ASSERT_TRUE(signer_result.ok()) << signer_result.status();
+    auto signer = std::move(signer_result.ValueOrDie());
+    auto verifier_result =
+        EcdsaVerifyBoringSsl::New(ec_key, HashType::SHA256, encoding);
+    ASSERT_TRUE(verifier_result.ok()) << verifier_result.status();
+    auto verifier = std::move(verifier_result.ValueOrDie());
+
+    std::vector<std::string> messages;
+    for (int i = 0; i < 20; i++) messages.push_back(Random::GetRandomBytes(i));
+    std::vector<absl::string_view> data(messages.begin(), messages.end());
+    data.push_back(absl::string_view());
+    std::string arena;
+    std::vector<absl::string_view> signatures;
+    ASSERT_TRUE(signer->SignBatch(data, &arena, &signatures).ok());
+    ASSERT_EQ(signatures.size(), data.size());
+    for (size_t i = 0; i < data.size(); i++) {
+      auto status = verifier->Verify(signatures[i], data[i]);
+      EXPECT_TRUE(status.ok()) << status;
+    }
+
+    std::string prefix = "\x01\x02\x03\x04\x05";
+    ASSERT_TRUE(signer
+                    ->SignBatchWithPrefix(prefix, data, "suffix", &arena,
+                                          &signatures)
+                    .ok());
+    ASSERT_EQ(signatures.size(), data.size());
+    for (size_t i = 0; i < data.size(); i++) {
+      absl::string_view signature = signatures[i];
+      ASSERT_EQ(signature.substr(0, prefix.size()), prefix);
+      signature.remove_prefix(prefix.size());
+      auto status =
+          verifier->Verify(signature, absl::StrCat(data[i], "suffix"));
+      EXPECT_TRUE(status.ok()) << status;
+    }
+
+    // An empty batch.
+    ASSERT_TRUE(signer->SignBatch({}, &arena, &signatures).ok());
+    EXPECT_TRUE(arena.empty());
+    EXPECT_TRUE(signatures.empty());
+  }
+}
+
+TEST_F(EcdsaSignBoringSslTest, testStreamingSigning) {
+  if (kUseOnlyFips && !FIPS_mode()) {
+    GTEST_SKIP()
+        << "Test is skipped if kOnlyUseFips but BoringCrypto is unavailable.";
+  }
+  subtle::EcdsaSignatureEncoding encodings[2] = {
+      EcdsaSignatureEncoding::DER, EcdsaSignatureEncoding::IEEE_P1363};
+  for (EcdsaSignatureEncoding encoding : encodings) {
+    auto ec_key = SubtleUtilBoringSSL::GetNewEcKey(EllipticCurveType::NIST_P384)
+                      .ValueOrDie();
+    auto signer_result =
+        EcdsaSignBoringSsl::New(ec_key, HashType::SHA384, encoding);
+    ASSERT_TRUE(signer_result.ok()) << signer_result.status();
+    auto signer = std::move(signer_result.ValueOrDie());
+    auto verifier_result =
+        EcdsaVerifyBoringSsl::New(ec_key, HashType::SHA384, encoding);
+    ASSERT_TRUE(verifier_result.ok()) << verifier_result.status();
+    auto verifier = std::move(verifier_result.ValueOrDie());
+    std::string message = Random::GetRandomBytes(100000);
+
+    auto sign_stream_result = signer->NewSignOutputStream();
+    ASSERT_TRUE(sign_stream_result.ok()) << sign_stream_result.status();
+    auto sign_stream = std::move(sign_stream_result.ValueOrDie());
+    auto status = test::WriteToStream(sign_stream.get(), message);
+    ASSERT_TRUE(status.ok()) << status;
+    std::string signature = sign_stream->GetResult().ValueOrDie();
+    status = verifier->Verify(signature, message);
+    EXPECT_TRUE(status.ok()) << status;
+
+    signature = signer->Sign(message).ValueOrDie();
+    auto verify_stream_result = verifier->NewVerifyOutputStream(signature);
+    ASSERT_TRUE(verify_stream_result.ok()) << verify_stream_result.status();
+    status = test::WriteToStream(verify_stream_result.ValueOrDie().get(),
+                                 message);
+    EXPECT_TRUE(status.ok()) << status;
+
+    auto other_verify_stream_result =
+        verifier->NewVerifyOutputStream(signature);
+    ASSERT_TRUE(other_verify_stream_result.ok())
+        << other_verify_stream_result.status();
+    status = test::WriteToStream(
+        other_verify_stream_result.ValueOrDie().get(), "some bad message");
+    EXPECT_FALSE(status.ok());
+  }
+}
+
 TEST_F(EcdsaSignBoringSslTest, testEncodingsMismatch) {
   if (kUseOnlyFips && !FIPS_mode()) {
     GTEST_SKIP()
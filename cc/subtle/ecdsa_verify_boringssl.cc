@@ -16,13 +16,20 @@
 
 #include "tink/subtle/ecdsa_verify_boringssl.h"
 
+#include <string>
+#include <utility>
+#include <vector>
+
 #include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
 #include "openssl/bn.h"
+#include "openssl/digest.h"
 #include "openssl/ec.h"
 #include "openssl/ecdsa.h"
 #include "openssl/evp.h"
 #include "openssl/mem.h"
 #include "tink/subtle/common_enums.h"
+#include "tink/subtle/digest_output_stream.h"
 #include "tink/subtle/subtle_util_boringssl.h"
 #include "tink/util/errors.h"
 
@@ -76,6 +83,26 @@ util::StatusOr<std::unique_ptr<EcdsaVerifyBoringSsl>> EcdsaVerifyBoringSsl::New(
 
 util::Status EcdsaVerifyBoringSsl::Verify(absl::string_view signature,
                                           absl::string_view data) const {
+  bssl::ScopedEVP_MD_CTX md_ctx;
+  return VerifyWithContext(signature, data, md_ctx.get());
+}
+
+std::vector<util::Status> EcdsaVerifyBoringSsl::BatchVerify(
+    absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs)
+    const {
+  bssl::ScopedEVP_MD_CTX md_ctx;
+  std::vector<util::Status> results;
+  results.reserve(inputs.size());
+  for (const auto& input : inputs) {
+    results.push_back(VerifyWithContext(input.first, input.second,
+                                        md_ctx.get()));
+  }
+  return results;
+}
+
+util::Status EcdsaVerifyBoringSsl::VerifyWithContext(
+    absl::string_view signature, absl::string_view data,
+    EVP_MD_CTX* md_ctx) const {
   // BoringSSL expects a non-null pointer for data,
   // regardless of whether the size is 0.
   data = SubtleUtilBoringSSL::EnsureNonNull(data);
@@ -83,27 +110,57 @@ util::Status EcdsaVerifyBoringSsl::Verify(absl::string_view signature,
   // Compute the digest.
   unsigned int digest_size;
   uint8_t digest[EVP_MAX_MD_SIZE];
-  if (1 != EVP_Digest(data.data(), data.size(), digest, &digest_size, hash_,
-                      nullptr)) {
+  if (1 != EVP_DigestInit_ex(md_ctx, hash_, nullptr) ||
+      1 != EVP_DigestUpdate(md_ctx, data.data(), data.size()) ||
+      1 != EVP_DigestFinal_ex(md_ctx, digest, &digest_size)) {
     return util::Status(util::error::INTERNAL, "Could not compute digest.");
   }
+  return VerifyDigest(signature, absl::MakeConstSpan(digest, digest_size));
+}
+
+util::StatusOr<std::unique_ptr<OutputStreamWithResult<util::Status>>>
+EcdsaVerifyBoringSsl::NewVerifyOutputStream(
+    absl::string_view signature) const {
+  std::string signature_copy(signature);
+  return DigestOutputStream<util::Status>::New(
+      hash_, [this, signature_copy](absl::Span<const uint8_t> digest) {
+        return VerifyDigest(signature_copy, digest);
+      });
+}
 
-  std::string derSig(signature);
+util::Status EcdsaVerifyBoringSsl::VerifyDigest(
+    absl::string_view signature, absl::Span<const uint8_t> digest) const {
   if (encoding_ == subtle::EcdsaSignatureEncoding::IEEE_P1363) {
+    // The IEEE encoding is parsed directly, rather than converted to DER
+    // which ECDSA_verify() would then have to parse again.
     const EC_GROUP* group = EC_KEY_get0_group(key_.get());
-    auto status_or_der =
-        SubtleUtilBoringSSL::EcSignatureIeeeToDer(group, signature);
-
-    if (!status_or_der.ok()) {
-      return status_or_der.status();
+    size_t field_size_in_bytes = (EC_GROUP_get_degree(group) + 7) / 8;
+    if (signature.size() != field_size_in_bytes * 2) {
+      return util::Status(util::error::INVALID_ARGUMENT,
+                          "Signature is not valid.");
+    }
+    const uint8_t* sig_bytes =
+        reinterpret_cast<const uint8_t*>(signature.data());
+    // r and s are decoded into the BIGNUMs allocated by ECDSA_SIG_new().
+    bssl::UniquePtr<ECDSA_SIG> sig(ECDSA_SIG_new());
+    if (sig == nullptr ||
+        BN_bin2bn(sig_bytes, field_size_in_bytes, sig->r) == nullptr ||
+        BN_bin2bn(sig_bytes + field_size_in_bytes, field_size_in_bytes,
+                  sig->s) == nullptr) {
+      return util::Status(util::error::INTERNAL, "BN_bin2bn error.");
+    }
+    if (1 != ECDSA_do_verify(digest.data(), digest.size(), sig.get(),
+                             key_.get())) {
+      return util::Status(util::error::INVALID_ARGUMENT,
+                          "Signature is not valid.");
     }
-    derSig = status_or_der.ValueOrDie();
+    return util::Status::OK;
   }
 
   // Verify the signature.
-  if (1 != ECDSA_verify(0 /* unused */, digest, digest_size,
-                        reinterpret_cast<const uint8_t*>(derSig.data()),
-                        derSig.size(), key_.get())) {
+  if (1 != ECDSA_verify(0 /* unused */, digest.data(), digest.size(),
+                        reinterpret_cast<const uint8_t*>(signature.data()),
+                        signature.size(), key_.get())) {
     // signature is invalid
     return util::Status(util::error::INVALID_ARGUMENT,
                         "Signature is not valid.");
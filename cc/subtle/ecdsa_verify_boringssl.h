@@ -18,9 +18,13 @@
 #define TINK_SUBTLE_ECDSA_VERIFY_BORINGSSL_H_
 
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "tink/config/tink_fips.h"
+#include "tink/output_stream_with_result.h"
 #include "tink/subtle/common_enums.h"
 #include "tink/subtle/subtle_util_boringssl.h"
 #include "tink/public_key_verify.h"
@@ -33,6 +37,14 @@ namespace tink {
 namespace subtle {
 
 // ECDSA verification using Boring SSL, accepting signatures in DER-encoding.
+//
+// The public key is imported and validated once, in New(). The remaining
+// cost of Verify() is the scalar multiplication inside BoringSSL, whose
+// P-256 and P-384 implementations already use precomputed tables for the
+// generator. BoringSSL has no API for caching tables for the public point
+// between calls (EC_KEY_precompute_mult() is a no-op). Callers verifying
+// many signatures under the same keys should therefore keep the verifier
+// around, e.g. through a PrimitiveCache, rather than re-import the key.
 class EcdsaVerifyBoringSsl : public PublicKeyVerify {
  public:
   static crypto::tink::util::StatusOr<std::unique_ptr<EcdsaVerifyBoringSsl>>
@@ -48,6 +60,17 @@ class EcdsaVerifyBoringSsl : public PublicKeyVerify {
       absl::string_view signature,
       absl::string_view data) const override;
 
+  // Verifies all pairs with a single digest context, which saves its
+  // allocation per signature.
+  std::vector<crypto::tink::util::Status> BatchVerify(
+      absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs)
+      const override;
+
+  // Hashes the data as it is written, so only the digest is kept in memory.
+  crypto::tink::util::StatusOr<
+      std::unique_ptr<OutputStreamWithResult<crypto::tink::util::Status>>>
+  NewVerifyOutputStream(absl::string_view signature) const override;
+
   static constexpr crypto::tink::FipsCompatibility kFipsStatus =
       crypto::tink::FipsCompatibility::kRequiresBoringCrypto;
 
@@ -56,6 +79,15 @@ class EcdsaVerifyBoringSsl : public PublicKeyVerify {
                        EcdsaSignatureEncoding encoding)
       : key_(std::move(key)), hash_(hash), encoding_(encoding) {}
 
+  // Verify() using 'md_ctx' to compute the digest of 'data'.
+  crypto::tink::util::Status VerifyWithContext(absl::string_view signature,
+                                               absl::string_view data,
+                                               EVP_MD_CTX* md_ctx) const;
+
+  // Verifies 'signature' for the hash_ digest of the data.
+  crypto::tink::util::Status VerifyDigest(
+      absl::string_view signature, absl::Span<const uint8_t> digest) const;
+
   bssl::UniquePtr<EC_KEY> key_;
   const EVP_MD* hash_;  // Owned by BoringSSL.
   EcdsaSignatureEncoding encoding_;
@@ -18,6 +18,8 @@
 
 #include <iostream>
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "absl/strings/str_cat.h"
 #include "include/rapidjson/document.h"
@@ -84,6 +86,46 @@ TEST_F(EcdsaVerifyBoringSslTest, BasicSigning) {
   }
 }
 
+TEST_F(EcdsaVerifyBoringSslTest, BatchVerify) {
+  if (kUseOnlyFips && !FIPS_mode()) {
+    GTEST_SKIP()
+        << "Test is skipped if kOnlyUseFips but BoringCrypto is unavailable.";
+  }
+  subtle::EcdsaSignatureEncoding encodings[2] = {
+      EcdsaSignatureEncoding::DER, EcdsaSignatureEncoding::IEEE_P1363};
+  for (EcdsaSignatureEncoding encoding : encodings) {
+    auto ec_key_result =
+        SubtleUtilBoringSSL::GetNewEcKey(EllipticCurveType::NIST_P256);
+    ASSERT_TRUE(ec_key_result.ok()) << ec_key_result.status();
+    auto ec_key = std::move(ec_key_result.ValueOrDie());
+    auto signer = std::move(
+        EcdsaSignBoringSsl::New(ec_key, HashType::SHA256, encoding)
+            .ValueOrDie());
+    auto verifier = std::move(
+        EcdsaVerifyBoringSsl::New(ec_key, HashType::SHA256, encoding)
+            .ValueOrDie());
+
+    std::string message_0 = "some data to be signed";
+    std::string message_1 = "some other data to be signed";
+    std::string signature_0 = signer->Sign(message_0).ValueOrDie();
+    std::string signature_1 = signer->Sign(message_1).ValueOrDie();
+    std::vector<std::pair<absl::string_view, absl::string_view>> inputs = {
+        {signature_0, message_0},
+        {signature_0, message_1},
+        {signature_1, message_1},
+        {"some bad signature", message_0},
+        {signature_1, ""},
+    };
+    std::vector<util::Status> results = verifier->BatchVerify(inputs);
+    ASSERT_EQ(results.size(), inputs.size());
+    EXPECT_TRUE(results[0].ok()) << results[0];
+    EXPECT_THAT(results[1], StatusIs(util::error::INVALID_ARGUMENT));
+    EXPECT_TRUE(results[2].ok()) << results[2];
+    EXPECT_THAT(results[3], StatusIs(util::error::INVALID_ARGUMENT));
+    EXPECT_THAT(results[4], StatusIs(util::error::INVALID_ARGUMENT));
+  }
+}
+
 TEST_F(EcdsaVerifyBoringSslTest, EncodingsMismatch) {
   if (kUseOnlyFips && !FIPS_mode()) {
     GTEST_SKIP()
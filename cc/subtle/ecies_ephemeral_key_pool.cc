@@ -0,0 +1,174 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/subtle/ecies_ephemeral_key_pool.h"
+
+#include <atomic>
+#include <memory>
+#include <utility>
+
+#if !defined(_WIN32)
+#include <pthread.h>
+#endif
+
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+namespace {
+
+// Incremented in the child process after a fork(), so that the child
+// discards the keys copied from the parent instead of sending the same
+// ephemeral keys as the parent.
+std::atomic<uint64_t> fork_generation{0};
+
+void IncrementForkGeneration() {
+  fork_generation.fetch_add(1, std::memory_order_relaxed);
+}
+
+void RegisterForkHandler() {
+#if !defined(_WIN32)
+  static const bool registered =
+      pthread_atfork(nullptr, nullptr, &IncrementForkGeneration) == 0;
+  (void)registered;
+#endif
+}
+
+}  // namespace
+
+// static
+util::StatusOr<std::unique_ptr<EciesEphemeralKeyPool>>
+EciesEphemeralKeyPool::New(Generator generator, const Options& options) {
+  if (generator == nullptr) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "generator must be non-null");
+  }
+  if (options.depth <= 0) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "depth must be positive");
+  }
+  if (options.num_threads <= 0) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "num_threads must be positive");
+  }
+  RegisterForkHandler();
+  std::unique_ptr<EciesEphemeralKeyPool> pool(
+      new EciesEphemeralKeyPool(std::move(generator), options));
+  {
+    absl::MutexLock lock(&pool->mutex_);
+    pool->fork_generation_ = fork_generation.load(std::memory_order_relaxed);
+    pool->StartThreads();
+  }
+  return std::move(pool);
+}
+
+EciesEphemeralKeyPool::~EciesEphemeralKeyPool() {
+  std::unique_ptr<std::vector<std::thread>> threads;
+  {
+    absl::MutexLock lock(&mutex_);
+    stopped_ = true;
+    DiscardAfterFork();
+    threads = std::move(threads_);
+  }
+  for (std::thread& thread : *threads) thread.join();
+}
+
+util::StatusOr<EciesEphemeralKeyPool::EphemeralKey>
+EciesEphemeralKeyPool::Take() {
+  {
+    absl::MutexLock lock(&mutex_);
+    DiscardAfterFork();
+    if (!keys_.empty()) {
+      EphemeralKey key = std::move(keys_.front());
+      keys_.pop_front();
+      return std::move(key);
+    }
+  }
+  return generator_();
+}
+
+int EciesEphemeralKeyPool::size() const {
+  absl::MutexLock lock(&mutex_);
+  DiscardAfterFork();
+  return keys_.size();
+}
+
+bool EciesEphemeralKeyPool::WaitUntilFull(absl::Duration timeout) const {
+  absl::MutexLock lock(&mutex_);
+  DiscardAfterFork();
+  return mutex_.AwaitWithTimeout(
+      absl::Condition(this, &EciesEphemeralKeyPool::IsFull), timeout);
+}
+
+bool EciesEphemeralKeyPool::HasWork() const {
+  return stopped_ ||
+         static_cast<int>(keys_.size()) + in_flight_ < options_.depth;
+}
+
+bool EciesEphemeralKeyPool::IsFull() const {
+  return static_cast<int>(keys_.size()) >= options_.depth;
+}
+
+void EciesEphemeralKeyPool::StartThreads() const {
+  threads_ = absl::make_unique<std::vector<std::thread>>();
+  if (stopped_) return;
+  for (int i = 0; i < options_.num_threads; i++) {
+    threads_->emplace_back([this]() { Run(); });
+  }
+}
+
+void EciesEphemeralKeyPool::DiscardAfterFork() const {
+  uint64_t generation = fork_generation.load(std::memory_order_relaxed);
+  if (fork_generation_ == generation) return;
+  fork_generation_ = generation;
+  // Destroying the keys zeroizes their shared secrets. The keys being
+  // computed were computed by threads of the parent.
+  keys_.clear();
+  in_flight_ = 0;
+  // The threads of the parent do not exist in this process, and joining or
+  // detaching their handles is undefined, so the handles are leaked.
+  (void)threads_.release();
+  StartThreads();
+}
+
+void EciesEphemeralKeyPool::Run() const {
+  absl::MutexLock lock(&mutex_);
+  while (true) {
+    mutex_.Await(absl::Condition(this, &EciesEphemeralKeyPool::HasWork));
+    if (stopped_) return;
+    in_flight_++;
+    mutex_.Unlock();
+    auto key_result = generator_();
+    mutex_.Lock();
+    in_flight_--;
+    if (!key_result.ok()) {
+      mutex_.AwaitWithTimeout(absl::Condition(&stopped_),
+                              options_.retry_interval);
+      continue;
+    }
+    keys_.push_back(std::move(key_result.ValueOrDie()));
+  }
+}
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,128 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_SUBTLE_ECIES_EPHEMERAL_KEY_POOL_H_
+#define TINK_SUBTLE_ECIES_EPHEMERAL_KEY_POOL_H_
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+// Keeps ephemeral key agreements of an ECIES sender KEM ready, so that
+// encryption does not generate an ephemeral key pair and compute the shared
+// secret with the recipient's key on the calling thread. Background threads
+// keep up to 'depth' of them ready.
+//
+// Each ephemeral key is handed out once by Take(); its private key is not
+// kept, and the shared secret is zeroized when freed. If the pool is empty,
+// Take() computes a key agreement on the calling thread.
+//
+// After a fork(), the child process discards the keys it copied from the
+// parent, so that both do not send the same ephemeral keys, and starts its
+// own threads when the pool is next used.
+class EciesEphemeralKeyPool {
+ public:
+  struct Options {
+    // The number of key agreements kept ready.
+    int depth = 32;
+    // The number of threads computing them.
+    int num_threads = 1;
+    // The time a thread waits after a key agreement failed.
+    absl::Duration retry_interval = absl::Seconds(1);
+  };
+
+  // An ephemeral public key and the secret it shares with the recipient.
+  struct EphemeralKey {
+    // For NIST curves, the public point in uncompressed encoding.
+    std::string public_value;
+    util::SecretData shared_secret;
+  };
+
+  // Computes a fresh key agreement. Must be thread-safe.
+  using Generator = std::function<util::StatusOr<EphemeralKey>()>;
+
+  // Returns a pool of the keys from 'generator', which starts computing them
+  // right away.
+  static crypto::tink::util::StatusOr<std::unique_ptr<EciesEphemeralKeyPool>>
+  New(Generator generator, const Options& options);
+
+  EciesEphemeralKeyPool(const EciesEphemeralKeyPool&) = delete;
+  EciesEphemeralKeyPool& operator=(const EciesEphemeralKeyPool&) = delete;
+
+  // Stops the threads, and zeroizes the keys which are still ready.
+  ~EciesEphemeralKeyPool() ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns a ready key, or a new one if none is ready. Thread-safe.
+  crypto::tink::util::StatusOr<EphemeralKey> Take()
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Returns the number of ready keys.
+  int size() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Waits until 'depth' keys are ready. Returns false on timeout.
+  bool WaitUntilFull(absl::Duration timeout) const ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  EciesEphemeralKeyPool(Generator generator, const Options& options)
+      : generator_(std::move(generator)), options_(options) {}
+
+  bool HasWork() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  bool IsFull() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Starts the threads computing keys, unless the pool is stopped.
+  void StartThreads() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  // If the process was forked since the threads were started, zeroizes the
+  // ready keys, and starts new threads.
+  void DiscardAfterFork() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  void Run() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+  const Generator generator_;
+  const Options options_;
+
+  mutable absl::Mutex mutex_;
+  // The members below are mutable, as every method discards the state
+  // copied from the parent process after a fork().
+  mutable std::deque<EphemeralKey> keys_ ABSL_GUARDED_BY(mutex_);
+  // The number of keys being computed.
+  mutable int in_flight_ ABSL_GUARDED_BY(mutex_) = 0;
+  bool stopped_ ABSL_GUARDED_BY(mutex_) = false;
+  // The fork generation in which threads_ were started.
+  mutable uint64_t fork_generation_ ABSL_GUARDED_BY(mutex_) = 0;
+  mutable std::unique_ptr<std::vector<std::thread>> threads_
+      ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_SUBTLE_ECIES_EPHEMERAL_KEY_POOL_H_
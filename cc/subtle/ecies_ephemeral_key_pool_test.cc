@@ -0,0 +1,207 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/subtle/ecies_ephemeral_key_pool.h"
+
+#include <atomic>
+#include <memory>
+#include <set>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#if !defined(_WIN32)
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/test_matchers.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+namespace {
+
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+
+// Returns keys with the public values "0", "1", ....
+EciesEphemeralKeyPool::Generator CountingGenerator(std::atomic<int>* count) {
+  return [count]() -> util::StatusOr<EciesEphemeralKeyPool::EphemeralKey> {
+    EciesEphemeralKeyPool::EphemeralKey key;
+    key.public_value = absl::StrCat(count->fetch_add(1));
+    key.shared_secret = util::SecretDataFromStringView("secret");
+    return std::move(key);
+  };
+}
+
+TEST(EciesEphemeralKeyPoolTest, FillsToDepth) {
+  std::atomic<int> count(0);
+  EciesEphemeralKeyPool::Options options;
+  options.depth = 5;
+  options.num_threads = 2;
+  auto pool_result =
+      EciesEphemeralKeyPool::New(CountingGenerator(&count), options);
+  ASSERT_THAT(pool_result.status(), IsOk());
+  auto pool = std::move(pool_result.ValueOrDie());
+  ASSERT_TRUE(pool->WaitUntilFull(absl::Seconds(10)));
+  EXPECT_EQ(pool->size(), 5);
+  EXPECT_EQ(count.load(), 5);
+
+  auto key_result = pool->Take();
+  ASSERT_THAT(key_result.status(), IsOk());
+  EXPECT_EQ(util::SecretDataAsStringView(
+                key_result.ValueOrDie().shared_secret),
+            "secret");
+  // The pool is refilled.
+  ASSERT_TRUE(pool->WaitUntilFull(absl::Seconds(10)));
+  EXPECT_EQ(count.load(), 6);
+}
+
+TEST(EciesEphemeralKeyPoolTest, KeysAreTakenOnce) {
+  std::atomic<int> count(0);
+  EciesEphemeralKeyPool::Options options;
+  options.depth = 4;
+  auto pool_result =
+      EciesEphemeralKeyPool::New(CountingGenerator(&count), options);
+  ASSERT_THAT(pool_result.status(), IsOk());
+  auto pool = std::move(pool_result.ValueOrDie());
+
+  const int kNumThreads = 4;
+  const int kKeysPerThread = 50;
+  absl::Mutex mutex;
+  std::set<std::string> public_values;
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; i++) {
+    threads.emplace_back([&]() {
+      for (int j = 0; j < kKeysPerThread; j++) {
+        auto key_result = pool->Take();
+        ASSERT_THAT(key_result.status(), IsOk());
+        absl::MutexLock lock(&mutex);
+        EXPECT_TRUE(
+            public_values.insert(key_result.ValueOrDie().public_value).second);
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  EXPECT_EQ(public_values.size(), kNumThreads * kKeysPerThread);
+}
+
+TEST(EciesEphemeralKeyPoolTest, FailingGenerator) {
+  EciesEphemeralKeyPool::Options options;
+  options.retry_interval = absl::Milliseconds(1);
+  auto pool_result = EciesEphemeralKeyPool::New(
+      []() -> util::StatusOr<EciesEphemeralKeyPool::EphemeralKey> {
+        return util::Status(util::error::INTERNAL, "keygen failed");
+      },
+      options);
+  ASSERT_THAT(pool_result.status(), IsOk());
+  EXPECT_THAT(pool_result.ValueOrDie()->Take().status(),
+              StatusIs(util::error::INTERNAL));
+  EXPECT_EQ(pool_result.ValueOrDie()->size(), 0);
+}
+
+#if !defined(_WIN32)
+TEST(EciesEphemeralKeyPoolTest, ForkedProcessesTakeDistinctKeys) {
+  std::atomic<int> count(0);
+  EciesEphemeralKeyPool::Options options;
+  options.depth = 4;
+  // The public values name the process which computed them, as the counter
+  // is copied into the child.
+  auto pool_result = EciesEphemeralKeyPool::New(
+      [&count]() -> util::StatusOr<EciesEphemeralKeyPool::EphemeralKey> {
+        EciesEphemeralKeyPool::EphemeralKey key;
+        key.public_value = absl::StrCat(getpid(), ":", count.fetch_add(1));
+        key.shared_secret = util::SecretDataFromStringView("secret");
+        return std::move(key);
+      },
+      options);
+  ASSERT_THAT(pool_result.status(), IsOk());
+  auto pool = std::move(pool_result.ValueOrDie());
+  // The threads wait without holding the pool's mutex while it is full.
+  ASSERT_TRUE(pool->WaitUntilFull(absl::Seconds(10)));
+
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+  pid_t pid = fork();
+  ASSERT_GE(pid, 0);
+  if (pid == 0) {
+    close(fds[0]);
+    // The keys copied from the parent are gone, so the key is computed in
+    // the child.
+    int exit_code = 1;
+    if (pool->size() == 0) {
+      auto key_result = pool->Take();
+      if (key_result.ok()) {
+        const std::string& public_value = key_result.ValueOrDie().public_value;
+        if (write(fds[1], public_value.data(), public_value.size()) ==
+            static_cast<ssize_t>(public_value.size())) {
+          exit_code = 0;
+        }
+      }
+    }
+    _exit(exit_code);
+  }
+  close(fds[1]);
+  std::string child_value;
+  char buffer[64];
+  ssize_t read_size;
+  while ((read_size = read(fds[0], buffer, sizeof(buffer))) > 0) {
+    child_value.append(buffer, read_size);
+  }
+  close(fds[0]);
+  int status;
+  ASSERT_EQ(waitpid(pid, &status, 0), pid);
+  ASSERT_TRUE(WIFEXITED(status));
+  ASSERT_EQ(WEXITSTATUS(status), 0);
+
+  EXPECT_EQ(child_value.substr(0, child_value.find(':')),
+            absl::StrCat(pid));
+  for (int i = 0; i < options.depth; i++) {
+    auto key_result = pool->Take();
+    ASSERT_THAT(key_result.status(), IsOk());
+    EXPECT_NE(key_result.ValueOrDie().public_value, child_value);
+  }
+}
+#endif
+
+TEST(EciesEphemeralKeyPoolTest, InvalidOptions) {
+  std::atomic<int> count(0);
+  EXPECT_THAT(EciesEphemeralKeyPool::New(nullptr, {}).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EciesEphemeralKeyPool::Options options;
+  options.depth = 0;
+  EXPECT_THAT(
+      EciesEphemeralKeyPool::New(CountingGenerator(&count), options).status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+  options.depth = 1;
+  options.num_threads = 0;
+  EXPECT_THAT(
+      EciesEphemeralKeyPool::New(CountingGenerator(&count), options).status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
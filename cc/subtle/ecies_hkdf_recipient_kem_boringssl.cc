@@ -59,10 +59,8 @@ EciesHkdfNistPCurveRecipientKemBoringSsl::New(EllipticCurveType curve,
   if (priv_key.empty()) {
     return util::Status(util::error::INVALID_ARGUMENT, "empty priv_key");
   }
-  auto status_or_ec_group = SubtleUtilBoringSSL::GetEcGroup(curve);
+  auto status_or_ec_group = SubtleUtilBoringSSL::GetStaticEcGroup(curve);
   if (!status_or_ec_group.ok()) return status_or_ec_group.status();
-  // TODO(przydatek): consider refactoring SubtleUtilBoringSSL,
-  //     so that the saved group can be used for KEM operations.
   return {absl::WrapUnique(new EciesHkdfNistPCurveRecipientKemBoringSsl(
       curve, std::move(priv_key), status_or_ec_group.ValueOrDie()))};
 }
@@ -70,7 +68,7 @@ EciesHkdfNistPCurveRecipientKemBoringSsl::New(EllipticCurveType curve,
 EciesHkdfNistPCurveRecipientKemBoringSsl::
     EciesHkdfNistPCurveRecipientKemBoringSsl(EllipticCurveType curve,
                                              util::SecretData priv_key_value,
-                                             EC_GROUP* ec_group)
+                                             const EC_GROUP* ec_group)
     : curve_(curve),
       priv_key_value_(std::move(priv_key_value)),
       ec_group_(ec_group) {}
@@ -74,11 +74,12 @@ class EciesHkdfNistPCurveRecipientKemBoringSsl
  private:
   EciesHkdfNistPCurveRecipientKemBoringSsl(EllipticCurveType curve,
                                            util::SecretData priv_key_value,
-                                           EC_GROUP* ec_group);
+                                           const EC_GROUP* ec_group);
 
   EllipticCurveType curve_;
   util::SecretData priv_key_value_;
-  bssl::UniquePtr<EC_GROUP> ec_group_;
+  // The process-wide group of 'curve_', not owned.
+  const EC_GROUP* ec_group_;
 };
 
 // Implementation of EciesHkdfRecipientKemBoringSsl for curve25519.
@@ -16,10 +16,15 @@
 
 #include "tink/subtle/ecies_hkdf_sender_kem_boringssl.h"
 
+#include <string>
+#include <utility>
+
 #include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
 #include "openssl/bn.h"
 #include "openssl/curve25519.h"
 #include "tink/subtle/common_enums.h"
+#include "tink/subtle/ecies_ephemeral_key_pool.h"
 #include "tink/subtle/hkdf.h"
 #include "tink/subtle/subtle_util_boringssl.h"
 
@@ -27,6 +32,31 @@ namespace crypto {
 namespace tink {
 namespace subtle {
 
+namespace {
+
+// Converts the uncompressed encoding 0x04 || x || y of a point to 'format',
+// like SubtleUtilBoringSSL::EcPointEncode().
+util::StatusOr<std::string> EncodeUncompressedPoint(
+    absl::string_view uncompressed, EcPointFormat format) {
+  size_t coordinate_size = (uncompressed.size() - 1) / 2;
+  absl::string_view x = uncompressed.substr(1, coordinate_size);
+  switch (format) {
+    case EcPointFormat::UNCOMPRESSED:
+      return std::string(uncompressed);
+    case EcPointFormat::DO_NOT_USE_CRUNCHY_UNCOMPRESSED:
+      return std::string(uncompressed.substr(1));
+    case EcPointFormat::COMPRESSED: {
+      // The prefix is 0x02 for even y and 0x03 for odd y.
+      char prefix = 0x02 | (uncompressed.back() & 1);
+      return absl::StrCat(absl::string_view(&prefix, 1), x);
+    }
+    default:
+      return util::Status(util::error::INTERNAL, "Unsupported point format");
+  }
+}
+
+}  // namespace
+
 // static
 util::StatusOr<std::unique_ptr<const EciesHkdfSenderKemBoringSsl>>
 EciesHkdfSenderKemBoringSsl::New(subtle::EllipticCurveType curve,
@@ -45,45 +75,69 @@ EciesHkdfSenderKemBoringSsl::New(subtle::EllipticCurveType curve,
   }
 }
 
+// static
+util::StatusOr<std::unique_ptr<const EciesHkdfSenderKemBoringSsl>>
+EciesHkdfSenderKemBoringSsl::NewWithKeyPool(
+    subtle::EllipticCurveType curve, const std::string& pubx,
+    const std::string& puby,
+    const EciesEphemeralKeyPool::Options& pool_options) {
+  switch (curve) {
+    case EllipticCurveType::NIST_P256:
+    case EllipticCurveType::NIST_P384:
+    case EllipticCurveType::NIST_P521:
+      return EciesHkdfNistPCurveSendKemBoringSsl::New(curve, pubx, puby,
+                                                      &pool_options);
+    case EllipticCurveType::CURVE25519:
+      return EciesHkdfX25519SendKemBoringSsl::New(curve, pubx, puby,
+                                                  &pool_options);
+    default:
+      return util::Status(util::error::UNIMPLEMENTED,
+                          "Unsupported elliptic curve");
+  }
+}
+
 EciesHkdfNistPCurveSendKemBoringSsl::EciesHkdfNistPCurveSendKemBoringSsl(
     subtle::EllipticCurveType curve, const std::string& pubx,
-    const std::string& puby, EC_POINT* peer_pub_key)
-    : curve_(curve), pubx_(pubx), puby_(puby), peer_pub_key_(peer_pub_key) {}
+    const std::string& puby, const EC_GROUP* group, EC_POINT* peer_pub_key)
+    : curve_(curve),
+      pubx_(pubx),
+      puby_(puby),
+      group_(group),
+      peer_pub_key_(peer_pub_key) {}
 
 // static
 util::StatusOr<std::unique_ptr<const EciesHkdfSenderKemBoringSsl>>
-EciesHkdfNistPCurveSendKemBoringSsl::New(subtle::EllipticCurveType curve,
-                                         const std::string& pubx,
-                                         const std::string& puby) {
+EciesHkdfNistPCurveSendKemBoringSsl::New(
+    subtle::EllipticCurveType curve, const std::string& pubx,
+    const std::string& puby,
+    const EciesEphemeralKeyPool::Options* pool_options) {
   auto status = CheckFipsCompatibility<EciesHkdfNistPCurveSendKemBoringSsl>();
   if (!status.ok()) return status;
 
+  auto status_or_ec_group = SubtleUtilBoringSSL::GetStaticEcGroup(curve);
+  if (!status_or_ec_group.ok()) return status_or_ec_group.status();
   auto status_or_ec_point =
       SubtleUtilBoringSSL::GetEcPoint(curve, pubx, puby);
   if (!status_or_ec_point.ok()) return status_or_ec_point.status();
-  std::unique_ptr<const EciesHkdfSenderKemBoringSsl> sender_kem(
-      new EciesHkdfNistPCurveSendKemBoringSsl(curve, pubx, puby,
-                                              status_or_ec_point.ValueOrDie()));
-  return std::move(sender_kem);
-}
-
-util::StatusOr<std::unique_ptr<const EciesHkdfSenderKemBoringSsl::KemKey>>
-EciesHkdfNistPCurveSendKemBoringSsl::GenerateKey(
-    subtle::HashType hash, absl::string_view hkdf_salt,
-    absl::string_view hkdf_info, uint32_t key_size_in_bytes,
-    subtle::EcPointFormat point_format) const {
-  if (peer_pub_key_.get() == nullptr) {
-    return util::Status(util::error::INTERNAL,
-                        "peer_pub_key_ wasn't initialized");
+  std::unique_ptr<EciesHkdfNistPCurveSendKemBoringSsl> sender_kem(
+      new EciesHkdfNistPCurveSendKemBoringSsl(
+          curve, pubx, puby, status_or_ec_group.ValueOrDie(),
+          status_or_ec_point.ValueOrDie()));
+  if (pool_options != nullptr) {
+    EciesHkdfNistPCurveSendKemBoringSsl* kem = sender_kem.get();
+    auto pool_result = EciesEphemeralKeyPool::New(
+        [kem]() { return kem->NewEphemeralKey(); }, *pool_options);
+    if (!pool_result.ok()) return pool_result.status();
+    sender_kem->key_pool_ = std::move(pool_result.ValueOrDie());
   }
+  return std::unique_ptr<const EciesHkdfSenderKemBoringSsl>(
+      std::move(sender_kem));
+}
 
-  auto status_or_ec_group = SubtleUtilBoringSSL::GetEcGroup(curve_);
-  if (!status_or_ec_group.ok()) {
-    return status_or_ec_group.status();
-  }
-  bssl::UniquePtr<EC_GROUP> group(status_or_ec_group.ValueOrDie());
+util::StatusOr<EciesEphemeralKeyPool::EphemeralKey>
+EciesHkdfNistPCurveSendKemBoringSsl::NewEphemeralKey() const {
   bssl::UniquePtr<EC_KEY> ephemeral_key(EC_KEY_new());
-  if (1 != EC_KEY_set_group(ephemeral_key.get(), group.get())) {
+  if (1 != EC_KEY_set_group(ephemeral_key.get(), group_)) {
     return util::Status(util::error::INTERNAL, "EC_KEY_set_group failed");
   }
   if (1 != EC_KEY_generate_key(ephemeral_key.get())) {
@@ -91,21 +145,53 @@ EciesHkdfNistPCurveSendKemBoringSsl::GenerateKey(
   }
   const BIGNUM* ephemeral_priv = EC_KEY_get0_private_key(ephemeral_key.get());
   const EC_POINT* ephemeral_pub = EC_KEY_get0_public_key(ephemeral_key.get());
-  auto status_or_string_kem =
-      SubtleUtilBoringSSL::EcPointEncode(curve_, point_format, ephemeral_pub);
+  auto status_or_string_kem = SubtleUtilBoringSSL::EcPointEncode(
+      curve_, EcPointFormat::UNCOMPRESSED, ephemeral_pub);
   if (!status_or_string_kem.ok()) {
     return status_or_string_kem.status();
   }
-  std::string kem_bytes = status_or_string_kem.ValueOrDie();
   auto status_or_string_shared_secret =
       SubtleUtilBoringSSL::ComputeEcdhSharedSecret(curve_, ephemeral_priv,
                                                    peer_pub_key_.get());
   if (!status_or_string_shared_secret.ok()) {
     return status_or_string_shared_secret.status();
   }
-  util::SecretData shared_secret = status_or_string_shared_secret.ValueOrDie();
+  EciesEphemeralKeyPool::EphemeralKey key;
+  key.public_value = std::move(status_or_string_kem.ValueOrDie());
+  key.shared_secret = std::move(status_or_string_shared_secret.ValueOrDie());
+  return std::move(key);
+}
+
+util::StatusOr<std::unique_ptr<const EciesHkdfSenderKemBoringSsl::KemKey>>
+EciesHkdfNistPCurveSendKemBoringSsl::GenerateKey(
+    subtle::HashType hash, absl::string_view hkdf_salt,
+    absl::string_view hkdf_info, uint32_t key_size_in_bytes,
+    subtle::EcPointFormat point_format) const {
+  if (peer_pub_key_.get() == nullptr) {
+    return util::Status(util::error::INTERNAL,
+                        "peer_pub_key_ wasn't initialized");
+  }
+
+  // Rejects unsupported formats before an ephemeral key is used up.
+  if (point_format != EcPointFormat::UNCOMPRESSED &&
+      point_format != EcPointFormat::DO_NOT_USE_CRUNCHY_UNCOMPRESSED &&
+      point_format != EcPointFormat::COMPRESSED) {
+    return util::Status(util::error::INTERNAL, "Unsupported point format");
+  }
+  auto ephemeral_key_result =
+      key_pool_ != nullptr ? key_pool_->Take() : NewEphemeralKey();
+  if (!ephemeral_key_result.ok()) return ephemeral_key_result.status();
+  EciesEphemeralKeyPool::EphemeralKey ephemeral_key =
+      std::move(ephemeral_key_result.ValueOrDie());
+  auto status_or_string_kem =
+      EncodeUncompressedPoint(ephemeral_key.public_value, point_format);
+  if (!status_or_string_kem.ok()) {
+    return status_or_string_kem.status();
+  }
+  std::string kem_bytes = std::move(status_or_string_kem.ValueOrDie());
   auto symmetric_key_or = Hkdf::ComputeEciesHkdfSymmetricKey(
-      hash, kem_bytes, shared_secret, hkdf_salt, hkdf_info, key_size_in_bytes);
+      hash, kem_bytes, ephemeral_key.shared_secret, hkdf_salt, hkdf_info,
+      key_size_in_bytes);
   if (!symmetric_key_or.ok()) {
     return symmetric_key_or.status();
   }
@@ -122,9 +208,10 @@ EciesHkdfX25519SendKemBoringSsl::EciesHkdfX25519SendKemBoringSsl(
 
 // static
 util::StatusOr<std::unique_ptr<const EciesHkdfSenderKemBoringSsl>>
-EciesHkdfX25519SendKemBoringSsl::New(subtle::EllipticCurveType curve,
-                                     const std::string& pubx,
-                                     const std::string& puby) {
+EciesHkdfX25519SendKemBoringSsl::New(
+    subtle::EllipticCurveType curve, const std::string& pubx,
+    const std::string& puby,
+    const EciesEphemeralKeyPool::Options* pool_options) {
   auto status = CheckFipsCompatibility<EciesHkdfX25519SendKemBoringSsl>();
   if (!status.ok()) return status;
 
@@ -139,9 +226,47 @@ EciesHkdfX25519SendKemBoringSsl::New(subtle::EllipticCurveType curve,
   if (!puby.empty()) {
     return util::Status(util::error::INVALID_ARGUMENT, "puby is not empty");
   }
-  std::unique_ptr<const EciesHkdfSenderKemBoringSsl> sender_kem(
+  // X25519 gives an all-zero shared secret with a point of small order,
+  // whatever the ephemeral key. Such points are rejected once here, so that
+  // the shared secrets of GenerateKey() need not be checked.
+  util::SecretData probe_private_key(X25519_PRIVATE_KEY_LEN);
+  uint8_t probe_public_value[X25519_PUBLIC_VALUE_LEN];
+  X25519_keypair(probe_public_value, probe_private_key.data());
+  util::SecretData probe_shared_secret(X25519_SHARED_KEY_LEN);
+  if (X25519(probe_shared_secret.data(), probe_private_key.data(),
+             reinterpret_cast<const uint8_t*>(pubx.data())) != 1) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "pubx is a point of small order");
+  }
+  std::unique_ptr<EciesHkdfX25519SendKemBoringSsl> sender_kem(
       new EciesHkdfX25519SendKemBoringSsl(pubx));
-  return std::move(sender_kem);
+  if (pool_options != nullptr) {
+    EciesHkdfX25519SendKemBoringSsl* kem = sender_kem.get();
+    auto pool_result = EciesEphemeralKeyPool::New(
+        [kem]()
+            -> util::StatusOr<EciesEphemeralKeyPool::EphemeralKey> {
+          return kem->NewEphemeralKey();
+        },
+        *pool_options);
+    if (!pool_result.ok()) return pool_result.status();
+    sender_kem->key_pool_ = std::move(pool_result.ValueOrDie());
+  }
+  return std::unique_ptr<const EciesHkdfSenderKemBoringSsl>(
+      std::move(sender_kem));
+}
+
+EciesEphemeralKeyPool::EphemeralKey
+EciesHkdfX25519SendKemBoringSsl::NewEphemeralKey() const {
+  util::SecretData ephemeral_private_key(X25519_PRIVATE_KEY_LEN);
+  EciesEphemeralKeyPool::EphemeralKey key;
+  key.public_value.resize(X25519_PUBLIC_VALUE_LEN);
+  // Computes the public value with the precomputed table of the base point.
+  X25519_keypair(reinterpret_cast<uint8_t*>(&key.public_value[0]),
+                 ephemeral_private_key.data());
+  key.shared_secret.resize(X25519_SHARED_KEY_LEN);
+  X25519(key.shared_secret.data(), ephemeral_private_key.data(),
+         peer_public_value_);
+  return key;
 }
 
 util::StatusOr<std::unique_ptr<const EciesHkdfSenderKemBoringSsl::KemKey>>
@@ -155,22 +280,23 @@ EciesHkdfX25519SendKemBoringSsl::GenerateKey(
         "X25519 only supports compressed elliptic curve points");
   }
 
-  util::SecretData ephemeral_private_key(X25519_PRIVATE_KEY_LEN);
-  std::string kem_bytes(X25519_PUBLIC_VALUE_LEN, '\0');
-  X25519_keypair(reinterpret_cast<uint8_t*>(&kem_bytes[0]),
-                 ephemeral_private_key.data());
-
-  util::SecretData shared_secret(X25519_SHARED_KEY_LEN);
-  X25519(shared_secret.data(), ephemeral_private_key.data(),
-         peer_public_value_);
-
+  EciesEphemeralKeyPool::EphemeralKey ephemeral_key;
+  if (key_pool_ != nullptr) {
+    auto ephemeral_key_result = key_pool_->Take();
+    if (!ephemeral_key_result.ok()) return ephemeral_key_result.status();
+    ephemeral_key = std::move(ephemeral_key_result.ValueOrDie());
+  } else {
+    ephemeral_key = NewEphemeralKey();
+  }
   auto symmetric_key_or = Hkdf::ComputeEciesHkdfSymmetricKey(
-      hash, kem_bytes, shared_secret, hkdf_salt, hkdf_info, key_size_in_bytes);
+      hash, ephemeral_key.public_value, ephemeral_key.shared_secret,
+      hkdf_salt, hkdf_info, key_size_in_bytes);
   if (!symmetric_key_or.ok()) {
     return symmetric_key_or.status();
   }
-  util::SecretData symmetric_key = symmetric_key_or.ValueOrDie();
-  return absl::make_unique<const KemKey>(kem_bytes, symmetric_key);
+  return absl::make_unique<const KemKey>(
+      std::move(ephemeral_key.public_value),
+      std::move(symmetric_key_or.ValueOrDie()));
 }
 
 }  // namespace subtle
@@ -17,11 +17,15 @@
 #ifndef TINK_SUBTLE_ECIES_HKDF_SENDER_KEM_BORINGSSL_H_
 #define TINK_SUBTLE_ECIES_HKDF_SENDER_KEM_BORINGSSL_H_
 
+#include <memory>
+#include <string>
+
 #include "absl/strings/string_view.h"
 #include "openssl/curve25519.h"
 #include "openssl/ec.h"
 #include "tink/config/tink_fips.h"
 #include "tink/subtle/common_enums.h"
+#include "tink/subtle/ecies_ephemeral_key_pool.h"
 #include "tink/util/secret_data.h"
 #include "tink/util/statusor.h"
 
@@ -57,6 +61,18 @@ class EciesHkdfSenderKemBoringSsl {
   New(EllipticCurveType curve, const std::string& pubx,
       const std::string& puby);
 
+  // Like New(), but the KEM computes its ephemeral keys and their shared
+  // secrets ahead of time, on the threads of an EciesEphemeralKeyPool with
+  // 'pool_options'. Unlike other Tink primitives, such a KEM thus starts
+  // 'pool_options.num_threads' background threads, which run until it is
+  // destroyed; callers which must not have threads started for them should
+  // use New().
+  static crypto::tink::util::StatusOr<
+      std::unique_ptr<const EciesHkdfSenderKemBoringSsl>>
+  NewWithKeyPool(EllipticCurveType curve, const std::string& pubx,
+                 const std::string& puby,
+                 const EciesEphemeralKeyPool::Options& pool_options);
+
   // Generates ephemeral key pairs, computes ECDH's shared secret based on
   // generated ephemeral key and recipient's public key, then uses HKDF
   // to derive the symmetric key from the shared secret, 'hkdf_info' and
@@ -74,10 +90,12 @@ class EciesHkdfNistPCurveSendKemBoringSsl : public EciesHkdfSenderKemBoringSsl {
  public:
   // Constructs a sender KEM for the specified curve and recipient's
   // public key point.  The public key's coordinates are big-endian byte array.
+  // If 'pool_options' is non-null, ephemeral keys are computed ahead of time.
   static crypto::tink::util::StatusOr<
       std::unique_ptr<const EciesHkdfSenderKemBoringSsl>>
   New(EllipticCurveType curve, const std::string& pubx,
-      const std::string& puby);
+      const std::string& puby,
+      const EciesEphemeralKeyPool::Options* pool_options = nullptr);
 
   // Generates ephemeral key pairs, computes ECDH's shared secret based on
   // generated ephemeral key and recipient's public key, then uses HKDF
@@ -91,15 +109,26 @@ class EciesHkdfNistPCurveSendKemBoringSsl : public EciesHkdfSenderKemBoringSsl {
       crypto::tink::FipsCompatibility::kNotFips;
 
  private:
+  // Generates an ephemeral key pair and computes its shared secret with the
+  // recipient's key.
+  crypto::tink::util::StatusOr<EciesEphemeralKeyPool::EphemeralKey>
+  NewEphemeralKey() const;
+
   EciesHkdfNistPCurveSendKemBoringSsl(EllipticCurveType curve,
                                       const std::string& pubx,
                                       const std::string& puby,
+                                      const EC_GROUP* group,
                                       EC_POINT* peer_pub_key);
 
   EllipticCurveType curve_;
   std::string pubx_;
   std::string puby_;
+  // The process-wide group of 'curve_', not owned.
+  const EC_GROUP* group_;
   bssl::UniquePtr<EC_POINT> peer_pub_key_;
+  // Declared last, so that its threads stop before the other members are
+  // destroyed. May be null.
+  std::unique_ptr<EciesEphemeralKeyPool> key_pool_;
 };
 
 // Implementation of EciesHkdfSenderKemBoringSsl for curve25519.
@@ -107,10 +136,12 @@ class EciesHkdfX25519SendKemBoringSsl : public EciesHkdfSenderKemBoringSsl {
  public:
   // Constructs a sender KEM for the specified curve and recipient's
   // public key point.  The public key's coordinates are big-endian byte array.
+  // If 'pool_options' is non-null, ephemeral keys are computed ahead of time.
   static crypto::tink::util::StatusOr<
       std::unique_ptr<const EciesHkdfSenderKemBoringSsl>>
   New(EllipticCurveType curve, const std::string& pubx,
-      const std::string& puby);
+      const std::string& puby,
+      const EciesEphemeralKeyPool::Options* pool_options = nullptr);
 
   // Generates ephemeral key pairs, computes ECDH's shared secret based on
   // generated ephemeral key and recipient's public key, then uses HKDF
@@ -127,7 +158,14 @@ class EciesHkdfX25519SendKemBoringSsl : public EciesHkdfSenderKemBoringSsl {
   explicit EciesHkdfX25519SendKemBoringSsl(
       const std::string& peer_public_value);
 
+  // Generates an ephemeral key pair and computes its shared secret with the
+  // recipient's key.
+  EciesEphemeralKeyPool::EphemeralKey NewEphemeralKey() const;
+
   uint8_t peer_public_value_[X25519_PUBLIC_VALUE_LEN];
+  // Declared last, so that its threads stop before the other members are
+  // destroyed. May be null.
+  std::unique_ptr<EciesEphemeralKeyPool> key_pool_;
 };
 
 }  // namespace subtle
@@ -17,9 +17,13 @@
 #include "tink/subtle/ecies_hkdf_sender_kem_boringssl.h"
 
 #include <iostream>
+#include <set>
+#include <string>
+#include <vector>
 
 #include "gtest/gtest.h"
 #include "tink/subtle/common_enums.h"
+#include "tink/subtle/ecies_ephemeral_key_pool.h"
 #include "tink/subtle/ecies_hkdf_recipient_kem_boringssl.h"
 #include "tink/subtle/subtle_util_boringssl.h"
 #include "tink/util/secret_data.h"
@@ -107,6 +111,72 @@ TEST_F(EciesHkdfSenderKemBoringSslTest, TestSenderRecipientBasic) {
   }
 }
 
+TEST_F(EciesHkdfSenderKemBoringSslTest, TestSenderRecipientWithKeyPool) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  std::vector<TestVector> tests = test_vector;
+  tests.push_back({EllipticCurveType::NIST_P384, HashType::SHA512,
+                   EcPointFormat::DO_NOT_USE_CRUNCHY_UNCOMPRESSED, "0b0b0b0b",
+                   "0b0b0b0b0b0b0b0b", 32});
+  tests.push_back({EllipticCurveType::NIST_P521, HashType::SHA256,
+                   EcPointFormat::COMPRESSED, "", "", 16});
+  EciesEphemeralKeyPool::Options pool_options;
+  pool_options.depth = 4;
+  for (const TestVector& test : tests) {
+    auto status_or_test_key = SubtleUtilBoringSSL::GetNewEcKey(test.curve);
+    ASSERT_TRUE(status_or_test_key.ok());
+    auto test_key = status_or_test_key.ValueOrDie();
+    auto status_or_sender_kem = EciesHkdfSenderKemBoringSsl::NewWithKeyPool(
+        test.curve, test_key.pub_x, test_key.pub_y, pool_options);
+    ASSERT_TRUE(status_or_sender_kem.ok()) << status_or_sender_kem.status();
+    auto sender_kem = std::move(status_or_sender_kem.ValueOrDie());
+    auto ecies_recipient(
+        std::move(EciesHkdfRecipientKemBoringSsl::New(test.curve, test_key.priv)
+                      .ValueOrDie()));
+    // More keys than the pool holds, so that some are computed on this
+    // thread. Every one is used only once.
+    std::set<std::string> kem_bytes;
+    for (int i = 0; i < 3 * pool_options.depth; i++) {
+      auto status_or_kem_key = sender_kem->GenerateKey(
+          test.hash, test::HexDecodeOrDie(test.salt_hex),
+          test::HexDecodeOrDie(test.info_hex), test.out_len,
+          test.point_format);
+      ASSERT_TRUE(status_or_kem_key.ok()) << status_or_kem_key.status();
+      auto kem_key = std::move(status_or_kem_key.ValueOrDie());
+      EXPECT_TRUE(kem_bytes.insert(kem_key->get_kem_bytes()).second);
+      auto status_or_shared_secret = ecies_recipient->GenerateKey(
+          kem_key->get_kem_bytes(), test.hash,
+          test::HexDecodeOrDie(test.salt_hex),
+          test::HexDecodeOrDie(test.info_hex), test.out_len,
+          test.point_format);
+      ASSERT_TRUE(status_or_shared_secret.ok())
+          << status_or_shared_secret.status();
+      EXPECT_EQ(
+          test::HexEncode(
+              util::SecretDataAsStringView(kem_key->get_symmetric_key())),
+          test::HexEncode(util::SecretDataAsStringView(
+              status_or_shared_secret.ValueOrDie())));
+    }
+  }
+}
+
+TEST_F(EciesHkdfSenderKemBoringSslTest, TestNewWithKeyPoolInvalidOptions) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  auto test_key =
+      SubtleUtilBoringSSL::GetNewEcKey(EllipticCurveType::NIST_P256)
+          .ValueOrDie();
+  EciesEphemeralKeyPool::Options pool_options;
+  pool_options.depth = 0;
+  EXPECT_THAT(EciesHkdfSenderKemBoringSsl::NewWithKeyPool(
+                  EllipticCurveType::NIST_P256, test_key.pub_x,
+                  test_key.pub_y, pool_options)
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
 TEST_F(EciesHkdfSenderKemBoringSslTest, TestNewUnknownCurve) {
   if (kUseOnlyFips) {
     GTEST_SKIP() << "Not supported in FIPS-only mode";
@@ -228,6 +298,21 @@ TEST_F(EciesHkdfX25519SendKemBoringSslTest, TestNewPubyNotEmpty) {
             util::error::INVALID_ARGUMENT);
 }
 
+TEST_F(EciesHkdfX25519SendKemBoringSslTest, TestNewSmallOrderPoint) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  // The points with u = 0 and u = 1 have order 4 and 1.
+  for (char u : {'\x00', '\x01'}) {
+    std::string pubx(X25519_PUBLIC_VALUE_LEN, '\x00');
+    pubx[0] = u;
+    auto status_or_sender_kem = EciesHkdfX25519SendKemBoringSsl::New(
+        EllipticCurveType::CURVE25519, pubx, "");
+    EXPECT_EQ(status_or_sender_kem.status().error_code(),
+              util::error::INVALID_ARGUMENT);
+  }
+}
+
 TEST_F(EciesHkdfX25519SendKemBoringSslTest, TestGenerateKey) {
   if (kUseOnlyFips) {
     GTEST_SKIP() << "Not supported in FIPS-only mode";
@@ -0,0 +1,258 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/subtle/ecies_hkdf_streaming_hybrid.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "tink/subtle/ec_util.h"
+#include "tink/util/buffer.h"
+#include "tink/util/status.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+namespace {
+
+EciesHkdfStreamingDemFactory AesGcmHkdfDemFactory(
+    const AesGcmHkdfStreaming::Params& dem_params) {
+  return [dem_params](util::SecretData ikm, int ciphertext_offset)
+             -> util::StatusOr<std::unique_ptr<NonceBasedStreamingAead>> {
+    AesGcmHkdfStreaming::Params params = dem_params;
+    params.ikm = std::move(ikm);
+    params.ciphertext_offset = ciphertext_offset;
+    auto result = AesGcmHkdfStreaming::New(std::move(params));
+    if (!result.ok()) return result.status();
+    return {std::move(result.ValueOrDie())};
+  };
+}
+
+EciesHkdfStreamingDemFactory AesCtrHmacDemFactory(
+    const AesCtrHmacStreaming::Params& dem_params) {
+  return [dem_params](util::SecretData ikm, int ciphertext_offset)
+             -> util::StatusOr<std::unique_ptr<NonceBasedStreamingAead>> {
+    AesCtrHmacStreaming::Params params = dem_params;
+    params.ikm = std::move(ikm);
+    params.ciphertext_offset = ciphertext_offset;
+    auto result = AesCtrHmacStreaming::New(std::move(params));
+    if (!result.ok()) return result.status();
+    return {std::move(result.ValueOrDie())};
+  };
+}
+
+// Returns the size of the KEM bytes, after checking that the streaming AEAD
+// accepts key material of 'ikm_size' bytes and this ciphertext offset.
+util::StatusOr<int> CheckParams(const EciesHkdfStreamingParams& params,
+                                int ikm_size,
+                                const EciesHkdfStreamingDemFactory& factory) {
+  auto kem_size_result =
+      EcUtil::EncodingSizeInBytes(params.curve, params.point_format);
+  if (!kem_size_result.ok()) return kem_size_result.status();
+  int kem_size = kem_size_result.ValueOrDie();
+  auto dem_result = factory(util::SecretData(ikm_size), kem_size);
+  if (!dem_result.ok()) return dem_result.status();
+  return kem_size;
+}
+
+util::Status WriteFully(OutputStream* output_stream, absl::string_view data) {
+  while (!data.empty()) {
+    void* buffer;
+    auto next_result = output_stream->Next(&buffer);
+    if (!next_result.ok()) return next_result.status();
+    int available = next_result.ValueOrDie();
+    int count = std::min<size_t>(available, data.size());
+    std::memcpy(buffer, data.data(), count);
+    if (count < available) output_stream->BackUp(available - count);
+    data.remove_prefix(count);
+  }
+  return util::OkStatus();
+}
+
+util::Status ReadFully(InputStream* input_stream, int size,
+                       std::string* output) {
+  output->clear();
+  while (output->size() < size) {
+    const void* buffer;
+    auto next_result = input_stream->Next(&buffer);
+    if (!next_result.ok()) {
+      if (next_result.status().error_code() == util::error::OUT_OF_RANGE) {
+        return util::Status(util::error::INVALID_ARGUMENT,
+                            "ciphertext too short");
+      }
+      return next_result.status();
+    }
+    int available = next_result.ValueOrDie();
+    int count = std::min<size_t>(available, size - output->size());
+    output->append(static_cast<const char*>(buffer), count);
+    if (count < available) input_stream->BackUp(available - count);
+  }
+  return util::OkStatus();
+}
+
+}  // namespace
+
+// static
+util::StatusOr<std::unique_ptr<EciesHkdfStreamingHybridEncrypt>>
+EciesHkdfStreamingHybridEncrypt::New(
+    const EciesHkdfStreamingParams& params, const std::string& pubx,
+    const std::string& puby, const AesGcmHkdfStreaming::Params& dem_params) {
+  return New(params, pubx, puby, dem_params.derived_key_size,
+             AesGcmHkdfDemFactory(dem_params));
+}
+
+// static
+util::StatusOr<std::unique_ptr<EciesHkdfStreamingHybridEncrypt>>
+EciesHkdfStreamingHybridEncrypt::New(
+    const EciesHkdfStreamingParams& params, const std::string& pubx,
+    const std::string& puby, const AesCtrHmacStreaming::Params& dem_params) {
+  return New(params, pubx, puby, dem_params.key_size,
+             AesCtrHmacDemFactory(dem_params));
+}
+
+// static
+util::StatusOr<std::unique_ptr<EciesHkdfStreamingHybridEncrypt>>
+EciesHkdfStreamingHybridEncrypt::New(const EciesHkdfStreamingParams& params,
+                                     const std::string& pubx,
+                                     const std::string& puby, int ikm_size,
+                                     EciesHkdfStreamingDemFactory dem_factory) {
+  auto check_result = CheckParams(params, ikm_size, dem_factory);
+  if (!check_result.ok()) return check_result.status();
+  auto kem_result = EciesHkdfSenderKemBoringSsl::New(params.curve, pubx, puby);
+  if (!kem_result.ok()) return kem_result.status();
+  return {absl::WrapUnique(new EciesHkdfStreamingHybridEncrypt(
+      params, std::move(kem_result).ValueOrDie(), ikm_size,
+      std::move(dem_factory)))};
+}
+
+util::StatusOr<std::unique_ptr<OutputStream>>
+EciesHkdfStreamingHybridEncrypt::NewEncryptingStream(
+    std::unique_ptr<OutputStream> ciphertext_destination,
+    absl::string_view context_info) const {
+  if (ciphertext_destination == nullptr) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "ciphertext_destination must be non-null");
+  }
+  auto kem_key_result =
+      sender_kem_->GenerateKey(params_.hkdf_hash, params_.hkdf_salt,
+                               context_info, ikm_size_, params_.point_format);
+  if (!kem_key_result.ok()) return kem_key_result.status();
+  auto kem_key = std::move(kem_key_result.ValueOrDie());
+
+  auto dem_result = dem_factory_(kem_key->get_symmetric_key(),
+                                 kem_key->get_kem_bytes().size());
+  if (!dem_result.ok()) return dem_result.status();
+
+  util::Status status =
+      WriteFully(ciphertext_destination.get(), kem_key->get_kem_bytes());
+  if (!status.ok()) return status;
+  return dem_result.ValueOrDie()->NewEncryptingStream(
+      std::move(ciphertext_destination), "");  // empty associated data
+}
+
+// static
+util::StatusOr<std::unique_ptr<EciesHkdfStreamingHybridDecrypt>>
+EciesHkdfStreamingHybridDecrypt::New(
+    const EciesHkdfStreamingParams& params, util::SecretData priv_key,
+    const AesGcmHkdfStreaming::Params& dem_params) {
+  return New(params, std::move(priv_key), dem_params.derived_key_size,
+             AesGcmHkdfDemFactory(dem_params));
+}
+
+// static
+util::StatusOr<std::unique_ptr<EciesHkdfStreamingHybridDecrypt>>
+EciesHkdfStreamingHybridDecrypt::New(
+    const EciesHkdfStreamingParams& params, util::SecretData priv_key,
+    const AesCtrHmacStreaming::Params& dem_params) {
+  return New(params, std::move(priv_key), dem_params.key_size,
+             AesCtrHmacDemFactory(dem_params));
+}
+
+// static
+util::StatusOr<std::unique_ptr<EciesHkdfStreamingHybridDecrypt>>
+EciesHkdfStreamingHybridDecrypt::New(const EciesHkdfStreamingParams& params,
+                                     util::SecretData priv_key, int ikm_size,
+                                     EciesHkdfStreamingDemFactory dem_factory) {
+  auto kem_size_result = CheckParams(params, ikm_size, dem_factory);
+  if (!kem_size_result.ok()) return kem_size_result.status();
+  auto kem_result =
+      EciesHkdfRecipientKemBoringSsl::New(params.curve, std::move(priv_key));
+  if (!kem_result.ok()) return kem_result.status();
+  return {absl::WrapUnique(new EciesHkdfStreamingHybridDecrypt(
+      params, std::move(kem_result).ValueOrDie(),
+      kem_size_result.ValueOrDie(), ikm_size, std::move(dem_factory)))};
+}
+
+util::StatusOr<std::unique_ptr<NonceBasedStreamingAead>>
+EciesHkdfStreamingHybridDecrypt::NewDem(absl::string_view kem_bytes,
+                                        absl::string_view context_info) const {
+  auto ikm_result = recipient_kem_->GenerateKey(
+      kem_bytes, params_.hkdf_hash, params_.hkdf_salt, context_info, ikm_size_,
+      params_.point_format);
+  if (!ikm_result.ok()) return ikm_result.status();
+  return dem_factory_(std::move(ikm_result).ValueOrDie(), kem_size_);
+}
+
+util::StatusOr<std::unique_ptr<InputStream>>
+EciesHkdfStreamingHybridDecrypt::NewDecryptingStream(
+    std::unique_ptr<InputStream> ciphertext_source,
+    absl::string_view context_info) const {
+  if (ciphertext_source == nullptr) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "ciphertext_source must be non-null");
+  }
+  std::string kem_bytes;
+  util::Status status =
+      ReadFully(ciphertext_source.get(), kem_size_, &kem_bytes);
+  if (!status.ok()) return status;
+  auto dem_result = NewDem(kem_bytes, context_info);
+  if (!dem_result.ok()) return dem_result.status();
+  return dem_result.ValueOrDie()->NewDecryptingStream(
+      std::move(ciphertext_source), "");  // empty associated data
+}
+
+util::StatusOr<std::unique_ptr<RandomAccessStream>>
+EciesHkdfStreamingHybridDecrypt::NewDecryptingRandomAccessStream(
+    std::unique_ptr<RandomAccessStream> ciphertext_source,
+    absl::string_view context_info) const {
+  if (ciphertext_source == nullptr) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "ciphertext_source must be non-null");
+  }
+  auto buffer_result = util::Buffer::New(kem_size_);
+  if (!buffer_result.ok()) return buffer_result.status();
+  auto buffer = std::move(buffer_result.ValueOrDie());
+  util::Status status = ciphertext_source->PRead(0, kem_size_, buffer.get());
+  if (!status.ok() && status.error_code() != util::error::OUT_OF_RANGE) {
+    return status;
+  }
+  if (buffer->size() != kem_size_) {
+    return util::Status(util::error::INVALID_ARGUMENT, "ciphertext too short");
+  }
+  auto dem_result = NewDem(
+      absl::string_view(buffer->get_mem_block(), kem_size_), context_info);
+  if (!dem_result.ok()) return dem_result.status();
+  return dem_result.ValueOrDie()->NewDecryptingRandomAccessStream(
+      std::move(ciphertext_source), "");  // empty associated data
+}
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,156 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TINK_SUBTLE_ECIES_HKDF_STREAMING_HYBRID_H_
+#define TINK_SUBTLE_ECIES_HKDF_STREAMING_HYBRID_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "tink/input_stream.h"
+#include "tink/output_stream.h"
+#include "tink/random_access_stream.h"
+#include "tink/subtle/aes_ctr_hmac_streaming.h"
+#include "tink/subtle/aes_gcm_hkdf_streaming.h"
+#include "tink/subtle/common_enums.h"
+#include "tink/subtle/ecies_hkdf_recipient_kem_boringssl.h"
+#include "tink/subtle/ecies_hkdf_sender_kem_boringssl.h"
+#include "tink/subtle/nonce_based_streaming_aead.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+// Hybrid encryption of streams, with ECIES-HKDF as KEM and a streaming AEAD,
+// AES-GCM-HKDF or AES-CTR-HMAC, as DEM. The KEM runs once per stream and
+// derives the input key material of the streaming AEAD, so that memory use
+// does not depend on the size of the plaintext. The ciphertext is the KEM
+// bytes followed by the ciphertext of the streaming AEAD, whose ciphertext
+// offset is the size of the KEM bytes.
+//
+// As with HybridEncrypt, 'context_info' is the HKDF info of the KEM; the
+// streaming AEAD gets empty associated data.
+struct EciesHkdfStreamingParams {
+  EllipticCurveType curve;
+  EcPointFormat point_format;
+  HashType hkdf_hash;
+  std::string hkdf_salt;
+};
+
+// Returns the streaming AEAD of one stream, for the key material derived by
+// the KEM and the size of the KEM bytes.
+using EciesHkdfStreamingDemFactory =
+    std::function<util::StatusOr<std::unique_ptr<NonceBasedStreamingAead>>(
+        util::SecretData ikm, int ciphertext_offset)>;
+
+class EciesHkdfStreamingHybridEncrypt {
+ public:
+  // The 'ikm' and 'ciphertext_offset' of 'dem_params' are ignored: the input
+  // key material is derived by the KEM, with the size of the derived key.
+  static util::StatusOr<std::unique_ptr<EciesHkdfStreamingHybridEncrypt>> New(
+      const EciesHkdfStreamingParams& params, const std::string& pubx,
+      const std::string& puby, const AesGcmHkdfStreaming::Params& dem_params);
+  static util::StatusOr<std::unique_ptr<EciesHkdfStreamingHybridEncrypt>> New(
+      const EciesHkdfStreamingParams& params, const std::string& pubx,
+      const std::string& puby, const AesCtrHmacStreaming::Params& dem_params);
+
+  // Writes the KEM bytes to 'ciphertext_destination', and returns a wrapper
+  // around it which encrypts the bytes written to it. Closing the wrapper
+  // closes 'ciphertext_destination'.
+  util::StatusOr<std::unique_ptr<OutputStream>> NewEncryptingStream(
+      std::unique_ptr<OutputStream> ciphertext_destination,
+      absl::string_view context_info) const;
+
+ private:
+  EciesHkdfStreamingHybridEncrypt(
+      const EciesHkdfStreamingParams& params,
+      std::unique_ptr<const EciesHkdfSenderKemBoringSsl> sender_kem,
+      int ikm_size, EciesHkdfStreamingDemFactory dem_factory)
+      : params_(params),
+        sender_kem_(std::move(sender_kem)),
+        ikm_size_(ikm_size),
+        dem_factory_(std::move(dem_factory)) {}
+
+  static util::StatusOr<std::unique_ptr<EciesHkdfStreamingHybridEncrypt>> New(
+      const EciesHkdfStreamingParams& params, const std::string& pubx,
+      const std::string& puby, int ikm_size,
+      EciesHkdfStreamingDemFactory dem_factory);
+
+  const EciesHkdfStreamingParams params_;
+  const std::unique_ptr<const EciesHkdfSenderKemBoringSsl> sender_kem_;
+  const int ikm_size_;
+  const EciesHkdfStreamingDemFactory dem_factory_;
+};
+
+class EciesHkdfStreamingHybridDecrypt {
+ public:
+  // 'params' and 'dem_params' must be those of the encryption.
+  static util::StatusOr<std::unique_ptr<EciesHkdfStreamingHybridDecrypt>> New(
+      const EciesHkdfStreamingParams& params, util::SecretData priv_key,
+      const AesGcmHkdfStreaming::Params& dem_params);
+  static util::StatusOr<std::unique_ptr<EciesHkdfStreamingHybridDecrypt>> New(
+      const EciesHkdfStreamingParams& params, util::SecretData priv_key,
+      const AesCtrHmacStreaming::Params& dem_params);
+
+  // Reads the KEM bytes from 'ciphertext_source', and returns a wrapper
+  // around it from which the plaintext can be read.
+  util::StatusOr<std::unique_ptr<InputStream>> NewDecryptingStream(
+      std::unique_ptr<InputStream> ciphertext_source,
+      absl::string_view context_info) const;
+
+  // Reads the KEM bytes at the start of 'ciphertext_source', and returns a
+  // wrapper around it from which the plaintext can be read at any position.
+  util::StatusOr<std::unique_ptr<RandomAccessStream>>
+  NewDecryptingRandomAccessStream(
+      std::unique_ptr<RandomAccessStream> ciphertext_source,
+      absl::string_view context_info) const;
+
+ private:
+  EciesHkdfStreamingHybridDecrypt(
+      const EciesHkdfStreamingParams& params,
+      std::unique_ptr<const EciesHkdfRecipientKemBoringSsl> recipient_kem,
+      int kem_size, int ikm_size, EciesHkdfStreamingDemFactory dem_factory)
+      : params_(params),
+        recipient_kem_(std::move(recipient_kem)),
+        kem_size_(kem_size),
+        ikm_size_(ikm_size),
+        dem_factory_(std::move(dem_factory)) {}
+
+  static util::StatusOr<std::unique_ptr<EciesHkdfStreamingHybridDecrypt>> New(
+      const EciesHkdfStreamingParams& params, util::SecretData priv_key,
+      int ikm_size, EciesHkdfStreamingDemFactory dem_factory);
+
+  // Returns the streaming AEAD for the KEM bytes of a ciphertext.
+  util::StatusOr<std::unique_ptr<NonceBasedStreamingAead>> NewDem(
+      absl::string_view kem_bytes, absl::string_view context_info) const;
+
+  const EciesHkdfStreamingParams params_;
+  const std::unique_ptr<const EciesHkdfRecipientKemBoringSsl> recipient_kem_;
+  const int kem_size_;
+  const int ikm_size_;
+  const EciesHkdfStreamingDemFactory dem_factory_;
+};
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_SUBTLE_ECIES_HKDF_STREAMING_HYBRID_H_
@@ -0,0 +1,235 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/subtle/ecies_hkdf_streaming_hybrid.h"
+
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "tink/config/tink_fips.h"
+#include "tink/subtle/common_enums.h"
+#include "tink/subtle/random.h"
+#include "tink/subtle/subtle_util_boringssl.h"
+#include "tink/subtle/test_util.h"
+#include "tink/util/buffer.h"
+#include "tink/util/file_random_access_stream.h"
+#include "tink/util/istream_input_stream.h"
+#include "tink/util/ostream_output_stream.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "tink/util/test_matchers.h"
+#include "tink/util/test_util.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+namespace {
+
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::testing::Eq;
+using ::testing::Not;
+
+AesGcmHkdfStreaming::Params AesGcmHkdfDemParams() {
+  AesGcmHkdfStreaming::Params params;
+  params.hkdf_hash = SHA256;
+  params.derived_key_size = 16;
+  params.ciphertext_segment_size = 512;
+  return params;
+}
+
+AesCtrHmacStreaming::Params AesCtrHmacDemParams() {
+  AesCtrHmacStreaming::Params params;
+  params.hkdf_algo = SHA256;
+  params.key_size = 32;
+  params.ciphertext_segment_size = 512;
+  params.tag_algo = SHA256;
+  params.tag_size = 32;
+  return params;
+}
+
+class EciesHkdfStreamingHybridTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    if (kUseOnlyFips) {
+      GTEST_SKIP() << "Not supported in FIPS-only mode";
+    }
+    params_.curve = NIST_P256;
+    params_.point_format = EcPointFormat::UNCOMPRESSED;
+    params_.hkdf_hash = SHA256;
+    params_.hkdf_salt = "salt";
+    key_ = SubtleUtilBoringSSL::GetNewEcKey(params_.curve).ValueOrDie();
+  }
+
+  util::StatusOr<std::string> Encrypt(
+      const EciesHkdfStreamingHybridEncrypt& encrypt,
+      absl::string_view plaintext, absl::string_view context_info) {
+    auto ct_stream = absl::make_unique<std::stringstream>();
+    auto ct_buf = ct_stream->rdbuf();
+    auto enc_stream_result = encrypt.NewEncryptingStream(
+        absl::make_unique<util::OstreamOutputStream>(std::move(ct_stream)),
+        context_info);
+    if (!enc_stream_result.ok()) return enc_stream_result.status();
+    auto status = test::WriteToStream(enc_stream_result.ValueOrDie().get(),
+                                      plaintext);
+    if (!status.ok()) return status;
+    return ct_buf->str();
+  }
+
+  util::StatusOr<std::string> Decrypt(
+      const EciesHkdfStreamingHybridDecrypt& decrypt,
+      absl::string_view ciphertext, absl::string_view context_info) {
+    auto dec_stream_result = decrypt.NewDecryptingStream(
+        absl::make_unique<util::IstreamInputStream>(
+            absl::make_unique<std::stringstream>(std::string(ciphertext))),
+        context_info);
+    if (!dec_stream_result.ok()) return dec_stream_result.status();
+    std::string plaintext;
+    auto status =
+        test::ReadFromStream(dec_stream_result.ValueOrDie().get(), &plaintext);
+    if (!status.ok()) return status;
+    return plaintext;
+  }
+
+  util::StatusOr<std::string> DecryptRandomAccess(
+      const EciesHkdfStreamingHybridDecrypt& decrypt,
+      absl::string_view ciphertext, absl::string_view context_info,
+      int position, int count) {
+    static int index = 0;
+    int fd = crypto::tink::test::GetTestFileDescriptor(
+        absl::StrCat("ecies_hkdf_streaming_hybrid_", index++), ciphertext);
+    auto dec_stream_result = decrypt.NewDecryptingRandomAccessStream(
+        absl::make_unique<util::FileRandomAccessStream>(fd), context_info);
+    if (!dec_stream_result.ok()) return dec_stream_result.status();
+    auto buffer = std::move(util::Buffer::New(count).ValueOrDie());
+    auto status =
+        dec_stream_result.ValueOrDie()->PRead(position, count, buffer.get());
+    if (!status.ok() && status.error_code() != util::error::OUT_OF_RANGE) {
+      return status;
+    }
+    return std::string(buffer->get_mem_block(), buffer->size());
+  }
+
+  EciesHkdfStreamingParams params_;
+  SubtleUtilBoringSSL::EcKey key_;
+};
+
+TEST_F(EciesHkdfStreamingHybridTest, EncryptThenDecrypt) {
+  auto encrypt = std::move(EciesHkdfStreamingHybridEncrypt::New(
+                               params_, key_.pub_x, key_.pub_y,
+                               AesGcmHkdfDemParams())
+                               .ValueOrDie());
+  auto decrypt = std::move(
+      EciesHkdfStreamingHybridDecrypt::New(params_, key_.priv,
+                                           AesGcmHkdfDemParams())
+          .ValueOrDie());
+  for (int size : {0, 1, 511, 5000}) {
+    SCOPED_TRACE(size);
+    std::string plaintext = Random::GetRandomBytes(size);
+    auto ciphertext_result = Encrypt(*encrypt, plaintext, "context info");
+    ASSERT_THAT(ciphertext_result.status(), IsOk());
+    std::string ciphertext = ciphertext_result.ValueOrDie();
+
+    auto decrypt_result = Decrypt(*decrypt, ciphertext, "context info");
+    ASSERT_THAT(decrypt_result.status(), IsOk());
+    EXPECT_THAT(decrypt_result.ValueOrDie(), Eq(plaintext));
+    EXPECT_THAT(Decrypt(*decrypt, ciphertext, "other context info").status(),
+                Not(IsOk()));
+
+    if (size > 0) {
+      auto ra_result = DecryptRandomAccess(*decrypt, ciphertext,
+                                           "context info", size / 2, size);
+      ASSERT_THAT(ra_result.status(), IsOk());
+      EXPECT_THAT(ra_result.ValueOrDie(), Eq(plaintext.substr(size / 2)));
+    }
+  }
+}
+
+TEST_F(EciesHkdfStreamingHybridTest, AesCtrHmacDem) {
+  auto encrypt = std::move(EciesHkdfStreamingHybridEncrypt::New(
+                               params_, key_.pub_x, key_.pub_y,
+                               AesCtrHmacDemParams())
+                               .ValueOrDie());
+  auto decrypt = std::move(
+      EciesHkdfStreamingHybridDecrypt::New(params_, key_.priv,
+                                           AesCtrHmacDemParams())
+          .ValueOrDie());
+  std::string plaintext = Random::GetRandomBytes(3000);
+  std::string ciphertext =
+      Encrypt(*encrypt, plaintext, "context info").ValueOrDie();
+  auto decrypt_result = Decrypt(*decrypt, ciphertext, "context info");
+  ASSERT_THAT(decrypt_result.status(), IsOk());
+  EXPECT_THAT(decrypt_result.ValueOrDie(), Eq(plaintext));
+  auto ra_result =
+      DecryptRandomAccess(*decrypt, ciphertext, "context info", 1000, 100);
+  ASSERT_THAT(ra_result.status(), IsOk());
+  EXPECT_THAT(ra_result.ValueOrDie(), Eq(plaintext.substr(1000, 100)));
+}
+
+TEST_F(EciesHkdfStreamingHybridTest, ModifiedKemBytesFail) {
+  auto encrypt = std::move(EciesHkdfStreamingHybridEncrypt::New(
+                               params_, key_.pub_x, key_.pub_y,
+                               AesGcmHkdfDemParams())
+                               .ValueOrDie());
+  auto decrypt = std::move(
+      EciesHkdfStreamingHybridDecrypt::New(params_, key_.priv,
+                                           AesGcmHkdfDemParams())
+          .ValueOrDie());
+  std::string ciphertext = Encrypt(*encrypt, "plaintext", "").ValueOrDie();
+  std::string modified = ciphertext;
+  modified[10] ^= 1;
+  EXPECT_THAT(Decrypt(*decrypt, modified, "").status(), Not(IsOk()));
+  EXPECT_THAT(Decrypt(*decrypt, ciphertext.substr(0, 20), "").status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(
+      DecryptRandomAccess(*decrypt, ciphertext.substr(0, 20), "", 0, 1)
+          .status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST_F(EciesHkdfStreamingHybridTest, InvalidParams) {
+  AesGcmHkdfStreaming::Params dem_params = AesGcmHkdfDemParams();
+  // The first segment cannot hold the KEM bytes and the stream header.
+  dem_params.ciphertext_segment_size = 80;
+  EXPECT_THAT(EciesHkdfStreamingHybridEncrypt::New(params_, key_.pub_x,
+                                                   key_.pub_y, dem_params)
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(
+      EciesHkdfStreamingHybridDecrypt::New(params_, key_.priv, dem_params)
+          .status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+
+  EXPECT_THAT(
+      EciesHkdfStreamingHybridEncrypt::New(params_, key_.pub_x, key_.pub_y,
+                                           AesGcmHkdfDemParams())
+          .ValueOrDie()
+          ->NewEncryptingStream(nullptr, "")
+          .status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
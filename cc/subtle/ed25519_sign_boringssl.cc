@@ -17,13 +17,15 @@
 #include "tink/subtle/ed25519_sign_boringssl.h"
 
 #include <algorithm>
-#include <iterator>
+#include <string>
+#include <vector>
 
 #include "absl/memory/memory.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/string_view.h"
 #include "openssl/curve25519.h"
 #include "tink/public_key_sign.h"
+#include "tink/subtle/subtle_util.h"
 #include "tink/subtle/subtle_util_boringssl.h"
 #include "tink/util/statusor.h"
 
@@ -49,18 +51,60 @@ util::StatusOr<std::unique_ptr<PublicKeySign>> Ed25519SignBoringSsl::New(
 
 util::StatusOr<std::string> Ed25519SignBoringSsl::Sign(
     absl::string_view data) const {
-  data = SubtleUtilBoringSSL::EnsureNonNull(data);
+  return SignWithPrefix("", data, "");
+}
 
-  uint8_t out_sig[ED25519_SIGNATURE_LEN];
-  std::fill(std::begin(out_sig), std::end(out_sig), 0);
+util::StatusOr<std::string> Ed25519SignBoringSsl::SignWithPrefix(
+    absl::string_view output_prefix, absl::string_view data,
+    absl::string_view data_suffix) const {
+  // Sign directly into the result, to avoid copying the signature.
+  std::string signature;
+  ResizeStringUninitialized(&signature,
+                            output_prefix.size() + ED25519_SIGNATURE_LEN);
+  std::copy(output_prefix.begin(), output_prefix.end(), signature.begin());
+  std::string buffer;
+  util::Status status =
+      SignInto(data, data_suffix, &buffer, &signature[output_prefix.size()]);
+  if (!status.ok()) return status;
+  return signature;
+}
 
-  if (ED25519_sign(
-          out_sig, reinterpret_cast<const uint8_t *>(data.data()), data.size(),
-          reinterpret_cast<const uint8_t *>(private_key_.data())) != 1) {
-    return util::Status(util::error::INTERNAL, "Signing failed.");
+util::Status Ed25519SignBoringSsl::SignBatchWithPrefix(
+    absl::string_view output_prefix, absl::Span<const absl::string_view> data,
+    absl::string_view data_suffix, std::string* arena,
+    std::vector<absl::string_view>* signatures) const {
+  const int64_t signature_size = output_prefix.size() + ED25519_SIGNATURE_LEN;
+  ResizeStringUninitialized(arena, data.size() * signature_size);
+  std::string buffer;
+  for (size_t i = 0; i < data.size(); i++) {
+    char* out = &(*arena)[0] + i * signature_size;
+    std::copy(output_prefix.begin(), output_prefix.end(), out);
+    util::Status status =
+        SignInto(data[i], data_suffix, &buffer, out + output_prefix.size());
+    if (!status.ok()) return status;
   }
+  SplitArena(*arena, std::vector<int64_t>(data.size(), signature_size),
+             signatures);
+  return util::OkStatus();
+}
 
-  return std::string(reinterpret_cast<char *>(out_sig), ED25519_SIGNATURE_LEN);
+util::Status Ed25519SignBoringSsl::SignInto(absl::string_view data,
+                                            absl::string_view data_suffix,
+                                            std::string* buffer,
+                                            char* out) const {
+  if (!data_suffix.empty()) {
+    buffer->assign(data.data(), data.size());
+    buffer->append(data_suffix.data(), data_suffix.size());
+    data = *buffer;
+  }
+  data = SubtleUtilBoringSSL::EnsureNonNull(data);
+  if (ED25519_sign(reinterpret_cast<uint8_t *>(out),
+                   reinterpret_cast<const uint8_t *>(data.data()), data.size(),
+                   reinterpret_cast<const uint8_t *>(private_key_.data())) !=
+      1) {
+    return util::Status(util::error::INTERNAL, "Signing failed.");
+  }
+  return util::OkStatus();
 }
 
 }  // namespace subtle
@@ -18,7 +18,12 @@
 #define TINK_SUBTLE_ED25519_SIGN_BORINGSSL_H_
 
 #include <memory>
+#include <string>
 #include <utility>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 
 #include "tink/config/tink_fips.h"
 #include "tink/public_key_sign.h"
@@ -38,6 +43,20 @@ class Ed25519SignBoringSsl : public PublicKeySign {
   crypto::tink::util::StatusOr<std::string> Sign(
       absl::string_view data) const override;
 
+  // Writes the signature directly after 'output_prefix'. Ed25519 hashes the
+  // message twice, so 'data_suffix' still has to be appended to a copy of
+  // 'data'.
+  crypto::tink::util::StatusOr<std::string> SignWithPrefix(
+      absl::string_view output_prefix, absl::string_view data,
+      absl::string_view data_suffix) const override;
+
+  // Signs into a single buffer, since all signatures have the same size.
+  crypto::tink::util::Status SignBatchWithPrefix(
+      absl::string_view output_prefix,
+      absl::Span<const absl::string_view> data, absl::string_view data_suffix,
+      std::string* arena,
+      std::vector<absl::string_view>* signatures) const override;
+
   static constexpr crypto::tink::FipsCompatibility kFipsStatus =
       crypto::tink::FipsCompatibility::kNotFips;
 
@@ -45,6 +64,13 @@ class Ed25519SignBoringSsl : public PublicKeySign {
   explicit Ed25519SignBoringSsl(util::SecretData private_key)
       : private_key_(std::move(private_key)) {}
 
+  // Writes the signature of 'data' followed by 'data_suffix' to 'out'.
+  // '*buffer' holds the concatenation if 'data_suffix' is not empty, so that
+  // batches reuse it.
+  crypto::tink::util::Status SignInto(absl::string_view data,
+                                      absl::string_view data_suffix,
+                                      std::string* buffer, char* out) const;
+
   const util::SecretData private_key_;
 };
 
@@ -17,6 +17,7 @@
 #include "tink/subtle/ed25519_sign_boringssl.h"
 
 #include <string>
+#include <vector>
 
 #include "gtest/gtest.h"
 #include "absl/strings/str_cat.h"
@@ -37,6 +38,7 @@ namespace tink {
 namespace subtle {
 namespace {
 
+using ::crypto::tink::test::IsOk;
 using ::crypto::tink::test::StatusIs;
 
 class Ed25519SignBoringSslTest : public ::testing::Test {};
@@ -95,6 +97,45 @@ TEST_F(Ed25519SignBoringSslTest, testBasicSign) {
   }
 }
 
+TEST_F(Ed25519SignBoringSslTest, testSignBatch) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Test assumes kOnlyUseFips is false.";
+  }
+
+  uint8_t out_public_key[ED25519_PUBLIC_KEY_LEN];
+  uint8_t out_private_key[ED25519_PRIVATE_KEY_LEN];
+  ED25519_keypair(out_public_key, out_private_key);
+  util::SecretData private_key =
+      util::SecretDataFromStringView(absl::string_view(
+          reinterpret_cast<char *>(out_private_key), ED25519_PRIVATE_KEY_LEN));
+  auto signer_result = Ed25519SignBoringSsl::New(private_key);
+  ASSERT_TRUE(signer_result.ok()) << signer_result.status();
+  auto signer = std::move(signer_result.ValueOrDie());
+
+  std::vector<std::string> messages;
+  for (int i = 0; i < 20; i++) messages.push_back(Random::GetRandomBytes(i));
+  std::vector<absl::string_view> data(messages.begin(), messages.end());
+  data.push_back(absl::string_view());
+  std::string arena;
+  std::vector<absl::string_view> signatures;
+  ASSERT_THAT(signer->SignBatch(data, &arena, &signatures), IsOk());
+  ASSERT_EQ(signatures.size(), data.size());
+  EXPECT_EQ(arena.size(), data.size() * ED25519_SIGNATURE_LEN);
+  // Ed25519 signatures are deterministic.
+  for (size_t i = 0; i < data.size(); i++) {
+    EXPECT_EQ(signatures[i], signer->Sign(data[i]).ValueOrDie());
+  }
+
+  ASSERT_THAT(signer->SignBatchWithPrefix("prefix", data, "suffix", &arena,
+                                          &signatures),
+              IsOk());
+  ASSERT_EQ(signatures.size(), data.size());
+  for (size_t i = 0; i < data.size(); i++) {
+    EXPECT_EQ(signatures[i],
+              signer->SignWithPrefix("prefix", data[i], "suffix").ValueOrDie());
+  }
+}
+
 TEST_F(Ed25519SignBoringSslTest, testInvalidPrivateKeys) {
   if (kUseOnlyFips) {
     GTEST_SKIP() << "Test assumes kOnlyUseFips is false.";
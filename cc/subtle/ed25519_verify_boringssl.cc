@@ -47,6 +47,10 @@ util::StatusOr<std::unique_ptr<PublicKeyVerify>> Ed25519VerifyBoringSsl::New(
   return std::move(verify);
 }
 
+Ed25519VerifyBoringSsl::Ed25519VerifyBoringSsl(absl::string_view public_key) {
+  std::memcpy(public_key_, public_key.data(), ED25519_PUBLIC_KEY_LEN);
+}
+
 util::Status Ed25519VerifyBoringSsl::Verify(absl::string_view signature,
                                             absl::string_view data) const {
   signature = SubtleUtilBoringSSL::EnsureNonNull(signature);
@@ -63,7 +67,7 @@ util::Status Ed25519VerifyBoringSsl::Verify(absl::string_view signature,
   if (1 != ED25519_verify(
                reinterpret_cast<const uint8_t *>(data.data()), data.size(),
                reinterpret_cast<const uint8_t *>(signature.data()),
-               reinterpret_cast<const uint8_t *>(public_key_.data()))) {
+               public_key_)) {
     return util::Status(util::error::INVALID_ARGUMENT,
                         "Signature is not valid.");
   }
@@ -17,10 +17,12 @@
 #ifndef TINK_SUBTLE_ED25519_VERIFY_BORINGSSL_H_
 #define TINK_SUBTLE_ED25519_VERIFY_BORINGSSL_H_
 
+#include <cstdint>
 #include <memory>
 #include <string>
 
 #include "absl/strings/string_view.h"
+#include "openssl/curve25519.h"
 #include "tink/config/tink_fips.h"
 #include "tink/public_key_verify.h"
 #include "tink/util/statusor.h"
@@ -29,6 +31,13 @@ namespace crypto {
 namespace tink {
 namespace subtle {
 
+// Verifies Ed25519 signatures with BoringSSL.
+//
+// BoringSSL only accepts the encoded 32-byte public key, so each Verify()
+// decodes the public point again; the decoded point cannot be cached, as the
+// group operations are not part of BoringSSL's public API. The decoding costs
+// one field exponentiation, which is small next to the double-scalar
+// multiplication of the verification itself.
 class Ed25519VerifyBoringSsl : public PublicKeyVerify {
  public:
   static crypto::tink::util::StatusOr<std::unique_ptr<PublicKeyVerify>> New(
@@ -42,10 +51,9 @@ class Ed25519VerifyBoringSsl : public PublicKeyVerify {
       crypto::tink::FipsCompatibility::kNotFips;
 
  private:
-  const std::string public_key_;
+  explicit Ed25519VerifyBoringSsl(absl::string_view public_key);
 
-  explicit Ed25519VerifyBoringSsl(absl::string_view public_key)
-      : public_key_(public_key) {}
+  uint8_t public_key_[ED25519_PUBLIC_KEY_LEN];
 };
 
 }  // namespace subtle
@@ -17,14 +17,19 @@
 #include "tink/subtle/encrypt_then_authenticate.h"
 
 #include <cstdint>
+#include <cstring>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "absl/strings/string_view.h"
 #include "absl/strings/str_cat.h"
+#include "openssl/mem.h"
 #include "tink/aead.h"
 #include "tink/mac.h"
 #include "tink/subtle/ind_cpa_cipher.h"
+#include "tink/subtle/mac/stateful_mac.h"
+#include "tink/subtle/subtle_util.h"
 #include "tink/subtle/subtle_util_boringssl.h"
 #include "tink/util/errors.h"
 #include "tink/util/status.h"
@@ -35,15 +40,39 @@ namespace crypto {
 namespace tink {
 namespace subtle {
 
-static const std::string longToBigEndianStr(uint64_t value) {
-  uint8_t bytes[8];
-  for (int i = sizeof(bytes) - 1; i >= 0; i--) {
-    bytes[i] = value & 0xff;
+namespace {
+
+// Writes 'value' as a 64-bit big-endian integer.
+void BigEndianUint64(uint64_t value, char bytes[8]) {
+  for (int i = 7; i >= 0; i--) {
+    bytes[i] = static_cast<char>(value & 0xff);
     value >>= 8;
   }
-  return std::string(reinterpret_cast<const char*>(&bytes[0]), sizeof(bytes));
 }
 
+// Returns additional_data || ciphertext || additional_data's size in bits.
+std::string MacInput(absl::string_view additional_data,
+                     absl::string_view ciphertext) {
+  char aad_size_in_bits[8];
+  BigEndianUint64(static_cast<uint64_t>(additional_data.size()) * 8,
+                  aad_size_in_bits);
+  return absl::StrCat(
+      additional_data, ciphertext,
+      absl::string_view(aad_size_in_bits, sizeof(aad_size_in_bits)));
+}
+
+util::Status CheckAdditionalDataSize(absl::string_view additional_data) {
+  uint64_t aad_size_in_bytes = additional_data.size();
+  uint64_t aad_size_in_bits = aad_size_in_bytes * 8;
+  if (aad_size_in_bits / 8 != aad_size_in_bytes /* overflow occured! */) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "additional data too long");
+  }
+  return util::OkStatus();
+}
+
+}  // namespace
+
 util::StatusOr<std::unique_ptr<Aead>> EncryptThenAuthenticate::New(
     std::unique_ptr<IndCpaCipher> ind_cpa_cipher, std::unique_ptr<Mac> mac,
     uint8_t tag_size) {
@@ -51,42 +80,116 @@ util::StatusOr<std::unique_ptr<Aead>> EncryptThenAuthenticate::New(
     return util::Status(util::error::INVALID_ARGUMENT, "tag size too small");
   }
   std::unique_ptr<Aead> aead(new EncryptThenAuthenticate(
-      std::move(ind_cpa_cipher), std::move(mac), tag_size));
+      std::move(ind_cpa_cipher), std::move(mac), nullptr, tag_size));
+  return std::move(aead);
+}
+
+util::StatusOr<std::unique_ptr<Aead>> EncryptThenAuthenticate::New(
+    std::unique_ptr<IndCpaCipher> ind_cpa_cipher,
+    std::unique_ptr<StatefulMacFactory> mac_factory, uint8_t tag_size) {
+  if (tag_size < kMinTagSizeInBytes) {
+    return util::Status(util::error::INVALID_ARGUMENT, "tag size too small");
+  }
+  std::unique_ptr<Aead> aead(new EncryptThenAuthenticate(
+      std::move(ind_cpa_cipher), nullptr, std::move(mac_factory), tag_size));
   return std::move(aead);
 }
 
+util::StatusOr<std::string> EncryptThenAuthenticate::ComputeTag(
+    absl::string_view additional_data, absl::string_view ciphertext) const {
+  util::StatusOr<std::string> tag;
+  if (mac_factory_ != nullptr) {
+    char aad_size_in_bits[8];
+    BigEndianUint64(static_cast<uint64_t>(additional_data.size()) * 8,
+                    aad_size_in_bits);
+    auto mac_result = mac_factory_->Create();
+    if (!mac_result.ok()) return mac_result.status();
+    StatefulMac& mac = *mac_result.ValueOrDie();
+    util::Status status = mac.Update(additional_data);
+    if (status.ok()) status = mac.Update(ciphertext);
+    if (status.ok()) {
+      status = mac.Update(
+          absl::string_view(aad_size_in_bits, sizeof(aad_size_in_bits)));
+    }
+    if (!status.ok()) return status;
+    tag = mac.Finalize();
+  } else {
+    tag = mac_->ComputeMac(MacInput(additional_data, ciphertext));
+  }
+  if (!tag.ok()) return tag.status();
+  if (tag.ValueOrDie().size() != tag_size_) {
+    return util::Status(util::error::INTERNAL, "invalid tag size");
+  }
+  return tag;
+}
+
 util::StatusOr<std::string> EncryptThenAuthenticate::Encrypt(
     absl::string_view plaintext, absl::string_view additional_data) const {
+  // If the IndCpaCipher can report its ciphertext size, the ciphertext and
+  // the tag are written into a single allocation.
+  auto size_result = CiphertextSize(plaintext.size());
+  if (size_result.ok()) {
+    std::string result;
+    ResizeStringUninitialized(&result, size_result.ValueOrDie());
+    auto written_result =
+        EncryptInto(plaintext, additional_data, absl::MakeSpan(result));
+    if (!written_result.ok()) return written_result.status();
+    result.resize(written_result.ValueOrDie());
+    return result;
+  }
+
   // BoringSSL expects a non-null pointer for plaintext and additional_data,
   // regardless of whether the size is 0.
   plaintext = SubtleUtilBoringSSL::EnsureNonNull(plaintext);
   additional_data = SubtleUtilBoringSSL::EnsureNonNull(additional_data);
-
-  uint64_t aad_size_in_bytes = additional_data.size();
-  uint64_t aad_size_in_bits = aad_size_in_bytes * 8;
-  if (aad_size_in_bits / 8 != aad_size_in_bytes /* overflow occured! */) {
-    return util::Status(util::error::INVALID_ARGUMENT,
-                        "additional data too long");
-  }
+  util::Status status = CheckAdditionalDataSize(additional_data);
+  if (!status.ok()) return status;
 
   auto ct = ind_cpa_cipher_->Encrypt(plaintext);
   if (!ct.ok()) {
     return ct.status();
   }
-  std::string ciphertext(ct.ValueOrDie());
-  std::string toAuthData = absl::StrCat(additional_data, ciphertext,
-                                        longToBigEndianStr(aad_size_in_bits));
-
-  auto tag = mac_->ComputeMac(toAuthData);
+  std::string ciphertext(std::move(ct.ValueOrDie()));
+  auto tag = ComputeTag(additional_data, ciphertext);
   if (!tag.ok()) {
     return tag.status();
   }
-  if (tag.ValueOrDie().size() != tag_size_) {
-    return util::Status(util::error::INTERNAL, "invalid tag size");
-  }
   return ciphertext.append(tag.ValueOrDie());
 }
 
+util::StatusOr<int64_t> EncryptThenAuthenticate::CiphertextSize(
+    int64_t plaintext_size) const {
+  auto size_result = ind_cpa_cipher_->CiphertextSize(plaintext_size);
+  if (!size_result.ok()) return size_result.status();
+  return size_result.ValueOrDie() + tag_size_;
+}
+
+util::StatusOr<int64_t> EncryptThenAuthenticate::EncryptInto(
+    absl::string_view plaintext, absl::string_view additional_data,
+    absl::Span<char> buffer) const {
+  // BoringSSL expects a non-null pointer for plaintext and additional_data,
+  // regardless of whether the size is 0.
+  plaintext = SubtleUtilBoringSSL::EnsureNonNull(plaintext);
+  additional_data = SubtleUtilBoringSSL::EnsureNonNull(additional_data);
+  util::Status status = CheckAdditionalDataSize(additional_data);
+  if (!status.ok()) return status;
+  if (buffer.size() < tag_size_) {
+    return util::Status(util::error::INVALID_ARGUMENT, "Buffer too small");
+  }
+
+  auto written_result = ind_cpa_cipher_->EncryptInto(
+      plaintext, buffer.subspan(0, buffer.size() - tag_size_));
+  if (!written_result.ok()) return written_result.status();
+  int64_t written = written_result.ValueOrDie();
+  auto tag = ComputeTag(additional_data,
+                        absl::string_view(buffer.data(), written));
+  if (!tag.ok()) {
+    return tag.status();
+  }
+  std::memcpy(buffer.data() + written, tag.ValueOrDie().data(), tag_size_);
+  return written + tag_size_;
+}
+
 util::StatusOr<std::string> EncryptThenAuthenticate::Decrypt(
     absl::string_view ciphertext, absl::string_view additional_data) const {
   // BoringSSL expects a non-null pointer for additional_data,
@@ -96,22 +199,26 @@ util::StatusOr<std::string> EncryptThenAuthenticate::Decrypt(
   if (ciphertext.size() < tag_size_) {
     return util::Status(util::error::INVALID_ARGUMENT, "ciphertext too short");
   }
-
-  uint64_t aad_size_in_bytes = additional_data.size();
-  uint64_t aad_size_in_bits = aad_size_in_bytes * 8;
-  if (aad_size_in_bits / 8 != aad_size_in_bytes /* overflow occured! */) {
-    return util::Status(util::error::INVALID_ARGUMENT,
-                        "additional data too long");
-  }
+  util::Status status = CheckAdditionalDataSize(additional_data);
+  if (!status.ok()) return status;
 
   auto payload = ciphertext.substr(0, ciphertext.size() - tag_size_);
   auto tag = ciphertext.substr(ciphertext.size() - tag_size_, tag_size_);
-  std::string toAuthData = absl::StrCat(additional_data, payload,
-                                        longToBigEndianStr(aad_size_in_bits));
-
-  auto verified = mac_->VerifyMac(tag, toAuthData);
-  if (!verified.ok()) {
-    return verified;
+  if (mac_factory_ != nullptr) {
+    auto expected_tag = ComputeTag(additional_data, payload);
+    if (!expected_tag.ok()) {
+      return expected_tag.status();
+    }
+    if (CRYPTO_memcmp(expected_tag.ValueOrDie().data(), tag.data(),
+                      tag_size_) != 0) {
+      return util::Status(util::error::INVALID_ARGUMENT,
+                          "verification failed");
+    }
+  } else {
+    auto verified = mac_->VerifyMac(tag, MacInput(additional_data, payload));
+    if (!verified.ok()) {
+      return verified;
+    }
   }
 
   auto pt = ind_cpa_cipher_->Decrypt(payload);
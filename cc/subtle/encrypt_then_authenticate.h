@@ -17,12 +17,15 @@
 #ifndef TINK_SUBTLE_ENCRYPT_THEN_AUTHENTICATE_H_
 #define TINK_SUBTLE_ENCRYPT_THEN_AUTHENTICATE_H_
 
+#include <cstdint>
 #include <memory>
 
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "tink/aead.h"
 #include "tink/mac.h"
 #include "tink/subtle/ind_cpa_cipher.h"
+#include "tink/subtle/mac/stateful_mac.h"
 #include "tink/util/status.h"
 #include "tink/util/statusor.h"
 
@@ -40,6 +43,14 @@ class EncryptThenAuthenticate : public Aead {
       std::unique_ptr<IndCpaCipher> ind_cpa_cipher, std::unique_ptr<Mac> mac,
       uint8_t tag_size);
 
+  // As above, with a MAC which is computed incrementally over the additional
+  // data, the ciphertext and the length, so that they are not concatenated.
+  // With an IndCpaCipher which implements EncryptInto(), Encrypt() then
+  // writes the ciphertext and the tag into a single allocation.
+  static crypto::tink::util::StatusOr<std::unique_ptr<Aead>> New(
+      std::unique_ptr<IndCpaCipher> ind_cpa_cipher,
+      std::unique_ptr<StatefulMacFactory> mac_factory, uint8_t tag_size);
+
   // Encrypts 'plaintext' with 'additional_data' as additional authenticated
   // data. The resulting ciphertext allows for checking authenticity and
   // integrity of additional data ({@code aad}), but does not guarantee its
@@ -57,17 +68,33 @@ class EncryptThenAuthenticate : public Aead {
       absl::string_view ciphertext,
       absl::string_view additional_data) const override;
 
+  crypto::tink::util::StatusOr<int64_t> CiphertextSize(
+      int64_t plaintext_size) const override;
+
+  crypto::tink::util::StatusOr<int64_t> EncryptInto(
+      absl::string_view plaintext, absl::string_view additional_data,
+      absl::Span<char> buffer) const override;
+
  private:
   static constexpr int kMinTagSizeInBytes = 10;
 
   EncryptThenAuthenticate(std::unique_ptr<IndCpaCipher> ind_cpa_cipher,
-                          std::unique_ptr<Mac> mac, uint8_t tag_size)
+                          std::unique_ptr<Mac> mac,
+                          std::unique_ptr<StatefulMacFactory> mac_factory,
+                          uint8_t tag_size)
       : ind_cpa_cipher_(std::move(ind_cpa_cipher)),
         mac_(std::move(mac)),
+        mac_factory_(std::move(mac_factory)),
         tag_size_(tag_size) {}
 
+  // Returns the MAC of (additional_data || ciphertext || aad_size_in_bits).
+  crypto::tink::util::StatusOr<std::string> ComputeTag(
+      absl::string_view additional_data, absl::string_view ciphertext) const;
+
   const std::unique_ptr<IndCpaCipher> ind_cpa_cipher_;
+  // Exactly one of mac_ and mac_factory_ is set.
   const std::unique_ptr<Mac> mac_;
+  const std::unique_ptr<StatefulMacFactory> mac_factory_;
   const uint8_t tag_size_;
 };
 
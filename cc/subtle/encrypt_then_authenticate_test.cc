@@ -21,9 +21,11 @@
 
 #include "gtest/gtest.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "tink/subtle/aes_ctr_boringssl.h"
 #include "tink/subtle/common_enums.h"
 #include "tink/subtle/hmac_boringssl.h"
+#include "tink/subtle/mac/stateful_hmac_boringssl.h"
 #include "tink/subtle/random.h"
 #include "tink/util/secret_data.h"
 #include "tink/util/status.h"
@@ -109,6 +111,26 @@ util::StatusOr<std::unique_ptr<Aead>> createAead2(
   return std::move(cipher_res.ValueOrDie());
 }
 
+// As createAead2, with an HMAC which is computed incrementally.
+util::StatusOr<std::unique_ptr<Aead>> createStatefulAead(
+    util::SecretData encryption_key, int iv_size, util::SecretData mac_key,
+    uint8_t tag_size, HashType hash_type) {
+  auto ind_cipher_res =
+      AesCtrBoringSsl::New(std::move(encryption_key), iv_size);
+  if (!ind_cipher_res.ok()) {
+    return ind_cipher_res.status();
+  }
+  auto mac_res =
+      StatefulHmacBoringSslFactory::New(hash_type, tag_size, mac_key);
+  if (!mac_res.ok()) {
+    return mac_res.status();
+  }
+  return EncryptThenAuthenticate::New(
+      std::move(ind_cipher_res.ValueOrDie()),
+      std::unique_ptr<StatefulMacFactory>(std::move(mac_res.ValueOrDie())),
+      tag_size);
+}
+
 util::StatusOr<std::unique_ptr<Aead>> createAead(int encryption_key_size,
                                                  int iv_size, int mac_key_size,
                                                  int tag_size,
@@ -137,6 +159,85 @@ TEST(AesGcmBoringSslTest, testRfcVectors) {
   }
 }
 
+TEST(EncryptThenAuthenticateTest, testRfcVectorsWithStatefulMac) {
+  for (const TestVector& test : test_vectors) {
+    util::SecretData mac_key =
+        util::SecretDataFromStringView(test::HexDecodeOrDie(test.mac_key));
+    util::SecretData enc_key =
+        util::SecretDataFromStringView(test::HexDecodeOrDie(test.enc_key));
+    std::string ct = test::HexDecodeOrDie(test.ciphertext);
+    std::string aad = test::HexDecodeOrDie(test.aad);
+    auto res = createStatefulAead(std::move(enc_key), test.iv_size,
+                                  std::move(mac_key), test.tag_size,
+                                  test.hash_type);
+    ASSERT_TRUE(res.ok()) << res.status();
+    auto pt = res.ValueOrDie()->Decrypt(ct, aad);
+    EXPECT_TRUE(pt.ok()) << pt.status();
+    ct[0] ^= 1;
+    EXPECT_FALSE(res.ValueOrDie()->Decrypt(ct, aad).ok());
+  }
+}
+
+TEST(EncryptThenAuthenticateTest, testStatefulMacInteroperates) {
+  int iv_size = 12;
+  int tag_size = 16;
+  util::SecretData encryption_key = Random::GetRandomKeyBytes(16);
+  util::SecretData mac_key = Random::GetRandomKeyBytes(16);
+  auto res = createAead2(encryption_key, iv_size, mac_key, tag_size,
+                         HashType::SHA256);
+  ASSERT_TRUE(res.ok()) << res.status();
+  auto stateful_res = createStatefulAead(encryption_key, iv_size, mac_key,
+                                         tag_size, HashType::SHA256);
+  ASSERT_TRUE(stateful_res.ok()) << stateful_res.status();
+  const Aead& cipher = *res.ValueOrDie();
+  const Aead& stateful_cipher = *stateful_res.ValueOrDie();
+
+  for (int i = 0; i < 64; i++) {
+    std::string message = Random::GetRandomBytes(i);
+    std::string aad = Random::GetRandomBytes(i / 2);
+    auto ct = stateful_cipher.Encrypt(message, aad);
+    ASSERT_TRUE(ct.ok()) << ct.status();
+    EXPECT_EQ(ct.ValueOrDie().size(), message.size() + iv_size + tag_size);
+    auto pt = cipher.Decrypt(ct.ValueOrDie(), aad);
+    ASSERT_TRUE(pt.ok()) << pt.status();
+    EXPECT_EQ(pt.ValueOrDie(), message);
+
+    ct = cipher.Encrypt(message, aad);
+    ASSERT_TRUE(ct.ok()) << ct.status();
+    pt = stateful_cipher.Decrypt(ct.ValueOrDie(), aad);
+    ASSERT_TRUE(pt.ok()) << pt.status();
+    EXPECT_EQ(pt.ValueOrDie(), message);
+  }
+}
+
+TEST(EncryptThenAuthenticateTest, testEncryptInto) {
+  int iv_size = 12;
+  int tag_size = 16;
+  auto res = createStatefulAead(Random::GetRandomKeyBytes(16), iv_size,
+                                Random::GetRandomKeyBytes(16), tag_size,
+                                HashType::SHA256);
+  ASSERT_TRUE(res.ok()) << res.status();
+  const Aead& cipher = *res.ValueOrDie();
+
+  std::string message = "Some data to encrypt.";
+  std::string aad = "Some data to authenticate.";
+  auto size_result = cipher.CiphertextSize(message.size());
+  ASSERT_TRUE(size_result.ok()) << size_result.status();
+  EXPECT_EQ(size_result.ValueOrDie(), message.size() + iv_size + tag_size);
+
+  std::string buffer(size_result.ValueOrDie(), '\0');
+  auto written = cipher.EncryptInto(message, aad, absl::MakeSpan(buffer));
+  ASSERT_TRUE(written.ok()) << written.status();
+  EXPECT_EQ(written.ValueOrDie(), buffer.size());
+  auto pt = cipher.Decrypt(buffer, aad);
+  ASSERT_TRUE(pt.ok()) << pt.status();
+  EXPECT_EQ(pt.ValueOrDie(), message);
+
+  std::string small_buffer(buffer.size() - 1, '\0');
+  EXPECT_FALSE(
+      cipher.EncryptInto(message, aad, absl::MakeSpan(small_buffer)).ok());
+}
+
 TEST(EncryptThenAuthenticateTest, testEncryptDecrypt) {
   int encryption_key_size = 16;
   int iv_size = 12;
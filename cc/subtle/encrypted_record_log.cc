@@ -0,0 +1,456 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/subtle/encrypted_record_log.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "tink/output_stream.h"
+#include "tink/random_access_stream.h"
+#include "tink/subtle/stream_segment_decrypter.h"
+#include "tink/subtle/stream_segment_encrypter.h"
+#include "tink/util/buffer.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+using ::crypto::tink::util::Status;
+using ::crypto::tink::util::StatusOr;
+
+namespace {
+
+// The trailer of a segment: the index of its first record as a big-endian
+// uint64, and the number of its records as a big-endian uint32.
+constexpr int kTrailerSize = 12;
+// The maximal size of the varint preceding a record.
+constexpr int kMaxVarintSize = 5;
+
+int VarintSize(uint32_t value) {
+  int size = 1;
+  while (value >= 0x80) {
+    value >>= 7;
+    size++;
+  }
+  return size;
+}
+
+void AppendVarint(uint32_t value, std::vector<uint8_t>* out) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<uint8_t>(value));
+}
+
+// Parses a varint at '*position' of 'data', which must end before 'end',
+// and advances '*position' past it.
+bool ParseVarint(const std::vector<uint8_t>& data, size_t end,
+                 size_t* position, uint32_t* value) {
+  *value = 0;
+  for (int i = 0; i < kMaxVarintSize; i++) {
+    if (*position >= end) return false;
+    uint8_t byte = data[(*position)++];
+    *value |= static_cast<uint32_t>(byte & 0x7f) << (7 * i);
+    if (byte < 0x80) return true;
+  }
+  return false;
+}
+
+void StoreBigEndian(uint64_t value, int size, uint8_t* out) {
+  for (int i = size - 1; i >= 0; i--) {
+    out[i] = static_cast<uint8_t>(value);
+    value >>= 8;
+  }
+}
+
+uint64_t LoadBigEndian(const uint8_t* in, int size) {
+  uint64_t value = 0;
+  for (int i = 0; i < size; i++) value = (value << 8) | in[i];
+  return value;
+}
+
+}  // namespace
+
+// static
+StatusOr<std::unique_ptr<EncryptedRecordLogWriter>>
+EncryptedRecordLogWriter::New(
+    std::unique_ptr<StreamSegmentEncrypter> segment_encrypter,
+    std::unique_ptr<crypto::tink::OutputStream> destination,
+    const Options& options) {
+  if (segment_encrypter == nullptr || destination == nullptr) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "segment_encrypter and destination must be non-null");
+  }
+  int first_segment_size = segment_encrypter->get_plaintext_segment_size() -
+                           segment_encrypter->get_ciphertext_offset() -
+                           segment_encrypter->get_header().size();
+  if (first_segment_size <= kTrailerSize + kMaxVarintSize) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "The segments are too small for records");
+  }
+  return {absl::WrapUnique(new EncryptedRecordLogWriter(
+      std::move(segment_encrypter), std::move(destination), options))};
+}
+
+EncryptedRecordLogWriter::EncryptedRecordLogWriter(
+    std::unique_ptr<StreamSegmentEncrypter> segment_encrypter,
+    std::unique_ptr<crypto::tink::OutputStream> destination,
+    const Options& options)
+    : segment_encrypter_(std::move(segment_encrypter)),
+      destination_(std::move(destination)),
+      options_(options),
+      first_segment_size_(segment_encrypter_->get_plaintext_segment_size() -
+                          segment_encrypter_->get_ciphertext_offset() -
+                          segment_encrypter_->get_header().size()),
+      segment_size_(segment_encrypter_->get_plaintext_segment_size()),
+      // The first segment is the smallest one.
+      max_record_size_(first_segment_size_ - kTrailerSize - kMaxVarintSize) {}
+
+int EncryptedRecordLogWriter::SegmentSize(int64_t segment_index) const {
+  return segment_index == 0 ? first_segment_size_ : segment_size_;
+}
+
+StatusOr<int64_t> EncryptedRecordLogWriter::Append(absl::string_view record) {
+  if (record.size() > max_record_size_) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  absl::StrCat("The record is larger than ", max_record_size_,
+                               " bytes"));
+  }
+  absl::MutexLock lock(&mutex_);
+  if (!status_.ok()) return status_;
+  if (closed_) {
+    return Status(util::error::FAILED_PRECONDITION, "The log is closed");
+  }
+  const uint32_t size = record.size();
+  if (current_records_.size() + VarintSize(size) + size >
+      SegmentSize(current_segment_index_) - kTrailerSize) {
+    EndSegment();
+  }
+  AppendVarint(size, &current_records_);
+  current_records_.insert(current_records_.end(), record.begin(),
+                          record.end());
+  return next_record_++;
+}
+
+void EncryptedRecordLogWriter::EndSegment() {
+  std::vector<uint8_t> segment;
+  segment.swap(current_records_);
+  const int segment_size = SegmentSize(current_segment_index_);
+  segment.resize(segment_size, 0);
+  StoreBigEndian(current_first_record_, 8,
+                 &segment[segment_size - kTrailerSize]);
+  StoreBigEndian(next_record_ - current_first_record_, 4,
+                 &segment[segment_size - 4]);
+  pending_segments_.push_back(std::move(segment));
+  current_segment_index_++;
+  current_first_record_ = next_record_;
+  current_records_.reserve(segment_size_);
+}
+
+Status EncryptedRecordLogWriter::Commit() {
+  mutex_.Lock();
+  const int64_t target = next_record_;
+  while (true) {
+    mutex_.Await(absl::Condition(
+        +[](bool* in_progress) { return !*in_progress; },
+        &commit_in_progress_));
+    if (!status_.ok() || committed_records_ >= target) break;
+    // Commit all records appended so far, including those of the threads
+    // which wait for this commit.
+    if (!current_records_.empty()) EndSegment();
+    std::vector<std::vector<uint8_t>> segments;
+    segments.swap(pending_segments_);
+    const int64_t records = next_record_;
+    commit_in_progress_ = true;
+    mutex_.Unlock();
+    Status status = WriteSegments(&segments, /*is_end_of_log=*/false);
+    if (status.ok() && options_.sync) status = options_.sync();
+    mutex_.Lock();
+    commit_in_progress_ = false;
+    if (status.ok()) {
+      committed_records_ = records;
+    } else {
+      status_ = status;
+    }
+  }
+  Status status = status_;
+  mutex_.Unlock();
+  return status;
+}
+
+Status EncryptedRecordLogWriter::Close() {
+  std::vector<std::vector<uint8_t>> segments;
+  {
+    absl::MutexLock lock(&mutex_);
+    if (!status_.ok()) return status_;
+    if (closed_) {
+      return Status(util::error::FAILED_PRECONDITION, "The log is closed");
+    }
+    closed_ = true;
+    // The last segment is written even if it is empty, as it marks the end.
+    EndSegment();
+    segments.swap(pending_segments_);
+  }
+  Status status = WriteSegments(&segments, /*is_end_of_log=*/true);
+  if (status.ok()) status = destination_->Close();
+  if (status.ok() && options_.sync) status = options_.sync();
+  absl::MutexLock lock(&mutex_);
+  if (!status.ok()) status_ = status;
+  return status;
+}
+
+Status EncryptedRecordLogWriter::WriteSegments(
+    std::vector<std::vector<uint8_t>>* segments, bool is_end_of_log) {
+  if (!header_written_) {
+    const std::vector<uint8_t>& header = segment_encrypter_->get_header();
+    Status status = WriteBytes(header.data(), header.size());
+    if (!status.ok()) return status;
+    header_written_ = true;
+  }
+  std::vector<uint8_t> ciphertext;
+  for (size_t i = 0; i < segments->size(); i++) {
+    const bool is_last_segment = is_end_of_log && i + 1 == segments->size();
+    Status status = segment_encrypter_->EncryptSegment(
+        (*segments)[i], is_last_segment, &ciphertext);
+    if (!status.ok()) return status;
+    status = WriteBytes(ciphertext.data(), ciphertext.size());
+    if (!status.ok()) return status;
+  }
+  return util::OkStatus();
+}
+
+Status EncryptedRecordLogWriter::WriteBytes(const uint8_t* data,
+                                            int64_t size) {
+  while (size > 0) {
+    void* buffer;
+    StatusOr<int> next_result = destination_->Next(&buffer);
+    if (!next_result.ok()) return next_result.status();
+    int64_t count = std::min<int64_t>(next_result.ValueOrDie(), size);
+    std::memcpy(buffer, data, count);
+    data += count;
+    size -= count;
+    if (count < next_result.ValueOrDie()) {
+      destination_->BackUp(next_result.ValueOrDie() - count);
+    }
+  }
+  return util::OkStatus();
+}
+
+// static
+StatusOr<std::unique_ptr<EncryptedRecordLogReader>>
+EncryptedRecordLogReader::New(
+    std::unique_ptr<StreamSegmentDecrypter> segment_decrypter,
+    std::unique_ptr<crypto::tink::RandomAccessStream> source) {
+  if (segment_decrypter == nullptr || source == nullptr) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "segment_decrypter and source must be non-null");
+  }
+  auto reader = absl::WrapUnique(new EncryptedRecordLogReader(
+      std::move(segment_decrypter), std::move(source)));
+  StatusOr<int64_t> size_result = reader->source_->size();
+  if (!size_result.ok()) return size_result.status();
+  // Each segment, also the last one, has the full size, so a shorter one
+  // at the end was not completely written.
+  reader->segment_count_ =
+      size_result.ValueOrDie() / reader->ciphertext_segment_size_;
+  if (reader->segment_count_ == 0) return std::move(reader);
+
+  auto buffer_result = util::Buffer::New(reader->header_size_);
+  if (!buffer_result.ok()) return buffer_result.status();
+  util::Buffer& header = *buffer_result.ValueOrDie();
+  Status status = reader->source_->PRead(reader->ciphertext_offset_,
+                                         reader->header_size_, &header);
+  if (!status.ok()) return status;
+  status = reader->segment_decrypter_->Init(std::vector<uint8_t>(
+      header.get_mem_block(), header.get_mem_block() + header.size()));
+  if (!status.ok()) return status;
+
+  absl::MutexLock lock(&reader->mutex_);
+  Segment& last_segment = reader->cached_segment_;
+  const int64_t last_index = reader->segment_count_ - 1;
+  status = reader->ReadSegment(last_index, &last_segment);
+  if (!status.ok()) {
+    // A closed log ends with a segment marked as the last one.
+    reader->is_closed_ = true;
+    Status closed_status = reader->ReadSegment(last_index, &last_segment);
+    if (!closed_status.ok()) return status;
+  }
+  reader->record_count_ =
+      last_segment.first_record + last_segment.record_count;
+  return std::move(reader);
+}
+
+EncryptedRecordLogReader::EncryptedRecordLogReader(
+    std::unique_ptr<StreamSegmentDecrypter> segment_decrypter,
+    std::unique_ptr<crypto::tink::RandomAccessStream> source)
+    : segment_decrypter_(std::move(segment_decrypter)),
+      source_(std::move(source)),
+      header_size_(segment_decrypter_->get_header_size()),
+      ciphertext_offset_(segment_decrypter_->get_ciphertext_offset()),
+      ciphertext_segment_size_(
+          segment_decrypter_->get_ciphertext_segment_size()) {}
+
+Status EncryptedRecordLogReader::ReadSegment(int64_t segment_index,
+                                             Segment* segment) {
+  segment->index = -1;
+  int64_t position = segment_index * ciphertext_segment_size_;
+  int count = ciphertext_segment_size_;
+  if (segment_index == 0) {
+    position = ciphertext_offset_ + header_size_;
+    count -= position;
+  }
+  auto buffer_result = util::Buffer::New(count);
+  if (!buffer_result.ok()) return buffer_result.status();
+  util::Buffer& ciphertext = *buffer_result.ValueOrDie();
+  Status status = source_->PRead(position, count, &ciphertext);
+  if (!status.ok()) return status;
+
+  const bool is_last_segment =
+      is_closed_ && segment_index + 1 == segment_count_;
+  std::vector<uint8_t>& plaintext = segment->plaintext;
+  plaintext.assign(ciphertext.get_mem_block(),
+                   ciphertext.get_mem_block() + ciphertext.size());
+  status = segment_decrypter_->DecryptSegmentInPlace(
+      segment_index, is_last_segment, &plaintext);
+  if (status.error_code() == util::error::UNIMPLEMENTED) {
+    std::vector<uint8_t> ciphertext_segment;
+    ciphertext_segment.swap(plaintext);
+    status = segment_decrypter_->DecryptSegment(
+        ciphertext_segment, segment_index, is_last_segment, &plaintext);
+  }
+  if (!status.ok()) return status;
+
+  Status invalid_segment(
+      util::error::INVALID_ARGUMENT,
+      absl::StrCat("Segment ", segment_index, " is not a record segment"));
+  if (plaintext.size() < kTrailerSize) return invalid_segment;
+  const size_t records_end = plaintext.size() - kTrailerSize;
+  segment->first_record = LoadBigEndian(&plaintext[records_end], 8);
+  segment->record_count = LoadBigEndian(&plaintext[records_end + 8], 4);
+  if (segment->first_record > std::numeric_limits<int64_t>::max() / 2 ||
+      (segment_index == 0 && segment->first_record != 0)) {
+    return invalid_segment;
+  }
+  segment->records.clear();
+  size_t position_in_segment = 0;
+  for (int64_t i = 0; i < segment->record_count; i++) {
+    uint32_t size;
+    if (!ParseVarint(plaintext, records_end, &position_in_segment, &size) ||
+        size > records_end - position_in_segment) {
+      return invalid_segment;
+    }
+    segment->records.emplace_back(position_in_segment, size);
+    position_in_segment += size;
+  }
+  segment->index = segment_index;
+  return util::OkStatus();
+}
+
+Status EncryptedRecordLogReader::FindSegment(int64_t index) {
+  Segment& segment = cached_segment_;
+  auto holds_index = [&segment, index]() {
+    return segment.index >= 0 && segment.first_record <= index &&
+           index < segment.first_record + segment.record_count;
+  };
+  if (holds_index()) return util::OkStatus();
+  // Sequential reads continue in the next segment.
+  if (segment.index >= 0 && segment.index + 1 < segment_count_ &&
+      index >= segment.first_record + segment.record_count) {
+    Status status = ReadSegment(segment.index + 1, &segment);
+    if (!status.ok()) return status;
+    if (holds_index()) return util::OkStatus();
+  }
+  // Searches for the last segment whose first record is at most 'index'.
+  int64_t low = 0;
+  int64_t high = segment_count_ - 1;
+  while (low < high) {
+    int64_t middle = low + (high - low + 1) / 2;
+    Status status = ReadSegment(middle, &segment);
+    if (!status.ok()) return status;
+    if (segment.first_record <= index) {
+      low = middle;
+    } else {
+      high = middle - 1;
+    }
+  }
+  if (segment.index != low) {
+    Status status = ReadSegment(low, &segment);
+    if (!status.ok()) return status;
+  }
+  if (!holds_index()) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  absl::StrCat("No segment holds record ", index));
+  }
+  return util::OkStatus();
+}
+
+// static
+std::string EncryptedRecordLogReader::RecordOf(const Segment& segment,
+                                               int64_t index) {
+  const std::pair<size_t, size_t>& record =
+      segment.records[index - segment.first_record];
+  return std::string(
+      reinterpret_cast<const char*>(&segment.plaintext[record.first]),
+      record.second);
+}
+
+StatusOr<std::string> EncryptedRecordLogReader::ReadRecord(int64_t index) {
+  if (index < 0 || index >= record_count_) {
+    return Status(util::error::OUT_OF_RANGE,
+                  absl::StrCat("There is no record ", index));
+  }
+  absl::MutexLock lock(&mutex_);
+  Status status = FindSegment(index);
+  if (!status.ok()) return status;
+  return RecordOf(cached_segment_, index);
+}
+
+StatusOr<std::vector<std::string>> EncryptedRecordLogReader::ReadRecords(
+    int64_t first_index, int64_t max_count) {
+  if (first_index < 0 || first_index > record_count_ || max_count < 0) {
+    return Status(util::error::OUT_OF_RANGE,
+                  absl::StrCat("There is no record ", first_index));
+  }
+  const int64_t end = first_index + std::min(max_count,
+                                             record_count_ - first_index);
+  std::vector<std::string> records;
+  absl::MutexLock lock(&mutex_);
+  for (int64_t index = first_index; index < end; index++) {
+    Status status = FindSegment(index);
+    if (!status.ok()) return status;
+    records.push_back(RecordOf(cached_segment_, index));
+  }
+  return std::move(records);
+}
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,220 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TINK_SUBTLE_ENCRYPTED_RECORD_LOG_H_
+#define TINK_SUBTLE_ENCRYPTED_RECORD_LOG_H_
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "tink/output_stream.h"
+#include "tink/random_access_stream.h"
+#include "tink/subtle/stream_segment_decrypter.h"
+#include "tink/subtle/stream_segment_encrypter.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+// An append-only log of small records, encrypted as a ciphertext stream of
+// a StreamingAead. Unlike an Aead ciphertext per record, the records share
+// the nonce and tag of their segment, and unlike a plain ciphertext stream,
+// any record can be read without decrypting the ones before it, and the log
+// stays readable after the writer crashed.
+//
+// The log has the layout of a ciphertext stream, where every segment has
+// the full ciphertext segment size. The plaintext of a segment holds whole
+// records, each preceded by its size as a varint, then zero padding, and a
+// trailer with the index of the first record of the segment and the number
+// of records in it. The trailers are authenticated with the segments, and
+// form a sparse index over which the reader searches for a record.
+//
+// Writers append records to the current segment and write segments only on
+// Commit(), so that one commit writes the records of many appends. A commit
+// ends the current segment, even if it is not full, so commits should be
+// combined, e.g. by committing from a single thread at a fixed rate, or
+// from many threads at once, which Commit() groups into one write.
+//
+// Only Close() marks its segment as the last one. The log of a writer which
+// did not close it ends with its last complete segment: a partially written
+// segment is ignored by the reader. Note that such a log may also have been
+// truncated at a segment boundary by an attacker, which the reader reports
+// with is_closed() returning false.
+class EncryptedRecordLogWriter {
+ public:
+  struct Options {
+    // If set, called after the segments of a commit are written to the
+    // destination, e.g. to fsync the underlying file. While it runs, other
+    // threads can append records for the next commit.
+    std::function<crypto::tink::util::Status()> sync;
+  };
+
+  // Returns a writer which encrypts the log with 'segment_encrypter' to
+  // 'destination'. If the segment encrypter has a non-zero ciphertext
+  // offset, the caller writes the bytes before the header, as with
+  // StreamingAeadEncryptingStream.
+  static crypto::tink::util::StatusOr<std::unique_ptr<EncryptedRecordLogWriter>>
+  New(std::unique_ptr<StreamSegmentEncrypter> segment_encrypter,
+      std::unique_ptr<crypto::tink::OutputStream> destination,
+      const Options& options);
+
+  // Appends 'record' to the log, and returns its index, starting at 0 for
+  // the first record. The record is only written by the next Commit().
+  // Records larger than max_record_size() are rejected. Thread-safe.
+  crypto::tink::util::StatusOr<int64_t> Append(absl::string_view record);
+
+  // Writes all records appended before the call. If another thread commits
+  // already, waits for its commit and, if needed, commits the remaining
+  // records together with those of the other waiting threads. Thread-safe.
+  // After a failed commit, the writer fails all further calls.
+  crypto::tink::util::Status Commit();
+
+  // Commits the remaining records, marks the end of the log and closes the
+  // destination. Must be called after all other calls have returned.
+  crypto::tink::util::Status Close();
+
+  // The maximal size of a record.
+  int64_t max_record_size() const { return max_record_size_; }
+
+ private:
+  EncryptedRecordLogWriter(
+      std::unique_ptr<StreamSegmentEncrypter> segment_encrypter,
+      std::unique_ptr<crypto::tink::OutputStream> destination,
+      const Options& options);
+
+  // Returns the plaintext size of the segment 'segment_index'.
+  int SegmentSize(int64_t segment_index) const;
+
+  // Moves the records of the current segment to a plaintext segment in
+  // pending_segments_, and starts the next segment.
+  void EndSegment() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Encrypts and writes 'segments', marking the last of them as the last
+  // segment of the log if 'is_end_of_log' is true. Only called by one thread
+  // at a time.
+  crypto::tink::util::Status WriteSegments(
+      std::vector<std::vector<uint8_t>>* segments, bool is_end_of_log);
+
+  crypto::tink::util::Status WriteBytes(const uint8_t* data, int64_t size);
+
+  const std::unique_ptr<StreamSegmentEncrypter> segment_encrypter_;
+  const std::unique_ptr<crypto::tink::OutputStream> destination_;
+  const Options options_;
+  const int first_segment_size_;
+  const int segment_size_;
+  const int64_t max_record_size_;
+  // Whether the header was written, only accessed by the committing thread.
+  bool header_written_ = false;
+
+  absl::Mutex mutex_;
+  // The plaintext of the records of the current segment.
+  std::vector<uint8_t> current_records_ ABSL_GUARDED_BY(mutex_);
+  int64_t current_segment_index_ ABSL_GUARDED_BY(mutex_) = 0;
+  int64_t current_first_record_ ABSL_GUARDED_BY(mutex_) = 0;
+  // The index of the next appended record.
+  int64_t next_record_ ABSL_GUARDED_BY(mutex_) = 0;
+  // Ended segments, which the next commit writes.
+  std::vector<std::vector<uint8_t>> pending_segments_ ABSL_GUARDED_BY(mutex_);
+  // The number of records which were written by commits.
+  int64_t committed_records_ ABSL_GUARDED_BY(mutex_) = 0;
+  bool commit_in_progress_ ABSL_GUARDED_BY(mutex_) = false;
+  bool closed_ ABSL_GUARDED_BY(mutex_) = false;
+  crypto::tink::util::Status status_ ABSL_GUARDED_BY(mutex_);
+};
+
+// Reads the records of a log written by EncryptedRecordLogWriter. Reading a
+// record decrypts the segments visited by a binary search over the segment
+// trailers, and the segment holding the record; the last decrypted segment
+// is cached, so that consecutive records are read cheaply. Thread-safe.
+class EncryptedRecordLogReader {
+ public:
+  // Returns a reader of the log in 'source', decrypting it with
+  // 'segment_decrypter'. Reads the header and the last complete segment.
+  static crypto::tink::util::StatusOr<std::unique_ptr<EncryptedRecordLogReader>>
+  New(std::unique_ptr<StreamSegmentDecrypter> segment_decrypter,
+      std::unique_ptr<crypto::tink::RandomAccessStream> source);
+
+  // The number of records in the log.
+  int64_t record_count() const { return record_count_; }
+
+  // Whether the writer closed the log. If not, the log may end with a
+  // partially written segment, which is ignored, or it may be truncated.
+  bool is_closed() const { return is_closed_; }
+
+  // Returns the record with index 'index', or OUT_OF_RANGE if there is none.
+  crypto::tink::util::StatusOr<std::string> ReadRecord(int64_t index);
+
+  // Returns up to 'max_count' consecutive records, starting with the record
+  // with index 'first_index', which must be at most record_count().
+  crypto::tink::util::StatusOr<std::vector<std::string>> ReadRecords(
+      int64_t first_index, int64_t max_count);
+
+ private:
+  // A decrypted segment.
+  struct Segment {
+    int64_t index = -1;
+    int64_t first_record = 0;
+    int64_t record_count = 0;
+    // The position in 'plaintext' and the size of each record.
+    std::vector<std::pair<size_t, size_t>> records;
+    std::vector<uint8_t> plaintext;
+  };
+
+  EncryptedRecordLogReader(
+      std::unique_ptr<StreamSegmentDecrypter> segment_decrypter,
+      std::unique_ptr<crypto::tink::RandomAccessStream> source);
+
+  // Decrypts and parses the segment 'segment_index' into '*segment'.
+  crypto::tink::util::Status ReadSegment(int64_t segment_index,
+                                         Segment* segment)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  // Returns the record 'index' of 'segment', which must hold it.
+  static std::string RecordOf(const Segment& segment, int64_t index);
+
+  // Makes cached_segment_ the segment holding the record 'index', which
+  // must be less than record_count_.
+  crypto::tink::util::Status FindSegment(int64_t index)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  const std::unique_ptr<StreamSegmentDecrypter> segment_decrypter_;
+  const std::unique_ptr<crypto::tink::RandomAccessStream> source_;
+  int header_size_ = 0;
+  int ciphertext_offset_ = 0;
+  int ciphertext_segment_size_ = 0;
+  int64_t segment_count_ = 0;
+  int64_t record_count_ = 0;
+  bool is_closed_ = false;
+
+  absl::Mutex mutex_;
+  Segment cached_segment_ ABSL_GUARDED_BY(mutex_);
+};
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_SUBTLE_ENCRYPTED_RECORD_LOG_H_
@@ -0,0 +1,384 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/subtle/encrypted_record_log.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "tink/output_stream.h"
+#include "tink/random_access_stream.h"
+#include "tink/subtle/aes_ctr_hmac_streaming.h"
+#include "tink/subtle/common_enums.h"
+#include "tink/subtle/nonce_based_streaming_aead.h"
+#include "tink/subtle/random.h"
+#include "tink/subtle/test_util.h"
+#include "tink/util/buffer.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "tink/util/test_matchers.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+namespace {
+
+using ::crypto::tink::subtle::test::DummyStreamingAead;
+using ::crypto::tink::subtle::test::DummyStreamSegmentEncrypter;
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::testing::Eq;
+using ::testing::Gt;
+using ::testing::IsFalse;
+using ::testing::IsTrue;
+using ::testing::Lt;
+using ::testing::SizeIs;
+
+constexpr int kPtSegmentSize = 100;
+constexpr int kHeaderSize = 10;
+constexpr int kCtSegmentSize =
+    kPtSegmentSize + DummyStreamSegmentEncrypter::kSegmentTagSize;
+
+// An OutputStream appending to a string, which holds everything written so
+// far, like a file after a crash of the writer.
+class StringOutputStream : public OutputStream {
+ public:
+  // The size of the buffers returned by Next().
+  enum { kBufferSize = 64 };
+
+  explicit StringOutputStream(std::string* data) : data_(data) {}
+
+  util::StatusOr<int> Next(void** data) override {
+    size_t position = data_->size();
+    data_->resize(position + kBufferSize);
+    *data = &(*data_)[position];
+    return kBufferSize;
+  }
+
+  void BackUp(int count) override { data_->resize(data_->size() - count); }
+
+  util::Status Close() override { return util::OkStatus(); }
+
+  int64_t Position() const override { return data_->size(); }
+
+ private:
+  std::string* const data_;
+};
+
+// A RandomAccessStream reading from a string.
+class StringRandomAccessStream : public RandomAccessStream {
+ public:
+  explicit StringRandomAccessStream(std::string data)
+      : data_(std::move(data)) {}
+
+  util::Status PRead(int64_t position, int count,
+                     util::Buffer* dest_buffer) override {
+    if (position >= data_.size()) {
+      dest_buffer->set_size(0).IgnoreError();
+      return util::Status(util::error::OUT_OF_RANGE, "EOF");
+    }
+    int read_count = std::min<int64_t>(count, data_.size() - position);
+    std::memcpy(dest_buffer->get_mem_block(), data_.data() + position,
+                read_count);
+    auto status = dest_buffer->set_size(read_count);
+    if (!status.ok()) return status;
+    if (read_count < count) {
+      return util::Status(util::error::OUT_OF_RANGE, "EOF");
+    }
+    return util::OkStatus();
+  }
+
+  util::StatusOr<int64_t> size() override { return data_.size(); }
+
+ private:
+  const std::string data_;
+};
+
+std::string Record(int64_t index) {
+  // Records of different sizes, some of them spanning a varint boundary.
+  return absl::StrCat(index, ":", std::string((index * 37) % 60, 'r'));
+}
+
+std::unique_ptr<EncryptedRecordLogWriter> NewWriter(
+    NonceBasedStreamingAead* saead, std::string* log,
+    const EncryptedRecordLogWriter::Options& options =
+        EncryptedRecordLogWriter::Options()) {
+  auto writer_result = saead->NewRecordLogWriter(
+      absl::make_unique<StringOutputStream>(log), "aad", options);
+  EXPECT_THAT(writer_result.status(), IsOk());
+  return std::move(writer_result.ValueOrDie());
+}
+
+std::unique_ptr<EncryptedRecordLogReader> NewReader(
+    NonceBasedStreamingAead* saead, const std::string& log) {
+  auto reader_result = saead->NewRecordLogReader(
+      absl::make_unique<StringRandomAccessStream>(log), "aad");
+  EXPECT_THAT(reader_result.status(), IsOk());
+  if (!reader_result.ok()) return nullptr;
+  return std::move(reader_result.ValueOrDie());
+}
+
+void ExpectRecords(EncryptedRecordLogReader* reader, int64_t count) {
+  ASSERT_THAT(reader->record_count(), Eq(count));
+  // Out of order, to exercise the search.
+  for (int64_t i = 0; i < count; i++) {
+    int64_t index = (i * 7919) % count;
+    auto record_result = reader->ReadRecord(index);
+    ASSERT_THAT(record_result.status(), IsOk()) << index;
+    EXPECT_THAT(record_result.ValueOrDie(), Eq(Record(index)));
+  }
+  auto records_result = reader->ReadRecords(0, count + 10);
+  ASSERT_THAT(records_result.status(), IsOk());
+  ASSERT_THAT(records_result.ValueOrDie(), SizeIs(count));
+  for (int64_t i = 0; i < count; i++) {
+    EXPECT_THAT(records_result.ValueOrDie()[i], Eq(Record(i)));
+  }
+}
+
+TEST(EncryptedRecordLogTest, ReadsRecords) {
+  for (int ct_offset : {0, 5}) {
+    SCOPED_TRACE(absl::StrCat("ct_offset: ", ct_offset));
+    DummyStreamingAead saead(kPtSegmentSize, kHeaderSize, ct_offset);
+    std::string log(ct_offset, 'o');
+    auto writer = NewWriter(&saead, &log);
+    for (int64_t i = 0; i < 500; i++) {
+      auto index_result = writer->Append(Record(i));
+      ASSERT_THAT(index_result.status(), IsOk());
+      EXPECT_THAT(index_result.ValueOrDie(), Eq(i));
+      if (i % 37 == 0) {
+        ASSERT_THAT(writer->Commit(), IsOk());
+      }
+    }
+    ASSERT_THAT(writer->Close(), IsOk());
+    // Every segment has the full size.
+    EXPECT_THAT(log.size() % kCtSegmentSize, Eq(0));
+
+    auto reader = NewReader(&saead, log);
+    ASSERT_THAT(reader, testing::NotNull());
+    EXPECT_THAT(reader->is_closed(), IsTrue());
+    ExpectRecords(reader.get(), 500);
+    EXPECT_THAT(reader->ReadRecord(500).status(),
+                StatusIs(util::error::OUT_OF_RANGE));
+    EXPECT_THAT(reader->ReadRecord(-1).status(),
+                StatusIs(util::error::OUT_OF_RANGE));
+  }
+}
+
+TEST(EncryptedRecordLogTest, ReadsCommittedRecordsAfterCrash) {
+  DummyStreamingAead saead(kPtSegmentSize, kHeaderSize, 0);
+  std::string log;
+  auto writer = NewWriter(&saead, &log);
+  for (int64_t i = 0; i < 100; i++) {
+    ASSERT_THAT(writer->Append(Record(i)).status(), IsOk());
+  }
+  ASSERT_THAT(writer->Commit(), IsOk());
+  for (int64_t i = 100; i < 150; i++) {
+    ASSERT_THAT(writer->Append(Record(i)).status(), IsOk());
+  }
+  // The writer crashes while writing a segment.
+  std::string crashed_log = log + std::string(kCtSegmentSize / 2, 'x');
+
+  auto reader = NewReader(&saead, crashed_log);
+  ASSERT_THAT(reader, testing::NotNull());
+  EXPECT_THAT(reader->is_closed(), IsFalse());
+  ExpectRecords(reader.get(), 100);
+
+  // The writer continues, and the records of the next commit are readable.
+  ASSERT_THAT(writer->Commit(), IsOk());
+  reader = NewReader(&saead, log);
+  ASSERT_THAT(reader, testing::NotNull());
+  EXPECT_THAT(reader->is_closed(), IsFalse());
+  ExpectRecords(reader.get(), 150);
+}
+
+TEST(EncryptedRecordLogTest, CommitsEndTheCurrentSegment) {
+  DummyStreamingAead saead(kPtSegmentSize, kHeaderSize, 0);
+  std::string log;
+  auto writer = NewWriter(&saead, &log);
+  ASSERT_THAT(writer->Commit(), IsOk());
+  EXPECT_THAT(log, Eq(""));
+  for (int64_t i = 0; i < 3; i++) {
+    ASSERT_THAT(writer->Append("x").status(), IsOk());
+    ASSERT_THAT(writer->Commit(), IsOk());
+    EXPECT_THAT(log.size(), Eq((i + 1) * kCtSegmentSize));
+  }
+  // Nothing to commit.
+  ASSERT_THAT(writer->Commit(), IsOk());
+  EXPECT_THAT(log.size(), Eq(3 * kCtSegmentSize));
+}
+
+TEST(EncryptedRecordLogTest, GroupsConcurrentCommits) {
+  DummyStreamingAead saead(kPtSegmentSize, kHeaderSize, 0);
+  std::string log;
+  int syncs = 0;
+  EncryptedRecordLogWriter::Options options;
+  options.sync = [&syncs]() {
+    syncs++;
+    return util::OkStatus();
+  };
+  auto writer = NewWriter(&saead, &log, options);
+  const int kThreads = 8;
+  const int kRecordsPerThread = 200;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; t++) {
+    threads.emplace_back([&writer, t]() {
+      for (int i = 0; i < kRecordsPerThread; i++) {
+        ASSERT_THAT(writer->Append(absl::StrCat(t, ":", i)).status(), IsOk());
+        ASSERT_THAT(writer->Commit(), IsOk());
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  ASSERT_THAT(writer->Close(), IsOk());
+  EXPECT_THAT(syncs, Gt(0));
+  EXPECT_THAT(syncs, Lt(kThreads * kRecordsPerThread + 2));
+
+  auto reader = NewReader(&saead, log);
+  ASSERT_THAT(reader, testing::NotNull());
+  ASSERT_THAT(reader->record_count(), Eq(kThreads * kRecordsPerThread));
+  auto records_result = reader->ReadRecords(0, reader->record_count());
+  ASSERT_THAT(records_result.status(), IsOk());
+  // The records of each thread are in the order they were appended.
+  std::vector<int> next_record(kThreads, 0);
+  for (const std::string& record : records_result.ValueOrDie()) {
+    int t = record[0] - '0';
+    EXPECT_THAT(record, Eq(absl::StrCat(t, ":", next_record[t]++)));
+  }
+}
+
+TEST(EncryptedRecordLogTest, EmptyLogs) {
+  DummyStreamingAead saead(kPtSegmentSize, kHeaderSize, 0);
+  auto reader = NewReader(&saead, "");
+  ASSERT_THAT(reader, testing::NotNull());
+  EXPECT_THAT(reader->record_count(), Eq(0));
+  EXPECT_THAT(reader->is_closed(), IsFalse());
+  EXPECT_THAT(reader->ReadRecord(0).status(),
+              StatusIs(util::error::OUT_OF_RANGE));
+
+  std::string log;
+  auto writer = NewWriter(&saead, &log);
+  ASSERT_THAT(writer->Close(), IsOk());
+  reader = NewReader(&saead, log);
+  ASSERT_THAT(reader, testing::NotNull());
+  EXPECT_THAT(reader->record_count(), Eq(0));
+  EXPECT_THAT(reader->is_closed(), IsTrue());
+  auto records_result = reader->ReadRecords(0, 10);
+  ASSERT_THAT(records_result.status(), IsOk());
+  EXPECT_THAT(records_result.ValueOrDie(), SizeIs(0));
+}
+
+TEST(EncryptedRecordLogTest, RejectsLargeRecordsAndClosedLogs) {
+  DummyStreamingAead saead(kPtSegmentSize, kHeaderSize, 0);
+  std::string log;
+  auto writer = NewWriter(&saead, &log);
+  const int64_t max_size = writer->max_record_size();
+  ASSERT_THAT(max_size, Gt(0));
+  EXPECT_THAT(writer->Append(std::string(max_size + 1, 'a')).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  ASSERT_THAT(writer->Append(std::string(max_size, 'a')).status(), IsOk());
+  ASSERT_THAT(writer->Append(std::string(max_size, 'b')).status(), IsOk());
+  ASSERT_THAT(writer->Close(), IsOk());
+  EXPECT_THAT(writer->Append("c").status(),
+              StatusIs(util::error::FAILED_PRECONDITION));
+  EXPECT_THAT(writer->Close(), StatusIs(util::error::FAILED_PRECONDITION));
+
+  auto reader = NewReader(&saead, log);
+  ASSERT_THAT(reader, testing::NotNull());
+  auto record_result = reader->ReadRecord(1);
+  ASSERT_THAT(record_result.status(), IsOk());
+  EXPECT_THAT(record_result.ValueOrDie(), Eq(std::string(max_size, 'b')));
+}
+
+TEST(EncryptedRecordLogTest, DetectsModifiedSegments) {
+  DummyStreamingAead saead(kPtSegmentSize, kHeaderSize, 0);
+  std::string log;
+  auto writer = NewWriter(&saead, &log);
+  for (int64_t i = 0; i < 100; i++) {
+    ASSERT_THAT(writer->Append(Record(i)).status(), IsOk());
+  }
+  ASSERT_THAT(writer->Close(), IsOk());
+  const int64_t segments = log.size() / kCtSegmentSize;
+  ASSERT_THAT(segments, Gt(3));
+
+  // Swapping two segments breaks their segment numbers.
+  std::string swapped = log;
+  std::swap_ranges(swapped.begin() + kCtSegmentSize,
+                   swapped.begin() + 2 * kCtSegmentSize,
+                   swapped.begin() + 2 * kCtSegmentSize);
+  auto reader = NewReader(&saead, swapped);
+  ASSERT_THAT(reader, testing::NotNull());
+  auto records_result = reader->ReadRecords(0, 100);
+  EXPECT_THAT(records_result.status(), StatusIs(util::error::INVALID_ARGUMENT));
+
+  // Truncating the log at a segment boundary loses the end marker.
+  reader = NewReader(&saead, log.substr(0, (segments - 1) * kCtSegmentSize));
+  ASSERT_THAT(reader, testing::NotNull());
+  EXPECT_THAT(reader->is_closed(), IsFalse());
+  EXPECT_THAT(reader->record_count(), Lt(100));
+}
+
+TEST(EncryptedRecordLogTest, AesCtrHmacStreaming) {
+  AesCtrHmacStreaming::Params params;
+  params.ikm = Random::GetRandomKeyBytes(32);
+  params.hkdf_algo = SHA256;
+  params.key_size = 32;
+  params.ciphertext_segment_size = 512;
+  params.ciphertext_offset = 0;
+  params.tag_algo = SHA256;
+  params.tag_size = 16;
+  auto saead_result = AesCtrHmacStreaming::New(std::move(params));
+  ASSERT_THAT(saead_result.status(), IsOk());
+  NonceBasedStreamingAead* saead = saead_result.ValueOrDie().get();
+
+  std::string log;
+  auto writer = NewWriter(saead, &log);
+  for (int64_t i = 0; i < 1000; i++) {
+    ASSERT_THAT(writer->Append(Record(i)).status(), IsOk());
+    if (i % 100 == 0) {
+      ASSERT_THAT(writer->Commit(), IsOk());
+    }
+  }
+  ASSERT_THAT(writer->Commit(), IsOk());
+  auto reader = NewReader(saead, log);
+  ASSERT_THAT(reader, testing::NotNull());
+  EXPECT_THAT(reader->is_closed(), IsFalse());
+  ExpectRecords(reader.get(), 1000);
+
+  ASSERT_THAT(writer->Close(), IsOk());
+  reader = NewReader(saead, log);
+  ASSERT_THAT(reader, testing::NotNull());
+  EXPECT_THAT(reader->is_closed(), IsTrue());
+  ExpectRecords(reader.get(), 1000);
+
+  auto other_reader_result = saead->NewRecordLogReader(
+      absl::make_unique<StringRandomAccessStream>(log), "other aad");
+  EXPECT_FALSE(other_reader_result.ok());
+}
+
+}  // namespace
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
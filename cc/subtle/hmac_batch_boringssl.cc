@@ -0,0 +1,152 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/subtle/hmac_batch_boringssl.h"
+
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "openssl/mem.h"
+#include "openssl/sha.h"
+#include "tink/subtle/common_enums.h"
+#include "tink/subtle/subtle_util.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+namespace {
+
+// HMAC (RFC 2104) on the low level SHA functions of BoringSSL, for a hash
+// with the context type Ctx.
+template <typename Ctx, int (*Init)(Ctx*),
+          int (*Update)(Ctx*, const void*, size_t),
+          int (*Final)(uint8_t*, Ctx*), size_t kDigestSize, size_t kBlockSize>
+class HmacBatchImpl : public HmacBatchBoringSsl {
+ public:
+  explicit HmacBatchImpl(const util::SecretData& key)
+      : HmacBatchBoringSsl(kDigestSize) {
+    uint8_t block[kBlockSize] = {0};
+    if (key.size() > kBlockSize) {
+      Ctx ctx;
+      Init(&ctx);
+      Update(&ctx, key.data(), key.size());
+      Final(block, &ctx);
+      OPENSSL_cleanse(&ctx, sizeof(ctx));
+    } else {
+      std::memcpy(block, key.data(), key.size());
+    }
+    for (size_t i = 0; i < kBlockSize; i++) block[i] ^= 0x36;
+    Init(&inner_);
+    Update(&inner_, block, kBlockSize);
+    for (size_t i = 0; i < kBlockSize; i++) block[i] ^= 0x36 ^ 0x5c;
+    Init(&outer_);
+    Update(&outer_, block, kBlockSize);
+    OPENSSL_cleanse(block, sizeof(block));
+  }
+
+  ~HmacBatchImpl() override {
+    OPENSSL_cleanse(&inner_, sizeof(inner_));
+    OPENSSL_cleanse(&outer_, sizeof(outer_));
+  }
+
+  void Compute(absl::string_view data, uint8_t* out) const override {
+    uint8_t inner_digest[kDigestSize];
+    Ctx ctx = inner_;
+    if (!data.empty()) Update(&ctx, data.data(), data.size());
+    Final(inner_digest, &ctx);
+    ctx = outer_;
+    Update(&ctx, inner_digest, kDigestSize);
+    Final(out, &ctx);
+    OPENSSL_cleanse(&ctx, sizeof(ctx));
+  }
+
+ private:
+  // The hash states after absorbing the key xor ipad and opad, respectively.
+  Ctx inner_;
+  Ctx outer_;
+};
+
+using HmacSha1 = HmacBatchImpl<SHA_CTX, SHA1_Init, SHA1_Update, SHA1_Final,
+                               SHA_DIGEST_LENGTH, SHA_CBLOCK>;
+using HmacSha256 =
+    HmacBatchImpl<SHA256_CTX, SHA256_Init, SHA256_Update, SHA256_Final,
+                  SHA256_DIGEST_LENGTH, SHA256_CBLOCK>;
+using HmacSha384 =
+    HmacBatchImpl<SHA512_CTX, SHA384_Init, SHA384_Update, SHA384_Final,
+                  SHA384_DIGEST_LENGTH, SHA512_CBLOCK>;
+using HmacSha512 =
+    HmacBatchImpl<SHA512_CTX, SHA512_Init, SHA512_Update, SHA512_Final,
+                  SHA512_DIGEST_LENGTH, SHA512_CBLOCK>;
+
+}  // namespace
+
+// static
+util::StatusOr<std::unique_ptr<HmacBatchBoringSsl>> HmacBatchBoringSsl::New(
+    HashType hash_type, const util::SecretData& key) {
+  if (key.size() < kMinKeySize) {
+    return util::Status(util::error::INVALID_ARGUMENT, "invalid key size");
+  }
+  switch (hash_type) {
+    case HashType::SHA1:
+      return {absl::make_unique<HmacSha1>(key)};
+    case HashType::SHA256:
+      return {absl::make_unique<HmacSha256>(key)};
+    case HashType::SHA384:
+      return {absl::make_unique<HmacSha384>(key)};
+    case HashType::SHA512:
+      return {absl::make_unique<HmacSha512>(key)};
+    default:
+      return util::Status(util::error::UNIMPLEMENTED,
+                          "Unsupported hash function");
+  }
+}
+
+util::Status HmacBatchBoringSsl::ComputeBatch(
+    absl::Span<const absl::string_view> inputs, size_t tag_size,
+    std::string* output) const {
+  if (tag_size > digest_size_) {
+    return util::Status(util::error::INVALID_ARGUMENT, "invalid tag size");
+  }
+  ResizeStringUninitialized(output, inputs.size() * tag_size);
+  uint8_t* out = reinterpret_cast<uint8_t*>(&(*output)[0]);
+  if (tag_size == digest_size_) {
+    for (absl::string_view input : inputs) {
+      Compute(input, out);
+      out += tag_size;
+    }
+    return util::OkStatus();
+  }
+  uint8_t buf[SHA512_DIGEST_LENGTH];
+  for (absl::string_view input : inputs) {
+    Compute(input, buf);
+    std::memcpy(out, buf, tag_size);
+    out += tag_size;
+  }
+  OPENSSL_cleanse(buf, sizeof(buf));
+  return util::OkStatus();
+}
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
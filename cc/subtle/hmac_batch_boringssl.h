@@ -0,0 +1,84 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_SUBTLE_HMAC_BATCH_BORINGSSL_H_
+#define TINK_SUBTLE_HMAC_BATCH_BORINGSSL_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "tink/subtle/common_enums.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+// Computes HMACs of many independent messages under a single key.
+//
+// The inner and outer hash states of the key are computed once, at
+// construction. Each message then costs hashing the message and one block
+// for the outer hash, working directly on stack allocated SHA contexts,
+// without the EVP and HMAC_CTX setup, copies and allocations of a general
+// HMAC implementation. The SHA compression functions are BoringSSL's, which
+// select the fastest implementation for the CPU (SHA extensions, AVX2,
+// SSSE3 or generic code) at runtime.
+//
+// Instances are immutable and thread-safe.
+class HmacBatchBoringSsl {
+ public:
+  // Supports SHA1, SHA256, SHA384 and SHA512.
+  static crypto::tink::util::StatusOr<std::unique_ptr<HmacBatchBoringSsl>>
+  New(HashType hash_type, const util::SecretData& key);
+
+  virtual ~HmacBatchBoringSsl() {}
+
+  // The size of an untruncated HMAC, in bytes.
+  size_t digest_size() const { return digest_size_; }
+
+  // Writes the untruncated HMAC of 'data' to 'out', which must hold
+  // digest_size() bytes.
+  virtual void Compute(absl::string_view data, uint8_t* out) const = 0;
+
+  // Computes the HMAC of each of 'inputs', truncated to 'tag_size' bytes,
+  // and stores the tags back-to-back in '*output', which is overwritten:
+  // the tag of inputs[i] starts at i * tag_size.
+  crypto::tink::util::Status ComputeBatch(
+      absl::Span<const absl::string_view> inputs, size_t tag_size,
+      std::string* output) const;
+
+ protected:
+  explicit HmacBatchBoringSsl(size_t digest_size)
+      : digest_size_(digest_size) {}
+
+ private:
+  // Minimum HMAC key size in bytes.
+  static constexpr size_t kMinKeySize = 16;
+
+  const size_t digest_size_;
+};
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_SUBTLE_HMAC_BATCH_BORINGSSL_H_
@@ -0,0 +1,140 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/subtle/hmac_batch_boringssl.h"
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "tink/subtle/common_enums.h"
+#include "tink/subtle/hmac_boringssl.h"
+#include "tink/subtle/random.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/test_matchers.h"
+#include "tink/util/test_util.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+namespace {
+
+using ::crypto::tink::test::HexEncode;
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+
+std::string ComputeBatch(const HmacBatchBoringSsl& hmac,
+                         const std::vector<absl::string_view>& inputs,
+                         size_t tag_size) {
+  std::string output;
+  EXPECT_THAT(hmac.ComputeBatch(inputs, tag_size, &output), IsOk());
+  return output;
+}
+
+std::string HexHmac(HashType hash_type, const util::SecretData& key,
+                    absl::string_view message, size_t tag_size) {
+  auto hmac_result = HmacBatchBoringSsl::New(hash_type, key);
+  EXPECT_THAT(hmac_result.status(), IsOk());
+  if (!hmac_result.ok()) return "";
+  return HexEncode(
+      ComputeBatch(*hmac_result.ValueOrDie(), {message}, tag_size));
+}
+
+TEST(HmacBatchBoringSslTest, TestVectors) {
+  // RFC 4231, test case 6, for a key larger than the block size.
+  util::SecretData long_key(131, 0xaa);
+  std::string message = "Test Using Larger Than Block-Size Key - Hash Key First";
+  EXPECT_EQ(
+      "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54",
+      HexHmac(HashType::SHA256, long_key, message, 32));
+  EXPECT_EQ(
+      "80b24263c7c1a3ebb71493c1dd7be8b49b46d1f41b4aeec1121b013783f8f352"
+      "6b56d037e05f2598bd0fd2215d6a1e5295e64f73f63f0aec8b915a985d786598",
+      HexHmac(HashType::SHA512, long_key, message, 64));
+
+  // RFC 4231, test case 1, truncated.
+  EXPECT_EQ("afd03944d84895626b0825f4ab46907f",
+            HexHmac(HashType::SHA384, util::SecretData(20, 0x0b), "Hi There",
+                    16));
+}
+
+TEST(HmacBatchBoringSslTest, MatchesHmacBoringSsl) {
+  for (HashType hash_type : {HashType::SHA1, HashType::SHA256,
+                             HashType::SHA384, HashType::SHA512}) {
+    for (size_t key_size : {16, 64, 65, 128, 200}) {
+      SCOPED_TRACE(absl::StrCat(EnumToString(hash_type), " ", key_size));
+      util::SecretData key = Random::GetRandomKeyBytes(key_size);
+      auto hmac_result = HmacBatchBoringSsl::New(hash_type, key);
+      ASSERT_THAT(hmac_result.status(), IsOk());
+      const HmacBatchBoringSsl& hmac = *hmac_result.ValueOrDie();
+      size_t digest_size = hmac.digest_size();
+      auto mac_result = HmacBoringSsl::New(hash_type, digest_size, key);
+      ASSERT_THAT(mac_result.status(), IsOk());
+
+      std::vector<std::string> messages;
+      for (size_t size = 0; size < 300; size += 7) {
+        messages.push_back(Random::GetRandomBytes(size));
+      }
+      std::vector<absl::string_view> inputs(messages.begin(), messages.end());
+      std::string output = ComputeBatch(hmac, inputs, digest_size);
+      std::string truncated = ComputeBatch(hmac, inputs, 10);
+      ASSERT_EQ(messages.size() * digest_size, output.size());
+      ASSERT_EQ(messages.size() * 10, truncated.size());
+      for (size_t i = 0; i < messages.size(); i++) {
+        auto expected = mac_result.ValueOrDie()->ComputeMac(messages[i]);
+        ASSERT_THAT(expected.status(), IsOk());
+        EXPECT_EQ(expected.ValueOrDie(),
+                  output.substr(i * digest_size, digest_size));
+        EXPECT_EQ(expected.ValueOrDie().substr(0, 10),
+                  truncated.substr(i * 10, 10));
+      }
+    }
+  }
+}
+
+TEST(HmacBatchBoringSslTest, EmptyBatch) {
+  auto hmac_result =
+      HmacBatchBoringSsl::New(HashType::SHA256, util::SecretData(16, 1));
+  ASSERT_THAT(hmac_result.status(), IsOk());
+  std::string output = "previous";
+  EXPECT_THAT(hmac_result.ValueOrDie()->ComputeBatch({}, 16, &output), IsOk());
+  EXPECT_EQ("", output);
+}
+
+TEST(HmacBatchBoringSslTest, InvalidParameters) {
+  EXPECT_THAT(
+      HmacBatchBoringSsl::New(HashType::SHA256, util::SecretData(15, 1))
+          .status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(
+      HmacBatchBoringSsl::New(HashType::UNKNOWN_HASH, util::SecretData(16, 1))
+          .status(),
+      StatusIs(util::error::UNIMPLEMENTED));
+  auto hmac_result =
+      HmacBatchBoringSsl::New(HashType::SHA256, util::SecretData(16, 1));
+  ASSERT_THAT(hmac_result.status(), IsOk());
+  std::string output;
+  EXPECT_THAT(hmac_result.ValueOrDie()->ComputeBatch({"a"}, 33, &output),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
@@ -17,6 +17,8 @@
 #include "tink/subtle/hmac_boringssl.h"
 
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "absl/memory/memory.h"
 #include "tink/mac.h"
@@ -57,55 +59,123 @@ util::StatusOr<std::unique_ptr<Mac>> HmacBoringSsl::New(HashType hash_type,
   if (key.size() < kMinKeySize) {
     return util::Status(util::error::INVALID_ARGUMENT, "invalid key size");
   }
-  return {absl::WrapUnique(new HmacBoringSsl(md, tag_size, std::move(key)))};
+  bssl::UniquePtr<HMAC_CTX> hmac_context(HMAC_CTX_new());
+  if (hmac_context == nullptr ||
+      !HMAC_Init_ex(hmac_context.get(), key.data(), key.size(), md,
+                    nullptr /* engine */)) {
+    return util::Status(util::error::INTERNAL,
+                        "BoringSSL failed to initialize HMAC");
+  }
+  return {absl::WrapUnique(
+      new HmacBoringSsl(tag_size, std::move(hmac_context)))};
 }
 
-util::StatusOr<std::string> HmacBoringSsl::ComputeMac(
-    absl::string_view data) const {
+util::Status HmacBoringSsl::ComputeFullMac(absl::string_view data,
+                                           absl::string_view data_suffix,
+                                           uint8_t* buf) const {
   // BoringSSL expects a non-null pointer for data,
   // regardless of whether the size is 0.
   data = SubtleUtilBoringSSL::EnsureNonNull(data);
+  data_suffix = SubtleUtilBoringSSL::EnsureNonNull(data_suffix);
 
-  uint8_t buf[EVP_MAX_MD_SIZE];
+  // Copying the initialized context avoids rehashing the padded key for
+  // every message.
+  bssl::ScopedHMAC_CTX ctx;
   unsigned int out_len;
-  const uint8_t* res = HMAC(md_, key_.data(), key_.size(),
-                            reinterpret_cast<const uint8_t*>(data.data()),
-                            data.size(), buf, &out_len);
-  if (res == nullptr) {
+  if (!HMAC_CTX_copy_ex(ctx.get(), hmac_context_.get()) ||
+      !HMAC_Update(ctx.get(), reinterpret_cast<const uint8_t*>(data.data()),
+                   data.size()) ||
+      !HMAC_Update(ctx.get(),
+                   reinterpret_cast<const uint8_t*>(data_suffix.data()),
+                   data_suffix.size()) ||
+      !HMAC_Final(ctx.get(), buf, &out_len)) {
     // TODO(bleichen): We expect that BoringSSL supports the
     //   hashes that we use. Maybe we should have a status that indicates
     //   such mismatches between expected and actual behaviour.
     return util::Status(util::error::INTERNAL,
                         "BoringSSL failed to compute HMAC");
   }
+  return util::OkStatus();
+}
+
+util::StatusOr<std::string> HmacBoringSsl::ComputeMac(
+    absl::string_view data) const {
+  uint8_t buf[EVP_MAX_MD_SIZE];
+  util::Status status = ComputeFullMac(data, "", buf);
+  if (!status.ok()) return status;
   return std::string(reinterpret_cast<char*>(buf), tag_size_);
 }
 
 util::Status HmacBoringSsl::VerifyMac(
     absl::string_view mac,
     absl::string_view data) const {
-  // BoringSSL expects a non-null pointer for data,
-  // regardless of whether the size is 0.
-  data = SubtleUtilBoringSSL::EnsureNonNull(data);
+  return VerifyMacWithSuffix(mac, data, "");
+}
 
-  if (mac.size() != tag_size_) {
+util::StatusOr<std::string> HmacBoringSsl::ComputeMacWithPrefix(
+    absl::string_view output_prefix, absl::string_view data,
+    absl::string_view data_suffix) const {
+  uint8_t buf[EVP_MAX_MD_SIZE];
+  util::Status status = ComputeFullMac(data, data_suffix, buf);
+  if (!status.ok()) return status;
+  std::string mac;
+  mac.reserve(output_prefix.size() + tag_size_);
+  mac.append(output_prefix.data(), output_prefix.size());
+  mac.append(reinterpret_cast<char*>(buf), tag_size_);
+  return mac;
+}
+
+util::Status HmacBoringSsl::VerifyMacWithSuffix(
+    absl::string_view mac_value, absl::string_view data,
+    absl::string_view data_suffix) const {
+  if (mac_value.size() != tag_size_) {
     return util::Status(util::error::INVALID_ARGUMENT, "incorrect tag size");
   }
   uint8_t buf[EVP_MAX_MD_SIZE];
-  unsigned int out_len;
-  const uint8_t* res = HMAC(md_, key_.data(), key_.size(),
-                            reinterpret_cast<const uint8_t*>(data.data()),
-                            data.size(), buf, &out_len);
-  if (res == nullptr) {
-    return util::Status(util::error::INTERNAL,
-                        "BoringSSL failed to compute HMAC");
-  }
-  if (CRYPTO_memcmp(buf, mac.data(), tag_size_) != 0) {
+  util::Status status = ComputeFullMac(data, data_suffix, buf);
+  if (!status.ok()) return status;
+  if (CRYPTO_memcmp(buf, mac_value.data(), tag_size_) != 0) {
     return util::Status(util::error::INVALID_ARGUMENT, "verification failed");
   }
   return util::Status::OK;
 }
 
+std::vector<util::Status> HmacBoringSsl::BatchVerifyMac(
+    absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs)
+    const {
+  std::vector<util::Status> results;
+  results.reserve(inputs.size());
+  bssl::ScopedHMAC_CTX ctx;
+  bool ctx_ok = HMAC_CTX_copy_ex(ctx.get(), hmac_context_.get());
+  uint8_t buf[EVP_MAX_MD_SIZE];
+  for (const auto& input : inputs) {
+    absl::string_view mac = input.first;
+    absl::string_view data = SubtleUtilBoringSSL::EnsureNonNull(input.second);
+    if (mac.size() != tag_size_) {
+      results.push_back(
+          util::Status(util::error::INVALID_ARGUMENT, "incorrect tag size"));
+      continue;
+    }
+    // Without a key, HMAC_Init_ex() restarts from the inner pad state kept
+    // in the context.
+    unsigned int out_len;
+    if (!ctx_ok ||
+        !HMAC_Init_ex(ctx.get(), nullptr, 0, nullptr, nullptr /* engine */) ||
+        !HMAC_Update(ctx.get(), reinterpret_cast<const uint8_t*>(data.data()),
+                     data.size()) ||
+        !HMAC_Final(ctx.get(), buf, &out_len)) {
+      results.push_back(util::Status(util::error::INTERNAL,
+                                     "BoringSSL failed to compute HMAC"));
+    } else if (CRYPTO_memcmp(buf, mac.data(), tag_size_) != 0) {
+      results.push_back(
+          util::Status(util::error::INVALID_ARGUMENT, "verification failed"));
+    } else {
+      results.push_back(util::OkStatus());
+    }
+  }
+  return results;
+}
+
 }  // namespace subtle
 }  // namespace tink
 }  // namespace crypto
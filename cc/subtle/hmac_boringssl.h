@@ -18,10 +18,15 @@
 #define TINK_SUBTLE_HMAC_BORINGSSL_H_
 
 #include <memory>
+#include <string>
 #include <utility>
+#include <vector>
 
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "openssl/base.h"
 #include "openssl/evp.h"
+#include "openssl/hmac.h"
 #include "tink/mac.h"
 #include "tink/config/tink_fips.h"
 #include "tink/subtle/common_enums.h"
@@ -48,6 +53,22 @@ class HmacBoringSsl : public Mac {
       absl::string_view mac,
       absl::string_view data) const override;
 
+  // Authenticates 'data' and 'data_suffix' without concatenating them, and
+  // writes the MAC directly after 'output_prefix'.
+  crypto::tink::util::StatusOr<std::string> ComputeMacWithPrefix(
+      absl::string_view output_prefix, absl::string_view data,
+      absl::string_view data_suffix) const override;
+
+  crypto::tink::util::Status VerifyMacWithSuffix(
+      absl::string_view mac_value, absl::string_view data,
+      absl::string_view data_suffix) const override;
+
+  // Verifies all pairs with a single HMAC context, which is reset to the
+  // precomputed pad states for every pair instead of being copied.
+  std::vector<crypto::tink::util::Status> BatchVerifyMac(
+      absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs)
+      const override;
+
   static constexpr crypto::tink::FipsCompatibility kFipsStatus =
       crypto::tink::FipsCompatibility::kRequiresBoringCrypto;
 
@@ -55,13 +76,20 @@ class HmacBoringSsl : public Mac {
   // Minimum HMAC key size in bytes.
   static constexpr size_t kMinKeySize = 16;
 
-  HmacBoringSsl(const EVP_MD* md, uint32_t tag_size, util::SecretData key)
-      : md_(md), tag_size_(tag_size), key_(std::move(key)) {}
+  HmacBoringSsl(uint32_t tag_size, bssl::UniquePtr<HMAC_CTX> hmac_context)
+      : tag_size_(tag_size), hmac_context_(std::move(hmac_context)) {}
+
+  // Computes the full (untruncated) HMAC of 'data' followed by 'data_suffix'
+  // into 'buf', which must hold at least EVP_MAX_MD_SIZE bytes.
+  crypto::tink::util::Status ComputeFullMac(absl::string_view data,
+                                            absl::string_view data_suffix,
+                                            uint8_t* buf) const;
 
-  // HmacBoringSsl is not owner of md (it is owned by BoringSSL).
-  const EVP_MD* const md_;
   const uint32_t tag_size_;
-  const util::SecretData key_;
+  // HMAC context initialized with the key at construction, i.e. holding the
+  // precomputed inner and outer hash states. It is never modified; every MAC
+  // computation works on a copy of it.
+  const bssl::UniquePtr<HMAC_CTX> hmac_context_;
 };
 
 }  // namespace subtle
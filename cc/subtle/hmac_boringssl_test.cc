@@ -17,8 +17,11 @@
 #include "tink/subtle/hmac_boringssl.h"
 
 #include <string>
+#include <utility>
+#include <vector>
 
 #include "gtest/gtest.h"
+#include "absl/strings/string_view.h"
 #include "tink/mac.h"
 #include "tink/config/tink_fips.h"
 #include "tink/subtle/common_enums.h"
@@ -138,6 +141,31 @@ TEST_F(HmacBoringSslTest, testTruncation) {
   }
 }
 
+TEST_F(HmacBoringSslTest, testRepeatedComputation) {
+  if (kUseOnlyFips && !FIPS_mode()) {
+    GTEST_SKIP()
+        << "Test should not run in FIPS mode when BoringCrypto is unavailable.";
+  }
+
+  // RFC 4231, test case 6: the key is longer than the block size.
+  util::SecretData key(131, static_cast<char>(0xaa));
+  auto hmac_result = HmacBoringSsl::New(HashType::SHA256, 32, key);
+  EXPECT_TRUE(hmac_result.ok()) << hmac_result.status();
+  auto hmac = std::move(hmac_result.ValueOrDie());
+  std::string data = "Test Using Larger Than Block-Size Key - Hash Key First";
+  std::string expected_tag = test::HexDecodeOrDie(
+      "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54");
+  // The keyed state is shared by all calls and must not be consumed by any
+  // of them.
+  for (int i = 0; i < 3; i++) {
+    auto res = hmac->ComputeMac(data);
+    EXPECT_TRUE(res.ok()) << res.status().ToString();
+    EXPECT_EQ(expected_tag, res.ValueOrDie());
+    EXPECT_TRUE(hmac->ComputeMac("").ok());
+    EXPECT_TRUE(hmac->VerifyMac(expected_tag, data).ok());
+  }
+}
+
 TEST_F(HmacBoringSslTest, testInvalidKeySizes) {
   if (kUseOnlyFips && !FIPS_mode()) {
     GTEST_SKIP()
@@ -157,6 +185,44 @@ TEST_F(HmacBoringSslTest, testInvalidKeySizes) {
   }
 }
 
+TEST_F(HmacBoringSslTest, BatchVerifyMac) {
+  if (kUseOnlyFips && !FIPS_mode()) {
+    GTEST_SKIP()
+        << "Test should not run in FIPS mode when BoringCrypto is unavailable.";
+  }
+
+  util::SecretData key = util::SecretDataFromStringView(
+      test::HexDecodeOrDie("000102030405060708090a0b0c0d0e0f"));
+  auto hmac_result = HmacBoringSsl::New(HashType::SHA256, 16, key);
+  ASSERT_TRUE(hmac_result.ok()) << hmac_result.status();
+  auto hmac = std::move(hmac_result.ValueOrDie());
+
+  std::vector<std::string> data;
+  std::vector<std::string> tags;
+  for (int i = 0; i < 20; i++) {
+    data.push_back(std::string(7 * i, 'a' + i));
+    auto tag_result = hmac->ComputeMac(data.back());
+    ASSERT_TRUE(tag_result.ok()) << tag_result.status();
+    tags.push_back(tag_result.ValueOrDie());
+  }
+  tags[4][15] ^= 1;
+  tags[9].pop_back();
+  std::vector<std::pair<absl::string_view, absl::string_view>> inputs;
+  for (int i = 0; i < 20; i++) inputs.emplace_back(tags[i], data[i]);
+
+  std::vector<util::Status> results = hmac->BatchVerifyMac(inputs);
+  ASSERT_EQ(results.size(), inputs.size());
+  for (int i = 0; i < 20; i++) {
+    if (i == 4 || i == 9) {
+      EXPECT_THAT(results[i], StatusIs(util::error::INVALID_ARGUMENT))
+          << "i=" << i;
+    } else {
+      EXPECT_TRUE(results[i].ok()) << "i=" << i << " " << results[i];
+    }
+  }
+  EXPECT_TRUE(hmac->BatchVerifyMac({}).empty());
+}
+
 TEST_F(HmacBoringSslTest, TestFipsFailWithoutBoringCrypto) {
   if (!kUseOnlyFips || FIPS_mode()) {
     GTEST_SKIP()
@@ -17,9 +17,13 @@
 #ifndef TINK_SUBTLE_IND_CPA_CIPHER_H_
 #define TINK_SUBTLE_IND_CPA_CIPHER_H_
 
+#include <cstdint>
+#include <cstring>
 #include <string>
 
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "tink/util/status.h"
 #include "tink/util/statusor.h"
 
 namespace crypto {
@@ -42,6 +46,32 @@ class IndCpaCipher {
   virtual crypto::tink::util::StatusOr<std::string> Decrypt(
       absl::string_view ciphertext) const = 0;
 
+  // Returns the size of the ciphertext that Encrypt() and EncryptInto()
+  // produce for a plaintext of 'plaintext_size' bytes, or an UNIMPLEMENTED
+  // error if it is not known.
+  virtual crypto::tink::util::StatusOr<int64_t> CiphertextSize(
+      int64_t plaintext_size) const {
+    return crypto::tink::util::Status(
+        crypto::tink::util::error::UNIMPLEMENTED,
+        "CiphertextSize() is not supported by this IndCpaCipher");
+  }
+
+  // Like Encrypt(), but writes the ciphertext to 'buffer', which must not
+  // overlap with 'plaintext', and returns the number of bytes written. The
+  // default implementation calls Encrypt() and copies the result.
+  virtual crypto::tink::util::StatusOr<int64_t> EncryptInto(
+      absl::string_view plaintext, absl::Span<char> buffer) const {
+    auto encrypt_result = Encrypt(plaintext);
+    if (!encrypt_result.ok()) return encrypt_result.status();
+    const std::string& ciphertext = encrypt_result.ValueOrDie();
+    if (buffer.size() < ciphertext.size()) {
+      return crypto::tink::util::Status(
+          crypto::tink::util::error::INVALID_ARGUMENT, "Buffer too small");
+    }
+    std::memcpy(buffer.data(), ciphertext.data(), ciphertext.size());
+    return ciphertext.size();
+  }
+
   virtual ~IndCpaCipher() {}
 };
 
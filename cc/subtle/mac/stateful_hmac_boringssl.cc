@@ -0,0 +1,117 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/subtle/mac/stateful_hmac_boringssl.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "openssl/evp.h"
+#include "openssl/hmac.h"
+#include "tink/config/tink_fips.h"
+#include "tink/subtle/hmac_boringssl.h"
+#include "tink/subtle/subtle_util_boringssl.h"
+#include "tink/util/errors.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+constexpr size_t StatefulHmacBoringSslFactory::kMinKeySize;
+
+// static
+util::StatusOr<std::unique_ptr<StatefulMac>> StatefulHmacBoringSsl::New(
+    HashType hash_type, uint32_t tag_size, const util::SecretData& key) {
+  auto factory_result =
+      StatefulHmacBoringSslFactory::New(hash_type, tag_size, key);
+  if (!factory_result.ok()) return factory_result.status();
+  return factory_result.ValueOrDie()->Create();
+}
+
+util::Status StatefulHmacBoringSsl::Update(absl::string_view data) {
+  // BoringSSL expects a non-null pointer for data,
+  // regardless of whether the size is 0.
+  data = SubtleUtilBoringSSL::EnsureNonNull(data);
+  if (!HMAC_Update(context_.get(),
+                   reinterpret_cast<const uint8_t*>(data.data()),
+                   data.size())) {
+    return util::Status(util::error::INTERNAL,
+                        "BoringSSL failed to update HMAC");
+  }
+  return util::OkStatus();
+}
+
+util::StatusOr<std::string> StatefulHmacBoringSsl::Finalize() {
+  uint8_t buf[EVP_MAX_MD_SIZE];
+  unsigned int out_len;
+  if (!HMAC_Final(context_.get(), buf, &out_len)) {
+    return util::Status(util::error::INTERNAL,
+                        "BoringSSL failed to compute HMAC");
+  }
+  return std::string(reinterpret_cast<char*>(buf), tag_size_);
+}
+
+util::Status StatefulHmacBoringSsl::Reset() {
+  if (!HMAC_CTX_copy_ex(context_.get(), keyed_context_.get())) {
+    return util::Status(util::error::INTERNAL,
+                        "BoringSSL failed to initialize HMAC");
+  }
+  return util::OkStatus();
+}
+
+// static
+util::StatusOr<std::unique_ptr<StatefulHmacBoringSslFactory>>
+StatefulHmacBoringSslFactory::New(HashType hash_type, uint32_t tag_size,
+                                  const util::SecretData& key) {
+  auto status = CheckFipsCompatibility<HmacBoringSsl>();
+  if (!status.ok()) return status;
+
+  util::StatusOr<const EVP_MD*> res = SubtleUtilBoringSSL::EvpHash(hash_type);
+  if (!res.ok()) {
+    return res.status();
+  }
+  const EVP_MD* md = res.ValueOrDie();
+  if (EVP_MD_size(md) < tag_size) {
+    return util::Status(util::error::INVALID_ARGUMENT, "invalid tag size");
+  }
+  if (key.size() < kMinKeySize) {
+    return util::Status(util::error::INVALID_ARGUMENT, "invalid key size");
+  }
+  std::shared_ptr<HMAC_CTX> keyed_context(HMAC_CTX_new(), HMAC_CTX_free);
+  if (keyed_context == nullptr ||
+      !HMAC_Init_ex(keyed_context.get(), key.data(), key.size(), md,
+                    nullptr /* engine */)) {
+    return util::Status(util::error::INTERNAL,
+                        "BoringSSL failed to initialize HMAC");
+  }
+  return {absl::WrapUnique(
+      new StatefulHmacBoringSslFactory(tag_size, std::move(keyed_context)))};
+}
+
+util::StatusOr<std::unique_ptr<StatefulMac>>
+StatefulHmacBoringSslFactory::Create() const {
+  std::unique_ptr<StatefulMac> hmac =
+      absl::WrapUnique(new StatefulHmacBoringSsl(tag_size_, keyed_context_));
+  auto status = hmac->Reset();
+  if (!status.ok()) return status;
+  return std::move(hmac);
+}
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
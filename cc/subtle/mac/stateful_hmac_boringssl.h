@@ -0,0 +1,89 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_SUBTLE_MAC_STATEFUL_HMAC_BORINGSSL_H_
+#define TINK_SUBTLE_MAC_STATEFUL_HMAC_BORINGSSL_H_
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/strings/string_view.h"
+#include "openssl/base.h"
+#include "openssl/hmac.h"
+#include "tink/subtle/common_enums.h"
+#include "tink/subtle/mac/stateful_mac.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+// An HMAC which is computed incrementally, for messages which are not
+// available as a single buffer. Thread-compatible.
+class StatefulHmacBoringSsl : public StatefulMac {
+ public:
+  static util::StatusOr<std::unique_ptr<StatefulMac>> New(
+      HashType hash_type, uint32_t tag_size, const util::SecretData& key);
+
+  util::Status Update(absl::string_view data) override;
+  util::StatusOr<std::string> Finalize() override;
+  util::Status Reset() override;
+
+ private:
+  friend class StatefulHmacBoringSslFactory;
+
+  StatefulHmacBoringSsl(uint32_t tag_size,
+                        std::shared_ptr<const HMAC_CTX> keyed_context)
+      : tag_size_(tag_size), keyed_context_(std::move(keyed_context)) {}
+
+  const uint32_t tag_size_;
+  // Holds the inner and outer hash states after hashing the key. It is never
+  // modified; Reset() copies it into 'context_'.
+  const std::shared_ptr<const HMAC_CTX> keyed_context_;
+  bssl::ScopedHMAC_CTX context_;
+};
+
+// Creates StatefulHmacBoringSsl objects which share one keyed HMAC context,
+// so that the key is hashed only once. Thread-safe.
+class StatefulHmacBoringSslFactory : public StatefulMacFactory {
+ public:
+  static util::StatusOr<std::unique_ptr<StatefulHmacBoringSslFactory>> New(
+      HashType hash_type, uint32_t tag_size, const util::SecretData& key);
+
+  util::StatusOr<std::unique_ptr<StatefulMac>> Create() const override;
+
+  uint32_t tag_size() const { return tag_size_; }
+
+ private:
+  // Minimum HMAC key size in bytes.
+  static constexpr size_t kMinKeySize = 16;
+
+  StatefulHmacBoringSslFactory(uint32_t tag_size,
+                               std::shared_ptr<const HMAC_CTX> keyed_context)
+      : tag_size_(tag_size), keyed_context_(std::move(keyed_context)) {}
+
+  const uint32_t tag_size_;
+  const std::shared_ptr<const HMAC_CTX> keyed_context_;
+};
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_SUBTLE_MAC_STATEFUL_HMAC_BORINGSSL_H_
@@ -0,0 +1,103 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/subtle/mac/stateful_hmac_boringssl.h"
+
+#include <memory>
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "tink/subtle/common_enums.h"
+#include "tink/subtle/hmac_boringssl.h"
+#include "tink/subtle/random.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/test_matchers.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+namespace {
+
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::testing::Eq;
+
+TEST(StatefulHmacBoringSslTest, MatchesHmacBoringSsl) {
+  util::SecretData key = Random::GetRandomKeyBytes(32);
+  auto hmac_result = HmacBoringSsl::New(HashType::SHA256, 16, key);
+  ASSERT_THAT(hmac_result.status(), IsOk());
+  auto factory_result =
+      StatefulHmacBoringSslFactory::New(HashType::SHA256, 16, key);
+  ASSERT_THAT(factory_result.status(), IsOk());
+  EXPECT_THAT(factory_result.ValueOrDie()->tag_size(), Eq(16));
+
+  for (int size : {0, 1, 31, 64, 1000}) {
+    std::string data = Random::GetRandomBytes(size);
+    auto expected = hmac_result.ValueOrDie()->ComputeMac(data);
+    ASSERT_THAT(expected.status(), IsOk());
+
+    auto mac_result = factory_result.ValueOrDie()->Create();
+    ASSERT_THAT(mac_result.status(), IsOk());
+    StatefulMac& mac = *mac_result.ValueOrDie();
+    // Fed in two parts.
+    ASSERT_THAT(mac.Update(absl::string_view(data).substr(0, size / 2)),
+                IsOk());
+    ASSERT_THAT(mac.Update(absl::string_view(data).substr(size / 2)), IsOk());
+    auto tag = mac.Finalize();
+    ASSERT_THAT(tag.status(), IsOk());
+    EXPECT_THAT(tag.ValueOrDie(), Eq(expected.ValueOrDie())) << size;
+
+    // After Reset(), the same object computes the next MAC.
+    ASSERT_THAT(mac.Reset(), IsOk());
+    ASSERT_THAT(mac.Update(data), IsOk());
+    tag = mac.Finalize();
+    ASSERT_THAT(tag.status(), IsOk());
+    EXPECT_THAT(tag.ValueOrDie(), Eq(expected.ValueOrDie())) << size;
+  }
+}
+
+TEST(StatefulHmacBoringSslTest, MacOutlivesFactory) {
+  util::SecretData key = Random::GetRandomKeyBytes(16);
+  auto mac_result = StatefulHmacBoringSsl::New(HashType::SHA1, 20, key);
+  ASSERT_THAT(mac_result.status(), IsOk());
+  auto hmac_result = HmacBoringSsl::New(HashType::SHA1, 20, key);
+  ASSERT_THAT(hmac_result.status(), IsOk());
+
+  StatefulMac& mac = *mac_result.ValueOrDie();
+  ASSERT_THAT(mac.Update("some data"), IsOk());
+  auto tag = mac.Finalize();
+  ASSERT_THAT(tag.status(), IsOk());
+  EXPECT_THAT(tag.ValueOrDie(),
+              Eq(hmac_result.ValueOrDie()->ComputeMac("some data")
+                     .ValueOrDie()));
+}
+
+TEST(StatefulHmacBoringSslTest, InvalidParameters) {
+  EXPECT_THAT(StatefulHmacBoringSslFactory::New(
+                  HashType::SHA256, 16, Random::GetRandomKeyBytes(15))
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(StatefulHmacBoringSslFactory::New(
+                  HashType::SHA256, 33, Random::GetRandomKeyBytes(16))
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
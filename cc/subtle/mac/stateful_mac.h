@@ -40,6 +40,13 @@ class StatefulMac {
 
   virtual util::Status Update(absl::string_view data) = 0;
   virtual util::StatusOr<std::string> Finalize() = 0;
+
+  // Returns the MAC to the state it had when it was created, so that it can
+  // process another message without being recreated. Implementations which
+  // cannot do this return UNIMPLEMENTED.
+  virtual util::Status Reset() {
+    return util::Status(util::error::UNIMPLEMENTED, "Reset is not supported");
+  }
 };
 
 class StatefulMacFactory {
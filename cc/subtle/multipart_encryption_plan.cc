@@ -0,0 +1,148 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/subtle/multipart_encryption_plan.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+using crypto::tink::util::Status;
+using crypto::tink::util::StatusOr;
+
+// static
+StatusOr<std::unique_ptr<MultipartEncryptionPlan>> MultipartEncryptionPlan::New(
+    std::unique_ptr<StreamSegmentEncrypter> segment_encrypter) {
+  if (segment_encrypter == nullptr) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "segment_encrypter must be non-null");
+  }
+  int first_plaintext_segment_size =
+      segment_encrypter->get_plaintext_segment_size() -
+      segment_encrypter->get_ciphertext_offset() -
+      segment_encrypter->get_header().size();
+  if (first_plaintext_segment_size <= 0) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "The first segment has no room for plaintext");
+  }
+  return {absl::WrapUnique(
+      new MultipartEncryptionPlan(std::move(segment_encrypter)))};
+}
+
+MultipartEncryptionPlan::MultipartEncryptionPlan(
+    std::unique_ptr<StreamSegmentEncrypter> segment_encrypter)
+    : segment_encrypter_(std::move(segment_encrypter)),
+      first_segment_number_(segment_encrypter_->get_segment_number()),
+      plaintext_segment_size_(segment_encrypter_->get_plaintext_segment_size()),
+      ciphertext_segment_size_(
+          segment_encrypter_->get_ciphertext_segment_size()),
+      first_plaintext_segment_size_(
+          plaintext_segment_size_ - segment_encrypter_->get_ciphertext_offset() -
+          segment_encrypter_->get_header().size()) {}
+
+std::string MultipartEncryptionPlan::header() const {
+  const std::vector<uint8_t>& header = segment_encrypter_->get_header();
+  return std::string(header.begin(), header.end());
+}
+
+int64_t MultipartEncryptionPlan::PlaintextPosition(
+    int64_t segment_index) const {
+  if (segment_index <= 0) return 0;
+  return first_plaintext_segment_size_ +
+         (segment_index - 1) * plaintext_segment_size_;
+}
+
+int64_t MultipartEncryptionPlan::CiphertextPosition(
+    int64_t segment_index) const {
+  if (segment_index <= 0) return 0;
+  return segment_index * ciphertext_segment_size_ -
+         segment_encrypter_->get_ciphertext_offset();
+}
+
+StatusOr<std::string> MultipartEncryptionPlan::EncryptPart(
+    int64_t first_segment_index, absl::string_view plaintext,
+    bool is_last_part) const {
+  if (first_segment_index < 0) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "first_segment_index must be non-negative");
+  }
+  if (plaintext.empty() && !(is_last_part && first_segment_index == 0)) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "Only a part which is the whole stream may be empty");
+  }
+  const int64_t part_start = PlaintextPosition(first_segment_index);
+  const int64_t part_end = part_start + plaintext.size();
+  // Segments which end at or before part_end.
+  int64_t end_segment_index =
+      part_end < first_plaintext_segment_size_
+          ? 0
+          : 1 + (part_end - first_plaintext_segment_size_) /
+                    plaintext_segment_size_;
+  if (!is_last_part && PlaintextPosition(end_segment_index) != part_end) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "A part which is not the last one must consist of whole "
+                  "segments");
+  }
+  if (is_last_part && PlaintextPosition(end_segment_index) != part_end) {
+    // The incomplete segment at the end is the last one.
+    ++end_segment_index;
+  }
+  if (is_last_part && plaintext.empty()) end_segment_index = 1;
+
+  const int overhead = ciphertext_segment_size_ - plaintext_segment_size_;
+  std::string ciphertext;
+  const int64_t segment_count = end_segment_index - first_segment_index;
+  if (first_segment_index == 0) {
+    const std::vector<uint8_t>& header = segment_encrypter_->get_header();
+    ciphertext.reserve(header.size() + plaintext.size() +
+                       segment_count * overhead);
+    ciphertext.append(header.begin(), header.end());
+  } else {
+    ciphertext.reserve(plaintext.size() + segment_count * overhead);
+  }
+  std::vector<uint8_t> segment;
+  std::vector<uint8_t> ciphertext_segment;
+  segment.reserve(ciphertext_segment_size_);
+  for (int64_t i = first_segment_index; i < end_segment_index; ++i) {
+    const int64_t start = PlaintextPosition(i) - part_start;
+    const int64_t end =
+        std::min<int64_t>(PlaintextPosition(i + 1) - part_start,
+                          plaintext.size());
+    const bool is_last_segment = is_last_part && i + 1 == end_segment_index;
+    segment.assign(plaintext.begin() + start, plaintext.begin() + end);
+    const int64_t segment_number = first_segment_number_ + i;
+    Status status = segment_encrypter_->EncryptSegmentInPlace(
+        segment_number, is_last_segment, &segment);
+    if (status.error_code() == util::error::UNIMPLEMENTED) {
+      status = segment_encrypter_->EncryptSegmentAt(
+          segment, segment_number, is_last_segment, &ciphertext_segment);
+      segment.swap(ciphertext_segment);
+    }
+    if (!status.ok()) return status;
+    ciphertext.append(segment.begin(), segment.end());
+  }
+  return std::move(ciphertext);
+}
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,96 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_SUBTLE_MULTIPART_ENCRYPTION_PLAN_H_
+#define TINK_SUBTLE_MULTIPART_ENCRYPTION_PLAN_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "tink/subtle/stream_segment_encrypter.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+// Encrypts a ciphertext stream in independent parts, e.g. for a multipart
+// upload to an object store, where the parts are encrypted by different
+// threads or machines. Each part consists of whole segments, so that the
+// concatenation of the encrypted parts, in the order of their segments, is
+// a ciphertext stream identical to the one a StreamingAeadEncryptingStream
+// with the same header would write, which the usual decrypting streams read.
+//
+// A plan is created once per stream, and its header() is passed along with
+// the parts to the other machines, which create a plan for the same header,
+// e.g. with NonceBasedStreamingAead::GetMultipartEncryptionPlan(). The header
+// contains no secret data. EncryptPart() is thread-safe.
+//
+// Each part must be encrypted only once per header: encrypting a different
+// plaintext for the same segments reuses nonces, and breaks the security of
+// the stream.
+class MultipartEncryptionPlan {
+ public:
+  // Returns a plan which encrypts the segments with 'segment_encrypter'.
+  // 'segment_encrypter' must support EncryptSegmentInPlace() or
+  // EncryptSegmentAt(); otherwise EncryptPart() fails with UNIMPLEMENTED.
+  static crypto::tink::util::StatusOr<std::unique_ptr<MultipartEncryptionPlan>>
+  New(std::unique_ptr<StreamSegmentEncrypter> segment_encrypter);
+
+  // Returns the header of the ciphertext stream, which identifies the plan.
+  std::string header() const;
+
+  // Returns the position in the plaintext of the first byte of segment
+  // 'segment_index', i.e. where a part starting with that segment starts.
+  int64_t PlaintextPosition(int64_t segment_index) const;
+
+  // Returns the position in the ciphertext stream of the first byte of the
+  // encrypted part which starts with segment 'segment_index'. The ciphertext
+  // stream starts with the header, which belongs to the part of segment 0.
+  int64_t CiphertextPosition(int64_t segment_index) const;
+
+  // Returns the ciphertext of the part starting with segment
+  // 'first_segment_index' with the given 'plaintext'. Unless 'is_last_part'
+  // is true, 'plaintext' must be the plaintext of at least one whole segment,
+  // i.e. it must be PlaintextPosition(first_segment_index + k) -
+  // PlaintextPosition(first_segment_index) bytes long for some k > 0. The last
+  // part may have any size, but must be non-empty unless it is the only part.
+  crypto::tink::util::StatusOr<std::string> EncryptPart(
+      int64_t first_segment_index, absl::string_view plaintext,
+      bool is_last_part) const;
+
+ private:
+  explicit MultipartEncryptionPlan(
+      std::unique_ptr<StreamSegmentEncrypter> segment_encrypter);
+
+  const std::unique_ptr<StreamSegmentEncrypter> segment_encrypter_;
+  // The number of the first segment of the stream.
+  const int64_t first_segment_number_;
+  const int plaintext_segment_size_;
+  const int ciphertext_segment_size_;
+  // The number of plaintext bytes in segment 0, which is shorter by the
+  // header and the ciphertext offset.
+  const int first_plaintext_segment_size_;
+};
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_SUBTLE_MULTIPART_ENCRYPTION_PLAN_H_
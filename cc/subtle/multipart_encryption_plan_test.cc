@@ -0,0 +1,161 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/subtle/multipart_encryption_plan.h"
+
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "tink/subtle/random.h"
+#include "tink/subtle/test_util.h"
+#include "tink/util/status.h"
+#include "tink/util/test_matchers.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+namespace {
+
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::testing::Eq;
+
+constexpr int kSegmentSize = 100;
+constexpr int kHeaderSize = 20;
+
+std::unique_ptr<test::DummyStreamSegmentEncrypter> NewEncrypter(
+    int ct_offset) {
+  return absl::make_unique<test::DummyStreamSegmentEncrypter>(
+      kSegmentSize, kHeaderSize, ct_offset);
+}
+
+std::unique_ptr<MultipartEncryptionPlan> NewPlan(int ct_offset) {
+  auto plan_result = MultipartEncryptionPlan::New(NewEncrypter(ct_offset));
+  EXPECT_THAT(plan_result.status(), IsOk());
+  return std::move(plan_result.ValueOrDie());
+}
+
+// Encrypts 'plaintext' in parts of 'segments_per_part' segments.
+std::string EncryptInParts(const MultipartEncryptionPlan& plan,
+                           absl::string_view plaintext,
+                           int segments_per_part) {
+  std::string ciphertext;
+  int64_t segment = 0;
+  while (true) {
+    int64_t start = plan.PlaintextPosition(segment);
+    int64_t end = plan.PlaintextPosition(segment + segments_per_part);
+    bool is_last_part = end >= static_cast<int64_t>(plaintext.size());
+    EXPECT_THAT(plan.CiphertextPosition(segment), Eq(ciphertext.size()));
+    auto part_result = plan.EncryptPart(
+        segment, plaintext.substr(start, end - start), is_last_part);
+    EXPECT_THAT(part_result.status(), IsOk());
+    if (!part_result.ok()) return "";
+    ciphertext += part_result.ValueOrDie();
+    if (is_last_part) return ciphertext;
+    segment += segments_per_part;
+  }
+}
+
+TEST(MultipartEncryptionPlanTest, PartsConcatenateToTheStream) {
+  for (int ct_offset : {0, 5}) {
+    for (int size : {0, 1, 74, 75, 76, 175, 176, 1000, 10000}) {
+      for (int segments_per_part : {1, 2, 7}) {
+        SCOPED_TRACE(absl::StrCat("ct_offset: ", ct_offset, " size: ", size,
+                                  " segments_per_part: ", segments_per_part));
+        std::string plaintext = Random::GetRandomBytes(size);
+        auto plan = NewPlan(ct_offset);
+        EXPECT_THAT(EncryptInParts(*plan, plaintext, segments_per_part),
+                    Eq(NewEncrypter(ct_offset)->GenerateCiphertext(plaintext)));
+      }
+    }
+  }
+}
+
+TEST(MultipartEncryptionPlanTest, Positions) {
+  auto plan = NewPlan(/* ct_offset = */ 5);
+  EXPECT_THAT(plan->PlaintextPosition(0), Eq(0));
+  EXPECT_THAT(plan->PlaintextPosition(1), Eq(kSegmentSize - 5 - kHeaderSize));
+  EXPECT_THAT(plan->PlaintextPosition(3),
+              Eq(3 * kSegmentSize - 5 - kHeaderSize));
+  const int ct_segment_size =
+      kSegmentSize + test::DummyStreamSegmentEncrypter::kSegmentTagSize;
+  EXPECT_THAT(plan->CiphertextPosition(0), Eq(0));
+  EXPECT_THAT(plan->CiphertextPosition(3), Eq(3 * ct_segment_size - 5));
+  EXPECT_THAT(plan->header(), Eq(std::string(kHeaderSize, 'h')));
+}
+
+TEST(MultipartEncryptionPlanTest, PartsInParallel) {
+  std::string plaintext = Random::GetRandomBytes(50000);
+  auto plan = NewPlan(/* ct_offset = */ 0);
+  const int segments_per_part = 10;
+  std::vector<std::string> parts(
+      (plaintext.size() + segments_per_part * kSegmentSize) /
+      (segments_per_part * kSegmentSize));
+  std::vector<std::thread> threads;
+  for (int i = 0; i < parts.size(); ++i) {
+    threads.emplace_back([&plan, &plaintext, &parts, i]() {
+      int64_t start = plan->PlaintextPosition(i * segments_per_part);
+      int64_t end = std::min<int64_t>(
+          plan->PlaintextPosition((i + 1) * segments_per_part),
+          plaintext.size());
+      auto part_result =
+          plan->EncryptPart(i * segments_per_part,
+                            absl::string_view(plaintext).substr(start,
+                                                                end - start),
+                            i + 1 == parts.size());
+      EXPECT_THAT(part_result.status(), IsOk());
+      if (part_result.ok()) parts[i] = part_result.ValueOrDie();
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  std::string ciphertext;
+  for (const auto& part : parts) ciphertext += part;
+  EXPECT_THAT(ciphertext,
+              Eq(NewEncrypter(/* ct_offset = */ 0)
+                     ->GenerateCiphertext(plaintext)));
+}
+
+TEST(MultipartEncryptionPlanTest, InvalidParts) {
+  auto plan = NewPlan(/* ct_offset = */ 0);
+  // Not a whole number of segments.
+  EXPECT_THAT(plan->EncryptPart(1, std::string(kSegmentSize + 1, 'a'),
+                                /* is_last_part = */ false)
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  // Empty parts.
+  EXPECT_THAT(plan->EncryptPart(1, "", /* is_last_part = */ true).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(plan->EncryptPart(0, "", /* is_last_part = */ false).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(plan->EncryptPart(-1, "a", /* is_last_part = */ true).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(MultipartEncryptionPlanTest, NullEncrypter) {
+  EXPECT_THAT(MultipartEncryptionPlan::New(nullptr).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
@@ -16,16 +16,23 @@
 
 #include "tink/subtle/nonce_based_streaming_aead.h"
 
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/memory/memory.h"
 #include "absl/strings/string_view.h"
 #include "tink/input_stream.h"
 #include "tink/output_stream.h"
 #include "tink/random_access_stream.h"
 #include "tink/streaming_aead.h"
+#include "tink/subtle/ciphertext_stream_verifier.h"
 #include "tink/subtle/decrypting_random_access_stream.h"
 #include "tink/subtle/stream_segment_decrypter.h"
 #include "tink/subtle/stream_segment_encrypter.h"
 #include "tink/subtle/streaming_aead_decrypting_stream.h"
 #include "tink/subtle/streaming_aead_encrypting_stream.h"
+#include "tink/util/status.h"
 #include "tink/util/statusor.h"
 
 namespace crypto {
@@ -43,6 +50,163 @@ crypto::tink::util::StatusOr<std::unique_ptr<crypto::tink::OutputStream>>
       std::move(ciphertext_destination));
 }
 
+crypto::tink::util::StatusOr<std::string>
+    NonceBasedStreamingAead::EncryptSmall(absl::string_view plaintext,
+                                          absl::string_view associated_data) {
+  auto segment_encrypter_result = NewSegmentEncrypter(associated_data);
+  if (!segment_encrypter_result.ok()) return segment_encrypter_result.status();
+  StreamSegmentEncrypter& segment_encrypter =
+      *segment_encrypter_result.ValueOrDie();
+  const std::vector<uint8_t>& header = segment_encrypter.get_header();
+  // The first segment is shorter by the header, as in an encrypting stream.
+  const int first_segment_size =
+      segment_encrypter.get_plaintext_segment_size() -
+      segment_encrypter.get_ciphertext_offset() -
+      static_cast<int>(header.size());
+  if (plaintext.size() > static_cast<size_t>(first_segment_size)) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "plaintext too long for a single segment");
+  }
+  const int segment_overhead = segment_encrypter.get_ciphertext_segment_size() -
+                               segment_encrypter.get_plaintext_segment_size();
+  std::vector<uint8_t> segment;
+  segment.reserve(plaintext.size() + segment_overhead);
+  segment.assign(plaintext.begin(), plaintext.end());
+  auto status = segment_encrypter.EncryptSegmentInPlace(
+      /* segment_number = */ 0, /* is_last_segment = */ true, &segment);
+  if (status.error_code() == util::error::UNIMPLEMENTED) {
+    std::vector<uint8_t> ciphertext_segment;
+    status = segment_encrypter.EncryptSegment(
+        segment, /* is_last_segment = */ true, &ciphertext_segment);
+    segment = std::move(ciphertext_segment);
+  }
+  if (!status.ok()) return status;
+  std::string ciphertext;
+  ciphertext.reserve(header.size() + segment.size());
+  ciphertext.append(header.begin(), header.end());
+  ciphertext.append(segment.begin(), segment.end());
+  return std::move(ciphertext);
+}
+
+crypto::tink::util::StatusOr<std::string>
+    NonceBasedStreamingAead::DecryptSmall(absl::string_view ciphertext,
+                                          absl::string_view associated_data) {
+  auto segment_decrypter_result = NewSegmentDecrypter(associated_data);
+  if (!segment_decrypter_result.ok()) return segment_decrypter_result.status();
+  StreamSegmentDecrypter& segment_decrypter =
+      *segment_decrypter_result.ValueOrDie();
+  const int header_size = segment_decrypter.get_header_size();
+  const int first_segment_size =
+      segment_decrypter.get_ciphertext_segment_size() -
+      segment_decrypter.get_ciphertext_offset() - header_size;
+  if (ciphertext.size() < static_cast<size_t>(header_size)) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "ciphertext too short");
+  }
+  if (ciphertext.size() - header_size >
+      static_cast<size_t>(first_segment_size)) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "ciphertext too long for a single segment");
+  }
+  auto status = segment_decrypter.Init(std::vector<uint8_t>(
+      ciphertext.begin(), ciphertext.begin() + header_size));
+  if (!status.ok()) return status;
+  std::vector<uint8_t> segment(ciphertext.begin() + header_size,
+                               ciphertext.end());
+  status = segment_decrypter.DecryptSegmentInPlace(
+      /* segment_number = */ 0, /* is_last_segment = */ true, &segment);
+  if (status.error_code() == util::error::UNIMPLEMENTED) {
+    std::vector<uint8_t> plaintext_segment;
+    status = segment_decrypter.DecryptSegment(
+        segment, /* segment_number = */ 0, /* is_last_segment = */ true,
+        &plaintext_segment);
+    segment = std::move(plaintext_segment);
+  }
+  if (!status.ok()) return status;
+  return std::string(segment.begin(), segment.end());
+}
+
+crypto::tink::util::StatusOr<std::unique_ptr<crypto::tink::OutputStream>>
+    NonceBasedStreamingAead::NewParallelEncryptingStream(
+        std::unique_ptr<crypto::tink::OutputStream> ciphertext_destination,
+        absl::string_view associated_data,
+        StreamingAeadEncryptingStream::ParallelOptions options) {
+  auto segment_encrypter_result = NewSegmentEncrypter(associated_data);
+  if (!segment_encrypter_result.ok()) return segment_encrypter_result.status();
+  return StreamingAeadEncryptingStream::NewParallel(
+      std::move(segment_encrypter_result.ValueOrDie()),
+      std::move(ciphertext_destination), std::move(options));
+}
+
+crypto::tink::util::StatusOr<std::unique_ptr<StreamingAeadEncryptingStream>>
+    NonceBasedStreamingAead::NewResumableEncryptingStream(
+        std::unique_ptr<crypto::tink::OutputStream> ciphertext_destination,
+        absl::string_view associated_data) {
+  auto segment_encrypter_result = NewSegmentEncrypter(associated_data);
+  if (!segment_encrypter_result.ok()) return segment_encrypter_result.status();
+  auto stream_result = StreamingAeadEncryptingStream::New(
+      std::move(segment_encrypter_result.ValueOrDie()),
+      std::move(ciphertext_destination));
+  if (!stream_result.ok()) return stream_result.status();
+  return {absl::WrapUnique(static_cast<StreamingAeadEncryptingStream*>(
+      stream_result.ValueOrDie().release()))};
+}
+
+crypto::tink::util::StatusOr<std::unique_ptr<StreamingAeadEncryptingStream>>
+    NonceBasedStreamingAead::ResumeEncryptingStream(
+        std::unique_ptr<crypto::tink::OutputStream> ciphertext_destination,
+        absl::string_view associated_data,
+        const StreamingAeadEncryptingStream::Checkpoint& checkpoint) {
+  auto segment_encrypter_result =
+      NewSegmentEncrypterForHeader(associated_data, checkpoint.header);
+  if (!segment_encrypter_result.ok()) return segment_encrypter_result.status();
+  return StreamingAeadEncryptingStream::NewResumed(
+      std::move(segment_encrypter_result.ValueOrDie()),
+      std::move(ciphertext_destination), checkpoint);
+}
+
+crypto::tink::util::StatusOr<std::unique_ptr<MultipartEncryptionPlan>>
+    NonceBasedStreamingAead::NewMultipartEncryptionPlan(
+        absl::string_view associated_data) {
+  auto segment_encrypter_result = NewSegmentEncrypter(associated_data);
+  if (!segment_encrypter_result.ok()) return segment_encrypter_result.status();
+  return MultipartEncryptionPlan::New(
+      std::move(segment_encrypter_result.ValueOrDie()));
+}
+
+crypto::tink::util::StatusOr<std::unique_ptr<MultipartEncryptionPlan>>
+    NonceBasedStreamingAead::GetMultipartEncryptionPlan(
+        absl::string_view associated_data, absl::string_view header) {
+  auto segment_encrypter_result =
+      NewSegmentEncrypterForHeader(associated_data, header);
+  if (!segment_encrypter_result.ok()) return segment_encrypter_result.status();
+  return MultipartEncryptionPlan::New(
+      std::move(segment_encrypter_result.ValueOrDie()));
+}
+
+crypto::tink::util::StatusOr<std::unique_ptr<EncryptedRecordLogWriter>>
+    NonceBasedStreamingAead::NewRecordLogWriter(
+        std::unique_ptr<crypto::tink::OutputStream> ciphertext_destination,
+        absl::string_view associated_data,
+        const EncryptedRecordLogWriter::Options& options) {
+  auto segment_encrypter_result = NewSegmentEncrypter(associated_data);
+  if (!segment_encrypter_result.ok()) return segment_encrypter_result.status();
+  return EncryptedRecordLogWriter::New(
+      std::move(segment_encrypter_result.ValueOrDie()),
+      std::move(ciphertext_destination), options);
+}
+
+crypto::tink::util::StatusOr<std::unique_ptr<EncryptedRecordLogReader>>
+    NonceBasedStreamingAead::NewRecordLogReader(
+        std::unique_ptr<crypto::tink::RandomAccessStream> ciphertext_source,
+        absl::string_view associated_data) {
+  auto segment_decrypter_result = NewSegmentDecrypter(associated_data);
+  if (!segment_decrypter_result.ok()) return segment_decrypter_result.status();
+  return EncryptedRecordLogReader::New(
+      std::move(segment_decrypter_result.ValueOrDie()),
+      std::move(ciphertext_source));
+}
+
 crypto::tink::util::StatusOr<std::unique_ptr<crypto::tink::InputStream>>
     NonceBasedStreamingAead::NewDecryptingStream(
         std::unique_ptr<crypto::tink::InputStream> ciphertext_source,
@@ -54,6 +218,18 @@ crypto::tink::util::StatusOr<std::unique_ptr<crypto::tink::InputStream>>
       std::move(ciphertext_source));
 }
 
+crypto::tink::util::StatusOr<std::unique_ptr<crypto::tink::InputStream>>
+    NonceBasedStreamingAead::NewChunkedDecryptingStream(
+        std::unique_ptr<crypto::tink::InputStream> ciphertext_source,
+        absl::string_view associated_data,
+        StreamingAeadDecryptingStream::ChunkedOptions options) {
+  auto segment_decrypter_result = NewSegmentDecrypter(associated_data);
+  if (!segment_decrypter_result.ok()) return segment_decrypter_result.status();
+  return StreamingAeadDecryptingStream::NewChunked(
+      std::move(segment_decrypter_result.ValueOrDie()),
+      std::move(ciphertext_source), options);
+}
+
 crypto::tink::util::StatusOr<std::unique_ptr<crypto::tink::RandomAccessStream>>
     NonceBasedStreamingAead::NewDecryptingRandomAccessStream(
         std::unique_ptr<crypto::tink::RandomAccessStream> ciphertext_source,
@@ -65,6 +241,30 @@ crypto::tink::util::StatusOr<std::unique_ptr<crypto::tink::RandomAccessStream>>
       std::move(ciphertext_source));
 }
 
+crypto::tink::util::StatusOr<std::unique_ptr<crypto::tink::RandomAccessStream>>
+    NonceBasedStreamingAead::NewParallelDecryptingRandomAccessStream(
+        std::unique_ptr<crypto::tink::RandomAccessStream> ciphertext_source,
+        absl::string_view associated_data,
+        DecryptingRandomAccessStream::ParallelOptions options) {
+  auto segment_decrypter_result = NewSegmentDecrypter(associated_data);
+  if (!segment_decrypter_result.ok()) return segment_decrypter_result.status();
+  return DecryptingRandomAccessStream::NewParallel(
+      std::move(segment_decrypter_result.ValueOrDie()),
+      std::move(ciphertext_source), std::move(options));
+}
+
+util::Status NonceBasedStreamingAead::VerifyCiphertext(
+    crypto::tink::RandomAccessStream* ciphertext_source,
+    absl::string_view associated_data,
+    const CiphertextStreamVerifier::Options& options,
+    int64_t* invalid_segment) {
+  auto segment_decrypter_result = NewSegmentDecrypter(associated_data);
+  if (!segment_decrypter_result.ok()) return segment_decrypter_result.status();
+  return CiphertextStreamVerifier::Verify(
+      std::move(segment_decrypter_result.ValueOrDie()), ciphertext_source,
+      options, invalid_segment);
+}
+
 }  // namespace subtle
 }  // namespace tink
 }  // namespace crypto
@@ -17,13 +17,23 @@
 #ifndef TINK_SUBTLE_NONCE_BASED_STREAMING_AEAD_H_
 #define TINK_SUBTLE_NONCE_BASED_STREAMING_AEAD_H_
 
+#include <cstdint>
+#include <string>
+
 #include "absl/strings/string_view.h"
 #include "tink/input_stream.h"
 #include "tink/output_stream.h"
 #include "tink/random_access_stream.h"
 #include "tink/streaming_aead.h"
+#include "tink/subtle/ciphertext_stream_verifier.h"
+#include "tink/subtle/decrypting_random_access_stream.h"
+#include "tink/subtle/encrypted_record_log.h"
+#include "tink/subtle/multipart_encryption_plan.h"
 #include "tink/subtle/stream_segment_decrypter.h"
 #include "tink/subtle/stream_segment_encrypter.h"
+#include "tink/subtle/streaming_aead_decrypting_stream.h"
+#include "tink/subtle/streaming_aead_encrypting_stream.h"
+#include "tink/util/status.h"
 #include "tink/util/statusor.h"
 
 namespace crypto {
@@ -53,6 +63,96 @@ class NonceBasedStreamingAead : public StreamingAead {
       std::unique_ptr<crypto::tink::RandomAccessStream> ciphertext_source,
       absl::string_view associated_data) override;
 
+  // Encrypts 'plaintext' as a stream of a single segment, without the
+  // buffers of an encrypting stream.
+  crypto::tink::util::StatusOr<std::string> EncryptSmall(
+      absl::string_view plaintext, absl::string_view associated_data) override;
+
+  crypto::tink::util::StatusOr<std::string> DecryptSmall(
+      absl::string_view ciphertext, absl::string_view associated_data) override;
+
+  // Like NewEncryptingStream(), but encrypts several segments concurrently,
+  // see StreamingAeadEncryptingStream::NewParallel().
+  crypto::tink::util::StatusOr<std::unique_ptr<crypto::tink::OutputStream>>
+  NewParallelEncryptingStream(
+      std::unique_ptr<crypto::tink::OutputStream> ciphertext_destination,
+      absl::string_view associated_data,
+      StreamingAeadEncryptingStream::ParallelOptions options);
+
+  // Like NewEncryptingStream(), but returns a stream whose GetCheckpoint()
+  // can be used to resume an interrupted encryption with
+  // ResumeEncryptingStream().
+  crypto::tink::util::StatusOr<std::unique_ptr<StreamingAeadEncryptingStream>>
+  NewResumableEncryptingStream(
+      std::unique_ptr<crypto::tink::OutputStream> ciphertext_destination,
+      absl::string_view associated_data);
+
+  // Returns a stream that continues the encryption of an earlier stream
+  // with the same 'associated_data' at 'checkpoint', see
+  // StreamingAeadEncryptingStream::NewResumed(), in particular for the
+  // requirements on the plaintext and on 'ciphertext_destination'.
+  crypto::tink::util::StatusOr<std::unique_ptr<StreamingAeadEncryptingStream>>
+  ResumeEncryptingStream(
+      std::unique_ptr<crypto::tink::OutputStream> ciphertext_destination,
+      absl::string_view associated_data,
+      const StreamingAeadEncryptingStream::Checkpoint& checkpoint);
+
+  // Returns a plan for a new ciphertext stream with 'associated_data', which
+  // is encrypted in independent parts, see MultipartEncryptionPlan.
+  crypto::tink::util::StatusOr<std::unique_ptr<MultipartEncryptionPlan>>
+  NewMultipartEncryptionPlan(absl::string_view associated_data);
+
+  // Returns the plan with the given 'header', i.e. the header() of a plan
+  // from NewMultipartEncryptionPlan() with the same 'associated_data', e.g.
+  // to encrypt some of its parts on another machine.
+  crypto::tink::util::StatusOr<std::unique_ptr<MultipartEncryptionPlan>>
+  GetMultipartEncryptionPlan(absl::string_view associated_data,
+                             absl::string_view header);
+
+  // Returns a writer of an encrypted log of records with 'associated_data'
+  // to 'ciphertext_destination', see EncryptedRecordLogWriter.
+  crypto::tink::util::StatusOr<std::unique_ptr<EncryptedRecordLogWriter>>
+  NewRecordLogWriter(
+      std::unique_ptr<crypto::tink::OutputStream> ciphertext_destination,
+      absl::string_view associated_data,
+      const EncryptedRecordLogWriter::Options& options);
+
+  // Returns a reader of a log written by NewRecordLogWriter() with the same
+  // 'associated_data', see EncryptedRecordLogReader.
+  crypto::tink::util::StatusOr<std::unique_ptr<EncryptedRecordLogReader>>
+  NewRecordLogReader(
+      std::unique_ptr<crypto::tink::RandomAccessStream> ciphertext_source,
+      absl::string_view associated_data);
+
+  // Like NewDecryptingStream(), but every Next() of the returned stream
+  // returns the plaintext of several segments at once, see
+  // StreamingAeadDecryptingStream::NewChunked().
+  crypto::tink::util::StatusOr<std::unique_ptr<crypto::tink::InputStream>>
+  NewChunkedDecryptingStream(
+      std::unique_ptr<crypto::tink::InputStream> ciphertext_source,
+      absl::string_view associated_data,
+      StreamingAeadDecryptingStream::ChunkedOptions options);
+
+  // Like NewDecryptingRandomAccessStream(), but decrypts several segments
+  // concurrently, see DecryptingRandomAccessStream::NewParallel().
+  crypto::tink::util::StatusOr<
+      std::unique_ptr<crypto::tink::RandomAccessStream>>
+  NewParallelDecryptingRandomAccessStream(
+      std::unique_ptr<crypto::tink::RandomAccessStream> ciphertext_source,
+      absl::string_view associated_data,
+      DecryptingRandomAccessStream::ParallelOptions options);
+
+  // Checks that 'ciphertext_source' holds an authentic ciphertext stream for
+  // 'associated_data', without producing the plaintext, see
+  // CiphertextStreamVerifier::Verify(). Returns the error of the first
+  // invalid segment, whose number is stored in 'invalid_segment' if it is
+  // non-null.
+  crypto::tink::util::Status VerifyCiphertext(
+      crypto::tink::RandomAccessStream* ciphertext_source,
+      absl::string_view associated_data,
+      const CiphertextStreamVerifier::Options& options,
+      int64_t* invalid_segment = nullptr);
+
  protected:
   // Methods to be implemented by a subclass of this class.
 
@@ -63,6 +163,17 @@ class NonceBasedStreamingAead : public StreamingAead {
   // Returns a new StreamSegmentDecrypter that uses `associated_data` for AEAD.
   virtual crypto::tink::util::StatusOr<std::unique_ptr<StreamSegmentDecrypter>>
   NewSegmentDecrypter(absl::string_view associated_data) const = 0;
+
+  // Returns a new StreamSegmentEncrypter that uses `associated_data` for AEAD
+  // and continues a stream with the given `header`, as produced by an earlier
+  // encrypter. Needed only to support ResumeEncryptingStream() and
+  // GetMultipartEncryptionPlan().
+  virtual crypto::tink::util::StatusOr<std::unique_ptr<StreamSegmentEncrypter>>
+  NewSegmentEncrypterForHeader(absl::string_view associated_data,
+                               absl::string_view header) const {
+    return util::Status(util::error::UNIMPLEMENTED,
+                        "Resuming encryption is not supported");
+  }
 };
 
 }  // namespace subtle
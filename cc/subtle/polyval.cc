@@ -0,0 +1,209 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/subtle/polyval.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include "absl/types/span.h"
+#include "openssl/mem.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define TINK_POLYVAL_CLMUL 1
+#include <immintrin.h>
+#endif
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+constexpr int Polyval::kBlockSize;
+
+namespace {
+
+uint64_t LoadLe64(const uint8_t* in) {
+  uint64_t value = 0;
+  for (int i = 7; i >= 0; i--) value = (value << 8) | in[i];
+  return value;
+}
+
+void StoreLe64(uint64_t value, uint8_t* out) {
+  for (int i = 0; i < 8; i++) out[i] = value >> (8 * i);
+}
+
+// out = a * b * x^-128 in GF(2^128) modulo x^128 + x^127 + x^126 + x^121 + 1,
+// i.e. dot(a, b) of RFC 8452. Constant-time.
+void DotPortable(const uint64_t a[2], const uint64_t b[2], uint64_t out[2]) {
+  uint64_t lo = 0;
+  uint64_t hi = 0;
+  for (int i = 0; i < 128; i++) {
+    uint64_t bit = (i < 64 ? b[0] >> i : b[1] >> (i - 64)) & 1;
+    uint64_t mask = 0 - bit;
+    lo ^= a[0] & mask;
+    hi ^= a[1] & mask;
+    // Multiplies by x^-1: adds the modulus if the constant term is set, and
+    // divides by x.
+    uint64_t reduce = 0 - (lo & 1);
+    lo ^= reduce & 1;
+    hi ^= reduce & 0xc200000000000000;
+    lo = (lo >> 1) | (hi << 63);
+    hi = (hi >> 1) | (reduce & 0x8000000000000000);
+  }
+  out[0] = lo;
+  out[1] = hi;
+}
+
+#ifdef TINK_POLYVAL_CLMUL
+
+#define TINK_CLMUL_TARGET __attribute__((target("pclmul,sse2")))
+
+TINK_CLMUL_TARGET inline __m128i Load(const uint64_t value[2]) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(value));
+}
+
+// The unreduced 256-bit product a * b, as lo and hi halves.
+TINK_CLMUL_TARGET inline void ClmulProduct(__m128i a, __m128i b, __m128i* lo,
+                                           __m128i* hi) {
+  __m128i low = _mm_clmulepi64_si128(a, b, 0x00);
+  __m128i high = _mm_clmulepi64_si128(a, b, 0x11);
+  __m128i middle = _mm_xor_si128(_mm_clmulepi64_si128(a, b, 0x10),
+                                 _mm_clmulepi64_si128(a, b, 0x01));
+  *lo = _mm_xor_si128(*lo, _mm_xor_si128(low, _mm_slli_si128(middle, 8)));
+  *hi = _mm_xor_si128(*hi, _mm_xor_si128(high, _mm_srli_si128(middle, 8)));
+}
+
+// Returns (hi * x^128 + lo) * x^-128, reduced. Each of the two folds
+// multiplies the low 64 bits by x^-64.
+TINK_CLMUL_TARGET inline __m128i ClmulReduce(__m128i lo, __m128i hi) {
+  const __m128i poly = _mm_set_epi64x(0xc200000000000000, 1);
+  lo = _mm_xor_si128(_mm_shuffle_epi32(lo, 78),
+                     _mm_clmulepi64_si128(lo, poly, 0x10));
+  lo = _mm_xor_si128(_mm_shuffle_epi32(lo, 78),
+                     _mm_clmulepi64_si128(lo, poly, 0x10));
+  return _mm_xor_si128(hi, lo);
+}
+
+TINK_CLMUL_TARGET void DotClmul(const uint64_t a[2], const uint64_t b[2],
+                                uint64_t out[2]) {
+  __m128i lo = _mm_setzero_si128();
+  __m128i hi = _mm_setzero_si128();
+  ClmulProduct(Load(a), Load(b), &lo, &hi);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out), ClmulReduce(lo, hi));
+}
+
+// Absorbs 'num_blocks' blocks of 'data' into 'state'.
+TINK_CLMUL_TARGET void UpdateClmul(const uint64_t powers[4][2],
+                                   const uint8_t* data, size_t num_blocks,
+                                   uint64_t state[2]) {
+  const __m128i h1 = Load(powers[0]);
+  const __m128i h2 = Load(powers[1]);
+  const __m128i h3 = Load(powers[2]);
+  const __m128i h4 = Load(powers[3]);
+  __m128i s = Load(state);
+  const __m128i* in = reinterpret_cast<const __m128i*>(data);
+  for (; num_blocks >= 4; num_blocks -= 4, in += 4) {
+    __m128i lo = _mm_setzero_si128();
+    __m128i hi = _mm_setzero_si128();
+    ClmulProduct(_mm_xor_si128(s, _mm_loadu_si128(in)), h4, &lo, &hi);
+    ClmulProduct(_mm_loadu_si128(in + 1), h3, &lo, &hi);
+    ClmulProduct(_mm_loadu_si128(in + 2), h2, &lo, &hi);
+    ClmulProduct(_mm_loadu_si128(in + 3), h1, &lo, &hi);
+    s = ClmulReduce(lo, hi);
+  }
+  for (; num_blocks > 0; num_blocks--, in++) {
+    __m128i lo = _mm_setzero_si128();
+    __m128i hi = _mm_setzero_si128();
+    ClmulProduct(_mm_xor_si128(s, _mm_loadu_si128(in)), h1, &lo, &hi);
+    s = ClmulReduce(lo, hi);
+  }
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(state), s);
+}
+
+#undef TINK_CLMUL_TARGET
+
+#endif  // TINK_POLYVAL_CLMUL
+
+void UpdatePortable(const uint64_t h[2], const uint8_t* data,
+                    size_t num_blocks, uint64_t state[2]) {
+  for (size_t i = 0; i < num_blocks; i++, data += Polyval::kBlockSize) {
+    uint64_t x[2] = {state[0] ^ LoadLe64(data), state[1] ^ LoadLe64(data + 8)};
+    DotPortable(x, h, state);
+  }
+}
+
+void Dot(const uint64_t a[2], const uint64_t b[2], uint64_t out[2]) {
+#ifdef TINK_POLYVAL_CLMUL
+  if (Polyval::IsAccelerated()) {
+    DotClmul(a, b, out);
+    return;
+  }
+#endif
+  DotPortable(a, b, out);
+}
+
+}  // namespace
+
+// static
+bool Polyval::IsAccelerated() {
+#ifdef TINK_POLYVAL_CLMUL
+  static const bool accelerated = __builtin_cpu_supports("pclmul");
+  return accelerated;
+#else
+  return false;
+#endif
+}
+
+Polyval::Polyval(const uint8_t key[kBlockSize]) {
+  powers_[0][0] = LoadLe64(key);
+  powers_[0][1] = LoadLe64(key + 8);
+  for (int i = 1; i < 4; i++) Dot(powers_[i - 1], powers_[0], powers_[i]);
+}
+
+Polyval::~Polyval() {
+  OPENSSL_cleanse(powers_, sizeof(powers_));
+  OPENSSL_cleanse(state_, sizeof(state_));
+}
+
+void Polyval::Update(absl::Span<const uint8_t> data) {
+  size_t num_blocks = data.size() / kBlockSize;
+#ifdef TINK_POLYVAL_CLMUL
+  if (IsAccelerated()) {
+    UpdateClmul(powers_, data.data(), num_blocks, state_);
+  } else {
+    UpdatePortable(powers_[0], data.data(), num_blocks, state_);
+  }
+#else
+  UpdatePortable(powers_[0], data.data(), num_blocks, state_);
+#endif
+  size_t rest = data.size() % kBlockSize;
+  if (rest != 0) {
+    uint8_t block[kBlockSize] = {0};
+    std::memcpy(block, &data[num_blocks * kBlockSize], rest);
+    uint64_t x[2] = {state_[0] ^ LoadLe64(block),
+                     state_[1] ^ LoadLe64(block + 8)};
+    Dot(x, powers_[0], state_);
+  }
+}
+
+void Polyval::Finish(uint8_t out[kBlockSize]) const {
+  StoreLe64(state_[0], out);
+  StoreLe64(state_[1], out + 8);
+}
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
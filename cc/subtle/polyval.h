@@ -0,0 +1,65 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_SUBTLE_POLYVAL_H_
+#define TINK_SUBTLE_POLYVAL_H_
+
+#include <cstdint>
+
+#include "absl/types/span.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+// POLYVAL, the universal hash function of AES-GCM-SIV (RFC 8452, section 3).
+//
+// On x86-64 CPUs with carry-less multiplication, four blocks are multiplied
+// by H^4, ..., H and reduced together, so that the multiplications of a
+// block do not wait for the previous one. Elsewhere a constant-time portable
+// implementation is used, which is much slower; see IsAccelerated().
+class Polyval {
+ public:
+  static constexpr int kBlockSize = 16;
+
+  // 'key' is the 16-byte hash key H.
+  explicit Polyval(const uint8_t key[kBlockSize]);
+  ~Polyval();
+
+  Polyval(const Polyval&) = delete;
+  Polyval& operator=(const Polyval&) = delete;
+
+  // Absorbs 'data', padded with zeros to a multiple of kBlockSize bytes.
+  void Update(absl::Span<const uint8_t> data);
+
+  // Writes the hash of all data absorbed so far.
+  void Finish(uint8_t out[kBlockSize]) const;
+
+  // Returns true if carry-less multiplication is used.
+  static bool IsAccelerated();
+
+ private:
+  // Field elements as little-endian 64-bit halves {low, high}.
+  // powers_[i] is H^(i + 1).
+  uint64_t powers_[4][2];
+  uint64_t state_[2] = {0, 0};
+};
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_SUBTLE_POLYVAL_H_
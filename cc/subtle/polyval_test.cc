@@ -0,0 +1,88 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/subtle/polyval.h"
+
+#include <cstdint>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "absl/types/span.h"
+#include "tink/subtle/random.h"
+#include "tink/util/test_util.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+namespace {
+
+absl::Span<const uint8_t> ToSpan(const std::string& s) {
+  return absl::MakeConstSpan(reinterpret_cast<const uint8_t*>(s.data()),
+                             s.size());
+}
+
+std::string Hash(const std::string& key, const std::string& data) {
+  Polyval polyval(reinterpret_cast<const uint8_t*>(key.data()));
+  polyval.Update(ToSpan(data));
+  uint8_t out[Polyval::kBlockSize];
+  polyval.Finish(out);
+  return std::string(reinterpret_cast<const char*>(out), sizeof(out));
+}
+
+// RFC 8452, Appendix A.
+TEST(PolyvalTest, TestVector) {
+  std::string key = test::HexDecodeOrDie("25629347589242761d31f826ba4b757b");
+  std::string data = test::HexDecodeOrDie(
+      "4f4f95668c83dfb6401762bb2d01a262"
+      "d1a24ddd2721d006bbe45f20d3c9f362");
+  EXPECT_EQ(test::HexEncode(Hash(key, data)),
+            "f7a3b47b846119fae5b7866cf5e5b77e");
+}
+
+TEST(PolyvalTest, EmptyInput) {
+  std::string key = Random::GetRandomBytes(Polyval::kBlockSize);
+  EXPECT_EQ(Hash(key, ""), std::string(Polyval::kBlockSize, '\0'));
+}
+
+TEST(PolyvalTest, PadsWithZeros) {
+  std::string key = Random::GetRandomBytes(Polyval::kBlockSize);
+  std::string data = Random::GetRandomBytes(21);
+  EXPECT_EQ(Hash(key, data), Hash(key, data + std::string(11, '\0')));
+}
+
+// Updates in whole blocks must give the same hash as one Update(), whether
+// or not they fill the four-block aggregation.
+TEST(PolyvalTest, Incremental) {
+  std::string key = Random::GetRandomBytes(Polyval::kBlockSize);
+  for (int num_blocks : {1, 3, 4, 5, 9, 17}) {
+    std::string data = Random::GetRandomBytes(num_blocks * Polyval::kBlockSize);
+    Polyval polyval(reinterpret_cast<const uint8_t*>(key.data()));
+    for (int i = 0; i < num_blocks; i++) {
+      polyval.Update(ToSpan(data).subspan(i * Polyval::kBlockSize,
+                                          Polyval::kBlockSize));
+    }
+    uint8_t out[Polyval::kBlockSize];
+    polyval.Finish(out);
+    EXPECT_EQ(std::string(reinterpret_cast<const char*>(out), sizeof(out)),
+              Hash(key, data))
+        << num_blocks << " blocks";
+  }
+}
+
+}  // namespace
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
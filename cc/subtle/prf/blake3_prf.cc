@@ -0,0 +1,80 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/subtle/prf/blake3_prf.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "tink/prf/prf_set.h"
+#include "tink/subtle/blake3.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+constexpr int Blake3Prf::kKeySize;
+constexpr size_t Blake3Prf::kMaxOutputLength;
+
+// static
+util::StatusOr<std::unique_ptr<Prf>> Blake3Prf::New(util::SecretData key) {
+  auto status = CheckFipsCompatibility<Blake3Prf>();
+  if (!status.ok()) return status;
+  if (key.size() != kKeySize) {
+    return util::Status(util::error::INVALID_ARGUMENT, "invalid key size");
+  }
+  return {absl::WrapUnique(new Blake3Prf(std::move(key)))};
+}
+
+util::StatusOr<std::string> Blake3Prf::Compute(absl::string_view input,
+                                               size_t output_length) const {
+  if (output_length > kMaxOutputLength) {
+    return util::Status(
+        util::error::INVALID_ARGUMENT,
+        absl::StrCat("Output length ", output_length,
+                     " is larger than the maximum of ", kMaxOutputLength));
+  }
+  Blake3Hasher hasher(key_.data());
+  hasher.Update(input);
+  std::string output(output_length, '\0');
+  hasher.Finish(absl::MakeSpan(reinterpret_cast<uint8_t*>(&output[0]),
+                               output.size()));
+  return output;
+}
+
+util::StatusOr<uint64_t> Blake3Prf::ComputeUint64(
+    absl::string_view input) const {
+  Blake3Hasher hasher(key_.data());
+  hasher.Update(input);
+  uint8_t buf[8];
+  hasher.Finish(absl::MakeSpan(buf));
+  uint64_t value = 0;
+  for (uint8_t b : buf) value = (value << 8) | b;
+  return value;
+}
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,66 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_SUBTLE_PRF_BLAKE3_PRF_H_
+#define TINK_SUBTLE_PRF_BLAKE3_PRF_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/strings/string_view.h"
+#include "tink/config/tink_fips.h"
+#include "tink/prf/prf_set.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+// BLAKE3 in the keyed hash mode as a Prf. The output is the extendable
+// output of BLAKE3, so outputs of any length up to kMaxOutputLength are
+// prefixes of each other.
+class Blake3Prf : public Prf {
+ public:
+  static constexpr int kKeySize = 32;
+  static constexpr size_t kMaxOutputLength = 1 << 16;
+
+  static crypto::tink::util::StatusOr<std::unique_ptr<Prf>> New(
+      util::SecretData key);
+
+  crypto::tink::util::StatusOr<std::string> Compute(
+      absl::string_view input, size_t output_length) const override;
+
+  // Computes only the first 8 bytes of output, without allocating.
+  crypto::tink::util::StatusOr<uint64_t> ComputeUint64(
+      absl::string_view input) const override;
+
+  static constexpr crypto::tink::FipsCompatibility kFipsStatus =
+      crypto::tink::FipsCompatibility::kNotFips;
+
+ private:
+  explicit Blake3Prf(util::SecretData key) : key_(std::move(key)) {}
+
+  const util::SecretData key_;
+};
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_SUBTLE_PRF_BLAKE3_PRF_H_
@@ -0,0 +1,99 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/subtle/prf/blake3_prf.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "tink/config/tink_fips.h"
+#include "tink/prf/prf_set.h"
+#include "tink/subtle/random.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/test_matchers.h"
+#include "tink/util/test_util.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+namespace {
+
+using ::crypto::tink::test::HexEncode;
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::testing::Eq;
+using ::testing::SizeIs;
+
+util::SecretData TestKey() {
+  return util::SecretDataFromStringView("whats the Elvish word for friend");
+}
+
+TEST(Blake3PrfTest, TestVector) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  auto prf = Blake3Prf::New(TestKey());
+  ASSERT_THAT(prf.status(), IsOk());
+  std::string input(2049, '\0');
+  for (int i = 0; i < input.size(); i++) input[i] = i % 251;
+  EXPECT_THAT(
+      HexEncode(prf.ValueOrDie()->Compute(input, 64).ValueOrDie()),
+      Eq("9f29700902f7c86e514ddc4df1e3049f258b2472b6dd5267f61bf13983b78dd5"
+         "f9a88abfefdfa1e00b418971f2b39c64ca621e8eb37fceac57fd0c8fc8e117d4"));
+  EXPECT_THAT(prf.ValueOrDie()->ComputeUint64(input).ValueOrDie(),
+              Eq(0x9f29700902f7c86eULL));
+}
+
+TEST(Blake3PrfTest, OutputsArePrefixes) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  std::unique_ptr<Prf> prf = Blake3Prf::New(TestKey()).ValueOrDie();
+  std::string input = Random::GetRandomBytes(100);
+  std::string output =
+      prf->Compute(input, Blake3Prf::kMaxOutputLength).ValueOrDie();
+  EXPECT_THAT(output, SizeIs(Blake3Prf::kMaxOutputLength));
+  for (size_t length : {0, 1, 31, 32, 65, 1000}) {
+    EXPECT_THAT(prf->Compute(input, length).ValueOrDie(),
+                Eq(output.substr(0, length)));
+  }
+  EXPECT_THAT(prf->Compute(input, Blake3Prf::kMaxOutputLength + 1).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(Blake3PrfTest, InvalidKeySize) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  EXPECT_THAT(Blake3Prf::New(util::SecretData(16)).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(Blake3PrfTest, FipsOnly) {
+  if (!kUseOnlyFips) {
+    GTEST_SKIP() << "Only supported in FIPS-only mode";
+  }
+  EXPECT_THAT(Blake3Prf::New(TestKey()).status(),
+              StatusIs(util::error::INTERNAL));
+}
+
+}  // namespace
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
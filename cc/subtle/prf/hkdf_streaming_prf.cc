@@ -15,14 +15,15 @@
 #include "tink/subtle/prf/hkdf_streaming_prf.h"
 
 #include <algorithm>
+#include <memory>
 #include <utility>
 
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
 #include "openssl/base.h"
 #include "openssl/hkdf.h"
-#include "openssl/hmac.h"
-#include "tink/subtle/subtle_util.h"
+#include "openssl/evp.h"
+#include "tink/subtle/hmac_batch_boringssl.h"
 #include "tink/subtle/subtle_util_boringssl.h"
 #include "tink/util/secret_data.h"
 #include "tink/util/status.h"
@@ -34,35 +35,36 @@ namespace subtle {
 
 namespace {
 
+// By RFC 5869, the output is at most 255 hash blocks long.
+constexpr int kMaxBlocks = 255;
+
 class HkdfInputStream : public InputStream {
  public:
-  HkdfInputStream(const EVP_MD *digest, const util::SecretData &secret,
-                  absl::string_view salt, absl::string_view input)
-      : input_(input) {
-    stream_status_ = Init(digest, secret, salt);
+  HkdfInputStream(std::shared_ptr<const HmacBatchBoringSsl> prk_hmac,
+                  absl::string_view input)
+      : prk_hmac_(std::move(prk_hmac)),
+        digest_size_(prk_hmac_->digest_size()),
+        message_(digest_size_ + input.size() + 1),
+        ti_(digest_size_) {
+    std::copy(input.begin(), input.end(), message_.begin() + digest_size_);
   }
 
   crypto::tink::util::StatusOr<int> Next(const void **data) override {
-    if (!stream_status_.ok()) {
-      return stream_status_;
-    }
-    if (position_in_ti_ < ti_.size()) {
-      return returnDataFromPosition(data);
-    }
-    if (i_ == 255) {
-      stream_status_ = crypto::tink::util::Status(
-          crypto::tink::util::error::OUT_OF_RANGE, "EOF");
-      return stream_status_;
-    }
-    stream_status_ = UpdateTi();
-    if (!stream_status_.ok()) {
-      return stream_status_;
+    if (i_ == 0 || position_in_ti_ == ti_.size()) {
+      if (i_ == kMaxBlocks) {
+        return crypto::tink::util::Status(
+            crypto::tink::util::error::OUT_OF_RANGE, "EOF");
+      }
+      UpdateTi();
     }
-    return returnDataFromPosition(data);
+    *data = ti_.data() + position_in_ti_;
+    int result = ti_.size() - position_in_ti_;
+    position_in_ti_ = ti_.size();
+    return result;
   }
 
   void BackUp(int count) override {
-    position_in_ti_ -= std::min(std::max(0, count), position_in_ti_);
+    position_in_ti_ -= std::min<size_t>(std::max(0, count), position_in_ti_);
   }
 
   int64_t Position() const override {
@@ -71,102 +73,38 @@ class HkdfInputStream : public InputStream {
   }
 
  private:
-  util::Status Init(const EVP_MD *digest, const util::SecretData &secret,
-                    absl::string_view salt) {
-    // PRK as by RFC 5869, Section 2.2
-    util::SecretData prk(EVP_MAX_MD_SIZE);
-    size_t prk_len;
-
-    if (!digest) {
-      return util::Status(util::error::INVALID_ARGUMENT, "Invalid digest");
-    }
-    const size_t digest_size = EVP_MD_size(digest);
-    if (digest_size == 0) {
-      return util::Status(util::error::INVALID_ARGUMENT,
-                          "Invalid digest size (0)");
-    }
-    ti_.resize(digest_size);
-    if (1 != HKDF_extract(
-                 prk.data(), &prk_len, digest, secret.data(), secret.size(),
-                 reinterpret_cast<const uint8_t *>(salt.data()), salt.size())) {
-      return util::Status(util::error::INTERNAL, "BoringSSL's HKDF failed");
-    }
-    prk.resize(prk_len);
-    if (!hmac_ctx_) {
-      return util::Status(util::error::INTERNAL,
-                          "BoringSSL's HMAC_CTX_new failed");
-    }
-    if (!HMAC_Init_ex(hmac_ctx_.get(), prk.data(), prk.size(), digest,
-                      nullptr)) {
-      return util::Status(util::error::INTERNAL,
-                          "BoringSSL's HMAC_Init_ex failed");
-    }
-    return UpdateTi();
-  }
-
-  int returnDataFromPosition(const void **data) {
-    // There's still data in ti to return.
-    *data = ti_.data() + position_in_ti_;
-    int result = ti_.size() - position_in_ti_;
-    position_in_ti_ = ti_.size();
-    return result;
-  }
-
-  // Sets T(i+i) = HMAC-Hash(PRK, T(i) | info | i + 1) as in RFC 5869,
-  // Section 2.3
-  // Unfortunately, boringSSL does not provide a function which updates T(i)
-  // for a single round; hence we implement this ourselves.
-  util::Status UpdateTi() {
-    if (!HMAC_Init_ex(hmac_ctx_.get(), nullptr, 0, nullptr, nullptr)) {
-      return util::Status(util::error::INTERNAL,
-                          "BoringSSL's HMAC_Init_ex failed");
-    }
-    if (i_ != 0 && !HMAC_Update(hmac_ctx_.get(), ti_.data(), ti_.size())) {
-      return util::Status(util::error::INTERNAL,
-                          "BoringSSL's HMAC_Update failed on ti_");
-    }
-    if (!HMAC_Update(hmac_ctx_.get(),
-                     reinterpret_cast<const uint8_t *>(&input_[0]),
-                     input_.size())) {
-      return util::Status(util::error::INTERNAL,
-                          "BoringSSL's HMAC_Update failed on input_");
-    }
-    uint8_t i_as_uint8 = i_ + 1;
-    if (!HMAC_Update(hmac_ctx_.get(), &i_as_uint8, 1)) {
-      return util::Status(util::error::INTERNAL,
-                          "BoringSSL's HMAC_Update failed on i_");
-    }
-    if (!HMAC_Final(hmac_ctx_.get(), ti_.data(), nullptr)) {
-      return util::Status(util::error::INTERNAL,
-                          "BoringSSL's HMAC_Final failed");
-    }
+  // Sets T(i+1) = HMAC-Hash(PRK, T(i) | info | i + 1) as in RFC 5869,
+  // Section 2.3.
+  void UpdateTi() {
+    message_.back() = i_ + 1;
+    absl::string_view message(reinterpret_cast<const char *>(message_.data()),
+                              message_.size());
+    // T(0) is the empty string.
+    prk_hmac_->Compute(i_ == 0 ? message.substr(digest_size_) : message,
+                       ti_.data());
+    std::copy(ti_.begin(), ti_.end(), message_.begin());
     i_++;
     position_in_ti_ = 0;
-    return util::OkStatus();
   }
 
-  // OUT_OF_RANGE_ERROR in case we returned all the data. Other errors indicate
-  // problems and are permanent.
-  util::Status stream_status_ = util::OkStatus();
-
-  bssl::UniquePtr<HMAC_CTX> hmac_ctx_{HMAC_CTX_new()};
+  const std::shared_ptr<const HmacBatchBoringSsl> prk_hmac_;
+  const size_t digest_size_;
 
+  // T(i) | info | i + 1, the message of the next HMAC computation.
+  util::SecretData message_;
   // Current value T(i).
   util::SecretData ti_;
   // By RFC 5869: 0 <= i_ <= 255*HashLen
   int i_ = 0;
-
-  std::string input_;
-
   // The current position of ti which we returned.
-  int position_in_ti_ = 0;
+  size_t position_in_ti_ = 0;
 };
 
 }  // namespace
 
 std::unique_ptr<InputStream> HkdfStreamingPrf::ComputePrf(
     absl::string_view input) const {
-  return absl::make_unique<HkdfInputStream>(hash_, secret_, salt_, input);
+  return absl::make_unique<HkdfInputStream>(prk_hmac_, input);
 }
 
 // static
@@ -191,8 +129,22 @@ HkdfStreamingPrf::New(HashType hash, util::SecretData secret,
     return util::Status(util::error::UNIMPLEMENTED, "Unsupported hash");
   }
 
-  return {absl::WrapUnique(
-      new HkdfStreamingPrf(evp_md_or.ValueOrDie(), std::move(secret), salt))};
+  // PRK as by RFC 5869, Section 2.2
+  util::SecretData prk(EVP_MAX_MD_SIZE);
+  size_t prk_len;
+  if (1 != HKDF_extract(prk.data(), &prk_len, evp_md_or.ValueOrDie(),
+                        secret.data(), secret.size(),
+                        reinterpret_cast<const uint8_t *>(salt.data()),
+                        salt.size())) {
+    return util::Status(util::error::INTERNAL, "BoringSSL's HKDF failed");
+  }
+  prk.resize(prk_len);
+  auto prk_hmac_or = HmacBatchBoringSsl::New(hash, prk);
+  if (!prk_hmac_or.ok()) return prk_hmac_or.status();
+
+  return {absl::WrapUnique(new HkdfStreamingPrf(
+      std::shared_ptr<const HmacBatchBoringSsl>(
+          std::move(prk_hmac_or.ValueOrDie()))))};
 }
 
 }  // namespace subtle
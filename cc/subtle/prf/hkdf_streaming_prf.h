@@ -20,8 +20,8 @@
 #include <utility>
 
 #include "absl/strings/string_view.h"
-#include "openssl/base.h"
 #include "tink/subtle/common_enums.h"
+#include "tink/subtle/hmac_batch_boringssl.h"
 #include "tink/subtle/prf/streaming_prf.h"
 #include "tink/config/tink_fips.h"
 #include "tink/util/secret_data.h"
@@ -31,6 +31,13 @@ namespace crypto {
 namespace tink {
 namespace subtle {
 
+// HKDF (RFC 5869) as a StreamingPrf, with up to 255 hash blocks of output.
+//
+// The pseudorandom key only depends on the secret and the salt, so it is
+// derived, and HMAC keyed with it, once in New(). The streams compute the
+// expand step with this precomputed HMAC state, one hash block per Next():
+// since the stream cannot know how much of its output will be read, larger
+// blocks would compute output which is never used.
 class HkdfStreamingPrf : public StreamingPrf {
  public:
   static crypto::tink::util::StatusOr<std::unique_ptr<StreamingPrf>> New(
@@ -43,13 +50,12 @@ class HkdfStreamingPrf : public StreamingPrf {
       crypto::tink::FipsCompatibility::kNotFips;
 
  private:
-  HkdfStreamingPrf(const EVP_MD* hash, util::SecretData secret,
-                   absl::string_view salt)
-      : hash_(hash), secret_(std::move(secret)), salt_(salt) {}
+  explicit HkdfStreamingPrf(std::shared_ptr<const HmacBatchBoringSsl> prk_hmac)
+      : prk_hmac_(std::move(prk_hmac)) {}
 
-  const EVP_MD* hash_;
-  const util::SecretData secret_;
-  const std::string salt_;
+  // HMAC keyed with the pseudorandom key. It is shared with the streams,
+  // which may outlive this object.
+  const std::shared_ptr<const HmacBatchBoringSsl> prk_hmac_;
 };
 
 }  // namespace subtle
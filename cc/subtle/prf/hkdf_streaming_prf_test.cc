@@ -14,6 +14,9 @@
 
 #include "tink/subtle/prf/hkdf_streaming_prf.h"
 
+#include <algorithm>
+#include <string>
+
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "tink/subtle/hkdf.h"
@@ -536,6 +539,47 @@ TEST(HkdfStreamingPrf, TestAgainstHkdfUtil) {
               Eq(util::SecretDataAsStringView(compute_hkdf_result)));
 }
 
+// Reads the full output with small reads, Next() calls and backups, which
+// cross the boundaries of the blocks returned by a single Next().
+TEST(HkdfStreamingPrf, MixedReadsAgainstHkdfUtil) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  for (HashType hash : {SHA1, SHA256, SHA512}) {
+    util::SecretData ikm = Random::GetRandomKeyBytes(32);
+    std::string salt = Random::GetRandomBytes(16);
+    std::string info = Random::GetRandomBytes(20);
+    auto streaming_prf_or = HkdfStreamingPrf::New(hash, ikm, salt);
+    ASSERT_THAT(streaming_prf_or.status(), IsOk());
+    std::unique_ptr<InputStream> stream =
+        streaming_prf_or.ValueOrDie()->ComputePrf(info);
+
+    std::string output;
+    for (int i = 0;; i++) {
+      const void* data;
+      auto next_result = stream->Next(&data);
+      if (!next_result.ok()) {
+        EXPECT_THAT(next_result.status(),
+                    StatusIs(util::error::OUT_OF_RANGE));
+        break;
+      }
+      int size = next_result.ValueOrDie();
+      int keep = i % 2 == 0 ? size : std::min(size, 7);
+      output.append(static_cast<const char*>(data), keep);
+      stream->BackUp(size - keep);
+      EXPECT_THAT(stream->Position(), Eq(output.size()));
+    }
+
+    auto compute_hkdf_result_or =
+        Hkdf::ComputeHkdf(hash, ikm, salt, info, output.size());
+    ASSERT_THAT(compute_hkdf_result_or.status(), IsOk());
+    size_t digest_size = hash == SHA1 ? 20 : hash == SHA256 ? 32 : 64;
+    EXPECT_THAT(output, SizeIs(255 * digest_size));
+    EXPECT_THAT(output, Eq(util::SecretDataAsStringView(
+                            compute_hkdf_result_or.ValueOrDie())));
+  }
+}
+
 TEST(HkdfStreamingPrf, TestFipsOnly) {
   if (!kUseOnlyFips) {
     GTEST_SKIP() << "Only supported in FIPS-only mode";
@@ -13,10 +13,14 @@
 ////////////////////////////////////////////////////////////////////////////////
 #include "tink/subtle/prf/prf_set_util.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <memory>
 
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "tink/subtle/mac/stateful_mac.h"
 #include "tink/util/input_stream_util.h"
 #include "tink/util/status.h"
@@ -27,6 +31,12 @@ namespace tink {
 namespace subtle {
 namespace {
 
+uint64_t LoadBigEndian64(const uint8_t* bytes) {
+  uint64_t value = 0;
+  for (int i = 0; i < 8; i++) value = (value << 8) | bytes[i];
+  return value;
+}
+
 class PrfFromStreamingPrf : public Prf {
  public:
   explicit PrfFromStreamingPrf(std::unique_ptr<StreamingPrf> streaming_prf)
@@ -76,10 +86,168 @@ class PrfFromStatefulMacFactory : public Prf {
     return output.substr(0, output_length);
   }
 
+  // Creates a single StatefulMac for the whole batch and resets it between
+  // inputs, which saves the key setup and an allocation per input.
+  util::Status ComputeBatch(absl::Span<const absl::string_view> inputs,
+                            size_t output_length,
+                            std::string* output) const override {
+    output->clear();
+    if (inputs.empty()) return util::OkStatus();
+    auto stateful_mac_result = stateful_mac_factory_->Create();
+    if (!stateful_mac_result.ok()) {
+      return stateful_mac_result.status();
+    }
+    auto stateful_mac = std::move(stateful_mac_result.ValueOrDie());
+    output->reserve(inputs.size() * output_length);
+    for (size_t i = 0; i < inputs.size(); i++) {
+      if (i > 0) {
+        auto status = stateful_mac->Reset();
+        if (status.error_code() == util::error::UNIMPLEMENTED) {
+          return Prf::ComputeBatch(inputs, output_length, output);
+        }
+        if (!status.ok()) return status;
+      }
+      auto status = stateful_mac->Update(inputs[i]);
+      if (!status.ok()) return status;
+      auto output_result = stateful_mac->Finalize();
+      if (!output_result.ok()) return output_result.status();
+      absl::string_view mac = output_result.ValueOrDie();
+      if (mac.size() < output_length) {
+        return util::Status(
+            util::error::INVALID_ARGUMENT,
+            absl::StrCat("PRF only supports outputs up to ", mac.size(),
+                         " bytes, but ", output_length,
+                         " bytes were requested"));
+      }
+      output->append(mac.data(), output_length);
+    }
+    return util::OkStatus();
+  }
+
  private:
   std::unique_ptr<StatefulMacFactory> stateful_mac_factory_;
 };
 
+class PrfFromHmacBatch : public Prf {
+ public:
+  explicit PrfFromHmacBatch(std::unique_ptr<HmacBatchBoringSsl> hmac)
+      : hmac_(std::move(hmac)) {}
+  util::StatusOr<std::string> Compute(absl::string_view input,
+                                      size_t output_length) const override {
+    if (output_length > hmac_->digest_size()) {
+      return util::Status(
+          util::error::INVALID_ARGUMENT,
+          absl::StrCat("PRF only supports outputs up to ",
+                       hmac_->digest_size(), " bytes, but ", output_length,
+                       " bytes were requested"));
+    }
+    std::string output;
+    auto status = hmac_->ComputeBatch({input}, output_length, &output);
+    if (!status.ok()) return status;
+    return output;
+  }
+
+  util::Status ComputeBatch(absl::Span<const absl::string_view> inputs,
+                            size_t output_length,
+                            std::string* output) const override {
+    if (output_length > hmac_->digest_size()) {
+      return util::Status(
+          util::error::INVALID_ARGUMENT,
+          absl::StrCat("PRF only supports outputs up to ",
+                       hmac_->digest_size(), " bytes, but ", output_length,
+                       " bytes were requested"));
+    }
+    return hmac_->ComputeBatch(inputs, output_length, output);
+  }
+
+  // Computes the HMAC into a stack buffer, without allocating.
+  util::StatusOr<uint64_t> ComputeUint64(
+      absl::string_view input) const override {
+    uint8_t digest[kMaxDigestSize];
+    hmac_->Compute(input, digest);
+    return LoadBigEndian64(digest);
+  }
+
+  util::Status ComputeUint64Batch(
+      absl::Span<const absl::string_view> inputs,
+      absl::Span<uint64_t> outputs) const override {
+    if (outputs.size() != inputs.size()) {
+      return util::Status(util::error::INVALID_ARGUMENT,
+                          "outputs must have the size of inputs");
+    }
+    uint8_t digest[kMaxDigestSize];
+    for (size_t i = 0; i < inputs.size(); i++) {
+      hmac_->Compute(inputs[i], digest);
+      outputs[i] = LoadBigEndian64(digest);
+    }
+    return util::OkStatus();
+  }
+
+ private:
+  // The digest size of SHA-512, the largest hash supported.
+  static constexpr size_t kMaxDigestSize = 64;
+
+  std::unique_ptr<HmacBatchBoringSsl> hmac_;
+};
+
+class PrfFromAesCmacBatch : public Prf {
+ public:
+  explicit PrfFromAesCmacBatch(std::unique_ptr<AesCmacBatchBoringSsl> cmac)
+      : cmac_(std::move(cmac)) {}
+  util::StatusOr<std::string> Compute(absl::string_view input,
+                                      size_t output_length) const override {
+    std::string output;
+    auto status = ComputeBatch({input}, output_length, &output);
+    if (!status.ok()) return status;
+    return output;
+  }
+
+  util::Status ComputeBatch(absl::Span<const absl::string_view> inputs,
+                            size_t output_length,
+                            std::string* output) const override {
+    if (output_length > AesCmacBatchBoringSsl::kTagSize) {
+      return util::Status(
+          util::error::INVALID_ARGUMENT,
+          absl::StrCat("PRF only supports outputs up to ",
+                       AesCmacBatchBoringSsl::kTagSize, " bytes, but ",
+                       output_length, " bytes were requested"));
+    }
+    return cmac_->ComputeBatch(inputs, output_length, output);
+  }
+
+  util::StatusOr<uint64_t> ComputeUint64(
+      absl::string_view input) const override {
+    uint8_t tag[AesCmacBatchBoringSsl::kTagSize];
+    cmac_->Compute(input, tag);
+    return LoadBigEndian64(tag);
+  }
+
+  // Computes the CMACs kLanes at a time into a stack buffer, so that the
+  // lanes are pipelined and nothing is allocated.
+  util::Status ComputeUint64Batch(
+      absl::Span<const absl::string_view> inputs,
+      absl::Span<uint64_t> outputs) const override {
+    if (outputs.size() != inputs.size()) {
+      return util::Status(util::error::INVALID_ARGUMENT,
+                          "outputs must have the size of inputs");
+    }
+    constexpr int kLanes = AesCmacBatchBoringSsl::kLanes;
+    constexpr size_t kTagSize = AesCmacBatchBoringSsl::kTagSize;
+    uint8_t tags[kLanes * kTagSize];
+    for (size_t i = 0; i < inputs.size(); i += kLanes) {
+      size_t count = std::min<size_t>(kLanes, inputs.size() - i);
+      cmac_->ComputeTags(inputs.subspan(i, count), tags);
+      for (size_t j = 0; j < count; j++) {
+        outputs[i + j] = LoadBigEndian64(tags + j * kTagSize);
+      }
+    }
+    return util::OkStatus();
+  }
+
+ private:
+  std::unique_ptr<AesCmacBatchBoringSsl> cmac_;
+};
+
 }  // namespace
 
 std::unique_ptr<Prf> CreatePrfFromStreamingPrf(
@@ -93,6 +261,16 @@ std::unique_ptr<Prf> CreatePrfFromStatefulMacFactory(
       std::move(stateful_mac_factory));
 }
 
+std::unique_ptr<Prf> CreatePrfFromHmacBatch(
+    std::unique_ptr<HmacBatchBoringSsl> hmac) {
+  return absl::make_unique<PrfFromHmacBatch>(std::move(hmac));
+}
+
+std::unique_ptr<Prf> CreatePrfFromAesCmacBatch(
+    std::unique_ptr<AesCmacBatchBoringSsl> cmac) {
+  return absl::make_unique<PrfFromAesCmacBatch>(std::move(cmac));
+}
+
 }  // namespace subtle
 }  // namespace tink
 }  // namespace crypto
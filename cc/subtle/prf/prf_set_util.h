@@ -17,6 +17,8 @@
 #include <memory>
 
 #include "tink/prf/prf_set.h"
+#include "tink/subtle/aes_cmac_batch_boringssl.h"
+#include "tink/subtle/hmac_batch_boringssl.h"
 #include "tink/subtle/mac/stateful_mac.h"
 #include "tink/subtle/prf/streaming_prf.h"
 
@@ -33,6 +35,15 @@ std::unique_ptr<Prf> CreatePrfFromStreamingPrf(
 // do not produce output indistinguishable from random numbers.
 std::unique_ptr<Prf> CreatePrfFromStatefulMacFactory(
     std::unique_ptr<StatefulMacFactory> mac_factory);
+// Creates an HMAC Prf from an HmacBatchBoringSsl, taking ownership of it.
+// Unlike a Prf from a StatefulHmacBoringSslFactory, it creates no MAC object
+// per computation.
+std::unique_ptr<Prf> CreatePrfFromHmacBatch(
+    std::unique_ptr<HmacBatchBoringSsl> hmac);
+// Creates an AES-CMAC Prf from an AesCmacBatchBoringSsl, taking ownership of
+// it. Its outputs have at most 16 bytes.
+std::unique_ptr<Prf> CreatePrfFromAesCmacBatch(
+    std::unique_ptr<AesCmacBatchBoringSsl> cmac);
 
 }  // namespace subtle
 }  // namespace tink
@@ -13,18 +13,26 @@
 ////////////////////////////////////////////////////////////////////////////////
 #include "tink/subtle/prf/prf_set_util.h"
 
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "tink/input_stream.h"
+#include "tink/subtle/aes_cmac_batch_boringssl.h"
+#include "tink/subtle/common_enums.h"
+#include "tink/subtle/hmac_batch_boringssl.h"
 #include "tink/subtle/prf/streaming_prf.h"
 #include "tink/util/istream_input_stream.h"
+#include "tink/util/secret_data.h"
 #include "tink/util/status.h"
 #include "tink/util/test_matchers.h"
 
@@ -57,17 +65,24 @@ class MockStatefulMac : public StatefulMac {
  public:
   MOCK_METHOD(util::Status, Update, (absl::string_view data), (override));
   MOCK_METHOD(util::StatusOr<std::string>, Finalize, (), (override));
+  MOCK_METHOD(util::Status, Reset, (), (override));
 };
 
 class FakeStatefulMacFactory : public StatefulMacFactory {
  public:
-  FakeStatefulMacFactory(util::Status update_status,
-                         util::StatusOr<std::string> finalize_result)
-      : update_status_(update_status), finalize_result_(finalize_result) {}
+  FakeStatefulMacFactory(
+      util::Status update_status, util::StatusOr<std::string> finalize_result,
+      util::Status reset_status = util::OkStatus(), int* create_count = nullptr)
+      : update_status_(update_status),
+        finalize_result_(finalize_result),
+        reset_status_(reset_status),
+        create_count_(create_count) {}
   util::StatusOr<std::unique_ptr<StatefulMac>> Create() const override {
+    if (create_count_ != nullptr) (*create_count_)++;
     auto mac_mock = absl::make_unique<NiceMock<MockStatefulMac>>();
     ON_CALL(*mac_mock, Update(_)).WillByDefault(Return(update_status_));
     ON_CALL(*mac_mock, Finalize()).WillByDefault(Return(finalize_result_));
+    ON_CALL(*mac_mock, Reset()).WillByDefault(Return(reset_status_));
     std::unique_ptr<StatefulMac> result = std::move(mac_mock);
     return std::move(result);
   }
@@ -75,6 +90,8 @@ class FakeStatefulMacFactory : public StatefulMacFactory {
  private:
   util::Status update_status_;
   util::StatusOr<std::string> finalize_result_;
+  util::Status reset_status_;
+  int* create_count_;
 };
 
 class MockStreamingPrf : public StreamingPrf {
@@ -131,6 +148,150 @@ TEST_F(PrfFromStatefulMacFactoryTest, ComputePrfTooMuchOutputRequested) {
   EXPECT_FALSE(output_result.ok());
 }
 
+TEST(PrfFromStatefulMacFactoryBatchTest, ComputeBatchResetsMac) {
+  int create_count = 0;
+  auto prf = CreatePrfFromStatefulMacFactory(
+      absl::make_unique<FakeStatefulMacFactory>(
+          util::OkStatus(), std::string("mock_stateful_mac"), util::OkStatus(),
+          &create_count));
+  std::vector<absl::string_view> inputs = {"a", "b", "c"};
+  std::string output;
+  ASSERT_THAT(prf->ComputeBatch(inputs, 5, &output), IsOk());
+  EXPECT_THAT(output, StrEq("mock_mock_mock_"));
+  EXPECT_EQ(1, create_count);
+
+  ASSERT_THAT(prf->ComputeBatch({}, 5, &output), IsOk());
+  EXPECT_THAT(output, StrEq(""));
+}
+
+TEST(PrfFromStatefulMacFactoryBatchTest, ComputeBatchWithoutReset) {
+  int create_count = 0;
+  auto prf = CreatePrfFromStatefulMacFactory(
+      absl::make_unique<FakeStatefulMacFactory>(
+          util::OkStatus(), std::string("mock_stateful_mac"),
+          util::Status(util::error::UNIMPLEMENTED, "no reset"),
+          &create_count));
+  std::vector<absl::string_view> inputs = {"a", "b", "c"};
+  std::string output;
+  ASSERT_THAT(prf->ComputeBatch(inputs, 5, &output), IsOk());
+  EXPECT_THAT(output, StrEq("mock_mock_mock_"));
+}
+
+TEST(PrfFromStatefulMacFactoryBatchTest, ComputeBatchFails) {
+  std::vector<absl::string_view> inputs = {"a", "b"};
+  std::string output;
+  auto prf = CreatePrfFromStatefulMacFactory(
+      absl::make_unique<FakeStatefulMacFactory>(
+          util::OkStatus(), std::string("mock_stateful_mac"),
+          util::Status(util::error::INTERNAL, "ResetFailed")));
+  EXPECT_THAT(prf->ComputeBatch(inputs, 5, &output),
+              StatusIs(util::error::INTERNAL));
+  EXPECT_THAT(prf->ComputeBatch(inputs, 100, &output), Not(IsOk()));
+  prf = CreatePrfFromStatefulMacFactory(
+      absl::make_unique<FakeStatefulMacFactory>(
+          util::Status(util::error::INTERNAL, "UpdateFailed"),
+          std::string("mock_stateful_mac")));
+  EXPECT_THAT(prf->ComputeBatch(inputs, 5, &output),
+              StatusIs(util::error::INTERNAL));
+}
+
+TEST(PrfFromHmacBatchTest, Compute) {
+  auto hmac_result = HmacBatchBoringSsl::New(
+      HashType::SHA256, util::SecretDataFromStringView("0123456789abcdef"));
+  ASSERT_THAT(hmac_result.status(), IsOk());
+  auto prf = CreatePrfFromHmacBatch(std::move(hmac_result.ValueOrDie()));
+  auto output_result = prf->Compute("input", 32);
+  ASSERT_THAT(output_result.status(), IsOk());
+  EXPECT_EQ(32, output_result.ValueOrDie().size());
+  auto short_output_result = prf->Compute("input", 16);
+  ASSERT_THAT(short_output_result.status(), IsOk());
+  EXPECT_EQ(output_result.ValueOrDie().substr(0, 16),
+            short_output_result.ValueOrDie());
+
+  std::vector<absl::string_view> inputs = {"other", "input"};
+  std::string output;
+  ASSERT_THAT(prf->ComputeBatch(inputs, 16, &output), IsOk());
+  EXPECT_EQ(short_output_result.ValueOrDie(), output.substr(16));
+
+  EXPECT_THAT(prf->Compute("input", 33).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(prf->ComputeBatch(inputs, 33, &output),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(PrfFromAesCmacBatchTest, Compute) {
+  auto cmac_result = AesCmacBatchBoringSsl::New(
+      util::SecretDataFromStringView("0123456789abcdef"));
+  ASSERT_THAT(cmac_result.status(), IsOk());
+  auto prf = CreatePrfFromAesCmacBatch(std::move(cmac_result.ValueOrDie()));
+  auto output_result = prf->Compute("input", 16);
+  ASSERT_THAT(output_result.status(), IsOk());
+  EXPECT_EQ(16, output_result.ValueOrDie().size());
+  auto short_output_result = prf->Compute("input", 10);
+  ASSERT_THAT(short_output_result.status(), IsOk());
+  EXPECT_EQ(output_result.ValueOrDie().substr(0, 10),
+            short_output_result.ValueOrDie());
+
+  std::vector<absl::string_view> inputs = {"other", "input"};
+  std::string output;
+  ASSERT_THAT(prf->ComputeBatch(inputs, 16, &output), IsOk());
+  EXPECT_EQ(output_result.ValueOrDie(), output.substr(16));
+
+  EXPECT_THAT(prf->Compute("input", 17).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(prf->ComputeBatch(inputs, 17, &output),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+uint64_t BigEndianValue(absl::string_view bytes) {
+  uint64_t value = 0;
+  for (char byte : bytes) value = (value << 8) | static_cast<uint8_t>(byte);
+  return value;
+}
+
+// Checks that ComputeUint64() and ComputeUint64Batch() of 'prf' agree with
+// Compute().
+void TestComputeUint64(const Prf& prf) {
+  std::vector<std::string> input_strings;
+  for (int i = 0; i < 20; i++) input_strings.push_back(absl::StrCat(i));
+  std::vector<absl::string_view> inputs(input_strings.begin(),
+                                        input_strings.end());
+  std::vector<uint64_t> outputs(inputs.size());
+  ASSERT_THAT(prf.ComputeUint64Batch(inputs, absl::MakeSpan(outputs)),
+              IsOk());
+  for (size_t i = 0; i < inputs.size(); i++) {
+    auto output_result = prf.Compute(inputs[i], 8);
+    ASSERT_THAT(output_result.status(), IsOk());
+    auto value_result = prf.ComputeUint64(inputs[i]);
+    ASSERT_THAT(value_result.status(), IsOk());
+    EXPECT_EQ(BigEndianValue(output_result.ValueOrDie()),
+              value_result.ValueOrDie());
+    EXPECT_EQ(value_result.ValueOrDie(), outputs[i]);
+  }
+  outputs.resize(3);
+  EXPECT_THAT(prf.ComputeUint64Batch(inputs, absl::MakeSpan(outputs)),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(PrfFromHmacBatchTest, ComputeUint64) {
+  for (HashType hash_type : {HashType::SHA1, HashType::SHA256,
+                             HashType::SHA384, HashType::SHA512}) {
+    auto hmac_result = HmacBatchBoringSsl::New(
+        hash_type, util::SecretDataFromStringView("0123456789abcdef"));
+    ASSERT_THAT(hmac_result.status(), IsOk());
+    TestComputeUint64(
+        *CreatePrfFromHmacBatch(std::move(hmac_result.ValueOrDie())));
+  }
+}
+
+TEST(PrfFromAesCmacBatchTest, ComputeUint64) {
+  auto cmac_result = AesCmacBatchBoringSsl::New(
+      util::SecretDataFromStringView("0123456789abcdef"));
+  ASSERT_THAT(cmac_result.status(), IsOk());
+  TestComputeUint64(
+      *CreatePrfFromAesCmacBatch(std::move(cmac_result.ValueOrDie())));
+}
+
 class PrfFromStreamingPrfTest : public ::testing::Test {
  protected:
   void SetUp() override {
@@ -173,6 +334,13 @@ TEST_F(PrfFromStreamingPrfTest, ComputeSubstring) {
   EXPECT_THAT(output_result.ValueOrDie(), StrEq("ou"));
 }
 
+TEST_F(PrfFromStreamingPrfTest, ComputeBatch) {
+  std::vector<absl::string_view> inputs = {"input", "input"};
+  std::string output;
+  ASSERT_THAT(prf()->ComputeBatch(inputs, 3, &output), IsOk());
+  EXPECT_THAT(output, StrEq("outout"));
+}
+
 TEST_F(PrfFromStreamingPrfTest, ComputeTooMuch) {
   auto output_result = prf()->Compute("input", 5);
   ASSERT_THAT(output_result.status(), IsOk());
@@ -16,15 +16,87 @@
 
 #include "tink/subtle/random.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cstring>
 #include <string>
 
+#if !defined(_WIN32)
+#include <pthread.h>
+#endif
+
+#include "openssl/mem.h"
 #include "openssl/rand.h"
 
 namespace crypto {
 namespace tink {
 namespace subtle {
 
+namespace {
+
+// The number of bytes of RAND_bytes output buffered per thread.
+constexpr size_t kRandomBufferSize = 4096;
+// Larger requests are passed to RAND_bytes directly.
+constexpr size_t kMaxBufferedRequestSize = 256;
+
+// Incremented in the child process after a fork(), so that the buffers
+// copied from the parent are discarded instead of returning the same bytes
+// in both processes.
+std::atomic<uint64_t> fork_generation{0};
+
+void IncrementForkGeneration() {
+  fork_generation.fetch_add(1, std::memory_order_relaxed);
+}
+
+void RegisterForkHandler() {
+#if !defined(_WIN32)
+  static const bool registered =
+      pthread_atfork(nullptr, nullptr, &IncrementForkGeneration) == 0;
+  (void)registered;
+#endif
+}
+
+struct RandomBuffer {
+  ~RandomBuffer() { OPENSSL_cleanse(bytes, sizeof(bytes)); }
+
+  // The unused bytes are bytes[kRandomBufferSize - available, ...).
+  uint8_t bytes[kRandomBufferSize];
+  size_t available = 0;
+  uint64_t generation = 0;
+};
+
+}  // namespace
+
+// static
+void Random::FillRandomBytes(absl::Span<uint8_t> buffer) {
+  if (buffer.size() > kMaxBufferedRequestSize) {
+    RAND_bytes(buffer.data(), buffer.size());
+    return;
+  }
+  thread_local RandomBuffer random_buffer;
+  uint64_t generation = fork_generation.load(std::memory_order_relaxed);
+  if (random_buffer.available < buffer.size() ||
+      random_buffer.generation != generation) {
+    // Refilling also picks up the reseeding done by RAND_bytes.
+    RegisterForkHandler();
+    RAND_bytes(random_buffer.bytes, kRandomBufferSize);
+    random_buffer.available = kRandomBufferSize;
+    random_buffer.generation = generation;
+  }
+  uint8_t* bytes =
+      random_buffer.bytes + kRandomBufferSize - random_buffer.available;
+  std::copy(bytes, bytes + buffer.size(), buffer.begin());
+  // Returned bytes are not kept in memory.
+  OPENSSL_cleanse(bytes, buffer.size());
+  random_buffer.available -= buffer.size();
+}
+
+// static
+void Random::FillRandomBytes(absl::Span<char> buffer) {
+  FillRandomBytes(absl::MakeSpan(reinterpret_cast<uint8_t *>(buffer.data()),
+                                 buffer.size()));
+}
+
 // static
 std::string Random::GetRandomBytes(size_t length) {
   std::unique_ptr<uint8_t[]> buf(new uint8_t[length]);
@@ -42,6 +114,11 @@ std::string Random::GetRandomBytes(size_t length) {
   return std::string(reinterpret_cast<const char *>(buf.get()), length);
 }
 
+// static
+void Random::GetRandomBytes(absl::Span<char> buffer) {
+  RAND_bytes(reinterpret_cast<uint8_t *>(buffer.data()), buffer.size());
+}
+
 uint32_t Random::GetRandomUInt32() {
   uint8_t buf[sizeof(uint32_t)];
   RAND_bytes(buf, sizeof(uint32_t));
@@ -73,6 +150,10 @@ util::SecretData Random::GetRandomKeyBytes(size_t length) {
   return buf;
 }
 
+void Random::GetRandomKeyBytes(absl::Span<uint8_t> buffer) {
+  RAND_bytes(buffer.data(), buffer.size());
+}
+
 }  // namespace subtle
 }  // namespace tink
 }  // namespace crypto
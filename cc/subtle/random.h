@@ -17,9 +17,11 @@
 #ifndef TINK_SUBTLE_RANDOM_H_
 #define TINK_SUBTLE_RANDOM_H_
 
+#include <cstdint>
 #include <memory>
 #include <string>
 
+#include "absl/types/span.h"
 #include "tink/util/secret_data.h"
 
 namespace crypto {
@@ -30,11 +32,21 @@ class Random {
  public:
   // Returns a random string of desired length.
   static std::string GetRandomBytes(size_t length);
+  // Fills 'buffer' with random bytes, as GetRandomBytes(size_t).
+  static void GetRandomBytes(absl::Span<char> buffer);
+  // Fills 'buffer' with random bytes, without allocating. Small requests are
+  // served from a per-thread buffer of RAND_bytes output, so this is meant
+  // for public values such as nonces and IVs; keys should be generated
+  // with GetRandomKeyBytes().
+  static void FillRandomBytes(absl::Span<uint8_t> buffer);
+  static void FillRandomBytes(absl::Span<char> buffer);
   static uint32_t GetRandomUInt32();
   static uint16_t GetRandomUInt16();
   static uint8_t GetRandomUInt8();
   // Returns length bytes of random data stored in specialized key container.
   static util::SecretData GetRandomKeyBytes(size_t length);
+  // Fills 'buffer' with random key bytes, directly from RAND_bytes.
+  static void GetRandomKeyBytes(absl::Span<uint8_t> buffer);
 };
 
 }  // namespace subtle
@@ -16,6 +16,12 @@
 
 #include "tink/subtle/random.h"
 
+#if !defined(_WIN32)
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include <cstring>
 #include <set>
 #include <string>
 #include <vector>
@@ -23,6 +29,7 @@
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "absl/container/flat_hash_set.h"
+#include "absl/types/span.h"
 #include "tink/util/secret_data.h"
 
 namespace crypto {
@@ -45,11 +52,92 @@ TEST(RandomTest, testBasic) {
   EXPECT_THAT(rand_strings, SizeIs(numTests));
 }
 
+TEST(RandomTest, BytesIntoBufferTest) {
+  int numTests = 32;
+  absl::flat_hash_set<std::string> rand_strings;
+  for (int i = 0; i < numTests; i++) {
+    std::string s(16, '\0');
+    Random::GetRandomBytes(absl::MakeSpan(s));
+    rand_strings.insert(s);
+  }
+  EXPECT_THAT(rand_strings, SizeIs(numTests));
+}
+
+TEST(RandomTest, FillRandomBytesUniqueTest) {
+  // Enough requests to refill the per-thread buffer several times.
+  int numTests = 2000;
+  absl::flat_hash_set<std::string> rand_strings;
+  for (int i = 0; i < numTests; i++) {
+    std::string s(12 + i % 5, '\0');
+    Random::FillRandomBytes(absl::MakeSpan(
+        reinterpret_cast<uint8_t*>(&s[0]), s.size()));
+    rand_strings.insert(s);
+  }
+  EXPECT_THAT(rand_strings, SizeIs(numTests));
+}
+
+TEST(RandomTest, FillRandomBytesIntoCharBufferTest) {
+  int numTests = 32;
+  absl::flat_hash_set<std::string> rand_strings;
+  for (int i = 0; i < numTests; i++) {
+    std::string s(16, '\0');
+    Random::FillRandomBytes(absl::MakeSpan(s));
+    rand_strings.insert(s);
+  }
+  EXPECT_THAT(rand_strings, SizeIs(numTests));
+}
+
+TEST(RandomTest, FillRandomBytesLargeTest) {
+  std::vector<uint8_t> first(10000);
+  std::vector<uint8_t> second(10000);
+  Random::FillRandomBytes(absl::MakeSpan(first));
+  Random::FillRandomBytes(absl::MakeSpan(second));
+  EXPECT_NE(first, second);
+  Random::FillRandomBytes(absl::Span<uint8_t>());
+}
+
+#if !defined(_WIN32)
+TEST(RandomTest, FillRandomBytesAfterForkTest) {
+  // Leaves bytes in the buffer of this thread.
+  uint8_t nonce[12];
+  Random::FillRandomBytes(absl::MakeSpan(nonce));
+
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+  pid_t pid = fork();
+  ASSERT_GE(pid, 0);
+  if (pid == 0) {
+    Random::FillRandomBytes(absl::MakeSpan(nonce));
+    ssize_t written = write(fds[1], nonce, sizeof(nonce));
+    _exit(written == static_cast<ssize_t>(sizeof(nonce)) ? 0 : 1);
+  }
+  uint8_t parent_nonce[12];
+  Random::FillRandomBytes(absl::MakeSpan(parent_nonce));
+  uint8_t child_nonce[12];
+  ASSERT_EQ(static_cast<ssize_t>(sizeof(child_nonce)),
+            read(fds[0], child_nonce, sizeof(child_nonce)));
+  int status;
+  ASSERT_EQ(pid, waitpid(pid, &status, 0));
+  close(fds[0]);
+  close(fds[1]);
+  EXPECT_NE(0, std::memcmp(parent_nonce, child_nonce, sizeof(child_nonce)));
+}
+#endif
+
 TEST(RandomTest, KeyBytesTest) {
   util::SecretData key = Random::GetRandomKeyBytes(16);
   EXPECT_THAT(key, SizeIs(16));
 }
 
+TEST(RandomTest, KeyBytesIntoBufferTest) {
+  util::SecretData first(32, 0);
+  util::SecretData second(32, 0);
+  Random::GetRandomKeyBytes(absl::MakeSpan(first));
+  Random::GetRandomKeyBytes(absl::MakeSpan(second));
+  EXPECT_NE(first, util::SecretData(32, 0));
+  EXPECT_NE(first, second);
+}
+
 TEST(RandomTest, KeyBytesUniqueTest) {
   int numTests = 32;
   absl::flat_hash_set<util::SecretData> rand_strings;
@@ -16,14 +16,19 @@
 
 #include "tink/subtle/rsa_ssa_pkcs1_sign_boringssl.h"
 
+#include <algorithm>
+#include <string>
 #include <vector>
 
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
 #include "openssl/base.h"
 #include "openssl/digest.h"
 #include "openssl/evp.h"
 #include "openssl/rsa.h"
+#include "tink/subtle/digest_output_stream.h"
+#include "tink/subtle/subtle_util.h"
 #include "tink/subtle/subtle_util_boringssl.h"
 
 namespace crypto {
@@ -58,24 +63,53 @@ util::StatusOr<std::unique_ptr<PublicKeySign>> RsaSsaPkcs1SignBoringSsl::New(
     return rsa.status();
   }
 
-  return {absl::WrapUnique(new RsaSsaPkcs1SignBoringSsl(
-      std::move(rsa).ValueOrDie(), sig_hash.ValueOrDie()))};
+  auto signer = absl::WrapUnique(new RsaSsaPkcs1SignBoringSsl(
+      std::move(rsa).ValueOrDie(), sig_hash.ValueOrDie()));
+  // Sign once so that BoringSSL freezes the key and sets up its Montgomery
+  // contexts now, instead of under the key's lock on the first concurrent use.
+  auto warm_up = signer->Sign("");
+  if (!warm_up.ok()) return warm_up.status();
+  return {std::move(signer)};
 }
 
 util::StatusOr<std::string> RsaSsaPkcs1SignBoringSsl::Sign(
     absl::string_view data) const {
+  return SignWithPrefix("", data, "");
+}
+
+util::StatusOr<std::string> RsaSsaPkcs1SignBoringSsl::SignWithPrefix(
+    absl::string_view output_prefix, absl::string_view data,
+    absl::string_view data_suffix) const {
   data = SubtleUtilBoringSSL::EnsureNonNull(data);
-  auto digest_or = boringssl::ComputeHash(data, *sig_hash_);
-  if (!digest_or.ok()) return digest_or.status();
-  std::vector<uint8_t> digest = std::move(digest_or.ValueOrDie());
+  uint8_t digest[EVP_MAX_MD_SIZE];
+  auto digest_size_or =
+      boringssl::ComputeHash(data, data_suffix, *sig_hash_, digest);
+  if (!digest_size_or.ok()) return digest_size_or.status();
+  return SignDigest(output_prefix,
+                    absl::MakeConstSpan(digest, digest_size_or.ValueOrDie()));
+}
+
+util::StatusOr<std::unique_ptr<OutputStreamWithResult<std::string>>>
+RsaSsaPkcs1SignBoringSsl::NewSignOutputStream() const {
+  return DigestOutputStream<std::string>::New(
+      sig_hash_, [this](absl::Span<const uint8_t> digest) {
+        return SignDigest("", digest);
+      });
+}
 
-  std::vector<uint8_t> signature(RSA_size(private_key_.get()));
+util::StatusOr<std::string> RsaSsaPkcs1SignBoringSsl::SignDigest(
+    absl::string_view output_prefix, absl::Span<const uint8_t> digest) const {
+  std::string signature;
+  ResizeStringUninitialized(&signature,
+                            output_prefix.size() + signature_size_);
+  std::copy(output_prefix.begin(), output_prefix.end(), signature.begin());
+  uint8_t* out = reinterpret_cast<uint8_t*>(&signature[output_prefix.size()]);
   unsigned int signature_length = 0;
 
   if (RSA_sign(/*hash_nid=*/EVP_MD_type(sig_hash_),
                /*in=*/digest.data(),
                /*in_len=*/digest.size(),
-               /*out=*/signature.data(),
+               /*out=*/out,
                /*out_len=*/&signature_length,
                /*rsa=*/private_key_.get()) != 1) {
     // TODO(b/112581512): Decide if it's safe to propagate the BoringSSL error.
@@ -84,8 +118,8 @@ util::StatusOr<std::string> RsaSsaPkcs1SignBoringSsl::Sign(
     return util::Status(util::error::INTERNAL, "Signing failed.");
   }
 
-  return std::string(reinterpret_cast<const char*>(signature.data()),
-                     signature_length);
+  signature.resize(output_prefix.size() + signature_length);
+  return signature;
 }
 
 }  // namespace subtle
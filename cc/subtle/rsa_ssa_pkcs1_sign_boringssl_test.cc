@@ -15,18 +15,27 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "tink/subtle/rsa_ssa_pkcs1_sign_boringssl.h"
+
 #include <cstdint>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
 
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "absl/strings/escaping.h"
+#include "absl/strings/str_cat.h"
 #include "openssl/base.h"
 #include "openssl/bn.h"
 #include "openssl/crypto.h"
 #include "openssl/rsa.h"
 #include "tink/config/tink_fips.h"
+#include "tink/public_key_sign.h"
+#include "tink/public_key_verify.h"
+#include "tink/subtle/random.h"
 #include "tink/subtle/rsa_ssa_pkcs1_verify_boringssl.h"
 #include "tink/subtle/subtle_util_boringssl.h"
+#include "tink/subtle/test_util.h"
 #include "tink/util/test_matchers.h"
 
 namespace crypto {
@@ -96,6 +105,81 @@ TEST_F(RsaPkcs1SignBoringsslTest, EncodesPkcs1WithSeparateHashes) {
       IsOk());
 }
 
+TEST_F(RsaPkcs1SignBoringsslTest, SignsAndVerifiesStreams) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Test not run in FIPS-only mode";
+  }
+
+  SubtleUtilBoringSSL::RsaSsaPkcs1Params params{/*sig_hash=*/HashType::SHA256};
+  auto signer_or = RsaSsaPkcs1SignBoringSsl::New(private_key_, params);
+  ASSERT_THAT(signer_or.status(), IsOk());
+  auto verifier_or = RsaSsaPkcs1VerifyBoringSsl::New(public_key_, params);
+  ASSERT_THAT(verifier_or.status(), IsOk());
+  std::string data = Random::GetRandomBytes(100000);
+
+  auto sign_stream_or = signer_or.ValueOrDie()->NewSignOutputStream();
+  ASSERT_THAT(sign_stream_or.status(), IsOk());
+  auto& sign_stream = sign_stream_or.ValueOrDie();
+  ASSERT_THAT(test::WriteToStream(sign_stream.get(), data), IsOk());
+  auto signature_or = sign_stream->GetResult();
+  ASSERT_THAT(signature_or.status(), IsOk());
+  // PKCS1 signatures are deterministic.
+  EXPECT_EQ(signer_or.ValueOrDie()->Sign(data).ValueOrDie(),
+            signature_or.ValueOrDie());
+
+  const std::string& signature = signature_or.ValueOrDie();
+  auto verify_stream_or =
+      verifier_or.ValueOrDie()->NewVerifyOutputStream(signature);
+  ASSERT_THAT(verify_stream_or.status(), IsOk());
+  EXPECT_THAT(
+      test::WriteToStream(verify_stream_or.ValueOrDie().get(), data), IsOk());
+
+  auto other_verify_stream_or =
+      verifier_or.ValueOrDie()->NewVerifyOutputStream(signature);
+  ASSERT_THAT(other_verify_stream_or.status(), IsOk());
+  EXPECT_THAT(test::WriteToStream(other_verify_stream_or.ValueOrDie().get(),
+                                  data.substr(1)),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST_F(RsaPkcs1SignBoringsslTest, SignsConcurrently) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Test not run in FIPS-only mode";
+  }
+
+  SubtleUtilBoringSSL::RsaSsaPkcs1Params params{/*sig_hash=*/HashType::SHA256};
+  auto signer_or = RsaSsaPkcs1SignBoringSsl::New(private_key_, params);
+  ASSERT_THAT(signer_or.status(), IsOk());
+  auto verifier_or = RsaSsaPkcs1VerifyBoringSsl::New(public_key_, params);
+  ASSERT_THAT(verifier_or.status(), IsOk());
+  const PublicKeySign& signer = *signer_or.ValueOrDie();
+  const PublicKeyVerify& verifier = *verifier_or.ValueOrDie();
+
+  constexpr int kNumThreads = 4;
+  constexpr int kSignaturesPerThread = 8;
+  std::vector<std::string> signatures(kNumThreads * kSignaturesPerThread);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; t++) {
+    threads.emplace_back([&signer, &signatures, t]() {
+      for (int i = 0; i < kSignaturesPerThread; i++) {
+        auto signature_or = signer.Sign(absl::StrCat("data ", t, " ", i));
+        if (signature_or.ok()) {
+          signatures[t * kSignaturesPerThread + i] = signature_or.ValueOrDie();
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  for (int t = 0; t < kNumThreads; t++) {
+    for (int i = 0; i < kSignaturesPerThread; i++) {
+      EXPECT_THAT(verifier.Verify(signatures[t * kSignaturesPerThread + i],
+                                  absl::StrCat("data ", t, " ", i)),
+                  IsOk());
+    }
+  }
+}
+
 TEST_F(RsaPkcs1SignBoringsslTest, RejectsUnsafeHash) {
   if (kUseOnlyFips) {
     GTEST_SKIP() << "Test not run in FIPS-only mode";
@@ -15,12 +15,17 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "tink/subtle/rsa_ssa_pkcs1_verify_boringssl.h"
+
+#include <string>
+
 #include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
 #include "openssl/bn.h"
 #include "openssl/digest.h"
 #include "openssl/evp.h"
 #include "openssl/rsa.h"
 #include "tink/subtle/common_enums.h"
+#include "tink/subtle/digest_output_stream.h"
 #include "tink/subtle/subtle_util_boringssl.h"
 #include "tink/util/errors.h"
 
@@ -51,6 +56,9 @@ RsaSsaPkcs1VerifyBoringSsl::New(
   if (!rsa.ok()) {
     return rsa.status();
   }
+  auto precompute_status =
+      SubtleUtilBoringSSL::PrecomputeRsaPublicKey(rsa.ValueOrDie().get());
+  if (!precompute_status.ok()) return precompute_status;
 
   std::unique_ptr<RsaSsaPkcs1VerifyBoringSsl> verify(
       new RsaSsaPkcs1VerifyBoringSsl(std::move(rsa).ValueOrDie(),
@@ -64,10 +72,27 @@ util::Status RsaSsaPkcs1VerifyBoringSsl::Verify(absl::string_view signature,
   // regardless of whether the size is 0.
   data = SubtleUtilBoringSSL::EnsureNonNull(data);
 
-  auto digest_result = boringssl::ComputeHash(data, *sig_hash_);
-  if (!digest_result.ok()) return digest_result.status();
-  auto digest = std::move(digest_result.ValueOrDie());
+  unsigned int digest_size;
+  uint8_t digest[EVP_MAX_MD_SIZE];
+  if (1 != EVP_Digest(data.data(), data.size(), digest, &digest_size,
+                      sig_hash_, nullptr)) {
+    return util::Status(util::error::INTERNAL, "Could not compute digest.");
+  }
+  return VerifyDigest(signature, absl::MakeConstSpan(digest, digest_size));
+}
+
+util::StatusOr<std::unique_ptr<OutputStreamWithResult<util::Status>>>
+RsaSsaPkcs1VerifyBoringSsl::NewVerifyOutputStream(
+    absl::string_view signature) const {
+  std::string signature_copy(signature);
+  return DigestOutputStream<util::Status>::New(
+      sig_hash_, [this, signature_copy](absl::Span<const uint8_t> digest) {
+        return VerifyDigest(signature_copy, digest);
+      });
+}
 
+util::Status RsaSsaPkcs1VerifyBoringSsl::VerifyDigest(
+    absl::string_view signature, absl::Span<const uint8_t> digest) const {
   if (1 !=
       RSA_verify(EVP_MD_type(sig_hash_),
                  /*msg=*/digest.data(),
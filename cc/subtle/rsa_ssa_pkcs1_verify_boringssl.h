@@ -21,10 +21,12 @@
 #include <utility>
 
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "openssl/evp.h"
 #include "openssl/rsa.h"
 #include "tink/public_key_verify.h"
 #include "tink/config/tink_fips.h"
+#include "tink/output_stream_with_result.h"
 #include "tink/subtle/common_enums.h"
 #include "tink/subtle/subtle_util_boringssl.h"
 #include "tink/util/status.h"
@@ -48,6 +50,11 @@ class RsaSsaPkcs1VerifyBoringSsl : public PublicKeyVerify {
   crypto::tink::util::Status Verify(absl::string_view signature,
                                     absl::string_view data) const override;
 
+  // Hashes the data as it is written, so only the digest is kept in memory.
+  crypto::tink::util::StatusOr<
+      std::unique_ptr<OutputStreamWithResult<crypto::tink::util::Status>>>
+  NewVerifyOutputStream(absl::string_view signature) const override;
+
   ~RsaSsaPkcs1VerifyBoringSsl() override = default;
 
   static constexpr crypto::tink::FipsCompatibility kFipsStatus =
@@ -63,6 +70,10 @@ class RsaSsaPkcs1VerifyBoringSsl : public PublicKeyVerify {
   RsaSsaPkcs1VerifyBoringSsl(bssl::UniquePtr<RSA> rsa, const EVP_MD* sig_hash)
       : rsa_(std::move(rsa)), sig_hash_(sig_hash) {}
 
+  // Verifies 'signature' for the sig_hash_ digest of the data.
+  crypto::tink::util::Status VerifyDigest(
+      absl::string_view signature, absl::Span<const uint8_t> digest) const;
+
   const bssl::UniquePtr<RSA> rsa_;
   const EVP_MD* const sig_hash_;  // Owned by BoringSSL.
 };
@@ -16,13 +16,18 @@
 
 #include "tink/subtle/rsa_ssa_pss_sign_boringssl.h"
 
+#include <algorithm>
+#include <string>
 #include <vector>
 
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
 #include "openssl/base.h"
 #include "openssl/evp.h"
 #include "openssl/rsa.h"
+#include "tink/subtle/digest_output_stream.h"
+#include "tink/subtle/subtle_util.h"
 #include "tink/subtle/subtle_util_boringssl.h"
 
 namespace crypto {
@@ -52,9 +57,14 @@ util::StatusOr<std::unique_ptr<PublicKeySign>> RsaSsaPssSignBoringSsl::New(
     return rsa.status();
   }
 
-  return {absl::WrapUnique(new RsaSsaPssSignBoringSsl(
+  auto signer = absl::WrapUnique(new RsaSsaPssSignBoringSsl(
       std::move(rsa).ValueOrDie(), sig_hash.ValueOrDie(),
-      mgf1_hash.ValueOrDie(), params.salt_length))};
+      mgf1_hash.ValueOrDie(), params.salt_length));
+  // Sign once so that BoringSSL freezes the key and sets up its Montgomery
+  // contexts now, instead of under the key's lock on the first concurrent use.
+  auto warm_up = signer->Sign("");
+  if (!warm_up.ok()) return warm_up.status();
+  return {std::move(signer)};
 }
 
 RsaSsaPssSignBoringSsl::RsaSsaPssSignBoringSsl(bssl::UniquePtr<RSA> private_key,
@@ -62,23 +72,49 @@ RsaSsaPssSignBoringSsl::RsaSsaPssSignBoringSsl(bssl::UniquePtr<RSA> private_key,
                                                const EVP_MD* mgf1_hash,
                                                int32_t salt_length)
     : private_key_(std::move(private_key)),
+      signature_size_(RSA_size(private_key_.get())),
       sig_hash_(sig_hash),
       mgf1_hash_(mgf1_hash),
       salt_length_(salt_length) {}
 
 util::StatusOr<std::string> RsaSsaPssSignBoringSsl::Sign(
     absl::string_view data) const {
+  return SignWithPrefix("", data, "");
+}
+
+util::StatusOr<std::string> RsaSsaPssSignBoringSsl::SignWithPrefix(
+    absl::string_view output_prefix, absl::string_view data,
+    absl::string_view data_suffix) const {
   data = SubtleUtilBoringSSL::EnsureNonNull(data);
-  auto digest_or = boringssl::ComputeHash(data, *sig_hash_);
-  if (!digest_or.ok()) return digest_or.status();
-  std::vector<uint8_t> digest = std::move(digest_or.ValueOrDie());
+  uint8_t digest[EVP_MAX_MD_SIZE];
+  auto digest_size_or =
+      boringssl::ComputeHash(data, data_suffix, *sig_hash_, digest);
+  if (!digest_size_or.ok()) return digest_size_or.status();
+  return SignDigest(output_prefix,
+                    absl::MakeConstSpan(digest, digest_size_or.ValueOrDie()));
+}
+
+util::StatusOr<std::unique_ptr<OutputStreamWithResult<std::string>>>
+RsaSsaPssSignBoringSsl::NewSignOutputStream() const {
+  return DigestOutputStream<std::string>::New(
+      sig_hash_, [this](absl::Span<const uint8_t> digest) {
+        return SignDigest("", digest);
+      });
+}
 
-  std::vector<uint8_t> signature(RSA_size(private_key_.get()));
+util::StatusOr<std::string> RsaSsaPssSignBoringSsl::SignDigest(
+    absl::string_view output_prefix, absl::Span<const uint8_t> digest) const {
+  std::string signature;
+  ResizeStringUninitialized(&signature,
+                            output_prefix.size() + signature_size_);
+  std::copy(output_prefix.begin(), output_prefix.end(), signature.begin());
+  uint8_t* out = reinterpret_cast<uint8_t*>(&signature[output_prefix.size()]);
   size_t signature_length;
 
   if (RSA_sign_pss_mgf1(private_key_.get(),
                         /*out_len=*/&signature_length,
-                        /*out=*/signature.data(), /*max_out=*/signature.size(),
+                        /*out=*/out,
+                        /*max_out=*/signature_size_,
                         /*in=*/digest.data(), /*in_len=*/digest.size(),
                         /*md=*/sig_hash_,
                         /*mgf1_md=*/mgf1_hash_, salt_length_) != 1) {
@@ -87,8 +123,8 @@ util::StatusOr<std::string> RsaSsaPssSignBoringSsl::Sign(
     SubtleUtilBoringSSL::GetErrors();
     return util::Status(util::error::INTERNAL, "Signing failed.");
   }
-  return std::string(reinterpret_cast<const char*>(signature.data()),
-                     signature_length);
+  signature.resize(output_prefix.size() + signature_length);
+  return signature;
 }
 
 }  // namespace subtle
@@ -18,12 +18,15 @@
 #define TINK_SUBTLE_RSA_SSA_PSS_SIGN_BORINGSSL_H_
 
 #include <memory>
+#include <string>
 
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "openssl/base.h"
 #include "openssl/ec.h"
 #include "openssl/rsa.h"
 #include "tink/config/tink_fips.h"
+#include "tink/output_stream_with_result.h"
 #include "tink/public_key_sign.h"
 #include "tink/subtle/common_enums.h"
 #include "tink/subtle/subtle_util_boringssl.h"
@@ -47,6 +50,17 @@ class RsaSsaPssSignBoringSsl : public PublicKeySign {
   crypto::tink::util::StatusOr<std::string> Sign(
       absl::string_view data) const override;
 
+  // Hashes 'data' and 'data_suffix' without concatenating them, and writes
+  // the signature directly after 'output_prefix'.
+  crypto::tink::util::StatusOr<std::string> SignWithPrefix(
+      absl::string_view output_prefix, absl::string_view data,
+      absl::string_view data_suffix) const override;
+
+  // Hashes the data as it is written, so only the digest is kept in memory.
+  crypto::tink::util::StatusOr<
+      std::unique_ptr<OutputStreamWithResult<std::string>>>
+  NewSignOutputStream() const override;
+
   ~RsaSsaPssSignBoringSsl() override = default;
 
   static constexpr crypto::tink::FipsCompatibility kFipsStatus =
@@ -54,6 +68,7 @@ class RsaSsaPssSignBoringSsl : public PublicKeySign {
 
  private:
   const bssl::UniquePtr<RSA> private_key_;
+  const size_t signature_size_;
   const EVP_MD* sig_hash_;   // Owned by BoringSSL.
   const EVP_MD* mgf1_hash_;  // Owned by BoringSSL.
   int32_t salt_length_;
@@ -61,6 +76,11 @@ class RsaSsaPssSignBoringSsl : public PublicKeySign {
   RsaSsaPssSignBoringSsl(bssl::UniquePtr<RSA> private_key,
                          const EVP_MD* sig_hash, const EVP_MD* mgf1_hash,
                          int32_t salt_length);
+
+  // Returns 'output_prefix' followed by the signature for the sig_hash_ digest
+  // of the data.
+  crypto::tink::util::StatusOr<std::string> SignDigest(
+      absl::string_view output_prefix, absl::Span<const uint8_t> digest) const;
 };
 
 }  // namespace subtle
@@ -16,14 +16,23 @@
 
 #include "tink/subtle/rsa_ssa_pss_sign_boringssl.h"
 
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "absl/strings/escaping.h"
+#include "absl/strings/str_cat.h"
 #include "openssl/base.h"
 #include "openssl/bn.h"
 #include "openssl/rsa.h"
+#include "tink/public_key_sign.h"
+#include "tink/public_key_verify.h"
+#include "tink/subtle/random.h"
 #include "tink/subtle/rsa_ssa_pss_verify_boringssl.h"
 #include "tink/subtle/subtle_util_boringssl.h"
+#include "tink/subtle/test_util.h"
 #include "tink/util/test_matchers.h"
 
 namespace crypto {
@@ -97,6 +106,84 @@ TEST_F(RsaPssSignBoringsslTest, EncodesPssWithSeparateHashes) {
       IsOk());
 }
 
+TEST_F(RsaPssSignBoringsslTest, SignsAndVerifiesStreams) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Test not run in FIPS-only mode";
+  }
+
+  SubtleUtilBoringSSL::RsaSsaPssParams params{/*sig_hash=*/HashType::SHA256,
+                                              /*mgf1_hash=*/HashType::SHA1,
+                                              /*salt_length=*/32};
+  auto signer_or = RsaSsaPssSignBoringSsl::New(private_key_, params);
+  ASSERT_THAT(signer_or.status(), IsOk());
+  auto verifier_or = RsaSsaPssVerifyBoringSsl::New(public_key_, params);
+  ASSERT_THAT(verifier_or.status(), IsOk());
+  std::string data = Random::GetRandomBytes(100000);
+
+  auto sign_stream_or = signer_or.ValueOrDie()->NewSignOutputStream();
+  ASSERT_THAT(sign_stream_or.status(), IsOk());
+  auto& sign_stream = sign_stream_or.ValueOrDie();
+  ASSERT_THAT(test::WriteToStream(sign_stream.get(), data), IsOk());
+  auto signature_or = sign_stream->GetResult();
+  ASSERT_THAT(signature_or.status(), IsOk());
+  EXPECT_THAT(verifier_or.ValueOrDie()->Verify(signature_or.ValueOrDie(), data),
+              IsOk());
+
+  std::string signature = signer_or.ValueOrDie()->Sign(data).ValueOrDie();
+  auto verify_stream_or =
+      verifier_or.ValueOrDie()->NewVerifyOutputStream(signature);
+  ASSERT_THAT(verify_stream_or.status(), IsOk());
+  EXPECT_THAT(
+      test::WriteToStream(verify_stream_or.ValueOrDie().get(), data), IsOk());
+
+  auto other_verify_stream_or =
+      verifier_or.ValueOrDie()->NewVerifyOutputStream(signature);
+  ASSERT_THAT(other_verify_stream_or.status(), IsOk());
+  EXPECT_THAT(test::WriteToStream(other_verify_stream_or.ValueOrDie().get(),
+                                  data.substr(1)),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST_F(RsaPssSignBoringsslTest, SignsConcurrently) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Test not run in FIPS-only mode";
+  }
+
+  SubtleUtilBoringSSL::RsaSsaPssParams params{/*sig_hash=*/HashType::SHA256,
+                                              /*mgf1_hash=*/HashType::SHA256,
+                                              /*salt_length=*/32};
+  auto signer_or = RsaSsaPssSignBoringSsl::New(private_key_, params);
+  ASSERT_THAT(signer_or.status(), IsOk());
+  auto verifier_or = RsaSsaPssVerifyBoringSsl::New(public_key_, params);
+  ASSERT_THAT(verifier_or.status(), IsOk());
+  const PublicKeySign& signer = *signer_or.ValueOrDie();
+  const PublicKeyVerify& verifier = *verifier_or.ValueOrDie();
+
+  constexpr int kNumThreads = 4;
+  constexpr int kSignaturesPerThread = 8;
+  std::vector<std::string> signatures(kNumThreads * kSignaturesPerThread);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; t++) {
+    threads.emplace_back([&signer, &signatures, t]() {
+      for (int i = 0; i < kSignaturesPerThread; i++) {
+        auto signature_or = signer.Sign(absl::StrCat("data ", t, " ", i));
+        if (signature_or.ok()) {
+          signatures[t * kSignaturesPerThread + i] = signature_or.ValueOrDie();
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  for (int t = 0; t < kNumThreads; t++) {
+    for (int i = 0; i < kSignaturesPerThread; i++) {
+      EXPECT_THAT(verifier.Verify(signatures[t * kSignaturesPerThread + i],
+                                  absl::StrCat("data ", t, " ", i)),
+                  IsOk());
+    }
+  }
+}
+
 TEST_F(RsaPssSignBoringsslTest, RejectsInvalidPaddingHash) {
   if (kUseOnlyFips) {
     GTEST_SKIP() << "Test not run in FIPS-only mode";
@@ -15,11 +15,16 @@
 ///////////////////////////////////////////////////////////////////////////////
 
 #include "tink/subtle/rsa_ssa_pss_verify_boringssl.h"
+
+#include <string>
+
 #include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
 #include "openssl/bn.h"
 #include "openssl/evp.h"
 #include "openssl/rsa.h"
 #include "tink/subtle/common_enums.h"
+#include "tink/subtle/digest_output_stream.h"
 #include "tink/subtle/subtle_util_boringssl.h"
 #include "tink/util/errors.h"
 
@@ -54,6 +59,9 @@ RsaSsaPssVerifyBoringSsl::New(
   if (!rsa.ok()) {
     return rsa.status();
   }
+  auto precompute_status =
+      SubtleUtilBoringSSL::PrecomputeRsaPublicKey(rsa.ValueOrDie().get());
+  if (!precompute_status.ok()) return precompute_status;
 
   std::unique_ptr<RsaSsaPssVerifyBoringSsl> verify(new RsaSsaPssVerifyBoringSsl(
       std::move(rsa).ValueOrDie(), sig_hash_result.ValueOrDie(),
@@ -67,10 +75,27 @@ util::Status RsaSsaPssVerifyBoringSsl::Verify(absl::string_view signature,
   // regardless of whether the size is 0.
   data = SubtleUtilBoringSSL::EnsureNonNull(data);
 
-  auto digest_result = boringssl::ComputeHash(data, *sig_hash_);
-  if (!digest_result.ok()) return digest_result.status();
-  auto digest = std::move(digest_result.ValueOrDie());
+  unsigned int digest_size;
+  uint8_t digest[EVP_MAX_MD_SIZE];
+  if (1 != EVP_Digest(data.data(), data.size(), digest, &digest_size,
+                      sig_hash_, nullptr)) {
+    return util::Status(util::error::INTERNAL, "Could not compute digest.");
+  }
+  return VerifyDigest(signature, absl::MakeConstSpan(digest, digest_size));
+}
+
+util::StatusOr<std::unique_ptr<OutputStreamWithResult<util::Status>>>
+RsaSsaPssVerifyBoringSsl::NewVerifyOutputStream(
+    absl::string_view signature) const {
+  std::string signature_copy(signature);
+  return DigestOutputStream<util::Status>::New(
+      sig_hash_, [this, signature_copy](absl::Span<const uint8_t> digest) {
+        return VerifyDigest(signature_copy, digest);
+      });
+}
 
+util::Status RsaSsaPssVerifyBoringSsl::VerifyDigest(
+    absl::string_view signature, absl::Span<const uint8_t> digest) const {
   if (1 != RSA_verify_pss_mgf1(
                rsa_.get(), digest.data(), digest.size(), sig_hash_, mgf1_hash_,
                salt_length_, reinterpret_cast<const uint8_t*>(signature.data()),
@@ -21,10 +21,12 @@
 #include <utility>
 
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "openssl/evp.h"
 #include "openssl/rsa.h"
 #include "tink/public_key_verify.h"
 #include "tink/config/tink_fips.h"
+#include "tink/output_stream_with_result.h"
 #include "tink/subtle/common_enums.h"
 #include "tink/subtle/subtle_util_boringssl.h"
 #include "tink/util/status.h"
@@ -47,6 +49,11 @@ class RsaSsaPssVerifyBoringSsl : public PublicKeyVerify {
   crypto::tink::util::Status Verify(absl::string_view signature,
                                     absl::string_view data) const override;
 
+  // Hashes the data as it is written, so only the digest is kept in memory.
+  crypto::tink::util::StatusOr<
+      std::unique_ptr<OutputStreamWithResult<crypto::tink::util::Status>>>
+  NewVerifyOutputStream(absl::string_view signature) const override;
+
   ~RsaSsaPssVerifyBoringSsl() override = default;
 
   static constexpr crypto::tink::FipsCompatibility kFipsStatus =
@@ -60,6 +67,10 @@ class RsaSsaPssVerifyBoringSsl : public PublicKeyVerify {
         mgf1_hash_(mgf1_hash),
         salt_length_(salt_length) {}
 
+  // Verifies 'signature' for the sig_hash_ digest of the data.
+  crypto::tink::util::Status VerifyDigest(
+      absl::string_view signature, absl::Span<const uint8_t> digest) const;
+
   const bssl::UniquePtr<RSA> rsa_;
   const EVP_MD* const sig_hash_;   // Owned by BoringSSL.
   const EVP_MD* const mgf1_hash_;  // Owned by BoringSSL.
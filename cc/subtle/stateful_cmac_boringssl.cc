@@ -23,8 +23,9 @@ namespace crypto {
 namespace tink {
 namespace subtle {
 
-util::StatusOr<std::unique_ptr<StatefulMac>> StatefulCmacBoringSsl::New(
-    uint32_t tag_size, const util::SecretData& key_value) {
+util::StatusOr<bssl::UniquePtr<CMAC_CTX>>
+StatefulCmacBoringSsl::NewCmacContext(uint32_t tag_size,
+                                      const util::SecretData& key_value) {
   const EVP_CIPHER* cipher;
   switch (key_value.size()) {
     case 16:
@@ -50,8 +51,15 @@ util::StatusOr<std::unique_ptr<StatefulMac>> StatefulCmacBoringSsl::New(
                         "CMAC initialization failed");
   }
 
-  return {
-      absl::WrapUnique(new StatefulCmacBoringSsl(tag_size, std::move(ctx)))};
+  return std::move(ctx);
+}
+
+util::StatusOr<std::unique_ptr<StatefulMac>> StatefulCmacBoringSsl::New(
+    uint32_t tag_size, const util::SecretData& key_value) {
+  auto ctx_result = NewCmacContext(tag_size, key_value);
+  if (!ctx_result.ok()) return ctx_result.status();
+  return {absl::WrapUnique(
+      new StatefulCmacBoringSsl(tag_size, std::move(ctx_result.ValueOrDie())))};
 }
 
 util::Status StatefulCmacBoringSsl::Update(absl::string_view data) {
@@ -77,13 +85,29 @@ util::StatusOr<std::string> StatefulCmacBoringSsl::Finalize() {
   return std::string(reinterpret_cast<char*>(buf), tag_size_);
 }
 
+util::Status StatefulCmacBoringSsl::Reset() {
+  if (!CMAC_Reset(cmac_context_.get())) {
+    return util::Status(util::error::INTERNAL, "CMAC reset failed");
+  }
+  return util::OkStatus();
+}
+
 StatefulCmacBoringSslFactory::StatefulCmacBoringSslFactory(
     uint32_t tag_size, const util::SecretData& key_value)
-    : tag_size_(tag_size), key_value_(key_value) {}
+    : tag_size_(tag_size),
+      cmac_context_(
+          StatefulCmacBoringSsl::NewCmacContext(tag_size, key_value)) {}
 
 util::StatusOr<std::unique_ptr<StatefulMac>>
 StatefulCmacBoringSslFactory::Create() const {
-  return StatefulCmacBoringSsl::New(tag_size_, key_value_);
+  if (!cmac_context_.ok()) return cmac_context_.status();
+  bssl::UniquePtr<CMAC_CTX> ctx(CMAC_CTX_new());
+  if (ctx == nullptr ||
+      !CMAC_CTX_copy(ctx.get(), cmac_context_.ValueOrDie().get())) {
+    return util::Status(util::error::INTERNAL, "CMAC context copy failed");
+  }
+  return std::unique_ptr<StatefulMac>(
+      new StatefulCmacBoringSsl(tag_size_, std::move(ctx)));
 }
 
 }  // namespace subtle
@@ -39,8 +39,11 @@ class StatefulCmacBoringSsl : public subtle::StatefulMac {
       uint32_t tag_size, const util::SecretData& key_value);
   util::Status Update(absl::string_view data) override;
   util::StatusOr<std::string> Finalize() override;
+  util::Status Reset() override;
 
  private:
+  friend class StatefulCmacBoringSslFactory;
+
   static constexpr size_t kSmallKeySize = 16;
   static constexpr size_t kBigKeySize = 32;
   static constexpr size_t kMaxTagSize = 16;
@@ -48,10 +51,17 @@ class StatefulCmacBoringSsl : public subtle::StatefulMac {
   StatefulCmacBoringSsl(uint32_t tag_size, bssl::UniquePtr<CMAC_CTX> ctx)
       : cmac_context_(std::move(ctx)), tag_size_(tag_size) {}
 
+  // Validates the parameters and returns a CMAC context initialized with
+  // 'key_value'.
+  static util::StatusOr<bssl::UniquePtr<CMAC_CTX>> NewCmacContext(
+      uint32_t tag_size, const util::SecretData& key_value);
+
   const bssl::UniquePtr<CMAC_CTX> cmac_context_;
   const uint32_t tag_size_;
 };
 
+// Precomputes the keyed CMAC state, with its AES key schedule and subkeys,
+// once; every Create() call starts from a copy of it.
 class StatefulCmacBoringSslFactory : public subtle::StatefulMacFactory {
  public:
   StatefulCmacBoringSslFactory(uint32_t tag_size,
@@ -60,7 +70,8 @@ class StatefulCmacBoringSslFactory : public subtle::StatefulMacFactory {
 
  private:
   const uint32_t tag_size_;
-  const util::SecretData key_value_;
+  // Initialized CMAC context, or the error which prevented creating it.
+  util::StatusOr<bssl::UniquePtr<CMAC_CTX>> cmac_context_;
 };
 
 }  // namespace subtle
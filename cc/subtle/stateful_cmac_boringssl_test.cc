@@ -135,6 +135,32 @@ TEST(StatefulCmacBoringSslTest, testMultipleUpdates) {
                      expected_small);
 }
 
+TEST(StatefulCmacBoringSslTest, testReset) {
+  std::string key(test::HexDecodeOrDie("000102030405060708090a0b0c0d0e0f"));
+  std::string expected(
+      test::HexDecodeOrDie("c856e183e8dee9bb99402d54c34f3222"));
+  auto cmac_result =
+      StatefulCmacBoringSsl::New(kTagSize, util::SecretDataFromStringView(key));
+  ASSERT_THAT(cmac_result.status(), IsOk());
+  auto cmac = std::move(cmac_result.ValueOrDie());
+  EXPECT_THAT(cmac->Update("Other data"), IsOk());
+  ASSERT_THAT(cmac->Finalize().status(), IsOk());
+
+  ASSERT_THAT(cmac->Reset(), IsOk());
+  EXPECT_THAT(cmac->Update("Some data to test."), IsOk());
+  auto result = cmac->Finalize();
+  ASSERT_THAT(result.status(), IsOk());
+  EXPECT_EQ(expected, result.ValueOrDie());
+
+  // Resetting also discards an unfinished message.
+  EXPECT_THAT(cmac->Update("Other data"), IsOk());
+  ASSERT_THAT(cmac->Reset(), IsOk());
+  EXPECT_THAT(cmac->Update("Some data to test."), IsOk());
+  result = cmac->Finalize();
+  ASSERT_THAT(result.status(), IsOk());
+  EXPECT_EQ(expected, result.ValueOrDie());
+}
+
 TEST(StatefulCmacBoringSslTest, testInvalidKeySizes) {
   size_t tag_size = 16;
 
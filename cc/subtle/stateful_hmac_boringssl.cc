@@ -25,6 +25,15 @@ namespace subtle {
 
 util::StatusOr<std::unique_ptr<StatefulMac>> StatefulHmacBoringSsl::New(
     HashType hash_type, uint32_t tag_size, const util::SecretData& key_value) {
+  auto ctx_or = NewHmacContext(hash_type, tag_size, key_value);
+  if (!ctx_or.ok()) return ctx_or.status();
+  return std::unique_ptr<StatefulMac>(
+      new StatefulHmacBoringSsl(tag_size, std::move(ctx_or.ValueOrDie())));
+}
+
+// static
+util::StatusOr<bssl::UniquePtr<HMAC_CTX>> StatefulHmacBoringSsl::NewHmacContext(
+    HashType hash_type, uint32_t tag_size, const util::SecretData& key_value) {
   util::StatusOr<const EVP_MD*> res = SubtleUtilBoringSSL::EvpHash(hash_type);
   if (!res.ok()) {
     return res.status();
@@ -48,8 +57,7 @@ util::StatusOr<std::unique_ptr<StatefulMac>> StatefulHmacBoringSsl::New(
                         "HMAC initialization failed");
   }
 
-  return std::unique_ptr<StatefulMac>(
-      new StatefulHmacBoringSsl(tag_size, std::move(ctx)));
+  return std::move(ctx);
 }
 
 util::Status StatefulHmacBoringSsl::Update(absl::string_view data) {
@@ -76,13 +84,30 @@ util::StatusOr<std::string> StatefulHmacBoringSsl::Finalize() {
   return std::string(reinterpret_cast<char*>(buf), tag_size_);
 }
 
+util::Status StatefulHmacBoringSsl::Reset() {
+  // Without a key and digest, HMAC_Init_ex reuses the precomputed pads.
+  if (!HMAC_Init_ex(hmac_context_.get(), nullptr, 0, nullptr, nullptr)) {
+    return util::Status(util::error::INTERNAL, "HMAC reset failed");
+  }
+  return util::OkStatus();
+}
+
 StatefulHmacBoringSslFactory::StatefulHmacBoringSslFactory(
     HashType hash_type, uint32_t tag_size, const util::SecretData& key_value)
-    : hash_type_(hash_type), tag_size_(tag_size), key_value_(key_value) {}
+    : tag_size_(tag_size),
+      hmac_context_(StatefulHmacBoringSsl::NewHmacContext(hash_type, tag_size,
+                                                          key_value)) {}
 
 util::StatusOr<std::unique_ptr<StatefulMac>>
 StatefulHmacBoringSslFactory::Create() const {
-  return StatefulHmacBoringSsl::New(hash_type_, tag_size_, key_value_);
+  if (!hmac_context_.ok()) return hmac_context_.status();
+  bssl::UniquePtr<HMAC_CTX> ctx(HMAC_CTX_new());
+  if (ctx == nullptr ||
+      !HMAC_CTX_copy_ex(ctx.get(), hmac_context_.ValueOrDie().get())) {
+    return util::Status(util::error::INTERNAL, "HMAC context copy failed");
+  }
+  return std::unique_ptr<StatefulMac>(
+      new StatefulHmacBoringSsl(tag_size_, std::move(ctx)));
 }
 
 }  // namespace subtle
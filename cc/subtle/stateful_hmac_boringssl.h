@@ -35,18 +35,28 @@ class StatefulHmacBoringSsl : public subtle::StatefulMac {
       HashType hash_type, uint32_t tag_size, const util::SecretData& key_value);
   util::Status Update(absl::string_view data) override;
   util::StatusOr<std::string> Finalize() override;
+  util::Status Reset() override;
 
  private:
   // Minimum HMAC key size in bytes.
   static constexpr size_t kMinKeySize = 16;
 
+  friend class StatefulHmacBoringSslFactory;
+
   StatefulHmacBoringSsl(uint32_t tag_size, bssl::UniquePtr<HMAC_CTX> ctx)
       : hmac_context_(std::move(ctx)), tag_size_(tag_size) {}
 
+  // Validates the parameters and returns an HMAC context initialized with
+  // 'key_value'.
+  static util::StatusOr<bssl::UniquePtr<HMAC_CTX>> NewHmacContext(
+      HashType hash_type, uint32_t tag_size, const util::SecretData& key_value);
+
   const bssl::UniquePtr<HMAC_CTX> hmac_context_;
   const uint32_t tag_size_;
 };
 
+// Precomputes the keyed HMAC state once; every Create() call starts from a
+// copy of it instead of rehashing the key.
 class StatefulHmacBoringSslFactory : public subtle::StatefulMacFactory {
  public:
   StatefulHmacBoringSslFactory(HashType hash_type, uint32_t tag_size,
@@ -54,9 +64,9 @@ class StatefulHmacBoringSslFactory : public subtle::StatefulMacFactory {
   util::StatusOr<std::unique_ptr<StatefulMac>> Create() const override;
 
  private:
-  const HashType hash_type_;
   const uint32_t tag_size_;
-  const util::SecretData key_value_;
+  // Initialized HMAC context, or the error which prevented creating it.
+  util::StatusOr<bssl::UniquePtr<HMAC_CTX>> hmac_context_;
 };
 
 }  // namespace subtle
@@ -160,6 +160,32 @@ TEST(StatefulHmacBoringSslTest, testMultipleUpdates) {
                      data4, expected_512_small);
 }
 
+TEST(StatefulHmacBoringSslTest, testReset) {
+  std::string key(test::HexDecodeOrDie("000102030405060708090a0b0c0d0e0f"));
+  std::string expected(
+      test::HexDecodeOrDie("1d6eb74bc283f7947e92c72bd985ce6e"));
+  auto hmac_result = StatefulHmacBoringSsl::New(
+      HashType::SHA256, kTagSize, util::SecretDataFromStringView(key));
+  ASSERT_THAT(hmac_result.status(), IsOk());
+  auto hmac = std::move(hmac_result.ValueOrDie());
+  EXPECT_THAT(hmac->Update("Other data"), IsOk());
+  ASSERT_THAT(hmac->Finalize().status(), IsOk());
+
+  ASSERT_THAT(hmac->Reset(), IsOk());
+  EXPECT_THAT(hmac->Update("Some data to test."), IsOk());
+  auto result = hmac->Finalize();
+  ASSERT_THAT(result.status(), IsOk());
+  EXPECT_EQ(expected, result.ValueOrDie());
+
+  // Resetting also discards an unfinished message.
+  EXPECT_THAT(hmac->Update("Other data"), IsOk());
+  ASSERT_THAT(hmac->Reset(), IsOk());
+  EXPECT_THAT(hmac->Update("Some data to test."), IsOk());
+  result = hmac->Finalize();
+  ASSERT_THAT(result.status(), IsOk());
+  EXPECT_EQ(expected, result.ValueOrDie());
+}
+
 TEST(StatefulHmacBoringSslTest, testInvalidKeySizes) {
   size_t tag_size = 16;
 
@@ -196,6 +222,40 @@ TEST(StatefulCmacFactoryTest, createsObjects) {
   EXPECT_THAT(output, StrEq(expected));
 }
 
+TEST(StatefulCmacFactoryTest, createsIndependentObjects) {
+  std::string key(test::HexDecodeOrDie("000102030405060708090a0b0c0d0e0f"));
+  std::string data = "Some data to test.";
+  std::string expected(
+      test::HexDecodeOrDie("1d6eb74bc283f7947e92c72bd985ce6e"));
+  StatefulHmacBoringSslFactory factory(HashType::SHA256, kTagSize,
+                                       util::SecretDataFromStringView(key));
+
+  auto first_or = factory.Create();
+  ASSERT_THAT(first_or.status(), IsOk());
+  auto second_or = factory.Create();
+  ASSERT_THAT(second_or.status(), IsOk());
+  // Updating one object must not affect the other, nor later objects.
+  EXPECT_THAT(first_or.ValueOrDie()->Update("other data"), IsOk());
+  EXPECT_THAT(second_or.ValueOrDie()->Update(data), IsOk());
+  auto output_or = second_or.ValueOrDie()->Finalize();
+  ASSERT_THAT(output_or.status(), IsOk());
+  EXPECT_THAT(output_or.ValueOrDie(), StrEq(expected));
+
+  auto third_or = factory.Create();
+  ASSERT_THAT(third_or.status(), IsOk());
+  EXPECT_THAT(third_or.ValueOrDie()->Update(data), IsOk());
+  output_or = third_or.ValueOrDie()->Finalize();
+  ASSERT_THAT(output_or.status(), IsOk());
+  EXPECT_THAT(output_or.ValueOrDie(), StrEq(expected));
+}
+
+TEST(StatefulCmacFactoryTest, invalidKeySize) {
+  StatefulHmacBoringSslFactory factory(HashType::SHA256, kTagSize,
+                                       util::SecretData(15, 'x'));
+  EXPECT_THAT(factory.Create().status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
 class StatefulHmacBoringSslTestVectorTest
     : public ::testing::TestWithParam<std::pair<int, std::string>> {
  public:
@@ -20,6 +20,7 @@
 #include <cstdint>
 #include <vector>
 
+#include "tink/util/secret_data.h"
 #include "tink/util/status.h"
 
 namespace crypto {
@@ -50,6 +51,47 @@ class StreamSegmentDecrypter {
       bool is_last_segment,
       std::vector<uint8_t>* plaintext_buffer) = 0;
 
+  // Like DecryptSegment(), but decrypts the ciphertext in '*segment' in
+  // place: on success '*segment' holds the plaintext of the segment.
+  // This saves copying the ciphertext into a separate plaintext buffer.
+  // If the decryption fails, the contents of '*segment' are unspecified.
+  // Implementations which cannot support this return UNIMPLEMENTED, and leave
+  // '*segment' unchanged.
+  virtual util::Status DecryptSegmentInPlace(int64_t segment_number,
+                                             bool is_last_segment,
+                                             std::vector<uint8_t>* segment) {
+    return util::Status(util::error::UNIMPLEMENTED,
+                        "DecryptSegmentInPlace() is not supported");
+  }
+
+  // Verifies that '*segment' is the authentic ciphertext of the specified
+  // segment, without returning its plaintext. '*segment' may be overwritten,
+  // its contents are unspecified afterwards. By default the segment is
+  // decrypted in place (or into a temporary buffer), and the plaintext is
+  // wiped. Implementations which can authenticate a segment without
+  // decrypting it override this.
+  virtual util::Status VerifySegment(int64_t segment_number,
+                                     bool is_last_segment,
+                                     std::vector<uint8_t>* segment) {
+    if (segment == nullptr) {
+      return util::Status(util::error::INVALID_ARGUMENT,
+                          "segment must be non-null");
+    }
+    util::Status status =
+        DecryptSegmentInPlace(segment_number, is_last_segment, segment);
+    if (status.error_code() != util::error::UNIMPLEMENTED) {
+      util::SafeZeroMemory(reinterpret_cast<char*>(segment->data()),
+                           segment->size());
+      return status;
+    }
+    std::vector<uint8_t> plaintext;
+    status = DecryptSegment(*segment, segment_number, is_last_segment,
+                            &plaintext);
+    util::SafeZeroMemory(reinterpret_cast<char*>(plaintext.data()),
+                         plaintext.size());
+    return status;
+  }
+
   // Initializes this decrypter, using the information from 'header',
   // which must be of size exactly get_header_size().
   virtual util::Status Init(const std::vector<uint8_t>& header) = 0;
@@ -76,6 +76,33 @@ class StreamSegmentEncrypter {
       bool is_last_segment,
       std::vector<uint8_t>* ciphertext_buffer) = 0;
 
+  // Encrypts 'plaintext' as the segment with number 'segment_number', and
+  // writes the resulting ciphertext to 'ciphertext_buffer', adjusting its
+  // size as needed. Unlike EncryptSegment(), this does not use or change the
+  // current segment number, and is safe to call concurrently from several
+  // threads. The result is identical to EncryptSegment() called for the same
+  // segment number. Implementations which cannot support this return
+  // UNIMPLEMENTED.
+  virtual util::Status EncryptSegmentAt(
+      const std::vector<uint8_t>& plaintext, int64_t segment_number,
+      bool is_last_segment, std::vector<uint8_t>* ciphertext_buffer) const {
+    return util::Status(util::error::UNIMPLEMENTED,
+                        "EncryptSegmentAt() is not supported");
+  }
+
+  // Like EncryptSegmentAt(), but encrypts the plaintext in '*segment' in
+  // place: on success '*segment' holds the ciphertext of the segment, which
+  // is longer than the plaintext by the segment overhead. This saves copying
+  // the plaintext into a separate ciphertext buffer. If the encryption fails,
+  // the contents of '*segment' are unspecified. Implementations which cannot
+  // support this return UNIMPLEMENTED, and leave '*segment' unchanged.
+  virtual util::Status EncryptSegmentInPlace(
+      int64_t segment_number, bool is_last_segment,
+      std::vector<uint8_t>* segment) const {
+    return util::Status(util::error::UNIMPLEMENTED,
+                        "EncryptSegmentInPlace() is not supported");
+  }
+
   // Returns the header of the ciphertext stream.
   virtual const std::vector<uint8_t>& get_header() const = 0;
 
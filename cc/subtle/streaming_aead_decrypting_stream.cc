@@ -110,6 +110,71 @@ StatusOr<std::unique_ptr<InputStream>> StreamingAeadDecryptingStream::New(
   return {std::move(dec_stream)};
 }
 
+// static
+StatusOr<std::unique_ptr<InputStream>>
+StreamingAeadDecryptingStream::NewChunked(
+    std::unique_ptr<StreamSegmentDecrypter> segment_decrypter,
+    std::unique_ptr<InputStream> ciphertext_source, ChunkedOptions options) {
+  if (options.target_chunk_size <= 0) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "target_chunk_size must be positive");
+  }
+  auto dec_stream_result =
+      New(std::move(segment_decrypter), std::move(ciphertext_source));
+  if (!dec_stream_result.ok()) return dec_stream_result.status();
+  auto* dec_stream = static_cast<StreamingAeadDecryptingStream*>(
+      dec_stream_result.ValueOrDie().get());
+  dec_stream->target_chunk_size_ = options.target_chunk_size;
+  // Reserving the space for the whole chunk avoids reallocations when the
+  // segments are appended.
+  dec_stream->pt_buffer_.reserve(
+      options.target_chunk_size +
+      dec_stream->segment_decrypter_->get_plaintext_segment_size());
+  return dec_stream_result;
+}
+
+Status StreamingAeadDecryptingStream::ReadAndDecryptSegment(
+    std::vector<uint8_t>* plaintext) {
+  if (segment_number_ > 0) {
+    ct_buffer_.resize(segment_decrypter_->get_ciphertext_segment_size());
+  }
+  Status status =
+      ReadFromStream(ct_source_.get(), ct_buffer_.size(), &ct_buffer_);
+  if (!status.ok() && (status.error_code() != util::error::OUT_OF_RANGE)) {
+    return status;
+  }
+  read_last_segment_ = (status.error_code() == util::error::OUT_OF_RANGE);
+  status = segment_decrypter_->DecryptSegment(
+      ct_buffer_,
+      /* segment_number = */ segment_number_,
+      /* is_last_segment = */ read_last_segment_,
+      plaintext);
+  if (!status.ok() && !read_last_segment_) {
+    // Try decrypting as the last segment, if haven't tried yet.
+    read_last_segment_ = true;
+    status = segment_decrypter_->DecryptSegment(
+        ct_buffer_,
+        /* segment_number = */ segment_number_,
+        /* is_last_segment = */ read_last_segment_,
+        plaintext);
+  }
+  return status;
+}
+
+void StreamingAeadDecryptingStream::DecryptFollowingSegments() {
+  while (static_cast<int64_t>(pt_buffer_.size()) < target_chunk_size_ &&
+         !read_last_segment_) {
+    segment_number_++;
+    Status status = ReadAndDecryptSegment(&segment_buffer_);
+    if (!status.ok()) {
+      pending_status_ = status;
+      return;
+    }
+    pt_buffer_.insert(pt_buffer_.end(), segment_buffer_.begin(),
+                      segment_buffer_.end());
+  }
+}
+
 StatusOr<int> StreamingAeadDecryptingStream::Next(const void** data) {
   if (!status_.ok()) return status_;
 
@@ -127,26 +192,9 @@ StatusOr<int> StreamingAeadDecryptingStream::Next(const void** data) {
     if (!status_.ok()) return status_;
     is_initialized_ = true;
     count_backedup_ = 0;
-    status_ = ReadFromStream(ct_source_.get(), ct_buffer_.size(), &ct_buffer_);
-    if (!status_.ok() && (status_.error_code() != util::error::OUT_OF_RANGE)) {
-      return status_;
-    }
-    read_last_segment_ = (status_.error_code() == util::error::OUT_OF_RANGE);
-    status_ = segment_decrypter_->DecryptSegment(
-        ct_buffer_,
-        /* segment_number = */ segment_number_,
-        /* is_last_segment = */ read_last_segment_,
-        &pt_buffer_);
-    if (!status_.ok() && !read_last_segment_) {
-      // Try decrypting as the last segment, if haven't tried yet.
-      read_last_segment_ = true;
-      status_ = segment_decrypter_->DecryptSegment(
-          ct_buffer_,
-          /* segment_number = */ segment_number_,
-          /* is_last_segment = */ read_last_segment_,
-          &pt_buffer_);
-    }
+    status_ = ReadAndDecryptSegment(&pt_buffer_);
     if (!status_.ok()) return status_;
+    DecryptFollowingSegments();
     *data = pt_buffer_.data();
     position_ = pt_buffer_.size();
     return pt_buffer_.size();
@@ -164,32 +212,18 @@ StatusOr<int> StreamingAeadDecryptingStream::Next(const void** data) {
 
   // We're past the first segment, and no space was backed up, so we
   // try to get and decrypt the next ciphertext segment, if any.
+  if (!pending_status_.ok()) {
+    status_ = pending_status_;
+    return status_;
+  }
   if (read_last_segment_) {
     status_ = Status(util::error::OUT_OF_RANGE, "Reached end of stream.");
     return status_;
   }
   segment_number_++;
-  ct_buffer_.resize(segment_decrypter_->get_ciphertext_segment_size());
-  status_ = ReadFromStream(ct_source_.get(), ct_buffer_.size(), &ct_buffer_);
-  if (!status_.ok() && (status_.error_code() != util::error::OUT_OF_RANGE)) {
-    return status_;
-  }
-  read_last_segment_ = (status_.error_code() == util::error::OUT_OF_RANGE);
-  status_ = segment_decrypter_->DecryptSegment(
-      ct_buffer_,
-      /* segment_number = */ segment_number_,
-      /* is_last_segment = */ read_last_segment_,
-      &pt_buffer_);
-  if (!status_.ok() && !read_last_segment_) {
-    // Try decrypting as the last segment, if haven't tried yet.
-    read_last_segment_ = true;
-    status_ = segment_decrypter_->DecryptSegment(
-        ct_buffer_,
-        /* segment_number = */ segment_number_,
-        /* is_last_segment = */ read_last_segment_,
-        &pt_buffer_);
-  }
+  status_ = ReadAndDecryptSegment(&pt_buffer_);
   if (!status_.ok()) return status_;
+  DecryptFollowingSegments();
   *data = pt_buffer_.data();
   pt_buffer_offset_ = 0;
   position_ += pt_buffer_.size();
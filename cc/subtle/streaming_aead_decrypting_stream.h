@@ -41,6 +41,27 @@ class StreamingAeadDecryptingStream : public InputStream {
       New(std::unique_ptr<StreamSegmentDecrypter> segment_decrypter,
           std::unique_ptr<crypto::tink::InputStream> ciphertext_source);
 
+  // Options for decrypting several segments per call of Next().
+  struct ChunkedOptions {
+    // Next() decrypts consecutive segments into one plaintext buffer until
+    // it holds at least this many bytes or the last segment was decrypted,
+    // and returns the whole buffer. Bounds the memory used by the stream to
+    // roughly this many bytes plus a segment. Must be positive.
+    int target_chunk_size = 1 << 20;  // 1 MB
+  };
+
+  // Like New(), but every call of Next() returns the plaintext of several
+  // segments as one contiguous buffer, as specified by 'options'. Callers
+  // that read large streams then make much fewer calls through the stack of
+  // wrapping streams than with one segment per call. If a segment fails to
+  // decrypt, Next() first returns the plaintext of the segments before it,
+  // and fails on the following call.
+  static
+  crypto::tink::util::StatusOr<std::unique_ptr<crypto::tink::InputStream>>
+      NewChunked(std::unique_ptr<StreamSegmentDecrypter> segment_decrypter,
+                 std::unique_ptr<crypto::tink::InputStream> ciphertext_source,
+                 ChunkedOptions options);
+
   // -----------------------
   // Methods of InputStream-interface implemented by this class.
   crypto::tink::util::StatusOr<int> Next(const void** data) override;
@@ -49,6 +70,18 @@ class StreamingAeadDecryptingStream : public InputStream {
 
  private:
   StreamingAeadDecryptingStream() {}
+
+  // Reads the ciphertext of segment segment_number_ from ct_source_ and
+  // decrypts it into '*plaintext'. Sets read_last_segment_ if it is the last
+  // segment.
+  crypto::tink::util::Status ReadAndDecryptSegment(
+      std::vector<uint8_t>* plaintext);
+
+  // Appends the plaintext of the following segments to pt_buffer_, until it
+  // holds target_chunk_size_ bytes or the last segment was decrypted. If a
+  // segment fails to decrypt, stores the error in pending_status_.
+  void DecryptFollowingSegments();
+
   std::unique_ptr<StreamSegmentDecrypter> segment_decrypter_;
   std::unique_ptr<crypto::tink::InputStream> ct_source_;
   std::vector<uint8_t> ct_buffer_;  // ciphertext buffer
@@ -56,6 +89,12 @@ class StreamingAeadDecryptingStream : public InputStream {
   int64_t position_;  // number of plaintext bytes read from this stream
   int64_t segment_number_;  // current segment number
   crypto::tink::util::Status status_;  // status of the stream
+  // The error of a segment after those in pt_buffer_, which is returned once
+  // pt_buffer_ has been read.
+  crypto::tink::util::Status pending_status_;
+  // Zero unless the stream returns several segments per Next().
+  int target_chunk_size_ = 0;
+  std::vector<uint8_t> segment_buffer_;  // plaintext of a following segment
 
   // Counters that describe the state of the data in pt_buffer_.
   int count_backedup_;    // # bytes in pt_buffer_ that were backed up
@@ -406,6 +406,119 @@ TEST_F(StreamingAeadDecryptingStreamTest, BackupAndPosition) {
   EXPECT_EQ(pt, decrypted_first_segment + decrypted_rest);
 }
 
+// Returns a stream from StreamingAeadDecryptingStream::NewChunked().
+std::unique_ptr<InputStream> GetChunkedDecryptingStream(
+    int pt_segment_size, int header_size, absl::string_view ciphertext,
+    int target_chunk_size) {
+  std::unique_ptr<InputStream> ct_source(
+      absl::make_unique<IstreamInputStream>(
+          absl::make_unique<std::stringstream>(std::string(ciphertext))));
+  StreamingAeadDecryptingStream::ChunkedOptions options;
+  options.target_chunk_size = target_chunk_size;
+  auto dec_stream_result = StreamingAeadDecryptingStream::NewChunked(
+      absl::make_unique<DummyStreamSegmentDecrypter>(
+          pt_segment_size, header_size, /* ct_offset = */ 0),
+      std::move(ct_source), options);
+  EXPECT_TRUE(dec_stream_result.ok()) << dec_stream_result.status();
+  return std::move(dec_stream_result.ValueOrDie());
+}
+
+TEST_F(StreamingAeadDecryptingStreamTest, ChunkedStreams) {
+  int pt_segment_size = 100;
+  int header_size = 20;
+  for (int pt_size : {0, 10, 80, 81, 1000, 100000}) {
+    for (int target_chunk_size : {1, 100, 250, 1000, 1 << 20}) {
+      SCOPED_TRACE(absl::StrCat("pt_size = ", pt_size,
+                                ", target_chunk_size = ", target_chunk_size));
+      std::string pt = Random::GetRandomBytes(pt_size);
+      DummyStreamSegmentEncrypter seg_enc(pt_segment_size, header_size,
+                                          /* ct_offset = */ 0);
+      auto dec_stream = GetChunkedDecryptingStream(
+          pt_segment_size, header_size, seg_enc.GenerateCiphertext(pt),
+          target_chunk_size);
+
+      // Every chunk but the last one holds whole segments, and at least
+      // target_chunk_size bytes.
+      std::string decrypted;
+      const void* buffer;
+      while (true) {
+        auto next_result = dec_stream->Next(&buffer);
+        if (!next_result.ok()) {
+          EXPECT_EQ(util::error::OUT_OF_RANGE,
+                    next_result.status().error_code());
+          break;
+        }
+        int buffer_size = next_result.ValueOrDie();
+        decrypted.append(static_cast<const char*>(buffer), buffer_size);
+        EXPECT_EQ(decrypted.size(), dec_stream->Position());
+        if (decrypted.size() < pt.size()) {
+          EXPECT_GE(buffer_size, target_chunk_size);
+          EXPECT_EQ(0, (decrypted.size() + header_size) % pt_segment_size);
+        }
+        // Backing up half of the chunk returns that half again.
+        int backup_size = buffer_size / 2;
+        if (backup_size == 0) continue;
+        dec_stream->BackUp(backup_size);
+        EXPECT_EQ(decrypted.size() - backup_size, dec_stream->Position());
+        next_result = dec_stream->Next(&buffer);
+        ASSERT_TRUE(next_result.ok()) << next_result.status();
+        EXPECT_EQ(backup_size, next_result.ValueOrDie());
+        EXPECT_EQ(decrypted.substr(decrypted.size() - backup_size),
+                  std::string(static_cast<const char*>(buffer), backup_size));
+      }
+      EXPECT_EQ(pt, decrypted);
+    }
+  }
+}
+
+TEST_F(StreamingAeadDecryptingStreamTest, ChunkedStreamWithInvalidSegment) {
+  int pt_segment_size = 100;
+  int header_size = 20;
+  std::string pt = Random::GetRandomBytes(1000);
+  DummyStreamSegmentEncrypter seg_enc(pt_segment_size, header_size,
+                                      /* ct_offset = */ 0);
+  std::string ct = seg_enc.GenerateCiphertext(pt);
+  auto dec_stream = GetChunkedDecryptingStream(
+      pt_segment_size, header_size, ct.substr(0, ct.size() - 2), 1 << 20);
+
+  // The first chunk holds the segments before the truncated last one.
+  const void* buffer;
+  auto next_result = dec_stream->Next(&buffer);
+  ASSERT_TRUE(next_result.ok()) << next_result.status();
+  int buffer_size = next_result.ValueOrDie();
+  EXPECT_EQ(10 * pt_segment_size - header_size, buffer_size);
+  EXPECT_EQ(pt.substr(0, buffer_size),
+            std::string(static_cast<const char*>(buffer), buffer_size));
+  dec_stream->BackUp(10);
+  next_result = dec_stream->Next(&buffer);
+  ASSERT_TRUE(next_result.ok()) << next_result.status();
+  EXPECT_EQ(10, next_result.ValueOrDie());
+
+  // Then the error of the last segment.
+  next_result = dec_stream->Next(&buffer);
+  EXPECT_EQ(util::error::INVALID_ARGUMENT,
+            next_result.status().error_code());
+  EXPECT_PRED_FORMAT2(testing::IsSubstring, "unexpected last-segment marker",
+                      next_result.status().error_message());
+  next_result = dec_stream->Next(&buffer);
+  EXPECT_EQ(util::error::INVALID_ARGUMENT,
+            next_result.status().error_code());
+}
+
+TEST_F(StreamingAeadDecryptingStreamTest, InvalidChunkedOptions) {
+  for (int target_chunk_size : {0, -1}) {
+    StreamingAeadDecryptingStream::ChunkedOptions options;
+    options.target_chunk_size = target_chunk_size;
+    auto dec_stream_result = StreamingAeadDecryptingStream::NewChunked(
+        absl::make_unique<DummyStreamSegmentDecrypter>(100, 20, 0),
+        absl::make_unique<IstreamInputStream>(
+            absl::make_unique<std::stringstream>("ciphertext")),
+        options);
+    EXPECT_EQ(util::error::INVALID_ARGUMENT,
+              dec_stream_result.status().error_code());
+  }
+}
+
 }  // namespace
 }  // namespace subtle
 }  // namespace tink
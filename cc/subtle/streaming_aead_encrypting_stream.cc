@@ -18,8 +18,12 @@
 
 #include <algorithm>
 #include <cstring>
+#include <string>
+#include <utility>
 
 #include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "tink/output_stream.h"
 #include "tink/subtle/stream_segment_encrypter.h"
 #include "tink/util/statusor.h"
@@ -60,8 +64,59 @@ util::Status WriteToStream(const std::vector<uint8_t>& contents,
   return Status::OK;
 }
 
+// The version of the encoding of Checkpoint, which is
+//   version || segment_count || plaintext_position || ciphertext_position
+//     || header
+// where version is one byte, and the positions and the count are big endian
+// 64 bit integers.
+constexpr uint8_t kCheckpointVersion = 1;
+constexpr int kCheckpointPrefixSize = 1 + 3 * 8;
+
+void AppendBigEndian64(int64_t value, std::string* out) {
+  for (int shift = 56; shift >= 0; shift -= 8) {
+    out->push_back(static_cast<char>((static_cast<uint64_t>(value) >> shift) &
+                                     0xff));
+  }
+}
+
+int64_t ReadBigEndian64(absl::string_view in) {
+  uint64_t value = 0;
+  for (int i = 0; i < 8; i++) {
+    value = (value << 8) | static_cast<uint8_t>(in[i]);
+  }
+  return static_cast<int64_t>(value);
+}
+
 }  // anonymous namespace
 
+std::string StreamingAeadEncryptingStream::Checkpoint::Serialize() const {
+  std::string serialized(1, static_cast<char>(kCheckpointVersion));
+  AppendBigEndian64(segment_count, &serialized);
+  AppendBigEndian64(plaintext_position, &serialized);
+  AppendBigEndian64(ciphertext_position, &serialized);
+  serialized.append(header);
+  return serialized;
+}
+
+// static
+StatusOr<StreamingAeadEncryptingStream::Checkpoint>
+StreamingAeadEncryptingStream::Checkpoint::Parse(absl::string_view serialized) {
+  if (serialized.size() <= kCheckpointPrefixSize ||
+      static_cast<uint8_t>(serialized[0]) != kCheckpointVersion) {
+    return Status(util::error::INVALID_ARGUMENT, "Invalid checkpoint");
+  }
+  Checkpoint checkpoint;
+  checkpoint.segment_count = ReadBigEndian64(serialized.substr(1));
+  checkpoint.plaintext_position = ReadBigEndian64(serialized.substr(9));
+  checkpoint.ciphertext_position = ReadBigEndian64(serialized.substr(17));
+  checkpoint.header = std::string(serialized.substr(kCheckpointPrefixSize));
+  if (checkpoint.segment_count < 0 || checkpoint.plaintext_position < 0 ||
+      checkpoint.ciphertext_position < 0) {
+    return Status(util::error::INVALID_ARGUMENT, "Invalid checkpoint");
+  }
+  return checkpoint;
+}
+
 // static
 StatusOr<std::unique_ptr<OutputStream>> StreamingAeadEncryptingStream::New(
     std::unique_ptr<StreamSegmentEncrypter> segment_encrypter,
@@ -89,14 +144,204 @@ StatusOr<std::unique_ptr<OutputStream>> StreamingAeadEncryptingStream::New(
   }
   enc_stream->pt_buffer_.resize(first_segment_size);
   enc_stream->pt_to_encrypt_.resize(0);
+  enc_stream->next_segment_number_ =
+      enc_stream->segment_encrypter_->get_segment_number();
   enc_stream->position_ = 0;
   enc_stream->is_first_segment_ = true;
   enc_stream->count_backedup_ = first_segment_size;
   enc_stream->pt_buffer_offset_ = 0;
   enc_stream->status_ = Status::OK;
+  const std::vector<uint8_t>& header =
+      enc_stream->segment_encrypter_->get_header();
+  enc_stream->checkpoint_.header = std::string(header.begin(), header.end());
   return {std::move(enc_stream)};
 }
 
+// static
+StatusOr<std::unique_ptr<StreamingAeadEncryptingStream>>
+StreamingAeadEncryptingStream::NewResumed(
+    std::unique_ptr<StreamSegmentEncrypter> segment_encrypter,
+    std::unique_ptr<OutputStream> ciphertext_destination,
+    const Checkpoint& checkpoint) {
+  if (segment_encrypter == nullptr) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "segment_encrypter must be non-null");
+  }
+  const std::vector<uint8_t>& header = segment_encrypter->get_header();
+  if (std::string(header.begin(), header.end()) != checkpoint.header) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "checkpoint does not match segment_encrypter");
+  }
+  // Only the numbers of segments are stored in the ciphertext, so the
+  // positions must follow from them.
+  int64_t plaintext_position = 0;
+  int64_t ciphertext_position = 0;
+  if (checkpoint.segment_count > 0) {
+    plaintext_position =
+        checkpoint.segment_count *
+            segment_encrypter->get_plaintext_segment_size() -
+        segment_encrypter->get_ciphertext_offset() - header.size();
+    ciphertext_position = checkpoint.segment_count *
+                              segment_encrypter->get_ciphertext_segment_size() -
+                          segment_encrypter->get_ciphertext_offset();
+  }
+  if (checkpoint.segment_count < 0 ||
+      checkpoint.plaintext_position != plaintext_position ||
+      checkpoint.ciphertext_position != ciphertext_position) {
+    return Status(util::error::INVALID_ARGUMENT, "Invalid checkpoint");
+  }
+  int64_t segment_number = segment_encrypter->get_segment_number();
+  auto stream_result =
+      New(std::move(segment_encrypter), std::move(ciphertext_destination));
+  if (!stream_result.ok()) return stream_result.status();
+  std::unique_ptr<StreamingAeadEncryptingStream> enc_stream(
+      static_cast<StreamingAeadEncryptingStream*>(
+          stream_result.ValueOrDie().release()));
+  if (checkpoint.segment_count == 0) return {std::move(enc_stream)};
+
+  // The header and the first segment were written already, so the stream
+  // continues like after a call to Next() which wrote the previous segment.
+  enc_stream->next_segment_number_ = segment_number + checkpoint.segment_count;
+  enc_stream->pt_buffer_.clear();
+  enc_stream->position_ = checkpoint.plaintext_position;
+  enc_stream->is_first_segment_ = false;
+  enc_stream->count_backedup_ = 0;
+  enc_stream->checkpoint_ = checkpoint;
+  return {std::move(enc_stream)};
+}
+
+// static
+StatusOr<std::unique_ptr<OutputStream>>
+StreamingAeadEncryptingStream::NewParallel(
+    std::unique_ptr<StreamSegmentEncrypter> segment_encrypter,
+    std::unique_ptr<OutputStream> ciphertext_destination,
+    ParallelOptions options) {
+  if (options.schedule == nullptr) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "options.schedule must be non-null");
+  }
+  if (options.max_segments_in_flight <= 0) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "options.max_segments_in_flight must be positive");
+  }
+  auto stream_result =
+      New(std::move(segment_encrypter), std::move(ciphertext_destination));
+  if (!stream_result.ok()) return stream_result.status();
+  std::unique_ptr<StreamingAeadEncryptingStream> enc_stream(
+      static_cast<StreamingAeadEncryptingStream*>(
+          stream_result.ValueOrDie().release()));
+  enc_stream->schedule_ = std::move(options.schedule);
+  enc_stream->max_segments_in_flight_ = options.max_segments_in_flight;
+  return {std::move(enc_stream)};
+}
+
+StreamingAeadEncryptingStream::~StreamingAeadEncryptingStream() {
+  // The scheduled tasks refer to segment_encrypter_.
+  for (const auto& job : segments_in_flight_) {
+    job->mutex.LockWhen(absl::Condition(&job->done));
+    job->mutex.Unlock();
+  }
+}
+
+Status StreamingAeadEncryptingStream::EncryptAndWriteSegment(
+    std::vector<uint8_t>* plaintext, bool is_last_segment) {
+  int plaintext_size = plaintext->size();
+  if (schedule_ == nullptr) {
+    if (encrypts_in_place_) {
+      // The buffer handed out by Next() becomes the ciphertext buffer.
+      auto status = segment_encrypter_->EncryptSegmentInPlace(
+          next_segment_number_, is_last_segment, plaintext);
+      if (status.ok()) {
+        next_segment_number_++;
+        status = WriteToStream(*plaintext, ct_destination_.get());
+        if (!status.ok()) return status;
+        OnSegmentWritten(plaintext_size, plaintext->size(), is_last_segment);
+        return Status::OK;
+      }
+      if (status.error_code() != util::error::UNIMPLEMENTED) return status;
+      encrypts_in_place_ = false;
+    }
+    // The segment encrypter numbers the segments itself, unless the stream
+    // was resumed.
+    auto status =
+        segment_encrypter_->get_segment_number() == next_segment_number_
+            ? segment_encrypter_->EncryptSegment(*plaintext, is_last_segment,
+                                                 &ct_buffer_)
+            : segment_encrypter_->EncryptSegmentAt(
+                  *plaintext, next_segment_number_, is_last_segment,
+                  &ct_buffer_);
+    if (!status.ok()) return status;
+    next_segment_number_++;
+    status = WriteToStream(ct_buffer_, ct_destination_.get());
+    if (!status.ok()) return status;
+    OnSegmentWritten(plaintext_size, ct_buffer_.size(), is_last_segment);
+    return Status::OK;
+  }
+
+  while (segments_in_flight_.size() >=
+         static_cast<size_t>(max_segments_in_flight_)) {
+    auto status = WriteOldestSegment();
+    if (!status.ok()) return status;
+  }
+  auto job = std::make_shared<SegmentJob>();
+  job->plaintext = std::move(*plaintext);
+  job->plaintext_size = plaintext_size;
+  job->is_last_segment = is_last_segment;
+  plaintext->clear();
+  segments_in_flight_.push_back(job);
+  const StreamSegmentEncrypter* segment_encrypter = segment_encrypter_.get();
+  int64_t segment_number = next_segment_number_++;
+  schedule_([job, segment_encrypter, segment_number, is_last_segment]() {
+    job->status = segment_encrypter->EncryptSegmentInPlace(
+        segment_number, is_last_segment, &job->plaintext);
+    if (job->status.ok()) {
+      job->ciphertext.swap(job->plaintext);
+    } else if (job->status.error_code() == util::error::UNIMPLEMENTED) {
+      job->status = segment_encrypter->EncryptSegmentAt(
+          job->plaintext, segment_number, is_last_segment, &job->ciphertext);
+      // The plaintext is not needed anymore, release its memory early.
+      std::vector<uint8_t>().swap(job->plaintext);
+    }
+    absl::MutexLock lock(&job->mutex);
+    job->done = true;
+  });
+  return Status::OK;
+}
+
+Status StreamingAeadEncryptingStream::WriteOldestSegment() {
+  std::shared_ptr<SegmentJob> job = std::move(segments_in_flight_.front());
+  segments_in_flight_.pop_front();
+  job->mutex.LockWhen(absl::Condition(&job->done));
+  job->mutex.Unlock();
+  if (!job->status.ok()) return job->status;
+  auto status = WriteToStream(job->ciphertext, ct_destination_.get());
+  if (!status.ok()) return status;
+  OnSegmentWritten(job->plaintext_size, job->ciphertext.size(),
+                   job->is_last_segment);
+  return Status::OK;
+}
+
+Status StreamingAeadEncryptingStream::WriteAllSegments() {
+  while (!segments_in_flight_.empty()) {
+    auto status = WriteOldestSegment();
+    if (!status.ok()) return status;
+  }
+  return Status::OK;
+}
+
+void StreamingAeadEncryptingStream::OnSegmentWritten(int plaintext_size,
+                                                     int ciphertext_size,
+                                                     bool is_last_segment) {
+  // The stream cannot be resumed after its last segment.
+  if (is_last_segment) return;
+  if (checkpoint_.segment_count == 0) {
+    checkpoint_.ciphertext_position += checkpoint_.header.size();
+  }
+  checkpoint_.segment_count++;
+  checkpoint_.plaintext_position += plaintext_size;
+  checkpoint_.ciphertext_position += ciphertext_size;
+}
+
 StatusOr<int> StreamingAeadEncryptingStream::Next(void** data) {
   if (!status_.ok()) return status_;
 
@@ -131,10 +376,8 @@ StatusOr<int> StreamingAeadEncryptingStream::Next(void** data) {
   //
   // Step 1.
   if (!pt_to_encrypt_.empty()) {
-    status_ = segment_encrypter_->EncryptSegment(
-        pt_to_encrypt_, /* is_last_segment = */ false, &ct_buffer_);
-    if (!status_.ok()) return status_;
-    status_ = WriteToStream(ct_buffer_, ct_destination_.get());
+    status_ = EncryptAndWriteSegment(&pt_to_encrypt_,
+                                     /* is_last_segment = */ false);
     if (!status_.ok()) return status_;
   }
   // Step 2.
@@ -173,13 +416,8 @@ Status StreamingAeadEncryptingStream::Close() {
   }
   if (pt_last_segment != &pt_to_encrypt_ && (!pt_to_encrypt_.empty())) {
     // Before writing the last segment we must encrypt pt_to_encrypt_.
-    status_ = segment_encrypter_->EncryptSegment(
-        pt_to_encrypt_, /* is_last_segment = */ false, &ct_buffer_);
-    if (!status_.ok()) {
-      ct_destination_->Close().IgnoreError();
-      return status_;
-    }
-    status_ = WriteToStream(ct_buffer_, ct_destination_.get());
+    status_ = EncryptAndWriteSegment(&pt_to_encrypt_,
+                                     /* is_last_segment = */ false);
     if (!status_.ok()) {
       ct_destination_->Close().IgnoreError();
       return status_;
@@ -187,13 +425,13 @@ Status StreamingAeadEncryptingStream::Close() {
   }
 
   // Encrypt pt_last_segment, write the ciphertext, and close the stream.
-  status_ = segment_encrypter_->EncryptSegment(
-      *pt_last_segment, /* is_last_segment = */ true, &ct_buffer_);
+  status_ = EncryptAndWriteSegment(pt_last_segment,
+                                   /* is_last_segment = */ true);
   if (!status_.ok()) {
     ct_destination_->Close().IgnoreError();
     return status_;
   }
-  status_ = WriteToStream(ct_buffer_, ct_destination_.get());
+  status_ = WriteAllSegments();
   if (!status_.ok()) {
     ct_destination_->Close().IgnoreError();
     return status_;
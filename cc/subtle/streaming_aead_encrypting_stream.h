@@ -17,9 +17,15 @@
 #ifndef TINK_SUBTLE_STREAMING_AEAD_ENCRYPTING_STREAM_H_
 #define TINK_SUBTLE_STREAMING_AEAD_ENCRYPTING_STREAM_H_
 
+#include <deque>
+#include <functional>
 #include <memory>
+#include <string>
 #include <vector>
 
+#include "absl/base/thread_annotations.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "tink/output_stream.h"
 #include "tink/subtle/stream_segment_encrypter.h"
 #include "tink/util/statusor.h"
@@ -40,6 +46,82 @@ class StreamingAeadEncryptingStream : public OutputStream {
       New(std::unique_ptr<StreamSegmentEncrypter> segment_encrypter,
           std::unique_ptr<crypto::tink::OutputStream> ciphertext_destination);
 
+  // Options for encrypting several segments of a stream concurrently.
+  struct ParallelOptions {
+    // Runs the given task, typically on a thread pool owned by the caller.
+    // Tasks may run on any thread and in any order. Must be non-null,
+    // and must eventually run every task it has been given.
+    std::function<void(std::function<void()>)> schedule;
+    // The maximal number of segments that are being encrypted or wait to be
+    // written at any time. Bounds the memory used by the stream to roughly
+    // twice this many segments. Must be positive.
+    int max_segments_in_flight = 8;
+  };
+
+  // Like New(), but encrypts up to options.max_segments_in_flight segments
+  // concurrently using options.schedule. The segments are still written to
+  // 'ciphertext_destination' in order, so the resulting ciphertext is
+  // identical to the one New() would produce. 'segment_encrypter' must
+  // support EncryptSegmentAt(); otherwise the stream fails with
+  // UNIMPLEMENTED without writing any segment.
+  static
+  crypto::tink::util::StatusOr<std::unique_ptr<crypto::tink::OutputStream>>
+      NewParallel(
+          std::unique_ptr<StreamSegmentEncrypter> segment_encrypter,
+          std::unique_ptr<crypto::tink::OutputStream> ciphertext_destination,
+          ParallelOptions options);
+
+  // The state of an encrypting stream at a segment boundary, from which an
+  // interrupted encryption can be resumed with NewResumed(), e.g. to continue
+  // an upload that failed after some of the ciphertext was stored.
+  // A Checkpoint contains no secret data.
+  struct Checkpoint {
+    // The header of the ciphertext.
+    std::string header;
+    // The number of segments already written to the ciphertext destination.
+    int64_t segment_count = 0;
+    // The number of plaintext bytes encrypted in these segments.
+    int64_t plaintext_position = 0;
+    // The number of bytes written to the ciphertext destination for these
+    // segments, including the header. Zero if no segment was written.
+    int64_t ciphertext_position = 0;
+
+    // Returns an encoding of this checkpoint, which can be stored with the
+    // incomplete ciphertext and decoded with Parse().
+    std::string Serialize() const;
+    static crypto::tink::util::StatusOr<Checkpoint> Parse(
+        absl::string_view serialized);
+  };
+
+  // Like New(), but resumes the encryption of an earlier stream at
+  // 'checkpoint', which was obtained from GetCheckpoint() of that stream.
+  // 'segment_encrypter' must continue the earlier stream, i.e. it must have
+  // the header in 'checkpoint' and support EncryptSegmentAt() or
+  // EncryptSegmentInPlace(). The bytes written to the returned stream are
+  // encrypted as the plaintext starting at checkpoint.plaintext_position,
+  // and their ciphertext is written to 'ciphertext_destination', which thus
+  // must continue the earlier ciphertext at checkpoint.ciphertext_position.
+  //
+  // The plaintext written to the returned stream must be identical to the
+  // plaintext written to the earlier stream after the checkpoint: since the
+  // segments are encrypted with the same nonces, encrypting a different
+  // plaintext reuses nonces, and breaks the security of both ciphertexts.
+  static crypto::tink::util::StatusOr<
+      std::unique_ptr<StreamingAeadEncryptingStream>>
+  NewResumed(std::unique_ptr<StreamSegmentEncrypter> segment_encrypter,
+             std::unique_ptr<crypto::tink::OutputStream> ciphertext_destination,
+             const Checkpoint& checkpoint);
+
+  // Returns the checkpoint after the last segment that was completely written
+  // to the ciphertext destination, not counting the last segment of the
+  // stream. Note that the destination may still buffer some of the written
+  // bytes, so the checkpoint should be used only once the destination has
+  // stored checkpoint.ciphertext_position bytes.
+  Checkpoint GetCheckpoint() const { return checkpoint_; }
+
+  // Waits for all segments which are still being encrypted.
+  ~StreamingAeadEncryptingStream() override;
+
   // -----------------------
   // Methods of OutputStream-interface implemented by this class.
   crypto::tink::util::StatusOr<int> Next(void** data) override;
@@ -48,7 +130,38 @@ class StreamingAeadEncryptingStream : public OutputStream {
   int64_t Position() const override;
 
  private:
+  // A segment that is encrypted by a task given to ParallelOptions::schedule.
+  struct SegmentJob {
+    std::vector<uint8_t> plaintext;
+    std::vector<uint8_t> ciphertext;
+    int plaintext_size;
+    bool is_last_segment;
+    crypto::tink::util::Status status;
+    absl::Mutex mutex;
+    bool done ABSL_GUARDED_BY(mutex) = false;
+  };
+
   StreamingAeadEncryptingStream() {}
+
+  // Encrypts the contents of '*plaintext' as the next segment and writes the
+  // ciphertext to ct_destination_. The segment is encrypted in place if
+  // segment_encrypter_ supports it, thus '*plaintext' may be overwritten.
+  // In parallel mode the encryption is scheduled instead, and '*plaintext'
+  // is left empty.
+  crypto::tink::util::Status EncryptAndWriteSegment(
+      std::vector<uint8_t>* plaintext, bool is_last_segment);
+
+  // Waits until the oldest segment in segments_in_flight_ is encrypted
+  // and writes its ciphertext to ct_destination_.
+  crypto::tink::util::Status WriteOldestSegment();
+
+  // Writes all segments in segments_in_flight_ to ct_destination_.
+  crypto::tink::util::Status WriteAllSegments();
+
+  // Updates checkpoint_ after a segment was written to ct_destination_.
+  void OnSegmentWritten(int plaintext_size, int ciphertext_size,
+                        bool is_last_segment);
+
   std::unique_ptr<StreamSegmentEncrypter> segment_encrypter_;
   std::unique_ptr<crypto::tink::OutputStream> ct_destination_;
   std::vector<uint8_t> pt_buffer_;  // plaintext buffer
@@ -67,6 +180,20 @@ class StreamingAeadEncryptingStream : public OutputStream {
   // header has been written to ct_destination_, nor the user had
   // a chance to write any data to this stream.
   bool is_first_segment_;
+
+  // The number of the segment which is encrypted next.
+  int64_t next_segment_number_ = 0;
+  // False if segment_encrypter_ does not support EncryptSegmentInPlace().
+  bool encrypts_in_place_ = true;
+  // The state after the segments written to ct_destination_ so far.
+  Checkpoint checkpoint_;
+
+  // State of the parallel mode, which is used iff schedule_ is non-null.
+  std::function<void(std::function<void()>)> schedule_;
+  int max_segments_in_flight_ = 0;
+  // Segments that were scheduled for encryption but not written yet,
+  // oldest first.
+  std::deque<std::shared_ptr<SegmentJob>> segments_in_flight_;
 };
 
 }  // namespace subtle
@@ -16,6 +16,7 @@
 
 #include "tink/subtle/streaming_aead_encrypting_stream.h"
 
+#include <functional>
 #include <sstream>
 #include <vector>
 
@@ -37,6 +38,7 @@ namespace subtle {
 
 using crypto::tink::OutputStream;
 using crypto::tink::subtle::test::DummyStreamSegmentEncrypter;
+using crypto::tink::subtle::test::TestThreadPool;
 using crypto::tink::util::OstreamOutputStream;
 
 namespace {
@@ -69,6 +71,42 @@ std::unique_ptr<OutputStream> GetEncryptingStream(
 }
 
 
+// Like GetEncryptingStream(), but returns a stream in parallel mode.
+std::unique_ptr<OutputStream> GetParallelEncryptingStream(
+    int pt_segment_size, int header_size, int ct_offset,
+    int max_segments_in_flight, TestThreadPool* pool, ValidationRefs* refs) {
+  auto ct_stream = absl::make_unique<std::stringstream>();
+  refs->ct_buf = ct_stream->rdbuf();
+  std::unique_ptr<OutputStream> ct_destination(
+      absl::make_unique<OstreamOutputStream>(std::move(ct_stream)));
+  auto seg_enc = absl::make_unique<DummyStreamSegmentEncrypter>(
+          pt_segment_size, header_size, ct_offset);
+  refs->seg_enc = seg_enc.get();
+  StreamingAeadEncryptingStream::ParallelOptions options;
+  options.schedule = [pool](std::function<void()> task) {
+    pool->Schedule(std::move(task));
+  };
+  options.max_segments_in_flight = max_segments_in_flight;
+  auto enc_stream = std::move(StreamingAeadEncryptingStream::NewParallel(
+      std::move(seg_enc), std::move(ct_destination), options).ValueOrDie());
+  EXPECT_EQ(0, enc_stream->Position());
+  return enc_stream;
+}
+
+// A segment encrypter which does not support EncryptSegmentAt().
+class SequentialOnlySegmentEncrypter : public DummyStreamSegmentEncrypter {
+ public:
+  using DummyStreamSegmentEncrypter::DummyStreamSegmentEncrypter;
+
+  util::Status EncryptSegmentAt(
+      const std::vector<uint8_t>& plaintext, int64_t segment_number,
+      bool is_last_segment,
+      std::vector<uint8_t>* ciphertext_buffer) const override {
+    return StreamSegmentEncrypter::EncryptSegmentAt(
+        plaintext, segment_number, is_last_segment, ciphertext_buffer);
+  }
+};
+
 class StreamingAeadEncryptingStreamTest : public ::testing::Test {
 };
 
@@ -562,6 +600,276 @@ TEST_F(StreamingAeadEncryptingStreamTest, BackupAndPosition) {
   EXPECT_EQ(util::error::FAILED_PRECONDITION, close_status.error_code());
 }
 
+TEST_F(StreamingAeadEncryptingStreamTest, ParallelWritingStreams) {
+  std::vector<int> pt_sizes = {0, 10, 1000, 100000};
+  std::vector<int> thread_counts = {1, 4};
+  std::vector<int> max_segments_in_flight_values = {1, 2, 16};
+  int pt_segment_size = 256;
+  int header_size = 32;
+  int ct_offset = 5;
+  for (auto pt_size : pt_sizes) {
+    for (auto thread_count : thread_counts) {
+      for (auto max_segments_in_flight : max_segments_in_flight_values) {
+        SCOPED_TRACE(absl::StrCat("pt_size = ", pt_size,
+                                  ", thread_count = ", thread_count,
+                                  ", max_segments_in_flight = ",
+                                  max_segments_in_flight));
+        TestThreadPool pool(thread_count);
+        ValidationRefs refs;
+        auto enc_stream = GetParallelEncryptingStream(
+            pt_segment_size, header_size, ct_offset, max_segments_in_flight,
+            &pool, &refs);
+
+        std::string pt = Random::GetRandomBytes(pt_size);
+        auto status = test::WriteToStream(enc_stream.get(), pt);
+        EXPECT_TRUE(status.ok()) << status;
+        EXPECT_EQ(enc_stream->Position(), pt.size());
+        // The output is identical to the one of a sequential stream.
+        EXPECT_EQ(refs.seg_enc->GenerateCiphertext(pt), refs.ct_buf->str());
+
+        status = enc_stream->Close();
+        EXPECT_EQ(util::error::FAILED_PRECONDITION, status.error_code());
+      }
+    }
+  }
+}
+
+TEST_F(StreamingAeadEncryptingStreamTest, ParallelDestroyedWithoutClose) {
+  TestThreadPool pool(4);
+  ValidationRefs refs;
+  auto enc_stream = GetParallelEncryptingStream(
+      /* pt_segment_size = */ 256, /* header_size = */ 32,
+      /* ct_offset = */ 0, /* max_segments_in_flight = */ 8, &pool, &refs);
+  void* buffer;
+  for (int i = 0; i < 10; i++) {
+    auto next_result = enc_stream->Next(&buffer);
+    EXPECT_TRUE(next_result.ok()) << next_result.status();
+  }
+  // Must wait for the segments which are still being encrypted.
+  enc_stream.reset();
+}
+
+TEST_F(StreamingAeadEncryptingStreamTest, ParallelInvalidOptions) {
+  auto GetStream = [](StreamingAeadEncryptingStream::ParallelOptions options) {
+    return StreamingAeadEncryptingStream::NewParallel(
+        absl::make_unique<DummyStreamSegmentEncrypter>(256, 32, 0),
+        absl::make_unique<OstreamOutputStream>(
+            absl::make_unique<std::stringstream>()),
+        std::move(options));
+  };
+  StreamingAeadEncryptingStream::ParallelOptions options;
+  EXPECT_EQ(util::error::INVALID_ARGUMENT,
+            GetStream(options).status().error_code());
+
+  options.schedule = [](std::function<void()> task) { task(); };
+  options.max_segments_in_flight = 0;
+  EXPECT_EQ(util::error::INVALID_ARGUMENT,
+            GetStream(options).status().error_code());
+
+  options.max_segments_in_flight = 1;
+  EXPECT_TRUE(GetStream(options).ok());
+}
+
+TEST_F(StreamingAeadEncryptingStreamTest, ParallelUnsupportedEncrypter) {
+  StreamingAeadEncryptingStream::ParallelOptions options;
+  options.schedule = [](std::function<void()> task) { task(); };
+  auto enc_stream = std::move(StreamingAeadEncryptingStream::NewParallel(
+      absl::make_unique<SequentialOnlySegmentEncrypter>(256, 32, 0),
+      absl::make_unique<OstreamOutputStream>(
+          absl::make_unique<std::stringstream>()),
+      options).ValueOrDie());
+  auto status = test::WriteToStream(enc_stream.get(),
+                                    Random::GetRandomBytes(1000));
+  EXPECT_EQ(util::error::UNIMPLEMENTED, status.error_code());
+}
+
+// Returns a ciphertext destination that writes to a new buffer, and sets
+// '*ct_buf' to that buffer.
+std::unique_ptr<OutputStream> GetCiphertextDestination(
+    std::stringbuf** ct_buf) {
+  auto ct_stream = absl::make_unique<std::stringstream>();
+  *ct_buf = ct_stream->rdbuf();
+  return absl::make_unique<OstreamOutputStream>(std::move(ct_stream));
+}
+
+TEST_F(StreamingAeadEncryptingStreamTest, ResumeFromCheckpoint) {
+  int pt_segment_size = 256;
+  int header_size = 32;
+  int ct_offset = 5;
+  for (int pt_size : {0, 100, 1000, 10000}) {
+    for (int interrupted_at : {0, 200, 219, 220, 500, 1000, 5000}) {
+      if (interrupted_at > pt_size) continue;
+      SCOPED_TRACE(absl::StrCat("pt_size = ", pt_size,
+                                ", interrupted_at = ", interrupted_at));
+      std::string pt = Random::GetRandomBytes(pt_size);
+      ValidationRefs refs;
+      auto enc_stream = GetEncryptingStream(pt_segment_size, header_size,
+                                            ct_offset, &refs);
+      auto status = test::WriteToStream(
+          enc_stream.get(), pt.substr(0, interrupted_at), false);
+      EXPECT_TRUE(status.ok()) << status;
+      auto checkpoint_result = StreamingAeadEncryptingStream::Checkpoint::Parse(
+          static_cast<StreamingAeadEncryptingStream*>(enc_stream.get())
+              ->GetCheckpoint()
+              .Serialize());
+      ASSERT_TRUE(checkpoint_result.ok()) << checkpoint_result.status();
+      auto checkpoint = checkpoint_result.ValueOrDie();
+      EXPECT_LE(checkpoint.plaintext_position, interrupted_at);
+      status = test::WriteToStream(enc_stream.get(),
+                                   pt.substr(interrupted_at));
+      EXPECT_TRUE(status.ok()) << status;
+      std::string ct = refs.ct_buf->str();
+      EXPECT_EQ(refs.seg_enc->GenerateCiphertext(pt), ct);
+
+      // Resume the encryption with the same plaintext.
+      std::stringbuf* resumed_ct_buf;
+      auto resumed_result = StreamingAeadEncryptingStream::NewResumed(
+          absl::make_unique<DummyStreamSegmentEncrypter>(
+              pt_segment_size, header_size, ct_offset),
+          GetCiphertextDestination(&resumed_ct_buf), checkpoint);
+      ASSERT_TRUE(resumed_result.ok()) << resumed_result.status();
+      auto resumed_stream = std::move(resumed_result.ValueOrDie());
+      EXPECT_EQ(checkpoint.plaintext_position, resumed_stream->Position());
+      status = test::WriteToStream(resumed_stream.get(),
+                                   pt.substr(checkpoint.plaintext_position));
+      EXPECT_TRUE(status.ok()) << status;
+      EXPECT_EQ(pt.size(), resumed_stream->Position());
+      EXPECT_EQ(ct, ct.substr(0, checkpoint.ciphertext_position) +
+                        resumed_ct_buf->str());
+    }
+  }
+}
+
+TEST_F(StreamingAeadEncryptingStreamTest, CheckpointCountsWrittenSegments) {
+  int pt_segment_size = 256;
+  int header_size = 32;
+  int ct_offset = 0;
+  int first_segment_size = pt_segment_size - header_size;
+  ValidationRefs refs;
+  auto enc_stream = GetEncryptingStream(pt_segment_size, header_size,
+                                        ct_offset, &refs);
+  auto GetCheckpoint = [&enc_stream]() {
+    return static_cast<StreamingAeadEncryptingStream*>(enc_stream.get())
+        ->GetCheckpoint();
+  };
+  std::string header(header_size, 'h');
+  EXPECT_EQ(header, GetCheckpoint().header);
+  EXPECT_EQ(0, GetCheckpoint().segment_count);
+
+  // A segment is written only when the buffer after it is requested.
+  std::string pt = Random::GetRandomBytes(3 * pt_segment_size);
+  auto status = test::WriteToStream(
+      enc_stream.get(), pt.substr(0, first_segment_size + 1), false);
+  EXPECT_TRUE(status.ok()) << status;
+  EXPECT_EQ(0, GetCheckpoint().segment_count);
+  status = test::WriteToStream(
+      enc_stream.get(), pt.substr(first_segment_size + 1, pt_segment_size),
+      false);
+  EXPECT_TRUE(status.ok()) << status;
+  auto checkpoint = GetCheckpoint();
+  EXPECT_EQ(1, checkpoint.segment_count);
+  EXPECT_EQ(first_segment_size, checkpoint.plaintext_position);
+  EXPECT_EQ(pt_segment_size + DummyStreamSegmentEncrypter::kSegmentTagSize,
+            checkpoint.ciphertext_position);
+
+  // The last segment is not counted.
+  status = enc_stream->Close();
+  EXPECT_TRUE(status.ok()) << status;
+  EXPECT_EQ(2, GetCheckpoint().segment_count);
+}
+
+TEST_F(StreamingAeadEncryptingStreamTest, ParallelCheckpoint) {
+  TestThreadPool pool(4);
+  ValidationRefs refs;
+  auto enc_stream = GetParallelEncryptingStream(
+      /* pt_segment_size = */ 256, /* header_size = */ 32,
+      /* ct_offset = */ 0, /* max_segments_in_flight = */ 4, &pool, &refs);
+  std::string pt = Random::GetRandomBytes(10000);
+  auto status = test::WriteToStream(enc_stream.get(), pt, false);
+  EXPECT_TRUE(status.ok()) << status;
+  auto checkpoint = static_cast<StreamingAeadEncryptingStream*>(
+      enc_stream.get())->GetCheckpoint();
+  // At most max_segments_in_flight segments are not written yet.
+  EXPECT_LE(10000 - checkpoint.plaintext_position, 6 * 256);
+  status = enc_stream->Close();
+  EXPECT_TRUE(status.ok()) << status;
+  std::string ct = refs.ct_buf->str();
+
+  std::stringbuf* resumed_ct_buf;
+  auto resumed_stream = std::move(StreamingAeadEncryptingStream::NewResumed(
+      absl::make_unique<DummyStreamSegmentEncrypter>(256, 32, 0),
+      GetCiphertextDestination(&resumed_ct_buf), checkpoint).ValueOrDie());
+  status = test::WriteToStream(resumed_stream.get(),
+                               pt.substr(checkpoint.plaintext_position));
+  EXPECT_TRUE(status.ok()) << status;
+  EXPECT_EQ(ct, ct.substr(0, checkpoint.ciphertext_position) +
+                    resumed_ct_buf->str());
+}
+
+TEST_F(StreamingAeadEncryptingStreamTest, ResumeWithInvalidCheckpoint) {
+  auto Resume = [](const StreamingAeadEncryptingStream::Checkpoint& checkpoint) {
+    return StreamingAeadEncryptingStream::NewResumed(
+        absl::make_unique<DummyStreamSegmentEncrypter>(256, 32, 0),
+        absl::make_unique<OstreamOutputStream>(
+            absl::make_unique<std::stringstream>()),
+        checkpoint);
+  };
+  StreamingAeadEncryptingStream::Checkpoint checkpoint;
+  checkpoint.header = std::string(32, 'h');
+  checkpoint.segment_count = 2;
+  checkpoint.plaintext_position = 2 * 256 - 32;
+  checkpoint.ciphertext_position =
+      2 * (256 + DummyStreamSegmentEncrypter::kSegmentTagSize);
+  EXPECT_TRUE(Resume(checkpoint).ok());
+
+  auto wrong_checkpoint = checkpoint;
+  wrong_checkpoint.header = std::string(32, 'x');
+  EXPECT_EQ(util::error::INVALID_ARGUMENT,
+            Resume(wrong_checkpoint).status().error_code());
+  wrong_checkpoint = checkpoint;
+  wrong_checkpoint.plaintext_position++;
+  EXPECT_EQ(util::error::INVALID_ARGUMENT,
+            Resume(wrong_checkpoint).status().error_code());
+  wrong_checkpoint = checkpoint;
+  wrong_checkpoint.ciphertext_position--;
+  EXPECT_EQ(util::error::INVALID_ARGUMENT,
+            Resume(wrong_checkpoint).status().error_code());
+  wrong_checkpoint = checkpoint;
+  wrong_checkpoint.segment_count = -1;
+  EXPECT_EQ(util::error::INVALID_ARGUMENT,
+            Resume(wrong_checkpoint).status().error_code());
+
+  std::string serialized = checkpoint.Serialize();
+  EXPECT_TRUE(
+      StreamingAeadEncryptingStream::Checkpoint::Parse(serialized).ok());
+  for (int size : {0, 1, 25}) {
+    EXPECT_EQ(util::error::INVALID_ARGUMENT,
+              StreamingAeadEncryptingStream::Checkpoint::Parse(
+                  serialized.substr(0, size)).status().error_code());
+  }
+  serialized[0] = 2;
+  EXPECT_EQ(util::error::INVALID_ARGUMENT,
+            StreamingAeadEncryptingStream::Checkpoint::Parse(serialized)
+                .status().error_code());
+}
+
+TEST_F(StreamingAeadEncryptingStreamTest, ResumeUnsupportedEncrypter) {
+  StreamingAeadEncryptingStream::Checkpoint checkpoint;
+  checkpoint.header = std::string(32, 'h');
+  checkpoint.segment_count = 1;
+  checkpoint.plaintext_position = 256 - 32;
+  checkpoint.ciphertext_position =
+      256 + DummyStreamSegmentEncrypter::kSegmentTagSize;
+  auto enc_stream = std::move(StreamingAeadEncryptingStream::NewResumed(
+      absl::make_unique<SequentialOnlySegmentEncrypter>(256, 32, 0),
+      absl::make_unique<OstreamOutputStream>(
+          absl::make_unique<std::stringstream>()),
+      checkpoint).ValueOrDie());
+  auto status = test::WriteToStream(enc_stream.get(),
+                                    Random::GetRandomBytes(1000));
+  EXPECT_EQ(util::error::UNIMPLEMENTED, status.error_code());
+}
+
 }  // namespace
 }  // namespace subtle
 }  // namespace tink
@@ -14,35 +14,86 @@
 
 #include "tink/subtle/streaming_mac_impl.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
 #include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "openssl/crypto.h"
+#include "openssl/mem.h"
 #include "tink/util/status.h"
 
 namespace crypto {
 namespace tink {
 namespace subtle {
 
+constexpr int StreamingMacImpl::kDefaultBufferSize;
+
 namespace {
-constexpr size_t kBufferSize = 4096;
-}
 
-class ComputeMacOutputStream : public OutputStreamWithResult<std::string> {
+// The state shared by the compute and verify streams: the buffer handed out
+// by NextBuffer(), whose contents are passed to the StatefulMac in one
+// Update() call each time it is handed out again.
+class MacStreamBuffer {
  public:
-  explicit ComputeMacOutputStream(std::unique_ptr<StatefulMac> mac)
+  MacStreamBuffer(std::unique_ptr<StatefulMac> mac, int buffer_size)
       : status_(util::OkStatus()),
         mac_(std::move(mac)),
         position_(0),
         buffer_position_(0),
-        buffer_("") {
-    buffer_.resize(kBufferSize);
+        buffer_(buffer_size, 0) {}
+
+  // Clears the buffer, so that the data written to the stream cannot be
+  // accessed later.
+  ~MacStreamBuffer() { OPENSSL_cleanse(&buffer_[0], buffer_.size()); }
+
+  util::StatusOr<int> NextBuffer(void** buffer) {
+    if (!status_.ok()) {
+      return status_;
+    }
+    WriteIntoMac();
+    if (!status_.ok()) {
+      return status_;
+    }
+    *buffer = &buffer_[0];
+    position_ += buffer_.size();
+    buffer_position_ = buffer_.size();
+    return buffer_position_;
   }
 
-  util::StatusOr<int> NextBuffer(void** buffer) override;
-  util::StatusOr<std::string> CloseStreamAndComputeResult() override;
-  void BackUp(int count) override;
-  int64_t Position() const override { return position_; }
+  void BackUp(int count) {
+    count = std::min(count, buffer_position_);
+    buffer_position_ -= count;
+    position_ -= count;
+  }
+
+  int64_t Position() const { return position_; }
+
+  // Closes the stream and returns the MAC of the data written to it.
+  util::StatusOr<std::string> Finalize() {
+    if (!status_.ok()) {
+      return status_;
+    }
+    WriteIntoMac();
+    if (!status_.ok()) {
+      return status_;
+    }
+    status_ = util::Status(util::error::FAILED_PRECONDITION, "Stream Closed");
+    return mac_->Finalize();
+  }
 
  private:
-  void WriteIntoMac();
+  // Writes the data in buffer_ into mac_. The data is overwritten by the
+  // next user of the buffer, and wiped when the stream is destroyed.
+  void WriteIntoMac() {
+    if (buffer_position_ == 0) return;
+    // Remove the suffix of the buffer (all data after buffer_position_).
+    status_ = mac_->Update(absl::string_view(buffer_.data(), buffer_position_));
+    buffer_position_ = 0;
+  }
 
   util::Status status_;
   const std::unique_ptr<StatefulMac> mac_;
@@ -51,134 +102,70 @@ class ComputeMacOutputStream : public OutputStreamWithResult<std::string> {
   std::string buffer_;
 };
 
-util::StatusOr<std::unique_ptr<OutputStreamWithResult<std::string>>>
-StreamingMacImpl::NewComputeMacOutputStream() const {
-  util::StatusOr<std::unique_ptr<StatefulMac>> mac_status =
-      mac_factory_->Create();
-
-  if (!mac_status.ok()) {
-    return mac_status.status();
-  }
-
-  std::unique_ptr<OutputStreamWithResult<std::string>> string_to_return =
-      absl::make_unique<ComputeMacOutputStream>(
-          std::move(mac_status.ValueOrDie()));
-  return string_to_return;
-}
+class ComputeMacOutputStream : public OutputStreamWithResult<std::string> {
+ public:
+  ComputeMacOutputStream(std::unique_ptr<StatefulMac> mac, int buffer_size)
+      : buffer_(std::move(mac), buffer_size) {}
 
-util::StatusOr<int> ComputeMacOutputStream::NextBuffer(void** buffer) {
-  if (!status_.ok()) {
-    return status_;
+  util::StatusOr<int> NextBuffer(void** buffer) override {
+    return buffer_.NextBuffer(buffer);
   }
-  WriteIntoMac();
-  *buffer = &buffer_[0];
-  position_ += kBufferSize;
-  buffer_position_ = kBufferSize;
-  return buffer_position_;
-}
-
-util::StatusOr<std::string>
-ComputeMacOutputStream::CloseStreamAndComputeResult() {
-  if (!status_.ok()) {
-    return status_;
+  util::StatusOr<std::string> CloseStreamAndComputeResult() override {
+    return buffer_.Finalize();
   }
-  WriteIntoMac();
-  status_ = util::Status(util::error::FAILED_PRECONDITION, "Stream Closed");
-  return mac_->Finalize();
-}
-
-void ComputeMacOutputStream::BackUp(int count) {
-  count = std::min(count, buffer_position_);
-  buffer_position_ -= count;
-  position_ -= count;
-}
+  void BackUp(int count) override { buffer_.BackUp(count); }
+  int64_t Position() const override { return buffer_.Position(); }
 
-// Writes the data in buffer_ into mac_, and clears buffer_.
-void ComputeMacOutputStream::WriteIntoMac() {
-  // Remove the suffix of the buffer (all data after buffer_position_).
-  status_ = mac_->Update(absl::string_view(buffer_.data(), buffer_position_));
-
-  // Clear the buffer, so that any sensitive information that
-  // was written to the buffer cannot be accessed later.
-  // Write buffer_position_ number of 0's to the buffer, starting from idx 0.
-  buffer_.replace(0, buffer_position_, buffer_position_, 0);
-}
+ private:
+  MacStreamBuffer buffer_;
+};
 
 class VerifyMacOutputStream : public OutputStreamWithResult<util::Status> {
  public:
   VerifyMacOutputStream(const std::string& expected,
-                        std::unique_ptr<StatefulMac> mac)
-      : status_(util::OkStatus()),
-        mac_(std::move(mac)),
-        position_(0),
-        buffer_position_(0),
-        buffer_(""),
-        expected_(expected) {
-    buffer_.resize(kBufferSize);
-  }
-
-  util::StatusOr<int> NextBuffer(void** buffer) override;
+                        std::unique_ptr<StatefulMac> mac, int buffer_size)
+      : buffer_(std::move(mac), buffer_size), expected_(expected) {}
 
+  util::StatusOr<int> NextBuffer(void** buffer) override {
+    return buffer_.NextBuffer(buffer);
+  }
   util::Status CloseStreamAndComputeResult() override;
-
-  void BackUp(int count) override;
-  int64_t Position() const override { return position_; }
+  void BackUp(int count) override { buffer_.BackUp(count); }
+  int64_t Position() const override { return buffer_.Position(); }
 
  private:
-  void WriteIntoMac();
-
-  // Stream status: Initialized as OK, and
-  // changed to ERROR:FAILED_PRECONDITION when the stream is closed.
-  util::Status status_;
-  std::unique_ptr<StatefulMac> mac_;
-  int64_t position_;
-  int buffer_position_;
-  std::string buffer_;
+  MacStreamBuffer buffer_;
   std::string expected_;
 };
 
-util::StatusOr<int> VerifyMacOutputStream::NextBuffer(void** buffer) {
-  if (!status_.ok()) {
-    return status_;
-  }
-  WriteIntoMac();
-  *buffer = &buffer_[0];
-  position_ += kBufferSize;
-  buffer_position_ = kBufferSize;
-  return buffer_position_;
-}
-
 util::Status VerifyMacOutputStream::CloseStreamAndComputeResult() {
-  if (!status_.ok()) {
-    return status_;
-  }
-  WriteIntoMac();
-  status_ = util::Status(util::error::FAILED_PRECONDITION, "Stream Closed");
-  util::StatusOr<std::string> mac_actual = mac_->Finalize();
+  util::StatusOr<std::string> mac_actual = buffer_.Finalize();
   if (!mac_actual.ok()) {
     return mac_actual.status();
   }
-  if (mac_actual.ValueOrDie() == expected_) {
+  const std::string& actual = mac_actual.ValueOrDie();
+  if (actual.size() == expected_.size() &&
+      CRYPTO_memcmp(actual.data(), expected_.data(), actual.size()) == 0) {
     return util::OkStatus();
   }
   return util::Status(util::error::INVALID_ARGUMENT, "Incorrect MAC");
 }
 
-void VerifyMacOutputStream::BackUp(int count) {
-  count = std::min(count, buffer_position_);
-  buffer_position_ -= count;
-  position_ -= count;
-}
+}  // namespace
 
-// Writes the data in buffer_ into mac_, and clears buffer_.
-void VerifyMacOutputStream::WriteIntoMac() {
-  // Remove the suffix of the buffer (all data after buffer_position_).
-  status_ = mac_->Update(absl::string_view(buffer_.data(), buffer_position_));
+util::StatusOr<std::unique_ptr<OutputStreamWithResult<std::string>>>
+StreamingMacImpl::NewComputeMacOutputStream() const {
+  util::StatusOr<std::unique_ptr<StatefulMac>> mac_status =
+      mac_factory_->Create();
 
-  // Clear the buffer, so that any sensitive information that
-  // was written to the buffer cannot be accessed later.
-  // Write buffer_position_ number of 0's to the buffer, starting from idx 0.
-  buffer_.replace(0, buffer_position_, buffer_position_, 0);
+  if (!mac_status.ok()) {
+    return mac_status.status();
+  }
+
+  std::unique_ptr<OutputStreamWithResult<std::string>> string_to_return =
+      absl::make_unique<ComputeMacOutputStream>(
+          std::move(mac_status.ValueOrDie()), buffer_size_);
+  return string_to_return;
 }
 
 util::StatusOr<std::unique_ptr<OutputStreamWithResult<util::Status>>>
@@ -190,8 +177,9 @@ StreamingMacImpl::NewVerifyMacOutputStream(const std::string& mac_value) const {
   }
   return std::unique_ptr<OutputStreamWithResult<util::Status>>(
       absl::make_unique<VerifyMacOutputStream>(
-          mac_value, std::move(mac_status.ValueOrDie())));
+          mac_value, std::move(mac_status.ValueOrDie()), buffer_size_));
 }
+
 }  // namespace subtle
 }  // namespace tink
 }  // namespace crypto
@@ -121,6 +121,27 @@ TEST(StreamingMacImplTest, ComputeRandMac) {
   }
 }
 
+TEST(StreamingMacImplTest, ComputeWithLargeBuffer) {
+  const int kBufferSize = 1 << 20;
+  auto streaming_mac = absl::make_unique<StreamingMacImpl>(
+      absl::make_unique<DummyStatefulMacFactory>(), kBufferSize);
+  auto output_stream =
+      std::move(streaming_mac->NewComputeMacOutputStream().ValueOrDie());
+  void* buffer;
+  auto next_result = output_stream->Next(&buffer);
+  ASSERT_THAT(next_result.status(), IsOk());
+  EXPECT_EQ(next_result.ValueOrDie(), kBufferSize);
+  output_stream->BackUp(kBufferSize);
+
+  std::string text = Random::GetRandomBytes(3 * kBufferSize + 5);
+  EXPECT_THAT(test::WriteToStream(output_stream.get(), text, false), IsOk());
+  auto close_status = output_stream->CloseAndGetResult();
+  EXPECT_THAT(close_status.status(), IsOk());
+  EXPECT_EQ(close_status.ValueOrDie(),
+            "23:" + std::to_string(text.size()) + ":DummyMac:streaming mac:" +
+                text);
+}
+
 TEST(StreamingMacImplTest, ComputeCheckStreamPosition) {
   std::string text = "I am a small message";
   auto output_stream = GetComputeMacOutputStream();
@@ -17,11 +17,16 @@
 #include "tink/subtle/subtle_util_boringssl.h"
 
 #include <algorithm>
+#include <atomic>
 #include <iterator>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
 
+#include "absl/base/thread_annotations.h"
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/substitute.h"
+#include "absl/synchronization/mutex.h"
 #include "openssl/bn.h"
 #include "openssl/cipher.h"
 #include "openssl/curve25519.h"
@@ -52,6 +57,25 @@ size_t FieldElementSizeInBytes(const EC_GROUP *group) {
   return (degree_bits + 7) / 8;
 }
 
+// The field size of NIST P-521, the largest curve supported.
+constexpr size_t kMaxEcFieldSizeInBytes = 66;
+
+// Writes to 'out' the DER encoding of the non-negative INTEGER with the
+// big-endian bytes 'value', of at most kMaxEcFieldSizeInBytes bytes, and
+// returns the end of the encoding.
+uint8_t *AppendDerInteger(absl::string_view value, uint8_t *out) {
+  while (!value.empty() && value[0] == 0) value.remove_prefix(1);
+  // Zero is encoded as a single zero byte, and a leading zero byte keeps
+  // integers with the top bit set positive.
+  bool has_leading_zero =
+      value.empty() || (static_cast<uint8_t>(value[0]) & 0x80) != 0;
+  *out++ = 0x02;
+  *out++ = static_cast<uint8_t>(value.size() + (has_leading_zero ? 1 : 0));
+  if (has_leading_zero) *out++ = 0;
+  std::copy(value.begin(), value.end(), out);
+  return out + value.size();
+}
+
 }  // namespace
 
 // static
@@ -107,6 +131,38 @@ util::StatusOr<EC_GROUP *> SubtleUtilBoringSSL::GetEcGroup(
   }
 }
 
+// static
+util::StatusOr<const EC_GROUP *> SubtleUtilBoringSSL::GetStaticEcGroup(
+    EllipticCurveType curve_type) {
+  const EC_GROUP *group;
+  switch (curve_type) {
+    case EllipticCurveType::NIST_P256: {
+      static const EC_GROUP *p256 =
+          EC_GROUP_new_by_curve_name(NID_X9_62_prime256v1);
+      group = p256;
+      break;
+    }
+    case EllipticCurveType::NIST_P384: {
+      static const EC_GROUP *p384 = EC_GROUP_new_by_curve_name(NID_secp384r1);
+      group = p384;
+      break;
+    }
+    case EllipticCurveType::NIST_P521: {
+      static const EC_GROUP *p521 = EC_GROUP_new_by_curve_name(NID_secp521r1);
+      group = p521;
+      break;
+    }
+    default:
+      return util::Status(util::error::UNIMPLEMENTED,
+                          "Unsupported elliptic curve");
+  }
+  if (group == nullptr) {
+    return util::Status(util::error::INTERNAL,
+                        "EC_GROUP_new_by_curve_name failed");
+  }
+  return group;
+}
+
 // static
 util::StatusOr<EC_POINT *> SubtleUtilBoringSSL::GetEcPoint(
     EllipticCurveType curve, absl::string_view pubx, absl::string_view puby) {
@@ -119,14 +175,14 @@ util::StatusOr<EC_POINT *> SubtleUtilBoringSSL::GetEcPoint(
   if (bn_x.get() == nullptr || bn_y.get() == nullptr) {
     return util::Status(util::error::INTERNAL, "BN_bin2bn failed");
   }
-  auto status_or_ec_group = SubtleUtilBoringSSL::GetEcGroup(curve);
+  auto status_or_ec_group = SubtleUtilBoringSSL::GetStaticEcGroup(curve);
   if (!status_or_ec_group.ok()) {
     return status_or_ec_group.status();
   }
-  bssl::UniquePtr<EC_GROUP> group(status_or_ec_group.ValueOrDie());
-  bssl::UniquePtr<EC_POINT> pub_key(EC_POINT_new(group.get()));
+  const EC_GROUP *group = status_or_ec_group.ValueOrDie();
+  bssl::UniquePtr<EC_POINT> pub_key(EC_POINT_new(group));
   if (1 != EC_POINT_set_affine_coordinates_GFp(
-               group.get(), pub_key.get(), bn_x.get(), bn_y.get(), nullptr)) {
+               group, pub_key.get(), bn_x.get(), bn_y.get(), nullptr)) {
     return util::Status(util::error::INTERNAL,
                         "EC_POINT_set_affine_coordinates_GFp failed");
   }
@@ -140,17 +196,17 @@ util::StatusOr<SubtleUtilBoringSSL::EcKey> SubtleUtilBoringSSL::GetNewEcKey(
     auto key = GenerateNewX25519Key();
     return EcKeyFromX25519Key(key.get());
   }
-  auto status_or_group(SubtleUtilBoringSSL::GetEcGroup(curve_type));
+  auto status_or_group(SubtleUtilBoringSSL::GetStaticEcGroup(curve_type));
   if (!status_or_group.ok()) return status_or_group.status();
-  bssl::UniquePtr<EC_GROUP> group(status_or_group.ValueOrDie());
+  const EC_GROUP *group = status_or_group.ValueOrDie();
   bssl::UniquePtr<EC_KEY> key(EC_KEY_new());
-  EC_KEY_set_group(key.get(), group.get());
+  EC_KEY_set_group(key.get(), group);
   EC_KEY_generate_key(key.get());
   const BIGNUM *priv_key = EC_KEY_get0_private_key(key.get());
   const EC_POINT *pub_key = EC_KEY_get0_public_key(key.get());
   bssl::UniquePtr<BIGNUM> pub_key_x_bn(BN_new());
   bssl::UniquePtr<BIGNUM> pub_key_y_bn(BN_new());
-  if (!EC_POINT_get_affine_coordinates_GFp(group.get(), pub_key,
+  if (!EC_POINT_get_affine_coordinates_GFp(group, pub_key,
                                            pub_key_x_bn.get(),
                                            pub_key_y_bn.get(), nullptr)) {
     return util::Status(util::error::INTERNAL,
@@ -159,19 +215,19 @@ util::StatusOr<SubtleUtilBoringSSL::EcKey> SubtleUtilBoringSSL::GetNewEcKey(
   EcKey ec_key;
   ec_key.curve = curve_type;
   auto pub_x_str =
-      bn2str(pub_key_x_bn.get(), FieldElementSizeInBytes(group.get()));
+      bn2str(pub_key_x_bn.get(), FieldElementSizeInBytes(group));
   if (!pub_x_str.ok()) {
     return pub_x_str.status();
   }
   ec_key.pub_x = pub_x_str.ValueOrDie();
   auto pub_y_str =
-      bn2str(pub_key_y_bn.get(), FieldElementSizeInBytes(group.get()));
+      bn2str(pub_key_y_bn.get(), FieldElementSizeInBytes(group));
   if (!pub_y_str.ok()) {
     return pub_y_str.status();
   }
   ec_key.pub_y = pub_y_str.ValueOrDie();
   auto priv_key_or =
-      BignumToSecretData(priv_key, ScalarSizeInBytes(group.get()));
+      BignumToSecretData(priv_key, ScalarSizeInBytes(group));
   if (!priv_key_or.ok()) {
     return priv_key_or.status();
   }
@@ -263,50 +319,50 @@ util::StatusOr<const EVP_MD *> SubtleUtilBoringSSL::EvpHash(
 // static
 util::StatusOr<util::SecretData> SubtleUtilBoringSSL::ComputeEcdhSharedSecret(
     EllipticCurveType curve, const BIGNUM *priv_key, const EC_POINT *pub_key) {
-  auto status_or_ec_group = SubtleUtilBoringSSL::GetEcGroup(curve);
+  auto status_or_ec_group = SubtleUtilBoringSSL::GetStaticEcGroup(curve);
   if (!status_or_ec_group.ok()) {
     return status_or_ec_group.status();
   }
-  bssl::UniquePtr<EC_GROUP> priv_group(status_or_ec_group.ValueOrDie());
-  bssl::UniquePtr<EC_POINT> shared_point(EC_POINT_new(priv_group.get()));
+  const EC_GROUP *priv_group = status_or_ec_group.ValueOrDie();
+  bssl::UniquePtr<EC_POINT> shared_point(EC_POINT_new(priv_group));
   // BoringSSL's EC_POINT_set_affine_coordinates_GFp documentation says that
   // "unlike with OpenSSL, it's considered an error if the point is not on the
   // curve". To be sure, we double check here.
-  if (1 != EC_POINT_is_on_curve(priv_group.get(), pub_key, nullptr)) {
+  if (1 != EC_POINT_is_on_curve(priv_group, pub_key, nullptr)) {
     return util::Status(util::error::INTERNAL, "Point is not on curve");
   }
   // Compute the shared point.
-  if (1 != EC_POINT_mul(priv_group.get(), shared_point.get(), nullptr, pub_key,
+  if (1 != EC_POINT_mul(priv_group, shared_point.get(), nullptr, pub_key,
                         priv_key, nullptr)) {
     return util::Status(util::error::INTERNAL, "Point multiplication failed");
   }
   // Check for buggy computation.
   if (1 !=
-      EC_POINT_is_on_curve(priv_group.get(), shared_point.get(), nullptr)) {
+      EC_POINT_is_on_curve(priv_group, shared_point.get(), nullptr)) {
     return util::Status(util::error::INTERNAL, "Shared point is not on curve");
   }
   // Get shared point's x coordinate.
   bssl::UniquePtr<BIGNUM> shared_x(BN_new());
   if (1 !=
-      EC_POINT_get_affine_coordinates_GFp(priv_group.get(), shared_point.get(),
+      EC_POINT_get_affine_coordinates_GFp(priv_group, shared_point.get(),
                                           shared_x.get(), nullptr, nullptr)) {
     return util::Status(util::error::INTERNAL,
                         "EC_POINT_get_affine_coordinates_GFp failed");
   }
   return BignumToSecretData(shared_x.get(),
-                            FieldElementSizeInBytes(priv_group.get()));
+                            FieldElementSizeInBytes(priv_group));
 }
 
 // static
 util::StatusOr<bssl::UniquePtr<EC_POINT>> SubtleUtilBoringSSL::EcPointDecode(
     EllipticCurveType curve, EcPointFormat format, absl::string_view encoded) {
-  auto status_or_ec_group = GetEcGroup(curve);
+  auto status_or_ec_group = GetStaticEcGroup(curve);
   if (!status_or_ec_group.ok()) {
     return status_or_ec_group.status();
   }
-  bssl::UniquePtr<EC_GROUP> group(status_or_ec_group.ValueOrDie());
-  bssl::UniquePtr<EC_POINT> point(EC_POINT_new(group.get()));
-  unsigned curve_size_in_bytes = (EC_GROUP_get_degree(group.get()) + 7) / 8;
+  const EC_GROUP *group = status_or_ec_group.ValueOrDie();
+  bssl::UniquePtr<EC_POINT> point(EC_POINT_new(group));
+  unsigned curve_size_in_bytes = (EC_GROUP_get_degree(group) + 7) / 8;
   switch (format) {
     case EcPointFormat::UNCOMPRESSED: {
       if (static_cast<int>(encoded[0]) != 0x04) {
@@ -321,7 +377,7 @@ util::StatusOr<bssl::UniquePtr<EC_POINT>> SubtleUtilBoringSSL::EcPointDecode(
                              encoded.size(), 1 + 2 * curve_size_in_bytes));
       }
       if (1 !=
-          EC_POINT_oct2point(group.get(), point.get(),
+          EC_POINT_oct2point(group, point.get(),
                              reinterpret_cast<const uint8_t *>(encoded.data()),
                              encoded.size(), nullptr)) {
         return util::Status(util::error::INTERNAL, "EC_POINT_toc2point failed");
@@ -354,7 +410,7 @@ util::StatusOr<bssl::UniquePtr<EC_POINT>> SubtleUtilBoringSSL::EcPointDecode(
         return util::Status(util::error::INTERNAL,
                             "Openssl internal error extracting y coordinate");
       }
-      if (1 != EC_POINT_set_affine_coordinates_GFp(group.get(), point.get(),
+      if (1 != EC_POINT_set_affine_coordinates_GFp(group, point.get(),
                                                    x.get(), y.get(), nullptr)) {
         return util::Status(util::error::INTERNAL,
                             "Openssl internal error setting coordinates");
@@ -369,7 +425,7 @@ util::StatusOr<bssl::UniquePtr<EC_POINT>> SubtleUtilBoringSSL::EcPointDecode(
                             "0x03, but input doesn't");
       }
       if (1 !=
-          EC_POINT_oct2point(group.get(), point.get(),
+          EC_POINT_oct2point(group, point.get(),
                              reinterpret_cast<const uint8_t *>(encoded.data()),
                              encoded.size(), nullptr)) {
         return util::Status(util::error::INTERNAL, "EC_POINT_oct2point failed");
@@ -379,7 +435,7 @@ util::StatusOr<bssl::UniquePtr<EC_POINT>> SubtleUtilBoringSSL::EcPointDecode(
     default:
       return util::Status(util::error::INTERNAL, "Unsupported format");
   }
-  if (1 != EC_POINT_is_on_curve(group.get(), point.get(), nullptr)) {
+  if (1 != EC_POINT_is_on_curve(group, point.get(), nullptr)) {
     return util::Status(util::error::INTERNAL, "Point is not on curve");
   }
   return {std::move(point)};
@@ -388,13 +444,13 @@ util::StatusOr<bssl::UniquePtr<EC_POINT>> SubtleUtilBoringSSL::EcPointDecode(
 // static
 util::StatusOr<std::string> SubtleUtilBoringSSL::EcPointEncode(
     EllipticCurveType curve, EcPointFormat format, const EC_POINT *point) {
-  auto status_or_ec_group = GetEcGroup(curve);
+  auto status_or_ec_group = GetStaticEcGroup(curve);
   if (!status_or_ec_group.ok()) {
     return status_or_ec_group.status();
   }
-  bssl::UniquePtr<EC_GROUP> group(status_or_ec_group.ValueOrDie());
-  unsigned curve_size_in_bytes = (EC_GROUP_get_degree(group.get()) + 7) / 8;
-  if (1 != EC_POINT_is_on_curve(group.get(), point, nullptr)) {
+  const EC_GROUP *group = status_or_ec_group.ValueOrDie();
+  unsigned curve_size_in_bytes = (EC_GROUP_get_degree(group) + 7) / 8;
+  if (1 != EC_POINT_is_on_curve(group, point, nullptr)) {
     return util::Status(util::error::INTERNAL, "Point is not on curve");
   }
   switch (format) {
@@ -402,7 +458,7 @@ util::StatusOr<std::string> SubtleUtilBoringSSL::EcPointEncode(
       std::unique_ptr<uint8_t[]> encoded(
           new uint8_t[1 + 2 * curve_size_in_bytes]);
       size_t size = EC_POINT_point2oct(
-          group.get(), point, POINT_CONVERSION_UNCOMPRESSED, encoded.get(),
+          group, point, POINT_CONVERSION_UNCOMPRESSED, encoded.get(),
           1 + 2 * curve_size_in_bytes, nullptr);
       if (size != 1 + 2 * curve_size_in_bytes) {
         return util::Status(util::error::INTERNAL, "EC_POINT_point2oct failed");
@@ -420,7 +476,7 @@ util::StatusOr<std::string> SubtleUtilBoringSSL::EcPointEncode(
       }
       std::unique_ptr<uint8_t[]> encoded(new uint8_t[2 * curve_size_in_bytes]);
 
-      if (1 != EC_POINT_get_affine_coordinates_GFp(group.get(), point, x.get(),
+      if (1 != EC_POINT_get_affine_coordinates_GFp(group, point, x.get(),
                                                    y.get(), nullptr)) {
         return util::Status(util::error::INTERNAL,
                             "Openssl internal error getting coordinates");
@@ -442,7 +498,7 @@ util::StatusOr<std::string> SubtleUtilBoringSSL::EcPointEncode(
     case EcPointFormat::COMPRESSED: {
       std::unique_ptr<uint8_t[]> encoded(new uint8_t[1 + curve_size_in_bytes]);
       size_t size = EC_POINT_point2oct(
-          group.get(), point, POINT_CONVERSION_COMPRESSED, encoded.get(),
+          group, point, POINT_CONVERSION_COMPRESSED, encoded.get(),
           1 + curve_size_in_bytes, nullptr);
       if (size != 1 + curve_size_in_bytes) {
         return util::Status(util::error::INTERNAL, "EC_POINT_point2oct failed");
@@ -459,36 +515,25 @@ util::StatusOr<std::string> SubtleUtilBoringSSL::EcPointEncode(
 util::StatusOr<std::string> SubtleUtilBoringSSL::EcSignatureIeeeToDer(
     const EC_GROUP *group, absl::string_view ieee_sig) {
   size_t field_size_in_bytes = (EC_GROUP_get_degree(group) + 7) / 8;
-  if (ieee_sig.size() != field_size_in_bytes * 2) {
+  if (ieee_sig.size() != field_size_in_bytes * 2 ||
+      field_size_in_bytes > kMaxEcFieldSizeInBytes) {
     return util::Status(util::error::INVALID_ARGUMENT,
                         "Signature is not valid.");
   }
-  bssl::UniquePtr<ECDSA_SIG> ecdsa(ECDSA_SIG_new());
-  auto status_or_r =
-      SubtleUtilBoringSSL::str2bn(ieee_sig.substr(0, ieee_sig.size() / 2));
-  if (!status_or_r.ok()) {
-    return status_or_r.status();
-  }
-  auto status_or_s = SubtleUtilBoringSSL::str2bn(
-      ieee_sig.substr(ieee_sig.size() / 2, ieee_sig.size() / 2));
-  if (!status_or_s.ok()) {
-    return status_or_s.status();
-  }
-  if (1 != ECDSA_SIG_set0(ecdsa.get(), status_or_r.ValueOrDie().get(),
-                          status_or_s.ValueOrDie().get())) {
-    return util::Status(util::error::INTERNAL, "ECDSA_SIG_set0 error.");
-  }
-  // ECDSA_SIG_set0 takes ownership of s and r's pointers.
-  status_or_r.ValueOrDie().release();
-  status_or_s.ValueOrDie().release();
-  uint8_t *der = nullptr;
-  size_t der_len;
-  if (!ECDSA_SIG_to_bytes(&der, &der_len, ecdsa.get())) {
-    return util::Status(util::error::INVALID_ARGUMENT,
-                        "ECDSA_SIG_to_bytes error");
-  }
-  std::string result = std::string(reinterpret_cast<char *>(der), der_len);
-  OPENSSL_free(der);
+  // The integers are encoded directly, without BIGNUMs or a CBB. Each takes
+  // at most 3 bytes more than the field size, which keeps the length of the
+  // SEQUENCE below 256.
+  uint8_t content[2 * (kMaxEcFieldSizeInBytes + 3)];
+  uint8_t *end = AppendDerInteger(ieee_sig.substr(0, field_size_in_bytes),
+                                  content);
+  end = AppendDerInteger(ieee_sig.substr(field_size_in_bytes), end);
+  size_t content_size = end - content;
+  std::string result;
+  result.reserve(3 + content_size);
+  result.push_back(0x30);
+  if (content_size >= 0x80) result.push_back(static_cast<char>(0x81));
+  result.push_back(static_cast<char>(content_size));
+  result.append(reinterpret_cast<const char *>(content), content_size);
   return result;
 }
 
@@ -571,24 +616,97 @@ absl::string_view SubtleUtilBoringSSL::EnsureNonNull(absl::string_view str) {
   return str;
 }
 
+constexpr int SubtleUtilBoringSSL::kMaxRsaKeyGenerationThreads;
+
+// static
 util::Status SubtleUtilBoringSSL::GetNewRsaKeyPair(
     int modulus_size_in_bits, const BIGNUM *e,
     SubtleUtilBoringSSL::RsaPrivateKey *private_key,
     SubtleUtilBoringSSL::RsaPublicKey *public_key) {
+  int num_threads = std::min<int>(std::thread::hardware_concurrency(),
+                                  kMaxRsaKeyGenerationThreads);
+  return GetNewRsaKeyPair(modulus_size_in_bits, e, std::max(num_threads, 1),
+                          private_key, public_key);
+}
+
+namespace {
+
+// State shared by the threads of one parallel RSA key generation.
+struct RsaKeyGeneration {
+  int modulus_size_in_bits;
+  const BIGNUM *e;
+  // Set once a thread generated a key, which makes the others stop.
+  std::atomic<bool> done{false};
+  absl::Mutex mutex;
+  bssl::UniquePtr<RSA> rsa ABSL_GUARDED_BY(mutex);
+  util::Status status ABSL_GUARDED_BY(mutex);
+};
+
+// Called by BoringSSL during the prime search. Returning 0 aborts it.
+int ContinueUnlessDone(int event, int n, BN_GENCB *callback) {
+  return static_cast<RsaKeyGeneration *>(callback->arg)
+                 ->done.load(std::memory_order_relaxed)
+             ? 0
+             : 1;
+}
+
+// Generates a key, unless another thread of 'generation' is faster.
+void GenerateRsaKey(RsaKeyGeneration *generation) {
   bssl::UniquePtr<RSA> rsa(RSA_new());
-  if (rsa == nullptr) {
-    return util::Status(util::error::INTERNAL, "Could not initialize RSA.");
+  bssl::UniquePtr<BIGNUM> e_copy(BN_dup(generation->e));
+  util::Status status;
+  if (rsa == nullptr || e_copy == nullptr) {
+    status = util::Status(util::error::INTERNAL, "Could not initialize RSA.");
+  } else {
+    BN_GENCB callback;
+    BN_GENCB_set(&callback, &ContinueUnlessDone, generation);
+    if (RSA_generate_key_ex(rsa.get(), generation->modulus_size_in_bits,
+                            e_copy.get(), &callback) != 1) {
+      // The error queue is per thread, so it is read here.
+      status = util::Status(
+          util::error::INTERNAL,
+          absl::StrCat("Error generating private key: ",
+                       SubtleUtilBoringSSL::GetErrors()));
+    }
+  }
+  absl::MutexLock lock(&generation->mutex);
+  if (!status.ok()) {
+    if (generation->rsa == nullptr) generation->status = status;
+    return;
+  }
+  if (generation->rsa == nullptr) {
+    generation->rsa = std::move(rsa);
+    generation->done.store(true, std::memory_order_relaxed);
   }
+}
+
+}  // namespace
 
-  bssl::UniquePtr<BIGNUM> e_copy(BN_new());
-  if (BN_copy(e_copy.get(), e) == nullptr) {
-    return util::Status(util::error::INTERNAL, GetErrors());
+// static
+util::Status SubtleUtilBoringSSL::GetNewRsaKeyPair(
+    int modulus_size_in_bits, const BIGNUM *e, int num_threads,
+    SubtleUtilBoringSSL::RsaPrivateKey *private_key,
+    SubtleUtilBoringSSL::RsaPublicKey *public_key) {
+  if (num_threads < 1) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "num_threads must be positive");
   }
-  if (RSA_generate_key_ex(rsa.get(), modulus_size_in_bits, e_copy.get(),
-                          /*cb=*/nullptr) != 1) {
-    return util::Status(
-        util::error::INTERNAL,
-        absl::StrCat("Error generating private key: ", GetErrors()));
+  RsaKeyGeneration generation;
+  generation.modulus_size_in_bits = modulus_size_in_bits;
+  generation.e = e;
+  // The calling thread takes part in the search.
+  std::vector<std::thread> threads;
+  for (int i = 1; i < num_threads; i++) {
+    threads.emplace_back(&GenerateRsaKey, &generation);
+  }
+  GenerateRsaKey(&generation);
+  for (std::thread &thread : threads) thread.join();
+
+  bssl::UniquePtr<RSA> rsa;
+  {
+    absl::MutexLock lock(&generation.mutex);
+    if (generation.rsa == nullptr) return generation.status;
+    rsa = std::move(generation.rsa);
   }
 
   const BIGNUM *n_bn, *e_bn, *d_bn;
@@ -780,6 +898,23 @@ SubtleUtilBoringSSL::BoringSslRsaFromRsaPublicKey(
   return rsa;
 }
 
+// static
+util::Status SubtleUtilBoringSSL::PrecomputeRsaPublicKey(RSA *rsa) {
+  // A raw public key operation on 1 sets up the Montgomery context of n.
+  size_t size = RSA_size(rsa);
+  std::vector<uint8_t> one(size, 0);
+  one[size - 1] = 1;
+  std::vector<uint8_t> out(size);
+  size_t out_len;
+  if (1 != RSA_verify_raw(rsa, &out_len, out.data(), out.size(), one.data(),
+                          one.size(), RSA_NO_PADDING)) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        absl::StrCat("Invalid RSA public key: ",
+                                     SubtleUtilBoringSSL::GetErrors()));
+  }
+  return util::Status::OK;
+}
+
 // static
 const EVP_CIPHER *SubtleUtilBoringSSL::GetAesCtrCipherForKeySize(
     uint32_t size_in_bytes) {
@@ -837,6 +972,23 @@ util::StatusOr<std::vector<uint8_t>> ComputeHash(absl::string_view input,
   return digest;
 }
 
+util::StatusOr<unsigned int> ComputeHash(absl::string_view input,
+                                         absl::string_view suffix,
+                                         const EVP_MD &hasher,
+                                         uint8_t *digest) {
+  bssl::ScopedEVP_MD_CTX md_ctx;
+  unsigned int digest_length = 0;
+  if (EVP_DigestInit_ex(md_ctx.get(), &hasher, /*engine=*/nullptr) != 1 ||
+      EVP_DigestUpdate(md_ctx.get(), input.data(), input.size()) != 1 ||
+      EVP_DigestUpdate(md_ctx.get(), suffix.data(), suffix.size()) != 1 ||
+      EVP_DigestFinal_ex(md_ctx.get(), digest, &digest_length) != 1) {
+    return util::Status(util::error::INTERNAL,
+                        absl::StrCat("Openssl internal error computing hash: ",
+                                     SubtleUtilBoringSSL::GetErrors()));
+  }
+  return digest_length;
+}
+
 }  // namespace boringssl
 
 }  // namespace subtle
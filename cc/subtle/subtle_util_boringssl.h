@@ -131,6 +131,13 @@ class SubtleUtilBoringSSL {
   static crypto::tink::util::StatusOr<EC_GROUP *> GetEcGroup(
       EllipticCurveType curve_type);
 
+  // Returns a process-wide EC_GROUP of the curve type, which is created on
+  // first use and never freed. Unlike GetEcGroup(), it allocates nothing
+  // after the first call. The group is immutable and may be used from many
+  // threads at once.
+  static crypto::tink::util::StatusOr<const EC_GROUP *> GetStaticEcGroup(
+      EllipticCurveType curve_type);
+
   // Returns BoringSSL's EC_POINT constructed from the curve type, big-endian
   // representation of public key's x-coordinate and y-coordinate.
   static crypto::tink::util::StatusOr<EC_POINT *> GetEcPoint(
@@ -218,12 +225,25 @@ class SubtleUtilBoringSSL {
   // Return an empty string if str.data() is nullptr; otherwise return str.
   static absl::string_view EnsureNonNull(absl::string_view str);
 
-  // Creates a new RSA public and private key pair.
+  // The number of threads GetNewRsaKeyPair uses at most by default.
+  static constexpr int kMaxRsaKeyGenerationThreads = 4;
+
+  // Creates a new RSA public and private key pair. Uses one thread per core,
+  // up to kMaxRsaKeyGenerationThreads.
   static util::Status GetNewRsaKeyPair(int modulus_size_in_bits,
                                        const BIGNUM *e,
                                        RsaPrivateKey *private_key,
                                        RsaPublicKey *public_key);
 
+  // Creates a new RSA public and private key pair with 'num_threads'
+  // concurrent key generations, of which the first to finish is returned.
+  // The time to find the primes varies widely, so this cuts the tail latency
+  // of key generation. The calling thread is one of the 'num_threads'.
+  static util::Status GetNewRsaKeyPair(int modulus_size_in_bits,
+                                       const BIGNUM *e, int num_threads,
+                                       RsaPrivateKey *private_key,
+                                       RsaPublicKey *public_key);
+
   // Copies n, e and d into the RSA key.
   static util::Status CopyKey(const RsaPrivateKey &key, RSA *rsa);
 
@@ -241,6 +261,12 @@ class SubtleUtilBoringSSL {
   static util::StatusOr<bssl::UniquePtr<RSA>> BoringSslRsaFromRsaPublicKey(
       const RsaPublicKey &key);
 
+  // Makes BoringSSL compute the Montgomery context of the modulus of 'rsa'
+  // now, rather than lazily in the first public key operation, where it holds
+  // the write lock of 'rsa' and stalls all other operations with the key. Also
+  // checks that BoringSSL accepts 'rsa' for public key operations.
+  static util::Status PrecomputeRsaPublicKey(RSA *rsa);
+
   // Returns BoringSSL's AES CTR EVP_CIPHER for the key size.
   static const EVP_CIPHER *GetAesCtrCipherForKeySize(uint32_t size_in_bytes);
 
@@ -257,6 +283,14 @@ namespace boringssl {
 util::StatusOr<std::vector<uint8_t>> ComputeHash(absl::string_view input,
                                                  const EVP_MD &hasher);
 
+// Computes the hash of 'input' followed by 'suffix' using the hash function
+// 'hasher', and writes it to 'digest', which must hold EVP_MAX_MD_SIZE bytes.
+// Returns the size of the hash.
+util::StatusOr<unsigned int> ComputeHash(absl::string_view input,
+                                         absl::string_view suffix,
+                                         const EVP_MD &hasher,
+                                         uint8_t *digest);
+
 }  // namespace boringssl
 
 }  // namespace subtle
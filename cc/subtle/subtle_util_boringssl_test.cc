@@ -18,6 +18,7 @@
 
 #include <algorithm>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "gtest/gtest.h"
@@ -27,11 +28,14 @@
 #include "openssl/curve25519.h"
 #include "openssl/digest.h"
 #include "openssl/ec.h"
+#include "openssl/ecdsa.h"
 #include "openssl/evp.h"
+#include "openssl/mem.h"
 #include "openssl/x509.h"
 #include "include/rapidjson/document.h"
 #include "tink/subtle/common_enums.h"
 #include "tink/subtle/ec_util.h"
+#include "tink/subtle/random.h"
 #include "tink/subtle/wycheproof_util.h"
 #include "tink/util/secret_data.h"
 #include "tink/util/status.h"
@@ -141,6 +145,27 @@ TEST(SubtleUtilBoringSSLTest, EcPointDecode) {
   }
 }
 
+TEST(SubtleUtilBoringSSLTest, GetStaticEcGroup) {
+  std::vector<std::pair<EllipticCurveType, int>> curves = {
+      {EllipticCurveType::NIST_P256, NID_X9_62_prime256v1},
+      {EllipticCurveType::NIST_P384, NID_secp384r1},
+      {EllipticCurveType::NIST_P521, NID_secp521r1}};
+  for (const auto& curve : curves) {
+    auto group_result = SubtleUtilBoringSSL::GetStaticEcGroup(curve.first);
+    ASSERT_THAT(group_result.status(), IsOk());
+    ASSERT_THAT(group_result.ValueOrDie(), NotNull());
+    EXPECT_EQ(EC_GROUP_get_curve_name(group_result.ValueOrDie()),
+              curve.second);
+    // Every call returns the same group.
+    EXPECT_EQ(SubtleUtilBoringSSL::GetStaticEcGroup(curve.first).ValueOrDie(),
+              group_result.ValueOrDie());
+  }
+  EXPECT_THAT(
+      SubtleUtilBoringSSL::GetStaticEcGroup(EllipticCurveType::CURVE25519)
+          .status(),
+      StatusIs(util::error::UNIMPLEMENTED));
+}
+
 TEST(SubtleUtilBoringSSLTest, Bn2strAndStr2bn) {
   int len = 8;
   std::string bn_str[6] = {"0000000000000000", "0000000000000001",
@@ -156,6 +181,52 @@ TEST(SubtleUtilBoringSSLTest, Bn2strAndStr2bn) {
   }
 }
 
+// Returns the DER encoding of the ECDSA signature (r, s) computed by
+// BoringSSL, for comparison with EcSignatureIeeeToDer().
+std::string BoringSslDerSignature(absl::string_view r, absl::string_view s) {
+  bssl::UniquePtr<ECDSA_SIG> sig(ECDSA_SIG_new());
+  EXPECT_NE(nullptr, BN_bin2bn(reinterpret_cast<const uint8_t*>(r.data()),
+                               r.size(), sig->r));
+  EXPECT_NE(nullptr, BN_bin2bn(reinterpret_cast<const uint8_t*>(s.data()),
+                               s.size(), sig->s));
+  uint8_t* der = nullptr;
+  size_t der_len;
+  EXPECT_EQ(1, ECDSA_SIG_to_bytes(&der, &der_len, sig.get()));
+  std::string result(reinterpret_cast<char*>(der), der_len);
+  OPENSSL_free(der);
+  return result;
+}
+
+TEST(SubtleUtilBoringSSLTest, EcSignatureIeeeToDer) {
+  for (EllipticCurveType curve :
+       {EllipticCurveType::NIST_P256, EllipticCurveType::NIST_P384,
+        EllipticCurveType::NIST_P521}) {
+    SCOPED_TRACE(EnumToString(curve));
+    const EC_GROUP* group =
+        SubtleUtilBoringSSL::GetStaticEcGroup(curve).ValueOrDie();
+    size_t size = (EC_GROUP_get_degree(group) + 7) / 8;
+    std::vector<std::string> values = {
+        std::string(size, '\0'), std::string(size, '\xff'),
+        std::string(size - 1, '\0') + "\x01",
+        std::string(size - 1, '\0') + "\x80",
+        "\x7f" + std::string(size - 1, '\xff'),
+        Random::GetRandomBytes(size), Random::GetRandomBytes(size)};
+    for (const std::string& r : values) {
+      for (const std::string& s : values) {
+        auto der_result =
+            SubtleUtilBoringSSL::EcSignatureIeeeToDer(group, r + s);
+        ASSERT_THAT(der_result.status(), IsOk());
+        EXPECT_EQ(test::HexEncode(BoringSslDerSignature(r, s)),
+                  test::HexEncode(der_result.ValueOrDie()));
+      }
+    }
+    EXPECT_THAT(SubtleUtilBoringSSL::EcSignatureIeeeToDer(
+                    group, std::string(2 * size - 1, '\x01'))
+                    .status(),
+                StatusIs(util::error::INVALID_ARGUMENT));
+  }
+}
+
 TEST(SubtleUtilBoringSSLTest, ValidateSignatureHash) {
   EXPECT_TRUE(
       SubtleUtilBoringSSL::ValidateSignatureHash(HashType::SHA256).ok());
@@ -376,6 +447,51 @@ TEST(CreatesNewRsaKeyPairTest, KeyIsWellFormed) {
   }
 }
 
+TEST(CreatesNewRsaKeyPairTest, WithThreads) {
+  bssl::UniquePtr<BIGNUM> e(BN_new());
+  BN_set_word(e.get(), RSA_F4);
+  bssl::UniquePtr<BN_CTX> ctx(BN_CTX_new());
+  for (int num_threads : {1, 2, 8}) {
+    SubtleUtilBoringSSL::RsaPublicKey public_key;
+    SubtleUtilBoringSSL::RsaPrivateKey private_key;
+    ASSERT_THAT(SubtleUtilBoringSSL::GetNewRsaKeyPair(
+                    2048, e.get(), num_threads, &private_key, &public_key),
+                IsOk());
+    EXPECT_EQ(public_key.n, private_key.n);
+    auto n = std::move(SubtleUtilBoringSSL::str2bn(private_key.n).ValueOrDie());
+    auto p = std::move(
+        SubtleUtilBoringSSL::str2bn(util::SecretDataAsStringView(private_key.p))
+            .ValueOrDie());
+    auto q = std::move(
+        SubtleUtilBoringSSL::str2bn(util::SecretDataAsStringView(private_key.q))
+            .ValueOrDie());
+    auto n_calc = bssl::UniquePtr<BIGNUM>(BN_new());
+    ASSERT_TRUE(BN_mul(n_calc.get(), p.get(), q.get(), ctx.get()));
+    EXPECT_TRUE(BN_equal_consttime(n_calc.get(), n.get()));
+    EXPECT_GE(BN_num_bits(n.get()), 2048);
+  }
+}
+
+TEST(CreatesNewRsaKeyPairTest, WithThreadsFailsOnLargeE) {
+  SubtleUtilBoringSSL::RsaPublicKey public_key;
+  SubtleUtilBoringSSL::RsaPrivateKey private_key;
+  bssl::UniquePtr<BIGNUM> e(BN_new());
+  BN_set_word(e.get(), 1L << 33);
+  EXPECT_THAT(SubtleUtilBoringSSL::GetNewRsaKeyPair(
+                  2048, e.get(), /*num_threads=*/4, &private_key, &public_key),
+              StatusIs(util::error::INTERNAL));
+}
+
+TEST(CreatesNewRsaKeyPairTest, FailsWithoutThreads) {
+  SubtleUtilBoringSSL::RsaPublicKey public_key;
+  SubtleUtilBoringSSL::RsaPrivateKey private_key;
+  bssl::UniquePtr<BIGNUM> e(BN_new());
+  BN_set_word(e.get(), RSA_F4);
+  EXPECT_THAT(SubtleUtilBoringSSL::GetNewRsaKeyPair(
+                  2048, e.get(), /*num_threads=*/0, &private_key, &public_key),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
 TEST(CreatesNewRsaKeyPairTest, GeneratesDifferentKeysEveryTime) {
   SubtleUtilBoringSSL::RsaPublicKey public_key;
   bssl::UniquePtr<BIGNUM> e(BN_new());
@@ -466,6 +582,23 @@ TEST(CopiesRsaKeysTest, CopiesRsaPublicKey) {
   EXPECT_TRUE(BignumEqualsString(rsa->n, public_key.n));
 }
 
+TEST(PrecomputeRsaPublicKeyTest, Succeeds) {
+  SubtleUtilBoringSSL::RsaPrivateKey private_key;
+  SubtleUtilBoringSSL::RsaPublicKey public_key;
+  bssl::UniquePtr<BIGNUM> e(BN_new());
+  BN_set_word(e.get(), RSA_F4);
+  ASSERT_THAT(SubtleUtilBoringSSL::GetNewRsaKeyPair(2048, e.get(), &private_key,
+                                                    &public_key),
+              IsOk());
+  auto rsa_result =
+      SubtleUtilBoringSSL::BoringSslRsaFromRsaPublicKey(public_key);
+  ASSERT_TRUE(rsa_result.ok());
+
+  EXPECT_THAT(SubtleUtilBoringSSL::PrecomputeRsaPublicKey(
+                  rsa_result.ValueOrDie().get()),
+              IsOk());
+}
+
 TEST(CreatesNewEd25519KeyPairTest, BoringSSLPrivateKeySuffix) {
   // Generate a new key pair.
   uint8_t out_public_key[ED25519_PUBLIC_KEY_LEN];
@@ -16,6 +16,9 @@
 
 #include "tink/subtle/test_util.h"
 
+#include <utility>
+
+#include "absl/synchronization/mutex.h"
 
 namespace crypto {
 namespace tink {
@@ -70,6 +73,43 @@ util::Status ReadFromStream(InputStream* input_stream, std::string* output) {
   return util::Status::OK;
 }
 
+TestThreadPool::TestThreadPool(int thread_count) {
+  for (int i = 0; i < thread_count; i++) {
+    threads_.emplace_back([this]() { RunTasks(); });
+  }
+}
+
+TestThreadPool::~TestThreadPool() {
+  {
+    absl::MutexLock lock(&mutex_);
+    stopping_ = true;
+  }
+  for (auto& thread : threads_) thread.join();
+}
+
+void TestThreadPool::Schedule(std::function<void()> task) {
+  absl::MutexLock lock(&mutex_);
+  tasks_.push_back(std::move(task));
+}
+
+bool TestThreadPool::CanRunOrStop() const {
+  return stopping_ || !tasks_.empty();
+}
+
+void TestThreadPool::RunTasks() {
+  while (true) {
+    std::function<void()> task;
+    {
+      absl::MutexLock lock(&mutex_);
+      mutex_.Await(absl::Condition(this, &TestThreadPool::CanRunOrStop));
+      if (tasks_.empty()) return;
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+    task();
+  }
+}
+
 }  // namespace test
 }  // namespace subtle
 }  // namespace tink
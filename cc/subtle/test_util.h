@@ -17,12 +17,17 @@
 #ifndef TINK_SUBTLE_TEST_UTIL_H_
 #define TINK_SUBTLE_TEST_UTIL_H_
 
+#include <deque>
+#include <functional>
 #include <string>
+#include <thread>  // NOLINT(build/c++11)
 #include <vector>
 
+#include "absl/base/thread_annotations.h"
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "tink/input_stream.h"
 #include "tink/output_stream.h"
 #include "tink/subtle/nonce_based_streaming_aead.h"
@@ -54,6 +59,26 @@ util::Status WriteToStream(OutputStream* output_stream,
 // then this function returns OK.
 util::Status ReadFromStream(InputStream* input_stream, std::string* output);
 
+// A minimal thread pool for tests of the parallel modes of streams.
+// The destructor runs all scheduled tasks before it returns.
+class TestThreadPool {
+ public:
+  explicit TestThreadPool(int thread_count);
+  ~TestThreadPool();
+
+  // Schedules 'task' to run on one of the threads of the pool.
+  void Schedule(std::function<void()> task);
+
+ private:
+  bool CanRunOrStop() const ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  void RunTasks();
+
+  absl::Mutex mutex_;
+  std::deque<std::function<void()>> tasks_ ABSL_GUARDED_BY(mutex_);
+  bool stopping_ ABSL_GUARDED_BY(mutex_) = false;
+  std::vector<std::thread> threads_;
+};
+
 // A dummy encrypter that "encrypts" by just appending to the plaintext
 // the current segment number and a marker byte indicating whether
 // the segment is last one.
@@ -104,15 +129,24 @@ class DummyStreamSegmentEncrypter : public StreamSegmentEncrypter {
       const std::vector<uint8_t>& plaintext,
       bool is_last_segment,
       std::vector<uint8_t>* ciphertext_buffer) override {
+    EncryptSegmentAt(plaintext, segment_number_, is_last_segment,
+                     ciphertext_buffer).IgnoreError();
+    generated_output_size_ += ciphertext_buffer->size();
+    IncSegmentNumber();
+    return util::Status::OK;
+  }
+
+  util::Status EncryptSegmentAt(
+      const std::vector<uint8_t>& plaintext, int64_t segment_number,
+      bool is_last_segment,
+      std::vector<uint8_t>* ciphertext_buffer) const override {
     ciphertext_buffer->resize(plaintext.size() + kSegmentTagSize);
     memcpy(ciphertext_buffer->data(), plaintext.data(), plaintext.size());
     memcpy(ciphertext_buffer->data() + plaintext.size(),
-           &segment_number_, sizeof(segment_number_));
+           &segment_number, sizeof(segment_number));
     // The last byte of the a ciphertext segment.
     ciphertext_buffer->back() =
         is_last_segment ? kLastSegment : kNotLastSegment;
-    generated_output_size_ += ciphertext_buffer->size();
-    IncSegmentNumber();
     return util::Status::OK;
   }
 
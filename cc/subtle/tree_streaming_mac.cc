@@ -0,0 +1,294 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/subtle/tree_streaming_mac.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "openssl/crypto.h"
+#include "openssl/mem.h"
+#include "tink/subtle/subtle_util.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+namespace {
+
+constexpr char kLeafPrefix = 0x00;
+constexpr char kRootPrefix = 0x01;
+
+std::string BigEndian64(uint64_t value) {
+  std::string result(8, 0);
+  for (int i = 7; i >= 0; i--) {
+    result[i] = static_cast<char>(value & 0xff);
+    value >>= 8;
+  }
+  return result;
+}
+
+// A chunk which is MACed by a task given to Options::schedule.
+struct LeafJob {
+  std::string chunk;
+  uint64_t index;
+  util::StatusOr<std::string> tag;
+  absl::Mutex mutex;
+  bool done ABSL_GUARDED_BY(mutex) = false;
+};
+
+void ComputeLeaf(const StatefulMacFactory& mac_factory, LeafJob* job) {
+  util::StatusOr<std::unique_ptr<StatefulMac>> mac_result =
+      mac_factory.Create();
+  if (!mac_result.ok()) {
+    job->tag = mac_result.status();
+  } else {
+    StatefulMac& mac = *mac_result.ValueOrDie();
+    std::string header = std::string(1, kLeafPrefix) + BigEndian64(job->index);
+    util::Status status = mac.Update(header);
+    if (status.ok()) status = mac.Update(job->chunk);
+    if (status.ok()) {
+      job->tag = mac.Finalize();
+    } else {
+      job->tag = status;
+    }
+  }
+  OPENSSL_cleanse(&job->chunk[0], job->chunk.size());
+  job->chunk.clear();
+}
+
+// Splits the data written to it into chunks, and MACs them with the tree
+// construction of TreeStreamingMac.
+class TreeMacStream {
+ public:
+  TreeMacStream(std::shared_ptr<const StatefulMacFactory> mac_factory,
+                const TreeStreamingMac::Options& options,
+                std::unique_ptr<StatefulMac> root)
+      : mac_factory_(std::move(mac_factory)),
+        options_(options),
+        root_(std::move(root)) {
+    status_ = root_->Update(absl::string_view(&kRootPrefix, 1));
+  }
+
+  ~TreeMacStream() {
+    if (!chunk_.empty()) OPENSSL_cleanse(&chunk_[0], chunk_.size());
+  }
+
+  util::StatusOr<int> NextBuffer(void** buffer) {
+    if (!status_.ok()) return status_;
+    if (chunk_position_ == options_.chunk_size) {
+      status_ = DispatchChunk();
+      if (!status_.ok()) return status_;
+    }
+    if (chunk_.empty()) {
+      ResizeStringUninitialized(&chunk_, options_.chunk_size);
+    }
+    *buffer = &chunk_[chunk_position_];
+    int size = options_.chunk_size - chunk_position_;
+    chunk_position_ = options_.chunk_size;
+    last_buffer_size_ = size;
+    position_ += size;
+    return size;
+  }
+
+  void BackUp(int count) {
+    count = std::max(0, std::min(count, last_buffer_size_));
+    last_buffer_size_ -= count;
+    chunk_position_ -= count;
+    position_ -= count;
+  }
+
+  int64_t Position() const { return position_; }
+
+  // Closes the stream and returns the tag of the data written to it.
+  util::StatusOr<std::string> Finalize() {
+    if (!status_.ok()) return status_;
+    if (chunk_position_ > 0) status_ = DispatchChunk();
+    while (status_.ok() && !leaves_in_flight_.empty()) {
+      status_ = AbsorbOldestLeaf();
+    }
+    if (status_.ok()) {
+      status_ =
+          root_->Update(BigEndian64(num_leaves_) + BigEndian64(position_));
+    }
+    if (!status_.ok()) return status_;
+    status_ = util::Status(util::error::FAILED_PRECONDITION, "Stream Closed");
+    return root_->Finalize();
+  }
+
+ private:
+  // MACs the first chunk_position_ bytes of chunk_ as the next leaf, or
+  // schedules that.
+  util::Status DispatchChunk() {
+    auto job = std::make_shared<LeafJob>();
+    chunk_.resize(chunk_position_);
+    job->chunk = std::move(chunk_);
+    job->index = num_leaves_++;
+    chunk_.clear();
+    chunk_position_ = 0;
+    last_buffer_size_ = 0;
+    if (options_.schedule == nullptr) {
+      ComputeLeaf(*mac_factory_, job.get());
+      if (!job->tag.ok()) return job->tag.status();
+      return root_->Update(job->tag.ValueOrDie());
+    }
+    std::shared_ptr<const StatefulMacFactory> mac_factory = mac_factory_;
+    options_.schedule([mac_factory, job]() {
+      ComputeLeaf(*mac_factory, job.get());
+      absl::MutexLock lock(&job->mutex);
+      job->done = true;
+    });
+    leaves_in_flight_.push_back(std::move(job));
+    if (static_cast<int>(leaves_in_flight_.size()) >=
+        options_.max_chunks_in_flight) {
+      return AbsorbOldestLeaf();
+    }
+    return util::OkStatus();
+  }
+
+  // Waits for the oldest scheduled leaf and adds its tag to the root.
+  util::Status AbsorbOldestLeaf() {
+    std::shared_ptr<LeafJob> job = std::move(leaves_in_flight_.front());
+    leaves_in_flight_.pop_front();
+    {
+      absl::MutexLock lock(&job->mutex);
+      job->mutex.Await(absl::Condition(&job->done));
+    }
+    if (!job->tag.ok()) return job->tag.status();
+    return root_->Update(job->tag.ValueOrDie());
+  }
+
+  const std::shared_ptr<const StatefulMacFactory> mac_factory_;
+  const TreeStreamingMac::Options options_;
+  const std::unique_ptr<StatefulMac> root_;
+  util::Status status_;
+  // The chunk being written, with chunk_position_ bytes of data.
+  std::string chunk_;
+  int chunk_position_ = 0;
+  // The size of the last buffer returned by NextBuffer(), minus BackUp()s.
+  int last_buffer_size_ = 0;
+  int64_t position_ = 0;
+  uint64_t num_leaves_ = 0;
+  // Scheduled leaves whose tags were not added to root_ yet, oldest first.
+  std::deque<std::shared_ptr<LeafJob>> leaves_in_flight_;
+};
+
+class TreeComputeMacOutputStream
+    : public OutputStreamWithResult<std::string> {
+ public:
+  explicit TreeComputeMacOutputStream(std::unique_ptr<TreeMacStream> stream)
+      : stream_(std::move(stream)) {}
+
+  util::StatusOr<int> NextBuffer(void** buffer) override {
+    return stream_->NextBuffer(buffer);
+  }
+  util::StatusOr<std::string> CloseStreamAndComputeResult() override {
+    return stream_->Finalize();
+  }
+  void BackUp(int count) override { stream_->BackUp(count); }
+  int64_t Position() const override { return stream_->Position(); }
+
+ private:
+  const std::unique_ptr<TreeMacStream> stream_;
+};
+
+class TreeVerifyMacOutputStream
+    : public OutputStreamWithResult<util::Status> {
+ public:
+  TreeVerifyMacOutputStream(std::unique_ptr<TreeMacStream> stream,
+                            const std::string& expected)
+      : stream_(std::move(stream)), expected_(expected) {}
+
+  util::StatusOr<int> NextBuffer(void** buffer) override {
+    return stream_->NextBuffer(buffer);
+  }
+  util::Status CloseStreamAndComputeResult() override {
+    util::StatusOr<std::string> actual_result = stream_->Finalize();
+    if (!actual_result.ok()) return actual_result.status();
+    const std::string& actual = actual_result.ValueOrDie();
+    if (actual.size() == expected_.size() &&
+        CRYPTO_memcmp(actual.data(), expected_.data(), actual.size()) == 0) {
+      return util::OkStatus();
+    }
+    return util::Status(util::error::INVALID_ARGUMENT, "Incorrect MAC");
+  }
+  void BackUp(int count) override { stream_->BackUp(count); }
+  int64_t Position() const override { return stream_->Position(); }
+
+ private:
+  const std::unique_ptr<TreeMacStream> stream_;
+  const std::string expected_;
+};
+
+}  // namespace
+
+// static
+util::StatusOr<std::unique_ptr<StreamingMac>> TreeStreamingMac::New(
+    std::unique_ptr<StatefulMacFactory> mac_factory, Options options) {
+  if (mac_factory == nullptr) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "mac_factory must be non-null");
+  }
+  if (options.chunk_size <= 0) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "chunk_size must be positive");
+  }
+  if (options.max_chunks_in_flight <= 0) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "max_chunks_in_flight must be positive");
+  }
+  return std::unique_ptr<StreamingMac>(new TreeStreamingMac(
+      std::shared_ptr<const StatefulMacFactory>(std::move(mac_factory)),
+      std::move(options)));
+}
+
+util::StatusOr<std::unique_ptr<OutputStreamWithResult<std::string>>>
+TreeStreamingMac::NewComputeMacOutputStream() const {
+  util::StatusOr<std::unique_ptr<StatefulMac>> root_result =
+      mac_factory_->Create();
+  if (!root_result.ok()) return root_result.status();
+  return std::unique_ptr<OutputStreamWithResult<std::string>>(
+      absl::make_unique<TreeComputeMacOutputStream>(
+          absl::make_unique<TreeMacStream>(
+              mac_factory_, options_, std::move(root_result.ValueOrDie()))));
+}
+
+util::StatusOr<std::unique_ptr<OutputStreamWithResult<util::Status>>>
+TreeStreamingMac::NewVerifyMacOutputStream(const std::string& mac_value) const {
+  util::StatusOr<std::unique_ptr<StatefulMac>> root_result =
+      mac_factory_->Create();
+  if (!root_result.ok()) return root_result.status();
+  return std::unique_ptr<OutputStreamWithResult<util::Status>>(
+      absl::make_unique<TreeVerifyMacOutputStream>(
+          absl::make_unique<TreeMacStream>(
+              mac_factory_, options_, std::move(root_result.ValueOrDie())),
+          mac_value));
+}
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
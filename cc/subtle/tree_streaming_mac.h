@@ -0,0 +1,85 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_SUBTLE_TREE_STREAMING_MAC_H_
+#define TINK_SUBTLE_TREE_STREAMING_MAC_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "tink/streaming_mac.h"
+#include "tink/subtle/mac/stateful_mac.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+// A StreamingMac whose input is split into chunks that are MACed
+// independently, so that a large input can be MACed on several cores.
+//
+// With the MAC M of the StatefulMacFactory, chunk i of the input is MACed as
+//   leaf_i = M(0x00 || uint64_be(i) || chunk_i)
+// and the tag of an input with n chunks and L bytes is
+//   M(0x01 || leaf_0 || ... || leaf_{n-1} || uint64_be(n) || uint64_be(L)).
+// The leading byte separates leaves from the root, and the trailer fixes the
+// chunk count and length, so chunks cannot be dropped, reordered or moved
+// between inputs. The tags differ from those of StreamingMacImpl with the
+// same factory, and depend on the chunk size, which must therefore be fixed
+// for a key.
+class TreeStreamingMac : public StreamingMac {
+ public:
+  struct Options {
+    // The size of the chunks. Must be positive.
+    int chunk_size = 1 << 20;
+    // Runs the given task, typically on a thread pool owned by the caller.
+    // Tasks may run on any thread and in any order, also after the stream
+    // which scheduled them was destroyed, and must eventually all run. If
+    // null, chunks are MACed on the writing thread as they fill up.
+    std::function<void(std::function<void()>)> schedule;
+    // The maximal number of chunks that are MACed concurrently by a stream.
+    // Bounds its memory use to this many chunks. Must be positive.
+    int max_chunks_in_flight = 8;
+  };
+
+  // 'mac_factory' must be thread-safe if options.schedule is set.
+  static util::StatusOr<std::unique_ptr<StreamingMac>> New(
+      std::unique_ptr<StatefulMacFactory> mac_factory, Options options);
+
+  util::StatusOr<std::unique_ptr<OutputStreamWithResult<std::string>>>
+  NewComputeMacOutputStream() const override;
+
+  util::StatusOr<std::unique_ptr<OutputStreamWithResult<util::Status>>>
+  NewVerifyMacOutputStream(const std::string& mac_value) const override;
+
+ private:
+  TreeStreamingMac(std::shared_ptr<const StatefulMacFactory> mac_factory,
+                   Options options)
+      : mac_factory_(std::move(mac_factory)), options_(std::move(options)) {}
+
+  // Shared with the tasks of the streams.
+  const std::shared_ptr<const StatefulMacFactory> mac_factory_;
+  const Options options_;
+};
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_SUBTLE_TREE_STREAMING_MAC_H_
@@ -0,0 +1,207 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/subtle/tree_streaming_mac.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "tink/subtle/common_enums.h"
+#include "tink/subtle/random.h"
+#include "tink/subtle/stateful_hmac_boringssl.h"
+#include "tink/subtle/test_util.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "tink/util/test_matchers.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+namespace {
+
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::testing::Eq;
+using ::testing::Not;
+
+constexpr int kChunkSize = 100;
+constexpr uint32_t kTagSize = 32;
+
+std::string BigEndian64(uint64_t value) {
+  std::string result(8, 0);
+  for (int i = 7; i >= 0; i--) {
+    result[i] = static_cast<char>(value & 0xff);
+    value >>= 8;
+  }
+  return result;
+}
+
+class TreeStreamingMacTest : public ::testing::Test {
+ protected:
+  std::unique_ptr<StatefulMacFactory> NewFactory() {
+    return absl::make_unique<StatefulHmacBoringSslFactory>(HashType::SHA256,
+                                                           kTagSize, key_);
+  }
+
+  std::string Mac(const std::string& data) {
+    auto mac = NewFactory()->Create().ValueOrDie();
+    EXPECT_THAT(mac->Update(data), IsOk());
+    return mac->Finalize().ValueOrDie();
+  }
+
+  // Computes the tag of the tree construction directly.
+  std::string ExpectedTag(const std::string& data) {
+    std::string root(1, '\x01');
+    uint64_t num_chunks = 0;
+    for (size_t i = 0; i < data.size(); i += kChunkSize) {
+      root += Mac(std::string(1, '\x00') + BigEndian64(num_chunks++) +
+                  data.substr(i, kChunkSize));
+    }
+    return Mac(root + BigEndian64(num_chunks) + BigEndian64(data.size()));
+  }
+
+  std::unique_ptr<StreamingMac> NewTreeMac(test::TestThreadPool* pool) {
+    TreeStreamingMac::Options options;
+    options.chunk_size = kChunkSize;
+    options.max_chunks_in_flight = 3;
+    if (pool != nullptr) {
+      options.schedule = [pool](std::function<void()> task) {
+        pool->Schedule(std::move(task));
+      };
+    }
+    auto result = TreeStreamingMac::New(NewFactory(), std::move(options));
+    EXPECT_THAT(result.status(), IsOk());
+    return std::move(result.ValueOrDie());
+  }
+
+  util::SecretData key_ = Random::GetRandomKeyBytes(32);
+};
+
+TEST_F(TreeStreamingMacTest, MatchesConstruction) {
+  test::TestThreadPool pool(4);
+  for (bool parallel : {false, true}) {
+    auto tree_mac = NewTreeMac(parallel ? &pool : nullptr);
+    for (int size : {0, 1, kChunkSize - 1, kChunkSize, kChunkSize + 1,
+                     17 * kChunkSize + 3}) {
+      std::string data = Random::GetRandomBytes(size);
+      auto stream =
+          std::move(tree_mac->NewComputeMacOutputStream().ValueOrDie());
+      ASSERT_THAT(test::WriteToStream(stream.get(), data, false), IsOk());
+      EXPECT_THAT(stream->Position(), Eq(size));
+      auto tag_result = stream->CloseAndGetResult();
+      ASSERT_THAT(tag_result.status(), IsOk());
+      EXPECT_THAT(tag_result.ValueOrDie(), Eq(ExpectedTag(data)))
+          << "size " << size << ", parallel " << parallel;
+    }
+  }
+}
+
+TEST_F(TreeStreamingMacTest, ChunksOfOtherSizesDiffer) {
+  auto tree_mac = NewTreeMac(nullptr);
+  std::string data = Random::GetRandomBytes(3 * kChunkSize);
+  auto stream = std::move(tree_mac->NewComputeMacOutputStream().ValueOrDie());
+  ASSERT_THAT(test::WriteToStream(stream.get(), data, false), IsOk());
+  std::string tag = stream->CloseAndGetResult().ValueOrDie();
+  EXPECT_THAT(tag, Not(Eq(Mac(data))));
+
+  TreeStreamingMac::Options options;
+  options.chunk_size = 2 * kChunkSize;
+  auto other_mac =
+      std::move(TreeStreamingMac::New(NewFactory(), options).ValueOrDie());
+  stream = std::move(other_mac->NewComputeMacOutputStream().ValueOrDie());
+  ASSERT_THAT(test::WriteToStream(stream.get(), data, false), IsOk());
+  EXPECT_THAT(stream->CloseAndGetResult().ValueOrDie(), Not(Eq(tag)));
+}
+
+TEST_F(TreeStreamingMacTest, BackUp) {
+  auto tree_mac = NewTreeMac(nullptr);
+  std::string data = Random::GetRandomBytes(250);
+  auto stream = std::move(tree_mac->NewComputeMacOutputStream().ValueOrDie());
+  // Writes at most 30 bytes into every buffer, and backs up the rest.
+  size_t written = 0;
+  while (written < data.size()) {
+    void* buffer;
+    auto next_result = stream->Next(&buffer);
+    ASSERT_THAT(next_result.status(), IsOk());
+    int size = std::min<int>({next_result.ValueOrDie(), 30,
+                              static_cast<int>(data.size() - written)});
+    std::copy_n(&data[written], size, static_cast<char*>(buffer));
+    stream->BackUp(next_result.ValueOrDie() - size);
+    written += size;
+    EXPECT_THAT(stream->Position(), Eq(written));
+  }
+  EXPECT_THAT(stream->CloseAndGetResult().ValueOrDie(), Eq(ExpectedTag(data)));
+}
+
+TEST_F(TreeStreamingMacTest, Verify) {
+  test::TestThreadPool pool(4);
+  auto tree_mac = NewTreeMac(&pool);
+  std::string data = Random::GetRandomBytes(10 * kChunkSize + 7);
+  std::string tag = ExpectedTag(data);
+
+  auto stream =
+      std::move(tree_mac->NewVerifyMacOutputStream(tag).ValueOrDie());
+  ASSERT_THAT(test::WriteToStream(stream.get(), data, false), IsOk());
+  EXPECT_THAT(stream->CloseAndGetResult(), IsOk());
+
+  std::string modified = data;
+  modified[5 * kChunkSize] ^= 1;
+  stream = std::move(tree_mac->NewVerifyMacOutputStream(tag).ValueOrDie());
+  ASSERT_THAT(test::WriteToStream(stream.get(), modified, false), IsOk());
+  EXPECT_THAT(stream->CloseAndGetResult(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+
+  stream = std::move(tree_mac->NewVerifyMacOutputStream(tag).ValueOrDie());
+  ASSERT_THAT(test::WriteToStream(stream.get(), data.substr(0, 10 * kChunkSize),
+                                  false),
+              IsOk());
+  EXPECT_THAT(stream->CloseAndGetResult(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST_F(TreeStreamingMacTest, ClosedStream) {
+  auto tree_mac = NewTreeMac(nullptr);
+  auto stream = std::move(tree_mac->NewComputeMacOutputStream().ValueOrDie());
+  ASSERT_THAT(stream->CloseAndGetResult().status(), IsOk());
+  void* buffer;
+  EXPECT_THAT(stream->Next(&buffer).status(),
+              StatusIs(util::error::FAILED_PRECONDITION));
+}
+
+TEST_F(TreeStreamingMacTest, InvalidOptions) {
+  TreeStreamingMac::Options options;
+  EXPECT_THAT(TreeStreamingMac::New(nullptr, options).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  options.chunk_size = 0;
+  EXPECT_THAT(TreeStreamingMac::New(NewFactory(), options).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  options.chunk_size = kChunkSize;
+  options.max_chunks_in_flight = 0;
+  EXPECT_THAT(TreeStreamingMac::New(NewFactory(), options).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
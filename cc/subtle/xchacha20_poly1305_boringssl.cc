@@ -16,14 +16,21 @@
 
 #include "tink/subtle/xchacha20_poly1305_boringssl.h"
 
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "openssl/crypto.h"
 #include "openssl/err.h"
 #include "openssl/evp.h"
+#include "openssl/mem.h"
+#include "openssl/poly1305.h"
 #include "tink/aead.h"
 #include "tink/config/tink_fips.h"
+#include "tink/subtle/chacha20_lanes.h"
 #include "tink/subtle/random.h"
 #include "tink/subtle/subtle_util.h"
 #include "tink/subtle/subtle_util_boringssl.h"
@@ -36,9 +43,152 @@ namespace tink {
 namespace subtle {
 
 namespace {
+
+constexpr int kLanes = ChaCha20Lanes::kLanes;
+constexpr int kPoly1305TagSize = 16;
+
 const bool IsValidKeySize(uint32_t size_in_bytes) {
   return size_in_bytes == 32;
 }
+
+// One message of a batch which is processed in a lane.
+struct LaneMessage {
+  // The plaintext, or the ciphertext without nonce and tag.
+  absl::string_view input;
+  absl::string_view associated_data;
+  // The 24-byte XChaCha20 nonce.
+  const uint8_t* nonce;
+  // Receives input.size() bytes. When sealing, the tag is written after
+  // them; when opening, it follows the input.
+  uint8_t* output;
+};
+
+uint8_t* ToUint8(char* data) { return reinterpret_cast<uint8_t*>(data); }
+
+const uint8_t* ToUint8(const char* data) {
+  return reinterpret_cast<const uint8_t*>(data);
+}
+
+void StoreLe64(uint64_t value, uint8_t* out) {
+  for (int i = 0; i < 8; i++) out[i] = value >> (8 * i);
+}
+
+// Derives the subkeys of 'messages' and sets up their lanes in 'lanes', and
+// writes the first keystream block of each lane, whose first 32 bytes are
+// the one-time Poly1305 key, to poly_keys.
+void SetUpLanes(const uint8_t* key, absl::Span<const LaneMessage> messages,
+                ChaCha20Lanes* lanes,
+                uint8_t poly_keys[kLanes][ChaCha20Lanes::kBlockSize]) {
+  uint8_t hchacha_nonces[kLanes][ChaCha20Lanes::kHChaCha20NonceSize] = {};
+  for (size_t i = 0; i < messages.size(); i++) {
+    std::memcpy(hchacha_nonces[i], messages[i].nonce,
+                ChaCha20Lanes::kHChaCha20NonceSize);
+  }
+  uint8_t subkeys[kLanes][ChaCha20Lanes::kKeySize];
+  ChaCha20Lanes::HChaCha20(key, hchacha_nonces, subkeys);
+  for (size_t i = 0; i < messages.size(); i++) {
+    // The ChaCha20 nonce is 4 zero bytes and the last 8 bytes of the
+    // XChaCha20 nonce.
+    uint8_t nonce[ChaCha20Lanes::kNonceSize] = {};
+    std::memcpy(nonce + 4, messages[i].nonce + 16, 8);
+    lanes->SetLane(i, subkeys[i], nonce);
+  }
+  OPENSSL_cleanse(subkeys, sizeof(subkeys));
+  lanes->Blocks(0, poly_keys);
+}
+
+// XORs the keystream of each lane, from block 1 on, into the input of its
+// message and writes the result to the output.
+void XorKeyStream(const ChaCha20Lanes& lanes,
+                  absl::Span<const LaneMessage> messages) {
+  size_t max_size = 0;
+  for (const auto& message : messages) {
+    max_size = std::max(max_size, message.input.size());
+  }
+  uint8_t blocks[kLanes][ChaCha20Lanes::kBlockSize];
+  uint32_t counter = 1;
+  for (size_t offset = 0; offset < max_size;
+       offset += ChaCha20Lanes::kBlockSize, counter++) {
+    lanes.Blocks(counter, blocks);
+    for (size_t i = 0; i < messages.size(); i++) {
+      const LaneMessage& message = messages[i];
+      if (offset >= message.input.size()) continue;
+      size_t size = std::min<size_t>(ChaCha20Lanes::kBlockSize,
+                                     message.input.size() - offset);
+      const uint8_t* in = ToUint8(message.input.data()) + offset;
+      for (size_t j = 0; j < size; j++) {
+        message.output[offset + j] = in[j] ^ blocks[i][j];
+      }
+    }
+  }
+  OPENSSL_cleanse(blocks, sizeof(blocks));
+}
+
+// Computes the Poly1305 tag of RFC 8439 over 'associated_data' and the
+// encrypted message 'ciphertext'.
+void ComputeTag(const uint8_t poly_key[32], absl::string_view associated_data,
+                const uint8_t* ciphertext, size_t ciphertext_size,
+                uint8_t tag[kPoly1305TagSize]) {
+  static const uint8_t kPadding[16] = {0};
+  poly1305_state state;
+  CRYPTO_poly1305_init(&state, poly_key);
+  if (!associated_data.empty()) {
+    CRYPTO_poly1305_update(&state, ToUint8(associated_data.data()),
+                           associated_data.size());
+    if (associated_data.size() % 16 != 0) {
+      CRYPTO_poly1305_update(&state, kPadding,
+                             16 - associated_data.size() % 16);
+    }
+  }
+  if (ciphertext_size > 0) {
+    CRYPTO_poly1305_update(&state, ciphertext, ciphertext_size);
+    if (ciphertext_size % 16 != 0) {
+      CRYPTO_poly1305_update(&state, kPadding, 16 - ciphertext_size % 16);
+    }
+  }
+  uint8_t lengths[16];
+  StoreLe64(associated_data.size(), lengths);
+  StoreLe64(ciphertext_size, lengths + 8);
+  CRYPTO_poly1305_update(&state, lengths, sizeof(lengths));
+  CRYPTO_poly1305_finish(&state, tag);
+}
+
+// Encrypts up to kLanes messages at once.
+void SealLanes(const uint8_t* key, absl::Span<const LaneMessage> messages) {
+  ChaCha20Lanes lanes;
+  uint8_t poly_keys[kLanes][ChaCha20Lanes::kBlockSize];
+  SetUpLanes(key, messages, &lanes, poly_keys);
+  XorKeyStream(lanes, messages);
+  for (size_t i = 0; i < messages.size(); i++) {
+    const LaneMessage& message = messages[i];
+    ComputeTag(poly_keys[i], message.associated_data, message.output,
+               message.input.size(), message.output + message.input.size());
+  }
+  OPENSSL_cleanse(poly_keys, sizeof(poly_keys));
+}
+
+// Decrypts up to kLanes messages at once. Returns false, without writing
+// any plaintext, if a tag is invalid.
+bool OpenLanes(const uint8_t* key, absl::Span<const LaneMessage> messages) {
+  ChaCha20Lanes lanes;
+  uint8_t poly_keys[kLanes][ChaCha20Lanes::kBlockSize];
+  SetUpLanes(key, messages, &lanes, poly_keys);
+  bool valid = true;
+  for (size_t i = 0; i < messages.size(); i++) {
+    const LaneMessage& message = messages[i];
+    const uint8_t* ciphertext = ToUint8(message.input.data());
+    uint8_t tag[kPoly1305TagSize];
+    ComputeTag(poly_keys[i], message.associated_data, ciphertext,
+               message.input.size(), tag);
+    valid &= CRYPTO_memcmp(tag, ciphertext + message.input.size(),
+                           kPoly1305TagSize) == 0;
+  }
+  OPENSSL_cleanse(poly_keys, sizeof(poly_keys));
+  if (!valid) return false;
+  XorKeyStream(lanes, messages);
+  return true;
+}
+
 }  // namespace
 
 util::StatusOr<std::unique_ptr<Aead>> XChacha20Poly1305BoringSsl::New(
@@ -54,42 +204,67 @@ util::StatusOr<std::unique_ptr<Aead>> XChacha20Poly1305BoringSsl::New(
   if (cipher == nullptr) {
     return util::Status(util::error::INTERNAL, "Failed to get EVP_AEAD");
   }
+  bssl::UniquePtr<EVP_AEAD_CTX> ctx(
+      EVP_AEAD_CTX_new(cipher, reinterpret_cast<const uint8_t*>(key.data()),
+                       key.size(), kTagSize));
+  if (ctx.get() == nullptr) {
+    return util::Status(util::error::INTERNAL,
+                        "could not initialize EVP_AEAD_CTX");
+  }
   return std::unique_ptr<Aead>(
-      new XChacha20Poly1305BoringSsl(std::move(key), cipher));
+      new XChacha20Poly1305BoringSsl(std::move(ctx), std::move(key)));
 }
 
 util::StatusOr<std::string> XChacha20Poly1305BoringSsl::Encrypt(
     absl::string_view plaintext, absl::string_view additional_data) const {
-  bssl::UniquePtr<EVP_AEAD_CTX> ctx(
-      EVP_AEAD_CTX_new(aead_, reinterpret_cast<const uint8_t*>(key_.data()),
-                       key_.size(), kTagSize));
-  if (ctx.get() == nullptr) {
-    return util::Status(util::error::INTERNAL,
-                        "could not initialize EVP_AEAD_CTX");
+  std::string ct;
+  ResizeStringUninitialized(&ct, kNonceSize + plaintext.size() + kTagSize);
+  auto written_result =
+      EncryptInto(plaintext, additional_data, absl::MakeSpan(ct));
+  if (!written_result.ok()) return written_result.status();
+  return ct;
+}
+
+util::StatusOr<std::string> XChacha20Poly1305BoringSsl::Decrypt(
+    absl::string_view ciphertext, absl::string_view additional_data) const {
+  if (ciphertext.size() < kNonceSize + kTagSize) {
+    return util::CiphertextTooShortError();
   }
+  std::string out;
+  ResizeStringUninitialized(&out, ciphertext.size() - kNonceSize - kTagSize);
+  auto written_result =
+      DecryptInto(ciphertext, additional_data, absl::MakeSpan(out));
+  if (!written_result.ok()) return written_result.status();
+  return out;
+}
+
+util::StatusOr<int64_t> XChacha20Poly1305BoringSsl::CiphertextSize(
+    int64_t plaintext_size) const {
+  return kNonceSize + plaintext_size + kTagSize;
+}
 
+util::StatusOr<int64_t> XChacha20Poly1305BoringSsl::EncryptInto(
+    absl::string_view plaintext, absl::string_view additional_data,
+    absl::Span<char> buffer) const {
   // BoringSSL expects a non-null pointer for plaintext and additional_data,
   // regardless of whether the size is 0.
   plaintext = SubtleUtilBoringSSL::EnsureNonNull(plaintext);
   additional_data = SubtleUtilBoringSSL::EnsureNonNull(additional_data);
 
-  const std::string nonce = Random::GetRandomBytes(kNonceSize);
-  if (nonce.size() != kNonceSize) {
-    return util::Status(util::error::INTERNAL,
-                        "Failed to get enough random bytes for nonce");
+  size_t ciphertext_size = kNonceSize + plaintext.size() + kTagSize;
+  if (buffer.size() < ciphertext_size) {
+    return util::Status(util::error::INVALID_ARGUMENT, "Buffer too small");
   }
 
-  size_t ciphertext_size = nonce.size() + plaintext.size() + kTagSize;
-
   // Write the nonce in the output buffer.
-  std::string ct = nonce;
-  ResizeStringUninitialized(&ct, ciphertext_size);
+  absl::Span<char> nonce = buffer.subspan(0, kNonceSize);
+  Random::GetRandomBytes(nonce);
   size_t written = nonce.size();
 
   // Encrypt the plaintext and store it after the nonce.
   size_t out_len = 0;
   int ret = EVP_AEAD_CTX_seal(
-      ctx.get(), reinterpret_cast<uint8_t*>(&ct[written]), &out_len,
+      ctx_.get(), reinterpret_cast<uint8_t*>(&buffer[written]), &out_len,
       ciphertext_size - written, reinterpret_cast<const uint8_t*>(nonce.data()),
       nonce.size(), reinterpret_cast<const uint8_t*>(plaintext.data()),
       plaintext.size(),
@@ -104,30 +279,28 @@ util::StatusOr<std::string> XChacha20Poly1305BoringSsl::Encrypt(
   if (written != ciphertext_size) {
     return util::Status(util::error::INTERNAL, "Incorrect ciphertext size");
   }
-  return ct;
+  return written;
 }
 
-util::StatusOr<std::string> XChacha20Poly1305BoringSsl::Decrypt(
-    absl::string_view ciphertext, absl::string_view additional_data) const {
+util::StatusOr<int64_t> XChacha20Poly1305BoringSsl::DecryptInto(
+    absl::string_view ciphertext, absl::string_view additional_data,
+    absl::Span<char> buffer) const {
   // BoringSSL expects a non-null pointer for additional_data,
   // regardless of whether the size is 0.
   additional_data = SubtleUtilBoringSSL::EnsureNonNull(additional_data);
 
   if (ciphertext.size() < kNonceSize + kTagSize) {
-    return util::Status(util::error::INVALID_ARGUMENT, "Ciphertext too short");
-  }
-
-  bssl::UniquePtr<EVP_AEAD_CTX> ctx(
-      EVP_AEAD_CTX_new(aead_, reinterpret_cast<const uint8_t*>(key_.data()),
-                       key_.size(), kTagSize));
-  if (ctx.get() == nullptr) {
-    return util::Status(util::error::INTERNAL,
-                        "could not initialize EVP_AEAD_CTX");
+    return util::CiphertextTooShortError();
   }
-
-  std::string out;
   size_t out_size = ciphertext.size() - kNonceSize - kTagSize;
-  ResizeStringUninitialized(&out, out_size);
+  if (buffer.size() < out_size) {
+    return util::Status(util::error::INVALID_ARGUMENT, "Buffer too small");
+  }
+  // BoringSSL expects a non-null pointer for the output, regardless of
+  // whether the size is 0.
+  char dummy;
+  uint8_t* out = reinterpret_cast<uint8_t*>(
+      buffer.data() != nullptr ? buffer.data() : &dummy);
 
   absl::string_view nonce = ciphertext.substr(0, kNonceSize);
   absl::string_view encrypted =
@@ -135,7 +308,7 @@ util::StatusOr<std::string> XChacha20Poly1305BoringSsl::Decrypt(
 
   size_t len = 0;
   int ret = EVP_AEAD_CTX_open(
-      ctx.get(), reinterpret_cast<uint8_t*>(&out[0]), &len, out_size,
+      ctx_.get(), out, &len, out_size,
       reinterpret_cast<const uint8_t*>(nonce.data()), nonce.size(),
       reinterpret_cast<const uint8_t*>(encrypted.data()), encrypted.size(),
       reinterpret_cast<const uint8_t*>(additional_data.data()),
@@ -148,7 +321,89 @@ util::StatusOr<std::string> XChacha20Poly1305BoringSsl::Decrypt(
     return util::Status(util::error::INTERNAL, "Incorrect output size");
   }
 
-  return out;
+  return len;
+}
+
+util::Status XChacha20Poly1305BoringSsl::BatchEncrypt(
+    absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs,
+    std::string* arena, std::vector<absl::string_view>* ciphertexts) const {
+  std::vector<int64_t> sizes;
+  sizes.reserve(inputs.size());
+  int64_t total_size = 0;
+  for (const auto& input : inputs) {
+    sizes.push_back(kNonceSize + input.first.size() + kTagSize);
+    total_size += sizes.back();
+  }
+  ResizeStringUninitialized(arena, total_size);
+
+  std::vector<LaneMessage> messages;
+  messages.reserve(kLanes);
+  int64_t offset = 0;
+  for (size_t i = 0; i < inputs.size(); i++) {
+    char* out = &(*arena)[0] + offset;
+    offset += sizes[i];
+    if (inputs[i].first.size() > kMaxLaneMessageSize) {
+      auto written_result = EncryptInto(inputs[i].first, inputs[i].second,
+                                        absl::MakeSpan(out, sizes[i]));
+      if (!written_result.ok()) return written_result.status();
+      continue;
+    }
+    Random::FillRandomBytes(absl::MakeSpan(out, kNonceSize));
+    uint8_t* body = ToUint8(out) + kNonceSize;
+    messages.push_back({inputs[i].first, inputs[i].second, ToUint8(out), body});
+    if (messages.size() == kLanes) {
+      SealLanes(key_.data(), messages);
+      messages.clear();
+    }
+  }
+  if (!messages.empty()) SealLanes(key_.data(), messages);
+  SplitArena(*arena, sizes, ciphertexts);
+  return util::Status::OK;
+}
+
+util::Status XChacha20Poly1305BoringSsl::BatchDecrypt(
+    absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs,
+    std::string* arena, std::vector<absl::string_view>* plaintexts) const {
+  std::vector<int64_t> sizes;
+  sizes.reserve(inputs.size());
+  int64_t total_size = 0;
+  for (const auto& input : inputs) {
+    if (input.first.size() < kNonceSize + kTagSize) {
+      return util::CiphertextTooShortError();
+    }
+    sizes.push_back(input.first.size() - kNonceSize - kTagSize);
+    total_size += sizes.back();
+  }
+  ResizeStringUninitialized(arena, total_size);
+
+  std::vector<LaneMessage> messages;
+  messages.reserve(kLanes);
+  int64_t offset = 0;
+  for (size_t i = 0; i < inputs.size(); i++) {
+    char* out = &(*arena)[0] + offset;
+    offset += sizes[i];
+    absl::string_view ciphertext = inputs[i].first;
+    if (static_cast<size_t>(sizes[i]) > kMaxLaneMessageSize) {
+      auto written_result = DecryptInto(ciphertext, inputs[i].second,
+                                        absl::MakeSpan(out, sizes[i]));
+      if (!written_result.ok()) return written_result.status();
+      continue;
+    }
+    messages.push_back({ciphertext.substr(kNonceSize, sizes[i]),
+                        inputs[i].second, ToUint8(ciphertext.data()),
+                        ToUint8(out)});
+    if (messages.size() == kLanes) {
+      if (!OpenLanes(key_.data(), messages)) {
+        return util::AuthenticationFailedError();
+      }
+      messages.clear();
+    }
+  }
+  if (!messages.empty() && !OpenLanes(key_.data(), messages)) {
+    return util::AuthenticationFailedError();
+  }
+  SplitArena(*arena, sizes, plaintexts);
+  return util::Status::OK;
 }
 
 }  // namespace subtle
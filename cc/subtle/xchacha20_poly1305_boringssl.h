@@ -18,9 +18,13 @@
 #define TINK_SUBTLE_XCHACHA20_POLY1305_BORINGSSL_H_
 
 #include <memory>
+#include <string>
 #include <utility>
+#include <vector>
 
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "openssl/aead.h"
 #include "openssl/base.h"
 #include "tink/aead.h"
 #include "tink/config/tink_fips.h"
@@ -49,6 +53,31 @@ class XChacha20Poly1305BoringSsl : public Aead {
       absl::string_view ciphertext,
       absl::string_view additional_data) const override;
 
+  crypto::tink::util::StatusOr<int64_t> CiphertextSize(
+      int64_t plaintext_size) const override;
+
+  crypto::tink::util::StatusOr<int64_t> EncryptInto(
+      absl::string_view plaintext, absl::string_view additional_data,
+      absl::Span<char> buffer) const override;
+
+  crypto::tink::util::StatusOr<int64_t> DecryptInto(
+      absl::string_view ciphertext, absl::string_view additional_data,
+      absl::Span<char> buffer) const override;
+
+  // The batch methods process short messages in parallel SIMD lanes,
+  // including the derivation of their subkeys, see ChaCha20Lanes. Longer
+  // messages are processed one by one, as by EncryptInto() and
+  // DecryptInto().
+  crypto::tink::util::Status BatchEncrypt(
+      absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs,
+      std::string* arena,
+      std::vector<absl::string_view>* ciphertexts) const override;
+
+  crypto::tink::util::Status BatchDecrypt(
+      absl::Span<const std::pair<absl::string_view, absl::string_view>> inputs,
+      std::string* arena,
+      std::vector<absl::string_view>* plaintexts) const override;
+
   static constexpr crypto::tink::FipsCompatibility kFipsStatus =
       crypto::tink::FipsCompatibility::kNotFips;
 
@@ -57,11 +86,17 @@ class XChacha20Poly1305BoringSsl : public Aead {
   static constexpr int kNonceSize = 24;
   static constexpr int kTagSize = 16;
 
-  XChacha20Poly1305BoringSsl(util::SecretData key, const EVP_AEAD* aead)
-      : key_(std::move(key)), aead_(aead) {}
+  // Messages of up to this many bytes are processed in lanes by the batch
+  // methods. BoringSSL is as fast for longer ones.
+  static constexpr size_t kMaxLaneMessageSize = 1024;
+
+  XChacha20Poly1305BoringSsl(bssl::UniquePtr<EVP_AEAD_CTX> ctx,
+                             util::SecretData key)
+      : ctx_(std::move(ctx)), key_(std::move(key)) {}
 
+  const bssl::UniquePtr<EVP_AEAD_CTX> ctx_;
+  // For the batch methods.
   const util::SecretData key_;
-  const EVP_AEAD* const aead_;
 };
 
 }  // namespace subtle
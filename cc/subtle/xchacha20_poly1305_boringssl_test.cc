@@ -17,11 +17,15 @@
 #include "tink/subtle/xchacha20_poly1305_boringssl.h"
 
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "absl/strings/str_cat.h"
+#include "absl/types/span.h"
 #include "openssl/err.h"
+#include "tink/subtle/random.h"
 #include "tink/util/status.h"
 #include "tink/util/statusor.h"
 #include "tink/util/test_matchers.h"
@@ -32,6 +36,7 @@ namespace tink {
 namespace subtle {
 namespace {
 
+using ::crypto::tink::test::IsOk;
 using ::crypto::tink::test::StatusIs;
 
 TEST(XChacha20Poly1305BoringSslTest, TestBasic) {
@@ -55,6 +60,86 @@ TEST(XChacha20Poly1305BoringSslTest, TestBasic) {
   EXPECT_EQ(pt.ValueOrDie(), message);
 }
 
+TEST(XChacha20Poly1305BoringSslTest, TestEncryptIntoDecryptInto) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+
+  util::SecretData key = util::SecretDataFromStringView(test::HexDecodeOrDie(
+      "000102030405060708090a0b0c0d0e0f000102030405060708090a0b0c0d0e0f"));
+  auto res = XChacha20Poly1305BoringSsl::New(key);
+  ASSERT_TRUE(res.ok()) << res.status();
+  auto cipher = std::move(res.ValueOrDie());
+  std::string message = "Some data to encrypt.";
+  std::string aad = "Some data to authenticate.";
+
+  auto size_result = cipher->CiphertextSize(message.size());
+  ASSERT_TRUE(size_result.ok()) << size_result.status();
+  EXPECT_EQ(size_result.ValueOrDie(), message.size() + 24 + 16);
+
+  // Too small buffers are rejected.
+  std::string ct(size_result.ValueOrDie() - 1, '\0');
+  EXPECT_THAT(
+      cipher->EncryptInto(message, aad, absl::MakeSpan(ct)).status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+
+  ct.resize(size_result.ValueOrDie());
+  auto written = cipher->EncryptInto(message, aad, absl::MakeSpan(ct));
+  ASSERT_TRUE(written.ok()) << written.status();
+  EXPECT_EQ(written.ValueOrDie(), ct.size());
+
+  // Ciphertexts of EncryptInto() and Encrypt() are interchangeable.
+  auto pt = cipher->Decrypt(ct, aad);
+  ASSERT_TRUE(pt.ok()) << pt.status();
+  EXPECT_EQ(pt.ValueOrDie(), message);
+
+  std::string decrypted(message.size() - 1, '\0');
+  EXPECT_THAT(
+      cipher->DecryptInto(ct, aad, absl::MakeSpan(decrypted)).status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+  decrypted.resize(ct.size());
+  written = cipher->DecryptInto(ct, aad, absl::MakeSpan(decrypted));
+  ASSERT_TRUE(written.ok()) << written.status();
+  EXPECT_EQ(decrypted.substr(0, written.ValueOrDie()), message);
+
+  std::string ct2 = cipher->Encrypt(message, aad).ValueOrDie();
+  written = cipher->DecryptInto(ct2, aad, absl::MakeSpan(decrypted));
+  ASSERT_TRUE(written.ok()) << written.status();
+  EXPECT_EQ(decrypted.substr(0, written.ValueOrDie()), message);
+
+  // Modified ciphertexts fail.
+  ct[ct.size() - 1] ^= 1;
+  EXPECT_FALSE(cipher->DecryptInto(ct, aad, absl::MakeSpan(decrypted)).ok());
+}
+
+TEST(XChacha20Poly1305BoringSslTest, TestEncryptFragmentsInto) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+
+  util::SecretData key = util::SecretDataFromStringView(test::HexDecodeOrDie(
+      "000102030405060708090a0b0c0d0e0f000102030405060708090a0b0c0d0e0f"));
+  auto res = XChacha20Poly1305BoringSsl::New(key);
+  ASSERT_TRUE(res.ok()) << res.status();
+  auto cipher = std::move(res.ValueOrDie());
+  std::vector<absl::string_view> message = {"Some data", " to encrypt."};
+  std::vector<absl::string_view> aad = {"Some data to ", "authenticate."};
+  std::string ct(21 + 24 + 16, '\0');
+  std::vector<absl::Span<char>> buffers = {absl::MakeSpan(&ct[0], 30),
+                                           absl::MakeSpan(&ct[30], 31)};
+
+  auto written = cipher->EncryptFragmentsInto(message, aad, buffers);
+  ASSERT_TRUE(written.ok()) << written.status();
+  EXPECT_EQ(written.ValueOrDie(), ct.size());
+  auto pt = cipher->Decrypt(ct, "Some data to authenticate.");
+  ASSERT_TRUE(pt.ok()) << pt.status();
+  EXPECT_EQ(pt.ValueOrDie(), "Some data to encrypt.");
+
+  buffers.pop_back();
+  EXPECT_THAT(cipher->EncryptFragmentsInto(message, aad, buffers).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
 TEST(XChacha20Poly1305BoringSslTest, TestModification) {
   if (kUseOnlyFips) {
     GTEST_SKIP() << "Not supported in FIPS-only mode";
@@ -246,6 +331,106 @@ TEST(XChacha20Poly1305BoringSslTest, TestInvalidKeySizes) {
   }
 }
 
+// Plaintexts of all sizes up to a few blocks, and some which are too long
+// to be processed in lanes.
+std::vector<std::string> BatchPlaintexts() {
+  std::vector<std::string> plaintexts;
+  for (int size = 0; size < 200; size += 7) {
+    plaintexts.push_back(Random::GetRandomBytes(size));
+  }
+  plaintexts.push_back(Random::GetRandomBytes(1024));
+  plaintexts.push_back(Random::GetRandomBytes(1025));
+  plaintexts.push_back(Random::GetRandomBytes(5000));
+  return plaintexts;
+}
+
+TEST(XChacha20Poly1305BoringSslTest, TestBatchEncrypt) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+
+  util::SecretData key = util::SecretDataFromStringView(test::HexDecodeOrDie(
+      "000102030405060708090a0b0c0d0e0f000102030405060708090a0b0c0d0e0f"));
+  auto res = XChacha20Poly1305BoringSsl::New(key);
+  ASSERT_TRUE(res.ok()) << res.status();
+  auto cipher = std::move(res.ValueOrDie());
+
+  std::vector<std::string> plaintexts = BatchPlaintexts();
+  std::vector<std::string> aads;
+  std::vector<std::pair<absl::string_view, absl::string_view>> inputs;
+  for (size_t i = 0; i < plaintexts.size(); i++) {
+    aads.push_back(std::string(i % 20, 'a'));
+  }
+  for (size_t i = 0; i < plaintexts.size(); i++) {
+    inputs.push_back({plaintexts[i], aads[i]});
+  }
+
+  std::string arena;
+  std::vector<absl::string_view> ciphertexts;
+  ASSERT_THAT(cipher->BatchEncrypt(inputs, &arena, &ciphertexts), IsOk());
+  ASSERT_EQ(ciphertexts.size(), plaintexts.size());
+  for (size_t i = 0; i < plaintexts.size(); i++) {
+    EXPECT_EQ(ciphertexts[i].size(), plaintexts[i].size() + 24 + 16);
+    auto pt = cipher->Decrypt(ciphertexts[i], aads[i]);
+    ASSERT_TRUE(pt.ok()) << "size " << plaintexts[i].size() << ": "
+                         << pt.status();
+    EXPECT_EQ(pt.ValueOrDie(), plaintexts[i]);
+  }
+}
+
+TEST(XChacha20Poly1305BoringSslTest, TestBatchDecrypt) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+
+  util::SecretData key = util::SecretDataFromStringView(test::HexDecodeOrDie(
+      "000102030405060708090a0b0c0d0e0f000102030405060708090a0b0c0d0e0f"));
+  auto res = XChacha20Poly1305BoringSsl::New(key);
+  ASSERT_TRUE(res.ok()) << res.status();
+  auto cipher = std::move(res.ValueOrDie());
+
+  std::vector<std::string> plaintexts = BatchPlaintexts();
+  std::string aad = "Some data to authenticate.";
+  std::vector<std::string> ciphertexts;
+  for (const std::string& plaintext : plaintexts) {
+    auto ct = cipher->Encrypt(plaintext, aad);
+    ASSERT_TRUE(ct.ok()) << ct.status();
+    ciphertexts.push_back(ct.ValueOrDie());
+  }
+  std::vector<std::pair<absl::string_view, absl::string_view>> inputs;
+  for (const std::string& ciphertext : ciphertexts) {
+    inputs.push_back({ciphertext, aad});
+  }
+
+  std::string arena;
+  std::vector<absl::string_view> decrypted;
+  ASSERT_THAT(cipher->BatchDecrypt(inputs, &arena, &decrypted), IsOk());
+  ASSERT_EQ(decrypted.size(), plaintexts.size());
+  for (size_t i = 0; i < plaintexts.size(); i++) {
+    EXPECT_EQ(decrypted[i], plaintexts[i]);
+  }
+
+  // A modified ciphertext in any lane fails the whole batch.
+  for (size_t i : {0, 3, 9}) {
+    std::string modified = ciphertexts[i];
+    modified[modified.size() / 2] ^= 1;
+    auto modified_inputs = inputs;
+    modified_inputs[i].first = modified;
+    EXPECT_THAT(cipher->BatchDecrypt(modified_inputs, &arena, &decrypted),
+                StatusIs(util::error::INTERNAL));
+  }
+  auto modified_inputs = inputs;
+  modified_inputs[1].second = "Other data.";
+  EXPECT_THAT(cipher->BatchDecrypt(modified_inputs, &arena, &decrypted),
+              StatusIs(util::error::INTERNAL));
+
+  // So does a truncated one.
+  modified_inputs = inputs;
+  modified_inputs[2].first = ciphertexts[2].substr(0, 39);
+  EXPECT_THAT(cipher->BatchDecrypt(modified_inputs, &arena, &decrypted),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
 TEST(XChacha20Poly1305BoringSslTest, TestFipsOnly) {
   if (!kUseOnlyFips) {
     GTEST_SKIP() << "Only supported in FIPS-only mode";
@@ -0,0 +1,228 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/subtle/xchacha20_poly1305_hkdf_stream_segment_decrypter.h"
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <utility>
+
+#include "absl/algorithm/container.h"
+#include "absl/base/config.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "openssl/aead.h"
+#include "tink/subtle/common_enums.h"
+#include "tink/subtle/hkdf.h"
+#include "tink/subtle/subtle_util_boringssl.h"
+#include "tink/subtle/xchacha20_poly1305_hkdf_stream_segment_encrypter.h"
+#include "tink/util/status.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+namespace {
+
+using Encrypter = XChaCha20Poly1305HkdfStreamSegmentEncrypter;
+
+uint32_t ByteSwap(uint32_t val) {
+  return ((val & 0xff000000) >> 24) | ((val & 0x00ff0000) >> 8) |
+         ((val & 0x0000ff00) << 8) | ((val & 0x000000ff) << 24);
+}
+
+void BigEndianStore32(uint8_t dst[4], uint32_t val) {
+#if defined(ABSL_IS_LITTLE_ENDIAN)
+  val = ByteSwap(val);
+#elif !defined(ABSL_IS_BIG_ENDIAN)
+#error Unknown endianness
+#endif
+  std::memcpy(dst, &val, sizeof(val));
+}
+
+util::Status Validate(
+    const XChaCha20Poly1305HkdfStreamSegmentDecrypter::Params& params) {
+  if (params.ikm == nullptr) {
+    return util::Status(util::error::INVALID_ARGUMENT, "ikm must be non-null");
+  }
+  if (!(params.hkdf_hash == SHA1 || params.hkdf_hash == SHA256 ||
+        params.hkdf_hash == SHA512)) {
+    return util::Status(util::error::INVALID_ARGUMENT, "unsupported hkdf_hash");
+  }
+  if (params.ikm->size() < Encrypter::kKeySizeInBytes) {
+    return util::Status(util::error::INVALID_ARGUMENT, "ikm too small");
+  }
+  if (params.ciphertext_offset < 0) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "ciphertext_offset must be non-negative");
+  }
+  if (params.ciphertext_segment_size <=
+      params.ciphertext_offset + Encrypter::kHeaderSizeInBytes +
+          Encrypter::kTagSizeInBytes) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "ciphertext_segment_size too small");
+  }
+  return util::OkStatus();
+}
+
+}  // namespace
+
+XChaCha20Poly1305HkdfStreamSegmentDecrypter::
+    XChaCha20Poly1305HkdfStreamSegmentDecrypter(Params params)
+    : ikm_(std::move(params.ikm)),
+      hkdf_hash_(params.hkdf_hash),
+      ciphertext_offset_(params.ciphertext_offset),
+      ciphertext_segment_size_(params.ciphertext_segment_size),
+      associated_data_(std::move(params.associated_data)) {}
+
+// static
+util::StatusOr<std::unique_ptr<StreamSegmentDecrypter>>
+XChaCha20Poly1305HkdfStreamSegmentDecrypter::New(Params params) {
+  auto status = Validate(params);
+  if (!status.ok()) return status;
+  return {absl::WrapUnique(
+      new XChaCha20Poly1305HkdfStreamSegmentDecrypter(std::move(params)))};
+}
+
+util::Status XChaCha20Poly1305HkdfStreamSegmentDecrypter::Init(
+    const std::vector<uint8_t>& header) {
+  if (is_initialized_) {
+    return util::Status(util::error::FAILED_PRECONDITION,
+                        "decrypter already initialized");
+  }
+  if (header.size() != Encrypter::kHeaderSizeInBytes) {
+    return util::Status(
+        util::error::INVALID_ARGUMENT,
+        absl::StrCat("wrong header size, expected ",
+                     Encrypter::kHeaderSizeInBytes, " bytes"));
+  }
+  if (header[0] != Encrypter::kHeaderSizeInBytes) {
+    return util::Status(util::error::INVALID_ARGUMENT, "corrupted header");
+  }
+  absl::string_view salt(reinterpret_cast<const char*>(header.data()) + 1,
+                         Encrypter::kKeySizeInBytes);
+  nonce_prefix_.assign(header.begin() + 1 + Encrypter::kKeySizeInBytes,
+                       header.end());
+
+  auto hkdf_result = Hkdf::ComputeHkdf(hkdf_hash_, *ikm_, salt,
+                                       associated_data_,
+                                       Encrypter::kKeySizeInBytes);
+  if (!hkdf_result.ok()) return hkdf_result.status();
+  util::SecretData key = std::move(hkdf_result).ValueOrDie();
+  if (!EVP_AEAD_CTX_init(ctx_.get(), EVP_aead_xchacha20_poly1305(),
+                         key.data(), key.size(), Encrypter::kTagSizeInBytes,
+                         /* engine = */ nullptr)) {
+    return util::Status(util::error::INTERNAL,
+                        "could not initialize EVP_AEAD_CTX");
+  }
+  is_initialized_ = true;
+  return util::OkStatus();
+}
+
+int XChaCha20Poly1305HkdfStreamSegmentDecrypter::get_header_size() const {
+  return Encrypter::kHeaderSizeInBytes;
+}
+
+int XChaCha20Poly1305HkdfStreamSegmentDecrypter::get_plaintext_segment_size()
+    const {
+  return ciphertext_segment_size_ - Encrypter::kTagSizeInBytes;
+}
+
+util::Status XChaCha20Poly1305HkdfStreamSegmentDecrypter::DecryptSegment(
+    const std::vector<uint8_t>& ciphertext,
+    int64_t segment_number,
+    bool is_last_segment,
+    std::vector<uint8_t>* plaintext_buffer) {
+  auto status =
+      CheckSegment(ciphertext.size(), segment_number, is_last_segment);
+  if (!status.ok()) return status;
+  if (plaintext_buffer == nullptr) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "plaintext_buffer must be non-null");
+  }
+  plaintext_buffer->resize(ciphertext.size() - Encrypter::kTagSizeInBytes);
+  return Open(ciphertext.data(), ciphertext.size(), segment_number,
+              is_last_segment, plaintext_buffer->data());
+}
+
+util::Status XChaCha20Poly1305HkdfStreamSegmentDecrypter::DecryptSegmentInPlace(
+    int64_t segment_number, bool is_last_segment,
+    std::vector<uint8_t>* segment) {
+  if (segment == nullptr) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "segment must be non-null");
+  }
+  auto status = CheckSegment(segment->size(), segment_number, is_last_segment);
+  if (!status.ok()) return status;
+  status = Open(segment->data(), segment->size(), segment_number,
+                is_last_segment, segment->data());
+  if (!status.ok()) return status;
+  segment->resize(segment->size() - Encrypter::kTagSizeInBytes);
+  return util::OkStatus();
+}
+
+util::Status XChaCha20Poly1305HkdfStreamSegmentDecrypter::CheckSegment(
+    size_t ciphertext_size, int64_t segment_number,
+    bool is_last_segment) const {
+  if (!is_initialized_) {
+    return util::Status(util::error::FAILED_PRECONDITION,
+                        "decrypter not initialized");
+  }
+  if (ciphertext_size > get_ciphertext_segment_size()) {
+    return util::Status(util::error::INVALID_ARGUMENT, "ciphertext too long");
+  }
+  if (ciphertext_size < Encrypter::kTagSizeInBytes) {
+    return util::Status(util::error::INVALID_ARGUMENT, "ciphertext too short");
+  }
+  if (segment_number > std::numeric_limits<uint32_t>::max() ||
+      (segment_number == std::numeric_limits<uint32_t>::max() &&
+       !is_last_segment)) {
+    return util::Status(util::error::INVALID_ARGUMENT, "too many segments");
+  }
+  return util::OkStatus();
+}
+
+util::Status XChaCha20Poly1305HkdfStreamSegmentDecrypter::Open(
+    const uint8_t* ciphertext, size_t ciphertext_size, int64_t segment_number,
+    bool is_last_segment, uint8_t* plaintext) const {
+  size_t pt_size = ciphertext_size - Encrypter::kTagSizeInBytes;
+  uint8_t nonce[Encrypter::kNonceSizeInBytes];
+  absl::c_copy(nonce_prefix_, nonce);
+  BigEndianStore32(nonce + Encrypter::kNoncePrefixSizeInBytes,
+                   static_cast<uint32_t>(segment_number));
+  nonce[Encrypter::kNonceSizeInBytes - 1] = is_last_segment ? 1 : 0;
+
+  // EVP_AEAD_CTX_open() supports decrypting in place.
+  size_t out_len;
+  if (!EVP_AEAD_CTX_open(ctx_.get(), plaintext, &out_len, pt_size, nonce,
+                         sizeof(nonce), ciphertext, ciphertext_size,
+                         /* ad = */ nullptr, /* ad.length() = */ 0)) {
+    return util::Status(util::error::INTERNAL,
+                        absl::StrCat("Decryption failed: ",
+                                     SubtleUtilBoringSSL::GetErrors()));
+  }
+  if (out_len != pt_size) {
+    return util::Status(util::error::INTERNAL, "incorrect plaintext size");
+  }
+  return util::OkStatus();
+}
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
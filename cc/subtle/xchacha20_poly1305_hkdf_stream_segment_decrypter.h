@@ -0,0 +1,114 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_SUBTLE_XCHACHA20_POLY1305_HKDF_STREAM_SEGMENT_DECRYPTER_H_
+#define TINK_SUBTLE_XCHACHA20_POLY1305_HKDF_STREAM_SEGMENT_DECRYPTER_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "openssl/aead.h"
+#include "tink/subtle/common_enums.h"
+#include "tink/subtle/stream_segment_decrypter.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+// StreamSegmentDecrypter for streaming decryption using XChaCha20-Poly1305
+// with HKDF as key derivation function.
+//
+// See XChaCha20Poly1305HkdfStreamSegmentEncrypter for the format of the
+// ciphertexts.
+class XChaCha20Poly1305HkdfStreamSegmentDecrypter
+    : public StreamSegmentDecrypter {
+ public:
+  // All sizes are in bytes.
+  struct Params {
+    // The key derivation key, shared by the decrypters of one key.
+    std::shared_ptr<const util::SecretData> ikm;
+    HashType hkdf_hash;
+    int ciphertext_offset;
+    int ciphertext_segment_size;
+    std::string associated_data;
+  };
+
+  // A factory.
+  static util::StatusOr<std::unique_ptr<StreamSegmentDecrypter>> New(
+      Params params);
+
+  // Overridden methods of StreamSegmentDecrypter.
+  util::Status Init(const std::vector<uint8_t>& header) override;
+
+  util::Status DecryptSegment(
+      const std::vector<uint8_t>& ciphertext,
+      int64_t segment_number,
+      bool is_last_segment,
+      std::vector<uint8_t>* plaintext_buffer) override;
+
+  util::Status DecryptSegmentInPlace(int64_t segment_number,
+                                     bool is_last_segment,
+                                     std::vector<uint8_t>* segment) override;
+
+  int get_header_size() const override;
+
+  int get_plaintext_segment_size() const override;
+
+  int get_ciphertext_segment_size() const override {
+    return ciphertext_segment_size_;
+  }
+  int get_ciphertext_offset() const override {
+    return ciphertext_offset_;
+  }
+
+ private:
+  explicit XChaCha20Poly1305HkdfStreamSegmentDecrypter(Params params);
+
+  // Returns an error if a ciphertext of 'ciphertext_size' bytes cannot be
+  // decrypted as the specified segment.
+  util::Status CheckSegment(size_t ciphertext_size, int64_t segment_number,
+                            bool is_last_segment) const;
+
+  // Decrypts 'ciphertext_size' bytes at 'ciphertext' as the specified segment,
+  // and writes the plaintext of ciphertext_size - kTagSizeInBytes bytes
+  // to 'plaintext', which may be equal to 'ciphertext'.
+  util::Status Open(const uint8_t* ciphertext, size_t ciphertext_size,
+                    int64_t segment_number, bool is_last_segment,
+                    uint8_t* plaintext) const;
+
+  // Parameters set upon decrypter creation.
+  const std::shared_ptr<const util::SecretData> ikm_;
+  const HashType hkdf_hash_;
+  const int ciphertext_offset_;
+  const int ciphertext_segment_size_;
+  const std::string associated_data_;
+
+  // Parameters set when initializing with data from stream header.
+  bool is_initialized_ = false;
+  std::vector<uint8_t> nonce_prefix_;
+  bssl::ScopedEVP_AEAD_CTX ctx_;
+};
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_SUBTLE_XCHACHA20_POLY1305_HKDF_STREAM_SEGMENT_DECRYPTER_H_
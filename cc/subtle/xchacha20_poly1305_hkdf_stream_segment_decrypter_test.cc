@@ -0,0 +1,208 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/subtle/xchacha20_poly1305_hkdf_stream_segment_decrypter.h"
+
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "tink/subtle/common_enums.h"
+#include "tink/subtle/hkdf.h"
+#include "tink/subtle/random.h"
+#include "tink/subtle/stream_segment_encrypter.h"
+#include "tink/subtle/xchacha20_poly1305_hkdf_stream_segment_encrypter.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "tink/util/test_matchers.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+namespace {
+
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::testing::ElementsAreArray;
+using ::testing::Eq;
+
+using Decrypter = XChaCha20Poly1305HkdfStreamSegmentDecrypter;
+using Encrypter = XChaCha20Poly1305HkdfStreamSegmentEncrypter;
+
+util::StatusOr<std::unique_ptr<StreamSegmentEncrypter>> GetEncrypter(
+    const util::SecretData& ikm, HashType hkdf_hash, int ciphertext_offset,
+    int ciphertext_segment_size, absl::string_view associated_data) {
+  Encrypter::Params params;
+  params.salt = Random::GetRandomBytes(Encrypter::kKeySizeInBytes);
+  auto hkdf_result = Hkdf::ComputeHkdf(hkdf_hash, ikm, params.salt,
+                                       associated_data,
+                                       Encrypter::kKeySizeInBytes);
+  if (!hkdf_result.ok()) return hkdf_result.status();
+  params.key = hkdf_result.ValueOrDie();
+  params.ciphertext_offset = ciphertext_offset;
+  params.ciphertext_segment_size = ciphertext_segment_size;
+  return Encrypter::New(std::move(params));
+}
+
+Decrypter::Params GetParams(const util::SecretData& ikm, HashType hkdf_hash,
+                            int ciphertext_offset,
+                            int ciphertext_segment_size,
+                            absl::string_view associated_data) {
+  Decrypter::Params params;
+  params.ikm = std::make_shared<const util::SecretData>(ikm);
+  params.hkdf_hash = hkdf_hash;
+  params.ciphertext_offset = ciphertext_offset;
+  params.ciphertext_segment_size = ciphertext_segment_size;
+  params.associated_data = std::string(associated_data);
+  return params;
+}
+
+TEST(XChaCha20Poly1305HkdfStreamSegmentDecrypterTest, DecryptsSegments) {
+  for (HashType hkdf_hash : {SHA1, SHA256, SHA512}) {
+    for (int ciphertext_offset : {0, 5, 10}) {
+      for (int ct_segment_size : {100, 128, 200}) {
+        for (std::string associated_data : {"associated data", ""}) {
+          SCOPED_TRACE(absl::StrCat(
+              "hkdf_hash = ", EnumToString(hkdf_hash),
+              ", ciphertext_offset = ", ciphertext_offset,
+              ", ciphertext_segment_size = ", ct_segment_size,
+              ", associated_data = '", associated_data, "'"));
+          util::SecretData ikm = Random::GetRandomKeyBytes(32);
+          auto result = Decrypter::New(GetParams(
+              ikm, hkdf_hash, ciphertext_offset, ct_segment_size,
+              associated_data));
+          ASSERT_THAT(result.status(), IsOk());
+          auto decrypter = std::move(result.ValueOrDie());
+          EXPECT_THAT(decrypter->get_header_size(),
+                      Eq(Encrypter::kHeaderSizeInBytes));
+
+          // Not initialized yet.
+          std::vector<uint8_t> ciphertext(50), plaintext;
+          EXPECT_THAT(
+              decrypter->DecryptSegment(ciphertext, 0, false, &plaintext),
+              StatusIs(util::error::FAILED_PRECONDITION));
+
+          auto encrypter = std::move(
+              GetEncrypter(ikm, hkdf_hash, ciphertext_offset, ct_segment_size,
+                           associated_data)
+                  .ValueOrDie());
+          ASSERT_THAT(decrypter->Init(encrypter->get_header()), IsOk());
+          EXPECT_THAT(decrypter->Init(encrypter->get_header()),
+                      StatusIs(util::error::FAILED_PRECONDITION));
+          EXPECT_THAT(decrypter->get_plaintext_segment_size(),
+                      Eq(encrypter->get_plaintext_segment_size()));
+
+          for (int i = 0; i < 3; i++) {
+            bool is_last = i == 2;
+            std::string pt = Random::GetRandomBytes(
+                encrypter->get_plaintext_segment_size() - 3 * i);
+            std::vector<uint8_t> expected(pt.begin(), pt.end());
+            ASSERT_THAT(
+                encrypter->EncryptSegment(expected, is_last, &ciphertext),
+                IsOk());
+            ASSERT_THAT(
+                decrypter->DecryptSegment(ciphertext, i, is_last, &plaintext),
+                IsOk());
+            EXPECT_THAT(plaintext, ElementsAreArray(expected));
+
+            // The segment number and the last segment flag are
+            // authenticated.
+            EXPECT_FALSE(decrypter
+                             ->DecryptSegment(ciphertext, i + 1, is_last,
+                                              &plaintext)
+                             .ok());
+            EXPECT_FALSE(decrypter
+                             ->DecryptSegment(ciphertext, i, !is_last,
+                                              &plaintext)
+                             .ok());
+            ASSERT_THAT(
+                decrypter->DecryptSegmentInPlace(i, is_last, &ciphertext),
+                IsOk());
+            EXPECT_THAT(ciphertext, ElementsAreArray(expected));
+          }
+        }
+      }
+    }
+  }
+}
+
+TEST(XChaCha20Poly1305HkdfStreamSegmentDecrypterTest,
+     RejectsModifiedCiphertexts) {
+  util::SecretData ikm = Random::GetRandomKeyBytes(32);
+  auto encrypter =
+      std::move(GetEncrypter(ikm, SHA256, 0, 128, "ad").ValueOrDie());
+  std::vector<uint8_t> plaintext(70, 'p'), ciphertext;
+  ASSERT_THAT(encrypter->EncryptSegment(plaintext, true, &ciphertext), IsOk());
+
+  // Other associated data derives another key.
+  auto decrypter = std::move(
+      Decrypter::New(GetParams(ikm, SHA256, 0, 128, "other")).ValueOrDie());
+  ASSERT_THAT(decrypter->Init(encrypter->get_header()), IsOk());
+  EXPECT_FALSE(decrypter->DecryptSegment(ciphertext, 0, true, &plaintext).ok());
+
+  for (size_t i = 0; i < ciphertext.size(); i++) {
+    decrypter = std::move(
+        Decrypter::New(GetParams(ikm, SHA256, 0, 128, "ad")).ValueOrDie());
+    ASSERT_THAT(decrypter->Init(encrypter->get_header()), IsOk());
+    std::vector<uint8_t> modified = ciphertext;
+    modified[i] ^= 1;
+    EXPECT_FALSE(
+        decrypter->DecryptSegment(modified, 0, true, &plaintext).ok())
+        << i;
+  }
+}
+
+TEST(XChaCha20Poly1305HkdfStreamSegmentDecrypterTest, RejectsInvalidHeaders) {
+  util::SecretData ikm = Random::GetRandomKeyBytes(32);
+  auto encrypter =
+      std::move(GetEncrypter(ikm, SHA256, 0, 128, "ad").ValueOrDie());
+  std::vector<uint8_t> header = encrypter->get_header();
+  auto decrypter = std::move(
+      Decrypter::New(GetParams(ikm, SHA256, 0, 128, "ad")).ValueOrDie());
+  header[0]++;
+  EXPECT_THAT(decrypter->Init(header), StatusIs(util::error::INVALID_ARGUMENT));
+  header.pop_back();
+  EXPECT_THAT(decrypter->Init(header), StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(XChaCha20Poly1305HkdfStreamSegmentDecrypterTest, RejectsInvalidParams) {
+  util::SecretData ikm = Random::GetRandomKeyBytes(32);
+  EXPECT_THAT(Decrypter::New(GetParams(Random::GetRandomKeyBytes(16), SHA256,
+                                       0, 128, ""))
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(Decrypter::New(GetParams(ikm, UNKNOWN_HASH, 0, 128, "")).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(Decrypter::New(GetParams(ikm, SHA256, -1, 128, "")).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(
+      Decrypter::New(GetParams(ikm, SHA256, 10, 78, "")).status(),
+      StatusIs(util::error::INVALID_ARGUMENT));
+  Decrypter::Params params = GetParams(ikm, SHA256, 0, 128, "");
+  params.ikm = nullptr;
+  EXPECT_THAT(Decrypter::New(std::move(params)).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,200 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/subtle/xchacha20_poly1305_hkdf_stream_segment_encrypter.h"
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#include "absl/algorithm/container.h"
+#include "absl/base/config.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "openssl/aead.h"
+#include "tink/subtle/random.h"
+#include "tink/subtle/subtle_util_boringssl.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+namespace {
+
+uint32_t ByteSwap(uint32_t val) {
+  return ((val & 0xff000000) >> 24) | ((val & 0x00ff0000) >> 8) |
+         ((val & 0x0000ff00) << 8) | ((val & 0x000000ff) << 24);
+}
+
+void BigEndianStore32(uint8_t dst[4], uint32_t val) {
+#if defined(ABSL_IS_LITTLE_ENDIAN)
+  val = ByteSwap(val);
+#elif !defined(ABSL_IS_BIG_ENDIAN)
+#error Unknown endianness
+#endif
+  std::memcpy(dst, &val, sizeof(val));
+}
+
+util::Status Validate(
+    const XChaCha20Poly1305HkdfStreamSegmentEncrypter::Params& params) {
+  if (params.key.size() !=
+      XChaCha20Poly1305HkdfStreamSegmentEncrypter::kKeySizeInBytes) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "key must have 32 bytes");
+  }
+  if (params.key.size() != params.salt.size()) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "salt must have same size as the key");
+  }
+  if (!params.nonce_prefix.empty() &&
+      params.nonce_prefix.size() !=
+          XChaCha20Poly1305HkdfStreamSegmentEncrypter::
+              kNoncePrefixSizeInBytes) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "nonce_prefix has wrong size");
+  }
+  if (params.ciphertext_offset < 0) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "ciphertext_offset must be non-negative");
+  }
+  if (params.ciphertext_segment_size <=
+      params.ciphertext_offset +
+          XChaCha20Poly1305HkdfStreamSegmentEncrypter::kHeaderSizeInBytes +
+          XChaCha20Poly1305HkdfStreamSegmentEncrypter::kTagSizeInBytes) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "ciphertext_segment_size too small");
+  }
+  return util::OkStatus();
+}
+
+std::vector<uint8_t> CreateHeader(absl::string_view salt,
+                                  absl::string_view nonce_prefix) {
+  std::vector<uint8_t> header(
+      XChaCha20Poly1305HkdfStreamSegmentEncrypter::kHeaderSizeInBytes);
+  header[0] = static_cast<uint8_t>(header.size());
+  absl::c_copy(salt, header.begin() + 1);
+  absl::c_copy(nonce_prefix, header.begin() + 1 + salt.size());
+  return header;
+}
+
+}  // namespace
+
+XChaCha20Poly1305HkdfStreamSegmentEncrypter::
+    XChaCha20Poly1305HkdfStreamSegmentEncrypter(const Params& params)
+    : nonce_prefix_(params.nonce_prefix.empty()
+                        ? Random::GetRandomBytes(kNoncePrefixSizeInBytes)
+                        : params.nonce_prefix),
+      header_(CreateHeader(params.salt, nonce_prefix_)),
+      ciphertext_segment_size_(params.ciphertext_segment_size),
+      ciphertext_offset_(params.ciphertext_offset) {}
+
+// static
+util::StatusOr<std::unique_ptr<StreamSegmentEncrypter>>
+XChaCha20Poly1305HkdfStreamSegmentEncrypter::New(Params params) {
+  auto status = Validate(params);
+  if (!status.ok()) return status;
+  auto encrypter =
+      absl::WrapUnique(new XChaCha20Poly1305HkdfStreamSegmentEncrypter(params));
+  if (!EVP_AEAD_CTX_init(encrypter->ctx_.get(), EVP_aead_xchacha20_poly1305(),
+                         params.key.data(), params.key.size(),
+                         kTagSizeInBytes, /* engine = */ nullptr)) {
+    return util::Status(util::error::INTERNAL,
+                        "could not initialize EVP_AEAD_CTX");
+  }
+  return {std::move(encrypter)};
+}
+
+util::Status XChaCha20Poly1305HkdfStreamSegmentEncrypter::EncryptSegment(
+    const std::vector<uint8_t>& plaintext, bool is_last_segment,
+    std::vector<uint8_t>* ciphertext_buffer) {
+  auto status = EncryptSegmentAt(plaintext, get_segment_number(),
+                                 is_last_segment, ciphertext_buffer);
+  if (!status.ok()) return status;
+  IncSegmentNumber();
+  return util::OkStatus();
+}
+
+util::Status XChaCha20Poly1305HkdfStreamSegmentEncrypter::EncryptSegmentAt(
+    const std::vector<uint8_t>& plaintext, int64_t segment_number,
+    bool is_last_segment, std::vector<uint8_t>* ciphertext_buffer) const {
+  auto status =
+      CheckSegment(plaintext.size(), segment_number, is_last_segment);
+  if (!status.ok()) return status;
+  if (ciphertext_buffer == nullptr) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "ciphertext_buffer must be non-null");
+  }
+  ciphertext_buffer->resize(plaintext.size() + kTagSizeInBytes);
+  return Seal(plaintext.data(), plaintext.size(), segment_number,
+              is_last_segment, ciphertext_buffer->data());
+}
+
+util::Status XChaCha20Poly1305HkdfStreamSegmentEncrypter::EncryptSegmentInPlace(
+    int64_t segment_number, bool is_last_segment,
+    std::vector<uint8_t>* segment) const {
+  if (segment == nullptr) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "segment must be non-null");
+  }
+  size_t pt_size = segment->size();
+  auto status = CheckSegment(pt_size, segment_number, is_last_segment);
+  if (!status.ok()) return status;
+  segment->resize(pt_size + kTagSizeInBytes);
+  return Seal(segment->data(), pt_size, segment_number, is_last_segment,
+              segment->data());
+}
+
+util::Status XChaCha20Poly1305HkdfStreamSegmentEncrypter::CheckSegment(
+    size_t plaintext_size, int64_t segment_number,
+    bool is_last_segment) const {
+  if (plaintext_size > get_plaintext_segment_size()) {
+    return util::Status(util::error::INVALID_ARGUMENT, "plaintext too long");
+  }
+  if (segment_number > std::numeric_limits<uint32_t>::max() ||
+      (segment_number == std::numeric_limits<uint32_t>::max() &&
+       !is_last_segment)) {
+    return util::Status(util::error::INVALID_ARGUMENT, "too many segments");
+  }
+  return util::OkStatus();
+}
+
+util::Status XChaCha20Poly1305HkdfStreamSegmentEncrypter::Seal(
+    const uint8_t* plaintext, size_t plaintext_size, int64_t segment_number,
+    bool is_last_segment, uint8_t* ciphertext) const {
+  uint8_t nonce[kNonceSizeInBytes];
+  std::memcpy(nonce, nonce_prefix_.data(), kNoncePrefixSizeInBytes);
+  BigEndianStore32(nonce + kNoncePrefixSizeInBytes,
+                   static_cast<uint32_t>(segment_number));
+  nonce[kNonceSizeInBytes - 1] = is_last_segment ? 1 : 0;
+  size_t out_len;
+  // EVP_AEAD_CTX_seal() supports encrypting in place.
+  if (!EVP_AEAD_CTX_seal(ctx_.get(), ciphertext, &out_len,
+                         plaintext_size + kTagSizeInBytes, nonce,
+                         kNonceSizeInBytes, plaintext, plaintext_size,
+                         /* ad = */ nullptr, /* ad.length() = */ 0)) {
+    return util::Status(util::error::INTERNAL,
+                        absl::StrCat("Encryption failed: ",
+                                     SubtleUtilBoringSSL::GetErrors()));
+  }
+  return util::OkStatus();
+}
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,157 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_SUBTLE_XCHACHA20_POLY1305_HKDF_STREAM_SEGMENT_ENCRYPTER_H_
+#define TINK_SUBTLE_XCHACHA20_POLY1305_HKDF_STREAM_SEGMENT_ENCRYPTER_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "openssl/aead.h"
+#include "tink/subtle/stream_segment_encrypter.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+// StreamSegmentEncrypter for streaming encryption using XChaCha20-Poly1305
+// with HKDF as key derivation function.
+//
+// Each ciphertext uses a new XChaCha20-Poly1305 key that is derived from the
+// key derivation key, a randomly chosen salt of the same size as the key and
+// a nonce prefix. As ChaCha20 needs no AES instructions, this is the fast
+// choice on CPUs without them.
+//
+// The format of a ciphertext is the same as that of
+// AesGcmHkdfStreamSegmentEncrypter,
+//   header || segment_0 || segment_1 || ... || segment_k.
+// with the header
+//   header_size || salt || nonce_prefix
+// where
+//  - header_size is 1 byte determining the size of the header
+//  - salt is a salt used in the key derivation, of kKeySizeInBytes bytes
+//  - nonce_prefix is the prefix of the nonce, of kNoncePrefixSizeInBytes
+//    bytes
+class XChaCha20Poly1305HkdfStreamSegmentEncrypter
+    : public StreamSegmentEncrypter {
+ public:
+  // The size of the derived keys.
+  static constexpr int kKeySizeInBytes = 32;
+
+  // The size of the XChaCha20 nonces.
+  static constexpr int kNonceSizeInBytes = 24;
+
+  // The nonce has the format nonce_prefix || ctr || last_block, where:
+  //  - nonce_prefix is a constant of kNoncePrefixSizeInBytes bytes
+  //    for the whole file
+  //  - ctr is a 32 bit counter
+  //  - last_block is a byte equal to 1 for the last block of the file
+  //    and 0 otherwise.
+  static constexpr int kNoncePrefixSizeInBytes = 19;
+
+  // The size of the tags of each ciphertext segment.
+  static constexpr int kTagSizeInBytes = 16;
+
+  // The size of the header of a ciphertext.
+  static constexpr int kHeaderSizeInBytes =
+      1 + kKeySizeInBytes + kNoncePrefixSizeInBytes;
+
+  struct Params {
+    util::SecretData key;
+    std::string salt;
+    int ciphertext_offset;
+    int ciphertext_segment_size;
+    // The nonce prefix of the stream, which is chosen randomly if empty.
+    // Set only to resume an interrupted encryption, with the nonce prefix
+    // from the header of the earlier encrypter; must then have
+    // kNoncePrefixSizeInBytes bytes.
+    std::string nonce_prefix;
+  };
+
+  // A factory.
+  static util::StatusOr<std::unique_ptr<StreamSegmentEncrypter>> New(
+      Params params);
+
+  // Overridden methods of StreamSegmentEncrypter.
+  util::Status EncryptSegment(
+      const std::vector<uint8_t>& plaintext,
+      bool is_last_segment,
+      std::vector<uint8_t>* ciphertext_buffer) override;
+
+  util::Status EncryptSegmentAt(
+      const std::vector<uint8_t>& plaintext, int64_t segment_number,
+      bool is_last_segment,
+      std::vector<uint8_t>* ciphertext_buffer) const override;
+
+  util::Status EncryptSegmentInPlace(
+      int64_t segment_number, bool is_last_segment,
+      std::vector<uint8_t>* segment) const override;
+
+  const std::vector<uint8_t>& get_header() const override {
+    return header_;
+  }
+  int64_t get_segment_number() const override {
+    return segment_number_;
+  }
+  int get_plaintext_segment_size() const override {
+    return ciphertext_segment_size_ - kTagSizeInBytes;
+  }
+  int get_ciphertext_segment_size() const override {
+    return ciphertext_segment_size_;
+  }
+  int get_ciphertext_offset() const override {
+    return ciphertext_offset_;
+  }
+
+ protected:
+  void IncSegmentNumber() override {
+    segment_number_++;
+  }
+
+ private:
+  explicit XChaCha20Poly1305HkdfStreamSegmentEncrypter(const Params& params);
+
+  // Returns an error if a plaintext of 'plaintext_size' bytes cannot be
+  // encrypted as the specified segment.
+  util::Status CheckSegment(size_t plaintext_size, int64_t segment_number,
+                            bool is_last_segment) const;
+
+  // Encrypts 'plaintext_size' bytes at 'plaintext' as the specified segment,
+  // and writes the ciphertext of plaintext_size + kTagSizeInBytes bytes
+  // to 'ciphertext', which may be equal to 'plaintext'.
+  util::Status Seal(const uint8_t* plaintext, size_t plaintext_size,
+                    int64_t segment_number, bool is_last_segment,
+                    uint8_t* ciphertext) const;
+
+  bssl::ScopedEVP_AEAD_CTX ctx_;
+  const std::string nonce_prefix_;
+  const std::vector<uint8_t> header_;
+  const int ciphertext_segment_size_;
+  const int ciphertext_offset_;
+
+  int64_t segment_number_ = 0;
+};
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_SUBTLE_XCHACHA20_POLY1305_HKDF_STREAM_SEGMENT_ENCRYPTER_H_
@@ -0,0 +1,177 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/subtle/xchacha20_poly1305_hkdf_stream_segment_encrypter.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "tink/subtle/random.h"
+#include "tink/subtle/stream_segment_encrypter.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "tink/util/test_matchers.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+namespace {
+
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::testing::ElementsAreArray;
+using ::testing::Eq;
+
+using Encrypter = XChaCha20Poly1305HkdfStreamSegmentEncrypter;
+
+Encrypter::Params GetParams(int ciphertext_offset,
+                            int ciphertext_segment_size) {
+  Encrypter::Params params;
+  params.key = Random::GetRandomKeyBytes(Encrypter::kKeySizeInBytes);
+  params.salt = Random::GetRandomBytes(Encrypter::kKeySizeInBytes);
+  params.ciphertext_offset = ciphertext_offset;
+  params.ciphertext_segment_size = ciphertext_segment_size;
+  return params;
+}
+
+TEST(XChaCha20Poly1305HkdfStreamSegmentEncrypterTest, EncryptsSegments) {
+  for (int ciphertext_offset : {0, 5, 10}) {
+    for (int ct_segment_size : {100, 128, 4096}) {
+      Encrypter::Params params = GetParams(ciphertext_offset, ct_segment_size);
+      std::string salt = params.salt;
+      auto result = Encrypter::New(std::move(params));
+      ASSERT_THAT(result.status(), IsOk());
+      auto encrypter = std::move(result.ValueOrDie());
+
+      EXPECT_THAT(encrypter->get_ciphertext_offset(), Eq(ciphertext_offset));
+      EXPECT_THAT(encrypter->get_ciphertext_segment_size(),
+                  Eq(ct_segment_size));
+      EXPECT_THAT(encrypter->get_plaintext_segment_size(),
+                  Eq(ct_segment_size - Encrypter::kTagSizeInBytes));
+      const std::vector<uint8_t>& header = encrypter->get_header();
+      ASSERT_THAT(header.size(), Eq(Encrypter::kHeaderSizeInBytes));
+      EXPECT_THAT(header[0], Eq(Encrypter::kHeaderSizeInBytes));
+      EXPECT_THAT(std::string(header.begin() + 1,
+                              header.begin() + 1 + salt.size()),
+                  Eq(salt));
+
+      std::vector<uint8_t> ciphertext;
+      for (int i = 0; i < 3; i++) {
+        std::string pt = Random::GetRandomBytes(
+            encrypter->get_plaintext_segment_size() - i);
+        std::vector<uint8_t> plaintext(pt.begin(), pt.end());
+        EXPECT_THAT(encrypter->get_segment_number(), Eq(i));
+        ASSERT_THAT(encrypter->EncryptSegment(plaintext, i == 2, &ciphertext),
+                    IsOk());
+        EXPECT_THAT(ciphertext.size(),
+                    Eq(plaintext.size() + Encrypter::kTagSizeInBytes));
+
+        // Encrypting the same segment by number, or in place, gives the
+        // same ciphertext.
+        std::vector<uint8_t> at;
+        ASSERT_THAT(encrypter->EncryptSegmentAt(plaintext, i, i == 2, &at),
+                    IsOk());
+        EXPECT_THAT(at, ElementsAreArray(ciphertext));
+        ASSERT_THAT(encrypter->EncryptSegmentInPlace(i, i == 2, &plaintext),
+                    IsOk());
+        EXPECT_THAT(plaintext, ElementsAreArray(ciphertext));
+      }
+      EXPECT_THAT(encrypter->get_segment_number(), Eq(3));
+    }
+  }
+}
+
+TEST(XChaCha20Poly1305HkdfStreamSegmentEncrypterTest, UsesNoncePerSegment) {
+  auto encrypter =
+      std::move(Encrypter::New(GetParams(0, 128)).ValueOrDie());
+  std::vector<uint8_t> plaintext(50, 'p');
+  std::vector<uint8_t> first, second, last;
+  ASSERT_THAT(encrypter->EncryptSegmentAt(plaintext, 1, false, &first),
+              IsOk());
+  ASSERT_THAT(encrypter->EncryptSegmentAt(plaintext, 2, false, &second),
+              IsOk());
+  ASSERT_THAT(encrypter->EncryptSegmentAt(plaintext, 1, true, &last), IsOk());
+  EXPECT_NE(first, second);
+  EXPECT_NE(first, last);
+}
+
+TEST(XChaCha20Poly1305HkdfStreamSegmentEncrypterTest, ResumesWithNoncePrefix) {
+  Encrypter::Params params = GetParams(0, 128);
+  Encrypter::Params resumed_params = params;
+  auto encrypter = std::move(Encrypter::New(std::move(params)).ValueOrDie());
+  const std::vector<uint8_t>& header = encrypter->get_header();
+  resumed_params.nonce_prefix = std::string(
+      header.begin() + 1 + Encrypter::kKeySizeInBytes, header.end());
+  auto resumed =
+      std::move(Encrypter::New(std::move(resumed_params)).ValueOrDie());
+  EXPECT_THAT(resumed->get_header(), ElementsAreArray(header));
+
+  std::vector<uint8_t> plaintext(50, 'p');
+  std::vector<uint8_t> ciphertext, resumed_ciphertext;
+  ASSERT_THAT(encrypter->EncryptSegmentAt(plaintext, 7, false, &ciphertext),
+              IsOk());
+  ASSERT_THAT(
+      resumed->EncryptSegmentAt(plaintext, 7, false, &resumed_ciphertext),
+      IsOk());
+  EXPECT_THAT(resumed_ciphertext, ElementsAreArray(ciphertext));
+}
+
+TEST(XChaCha20Poly1305HkdfStreamSegmentEncrypterTest, RejectsInvalidParams) {
+  Encrypter::Params params = GetParams(0, 128);
+  params.key = Random::GetRandomKeyBytes(16);
+  EXPECT_THAT(Encrypter::New(params).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  params = GetParams(0, 128);
+  params.salt = "salt";
+  EXPECT_THAT(Encrypter::New(params).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  params = GetParams(0, 128);
+  params.nonce_prefix = "prefix";
+  EXPECT_THAT(Encrypter::New(params).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  params = GetParams(-1, 128);
+  EXPECT_THAT(Encrypter::New(params).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  params = GetParams(
+      0, Encrypter::kHeaderSizeInBytes + Encrypter::kTagSizeInBytes);
+  EXPECT_THAT(Encrypter::New(params).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(XChaCha20Poly1305HkdfStreamSegmentEncrypterTest, RejectsLongSegments) {
+  auto encrypter =
+      std::move(Encrypter::New(GetParams(0, 128)).ValueOrDie());
+  std::vector<uint8_t> plaintext(
+      encrypter->get_plaintext_segment_size() + 1, 'p');
+  std::vector<uint8_t> ciphertext;
+  EXPECT_THAT(encrypter->EncryptSegment(plaintext, false, &ciphertext),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(encrypter->EncryptSegmentInPlace(0, false, &plaintext),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  plaintext.resize(10);
+  EXPECT_THAT(encrypter->EncryptSegmentAt(
+                  plaintext, int64_t{1} << 32, true, &ciphertext),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,128 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/subtle/xchacha20_poly1305_hkdf_streaming.h"
+
+#include <cstdint>
+#include <string>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "tink/subtle/common_enums.h"
+#include "tink/subtle/hkdf.h"
+#include "tink/subtle/random.h"
+#include "tink/subtle/xchacha20_poly1305_hkdf_stream_segment_decrypter.h"
+#include "tink/subtle/xchacha20_poly1305_hkdf_stream_segment_encrypter.h"
+#include "tink/util/status.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+
+namespace {
+
+using Encrypter = XChaCha20Poly1305HkdfStreamSegmentEncrypter;
+
+util::Status Validate(const XChaCha20Poly1305HkdfStreaming::Params& params) {
+  if (!(params.hkdf_hash == SHA1 || params.hkdf_hash == SHA256 ||
+        params.hkdf_hash == SHA512)) {
+    return util::Status(util::error::INVALID_ARGUMENT, "unsupported hkdf_hash");
+  }
+  if (params.ikm.size() < Encrypter::kKeySizeInBytes) {
+    return util::Status(util::error::INVALID_ARGUMENT, "ikm too small");
+  }
+  if (params.ciphertext_offset < 0) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "ciphertext_offset must be non-negative");
+  }
+  if (params.ciphertext_segment_size <=
+      params.ciphertext_offset + Encrypter::kHeaderSizeInBytes +
+          Encrypter::kTagSizeInBytes) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "ciphertext_segment_size too small");
+  }
+  return util::OkStatus();
+}
+
+}  // namespace
+
+util::StatusOr<std::unique_ptr<XChaCha20Poly1305HkdfStreaming>>
+XChaCha20Poly1305HkdfStreaming::New(Params params) {
+  auto status = CheckFipsCompatibility<XChaCha20Poly1305HkdfStreaming>();
+  if (!status.ok()) return status;
+
+  status = Validate(params);
+  if (!status.ok()) return status;
+  return {absl::WrapUnique(
+      new XChaCha20Poly1305HkdfStreaming(std::move(params)))};
+}
+
+util::StatusOr<std::unique_ptr<StreamSegmentEncrypter>>
+XChaCha20Poly1305HkdfStreaming::NewEncrypter(
+    absl::string_view associated_data, std::string salt,
+    std::string nonce_prefix) const {
+  auto hkdf_result = Hkdf::ComputeHkdf(hkdf_hash_, *ikm_, salt,
+                                       associated_data,
+                                       Encrypter::kKeySizeInBytes);
+  if (!hkdf_result.ok()) return hkdf_result.status();
+  Encrypter::Params params;
+  params.key = std::move(hkdf_result).ValueOrDie();
+  params.salt = std::move(salt);
+  params.nonce_prefix = std::move(nonce_prefix);
+  params.ciphertext_offset = ciphertext_offset_;
+  params.ciphertext_segment_size = ciphertext_segment_size_;
+  return Encrypter::New(std::move(params));
+}
+
+util::StatusOr<std::unique_ptr<StreamSegmentEncrypter>>
+XChaCha20Poly1305HkdfStreaming::NewSegmentEncrypter(
+    absl::string_view associated_data) const {
+  // The salt and the nonce prefix, with a single call to the RNG.
+  std::string random_bytes = Random::GetRandomBytes(
+      Encrypter::kKeySizeInBytes + Encrypter::kNoncePrefixSizeInBytes);
+  return NewEncrypter(associated_data,
+                      random_bytes.substr(0, Encrypter::kKeySizeInBytes),
+                      random_bytes.substr(Encrypter::kKeySizeInBytes));
+}
+
+util::StatusOr<std::unique_ptr<StreamSegmentEncrypter>>
+XChaCha20Poly1305HkdfStreaming::NewSegmentEncrypterForHeader(
+    absl::string_view associated_data, absl::string_view header) const {
+  if (header.size() != Encrypter::kHeaderSizeInBytes ||
+      static_cast<uint8_t>(header[0]) != Encrypter::kHeaderSizeInBytes) {
+    return util::Status(util::error::INVALID_ARGUMENT, "Invalid header");
+  }
+  return NewEncrypter(
+      associated_data,
+      std::string(header.substr(1, Encrypter::kKeySizeInBytes)),
+      std::string(header.substr(1 + Encrypter::kKeySizeInBytes)));
+}
+
+util::StatusOr<std::unique_ptr<StreamSegmentDecrypter>>
+XChaCha20Poly1305HkdfStreaming::NewSegmentDecrypter(
+    absl::string_view associated_data) const {
+  XChaCha20Poly1305HkdfStreamSegmentDecrypter::Params params;
+  params.ikm = ikm_;
+  params.hkdf_hash = hkdf_hash_;
+  params.ciphertext_offset = ciphertext_offset_;
+  params.ciphertext_segment_size = ciphertext_segment_size_;
+  params.associated_data = std::string(associated_data);
+  return XChaCha20Poly1305HkdfStreamSegmentDecrypter::New(std::move(params));
+}
+
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,196 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/subtle/xchacha20_poly1305_hkdf_streaming.h"
+
+#include <sstream>
+#include <string>
+#include <utility>
+
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/str_cat.h"
+#include "tink/config/tink_fips.h"
+#include "tink/subtle/common_enums.h"
+#include "tink/subtle/random.h"
+#include "tink/subtle/streaming_aead_encrypting_stream.h"
+#include "tink/subtle/streaming_aead_test_util.h"
+#include "tink/subtle/test_util.h"
+#include "tink/util/istream_input_stream.h"
+#include "tink/util/ostream_output_stream.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "tink/util/test_matchers.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+namespace {
+
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+
+XChaCha20Poly1305HkdfStreaming::Params GetParams(int ciphertext_segment_size,
+                                                 int ciphertext_offset) {
+  XChaCha20Poly1305HkdfStreaming::Params params;
+  params.ikm = Random::GetRandomKeyBytes(32);
+  params.hkdf_hash = SHA256;
+  params.ciphertext_segment_size = ciphertext_segment_size;
+  params.ciphertext_offset = ciphertext_offset;
+  return params;
+}
+
+TEST(XChaCha20Poly1305HkdfStreamingTest, EncryptsAndDecrypts) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  for (HashType hkdf_hash : {SHA1, SHA256, SHA512}) {
+    for (int ct_segment_size : {80, 128, 200, 4096}) {
+      for (int ciphertext_offset : {0, 10}) {
+        SCOPED_TRACE(absl::StrCat(
+            "hkdf_hash = ", EnumToString(hkdf_hash),
+            ", ciphertext_segment_size = ", ct_segment_size,
+            ", ciphertext_offset = ", ciphertext_offset));
+        XChaCha20Poly1305HkdfStreaming::Params params =
+            GetParams(ct_segment_size, ciphertext_offset);
+        params.hkdf_hash = hkdf_hash;
+        auto result = XChaCha20Poly1305HkdfStreaming::New(std::move(params));
+        ASSERT_THAT(result.status(), IsOk());
+        auto streaming_aead = std::move(result.ValueOrDie());
+
+        std::string associated_data = "some associated data";
+        for (int pt_size : {0, 16, 100, 1000, 10000}) {
+          SCOPED_TRACE(absl::StrCat(" pt_size = ", pt_size));
+          std::string pt = Random::GetRandomBytes(pt_size);
+          EXPECT_THAT(
+              EncryptThenDecrypt(streaming_aead.get(), streaming_aead.get(),
+                                 pt, associated_data, ciphertext_offset),
+              IsOk());
+        }
+      }
+    }
+  }
+}
+
+TEST(XChaCha20Poly1305HkdfStreamingTest, EncryptsSmall) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  auto streaming_aead = std::move(
+      XChaCha20Poly1305HkdfStreaming::New(GetParams(256, 0)).ValueOrDie());
+  std::string associated_data = "some associated data";
+  // The first segment holds 256 - 16 bytes of ciphertext, less the header
+  // of 1 + 32 + 19 bytes.
+  const int max_size = 256 - 16 - 52;
+  for (int pt_size : {0, 1, max_size}) {
+    SCOPED_TRACE(absl::StrCat("pt_size = ", pt_size));
+    std::string pt = Random::GetRandomBytes(pt_size);
+    auto encrypt_result = streaming_aead->EncryptSmall(pt, associated_data);
+    ASSERT_THAT(encrypt_result.status(), IsOk());
+    std::string ct = encrypt_result.ValueOrDie();
+    EXPECT_EQ(52 + pt_size + 16, ct.size());
+
+    auto dec_stream_result = streaming_aead->NewDecryptingStream(
+        absl::make_unique<util::IstreamInputStream>(
+            absl::make_unique<std::stringstream>(ct)),
+        associated_data);
+    ASSERT_THAT(dec_stream_result.status(), IsOk());
+    std::string decrypted;
+    ASSERT_THAT(test::ReadFromStream(dec_stream_result.ValueOrDie().get(),
+                                     &decrypted),
+                IsOk());
+    EXPECT_EQ(pt, decrypted);
+    EXPECT_FALSE(
+        streaming_aead->DecryptSmall(ct, "wrong associated data").ok());
+  }
+  EXPECT_THAT(streaming_aead
+                  ->EncryptSmall(Random::GetRandomBytes(max_size + 1),
+                                 associated_data)
+                  .status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(XChaCha20Poly1305HkdfStreamingTest, ResumesEncryption) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  auto streaming_aead = std::move(
+      XChaCha20Poly1305HkdfStreaming::New(GetParams(256, 0)).ValueOrDie());
+  std::string pt = Random::GetRandomBytes(5000);
+  std::string associated_data = "some associated data";
+
+  auto ct_stream = absl::make_unique<std::stringstream>();
+  std::stringbuf* ct_buf = ct_stream->rdbuf();
+  auto enc_stream = std::move(
+      streaming_aead
+          ->NewResumableEncryptingStream(
+              absl::make_unique<util::OstreamOutputStream>(
+                  std::move(ct_stream)),
+              associated_data)
+          .ValueOrDie());
+  ASSERT_THAT(test::WriteToStream(enc_stream.get(), pt.substr(0, 2000), false),
+              IsOk());
+  StreamingAeadEncryptingStream::Checkpoint checkpoint =
+      enc_stream->GetCheckpoint();
+  ASSERT_THAT(test::WriteToStream(enc_stream.get(), pt.substr(2000)), IsOk());
+  std::string ct = ct_buf->str();
+
+  ct_stream = absl::make_unique<std::stringstream>();
+  ct_buf = ct_stream->rdbuf();
+  auto resumed_result = streaming_aead->ResumeEncryptingStream(
+      absl::make_unique<util::OstreamOutputStream>(std::move(ct_stream)),
+      associated_data, checkpoint);
+  ASSERT_THAT(resumed_result.status(), IsOk());
+  ASSERT_THAT(test::WriteToStream(resumed_result.ValueOrDie().get(),
+                                  pt.substr(checkpoint.plaintext_position)),
+              IsOk());
+  EXPECT_EQ(ct, ct.substr(0, checkpoint.ciphertext_position) + ct_buf->str());
+}
+
+TEST(XChaCha20Poly1305HkdfStreamingTest, RejectsInvalidParams) {
+  if (kUseOnlyFips) {
+    GTEST_SKIP() << "Not supported in FIPS-only mode";
+  }
+  XChaCha20Poly1305HkdfStreaming::Params params = GetParams(256, 0);
+  params.ikm = Random::GetRandomKeyBytes(16);
+  EXPECT_THAT(XChaCha20Poly1305HkdfStreaming::New(std::move(params)).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  params = GetParams(256, 0);
+  params.hkdf_hash = SHA384;
+  EXPECT_THAT(XChaCha20Poly1305HkdfStreaming::New(std::move(params)).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(XChaCha20Poly1305HkdfStreaming::New(GetParams(256, -1)).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  // The first segment must hold the header, a tag and some ciphertext.
+  EXPECT_THAT(XChaCha20Poly1305HkdfStreaming::New(GetParams(78, 10)).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(XChaCha20Poly1305HkdfStreaming::New(GetParams(79, 10)).status(),
+              IsOk());
+}
+
+// FIPS only mode tests
+TEST(XChaCha20Poly1305HkdfStreamingTest, TestFipsOnly) {
+  if (!kUseOnlyFips) {
+    GTEST_SKIP() << "Only supported in FIPS-only mode";
+  }
+  EXPECT_THAT(XChaCha20Poly1305HkdfStreaming::New(GetParams(256, 0)).status(),
+              StatusIs(util::error::INTERNAL));
+}
+
+}  // namespace
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
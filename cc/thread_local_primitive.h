@@ -0,0 +1,192 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_THREAD_LOCAL_PRIMITIVE_H_
+#define TINK_THREAD_LOCAL_PRIMITIVE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/container/flat_hash_map.h"
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+#include "tink/keyset_handle.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+
+// A primitive of type P with one clone per thread, so that threads do not
+// contend on state which primitives share internally, such as lazily
+// initialized key schedules or the cache lines of their contexts:
+//
+//   auto aead_result =
+//       ThreadLocalPrimitive<Aead>::New(*keyset_handle, /* max_clones= */ 64);
+//   ...
+//   auto ciphertext_result =
+//       aead_result.ValueOrDie()->Get()->Encrypt(plaintext, associated_data);
+//
+// The clone of a thread is created with KeysetHandle::GetPrimitive<P>() the
+// first time the thread calls Get(). At most 'max_clones' threads get their
+// own clone; the threads after them share one primitive.
+//
+// Update() switches to a new keyset. Every thread replaces its clone on its
+// next call to Get(), so the clones of the previous keyset are deleted once
+// each thread that holds one calls Get() again or exits.
+template <class P>
+class ThreadLocalPrimitive {
+ public:
+  // Returns a ThreadLocalPrimitive for the keyset of 'handle', with at most
+  // 'max_clones' clones, which must not be negative.
+  static crypto::tink::util::StatusOr<std::unique_ptr<ThreadLocalPrimitive<P>>>
+  New(const KeysetHandle& handle, int max_clones) {
+    if (max_clones < 0) {
+      return util::Status(util::error::INVALID_ARGUMENT,
+                          "max_clones must not be negative");
+    }
+    auto thread_local_primitive =
+        absl::WrapUnique(new ThreadLocalPrimitive<P>(max_clones));
+    util::Status status = thread_local_primitive->Update(handle);
+    if (!status.ok()) return status;
+    return std::move(thread_local_primitive);
+  }
+
+  ThreadLocalPrimitive(const ThreadLocalPrimitive&) = delete;
+  ThreadLocalPrimitive& operator=(const ThreadLocalPrimitive&) = delete;
+
+  // Returns the primitive of the calling thread, which stays valid until the
+  // thread calls Get() again after an Update(), or exits. Thread-safe; after
+  // the first call of a thread, and until the next Update(), it only takes a
+  // thread-local lookup.
+  P* Get() const ABSL_LOCKS_EXCLUDED(mutex_) {
+    ThreadClones& clones = GetThreadClones();
+    auto it = clones.find(id_);
+    if (it != clones.end() &&
+        it->second.generation == generation_.load(std::memory_order_acquire)) {
+      return it->second.primitive.get();
+    }
+    return NewThreadClone(&clones);
+  }
+
+  // Switches to the keyset of 'handle', if it differs from the current one.
+  // If its primitive cannot be created, the current keyset stays in use.
+  // Thread-safe.
+  crypto::tink::util::Status Update(const KeysetHandle& handle)
+      ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock lock(&mutex_);
+    // The keyset info changes with every rotation, and does not hold key
+    // material.
+    std::string keyset_info = handle.GetKeysetInfo().SerializeAsString();
+    if (handle_ != nullptr && keyset_info == keyset_info_) {
+      return util::OkStatus();
+    }
+    auto primitive_result = handle.GetPrimitive<P>();
+    if (!primitive_result.ok()) return primitive_result.status();
+    handle_ = absl::make_unique<KeysetHandle>(handle);
+    keyset_info_ = std::move(keyset_info);
+    shared_primitive_ = std::move(primitive_result.ValueOrDie());
+    num_clones_ = 0;
+    generation_.fetch_add(1, std::memory_order_release);
+    return util::OkStatus();
+  }
+
+  // Returns the number of threads with their own clone of the current keyset.
+  int num_clones() const ABSL_LOCKS_EXCLUDED(mutex_) {
+    absl::MutexLock lock(&mutex_);
+    return num_clones_;
+  }
+
+  // Returns the number of times the keyset was switched.
+  int64_t generation() const {
+    return generation_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  struct ThreadClone {
+    int64_t generation;
+    std::shared_ptr<P> primitive;
+    // Expires when the ThreadLocalPrimitive is destroyed.
+    std::weak_ptr<void> owner;
+  };
+  // The clones of a thread, by the id of their ThreadLocalPrimitive.
+  using ThreadClones = absl::flat_hash_map<int64_t, ThreadClone>;
+
+  explicit ThreadLocalPrimitive(int max_clones)
+      : max_clones_(max_clones), id_(NextId()) {}
+
+  // The clones of the calling thread, which are deleted when it exits.
+  static ThreadClones& GetThreadClones() {
+    static thread_local ThreadClones clones;
+    return clones;
+  }
+
+  static int64_t NextId() {
+    static std::atomic<int64_t>* next_id = new std::atomic<int64_t>(0);
+    return next_id->fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // Creates the clone of the calling thread for the current keyset, and
+  // stores it in 'clones'.
+  P* NewThreadClone(ThreadClones* clones) const ABSL_LOCKS_EXCLUDED(mutex_) {
+    // Clones of destroyed ThreadLocalPrimitives are only dropped here, to keep
+    // Get() cheap.
+    for (auto it = clones->begin(); it != clones->end();) {
+      if (it->second.owner.expired()) {
+        clones->erase(it++);
+      } else {
+        ++it;
+      }
+    }
+    absl::MutexLock lock(&mutex_);
+    ThreadClone clone;
+    clone.generation = generation_.load(std::memory_order_relaxed);
+    clone.primitive = shared_primitive_;
+    clone.owner = owner_;
+    if (num_clones_ < max_clones_) {
+      auto primitive_result = handle_->GetPrimitive<P>();
+      // Creating the primitive succeeded in Update(), so the thread can share
+      // the primitive if it fails now.
+      if (primitive_result.ok()) {
+        clone.primitive = std::move(primitive_result.ValueOrDie());
+        num_clones_++;
+      }
+    }
+    P* primitive = clone.primitive.get();
+    (*clones)[id_] = std::move(clone);
+    return primitive;
+  }
+
+  const int max_clones_;
+  const int64_t id_;
+  const std::shared_ptr<void> owner_ = std::make_shared<int>(0);
+  std::atomic<int64_t> generation_{0};
+
+  mutable absl::Mutex mutex_;
+  std::unique_ptr<const KeysetHandle> handle_ ABSL_GUARDED_BY(mutex_);
+  std::string keyset_info_ ABSL_GUARDED_BY(mutex_);
+  std::shared_ptr<P> shared_primitive_ ABSL_GUARDED_BY(mutex_);
+  mutable int num_clones_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_THREAD_LOCAL_PRIMITIVE_H_
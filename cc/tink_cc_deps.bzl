@@ -187,3 +187,20 @@ def tink_cc_deps():
             url = "https://github.com/google/wycheproof/archive/d8ed1ba95ac4c551db67f410c06131c3bc00a97c.zip",
             sha256 = "eb1d558071acf1aa6d677d7f1cabec2328d1cf8381496c17185bd92b52ce7545",
         )
+
+def tink_cc_benchmark_deps():
+    """ Loads the dependencies of the C++ Tink benchmarks.
+
+    Only needed by workspaces which build the benchmarks, so that workspaces
+    using tink_cc_deps() do not fetch them.
+    """
+
+    # Google Benchmark. Used by the benchmarks in //benchmarks.
+    if not native.existing_rule("com_github_google_benchmark"):
+        # Release from 2020-09-11.
+        http_archive(
+            name = "com_github_google_benchmark",
+            strip_prefix = "benchmark-1.5.2",
+            url = "https://github.com/google/benchmark/archive/v1.5.2.tar.gz",
+            sha256 = "dccbdab796baa1043f04982147e67bb6e118fe610da2c65f88912d73987e700c",
+        )
@@ -0,0 +1,83 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_TRACING_H_
+#define TINK_TRACING_H_
+
+#include <cstdint>
+#include <memory>
+
+#include "absl/strings/string_view.h"
+#include "absl/time/time.h"
+
+namespace crypto {
+namespace tink {
+
+// What a span measured, reported when it ends.
+struct TracingSpanData {
+  // The bytes processed, e.g. the size of a ciphertext, or the bytes read
+  // from a stream.
+  int64_t num_bytes = 0;
+  // The number of keys tried, for decryptions which try the keys of a keyset
+  // one after the other.
+  int key_trials = 0;
+  bool ok = true;
+  absl::Duration duration;
+};
+
+// Receives spans around the operations of Tink which may be slow: reading
+// keysets, calls to a KMS, creating primitives in the Registry, decryptions
+// which try several keys, and the lifetime of decrypting streams.
+//
+// Spans are only reported if Tink is built with tracing, see
+// Tracing::IsCompiledIn(); otherwise they compile to nothing. The callbacks
+// map onto OpenTelemetry: StartSpan() can start a span of a Tracer and return
+// it, and EndSpan() can set the data as attributes and end it.
+class TracingClient {
+ public:
+  virtual ~TracingClient() = default;
+
+  // Called when the span 'name', such as "tink.keyset_handle.read", starts
+  // on the calling thread. The result is passed to EndSpan(). Must be
+  // thread-safe.
+  virtual void* StartSpan(absl::string_view name) = 0;
+
+  // Called when the span which StartSpan() returned ends. This is the thread
+  // which started the span, except for spans over the lifetime of a stream,
+  // which end on the thread destroying the stream.
+  virtual void EndSpan(void* span, const TracingSpanData& data) = 0;
+};
+
+// Holds the installed TracingClient.
+class Tracing {
+ public:
+  // Makes spans started afterwards report to 'client'. Passing nullptr
+  // disables tracing.
+  static void SetClient(std::shared_ptr<TracingClient> client);
+
+  // Returns the installed client, or nullptr. Returns right away if there
+  // is none.
+  static std::shared_ptr<TracingClient> GetClient();
+
+  // Returns true if Tink was built with tracing, i.e. with
+  // --//:enable_tracing in Bazel or -DTINK_ENABLE_TRACING=ON in CMake.
+  static bool IsCompiledIn();
+};
+
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_TRACING_H_
@@ -0,0 +1,301 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/util/base64.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "tink/subtle/subtle_util.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define TINK_BASE64_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace crypto {
+namespace tink {
+namespace util {
+
+namespace {
+
+constexpr char kStandardChars[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+constexpr char kUrlChars[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+
+// The value of each character, or 0xff for characters outside the alphabet.
+struct DecodeTables {
+  DecodeTables() {
+    std::memset(standard, 0xff, sizeof(standard));
+    std::memset(url, 0xff, sizeof(url));
+    for (int i = 0; i < 64; i++) {
+      standard[static_cast<uint8_t>(kStandardChars[i])] = i;
+      url[static_cast<uint8_t>(kUrlChars[i])] = i;
+    }
+  }
+
+  uint8_t standard[256];
+  uint8_t url[256];
+};
+
+const char* EncodeChars(Base64Alphabet alphabet) {
+  return alphabet == Base64Alphabet::kUrl ? kUrlChars : kStandardChars;
+}
+
+const uint8_t* DecodeTable(Base64Alphabet alphabet) {
+  static const DecodeTables* tables = new DecodeTables();
+  return alphabet == Base64Alphabet::kUrl ? tables->url : tables->standard;
+}
+
+#ifdef TINK_BASE64_AVX2
+
+#define TINK_AVX2_TARGET __attribute__((target("avx2")))
+
+// Encodes 24-byte blocks of 'in' into 32 characters each, as long as 28 bytes
+// are readable, and returns the number of bytes encoded.
+TINK_AVX2_TARGET size_t EncodeAvx2(const uint8_t* in, size_t size,
+                                   Base64Alphabet alphabet, char* out) {
+  // The offsets from the 6-bit values to the characters, indexed as below.
+  const __m256i shift_lut =
+      alphabet == Base64Alphabet::kUrl
+          ? _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                             '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                             '0' - 52, '-' - 62, '_' - 63, 'A', 0, 0,
+                             'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                             '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                             '0' - 52, '-' - 62, '_' - 63, 'A', 0, 0)
+          : _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                             '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                             '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+                             'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                             '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                             '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+  // Spreads each 3 bytes over the 4 bytes of a 32-bit word, as b1 b0 b2 b1.
+  const __m256i spread = _mm256_setr_epi8(
+      1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+      1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+  size_t done = 0;
+  for (; size - done >= 28; done += 24, out += 32) {
+    __m256i bytes = _mm256_inserti128_si256(
+        _mm256_castsi128_si256(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + done))),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + done + 12)), 1);
+    bytes = _mm256_shuffle_epi8(bytes, spread);
+    // Moves the four 6-bit values of each word into its four bytes.
+    __m256i ac = _mm256_mulhi_epu16(
+        _mm256_and_si256(bytes, _mm256_set1_epi32(0x0fc0fc00)),
+        _mm256_set1_epi32(0x04000040));
+    __m256i bd = _mm256_mullo_epi16(
+        _mm256_and_si256(bytes, _mm256_set1_epi32(0x003f03f0)),
+        _mm256_set1_epi32(0x01000010));
+    __m256i values = _mm256_or_si256(ac, bd);
+    // 0 for 0..25, which is then mapped to 13, 0 for 26..51, and 1..12 above.
+    __m256i index = _mm256_subs_epu8(values, _mm256_set1_epi8(51));
+    __m256i is_upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), values);
+    index = _mm256_or_si256(index,
+                            _mm256_and_si256(is_upper, _mm256_set1_epi8(13)));
+    __m256i chars =
+        _mm256_add_epi8(values, _mm256_shuffle_epi8(shift_lut, index));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), chars);
+  }
+  return done;
+}
+
+// Returns the mask of the bytes of 'c' in [lo, hi].
+TINK_AVX2_TARGET inline __m256i InRange(__m256i c, char lo, char hi) {
+  return _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8(lo - 1)),
+                          _mm256_cmpgt_epi8(_mm256_set1_epi8(hi + 1), c));
+}
+
+// Decodes blocks of 32 characters of 'in' into 24 bytes each, as long as
+// 44 characters are left, so that the 32 bytes written per block stay within
+// Base64MaxDecodedSize(size). Stops at the first block with a character
+// outside the alphabet, and returns the number of characters decoded.
+TINK_AVX2_TARGET size_t DecodeAvx2(const char* in, size_t size,
+                                   Base64Alphabet alphabet, uint8_t* out) {
+  const bool url = alphabet == Base64Alphabet::kUrl;
+  const __m256i char_62 = _mm256_set1_epi8(url ? '-' : '+');
+  const __m256i char_63 = _mm256_set1_epi8(url ? '_' : '/');
+  const __m256i offset_62 = _mm256_set1_epi8(url ? 62 - '-' : 62 - '+');
+  const __m256i offset_63 = _mm256_set1_epi8(url ? 63 - '_' : 63 - '/');
+  const __m256i pack = _mm256_setr_epi8(
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+  size_t done = 0;
+  for (; size - done >= 44; done += 32, out += 24) {
+    __m256i c =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + done));
+    __m256i upper = InRange(c, 'A', 'Z');
+    __m256i lower = InRange(c, 'a', 'z');
+    __m256i digit = InRange(c, '0', '9');
+    __m256i is_62 = _mm256_cmpeq_epi8(c, char_62);
+    __m256i is_63 = _mm256_cmpeq_epi8(c, char_63);
+    __m256i valid = _mm256_or_si256(
+        _mm256_or_si256(upper, lower),
+        _mm256_or_si256(digit, _mm256_or_si256(is_62, is_63)));
+    if (static_cast<uint32_t>(_mm256_movemask_epi8(valid)) != 0xffffffff) {
+      break;
+    }
+    __m256i offset = _mm256_or_si256(
+        _mm256_or_si256(
+            _mm256_and_si256(upper, _mm256_set1_epi8(-'A')),
+            _mm256_and_si256(lower, _mm256_set1_epi8(26 - 'a'))),
+        _mm256_or_si256(
+            _mm256_and_si256(digit, _mm256_set1_epi8(52 - '0')),
+            _mm256_or_si256(_mm256_and_si256(is_62, offset_62),
+                            _mm256_and_si256(is_63, offset_63))));
+    __m256i values = _mm256_add_epi8(c, offset);
+    // Merges the four 6-bit values of each word into 24 bits, big-endian.
+    __m256i merged = _mm256_madd_epi16(
+        _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140)),
+        _mm256_set1_epi32(0x00011000));
+    merged = _mm256_shuffle_epi8(merged, pack);
+    merged = _mm256_permutevar8x32_epi32(
+        merged, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), merged);
+  }
+  return done;
+}
+
+#endif  // TINK_BASE64_AVX2
+
+}  // namespace
+
+size_t Base64EncodedSize(size_t size, bool padding) {
+  if (padding) return (size + 2) / 3 * 4;
+  return size / 3 * 4 + (size % 3 == 0 ? 0 : size % 3 + 1);
+}
+
+size_t Base64EncodeInto(absl::string_view data, Base64Alphabet alphabet,
+                        bool padding, char* out) {
+  const uint8_t* in = reinterpret_cast<const uint8_t*>(data.data());
+  size_t size = data.size();
+  char* const start = out;
+#ifdef TINK_BASE64_AVX2
+  if (Base64IsAccelerated()) {
+    size_t done = EncodeAvx2(in, size, alphabet, out);
+    in += done;
+    size -= done;
+    out += done / 3 * 4;
+  }
+#endif
+  const char* chars = EncodeChars(alphabet);
+  for (; size >= 3; size -= 3, in += 3, out += 4) {
+    uint32_t v = (in[0] << 16) | (in[1] << 8) | in[2];
+    out[0] = chars[v >> 18];
+    out[1] = chars[(v >> 12) & 0x3f];
+    out[2] = chars[(v >> 6) & 0x3f];
+    out[3] = chars[v & 0x3f];
+  }
+  if (size > 0) {
+    uint32_t v = (in[0] << 16) | (size == 2 ? in[1] << 8 : 0);
+    *out++ = chars[v >> 18];
+    *out++ = chars[(v >> 12) & 0x3f];
+    if (size == 2) *out++ = chars[(v >> 6) & 0x3f];
+    if (padding) {
+      if (size == 1) *out++ = '=';
+      *out++ = '=';
+    }
+  }
+  return out - start;
+}
+
+std::string Base64Encode(absl::string_view data, Base64Alphabet alphabet,
+                         bool padding) {
+  std::string encoded;
+  subtle::ResizeStringUninitialized(
+      &encoded, Base64EncodedSize(data.size(), padding));
+  Base64EncodeInto(data, alphabet, padding, &encoded[0]);
+  return encoded;
+}
+
+size_t Base64MaxDecodedSize(size_t encoded_size) {
+  return encoded_size / 4 * 3 + encoded_size % 4;
+}
+
+bool Base64DecodeInto(absl::string_view encoded, Base64Alphabet alphabet,
+                      char* out, size_t* out_size) {
+  if (encoded.size() % 4 == 0 && !encoded.empty() && encoded.back() == '=') {
+    encoded.remove_suffix(encoded[encoded.size() - 2] == '=' ? 2 : 1);
+  }
+  const char* in = encoded.data();
+  size_t size = encoded.size();
+  if (size % 4 == 1) return false;
+  uint8_t* next = reinterpret_cast<uint8_t*>(out);
+#ifdef TINK_BASE64_AVX2
+  if (Base64IsAccelerated()) {
+    size_t done = DecodeAvx2(in, size, alphabet, next);
+    in += done;
+    size -= done;
+    next += done / 4 * 3;
+  }
+#endif
+  const uint8_t* table = DecodeTable(alphabet);
+  auto value = [table](char c) { return table[static_cast<uint8_t>(c)]; };
+  for (; size >= 4; size -= 4, in += 4, next += 3) {
+    uint32_t a = value(in[0]);
+    uint32_t b = value(in[1]);
+    uint32_t c = value(in[2]);
+    uint32_t d = value(in[3]);
+    if (((a | b | c | d) & 0x80) != 0) return false;
+    uint32_t v = (a << 18) | (b << 12) | (c << 6) | d;
+    next[0] = v >> 16;
+    next[1] = v >> 8;
+    next[2] = v;
+  }
+  if (size > 0) {
+    uint32_t a = value(in[0]);
+    uint32_t b = value(in[1]);
+    uint32_t c = size == 3 ? value(in[2]) : 0;
+    if (((a | b | c) & 0x80) != 0) return false;
+    uint32_t v = (a << 18) | (b << 12) | (c << 6);
+    // The bits of the last character beyond the data must be zero.
+    if ((v & (size == 2 ? 0xffff : 0xff)) != 0) return false;
+    *next++ = v >> 16;
+    if (size == 3) *next++ = v >> 8;
+  }
+  *out_size = reinterpret_cast<char*>(next) - out;
+  return true;
+}
+
+bool Base64Decode(absl::string_view encoded, Base64Alphabet alphabet,
+                  std::string* out) {
+  subtle::ResizeStringUninitialized(out,
+                                    Base64MaxDecodedSize(encoded.size()));
+  size_t size;
+  if (!Base64DecodeInto(encoded, alphabet, &(*out)[0], &size)) {
+    out->clear();
+    return false;
+  }
+  out->resize(size);
+  return true;
+}
+
+bool Base64IsAccelerated() {
+#ifdef TINK_BASE64_AVX2
+  static const bool accelerated = __builtin_cpu_supports("avx2");
+  return accelerated;
+#else
+  return false;
+#endif
+}
+
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
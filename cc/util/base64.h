@@ -0,0 +1,77 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_UTIL_BASE64_H_
+#define TINK_UTIL_BASE64_H_
+
+#include <cstddef>
+#include <string>
+
+#include "absl/strings/string_view.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+
+///////////////////////////////////////////////////////////////////////////////
+// Base64 encoding and decoding, https://tools.ietf.org/html/rfc4648, into
+// caller-provided buffers. Unlike absl::Base64Escape() and friends they need
+// no temporary strings, and on x86-64 CPUs with AVX2 they process 32
+// characters per step.
+
+enum class Base64Alphabet {
+  kStandard,  // '+' and '/', as in JSON keysets.
+  kUrl,       // '-' and '_', as in JWTs.
+};
+
+// Returns the size of the encoding of 'size' bytes, which is padded with '='
+// to a multiple of 4 iff 'padding'.
+size_t Base64EncodedSize(size_t size, bool padding);
+
+// Writes the encoding of 'data' to 'out', which must have room for
+// Base64EncodedSize(data.size(), padding) bytes, and returns that size.
+size_t Base64EncodeInto(absl::string_view data, Base64Alphabet alphabet,
+                        bool padding, char* out);
+
+// Returns the encoding of 'data'.
+std::string Base64Encode(absl::string_view data, Base64Alphabet alphabet,
+                         bool padding);
+
+// Returns an upper bound of the size of the data decoded from 'encoded_size'
+// characters.
+size_t Base64MaxDecodedSize(size_t encoded_size);
+
+// Decodes 'encoded' into 'out', which must have room for
+// Base64MaxDecodedSize(encoded.size()) bytes, and sets 'out_size' to the
+// size of the decoded data. Returns false if 'encoded' is not a valid
+// encoding: it may end with "=" padding to a multiple of 4 characters, but
+// must not contain any other characters outside 'alphabet', and the unused
+// bits of its last character must be zero.
+bool Base64DecodeInto(absl::string_view encoded, Base64Alphabet alphabet,
+                      char* out, size_t* out_size);
+
+// Like above, into 'out', which is resized to the decoded data.
+bool Base64Decode(absl::string_view encoded, Base64Alphabet alphabet,
+                  std::string* out);
+
+// Returns true if the AVX2 implementation is used.
+bool Base64IsAccelerated();
+
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_UTIL_BASE64_H_
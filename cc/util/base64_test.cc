@@ -0,0 +1,124 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/util/base64.h"
+
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/escaping.h"
+#include "absl/strings/str_cat.h"
+#include "tink/subtle/random.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+namespace {
+
+using ::testing::Eq;
+using ::testing::IsEmpty;
+
+TEST(Base64Test, EncodesLikeAbsl) {
+  for (int size = 0; size < 300; size++) {
+    SCOPED_TRACE(absl::StrCat("size: ", size));
+    std::string data = subtle::Random::GetRandomBytes(size);
+    EXPECT_THAT(Base64Encode(data, Base64Alphabet::kStandard,
+                             /* padding = */ true),
+                Eq(absl::Base64Escape(data)));
+    EXPECT_THAT(Base64Encode(data, Base64Alphabet::kUrl, /* padding = */ false),
+                Eq(absl::WebSafeBase64Escape(data)));
+    EXPECT_THAT(Base64EncodedSize(size, /* padding = */ false),
+                Eq(absl::WebSafeBase64Escape(data).size()));
+  }
+}
+
+TEST(Base64Test, DecodesLikeAbsl) {
+  for (int size = 0; size < 300; size++) {
+    SCOPED_TRACE(absl::StrCat("size: ", size));
+    std::string data = subtle::Random::GetRandomBytes(size);
+    std::string decoded;
+    EXPECT_TRUE(
+        Base64Decode(absl::Base64Escape(data), Base64Alphabet::kStandard,
+                     &decoded));
+    EXPECT_THAT(decoded, Eq(data));
+    EXPECT_TRUE(Base64Decode(absl::WebSafeBase64Escape(data),
+                             Base64Alphabet::kUrl, &decoded));
+    EXPECT_THAT(decoded, Eq(data));
+    // Padding is optional.
+    EXPECT_TRUE(Base64Decode(Base64Encode(data, Base64Alphabet::kUrl, true),
+                             Base64Alphabet::kUrl, &decoded));
+    EXPECT_THAT(decoded, Eq(data));
+  }
+}
+
+TEST(Base64Test, DecodesIntoBuffer) {
+  std::string data = subtle::Random::GetRandomBytes(1000);
+  std::string encoded = absl::WebSafeBase64Escape(data);
+  std::string buffer(Base64MaxDecodedSize(encoded.size()), 'x');
+  size_t size;
+  ASSERT_TRUE(Base64DecodeInto(encoded, Base64Alphabet::kUrl, &buffer[0],
+                               &size));
+  EXPECT_THAT(buffer.substr(0, size), Eq(data));
+}
+
+TEST(Base64Test, RejectsInvalidCharacters) {
+  std::string data = subtle::Random::GetRandomBytes(150);
+  std::string encoded = absl::Base64Escape(data);
+  for (char invalid : {'-', '_', '=', '*', ' ', '\0', '\x80', '\xff'}) {
+    for (int i = 0; i < encoded.size(); i++) {
+      // A '=' at the end is valid padding if the bits it replaces are zero.
+      if (invalid == '=' && i + 1 == encoded.size()) continue;
+      SCOPED_TRACE(absl::StrCat("invalid: ", static_cast<int>(invalid),
+                                " position: ", i));
+      std::string corrupted = encoded;
+      corrupted[i] = invalid;
+      std::string decoded = "x";
+      EXPECT_FALSE(
+          Base64Decode(corrupted, Base64Alphabet::kStandard, &decoded));
+      EXPECT_THAT(decoded, IsEmpty());
+    }
+  }
+  encoded = absl::WebSafeBase64Escape(data);
+  for (char invalid : {'+', '/'}) {
+    for (int i = 0; i < encoded.size(); i++) {
+      std::string corrupted = encoded;
+      corrupted[i] = invalid;
+      std::string decoded;
+      EXPECT_FALSE(Base64Decode(corrupted, Base64Alphabet::kUrl, &decoded))
+          << i;
+    }
+  }
+}
+
+TEST(Base64Test, RejectsInvalidEncodings) {
+  std::string decoded;
+  for (absl::string_view encoded :
+       {"Q", "QUJDR", "QQ=", "Q===", "====", "QQ=A", "QR", "QUJ", "QR==",
+        "QUJ="}) {
+    SCOPED_TRACE(encoded);
+    EXPECT_FALSE(Base64Decode(encoded, Base64Alphabet::kStandard, &decoded));
+  }
+  EXPECT_TRUE(Base64Decode("", Base64Alphabet::kStandard, &decoded));
+  EXPECT_THAT(decoded, IsEmpty());
+  EXPECT_TRUE(Base64Decode("QUE=", Base64Alphabet::kStandard, &decoded));
+  EXPECT_THAT(decoded, Eq("AA"));
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,299 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/util/buffer_pool.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+#include "openssl/mem.h"
+#include "tink/util/buffer.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+
+namespace {
+
+// Free memory blocks, by size class.
+using FreeBlocks = std::vector<std::vector<std::unique_ptr<char[]>>>;
+
+// The largest supported size class, so that block sizes fit into an int.
+constexpr int kMaxBlockSize = 1 << 30;
+
+bool IsPowerOfTwo(int x) { return x > 0 && (x & (x - 1)) == 0; }
+
+}  // namespace
+
+class BufferPool::State {
+ public:
+  explicit State(const Options& options) : options_(options) {
+    int64_t block_size = options_.min_block_size;
+    size_class_count_ = 1;
+    while (block_size < options_.max_block_size) {
+      block_size *= 2;
+      size_class_count_++;
+    }
+    shared_free_blocks_.resize(size_class_count_);
+  }
+
+  // Returns the size class of blocks for 'size' bytes, or -1 if such blocks
+  // are not pooled.
+  int GetSizeClass(int size) const {
+    int size_class = 0;
+    int64_t block_size = options_.min_block_size;
+    while (block_size < size) {
+      block_size *= 2;
+      size_class++;
+    }
+    return size_class < size_class_count_ ? size_class : -1;
+  }
+
+  int GetBlockSize(int size_class) const {
+    return options_.min_block_size << size_class;
+  }
+
+  int size_class_count() const { return size_class_count_; }
+
+  bool zero_on_release() const { return options_.zero_on_release; }
+
+  // Returns a free block of the given size class from the calling thread's
+  // cache or from the shared free list, or a newly allocated one.
+  std::unique_ptr<char[]> Acquire(const std::shared_ptr<State>& self,
+                                  int size_class);
+
+  // Returns 'block' of the given size class to the calling thread's cache
+  // or to the shared free list, or frees it if both are full.
+  void Release(const std::shared_ptr<State>& self, int size_class,
+               std::unique_ptr<char[]> block);
+
+  // Moves 'block' to the shared free list, or frees it if the list is full.
+  void ReleaseToSharedList(int size_class, std::unique_ptr<char[]> block) {
+    absl::MutexLock lock(&mutex_);
+    auto& free_blocks = shared_free_blocks_[size_class];
+    if (free_blocks.size() < options_.shared_cache_size) {
+      free_blocks.push_back(std::move(block));
+    }
+  }
+
+  Stats GetStats() const {
+    Stats stats;
+    stats.allocated_blocks = allocated_blocks_.load(std::memory_order_relaxed);
+    stats.reused_blocks = reused_blocks_.load(std::memory_order_relaxed);
+    absl::MutexLock lock(&mutex_);
+    for (const auto& free_blocks : shared_free_blocks_) {
+      stats.shared_free_blocks += free_blocks.size();
+    }
+    return stats;
+  }
+
+ private:
+  const Options options_;
+  int size_class_count_;
+  std::atomic<int64_t> allocated_blocks_{0};
+  std::atomic<int64_t> reused_blocks_{0};
+  mutable absl::Mutex mutex_;
+  FreeBlocks shared_free_blocks_ ABSL_GUARDED_BY(mutex_);
+};
+
+// The free blocks kept by one thread, for each pool it has used.
+class BufferPool::ThreadCache {
+ public:
+  // Returns the blocks of the calling thread's cache which belong to the
+  // pool with the given 'state'.
+  static FreeBlocks* Get(const std::shared_ptr<State>& state) {
+    static thread_local ThreadCache cache;
+    return cache.GetFreeBlocks(state);
+  }
+
+  // Gives the cached blocks back to the pools which are still alive.
+  ~ThreadCache() {
+    for (auto& entry : entries_) {
+      std::shared_ptr<State> state = entry.state.lock();
+      if (state == nullptr) continue;
+      for (size_t size_class = 0; size_class < entry.free_blocks.size();
+           size_class++) {
+        for (auto& block : entry.free_blocks[size_class]) {
+          state->ReleaseToSharedList(size_class, std::move(block));
+        }
+      }
+    }
+  }
+
+ private:
+  struct Entry {
+    const State* pool;
+    std::weak_ptr<State> state;
+    FreeBlocks free_blocks;
+  };
+
+  FreeBlocks* GetFreeBlocks(const std::shared_ptr<State>& state) {
+    for (auto& entry : entries_) {
+      if (entry.pool == state.get() && !entry.state.expired()) {
+        return &entry.free_blocks;
+      }
+    }
+    // The blocks of deleted pools are freed when the thread first uses
+    // another pool, so that their address can be reused safely.
+    std::vector<Entry> live_entries;
+    for (auto& entry : entries_) {
+      if (!entry.state.expired()) live_entries.push_back(std::move(entry));
+    }
+    entries_ = std::move(live_entries);
+    entries_.push_back(
+        {state.get(), state, FreeBlocks(state->size_class_count())});
+    return &entries_.back().free_blocks;
+  }
+
+  // Typically a thread uses only a few pools, so a linear search suffices.
+  std::vector<Entry> entries_;
+};
+
+std::unique_ptr<char[]> BufferPool::State::Acquire(
+    const std::shared_ptr<State>& self, int size_class) {
+  if (options_.thread_cache_size > 0) {
+    auto& free_blocks = (*ThreadCache::Get(self))[size_class];
+    if (!free_blocks.empty()) {
+      std::unique_ptr<char[]> block = std::move(free_blocks.back());
+      free_blocks.pop_back();
+      reused_blocks_.fetch_add(1, std::memory_order_relaxed);
+      return block;
+    }
+  }
+  {
+    absl::MutexLock lock(&mutex_);
+    auto& free_blocks = shared_free_blocks_[size_class];
+    if (!free_blocks.empty()) {
+      std::unique_ptr<char[]> block = std::move(free_blocks.back());
+      free_blocks.pop_back();
+      reused_blocks_.fetch_add(1, std::memory_order_relaxed);
+      return block;
+    }
+  }
+  allocated_blocks_.fetch_add(1, std::memory_order_relaxed);
+  return absl::make_unique<char[]>(GetBlockSize(size_class));
+}
+
+void BufferPool::State::Release(const std::shared_ptr<State>& self,
+                                int size_class,
+                                std::unique_ptr<char[]> block) {
+  if (options_.thread_cache_size > 0) {
+    auto& free_blocks = (*ThreadCache::Get(self))[size_class];
+    if (free_blocks.size() < options_.thread_cache_size) {
+      free_blocks.push_back(std::move(block));
+      return;
+    }
+  }
+  ReleaseToSharedList(size_class, std::move(block));
+}
+
+// A Buffer whose memory block is returned to the pool on deletion.
+class BufferPool::PooledBuffer : public Buffer {
+ public:
+  // It is assumed that 'allocated_size' is positive, and that 'mem_block'
+  // has at least 'allocated_size' bytes. A 'size_class' of -1 denotes
+  // a block which is not pooled.
+  PooledBuffer(std::shared_ptr<State> state, int size_class,
+               std::unique_ptr<char[]> mem_block, int allocated_size)
+      : state_(std::move(state)),
+        size_class_(size_class),
+        mem_block_(std::move(mem_block)),
+        allocated_size_(allocated_size),
+        size_(allocated_size) {}
+
+  char* const get_mem_block() const override { return mem_block_.get(); }
+
+  int allocated_size() const override { return allocated_size_; }
+
+  int size() const override { return size_; }
+
+  util::Status set_size(int new_size) override {
+    if (new_size < 0 || new_size > allocated_size_) {
+      return Status(crypto::tink::util::error::INVALID_ARGUMENT,
+                    "new_size must satisfy 0 <= new_size <= allocated_size()");
+    }
+    size_ = new_size;
+    return Status::OK;
+  }
+
+  ~PooledBuffer() override {
+    if (state_->zero_on_release()) {
+      OPENSSL_cleanse(mem_block_.get(), allocated_size_);
+    }
+    if (size_class_ >= 0) {
+      state_->Release(state_, size_class_, std::move(mem_block_));
+    }
+  }
+
+ private:
+  const std::shared_ptr<State> state_;
+  const int size_class_;
+  std::unique_ptr<char[]> mem_block_;
+  const int allocated_size_;
+  int size_;
+};
+
+// static
+StatusOr<std::unique_ptr<BufferPool>> BufferPool::New(Options options) {
+  if (!IsPowerOfTwo(options.min_block_size)) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "min_block_size must be a positive power of two");
+  }
+  if (options.max_block_size < options.min_block_size ||
+      options.max_block_size > kMaxBlockSize) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "max_block_size must be in range min_block_size..2^30");
+  }
+  if (options.thread_cache_size < 0 || options.shared_cache_size < 0) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "cache sizes must be non-negative");
+  }
+  return {absl::WrapUnique(
+      new BufferPool(std::make_shared<State>(options)))};
+}
+
+BufferPool::BufferPool(std::shared_ptr<State> state)
+    : state_(std::move(state)) {}
+
+BufferPool::~BufferPool() {}
+
+StatusOr<std::unique_ptr<Buffer>> BufferPool::Get(int allocated_size) {
+  if (allocated_size <= 0) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "allocated_size must be positive");
+  }
+  int size_class = state_->GetSizeClass(allocated_size);
+  std::unique_ptr<char[]> mem_block =
+      size_class >= 0 ? state_->Acquire(state_, size_class)
+                      : absl::make_unique<char[]>(allocated_size);
+  return {absl::make_unique<PooledBuffer>(state_, size_class,
+                                          std::move(mem_block),
+                                          allocated_size)};
+}
+
+BufferPool::Stats BufferPool::GetStats() const { return state_->GetStats(); }
+
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
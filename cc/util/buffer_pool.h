@@ -0,0 +1,98 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_UTIL_BUFFER_POOL_H_
+#define TINK_UTIL_BUFFER_POOL_H_
+
+#include <cstdint>
+#include <memory>
+
+#include "tink/util/buffer.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+
+// A pool of reusable memory blocks for Buffers.
+//
+// Get() returns a Buffer whose memory block is taken from the pool, and the
+// block goes back to the pool when the Buffer is deleted. Blocks are grouped
+// in size classes of powers of two, so that a block can serve any request
+// of at most its size. Each thread keeps a few free blocks of every size
+// class for itself, and a shared free list holds the remaining ones, so
+// that most Get() calls do not contend on a lock.
+//
+// Buffers returned by Get() may outlive the pool. Instances of this class
+// are thread safe.
+class BufferPool {
+ public:
+  struct Options {
+    // The smallest size class. Must be a positive power of two.
+    int min_block_size = 4096;
+    // Requests larger than the largest size class, which is the smallest
+    // power of two of at least this size, are not pooled: their memory is
+    // allocated by Get() and freed with the Buffer. Must be at least
+    // min_block_size, and at most 2^30.
+    int max_block_size = 1 << 24;
+    // The maximal number of free blocks per size class kept by each thread.
+    // Must be non-negative.
+    int thread_cache_size = 2;
+    // The maximal number of free blocks per size class kept in the shared
+    // free list. Must be non-negative.
+    int shared_cache_size = 64;
+    // If true, the contents of a Buffer are overwritten with zeros when it is
+    // deleted, before its block is reused or freed. Should be set if the
+    // Buffers hold secret data, like plaintext or key material.
+    bool zero_on_release = false;
+  };
+
+  struct Stats {
+    // The number of blocks allocated by Get().
+    int64_t allocated_blocks = 0;
+    // The number of Get() calls served by a free block.
+    int64_t reused_blocks = 0;
+    // The number of free blocks in the shared free list.
+    int64_t shared_free_blocks = 0;
+  };
+
+  static util::StatusOr<std::unique_ptr<BufferPool>> New(Options options);
+
+  ~BufferPool();
+
+  // Returns a Buffer of 'allocated_size' bytes, which must be positive.
+  // Like for Buffer::New(), the size of the returned Buffer is initially
+  // equal to its allocated size, and its contents are unspecified.
+  util::StatusOr<std::unique_ptr<Buffer>> Get(int allocated_size);
+
+  Stats GetStats() const;
+
+ private:
+  class State;
+  class ThreadCache;
+  class PooledBuffer;
+
+  explicit BufferPool(std::shared_ptr<State> state);
+
+  const std::shared_ptr<State> state_;
+};
+
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_UTIL_BUFFER_POOL_H_
@@ -0,0 +1,206 @@
+// Copyright 2019 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/util/buffer_pool.h"
+
+#include <cstring>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "tink/util/buffer.h"
+#include "tink/util/status.h"
+#include "tink/util/test_matchers.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+namespace {
+
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+
+std::unique_ptr<BufferPool> NewPool(BufferPool::Options options) {
+  auto pool_result = BufferPool::New(options);
+  EXPECT_THAT(pool_result.status(), IsOk());
+  return std::move(pool_result.ValueOrDie());
+}
+
+TEST(BufferPoolTest, BasicOperations) {
+  auto pool = NewPool(BufferPool::Options());
+  for (int size : {1, 10, 4096, 4097, 100000, 1 << 24, (1 << 24) + 1}) {
+    SCOPED_TRACE(size);
+    auto buffer_result = pool->Get(size);
+    ASSERT_THAT(buffer_result.status(), IsOk());
+    auto buffer = std::move(buffer_result.ValueOrDie());
+    EXPECT_EQ(size, buffer->allocated_size());
+    EXPECT_EQ(size, buffer->size());
+    std::memset(buffer->get_mem_block(), 'a', size);
+    EXPECT_THAT(buffer->set_size(0), IsOk());
+    EXPECT_EQ(0, buffer->size());
+    EXPECT_THAT(buffer->set_size(size), IsOk());
+    EXPECT_THAT(buffer->set_size(size + 1),
+                StatusIs(util::error::INVALID_ARGUMENT));
+    EXPECT_THAT(buffer->set_size(-1), StatusIs(util::error::INVALID_ARGUMENT));
+    EXPECT_EQ(size, buffer->size());
+  }
+  EXPECT_THAT(pool->Get(0).status(), StatusIs(util::error::INVALID_ARGUMENT));
+  EXPECT_THAT(pool->Get(-5).status(), StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(BufferPoolTest, InvalidOptions) {
+  BufferPool::Options options;
+  options.min_block_size = 1000;
+  EXPECT_THAT(BufferPool::New(options).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  options.min_block_size = 1024;
+  options.max_block_size = 512;
+  EXPECT_THAT(BufferPool::New(options).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  options.max_block_size = (1 << 30) + 1;
+  EXPECT_THAT(BufferPool::New(options).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  options.max_block_size = 1 << 20;
+  options.thread_cache_size = -1;
+  EXPECT_THAT(BufferPool::New(options).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  options.thread_cache_size = 0;
+  options.shared_cache_size = -1;
+  EXPECT_THAT(BufferPool::New(options).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
+TEST(BufferPoolTest, ReusesBlocksOfTheSameSizeClass) {
+  auto pool = NewPool(BufferPool::Options());
+  char* mem_block;
+  {
+    auto buffer = std::move(pool->Get(5000).ValueOrDie());
+    mem_block = buffer->get_mem_block();
+  }
+  // 5000 and 8000 bytes are both served by blocks of 8192 bytes.
+  auto buffer = std::move(pool->Get(8000).ValueOrDie());
+  EXPECT_EQ(mem_block, buffer->get_mem_block());
+  EXPECT_EQ(8000, buffer->allocated_size());
+  // A block of 4096 bytes is not large enough.
+  auto other_buffer = std::move(pool->Get(9000).ValueOrDie());
+  EXPECT_NE(mem_block, other_buffer->get_mem_block());
+  BufferPool::Stats stats = pool->GetStats();
+  EXPECT_EQ(2, stats.allocated_blocks);
+  EXPECT_EQ(1, stats.reused_blocks);
+}
+
+TEST(BufferPoolTest, DoesNotPoolLargeBuffers) {
+  BufferPool::Options options;
+  options.max_block_size = 1 << 16;
+  auto pool = NewPool(options);
+  pool->Get((1 << 16) + 1).ValueOrDie().reset();
+  pool->Get((1 << 16) + 1).ValueOrDie().reset();
+  BufferPool::Stats stats = pool->GetStats();
+  EXPECT_EQ(0, stats.allocated_blocks);
+  EXPECT_EQ(0, stats.reused_blocks);
+}
+
+TEST(BufferPoolTest, SharesBlocksBetweenThreads) {
+  BufferPool::Options options;
+  options.thread_cache_size = 1;
+  auto pool = NewPool(options);
+  const int kBufferCount = 5;
+  std::vector<std::unique_ptr<Buffer>> buffers;
+  for (int i = 0; i < kBufferCount; i++) {
+    buffers.push_back(std::move(pool->Get(4096).ValueOrDie()));
+  }
+  // One block stays in the cache of this thread, the others go to the
+  // shared free list.
+  buffers.clear();
+  EXPECT_EQ(kBufferCount - 1, pool->GetStats().shared_free_blocks);
+  std::thread thread([&pool, &buffers]() {
+    for (int i = 0; i < kBufferCount - 1; i++) {
+      buffers.push_back(std::move(pool->Get(4096).ValueOrDie()));
+    }
+  });
+  thread.join();
+  BufferPool::Stats stats = pool->GetStats();
+  EXPECT_EQ(kBufferCount, stats.allocated_blocks);
+  EXPECT_EQ(kBufferCount - 1, stats.reused_blocks);
+  EXPECT_EQ(0, stats.shared_free_blocks);
+}
+
+TEST(BufferPoolTest, ThreadCacheIsReturnedOnThreadExit) {
+  BufferPool::Options options;
+  options.shared_cache_size = 8;
+  auto pool = NewPool(options);
+  std::thread thread([&pool]() {
+    pool->Get(4096).ValueOrDie().reset();
+    pool->Get(100000).ValueOrDie().reset();
+  });
+  thread.join();
+  EXPECT_EQ(2, pool->GetStats().shared_free_blocks);
+}
+
+TEST(BufferPoolTest, ZeroesBuffersOnRelease) {
+  BufferPool::Options options;
+  options.zero_on_release = true;
+  auto pool = NewPool(options);
+  char* mem_block;
+  {
+    auto buffer = std::move(pool->Get(4096).ValueOrDie());
+    mem_block = buffer->get_mem_block();
+    std::memset(mem_block, 'x', buffer->allocated_size());
+  }
+  auto buffer = std::move(pool->Get(4096).ValueOrDie());
+  ASSERT_EQ(mem_block, buffer->get_mem_block());
+  for (int i = 0; i < buffer->allocated_size(); i++) {
+    ASSERT_EQ(0, buffer->get_mem_block()[i]) << "at offset " << i;
+  }
+}
+
+TEST(BufferPoolTest, BuffersMayOutliveThePool) {
+  auto pool = NewPool(BufferPool::Options());
+  auto buffer = std::move(pool->Get(4096).ValueOrDie());
+  pool.reset();
+  std::memset(buffer->get_mem_block(), 'a', buffer->allocated_size());
+  buffer.reset();
+  // A new pool does not get the blocks of the deleted one.
+  pool = NewPool(BufferPool::Options());
+  pool->Get(4096).ValueOrDie().reset();
+  EXPECT_EQ(1, pool->GetStats().allocated_blocks);
+  EXPECT_EQ(0, pool->GetStats().reused_blocks);
+}
+
+TEST(BufferPoolTest, ConcurrentUse) {
+  auto pool = NewPool(BufferPool::Options());
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; t++) {
+    threads.emplace_back([&pool, t]() {
+      for (int i = 0; i < 200; i++) {
+        int size = 1000 * (1 + (i + t) % 20);
+        auto buffer = std::move(pool->Get(size).ValueOrDie());
+        std::memset(buffer->get_mem_block(), t, size);
+        for (int j = 0; j < size; j += 97) {
+          ASSERT_EQ(t, buffer->get_mem_block()[j]);
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  BufferPool::Stats stats = pool->GetStats();
+  EXPECT_EQ(800, stats.allocated_blocks + stats.reused_blocks);
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
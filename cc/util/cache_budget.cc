@@ -0,0 +1,171 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/util/cache_budget.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "tink/monitoring.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+
+CacheBudget::Registration::~Registration() { budget_->Unregister(this); }
+
+void CacheBudget::Registration::Add(int64_t delta) {
+  bytes_.fetch_add(delta, std::memory_order_relaxed);
+  int64_t used_bytes =
+      budget_->used_bytes_.fetch_add(delta, std::memory_order_relaxed) + delta;
+  int64_t max_bytes = budget_->max_bytes();
+  if (delta > 0 && used_bytes > max_bytes) budget_->ShrinkTo(max_bytes);
+}
+
+// static
+StatusOr<std::shared_ptr<CacheBudget>> CacheBudget::New(int64_t max_bytes) {
+  if (max_bytes <= 0) {
+    return Status(error::INVALID_ARGUMENT, "max_bytes must be positive");
+  }
+  std::shared_ptr<CacheBudget> budget(new CacheBudget(max_bytes));
+  std::shared_ptr<MonitoringClient> client = Monitoring::GetClient();
+  if (client != nullptr) client->AddCacheBudget(budget);
+  return budget;
+}
+
+StatusOr<std::unique_ptr<CacheBudget::Registration>> CacheBudget::Register(
+    absl::string_view name, double cost, Cache* cache) {
+  if (!(cost > 0)) {
+    return Status(error::INVALID_ARGUMENT, "cost must be positive");
+  }
+  if (cache == nullptr) {
+    return Status(error::INVALID_ARGUMENT, "cache must be non-null");
+  }
+  auto registration =
+      absl::WrapUnique(new Registration(shared_from_this(), name, cost, cache));
+  absl::MutexLock lock(&mutex_);
+  registrations_.push_back(registration.get());
+  return std::move(registration);
+}
+
+Status CacheBudget::SetMaxBytes(int64_t max_bytes) {
+  if (max_bytes <= 0) {
+    return Status(error::INVALID_ARGUMENT, "max_bytes must be positive");
+  }
+  max_bytes_.store(max_bytes, std::memory_order_relaxed);
+  ShrinkTo(max_bytes);
+  return OkStatus();
+}
+
+void CacheBudget::HandleMemoryPressure(double fraction) {
+  if (!(fraction > 0)) return;
+  int64_t used = used_bytes();
+  if (fraction >= 1) {
+    ShrinkTo(0);
+    return;
+  }
+  ShrinkTo(used - static_cast<int64_t>(std::ceil(used * fraction)));
+}
+
+std::vector<CacheBudget::CacheUsage> CacheBudget::GetUsage() const {
+  absl::MutexLock lock(&mutex_);
+  std::vector<CacheUsage> usage;
+  usage.reserve(registrations_.size());
+  for (const Registration* registration : registrations_) {
+    usage.push_back(
+        {registration->name_,
+         registration->bytes_.load(std::memory_order_relaxed),
+         registration->evicted_bytes_.load(std::memory_order_relaxed)});
+  }
+  return usage;
+}
+
+void CacheBudget::ShrinkTo(int64_t target_bytes) {
+  absl::MutexLock lock(&mutex_);
+  // Another thread may have evicted enough while we waited for the lock.
+  int64_t excess = used_bytes() - target_bytes;
+  if (excess <= 0) return;
+
+  // Every cache gives up a share of the excess proportional to its memory
+  // divided by its cost.
+  std::vector<int64_t> bytes;
+  bytes.reserve(registrations_.size());
+  double total_weight = 0;
+  for (const Registration* registration : registrations_) {
+    bytes.push_back(registration->bytes_.load(std::memory_order_relaxed));
+    if (bytes.back() > 0) total_weight += bytes.back() / registration->cost_;
+  }
+  if (total_weight > 0) {
+    const double total_excess = excess;
+    // The caches evict whole entries, so the first caches asked tend to free
+    // more than their share. Start with a different cache every time.
+    size_t count = registrations_.size();
+    next_first_ = (next_first_ + 1) % count;
+    for (size_t j = 0; j < count && excess > 0; j++) {
+      size_t i = (next_first_ + j) % count;
+      if (bytes[i] <= 0) continue;
+      double weight = bytes[i] / registrations_[i]->cost_;
+      int64_t share = static_cast<int64_t>(
+          std::ceil(total_excess * weight / total_weight));
+      excess -= Evict(registrations_[i], std::min(share, excess));
+    }
+  }
+  if (excess <= 0) return;
+
+  // The caches freed less than they were asked to, e.g. since they shrank
+  // concurrently. Take the rest from the cheapest caches first.
+  std::vector<Registration*> by_cost = registrations_;
+  std::stable_sort(by_cost.begin(), by_cost.end(),
+                   [](const Registration* a, const Registration* b) {
+                     return a->cost_ < b->cost_;
+                   });
+  for (Registration* registration : by_cost) {
+    if (excess <= 0) break;
+    excess -= Evict(registration, excess);
+  }
+}
+
+int64_t CacheBudget::Evict(Registration* registration, int64_t bytes) {
+  if (bytes <= 0) return 0;
+  int64_t freed = registration->cache_->Evict(bytes);
+  if (freed <= 0) return 0;
+  registration->bytes_.fetch_sub(freed, std::memory_order_relaxed);
+  registration->evicted_bytes_.fetch_add(freed, std::memory_order_relaxed);
+  used_bytes_.fetch_sub(freed, std::memory_order_relaxed);
+  return freed;
+}
+
+void CacheBudget::Unregister(Registration* registration) {
+  absl::MutexLock lock(&mutex_);
+  registrations_.erase(std::find(registrations_.begin(),
+                                 registrations_.end(), registration));
+  used_bytes_.fetch_sub(registration->bytes_.load(std::memory_order_relaxed),
+                        std::memory_order_relaxed);
+}
+
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,170 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TINK_UTIL_CACHE_BUDGET_H_
+#define TINK_UTIL_CACHE_BUDGET_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+
+// A memory budget shared by several caches, so that together they hold at
+// most 'max_bytes' bytes, instead of each staying below a limit of its own:
+//
+//   auto budget = CacheBudget::New(/* max_bytes= */ 256 << 20).ValueOrDie();
+//   CachingDeterministicAead::Options options;
+//   options.budget = budget;
+//   ...
+//
+// Caches register with Register() and report the memory of their entries
+// with Registration::Add(). Whenever the caches hold more than the budget,
+// the excess is evicted from all caches, each giving up a share which is
+// proportional to its memory divided by its 'cost', the relative cost of
+// recomputing a byte of its entries. A cache whose entries are cheap to
+// recompute thus shrinks more than one whose entries are expensive.
+//
+// HandleMemoryPressure() and SetMaxBytes() shrink all caches together, e.g.
+// when the process is notified that memory is low. Budgets created while a
+// MonitoringClient is installed are passed to its AddCacheBudget(), which
+// can export GetUsage() periodically.
+//
+// Instances are thread-safe.
+class CacheBudget : public std::enable_shared_from_this<CacheBudget> {
+ public:
+  // Implemented by the caches using a budget.
+  class Cache {
+   public:
+    virtual ~Cache() = default;
+
+    // Evicts entries holding at least 'bytes' bytes, or all entries if they
+    // hold less, and returns the number of bytes freed. The freed bytes must
+    // not be reported with Registration::Add(). Must not call into the
+    // budget.
+    virtual int64_t Evict(int64_t bytes) = 0;
+  };
+
+  // The memory of a registered cache.
+  struct CacheUsage {
+    std::string name;
+    int64_t bytes;
+    // The number of bytes evicted to stay within the budget.
+    int64_t evicted_bytes;
+  };
+
+  // The membership of a cache in a budget. The cache is unregistered, and
+  // its bytes no longer count against the budget, once this is destroyed.
+  class Registration {
+   public:
+    Registration(const Registration&) = delete;
+    Registration& operator=(const Registration&) = delete;
+
+    ~Registration();
+
+    // Records that the cache now holds 'delta' more bytes, or less if it is
+    // negative, and evicts entries of all caches if the budget is exceeded.
+    // Must not be called while holding a lock which Evict() acquires.
+    void Add(int64_t delta);
+
+   private:
+    friend class CacheBudget;
+
+    Registration(std::shared_ptr<CacheBudget> budget, absl::string_view name,
+                 double cost, Cache* cache)
+        : budget_(std::move(budget)), name_(name), cost_(cost), cache_(cache) {}
+
+    const std::shared_ptr<CacheBudget> budget_;
+    const std::string name_;
+    const double cost_;
+    Cache* const cache_;
+    std::atomic<int64_t> bytes_{0};
+    std::atomic<int64_t> evicted_bytes_{0};
+  };
+
+  // Returns a budget of 'max_bytes', which must be positive.
+  static crypto::tink::util::StatusOr<std::shared_ptr<CacheBudget>> New(
+      int64_t max_bytes);
+
+  CacheBudget(const CacheBudget&) = delete;
+  CacheBudget& operator=(const CacheBudget&) = delete;
+
+  // Registers 'cache' under 'name', e.g. for GetUsage(). 'cost' must be
+  // positive; entries of caches with a higher cost are evicted later.
+  // 'cache' must outlive the returned Registration.
+  crypto::tink::util::StatusOr<std::unique_ptr<Registration>> Register(
+      absl::string_view name, double cost, Cache* cache)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Changes the budget to 'max_bytes', which must be positive, and evicts
+  // entries if the caches hold more.
+  crypto::tink::util::Status SetMaxBytes(int64_t max_bytes)
+      ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Evicts 'fraction' of the memory held by the caches, where 'fraction' is
+  // between 0 and 1. The budget itself is unchanged, so the caches may grow
+  // again afterwards; lower it with SetMaxBytes() to keep them small.
+  void HandleMemoryPressure(double fraction) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  int64_t max_bytes() const {
+    return max_bytes_.load(std::memory_order_relaxed);
+  }
+
+  // The memory held by all registered caches.
+  int64_t used_bytes() const {
+    return used_bytes_.load(std::memory_order_relaxed);
+  }
+
+  // Returns the memory of every registered cache, in registration order.
+  std::vector<CacheUsage> GetUsage() const ABSL_LOCKS_EXCLUDED(mutex_);
+
+ private:
+  explicit CacheBudget(int64_t max_bytes) : max_bytes_(max_bytes) {}
+
+  // Evicts entries until the caches hold at most 'target_bytes'.
+  void ShrinkTo(int64_t target_bytes) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  // Asks the cache of 'registration' to evict 'bytes', and returns the
+  // number of bytes it freed.
+  int64_t Evict(Registration* registration, int64_t bytes)
+      ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+
+  void Unregister(Registration* registration) ABSL_LOCKS_EXCLUDED(mutex_);
+
+  std::atomic<int64_t> max_bytes_;
+  std::atomic<int64_t> used_bytes_{0};
+  // Held while evicting, so that caches are not unregistered meanwhile.
+  mutable absl::Mutex mutex_;
+  std::vector<Registration*> registrations_ ABSL_GUARDED_BY(mutex_);
+  // The index of the cache ShrinkTo() asks first.
+  size_t next_first_ ABSL_GUARDED_BY(mutex_) = 0;
+};
+
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_UTIL_CACHE_BUDGET_H_
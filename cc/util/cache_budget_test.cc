@@ -0,0 +1,247 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#include "tink/util/cache_budget.h"
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
+#include "tink/monitoring.h"
+#include "tink/util/status.h"
+#include "tink/util/test_matchers.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+namespace {
+
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::testing::Eq;
+using ::testing::Ge;
+using ::testing::Le;
+using ::testing::SizeIs;
+
+// A cache of entries which only have a size, evicted oldest first.
+class FakeCache : public CacheBudget::Cache {
+ public:
+  void Insert(int64_t size) {
+    {
+      absl::MutexLock lock(&mutex_);
+      entries_.push_back(size);
+      bytes_ += size;
+    }
+    registration->Add(size);
+  }
+
+  int64_t Evict(int64_t bytes) override {
+    absl::MutexLock lock(&mutex_);
+    int64_t freed = 0;
+    while (freed < bytes && !entries_.empty()) {
+      freed += entries_.front();
+      entries_.pop_front();
+    }
+    bytes_ -= freed;
+    return freed;
+  }
+
+  int64_t bytes() {
+    absl::MutexLock lock(&mutex_);
+    return bytes_;
+  }
+
+ private:
+  absl::Mutex mutex_;
+  std::deque<int64_t> entries_ ABSL_GUARDED_BY(mutex_);
+  int64_t bytes_ ABSL_GUARDED_BY(mutex_) = 0;
+
+ public:
+  // Destroyed first.
+  std::unique_ptr<CacheBudget::Registration> registration;
+};
+
+std::shared_ptr<CacheBudget> NewBudget(int64_t max_bytes) {
+  auto budget_result = CacheBudget::New(max_bytes);
+  EXPECT_THAT(budget_result.status(), IsOk());
+  return budget_result.ValueOrDie();
+}
+
+void RegisterWith(CacheBudget* budget, absl::string_view name, double cost,
+                  FakeCache* cache) {
+  auto registration_result = budget->Register(name, cost, cache);
+  ASSERT_THAT(registration_result.status(), IsOk());
+  cache->registration = std::move(registration_result.ValueOrDie());
+}
+
+TEST(CacheBudgetTest, InvalidArguments) {
+  EXPECT_THAT(CacheBudget::New(0).status(),
+              StatusIs(error::INVALID_ARGUMENT));
+  std::shared_ptr<CacheBudget> budget = NewBudget(1000);
+  FakeCache cache;
+  EXPECT_THAT(budget->Register("cache", 0, &cache).status(),
+              StatusIs(error::INVALID_ARGUMENT));
+  EXPECT_THAT(budget->Register("cache", 1, nullptr).status(),
+              StatusIs(error::INVALID_ARGUMENT));
+  EXPECT_THAT(budget->SetMaxBytes(-1), StatusIs(error::INVALID_ARGUMENT));
+  EXPECT_THAT(budget->max_bytes(), Eq(1000));
+}
+
+TEST(CacheBudgetTest, CachesShareTheBudget) {
+  std::shared_ptr<CacheBudget> budget = NewBudget(1000);
+  FakeCache first_cache;
+  FakeCache second_cache;
+  RegisterWith(budget.get(), "first", 1, &first_cache);
+  RegisterWith(budget.get(), "second", 1, &second_cache);
+  for (int i = 0; i < 100; i++) {
+    first_cache.Insert(10);
+    second_cache.Insert(10);
+    EXPECT_THAT(budget->used_bytes(), Le(1000));
+  }
+  EXPECT_THAT(first_cache.bytes() + second_cache.bytes(),
+              Eq(budget->used_bytes()));
+  EXPECT_THAT(first_cache.bytes(), Ge(400));
+  EXPECT_THAT(second_cache.bytes(), Ge(400));
+
+  std::vector<CacheBudget::CacheUsage> usage = budget->GetUsage();
+  ASSERT_THAT(usage, SizeIs(2));
+  EXPECT_THAT(usage[0].name, Eq("first"));
+  EXPECT_THAT(usage[0].bytes, Eq(first_cache.bytes()));
+  EXPECT_THAT(usage[0].evicted_bytes, Eq(1000 - first_cache.bytes()));
+  EXPECT_THAT(usage[1].name, Eq("second"));
+  EXPECT_THAT(usage[1].bytes, Eq(second_cache.bytes()));
+  EXPECT_THAT(usage[1].evicted_bytes, Eq(1000 - second_cache.bytes()));
+}
+
+TEST(CacheBudgetTest, EvictsCheapEntriesFirst) {
+  std::shared_ptr<CacheBudget> budget = NewBudget(10000);
+  FakeCache cheap_cache;
+  FakeCache expensive_cache;
+  RegisterWith(budget.get(), "cheap", 1, &cheap_cache);
+  RegisterWith(budget.get(), "expensive", 4, &expensive_cache);
+  for (int i = 0; i < 500; i++) {
+    cheap_cache.Insert(10);
+    expensive_cache.Insert(10);
+  }
+  // Both caches hold 5000 bytes, and give up shares of the excess of 2500
+  // bytes in the ratio 5000 / 1 to 5000 / 4.
+  EXPECT_THAT(budget->SetMaxBytes(7500), IsOk());
+  EXPECT_THAT(cheap_cache.bytes(), Eq(3000));
+  EXPECT_THAT(expensive_cache.bytes(), Eq(4500));
+}
+
+TEST(CacheBudgetTest, HandleMemoryPressure) {
+  std::shared_ptr<CacheBudget> budget = NewBudget(10000);
+  FakeCache first_cache;
+  FakeCache second_cache;
+  RegisterWith(budget.get(), "first", 1, &first_cache);
+  RegisterWith(budget.get(), "second", 1, &second_cache);
+  for (int i = 0; i < 200; i++) {
+    first_cache.Insert(10);
+    second_cache.Insert(10);
+  }
+  budget->HandleMemoryPressure(0.5);
+  EXPECT_THAT(budget->used_bytes(), Eq(2000));
+  EXPECT_THAT(first_cache.bytes(), Eq(1000));
+  EXPECT_THAT(second_cache.bytes(), Eq(1000));
+
+  budget->HandleMemoryPressure(0);
+  EXPECT_THAT(budget->used_bytes(), Eq(2000));
+  budget->HandleMemoryPressure(1);
+  EXPECT_THAT(budget->used_bytes(), Eq(0));
+  EXPECT_THAT(first_cache.bytes(), Eq(0));
+  EXPECT_THAT(second_cache.bytes(), Eq(0));
+}
+
+TEST(CacheBudgetTest, SetMaxBytes) {
+  std::shared_ptr<CacheBudget> budget = NewBudget(10000);
+  FakeCache cache;
+  RegisterWith(budget.get(), "cache", 1, &cache);
+  for (int i = 0; i < 100; i++) cache.Insert(100);
+  EXPECT_THAT(budget->SetMaxBytes(5000), IsOk());
+  EXPECT_THAT(budget->max_bytes(), Eq(5000));
+  EXPECT_THAT(cache.bytes(), Eq(5000));
+  cache.Insert(100);
+  EXPECT_THAT(cache.bytes(), Eq(5000));
+}
+
+TEST(CacheBudgetTest, UnregisteredCachesReleaseTheirBytes) {
+  std::shared_ptr<CacheBudget> budget = NewBudget(1000);
+  FakeCache cache;
+  {
+    FakeCache temporary_cache;
+    RegisterWith(budget.get(), "temporary", 1, &temporary_cache);
+    temporary_cache.Insert(600);
+    EXPECT_THAT(budget->used_bytes(), Eq(600));
+  }
+  EXPECT_THAT(budget->used_bytes(), Eq(0));
+  EXPECT_THAT(budget->GetUsage(), SizeIs(0));
+  RegisterWith(budget.get(), "cache", 1, &cache);
+  cache.Insert(600);
+  EXPECT_THAT(cache.bytes(), Eq(600));
+}
+
+TEST(CacheBudgetTest, ConcurrentUse) {
+  std::shared_ptr<CacheBudget> budget = NewBudget(10000);
+  std::vector<std::unique_ptr<FakeCache>> caches;
+  for (int i = 0; i < 4; i++) {
+    caches.push_back(absl::make_unique<FakeCache>());
+    RegisterWith(budget.get(), "cache", i + 1, caches.back().get());
+  }
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; t++) {
+    threads.emplace_back([&caches, t]() {
+      for (int i = 0; i < 1000; i++) caches[(i + t) % 4]->Insert(10 + t);
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  int64_t bytes = 0;
+  for (const auto& cache : caches) bytes += cache->bytes();
+  EXPECT_THAT(bytes, Eq(budget->used_bytes()));
+  EXPECT_THAT(bytes, Le(10000));
+}
+
+class BudgetMonitoringClient : public MonitoringClient {
+ public:
+  void AddCacheBudget(std::shared_ptr<const CacheBudget> budget) override {
+    budgets.push_back(std::move(budget));
+  }
+  void RecordSample(const MonitoringSample& sample) override {}
+
+  std::vector<std::shared_ptr<const CacheBudget>> budgets;
+};
+
+TEST(CacheBudgetTest, ReportsToMonitoring) {
+  auto client = std::make_shared<BudgetMonitoringClient>();
+  Monitoring::SetClient(client);
+  std::shared_ptr<CacheBudget> budget = NewBudget(1000);
+  Monitoring::SetClient(nullptr);
+  ASSERT_THAT(client->budgets, SizeIs(1));
+  EXPECT_THAT(client->budgets[0].get(), Eq(budget.get()));
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
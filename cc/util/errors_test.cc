@@ -52,6 +52,44 @@ TEST(ErrorsTest, ToAbslStatus) {
   EXPECT_EQ(::absl::Status(crypto::tink::util::OkStatus()), ::absl::OkStatus());
 }
 
+TEST(ErrorsTest, InternedStatus) {
+  static const std::string* message = new std::string("interned message");
+  util::Status status =
+      util::Status::Interned(util::error::INTERNAL, *message);
+  EXPECT_FALSE(status.ok());
+  EXPECT_EQ(util::error::INTERNAL, status.error_code());
+  // The message is referenced, also by copies, not copied.
+  EXPECT_EQ(message, &status.error_message());
+  util::Status copy = status;
+  EXPECT_EQ(message, &copy.error_message());
+  util::Status assigned;
+  assigned = status;
+  EXPECT_EQ(message, &assigned.error_message());
+
+  EXPECT_EQ(util::Status(util::error::INTERNAL, "interned message"), status);
+  EXPECT_EQ("INTERNAL: interned message", status.ToString());
+  EXPECT_EQ(::absl::Status(status).message(), "interned message");
+
+  EXPECT_TRUE(util::Status::Interned(util::error::OK, *message).ok());
+  EXPECT_EQ("",
+            util::Status::Interned(util::error::OK, *message).error_message());
+}
+
+TEST(ErrorsTest, HotPathErrors) {
+  EXPECT_EQ(util::Status(util::error::INVALID_ARGUMENT, "decryption failed"),
+            util::DecryptionFailedError());
+  EXPECT_EQ(util::Status(util::error::INTERNAL, "decryption failed"),
+            util::DecryptionFailedError(util::error::INTERNAL));
+  EXPECT_EQ(util::Status(util::error::INVALID_ARGUMENT, "Ciphertext too short"),
+            util::CiphertextTooShortError());
+  EXPECT_EQ(util::Status(util::error::INTERNAL, "Authentication failed"),
+            util::AuthenticationFailedError());
+  // All share the same message.
+  util::Status internal = util::DecryptionFailedError(util::error::INTERNAL);
+  EXPECT_EQ(&util::DecryptionFailedError().error_message(),
+            &internal.error_message());
+}
+
 }  // namespace
 }  // namespace tink
 }  // namespace crypto
@@ -0,0 +1,42 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_UTIL_EXECUTOR_H_
+#define TINK_UTIL_EXECUTOR_H_
+
+#include <functional>
+
+namespace crypto {
+namespace tink {
+namespace util {
+
+// Runs tasks asynchronously, e.g. on a thread pool or on the event loop of a
+// server. Tink uses it to run the operations of asynchronous primitives.
+//
+// Implementations are expected to be thread safe.
+class Executor {
+ public:
+  // Runs 'task' once, at some later point and in any thread.
+  virtual void Schedule(std::function<void()> task) = 0;
+
+  virtual ~Executor() {}
+};
+
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_UTIL_EXECUTOR_H_
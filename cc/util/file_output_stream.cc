@@ -16,9 +16,13 @@
 
 #include "tink/util/file_output_stream.h"
 
+#include <fcntl.h>
 #include <unistd.h>
-#include <cstring>
 #include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <limits>
 
 #include "absl/memory/memory.h"
 #include "tink/output_stream.h"
@@ -53,75 +57,182 @@ int write_ignoring_eintr(int fd, const void *buf, size_t count) {
   return result;
 }
 
+FileOutputStream::Options OptionsWithBufferSize(int buffer_size) {
+  FileOutputStream::Options options;
+  options.buffer_size = buffer_size;
+  return options;
+}
+
+// Returns buffer_size * buffers_per_write, or -1 if it is not a valid int.
+int CapacityOf(int buffer_size, int buffers_per_write) {
+  if (buffers_per_write < 1) return -1;
+  int64_t capacity = static_cast<int64_t>(buffer_size) * buffers_per_write;
+  if (capacity > std::numeric_limits<int>::max()) return -1;
+  return static_cast<int>(capacity);
+}
+
+int datasync(int fd) {
+#if defined(__linux__)
+  return fdatasync(fd);
+#else
+  return fsync(fd);
+#endif
+}
+
 }  // anonymous namespace
 
 
-FileOutputStream::FileOutputStream(int file_descriptor, int buffer_size) :
-    buffer_size_(buffer_size > 0 ? buffer_size : 128 * 1024) {  // 128 KB
+FileOutputStream::FileOutputStream(int file_descriptor, int buffer_size)
+    : FileOutputStream(file_descriptor, OptionsWithBufferSize(buffer_size)) {}
+
+FileOutputStream::FileOutputStream(int file_descriptor, const Options& options)
+    : options_(options),
+      buffer_size_(options.buffer_size > 0 ? options.buffer_size
+                                           : 128 * 1024),  // 128 KB
+      capacity_(CapacityOf(buffer_size_, options.buffers_per_write)) {
   fd_ = file_descriptor;
   count_in_buffer_ = 0;
-  count_backedup_ = 0;
+  count_returned_ = 0;
   buffer_ = nullptr;
+  data_ = nullptr;
   position_ = 0;
-  buffer_offset_ = 0;
-  status_ = Status::OK;
+  synced_offset_ = 0;
+  written_offset_ = 0;
+  status_ = Initialize();
 }
 
-crypto::tink::util::StatusOr<int> FileOutputStream::Next(void** data) {
-  if (!status_.ok()) return status_;
+Status FileOutputStream::Initialize() {
+  if (capacity_ <= 0) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "buffers_per_write must be positive, and the coalesced "
+                  "write size must fit an int");
+  }
+  if (options_.sync_interval_bytes < 0 || options_.preallocate_size < 0) {
+    return Status(util::error::INVALID_ARGUMENT,
+                  "sync_interval_bytes and preallocate_size must not be "
+                  "negative");
+  }
+  bool needs_offset = options_.direct_io || options_.preallocate_size > 0 ||
+                      options_.sync_policy == SyncPolicy::kSyncFileRange;
+  if (!needs_offset) return Status::OK;
+  off_t offset = lseek(fd_, 0, SEEK_CUR);
+  if (offset < 0) {
+    return ToStatusF(util::error::INVALID_ARGUMENT,
+                     "The file options require a seekable file: %d", errno);
+  }
+  synced_offset_ = offset;
+  written_offset_ = offset;
 
-  if (buffer_ == nullptr) {  // possible only at the first call to Next()
-    buffer_ = absl::make_unique<uint8_t[]>(buffer_size_);
-    *data = buffer_.get();
-    count_in_buffer_ = buffer_size_;
-    position_ = buffer_size_;
-    return buffer_size_;
+  if (options_.direct_io) {
+    int alignment = options_.direct_io_alignment;
+    if (alignment <= 0 || (alignment & (alignment - 1)) != 0) {
+      return Status(util::error::INVALID_ARGUMENT,
+                    "direct_io_alignment must be a power of 2");
+    }
+    if (capacity_ % alignment != 0 || offset % alignment != 0) {
+      return Status(util::error::INVALID_ARGUMENT,
+                    "With direct_io, the write size and the file offset must "
+                    "be multiples of direct_io_alignment");
+    }
+#if defined(O_DIRECT)
+    int flags = fcntl(fd_, F_GETFL);
+    if (flags == -1 || fcntl(fd_, F_SETFL, flags | O_DIRECT) == -1) {
+      return ToStatusF(util::error::INVALID_ARGUMENT,
+                       "Could not enable O_DIRECT: %d", errno);
+    }
+#else
+    return Status(util::error::UNIMPLEMENTED,
+                  "direct_io is not supported on this platform");
+#endif
   }
 
-  // If some space was backed up, return it first.
-  if (count_backedup_ > 0) {
-    position_ = position_ + count_backedup_;
-    buffer_offset_ = count_in_buffer_;
-    count_in_buffer_ = count_in_buffer_ + count_backedup_;
-    int backedup = count_backedup_;
-    count_backedup_ = 0;
-    *data = buffer_.get() + buffer_offset_;
-    return backedup;
+#if defined(__linux__)
+  if (options_.preallocate_size > 0 &&
+      fallocate(fd_, FALLOC_FL_KEEP_SIZE, offset,
+                options_.preallocate_size) == -1 &&
+      errno != EOPNOTSUPP && errno != ENOSYS) {
+    return ToStatusF(util::error::INTERNAL,
+                     "I/O error upon fallocate: %d", errno);
   }
+#endif
+  return Status::OK;
+}
 
-  // No space was backed up, so count_in_buffer_ == buffer_size_ holds here.
-  // Write the data from the buffer, and return available space in buffer_.
-  // The available space might not span the entire buffer_, as writing
-  // may succeed only for a prefix of buffer_ -- in this case the data still
-  // to be written is shifted in buffer_ and the remaining space is returned.
-  int write_result = write_ignoring_eintr(fd_, buffer_.get(), buffer_size_);
-  if (write_result <= 0) {  // No data written or an I/O error occurred.
-    if (write_result == 0) {
-      return 0;
+Status FileOutputStream::WriteBuffer(const uint8_t* data, int count) {
+  int total_written = 0;
+  while (total_written < count) {
+    int write_result = write_ignoring_eintr(fd_, data + total_written,
+                                            count - total_written);
+    if (write_result < 0) {  // An I/O error occurred.
+      return ToStatusF(
+          util::error::INTERNAL, "I/O error upon write: %d", errno);
+    } else if (write_result == 0) {  // No progress, hence abort.
+      return ToStatusF(util::error::INTERNAL,
+          "I/O error: failed to write %d bytes.", count - total_written);
     }
-    status_ = ToStatusF(
-        util::error::INTERNAL, "I/O error upon write: %d", errno);
-    return status_;
+    // Managed to write some bytes, hence continue.
+    total_written += write_result;
   }
-  // Some data was written, so we can return some portion of buffer_.
-  position_ = position_ + write_result;
-  count_in_buffer_ = buffer_size_;
-  count_backedup_ = 0;
-  buffer_offset_ = buffer_size_ - write_result;
-  *data = buffer_.get() + buffer_offset_;
-  if (write_result < buffer_size_) {
-    // Only part of the data was written, shift the remaining data in buffer_.
-    // Using memmove, as source and destination may overlap.
-    std::memmove(buffer_.get(), buffer_.get() + write_result, buffer_offset_);
+  written_offset_ += count;
+  if (options_.sync_policy != SyncPolicy::kNone &&
+      options_.sync_interval_bytes > 0 &&
+      written_offset_ - synced_offset_ >= options_.sync_interval_bytes) {
+    return Sync();
   }
-  return write_result;
+  return Status::OK;
+}
+
+Status FileOutputStream::Sync() {
+#if defined(__linux__)
+  if (options_.sync_policy == SyncPolicy::kSyncFileRange) {
+    if (sync_file_range(fd_, synced_offset_, written_offset_ - synced_offset_,
+                        SYNC_FILE_RANGE_WRITE) == -1) {
+      return ToStatusF(
+          util::error::INTERNAL, "I/O error upon sync_file_range: %d", errno);
+    }
+    synced_offset_ = written_offset_;
+    return Status::OK;
+  }
+#endif
+  if (datasync(fd_) == -1) {
+    return ToStatusF(util::error::INTERNAL, "I/O error upon sync: %d", errno);
+  }
+  synced_offset_ = written_offset_;
+  return Status::OK;
+}
+
+crypto::tink::util::StatusOr<int> FileOutputStream::Next(void** data) {
+  if (!status_.ok()) return status_;
+
+  if (buffer_ == nullptr) {  // possible only at the first call to Next()
+    // With direct_io, data_ must be aligned.
+    int alignment = options_.direct_io ? options_.direct_io_alignment : 1;
+    buffer_ = absl::make_unique<uint8_t[]>(capacity_ + alignment - 1);
+    uintptr_t address = reinterpret_cast<uintptr_t>(buffer_.get());
+    data_ = buffer_.get() + (alignment - address % alignment) % alignment;
+  } else if (count_in_buffer_ == capacity_) {
+    // The buffers are full, write them all at once.
+    Status status = WriteBuffer(data_, capacity_);
+    if (!status.ok()) {
+      status_ = status;
+      return status_;
+    }
+    count_in_buffer_ = 0;
+  }
+
+  // Return the next buffer, or the space backed up in the current one.
+  int count = std::min(buffer_size_, capacity_ - count_in_buffer_);
+  *data = data_ + count_in_buffer_;
+  count_in_buffer_ += count;
+  count_returned_ = count;
+  position_ += count;
+  return count;
 }
 
 void FileOutputStream::BackUp(int count) {
-  if (!status_.ok() || count < 1 || count_in_buffer_ == 0) return;
-  int curr_buffer_size = buffer_size_ - buffer_offset_;
-  int actual_count = std::min(count, curr_buffer_size - count_backedup_);
-  count_backedup_ += actual_count;
+  if (!status_.ok() || count < 1) return;
+  int actual_count = std::min(count, count_returned_);
+  count_returned_ -= actual_count;
   count_in_buffer_ -= actual_count;
   position_ -= actual_count;
 }
@@ -133,24 +244,33 @@ FileOutputStream::~FileOutputStream() {
 Status FileOutputStream::Close() {
   if (!status_.ok()) return status_;
   if (count_in_buffer_ > 0) {
-    // Try to write the remaining bytes.
-    int total_written = 0;
-    while (total_written < count_in_buffer_) {
-      int write_result = write_ignoring_eintr(
-          fd_, buffer_.get() + total_written, count_in_buffer_ - total_written);
-      if (write_result < 0) {  // An I/O error occurred.
+    // Try to write the remaining bytes. With direct_io, the unaligned rest
+    // has to be written through the page cache.
+    int direct_count = count_in_buffer_;
+    if (options_.direct_io) {
+      direct_count -= count_in_buffer_ % options_.direct_io_alignment;
+    }
+    status_ = WriteBuffer(data_, direct_count);
+    if (!status_.ok()) return status_;
+    if (direct_count < count_in_buffer_) {
+#if defined(O_DIRECT)
+      int flags = fcntl(fd_, F_GETFL);
+      if (flags == -1 || fcntl(fd_, F_SETFL, flags & ~O_DIRECT) == -1) {
         status_ = ToStatusF(
-            util::error::INTERNAL, "I/O error upon write: %d", errno);
-        return status_;
-      } else if (write_result == 0) {  // No progress, hence abort.
-        status_ = ToStatusF(util::error::INTERNAL,
-            "I/O error: failed to write %d bytes before closing.",
-            count_in_buffer_ - total_written);
+            util::error::INTERNAL, "Could not disable O_DIRECT: %d", errno);
         return status_;
       }
-      // Managed to write some bytes, hence continue.
-      total_written += write_result;
+#endif
+      status_ = WriteBuffer(data_ + direct_count,
+                            count_in_buffer_ - direct_count);
+      if (!status_.ok()) return status_;
     }
+    count_in_buffer_ = 0;
+  }
+  if (options_.sync_policy != SyncPolicy::kNone && datasync(fd_) == -1) {
+    status_ = ToStatusF(
+        util::error::INTERNAL, "I/O error upon sync: %d", errno);
+    return status_;
   }
   if (close_ignoring_eintr(fd_) == -1) {
     status_ = ToStatusF(
@@ -17,6 +17,7 @@
 #ifndef TINK_UTIL_FILE_OUTPUT_STREAM_H_
 #define TINK_UTIL_FILE_OUTPUT_STREAM_H_
 
+#include <cstdint>
 #include <memory>
 
 #include "tink/output_stream.h"
@@ -30,12 +31,58 @@ namespace util {
 // An OutputStream that writes to a file descriptor.
 class FileOutputStream : public crypto::tink::OutputStream {
  public:
+  // When the data written so far is synced to disk.
+  enum class SyncPolicy {
+    // Never; the data reaches the disk when the OS flushes its page cache.
+    kNone,
+    // With fdatasync() every 'sync_interval_bytes', and when closing.
+    kFdatasync,
+    // Like kFdatasync, but every 'sync_interval_bytes' only starts the
+    // writeback of the newly written range with sync_file_range(), without
+    // waiting for it. This keeps the amount of dirty pages bounded without
+    // blocking. Falls back to kFdatasync on platforms other than Linux.
+    kSyncFileRange,
+  };
+
+  struct Options {
+    // Size of the buffers returned by Next(). If not positive, a reasonable
+    // default is used.
+    int buffer_size = -1;
+
+    // Number of buffers that are filled before they are written together,
+    // to coalesce the writes of small buffers into one system call.
+    int buffers_per_write = 1;
+
+    SyncPolicy sync_policy = SyncPolicy::kNone;
+    // If positive, the data is synced whenever this many bytes were written
+    // since the last sync. Ignored if 'sync_policy' is kNone.
+    int64_t sync_interval_bytes = 0;
+
+    // If positive, this many bytes are preallocated at the current offset of
+    // the file, e.g. the expected size of the ciphertext, without changing
+    // the size of the file. Only supported on Linux, ignored elsewhere and
+    // by file systems that do not support it.
+    int64_t preallocate_size = 0;
+
+    // If true, writes bypass the page cache with O_DIRECT, which is only
+    // supported on Linux. The current offset of the file and the
+    // coalesced write size, buffer_size * buffers_per_write, must then be
+    // multiples of 'direct_io_alignment'; only the last write when closing
+    // may be shorter.
+    bool direct_io = false;
+    int direct_io_alignment = 4096;
+  };
+
   // Constructs an OutputStream that will write to the file specified
   // via 'file_descriptor', using a buffer of the specified size, if any
   // (if no legal 'buffer_size' is given, a reasonable default will be used).
   // Takes the ownership of the file, and will close it upon destruction.
   explicit FileOutputStream(int file_descriptor, int buffer_size = -1);
 
+  // Like above, but writes according to 'options'. If 'options' are invalid,
+  // or the file does not support them, all calls to the stream fail.
+  FileOutputStream(int file_descriptor, const Options& options);
+
   ~FileOutputStream() override;
 
   crypto::tink::util::StatusOr<int> Next(void** data) override;
@@ -47,20 +94,28 @@ class FileOutputStream : public crypto::tink::OutputStream {
   int64_t Position() const override;
 
  private:
+  // Applies the file options, returning an error if they are not supported.
+  util::Status Initialize();
+  // Writes all of the 'count' bytes at 'data'.
+  util::Status WriteBuffer(const uint8_t* data, int count);
+  // Syncs the data written since the last sync.
+  util::Status Sync();
+
   util::Status status_;
   int fd_;
-  std::unique_ptr<uint8_t[]> buffer_;
+  const Options options_;
   const int buffer_size_;
+  const int capacity_;  // buffer_size_ * options_.buffers_per_write
+  std::unique_ptr<uint8_t[]> buffer_;
+  uint8_t* data_;  // Start of the usable part of buffer_, aligned if needed.
   int64_t position_;     // current position in the file (from the beginning)
 
-  // Counters that describe the state of the data in buffer_.
-  // count_in_buffer_ is always equal to (buffer_size_ - count_backedup_),
-  // except initially (before the first call to Next()).
-  // In other words, we have an invariant:
-  // (count_in_buffer_ == buffer_size_ - count_backedup_) || buffer_ == nullptr
-  int count_in_buffer_;  // # bytes in buffer_ that will be eventually written
-  int count_backedup_;   // # bytes in buffer_ that were backed up
-  int buffer_offset_;    // offset where the returned *data starts in buffer_
+  // Counters that describe the state of the data in data_.
+  int count_in_buffer_;  // # bytes in data_ that will be eventually written
+  int count_returned_;   // # bytes of the last Next() that were not backed up
+
+  int64_t synced_offset_;      // offset in the file up to which data is synced
+  int64_t written_offset_;     // offset in the file up to which data is written
 };
 
 }  // namespace util
@@ -16,17 +16,28 @@
 
 #include "tink/util/file_output_stream.h"
 
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
 #include "gtest/gtest.h"
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
 #include "tink/subtle/random.h"
+#include "tink/util/test_matchers.h"
 #include "tink/util/test_util.h"
 
 namespace crypto {
 namespace tink {
 namespace {
 
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+
 // Writes 'contents' the specified 'output_stream', and closes the stream.
 // Returns the status of output_stream->Close()-operation, or a non-OK status
 // of a prior output_stream->Next()-operation, if any.
@@ -177,6 +188,143 @@ TEST_F(FileOutputStreamTest, BackupAndPosition) {
   EXPECT_EQ(stream_contents, file_contents);
 }
 
+TEST_F(FileOutputStreamTest, CoalescedWrites) {
+  int stream_size = 1024 * 1024 + 17;
+  int buffer_size = 1000;
+  std::string stream_contents = subtle::Random::GetRandomBytes(stream_size);
+  for (auto buffers_per_write : {1, 2, 4, 100}) {
+    SCOPED_TRACE(absl::StrCat("buffers_per_write = ", buffers_per_write));
+    std::string filename =
+        absl::StrCat(buffers_per_write, "_coalesced_test.bin");
+    int output_fd = test::GetTestFileDescriptor(filename);
+    util::FileOutputStream::Options options;
+    options.buffer_size = buffer_size;
+    options.buffers_per_write = buffers_per_write;
+    util::FileOutputStream output_stream(output_fd, options);
+
+    // Each call to Next() returns at most one buffer, also after BackUp().
+    void* buffer;
+    auto next_result = output_stream.Next(&buffer);
+    ASSERT_THAT(next_result.status(), IsOk());
+    EXPECT_EQ(buffer_size, next_result.ValueOrDie());
+    std::memcpy(buffer, stream_contents.data(), buffer_size / 2);
+    output_stream.BackUp(buffer_size / 2);
+    next_result = output_stream.Next(&buffer);
+    ASSERT_THAT(next_result.status(), IsOk());
+    EXPECT_EQ(buffers_per_write == 1 ? buffer_size / 2 : buffer_size,
+              next_result.ValueOrDie());
+    output_stream.BackUp(next_result.ValueOrDie());
+    EXPECT_EQ(buffer_size / 2, output_stream.Position());
+
+    EXPECT_THAT(
+        WriteToStream(&output_stream,
+                      stream_contents.substr(output_stream.Position())),
+        IsOk());
+    EXPECT_EQ(stream_contents, test::ReadTestFile(filename));
+  }
+}
+
+TEST_F(FileOutputStreamTest, SyncPolicies) {
+  int stream_size = 300 * 1000;
+  std::string stream_contents = subtle::Random::GetRandomBytes(stream_size);
+  using SyncPolicy = util::FileOutputStream::SyncPolicy;
+  for (auto sync_policy :
+       {SyncPolicy::kFdatasync, SyncPolicy::kSyncFileRange}) {
+    for (auto sync_interval_bytes : {0, 1, 50000}) {
+      SCOPED_TRACE(absl::StrCat("sync_policy = ", static_cast<int>(sync_policy),
+                                ", sync_interval_bytes = ",
+                                sync_interval_bytes));
+      std::string filename =
+          absl::StrCat(static_cast<int>(sync_policy), "_",
+                       sync_interval_bytes, "_sync_test.bin");
+      int output_fd = test::GetTestFileDescriptor(filename);
+      util::FileOutputStream::Options options;
+      options.buffer_size = 10000;
+      options.sync_policy = sync_policy;
+      options.sync_interval_bytes = sync_interval_bytes;
+      util::FileOutputStream output_stream(output_fd, options);
+      EXPECT_THAT(WriteToStream(&output_stream, stream_contents), IsOk());
+      EXPECT_EQ(stream_contents, test::ReadTestFile(filename));
+    }
+  }
+}
+
+TEST_F(FileOutputStreamTest, Preallocate) {
+  int stream_size = 12345;
+  std::string stream_contents = subtle::Random::GetRandomBytes(stream_size);
+  std::string filename = "preallocate_test.bin";
+  int output_fd = test::GetTestFileDescriptor(filename);
+  util::FileOutputStream::Options options;
+  options.preallocate_size = 1024 * 1024;
+  util::FileOutputStream output_stream(output_fd, options);
+
+  // Preallocating does not change the size of the file.
+  struct stat file_stat;
+  ASSERT_EQ(0, fstat(output_fd, &file_stat));
+  EXPECT_EQ(0, file_stat.st_size);
+  EXPECT_THAT(WriteToStream(&output_stream, stream_contents), IsOk());
+  EXPECT_EQ(stream_contents, test::ReadTestFile(filename));
+}
+
+TEST_F(FileOutputStreamTest, DirectIo) {
+  int stream_size = 1024 * 1024 + 17;
+  std::string stream_contents = subtle::Random::GetRandomBytes(stream_size);
+  std::string filename = "direct_io_test.bin";
+  int output_fd = test::GetTestFileDescriptor(filename);
+  util::FileOutputStream::Options options;
+  options.buffer_size = 4096;
+  options.buffers_per_write = 16;
+  options.direct_io = true;
+  util::FileOutputStream output_stream(output_fd, options);
+  void* buffer;
+  auto next_result = output_stream.Next(&buffer);
+  if (!next_result.ok()) {
+    // Not supported on this platform or file system, e.g. tmpfs.
+    close(output_fd);
+    GTEST_SKIP() << next_result.status();
+  }
+  EXPECT_EQ(0, reinterpret_cast<uintptr_t>(buffer) % 4096);
+  output_stream.BackUp(next_result.ValueOrDie());
+  EXPECT_THAT(WriteToStream(&output_stream, stream_contents), IsOk());
+  EXPECT_EQ(stream_contents, test::ReadTestFile(filename));
+}
+
+TEST_F(FileOutputStreamTest, InvalidOptions) {
+  std::vector<util::FileOutputStream::Options> invalid_options(5);
+  invalid_options[0].buffers_per_write = 0;
+  invalid_options[1].buffer_size = 1 << 20;
+  invalid_options[1].buffers_per_write = 1 << 12;
+  invalid_options[2].sync_policy =
+      util::FileOutputStream::SyncPolicy::kFdatasync;
+  invalid_options[2].sync_interval_bytes = -1;
+  invalid_options[3].preallocate_size = -1;
+  invalid_options[4].direct_io = true;
+  invalid_options[4].buffer_size = 1000;
+  for (size_t i = 0; i < invalid_options.size(); i++) {
+    SCOPED_TRACE(absl::StrCat("invalid_options[", i, "]"));
+    int output_fd = test::GetTestFileDescriptor("invalid_options_test.bin");
+    util::FileOutputStream output_stream(output_fd, invalid_options[i]);
+    void* buffer;
+    EXPECT_THAT(output_stream.Next(&buffer).status(),
+                StatusIs(util::error::INVALID_ARGUMENT));
+    EXPECT_THAT(output_stream.Close(), StatusIs(util::error::INVALID_ARGUMENT));
+    close(output_fd);
+  }
+}
+
+TEST_F(FileOutputStreamTest, OptionsRequireSeekableFile) {
+  int fds[2];
+  ASSERT_EQ(0, pipe(fds));
+  util::FileOutputStream::Options options;
+  options.preallocate_size = 1024;
+  util::FileOutputStream output_stream(fds[1], options);
+  void* buffer;
+  EXPECT_THAT(output_stream.Next(&buffer).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+  close(fds[0]);
+  close(fds[1]);
+}
+
 }  // namespace
 }  // namespace tink
 }  // namespace crypto
@@ -20,6 +20,7 @@
 #include <algorithm>
 #include <cstring>
 #include <istream>
+#include <streambuf>
 
 #include "absl/memory/memory.h"
 #include "tink/input_stream.h"
@@ -31,6 +32,24 @@ namespace crypto {
 namespace tink {
 namespace util {
 
+namespace {
+
+// Accesses the get area of a std::streambuf, whose accessors are protected.
+class GetArea : public std::streambuf {
+ public:
+  static char* Begin(std::streambuf* buffer) {
+    return (buffer->*&GetArea::gptr)();
+  }
+  static char* End(std::streambuf* buffer) {
+    return (buffer->*&GetArea::egptr)();
+  }
+  static void Bump(std::streambuf* buffer, int count) {
+    (buffer->*&GetArea::gbump)(count);
+  }
+};
+
+}  // namespace
+
 IstreamInputStream::IstreamInputStream(std::unique_ptr<std::istream> input,
                                        int buffer_size) :
     buffer_size_(buffer_size > 0 ? buffer_size : 128 * 1024) {  // 128 KB
@@ -40,6 +59,8 @@ IstreamInputStream::IstreamInputStream(std::unique_ptr<std::istream> input,
   position_ = 0;
   buffer_ = absl::make_unique<uint8_t[]>(buffer_size_);
   buffer_offset_ = 0;
+  count_in_streambuf_ = 0;
+  count_backedup_streambuf_ = 0;
   status_ = Status::OK;
 }
 
@@ -53,20 +74,51 @@ crypto::tink::util::StatusOr<int> IstreamInputStream::Next(const void** data) {
     position_ = position_ + count_in_buffer_;
     return count_in_buffer_;
   }
-  // Read new bytes to buffer_.
-  input_->read(reinterpret_cast<char*>(buffer_.get()), buffer_size_);
-  int count_read = input_->gcount();
-  if (count_read == 0) {  // Could not read bytes, EOF or an I/O error.
-    if (input_->good()) return count_read;  // No bytes could be read.
-    // If !good(), distinguish EOF from other failures.
-    if (input_->eof()) {
-      status_ = Status(util::error::OUT_OF_RANGE, "EOF");
-    } else {
-      status_ =
-          ToStatusF(util::error::INTERNAL, "I/O error: %s", strerror(errno));
-    }
+  std::streambuf* streambuf = input_->rdbuf();
+  if (streambuf == nullptr) {
+    status_ = Status(util::error::INTERNAL, "istream has no streambuf");
+    return status_;
+  }
+  if (count_backedup_streambuf_ > 0) {  // Return the backed-up bytes.
+    *data = GetArea::Begin(streambuf);
+    GetArea::Bump(streambuf, count_backedup_streambuf_);
+    count_in_streambuf_ = count_backedup_streambuf_;
+    count_backedup_streambuf_ = 0;
+    position_ = position_ + count_in_streambuf_;
+    return count_in_streambuf_;
+  }
+  // Makes the streambuf fill its get area, if it has one.
+  if (std::streambuf::traits_type::eq_int_type(
+          streambuf->sgetc(), std::streambuf::traits_type::eof())) {
+    input_->setstate(std::ios::eofbit);
+    status_ = Status(util::error::OUT_OF_RANGE, "EOF");
     return status_;
   }
+  char* get_area = GetArea::Begin(streambuf);
+  std::ptrdiff_t count_available = GetArea::End(streambuf) - get_area;
+  if (count_available >= buffer_size_) {
+    // Return a buffer of the get area, which stays valid until the next call
+    // to the streambuf.
+    GetArea::Bump(streambuf, buffer_size_);
+    count_in_buffer_ = 0;
+    count_backedup_ = 0;
+    count_in_streambuf_ = buffer_size_;
+    position_ = position_ + buffer_size_;
+    *data = get_area;
+    return buffer_size_;
+  }
+  // Copy new bytes to buffer_. For large reads, streambufs like
+  // std::filebuf read directly into buffer_, bypassing their own buffer.
+  int count_read = streambuf->sgetn(reinterpret_cast<char*>(buffer_.get()),
+                                    buffer_size_);
+  if (count_read == 0) {  // An I/O error, as sgetc() returned a byte.
+    input_->setstate(std::ios::badbit);
+    status_ =
+        ToStatusF(util::error::INTERNAL, "I/O error: %s", strerror(errno));
+    return status_;
+  }
+  count_in_streambuf_ = 0;
+  count_backedup_streambuf_ = 0;
   buffer_offset_ = 0;
   count_backedup_ = 0;
   count_in_buffer_ = count_read;
@@ -76,7 +128,17 @@ crypto::tink::util::StatusOr<int> IstreamInputStream::Next(const void** data) {
 }
 
 void IstreamInputStream::BackUp(int count) {
-  if (!status_.ok() || count < 1 || count_backedup_ == count_in_buffer_) return;
+  if (!status_.ok() || count < 1) return;
+  if (count_in_streambuf_ > 0 || count_backedup_streambuf_ > 0) {
+    // The backed up bytes are still in the get area.
+    int actual_count = std::min(count, count_in_streambuf_);
+    GetArea::Bump(input_->rdbuf(), -actual_count);
+    count_in_streambuf_ = count_in_streambuf_ - actual_count;
+    count_backedup_streambuf_ = count_backedup_streambuf_ + actual_count;
+    position_ = position_ - actual_count;
+    return;
+  }
+  if (count_backedup_ == count_in_buffer_) return;
   int actual_count = std::min(count, count_in_buffer_ - count_backedup_);
   count_backedup_ = count_backedup_ + actual_count;
   position_ = position_ - actual_count;
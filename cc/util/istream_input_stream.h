@@ -28,7 +28,11 @@ namespace crypto {
 namespace tink {
 namespace util {
 
-// An InputStream that reads from a std::istream.
+// An InputStream that reads from a std::istream. It reads from the
+// std::streambuf of the istream directly, without the sentry and state
+// handling of std::istream::read(). If the streambuf holds at least a buffer
+// of data in its get area, as a std::stringbuf does, Next() returns a pointer
+// into the get area instead of copying the data.
 class IstreamInputStream : public crypto::tink::InputStream {
  public:
   // Constructs an InputStream that will read from the 'input' istream,
@@ -56,6 +60,11 @@ class IstreamInputStream : public crypto::tink::InputStream {
   int count_in_buffer_;  // # of bytes available in buffer_
   int count_backedup_;   // # of bytes available in buffer_ that were backed up
   int buffer_offset_;    // offset at which the returned bytes start in buffer_
+
+  // Counters that describe the bytes returned from the get area of the
+  // streambuf. If either is positive, buffer_ holds no data.
+  int count_in_streambuf_;       // # of bytes returned and not backed up
+  int count_backedup_streambuf_;  // # of bytes backed up into the get area
 };
 
 }  // namespace util
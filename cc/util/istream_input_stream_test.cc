@@ -20,6 +20,8 @@
 #include <fstream>
 #include <iostream>
 #include <istream>
+#include <sstream>
+#include <streambuf>
 
 #include "gtest/gtest.h"
 #include "absl/memory/memory.h"
@@ -186,6 +188,67 @@ TEST_F(IstreamInputStreamTest, testBackupAndPosition) {
             std::string(static_cast<const char*>(buffer), buffer_size));
 }
 
+TEST_F(IstreamInputStreamTest, testReadingStringStreams) {
+  for (int stream_size : {0, 10, 1000, 100000, 1000000}) {
+    for (int buffer_size : {-1, 1, 1000, 4096}) {
+      std::string contents = subtle::Random::GetRandomBytes(stream_size);
+      auto input_stream = absl::make_unique<util::IstreamInputStream>(
+          absl::make_unique<std::istringstream>(contents), buffer_size);
+      std::string stream_contents;
+      auto status = ReadTillEnd(input_stream.get(), &stream_contents);
+      EXPECT_EQ(util::error::OUT_OF_RANGE, status.error_code());
+      EXPECT_EQ(contents, stream_contents);
+      EXPECT_EQ(stream_size, input_stream->Position());
+    }
+  }
+}
+
+// A std::stringbuf holds all of its data in the get area, which Next()
+// returns without copying.
+TEST_F(IstreamInputStreamTest, testStringStreamBackupAndPosition) {
+  int buffer_size = 1234;
+  std::string contents = subtle::Random::GetRandomBytes(3 * buffer_size);
+  auto input = absl::make_unique<std::istringstream>(contents);
+  std::streambuf* streambuf = input->rdbuf();
+  auto input_stream = absl::make_unique<util::IstreamInputStream>(
+      std::move(input), buffer_size);
+
+  const void* buffer;
+  auto next_result = input_stream->Next(&buffer);
+  ASSERT_TRUE(next_result.ok()) << next_result.status();
+  EXPECT_EQ(buffer_size, next_result.ValueOrDie());
+  EXPECT_EQ(contents.substr(0, buffer_size),
+            std::string(static_cast<const char*>(buffer), buffer_size));
+  const void* first_buffer = buffer;
+
+  input_stream->BackUp(100);
+  input_stream->BackUp(34);
+  EXPECT_EQ(buffer_size - 134, input_stream->Position());
+  // The streambuf is at the position of the InputStream.
+  EXPECT_EQ(contents[buffer_size - 134], streambuf->sgetc());
+
+  next_result = input_stream->Next(&buffer);
+  ASSERT_TRUE(next_result.ok()) << next_result.status();
+  EXPECT_EQ(134, next_result.ValueOrDie());
+  EXPECT_EQ(static_cast<const char*>(first_buffer) + buffer_size - 134,
+            buffer);
+  EXPECT_EQ(buffer_size, input_stream->Position());
+
+  // BackUp more than returned by the last Next().
+  input_stream->BackUp(buffer_size);
+  EXPECT_EQ(buffer_size - 134, input_stream->Position());
+  next_result = input_stream->Next(&buffer);
+  ASSERT_TRUE(next_result.ok()) << next_result.status();
+  EXPECT_EQ(134, next_result.ValueOrDie());
+
+  next_result = input_stream->Next(&buffer);
+  ASSERT_TRUE(next_result.ok()) << next_result.status();
+  EXPECT_EQ(buffer_size, next_result.ValueOrDie());
+  EXPECT_EQ(2 * buffer_size, input_stream->Position());
+  EXPECT_EQ(contents.substr(buffer_size, buffer_size),
+            std::string(static_cast<const char*>(buffer), buffer_size));
+}
+
 }  // namespace
 }  // namespace tink
 }  // namespace crypto
@@ -38,16 +38,18 @@ uint32_t NewKeyId() {
 }  // namespace
 
 uint32_t GenerateUnusedKeyId(const Keyset& keyset) {
-  while (true) {
-    uint32_t key_id = NewKeyId();
-    bool already_exists = false;
+  return GenerateUnusedKeyId([&keyset](uint32_t key_id) {
     for (auto& key : keyset.key()) {
-      if (key.key_id() == key_id) {
-        already_exists = true;
-        break;
-      }
+      if (key.key_id() == key_id) return true;
     }
-    if (!already_exists) return key_id;
+    return false;
+  });
+}
+
+uint32_t GenerateUnusedKeyId(const std::function<bool(uint32_t)>& is_used) {
+  while (true) {
+    uint32_t key_id = NewKeyId();
+    if (!is_used(key_id)) return key_id;
   }
 }
 
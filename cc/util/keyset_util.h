@@ -18,6 +18,7 @@
 #define TINK_UTIL_KEYSET_UTIL_H_
 
 #include <cstdint>
+#include <functional>
 
 #include "proto/tink.pb.h"
 
@@ -27,6 +28,9 @@ namespace tink {
 // Generate a new random key ID not previously used in |keyset|.
 uint32_t GenerateUnusedKeyId(const google::crypto::tink::Keyset& keyset);
 
+// Generate a new random key ID for which |is_used| returns false.
+uint32_t GenerateUnusedKeyId(const std::function<bool(uint32_t)>& is_used);
+
 }  // namespace tink
 }  // namespace crypto
 
@@ -0,0 +1,147 @@
+// Copyright 2020 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/util/mmap_random_access_stream.h"
+
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include "absl/memory/memory.h"
+#include "tink/random_access_stream.h"
+#include "tink/util/buffer.h"
+#include "tink/util/errors.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+
+namespace {
+
+// Attempts to close file descriptor fd, while ignoring EINTR.
+// (code borrowed from ZeroCopy-streams)
+int close_ignoring_eintr(int fd) {
+  int result;
+  do {
+    result = close(fd);
+  } while (result < 0 && errno == EINTR);
+  return result;
+}
+
+int ToMadvise(MmapRandomAccessStream::AccessPattern access_pattern) {
+  switch (access_pattern) {
+    case MmapRandomAccessStream::AccessPattern::kSequential:
+      return MADV_SEQUENTIAL;
+    case MmapRandomAccessStream::AccessPattern::kRandom:
+      return MADV_RANDOM;
+    default:
+      return MADV_NORMAL;
+  }
+}
+
+}  // anonymous namespace
+
+// static
+StatusOr<std::unique_ptr<MmapRandomAccessStream>> MmapRandomAccessStream::New(
+    int file_descriptor, AccessPattern access_pattern) {
+  struct stat s;
+  if (fstat(file_descriptor, &s) == -1) {
+    int error = errno;
+    close_ignoring_eintr(file_descriptor);
+    return ToStatusF(util::error::UNAVAILABLE, "fstat failed: %d", error);
+  }
+  if (!S_ISREG(s.st_mode)) {
+    close_ignoring_eintr(file_descriptor);
+    return Status(util::error::INVALID_ARGUMENT, "not a regular file");
+  }
+  char* data = nullptr;
+  if (s.st_size > 0) {
+    void* mapping = mmap(nullptr, s.st_size, PROT_READ, MAP_SHARED,
+                         file_descriptor, 0);
+    if (mapping == MAP_FAILED) {
+      int error = errno;
+      close_ignoring_eintr(file_descriptor);
+      return ToStatusF(util::error::UNKNOWN, "mmap failed: %d", error);
+    }
+    // The hint only affects performance, so errors are ignored.
+    madvise(mapping, s.st_size, ToMadvise(access_pattern));
+    data = static_cast<char*>(mapping);
+  }
+  // The mapping stays valid after the file is closed.
+  close_ignoring_eintr(file_descriptor);
+  return {absl::WrapUnique(new MmapRandomAccessStream(data, s.st_size))};
+}
+
+MmapRandomAccessStream::~MmapRandomAccessStream() {
+  if (data_ != nullptr) munmap(data_, size_);
+}
+
+StatusOr<int> MmapRandomAccessStream::GetReadCount(int64_t position,
+                                                   int count) const {
+  if (count <= 0) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "count must be positive");
+  }
+  if (position < 0) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "position cannot be negative");
+  }
+  if (position >= size_) return 0;
+  return static_cast<int>(std::min<int64_t>(count, size_ - position));
+}
+
+Status MmapRandomAccessStream::PRead(int64_t position, int count,
+                                     Buffer* dest_buffer) {
+  if (dest_buffer == nullptr) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "dest_buffer must be non-null");
+  }
+  if (count > dest_buffer->allocated_size()) {
+    return util::Status(util::error::INVALID_ARGUMENT, "buffer too small");
+  }
+  auto read_count_result = GetReadCount(position, count);
+  if (!read_count_result.ok()) return read_count_result.status();
+  int read_count = read_count_result.ValueOrDie();
+  if (read_count == 0) {
+    dest_buffer->set_size(0).IgnoreError();
+    return Status(util::error::OUT_OF_RANGE, "EOF");
+  }
+  auto status = dest_buffer->set_size(read_count);
+  if (!status.ok()) return status;
+  std::memcpy(dest_buffer->get_mem_block(), data_ + position, read_count);
+  return Status::OK;
+}
+
+StatusOr<std::unique_ptr<Buffer>> MmapRandomAccessStream::PReadNoCopy(
+    int64_t position, int count) {
+  auto read_count_result = GetReadCount(position, count);
+  if (!read_count_result.ok()) return read_count_result.status();
+  int read_count = read_count_result.ValueOrDie();
+  if (read_count == 0) return Status(util::error::OUT_OF_RANGE, "EOF");
+  return Buffer::NewNonOwning(data_ + position, read_count);
+}
+
+StatusOr<int64_t> MmapRandomAccessStream::size() { return size_; }
+
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
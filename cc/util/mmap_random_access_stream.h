@@ -0,0 +1,78 @@
+// Copyright 2020 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_UTIL_MMAP_RANDOM_ACCESS_STREAM_H_
+#define TINK_UTIL_MMAP_RANDOM_ACCESS_STREAM_H_
+
+#include <cstdint>
+#include <memory>
+
+#include "tink/random_access_stream.h"
+#include "tink/util/buffer.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+
+// A RandomAccessStream that maps a regular file into memory once and serves
+// reads from the mapping, without a syscall per PRead(). The file must not
+// be truncated while the stream exists, and the stream sees the size the
+// file had when it was created.
+class MmapRandomAccessStream : public crypto::tink::RandomAccessStream {
+ public:
+  // Hints about the expected access pattern, passed to madvise().
+  enum class AccessPattern { kNormal, kSequential, kRandom };
+
+  // Maps the file specified via 'file_descriptor' for reading.
+  // Takes the ownership of the file, and closes it before returning.
+  static crypto::tink::util::StatusOr<std::unique_ptr<MmapRandomAccessStream>>
+  New(int file_descriptor,
+      AccessPattern access_pattern = AccessPattern::kNormal);
+
+  ~MmapRandomAccessStream() override;
+
+  crypto::tink::util::Status PRead(int64_t position,
+                                   int count,
+                                   Buffer* dest_buffer) override;
+
+  // Like PRead(), but instead of copying returns a non-owning Buffer which
+  // points into the mapping. The returned Buffer must not be written to and
+  // must not be used after this stream is destroyed.
+  crypto::tink::util::StatusOr<std::unique_ptr<Buffer>> PReadNoCopy(
+      int64_t position, int count);
+
+  crypto::tink::util::StatusOr<int64_t> size() override;
+
+ private:
+  MmapRandomAccessStream(char* data, int64_t size)
+      : data_(data), size_(size) {}
+
+  // Checks the arguments of PRead() and returns the number of bytes
+  // available at 'position', which is 0 at the end of the stream.
+  crypto::tink::util::StatusOr<int> GetReadCount(int64_t position,
+                                                 int count) const;
+
+  char* const data_;  // nullptr iff size_ is 0.
+  const int64_t size_;
+};
+
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_UTIL_MMAP_RANDOM_ACCESS_STREAM_H_
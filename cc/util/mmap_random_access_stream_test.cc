@@ -0,0 +1,191 @@
+// Copyright 2020 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/util/mmap_random_access_stream.h"
+
+#include <unistd.h>
+
+#include <cstring>
+#include <string>
+#include <thread>  // NOLINT(build/c++11)
+
+#include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "tink/util/buffer.h"
+#include "tink/util/test_util.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+namespace {
+
+std::unique_ptr<MmapRandomAccessStream> GetTestStream(
+    int stream_size, std::string* file_contents,
+    MmapRandomAccessStream::AccessPattern access_pattern =
+        MmapRandomAccessStream::AccessPattern::kNormal) {
+  std::string filename = absl::StrCat(stream_size, "_mmap_reading_test.bin");
+  int input_fd =
+      test::GetTestFileDescriptor(filename, stream_size, file_contents);
+  auto ra_stream_result = MmapRandomAccessStream::New(input_fd, access_pattern);
+  EXPECT_TRUE(ra_stream_result.ok()) << ra_stream_result.status();
+  return std::move(ra_stream_result.ValueOrDie());
+}
+
+// Reads from 'ra_stream' a chunk of 'count' bytes starting offset 'position',
+// and compares the read bytes to the corresponding bytes in 'file_contents'.
+void ReadAndVerifyChunk(RandomAccessStream* ra_stream,
+                        int64_t position,
+                        int count,
+                        absl::string_view file_contents) {
+  SCOPED_TRACE(absl::StrCat("stream_size = ", file_contents.size(),
+                            ", position = ", position,
+                            ", count = ", count));
+  auto buffer = std::move(Buffer::New(count).ValueOrDie());
+  int stream_size = ra_stream->size().ValueOrDie();
+  EXPECT_EQ(file_contents.size(), stream_size);
+  auto status = ra_stream->PRead(position, count, buffer.get());
+  EXPECT_TRUE(status.ok());
+  int read_count = buffer->size();
+  int expected_count = count;
+  if (position + count > stream_size) {
+    expected_count = stream_size - position;
+  }
+  EXPECT_EQ(expected_count, read_count);
+  EXPECT_EQ(0, memcmp(&file_contents[position],
+                      buffer->get_mem_block(), read_count));
+}
+
+TEST(MmapRandomAccessStreamTest, ReadingStreams) {
+  for (auto access_pattern :
+       {MmapRandomAccessStream::AccessPattern::kNormal,
+        MmapRandomAccessStream::AccessPattern::kSequential,
+        MmapRandomAccessStream::AccessPattern::kRandom}) {
+    for (auto stream_size : {1, 10, 100, 1000, 10000, 1000000}) {
+      SCOPED_TRACE(absl::StrCat("stream_size = ", stream_size));
+      std::string file_contents;
+      auto ra_stream =
+          GetTestStream(stream_size, &file_contents, access_pattern);
+      EXPECT_EQ(stream_size, ra_stream->size().ValueOrDie());
+      int chunk_size = 1 + (stream_size / 10);
+      auto buffer = std::move(Buffer::New(chunk_size).ValueOrDie());
+      std::string stream_contents;
+      auto status = ra_stream->PRead(0, chunk_size, buffer.get());
+      while (status.ok()) {
+        stream_contents.append(buffer->get_mem_block(), buffer->size());
+        status = ra_stream->PRead(stream_contents.size(), chunk_size,
+                                  buffer.get());
+      }
+      EXPECT_EQ(util::error::OUT_OF_RANGE, status.error_code());
+      EXPECT_EQ("EOF", status.error_message());
+      EXPECT_EQ(0, buffer->size());
+      EXPECT_EQ(file_contents, stream_contents);
+    }
+  }
+}
+
+TEST(MmapRandomAccessStreamTest, ReadingWithoutCopy) {
+  for (auto stream_size : {1, 10, 100, 1000, 10000}) {
+    SCOPED_TRACE(absl::StrCat("stream_size = ", stream_size));
+    std::string file_contents;
+    auto ra_stream = GetTestStream(stream_size, &file_contents);
+    for (int64_t position : {0, stream_size / 2, stream_size - 1}) {
+      auto buffer_result = ra_stream->PReadNoCopy(position, stream_size);
+      ASSERT_TRUE(buffer_result.ok()) << buffer_result.status();
+      auto buffer = std::move(buffer_result.ValueOrDie());
+      EXPECT_EQ(stream_size - position, buffer->size());
+      EXPECT_EQ(file_contents.substr(position),
+                std::string(buffer->get_mem_block(), buffer->size()));
+    }
+    auto eof_result = ra_stream->PReadNoCopy(stream_size, 1);
+    EXPECT_EQ(util::error::OUT_OF_RANGE, eof_result.status().error_code());
+    EXPECT_EQ(util::error::INVALID_ARGUMENT,
+              ra_stream->PReadNoCopy(-1, 1).status().error_code());
+    EXPECT_EQ(util::error::INVALID_ARGUMENT,
+              ra_stream->PReadNoCopy(0, 0).status().error_code());
+  }
+}
+
+TEST(MmapRandomAccessStreamTest, ConcurrentReads) {
+  for (auto stream_size : {100, 1000, 10000, 100000}) {
+    std::string file_contents;
+    auto ra_stream = GetTestStream(stream_size, &file_contents);
+    std::thread read_0(ReadAndVerifyChunk,
+        ra_stream.get(), 0, stream_size / 2, file_contents);
+    std::thread read_1(ReadAndVerifyChunk,
+        ra_stream.get(), stream_size / 4, stream_size / 2, file_contents);
+    std::thread read_2(ReadAndVerifyChunk,
+        ra_stream.get(), stream_size / 2, stream_size / 2, file_contents);
+    std::thread read_3(ReadAndVerifyChunk,
+        ra_stream.get(), 3 * stream_size / 4, stream_size / 2, file_contents);
+    read_0.join();
+    read_1.join();
+    read_2.join();
+    read_3.join();
+  }
+}
+
+TEST(MmapRandomAccessStreamTest, InvalidArguments) {
+  for (auto stream_size : {0, 10, 100, 1000, 10000}) {
+    SCOPED_TRACE(absl::StrCat("stream_size = ", stream_size));
+    std::string file_contents;
+    auto ra_stream = GetTestStream(stream_size, &file_contents);
+    auto buffer = std::move(Buffer::New(42).ValueOrDie());
+    for (auto position : {-100, -10, -1}) {
+      EXPECT_EQ(util::error::INVALID_ARGUMENT,
+                ra_stream->PRead(position, 42, buffer.get()).error_code());
+    }
+    for (auto count : {-100, -10, -1, 0}) {
+      EXPECT_EQ(util::error::INVALID_ARGUMENT,
+                ra_stream->PRead(0, count, buffer.get()).error_code());
+    }
+    EXPECT_EQ(util::error::INVALID_ARGUMENT,
+              ra_stream->PRead(0, 43, buffer.get()).error_code());
+    EXPECT_EQ(util::error::INVALID_ARGUMENT,
+              ra_stream->PRead(0, 42, nullptr).error_code());
+  }
+}
+
+TEST(MmapRandomAccessStreamTest, ReadPositionAfterEof) {
+  for (auto stream_size : {0, 10, 100, 1000, 10000}) {
+    std::string file_contents;
+    auto ra_stream = GetTestStream(stream_size, &file_contents);
+    int count = 42;
+    auto buffer = std::move(Buffer::New(count).ValueOrDie());
+    for (auto position : {stream_size, stream_size + 1, stream_size + 10}) {
+      SCOPED_TRACE(absl::StrCat("stream_size = ", stream_size,
+                                " position = ", position));
+      auto status = ra_stream->PRead(position, count, buffer.get());
+      EXPECT_EQ(util::error::OUT_OF_RANGE, status.error_code());
+      EXPECT_EQ(0, buffer->size());
+    }
+  }
+}
+
+TEST(MmapRandomAccessStreamTest, RejectsInvalidFiles) {
+  EXPECT_EQ(util::error::UNAVAILABLE,
+            MmapRandomAccessStream::New(-1).status().error_code());
+  int pipe_fds[2];
+  ASSERT_EQ(0, pipe(pipe_fds));
+  EXPECT_EQ(util::error::INVALID_ARGUMENT,
+            MmapRandomAccessStream::New(pipe_fds[0]).status().error_code());
+  close(pipe_fds[1]);
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
@@ -21,6 +21,7 @@
 #include <cstring>
 #include <memory>
 #include <ostream>
+#include <streambuf>
 
 #include "absl/memory/memory.h"
 #include "tink/output_stream.h"
@@ -108,17 +109,21 @@ OstreamOutputStream::~OstreamOutputStream() {
 
 Status OstreamOutputStream::Close() {
   if (!status_.ok()) return status_;
+  // Like in Next(), write directly to the streambuf, without the sentry of
+  // std::ostream::write().
+  std::streambuf* streambuf = output_->rdbuf();
   if (count_in_buffer_ > 0) {
     // Try to write the remaining bytes.
-    output_->write(reinterpret_cast<char*>(buffer_.get()), count_in_buffer_);
-    if (!output_->good()) {  // An I/O error occurred.
+    if (streambuf->sputn(reinterpret_cast<char*>(buffer_.get()),
+                         count_in_buffer_) != count_in_buffer_) {
+      output_->setstate(std::ios::badbit);
       status_ = ToStatusF(
           util::error::INTERNAL, "I/O error upon write: %d", errno);
       return status_;
     }
   }
-  output_->flush();
-  if (!output_->good()) {
+  if (streambuf->pubsync() != 0) {
+    output_->setstate(std::ios::badbit);
     status_ = ToStatusF(
         util::error::INTERNAL, "I/O error upon flushing: %d", errno);
     return status_;
@@ -0,0 +1,113 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/util/output_buffer.h"
+
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "tink/subtle/subtle_util.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+
+namespace {
+
+// Releaser for absl::MakeCordFromExternal() which owns the cord's bytes.
+class StringReleaser {
+ public:
+  explicit StringReleaser(std::unique_ptr<std::string> data)
+      : data_(std::move(data)) {}
+  void operator()(absl::string_view) const {}
+
+ private:
+  std::unique_ptr<std::string> data_;
+};
+
+StatusOr<OutputBuffer> Adopt(StatusOr<std::string> result) {
+  if (!result.ok()) return result.status();
+  return OutputBuffer(std::move(result.ValueOrDie()));
+}
+
+}  // namespace
+
+OutputBuffer::OutputBuffer() : data_(absl::make_unique<std::string>()) {}
+
+OutputBuffer::OutputBuffer(std::string data)
+    : data_(absl::make_unique<std::string>(std::move(data))) {}
+
+absl::Span<char> OutputBuffer::Allocate(size_t size) {
+  subtle::ResizeStringUninitialized(data_.get(), size);
+  return absl::MakeSpan(&(*data_)[0], size);
+}
+
+void OutputBuffer::Truncate(size_t size) { data_->resize(size); }
+
+absl::Cord OutputBuffer::ToCord() && {
+  absl::string_view bytes = *data_;
+  absl::Cord cord = absl::MakeCordFromExternal(
+      bytes, StringReleaser(std::move(data_)));
+  data_ = absl::make_unique<std::string>();
+  return cord;
+}
+
+std::string OutputBuffer::ToString() && {
+  std::string result = std::move(*data_);
+  data_->clear();
+  return result;
+}
+
+StatusOr<OutputBuffer> EncryptToBuffer(const Aead& aead,
+                                       absl::string_view plaintext,
+                                       absl::string_view associated_data) {
+  auto size_result = aead.CiphertextSize(plaintext.size());
+  if (!size_result.ok()) {
+    return Adopt(aead.Encrypt(plaintext, associated_data));
+  }
+  OutputBuffer buffer;
+  auto written_result = aead.EncryptInto(
+      plaintext, associated_data, buffer.Allocate(size_result.ValueOrDie()));
+  if (!written_result.ok()) return written_result.status();
+  buffer.Truncate(written_result.ValueOrDie());
+  return std::move(buffer);
+}
+
+StatusOr<OutputBuffer> EncryptDeterministicallyToBuffer(
+    const DeterministicAead& daead, absl::string_view plaintext,
+    absl::string_view associated_data) {
+  return Adopt(daead.EncryptDeterministically(plaintext, associated_data));
+}
+
+StatusOr<OutputBuffer> ComputeMacToBuffer(const Mac& mac,
+                                          absl::string_view data) {
+  return Adopt(mac.ComputeMac(data));
+}
+
+StatusOr<OutputBuffer> EncryptToBuffer(const HybridEncrypt& hybrid_encrypt,
+                                       absl::string_view plaintext,
+                                       absl::string_view context_info) {
+  return Adopt(hybrid_encrypt.Encrypt(plaintext, context_info));
+}
+
+StatusOr<OutputBuffer> SignToBuffer(const PublicKeySign& signer,
+                                    absl::string_view data) {
+  return Adopt(signer.Sign(data));
+}
+
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
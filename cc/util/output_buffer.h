@@ -0,0 +1,108 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_UTIL_OUTPUT_BUFFER_H_
+#define TINK_UTIL_OUTPUT_BUFFER_H_
+
+#include <memory>
+#include <string>
+
+#include "absl/strings/cord.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "tink/aead.h"
+#include "tink/deterministic_aead.h"
+#include "tink/hybrid_encrypt.h"
+#include "tink/mac.h"
+#include "tink/public_key_sign.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+
+// An owned, heap-allocated block of output bytes produced by a primitive,
+// which can be handed over to an absl::Cord or a std::string without
+// copying. The bytes never move while the buffer is alive, so a view or
+// a span obtained from it stays valid until the buffer is released.
+//
+// Typical use:
+//   auto buffer_result = util::EncryptToBuffer(aead, plaintext, ad);
+//   if (!buffer_result.ok()) return buffer_result.status();
+//   absl::Cord ciphertext = std::move(buffer_result.ValueOrDie()).ToCord();
+class OutputBuffer {
+ public:
+  // Creates an empty buffer.
+  OutputBuffer();
+
+  // Creates a buffer which takes over the bytes of 'data' without copying.
+  explicit OutputBuffer(std::string data);
+
+  OutputBuffer(OutputBuffer&& other) = default;
+  OutputBuffer& operator=(OutputBuffer&& other) = default;
+
+  // Resizes the buffer to 'size' bytes and returns a span over them, into
+  // which a primitive can write its output. The contents of the returned
+  // span are unspecified.
+  absl::Span<char> Allocate(size_t size);
+
+  // Shrinks the buffer to its first 'size' bytes. 'size' must not exceed
+  // size().
+  void Truncate(size_t size);
+
+  size_t size() const { return data_->size(); }
+  absl::string_view view() const { return *data_; }
+
+  // Hands the bytes to an absl::Cord without copying them; the cord
+  // releases the memory when its last reference goes away. The buffer is
+  // left empty.
+  absl::Cord ToCord() &&;
+
+  // Returns the bytes as a std::string without copying them. The buffer is
+  // left empty.
+  std::string ToString() &&;
+
+ private:
+  // Held by pointer so that the bytes stay put when the buffer is moved,
+  // including short strings which std::string would store inline.
+  std::unique_ptr<std::string> data_;
+};
+
+// Encrypts 'plaintext' with 'aead' directly into a new OutputBuffer. When
+// 'aead' reports its CiphertextSize(), the ciphertext is written in place
+// via EncryptInto(); otherwise the result of Encrypt() is adopted.
+StatusOr<OutputBuffer> EncryptToBuffer(const Aead& aead,
+                                       absl::string_view plaintext,
+                                       absl::string_view associated_data);
+
+// Like EncryptToBuffer() above, for the remaining primitives. Their output
+// is produced as a std::string and adopted by the buffer without a copy.
+StatusOr<OutputBuffer> EncryptDeterministicallyToBuffer(
+    const DeterministicAead& daead, absl::string_view plaintext,
+    absl::string_view associated_data);
+StatusOr<OutputBuffer> ComputeMacToBuffer(const Mac& mac,
+                                          absl::string_view data);
+StatusOr<OutputBuffer> EncryptToBuffer(const HybridEncrypt& hybrid_encrypt,
+                                       absl::string_view plaintext,
+                                       absl::string_view context_info);
+StatusOr<OutputBuffer> SignToBuffer(const PublicKeySign& signer,
+                                    absl::string_view data);
+
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_UTIL_OUTPUT_BUFFER_H_
@@ -0,0 +1,187 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/util/output_buffer.h"
+
+#include <algorithm>
+#include <string>
+#include <utility>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "absl/strings/cord.h"
+#include "absl/strings/str_cat.h"
+#include "tink/util/status.h"
+#include "tink/util/test_matchers.h"
+#include "tink/util/test_util.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+namespace {
+
+using ::crypto::tink::test::DummyAead;
+using ::crypto::tink::test::DummyDeterministicAead;
+using ::crypto::tink::test::DummyHybridEncrypt;
+using ::crypto::tink::test::DummyMac;
+using ::crypto::tink::test::DummyPublicKeySign;
+using ::crypto::tink::test::IsOk;
+using ::crypto::tink::test::StatusIs;
+using ::testing::Eq;
+
+// An Aead which knows its ciphertext size, and writes a ciphertext shorter
+// than that size, as AEADs with a variable-length output may do.
+class SizedAead : public Aead {
+ public:
+  StatusOr<std::string> Encrypt(
+      absl::string_view plaintext,
+      absl::string_view associated_data) const override {
+    return absl::StrCat("c:", plaintext);
+  }
+
+  StatusOr<std::string> Decrypt(
+      absl::string_view ciphertext,
+      absl::string_view associated_data) const override {
+    return Status(error::UNIMPLEMENTED, "not needed");
+  }
+
+  StatusOr<int64_t> CiphertextSize(int64_t plaintext_size) const override {
+    return plaintext_size + 10;
+  }
+
+  StatusOr<int64_t> EncryptInto(absl::string_view plaintext,
+                                absl::string_view associated_data,
+                                absl::Span<char> buffer) const override {
+    ++calls_;
+    if (buffer.size() != plaintext.size() + 10) {
+      return Status(error::INVALID_ARGUMENT, "unexpected buffer size");
+    }
+    buffer[0] = 'c';
+    buffer[1] = ':';
+    std::copy(plaintext.begin(), plaintext.end(), buffer.begin() + 2);
+    return plaintext.size() + 2;
+  }
+
+  mutable int calls_ = 0;
+};
+
+TEST(OutputBufferTest, AllocateAndTruncate) {
+  OutputBuffer buffer;
+  EXPECT_THAT(buffer.size(), Eq(0));
+  absl::Span<char> span = buffer.Allocate(5);
+  ASSERT_THAT(span.size(), Eq(5));
+  std::copy_n("hello", 5, span.begin());
+  buffer.Truncate(4);
+  EXPECT_THAT(buffer.view(), Eq("hell"));
+}
+
+TEST(OutputBufferTest, BytesDoNotMoveWithTheBuffer) {
+  OutputBuffer buffer(std::string("short"));
+  const char* data = buffer.view().data();
+  OutputBuffer moved = std::move(buffer);
+  EXPECT_THAT(moved.view().data(), Eq(data));
+  EXPECT_THAT(moved.view(), Eq("short"));
+}
+
+TEST(OutputBufferTest, ToCordDoesNotCopy) {
+  for (const std::string& contents :
+       {std::string(""), std::string("small"), std::string(10000, 'x')}) {
+    OutputBuffer buffer(contents);
+    const char* data = buffer.view().data();
+    absl::Cord cord = std::move(buffer).ToCord();
+    EXPECT_THAT(std::string(cord), Eq(contents));
+    if (!contents.empty()) {
+      EXPECT_THAT(cord.Flatten().data(), Eq(data));
+    }
+    EXPECT_THAT(buffer.size(), Eq(0));
+  }
+}
+
+TEST(OutputBufferTest, CordOutlivesBuffer) {
+  absl::Cord cord;
+  {
+    OutputBuffer buffer(std::string(1000, 'y'));
+    cord = std::move(buffer).ToCord();
+  }
+  EXPECT_THAT(std::string(cord), Eq(std::string(1000, 'y')));
+}
+
+TEST(OutputBufferTest, ToString) {
+  OutputBuffer buffer(std::string(100, 'z'));
+  EXPECT_THAT(std::move(buffer).ToString(), Eq(std::string(100, 'z')));
+  EXPECT_THAT(buffer.size(), Eq(0));
+}
+
+TEST(OutputBufferTest, EncryptToBufferWritesInPlace) {
+  SizedAead aead;
+  auto buffer_result = EncryptToBuffer(aead, "plaintext", "ad");
+  ASSERT_THAT(buffer_result.status(), IsOk());
+  EXPECT_THAT(buffer_result.ValueOrDie().view(), Eq("c:plaintext"));
+  EXPECT_THAT(aead.calls_, Eq(1));
+}
+
+TEST(OutputBufferTest, EncryptToBufferFallsBackToEncrypt) {
+  DummyAead aead("dummy");
+  auto buffer_result = EncryptToBuffer(aead, "plaintext", "ad");
+  ASSERT_THAT(buffer_result.status(), IsOk());
+  EXPECT_THAT(buffer_result.ValueOrDie().view(),
+              Eq(aead.Encrypt("plaintext", "ad").ValueOrDie()));
+}
+
+TEST(OutputBufferTest, OtherPrimitives) {
+  DummyDeterministicAead daead("daead");
+  auto daead_result = EncryptDeterministicallyToBuffer(daead, "pt", "ad");
+  ASSERT_THAT(daead_result.status(), IsOk());
+  EXPECT_THAT(daead_result.ValueOrDie().view(),
+              Eq(daead.EncryptDeterministically("pt", "ad").ValueOrDie()));
+
+  DummyMac mac("mac");
+  auto mac_result = ComputeMacToBuffer(mac, "data");
+  ASSERT_THAT(mac_result.status(), IsOk());
+  EXPECT_THAT(mac_result.ValueOrDie().view(),
+              Eq(mac.ComputeMac("data").ValueOrDie()));
+
+  DummyHybridEncrypt hybrid("hybrid");
+  auto hybrid_result = EncryptToBuffer(hybrid, "pt", "context");
+  ASSERT_THAT(hybrid_result.status(), IsOk());
+  EXPECT_THAT(hybrid_result.ValueOrDie().view(),
+              Eq(hybrid.Encrypt("pt", "context").ValueOrDie()));
+
+  DummyPublicKeySign signer("signer");
+  auto sign_result = SignToBuffer(signer, "data");
+  ASSERT_THAT(sign_result.status(), IsOk());
+  EXPECT_THAT(sign_result.ValueOrDie().view(),
+              Eq(signer.Sign("data").ValueOrDie()));
+}
+
+// Reports a ciphertext size which EncryptInto() of SizedAead rejects.
+class WrongSizeAead : public SizedAead {
+ public:
+  StatusOr<int64_t> CiphertextSize(int64_t plaintext_size) const override {
+    return plaintext_size;
+  }
+};
+
+TEST(OutputBufferTest, EncryptToBufferPropagatesErrors) {
+  WrongSizeAead aead;
+  EXPECT_THAT(EncryptToBuffer(aead, "plaintext", "ad").status(),
+              StatusIs(error::INVALID_ARGUMENT));
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,201 @@
+// Copyright 2020 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/util/read_ahead_file_input_stream.h"
+
+#include <errno.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <utility>
+
+#include "absl/memory/memory.h"
+#include "absl/synchronization/mutex.h"
+#include "tink/input_stream.h"
+#include "tink/util/errors.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+
+namespace {
+
+// Attempts to close file descriptor fd, while ignoring EINTR.
+// (code borrowed from ZeroCopy-streams)
+int close_ignoring_eintr(int fd) {
+  int result;
+  do {
+    result = close(fd);
+  } while (result < 0 && errno == EINTR);
+  return result;
+}
+
+// Reads up to 'count' bytes at 'offset' of fd into 'buf', stopping early
+// only at the end of the file. Returns the number of bytes read, or -1 with
+// errno set.
+int pread_fully(int fd, uint8_t* buf, int count, int64_t offset) {
+  int total = 0;
+  while (total < count) {
+    ssize_t result = pread(fd, buf + total, count - total, offset + total);
+    if (result < 0 && errno == EINTR) continue;
+    if (result < 0) return -1;
+    if (result == 0) break;
+    total += result;
+  }
+  return total;
+}
+
+}  // anonymous namespace
+
+// static
+StatusOr<std::unique_ptr<ReadAheadFileInputStream>>
+ReadAheadFileInputStream::New(int file_descriptor, Options options) {
+  if (options.buffer_size <= 0 || options.read_ahead_count <= 0 ||
+      !options.schedule) {
+    close_ignoring_eintr(file_descriptor);
+    return Status(util::error::INVALID_ARGUMENT,
+                  "buffer_size and read_ahead_count must be positive, and "
+                  "schedule must be set");
+  }
+  off_t offset = lseek(file_descriptor, 0, SEEK_CUR);
+  if (offset < 0) {
+    close_ignoring_eintr(file_descriptor);
+    return Status(util::error::INVALID_ARGUMENT,
+                  "the file descriptor must be seekable");
+  }
+  return {absl::WrapUnique(new ReadAheadFileInputStream(
+      file_descriptor, offset, std::move(options)))};
+}
+
+ReadAheadFileInputStream::ReadAheadFileInputStream(int file_descriptor,
+                                                   int64_t offset,
+                                                   Options options)
+    : fd_(file_descriptor),
+      options_(std::move(options)),
+      next_read_offset_(offset),
+      running_reads_(std::make_shared<RunningReads>()),
+      status_(Status::OK),
+      position_(0),
+      count_in_buffer_(0),
+      count_backedup_(0),
+      buffer_offset_(0) {
+  for (int i = 0; i < options_.read_ahead_count; i++) {
+    ScheduleRead(std::make_shared<Chunk>(options_.buffer_size));
+  }
+}
+
+ReadAheadFileInputStream::~ReadAheadFileInputStream() {
+  {
+    absl::MutexLock lock(&running_reads_->mutex);
+    running_reads_->mutex.Await(absl::Condition(
+        +[](int* count) { return *count == 0; }, &running_reads_->count));
+  }
+  close_ignoring_eintr(fd_);
+}
+
+void ReadAheadFileInputStream::ScheduleRead(std::shared_ptr<Chunk> chunk) {
+  int64_t offset = next_read_offset_;
+  next_read_offset_ += options_.buffer_size;
+  {
+    absl::MutexLock lock(&chunk->mutex);
+    chunk->done = false;
+  }
+  pending_chunks_.push_back(chunk);
+  std::shared_ptr<RunningReads> running_reads = running_reads_;
+  {
+    absl::MutexLock lock(&running_reads->mutex);
+    running_reads->count++;
+  }
+  int fd = fd_;
+  int count = options_.buffer_size;
+  options_.schedule([fd, count, offset, chunk, running_reads]() {
+    int read_result = pread_fully(fd, chunk->data.get(), count, offset);
+    {
+      absl::MutexLock lock(&chunk->mutex);
+      if (read_result < 0) {
+        chunk->size = 0;
+        chunk->status =
+            ToStatusF(util::error::INTERNAL, "I/O error: %d", errno);
+      } else {
+        chunk->size = read_result;
+        chunk->status = Status::OK;
+      }
+      chunk->done = true;
+    }
+    absl::MutexLock lock(&running_reads->mutex);
+    running_reads->count--;
+  });
+}
+
+crypto::tink::util::StatusOr<int> ReadAheadFileInputStream::Next(
+    const void** data) {
+  if (!status_.ok()) return status_;
+  if (count_backedup_ > 0) {  // Return the backed-up bytes.
+    buffer_offset_ = buffer_offset_ + (count_in_buffer_ - count_backedup_);
+    count_in_buffer_ = count_backedup_;
+    count_backedup_ = 0;
+    *data = current_chunk_->data.get() + buffer_offset_;
+    position_ = position_ + count_in_buffer_;
+    return count_in_buffer_;
+  }
+  if (pending_chunks_.empty()) {  // The previous chunk ended the file.
+    status_ = Status(util::error::OUT_OF_RANGE, "EOF");
+    return status_;
+  }
+  std::shared_ptr<Chunk> chunk = std::move(pending_chunks_.front());
+  pending_chunks_.pop_front();
+  {
+    absl::MutexLock lock(&chunk->mutex);
+    chunk->mutex.Await(absl::Condition(&chunk->done));
+  }
+  if (!chunk->status.ok()) {
+    status_ = chunk->status;
+    return status_;
+  }
+  if (chunk->size == 0) {
+    status_ = Status(util::error::OUT_OF_RANGE, "EOF");
+    return status_;
+  }
+  // The bytes of the previous chunk are no longer accessible to the caller,
+  // so its buffer can be reused for the next read, unless it was the end.
+  if (chunk->size == options_.buffer_size) {
+    ScheduleRead(current_chunk_ != nullptr
+                     ? std::move(current_chunk_)
+                     : std::make_shared<Chunk>(options_.buffer_size));
+  }
+  current_chunk_ = std::move(chunk);
+  buffer_offset_ = 0;
+  count_backedup_ = 0;
+  count_in_buffer_ = current_chunk_->size;
+  position_ = position_ + count_in_buffer_;
+  *data = current_chunk_->data.get();
+  return count_in_buffer_;
+}
+
+void ReadAheadFileInputStream::BackUp(int count) {
+  if (!status_.ok() || count < 1 || count_backedup_ == count_in_buffer_) return;
+  int actual_count = std::min(count, count_in_buffer_ - count_backedup_);
+  count_backedup_ = count_backedup_ + actual_count;
+  position_ = position_ - actual_count;
+}
+
+int64_t ReadAheadFileInputStream::Position() const { return position_; }
+
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,112 @@
+// Copyright 2020 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_UTIL_READ_AHEAD_FILE_INPUT_STREAM_H_
+#define TINK_UTIL_READ_AHEAD_FILE_INPUT_STREAM_H_
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "tink/input_stream.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+
+// An InputStream that reads from a seekable file descriptor, like
+// FileInputStream, but keeps several reads of the following bytes in flight
+// while the caller processes the current buffer. This lets e.g. a decrypting
+// stream overlap its disk I/O with the decryption of segments.
+class ReadAheadFileInputStream : public crypto::tink::InputStream {
+ public:
+  struct Options {
+    // The size of each buffer returned by Next().
+    int buffer_size = 128 * 1024;
+    // The number of buffers read ahead of the one returned by Next().
+    int read_ahead_count = 2;
+    // Runs the reads, e.g. by passing them to a thread pool. Must be set.
+    std::function<void(std::function<void()>)> schedule;
+  };
+
+  // Creates an InputStream that reads from the file specified via
+  // 'file_descriptor', starting at its current offset.
+  // Takes the ownership of the file, and will close it upon destruction.
+  static crypto::tink::util::StatusOr<std::unique_ptr<ReadAheadFileInputStream>>
+  New(int file_descriptor, Options options);
+
+  // Waits for the reads in flight before closing the file.
+  ~ReadAheadFileInputStream() override;
+
+  crypto::tink::util::StatusOr<int> Next(const void** data) override;
+
+  void BackUp(int count) override;
+
+  int64_t Position() const override;
+
+ private:
+  // A buffer which is being filled, or has been filled, by a read.
+  struct Chunk {
+    explicit Chunk(int buffer_size) : data(new uint8_t[buffer_size]) {}
+
+    absl::Mutex mutex;
+    bool done ABSL_GUARDED_BY(mutex) = false;
+    // Set by the read before done becomes true.
+    std::unique_ptr<uint8_t[]> data;
+    int size = 0;  // 0 at the end of the file.
+    util::Status status;
+  };
+
+  // Reads in flight, shared with the scheduled tasks.
+  struct RunningReads {
+    absl::Mutex mutex;
+    int count ABSL_GUARDED_BY(mutex) = 0;
+  };
+
+  ReadAheadFileInputStream(int file_descriptor, int64_t offset,
+                           Options options);
+
+  // Schedules a read of the next buffer_size bytes into 'chunk', and appends
+  // 'chunk' to pending_chunks_.
+  void ScheduleRead(std::shared_ptr<Chunk> chunk);
+
+  const int fd_;
+  const Options options_;
+  int64_t next_read_offset_;  // the file offset of the next scheduled read
+  std::deque<std::shared_ptr<Chunk>> pending_chunks_;
+  std::shared_ptr<Chunk> current_chunk_;  // the chunk returned by Next()
+  std::shared_ptr<RunningReads> running_reads_;
+
+  util::Status status_;
+  int64_t position_;     // current position in the stream
+
+  // Counters that describe the state of the data in current_chunk_.
+  int count_in_buffer_;  // # of bytes available in the buffer
+  int count_backedup_;   // # of bytes available in the buffer that were
+                         // backed up
+  int buffer_offset_;    // offset at which the returned bytes start
+};
+
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_UTIL_READ_AHEAD_FILE_INPUT_STREAM_H_
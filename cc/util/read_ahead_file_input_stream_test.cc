@@ -0,0 +1,189 @@
+// Copyright 2020 Google Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/util/read_ahead_file_input_stream.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+
+#include "gtest/gtest.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/string_view.h"
+#include "tink/subtle/test_util.h"
+#include "tink/util/test_util.h"
+
+namespace crypto {
+namespace tink {
+namespace {
+
+using crypto::tink::subtle::test::TestThreadPool;
+using crypto::tink::util::ReadAheadFileInputStream;
+
+// Reads the specified 'input_stream' until no more bytes can be read,
+// and puts the read bytes into 'contents'.
+// Returns the status of the last input_stream->Next()-operation.
+util::Status ReadTillEnd(InputStream* input_stream, std::string* contents) {
+  contents->clear();
+  const void* buffer;
+  auto next_result = input_stream->Next(&buffer);
+  while (next_result.ok()) {
+    contents->append(static_cast<const char*>(buffer),
+                     next_result.ValueOrDie());
+    next_result = input_stream->Next(&buffer);
+  }
+  return next_result.status();
+}
+
+class ReadAheadFileInputStreamTest : public ::testing::Test {
+ protected:
+  ReadAheadFileInputStream::Options GetOptions(int buffer_size,
+                                               int read_ahead_count) {
+    ReadAheadFileInputStream::Options options;
+    options.buffer_size = buffer_size;
+    options.read_ahead_count = read_ahead_count;
+    options.schedule = [this](std::function<void()> task) {
+      pool_.Schedule(std::move(task));
+    };
+    return options;
+  }
+
+  TestThreadPool pool_{4};
+};
+
+TEST_F(ReadAheadFileInputStreamTest, testReadingStreams) {
+  for (auto stream_size : {0, 10, 100, 1000, 10000, 100000, 1000000}) {
+    for (auto buffer_size : {1, 100, 1000, 128 * 1024}) {
+      for (auto read_ahead_count : {1, 2, 5}) {
+        if (buffer_size == 1 && stream_size > 10000) continue;
+        SCOPED_TRACE(absl::StrCat("stream_size = ", stream_size,
+                                  ", buffer_size = ", buffer_size,
+                                  ", read_ahead_count = ", read_ahead_count));
+        std::string file_contents;
+        std::string filename =
+            absl::StrCat(stream_size, "_read_ahead_test.bin");
+        int input_fd =
+            test::GetTestFileDescriptor(filename, stream_size, &file_contents);
+        auto input_stream_result = ReadAheadFileInputStream::New(
+            input_fd, GetOptions(buffer_size, read_ahead_count));
+        ASSERT_TRUE(input_stream_result.ok()) << input_stream_result.status();
+        auto input_stream = std::move(input_stream_result.ValueOrDie());
+        std::string stream_contents;
+        auto status = ReadTillEnd(input_stream.get(), &stream_contents);
+        EXPECT_EQ(util::error::OUT_OF_RANGE, status.error_code());
+        EXPECT_EQ("EOF", status.error_message());
+        EXPECT_EQ(file_contents, stream_contents);
+        EXPECT_EQ(stream_size, input_stream->Position());
+      }
+    }
+  }
+}
+
+TEST_F(ReadAheadFileInputStreamTest, testStartsAtCurrentOffset) {
+  int stream_size = 10000;
+  std::string file_contents;
+  int input_fd = test::GetTestFileDescriptor("read_ahead_offset_test.bin",
+                                             stream_size, &file_contents);
+  ASSERT_EQ(1234, lseek(input_fd, 1234, SEEK_SET));
+  auto input_stream_result =
+      ReadAheadFileInputStream::New(input_fd, GetOptions(100, 3));
+  ASSERT_TRUE(input_stream_result.ok()) << input_stream_result.status();
+  std::string stream_contents;
+  auto status =
+      ReadTillEnd(input_stream_result.ValueOrDie().get(), &stream_contents);
+  EXPECT_EQ(util::error::OUT_OF_RANGE, status.error_code());
+  EXPECT_EQ(file_contents.substr(1234), stream_contents);
+}
+
+TEST_F(ReadAheadFileInputStreamTest, testBackupAndPosition) {
+  int stream_size = 100000;
+  int buffer_size = 1234;
+  const void* buffer;
+  std::string file_contents;
+  int input_fd = test::GetTestFileDescriptor("read_ahead_backup_test.bin",
+                                             stream_size, &file_contents);
+  auto input_stream_result =
+      ReadAheadFileInputStream::New(input_fd, GetOptions(buffer_size, 2));
+  ASSERT_TRUE(input_stream_result.ok()) << input_stream_result.status();
+  auto input_stream = std::move(input_stream_result.ValueOrDie());
+  EXPECT_EQ(0, input_stream->Position());
+  auto next_result = input_stream->Next(&buffer);
+  ASSERT_TRUE(next_result.ok()) << next_result.status();
+  EXPECT_EQ(buffer_size, next_result.ValueOrDie());
+  EXPECT_EQ(buffer_size, input_stream->Position());
+
+  // BackUp several times, but in total fewer bytes than returned by Next().
+  int total_backup_size = 0;
+  for (auto backup_size : {0, 1, 5, 0, 10, 100, -42, 400, 20, -100}) {
+    SCOPED_TRACE(absl::StrCat("backup_size = ", backup_size));
+    input_stream->BackUp(backup_size);
+    total_backup_size += std::max(0, backup_size);
+    EXPECT_EQ(buffer_size - total_backup_size, input_stream->Position());
+  }
+  // Call Next(), it should return exactly the backed up bytes.
+  next_result = input_stream->Next(&buffer);
+  ASSERT_TRUE(next_result.ok()) << next_result.status();
+  EXPECT_EQ(total_backup_size, next_result.ValueOrDie());
+  EXPECT_EQ(buffer_size, input_stream->Position());
+  EXPECT_EQ(
+      file_contents.substr(buffer_size - total_backup_size, total_backup_size),
+      std::string(static_cast<const char*>(buffer), total_backup_size));
+
+  // Back up more than returned, then read the rest of the stream.
+  input_stream->BackUp(2 * buffer_size);
+  EXPECT_EQ(buffer_size - total_backup_size, input_stream->Position());
+  std::string stream_contents;
+  auto status = ReadTillEnd(input_stream.get(), &stream_contents);
+  EXPECT_EQ(util::error::OUT_OF_RANGE, status.error_code());
+  EXPECT_EQ(file_contents.substr(buffer_size - total_backup_size),
+            stream_contents);
+}
+
+TEST_F(ReadAheadFileInputStreamTest, testDestroyWithReadsInFlight) {
+  std::string file_contents;
+  int input_fd = test::GetTestFileDescriptor("read_ahead_destroy_test.bin",
+                                             100000, &file_contents);
+  auto input_stream_result =
+      ReadAheadFileInputStream::New(input_fd, GetOptions(1000, 10));
+  ASSERT_TRUE(input_stream_result.ok()) << input_stream_result.status();
+  const void* buffer;
+  EXPECT_TRUE(input_stream_result.ValueOrDie()->Next(&buffer).ok());
+}
+
+TEST_F(ReadAheadFileInputStreamTest, testInvalidArguments) {
+  std::string file_contents;
+  for (auto options : {GetOptions(0, 2), GetOptions(100, 0),
+                       ReadAheadFileInputStream::Options()}) {
+    int input_fd = test::GetTestFileDescriptor("read_ahead_invalid_test.bin",
+                                               100, &file_contents);
+    EXPECT_EQ(util::error::INVALID_ARGUMENT,
+              ReadAheadFileInputStream::New(input_fd, options)
+                  .status()
+                  .error_code());
+  }
+  int pipe_fds[2];
+  ASSERT_EQ(0, pipe(pipe_fds));
+  EXPECT_EQ(util::error::INVALID_ARGUMENT,
+            ReadAheadFileInputStream::New(pipe_fds[0], GetOptions(100, 2))
+                .status()
+                .error_code());
+  close(pipe_fds[1]);
+}
+
+}  // namespace
+}  // namespace tink
+}  // namespace crypto
@@ -0,0 +1,175 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/util/secret_arena.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#if !defined(_WIN32)
+#include <sys/mman.h>
+#endif
+
+#include "absl/synchronization/mutex.h"
+#include "tink/util/status.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+
+namespace internal {
+
+constexpr size_t SecretArena::kMinObjectSize;
+constexpr size_t SecretArena::kMaxObjectSize;
+constexpr size_t SecretArena::kRegionSize;
+constexpr int SecretArena::kNumSizeClasses;
+
+std::atomic<SecretArena*> SecretArena::global_arena_{nullptr};
+
+// static
+int SecretArena::SizeClass(size_t size) {
+  int size_class = 0;
+  for (size_t class_size = kMinObjectSize; class_size < size;
+       class_size <<= 1) {
+    size_class++;
+  }
+  return size_class;
+}
+
+void* SecretArena::Allocate(size_t size, size_t alignment) {
+  size = std::max(size, alignment);
+  if (size > kMaxObjectSize) return nullptr;
+  int size_class = SizeClass(size);
+  size_t class_size = kMinObjectSize << size_class;
+
+  absl::MutexLock lock(&mutex_);
+  FreeChunk* chunk = free_lists_[size_class];
+  if (chunk != nullptr) {
+    free_lists_[size_class] = chunk->next;
+    chunk->next = nullptr;
+    return chunk;
+  }
+  // Chunks are aligned to their size, so that no chunk spans two cache lines
+  // unless it is larger than one.
+  uintptr_t start = (next_ + class_size - 1) & ~(class_size - 1);
+  if (start + class_size > end_) {
+    if (!AddRegion().ok()) return nullptr;
+    start = next_;
+  }
+  next_ = start + class_size;
+  return reinterpret_cast<void*>(start);
+}
+
+bool SecretArena::Deallocate(void* ptr, size_t size) {
+  absl::MutexLock lock(&mutex_);
+  if (!ContainsLocked(ptr)) return false;
+  int size_class = SizeClass(size);
+  FreeChunk* chunk = static_cast<FreeChunk*>(ptr);
+  chunk->next = free_lists_[size_class];
+  free_lists_[size_class] = chunk;
+  return true;
+}
+
+bool SecretArena::Contains(const void* ptr) const {
+  absl::ReaderMutexLock lock(&mutex_);
+  return ContainsLocked(ptr);
+}
+
+bool SecretArena::ContainsLocked(const void* ptr) const {
+  // Regions are aligned to their size.
+  uintptr_t region = reinterpret_cast<uintptr_t>(ptr) & ~(kRegionSize - 1);
+  return std::binary_search(regions_.begin(), regions_.end(), region);
+}
+
+util::Status SecretArena::AddRegion() {
+#if defined(_WIN32)
+  return util::Status(util::error::UNIMPLEMENTED,
+                      "The secret arena is not supported on Windows");
+#else
+  if ((regions_.size() + 1) * kRegionSize > options_.max_size) {
+    return util::Status(util::error::RESOURCE_EXHAUSTED,
+                        "The secret arena is full");
+  }
+  // Map twice the size, to cut out an aligned region.
+  void* mapping = mmap(nullptr, 2 * kRegionSize, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mapping == MAP_FAILED) {
+    return util::Status(util::error::RESOURCE_EXHAUSTED,
+                        "Could not map the secret arena");
+  }
+  uintptr_t start = reinterpret_cast<uintptr_t>(mapping);
+  uintptr_t region = (start + kRegionSize - 1) & ~(kRegionSize - 1);
+  if (region > start) {
+    munmap(mapping, region - start);
+  }
+  if (region + kRegionSize < start + 2 * kRegionSize) {
+    munmap(reinterpret_cast<void*>(region + kRegionSize),
+           start + 2 * kRegionSize - region - kRegionSize);
+  }
+  void* region_ptr = reinterpret_cast<void*>(region);
+
+#if defined(MADV_HUGEPAGE)
+  if (options_.use_huge_pages) madvise(region_ptr, kRegionSize, MADV_HUGEPAGE);
+#endif
+#if defined(MADV_DONTDUMP)
+  madvise(region_ptr, kRegionSize, MADV_DONTDUMP);
+#endif
+  if (mlock(region_ptr, kRegionSize) != 0 && options_.require_mlock) {
+    munmap(region_ptr, kRegionSize);
+    return util::Status(util::error::RESOURCE_EXHAUSTED,
+                        "Could not lock the secret arena into memory");
+  }
+
+  regions_.insert(std::upper_bound(regions_.begin(), regions_.end(), region),
+                  region);
+  next_ = region;
+  end_ = region + kRegionSize;
+  return util::OkStatus();
+#endif
+}
+
+}  // namespace internal
+
+util::Status EnableSecretArena(const SecretArenaOptions& options) {
+  static absl::Mutex* enable_mutex = new absl::Mutex();
+  absl::MutexLock lock(enable_mutex);
+  if (internal::SecretArena::Get() != nullptr) {
+    return util::Status(util::error::FAILED_PRECONDITION,
+                        "The secret arena is already enabled");
+  }
+  auto* arena = new internal::SecretArena(options);
+  util::Status status;
+  {
+    absl::MutexLock arena_lock(&arena->mutex_);
+    // The first region is mapped here, so that mlock() failures are
+    // reported to the caller.
+    status = arena->AddRegion();
+  }
+  if (!status.ok()) {
+    delete arena;
+    return status;
+  }
+  // The arena is never deleted, since memory allocated from it may be freed
+  // at any time.
+  internal::SecretArena::global_arena_.store(arena, std::memory_order_release);
+  return util::OkStatus();
+}
+
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
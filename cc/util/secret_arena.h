@@ -0,0 +1,132 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_UTIL_SECRET_ARENA_H_
+#define TINK_UTIL_SECRET_ARENA_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "tink/util/status.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+
+struct SecretArenaOptions {
+  // Backs the arena with transparent huge pages where available, which
+  // reduces TLB misses when many keys are in use.
+  bool use_huge_pages = false;
+  // Fails EnableSecretArena() if the arena cannot be locked into memory,
+  // e.g. because of RLIMIT_MEMLOCK. Otherwise the arena is used unlocked.
+  bool require_mlock = true;
+  // Allocations beyond this many bytes of arena go to the heap.
+  size_t max_size = 256 << 20;
+};
+
+// Makes SecretData and SecretUniquePtr take allocations of up to
+// internal::SecretArena::kMaxObjectSize bytes, which covers symmetric keys
+// and key schedules, from a dedicated arena. The arena is locked into memory
+// and excluded from core dumps, and keeps key material on few pages.
+//
+// Allocations made before the call stay on the heap. The arena cannot be
+// disabled again; calling this twice returns FAILED_PRECONDITION.
+util::Status EnableSecretArena(const SecretArenaOptions& options);
+
+namespace internal {
+
+// A segregated-fit allocator over mmap()ed regions, with one free list per
+// power-of-two size class. Thread-safe.
+class SecretArena {
+ public:
+  static constexpr size_t kMinObjectSize = 16;
+  static constexpr size_t kMaxObjectSize = 1024;
+
+  // Returns the enabled arena, or nullptr.
+  static SecretArena* Get() {
+    return global_arena_.load(std::memory_order_acquire);
+  }
+
+  // Returns 'size' bytes aligned to 'alignment', or nullptr if they do not
+  // fit into the arena.
+  void* Allocate(size_t size, size_t alignment);
+
+  // Returns false if 'ptr' was not allocated by the arena. The caller has
+  // already wiped the memory.
+  bool Deallocate(void* ptr, size_t size);
+
+  // Returns true if 'ptr' points into the arena.
+  bool Contains(const void* ptr) const;
+
+ private:
+  friend util::Status util::EnableSecretArena(
+      const SecretArenaOptions& options);
+
+  // The size and alignment of a region; a huge page on x86-64.
+  static constexpr size_t kRegionSize = 2 << 20;
+  static constexpr int kNumSizeClasses = 7;  // 16, 32, ..., 1024 bytes.
+
+  struct FreeChunk {
+    FreeChunk* next;
+  };
+
+  explicit SecretArena(const SecretArenaOptions& options)
+      : options_(options) {}
+
+  static int SizeClass(size_t size);
+
+  // Maps a new region and makes it the current one.
+  util::Status AddRegion() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex_);
+  bool ContainsLocked(const void* ptr) const
+      ABSL_SHARED_LOCKS_REQUIRED(mutex_);
+
+  static std::atomic<SecretArena*> global_arena_;
+
+  const SecretArenaOptions options_;
+  mutable absl::Mutex mutex_;
+  // Sorted region start addresses.
+  std::vector<uintptr_t> regions_ ABSL_GUARDED_BY(mutex_);
+  // The unused end of the current region, [next_, end_).
+  uintptr_t next_ ABSL_GUARDED_BY(mutex_) = 0;
+  uintptr_t end_ ABSL_GUARDED_BY(mutex_) = 0;
+  FreeChunk* free_lists_[kNumSizeClasses] ABSL_GUARDED_BY(mutex_) = {};
+};
+
+// Returns memory from the arena if it is enabled and can hold 'size' bytes,
+// and nullptr otherwise.
+inline void* SecretArenaAllocate(size_t size, size_t alignment) {
+  SecretArena* arena = SecretArena::Get();
+  if (arena == nullptr) return nullptr;
+  return arena->Allocate(size, alignment);
+}
+
+// Returns false if 'ptr' was not allocated by SecretArenaAllocate().
+inline bool SecretArenaDeallocate(void* ptr, size_t size) {
+  SecretArena* arena = SecretArena::Get();
+  if (arena == nullptr) return false;
+  return arena->Deallocate(ptr, size);
+}
+
+}  // namespace internal
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_UTIL_SECRET_ARENA_H_
@@ -0,0 +1,118 @@
+// Copyright 2019 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/util/secret_arena.h"
+
+#include <cstdint>
+#include <string>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/status.h"
+
+namespace crypto {
+namespace tink {
+namespace util {
+namespace {
+
+using ::crypto::tink::util::internal::SecretArena;
+using ::testing::Eq;
+using ::testing::IsFalse;
+using ::testing::IsTrue;
+using ::testing::NotNull;
+
+class SecretArenaTest : public ::testing::Test {
+ protected:
+  // The arena is process-wide, so it is enabled once for all tests.
+  static void SetUpTestSuite() {
+    SecretArenaOptions options;
+    // The sandbox of the test may have a small RLIMIT_MEMLOCK.
+    options.require_mlock = false;
+    ASSERT_TRUE(EnableSecretArena(options).ok());
+  }
+};
+
+TEST_F(SecretArenaTest, EnableTwiceFails) {
+  ASSERT_THAT(SecretArena::Get(), NotNull());
+  EXPECT_EQ(error::FAILED_PRECONDITION,
+            EnableSecretArena(SecretArenaOptions()).error_code());
+}
+
+TEST_F(SecretArenaTest, SmallSecretDataIsInArena) {
+  SecretData data = SecretDataFromStringView(std::string(32, 'a'));
+  EXPECT_THAT(SecretArena::Get()->Contains(data.data()), IsTrue());
+  EXPECT_THAT(SecretDataAsStringView(data), Eq(std::string(32, 'a')));
+}
+
+TEST_F(SecretArenaTest, LargeSecretDataIsOnHeap) {
+  SecretData data(SecretArena::kMaxObjectSize + 1, 'b');
+  EXPECT_THAT(SecretArena::Get()->Contains(data.data()), IsFalse());
+}
+
+TEST_F(SecretArenaTest, StatsCountArenaBytes) {
+  SecretDataStats before = GetSecretDataStats();
+  {
+    SecretData small(32, 'a');
+    SecretData large(SecretArena::kMaxObjectSize + 1, 'b');
+    SecretDataStats during = GetSecretDataStats();
+    EXPECT_THAT(during.arena_bytes - before.arena_bytes, Eq(32));
+    EXPECT_THAT(during.bytes - before.bytes,
+                Eq(32 + SecretArena::kMaxObjectSize + 1));
+  }
+  EXPECT_THAT(GetSecretDataStats().arena_bytes, Eq(before.arena_bytes));
+}
+
+TEST_F(SecretArenaTest, ReusesFreedChunks) {
+  const void* first;
+  {
+    SecretData data(24, 'c');
+    first = data.data();
+  }
+  SecretData data(20, 'd');
+  EXPECT_THAT(static_cast<const void*>(data.data()), Eq(first));
+}
+
+TEST_F(SecretArenaTest, Alignment) {
+  for (size_t size = 1; size <= SecretArena::kMaxObjectSize; size *= 2) {
+    void* ptr = SecretArena::Get()->Allocate(size, 16);
+    ASSERT_THAT(ptr, NotNull());
+    EXPECT_THAT(reinterpret_cast<uintptr_t>(ptr) % 16, Eq(0));
+    EXPECT_THAT(SecretArena::Get()->Deallocate(ptr, size), IsTrue());
+  }
+}
+
+TEST_F(SecretArenaTest, DeallocateForeignPointer) {
+  int on_stack = 0;
+  EXPECT_THAT(SecretArena::Get()->Deallocate(&on_stack, sizeof(on_stack)),
+              IsFalse());
+}
+
+struct KeySchedule {
+  uint32_t round_keys[61];
+  int rounds;
+};
+
+TEST_F(SecretArenaTest, SecretUniquePtrIsInArena) {
+  SecretUniquePtr<KeySchedule> schedule = MakeSecretUniquePtr<KeySchedule>();
+  schedule->rounds = 14;
+  EXPECT_THAT(SecretArena::Get()->Contains(schedule.get()), IsTrue());
+}
+
+}  // namespace
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
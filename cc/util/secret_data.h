@@ -15,6 +15,7 @@
 #ifndef TINK_UTIL_SECRET_DATA_H_
 #define TINK_UTIL_SECRET_DATA_H_
 
+#include <cstdint>
 #include <memory>
 #include <type_traits>
 #include <vector>
@@ -133,6 +134,27 @@ inline void SafeZeroMemory(char* ptr, std::size_t size) {
   internal::SafeZeroMemory(ptr, size);
 }
 
+// The memory which SecretData, SecretUniquePtr and SecretValue objects hold
+// in the process, as requested from their allocator.
+struct SecretDataStats {
+  int64_t bytes = 0;
+  int64_t allocations = 0;
+  // The part of 'bytes' which comes from the secret arena, see
+  // EnableSecretArena().
+  int64_t arena_bytes = 0;
+};
+
+// Returns the current SecretDataStats. The counters are updated without
+// synchronization, so they may be slightly inconsistent with each other
+// while other threads allocate secret data.
+inline SecretDataStats GetSecretDataStats() {
+  SecretDataStats stats;
+  stats.bytes = internal::secret_data_counters.bytes.load();
+  stats.allocations = internal::secret_data_counters.allocations.load();
+  stats.arena_bytes = internal::secret_data_counters.arena_bytes.load();
+  return stats;
+}
+
 inline void SafeZeroString(std::string* str) {
   SafeZeroMemory(&(*str)[0], str->size());
 }
@@ -0,0 +1,61 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include "tink/util/secret_data_internal.h"
+
+#include <atomic>
+#include <cstdint>
+
+namespace crypto {
+namespace tink {
+namespace util {
+namespace internal {
+
+// Zero-initialized before any dynamic initialization.
+SecretDataCounters secret_data_counters;
+
+namespace {
+
+thread_local int64_t thread_secret_data_bytes = 0;
+
+}  // namespace
+
+int64_t ThreadSecretDataBytes() { return thread_secret_data_bytes; }
+
+void RecordSecretDataAllocation(size_t size, bool in_arena) {
+  thread_secret_data_bytes += size;
+  secret_data_counters.bytes.fetch_add(size, std::memory_order_relaxed);
+  secret_data_counters.allocations.fetch_add(1, std::memory_order_relaxed);
+  if (in_arena) {
+    secret_data_counters.arena_bytes.fetch_add(size,
+                                               std::memory_order_relaxed);
+  }
+}
+
+void RecordSecretDataDeallocation(size_t size, bool in_arena) {
+  thread_secret_data_bytes -= size;
+  secret_data_counters.bytes.fetch_sub(size, std::memory_order_relaxed);
+  secret_data_counters.allocations.fetch_sub(1, std::memory_order_relaxed);
+  if (in_arena) {
+    secret_data_counters.arena_bytes.fetch_sub(size,
+                                               std::memory_order_relaxed);
+  }
+}
+
+}  // namespace internal
+}  // namespace util
+}  // namespace tink
+}  // namespace crypto
@@ -15,10 +15,13 @@
 #ifndef TINK_UTIL_SECRET_DATA_INTERNAL_H_
 #define TINK_UTIL_SECRET_DATA_INTERNAL_H_
 
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
 #include <memory>
 
 #include "absl/base/attributes.h"
+#include "tink/util/secret_arena.h"
 
 namespace crypto {
 namespace tink {
@@ -33,6 +36,26 @@ inline void SafeZeroMemory(char* ptr, std::size_t size) {
   }
 }
 
+// Counters of the live allocations of SanitizingAllocator, see
+// util::GetSecretDataStats().
+struct SecretDataCounters {
+  std::atomic<int64_t> bytes;
+  std::atomic<int64_t> allocations;
+  std::atomic<int64_t> arena_bytes;
+};
+
+extern SecretDataCounters secret_data_counters;
+
+// Returns the bytes which the calling thread allocated through
+// SanitizingAllocator minus those it deallocated. The difference of two
+// readings is the secret data which the code in between retained.
+int64_t ThreadSecretDataBytes();
+
+// Updates the counters for an allocation or deallocation of 'size' bytes by
+// SanitizingAllocator.
+void RecordSecretDataAllocation(size_t size, bool in_arena);
+void RecordSecretDataDeallocation(size_t size, bool in_arena);
+
 template <typename T>
 struct SanitizingAllocator {
   typedef T value_type;
@@ -43,11 +66,20 @@ struct SanitizingAllocator {
       const SanitizingAllocator<U>&) noexcept {}
 
   ABSL_MUST_USE_RESULT T* allocate(std::size_t n) {
+    // Small objects come from the secret arena, if it is enabled.
+    void* ptr = SecretArenaAllocate(n * sizeof(T), alignof(T));
+    RecordSecretDataAllocation(n * sizeof(T), /*in_arena=*/ptr != nullptr);
+    if (ptr != nullptr) return static_cast<T*>(ptr);
     return std::allocator<T>().allocate(n);
   }
 
   void deallocate(T* ptr, std::size_t n) noexcept {
     SafeZeroMemory(reinterpret_cast<char*>(ptr), n * sizeof(T));
+    if (SecretArenaDeallocate(ptr, n * sizeof(T))) {
+      RecordSecretDataDeallocation(n * sizeof(T), /*in_arena=*/true);
+      return;
+    }
+    RecordSecretDataDeallocation(n * sizeof(T), /*in_arena=*/false);
     std::allocator<T>().deallocate(ptr, n);
   }
 
@@ -109,6 +109,24 @@ TEST(SecretValueTest, MoveAssignment) {
   EXPECT_THAT(s.value(), AnyOf(Eq(0), Eq(102)));
 }
 
+TEST(SecretDataStatsTest, CountsLiveAllocations) {
+  SecretDataStats before = GetSecretDataStats();
+  int64_t thread_before = internal::ThreadSecretDataBytes();
+  {
+    SecretData data(100, 'a');
+    SecretUniquePtr<int64_t> ptr = MakeSecretUniquePtr<int64_t>(3);
+    SecretDataStats during = GetSecretDataStats();
+    EXPECT_THAT(during.bytes - before.bytes, Eq(100 + sizeof(int64_t)));
+    EXPECT_THAT(during.allocations - before.allocations, Eq(2));
+    EXPECT_THAT(internal::ThreadSecretDataBytes() - thread_before,
+                Eq(100 + sizeof(int64_t)));
+  }
+  SecretDataStats after = GetSecretDataStats();
+  EXPECT_THAT(after.bytes, Eq(before.bytes));
+  EXPECT_THAT(after.allocations, Eq(before.allocations));
+  EXPECT_THAT(internal::ThreadSecretDataBytes(), Eq(thread_before));
+}
+
 }  // namespace
 }  // namespace util
 }  // namespace tink
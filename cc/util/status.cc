@@ -47,6 +47,22 @@ const Status& GetOk() {
   return *status;
 }
 
+const std::string& DecryptionFailedMessage() {
+  static const std::string* message = new std::string("decryption failed");
+  return *message;
+}
+
+const std::string& CiphertextTooShortMessage() {
+  static const std::string* message = new std::string("Ciphertext too short");
+  return *message;
+}
+
+const std::string& AuthenticationFailedMessage() {
+  static const std::string* message =
+      new std::string("Authentication failed");
+  return *message;
+}
+
 }  // namespace
 
 Status::Status(const ::absl::Status& status)
@@ -58,7 +74,8 @@ Status::Status(const ::absl::Status& status)
 
 Status::operator ::absl::Status() const {
   if (ok()) return ::absl::OkStatus();
-  return ::absl::Status(static_cast<absl::StatusCode>(code_), message_);
+  return ::absl::Status(static_cast<absl::StatusCode>(code_),
+                        error_message());
 }
 
 Status::Status() : code_(::crypto::tink::util::error::OK), message_("") {
@@ -75,9 +92,20 @@ Status::Status(::crypto::tink::util::error::Code error,
 Status& Status::operator=(const Status& other) {
   code_ = other.code_;
   message_ = other.message_;
+  interned_message_ = other.interned_message_;
   return *this;
 }
 
+Status Status::Interned(::crypto::tink::util::error::Code error,
+                        const std::string& error_message) {
+  Status status;
+  status.code_ = error;
+  if (error != ::crypto::tink::util::error::OK) {
+    status.interned_message_ = &error_message;
+  }
+  return status;
+}
+
 const Status& Status::CANCELLED = GetCancelled();
 const Status& Status::UNKNOWN = GetUnknown();
 const Status& Status::OK = GetOk();
@@ -88,7 +116,7 @@ std::string Status::ToString() const {
   }
 
   std::ostringstream oss;
-  oss << code_ << ": " << message_;
+  oss << code_ << ": " << error_message();
   return oss.str();
 }
 
@@ -134,6 +162,20 @@ std::string ErrorCodeString(crypto::tink::util::error::Code error) {
   return absl::StrCat(error);
 }
 
+Status DecryptionFailedError(crypto::tink::util::error::Code code) {
+  return Status::Interned(code, DecryptionFailedMessage());
+}
+
+Status CiphertextTooShortError() {
+  return Status::Interned(crypto::tink::util::error::INVALID_ARGUMENT,
+                          CiphertextTooShortMessage());
+}
+
+Status AuthenticationFailedError() {
+  return Status::Interned(crypto::tink::util::error::INTERNAL,
+                          AuthenticationFailedMessage());
+}
+
 extern ostream& operator<<(ostream& os, crypto::tink::util::error::Code code) {
   os << ErrorCodeString(code);
   return os;
@@ -147,6 +147,13 @@ class Status {
 
   Status& operator=(const Status& other);
 
+  // Makes a Status that refers to 'error_message' instead of copying it, so
+  // that creating, copying and destroying the Status never allocates.
+  // 'error_message' must outlive the Status and all its copies; prefer the
+  // pre-defined errors below, whose messages are never destroyed.
+  static Status Interned(::crypto::tink::util::error::Code error,
+                         const std::string& error_message);
+
   // Some pre-defined Status objects
   static const Status& OK;  // Identical to 0-arg constructor
   static const Status& CANCELLED;
@@ -162,7 +169,9 @@ class Status {
   ::crypto::tink::util::error::Code CanonicalCode() const {
     return code_;
   }
-  const std::string& error_message() const { return message_; }
+  const std::string& error_message() const {
+    return interned_message_ != nullptr ? *interned_message_ : message_;
+  }
 
   bool operator==(const Status& x) const;
   bool operator!=(const Status& x) const;
@@ -179,10 +188,13 @@ class Status {
  private:
   ::crypto::tink::util::error::Code code_;
   std::string message_;
+  // If not null, the message of this status; 'message_' is then empty.
+  const std::string* interned_message_ = nullptr;
 };
 
 inline bool Status::operator==(const Status& other) const {
-  return (this->code_ == other.code_) && (this->message_ == other.message_);
+  return (this->code_ == other.code_) &&
+         (this->error_message() == other.error_message());
 }
 
 inline bool Status::operator!=(const Status& other) const {
@@ -198,6 +210,19 @@ extern ::std::ostream& operator<<(::std::ostream& os, const Status& other);
 // Returns an OK status, equivalent to a default constructed instance.
 inline Status OkStatus() { return Status(); }
 
+// Errors which are expected on hot paths, e.g. for every key that fails to
+// decrypt a ciphertext while a keyset is trial-decrypting it. They use
+// interned messages and hence do not allocate.
+//
+// "decryption failed", with the given code.
+Status DecryptionFailedError(
+    ::crypto::tink::util::error::Code code =
+        ::crypto::tink::util::error::INVALID_ARGUMENT);
+// INVALID_ARGUMENT: "Ciphertext too short".
+Status CiphertextTooShortError();
+// INTERNAL: "Authentication failed".
+Status AuthenticationFailedError();
+
 }  // namespace util
 }  // namespace tink
 }  // namespace crypto
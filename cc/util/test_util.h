@@ -363,6 +363,22 @@ class DummyStreamingAead : public StreamingAead {
         absl::StrCat(streaming_aead_name_, associated_data))};
   }
 
+  crypto::tink::util::StatusOr<std::string> EncryptSmall(
+      absl::string_view plaintext,
+      absl::string_view associated_data) override {
+    return absl::StrCat(streaming_aead_name_, associated_data, plaintext);
+  }
+
+  crypto::tink::util::StatusOr<std::string> DecryptSmall(
+      absl::string_view ciphertext,
+      absl::string_view associated_data) override {
+    std::string header = absl::StrCat(streaming_aead_name_, associated_data);
+    if (!absl::StartsWith(ciphertext, header)) {
+      return util::Status(util::error::INVALID_ARGUMENT, "Corrupted header");
+    }
+    return std::string(ciphertext.substr(header.size()));
+  }
+
   // Upon first call to Next() writes to 'ct_dest' the specifed 'header',
   // and subsequently forwards all methods calls to the corresponding
   // methods of 'cd_dest'.
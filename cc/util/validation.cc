@@ -56,15 +56,18 @@ util::Status ValidateKey(const Keyset::Key& key) {
 }
 
 util::Status ValidateKeyset(const Keyset& keyset) {
+  return PlanKeyset(keyset).status();
+}
+
+util::StatusOr<KeysetPlan> PlanKeyset(const Keyset& keyset) {
   if (keyset.key_size() < 1) {
     return util::Status(util::error::INVALID_ARGUMENT,
                         "A valid keyset must contain at least one key.");
   }
 
   uint32_t primary_key_id = keyset.primary_key_id();
-  bool has_primary_key = false;
   bool contains_only_public_key_material = true;
-  int enabled_keys = 0;
+  KeysetPlan plan;
 
   for (int i = 0; i < keyset.key_size(); i++) {
     const Keyset::Key& key = keyset.key(i);
@@ -73,20 +76,19 @@ util::Status ValidateKeyset(const Keyset& keyset) {
     if (key.status() != KeyStatusType::ENABLED) {
       continue;
     }
-    enabled_keys += 1;
+    plan.enabled_key_indices.push_back(i);
 
     auto validation_result = ValidateKey(key);
     if (!validation_result.ok()) {
       return validation_result;
     }
 
-    if (key.status() == KeyStatusType::ENABLED &&
-        key.key_id() == primary_key_id) {
-      if (has_primary_key) {
+    if (key.key_id() == primary_key_id) {
+      if (plan.primary_key_index >= 0) {
         return util::Status(util::error::INVALID_ARGUMENT,
                             "keyset contains multiple primary keys");
       }
-      has_primary_key = true;
+      plan.primary_key_index = i;
     }
 
     if (key.key_data().key_material_type() != KeyData::ASYMMETRIC_PUBLIC) {
@@ -94,7 +96,7 @@ util::Status ValidateKeyset(const Keyset& keyset) {
     }
   }
 
-  if (enabled_keys == 0) {
+  if (plan.enabled_key_indices.empty()) {
     return util::Status(util::error::INVALID_ARGUMENT,
                         "keyset must contain at least one ENABLED key");
   }
@@ -102,12 +104,12 @@ util::Status ValidateKeyset(const Keyset& keyset) {
   // A public key can be used for verification without being set as the primary
   // key. Therefore, it is okay to have a keyset that contains public but
   // doesn't have a primary key set.
-  if (!has_primary_key && !contains_only_public_key_material) {
+  if (plan.primary_key_index < 0 && !contains_only_public_key_material) {
     return util::Status(util::error::INVALID_ARGUMENT,
                         "keyset doesn't contain a valid primary key");
   }
 
-  return util::Status::OK;
+  return plan;
 }
 
 util::Status ValidateVersion(uint32_t candidate, uint32_t max_expected) {
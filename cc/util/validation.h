@@ -17,7 +17,10 @@
 #ifndef TINK_UTIL_VALIDATION_H_
 #define TINK_UTIL_VALIDATION_H_
 
+#include <vector>
+
 #include "tink/util/status.h"
+#include "tink/util/statusor.h"
 #include "proto/tink.pb.h"
 
 namespace crypto {
@@ -33,6 +36,19 @@ crypto::tink::util::Status ValidateKey(
 crypto::tink::util::Status ValidateKeyset(
     const google::crypto::tink::Keyset& keyset);
 
+// What is needed to create the primitives of a valid keyset.
+struct KeysetPlan {
+  // The indices of the ENABLED keys, in the order of the keyset.
+  std::vector<int> enabled_key_indices;
+  // The index of the primary key, or -1 if there is none, which is only
+  // valid for keysets with public key material only.
+  int primary_key_index = -1;
+};
+
+// Validates 'keyset' as ValidateKeyset(), and returns its plan.
+crypto::tink::util::StatusOr<KeysetPlan> PlanKeyset(
+    const google::crypto::tink::Keyset& keyset);
+
 crypto::tink::util::Status ValidateVersion(
     uint32_t candidate, uint32_t max_expected);
 
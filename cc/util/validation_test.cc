@@ -26,6 +26,8 @@ namespace {
 using crypto::tink::test::IsOk;
 using crypto::tink::test::StatusIs;
 using google::crypto::tink::KeyData;
+using testing::ElementsAre;
+using testing::Eq;
 using testing::Not;
 
 TEST(ValidateKey, ValidKey) {
@@ -160,6 +162,51 @@ TEST(ValidateKeyset, ValidHighId) {
   EXPECT_THAT(crypto::tink::ValidateKeyset(keyset), IsOk());
 }
 
+// Tests that the plan lists the enabled keys and the index of the primary.
+TEST(PlanKeyset, EnabledKeysAndPrimary) {
+  google::crypto::tink::Keyset keyset;
+  google::crypto::tink::Keyset::Key* key = keyset.add_key();
+  key->set_key_id(32);
+  key->mutable_key_data()->set_value("some value");
+  key->set_output_prefix_type(google::crypto::tink::OutputPrefixType::TINK);
+  key->set_status(google::crypto::tink::KeyStatusType::ENABLED);
+  key = keyset.add_key();
+  key->set_key_id(100);
+  key->mutable_key_data()->set_value("some other value");
+  key->set_output_prefix_type(google::crypto::tink::OutputPrefixType::TINK);
+  key->set_status(google::crypto::tink::KeyStatusType::DISABLED);
+  key = keyset.add_key();
+  key->set_key_id(18);
+  key->mutable_key_data()->set_value("some third value");
+  key->set_output_prefix_type(google::crypto::tink::OutputPrefixType::TINK);
+  key->set_status(google::crypto::tink::KeyStatusType::ENABLED);
+  keyset.set_primary_key_id(18);
+  auto plan_result = crypto::tink::PlanKeyset(keyset);
+  ASSERT_THAT(plan_result.status(), IsOk());
+  EXPECT_THAT(plan_result.ValueOrDie().enabled_key_indices, ElementsAre(0, 2));
+  EXPECT_THAT(plan_result.ValueOrDie().primary_key_index, Eq(2));
+}
+
+TEST(PlanKeyset, OnlyPublicKeysWithoutPrimary) {
+  google::crypto::tink::Keyset keyset;
+  google::crypto::tink::Keyset::Key* key = keyset.add_key();
+  key->set_key_id(32);
+  key->mutable_key_data()->set_value("some value");
+  key->mutable_key_data()->set_key_material_type(KeyData::ASYMMETRIC_PUBLIC);
+  key->set_output_prefix_type(google::crypto::tink::OutputPrefixType::TINK);
+  key->set_status(google::crypto::tink::KeyStatusType::ENABLED);
+  auto plan_result = crypto::tink::PlanKeyset(keyset);
+  ASSERT_THAT(plan_result.status(), IsOk());
+  EXPECT_THAT(plan_result.ValueOrDie().enabled_key_indices, ElementsAre(0));
+  EXPECT_THAT(plan_result.ValueOrDie().primary_key_index, Eq(-1));
+}
+
+TEST(PlanKeyset, Invalid) {
+  google::crypto::tink::Keyset keyset;
+  EXPECT_THAT(crypto::tink::PlanKeyset(keyset).status(),
+              StatusIs(util::error::INVALID_ARGUMENT));
+}
+
 }  // namespace
 
 }  // namespace tink
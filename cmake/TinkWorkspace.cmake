@@ -92,3 +92,15 @@ http_archive(
   SHA256 bf0e5070b4b99240183b29df78155eee335885e53a8af8683964579c214ad301
   CMAKE_SUBDIR cmake
 )
+
+# zlib is only needed for the compressing streams in cc/streamingaead, which
+# are omitted if no installed package, e.g. the zlib1g-dev package of the
+# distribution, is found.
+find_package(ZLIB)
+
+# Google Benchmark is only needed for the benchmarks in cc/benchmarks. An
+# installed package is used, e.g. the libbenchmark-dev package of the
+# distribution, or a local build installed with CMAKE_PREFIX_PATH pointing to it.
+if (TINK_BUILD_BENCHMARKS)
+  find_package(benchmark REQUIRED)
+endif()
@@ -0,0 +1,124 @@
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+// Benchmarks of the CECPQ2 KEM: encapsulation with the sender KEM and
+// decapsulation with the recipient KEM. Run them with
+//   bazel run -c opt //pqcrypto/cc/subtle:cecpq2_hkdf_kem_boringssl_benchmark
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "benchmark/benchmark.h"
+#include "tink/subtle/common_enums.h"
+#include "tink/util/secret_data.h"
+#include "tink/util/statusor.h"
+#include "pqcrypto/cc/subtle/cecpq2_hkdf_recipient_kem_boringssl.h"
+#include "pqcrypto/cc/subtle/cecpq2_hkdf_sender_kem_boringssl.h"
+#include "pqcrypto/cc/subtle/cecpq2_subtle_boringssl_util.h"
+
+namespace crypto {
+namespace tink {
+namespace subtle {
+namespace {
+
+constexpr char kHkdfSalt[] = "salt";
+constexpr char kHkdfInfo[] = "info";
+constexpr int kKeySize = 32;
+
+void BM_Cecpq2Encapsulate(benchmark::State& state) {
+  auto cecpq2_key_pair_or =
+      pqc::GenerateCecpq2Keypair(EllipticCurveType::CURVE25519);
+  if (!cecpq2_key_pair_or.ok()) {
+    state.SkipWithError(cecpq2_key_pair_or.status().error_message().c_str());
+    return;
+  }
+  const pqc::Cecpq2KeyPair& cecpq2_key_pair = cecpq2_key_pair_or.ValueOrDie();
+  auto sender_kem_or = Cecpq2HkdfSenderKemBoringSsl::New(
+      EllipticCurveType::CURVE25519, cecpq2_key_pair.x25519_key_pair.pub_x,
+      cecpq2_key_pair.x25519_key_pair.pub_y,
+      cecpq2_key_pair.hrss_key_pair.hrss_public_key_marshaled);
+  if (!sender_kem_or.ok()) {
+    state.SkipWithError(sender_kem_or.status().error_message().c_str());
+    return;
+  }
+  const Cecpq2HkdfSenderKemBoringSsl& sender_kem = *sender_kem_or.ValueOrDie();
+
+  for (auto _ : state) {
+    auto kem_key_or =
+        sender_kem.GenerateKey(HashType::SHA256, kHkdfSalt, kHkdfInfo,
+                               kKeySize, EcPointFormat::COMPRESSED);
+    if (!kem_key_or.ok()) {
+      state.SkipWithError(kem_key_or.status().error_message().c_str());
+      break;
+    }
+    benchmark::DoNotOptimize(kem_key_or);
+  }
+}
+
+void BM_Cecpq2Decapsulate(benchmark::State& state) {
+  auto cecpq2_key_pair_or =
+      pqc::GenerateCecpq2Keypair(EllipticCurveType::CURVE25519);
+  if (!cecpq2_key_pair_or.ok()) {
+    state.SkipWithError(cecpq2_key_pair_or.status().error_message().c_str());
+    return;
+  }
+  pqc::Cecpq2KeyPair cecpq2_key_pair =
+      std::move(cecpq2_key_pair_or.ValueOrDie());
+  auto sender_kem_or = Cecpq2HkdfSenderKemBoringSsl::New(
+      EllipticCurveType::CURVE25519, cecpq2_key_pair.x25519_key_pair.pub_x,
+      cecpq2_key_pair.x25519_key_pair.pub_y,
+      cecpq2_key_pair.hrss_key_pair.hrss_public_key_marshaled);
+  if (!sender_kem_or.ok()) {
+    state.SkipWithError(sender_kem_or.status().error_message().c_str());
+    return;
+  }
+  auto kem_key_or = sender_kem_or.ValueOrDie()->GenerateKey(
+      HashType::SHA256, kHkdfSalt, kHkdfInfo, kKeySize,
+      EcPointFormat::COMPRESSED);
+  if (!kem_key_or.ok()) {
+    state.SkipWithError(kem_key_or.status().error_message().c_str());
+    return;
+  }
+  std::string kem_bytes = kem_key_or.ValueOrDie()->get_kem_bytes();
+  auto recipient_kem_or = Cecpq2HkdfRecipientKemBoringSsl::New(
+      EllipticCurveType::CURVE25519, cecpq2_key_pair.x25519_key_pair.priv,
+      std::move(cecpq2_key_pair.hrss_key_pair.hrss_private_key));
+  if (!recipient_kem_or.ok()) {
+    state.SkipWithError(recipient_kem_or.status().error_message().c_str());
+    return;
+  }
+  const Cecpq2HkdfRecipientKemBoringSsl& recipient_kem =
+      *recipient_kem_or.ValueOrDie();
+
+  for (auto _ : state) {
+    auto symmetric_key_or =
+        recipient_kem.GenerateKey(kem_bytes, HashType::SHA256, kHkdfSalt,
+                                  kHkdfInfo, kKeySize,
+                                  EcPointFormat::COMPRESSED);
+    if (!symmetric_key_or.ok()) {
+      state.SkipWithError(symmetric_key_or.status().error_message().c_str());
+      break;
+    }
+    benchmark::DoNotOptimize(symmetric_key_or);
+  }
+}
+
+BENCHMARK(BM_Cecpq2Encapsulate)->ThreadRange(1, 8);
+BENCHMARK(BM_Cecpq2Decapsulate)->ThreadRange(1, 8);
+
+}  // namespace
+}  // namespace subtle
+}  // namespace tink
+}  // namespace crypto
@@ -15,7 +15,6 @@
 #include "pqcrypto/cc/subtle/cecpq2_hkdf_recipient_kem_boringssl.h"
 
 #include "absl/memory/memory.h"
-#include "absl/strings/str_cat.h"
 #include "openssl/bn.h"
 #include "openssl/curve25519.h"
 #include "openssl/ec.h"
@@ -81,7 +80,7 @@ Cecpq2HkdfX25519RecipientKemBoringSsl::GenerateKey(
         util::error::INVALID_ARGUMENT,
         "X25519 only supports compressed elliptic curve points");
   }
-  if (kem_bytes.size() != X25519_PUBLIC_VALUE_LEN + HRSS_PUBLIC_KEY_BYTES) {
+  if (kem_bytes.size() != X25519_PUBLIC_VALUE_LEN + HRSS_CIPHERTEXT_BYTES) {
     return util::Status(util::error::INVALID_ARGUMENT,
                         "kem_bytes has unexpected size");
   }
@@ -99,10 +98,14 @@ Cecpq2HkdfX25519RecipientKemBoringSsl::GenerateKey(
                                               X25519_PUBLIC_VALUE_LEN),
              HRSS_CIPHERTEXT_BYTES);
 
-  // Concatenate both shared secrets and kem_bytes
-  util::SecretData ikm = util::SecretDataFromStringView(absl::StrCat(
-      kem_bytes, util::SecretDataAsStringView(x25519_shared_secret),
-      util::SecretDataAsStringView(hrss_shared_secret)));
+  // Concatenate the kem_bytes with both shared secrets, directly in
+  // SecretData so that no copy of the shared secrets is left behind
+  util::SecretData ikm;
+  ikm.reserve(kem_bytes.size() + X25519_SHARED_KEY_LEN + HRSS_KEY_BYTES);
+  ikm.insert(ikm.end(), kem_bytes.begin(), kem_bytes.end());
+  ikm.insert(ikm.end(), x25519_shared_secret.begin(),
+             x25519_shared_secret.end());
+  ikm.insert(ikm.end(), hrss_shared_secret.begin(), hrss_shared_secret.end());
 
   // Compute symmetric key from both shared secrets, kem_bytes, hkdf_salt and
   // hkdf_info using HKDF
@@ -111,9 +114,7 @@ Cecpq2HkdfX25519RecipientKemBoringSsl::GenerateKey(
   if (!symmetric_key_or.ok()) {
     return symmetric_key_or.status();
   }
-  util::SecretData symmetric_key = symmetric_key_or.ValueOrDie();
-
-  return symmetric_key;
+  return std::move(symmetric_key_or.ValueOrDie());
 }
 
 }  // namespace subtle
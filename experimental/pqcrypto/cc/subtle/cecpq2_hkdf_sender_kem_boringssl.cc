@@ -14,8 +14,12 @@
 
 #include "pqcrypto/cc/subtle/cecpq2_hkdf_sender_kem_boringssl.h"
 
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <utility>
+
 #include "absl/memory/memory.h"
-#include "absl/strings/str_cat.h"
 #include "openssl/bn.h"
 #include "openssl/curve25519.h"
 #include "openssl/hrss.h"
@@ -50,11 +54,10 @@ Cecpq2HkdfSenderKemBoringSsl::New(subtle::EllipticCurveType curve,
 
 Cecpq2HkdfX25519SenderKemBoringSsl::Cecpq2HkdfX25519SenderKemBoringSsl(
     const absl::string_view peer_ec_pubx,
-    const absl::string_view marshalled_hrss_pub) {
-  peer_public_key_x25519_ =
-      reinterpret_cast<const uint8_t*>(peer_ec_pubx.data());
-  peer_marshalled_public_key_hrss_ =
-      reinterpret_cast<const uint8_t*>(marshalled_hrss_pub.data());
+    std::unique_ptr<struct HRSS_public_key> peer_public_key_hrss)
+    : peer_public_key_hrss_(std::move(peer_public_key_hrss)) {
+  std::copy_n(peer_ec_pubx.data(), X25519_PUBLIC_VALUE_LEN,
+              peer_public_key_x25519_);
 }
 
 // static
@@ -82,9 +85,18 @@ Cecpq2HkdfX25519SenderKemBoringSsl::New(
                         "marshalled_hrss_pub has unexpected length");
   }
 
+  auto peer_public_key_hrss = absl::make_unique<struct HRSS_public_key>();
+  if (!HRSS_parse_public_key(
+          peer_public_key_hrss.get(),
+          reinterpret_cast<const uint8_t*>(marshalled_hrss_pub.data()))) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        "marshalled_hrss_pub is not a valid HRSS public key");
+  }
+
   // If input parameters are ok, create a CECPQ2 Sender KEM instance
   std::unique_ptr<const Cecpq2HkdfSenderKemBoringSsl> sender_kem(
-      new Cecpq2HkdfX25519SenderKemBoringSsl(pubx, marshalled_hrss_pub));
+      new Cecpq2HkdfX25519SenderKemBoringSsl(pubx,
+                                             std::move(peer_public_key_hrss)));
   return std::move(sender_kem);
 }
 
@@ -100,13 +112,17 @@ Cecpq2HkdfX25519SenderKemBoringSsl::GenerateKey(
         "X25519 only supports compressed elliptic curve points");
   }
 
-  // Generate the ephemeral X25519 key pair. Note that the
-  // X25519_kem_bytes holds the X25519 public key
+  // The kem_bytes hold the X25519 public key followed by the HRSS
+  // ciphertext, which are written in place.
+  std::string kem_bytes;
+  subtle::ResizeStringUninitialized(
+      &kem_bytes, X25519_PUBLIC_VALUE_LEN + HRSS_CIPHERTEXT_BYTES);
+  uint8_t* x25519_kem_bytes = reinterpret_cast<uint8_t*>(&kem_bytes[0]);
+  uint8_t* hrss_kem_bytes = x25519_kem_bytes + X25519_PUBLIC_VALUE_LEN;
+
+  // Generate the ephemeral X25519 key pair
   util::SecretData ephemeral_x25519_private_key(X25519_PRIVATE_KEY_LEN);
-  std::string x25519_kem_bytes(X25519_PUBLIC_VALUE_LEN, '\0');
-  X25519_keypair(const_cast<uint8_t*>(
-                 reinterpret_cast<const uint8_t*>(x25519_kem_bytes.data())),
-                 ephemeral_x25519_private_key.data());
+  X25519_keypair(x25519_kem_bytes, ephemeral_x25519_private_key.data());
 
   // Generate the x25519 shared secret using peer's X25519 public key and
   // locally generated ephemeral X25519 private key
@@ -114,39 +130,24 @@ Cecpq2HkdfX25519SenderKemBoringSsl::GenerateKey(
   X25519(x25519_shared_secret.data(), ephemeral_x25519_private_key.data(),
          peer_public_key_x25519_);
 
-  // Declare the hrss_shared_secret and hrss_kem_bytes to be used in HRSS encaps
-  util::SecretData hrss_shared_secret;
-  hrss_shared_secret.resize(HRSS_KEY_BYTES);
-  // The hrss_kem_bytes will contain the encrypted shared secret
-  std::string hrss_kem_bytes;
-  subtle::ResizeStringUninitialized(&hrss_kem_bytes, HRSS_CIPHERTEXT_BYTES);
-
-  // Recover the internal HRSS public key representation from marshalled version
-  struct HRSS_public_key peer_public_key_hrss;
-  HRSS_parse_public_key(&peer_public_key_hrss,
-                        peer_marshalled_public_key_hrss_);
-
   // Generate entropy to be used in encaps
   util::SecretData encaps_entropy =
       crypto::tink::subtle::Random::GetRandomKeyBytes(HRSS_ENCAP_BYTES);
 
   // Generate a random shared secret and encapsulate it using peer's HRSS public
   // key
-  HRSS_encap(const_cast<uint8_t*>(
-             reinterpret_cast<const uint8_t*>(hrss_kem_bytes.data())),
-             reinterpret_cast<uint8_t*>(hrss_shared_secret.data()),
-             &peer_public_key_hrss, encaps_entropy.data());
-
-  // Concatenate the two kem_bytes
-  std::string kem_bytes(x25519_kem_bytes);
-  kem_bytes += hrss_kem_bytes;
-
-  // Concatenate the two shared secrets with the two kem_bytes
-  std::string kem_bytes_and_shared_secrets = absl::StrCat(
-      kem_bytes, util::SecretDataAsStringView(x25519_shared_secret),
-      util::SecretDataAsStringView(hrss_shared_secret));
-  util::SecretData ikm =
-      util::SecretDataFromStringView(kem_bytes_and_shared_secrets);
+  util::SecretData hrss_shared_secret(HRSS_KEY_BYTES);
+  HRSS_encap(hrss_kem_bytes, hrss_shared_secret.data(),
+             peer_public_key_hrss_.get(), encaps_entropy.data());
+
+  // Concatenate the kem_bytes with the two shared secrets, directly in
+  // SecretData so that no copy of the shared secrets is left behind
+  util::SecretData ikm;
+  ikm.reserve(kem_bytes.size() + X25519_SHARED_KEY_LEN + HRSS_KEY_BYTES);
+  ikm.insert(ikm.end(), kem_bytes.begin(), kem_bytes.end());
+  ikm.insert(ikm.end(), x25519_shared_secret.begin(),
+             x25519_shared_secret.end());
+  ikm.insert(ikm.end(), hrss_shared_secret.begin(), hrss_shared_secret.end());
 
   // Compute the symmetric key from the two shared secrets, kem_bytes, hkdf_salt
   // and hkdf_info using HKDF
@@ -155,10 +156,10 @@ Cecpq2HkdfX25519SenderKemBoringSsl::GenerateKey(
   if (!symmetric_key_or.ok()) {
     return symmetric_key_or.status();
   }
-  util::SecretData symmetric_key = symmetric_key_or.ValueOrDie();
 
   // Return the produced pair kem_bytes and symmetric_key
-  return absl::make_unique<const KemKey>(kem_bytes, symmetric_key);
+  return absl::make_unique<const KemKey>(
+      std::move(kem_bytes), std::move(symmetric_key_or.ValueOrDie()));
 }
 
 }  // namespace subtle
@@ -15,6 +15,9 @@
 #ifndef THIRD_PARTY_TINK_EXPERIMENTAL_PQCRYPTO_CC_SUBTLE_CECPQ2_HKDF_SENDER_KEM_BORINGSSL_H_
 #define THIRD_PARTY_TINK_EXPERIMENTAL_PQCRYPTO_CC_SUBTLE_CECPQ2_HKDF_SENDER_KEM_BORINGSSL_H_
 
+#include <memory>
+#include <string>
+
 #include "absl/strings/string_view.h"
 #include "openssl/curve25519.h"
 #include "openssl/ec.h"
@@ -131,20 +134,14 @@ class Cecpq2HkdfX25519SenderKemBoringSsl : public Cecpq2HkdfSenderKemBoringSsl {
   // already been made in the New() method defined above.
   explicit Cecpq2HkdfX25519SenderKemBoringSsl(
       const absl::string_view peer_ec_pubx,
-      const absl::string_view marshalled_hrss_pub);
+      std::unique_ptr<struct HRSS_public_key> peer_public_key_hrss);
 
-  // X25519 and HRSS public key containers. We note that the BoringSSL
-  // implementation of HRSS requires that the HRSS public key is stored in the
-  // *marshalled* format. This is done by calling the HRSS_marshal_public_key
-  // function from BoringSSL (see the tests available in cecpq2_hkdf_sender_kem
-  // _boringssl_test.cc file that demonstrate this process). If this process is
-  // not done, the internal raw HRSS public key representation (using the struct
-  // HRSS_public_key data structure) might cause padding problems depending on
-  // the compiler options.
-  // Pointer to array of size X25519_PUBLIC_VALUE_LEN bytes
-  const uint8_t* peer_public_key_x25519_;
-  // Pointer to array of size HRSS_PUBLIC_KEY_BYTES bytes
-  const uint8_t* peer_marshalled_public_key_hrss_;
+  uint8_t peer_public_key_x25519_[X25519_PUBLIC_VALUE_LEN];
+  // The HRSS public key, parsed once by New() from its marshalled format, so
+  // that GenerateKey() does not parse it on every call. The marshalled format
+  // is the one that is passed around, as the internal representation (struct
+  // HRSS_public_key) might have padding that depends on compiler options.
+  std::unique_ptr<const struct HRSS_public_key> peer_public_key_hrss_;
 };
 
 }  // namespace subtle
@@ -19,6 +19,8 @@ from __future__ import division
 # Placeholder for import for type annotations
 from __future__ import print_function
 
+from typing import Any, Tuple
+
 from tink import core
 from tink.aead import _aead
 from tink.aead import _aead_wrapper
@@ -39,6 +41,24 @@ class AeadCcToPyWrapper(_aead.Aead):
   def decrypt(self, plaintext: bytes, associated_data: bytes) -> bytes:
     return self._aead.decrypt(plaintext, associated_data)
 
+  @core.use_tink_errors
+  def encrypt_batch(self,
+                    plaintexts: Any,
+                    offsets: Any,
+                    associated_data: bytes,
+                    output_prefix: bytes = b'') -> Tuple[bytes, memoryview]:
+    return self._aead.encrypt_batch(plaintexts, offsets, associated_data,
+                                    output_prefix)
+
+  @core.use_tink_errors
+  def decrypt_batch(self,
+                    ciphertexts: Any,
+                    offsets: Any,
+                    associated_data: bytes,
+                    input_prefix: bytes = b'') -> Tuple[bytes, memoryview]:
+    return self._aead.decrypt_batch(ciphertexts, offsets, associated_data,
+                                    input_prefix)
+
 
 def register() -> None:
   """Registers all AEAD key managers and AEAD wrapper in the Registry."""
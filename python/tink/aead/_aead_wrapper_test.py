@@ -122,6 +122,39 @@ class AeadWrapperTest(parameterized.TestCase):
     self.assertEqual(p3.decrypt(ciphertext4, b'ad'), b'plaintext')
     self.assertEqual(p4.decrypt(ciphertext4, b'ad'), b'plaintext')
 
+  @parameterized.parameters([AEAD_TEMPLATE, RAW_AEAD_TEMPLATE])
+  def test_encrypt_decrypt_batch(self, template):
+    keyset_handle = tink.new_keyset_handle(template)
+    primitive = keyset_handle.primitive(aead.Aead)
+    plaintexts = [b'', b'a', b'plaintext', b'']
+    ciphertexts, offsets = primitive.encrypt_batch(
+        *tink.core.packed_values.pack(plaintexts), b'ad')
+    for ciphertext in tink.core.packed_values.unpack(ciphertexts, offsets):
+      self.assertIn(primitive.decrypt(ciphertext, b'ad'), plaintexts)
+    data, plaintext_offsets = primitive.decrypt_batch(ciphertexts, offsets,
+                                                      b'ad')
+    self.assertEqual(
+        tink.core.packed_values.unpack(data, plaintext_offsets), plaintexts)
+    with self.assertRaises(tink.TinkError):
+      primitive.decrypt_batch(ciphertexts, offsets, b'wrong_ad')
+
+  def test_decrypt_batch_with_key_rotation(self):
+    builder = keyset_builder.new_keyset_builder()
+    older_key_id = builder.add_new_key(AEAD_TEMPLATE)
+    builder.set_primary_key(older_key_id)
+    p1 = builder.keyset_handle().primitive(aead.Aead)
+    newer_key_id = builder.add_new_key(RAW_AEAD_TEMPLATE)
+    builder.set_primary_key(newer_key_id)
+    p2 = builder.keyset_handle().primitive(aead.Aead)
+
+    # The batch mixes both keys, so p2 cannot decrypt it with its primary.
+    ciphertexts = [p1.encrypt(b'old', b'ad'), p2.encrypt(b'new', b'ad')]
+    data, offsets = p2.decrypt_batch(
+        *tink.core.packed_values.pack(ciphertexts), b'ad')
+    self.assertEqual(
+        tink.core.packed_values.unpack(data, offsets), [b'old', b'new'])
+
+
 
 if __name__ == '__main__':
   absltest.main()
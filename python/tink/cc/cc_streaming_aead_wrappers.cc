@@ -14,12 +14,37 @@
 
 #include "tink/cc/cc_streaming_aead_wrappers.h"
 
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include "absl/strings/str_cat.h"
 #include "tink/input_stream.h"
 #include "tink/output_stream.h"
+#include "tink/util/file_input_stream.h"
+#include "tink/util/file_output_stream.h"
 
 namespace crypto {
 namespace tink {
 
+namespace {
+
+// Large enough that the native streams rarely make a system call per segment.
+constexpr int kFileStreamBufferSize = 1024 * 1024;  // 1 MB
+
+util::StatusOr<int> DuplicateFd(int fd) {
+  int duplicate_fd = dup(fd);
+  if (duplicate_fd < 0) {
+    return util::Status(util::error::INVALID_ARGUMENT,
+                        absl::StrCat("Could not duplicate file descriptor ",
+                                     fd, ": ", std::strerror(errno)));
+  }
+  return duplicate_fd;
+}
+
+}  // namespace
+
 util::StatusOr<std::unique_ptr<OutputStreamAdapter>> NewCcEncryptingStream(
     StreamingAead* streaming_aead, absl::string_view aad,
     std::shared_ptr<PythonFileObjectAdapter> ciphertext_destination) {
@@ -56,5 +81,37 @@ util::StatusOr<std::unique_ptr<InputStreamAdapter>> NewCcDecryptingStream(
   return absl::make_unique<InputStreamAdapter>(std::move(result.ValueOrDie()));
 }
 
+util::StatusOr<std::unique_ptr<OutputStreamAdapter>>
+NewCcEncryptingStreamFromFd(StreamingAead* streaming_aead,
+                            absl::string_view aad,
+                            int ciphertext_destination_fd) {
+  auto fd_result = DuplicateFd(ciphertext_destination_fd);
+  if (!fd_result.ok()) return fd_result.status();
+  std::unique_ptr<OutputStream> destination_os =
+      absl::make_unique<util::FileOutputStream>(fd_result.ValueOrDie(),
+                                                kFileStreamBufferSize);
+  auto result =
+      streaming_aead->NewEncryptingStream(std::move(destination_os), aad);
+  if (!result.ok()) {
+    return result.status();
+  }
+  return absl::make_unique<OutputStreamAdapter>(std::move(result.ValueOrDie()));
+}
+
+util::StatusOr<std::unique_ptr<InputStreamAdapter>>
+NewCcDecryptingStreamFromFd(StreamingAead* streaming_aead,
+                            absl::string_view aad, int ciphertext_source_fd) {
+  auto fd_result = DuplicateFd(ciphertext_source_fd);
+  if (!fd_result.ok()) return fd_result.status();
+  std::unique_ptr<InputStream> source_os =
+      absl::make_unique<util::FileInputStream>(fd_result.ValueOrDie(),
+                                               kFileStreamBufferSize);
+  auto result = streaming_aead->NewDecryptingStream(std::move(source_os), aad);
+  if (!result.ok()) {
+    return result.status();
+  }
+  return absl::make_unique<InputStreamAdapter>(std::move(result.ValueOrDie()));
+}
+
 }  // namespace tink
 }  // namespace crypto
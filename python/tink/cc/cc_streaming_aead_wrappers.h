@@ -51,6 +51,22 @@ util::StatusOr<std::unique_ptr<InputStreamAdapter>> NewCcDecryptingStream(
     StreamingAead* streaming_aead, const absl::string_view aad,
     std::shared_ptr<PythonFileObjectAdapter> ciphertext_source);
 
+// Like NewCcEncryptingStream, but writes the ciphertext directly to a
+// duplicate of the file descriptor 'ciphertext_destination_fd', without
+// calling into Python. The duplicate is closed when the stream is closed.
+util::StatusOr<std::unique_ptr<OutputStreamAdapter>>
+NewCcEncryptingStreamFromFd(StreamingAead* streaming_aead,
+                            const absl::string_view aad,
+                            int ciphertext_destination_fd);
+
+// Like NewCcDecryptingStream, but reads the ciphertext directly from a
+// duplicate of the file descriptor 'ciphertext_source_fd', without calling
+// into Python. The duplicate is closed when the stream is destroyed.
+util::StatusOr<std::unique_ptr<InputStreamAdapter>>
+NewCcDecryptingStreamFromFd(StreamingAead* streaming_aead,
+                            const absl::string_view aad,
+                            int ciphertext_source_fd);
+
 }  // namespace tink
 }  // namespace crypto
 
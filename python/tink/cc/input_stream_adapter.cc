@@ -15,6 +15,7 @@
 #include "tink/cc/input_stream_adapter.h"
 
 #include <algorithm>
+#include <cstring>
 
 #include "absl/strings/str_cat.h"
 #include "absl/strings/string_view.h"
@@ -25,6 +26,7 @@ namespace crypto {
 namespace tink {
 
 util::StatusOr<std::string> InputStreamAdapter::Read(int64_t size) {
+  absl::MutexLock lock(&mutex_);
   const void* buffer;
   auto next_result = stream_->Next(&buffer);
   if (!next_result.ok()) return next_result.status();
@@ -36,5 +38,18 @@ util::StatusOr<std::string> InputStreamAdapter::Read(int64_t size) {
       absl::string_view(static_cast<const char*>(buffer), read_count));
 }
 
+util::StatusOr<int64_t> InputStreamAdapter::ReadInto(absl::Span<char> buffer) {
+  absl::MutexLock lock(&mutex_);
+  const void* data;
+  auto next_result = stream_->Next(&data);
+  if (!next_result.ok()) return next_result.status();
+  int available = next_result.ValueOrDie();
+  int read_count = std::min(static_cast<int64_t>(available),
+                            static_cast<int64_t>(buffer.size()));
+  if (read_count < available) stream_->BackUp(available - read_count);
+  std::memcpy(buffer.data(), data, read_count);
+  return read_count;
+}
+
 }  // namespace tink
 }  // namespace crypto
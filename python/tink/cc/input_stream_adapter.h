@@ -16,14 +16,19 @@
 #define TINK_PYTHON_CC_INPUT_STREAM_ADAPTER_H_
 
 #include <memory>
+#include <string>
 
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
 #include "tink/input_stream.h"
 #include "tink/util/statusor.h"
 
 namespace crypto {
 namespace tink {
 
-// Adapts an InputStream for use in Python.
+// Adapts an InputStream for use in Python. Thread-safe, so that the bindings
+// can call it without holding the GIL.
 class InputStreamAdapter {
  public:
   explicit InputStreamAdapter(std::unique_ptr<InputStream> stream)
@@ -35,8 +40,13 @@ class InputStreamAdapter {
   // Returns OUT_OF_RANGE status if the stream is already at EOF.
   util::StatusOr<std::string> Read(int64_t size);
 
+  // Like Read(), but reads at most 'buffer.size()' bytes into 'buffer' and
+  // returns their number.
+  util::StatusOr<int64_t> ReadInto(absl::Span<char> buffer);
+
  private:
-  std::unique_ptr<InputStream> stream_;
+  absl::Mutex mutex_;
+  std::unique_ptr<InputStream> stream_ ABSL_GUARDED_BY(mutex_);
 };
 
 }  // namespace tink
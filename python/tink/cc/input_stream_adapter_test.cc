@@ -19,6 +19,7 @@
 
 #include "gtest/gtest.h"
 #include "absl/memory/memory.h"
+#include "absl/types/span.h"
 #include "tink/input_stream.h"
 #include "tink/subtle/random.h"
 #include "tink/util/istream_input_stream.h"
@@ -101,6 +102,22 @@ TEST(InputStreamAdapterTest, ReadFromEmptyStream) {
   EXPECT_EQ(read_result.status().error_code(), util::error::OUT_OF_RANGE);
 }
 
+TEST(InputStreamAdapterTest, ReadInto) {
+  std::string data = subtle::Random::GetRandomBytes(15);
+  auto adapter = GetInputStreamAdapter(-1, data);
+  std::string buffer(10, '\0');
+  auto read_result = adapter->ReadInto(absl::MakeSpan(&buffer[0], 10));
+  ASSERT_TRUE(read_result.status().ok()) << read_result.status();
+  EXPECT_EQ(read_result.ValueOrDie(), 10);
+  EXPECT_EQ(buffer, data.substr(0, 10));
+  read_result = adapter->ReadInto(absl::MakeSpan(&buffer[0], 10));
+  ASSERT_TRUE(read_result.status().ok()) << read_result.status();
+  EXPECT_EQ(read_result.ValueOrDie(), 5);
+  EXPECT_EQ(buffer.substr(0, 5), data.substr(10, 5));
+  read_result = adapter->ReadInto(absl::MakeSpan(&buffer[0], 10));
+  EXPECT_EQ(read_result.status().error_code(), util::error::OUT_OF_RANGE);
+}
+
 }  // namespace
 }  // namespace tink
 }  // namespace crypto
@@ -24,6 +24,7 @@ namespace crypto {
 namespace tink {
 
 util::StatusOr<int64_t> OutputStreamAdapter::Write(absl::string_view data) {
+  absl::MutexLock lock(&mutex_);
   void* buffer;
   int64_t written = 0;
   while (written < data.size()) {
@@ -39,7 +40,10 @@ util::StatusOr<int64_t> OutputStreamAdapter::Write(absl::string_view data) {
   return written;
 }
 
-util::Status OutputStreamAdapter::Close() { return stream_->Close(); }
+util::Status OutputStreamAdapter::Close() {
+  absl::MutexLock lock(&mutex_);
+  return stream_->Close();
+}
 
 }  // namespace tink
 }  // namespace crypto
@@ -17,7 +17,9 @@
 
 #include <memory>
 
+#include "absl/base/thread_annotations.h"
 #include "absl/strings/string_view.h"
+#include "absl/synchronization/mutex.h"
 #include "tink/output_stream.h"
 #include "tink/util/status.h"
 #include "tink/util/statusor.h"
@@ -25,7 +27,8 @@
 namespace crypto {
 namespace tink {
 
-// Adapts an OutputStream for use in Python.
+// Adapts an OutputStream for use in Python. Thread-safe, so that the bindings
+// can call it without holding the GIL.
 class OutputStreamAdapter {
  public:
   explicit OutputStreamAdapter(std::unique_ptr<OutputStream> stream)
@@ -42,7 +45,8 @@ class OutputStreamAdapter {
   util::Status Close();
 
  private:
-  std::unique_ptr<OutputStream> stream_;
+  absl::Mutex mutex_;
+  std::unique_ptr<OutputStream> stream_ ABSL_GUARDED_BY(mutex_);
 };
 
 }  // namespace tink
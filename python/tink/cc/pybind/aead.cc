@@ -16,8 +16,15 @@
 
 #include "tink/aead.h"
 
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
 #include "pybind11/pybind11.h"
+#include "tink/util/status.h"
 #include "tink/util/statusor.h"
+#include "tink/cc/pybind/buffer_view.h"
+#include "tink/cc/pybind/packed_values.h"
 #include "tink/cc/pybind/status_casters.h"
 
 namespace crypto {
@@ -38,31 +45,131 @@ void PybindRegisterAead(pybind11::module* module) {
 
       .def(
           "encrypt",
-          [](const Aead& self, const py::bytes& plaintext,
-             const py::bytes& associated_data) -> util::StatusOr<py::bytes> {
-            // TODO(b/145925674)
-            return self.Encrypt(std::string(plaintext),
-                                std::string(associated_data));
+          [](const Aead& self, const py::buffer& plaintext,
+             const py::buffer& associated_data) -> util::StatusOr<py::bytes> {
+            BufferView plaintext_view(plaintext);
+            BufferView associated_data_view(associated_data);
+            util::StatusOr<std::string> result;
+            {
+              py::gil_scoped_release release;
+              result = self.Encrypt(plaintext_view.data(),
+                                    associated_data_view.data());
+            }
+            if (!result.ok()) return result.status();
+            return py::bytes(result.ValueOrDie());
           },
           py::arg("plaintext"), py::arg("associated_data"),
           "Encrypts 'plaintext' with 'associated_data' as associated data, "
           "and returns the resulting ciphertext. "
           "The ciphertext allows for checking authenticity and integrity "
           "of the associated data, but does not guarantee its secrecy.")
+      .def(
+          "encrypt_into",
+          [](const Aead& self, const py::buffer& plaintext,
+             const py::buffer& associated_data,
+             const py::buffer& output) -> util::StatusOr<int64_t> {
+            BufferView plaintext_view(plaintext);
+            BufferView associated_data_view(associated_data);
+            BufferView output_view(output, /*writable=*/true);
+            py::gil_scoped_release release;
+            return self.EncryptInto(plaintext_view.data(),
+                                    associated_data_view.data(),
+                                    output_view.mutable_data());
+          },
+          py::arg("plaintext"), py::arg("associated_data"), py::arg("output"),
+          "Like encrypt(), but writes the ciphertext to the start of the "
+          "writable buffer 'output', e.g. a preallocated bytearray, and "
+          "returns the number of bytes written. 'output' must not overlap "
+          "with the inputs.")
       .def(
           "decrypt",
-          [](const Aead& self, const py::bytes& ciphertext,
-             const py::bytes& associated_data) -> util::StatusOr<py::bytes> {
-            // TODO(b/145925674)
-            return self.Decrypt(std::string(ciphertext),
-                                std::string(associated_data));
+          [](const Aead& self, const py::buffer& ciphertext,
+             const py::buffer& associated_data) -> util::StatusOr<py::bytes> {
+            BufferView ciphertext_view(ciphertext);
+            BufferView associated_data_view(associated_data);
+            util::StatusOr<std::string> result;
+            {
+              py::gil_scoped_release release;
+              result = self.Decrypt(ciphertext_view.data(),
+                                    associated_data_view.data());
+            }
+            if (!result.ok()) return result.status();
+            return py::bytes(result.ValueOrDie());
           },
           py::arg("ciphertext"), py::arg("associated_data"),
           "Decrypts 'ciphertext' with 'associated_data' as associated data, "
           "and returns the resulting plaintext. "
           "The decryption verifies the authenticity and integrity "
           "of the associated data, but there are no guarantees wrt. secrecy "
-          "of that data.");
+          "of that data.")
+      .def(
+          "encrypt_batch",
+          [](const Aead& self, const py::buffer& plaintexts,
+             const py::buffer& offsets, const py::buffer& associated_data,
+             const py::bytes& output_prefix) -> util::StatusOr<py::tuple> {
+            auto plaintexts_view_result =
+                PackedValuesView::New(plaintexts, offsets);
+            if (!plaintexts_view_result.ok()) {
+              return plaintexts_view_result.status();
+            }
+            PackedValuesView& plaintexts_view =
+                *plaintexts_view_result.ValueOrDie();
+            BufferView associated_data_view(associated_data);
+            std::string prefix = output_prefix;
+            std::string arena;
+            std::vector<absl::string_view> ciphertexts;
+            util::Status status;
+            {
+              py::gil_scoped_release release;
+              status = self.BatchEncrypt(
+                  plaintexts_view.PairedWith(associated_data_view.data()),
+                  &arena, &ciphertexts);
+            }
+            if (!status.ok()) return status;
+            return PackValues(prefix, ciphertexts);
+          },
+          py::arg("plaintexts"), py::arg("offsets"),
+          py::arg("associated_data"), py::arg("output_prefix") = py::bytes(),
+          "Encrypts the packed 'plaintexts', where plaintext i is "
+          "plaintexts[offsets[i]:offsets[i + 1]] and 'offsets' is a buffer "
+          "of int64, each with 'associated_data', in one call with the GIL "
+          "released. Returns the ciphertexts, each prefixed with "
+          "'output_prefix', packed as a tuple (data, offsets).")
+      .def(
+          "decrypt_batch",
+          [](const Aead& self, const py::buffer& ciphertexts,
+             const py::buffer& offsets, const py::buffer& associated_data,
+             const py::bytes& input_prefix) -> util::StatusOr<py::tuple> {
+            auto ciphertexts_view_result =
+                PackedValuesView::New(ciphertexts, offsets);
+            if (!ciphertexts_view_result.ok()) {
+              return ciphertexts_view_result.status();
+            }
+            PackedValuesView& ciphertexts_view =
+                *ciphertexts_view_result.ValueOrDie();
+            BufferView associated_data_view(associated_data);
+            util::Status status =
+                ciphertexts_view.RemovePrefix(std::string(input_prefix));
+            if (!status.ok()) return status;
+            std::string arena;
+            std::vector<absl::string_view> plaintexts;
+            {
+              py::gil_scoped_release release;
+              status = self.BatchDecrypt(
+                  ciphertexts_view.PairedWith(associated_data_view.data()),
+                  &arena, &plaintexts);
+            }
+            if (!status.ok()) return status;
+            return PackValues("", plaintexts);
+          },
+          py::arg("ciphertexts"), py::arg("offsets"),
+          py::arg("associated_data"), py::arg("input_prefix") = py::bytes(),
+          "Decrypts the packed 'ciphertexts', laid out as for "
+          "encrypt_batch(), each with 'associated_data', in one call with "
+          "the GIL released. Every ciphertext must start with "
+          "'input_prefix', which is removed before decryption. Returns the "
+          "plaintexts packed as a tuple (data, offsets), and fails if any "
+          "decryption fails.");
 }
 
 }  // namespace tink
@@ -0,0 +1,72 @@
+// Copyright 2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef TINK_PYTHON_TINK_CC_PYBIND_BUFFER_VIEW_H_
+#define TINK_PYTHON_TINK_CC_PYBIND_BUFFER_VIEW_H_
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "pybind11/pybind11.h"
+
+namespace crypto {
+namespace tink {
+
+// The contiguous bytes of a Python object supporting the buffer protocol,
+// such as bytes, bytearray or memoryview, without a copy. The exporter may
+// not resize or free the bytes while the view exists, so the view can be used
+// after releasing the GIL. Constructing and destroying a view requires the
+// GIL, so it has to outlive any pybind11::gil_scoped_release using it:
+//
+//   BufferView data_view(data);
+//   util::StatusOr<std::string> result;
+//   {
+//     pybind11::gil_scoped_release release;
+//     result = mac.ComputeMac(data_view.data());
+//   }
+class BufferView {
+ public:
+  // Raises BufferError, via pybind11::error_already_set, if 'buffer' is not
+  // contiguous, or if 'writable' is set and 'buffer' is read-only.
+  explicit BufferView(const pybind11::buffer& buffer, bool writable = false) {
+    int flags = PyBUF_SIMPLE | (writable ? PyBUF_WRITABLE : 0);
+    if (PyObject_GetBuffer(buffer.ptr(), &view_, flags) != 0) {
+      throw pybind11::error_already_set();
+    }
+  }
+
+  BufferView(const BufferView&) = delete;
+  BufferView& operator=(const BufferView&) = delete;
+
+  ~BufferView() { PyBuffer_Release(&view_); }
+
+  absl::string_view data() const {
+    return absl::string_view(static_cast<const char*>(view_.buf),
+                             view_.len);
+  }
+
+  // Requires the view to be writable.
+  absl::Span<char> mutable_data() {
+    return absl::Span<char>(static_cast<char*>(view_.buf), view_.len);
+  }
+
+ private:
+  Py_buffer view_;
+};
+
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_PYTHON_TINK_CC_PYBIND_BUFFER_VIEW_H_
@@ -87,6 +87,35 @@ class AeadKeyManagerTest(absltest.TestCase):
     ciphertext = primitive.encrypt(plaintext, associated_data)
     self.assertEqual(primitive.decrypt(ciphertext, associated_data), plaintext)
 
+  def test_encrypt_decrypt_buffers(self):
+    key_template = self.new_aes_eax_key_template(12, 16)
+    key_data = self.key_manager.new_key_data(key_template)
+
+    primitive = self.key_manager.primitive(key_data)
+    plaintext = bytearray(b'plaintext')
+    associated_data = memoryview(b'xassociated_data')[1:]
+    ciphertext = primitive.encrypt(plaintext, associated_data)
+    self.assertEqual(
+        primitive.decrypt(memoryview(ciphertext), b'associated_data'),
+        b'plaintext')
+    with self.assertRaises(TypeError):
+      primitive.encrypt(u'plaintext', b'associated_data')
+
+  def test_encrypt_into(self):
+    key_template = self.new_aes_eax_key_template(12, 16)
+    key_data = self.key_manager.new_key_data(key_template)
+
+    primitive = self.key_manager.primitive(key_data)
+    output = bytearray(100)
+    size = primitive.encrypt_into(b'plaintext', b'associated_data', output)
+    self.assertEqual(
+        primitive.decrypt(memoryview(output)[:size], b'associated_data'),
+        b'plaintext')
+    with self.assertRaises(tink_bindings.StatusNotOk):
+      primitive.encrypt_into(b'plaintext', b'associated_data', bytearray(10))
+    with self.assertRaises(BufferError):
+      primitive.encrypt_into(b'plaintext', b'associated_data', bytes(100))
+
 
 class DeterministicAeadKeyManagerTest(absltest.TestCase):
 
@@ -245,6 +274,7 @@ class MacKeyManagerTest(absltest.TestCase):
     self.assertLen(tag, 24)
     # No exception raised.
     mac.verify_mac(tag, data)
+    mac.verify_mac(memoryview(tag), bytearray(data))
 
   def test_mac_wrong(self):
     mac = self.key_manager.primitive(
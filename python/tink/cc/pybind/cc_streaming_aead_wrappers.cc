@@ -53,6 +53,25 @@ void PybindRegisterCcStreamingAeadWrappers(pybind11::module* module) {
       py::arg("primitive"), py::arg("aad"), py::arg("source"),
       // Keep source alive at least as long as InputStreamAdapter.
       py::keep_alive<0, 3>());
+
+  m.def(
+      "new_cc_encrypting_stream_from_fd",
+      [](StreamingAead* streaming_aead, const py::bytes& aad,
+         int destination_fd)
+          -> util::StatusOr<std::unique_ptr<OutputStreamAdapter>> {
+        return NewCcEncryptingStreamFromFd(streaming_aead, std::string(aad),
+                                           destination_fd);
+      },
+      py::arg("primitive"), py::arg("aad"), py::arg("destination_fd"));
+
+  m.def(
+      "new_cc_decrypting_stream_from_fd",
+      [](StreamingAead* streaming_aead, const py::bytes& aad, int source_fd)
+          -> util::StatusOr<std::unique_ptr<InputStreamAdapter>> {
+        return NewCcDecryptingStreamFromFd(streaming_aead, std::string(aad),
+                                           source_fd);
+      },
+      py::arg("primitive"), py::arg("aad"), py::arg("source_fd"));
 }
 
 }  // namespace tink
@@ -16,8 +16,15 @@
 
 #include "tink/deterministic_aead.h"
 
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
 #include "pybind11/pybind11.h"
+#include "tink/util/status.h"
 #include "tink/util/statusor.h"
+#include "tink/cc/pybind/buffer_view.h"
+#include "tink/cc/pybind/packed_values.h"
 #include "tink/cc/pybind/status_casters.h"
 
 namespace crypto {
@@ -51,22 +58,93 @@ void PybindRegisterDeterministicAead(pybind11::module* module) {
 
       .def(
           "encrypt_deterministically",
-          [](const DeterministicAead& self, const py::bytes& plaintext,
-             const py::bytes& associated_data) -> util::StatusOr<py::bytes> {
-            // TODO(b/145925674)
-            return self.EncryptDeterministically(std::string(plaintext),
-                                                 std::string(associated_data));
+          [](const DeterministicAead& self, const py::buffer& plaintext,
+             const py::buffer& associated_data) -> util::StatusOr<py::bytes> {
+            BufferView plaintext_view(plaintext);
+            BufferView associated_data_view(associated_data);
+            util::StatusOr<std::string> result;
+            {
+              py::gil_scoped_release release;
+              result = self.EncryptDeterministically(
+                  plaintext_view.data(), associated_data_view.data());
+            }
+            if (!result.ok()) return result.status();
+            return py::bytes(result.ValueOrDie());
           },
           py::arg("plaintext"), py::arg("associated_data"))
       .def(
           "decrypt_deterministically",
-          [](const DeterministicAead& self, const py::bytes& ciphertext,
-             const py::bytes& associated_data) -> util::StatusOr<py::bytes> {
-            // TODO(b/145925674)
-            return self.DecryptDeterministically(std::string(ciphertext),
-                                                 std::string(associated_data));
+          [](const DeterministicAead& self, const py::buffer& ciphertext,
+             const py::buffer& associated_data) -> util::StatusOr<py::bytes> {
+            BufferView ciphertext_view(ciphertext);
+            BufferView associated_data_view(associated_data);
+            util::StatusOr<std::string> result;
+            {
+              py::gil_scoped_release release;
+              result = self.DecryptDeterministically(
+                  ciphertext_view.data(), associated_data_view.data());
+            }
+            if (!result.ok()) return result.status();
+            return py::bytes(result.ValueOrDie());
+          },
+          py::arg("ciphertext"), py::arg("associated_data"))
+      .def(
+          "encrypt_deterministically_batch",
+          [](const DeterministicAead& self, const py::buffer& plaintexts,
+             const py::buffer& offsets, const py::buffer& associated_data,
+             const py::bytes& output_prefix) -> util::StatusOr<py::tuple> {
+            auto plaintexts_view_result =
+                PackedValuesView::New(plaintexts, offsets);
+            if (!plaintexts_view_result.ok()) {
+              return plaintexts_view_result.status();
+            }
+            PackedValuesView& plaintexts_view =
+                *plaintexts_view_result.ValueOrDie();
+            BufferView associated_data_view(associated_data);
+            std::string prefix = output_prefix;
+            std::string arena;
+            std::vector<absl::string_view> ciphertexts;
+            util::Status status;
+            {
+              py::gil_scoped_release release;
+              status = self.EncryptDeterministicallyBatch(
+                  plaintexts_view.PairedWith(associated_data_view.data()),
+                  &arena, &ciphertexts);
+            }
+            if (!status.ok()) return status;
+            return PackValues(prefix, ciphertexts);
+          },
+          py::arg("plaintexts"), py::arg("offsets"),
+          py::arg("associated_data"), py::arg("output_prefix") = py::bytes())
+      .def(
+          "decrypt_deterministically_batch",
+          [](const DeterministicAead& self, const py::buffer& ciphertexts,
+             const py::buffer& offsets, const py::buffer& associated_data,
+             const py::bytes& input_prefix) -> util::StatusOr<py::tuple> {
+            auto ciphertexts_view_result =
+                PackedValuesView::New(ciphertexts, offsets);
+            if (!ciphertexts_view_result.ok()) {
+              return ciphertexts_view_result.status();
+            }
+            PackedValuesView& ciphertexts_view =
+                *ciphertexts_view_result.ValueOrDie();
+            BufferView associated_data_view(associated_data);
+            util::Status status =
+                ciphertexts_view.RemovePrefix(std::string(input_prefix));
+            if (!status.ok()) return status;
+            std::string arena;
+            std::vector<absl::string_view> plaintexts;
+            {
+              py::gil_scoped_release release;
+              status = self.DecryptDeterministicallyBatch(
+                  ciphertexts_view.PairedWith(associated_data_view.data()),
+                  &arena, &plaintexts);
+            }
+            if (!status.ok()) return status;
+            return PackValues("", plaintexts);
           },
-          py::arg("ciphertext"), py::arg("associated_data"));
+          py::arg("ciphertexts"), py::arg("offsets"),
+          py::arg("associated_data"), py::arg("input_prefix") = py::bytes());
 }
 
 }  // namespace tink
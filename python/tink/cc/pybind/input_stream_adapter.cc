@@ -16,7 +16,10 @@
 
 #include "tink/cc/input_stream_adapter.h"
 
+#include <string>
+
 #include "pybind11/pybind11.h"
+#include "tink/cc/pybind/buffer_view.h"
 #include "tink/cc/pybind/status_casters.h"
 
 namespace crypto {
@@ -26,14 +29,32 @@ void PybindRegisterInputStreamAdapter(pybind11::module* module) {
   namespace py = pybind11;
   py::module& m = *module;
 
-
+  // The GIL is released while decrypting; the underlying PythonInputStream
+  // reacquires it to read the ciphertext.
   // TODO(b/146492561): Reduce the number of complicated lambdas.
   py::class_<InputStreamAdapter>(m, "InputStreamAdapter")
       .def(
           "read",
-          [](InputStreamAdapter *self, int64_t size)
-              -> util::StatusOr<py::bytes> { return self->Read(size); },
-          py::arg("size"));
+          [](InputStreamAdapter *self,
+             int64_t size) -> util::StatusOr<py::bytes> {
+            util::StatusOr<std::string> result;
+            {
+              py::gil_scoped_release release;
+              result = self->Read(size);
+            }
+            if (!result.ok()) return result.status();
+            return py::bytes(result.ValueOrDie());
+          },
+          py::arg("size"))
+      .def(
+          "readinto",
+          [](InputStreamAdapter *self,
+             const py::buffer &buffer) -> util::StatusOr<int64_t> {
+            BufferView buffer_view(buffer, /*writable=*/true);
+            py::gil_scoped_release release;
+            return self->ReadInto(buffer_view.mutable_data());
+          },
+          py::arg("buffer"));
 }
 
 }  // namespace tink
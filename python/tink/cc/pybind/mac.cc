@@ -16,8 +16,16 @@
 
 #include "tink/mac.h"
 
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/string_view.h"
 #include "pybind11/pybind11.h"
 #include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "tink/cc/pybind/buffer_view.h"
+#include "tink/cc/pybind/packed_values.h"
 #include "tink/cc/pybind/status_casters.h"
 
 namespace crypto {
@@ -39,24 +47,97 @@ void PybindRegisterMac(pybind11::module* module) {
       .def(
           "compute_mac",
           [](const Mac& self,
-             const py::bytes& data) -> util::StatusOr<py::bytes> {
-            // TODO(b/145925674)
-            return self.ComputeMac(std::string(data));
+             const py::buffer& data) -> util::StatusOr<py::bytes> {
+            BufferView data_view(data);
+            util::StatusOr<std::string> result;
+            {
+              py::gil_scoped_release release;
+              result = self.ComputeMac(data_view.data());
+            }
+            if (!result.ok()) return result.status();
+            return py::bytes(result.ValueOrDie());
           },
           py::arg("data"),
           "Computes and returns the message authentication code (MAC) for "
           "'data'.")
       .def(
           "verify_mac",
-          [](const Mac& self, const py::bytes& mac,
-             const py::bytes& data) -> util::Status {
-            // TODO(b/145925674)
-            return self.VerifyMac(std::string(mac), std::string(data));
+          [](const Mac& self, const py::buffer& mac,
+             const py::buffer& data) -> util::Status {
+            BufferView mac_view(mac);
+            BufferView data_view(data);
+            py::gil_scoped_release release;
+            return self.VerifyMac(mac_view.data(), data_view.data());
           },
           py::arg("mac"), py::arg("data"),
           "Verifies if 'mac' is a correct authentication code (MAC) for "
           "'data'. "
-          "Raises a StatusNotOk exception if the verification fails.");
+          "Raises a StatusNotOk exception if the verification fails.")
+      .def(
+          "compute_mac_batch",
+          [](const Mac& self, const py::buffer& data,
+             const py::buffer& offsets) -> util::StatusOr<py::tuple> {
+            auto data_view_result = PackedValuesView::New(data, offsets);
+            if (!data_view_result.ok()) return data_view_result.status();
+            PackedValuesView& data_view = *data_view_result.ValueOrDie();
+            std::vector<std::string> macs;
+            macs.reserve(data_view.values().size());
+            {
+              py::gil_scoped_release release;
+              for (absl::string_view value : data_view.values()) {
+                util::StatusOr<std::string> result = self.ComputeMac(value);
+                if (!result.ok()) return result.status();
+                macs.push_back(std::move(result.ValueOrDie()));
+              }
+            }
+            return PackValues("", std::vector<absl::string_view>(
+                                      macs.begin(), macs.end()));
+          },
+          py::arg("data"), py::arg("offsets"),
+          "Computes the MACs of the packed 'data', where message i is "
+          "data[offsets[i]:offsets[i + 1]] and 'offsets' is a buffer of "
+          "int64, in one call with the GIL released. Returns the MACs "
+          "packed as a tuple (data, offsets).")
+      .def(
+          "verify_mac_batch",
+          [](const Mac& self, const py::buffer& macs,
+             const py::buffer& mac_offsets, const py::buffer& data,
+             const py::buffer& data_offsets) -> util::StatusOr<py::bytes> {
+            auto macs_view_result = PackedValuesView::New(macs, mac_offsets);
+            if (!macs_view_result.ok()) return macs_view_result.status();
+            PackedValuesView& macs_view = *macs_view_result.ValueOrDie();
+            auto data_view_result = PackedValuesView::New(data, data_offsets);
+            if (!data_view_result.ok()) return data_view_result.status();
+            PackedValuesView& data_view = *data_view_result.ValueOrDie();
+            const std::vector<absl::string_view>& mac_values =
+                macs_view.values();
+            const std::vector<absl::string_view>& data_values =
+                data_view.values();
+            if (mac_values.size() != data_values.size()) {
+              return util::Status(util::error::INVALID_ARGUMENT,
+                                  "macs and data have different lengths");
+            }
+            std::string valid(mac_values.size(), '\0');
+            {
+              py::gil_scoped_release release;
+              std::vector<std::pair<absl::string_view, absl::string_view>>
+                  inputs;
+              inputs.reserve(mac_values.size());
+              for (size_t i = 0; i < mac_values.size(); i++) {
+                inputs.emplace_back(mac_values[i], data_values[i]);
+              }
+              std::vector<util::Status> results = self.BatchVerifyMac(inputs);
+              for (size_t i = 0; i < results.size(); i++) {
+                valid[i] = results[i].ok() ? 1 : 0;
+              }
+            }
+            return py::bytes(valid);
+          },
+          py::arg("macs"), py::arg("mac_offsets"), py::arg("data"),
+          py::arg("data_offsets"),
+          "Verifies the packed 'macs' against the packed 'data' in one call "
+          "with the GIL released. Returns one byte per pair, which is 1 if "
+          "the MAC is valid and 0 otherwise.");
 }
 
 }  // namespace tink
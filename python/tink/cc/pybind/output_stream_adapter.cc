@@ -17,6 +17,7 @@
 #include "tink/cc/output_stream_adapter.h"
 
 #include "pybind11/pybind11.h"
+#include "tink/cc/pybind/buffer_view.h"
 #include "tink/cc/pybind/status_casters.h"
 
 namespace crypto {
@@ -26,16 +27,21 @@ void PybindRegisterOutputStreamAdapter(pybind11::module* module) {
   namespace py = pybind11;
   py::module& m = *module;
 
+  // The GIL is released while encrypting; the underlying PythonOutputStream
+  // reacquires it to write the ciphertext.
   // TODO(b/146492561): Reduce the number of complicated lambdas.
   py::class_<OutputStreamAdapter>(m, "OutputStreamAdapter")
       .def(
           "write",
           [](OutputStreamAdapter* self,
-             const py::bytes& data) -> util::StatusOr<int64_t> {
-            return self->Write(std::string(data));
+             const py::buffer& data) -> util::StatusOr<int64_t> {
+            BufferView data_view(data);
+            py::gil_scoped_release release;
+            return self->Write(data_view.data());
           },
           py::arg("data"))
-      .def("close", &OutputStreamAdapter::Close);
+      .def("close", &OutputStreamAdapter::Close,
+           py::call_guard<py::gil_scoped_release>());
 }
 
 }  // namespace tink
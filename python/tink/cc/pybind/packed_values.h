@@ -0,0 +1,161 @@
+// Copyright 2021 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+
+#ifndef TINK_PYTHON_TINK_CC_PYBIND_PACKED_VALUES_H_
+#define TINK_PYTHON_TINK_CC_PYBIND_PACKED_VALUES_H_
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/match.h"
+#include "absl/strings/string_view.h"
+#include "pybind11/pybind11.h"
+#include "tink/util/status.h"
+#include "tink/util/statusor.h"
+#include "tink/cc/pybind/buffer_view.h"
+
+namespace crypto {
+namespace tink {
+
+// A batch of byte strings packed into one contiguous buffer, in the layout
+// used by Arrow binary arrays: value i is data[offsets[i]:offsets[i + 1]],
+// where 'offsets' is a one-dimensional buffer of n + 1 64-bit integers, such
+// as a numpy.int64 array or the offsets buffer of a pyarrow.large_binary
+// array. Like BufferView, the views stay valid after releasing the GIL, and
+// constructing and destroying a PackedValuesView requires the GIL.
+class PackedValuesView {
+ public:
+  // Fails with INVALID_ARGUMENT if 'offsets' is not a buffer of 64-bit
+  // integers, is empty, decreases, or points outside of 'data'. Raises
+  // BufferError, like BufferView, if 'data' is not contiguous.
+  static util::StatusOr<std::unique_ptr<PackedValuesView>> New(
+      const pybind11::buffer& data, const pybind11::buffer& offsets) {
+    std::unique_ptr<PackedValuesView> view(new PackedValuesView(data));
+    pybind11::buffer_info info = offsets.request();
+    std::string format = info.format;
+    if (!format.empty() &&
+        (format[0] == '@' || format[0] == '=' || format[0] == '<')) {
+      format = format.substr(1);
+    }
+    if (info.ndim != 1 || info.itemsize != 8 ||
+        (format != "q" && format != "l")) {
+      return util::Status(util::error::INVALID_ARGUMENT,
+                          "offsets must be a buffer of int64");
+    }
+    if (info.shape[0] < 1) {
+      return util::Status(util::error::INVALID_ARGUMENT,
+                          "offsets must have at least one entry");
+    }
+    absl::string_view all = view->data_.data();
+    const char* base = static_cast<const char*>(info.ptr);
+    int64_t previous = 0;
+    view->values_.reserve(info.shape[0] - 1);
+    for (ssize_t i = 0; i < info.shape[0]; i++) {
+      int64_t offset;
+      std::memcpy(&offset, base + i * info.strides[0], sizeof(offset));
+      if (offset < previous || offset > static_cast<int64_t>(all.size())) {
+        return util::Status(util::error::INVALID_ARGUMENT,
+                            "offsets out of range");
+      }
+      if (i > 0) {
+        view->values_.push_back(all.substr(previous, offset - previous));
+      }
+      previous = offset;
+    }
+    return std::move(view);
+  }
+
+  PackedValuesView(const PackedValuesView&) = delete;
+  PackedValuesView& operator=(const PackedValuesView&) = delete;
+
+  const std::vector<absl::string_view>& values() const { return values_; }
+
+  // Removes 'prefix' from every value. Fails if a value does not start with
+  // 'prefix', in which case the values are left partially stripped.
+  util::Status RemovePrefix(absl::string_view prefix) {
+    for (absl::string_view& value : values_) {
+      if (!absl::ConsumePrefix(&value, prefix)) {
+        return util::Status(util::error::INVALID_ARGUMENT,
+                            "value does not start with the expected prefix");
+      }
+    }
+    return util::OkStatus();
+  }
+
+  // Returns the pairs (value, associated_data) for the batch APIs of Aead
+  // and DeterministicAead.
+  std::vector<std::pair<absl::string_view, absl::string_view>> PairedWith(
+      absl::string_view associated_data) const {
+    std::vector<std::pair<absl::string_view, absl::string_view>> pairs;
+    pairs.reserve(values_.size());
+    for (absl::string_view value : values_) {
+      pairs.emplace_back(value, associated_data);
+    }
+    return pairs;
+  }
+
+ private:
+  explicit PackedValuesView(const pybind11::buffer& data) : data_(data) {}
+
+  BufferView data_;
+  std::vector<absl::string_view> values_;
+};
+
+// Packs 'values', each preceded by 'prefix', into a tuple (data, offsets) in
+// the layout read by PackedValuesView: 'data' is a bytes object and
+// 'offsets' is a memoryview of n + 1 int64 values, which numpy.frombuffer()
+// and pyarrow.py_buffer() accept without a copy. Requires the GIL, but
+// copies the values with the GIL released.
+inline pybind11::tuple PackValues(
+    absl::string_view prefix, const std::vector<absl::string_view>& values) {
+  namespace py = pybind11;
+  std::vector<int64_t> offsets;
+  offsets.reserve(values.size() + 1);
+  offsets.push_back(0);
+  for (absl::string_view value : values) {
+    offsets.push_back(offsets.back() + prefix.size() + value.size());
+  }
+  py::bytes data = py::reinterpret_steal<py::bytes>(
+      PyBytes_FromStringAndSize(nullptr, offsets.back()));
+  py::bytes offsets_bytes = py::reinterpret_steal<py::bytes>(
+      PyBytes_FromStringAndSize(reinterpret_cast<const char*>(offsets.data()),
+                                offsets.size() * sizeof(int64_t)));
+  if (!data || !offsets_bytes) throw py::error_already_set();
+  char* out = PyBytes_AS_STRING(data.ptr());
+  {
+    py::gil_scoped_release release;
+    for (absl::string_view value : values) {
+      if (!prefix.empty()) std::memcpy(out, prefix.data(), prefix.size());
+      out += prefix.size();
+      if (!value.empty()) std::memcpy(out, value.data(), value.size());
+      out += value.size();
+    }
+  }
+  py::object offsets_view = py::reinterpret_steal<py::object>(
+      PyMemoryView_FromObject(offsets_bytes.ptr()));
+  if (!offsets_view) throw py::error_already_set();
+  return py::make_tuple(data, offsets_view.attr("cast")("q"));
+}
+
+}  // namespace tink
+}  // namespace crypto
+
+#endif  // TINK_PYTHON_TINK_CC_PYBIND_PACKED_VALUES_H_
@@ -16,9 +16,14 @@
 
 #include "tink/cc/pybind/prf.h"
 
+#include <string>
+
 #include "pybind11/pybind11.h"
 #include "tink/prf/prf_set.h"
+#include "tink/util/status.h"
 #include "tink/util/statusor.h"
+#include "tink/cc/pybind/buffer_view.h"
+#include "tink/cc/pybind/packed_values.h"
 #include "tink/cc/pybind/status_casters.h"
 
 namespace crypto {
@@ -33,13 +38,42 @@ void PybindRegisterPrf(pybind11::module* module) {
       // only need the function "compute_primary".
       .def(
           "compute",
-          [](const Prf& self, const py::bytes& input_data,
+          [](const Prf& self, const py::buffer& input_data,
              size_t output_length) -> util::StatusOr<py::bytes> {
-            // TODO(b/145925674)
-            return self.Compute(std::string(input_data), output_length);
+            BufferView input_data_view(input_data);
+            util::StatusOr<std::string> result;
+            {
+              py::gil_scoped_release release;
+              result = self.Compute(input_data_view.data(), output_length);
+            }
+            if (!result.ok()) return result.status();
+            return py::bytes(result.ValueOrDie());
           },
           py::arg("input_data"), py::arg("output_length"),
-          "Computes the value of the primary (and only) PRF.");
+          "Computes the value of the primary (and only) PRF.")
+      .def(
+          "compute_batch",
+          [](const Prf& self, const py::buffer& inputs,
+             const py::buffer& offsets,
+             size_t output_length) -> util::StatusOr<py::bytes> {
+            auto inputs_view_result = PackedValuesView::New(inputs, offsets);
+            if (!inputs_view_result.ok()) return inputs_view_result.status();
+            PackedValuesView& inputs_view = *inputs_view_result.ValueOrDie();
+            std::string output;
+            util::Status status;
+            {
+              py::gil_scoped_release release;
+              status = self.ComputeBatch(inputs_view.values(), output_length,
+                                         &output);
+            }
+            if (!status.ok()) return status;
+            return py::bytes(output);
+          },
+          py::arg("inputs"), py::arg("offsets"), py::arg("output_length"),
+          "Computes the PRF on the packed 'inputs', where input i is "
+          "inputs[offsets[i]:offsets[i + 1]] and 'offsets' is a buffer of "
+          "int64, in one call with the GIL released. Returns the outputs "
+          "back-to-back: the one for input i starts at i * output_length.");
 }
 
 }  // namespace tink
@@ -16,8 +16,11 @@
 
 #include "tink/public_key_sign.h"
 
+#include <string>
+
 #include "pybind11/pybind11.h"
 #include "tink/util/statusor.h"
+#include "tink/cc/pybind/buffer_view.h"
 #include "tink/cc/pybind/status_casters.h"
 
 namespace crypto {
@@ -42,9 +45,15 @@ void PybindRegisterPublicKeySign(pybind11::module* module) {
       .def(
           "sign",
           [](const PublicKeySign& self,
-             const py::bytes& data) -> util::StatusOr<py::bytes> {
-            // TODO(b/145925674)
-            return self.Sign(std::string(data));
+             const py::buffer& data) -> util::StatusOr<py::bytes> {
+            BufferView data_view(data);
+            util::StatusOr<std::string> result;
+            {
+              py::gil_scoped_release release;
+              result = self.Sign(data_view.data());
+            }
+            if (!result.ok()) return result.status();
+            return py::bytes(result.ValueOrDie());
           },
           py::arg("data"), "Computes the signature for 'data'.");
 }
@@ -80,7 +80,7 @@ class Pybind11PythonFileObjectAdapter : public PythonFileObjectAdapter {
   util::StatusOr<int> Write(absl::string_view data) override{
       PYBIND11_OVERLOAD_PURE_STATUSOR_RETURN(
           int, PythonFileObjectAdapter, "write",
-          pybind11::bytes(std::string(data)))}
+          pybind11::bytes(data.data(), data.size()))}
 
   util::Status Close() override{
       PYBIND11_OVERLOAD_PURE_STATUS_RETURN(PythonFileObjectAdapter, "close")}
@@ -89,6 +89,34 @@ class Pybind11PythonFileObjectAdapter : public PythonFileObjectAdapter {
     PYBIND11_OVERLOAD_PURE_STATUSOR_RETURN(std::string, PythonFileObjectAdapter,
                                            "read", size)
   }
+
+  // Passes 'buffer' to the Python readinto() as a memoryview, so that the
+  // bytes are written into it without an intermediate bytes object. Falls
+  // back to Read() if readinto() is not overridden.
+  util::StatusOr<int> ReadInto(absl::Span<char> buffer) override {
+    try {
+      pybind11::gil_scoped_acquire gil;
+      pybind11::function overload = pybind11::get_overload(
+          static_cast<const PythonFileObjectAdapter *>(this), "readinto");
+      if (!overload) return PythonFileObjectAdapter::ReadInto(buffer);
+      auto memory = pybind11::reinterpret_steal<pybind11::object>(
+          PyMemoryView_FromMemory(buffer.data(), buffer.size(), PyBUF_WRITE));
+      if (!memory) throw pybind11::error_already_set();
+      auto o = overload(memory);
+      // Python code must not access the buffer after readinto() returns.
+      memory.attr("release")();
+      int count = o.cast<int>();
+      if (count < 0 || static_cast<size_t>(count) > buffer.size()) {
+        return util::Status(util::error::INTERNAL,
+                            "readinto returned an invalid number of bytes.");
+      }
+      return count;
+    } catch (const std::exception &e) {
+      return util::Status(util::error::UNKNOWN, e.what());
+    } catch (...) {
+      std::abort();
+    }
+  }
 };
 
 void PybindRegisterPythonFileObjectAdapter(pybind11::module* module) {
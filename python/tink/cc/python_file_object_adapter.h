@@ -15,7 +15,11 @@
 #ifndef TINK_PYTHON_CC_PYTHON_FILE_OBJECT_ADAPTER_H_
 #define TINK_PYTHON_CC_PYTHON_FILE_OBJECT_ADAPTER_H_
 
+#include <cstring>
+#include <string>
+
 #include "absl/strings/string_view.h"
+#include "absl/types/span.h"
 #include "tink/util/status.h"
 #include "tink/util/statusor.h"
 
@@ -38,6 +42,20 @@ class PythonFileObjectAdapter {
   // object is alreday at EOF.
   virtual util::StatusOr<std::string> Read(int size) = 0;
 
+  // Like Read(), but reads at most 'buffer.size()' bytes into 'buffer' and
+  // returns their number. The default implementation calls Read() and copies
+  // the result.
+  virtual util::StatusOr<int> ReadInto(absl::Span<char> buffer) {
+    auto read_result = Read(buffer.size());
+    if (!read_result.ok()) return read_result.status();
+    const std::string& data = read_result.ValueOrDie();
+    if (data.size() > buffer.size()) {
+      return util::Status(util::error::INTERNAL, "read returned too many bytes");
+    }
+    std::memcpy(buffer.data(), data.data(), data.size());
+    return data.size();
+  }
+
   virtual ~PythonFileObjectAdapter() {}
 };
 
@@ -19,6 +19,7 @@
 #include <string>
 
 #include "absl/memory/memory.h"
+#include "absl/types/span.h"
 #include "tink/input_stream.h"
 #include "tink/subtle/subtle_util.h"
 #include "tink/util/status.h"
@@ -39,7 +40,7 @@ bool is_eof(const util::Status& status) {
 
 PythonInputStream::PythonInputStream(
     std::shared_ptr<PythonFileObjectAdapter> adapter, int buffer_size) {
-  if (buffer_size <= 0) buffer_size = 128 * 1024;  // 128 KB
+  if (buffer_size <= 0) buffer_size = 1024 * 1024;  // 1 MB
   adapter_ = adapter;
   count_in_buffer_ = 0;
   count_backedup_ = 0;
@@ -62,7 +63,8 @@ util::StatusOr<int> PythonInputStream::Next(const void** data) {
   }
 
   // Read new bytes to buffer_.
-  auto read_result = adapter_->Read(buffer_.size());
+  auto read_result =
+      adapter_->ReadInto(absl::MakeSpan(&buffer_[0], buffer_.size()));
   if (is_eof(read_result.status())) {
     return status_ = util::Status(util::error::OUT_OF_RANGE, "EOF");
   } else if (read_result.status().error_code() == util::error::OUT_OF_RANGE) {
@@ -73,9 +75,7 @@ util::StatusOr<int> PythonInputStream::Next(const void** data) {
   } else if (!read_result.ok()) {
     return status_ = read_result.status();
   }
-  std::string read_string = read_result.ValueOrDie();
-  int count_read = read_string.length();
-  buffer_.replace(0, count_read, read_string);
+  int count_read = read_result.ValueOrDie();
   buffer_offset_ = 0;
   count_backedup_ = 0;
   count_in_buffer_ = count_read;
@@ -30,7 +30,7 @@ namespace tink {
 
 PythonOutputStream::PythonOutputStream(
     std::shared_ptr<PythonFileObjectAdapter> adapter, int buffer_size) {
-  if (buffer_size <= 0) buffer_size = 128 * 1024;  // 128 KB
+  if (buffer_size <= 0) buffer_size = 1024 * 1024;  // 1 MB
   adapter_ = adapter;
   subtle::ResizeStringUninitialized(&buffer_, buffer_size);
   is_first_call_ = true;
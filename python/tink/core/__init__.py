@@ -21,6 +21,7 @@ from __future__ import print_function
 from tink.proto import tink_pb2
 from tink.core import _crypto_format
 from tink.core import _key_manager
+from tink.core import _packed_values
 from tink.core import _primitive_set
 from tink.core import _primitive_wrapper
 from tink.core import _registry
@@ -43,3 +44,4 @@ PrimitiveSet = _primitive_set.PrimitiveSet
 PrimitiveWrapper = _primitive_wrapper.PrimitiveWrapper
 
 crypto_format = _crypto_format
+packed_values = _packed_values
@@ -0,0 +1,71 @@
+# Copyright 2021 Google LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Helpers for batches of byte strings packed into one buffer.
+
+A packed batch is a pair (data, offsets), where value i is
+data[offsets[i]:offsets[i + 1]] and offsets holds n + 1 64-bit integers. This
+is the layout of Arrow large_binary arrays, so NumPy and Arrow data can be
+passed to the batch methods of the primitives without a copy per value.
+"""
+
+from __future__ import absolute_import
+from __future__ import division
+# Placeholder for import for type annotations
+from __future__ import print_function
+
+import array
+from typing import Any, List, Sequence, Tuple
+
+from tink.core import _tink_error
+
+
+def unpack(data: Any, offsets: Any) -> List[bytes]:
+  """Returns the values of the packed batch (data, offsets) as a list.
+
+  Args:
+    data: A bytes-like object holding the values back-to-back.
+    offsets: A sequence or buffer of n + 1 non-decreasing integers.
+  Returns:
+    the n values, as bytes.
+  Raises:
+    tink.TinkError if the offsets do not describe slices of data.
+  """
+  view = memoryview(data).cast('B')
+  offsets = list(offsets)
+  if not offsets or offsets[0] < 0 or offsets[-1] > len(view):
+    raise _tink_error.TinkError('offsets out of range')
+  values = []
+  for start, end in zip(offsets, offsets[1:]):
+    if end < start:
+      raise _tink_error.TinkError('offsets must not decrease')
+    values.append(bytes(view[start:end]))
+  return values
+
+
+def pack(values: Sequence[bytes],
+         prefix: bytes = b'') -> Tuple[bytes, memoryview]:
+  """Packs values, each preceded by prefix, into a batch (data, offsets).
+
+  Args:
+    values: The values to pack.
+    prefix: Bytes to put in front of every value.
+  Returns:
+    a tuple (data, offsets), where offsets is a memoryview of int64.
+  """
+  offsets = array.array('q', [0])
+  for value in values:
+    offsets.append(offsets[-1] + len(prefix) + len(value))
+  data = b''.join(prefix + value for value in values)
+  return data, memoryview(offsets)
@@ -0,0 +1,66 @@
+# Copyright 2021 Google LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Tests for tink.python.tink.core._packed_values."""
+
+from __future__ import absolute_import
+from __future__ import division
+from __future__ import print_function
+
+import array
+
+from absl.testing import absltest
+from tink import core
+
+
+class PackedValuesTest(absltest.TestCase):
+
+  def test_pack_unpack(self):
+    values = [b'', b'a', b'bc', b'', b'def']
+    data, offsets = core.packed_values.pack(values)
+    self.assertEqual(data, b'abcdef')
+    self.assertEqual(offsets.format, 'q')
+    self.assertEqual(offsets.tolist(), [0, 0, 1, 3, 3, 6])
+    self.assertEqual(core.packed_values.unpack(data, offsets), values)
+
+  def test_pack_with_prefix(self):
+    data, offsets = core.packed_values.pack([b'a', b'bc'], prefix=b'xy')
+    self.assertEqual(data, b'xyaxybc')
+    self.assertEqual(offsets.tolist(), [0, 3, 7])
+
+  def test_pack_empty(self):
+    data, offsets = core.packed_values.pack([])
+    self.assertEqual(data, b'')
+    self.assertEqual(offsets.tolist(), [0])
+    self.assertEqual(core.packed_values.unpack(data, offsets), [])
+
+  def test_unpack_buffer_offsets(self):
+    data = bytearray(b'hello world')
+    offsets = array.array('q', [0, 5, 6, 11])
+    self.assertEqual(
+        core.packed_values.unpack(data, offsets), [b'hello', b' ', b'world'])
+
+  def test_unpack_invalid_offsets(self):
+    with self.assertRaises(core.TinkError):
+      core.packed_values.unpack(b'abc', [])
+    with self.assertRaises(core.TinkError):
+      core.packed_values.unpack(b'abc', [0, 4])
+    with self.assertRaises(core.TinkError):
+      core.packed_values.unpack(b'abc', [-1, 2])
+    with self.assertRaises(core.TinkError):
+      core.packed_values.unpack(b'abc', [0, 2, 1])
+
+
+if __name__ == '__main__':
+  absltest.main()
@@ -20,10 +20,13 @@ from __future__ import division
 from __future__ import print_function
 
 import abc
+from typing import Any, Tuple
 
 # Special imports
 import six
 
+from tink import core
+
 
 @six.add_metaclass(abc.ABCMeta)
 class DeterministicAead(object):
@@ -59,3 +62,64 @@ class DeterministicAead(object):
   def decrypt_deterministically(self, ciphertext: bytes,
                                 associated_data: bytes) -> bytes:
     raise NotImplementedError()
+
+  def encrypt_deterministically_batch(
+      self,
+      plaintexts: Any,
+      offsets: Any,
+      associated_data: bytes,
+      output_prefix: bytes = b'') -> Tuple[bytes, memoryview]:
+    """Deterministically encrypts a packed batch of plaintexts.
+
+    Plaintext i is plaintexts[offsets[i]:offsets[i + 1]], where offsets holds
+    n + 1 int64 values, e.g. the buffers of a NumPy array or an Arrow
+    large_binary array (see tink.core.packed_values). Primitives backed by C++
+    encrypt the whole batch in one call without holding the GIL. The default
+    implementation calls encrypt_deterministically() for every plaintext.
+
+    Args:
+      plaintexts: A bytes-like object holding the plaintexts back-to-back.
+      offsets: n + 1 int64 offsets into plaintexts.
+      associated_data: bytes. The associated data of every plaintext.
+      output_prefix: bytes. Prepended to every ciphertext.
+    Returns:
+      the ciphertexts packed as a tuple (data, offsets).
+    Raises:
+      tink.TinkError if the offsets are invalid or any encryption fails.
+    """
+    return core.packed_values.pack([
+        self.encrypt_deterministically(plaintext, associated_data)
+        for plaintext in core.packed_values.unpack(plaintexts, offsets)
+    ], output_prefix)
+
+  def decrypt_deterministically_batch(
+      self,
+      ciphertexts: Any,
+      offsets: Any,
+      associated_data: bytes,
+      input_prefix: bytes = b'') -> Tuple[bytes, memoryview]:
+    """Decrypts a packed batch of deterministic ciphertexts.
+
+    The batch is laid out as for encrypt_deterministically_batch(). The
+    default implementation calls decrypt_deterministically() for every
+    ciphertext.
+
+    Args:
+      ciphertexts: A bytes-like object holding the ciphertexts back-to-back.
+      offsets: n + 1 int64 offsets into ciphertexts.
+      associated_data: bytes. The associated data of every ciphertext.
+      input_prefix: bytes. Every ciphertext must start with it, and it is
+        removed before decryption.
+    Returns:
+      the plaintexts packed as a tuple (data, offsets).
+    Raises:
+      tink.TinkError if the offsets are invalid or any decryption fails.
+    """
+    plaintexts = []
+    for ciphertext in core.packed_values.unpack(ciphertexts, offsets):
+      if not ciphertext.startswith(input_prefix):
+        raise core.TinkError('ciphertext does not start with input_prefix')
+      plaintexts.append(
+          self.decrypt_deterministically(ciphertext[len(input_prefix):],
+                                         associated_data))
+    return core.packed_values.pack(plaintexts)
@@ -19,6 +19,8 @@ from __future__ import division
 # Placeholder for import for type annotations
 from __future__ import print_function
 
+from typing import Any, Tuple
+
 from tink import core
 from tink.cc.pybind import tink_bindings
 from tink.daead import _deterministic_aead
@@ -43,6 +45,26 @@ class _DeterministicAeadCcToPyWrapper(_deterministic_aead.DeterministicAead):
     return self._deterministic_aead.decrypt_deterministically(
         ciphertext, associated_data)
 
+  @core.use_tink_errors
+  def encrypt_deterministically_batch(
+      self,
+      plaintexts: Any,
+      offsets: Any,
+      associated_data: bytes,
+      output_prefix: bytes = b'') -> Tuple[bytes, memoryview]:
+    return self._deterministic_aead.encrypt_deterministically_batch(
+        plaintexts, offsets, associated_data, output_prefix)
+
+  @core.use_tink_errors
+  def decrypt_deterministically_batch(
+      self,
+      ciphertexts: Any,
+      offsets: Any,
+      associated_data: bytes,
+      input_prefix: bytes = b'') -> Tuple[bytes, memoryview]:
+    return self._deterministic_aead.decrypt_deterministically_batch(
+        ciphertexts, offsets, associated_data, input_prefix)
+
 
 def register():
   """Registers all Hybrid key managers and wrapper in the Python Registry."""
@@ -19,7 +19,7 @@ from __future__ import division
 # Placeholder for import for type annotations
 from __future__ import print_function
 
-from typing import Type
+from typing import Any, Tuple, Type
 from absl import logging
 
 from tink import core
@@ -60,6 +60,37 @@ class _WrappedDeterministicAead(_deterministic_aead.DeterministicAead):
     # nothing works.
     raise core.TinkError('Decryption failed.')
 
+  def encrypt_deterministically_batch(
+      self,
+      plaintexts: Any,
+      offsets: Any,
+      associated_data: bytes,
+      output_prefix: bytes = b'') -> Tuple[bytes, memoryview]:
+    primary = self._primitive_set.primary()
+    return primary.primitive.encrypt_deterministically_batch(
+        plaintexts, offsets, associated_data,
+        output_prefix + primary.identifier)
+
+  def decrypt_deterministically_batch(
+      self,
+      ciphertexts: Any,
+      offsets: Any,
+      associated_data: bytes,
+      input_prefix: bytes = b'') -> Tuple[bytes, memoryview]:
+    # Batches are usually encrypted with the primary key, so first try to
+    # decrypt the whole batch with it in one call.
+    primary = self._primitive_set.primary()
+    try:
+      return primary.primitive.decrypt_deterministically_batch(
+          ciphertexts, offsets, associated_data,
+          input_prefix + primary.identifier)
+    except core.TinkError as e:
+      logging.info('cannot decrypt the batch with the primary key: %s', e)
+    return super(_WrappedDeterministicAead,
+                 self).decrypt_deterministically_batch(ciphertexts, offsets,
+                                                       associated_data,
+                                                       input_prefix)
+
 
 class DeterministicAeadWrapper(
     core.PrimitiveWrapper[_deterministic_aead.DeterministicAead,
@@ -138,6 +138,27 @@ class AeadWrapperTest(parameterized.TestCase):
     self.assertEqual(p4.decrypt_deterministically(ciphertext4, b'ad'),
                      b'plaintext')
 
+  @parameterized.parameters([DAEAD_TEMPLATE, RAW_DAEAD_TEMPLATE])
+  def test_encrypt_decrypt_batch(self, template):
+    keyset_handle = tink.new_keyset_handle(template)
+    primitive = keyset_handle.primitive(daead.DeterministicAead)
+    plaintexts = [b'', b'a', b'plaintext', b'a']
+    ciphertexts, offsets = primitive.encrypt_deterministically_batch(
+        *tink.core.packed_values.pack(plaintexts), b'ad')
+    self.assertEqual(
+        tink.core.packed_values.unpack(ciphertexts, offsets), [
+            primitive.encrypt_deterministically(plaintext, b'ad')
+            for plaintext in plaintexts
+        ])
+    data, plaintext_offsets = primitive.decrypt_deterministically_batch(
+        ciphertexts, offsets, b'ad')
+    self.assertEqual(
+        tink.core.packed_values.unpack(data, plaintext_offsets), plaintexts)
+    with self.assertRaises(tink.TinkError):
+      primitive.decrypt_deterministically_batch(ciphertexts, offsets,
+                                                b'wrong_ad')
+
+
 
 if __name__ == '__main__':
   absltest.main()
@@ -19,10 +19,13 @@ from __future__ import division
 from __future__ import print_function
 
 import abc
+from typing import Any, Tuple
 
 # Special imports
 import six
 
+from tink import core
+
 
 @six.add_metaclass(abc.ABCMeta)
 class Mac(object):
@@ -58,3 +61,58 @@ class Mac(object):
       verification fails.
     """
     raise NotImplementedError()
+
+  def compute_mac_batch(self, data: Any,
+                        offsets: Any) -> Tuple[bytes, memoryview]:
+    """Computes the MACs of a packed batch of messages.
+
+    Message i is data[offsets[i]:offsets[i + 1]], where offsets holds n + 1
+    int64 values, e.g. the buffers of a NumPy array or an Arrow large_binary
+    array (see tink.core.packed_values). Primitives backed by C++ compute the
+    whole batch in one call without holding the GIL. The default
+    implementation calls compute_mac() for every message.
+
+    Args:
+      data: A bytes-like object holding the messages back-to-back.
+      offsets: n + 1 int64 offsets into data.
+    Returns:
+      the MACs packed as a tuple (data, offsets).
+    Raises:
+      tink.TinkError if the offsets are invalid or any computation fails.
+    """
+    return core.packed_values.pack([
+        self.compute_mac(value)
+        for value in core.packed_values.unpack(data, offsets)
+    ])
+
+  def verify_mac_batch(self, macs: Any, mac_offsets: Any, data: Any,
+                       data_offsets: Any) -> bytes:
+    """Verifies a packed batch of MACs against a packed batch of messages.
+
+    Both batches are laid out as for compute_mac_batch(). The default
+    implementation calls verify_mac() for every pair.
+
+    Args:
+      macs: A bytes-like object holding the MACs back-to-back.
+      mac_offsets: n + 1 int64 offsets into macs.
+      data: A bytes-like object holding the messages back-to-back.
+      data_offsets: n + 1 int64 offsets into data.
+    Returns:
+      n bytes, where byte i is 1 if MAC i is valid for message i, and 0
+      otherwise.
+    Raises:
+      tink.TinkError if the offsets are invalid or the batches have
+      different lengths.
+    """
+    mac_values = core.packed_values.unpack(macs, mac_offsets)
+    data_values = core.packed_values.unpack(data, data_offsets)
+    if len(mac_values) != len(data_values):
+      raise core.TinkError('macs and data have different lengths')
+    valid = bytearray(len(mac_values))
+    for i, (mac_value, value) in enumerate(zip(mac_values, data_values)):
+      try:
+        self.verify_mac(mac_value, value)
+        valid[i] = 1
+      except core.TinkError:
+        pass
+    return bytes(valid)
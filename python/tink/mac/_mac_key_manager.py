@@ -18,6 +18,8 @@ from __future__ import division
 # Placeholder for import for type annotations
 from __future__ import print_function
 
+from typing import Any, Tuple
+
 from tink import core
 from tink.cc.pybind import tink_bindings
 from tink.mac import _mac
@@ -38,6 +40,17 @@ class _MacCcToPyWrapper(_mac.Mac):
   def verify_mac(self, mac_value: bytes, data: bytes) -> None:
     self._cc_mac.verify_mac(mac_value, data)
 
+  @core.use_tink_errors
+  def compute_mac_batch(self, data: Any,
+                        offsets: Any) -> Tuple[bytes, memoryview]:
+    return self._cc_mac.compute_mac_batch(data, offsets)
+
+  @core.use_tink_errors
+  def verify_mac_batch(self, macs: Any, mac_offsets: Any, data: Any,
+                       data_offsets: Any) -> bytes:
+    return self._cc_mac.verify_mac_batch(macs, mac_offsets, data,
+                                         data_offsets)
+
 
 def register():
   tink_bindings.register()
@@ -129,6 +129,23 @@ class MacWrapperTest(parameterized.TestCase):
     mac3.verify_mac(mac_value4, b'plaintext')
     mac4.verify_mac(mac_value4, b'plaintext')
 
+  @parameterized.parameters([MAC_TEMPLATE, RAW_MAC_TEMPLATE])
+  def test_compute_verify_batch(self, template):
+    keyset_handle = tink.new_keyset_handle(template)
+    primitive = keyset_handle.primitive(mac.Mac)
+    data = [b'', b'a', b'data']
+    macs, mac_offsets = primitive.compute_mac_batch(
+        *tink.core.packed_values.pack(data))
+    mac_values = tink.core.packed_values.unpack(macs, mac_offsets)
+    self.assertEqual(mac_values,
+                     [primitive.compute_mac(value) for value in data])
+    mac_values[1] = mac_values[0]
+    self.assertEqual(
+        primitive.verify_mac_batch(
+            *(tink.core.packed_values.pack(mac_values) +
+              tink.core.packed_values.pack(data))), b'\x01\x00\x01')
+
+
 
 if __name__ == '__main__':
   absltest.main()
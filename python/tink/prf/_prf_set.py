@@ -17,10 +17,12 @@ from __future__ import division
 from __future__ import print_function
 
 import abc
-from typing import Mapping
+from typing import Any, Mapping
 # Special imports
 import six
 
+from tink import core
+
 
 @six.add_metaclass(abc.ABCMeta)
 class Prf(object):
@@ -64,6 +66,29 @@ class Prf(object):
     """
     raise NotImplementedError()
 
+  def compute_batch(self, inputs: Any, offsets: Any,
+                    output_length: int) -> bytes:
+    """Computes the PRF on a packed batch of inputs.
+
+    Input i is inputs[offsets[i]:offsets[i + 1]], where offsets holds n + 1
+    int64 values, e.g. the buffers of a NumPy array or an Arrow large_binary
+    array (see tink.core.packed_values). Primitives backed by C++ compute the
+    whole batch in one call without holding the GIL. The default
+    implementation calls compute() for every input.
+
+    Args:
+      inputs: A bytes-like object holding the inputs back-to-back.
+      offsets: n + 1 int64 offsets into inputs.
+      output_length: The length of every output, as for compute().
+
+    Returns:
+      the outputs back-to-back: the one for input i starts at
+      i * output_length.
+    """
+    return b''.join(
+        self.compute(value, output_length)
+        for value in core.packed_values.unpack(inputs, offsets))
+
 
 @six.add_metaclass(abc.ABCMeta)
 class PrfSet(object):
@@ -52,10 +52,16 @@ class RawDecryptingStream(io.RawIOBase):
     self._close_ciphertext_source = close_ciphertext_source
     if not ciphertext_source.readable():
       raise ValueError('ciphertext_source must be readable')
-    cc_ciphertext_source = file_object_adapter.FileObjectAdapter(
-        ciphertext_source)
-    self._input_stream_adapter = self._get_input_stream_adapter(
-        stream_aead, associated_data, cc_ciphertext_source)
+    # If ciphertext_source is a regular file, C++ reads from it directly.
+    source_fd = file_object_adapter.native_file_descriptor(ciphertext_source)
+    if source_fd is not None:
+      self._input_stream_adapter = self._get_input_stream_adapter_from_fd(
+          stream_aead, associated_data, source_fd)
+    else:
+      cc_ciphertext_source = file_object_adapter.FileObjectAdapter(
+          ciphertext_source)
+      self._input_stream_adapter = self._get_input_stream_adapter(
+          stream_aead, associated_data, cc_ciphertext_source)
 
   @staticmethod
   @core.use_tink_errors
@@ -64,11 +70,31 @@ class RawDecryptingStream(io.RawIOBase):
     return tink_bindings.new_cc_decrypting_stream(
         cc_primitive, aad, source)
 
+  @staticmethod
+  @core.use_tink_errors
+  def _get_input_stream_adapter_from_fd(cc_primitive, aad, source_fd):
+    """Implemented as a separate method to ensure correct error transform."""
+    return tink_bindings.new_cc_decrypting_stream_from_fd(
+        cc_primitive, aad, source_fd)
+
   @core.use_tink_errors
   def _read_from_input_stream_adapter(self, size: int) -> bytes:
     """Implemented as a separate method to ensure correct error transform."""
     return self._input_stream_adapter.read(size)
 
+  @core.use_tink_errors
+  def _readinto_from_input_stream_adapter(self, b: memoryview) -> int:
+    """Implemented as a separate method to ensure correct error transform."""
+    return self._input_stream_adapter.readinto(b)
+
+  @staticmethod
+  def _is_eof(e: core.TinkError) -> bool:
+    """Returns True if e was raised because of a C++ OUT_OF_RANGE status."""
+    wrapped_e = e.args[0]
+    return (isinstance(wrapped_e, tink_bindings.StatusNotOk) and
+            (wrapped_e.status.error_code() ==
+             tink_bindings.ErrorCode.OUT_OF_RANGE))
+
   def read(self, size=-1) -> bytes:
     """Read and return up to size bytes, where size is an int.
 
@@ -102,15 +128,10 @@ class RawDecryptingStream(io.RawIOBase):
         if data:
           return data
     except core.TinkError as e:
-      # We are checking if the exception was raised because of C++
-      # OUT_OF_RANGE status, which signals EOF.
-      wrapped_e = e.args[0]
-      if (isinstance(wrapped_e, tink_bindings.StatusNotOk) and
-          (wrapped_e.status.error_code() ==
-           tink_bindings.ErrorCode.OUT_OF_RANGE)):
+      # C++ OUT_OF_RANGE status signals EOF.
+      if self._is_eof(e):
         return b''
-      else:
-        raise e
+      raise e
 
   def readinto(self, b: bytearray) -> int:
     """Read bytes into a pre-allocated bytes-like object b.
@@ -125,10 +146,22 @@ class RawDecryptingStream(io.RawIOBase):
     Raises:
       TinkError if there was a permanent error.
     """
-    data = self.read(len(b))
-    n = len(data)
-    b[:n] = data
-    return n
+    if self.closed:  # pylint:disable=using-constant-test
+      raise ValueError('read on closed file.')
+    # Decrypts directly into b. Like read(), blocks until some data is
+    # available.
+    with memoryview(b) as view, view.cast('B') as flat:
+      if not flat:
+        return 0
+      try:
+        while True:
+          n = self._readinto_from_input_stream_adapter(flat)
+          if n:
+            return n
+      except core.TinkError as e:
+        if self._is_eof(e):
+          return 0
+        raise e
 
   def close(self) -> None:
     """Close the stream. Has no effect on a closed stream."""
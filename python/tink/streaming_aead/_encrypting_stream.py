@@ -35,6 +35,13 @@ def _new_cc_encrypting_stream(cc_primitive, aad, destination):
       cc_primitive, aad, destination)
 
 
+@core.use_tink_errors
+def _new_cc_encrypting_stream_from_fd(cc_primitive, aad, destination_fd):
+  """Implemented as a separate function to ensure correct error transform."""
+  return tink_bindings.new_cc_encrypting_stream_from_fd(
+      cc_primitive, aad, destination_fd)
+
+
 class RawEncryptingStream(io.RawIOBase):
   """A file-like object which wraps writes to an underlying file-like object.
 
@@ -60,14 +67,26 @@ class RawEncryptingStream(io.RawIOBase):
     super(RawEncryptingStream, self).__init__()
     if not ciphertext_destination.writable():
       raise ValueError('ciphertext_destination must be writable')
-    cc_ciphertext_destination = file_object_adapter.FileObjectAdapter(
+    # If ciphertext_destination is a regular file, C++ writes to it directly.
+    # Like FileObjectAdapter, ciphertext_destination is then closed when this
+    # stream is closed.
+    self._ciphertext_destination = None
+    destination_fd = file_object_adapter.native_file_descriptor(
         ciphertext_destination)
-    self._cc_encrypting_stream = _new_cc_encrypting_stream(
-        stream_aead, associated_data, cc_ciphertext_destination)
+    if destination_fd is not None:
+      self._ciphertext_destination = ciphertext_destination
+      self._cc_encrypting_stream = _new_cc_encrypting_stream_from_fd(
+          stream_aead, associated_data, destination_fd)
+    else:
+      cc_ciphertext_destination = file_object_adapter.FileObjectAdapter(
+          ciphertext_destination)
+      self._cc_encrypting_stream = _new_cc_encrypting_stream(
+          stream_aead, associated_data, cc_ciphertext_destination)
 
   @core.use_tink_errors
   def _write_to_cc_encrypting_stream(self, b: bytes) -> int:
-    return self._cc_encrypting_stream.write(bytes(b))
+    # The C++ stream reads b in place, without copying it to a bytes object.
+    return self._cc_encrypting_stream.write(b)
 
   @core.use_tink_errors
   def _close_cc_encrypting_stream(self) -> None:
@@ -105,6 +124,8 @@ class RawEncryptingStream(io.RawIOBase):
       return
     self.flush()
     self._close_cc_encrypting_stream()
+    if self._ciphertext_destination is not None:
+      self._ciphertext_destination.close()
     super(RawEncryptingStream, self).close()
 
   def writable(self) -> bool:
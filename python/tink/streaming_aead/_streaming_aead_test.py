@@ -24,6 +24,7 @@ from absl.testing import absltest
 
 import tink
 from tink import streaming_aead
+from tink.testing import bytes_io
 
 
 def setUpModule():
@@ -99,6 +100,44 @@ class StreamingAeadTest(absltest.TestCase):
           self.assertEqual(text_line, text_lines[i])
       self.assertTrue(src.closed)
 
+  def test_encrypt_decrypt_after_header(self):
+    primitive = get_primitive()
+    long_plaintext = b' '.join(b'%d' % i for i in range(100 * 1000))
+    aad = b'associated_data'
+    with tempfile.TemporaryDirectory() as tmpdirname:
+      filename = os.path.join(tmpdirname, 'encrypted_file_with_header')
+      dest = open(filename, 'wb')
+      dest.write(b'header')  # Still in the Python buffer.
+      with primitive.new_encrypting_stream(dest, aad) as es:
+        es.write(long_plaintext)
+      self.assertTrue(dest.closed)
+
+      for buffering in (0, -1):
+        src = open(filename, 'rb', buffering=buffering)
+        self.assertEqual(src.read(6), b'header')
+        with primitive.new_decrypting_stream(src, aad) as ds:
+          output = ds.read()
+        self.assertEqual(output, long_plaintext)
+
+  def test_decrypt_readinto(self):
+    primitive = get_primitive()
+    long_plaintext = b' '.join(b'%d' % i for i in range(100 * 1000))
+    aad = b'associated_data'
+    ciphertext = bytes_io.BytesIOWithValueAfterClose()
+    with primitive.new_encrypting_stream(ciphertext, aad) as es:
+      es.write(memoryview(long_plaintext))
+
+    output = bytearray()
+    buffer = bytearray(10000)
+    with primitive.new_decrypting_stream(
+        io.BytesIO(ciphertext.value_after_close()), aad) as ds:
+      while True:
+        n = ds.readinto(buffer)
+        if not n:
+          break
+        output += buffer[:n]
+    self.assertEqual(bytes(output), long_plaintext)
+
   def test_encrypt_fails_on_nonwritable_stream(self):
     primitive = get_primitive()
     with tempfile.TemporaryDirectory() as tmpdirname:
@@ -21,11 +21,47 @@ from __future__ import division
 from __future__ import print_function
 
 import io
-from typing import BinaryIO
+import os
+import stat
+from typing import BinaryIO, Optional
 
 from tink.cc.pybind import tink_bindings
 
 
+def native_file_descriptor(file_object: BinaryIO) -> Optional[int]:
+  """Returns the descriptor of the regular file that file_object reads/writes.
+
+  C++ streams can then use the descriptor directly, without calling back into
+  Python. This is only possible for files opened with open() in binary mode
+  whose Python buffer is empty; writable files are flushed first.
+
+  Args:
+    file_object: A file-like object.
+
+  Returns:
+    The file descriptor, or None if file_object has to be accessed through its
+    Python methods.
+  """
+  raw = file_object
+  if isinstance(file_object,
+                (io.BufferedReader, io.BufferedWriter, io.BufferedRandom)):
+    raw = file_object.raw
+  if not isinstance(raw, io.FileIO):
+    return None
+  try:
+    if file_object.writable():
+      file_object.flush()
+    # A difference means that the Python buffer holds read-ahead bytes.
+    if file_object.tell() != raw.tell():
+      return None
+    fd = raw.fileno()
+    if not stat.S_ISREG(os.fstat(fd).st_mode):
+      return None
+    return fd
+  except (OSError, ValueError):
+    return None
+
+
 class FileObjectAdapter(tink_bindings.PythonFileObjectAdapter):
   """Adapts a Python file object for use in C++."""
 
@@ -70,3 +106,34 @@ class FileObjectAdapter(tink_bindings.PythonFileObjectAdapter):
       return data
     except io.BlockingIOError:
       return b''
+
+  def readinto(self, buffer: memoryview) -> int:
+    """Reads at most len(buffer) bytes from the file object into buffer.
+
+    Uses the readinto() of the file object if it has one, which avoids
+    creating an intermediate bytes object.
+
+    Args:
+      buffer: A writable bytes-like object.
+
+    Returns:
+      The number of bytes read. 0 is returned if no bytes are available at the
+      moment.
+
+    Raises:
+      EOFError if the file object is already at EOF.
+    """
+    readinto = getattr(self._file_object, 'readinto', None)
+    if readinto is None:
+      data = self.read(len(buffer))
+      buffer[:len(data)] = data
+      return len(data)
+    try:
+      count = readinto(buffer)
+      if count is None:
+        return 0
+      elif count == 0 and len(buffer) > 0:
+        raise EOFError('EOF')
+      return count
+    except io.BlockingIOError:
+      return 0
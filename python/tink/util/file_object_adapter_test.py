@@ -119,6 +119,54 @@ class FileObjectAdapterTest(absltest.TestCase):
 
     self.assertEqual(adapter.read(10), b'')
 
+  def test_readinto(self):
+    file_object = io.BytesIO(b'something')
+    adapter = file_object_adapter.FileObjectAdapter(file_object)
+    buffer = bytearray(5)
+
+    self.assertEqual(adapter.readinto(memoryview(buffer)), 5)
+    self.assertEqual(buffer, b'somet')
+    self.assertEqual(adapter.readinto(memoryview(buffer)), 4)
+    self.assertEqual(buffer[:4], b'hing')
+    with self.assertRaises(EOFError):
+      adapter.readinto(memoryview(buffer))
+
+  def test_readinto_without_readinto_method(self):
+    file_object = mock.Mock(spec=['read'])
+    file_object.read = mock.Mock(return_value=b'some')
+    adapter = file_object_adapter.FileObjectAdapter(file_object)
+    buffer = bytearray(10)
+
+    self.assertEqual(adapter.readinto(memoryview(buffer)), 4)
+    self.assertEqual(buffer[:4], b'some')
+    file_object.read.assert_called_once_with(10)
+
+  def test_readinto_returns_none(self):
+    file_object = mock.Mock()
+    file_object.readinto = mock.Mock(return_value=None)
+    adapter = file_object_adapter.FileObjectAdapter(file_object)
+
+    self.assertEqual(adapter.readinto(memoryview(bytearray(10))), 0)
+
+  def test_native_file_descriptor(self):
+    path = self.create_tempfile(content=b'something').full_path
+    with open(path, 'rb') as f:
+      self.assertEqual(file_object_adapter.native_file_descriptor(f),
+                       f.fileno())
+      f.read(1)  # Fills the Python buffer.
+      self.assertIsNone(file_object_adapter.native_file_descriptor(f))
+    with open(path, 'ab') as f:
+      f.write(b'more')
+      self.assertEqual(file_object_adapter.native_file_descriptor(f),
+                       f.fileno())
+    with open(path, 'rb') as f:
+      self.assertEqual(f.read(), b'somethingmore')
+
+  def test_native_file_descriptor_not_a_file(self):
+    self.assertIsNone(
+        file_object_adapter.native_file_descriptor(io.BytesIO(b'something')))
+    self.assertIsNone(file_object_adapter.native_file_descriptor(mock.Mock()))
+
 
 if __name__ == '__main__':
   absltest.main()
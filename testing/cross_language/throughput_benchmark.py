@@ -0,0 +1,226 @@
+# Copyright 2020 Google LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+"""Compares the throughput of the testing servers of all languages.
+
+Starts the testing servers, and for every key template, language, operation,
+message size and concurrency calls the server for --duration_seconds. Reports
+operations per second, MB per second and latency percentiles. All languages
+use the same keyset, generated by the first language supporting its template.
+
+Usage:
+  bazel run :throughput_benchmark -- \\
+      --primitives=aead,streaming_aead --concurrency=1,16 \\
+      --message_sizes=100,1048576 --output_csv=/tmp/throughput.csv
+
+The servers are found as for the tests, in TINK_SRC_PATH if it is set.
+Latencies include the gRPC round trip from this Python client, which becomes
+the bottleneck with high concurrency and small messages: the numbers are meant
+to compare languages with each other, not as absolute throughputs of Tink.
+"""
+
+from __future__ import absolute_import
+from __future__ import division
+# Placeholder for import for type annotations
+from __future__ import print_function
+
+import csv
+import io
+import os
+import tempfile
+
+from typing import Callable, List, Text, Tuple
+
+from absl import app
+from absl import flags
+from absl import logging
+
+from tink import aead
+from tink import daead
+from tink import hybrid
+from tink import mac
+from tink import signature
+from tink import streaming_aead
+
+from util import load_generator
+from util import supported_key_types
+from util import testing_servers
+
+FLAGS = flags.FLAGS
+
+_KEY_TYPES_BY_PRIMITIVE = {
+    'aead': supported_key_types.AEAD_KEY_TYPES,
+    'daead': supported_key_types.DAEAD_KEY_TYPES,
+    'streaming_aead': supported_key_types.STREAMING_AEAD_KEY_TYPES,
+    'hybrid': supported_key_types.HYBRID_PRIVATE_KEY_TYPES,
+    'mac': supported_key_types.MAC_KEY_TYPES,
+    'signature': supported_key_types.SIGNATURE_KEY_TYPES,
+}
+
+flags.DEFINE_list('primitives', ['aead', 'streaming_aead', 'signature'],
+                  'Primitives to benchmark, out of %s.' %
+                  ', '.join(sorted(_KEY_TYPES_BY_PRIMITIVE)))
+flags.DEFINE_list('key_templates', [],
+                  'Key template names to benchmark. Defaults to all templates '
+                  'of --primitives.')
+flags.DEFINE_list('languages', testing_servers.LANGUAGES,
+                  'Languages whose servers are benchmarked.')
+flags.DEFINE_list('concurrency', ['1', '8'],
+                  'Numbers of concurrent calls to benchmark.')
+flags.DEFINE_list('message_sizes', ['1024', '1048576'],
+                  'Message sizes in bytes to benchmark. gRPC limits messages '
+                  'to 4 MB.')
+flags.DEFINE_float('duration_seconds', 5.0,
+                   'How long each measurement runs.')
+flags.DEFINE_float('warmup_seconds', 1.0,
+                   'How long each operation runs before it is measured.')
+flags.DEFINE_string('output_csv', None,
+                    'If set, the results are also written to this CSV file.')
+
+_ASSOCIATED_DATA = b'associated_data'
+
+_COLUMNS = [
+    'primitive', 'key_template', 'language', 'operation', 'message_size',
+    'concurrency', 'operations', 'errors', 'ops_per_second', 'mb_per_second',
+    'p50_ms', 'p90_ms', 'p99_ms'
+]
+
+Operation = Tuple[Text, Callable[[], None]]
+
+
+def _operations(primitive: Text, lang: Text, keyset: bytes,
+                message: bytes) -> List[Operation]:
+  """Returns the named operations of primitive, called through lang's server."""
+  data = _ASSOCIATED_DATA
+  if primitive == 'aead':
+    p = testing_servers.aead(lang, keyset)
+    ciphertext = p.encrypt(message, data)
+    return [('encrypt', lambda: p.encrypt(message, data)),
+            ('decrypt', lambda: p.decrypt(ciphertext, data))]
+  if primitive == 'daead':
+    p = testing_servers.deterministic_aead(lang, keyset)
+    ciphertext = p.encrypt_deterministically(message, data)
+    return [('encrypt', lambda: p.encrypt_deterministically(message, data)),
+            ('decrypt', lambda: p.decrypt_deterministically(ciphertext, data))]
+  if primitive == 'streaming_aead':
+    p = testing_servers.streaming_aead(lang, keyset)
+
+    def encrypt():
+      return p.new_encrypting_stream(io.BytesIO(message), data).read()
+
+    ciphertext = encrypt()
+
+    def decrypt():
+      return p.new_decrypting_stream(io.BytesIO(ciphertext), data).read()
+
+    return [('encrypt', encrypt), ('decrypt', decrypt)]
+  if primitive == 'hybrid':
+    public_keyset = testing_servers.public_keyset(lang, keyset)
+    enc = testing_servers.hybrid_encrypt(lang, public_keyset)
+    dec = testing_servers.hybrid_decrypt(lang, keyset)
+    ciphertext = enc.encrypt(message, data)
+    return [('encrypt', lambda: enc.encrypt(message, data)),
+            ('decrypt', lambda: dec.decrypt(ciphertext, data))]
+  if primitive == 'mac':
+    p = testing_servers.mac(lang, keyset)
+    mac_value = p.compute_mac(message)
+    return [('compute', lambda: p.compute_mac(message)),
+            ('verify', lambda: p.verify_mac(mac_value, message))]
+  if primitive == 'signature':
+    public_keyset = testing_servers.public_keyset(lang, keyset)
+    signer = testing_servers.public_key_sign(lang, keyset)
+    verifier = testing_servers.public_key_verify(lang, public_keyset)
+    sig = signer.sign(message)
+    return [('sign', lambda: signer.sign(message)),
+            ('verify', lambda: verifier.verify(sig, message))]
+  raise ValueError('Unknown primitive %s' % primitive)
+
+
+def _key_template_names(primitive: Text) -> List[Text]:
+  names = []
+  for key_type in _KEY_TYPES_BY_PRIMITIVE[primitive]:
+    for name in supported_key_types.KEY_TEMPLATE_NAMES[key_type]:
+      if not FLAGS.key_templates or name in FLAGS.key_templates:
+        names.append(name)
+  return names
+
+
+def _benchmark(primitive: Text, key_template_name: Text) -> List[List]:
+  """Returns the result rows of one key template in all languages."""
+  supported_langs = supported_key_types.SUPPORTED_LANGUAGES_BY_TEMPLATE_NAME[
+      key_template_name]
+  langs = [lang for lang in FLAGS.languages if lang in supported_langs]
+  if not langs:
+    return []
+  keyset = testing_servers.new_keyset(
+      supported_langs[0], supported_key_types.KEY_TEMPLATE[key_template_name])
+  rows = []
+  for message_size in [int(s) for s in FLAGS.message_sizes]:
+    message = os.urandom(message_size)
+    for lang in langs:
+      for name, operation in _operations(primitive, lang, keyset, message):
+        for concurrency in [int(c) for c in FLAGS.concurrency]:
+          result = load_generator.run(
+              operation, concurrency, FLAGS.duration_seconds,
+              FLAGS.warmup_seconds)
+          if result.errors:
+            logging.warning('%s %s %s %s: %d errors, first: %s', primitive,
+                            key_template_name, lang, name, result.errors,
+                            result.first_error)
+          ops_per_second = result.operations_per_second()
+          row = [
+              primitive, key_template_name, lang, name, message_size,
+              concurrency, result.operations, result.errors,
+              ops_per_second, ops_per_second * message_size / 1e6,
+              result.percentile(50) * 1e3, result.percentile(90) * 1e3,
+              result.percentile(99) * 1e3
+          ]
+          print('%-14s %-40s %-6s %-7s %9d %4d %8d %4d %10.1f %9.2f %8.3f '
+                '%8.3f %8.3f' % tuple(row))
+          rows.append(row)
+  return rows
+
+
+def main(argv):
+  if len(argv) > 1:
+    raise app.UsageError('Too many command-line arguments.')
+  unknown_primitives = set(FLAGS.primitives) - set(_KEY_TYPES_BY_PRIMITIVE)
+  if unknown_primitives:
+    raise app.UsageError('Unknown primitives: %s' %
+                         ', '.join(sorted(unknown_primitives)))
+  aead.register()
+  daead.register()
+  hybrid.register()
+  mac.register()
+  signature.register()
+  streaming_aead.register()
+  # The servers write their logs where Bazel tests keep undeclared outputs.
+  os.environ.setdefault('TEST_UNDECLARED_OUTPUTS_DIR', tempfile.mkdtemp())
+  testing_servers.start('throughput_benchmark')
+  try:
+    print(' '.join(_COLUMNS))
+    rows = []
+    for primitive in FLAGS.primitives:
+      for key_template_name in _key_template_names(primitive):
+        rows.extend(_benchmark(primitive, key_template_name))
+  finally:
+    testing_servers.stop()
+  if FLAGS.output_csv:
+    with open(FLAGS.output_csv, 'w') as f:
+      writer = csv.writer(f)
+      writer.writerow(_COLUMNS)
+      writer.writerows(rows)
+
+
+if __name__ == '__main__':
+  app.run(main)
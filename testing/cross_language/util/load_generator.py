@@ -0,0 +1,121 @@
+# Copyright 2020 Google LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+"""Drives an operation from several threads and measures its throughput."""
+
+from __future__ import absolute_import
+from __future__ import division
+# Placeholder for import for type annotations
+from __future__ import print_function
+
+import math
+import threading
+import time
+
+from typing import Callable, List, Optional
+
+
+class LoadResult(object):
+  """Latencies of the operations of one load run."""
+
+  def __init__(self, latencies: List[float], elapsed_seconds: float,
+               errors: int, first_error: Optional[Exception]) -> None:
+    self.latencies = sorted(latencies)
+    self.elapsed_seconds = elapsed_seconds
+    self.errors = errors
+    self.first_error = first_error
+
+  @property
+  def operations(self) -> int:
+    return len(self.latencies)
+
+  def operations_per_second(self) -> float:
+    if self.elapsed_seconds <= 0:
+      return 0.0
+    return self.operations / self.elapsed_seconds
+
+  def percentile(self, p: float) -> float:
+    """Returns the p-th percentile latency in seconds, by nearest rank."""
+    if not 0 <= p <= 100:
+      raise ValueError('p must be in [0, 100]')
+    if not self.latencies:
+      return 0.0
+    rank = max(1, int(math.ceil(p / 100.0 * len(self.latencies))))
+    return self.latencies[rank - 1]
+
+
+def run(operation: Callable[[], None],
+        concurrency: int,
+        duration_seconds: float,
+        warmup_seconds: float = 0.0) -> LoadResult:
+  """Calls operation from 'concurrency' threads for duration_seconds.
+
+  Each thread calls operation in a loop. Calls during the first warmup_seconds
+  are not measured, so that connections and caches of the server are set up.
+  Exceptions raised by operation are counted as errors; the thread keeps
+  going.
+
+  Args:
+    operation: The function to call. Must be thread-safe.
+    concurrency: The number of threads, each with one call in flight.
+    duration_seconds: How long to measure.
+    warmup_seconds: How long to call operation before measuring.
+
+  Returns:
+    The measured latencies.
+  """
+  if concurrency < 1:
+    raise ValueError('concurrency must be positive')
+  if duration_seconds <= 0:
+    raise ValueError('duration_seconds must be positive')
+  lock = threading.Lock()
+  latencies = []
+  errors = [0]
+  first_error = [None]
+  start = time.monotonic() + warmup_seconds
+  end = start + duration_seconds
+
+  def worker():
+    local_latencies = []
+    local_errors = 0
+    local_first_error = None
+    while True:
+      before = time.monotonic()
+      if before >= end:
+        break
+      try:
+        operation()
+      except Exception as e:  # pylint: disable=broad-except
+        if before >= start:
+          local_errors += 1
+          if local_first_error is None:
+            local_first_error = e
+        continue
+      after = time.monotonic()
+      if before >= start:
+        local_latencies.append(after - before)
+    with lock:
+      latencies.extend(local_latencies)
+      errors[0] += local_errors
+      if first_error[0] is None:
+        first_error[0] = local_first_error
+
+  threads = [threading.Thread(target=worker) for _ in range(concurrency)]
+  for thread in threads:
+    thread.start()
+  for thread in threads:
+    thread.join()
+  # Calls started before 'end' may finish after it: measure until the last one
+  # finished.
+  return LoadResult(latencies, time.monotonic() - start, errors[0],
+                    first_error[0])
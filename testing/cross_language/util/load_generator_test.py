@@ -0,0 +1,75 @@
+# Copyright 2020 Google LLC
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#      http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+"""Tests for tink.testing.cross_language.util.load_generator."""
+
+import threading
+
+from absl.testing import absltest
+from util import load_generator
+
+
+class LoadGeneratorTest(absltest.TestCase):
+
+  def test_percentile(self):
+    result = load_generator.LoadResult(
+        [float(i) for i in range(100, 0, -1)], 10.0, 0, None)
+    self.assertEqual(result.operations, 100)
+    self.assertEqual(result.operations_per_second(), 10.0)
+    self.assertEqual(result.percentile(0), 1.0)
+    self.assertEqual(result.percentile(50), 50.0)
+    self.assertEqual(result.percentile(99), 99.0)
+    self.assertEqual(result.percentile(100), 100.0)
+    with self.assertRaises(ValueError):
+      result.percentile(101)
+
+  def test_percentile_without_operations(self):
+    result = load_generator.LoadResult([], 0.0, 0, None)
+    self.assertEqual(result.percentile(50), 0.0)
+    self.assertEqual(result.operations_per_second(), 0.0)
+
+  def test_run_uses_all_threads(self):
+    lock = threading.Lock()
+    thread_ids = set()
+
+    def operation():
+      with lock:
+        thread_ids.add(threading.get_ident())
+
+    result = load_generator.run(
+        operation, concurrency=4, duration_seconds=0.2, warmup_seconds=0.05)
+    self.assertGreater(result.operations, 0)
+    self.assertEqual(result.errors, 0)
+    self.assertIsNone(result.first_error)
+    self.assertLen(thread_ids, 4)
+    self.assertGreaterEqual(result.elapsed_seconds, 0.2)
+
+  def test_run_counts_errors(self):
+    def operation():
+      raise ValueError('failed')
+
+    result = load_generator.run(
+        operation, concurrency=2, duration_seconds=0.1)
+    self.assertEqual(result.operations, 0)
+    self.assertGreater(result.errors, 0)
+    self.assertIsInstance(result.first_error, ValueError)
+
+  def test_run_invalid_arguments(self):
+    with self.assertRaises(ValueError):
+      load_generator.run(lambda: None, concurrency=0, duration_seconds=1)
+    with self.assertRaises(ValueError):
+      load_generator.run(lambda: None, concurrency=1, duration_seconds=0)
+
+
+if __name__ == '__main__':
+  absltest.main()